@@ -216,6 +216,29 @@ def envoy_cc_test(name,
         local = local,
     )
 
+# Envoy C++ microbenchmark binaries should be specified with this function. They are not tests, so
+# they don't run as part of bazel test. Run them with bazel run -c opt for meaningful numbers.
+def envoy_cc_benchmark_binary(name,
+                              srcs = [],
+                              data = [],
+                              external_deps = [],
+                              deps = [],
+                              repository = ""):
+    native.cc_binary(
+        name = name,
+        srcs = srcs,
+        data = data,
+        copts = envoy_copts(repository, test = True),
+        linkopts = envoy_test_linkopts(),
+        testonly = 1,
+        linkstatic = 1,
+        malloc = tcmalloc_external_dep(repository),
+        deps = deps + [envoy_external_dep_path(dep) for dep in external_deps] + [
+            envoy_external_dep_path('benchmark'),
+            repository + "//test/benchmark:main",
+        ],
+    )
+
 # Envoy C++ test related libraries (that want gtest, gmock) should be specified
 # with this function.
 def envoy_cc_test_library(name,
@@ -0,0 +1,15 @@
+#!/bin/bash
+
+set -e
+
+VERSION=v1.2.0
+
+wget -O benchmark-"$VERSION".tar.gz https://github.com/google/benchmark/archive/"$VERSION".tar.gz
+tar xf benchmark-"$VERSION".tar.gz
+cd benchmark-"${VERSION#v}"
+cmake -DCMAKE_INSTALL_PREFIX:PATH="$THIRDPARTY_BUILD" \
+  -DCMAKE_CXX_FLAGS:STRING="${CXXFLAGS} ${CPPFLAGS}" \
+  -DCMAKE_C_FLAGS:STRING="${CFLAGS} ${CPPFLAGS}" \
+  -DBENCHMARK_ENABLE_TESTING=OFF \
+  -DCMAKE_BUILD_TYPE=Release .
+make VERBOSE=1 install
@@ -0,0 +1,13 @@
+#!/bin/bash
+
+set -e
+
+VERSION=2017-11-01
+
+wget -O re2-"$VERSION".tar.gz https://github.com/google/re2/archive/"$VERSION".tar.gz
+tar xf re2-"$VERSION".tar.gz
+cd re2-"$VERSION"
+make CXX="$CXX" CXXFLAGS="${CXXFLAGS} ${CPPFLAGS} -std=c++11 -O3 -g -pthread" obj/libre2.a
+cp obj/libre2.a "$THIRDPARTY_BUILD"/lib
+mkdir -p "$THIRDPARTY_BUILD"/include/re2
+cp re2/re2.h re2/set.h re2/stringpiece.h "$THIRDPARTY_BUILD"/include/re2
@@ -0,0 +1,13 @@
+#!/bin/bash
+
+set -e
+
+VERSION=0.6.3
+
+wget -O xxhash-"$VERSION".tar.gz https://github.com/Cyan4973/xxHash/archive/v"$VERSION".tar.gz
+tar xf xxhash-"$VERSION".tar.gz
+cd xxHash-"$VERSION"
+$CC $CFLAGS $CPPFLAGS -O3 -c xxhash.c -o xxhash.o
+ar rcs libxxhash.a xxhash.o
+cp libxxhash.a "$THIRDPARTY_BUILD"/lib
+cp xxhash.h "$THIRDPARTY_BUILD"/include
@@ -17,6 +17,32 @@ struct RawSlice {
   uint64_t len_;
 };
 
+/**
+ * Externally owned data that is added to a buffer without copying it via addBufferFragment(). Once
+ * no buffer references the data anymore, done() is called on the fragment.
+ */
+class BufferFragment {
+public:
+  /**
+   * @return const void* a pointer to the referenced data.
+   */
+  virtual const void* data() const PURE;
+
+  /**
+   * @return size_t the size of the referenced data.
+   */
+  virtual size_t size() const PURE;
+
+  /**
+   * Called once the data is no longer referenced by any buffer. This happens on the thread that
+   * drops the last reference, after which the data may be freed.
+   */
+  virtual void done() PURE;
+
+protected:
+  virtual ~BufferFragment() {}
+};
+
 /**
  * A basic buffer abstraction.
  */
@@ -31,6 +57,13 @@ public:
    */
   virtual void add(const void* data, uint64_t size) PURE;
 
+  /**
+   * Add externally owned data to the buffer without copying it. The data is also shared rather
+   * than copied when it is moved to another buffer or written out.
+   * @param fragment supplies the fragment, which must stay valid until its done() is called.
+   */
+  virtual void addBufferFragment(BufferFragment& fragment) PURE;
+
   /**
    * Copy a string into the buffer.
    * @param data supplies the string to copy.
@@ -63,14 +96,7 @@ public:
    * @param out_size supplies the size of out.
    * @return the actual number of slices needed, which may be greater than out_size. Passing
    *         nullptr for out and 0 for out_size will just return the size of the array needed
-   *         to capture all of the slice data.
-   * TODO(mattklein123): WARNING: The underlying implementation of this function currently uses
-   * libevent's evbuffer. It has the infuriating property where calling getRawSlices(nullptr, 0)
-   * will return the slices that include all of the buffer data, but not any empty slices at the
-   * end. However, calling getRawSlices(iovec, SOME_CONST), WILL return potentially empty slices
-   * beyond the end of the buffer. Code that is trying to avoid stack overflow by limiting the
-   * number of returned slices needs to deal with this. When we get rid of evbuffer we can rework
-   * all of this.
+   *         to capture all of the slice data. Empty slices are never returned.
    */
   virtual uint64_t getRawSlices(RawSlice* out, uint64_t out_size) const PURE;
 
@@ -123,6 +149,22 @@ public:
    */
   virtual ssize_t search(const void* data, uint64_t size, size_t start) const PURE;
 
+  /**
+   * Search for the first occurence of any of a set of bytes, e.g. "\r\n" to find the end of a line.
+   * @param chars supplies the bytes to search for.
+   * @param num_chars supplies the number of bytes in chars.
+   * @param start supplies the starting index to search from.
+   * @return the index of the first byte at or after start that matches any of chars or -1 if there
+   *         is no match.
+   */
+  virtual ssize_t findFirstOf(const void* chars, uint64_t num_chars, size_t start) const PURE;
+
+  /**
+   * Release the memory the buffer keeps around for data it does not hold, e.g. once the
+   * connection it belongs to has gone idle. The data in the buffer is kept.
+   */
+  virtual void shrink() PURE;
+
   /**
    * Write the buffer out to a file descriptor.
    * @param fd supplies the descriptor to write to.
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -35,6 +36,38 @@ public:
   virtual void onConfigUpdateFailed(const EnvoyException* e) PURE;
 };
 
+/**
+ * Callbacks of a subscription that are given only what changed between configuration updates.
+ */
+template <class ResourceType> class DeltaSubscriptionCallbacks {
+public:
+  typedef Protobuf::RepeatedPtrField<ResourceType> ResourceVector;
+
+  virtual ~DeltaSubscriptionCallbacks() {}
+
+  /**
+   * Called when a configuration update is received, even if no resource changed.
+   * @param added_or_changed vector of the resources that are new, or differ from their previous
+   *        version.
+   * @param hashes vector of the hashes of added_or_changed, in the same order, as given by
+   *        MessageUtil::hash(). Consumers that compare resources by hash can use them instead of
+   *        hashing the resources again.
+   * @param removed vector of the names of the resources that are no longer in the configuration.
+   * @throw EnvoyException with reason if the configuration is rejected. The changes of a rejected
+   *        update are delivered again with the next one, so applying them must be idempotent.
+   */
+  virtual void onConfigUpdate(const ResourceVector& added_or_changed,
+                              const std::vector<uint64_t>& hashes,
+                              const std::vector<std::string>& removed) PURE;
+
+  /**
+   * Called when either the Subscription is unable to fetch a config update or when onConfigUpdate
+   * invokes an exception.
+   * @param e supplies any exception data on why the fetch failed. May be nullptr.
+   */
+  virtual void onConfigUpdateFailed(const EnvoyException* e) PURE;
+};
+
 /**
  * Common abstraction for subscribing to versioned config updates. This may be implemented via bidi
  * gRPC streams, periodic/long polling REST or inotify filesystem updates. ResourceType is expected
@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/event/file_event.h"
 #include "envoy/event/signal.h"
 #include "envoy/event/timer.h"
@@ -122,6 +123,14 @@ public:
    */
   virtual TimerPtr createTimer(TimerCb cb) PURE;
 
+  /**
+   * Allocate a timer for timeouts that do not need to fire precisely, such as request and idle
+   * timeouts. Coarse timers are cheaper to enable and disable than timers from createTimer() but
+   * may fire a few milliseconds late. @see Event::Timer for docs on how to use the timer.
+   * @param cb supplies the callback to invoke when the timer fires.
+   */
+  virtual TimerPtr createCoarseTimer(TimerCb cb) PURE;
+
   /**
    * Submit an item for deferred delete. @see DeferredDeletable.
    */
@@ -132,6 +141,32 @@ public:
    */
   virtual void exit() PURE;
 
+  /**
+   * Start recording event loop stats: the delay of the loop, the size and wait time of post()
+   * batches, and callbacks that block the loop for long. This must be called before the dispatcher
+   * is shared with other threads.
+   * @param scope supplies the scope to record the stats in.
+   * @param prefix supplies the prefix of the stat names, which also names the dispatcher in the
+   *        slow callback log.
+   */
+  virtual void initializeStats(Stats::Scope& scope, const std::string& prefix) PURE;
+
+  /**
+   * Find a gauge among the stats of the dispatcher, for state that other components running on the
+   * dispatcher report per worker.
+   * @param name supplies the name of the gauge, which is prefixed with the dispatcher's prefix.
+   * @return Stats::Gauge* the gauge, or nullptr if initializeStats() has not been called.
+   */
+  virtual Stats::Gauge* gauge(const std::string& name) PURE;
+
+  /**
+   * @return std::chrono::milliseconds how far the event loop has fallen behind: the largest delay
+   *         of a timer that is due every 100ms over about the last second, or how long the timer
+   *         is overdue if that is longer, so that a stuck loop shows as well. It is 0 if
+   *         initializeStats() has not been called. It is safe to call from any thread.
+   */
+  virtual std::chrono::milliseconds loopDelay() PURE;
+
   /**
    * Listen for a signal event. Only a single dispatcher in the process can listen for signals.
    * If more than one dispatcher calls this routine in the process the behavior is undefined.
@@ -163,6 +198,22 @@ public:
    * @return the buffer factory for this dispatcher.
    */
   virtual Buffer::Factory& getBufferFactory() PURE;
+
+  /**
+   * @return SystemTimeSource& a system time source that only reads the clock once per event loop
+   *         iteration, before the events of the iteration run. It is behind the precise time by
+   *         how long the iteration has run so far, which is fine for timing requests, and saves
+   *         reading the clock several times per request. It must only be used from the thread that
+   *         runs this dispatcher. ProdSystemTimeSource supplies the precise time.
+   */
+  virtual SystemTimeSource& approximateSystemTime() PURE;
+
+  /**
+   * @return MonotonicTimeSource& a monotonic time source that only reads the clock once per event
+   *         loop iteration. @see approximateSystemTime(). ProdMonotonicTimeSource supplies the
+   *         precise time.
+   */
+  virtual MonotonicTimeSource& approximateMonotonicTime() PURE;
 };
 
 typedef std::unique_ptr<Dispatcher> DispatcherPtr;
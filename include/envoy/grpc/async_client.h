@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <memory>
 
 #include "envoy/common/optional.h"
 #include "envoy/common/pure.h"
@@ -12,6 +13,32 @@
 namespace Envoy {
 namespace Grpc {
 
+/**
+ * Deleter for gRPC response messages. The async client allocates each response on an arena owned
+ * by the deleter, so a message with a deep tree of sub-messages, such as a large xDS response, is
+ * freed in one shot when it is destroyed. Heap allocated messages convert implicitly from
+ * std::unique_ptr and are deleted as usual.
+ */
+template <class MessageType> class ResponseDeleter {
+public:
+  ResponseDeleter() {}
+  ResponseDeleter(std::default_delete<MessageType>) {}
+  ResponseDeleter(std::unique_ptr<Protobuf::Arena>&& arena) : arena_(std::move(arena)) {}
+
+  void operator()(MessageType* message) const {
+    // An arena allocated message goes away along with its arena.
+    if (!arena_) {
+      delete message;
+    }
+  }
+
+private:
+  std::unique_ptr<Protobuf::Arena> arena_;
+};
+
+template <class MessageType>
+using ResponsePtr = std::unique_ptr<MessageType, ResponseDeleter<MessageType>>;
+
 /**
  * An in-flight gRPC unary RPC.
  */
@@ -69,7 +96,7 @@ public:
    * Called when the async gRPC request succeeds. No further callbacks will be invoked.
    * @param response the gRPC response.
    */
-  virtual void onSuccess(std::unique_ptr<ResponseType>&& response) PURE;
+  virtual void onSuccess(ResponsePtr<ResponseType>&& response) PURE;
 
   /**
    * Called when the async gRPC request fails. No further callbacks will be invoked.
@@ -106,7 +133,7 @@ public:
    * Called when an async gRPC message is received.
    * @param response the gRPC message.
    */
-  virtual void onReceiveMessage(std::unique_ptr<ResponseType>&& message) PURE;
+  virtual void onReceiveMessage(ResponsePtr<ResponseType>&& message) PURE;
 
   /**
    * Called when trailing metadata is recevied.
@@ -43,6 +43,31 @@ enum ResponseFlag {
   RateLimited = 0x800
 };
 
+/**
+ * Points in the life of a request that the request info records the time of, so that the time of
+ * a slow request can be broken down by phase. The upstream points are those of the last upstream
+ * attempt, and the connection points are only recorded when the request waited for a new
+ * connection.
+ */
+enum class RequestTiming {
+  // The router asked the connection pool for an upstream stream.
+  UpstreamRequestStart,
+  // The connection pool started connecting a new connection for the request.
+  UpstreamConnectStart,
+  // The transport of the new connection connected.
+  UpstreamConnectEnd,
+  // The TLS handshake of the new connection completed.
+  UpstreamHandshakeEnd,
+  // The connection pool handed the request an upstream stream, ending the time in the pool queue.
+  UpstreamPoolReady,
+  // The response headers started arriving from upstream.
+  UpstreamFirstByte,
+  // The end of the response was written to the downstream connection.
+  DownstreamLastByte,
+  // Not a point. The number of points.
+  Count
+};
+
 /**
  * Additional information about a completed request for logging.
  */
@@ -91,6 +116,21 @@ public:
    */
   virtual void responseReceivedDuration(MonotonicTime time) PURE;
 
+  /**
+   * Record the time that the request reached a timing point. Points that are reached again, e.g.
+   * by a retry, keep the latest time.
+   * @param point supplies the timing point.
+   * @param time supplies the monotonic clock time when the point was reached.
+   */
+  virtual void timing(RequestTiming point, MonotonicTime time) PURE;
+
+  /**
+   * @param point supplies the timing point.
+   * @return Optional<std::chrono::microseconds> the duration from request start to when the
+   *         request reached point, if it did.
+   */
+  virtual Optional<std::chrono::microseconds> timing(RequestTiming point) const PURE;
+
   /**
    * @return the # of body bytes received in the request.
    */
@@ -185,9 +225,28 @@ class Formatter {
 public:
   virtual ~Formatter() {}
 
-  virtual std::string format(const Http::HeaderMap& request_headers,
-                             const Http::HeaderMap& response_headers,
-                             const RequestInfo& request_info) const PURE;
+  /**
+   * Append the formatted output to a string, so that the parts of a log line are written into
+   * one string without intermediate copies.
+   * @param request_headers supplies the request headers.
+   * @param response_headers supplies the response headers.
+   * @param request_info supplies the request info.
+   * @param output supplies the string to append to.
+   */
+  virtual void formatTo(const Http::HeaderMap& request_headers,
+                        const Http::HeaderMap& response_headers, const RequestInfo& request_info,
+                        std::string& output) const PURE;
+
+  /**
+   * @return std::string the formatted output. @see formatTo().
+   */
+  std::string format(const Http::HeaderMap& request_headers,
+                     const Http::HeaderMap& response_headers,
+                     const RequestInfo& request_info) const {
+    std::string output;
+    formatTo(request_headers, response_headers, request_info, output);
+    return output;
+  }
 };
 
 typedef std::unique_ptr<Formatter> FormatterPtr;
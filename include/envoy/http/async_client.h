@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <memory>
+#include <string>
 
 #include "envoy/common/optional.h"
 #include "envoy/event/dispatcher.h"
@@ -142,6 +143,24 @@ public:
   virtual Request* send(MessagePtr&& request, Callbacks& callbacks,
                         const Optional<std::chrono::milliseconds>& timeout) PURE;
 
+  /**
+   * Send an HTTP request asynchronously straight to a connection pool of the cluster, without the
+   * router: there are no retries, shadowing, tracing or per-route stats. This is meant for
+   * frequent internal calls like control plane fetches. The request shares the connection pools
+   * of routed requests, and a timeout or a failure before the response starts is reported with a
+   * local reply like the router sends.
+   * @param request the request to send.
+   * @param callbacks the callbacks to be notified of request status.
+   * @param timeout supplies the request timeout
+   * @param caller supplies the name of the caller, under which the request is counted in the
+   *        cluster.<name>.async_client.<caller>. stats.
+   * @return a request handle or nullptr if the request already completed inline. The client
+   *         owns the request and the handle should just be used to cancel.
+   */
+  virtual Request* sendDirect(MessagePtr&& request, Callbacks& callbacks,
+                              const Optional<std::chrono::milliseconds>& timeout,
+                              const std::string& caller) PURE;
+
   /**
    * Start an HTTP stream asynchronously.
    * @param callbacks the callbacks to be notified of stream status.
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "envoy/buffer/buffer.h"
 #include "envoy/common/pure.h"
@@ -173,6 +175,13 @@ struct Http1Settings {
   // Enable codec to parse absolute uris. This enables forward/explicit proxy support for non TLS
   // traffic
   bool allow_absolute_url_{false};
+  // Parse request heads that arrive in one piece with a vectorized parser, only running the start
+  // line and the headers that affect framing through http_parser.
+  bool fast_head_parser_{false};
+  // Hold back chunked body data of less than this many bytes until the end of the event loop
+  // iteration, so that small consecutive writes of a stream go out as one chunk in one write.
+  // Data is written as soon as this many bytes are held back. 0 disables coalescing.
+  uint32_t chunk_coalesce_bytes_{0};
 };
 
 /**
@@ -180,10 +189,35 @@ struct Http1Settings {
  */
 struct Http2Settings {
   // TODO(jwfang): support other HTTP/2 settings
+  // The size of the dynamic table advertised to the peer's HPACK encoder.
   uint32_t hpack_table_size_{DEFAULT_HPACK_TABLE_SIZE};
+  // The maximum size of the dynamic table used by our own HPACK encoder. The peer can lower this
+  // further through its SETTINGS_HEADER_TABLE_SIZE.
+  uint32_t hpack_encoder_table_size_{DEFAULT_HPACK_TABLE_SIZE};
+  // Lower case names of the headers that are encoded as never indexed literals. These are headers
+  // with values that are unlikely to repeat (request and trace IDs, ...), which would otherwise
+  // evict entries that compress the rest of the headers from the dynamic table.
+  std::vector<std::string> never_index_headers_;
   uint32_t max_concurrent_streams_{DEFAULT_MAX_CONCURRENT_STREAMS};
   uint32_t initial_stream_window_size_{DEFAULT_INITIAL_STREAM_WINDOW_SIZE};
   uint32_t initial_connection_window_size_{DEFAULT_INITIAL_CONNECTION_WINDOW_SIZE};
+  // Grow the receive windows beyond their initial sizes, up to the maxima below, from an estimate
+  // of the bandwidth-delay product of the connection that is measured with PINGs. Windows shrink
+  // back towards their initial sizes when streams stop reading.
+  bool window_auto_tuning_{false};
+  uint32_t max_stream_window_size_{MAX_INITIAL_STREAM_WINDOW_SIZE};
+  uint32_t max_connection_window_size_{MAX_INITIAL_CONNECTION_WINDOW_SIZE};
+  // The number of connections that an upstream connection pool spreads its streams over. A new
+  // connection is opened whenever all existing ones have active streams, until there are this many.
+  uint32_t max_connections_per_pool_{1};
+  // The most DATA bytes a stream sends in one frame. After each frame the streams with data queued
+  // take turns in the order and with the weights of the priorities signalled by the peer, so a
+  // small quantum keeps a large body from holding up the other streams. 0 sends frames of the
+  // largest size the peer allows.
+  uint32_t stream_write_quantum_{0};
+  // Send the frames of encoded streams once per event loop iteration instead of once per encode
+  // call, so that the streams encoded in the same iteration are scheduled against each other.
+  bool coalesce_frame_writes_{false};
 
   // disable HPACK compression
   static const uint32_t MIN_HPACK_TABLE_SIZE = 0;
@@ -318,6 +352,12 @@ public:
    * @return StreamEncoder& supplies the encoder to write the request into.
    */
   virtual StreamEncoder& newStream(StreamDecoder& response_decoder) PURE;
+
+  /**
+   * @return uint32_t the maximum number of streams that the peer allows to be active at the same
+   *         time on the connection.
+   */
+  virtual uint32_t maxConcurrentStreams() PURE;
 };
 
 typedef std::unique_ptr<ClientConnection> ClientConnectionPtr;
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <memory>
+#include <string>
+
+#include "envoy/common/pure.h"
+
 namespace Envoy {
 namespace Http {
 
@@ -72,5 +77,35 @@ enum class Code {
   // clang-format on
 };
 
+/**
+ * Pre-resolved response code stats for a fixed stats scope and prefix. Charging a response via
+ * this interface avoids building and looking up dynamic stat names for every response.
+ * Implementations must be safe to use concurrently from all threads.
+ */
+class CodeStats {
+public:
+  virtual ~CodeStats() {}
+
+  /**
+   * Charge a response code to both the aggregate (*xx) and code specific counters, as well as the
+   * canary and internal/external variants.
+   * @param code supplies the response code.
+   * @param canary supplies whether the response came from a canary upstream.
+   * @param internal_request supplies whether the request was an internal request.
+   */
+  virtual void chargeResponseStat(Code code, bool canary, bool internal_request) PURE;
+
+  /**
+   * Charge a response code to the per zone counters.
+   * @param from_zone supplies the zone of the local host.
+   * @param to_zone supplies the zone of the upstream host.
+   * @param code supplies the response code.
+   */
+  virtual void chargeZoneResponseStat(const std::string& from_zone, const std::string& to_zone,
+                                      Code code) PURE;
+};
+
+typedef std::unique_ptr<CodeStats> CodeStatsPtr;
+
 } // namespace Http
 } // namespace Envoy
@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "envoy/common/pure.h"
+#include "envoy/common/time.h"
 #include "envoy/event/deferred_deletable.h"
 #include "envoy/http/codec.h"
 #include "envoy/upstream/upstream.h"
@@ -35,6 +36,18 @@ enum class PoolFailureReason {
   ConnectionFailure
 };
 
+/**
+ * The approximate monotonic times at which a new connection went through the phases of connecting.
+ */
+struct ConnectionTiming {
+  // The connection started connecting.
+  MonotonicTime connect_start_;
+  // The transport connected.
+  MonotonicTime connect_end_;
+  // The TLS handshake completed. Default constructed if the connection does not use TLS.
+  MonotonicTime handshake_end_;
+};
+
 /**
  * Pool callbacks invoked in the context of a newStream() call, either synchronously or
  * asynchronously.
@@ -60,6 +73,14 @@ public:
    */
   virtual void onPoolReady(Http::StreamEncoder& encoder,
                            Upstream::HostDescriptionConstSharedPtr host) PURE;
+
+  /**
+   * Called right before onPoolReady() if the request waited for a new connection to connect.
+   * Pools that hand out streams before their connection is established (e.g., HTTP/2) do not
+   * call this.
+   * @param timing supplies when the new connection went through the phases of connecting.
+   */
+  virtual void onPoolConnectionTiming(const ConnectionTiming& timing) PURE;
 };
 
 /**
@@ -95,6 +116,13 @@ public:
    *                      should be done by resetting the stream.
    */
   virtual Cancellable* newStream(Http::StreamDecoder& response_decoder, Callbacks& callbacks) PURE;
+
+  /**
+   * Open connections ahead of the requests that will use them, so that those requests do not wait
+   * for connection establishment. How many connections are kept open depends on the warm
+   * connection and prefetch settings of the cluster. Nothing is opened while the pool is draining.
+   */
+  virtual void prefetchConnections() PURE;
 };
 
 typedef std::unique_ptr<Instance> InstancePtr;
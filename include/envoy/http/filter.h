@@ -376,6 +376,14 @@ class StreamFilter : public StreamDecoderFilter, public StreamEncoderFilter {};
 
 typedef std::shared_ptr<StreamFilter> StreamFilterSharedPtr;
 
+/**
+ * The number of filters in a filter chain, by direction. A dual filter counts in both directions.
+ */
+struct FilterChainSize {
+  uint32_t decoder_filters_;
+  uint32_t encoder_filters_;
+};
+
 /**
  * These callbacks are provided by the connection manager to the factory so that the factory can
  * build the filter chain in an application specific way.
@@ -425,6 +433,13 @@ public:
    *                  FilterChainFactoryCallbacks.
    */
   virtual void createFilterChain(FilterChainFactoryCallbacks& callbacks) PURE;
+
+  /**
+   * @return FilterChainSize the number of filters that createFilterChain() is expected to add. The
+   *         connection manager sets aside room for that many filters when a stream is created.
+   *         This is only a hint: a chain that turns out longer or shorter works all the same.
+   */
+  virtual FilterChainSize filterChainSize() PURE;
 };
 
 } // namespace Http
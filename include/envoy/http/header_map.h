@@ -4,11 +4,14 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <list>
 #include <memory>
 #include <string>
 
 #include "envoy/common/pure.h"
 
+#include "common/common/string_view.h"
+
 namespace Envoy {
 namespace Http {
 
@@ -102,6 +105,11 @@ public:
    */
   bool find(const char* str) const { return strstr(c_str(), str); }
 
+  /**
+   * @return a view of the string, valid until the string is next modified.
+   */
+  StringView getStringView() const { return StringView(c_str(), string_length_); }
+
   /**
    * Set the value of the string by copying data into it. This overwrites any existing string.
    */
@@ -216,11 +224,13 @@ private:
   HEADER_FUNC(EnvoyInternalRequest)                                                                \
   HEADER_FUNC(EnvoyMaxRetries)                                                                     \
   HEADER_FUNC(EnvoyOriginalPath)                                                                   \
+  HEADER_FUNC(EnvoyRetryBufferLimitBytes)                                                          \
   HEADER_FUNC(EnvoyRetryOn)                                                                        \
   HEADER_FUNC(EnvoyRetryGrpcOn)                                                                    \
   HEADER_FUNC(EnvoyUpstreamAltStatName)                                                            \
   HEADER_FUNC(EnvoyUpstreamCanary)                                                                 \
   HEADER_FUNC(EnvoyUpstreamHealthCheckedCluster)                                                   \
+  HEADER_FUNC(EnvoyUpstreamRequestHedgeDelayMs)                                                    \
   HEADER_FUNC(EnvoyUpstreamRequestPerTryTimeoutMs)                                                 \
   HEADER_FUNC(EnvoyUpstreamRequestTimeoutAltResponse)                                              \
   HEADER_FUNC(EnvoyUpstreamRequestTimeoutMs)                                                       \
@@ -368,6 +378,13 @@ public:
    */
   virtual void remove(const LowerCaseString& key) PURE;
 
+  /**
+   * Remove all instances of each of a list of headers. This takes a single pass over the map,
+   * rather than the pass per key that calling remove() for each key takes.
+   * @param keys supplies the header keys to remove.
+   */
+  virtual void removeKeys(const std::list<LowerCaseString>& keys) PURE;
+
   /**
    * @return the number of headers in the map.
    */
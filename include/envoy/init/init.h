@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <string>
 
 #include "envoy/common/pure.h"
 
@@ -20,6 +21,11 @@ public:
    *        initialization.
    */
   virtual void initialize(std::function<void()> callback) PURE;
+
+  /**
+   * @return std::string the name of the target, used to report how long it took to initialize.
+   */
+  virtual std::string name() const PURE;
 };
 
 /**
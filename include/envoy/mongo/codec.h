@@ -141,10 +141,34 @@ public:
   virtual void numberReturned(int32_t number_returned) PURE;
   virtual const std::list<Bson::DocumentSharedPtr>& documents() const PURE;
   virtual std::list<Bson::DocumentSharedPtr>& documents() PURE;
+
+  /**
+   * @return uint32_t the number of documents, without decoding them.
+   */
+  virtual uint32_t numberOfDocuments() const PURE;
+
+  /**
+   * @return uint64_t the total encoded size of the documents, without decoding them.
+   */
+  virtual uint64_t documentsByteSize() const PURE;
 };
 
 typedef std::unique_ptr<ReplyMessage> ReplyMessagePtr;
 
+/**
+ * The standard header that starts every message.
+ */
+struct MessageHeader {
+  // The size of the header on the wire.
+  static const uint32_t SIZE = 16;
+
+  // The length of the whole message, including the header.
+  int32_t message_length_;
+  int32_t request_id_;
+  int32_t response_to_;
+  int32_t op_code_;
+};
+
 /**
  * General callbacks for dispatching decoded mongo messages to a sink.
  */
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+
+#include "envoy/buffer/buffer.h"
+#include "envoy/mongo/codec.h"
+
+namespace Envoy {
+namespace Mongo {
+namespace ConnPool {
+
+/**
+ * A handle to an outbound request.
+ */
+class PoolRequest {
+public:
+  virtual ~PoolRequest() {}
+
+  /**
+   * Cancel the request. No further request callbacks will be called.
+   */
+  virtual void cancel() PURE;
+};
+
+/**
+ * Outbound request callbacks.
+ */
+class PoolCallbacks {
+public:
+  virtual ~PoolCallbacks() {}
+
+  /**
+   * Called when the reply to a request is received.
+   * @param header supplies the header of the reply. Its response_to_ is the request ID the
+   *        request was made with.
+   * @param body supplies the rest of the reply, which the callee may drain.
+   */
+  virtual void onReply(const MessageHeader& header, Buffer::Instance& body) PURE;
+
+  /**
+   * Called when the upstream connection fails before the reply is received.
+   */
+  virtual void onFailure() PURE;
+};
+
+/**
+ * A pool of upstream connections shared by many downstream connections. Messages are forwarded
+ * as they are, except for their request ID, which is rewritten so that it is unique on the
+ * upstream connection.
+ */
+class Instance {
+public:
+  virtual ~Instance() {}
+
+  /**
+   * Send a message that gets a reply, such as OP_QUERY or OP_GET_MORE.
+   * @param header supplies the header of the message.
+   * @param body supplies the rest of the message, which is drained.
+   * @param callbacks supplies the callbacks for the reply.
+   * @return PoolRequest* a handle to the request, or nullptr if there is no upstream host.
+   */
+  virtual PoolRequest* makeRequest(const MessageHeader& header, Buffer::Instance& body,
+                                   PoolCallbacks& callbacks) PURE;
+
+  /**
+   * Send a message that gets no reply, such as OP_INSERT or OP_KILL_CURSORS.
+   * @param header supplies the header of the message.
+   * @param body supplies the rest of the message, which is drained.
+   * @return bool false if there is no upstream host.
+   */
+  virtual bool send(const MessageHeader& header, Buffer::Instance& body) PURE;
+};
+
+typedef std::shared_ptr<Instance> InstanceSharedPtr;
+
+} // namespace ConnPool
+} // namespace Mongo
+} // namespace Envoy
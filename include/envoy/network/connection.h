@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -10,6 +11,7 @@
 #include "envoy/network/address.h"
 #include "envoy/network/filter.h"
 #include "envoy/ssl/connection.h"
+#include "envoy/stats/stats.h"
 
 namespace Envoy {
 namespace Event {
@@ -86,6 +88,12 @@ public:
    */
   virtual void addConnectionCallbacks(ConnectionCallbacks& cb) PURE;
 
+  /**
+   * Unregister callbacks registered with addConnectionCallbacks(). Must not be called while the
+   * connection raises an event.
+   */
+  virtual void removeConnectionCallbacks(ConnectionCallbacks& cb) PURE;
+
   /**
    * Close the connection.
    */
@@ -184,6 +192,18 @@ public:
    */
   virtual uint32_t bufferLimit() const PURE;
 
+  /**
+   * Bound the bytes that a single read or write event moves, so that a bulk transfer yields the
+   * event loop to the other connections of the dispatcher instead of reading or writing until the
+   * socket blocks. A read or write that uses up the budget continues from a new event, which runs
+   * after the events of other connections that are already ready.
+   * @param bytes supplies the budget of each read and each write event. 0 is unlimited.
+   * @param read_exhausted supplies the counter of read events that used up the budget.
+   * @param write_exhausted supplies the counter of write events that used up the budget.
+   */
+  virtual void setEventByteBudget(uint32_t bytes, Stats::Counter& read_exhausted,
+                                  Stats::Counter& write_exhausted) PURE;
+
   /**
    * @return boolean telling if the connection's local address is an original destination address,
    * rather than the listener's address.
@@ -194,6 +214,31 @@ public:
    * @return boolean telling if the connection is currently above the high watermark.
    */
   virtual bool aboveHighWatermark() const PURE;
+
+  /**
+   * @return uint64_t the number of bytes currently held in the connection's read and write
+   *         buffers.
+   */
+  virtual uint64_t bufferedBytes() const PURE;
+
+  /**
+   * Forward all data read from now on straight from this connection's socket to the socket of
+   * another connection with splice(), without copying it through user space. The data bypasses
+   * the read buffer and read filters of this connection and the write buffer of the peer, so
+   * splicing is only possible between plaintext connections where the caller is the only read
+   * filter of this connection and the peer has no write filters. Data already written to the peer
+   * is sent first. Byte statistics are still accounted on both connections. Splicing stops when
+   * either connection closes.
+   * @param peer supplies the connected connection to forward to.
+   * @return bool whether splicing started. If not, data keeps flowing through the read filters.
+   */
+  virtual bool spliceTo(Connection& peer) PURE;
+
+  /**
+   * Release the memory the read and write buffers keep around for data they do not hold, e.g.
+   * after the connection has been idle for a while. @see Buffer::Instance::shrink().
+   */
+  virtual void shrinkBuffers() PURE;
 };
 
 typedef std::unique_ptr<Connection> ConnectionPtr;
@@ -208,6 +253,29 @@ public:
    * registered via setConnectionEventCb().
    */
   virtual void connect() PURE;
+
+  /**
+   * Send the first data written to the connection with the SYN using TCP Fast Open. connect()
+   * then completes right away, so a failure to connect surfaces as a remote close once data has
+   * been written. Must be called before connect(). Does nothing if the platform does not support
+   * TCP Fast Open.
+   * @param syn_data_accepted supplies the counter that is incremented if the remote host accepts
+   *        the data sent with the SYN. This is known once the first data has been read.
+   */
+  virtual void enableTcpFastOpen(Stats::Counter& syn_data_accepted) PURE;
+
+  /**
+   * Race a connect to a fallback address against the connect to the remote address, as in
+   * RFC 8305 (happy eyeballs). The fallback connect starts once delay has passed without the
+   * connect to the remote address completing, or right away if that connect fails. The first
+   * connect to succeed is used and the other one is closed, remoteAddress() then returns the
+   * address connected to. The connection only fails if both connects do. Must be called before
+   * connect(). The connection must not be bound to a source address.
+   * @param fallback_address supplies the address to fall back to, usually of the other IP family.
+   * @param delay supplies how long the connect to the remote address runs alone.
+   */
+  virtual void enableHappyEyeballs(Address::InstanceConstSharedPtr fallback_address,
+                                   std::chrono::milliseconds delay) PURE;
 };
 
 typedef std::unique_ptr<ClientConnection> ClientConnectionPtr;
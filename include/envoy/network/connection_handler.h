@@ -12,6 +12,20 @@
 namespace Envoy {
 namespace Network {
 
+/**
+ * Actions a connection handler takes to reduce the memory held by its connections' buffers, or the
+ * load on its event loop.
+ */
+struct OverloadActions {
+  // Stop accepting new connections on all listeners.
+  bool stop_accepting_{};
+  // Percentage of each listener's per connection buffer limit to apply to its connections. 100
+  // applies the configured limits.
+  uint32_t buffer_limit_percent_{100};
+  // Close the connections with the most buffered data until at least this many bytes are freed.
+  uint64_t shed_bytes_{};
+};
+
 /**
  * Abstract connection handler.
  */
@@ -75,6 +89,13 @@ public:
    * Stop all listeners. This will not close any connections and is used for draining.
    */
   virtual void stopListeners() PURE;
+
+  /**
+   * Apply overload actions. Accepting and buffer limits stay as set until the next call,
+   * while shedding happens once per call.
+   * @param actions supplies the actions to take.
+   */
+  virtual void applyOverloadActions(const OverloadActions& actions) PURE;
 };
 
 typedef std::unique_ptr<ConnectionHandler> ConnectionHandlerPtr;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -10,6 +11,27 @@
 namespace Envoy {
 namespace Network {
 
+/**
+ * Limits the rate at which listeners accept connections. A limiter may be shared by the listeners
+ * of all workers, so it must be thread safe.
+ */
+class AcceptLimiter {
+public:
+  virtual ~AcceptLimiter() {}
+
+  /**
+   * Take the permission to accept a connection.
+   * @return bool true if a connection may be accepted now.
+   */
+  virtual bool tryAccept() PURE;
+
+  /**
+   * @return std::chrono::milliseconds how long a listener waits before it accepts again once
+   *         tryAccept() returned false. Connections wait in the listen backlog in the meantime.
+   */
+  virtual std::chrono::milliseconds retryInterval() const PURE;
+};
+
 /**
  * Listener configurations options.
  */
@@ -25,6 +47,20 @@ struct ListenerOptions {
   bool use_original_dst_;
   // Soft limit on size of the listener's new connection read and write buffers.
   uint32_t per_connection_buffer_limit_bytes_;
+  // How far above the average worker, in percent, a worker's number of connections must be before
+  // newly accepted connections are handed to the least loaded worker. 0 disables balancing.
+  uint32_t connection_balance_threshold_;
+  // Whether the listen socket has TCP Fast Open enabled, in which case the listener counts the
+  // accepted connections whose SYN carried data.
+  bool tcp_fast_open_;
+  // The bytes that a single read or write event of an accepted connection may move before the
+  // connection yields to other connections. 0 is unlimited.
+  uint32_t per_event_byte_budget_;
+  // The most connections accepted each time the listen socket becomes readable, before the events
+  // of other connections are serviced. 0 is unlimited.
+  uint32_t max_accepts_per_wakeup_;
+  // Limits the rate of accepted connections if set. It outlives the listener.
+  AcceptLimiter* accept_limiter_;
 
   /**
    * Factory for ListenerOptions with bind_to_port_ set.
@@ -34,7 +70,12 @@ struct ListenerOptions {
     return {.bind_to_port_ = true,
             .use_proxy_proto_ = false,
             .use_original_dst_ = false,
-            .per_connection_buffer_limit_bytes_ = 0};
+            .per_connection_buffer_limit_bytes_ = 0,
+            .connection_balance_threshold_ = 0,
+            .tcp_fast_open_ = false,
+            .per_event_byte_budget_ = 0,
+            .max_accepts_per_wakeup_ = 0,
+            .accept_limiter_ = nullptr};
   }
 };
 
@@ -45,6 +86,20 @@ class ListenerCallbacks {
 public:
   virtual ~ListenerCallbacks() {}
 
+  /**
+   * Called when a socket is accepted, before a connection is created for it. The callee may take
+   * over the socket, for example to have the connection created by a listener on another thread.
+   * @param fd supplies the accepted socket.
+   * @param remote_address supplies the remote address of the socket.
+   * @param local_address supplies the local address of the socket.
+   * @param using_original_dst supplies whether the local address is the original destination.
+   * @return bool true if the callee took over the socket, in which case no connection is created
+   *         for it by the listener.
+   */
+  virtual bool onAccept(int fd, Address::InstanceConstSharedPtr remote_address,
+                        Address::InstanceConstSharedPtr local_address,
+                        bool using_original_dst) PURE;
+
   /**
    * Called when a new connection is accepted.
    * @param new_connection supplies the new connection that is moved into the callee.
@@ -58,6 +113,29 @@ public:
 class Listener {
 public:
   virtual ~Listener() {}
+
+  /**
+   * Temporarily stop accepting new connections. Connections that are pending on the socket stay
+   * in the kernel backlog until the listener is enabled again.
+   */
+  virtual void disable() PURE;
+
+  /**
+   * Resume accepting new connections after disable().
+   */
+  virtual void enable() PURE;
+
+  /**
+   * Create a connection for a socket that was accepted elsewhere, for example by the listener for
+   * the same address on another worker. Must be called on the listener's dispatcher thread.
+   * @param fd supplies the socket, which the listener takes ownership of.
+   * @param remote_address supplies the remote address of the socket.
+   * @param local_address supplies the local address of the socket.
+   * @param using_original_dst supplies whether the local address is the original destination.
+   */
+  virtual void newConnection(int fd, Address::InstanceConstSharedPtr remote_address,
+                             Address::InstanceConstSharedPtr local_address,
+                             bool using_original_dst) PURE;
 };
 
 typedef std::unique_ptr<Listener> ListenerPtr;
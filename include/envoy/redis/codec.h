@@ -47,6 +47,14 @@ public:
   RespType type() const { return type_; }
   void type(RespType type);
 
+  /**
+   * The bytes a top level value was decoded from, if the decoder kept them. An encoder writes
+   * them out as they are instead of encoding the value again, so they must be cleared with
+   * raw(nullptr) before the value is changed. Changing the type with type() clears them.
+   */
+  const Buffer::Instance* raw() const { return raw_.get(); }
+  void raw(Buffer::InstancePtr&& raw) { raw_ = std::move(raw); }
+
 private:
   union {
     std::vector<RespValue> array_;
@@ -57,6 +65,7 @@ private:
   void cleanup();
 
   RespType type_;
+  Buffer::InstancePtr raw_;
 };
 
 typedef std::unique_ptr<RespValue> RespValuePtr;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -84,6 +85,19 @@ public:
    *         all operations use the same timeout.
    */
   virtual std::chrono::milliseconds opTimeout() const PURE;
+
+  /**
+   * @return uint32_t the number of requests after which the writes batched for an upstream
+   *         connection are flushed, or 0 for no limit.
+   */
+  virtual uint32_t maxBatchRequests() const PURE;
+
+  /**
+   * @return uint32_t the number of bytes after which the writes batched for an upstream connection
+   *         are flushed, or 0 for no limit. If both this and maxBatchRequests() are 0, requests are
+   *         not batched and each one is written on its own.
+   */
+  virtual uint32_t maxBatchBytes() const PURE;
 };
 
 /**
@@ -122,6 +136,27 @@ public:
    */
   virtual PoolRequest* makeRequest(const std::string& hash_key, const RespValue& request,
                                    PoolCallbacks& callbacks) PURE;
+
+  /**
+   * Makes a redis request that only reads, and which the pool may send to a replica instead of
+   * the master for the key. The parameters and return value are as for makeRequest().
+   */
+  virtual PoolRequest* makeReadRequest(const std::string& hash_key, const RespValue& request,
+                                       PoolCallbacks& callbacks) PURE;
+
+  /**
+   * @return bool true if the upstream is a Redis Cluster, and requests are routed by the hash slot
+   *         of their key. A multi-key command may then only be sent for keys in the same slot.
+   */
+  virtual bool clusterMode() const PURE;
+
+  /**
+   * @param hash_key supplies the key to use for consistent hashing.
+   * @return Upstream::HostConstSharedPtr the host a request with the key would be sent to, or
+   *         nullptr if there is none or it isn't known before the request is made. Requests for
+   *         keys on the same host may then be merged into one multi-key request.
+   */
+  virtual Upstream::HostConstSharedPtr hostForKey(const std::string& hash_key) PURE;
 };
 
 typedef std::unique_ptr<Instance> InstancePtr;
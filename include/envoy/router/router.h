@@ -11,6 +11,7 @@
 #include "envoy/common/optional.h"
 #include "envoy/http/codec.h"
 #include "envoy/http/header_map.h"
+#include "envoy/upstream/load_balancer_type.h"
 #include "envoy/upstream/resource_manager.h"
 
 namespace Envoy {
@@ -181,6 +182,13 @@ public:
    */
   virtual const std::string& clusterName() const PURE;
 
+  /**
+   * @return const Optional<uint32_t>& the id of clusterName() interned with
+   *         Upstream::ClusterManager::clusterId() when the route was loaded, if the cluster name is
+   *         known ahead of the request.
+   */
+  virtual const Optional<uint32_t>& clusterId() const PURE;
+
   /**
    * Do potentially destructive header transforms on request headers prior to forwarding. For
    * example URL prefix rewriting, adding headers, etc. This should only be called ONCE
@@ -249,6 +257,12 @@ public:
    */
   virtual const std::multimap<std::string, std::string>& opaqueConfig() const PURE;
 
+  /**
+   * @return const Upstream::MetadataMatchCriteria* the metadata that the upstream host of the
+   *         route must have, or nullptr if the route has no requirements.
+   */
+  virtual const Upstream::MetadataMatchCriteria* metadataMatchCriteria() const PURE;
+
   /**
    * @return bool true if the virtual host rate limits should be included.
    */
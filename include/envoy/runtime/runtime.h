@@ -30,6 +30,31 @@ public:
 
 typedef std::unique_ptr<RandomGenerator> RandomGeneratorPtr;
 
+/**
+ * A runtime key that has been resolved once to an index, so that snapshots can find its value
+ * without hashing the name on every lookup. Keys are obtained from Runtime::KeyRegistry, which
+ * gives every key of the same name the same index for the life of the process.
+ */
+class Key {
+public:
+  Key() : index_(UINT32_MAX) {}
+  Key(const std::string& name, uint32_t index) : name_(name), index_(index) {}
+
+  /**
+   * @return const std::string& the name of the key.
+   */
+  const std::string& name() const { return name_; }
+
+  /**
+   * @return uint32_t the index of the key, or UINT32_MAX if it was not registered.
+   */
+  uint32_t index() const { return index_; }
+
+private:
+  std::string name_;
+  uint32_t index_;
+};
+
 /**
  * A snapshot of runtime data.
  */
@@ -96,6 +121,35 @@ public:
    * @return uint64_t the runtime value or the default value.
    */
   virtual uint64_t getInteger(const std::string& key, uint64_t default_value) const PURE;
+
+  /**
+   * Variants of featureEnabled() and getInteger() that take a registered key. Snapshots that index
+   * their values by key override them; the defaults look the key up by name.
+   */
+  virtual bool featureEnabled(const Key& key, uint64_t default_value) const {
+    return featureEnabled(key.name(), default_value);
+  }
+
+  virtual bool featureEnabled(const Key& key, uint64_t default_value,
+                              uint64_t random_value) const {
+    return featureEnabled(key.name(), default_value, random_value);
+  }
+
+  virtual bool featureEnabled(const Key& key, uint64_t default_value, uint64_t random_value,
+                              uint16_t num_buckets) const {
+    return featureEnabled(key.name(), default_value, random_value, num_buckets);
+  }
+
+  virtual uint64_t getInteger(const Key& key, uint64_t default_value) const {
+    return getInteger(key.name(), default_value);
+  }
+
+  /**
+   * @return uint64_t a number that identifies the contents of the snapshot. Two snapshots with the
+   *         same version hold the same values, so anything computed from one of them can be kept
+   *         until the version changes.
+   */
+  virtual uint64_t version() const PURE;
 };
 
 /**
@@ -73,6 +73,18 @@ public:
    */
   virtual Network::Address::InstanceConstSharedPtr statsdUdpIpAddress() PURE;
 
+  /**
+   * @return uint64_t the maximum size of the datagrams that metrics flushed to the UDP statsd
+   *         address are batched into. 0 means that every metric is sent in its own datagram.
+   */
+  virtual uint64_t statsdUdpMaxPacketSize() PURE;
+
+  /**
+   * @return Optional<std::string> the optional cluster of the gRPC metrics service to stream stats
+   *         to. This cluster must be defined via the cluster manager configuration.
+   */
+  virtual Optional<std::string> metricsServiceClusterName() PURE;
+
   /**
    * @return std::chrono::milliseconds the time interval between flushing to configured stat sinks.
    *         The server latches counters.
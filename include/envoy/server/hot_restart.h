@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/common/pure.h"
 #include "envoy/event/dispatcher.h"
@@ -27,6 +28,18 @@ public:
     time_t original_start_time_;
   };
 
+  struct UnhealthyHostInfo {
+    std::string cluster_name_;
+    std::string address_;
+  };
+
+  struct StatsRegionInfo {
+    uint64_t stats_used_;
+    uint64_t stats_capacity_;
+    uint64_t symbols_used_;
+    uint64_t symbols_capacity_;
+  };
+
   virtual ~HotRestart() {}
 
   /**
@@ -39,9 +52,11 @@ public:
    * Retrieve a listening socket on the specified port from the parent process. The socket will be
    * duplicated across process boundaries.
    * @param port supplies the port of the socket to duplicate.
+   * @param worker_index supplies the index of the worker to duplicate the socket of, for
+   *        listeners that have a SO_REUSEPORT socket per worker.
    * @return int the fd or -1 if there is no bound listen port in the parent.
    */
-  virtual int duplicateParentListenSocket(const std::string& address) PURE;
+  virtual int duplicateParentListenSocket(const std::string& address, uint32_t worker_index) PURE;
 
   /**
    * Retrieve stats from our parent process.
@@ -49,6 +64,21 @@ public:
    */
   virtual void getParentStats(GetParentStatsInfo& info) PURE;
 
+  /**
+   * Retrieve the hosts that are failing health checks or are ejected by outlier detection in our
+   * parent process, so that a restarted process does not start out sending traffic to them.
+   * @param hosts will be filled with the cluster and address of each unhealthy host of our parent
+   *        if they can be retrieved.
+   */
+  virtual void getParentUnhealthyHosts(std::vector<UnhealthyHostInfo>& hosts) PURE;
+
+  /**
+   * Retrieve the utilization of the stats region shared between processes.
+   * @param info will be filled with the number of stats and name symbols in use, and the number
+   *        that the region has room for.
+   */
+  virtual void getStatsRegionInfo(StatsRegionInfo& info) PURE;
+
   /**
    * Initialize the restarter after primary server initialization begins. The hot restart
    * implementation needs to be created early to deal with shared memory, logging, etc. so
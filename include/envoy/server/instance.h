@@ -3,6 +3,8 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "envoy/access_log/access_log.h"
 #include "envoy/api/api.h"
@@ -24,6 +26,11 @@
 namespace Envoy {
 namespace Server {
 
+/**
+ * The time each phase of startup took, by phase name, in the order the phases ran.
+ */
+typedef std::vector<std::pair<std::string, std::chrono::milliseconds>> StartupPhaseTimes;
+
 /**
  * An instance of the running server.
  */
@@ -159,6 +166,12 @@ public:
    */
   virtual time_t startTimeFirstEpoch() PURE;
 
+  /**
+   * @return const StartupPhaseTimes& the time each phase of startup took. Phases that have not
+   *         completed yet are missing.
+   */
+  virtual const StartupPhaseTimes& startupPhaseTimes() PURE;
+
   /**
    * @return the server-wide stats store.
    */
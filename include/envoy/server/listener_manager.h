@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+
+#include "envoy/network/connection_handler.h"
 #include "envoy/network/filter.h"
 #include "envoy/network/listen_socket.h"
 #include "envoy/server/drain_manager.h"
@@ -30,6 +33,19 @@ public:
   virtual Network::ListenSocketSharedPtr
   createListenSocket(Network::Address::InstanceConstSharedPtr address, bool bind_to_port) PURE;
 
+  /**
+   * Creates a group of SO_REUSEPORT sockets bound to the same address, one per worker, so that the
+   * kernel balances incoming connections between workers instead of waking every worker up for
+   * each connection on a shared socket.
+   * @param address supplies the sockets' address.
+   * @param count supplies the number of sockets to create.
+   * @return std::vector<Network::ListenSocketSharedPtr> the initialized and bound sockets, indexed
+   *         by worker.
+   */
+  virtual std::vector<Network::ListenSocketSharedPtr>
+  createReusePortListenSockets(Network::Address::InstanceConstSharedPtr address,
+                               uint32_t count) PURE;
+
   /**
    * Creates a list of filter factories.
    * @param filters supplies the proto configuration.
@@ -70,6 +86,13 @@ public:
    */
   virtual Network::ListenSocket& socket() PURE;
 
+  /**
+   * @param worker_index supplies the index of a worker.
+   * @return Network::ListenSocket& the socket the worker accepts connections on. This is socket()
+   *         unless the listener has a SO_REUSEPORT socket per worker.
+   */
+  virtual Network::ListenSocket& workerSocket(uint32_t worker_index) PURE;
+
   /**
    * @return Ssl::ServerContext* the SSL context
    */
@@ -100,6 +123,36 @@ public:
    */
   virtual uint32_t perConnectionBufferLimitBytes() PURE;
 
+  /**
+   * @return uint32_t how far above the average worker, in percent, a worker's number of
+   *         connections must be before the worker hands newly accepted connections to the least
+   *         loaded worker. 0 disables connection balancing.
+   */
+  virtual uint32_t connectionBalanceThreshold() PURE;
+
+  /**
+   * @return bool whether the listen sockets of the listener have TCP Fast Open enabled.
+   */
+  virtual bool tcpFastOpen() PURE;
+
+  /**
+   * @return uint32_t the bytes that a single read or write event of a connection may move before
+   *         the connection yields to other connections of the worker. 0 is unlimited.
+   */
+  virtual uint32_t perEventByteBudget() PURE;
+
+  /**
+   * @return uint32_t the most connections a worker accepts each time the listen socket becomes
+   *         readable. 0 is unlimited.
+   */
+  virtual uint32_t maxAcceptsPerWakeup() PURE;
+
+  /**
+   * @return Network::AcceptLimiter* the limiter of the rate at which the workers accept
+   *         connections, or nullptr if the rate is unlimited. It outlives the workers' listeners.
+   */
+  virtual Network::AcceptLimiter* acceptLimiter() PURE;
+
   /**
    * @return Stats::Scope& the stats scope to use for all listener specific stats.
    */
@@ -137,6 +190,13 @@ public:
    */
   virtual bool addOrUpdateListener(const envoy::api::v2::Listener& config) PURE;
 
+  /**
+   * Add or update a listener, given the hash of its configuration as computed by
+   * MessageUtil::hash(), so that the configuration is not hashed again.
+   * @see addOrUpdateListener(const envoy::api::v2::Listener&).
+   */
+  virtual bool addOrUpdateListener(const envoy::api::v2::Listener& config, uint64_t hash) PURE;
+
   /**
    * @return std::vector<std::reference_wrapper<Listener>> a list of the currently loaded listeners.
    * Note that this routine returns references to the existing listeners. The references are only
@@ -175,6 +235,19 @@ public:
    * have exited.
    */
   virtual void stopWorkers() PURE;
+
+  /**
+   * Apply overload actions on all workers.
+   * @param actions supplies the actions to take. shed_bytes_ is the total across all workers and
+   *        is split evenly between them.
+   */
+  virtual void applyOverloadActions(const Network::OverloadActions& actions) PURE;
+
+  /**
+   * @return std::chrono::milliseconds how far the event loop of the worker that is furthest
+   *         behind has fallen behind. @see Event::Dispatcher::loopDelay().
+   */
+  virtual std::chrono::milliseconds workerLoopDelay() PURE;
 };
 
 } // namespace Server
@@ -3,6 +3,7 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/common/pure.h"
 #include "envoy/network/address.h"
@@ -54,21 +55,51 @@ public:
    */
   virtual uint32_t concurrency() PURE;
 
+  /**
+   * @return const std::vector<uint32_t>& the CPUs to pin worker threads to. Worker N is pinned to
+   *         entry N modulo the number of entries. Empty if worker threads are not pinned.
+   */
+  virtual const std::vector<uint32_t>& cpuset() PURE;
+
   /**
    * @return the number of seconds that envoy will perform draining during a hot restart.
    */
   virtual std::chrono::seconds drainTime() PURE;
 
+  /**
+   * @return uint64_t the number of connections that each worker drain closes at most per second
+   *         while draining, or 0 if there is no limit.
+   */
+  virtual uint64_t drainCloseRate() PURE;
+
   /**
    * @return const std::string& the path to the configuration file.
    */
   virtual const std::string& configPath() PURE;
 
+  /**
+   * @return const std::vector<std::string>& more configuration files. They are only accepted in
+   *         validate mode, which validates them along with configPath().
+   */
+  virtual const std::vector<std::string>& additionalConfigPaths() PURE;
+
   /**
    * @return const std::string& the admin address output file.
    */
   virtual const std::string& adminAddressPath() PURE;
 
+  /**
+   * @return const std::string& the file that the startup trace is written to once the server has
+   *         started, or empty if none is written.
+   */
+  virtual const std::string& startupTracePath() PURE;
+
+  /**
+   * @return const std::string& the directory that snapshots of the last applied configuration are
+   *         kept in, or empty if none are kept.
+   */
+  virtual const std::string& configSnapshotDir() PURE;
+
   /**
    * @return Network::Address::IpVersion the local address IP version.
    */
@@ -79,6 +110,12 @@ public:
    */
   virtual spdlog::level::level_enum logLevel() PURE;
 
+  /**
+   * @return uint64_t the maximum number of log messages that are queued for an asynchronous writer
+   *         thread, or 0 if messages are written synchronously by the thread logging them.
+   */
+  virtual uint64_t logQueueSize() PURE;
+
   /**
    * @return the number of seconds that envoy will wait before shutting down the parent envoy during
    *         a host restart. Generally this will be longer than the drainTime() option.
@@ -90,6 +127,23 @@ public:
    */
   virtual uint64_t restartEpoch() PURE;
 
+  /**
+   * @return uint64_t the number of stats the hot restart shared memory region has room for when
+   *         it is created. Restarted processes use the region of their parent as it is.
+   */
+  virtual uint64_t maxStats() PURE;
+
+  /**
+   * @return uint64_t the number of freed objects of each size, such as those of closed
+   *         connections, that every thread keeps to reuse their memory. 0 disables recycling.
+   */
+  virtual uint64_t maxRecycledObjects() PURE;
+
+  /**
+   * @return bool whether dispatchers batch epoll_ctl() calls through the libevent changelist.
+   */
+  virtual bool epollChangelist() PURE;
+
   /**
    * @return whether to verify the configuration file is valid, print any errors, and exit
    *         without serving.
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 
+#include "envoy/network/connection_handler.h"
 #include "envoy/server/guarddog.h"
 
 namespace Envoy {
@@ -68,6 +70,19 @@ public:
    * TODO(mattklein123): Same comment about the addition of a completion as stopListener().
    */
   virtual void stopListeners() PURE;
+
+  /**
+   * Apply overload actions to all of the worker's connections. This is called from the main
+   * thread and the actions are carried out on the worker thread.
+   * @param actions supplies the actions to take.
+   */
+  virtual void applyOverloadActions(const Network::OverloadActions& actions) PURE;
+
+  /**
+   * @return std::chrono::milliseconds how far the worker's event loop has fallen behind.
+   *         @see Event::Dispatcher::loopDelay().
+   */
+  virtual std::chrono::milliseconds loopDelay() PURE;
 };
 
 typedef std::unique_ptr<Worker> WorkerPtr;
@@ -80,9 +95,10 @@ public:
   virtual ~WorkerFactory() {}
 
   /**
+   * @param index supplies the index of the new worker, used to select per worker listen sockets.
    * @return WorkerPtr a new worker.
    */
-  virtual WorkerPtr createWorker() PURE;
+  virtual WorkerPtr createWorker(uint32_t index) PURE;
 };
 
 } // namespace Server
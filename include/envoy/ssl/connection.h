@@ -3,6 +3,7 @@
 #include <string>
 
 #include "envoy/common/pure.h"
+#include "envoy/common/time.h"
 
 namespace Envoy {
 namespace Ssl {
@@ -26,10 +27,11 @@ public:
   virtual std::string uriSanLocalCertificate() PURE;
 
   /**
-   * @return the SHA256 digest of the peer certificate. Returns "" if there is no peer certificate
-   *         which can happen in TLS (non mTLS) connections.
+   * @return the hex encoded SHA256 digest of the peer certificate. Returns "" if there is no peer
+   *         certificate which can happen in TLS (non mTLS) connections. The digest is computed
+   *         once per connection.
    */
-  virtual std::string sha256PeerCertificateDigest() PURE;
+  virtual const std::string& sha256PeerCertificateDigest() PURE;
 
   /**
    * @return the subject field of the peer certificate in RFC 2253 format. Returns "" if there is
@@ -42,6 +44,12 @@ public:
    *         certificate, or no SAN field, or no URI.
    **/
   virtual std::string uriSanPeerCertificate() PURE;
+
+  /**
+   * @return the approximate monotonic time when the TLS handshake started. For client connections
+   *         this is when the transport connected.
+   **/
+  virtual MonotonicTime handshakeStartTime() PURE;
 };
 
 } // namespace Ssl
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "envoy/common/pure.h"
+#include "envoy/ssl/private_key_method.h"
 
 namespace Envoy {
 namespace Ssl {
@@ -62,6 +63,12 @@ public:
    * Otherwise, ""
    */
   virtual const std::string& verifyCertificateHash() const PURE;
+
+  /**
+   * @return PrivateKeyMethodProviderSharedPtr the provider performing private key operations in
+   *         place of privateKeyFile(), or nullptr to load the private key into the context.
+   */
+  virtual PrivateKeyMethodProviderSharedPtr privateKeyMethodProvider() const PURE;
 };
 
 class ClientContextConfig : public virtual ContextConfig {
@@ -79,6 +86,14 @@ public:
    * @return True if client certificate is required, false otherwise.
    */
   virtual bool requireClientCertificate() const PURE;
+
+  /**
+   * @return const std::vector<std::string>& the files holding the session ticket keys. The first
+   *         key encrypts new tickets and every key decrypts presented tickets, so keys can be
+   *         rotated by prepending a new file. If empty, BoringSSL generates a random key per
+   *         context and tickets do not survive restarts or span multiple hosts.
+   */
+  virtual const std::vector<std::string>& sessionTicketKeyPaths() const PURE;
 };
 
 } // namespace Ssl
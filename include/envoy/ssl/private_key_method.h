@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "envoy/common/pure.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/json/json_object.h"
+
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Ssl {
+
+/**
+ * Callbacks for a connection whose handshake waits on an asynchronous private key operation.
+ */
+class PrivateKeyConnectionCallbacks {
+public:
+  virtual ~PrivateKeyConnectionCallbacks() {}
+
+  /**
+   * Called on the connection's dispatcher thread once a pending private key operation finished,
+   * successfully or not. The connection resumes its handshake, which collects the result.
+   */
+  virtual void onPrivateKeyMethodComplete() PURE;
+};
+
+/**
+ * Performs the private key operations of TLS handshakes in place of a private key loaded into the
+ * SSL_CTX, for example on an offload thread pool or a hardware accelerator. BoringSSL starts an
+ * operation through the SSL_PRIVATE_KEY_METHOD from within the handshake, and polls its complete()
+ * hook, which returns ssl_private_key_retry until the result is ready.
+ */
+class PrivateKeyMethodProvider {
+public:
+  virtual ~PrivateKeyMethodProvider() {}
+
+  /**
+   * Attach a connection, so that operations started for it can notify it when they finish.
+   * @param ssl supplies the connection's SSL.
+   * @param callbacks supplies the callbacks to notify.
+   * @param dispatcher supplies the dispatcher of the thread the connection runs on.
+   */
+  virtual void registerConnection(SSL* ssl, PrivateKeyConnectionCallbacks& callbacks,
+                                  Event::Dispatcher& dispatcher) PURE;
+
+  /**
+   * Detach a connection. An operation still pending for it finishes without notifying it.
+   * @param ssl supplies the connection's SSL.
+   */
+  virtual void unregisterConnection(SSL* ssl) PURE;
+
+  /**
+   * @return const SSL_PRIVATE_KEY_METHOD& the BoringSSL hooks to install on the SSL_CTX.
+   */
+  virtual const SSL_PRIVATE_KEY_METHOD& privateKeyMethod() PURE;
+};
+
+typedef std::shared_ptr<PrivateKeyMethodProvider> PrivateKeyMethodProviderSharedPtr;
+
+/**
+ * Implemented by each private key method provider and registered via Registry::registerFactory()
+ * or the convenience class RegisterFactory.
+ */
+class PrivateKeyMethodProviderFactory {
+public:
+  virtual ~PrivateKeyMethodProviderFactory() {}
+
+  /**
+   * Create a provider. If the provider can't be created it should throw an EnvoyException.
+   * @param config supplies the provider specific configuration.
+   * @param private_key_file supplies the configured private key file, which providers backed by
+   *        hardware may treat as a reference to a key they hold.
+   */
+  virtual PrivateKeyMethodProviderSharedPtr
+  createPrivateKeyMethodProvider(const Json::Object& config,
+                                 const std::string& private_key_file) PURE;
+
+  /**
+   * @return std::string the identifying name of the provider.
+   */
+  virtual std::string name() PURE;
+};
+
+} // namespace Ssl
+} // namespace Envoy
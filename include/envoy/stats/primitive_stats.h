@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * A counter that is only a value: it is not registered in a store, has no name and is not flushed
+ * to sinks. This is meant for stats that exist in very large numbers, like the stats of each
+ * upstream host, whose names are only built when they are listed.
+ */
+class PrimitiveCounter {
+public:
+  void add(uint64_t amount) { value_.fetch_add(amount, std::memory_order_relaxed); }
+  void inc() { add(1); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value_{};
+};
+
+/**
+ * A gauge that is only a value. @see PrimitiveCounter.
+ */
+class PrimitiveGauge {
+public:
+  void add(uint64_t amount) { value_.fetch_add(amount, std::memory_order_relaxed); }
+  void dec() { sub(1); }
+  void inc() { add(1); }
+  void set(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void sub(uint64_t amount) { value_.fetch_sub(amount, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> value_{};
+};
+
+} // namespace Stats
+
+/**
+ * Helper macros for blocks of primitive stats, which are declared like other stats (@see
+ * stats_macros.h) but are held by value:
+ *   struct MyDenseStats {
+ *     MY_COOL_STATS(GENERATE_PRIMITIVE_COUNTER_STRUCT, GENERATE_PRIMITIVE_GAUGE_STRUCT)
+ *   };
+ *
+ * The names and values of a block are listed with:
+ *   std::vector<std::pair<std::string, uint64_t>> counters{
+ *     MY_COOL_STATS(PRIMITIVE_STAT_NAME_AND_VALUE, IGNORE_PRIMITIVE_STAT)};
+ */
+#define GENERATE_PRIMITIVE_COUNTER_STRUCT(NAME) Stats::PrimitiveCounter NAME##_;
+#define GENERATE_PRIMITIVE_GAUGE_STRUCT(NAME) Stats::PrimitiveGauge NAME##_;
+
+#define PRIMITIVE_STAT_NAME_AND_VALUE(NAME) {#NAME, NAME##_.value()},
+#define IGNORE_PRIMITIVE_STAT(NAME)
+} // namespace Envoy
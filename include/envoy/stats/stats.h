@@ -2,11 +2,13 @@
 
 #include <chrono>
 #include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
 
 #include "envoy/common/pure.h"
+#include "envoy/common/time.h"
 
 namespace Envoy {
 namespace Event {
@@ -28,6 +30,13 @@ class Counter {
 public:
   virtual ~Counter() {}
   virtual void add(uint64_t amount) PURE;
+
+  /**
+   * @return bool whether the counter has been added to since the last call to clearChanged(). The
+   *         changed flag is reset. This is used by Store::forEachChangedCounter().
+   */
+  virtual bool clearChanged() PURE;
+
   virtual void inc() PURE;
   virtual uint64_t latch() PURE;
   virtual std::string name() PURE;
@@ -38,6 +47,11 @@ public:
 
 typedef std::shared_ptr<Counter> CounterSharedPtr;
 
+/**
+ * Callback invoked with the name of a counter and the counter.
+ */
+typedef std::function<void(const std::string& name, Counter& counter)> CounterCb;
+
 /**
  * A gauge that can both increment and decrement.
  */
@@ -46,6 +60,13 @@ public:
   virtual ~Gauge() {}
 
   virtual void add(uint64_t amount) PURE;
+
+  /**
+   * @return bool whether the gauge has been modified since the last call to clearChanged(). The
+   *         changed flag is reset. This is used by Store::forEachChangedGauge().
+   */
+  virtual bool clearChanged() PURE;
+
   virtual void dec() PURE;
   virtual void inc() PURE;
   virtual std::string name() PURE;
@@ -57,6 +78,11 @@ public:
 
 typedef std::shared_ptr<Gauge> GaugeSharedPtr;
 
+/**
+ * Callback invoked with the name of a gauge and the gauge.
+ */
+typedef std::function<void(const std::string& name, Gauge& gauge)> GaugeCb;
+
 /**
  * An individual timespan that is owned by a timer. The initial time is captured on construction.
  * A timespan must be completed via complete() for it to be stored. If the timespan is deleted
@@ -76,6 +102,12 @@ public:
    * against a timer with a dynamic name.
    */
   virtual void complete(const std::string& dynamic_name) PURE;
+
+  /**
+   * @return std::chrono::milliseconds the time since the span was allocated, e.g. to act on
+   *         outliers before the span is completed.
+   */
+  virtual std::chrono::milliseconds elapsed() PURE;
 };
 
 typedef std::unique_ptr<Timespan> TimespanPtr;
@@ -88,11 +120,80 @@ public:
   virtual ~Timer() {}
 
   virtual TimespanPtr allocateSpan() PURE;
+
+  /**
+   * Allocate a timespan that reads the time from a time source rather than from the clock.
+   * @param time_source supplies the time source, e.g. the approximate time of a dispatcher, which
+   *        must outlive the timespan.
+   */
+  virtual TimespanPtr allocateSpan(MonotonicTimeSource& time_source) PURE;
+
   virtual std::string name() PURE;
 };
 
 typedef std::shared_ptr<Timer> TimerSharedPtr;
 
+/**
+ * Summary statistics computed from a set of histogram samples.
+ */
+class HistogramStatistics {
+public:
+  virtual ~HistogramStatistics() {}
+
+  /**
+   * @return uint64_t the number of samples.
+   */
+  virtual uint64_t sampleCount() const PURE;
+
+  /**
+   * @return uint64_t the sum of all samples.
+   */
+  virtual uint64_t sampleSum() const PURE;
+
+  /**
+   * @param quantile supplies the quantile to estimate in the range [0, 1].
+   * @return double an estimate of the sample value at the quantile or 0 if there are no samples.
+   */
+  virtual double quantile(double quantile) const PURE;
+
+  /**
+   * @return std::string a human readable summary of the commonly used quantiles.
+   */
+  virtual std::string summary() const PURE;
+};
+
+/**
+ * A histogram of all samples delivered via Scope::deliverHistogramToSinks() and
+ * Scope::deliverTimingToSinks() for a single name. Samples are recorded per thread without locking
+ * and are only visible after merge() has been called.
+ */
+class Histogram {
+public:
+  virtual ~Histogram() {}
+
+  /**
+   * Merge the samples recorded on all threads since the last merge. The merged samples become the
+   * interval statistics and are added to the cumulative statistics. This must only be called from
+   * the main thread.
+   */
+  virtual void merge() PURE;
+
+  /**
+   * @return const HistogramStatistics& the samples merged by the last call to merge().
+   */
+  virtual const HistogramStatistics& intervalStatistics() const PURE;
+
+  /**
+   * @return const HistogramStatistics& all samples merged since the histogram was created.
+   */
+  virtual const HistogramStatistics& cumulativeStatistics() const PURE;
+
+  virtual std::string name() PURE;
+  virtual bool used() PURE;
+};
+
+typedef std::shared_ptr<Histogram> HistogramSharedPtr;
+
 /**
  * A sink for stats. Each sink is responsible for writing stats to a backing store.
  */
@@ -101,8 +202,8 @@ public:
   virtual ~Sink() {}
 
   /**
-   * This will be called before a sequence of flushCounter() and flushGauge() calls. Sinks can
-   * choose to optimize writing if desired with a paired endFlush() call.
+   * This will be called before a sequence of flushCounter(), flushGauge(), and flushHistogram()
+   * calls. Sinks can choose to optimize writing if desired with a paired endFlush() call.
    */
   virtual void beginFlush() PURE;
 
@@ -117,11 +218,18 @@ public:
   virtual void flushGauge(const std::string& name, uint64_t value) PURE;
 
   /**
-   * This will be called after beginFlush(), some number of flushCounter(), and some number of
-   * flushGauge(). Sinks can use this to optimize writing if desired.
+   * This will be called after beginFlush(), some number of flushCounter(), some number of
+   * flushGauge(), and some number of flushHistogram(). Sinks can use this to optimize writing if
+   * desired.
    */
   virtual void endFlush() PURE;
 
+  /**
+   * Flush the statistics of a histogram for the last flush interval. This is called between
+   * beginFlush() and endFlush().
+   */
+  virtual void flushHistogram(const std::string& name, const HistogramStatistics& statistics) PURE;
+
   /**
    * Flush a histogram value.
    */
@@ -181,7 +289,7 @@ public:
 };
 
 /**
- * A store for all known counters, gauges, and timers.
+ * A store for all known counters, gauges, histograms, and timers.
  */
 class Store : public Scope {
 public:
@@ -194,6 +302,40 @@ public:
    * @return a list of all known gauges.
    */
   virtual std::list<GaugeSharedPtr> gauges() const PURE;
+
+  /**
+   * @return a list of all known histograms.
+   */
+  virtual std::list<HistogramSharedPtr> histograms() const PURE;
+
+  /**
+   * Iterate over all known counters without copying them into a list. Each counter is visited
+   * exactly once, in no particular order. The store may be locked during the iteration so the
+   * callback must not allocate stats.
+   * @param callback supplies the callback to invoke for each counter.
+   */
+  virtual void forEachCounter(CounterCb callback) const PURE;
+
+  /**
+   * Iterate over all known gauges without copying them into a list. @see forEachCounter().
+   * @param callback supplies the callback to invoke for each gauge.
+   */
+  virtual void forEachGauge(GaugeCb callback) const PURE;
+
+  /**
+   * Iterate over the counters that changed since the last call, clearing their changed flags. The
+   * names of unchanged counters are not built, so this is much cheaper than forEachCounter() when
+   * few counters change between calls. It is meant for the periodic stats flush, which must be
+   * the only caller. @see forEachCounter() for the other restrictions.
+   * @param callback supplies the callback to invoke for each changed counter.
+   */
+  virtual void forEachChangedCounter(CounterCb callback) const PURE;
+
+  /**
+   * Iterate over the gauges that changed since the last call. @see forEachChangedCounter().
+   * @param callback supplies the callback to invoke for each changed gauge.
+   */
+  virtual void forEachChangedGauge(GaugeCb callback) const PURE;
 };
 
 /**
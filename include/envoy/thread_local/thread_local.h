@@ -34,11 +34,19 @@ public:
   virtual ThreadLocalObjectSharedPtr get() PURE;
 
   /**
-   * This is a helper on top of get() that casts the object stored in the slot to the specified
-   * type. Since the slot only stores pointers to the base interface, dynamic_cast provides some
-   * level of protection via RTTI.
+   * Like get(), but without taking a reference on the object, which saves a pair of atomic
+   * reference count updates on every call. The returned reference is only valid until the slot is
+   * next set() on this thread, so it must not be held beyond the current dispatcher callback.
+   * @return ThreadLocalObject& the thread local object stored in the slot.
    */
-  template <class T> T& getTyped() { return *std::dynamic_pointer_cast<T>(get()); }
+  virtual ThreadLocalObject& getObject() PURE;
+
+  /**
+   * This is a helper on top of getObject() that casts the object stored in the slot to the
+   * specified type. Since the slot only stores pointers to the base interface, dynamic_cast
+   * provides some level of protection via RTTI.
+   */
+  template <class T> T& getTyped() { return dynamic_cast<T&>(getObject()); }
 
   /**
    * Run a callback on all registered threads.
@@ -55,6 +63,19 @@ public:
    */
   typedef std::function<ThreadLocalObjectSharedPtr(Event::Dispatcher& dispatcher)> InitializeCb;
   virtual void set(InitializeCb cb) PURE;
+
+  /**
+   * Like set(), but for slots that are updated often with a complete replacement of their data,
+   * such as configuration snapshots. Updates are coalesced per thread: if a thread has not yet
+   * applied an earlier update when a new one is made, it only ever applies the newest one, and the
+   * earlier initializeCb and everything it captured are released right away on the calling
+   * thread. Each thread receives at most one post per slot no matter how many updates are made in
+   * the meantime.
+   * @param initializeCb supplies the functor that will be called on each thread, @see set().
+   * @param complete_cb supplies an optional callback that is run on the main thread once every
+   *                    thread has applied this update or a later one.
+   */
+  virtual void update(InitializeCb cb, Event::PostCb complete_cb) PURE;
 };
 
 typedef std::unique_ptr<Slot> SlotPtr;
@@ -39,6 +39,14 @@ public:
    */
   virtual bool addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster& cluster) PURE;
 
+  /**
+   * Add or update a cluster via API, given the hash of its config as computed by
+   * MessageUtil::hash(), so that the config of an unchanged cluster is not hashed again.
+   * @see addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster&).
+   */
+  virtual bool addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster& cluster,
+                                         uint64_t config_hash) PURE;
+
   /**
    * Set a callback that will be invoked when all owned clusters have been initialized.
    */
@@ -64,6 +72,23 @@ public:
    */
   virtual ThreadLocalCluster* get(const std::string& cluster) PURE;
 
+  /**
+   * Intern a cluster name, so that workers can look the cluster up by indexing rather than by
+   * hashing its name. This is meant to be done once when configuration that names a cluster is
+   * loaded. The id stays bound to the name for the lifetime of the cluster manager, whether or not
+   * a cluster of that name exists, and follows the cluster as it is added, updated and removed.
+   * This is thread safe.
+   * @param cluster supplies the cluster name.
+   * @return uint32_t the id of the cluster name.
+   */
+  virtual uint32_t clusterId(const std::string& cluster) PURE;
+
+  /**
+   * @return ThreadLocalCluster* the thread local cluster with the given id or nullptr if it does
+   * not exist. @see get(const std::string&).
+   */
+  virtual ThreadLocalCluster* getById(uint32_t cluster_id) PURE;
+
   /**
    * Allocate a load balanced HTTP connection pool for a cluster. This is *per-thread* so that
    * callers do not need to worry about per thread synchronization. The load balancing policy that
@@ -76,6 +101,14 @@ public:
                                                                  ResourcePriority priority,
                                                                  LoadBalancerContext* context) PURE;
 
+  /**
+   * Allocate a load balanced HTTP connection pool for a cluster given the id of its name.
+   * @see httpConnPoolForCluster(const std::string&, ResourcePriority, LoadBalancerContext*).
+   */
+  virtual Http::ConnectionPool::Instance*
+  httpConnPoolForClusterId(uint32_t cluster_id, ResourcePriority priority,
+                           LoadBalancerContext* context) PURE;
+
   /**
    * Allocate a load balanced TCP connection for a cluster. The created connection is already
    * bound to the correct *per-thread* dispatcher, so no further synchronization is needed. The
@@ -87,6 +120,18 @@ public:
   virtual Host::CreateConnectionData tcpConnForCluster(const std::string& cluster,
                                                        LoadBalancerContext* context) PURE;
 
+  /**
+   * Claim an idle TCP connection to a cluster that was established ahead of time, if the cluster
+   * keeps prewarmed connections (see ClusterInfo::prewarmedTcpConnections()). Unlike connections
+   * from tcpConnForCluster(), the connection is already connected, so the caller must not call
+   * connect() on it and won't see a Connected event. A replacement is opened in the background.
+   *
+   * Returns both a connection and the host that backs the connection. Both are nullptr if no
+   * prewarmed connection is available, or if the context requires a specific host.
+   */
+  virtual Host::CreateConnectionData prewarmedTcpConnForCluster(const std::string& cluster,
+                                                                LoadBalancerContext* context) PURE;
+
   /**
    * Returns a client that can be used to make async HTTP calls against the given cluster. The
    * client may be backed by a connection pool or by a multiplexed connection. The cluster manager
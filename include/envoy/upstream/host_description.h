@@ -1,18 +1,23 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "envoy/network/address.h"
-#include "envoy/stats/stats_macros.h"
+#include "envoy/stats/primitive_stats.h"
 #include "envoy/upstream/health_check_host_monitor.h"
 #include "envoy/upstream/outlier_detection.h"
 
+#include "api/base.pb.h"
+
 namespace Envoy {
 namespace Upstream {
 
 /**
- * All per host stats. @see stats_macros.h
+ * All per host stats. @see primitive_stats.h
  */
 // clang-format off
 #define ALL_HOST_STATS(COUNTER, GAUGE)                                                             \
@@ -25,10 +30,25 @@ namespace Upstream {
 // clang-format on
 
 /**
- * All per host stats defined. @see stats_macros.h
+ * All per host stats defined. These are held by value in every host rather than in a stats store,
+ * as there can be a very large number of hosts. @see primitive_stats.h
  */
 struct HostStats {
-  ALL_HOST_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+  ALL_HOST_STATS(GENERATE_PRIMITIVE_COUNTER_STRUCT, GENERATE_PRIMITIVE_GAUGE_STRUCT)
+
+  /**
+   * @return the name and value of each counter.
+   */
+  std::vector<std::pair<std::string, uint64_t>> counters() const {
+    return {ALL_HOST_STATS(PRIMITIVE_STAT_NAME_AND_VALUE, IGNORE_PRIMITIVE_STAT)};
+  }
+
+  /**
+   * @return the name and value of each gauge.
+   */
+  std::vector<std::pair<std::string, uint64_t>> gauges() const {
+    return {ALL_HOST_STATS(IGNORE_PRIMITIVE_STAT, PRIMITIVE_STAT_NAME_AND_VALUE)};
+  }
 };
 
 class ClusterInfo;
@@ -60,6 +80,11 @@ public:
    */
   virtual HealthCheckHostMonitor& healthChecker() const PURE;
 
+  /**
+   * @return the metadata of the host, e.g. the metadata of its EDS endpoint.
+   */
+  virtual const envoy::api::v2::Metadata& metadata() const PURE;
+
   /**
    * @return the hostname associated with the host if any.
    * Empty string "" indicates that hostname is not a DNS name.
@@ -74,7 +99,7 @@ public:
   /**
    * @return host specific stats.
    */
-  virtual const HostStats& stats() const PURE;
+  virtual HostStats& stats() const PURE;
 
   /**
    * @return the "zone" of the host (deployment specific). Empty is unknown.
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 
 #include "envoy/common/pure.h"
+#include "envoy/upstream/load_balancer_type.h"
 #include "envoy/upstream/upstream.h"
 
 namespace Envoy {
@@ -27,6 +29,13 @@ public:
    * balancing.
    */
   virtual const Network::Connection* downstreamConnection() const PURE;
+
+  /**
+   * @return const MetadataMatchCriteria* the metadata that the chosen host must have, or nullptr
+   *         if the request has no requirements. Only used by clusters with load balancing
+   *         subsets.
+   */
+  virtual const MetadataMatchCriteria* metadataMatchCriteria() const PURE;
 };
 
 /**
@@ -43,6 +52,15 @@ public:
    *        is missing and use sensible defaults.
    */
   virtual HostConstSharedPtr chooseHost(const LoadBalancerContext* context) PURE;
+
+  /**
+   * Report the response time of a request to a host previously returned by chooseHost(). Load
+   * balancers that do not take latency into account ignore it.
+   * @param host supplies the host that served the request.
+   * @param response_time supplies the time from the end of the request to the end of the response.
+   */
+  virtual void onResponseTime(const HostDescription& host,
+                              std::chrono::milliseconds response_time) PURE;
 };
 
 typedef std::unique_ptr<LoadBalancer> LoadBalancerPtr;
@@ -1,12 +1,32 @@
 #pragma once
 
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace Envoy {
 namespace Upstream {
 
 /**
  * Type of load balancing to perform.
  */
-enum class LoadBalancerType { RoundRobin, LeastRequest, Random, RingHash, OriginalDst };
+enum class LoadBalancerType {
+  RoundRobin,
+  LeastRequest,
+  PeakEwma,
+  Random,
+  RingHash,
+  Maglev,
+  OriginalDst
+};
+
+/**
+ * The metadata that a request requires of the hosts it is load balanced over, in clusters that
+ * group their hosts into subsets. Each entry is a key in the envoy.lb metadata namespace and the
+ * value that hosts must have for it, rendered by Config::Metadata::valueString(). Entries are
+ * sorted by key.
+ */
+typedef std::vector<std::pair<std::string, std::string>> MetadataMatchCriteria;
 
 } // namespace Upstream
 } // namespace Envoy
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 
@@ -73,6 +74,25 @@ public:
    * @return Resource& active retries.
    */
   virtual Resource& retries() PURE;
+
+  /**
+   * @return Resource& active hedged requests (second requests sent while the first one is still
+   *         outstanding).
+   */
+  virtual Resource& hedges() PURE;
+
+  /**
+   * @return Resource& active shadowed requests (copies of requests sent to this cluster by a
+   *         route shadow policy, whose responses are discarded).
+   */
+  virtual Resource& shadows() PURE;
+
+  /**
+   * Record the response time of a completed request, from which an adaptive requests limit is
+   * adjusted. Called on any thread.
+   * @param response_time supplies the time from the end of the request to the end of the response.
+   */
+  virtual void onResponseTime(std::chrono::microseconds response_time) PURE;
 };
 
 } // namespace Upstream
@@ -11,8 +11,10 @@
 #include "envoy/common/callback.h"
 #include "envoy/common/optional.h"
 #include "envoy/http/codec.h"
+#include "envoy/http/codes.h"
 #include "envoy/network/connection.h"
 #include "envoy/ssl/context.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/upstream/health_check_host_monitor.h"
 #include "envoy/upstream/load_balancer_type.h"
 #include "envoy/upstream/outlier_detection.h"
@@ -35,14 +37,11 @@ public:
     // The host is currently failing active health checks.
     FAILED_ACTIVE_HC = 0x1,
     // The host is currently considered an outlier and has been ejected.
-    FAILED_OUTLIER_CHECK = 0x02
+    FAILED_OUTLIER_CHECK = 0x02,
+    // The host is currently marked as unhealthy by EDS.
+    FAILED_EDS_HEALTH = 0x04
   };
 
-  /**
-   * @return host specific counters.
-   */
-  virtual std::list<Stats::CounterSharedPtr> counters() const PURE;
-
   /**
    * Create a connection for this host.
    * @param dispatcher supplies the owning dispatcher.
@@ -54,11 +53,6 @@ public:
    */
   virtual CreateConnectionData createConnection(Event::Dispatcher& dispatcher) const PURE;
 
-  /**
-   * @return host specific gauges.
-   */
-  virtual std::list<Stats::GaugeSharedPtr> gauges() const PURE;
-
   /**
    * Atomically clear a health flag for a host. Flags are specified in HealthFlags.
    */
@@ -178,6 +172,9 @@ public:
   COUNTER(lb_healthy_panic)                                                                        \
   COUNTER(lb_local_cluster_not_ok)                                                                 \
   COUNTER(lb_recalculate_zone_structures)                                                          \
+  COUNTER(lb_subsets_fallback)                                                                     \
+  COUNTER(lb_subsets_selected)                                                                     \
+  COUNTER(lb_unhealthy_repick)                                                                     \
   COUNTER(lb_zone_cluster_too_small)                                                               \
   COUNTER(lb_zone_no_capacity_left)                                                                \
   COUNTER(lb_zone_number_differs)                                                                  \
@@ -206,13 +203,20 @@ public:
   GAUGE  (upstream_cx_tx_bytes_buffered)                                                           \
   COUNTER(upstream_cx_protocol_error)                                                              \
   COUNTER(upstream_cx_max_requests)                                                                \
+  COUNTER(upstream_cx_idle_timeout)                                                                \
   COUNTER(upstream_cx_none_healthy)                                                                \
+  COUNTER(upstream_cx_prewarmed_claimed)                                                           \
+  COUNTER(upstream_cx_tcp_fast_open)                                                               \
+  COUNTER(upstream_cx_read_budget_exhausted)                                                       \
+  COUNTER(upstream_cx_write_budget_exhausted)                                                      \
   COUNTER(upstream_rq_total)                                                                       \
   GAUGE  (upstream_rq_active)                                                                      \
   COUNTER(upstream_rq_pending_total)                                                               \
   COUNTER(upstream_rq_pending_overflow)                                                            \
   COUNTER(upstream_rq_pending_failure_eject)                                                       \
   GAUGE  (upstream_rq_pending_active)                                                              \
+  TIMER  (upstream_rq_pool_wait_ms)                                                                \
+  TIMER  (upstream_rq_first_byte_ms)                                                               \
   COUNTER(upstream_rq_cancelled)                                                                   \
   COUNTER(upstream_rq_maintenance_mode)                                                            \
   COUNTER(upstream_rq_timeout)                                                                     \
@@ -222,6 +226,12 @@ public:
   COUNTER(upstream_rq_retry)                                                                       \
   COUNTER(upstream_rq_retry_success)                                                               \
   COUNTER(upstream_rq_retry_overflow)                                                              \
+  COUNTER(upstream_rq_retry_pushback)                                                              \
+  COUNTER(upstream_rq_retry_buffer_overflow)                                                       \
+  COUNTER(upstream_rq_hedge)                                                                       \
+  COUNTER(upstream_rq_hedge_won)                                                                   \
+  COUNTER(upstream_rq_hedge_overflow)                                                              \
+  COUNTER(upstream_rq_shadow_overflow)                                                             \
   COUNTER(upstream_flow_control_paused_reading_total)                                              \
   COUNTER(upstream_flow_control_resumed_reading_total)                                             \
   COUNTER(upstream_flow_control_backed_up_total)                                                   \
@@ -232,7 +242,8 @@ public:
   GAUGE  (membership_total)                                                                        \
   COUNTER(update_attempt)                                                                          \
   COUNTER(update_success)                                                                          \
-  COUNTER(update_failure)
+  COUNTER(update_failure)                                                                          \
+  COUNTER(update_no_rebuild)
 // clang-format on
 
 /**
@@ -250,6 +261,9 @@ public:
   struct Features {
     // Whether the upstream supports HTTP2. This is used when creating connection pools.
     static const uint64_t HTTP2 = 0x1;
+    // Whether each upstream host picks HTTP/2 or HTTP/1.1 with ALPN. This is used when creating
+    // connection pools.
+    static const uint64_t HTTP2_ALPN = 0x2;
   };
 
   virtual ~ClusterInfo() {}
@@ -286,6 +300,24 @@ public:
    */
   virtual LoadBalancerType lbType() const PURE;
 
+  /**
+   * @return uint64_t the requested size of the lookup table when lbType() is Maglev.
+   */
+  virtual uint64_t maglevTableSize() const PURE;
+
+  /**
+   * @return const std::vector<std::vector<std::string>>& the sets of envoy.lb metadata keys by
+   *         which the hosts of the cluster are grouped into load balancing subsets. Each set is
+   *         sorted. Empty if the cluster does not use subsets.
+   */
+  virtual const std::vector<std::vector<std::string>>& lbSubsetKeys() const PURE;
+
+  /**
+   * @return bool whether a request that matches no subset is load balanced over all hosts of the
+   *         cluster. Otherwise no host is chosen for it. Only used if lbSubsetKeys() is not empty.
+   */
+  virtual bool lbSubsetFallback() const PURE;
+
   /**
    * @return Whether the cluster is currently in maintenance mode and should not be routed to.
    *         Different filters may handle this situation in different ways. The implementation
@@ -294,6 +326,13 @@ public:
    */
   virtual bool maintenanceMode() const PURE;
 
+  /**
+   * @return bool whether workers build their state for the cluster, such as its load balancer,
+   *         only once they first route to it, and drop it again once they have not for a while.
+   *         This saves memory and membership update work for clusters that few requests go to.
+   */
+  virtual bool onDemand() const PURE;
+
   /**
    * @return uint64_t the maximum number of outbound requests that a connection pool will make on
    *         each upstream connection. This can be used to increase spread if the backends cannot
@@ -301,6 +340,54 @@ public:
    */
   virtual uint64_t maxRequestsPerConnection() const PURE;
 
+  /**
+   * @return uint32_t the number of connections that a connection pool keeps open to each upstream
+   *         host even when there are no requests, so that a burst of requests after an idle
+   *         period does not wait for connection establishment. 0 indicates no warm connections.
+   */
+  virtual uint32_t minWarmConnections() const PURE;
+
+  /**
+   * @return double the number of connections that an HTTP/1.1 connection pool keeps open or
+   *         connecting for each active or pending request. A ratio above 1 opens connections
+   *         ahead of the requests that will need them. The ratio is never below 1.
+   */
+  virtual double prefetchRatio() const PURE;
+
+  /**
+   * @return std::chrono::milliseconds how long an HTTP/1.1 connection pool keeps a connection open
+   *         that has no request, if the pool has more connections than minWarmConnections(). 0
+   *         indicates no idle timeout.
+   */
+  virtual std::chrono::milliseconds connectionIdleTimeout() const PURE;
+
+  /**
+   * @return uint32_t the number of idle connections to the cluster that each worker keeps
+   *         established for TCP proxies to claim, so that new downstream connections don't wait for
+   *         the upstream connect. 0 indicates no prewarmed connections.
+   */
+  virtual uint32_t prewarmedTcpConnections() const PURE;
+
+  /**
+   * @return bool whether each upstream host of the cluster has its connection pools on a single
+   *         worker, which all other workers hand their requests for the host to. This keeps the
+   *         number of upstream connections independent of the number of workers, at the cost of
+   *         a thread hop for most requests.
+   */
+  virtual bool sharedConnPools() const PURE;
+
+  /**
+   * @return bool whether upstream connections send their first data with the SYN using TCP Fast
+   *         Open, which saves a round trip once the host has issued a Fast Open cookie.
+   */
+  virtual bool tcpFastOpen() const PURE;
+
+  /**
+   * @return uint32_t the bytes that a single read or write event of an upstream connection may
+   *         move before the connection yields to other connections of the worker. 0 is unlimited.
+   */
+  virtual uint32_t perEventByteBudget() const PURE;
+
   /**
    * @return the human readable name of the cluster.
    */
@@ -328,6 +415,12 @@ public:
    */
   virtual Stats::Scope& statsScope() const PURE;
 
+  /**
+   * @return Http::CodeStats& pre-resolved response code stats that are charged against
+   *         statsScope(). Using these avoids per-response dynamic stat name lookups.
+   */
+  virtual Http::CodeStats& codeStats() const PURE;
+
   /**
    * Returns an optional source address for upstream connections to bind to.
    *
@@ -19,7 +19,8 @@ Impl::Impl(std::chrono::milliseconds file_flush_interval_msec)
 
 Filesystem::FileSharedPtr Impl::createFile(const std::string& path, Event::Dispatcher& dispatcher,
                                            Thread::BasicLockable& lock, Stats::Store& stats_store) {
-  return std::make_shared<Filesystem::FileImpl>(path, dispatcher, lock, *os_sys_calls_, stats_store,
+  return std::make_shared<Filesystem::FileImpl>(path, dispatcher, lock, file_flusher_,
+                                                *os_sys_calls_, stats_store,
                                                 file_flush_interval_msec_);
 }
 
@@ -6,6 +6,8 @@
 #include "envoy/api/api.h"
 #include "envoy/filesystem/filesystem.h"
 
+#include "common/filesystem/filesystem_impl.h"
+
 namespace Envoy {
 namespace Api {
 
@@ -26,6 +28,9 @@ public:
 
 private:
   Filesystem::OsSysCallsPtr os_sys_calls_;
+  // All files are flushed by one thread. It is declared after os_sys_calls_ so that it is
+  // destroyed first.
+  Filesystem::FileFlusher file_flusher_;
   std::chrono::milliseconds file_flush_interval_msec_;
 };
 
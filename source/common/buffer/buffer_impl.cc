@@ -1,32 +1,303 @@
 #include "common/buffer/buffer_impl.h"
 
+#include <sys/uio.h>
+
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <new>
 #include <string>
 
-#include "common/common/assert.h"
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
-#include "event2/buffer.h"
+#include "common/common/assert.h"
 
 namespace Envoy {
 namespace Buffer {
 
+// RawSlice is the same structure as iovec. This lets read() and write() hand slices straight to
+// readv() and writev() without leaking system headers into most code.
+static_assert(sizeof(RawSlice) == sizeof(iovec), "RawSlice != iovec");
+static_assert(offsetof(RawSlice, mem_) == offsetof(iovec, iov_base), "RawSlice != iovec");
+static_assert(offsetof(RawSlice, len_) == offsetof(iovec, iov_len), "RawSlice != iovec");
+
+const uint64_t Slice::DEFAULT_SIZE;
+const uint64_t Slice::MAX_FREE_BLOCKS;
+
+namespace {
+
+// Block capacities, smallest first. Small buffers (a single header or a short message) only take
+// up a small block, while anything bigger is built out of DEFAULT_SIZE blocks.
+const uint64_t SliceSizeClasses[] = {1024, 4096, Slice::DEFAULT_SIZE};
+const uint32_t NumSliceSizeClasses = sizeof(SliceSizeClasses) / sizeof(SliceSizeClasses[0]);
+
+} // namespace
+
+class SlicePool;
+
+/**
+ * All live pools, so that their allocation counts can be summed up.
+ */
+struct SlicePoolRegistry {
+  static SlicePoolRegistry& get() {
+    static SlicePoolRegistry* registry = new SlicePoolRegistry();
+    return *registry;
+  }
+
+  std::mutex lock_;
+  std::list<SlicePool*> pools_;
+  // Bytes accounted to threads that have exited. This may be negative since blocks can be
+  // released on a different thread than they were allocated on.
+  std::atomic<int64_t> retired_bytes_{};
+};
+
+/**
+ * Per thread free lists of blocks, one for each size class. Blocks are returned to the list of the
+ * thread that releases them, which may not be the thread that allocated them.
+ */
+class SlicePool {
+public:
+  SlicePool() {
+    SlicePoolRegistry& registry = SlicePoolRegistry::get();
+    std::unique_lock<std::mutex> lock(registry.lock_);
+    registry_entry_ = registry.pools_.insert(registry.pools_.end(), this);
+  }
+
+  ~SlicePool() {
+    for (std::vector<Slice::Block*>& free_blocks : free_blocks_) {
+      for (Slice::Block* block : free_blocks) {
+        destroy(block);
+      }
+    }
+    destroyed_ = true;
+
+    SlicePoolRegistry& registry = SlicePoolRegistry::get();
+    std::unique_lock<std::mutex> lock(registry.lock_);
+    registry.pools_.erase(registry_entry_);
+    registry.retired_bytes_ += allocated_bytes_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @return SlicePool* the pool of the calling thread, or nullptr if the thread is exiting and its
+   *         pool has already been destroyed.
+   */
+  static SlicePool* get() {
+    if (destroyed_) {
+      return nullptr;
+    }
+
+    static thread_local SlicePool pool;
+    return &pool;
+  }
+
+  Slice::Block* take(uint32_t size_class) {
+    std::vector<Slice::Block*>& free_blocks = free_blocks_[size_class];
+    if (free_blocks.empty()) {
+      return nullptr;
+    }
+
+    Slice::Block* block = free_blocks.back();
+    free_blocks.pop_back();
+    return block;
+  }
+
+  bool give(Slice::Block* block) {
+    std::vector<Slice::Block*>& free_blocks = free_blocks_[block->size_class_];
+    if (free_blocks.size() >= Slice::MAX_FREE_BLOCKS) {
+      return false;
+    }
+
+    free_blocks.push_back(block);
+    return true;
+  }
+
+  /**
+   * Account for blocks being handed to or released from slices on the calling thread.
+   */
+  static void account(int64_t delta) {
+    SlicePool* pool = get();
+    if (pool) {
+      // Only the owning thread writes its count, so this does not need an atomic add.
+      pool->allocated_bytes_.store(pool->allocated_bytes_.load(std::memory_order_relaxed) + delta,
+                                   std::memory_order_relaxed);
+    } else {
+      SlicePoolRegistry::get().retired_bytes_ += delta;
+    }
+  }
+
+  static uint64_t allocatedBytes() {
+    SlicePoolRegistry& registry = SlicePoolRegistry::get();
+    std::unique_lock<std::mutex> lock(registry.lock_);
+    int64_t total = registry.retired_bytes_;
+    for (SlicePool* pool : registry.pools_) {
+      total += pool->allocated_bytes_.load(std::memory_order_relaxed);
+    }
+    return total > 0 ? total : 0;
+  }
+
+  static void destroy(Slice::Block* block) {
+    if (block->fragment_) {
+      block->fragment_->done();
+      delete block;
+      return;
+    }
+
+    block->~Block();
+    ::operator delete(block);
+  }
+
+private:
+  static thread_local bool destroyed_;
+  std::vector<Slice::Block*> free_blocks_[NumSliceSizeClasses];
+  // Bytes handed to slices minus bytes released by slices on this thread.
+  std::atomic<int64_t> allocated_bytes_{};
+  std::list<SlicePool*>::iterator registry_entry_;
+};
+
+thread_local bool SlicePool::destroyed_ = false;
+
+Slice Slice::create(uint64_t min_capacity) {
+  uint32_t size_class = 0;
+  while (size_class < NumSliceSizeClasses && SliceSizeClasses[size_class] < min_capacity) {
+    size_class++;
+  }
+
+  Block* block = nullptr;
+  if (size_class < NumSliceSizeClasses) {
+    SlicePool* pool = SlicePool::get();
+    if (pool) {
+      block = pool->take(size_class);
+    }
+  }
+
+  if (!block) {
+    const uint64_t capacity =
+        size_class < NumSliceSizeClasses ? SliceSizeClasses[size_class] : min_capacity;
+    block = new (::operator new(sizeof(Block) + capacity)) Block();
+    block->base_ = reinterpret_cast<uint8_t*>(block + 1);
+    block->fragment_ = nullptr;
+    block->size_class_ = size_class;
+    block->capacity_ = capacity;
+  }
+
+  block->refs_.store(1, std::memory_order_relaxed);
+  SlicePool::account(block->capacity_);
+  return Slice(block, 0, 0);
+}
+
+Slice Slice::fromFragment(BufferFragment& fragment) {
+  ASSERT(fragment.size() > 0);
+  Block* block = new Block();
+  block->base_ = static_cast<uint8_t*>(const_cast<void*>(fragment.data()));
+  block->fragment_ = &fragment;
+  block->refs_.store(1, std::memory_order_relaxed);
+  block->size_class_ = NumSliceSizeClasses;
+  block->capacity_ = fragment.size();
+  // All of the fragment is data, so nothing is ever reservable.
+  return Slice(block, 0, block->capacity_);
+}
+
+Slice::Slice(Slice&& rhs) noexcept
+    : block_(rhs.block_), data_(rhs.data_), reservable_(rhs.reservable_) {
+  rhs.block_ = nullptr;
+}
+
+Slice& Slice::operator=(Slice&& rhs) noexcept {
+  if (this != &rhs) {
+    release();
+    block_ = rhs.block_;
+    data_ = rhs.data_;
+    reservable_ = rhs.reservable_;
+    rhs.block_ = nullptr;
+  }
+
+  return *this;
+}
+
+uint64_t Slice::append(const void* data, uint64_t size) {
+  const uint64_t copy_size = std::min(size, reservableSize());
+  if (copy_size > 0) {
+    memcpy(reservable(), data, copy_size);
+    reservable_ += copy_size;
+  }
+
+  return copy_size;
+}
+
+Slice Slice::split(uint64_t size) {
+  ASSERT(size <= dataSize());
+  block_->refs_.fetch_add(1, std::memory_order_relaxed);
+  Slice front(block_, data_, data_ + size);
+  data_ += size;
+  return front;
+}
+
+Slice Slice::share() const {
+  block_->refs_.fetch_add(1, std::memory_order_relaxed);
+  return Slice(block_, data_, reservable_);
+}
+
+void Slice::release() {
+  if (block_ && block_->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    freeBlock(block_);
+  }
+
+  block_ = nullptr;
+}
+
+uint64_t Slice::allocatedBytes() { return SlicePool::allocatedBytes(); }
+
+void Slice::freeBlock(Block* block) {
+  if (!block->fragment_) {
+    SlicePool::account(-static_cast<int64_t>(block->capacity_));
+  }
+
+  if (block->size_class_ < NumSliceSizeClasses) {
+    SlicePool* pool = SlicePool::get();
+    if (pool && pool->give(block)) {
+      return;
+    }
+  }
+
+  SlicePool::destroy(block);
+}
+
 InstancePtr OwnedImplFactory::create() { return InstancePtr{new OwnedImpl()}; }
 
-// RawSlice is the same structure as evbuffer_iovec. This was put into place to avoid leaking
-// libevent into most code since we will likely replace evbuffer with our own implementation at
-// some point. However, we can avoid a bunch of copies since the structure is the same.
-static_assert(sizeof(RawSlice) == sizeof(evbuffer_iovec), "RawSlice != evbuffer_iovec");
-static_assert(offsetof(RawSlice, mem_) == offsetof(evbuffer_iovec, iov_base),
-              "RawSlice != evbuffer_iovec");
-static_assert(offsetof(RawSlice, len_) == offsetof(evbuffer_iovec, iov_len),
-              "RawSlice != evbuffer_iovec");
+void OwnedImpl::add(const void* data, uint64_t size) {
+  const uint8_t* src = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    if (slices_.empty() || slices_.back().reservableSize() == 0) {
+      // Only the first slice is sized to fit the data. A buffer that has already filled a slice is
+      // likely to keep growing.
+      const uint64_t capacity =
+          slices_.empty() ? std::min(size, Slice::DEFAULT_SIZE) : Slice::DEFAULT_SIZE;
+      slices_.emplace_back(Slice::create(capacity));
+    }
 
-void OwnedImpl::add(const void* data, uint64_t size) { evbuffer_add(buffer_.get(), data, size); }
+    const uint64_t copied = slices_.back().append(src, size);
+    src += copied;
+    size -= copied;
+    length_ += copied;
+  }
+}
 
-void OwnedImpl::add(const std::string& data) {
-  evbuffer_add(buffer_.get(), data.c_str(), data.size());
+void OwnedImpl::addBufferFragment(BufferFragment& fragment) {
+  if (fragment.size() == 0) {
+    fragment.done();
+    return;
+  }
+
+  length_ += fragment.size();
+  slices_.emplace_back(Slice::fromFragment(fragment));
 }
 
+void OwnedImpl::add(const std::string& data) { add(data.c_str(), data.size()); }
+
 void OwnedImpl::add(const Instance& data) {
   uint64_t num_slices = data.getRawSlices(nullptr, 0);
   RawSlice slices[num_slices];
@@ -37,76 +308,496 @@ void OwnedImpl::add(const Instance& data) {
 }
 
 void OwnedImpl::commit(RawSlice* iovecs, uint64_t num_iovecs) {
-  int rc =
-      evbuffer_commit_space(buffer_.get(), reinterpret_cast<evbuffer_iovec*>(iovecs), num_iovecs);
-  ASSERT(rc == 0);
-  UNREFERENCED_PARAMETER(rc);
+  // The iovecs are either the space at the end of the last slice or slices from the reservation,
+  // in the order reserve() handed them out.
+  uint64_t next_reserved = 0;
+  for (uint64_t i = 0; i < num_iovecs; i++) {
+    if (iovecs[i].len_ == 0) {
+      continue;
+    }
+
+    if (!slices_.empty() && slices_.back().reservable() == iovecs[i].mem_) {
+      ASSERT(iovecs[i].len_ <= slices_.back().reservableSize());
+      slices_.back().commit(iovecs[i].len_);
+      length_ += iovecs[i].len_;
+      continue;
+    }
+
+    while (next_reserved < reservation_.size() &&
+           reservation_[next_reserved].reservable() != iovecs[i].mem_) {
+      next_reserved++;
+    }
+
+    ASSERT(next_reserved < reservation_.size());
+    if (next_reserved == reservation_.size()) {
+      continue;
+    }
+
+    Slice& slice = reservation_[next_reserved++];
+    ASSERT(iovecs[i].len_ <= slice.reservableSize());
+    slice.commit(iovecs[i].len_);
+    length_ += iovecs[i].len_;
+    slices_.emplace_back(std::move(slice));
+  }
+
+  reservation_.clear();
 }
 
 void OwnedImpl::drain(uint64_t size) {
-  ASSERT(size <= length());
-  int rc = evbuffer_drain(buffer_.get(), size);
-  ASSERT(rc == 0);
-  UNREFERENCED_PARAMETER(rc);
+  ASSERT(size <= length_);
+  length_ -= size;
+  while (size > 0) {
+    Slice& front = slices_.front();
+    if (front.dataSize() > size) {
+      front.drain(size);
+      return;
+    }
+
+    size -= front.dataSize();
+    slices_.pop_front();
+  }
 }
 
 uint64_t OwnedImpl::getRawSlices(RawSlice* out, uint64_t out_size) const {
-  return evbuffer_peek(buffer_.get(), -1, nullptr, reinterpret_cast<evbuffer_iovec*>(out),
-                       out_size);
-}
+  const uint64_t num_slices = std::min<uint64_t>(slices_.size(), out_size);
+  for (uint64_t i = 0; i < num_slices; i++) {
+    out[i].mem_ = const_cast<uint8_t*>(slices_[i].data());
+    out[i].len_ = slices_[i].dataSize();
+  }
 
-uint64_t OwnedImpl::length() const { return evbuffer_get_length(buffer_.get()); }
+  return slices_.size();
+}
 
 void* OwnedImpl::linearize(uint32_t size) {
-  ASSERT(size <= length());
-  return evbuffer_pullup(buffer_.get(), size);
+  ASSERT(size <= length_);
+  if (slices_.empty()) {
+    return nullptr;
+  }
+
+  if (slices_.front().dataSize() < size) {
+    Slice linear = Slice::create(size);
+    while (linear.dataSize() < size) {
+      Slice& front = slices_.front();
+      const uint64_t copy_size = std::min<uint64_t>(front.dataSize(), size - linear.dataSize());
+      linear.append(front.data(), copy_size);
+      front.drain(copy_size);
+      if (front.dataSize() == 0) {
+        slices_.pop_front();
+      }
+    }
+
+    slices_.emplace_front(std::move(linear));
+  }
+
+  return slices_.front().data();
+}
+
+void OwnedImpl::addShared(const Instance& data) {
+  // As in move(), the static cast gives access to the other slice chain. Only the reference
+  // counts of its blocks change, which a const buffer allows.
+  const OwnedImpl& other =
+      const_cast<LibEventInstance&>(static_cast<const LibEventInstance&>(data)).buffer();
+  for (const Slice& slice : other.slices_) {
+    if (slice.dataSize() > 0) {
+      slices_.emplace_back(slice.share());
+    }
+  }
+
+  length_ += other.length_;
 }
 
 void OwnedImpl::move(Instance& rhs) {
   // We do the static cast here because in practice we only have one buffer implementation right
-  // now and this is safe. Using the evbuffer move routines require having access to both evbuffers.
-  // This is a reasonable compromise in a high performance path where we want to maintain an
-  // abstraction in case we get rid of evbuffer later.
-  int rc = evbuffer_add_buffer(buffer_.get(), static_cast<LibEventInstance&>(rhs).buffer().get());
-  ASSERT(rc == 0);
-  UNREFERENCED_PARAMETER(rc);
+  // now and this is safe. Moving slices requires having access to both slice chains. This is a
+  // reasonable compromise in a high performance path where we want to maintain an abstraction.
+  OwnedImpl& other = static_cast<LibEventInstance&>(rhs).buffer();
+  if (slices_.empty()) {
+    slices_.swap(other.slices_);
+  } else {
+    for (Slice& slice : other.slices_) {
+      slices_.emplace_back(std::move(slice));
+    }
+    other.slices_.clear();
+  }
+
+  length_ += other.length_;
+  other.length_ = 0;
   static_cast<LibEventInstance&>(rhs).postProcess();
 }
 
 void OwnedImpl::move(Instance& rhs, uint64_t length) {
   // See move() above for why we do the static cast.
-  int rc = evbuffer_remove_buffer(static_cast<LibEventInstance&>(rhs).buffer().get(), buffer_.get(),
-                                  length);
-  ASSERT(static_cast<uint64_t>(rc) == length);
-  UNREFERENCED_PARAMETER(rc);
+  OwnedImpl& other = static_cast<LibEventInstance&>(rhs).buffer();
+  ASSERT(length <= other.length_);
+  other.length_ -= length;
+  length_ += length;
+  while (length > 0) {
+    Slice& front = other.slices_.front();
+    if (front.dataSize() > length) {
+      // Share the block rather than copying the front of the slice.
+      slices_.emplace_back(front.split(length));
+      break;
+    }
+
+    length -= front.dataSize();
+    slices_.emplace_back(std::move(front));
+    other.slices_.pop_front();
+  }
+
   static_cast<LibEventInstance&>(rhs).postProcess();
 }
 
 int OwnedImpl::read(int fd, uint64_t max_length) {
-  return evbuffer_read(buffer_.get(), fd, max_length);
+  if (max_length == 0) {
+    return 0;
+  }
+
+  // Two slices so that the remainder of the last slice is filled before a new one is started.
+  const uint64_t MaxSlices = 2;
+  RawSlice slices[MaxSlices];
+  const uint64_t num_slices = reserve(max_length, slices, MaxSlices);
+  const ssize_t rc = ::readv(fd, reinterpret_cast<iovec*>(slices), num_slices);
+  if (rc < 0) {
+    reservation_.clear();
+    return rc;
+  }
+
+  uint64_t remaining = rc;
+  for (uint64_t i = 0; i < num_slices; i++) {
+    slices[i].len_ = std::min(slices[i].len_, remaining);
+    remaining -= slices[i].len_;
+  }
+
+  commit(slices, num_slices);
+  return rc;
 }
 
 uint64_t OwnedImpl::reserve(uint64_t length, RawSlice* iovecs, uint64_t num_iovecs) {
-  uint64_t ret = evbuffer_reserve_space(buffer_.get(), length,
-                                        reinterpret_cast<evbuffer_iovec*>(iovecs), num_iovecs);
-  ASSERT(ret >= 1);
-  return ret;
+  ASSERT(num_iovecs > 0);
+  // Anything reserved earlier but never committed is given up.
+  reservation_.clear();
+
+  uint64_t reserved = 0;
+  uint64_t num_used = 0;
+  if (!slices_.empty()) {
+    // Use the space left at the end of the last slice first, unless it doesn't fit everything and
+    // would use up the only iovec.
+    Slice& back = slices_.back();
+    const uint64_t available = back.reservableSize();
+    if (available > 0 && (available >= length || num_iovecs > 1)) {
+      iovecs[num_used++] = {back.reservable(), available};
+      reserved += available;
+    }
+  }
+
+  while (reserved < length && num_used < num_iovecs) {
+    // The last iovec has to fit everything that is left.
+    const uint64_t remaining = length - reserved;
+    Slice slice = Slice::create(
+        num_used + 1 == num_iovecs ? remaining : std::min(remaining, Slice::DEFAULT_SIZE));
+    iovecs[num_used++] = {slice.reservable(), slice.reservableSize()};
+    reserved += slice.reservableSize();
+    reservation_.emplace_back(std::move(slice));
+  }
+
+  return num_used;
 }
 
+namespace {
+
+/**
+ * @return bool whether the data starting at an offset into a slice matches, following the data
+ *         into later slices as needed. The caller guarantees that enough data is left.
+ */
+bool matchesAt(const SliceDeque& slices, size_t slice_index, uint64_t offset, const uint8_t* data,
+               uint64_t size) {
+  while (size > 0) {
+    const Slice& slice = slices[slice_index++];
+    const uint64_t compare_size = std::min(size, slice.dataSize() - offset);
+    if (memcmp(slice.data() + offset, data, compare_size) != 0) {
+      return false;
+    }
+
+    data += compare_size;
+    size -= compare_size;
+    offset = 0;
+  }
+
+  return true;
+}
+
+// The number of first byte hits that don't match in a slice before search() switches to
+// findWithin().
+const uint32_t MAX_SEARCH_FALSE_HITS = 8;
+
+/**
+ * Find a needle of at least two bytes in contiguous memory. Candidates are positions where both the
+ * first and the last byte of the needle match, which rules out most false hits on the first byte
+ * alone, and are checked a whole vector at a time when possible.
+ * @return const uint8_t* the start of the first match in [begin, end) or nullptr.
+ */
+const uint8_t* findWithin(const uint8_t* begin, const uint8_t* end, const uint8_t* needle,
+                          uint64_t size) {
+  ASSERT(size >= 2);
+  const uint64_t last = size - 1;
+  // Matches have to start before limit to fit.
+  const uint8_t* limit = end - last;
+  const uint8_t* pos = begin;
+
+#if defined(__AVX2__)
+  const __m256i first_avx2 = _mm256_set1_epi8(needle[0]);
+  const __m256i last_avx2 = _mm256_set1_epi8(needle[last]);
+  for (; limit - pos >= 32; pos += 32) {
+    const __m256i first_matches = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos)), first_avx2);
+    const __m256i last_matches = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos + last)), last_avx2);
+    uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(first_matches, last_matches));
+    for (; mask != 0; mask &= mask - 1) {
+      const uint8_t* candidate = pos + __builtin_ctz(mask);
+      if (memcmp(candidate + 1, needle + 1, size - 2) == 0) {
+        return candidate;
+      }
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i first_sse2 = _mm_set1_epi8(needle[0]);
+  const __m128i last_sse2 = _mm_set1_epi8(needle[last]);
+  for (; limit - pos >= 16; pos += 16) {
+    const __m128i first_matches =
+        _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)), first_sse2);
+    const __m128i last_matches =
+        _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + last)), last_sse2);
+    uint32_t mask = _mm_movemask_epi8(_mm_and_si128(first_matches, last_matches));
+    for (; mask != 0; mask &= mask - 1) {
+      const uint8_t* candidate = pos + __builtin_ctz(mask);
+      if (memcmp(candidate + 1, needle + 1, size - 2) == 0) {
+        return candidate;
+      }
+    }
+  }
+#endif
+
+  for (; pos < limit; pos++) {
+    if (pos[0] == needle[0] && pos[last] == needle[last] &&
+        memcmp(pos + 1, needle + 1, size - 2) == 0) {
+      return pos;
+    }
+  }
+
+  return nullptr;
+}
+
+/**
+ * A set of bytes to scan for. Small sets, which covers scanning for delimiters such as CRLF, are
+ * compared against a whole vector of input at a time. Larger sets fall back to a table lookup per
+ * byte.
+ */
+class CharSet {
+public:
+  CharSet(const uint8_t* chars, uint64_t num_chars) : chars_(chars), num_chars_(num_chars) {
+    memset(table_, 0, sizeof(table_));
+    for (uint64_t i = 0; i < num_chars; i++) {
+      table_[chars[i]] = true;
+    }
+  }
+
+  /**
+   * @return const uint8_t* the first byte in [begin, end) that is in the set, or nullptr.
+   */
+  const uint8_t* find(const uint8_t* begin, const uint8_t* end) const {
+    if (num_chars_ == 1) {
+      return static_cast<const uint8_t*>(memchr(begin, chars_[0], end - begin));
+    }
+
+#if defined(__AVX2__)
+    if (num_chars_ <= MAX_VECTOR_CHARS) {
+      begin = findAvx2(begin, end);
+    }
+#endif
+#if defined(__SSE2__)
+    if (num_chars_ <= MAX_VECTOR_CHARS) {
+      begin = findSse2(begin, end);
+    }
+#endif
+
+    // The vector scans stop either on a byte in the set or at a tail shorter than a vector.
+    for (; begin < end; begin++) {
+      if (table_[*begin]) {
+        return begin;
+      }
+    }
+
+    return nullptr;
+  }
+
+private:
+  // Beyond this many bytes one compare per byte in the set costs more than the table lookup.
+  static const uint64_t MAX_VECTOR_CHARS = 4;
+
+#if defined(__AVX2__)
+  const uint8_t* findAvx2(const uint8_t* begin, const uint8_t* end) const {
+    __m256i needles[MAX_VECTOR_CHARS];
+    for (uint64_t i = 0; i < num_chars_; i++) {
+      needles[i] = _mm256_set1_epi8(chars_[i]);
+    }
+
+    for (; end - begin >= 32; begin += 32) {
+      const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+      __m256i matches = _mm256_cmpeq_epi8(input, needles[0]);
+      for (uint64_t i = 1; i < num_chars_; i++) {
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(input, needles[i]));
+      }
+
+      const uint32_t mask = _mm256_movemask_epi8(matches);
+      if (mask != 0) {
+        return begin + __builtin_ctz(mask);
+      }
+    }
+
+    return begin;
+  }
+#endif
+
+#if defined(__SSE2__)
+  const uint8_t* findSse2(const uint8_t* begin, const uint8_t* end) const {
+    __m128i needles[MAX_VECTOR_CHARS];
+    for (uint64_t i = 0; i < num_chars_; i++) {
+      needles[i] = _mm_set1_epi8(chars_[i]);
+    }
+
+    for (; end - begin >= 16; begin += 16) {
+      const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+      __m128i matches = _mm_cmpeq_epi8(input, needles[0]);
+      for (uint64_t i = 1; i < num_chars_; i++) {
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(input, needles[i]));
+      }
+
+      const uint32_t mask = _mm_movemask_epi8(matches);
+      if (mask != 0) {
+        return begin + __builtin_ctz(mask);
+      }
+    }
+
+    return begin;
+  }
+#endif
+
+  const uint8_t* chars_;
+  const uint64_t num_chars_;
+  bool table_[256];
+};
+
+} // namespace
+
 ssize_t OwnedImpl::search(const void* data, uint64_t size, size_t start) const {
-  evbuffer_ptr start_ptr;
-  if (-1 == evbuffer_ptr_set(buffer_.get(), &start_ptr, start, EVBUFFER_PTR_SET)) {
+  if (start > length_ || size > length_ - start) {
     return -1;
   }
 
-  evbuffer_ptr result_ptr =
-      evbuffer_search(buffer_.get(), static_cast<const char*>(data), size, &start_ptr);
-  return result_ptr.pos;
+  if (size == 0) {
+    return start;
+  }
+
+  const uint8_t* needle = static_cast<const uint8_t*>(data);
+  size_t slice_index = 0;
+  uint64_t slice_start = 0;
+  while (slice_start + slices_[slice_index].dataSize() <= start) {
+    slice_start += slices_[slice_index++].dataSize();
+  }
+
+  for (; slice_index < slices_.size(); slice_index++) {
+    const Slice& slice = slices_[slice_index];
+    const uint8_t* begin = slice.data();
+    const uint8_t* end = begin + slice.dataSize();
+    const uint8_t* pos = begin + (start > slice_start ? start - slice_start : 0);
+
+    // memchr() for the first byte of the needle is fastest as long as that byte is rare. Once it
+    // keeps producing false hits, let findWithin() find any match that lies entirely within the
+    // slice.
+    // Such a match starts before any match that crosses into the next slice, so only the tail of
+    // the slice is left to check afterwards.
+    uint32_t false_hits = 0;
+    while (pos < end) {
+      if (false_hits == MAX_SEARCH_FALSE_HITS && static_cast<uint64_t>(end - pos) >= size) {
+        const uint8_t* match = findWithin(pos, end, needle, size);
+        if (match) {
+          return slice_start + (match - begin);
+        }
+        pos = end - size + 1;
+      }
+
+      pos = static_cast<const uint8_t*>(memchr(pos, needle[0], end - pos));
+      if (!pos) {
+        break;
+      }
+
+      const uint64_t match_start = slice_start + (pos - begin);
+      if (size > length_ - match_start) {
+        return -1;
+      }
+
+      if (matchesAt(slices_, slice_index, pos - begin, needle, size)) {
+        return match_start;
+      }
+
+      pos++;
+      false_hits++;
+    }
+
+    slice_start += slice.dataSize();
+  }
+
+  return -1;
 }
 
-int OwnedImpl::write(int fd) { return evbuffer_write(buffer_.get(), fd); }
+ssize_t OwnedImpl::findFirstOf(const void* chars, uint64_t num_chars, size_t start) const {
+  if (start >= length_ || num_chars == 0) {
+    return -1;
+  }
+
+  const CharSet set(static_cast<const uint8_t*>(chars), num_chars);
+  uint64_t slice_start = 0;
+  for (const Slice& slice : slices_) {
+    const uint64_t slice_end = slice_start + slice.dataSize();
+    if (slice_end > start) {
+      const uint8_t* begin = slice.data();
+      const uint8_t* pos = begin + (start > slice_start ? start - slice_start : 0);
+      const uint8_t* match = set.find(pos, begin + slice.dataSize());
+      if (match) {
+        return slice_start + (match - begin);
+      }
+    }
+
+    slice_start = slice_end;
+  }
+
+  return -1;
+}
+
+void OwnedImpl::shrink() {
+  slices_.release();
+  std::vector<Slice>().swap(reservation_);
+}
+
+int OwnedImpl::write(int fd) {
+  const uint64_t MaxSlices = 64;
+  RawSlice slices[MaxSlices];
+  const uint64_t num_slices = std::min(getRawSlices(slices, MaxSlices), MaxSlices);
+  if (num_slices == 0) {
+    return 0;
+  }
+
+  const ssize_t rc = ::writev(fd, reinterpret_cast<iovec*>(slices), num_slices);
+  if (rc > 0) {
+    drain(rc);
+  }
+
+  return rc;
+}
 
-OwnedImpl::OwnedImpl() : buffer_(evbuffer_new()) {}
+OwnedImpl::OwnedImpl() {}
 
 OwnedImpl::OwnedImpl(const std::string& data) : OwnedImpl() { add(data); }
 
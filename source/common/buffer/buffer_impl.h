@@ -1,15 +1,238 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "envoy/buffer/buffer.h"
 
-#include "common/event/libevent.h"
+#include "common/common/non_copyable.h"
+#include "common/common/recycler.h"
 
 namespace Envoy {
 namespace Buffer {
 
+/**
+ * A contiguous range of buffer data inside a reference counted block of memory. Splitting a slice
+ * shares the block instead of copying the bytes, which is what lets a partial move() hand data
+ * to another buffer without a copy. Only the sole owner of a block may append to it, since the
+ * bytes past the end of a slice may belong to another slice that shares the same block.
+ *
+ * Blocks come in a few size classes and are recycled through a free list that is local to the
+ * thread that releases them, so steady state traffic on a worker does not go through malloc. A
+ * block can also wrap the memory of a BufferFragment, in which case it is never appended to and
+ * the fragment is released along with the block.
+ */
+class Slice {
+public:
+  // The size of the largest pooled block. Buffers that grow beyond one block are built out of
+  // blocks of this size.
+  static const uint64_t DEFAULT_SIZE = 16384;
+
+  // The number of free blocks of each size class that a thread keeps around for reuse.
+  static const uint64_t MAX_FREE_BLOCKS = 32;
+
+  /**
+   * @param min_capacity supplies the minimum number of bytes the slice must be able to hold.
+   * @return Slice a new empty slice. Requests up to DEFAULT_SIZE are rounded up to a pooled size
+   *         class, larger ones are allocated with exactly the requested capacity.
+   */
+  static Slice create(uint64_t min_capacity);
+
+  /**
+   * @param fragment supplies externally owned data, which must not be empty.
+   * @return Slice a slice holding the data of the fragment without copying it. done() is called on
+   *         the fragment once this slice and any slices split from it are released.
+   */
+  static Slice fromFragment(BufferFragment& fragment);
+
+  /**
+   * @return uint64_t the number of bytes in blocks currently held by slices across all threads,
+   *         not counting fragments or free blocks. Every thread keeps its own count so that
+   *         allocating never touches shared state; the counts are only summed up here.
+   */
+  static uint64_t allocatedBytes();
+
+  Slice(Slice&& rhs) noexcept;
+  Slice& operator=(Slice&& rhs) noexcept;
+  Slice(const Slice&) = delete;
+  Slice& operator=(const Slice&) = delete;
+  ~Slice() { release(); }
+
+  uint8_t* data() { return block_->data() + data_; }
+  const uint8_t* data() const { return block_->data() + data_; }
+  uint64_t dataSize() const { return reservable_ - data_; }
+
+  /**
+   * Remove bytes from the front of the slice.
+   * @param size supplies the number of bytes to remove, which must not exceed dataSize().
+   */
+  void drain(uint64_t size) { data_ += size; }
+
+  /**
+   * @return uint8_t* the first byte past the end of the data, where new data can be written.
+   */
+  uint8_t* reservable() { return block_->data() + reservable_; }
+
+  /**
+   * @return uint64_t the number of bytes that can be written at reservable(). This is 0 if the
+   *         block is shared with another slice.
+   */
+  uint64_t reservableSize() const {
+    return block_->refs_.load(std::memory_order_acquire) == 1 ? block_->capacity_ - reservable_
+                                                              : 0;
+  }
+
+  /**
+   * Make bytes previously written at reservable() part of the data.
+   * @param size supplies the number of bytes, which must not exceed reservableSize().
+   */
+  void commit(uint64_t size) { reservable_ += size; }
+
+  /**
+   * Copy as much data as fits into the reservable space.
+   * @param data supplies the data to copy.
+   * @param size supplies the size of the data.
+   * @return uint64_t the number of bytes copied.
+   */
+  uint64_t append(const void* data, uint64_t size);
+
+  /**
+   * Split off the front of the slice without copying. Both slices share the block afterwards, so
+   * neither can be appended to until the other is released.
+   * @param size supplies the number of bytes to split off, which must not exceed dataSize().
+   * @return Slice a slice holding the first size bytes, which are drained from this slice.
+   */
+  Slice split(uint64_t size);
+
+  /**
+   * Reference the data of the slice without copying it. Both slices share the block afterwards,
+   * so neither can be appended to until the other is released.
+   * @return Slice a slice holding the same bytes as this slice.
+   */
+  Slice share() const;
+
+private:
+  struct Block {
+    uint8_t* data() { return base_; }
+
+    // Either the memory right after the block or the data of fragment_.
+    uint8_t* base_;
+    BufferFragment* fragment_;
+    std::atomic<uint32_t> refs_;
+    // Index into the size classes, or one past the last size class for blocks that are not pooled.
+    uint32_t size_class_;
+    uint64_t capacity_;
+  };
+
+  Slice(Block* block, uint64_t data, uint64_t reservable)
+      : block_(block), data_(data), reservable_(reservable) {}
+
+  void release();
+
+  static void freeBlock(Block* block);
+
+  Block* block_;
+  // Offsets of the first byte of data and the first reservable byte into the block.
+  uint64_t data_;
+  uint64_t reservable_;
+
+  friend class SlicePool;
+};
+
+/**
+ * A deque of slices that only allocates storage once a slice is added. An empty std::deque still
+ * owns a map and a block of elements, which adds up over the mostly empty buffers of many idle
+ * connections. The storage is kept while the deque is in use and is freed by release().
+ */
+class SliceDeque {
+public:
+  typedef std::deque<Slice>::iterator iterator;
+  typedef std::deque<Slice>::const_iterator const_iterator;
+
+  bool empty() const { return slices_ == nullptr || slices_->empty(); }
+  size_t size() const { return slices_ == nullptr ? 0 : slices_->size(); }
+
+  Slice& front() { return slices_->front(); }
+  Slice& back() { return slices_->back(); }
+  Slice& operator[](size_t index) { return (*slices_)[index]; }
+  const Slice& operator[](size_t index) const { return (*slices_)[index]; }
+
+  // Value initialized iterators compare equal, so a deque without storage iterates over nothing.
+  iterator begin() { return slices_ == nullptr ? iterator() : slices_->begin(); }
+  iterator end() { return slices_ == nullptr ? iterator() : slices_->end(); }
+  const_iterator begin() const { return slices_ == nullptr ? const_iterator() : slices_->begin(); }
+  const_iterator end() const { return slices_ == nullptr ? const_iterator() : slices_->end(); }
+
+  void emplace_back(Slice&& slice) { storage().emplace_back(std::move(slice)); }
+  void emplace_front(Slice&& slice) { storage().emplace_front(std::move(slice)); }
+  void pop_front() { slices_->pop_front(); }
+  void clear() {
+    if (slices_ != nullptr) {
+      slices_->clear();
+    }
+  }
+  void swap(SliceDeque& other) { slices_.swap(other.slices_); }
+
+  /**
+   * Free the storage of the deque if it is empty.
+   */
+  void release() {
+    if (empty()) {
+      slices_.reset();
+    }
+  }
+
+private:
+  std::deque<Slice>& storage() {
+    if (slices_ == nullptr) {
+      slices_.reset(new std::deque<Slice>());
+    }
+    return *slices_;
+  }
+
+  std::unique_ptr<std::deque<Slice>> slices_;
+};
+
+/**
+ * A BufferFragment that calls a releasor once the buffer is done with the data.
+ */
+class BufferFragmentImpl : NonCopyable, public BufferFragment {
+public:
+  /**
+   * Called once the data is no longer referenced. Typically frees the data and the fragment.
+   */
+  typedef std::function<void(const void*, size_t, const BufferFragmentImpl*)> Releasor;
+
+  /**
+   * @param data supplies the externally owned data.
+   * @param size supplies the size of the data.
+   * @param releasor supplies the releasor, which may be empty if the data outlives the buffer.
+   */
+  BufferFragmentImpl(const void* data, size_t size, Releasor releasor)
+      : data_(data), size_(size), releasor_(releasor) {}
+
+  // Buffer::BufferFragment
+  const void* data() const override { return data_; }
+  size_t size() const override { return size_; }
+  void done() override {
+    if (releasor_) {
+      releasor_(data_, size_, this);
+    }
+  }
+
+private:
+  const void* const data_;
+  const size_t size_;
+  const Releasor releasor_;
+};
+
+class OwnedImpl;
+
 class OwnedImplFactory : public Factory {
 public:
   // Buffer::Factory
@@ -19,18 +242,18 @@ public:
 class LibEventInstance : public Instance {
 public:
   // Allows access into the underlying buffer for move() optimizations.
-  virtual Event::Libevent::BufferPtr& buffer() PURE;
+  virtual OwnedImpl& buffer() PURE;
   // Called after accessing the memory in buffer() directly to allow any post-processing.
   virtual void postProcess() PURE;
 };
 
 /**
- * Wraps an allocated and owned evbuffer.
+ * A buffer built out of a chain of pooled slices.
  *
  * Note that due to the internals of move() accessing buffer(), OwnedImpl is not
  * compatible with non-LibEventInstance buffers.
  */
-class OwnedImpl : public LibEventInstance {
+class OwnedImpl : public LibEventInstance, public Recycled {
 public:
   OwnedImpl();
   OwnedImpl(const std::string& data);
@@ -39,25 +262,40 @@ public:
 
   // LibEventInstance
   void add(const void* data, uint64_t size) override;
+  void addBufferFragment(BufferFragment& fragment) override;
   void add(const std::string& data) override;
   void add(const Instance& data) override;
   void commit(RawSlice* iovecs, uint64_t num_iovecs) override;
   void drain(uint64_t size) override;
   uint64_t getRawSlices(RawSlice* out, uint64_t out_size) const override;
-  uint64_t length() const override;
+  uint64_t length() const override { return length_; }
   void* linearize(uint32_t size) override;
   void move(Instance& rhs) override;
   void move(Instance& rhs, uint64_t length) override;
   int read(int fd, uint64_t max_length) override;
   uint64_t reserve(uint64_t length, RawSlice* iovecs, uint64_t num_iovecs) override;
   ssize_t search(const void* data, uint64_t size, size_t start) const override;
+  ssize_t findFirstOf(const void* chars, uint64_t num_chars, size_t start) const override;
+  void shrink() override;
   int write(int fd) override;
   void postProcess() override {}
 
-  Event::Libevent::BufferPtr& buffer() override { return buffer_; }
+  OwnedImpl& buffer() override { return *this; }
+
+  /**
+   * Append the data of another buffer by sharing its slices instead of copying them, like a
+   * partial move() that leaves the data in place. Neither buffer appends to the shared slices
+   * afterwards. The other buffer must be a LibEventInstance.
+   * @param data supplies the buffer to reference.
+   */
+  void addShared(const Instance& data);
 
 private:
-  Event::Libevent::BufferPtr buffer_;
+  // Slices holding data, in order. Only the last slice is ever appended to.
+  SliceDeque slices_;
+  // Slices handed out by the last reserve() that have not been committed yet.
+  std::vector<Slice> reservation_;
+  uint64_t length_{};
 };
 
 } // namespace Buffer
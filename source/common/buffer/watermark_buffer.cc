@@ -10,6 +10,11 @@ void WatermarkBuffer::add(const void* data, uint64_t size) {
   checkHighWatermark();
 }
 
+void WatermarkBuffer::addBufferFragment(BufferFragment& fragment) {
+  wrapped_buffer_->addBufferFragment(fragment);
+  checkHighWatermark();
+}
+
 void WatermarkBuffer::add(const std::string& data) {
   wrapped_buffer_->add(data);
   checkHighWatermark();
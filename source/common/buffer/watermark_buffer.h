@@ -31,6 +31,7 @@ public:
 
   // Instance
   void add(const void* data, uint64_t size) override;
+  void addBufferFragment(BufferFragment& fragment) override;
   void add(const std::string& data) override;
   void add(const Instance& data) override;
   void commit(RawSlice* iovecs, uint64_t num_iovecs) override;
@@ -47,10 +48,12 @@ public:
   ssize_t search(const void* data, uint64_t size, size_t start) const override {
     return wrapped_buffer_->search(data, size, start);
   }
-  int write(int fd) override;
-  Event::Libevent::BufferPtr& buffer() override {
-    return static_cast<LibEventInstance&>(*wrapped_buffer_).buffer();
+  ssize_t findFirstOf(const void* chars, uint64_t num_chars, size_t start) const override {
+    return wrapped_buffer_->findFirstOf(chars, num_chars, start);
   }
+  void shrink() override { wrapped_buffer_->shrink(); }
+  int write(int fd) override;
+  OwnedImpl& buffer() override { return static_cast<LibEventInstance&>(*wrapped_buffer_).buffer(); }
   void postProcess() override { checkLowWatermark(); }
 
   void setWatermarks(uint32_t watermark) {
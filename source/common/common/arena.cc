@@ -0,0 +1,129 @@
+#include "common/common/arena.h"
+
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+
+const uint64_t Arena::BLOCK_SIZE;
+const uint64_t Arena::MAX_FREE_BLOCKS;
+
+namespace {
+
+/**
+ * Per thread free list of BLOCK_SIZE blocks. Blocks are returned to the list of the thread that
+ * destroys the arena, which is almost always the thread that created it.
+ */
+class ArenaBlockPool {
+public:
+  ~ArenaBlockPool() {
+    for (void* block : free_blocks_) {
+      ::operator delete(block);
+    }
+    destroyed_ = true;
+  }
+
+  /**
+   * @return ArenaBlockPool* the pool of the calling thread, or nullptr if the thread is exiting and
+   *         its pool has already been destroyed.
+   */
+  static ArenaBlockPool* get() {
+    if (destroyed_) {
+      return nullptr;
+    }
+
+    static thread_local ArenaBlockPool pool;
+    return &pool;
+  }
+
+  void* take() {
+    if (free_blocks_.empty()) {
+      return ::operator new(Arena::BLOCK_SIZE);
+    }
+
+    void* block = free_blocks_.back();
+    free_blocks_.pop_back();
+    return block;
+  }
+
+  void give(void* block) {
+    if (free_blocks_.size() >= Arena::MAX_FREE_BLOCKS) {
+      ::operator delete(block);
+      return;
+    }
+
+    free_blocks_.push_back(block);
+  }
+
+private:
+  static thread_local bool destroyed_;
+  std::vector<void*> free_blocks_;
+};
+
+thread_local bool ArenaBlockPool::destroyed_ = false;
+
+} // namespace
+
+Arena::~Arena() {
+  while (destructors_) {
+    Destructor* destructor = destructors_;
+    destructors_ = destructor->next_;
+    destructor->destroy_(destructor->object_);
+  }
+
+  ArenaBlockPool* pool = ArenaBlockPool::get();
+  while (blocks_) {
+    Block* block = blocks_;
+    blocks_ = block->next_;
+    if (block->size_ == BLOCK_SIZE && pool) {
+      pool->give(block);
+    } else {
+      ::operator delete(block);
+    }
+  }
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+  ASSERT((alignment & (alignment - 1)) == 0);
+  const uintptr_t aligned =
+      (reinterpret_cast<uintptr_t>(next_) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+  if (next_ && aligned + size <= reinterpret_cast<uintptr_t>(end_)) {
+    next_ = reinterpret_cast<uint8_t*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  return allocateSlow(size, alignment);
+}
+
+void* Arena::allocateSlow(size_t size, size_t alignment) {
+  // Block headers keep the data that follows them aligned for anything but over-aligned types.
+  static_assert(sizeof(Block) % alignof(std::max_align_t) == 0, "unaligned arena block data");
+  const uint64_t padding = alignment > alignof(std::max_align_t) ? alignment : 0;
+  const uint64_t needed = sizeof(Block) + size + padding;
+  Block* block;
+  if (needed > BLOCK_SIZE) {
+    // Too big to share a block. It gets one of its own and the current block stays in use.
+    block = static_cast<Block*>(::operator new(needed));
+    block->size_ = needed;
+    block->next_ = blocks_;
+    blocks_ = block;
+    reserved_bytes_ += needed;
+    const uintptr_t start = reinterpret_cast<uintptr_t>(data(*block));
+    return reinterpret_cast<void*>((start + alignment - 1) & ~(uintptr_t(alignment) - 1));
+  }
+
+  ArenaBlockPool* pool = ArenaBlockPool::get();
+  block = static_cast<Block*>(pool ? pool->take() : ::operator new(BLOCK_SIZE));
+  block->size_ = BLOCK_SIZE;
+  block->next_ = blocks_;
+  blocks_ = block;
+  reserved_bytes_ += BLOCK_SIZE;
+  next_ = data(*block);
+  end_ = reinterpret_cast<uint8_t*>(block) + BLOCK_SIZE;
+  return allocate(size, alignment);
+}
+
+} // namespace Envoy
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "common/common/non_copyable.h"
+
+namespace Envoy {
+
+/**
+ * A bump allocator for objects that all go away at the same time, such as the state of a single
+ * HTTP stream. Memory is carved out of fixed size blocks and is only given back when the arena is
+ * destroyed, in one go. Blocks are recycled through a per thread free list, so an arena that lives
+ * and dies on one worker does not touch the general purpose allocator in the steady state.
+ *
+ * Objects made with create() are destroyed along with the arena, newest first. An arena is not
+ * thread safe.
+ */
+class Arena : NonCopyable {
+public:
+  static const uint64_t BLOCK_SIZE = 4096;
+  // The number of free blocks that each thread keeps around for reuse.
+  static const uint64_t MAX_FREE_BLOCKS = 256;
+
+  Arena() {}
+  ~Arena();
+
+  /**
+   * Allocate memory that lives as long as the arena.
+   * @param size supplies the number of bytes to allocate.
+   * @param alignment supplies the alignment of the memory. Must be a power of two.
+   * @return void* the memory.
+   */
+  void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  /**
+   * Construct an object in the arena. It is destroyed when the arena is.
+   * @return T* the new object.
+   */
+  template <class T, class... Args> T* create(Args&&... args) {
+    // Make room to remember the destructor first so that it cannot fail once the object exists.
+    Destructor* destructor = nullptr;
+    if (!std::is_trivially_destructible<T>::value) {
+      destructor = static_cast<Destructor*>(allocate(sizeof(Destructor), alignof(Destructor)));
+    }
+
+    T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if (destructor) {
+      destructor->destroy_ = &destroy<T>;
+      destructor->object_ = object;
+      destructor->next_ = destructors_;
+      destructors_ = destructor;
+    }
+
+    return object;
+  }
+
+  /**
+   * @return uint64_t the number of bytes taken from the system for this arena.
+   */
+  uint64_t reservedBytes() const { return reserved_bytes_; }
+
+private:
+  struct Block {
+    Block* next_;
+    uint64_t size_;
+  };
+
+  struct Destructor {
+    void (*destroy_)(void*);
+    void* object_;
+    Destructor* next_;
+  };
+
+  template <class T> static void destroy(void* object) { static_cast<T*>(object)->~T(); }
+
+  static uint8_t* data(Block& block) { return reinterpret_cast<uint8_t*>(&block + 1); }
+  void* allocateSlow(size_t size, size_t alignment);
+
+  Block* blocks_{};
+  Destructor* destructors_{};
+  uint8_t* next_{};
+  uint8_t* end_{};
+  uint64_t reserved_bytes_{};
+};
+
+/**
+ * An STL allocator that takes memory from an arena. Memory is never given back before the arena
+ * goes away, so containers using it should be sized up front where possible.
+ */
+template <class T> class ArenaAllocator {
+public:
+  typedef T value_type;
+
+  ArenaAllocator(Arena& arena) : arena_(&arena) {}
+  template <class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T))); }
+  void deallocate(T*, size_t) {}
+
+  template <class U> bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena_;
+  }
+  template <class U> bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena_;
+  }
+
+private:
+  template <class U> friend class ArenaAllocator;
+
+  Arena* arena_;
+};
+
+} // namespace Envoy
@@ -102,34 +102,34 @@ std::string Base64::decode(const std::string& input) {
   return result;
 }
 
-void Base64::encodeBase(const uint8_t cur_char, uint64_t pos, uint8_t& next_c, std::string& ret) {
+void Base64::encodeBase(const uint8_t cur_char, uint64_t pos, uint8_t& next_c, char*& out) {
   switch (pos % 3) {
   case 0:
-    ret.push_back(CHAR_TABLE[cur_char >> 2]);
+    *out++ = CHAR_TABLE[cur_char >> 2];
     next_c = (cur_char & 0x03) << 4;
     break;
   case 1:
-    ret.push_back(CHAR_TABLE[next_c | (cur_char >> 4)]);
+    *out++ = CHAR_TABLE[next_c | (cur_char >> 4)];
     next_c = (cur_char & 0x0f) << 2;
     break;
   case 2:
-    ret.push_back(CHAR_TABLE[next_c | (cur_char >> 6)]);
-    ret.push_back(CHAR_TABLE[cur_char & 0x3f]);
+    *out++ = CHAR_TABLE[next_c | (cur_char >> 6)];
+    *out++ = CHAR_TABLE[cur_char & 0x3f];
     next_c = 0;
     break;
   }
 }
 
-void Base64::encodeLast(uint64_t pos, uint8_t last_char, std::string& ret) {
+void Base64::encodeLast(uint64_t pos, uint8_t last_char, char*& out) {
   switch (pos % 3) {
   case 1:
-    ret.push_back(CHAR_TABLE[last_char]);
-    ret.push_back('=');
-    ret.push_back('=');
+    *out++ = CHAR_TABLE[last_char];
+    *out++ = '=';
+    *out++ = '=';
     break;
   case 2:
-    ret.push_back(CHAR_TABLE[last_char]);
-    ret.push_back('=');
+    *out++ = CHAR_TABLE[last_char];
+    *out++ = '=';
     break;
   default:
     break;
@@ -137,9 +137,9 @@ void Base64::encodeLast(uint64_t pos, uint8_t last_char, std::string& ret) {
 }
 
 std::string Base64::encode(const Buffer::Instance& buffer, uint64_t length) {
-  uint64_t output_length = (std::min(length, buffer.length()) + 2) / 3 * 4;
-  std::string ret;
-  ret.reserve(output_length);
+  length = std::min(length, buffer.length());
+  std::string ret((length + 2) / 3 * 4, '\0');
+  char* out = &ret[0];
 
   uint64_t num_slices = buffer.getRawSlices(nullptr, 0);
   Buffer::RawSlice slices[num_slices];
@@ -151,7 +151,7 @@ std::string Base64::encode(const Buffer::Instance& buffer, uint64_t length) {
     const uint8_t* slice_mem = static_cast<const uint8_t*>(slice.mem_);
 
     for (uint64_t i = 0; i < slice.len_ && j < length; ++i, ++j) {
-      encodeBase(slice_mem[i], j, next_c, ret);
+      encodeBase(slice_mem[i], j, next_c, out);
     }
 
     if (j == length) {
@@ -159,25 +159,147 @@ std::string Base64::encode(const Buffer::Instance& buffer, uint64_t length) {
     }
   }
 
-  encodeLast(j, next_c, ret);
+  encodeLast(j, next_c, out);
 
   return ret;
 }
 
 std::string Base64::encode(const char* input, uint64_t length) {
-  uint64_t output_length = (length + 2) / 3 * 4;
-  std::string ret;
-  ret.reserve(output_length);
+  std::string ret((length + 2) / 3 * 4, '\0');
+  char* out = &ret[0];
 
   uint64_t pos = 0;
   uint8_t next_c = 0;
 
   for (uint64_t i = 0; i < length; ++i) {
-    encodeBase(input[i], pos++, next_c, ret);
+    encodeBase(input[i], pos++, next_c, out);
   }
 
-  encodeLast(pos, next_c, ret);
+  encodeLast(pos, next_c, out);
 
   return ret;
 }
+
+void Base64::encode(const Buffer::Instance& buffer, Buffer::Instance& output) {
+  const uint64_t length = buffer.length();
+  if (length == 0) {
+    return;
+  }
+
+  // Reserve the whole encoded length as one iovec, so characters are written in place.
+  Buffer::RawSlice iovec;
+  output.reserve((length + 2) / 3 * 4, &iovec, 1);
+  char* const start = static_cast<char*>(iovec.mem_);
+  char* out = start;
+
+  uint64_t num_slices = buffer.getRawSlices(nullptr, 0);
+  Buffer::RawSlice slices[num_slices];
+  buffer.getRawSlices(slices, num_slices);
+
+  uint64_t pos = 0;
+  uint8_t next_c = 0;
+  for (Buffer::RawSlice& slice : slices) {
+    const uint8_t* slice_mem = static_cast<const uint8_t*>(slice.mem_);
+    for (uint64_t i = 0; i < slice.len_; ++i) {
+      encodeBase(slice_mem[i], pos++, next_c, out);
+    }
+  }
+
+  encodeLast(pos, next_c, out);
+
+  iovec.len_ = out - start;
+  output.commit(&iovec, 1);
+}
+
+bool Base64StreamDecoder::decode(const Buffer::Instance& input, Buffer::Instance& output) {
+  const uint64_t length = input.length();
+  if (length == 0) {
+    return true;
+  }
+
+  // Every quantum completed by this call decodes to at most 3 bytes.
+  Buffer::RawSlice iovec;
+  output.reserve((pending_length_ + length) / 4 * 3 + 3, &iovec, 1);
+  uint8_t* const start = static_cast<uint8_t*>(iovec.mem_);
+  uint8_t* out = start;
+
+  uint64_t num_slices = input.getRawSlices(nullptr, 0);
+  Buffer::RawSlice slices[num_slices];
+  input.getRawSlices(slices, num_slices);
+
+  bool valid = true;
+  for (uint64_t s = 0; s < num_slices && valid; s++) {
+    const uint8_t* slice_mem = static_cast<const uint8_t*>(slices[s].mem_);
+    const uint8_t* const slice_end = slice_mem + slices[s].len_;
+    while (slice_mem < slice_end) {
+      // Whole quanta of a slice that contain no padding decode without going through pending_.
+      while (pending_length_ == 0 && slice_end - slice_mem >= 4) {
+        const uint8_t a = REVERSE_LOOKUP_TABLE[slice_mem[0]];
+        const uint8_t b = REVERSE_LOOKUP_TABLE[slice_mem[1]];
+        const uint8_t c = REVERSE_LOOKUP_TABLE[slice_mem[2]];
+        const uint8_t d = REVERSE_LOOKUP_TABLE[slice_mem[3]];
+        if ((a | b | c | d) & 64) {
+          break;
+        }
+        *out++ = a << 2 | b >> 4;
+        *out++ = b << 4 | c >> 2;
+        *out++ = c << 6 | d;
+        slice_mem += 4;
+      }
+      if (slice_mem == slice_end) {
+        break;
+      }
+
+      const uint8_t value = REVERSE_LOOKUP_TABLE[*slice_mem];
+      if (value == 64 && *slice_mem != '=') {
+        // Input contains an invalid character.
+        valid = false;
+        break;
+      }
+      pending_[pending_length_++] = value;
+      slice_mem++;
+      if (pending_length_ == 4 && !decodeQuantum(out)) {
+        valid = false;
+        break;
+      }
+    }
+  }
+
+  iovec.len_ = out - start;
+  output.commit(&iovec, 1);
+  return valid;
+}
+
+bool Base64StreamDecoder::decodeQuantum(uint8_t*& out) {
+  pending_length_ = 0;
+  const uint8_t a = pending_[0];
+  const uint8_t b = pending_[1];
+  const uint8_t c = pending_[2];
+  const uint8_t d = pending_[3];
+
+  // At most the last two characters can be '=', and there must be no unused bits before them.
+  if (a == 64 || b == 64) {
+    return false;
+  }
+  if (c == 64) {
+    if (d != 64 || (b & 0b1111)) {
+      return false;
+    }
+    *out++ = a << 2 | b >> 4;
+    return true;
+  }
+  if (d == 64) {
+    if (c & 0b11) {
+      return false;
+    }
+    *out++ = a << 2 | b >> 4;
+    *out++ = b << 4 | c >> 2;
+    return true;
+  }
+
+  *out++ = a << 2 | b >> 4;
+  *out++ = b << 4 | c >> 2;
+  *out++ = c << 6 | d;
+  return true;
+}
 } // namespace Envoy
@@ -22,6 +22,14 @@ public:
    */
   static std::string encode(const char* input, uint64_t length);
 
+  /**
+   * Base64 encode an input buffer, appending the result to an output buffer without an
+   * intermediate string.
+   * @param buffer supplies the buffer to encode.
+   * @param output supplies the buffer the encoded characters are appended to.
+   */
+  static void encode(const Buffer::Instance& buffer, Buffer::Instance& output);
+
   /**
    * Base64 decode an input string.
    * @param input supplies the input to decode.
@@ -35,12 +43,41 @@ private:
   /**
    * Helper method for encoding. This is used to encode all of the characters from the input string.
    */
-  static void encodeBase(const uint8_t cur_char, uint64_t pos, uint8_t& next_c, std::string& ret);
+  static void encodeBase(const uint8_t cur_char, uint64_t pos, uint8_t& next_c, char*& out);
 
   /**
-   * Encode last characters. It appends '=' chars to the ret if input
+   * Encode last characters. It appends '=' chars to the out if input
    * string length is not divisible by 3.
    */
-  static void encodeLast(uint64_t pos, uint8_t last_char, std::string& ret);
+  static void encodeLast(uint64_t pos, uint8_t last_char, char*& out);
+};
+
+/**
+ * Base64 decoder for input that arrives in pieces, such as the body of a gRPC-web text request.
+ * The characters of an incomplete quantum are kept until the next call, so the caller needs no
+ * buffering of its own. A padded quantum ends one encoded string and the next character starts
+ * another, so concatenated base64 strings decode to the concatenation of their contents.
+ */
+class Base64StreamDecoder {
+public:
+  /**
+   * Decode an input buffer slice by slice, appending the result to an output buffer.
+   * @param input supplies the buffer to decode. It is not drained.
+   * @param output supplies the buffer the decoded bytes are appended to.
+   * @return bool false if the input is not valid base64. The decoder must not be used again.
+   */
+  bool decode(const Buffer::Instance& input, Buffer::Instance& output);
+
+  /**
+   * @return uint32_t the number of characters waiting for the rest of their quantum.
+   */
+  uint32_t pending() const { return pending_length_; }
+
+private:
+  bool decodeQuantum(uint8_t*& out);
+
+  // Decoded values of the characters seen so far of the current quantum, 64 for padding.
+  uint8_t pending_[4];
+  uint32_t pending_length_{0};
 };
 } // namespace Envoy
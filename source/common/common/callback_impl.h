@@ -41,6 +41,11 @@ public:
     }
   }
 
+  /**
+   * @return size_t the number of registered callbacks.
+   */
+  size_t size() const { return callbacks_.size(); }
+
 private:
   struct CallbackHolder : public CallbackHandle {
     CallbackHolder(CallbackManager& parent, Callback cb) : parent_(parent), cb_(cb) {}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "xxhash.h"
+
+namespace Envoy {
+
+/**
+ * Stable hash functions. Unlike std::hash, these give the same result with any standard library,
+ * so they are safe to use for anything that has to agree across builds, such as consistent hashing.
+ */
+class HashUtil final {
+public:
+  /**
+   * Return 64-bit hash from the xxHash algorithm.
+   * @param data supplies the data to hash.
+   * @param length supplies the length of the data.
+   * @param seed supplies the hash seed which defaults to 0.
+   * @return 64-bit hash of the data.
+   */
+  static uint64_t xxHash64(const void* data, size_t length, uint64_t seed = 0) {
+    return XXH64(data, length, seed);
+  }
+
+  /**
+   * Return 64-bit hash from the xxHash algorithm.
+   * @param input supplies the string to hash.
+   * @param seed supplies the hash seed which defaults to 0.
+   * @return 64-bit hash of the string.
+   */
+  static uint64_t xxHash64(const std::string& input, uint64_t seed = 0) {
+    return xxHash64(input.data(), input.size(), seed);
+  }
+};
+
+} // namespace Envoy
@@ -2,7 +2,9 @@
 
 #include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "envoy/thread/thread.h"
@@ -26,16 +28,111 @@ std::vector<Logger>& Registry::allLoggers() {
   return *all_loggers;
 }
 
+LockingStderrSink::~LockingStderrSink() { setAsync(0); }
+
+void LockingStderrSink::setAsync(uint64_t max_queued) {
+  std::unique_ptr<std::thread> writer;
+  {
+    std::unique_lock<std::mutex> queue_lock(queue_lock_);
+    if (max_queued > 0) {
+      max_queued_ = max_queued;
+      if (!writer_) {
+        stop_ = false;
+        writer_.reset(new std::thread([this]() -> void { writerLoop(); }));
+      }
+      return;
+    }
+
+    drain(queue_lock);
+    max_queued_ = 0;
+    stop_ = true;
+    writer = std::move(writer_);
+    queue_cv_.notify_one();
+  }
+
+  if (writer) {
+    writer->join();
+  }
+}
+
+uint64_t LockingStderrSink::dropped() {
+  std::unique_lock<std::mutex> queue_lock(queue_lock_);
+  return dropped_;
+}
+
 void LockingStderrSink::log(const spdlog::details::log_msg& msg) {
-  Thread::OptionalLockGuard<Thread::BasicLockable> guard(lock_);
-  std::cerr << msg.formatted.str();
+  {
+    std::unique_lock<std::mutex> queue_lock(queue_lock_);
+    if (max_queued_ > 0) {
+      if (msg.level != spdlog::level::critical) {
+        if (queue_.size() >= max_queued_) {
+          dropped_++;
+          unreported_dropped_++;
+        } else {
+          queue_.emplace_back(msg.formatted.str());
+          queue_cv_.notify_one();
+        }
+        return;
+      }
+
+      // Write out everything logged before a critical message first, so that nothing before it is
+      // lost if the process aborts right after.
+      drain(queue_lock);
+    }
+  }
+
+  write(msg.formatted.str());
 }
 
 void LockingStderrSink::flush() {
+  {
+    std::unique_lock<std::mutex> queue_lock(queue_lock_);
+    drain(queue_lock);
+  }
+
   Thread::OptionalLockGuard<Thread::BasicLockable> guard(lock_);
   std::cerr << std::flush;
 }
 
+void LockingStderrSink::drain(std::unique_lock<std::mutex>& queue_lock) {
+  drained_cv_.wait(queue_lock,
+                   [this]() -> bool { return !writer_ || (queue_.empty() && !writing_); });
+}
+
+void LockingStderrSink::write(const std::string& message) {
+  Thread::OptionalLockGuard<Thread::BasicLockable> guard(lock_);
+  std::cerr << message;
+}
+
+void LockingStderrSink::writerLoop() {
+  std::unique_lock<std::mutex> queue_lock(queue_lock_);
+  while (true) {
+    queue_cv_.wait(queue_lock, [this]() -> bool { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+
+    std::deque<std::string> messages;
+    messages.swap(queue_);
+    const uint64_t unreported_dropped = unreported_dropped_;
+    unreported_dropped_ = 0;
+    writing_ = true;
+    queue_lock.unlock();
+
+    for (const std::string& message : messages) {
+      write(message);
+    }
+    if (unreported_dropped > 0) {
+      write(fmt::format("dropped {} log messages because the log queue was full\n",
+                        unreported_dropped));
+    }
+
+    queue_lock.lock();
+    writing_ = false;
+    drained_cv_.notify_all();
+  }
+}
+
 spdlog::logger& Registry::getLog(Id id) { return *allLoggers()[static_cast<int>(id)].logger_; }
 
 void Registry::initialize(uint64_t log_level, Thread::BasicLockable& lock) {
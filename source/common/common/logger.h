@@ -1,8 +1,12 @@
 #pragma once
 
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "envoy/thread/thread.h"
@@ -60,18 +64,51 @@ private:
 };
 
 /**
- * An optionally locking stderr logging sink.
+ * An optionally locking stderr logging sink. By default messages are written by the thread that
+ * logs them. In asynchronous mode they are queued and written by a writer thread instead, so that
+ * logging at a verbose level under load does not block workers on stderr. The queue is bounded:
+ * once it is full, further messages are dropped and counted, and a note with the number of dropped
+ * messages is written once the writer catches up. Critical messages are never queued, as they are
+ * usually followed by an abort.
  */
 class LockingStderrSink : public spdlog::sinks::sink {
 public:
+  ~LockingStderrSink();
+
   void setLock(Thread::BasicLockable& lock) { lock_ = &lock; }
 
+  /**
+   * Switch between synchronous and asynchronous mode. Switching to synchronous mode writes out the
+   * queued messages and joins the writer thread, which must happen before the lock goes away.
+   * @param max_queued supplies the maximum number of queued messages, or 0 for synchronous mode.
+   */
+  void setAsync(uint64_t max_queued);
+
+  /**
+   * @return uint64_t the total number of messages dropped because the queue was full.
+   */
+  uint64_t dropped();
+
   // spdlog::sinks::sink
   void log(const spdlog::details::log_msg& msg) override;
   void flush() override;
 
 private:
+  void drain(std::unique_lock<std::mutex>& queue_lock);
+  void write(const std::string& message);
+  void writerLoop();
+
   Thread::BasicLockable* lock_{};
+  std::mutex queue_lock_;
+  std::condition_variable queue_cv_;
+  std::condition_variable drained_cv_;
+  std::deque<std::string> queue_;
+  uint64_t max_queued_{};
+  uint64_t dropped_{};
+  uint64_t unreported_dropped_{};
+  bool writing_{};
+  bool stop_{};
+  std::unique_ptr<std::thread> writer_;
 };
 
 /**
@@ -135,21 +172,69 @@ protected:
 #define LOG_PREFIX __FILE__ ":" LINE_STRING "] "
 
 /**
- * Base logging macros.  It is expected that users will use the convenience macros below rather than
- * invoke these directly.
+ * The lowest level that log statements are compiled in at, using the spdlog level numbers (0 for
+ * trace up to 4 for err). Statements below it are removed entirely, including the evaluation of
+ * their arguments, while critical statements are always kept. Defining NVLOG is a shorthand for
+ * removing trace and debug statements.
  */
+#ifndef ENVOY_LOG_MIN_LEVEL
 #ifdef NVLOG
+#define ENVOY_LOG_MIN_LEVEL 2
+#else
+#define ENVOY_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+#define ENVOY_LOG_COMPILED_trace (ENVOY_LOG_MIN_LEVEL <= 0)
+#define ENVOY_LOG_COMPILED_debug (ENVOY_LOG_MIN_LEVEL <= 1)
+#define ENVOY_LOG_COMPILED_info (ENVOY_LOG_MIN_LEVEL <= 2)
+#define ENVOY_LOG_COMPILED_warn (ENVOY_LOG_MIN_LEVEL <= 3)
+#define ENVOY_LOG_COMPILED_err (ENVOY_LOG_MIN_LEVEL <= 4)
+#define ENVOY_LOG_COMPILED_critical 1
+
+/**
+ * Base logging macros.  It is expected that users will use the convenience macros below rather than
+ * invoke these directly. The level of the logger is checked before the arguments are evaluated.
+ */
+#define ENVOY_LOG_LEVEL_TO_LOGGER(LOGGER, LEVEL, ...)                                              \
+  do {                                                                                             \
+    if (LOGGER.should_log(spdlog::level::LEVEL)) {                                                 \
+      LOGGER.LEVEL(LOG_PREFIX __VA_ARGS__);                                                        \
+    }                                                                                              \
+  } while (0)
+
+#if ENVOY_LOG_MIN_LEVEL <= 0
+#define ENVOY_LOG_trace_TO_LOGGER(LOGGER, ...) ENVOY_LOG_LEVEL_TO_LOGGER(LOGGER, trace, __VA_ARGS__)
+#else
 #define ENVOY_LOG_trace_TO_LOGGER(LOGGER, ...)
+#endif
+
+#if ENVOY_LOG_MIN_LEVEL <= 1
+#define ENVOY_LOG_debug_TO_LOGGER(LOGGER, ...) ENVOY_LOG_LEVEL_TO_LOGGER(LOGGER, debug, __VA_ARGS__)
+#else
 #define ENVOY_LOG_debug_TO_LOGGER(LOGGER, ...)
+#endif
+
+#if ENVOY_LOG_MIN_LEVEL <= 2
+#define ENVOY_LOG_info_TO_LOGGER(LOGGER, ...) ENVOY_LOG_LEVEL_TO_LOGGER(LOGGER, info, __VA_ARGS__)
+#else
+#define ENVOY_LOG_info_TO_LOGGER(LOGGER, ...)
+#endif
+
+#if ENVOY_LOG_MIN_LEVEL <= 3
+#define ENVOY_LOG_warn_TO_LOGGER(LOGGER, ...) ENVOY_LOG_LEVEL_TO_LOGGER(LOGGER, warn, __VA_ARGS__)
+#else
+#define ENVOY_LOG_warn_TO_LOGGER(LOGGER, ...)
+#endif
+
+#if ENVOY_LOG_MIN_LEVEL <= 4
+#define ENVOY_LOG_err_TO_LOGGER(LOGGER, ...) ENVOY_LOG_LEVEL_TO_LOGGER(LOGGER, err, __VA_ARGS__)
 #else
-#define ENVOY_LOG_trace_TO_LOGGER(LOGGER, ...) LOGGER.trace(LOG_PREFIX __VA_ARGS__)
-#define ENVOY_LOG_debug_TO_LOGGER(LOGGER, ...) LOGGER.debug(LOG_PREFIX __VA_ARGS__)
+#define ENVOY_LOG_err_TO_LOGGER(LOGGER, ...)
 #endif
 
-#define ENVOY_LOG_info_TO_LOGGER(LOGGER, ...) LOGGER.info(LOG_PREFIX __VA_ARGS__)
-#define ENVOY_LOG_warn_TO_LOGGER(LOGGER, ...) LOGGER.warn(LOG_PREFIX __VA_ARGS__)
-#define ENVOY_LOG_err_TO_LOGGER(LOGGER, ...) LOGGER.err(LOG_PREFIX __VA_ARGS__)
-#define ENVOY_LOG_critical_TO_LOGGER(LOGGER, ...) LOGGER.critical(LOG_PREFIX __VA_ARGS__)
+#define ENVOY_LOG_critical_TO_LOGGER(LOGGER, ...)                                                  \
+  ENVOY_LOG_LEVEL_TO_LOGGER(LOGGER, critical, __VA_ARGS__)
 
 /**
  * Convenience macro to log to a user-specified logger.
@@ -161,6 +246,14 @@ protected:
  */
 #define ENVOY_LOGGER() __log_do_not_use_read_comment()
 
+/**
+ * Convenience macro to check whether statements of a level are compiled in and enabled on the
+ * class' logger. This guards work that is only done for logging, like iterating over headers:
+ *   if (ENVOY_LOG_CHECK_LEVEL(debug)) { ... }
+ */
+#define ENVOY_LOG_CHECK_LEVEL(LEVEL)                                                               \
+  (ENVOY_LOG_COMPILED_##LEVEL && ENVOY_LOGGER().should_log(spdlog::level::LEVEL))
+
 /**
  * Convenience macro to flush logger.
  */
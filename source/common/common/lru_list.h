@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <utility>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+
+/**
+ * The entries of a cache in order of use, most recently used first. Each entry is given a position
+ * when it is inserted, which the cache keeps with it to touch or remove it without a search.
+ */
+template <class T> class LruList {
+public:
+  typedef typename std::list<T>::iterator Position;
+
+  /**
+   * Insert an entry as the most recently used.
+   * @return Position the position of the entry.
+   */
+  Position insert(T entry) {
+    entries_.push_front(std::move(entry));
+    return entries_.begin();
+  }
+
+  /**
+   * Make an entry the most recently used.
+   */
+  void touch(Position position) { entries_.splice(entries_.begin(), entries_, position); }
+
+  void remove(Position position) { entries_.erase(position); }
+
+  /**
+   * @return const T& the least recently used entry, which is the next to evict.
+   */
+  const T& leastRecentlyUsed() const {
+    ASSERT(!entries_.empty());
+    return entries_.back();
+  }
+
+  bool empty() const { return entries_.empty(); }
+  size_t size() const { return entries_.size(); }
+
+private:
+  std::list<T> entries_;
+};
+
+} // namespace Envoy
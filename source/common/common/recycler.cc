@@ -0,0 +1,117 @@
+#include "common/common/recycler.h"
+
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace Envoy {
+
+const size_t Recycler::SIZE_GRANULARITY;
+const size_t Recycler::MAX_OBJECT_SIZE;
+
+namespace {
+
+// Written once at startup before any worker exists, then only read.
+uint64_t max_free_objects = 0;
+
+const size_t NumSizeClasses = Recycler::MAX_OBJECT_SIZE / Recycler::SIZE_GRANULARITY;
+
+size_t sizeClass(size_t size) {
+  return size == 0 ? 0 : (size - 1) / Recycler::SIZE_GRANULARITY;
+}
+
+/**
+ * Per thread free lists, one for each size class.
+ */
+class RecyclerPool {
+public:
+  ~RecyclerPool() {
+    for (std::vector<void*>& free_objects : free_objects_) {
+      for (void* object : free_objects) {
+        ::operator delete(object);
+      }
+    }
+    destroyed_ = true;
+  }
+
+  /**
+   * @return RecyclerPool* the pool of the calling thread, or nullptr if the thread is exiting and
+   *         its pool has already been destroyed.
+   */
+  static RecyclerPool* get() {
+    if (destroyed_) {
+      return nullptr;
+    }
+
+    static thread_local RecyclerPool pool;
+    return &pool;
+  }
+
+  void* take(size_t size_class) {
+    std::vector<void*>& free_objects = free_objects_[size_class];
+    if (free_objects.empty()) {
+      return nullptr;
+    }
+
+    void* object = free_objects.back();
+    free_objects.pop_back();
+    return object;
+  }
+
+  bool give(void* object, size_t size_class) {
+    std::vector<void*>& free_objects = free_objects_[size_class];
+    if (free_objects.size() >= max_free_objects) {
+      return false;
+    }
+
+    free_objects.push_back(object);
+    return true;
+  }
+
+private:
+  static thread_local bool destroyed_;
+  std::vector<void*> free_objects_[NumSizeClasses];
+};
+
+thread_local bool RecyclerPool::destroyed_ = false;
+
+} // namespace
+
+void* Recycler::allocate(size_t size) {
+  if (size > MAX_OBJECT_SIZE) {
+    return ::operator new(size);
+  }
+
+  const size_t size_class = sizeClass(size);
+  if (max_free_objects > 0) {
+    RecyclerPool* pool = RecyclerPool::get();
+    void* object = pool ? pool->take(size_class) : nullptr;
+    if (object) {
+      return object;
+    }
+  }
+
+  // Allocate the whole size class so that the memory can later serve any size in it.
+  return ::operator new((size_class + 1) * SIZE_GRANULARITY);
+}
+
+void Recycler::release(void* object, size_t size) {
+  if (!object) {
+    return;
+  }
+
+  if (max_free_objects > 0 && size <= MAX_OBJECT_SIZE) {
+    RecyclerPool* pool = RecyclerPool::get();
+    if (pool && pool->give(object, sizeClass(size))) {
+      return;
+    }
+  }
+
+  ::operator delete(object);
+}
+
+void Recycler::maxFreeObjects(uint64_t max) { max_free_objects = max; }
+
+uint64_t Recycler::maxFreeObjects() { return max_free_objects; }
+
+} // namespace Envoy
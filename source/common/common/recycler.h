@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Envoy {
+
+/**
+ * Per thread free lists for the memory of objects that are created and destroyed at a high rate,
+ * such as the objects that make up a connection. Memory is kept by size, rounded up to
+ * SIZE_GRANULARITY, so a worker that accepts and closes connections in the steady state reuses the
+ * memory of the connections it closed instead of going to the general purpose allocator. Memory is
+ * returned to the list of the thread that frees it.
+ *
+ * Recycling is off until maxFreeObjects() is set to a non zero value.
+ */
+class Recycler {
+public:
+  static const size_t SIZE_GRANULARITY = 16;
+  // Larger objects are never recycled.
+  static const size_t MAX_OBJECT_SIZE = 8192;
+
+  /**
+   * @param size supplies the size of the object.
+   * @return void* memory for an object of the given size, from the free list of the calling thread
+   *         if it has any.
+   */
+  static void* allocate(size_t size);
+
+  /**
+   * Give back memory taken with allocate(). It is kept for reuse unless the free list of the
+   * calling thread for its size is full.
+   * @param object supplies the memory.
+   * @param size supplies the size that the memory was allocated with.
+   */
+  static void release(void* object, size_t size);
+
+  /**
+   * Set the number of free objects of each size that every thread keeps. Must be called before
+   * any worker thread starts.
+   * @param max supplies the cap. 0 disables recycling.
+   */
+  static void maxFreeObjects(uint64_t max);
+
+  /**
+   * @return uint64_t the number of free objects of each size that every thread keeps.
+   */
+  static uint64_t maxFreeObjects();
+};
+
+/**
+ * Base class for objects whose memory is recycled through the Recycler. Objects must be deleted
+ * through their own type or through a base with a virtual destructor so that the size they are
+ * released with is the size they were allocated with.
+ */
+class Recycled {
+public:
+  static void* operator new(size_t size) { return Recycler::allocate(size); }
+  static void operator delete(void* object, size_t size) { Recycler::release(object, size); }
+};
+
+} // namespace Envoy
@@ -0,0 +1,82 @@
+#include "common/common/regex.h"
+
+#include <algorithm>
+
+#include "envoy/common/exception.h"
+
+#include "spdlog/spdlog.h"
+
+namespace Envoy {
+namespace Regex {
+
+namespace {
+
+re2::RE2::Options options() {
+  re2::RE2::Options options;
+  // Invalid patterns are reported through exceptions instead.
+  options.set_log_errors(false);
+  return options;
+}
+
+} // namespace
+
+Pattern::Pattern(const std::string& pattern) : re2_(pattern, options()) {
+  if (!re2_.ok()) {
+    throw EnvoyException(fmt::format("invalid regex '{}': {}", pattern, re2_.error()));
+  }
+}
+
+bool Pattern::fullMatch(const char* data, size_t length, std::vector<std::string>* groups) const {
+  const re2::StringPiece value(data, length);
+  if (groups == nullptr) {
+    return re2::RE2::FullMatch(value, re2_);
+  }
+
+  const int num_groups = re2_.NumberOfCapturingGroups();
+  std::vector<re2::StringPiece> pieces(num_groups);
+  std::vector<re2::RE2::Arg> args;
+  std::vector<const re2::RE2::Arg*> arg_ptrs;
+  args.reserve(num_groups);
+  for (re2::StringPiece& piece : pieces) {
+    args.emplace_back(&piece);
+    arg_ptrs.push_back(&args.back());
+  }
+
+  if (!re2::RE2::FullMatchN(value, re2_, arg_ptrs.data(), num_groups)) {
+    return false;
+  }
+
+  groups->clear();
+  for (const re2::StringPiece& piece : pieces) {
+    groups->emplace_back(piece.data(), piece.size());
+  }
+  return true;
+}
+
+PatternSet::PatternSet(const std::vector<std::string>& patterns)
+    : set_(options(), re2::RE2::ANCHOR_BOTH) {
+  for (const std::string& pattern : patterns) {
+    std::string error;
+    if (set_.Add(pattern, &error) < 0) {
+      throw EnvoyException(fmt::format("invalid regex '{}': {}", pattern, error));
+    }
+  }
+
+  if (!set_.Compile()) {
+    throw EnvoyException("regex set exceeds the RE2 memory budget");
+  }
+}
+
+bool PatternSet::fullMatch(const char* data, size_t length, std::vector<int>& indexes) const {
+  indexes.clear();
+  if (!set_.Match(re2::StringPiece(data, length), &indexes)) {
+    return false;
+  }
+
+  // RE2 reports the matches in no particular order.
+  std::sort(indexes.begin(), indexes.end());
+  return true;
+}
+
+} // namespace Regex
+} // namespace Envoy
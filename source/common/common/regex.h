@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/common/non_copyable.h"
+
+#include "re2/re2.h"
+#include "re2/set.h"
+
+namespace Envoy {
+namespace Regex {
+
+/**
+ * A regular expression in RE2 syntax. Matching takes time linear in the length of the value, so a
+ * pattern cannot blow up on crafted input the way a backtracking std::regex can. In exchange RE2
+ * does not support backreferences or lookaround.
+ */
+class Pattern : NonCopyable {
+public:
+  /**
+   * @param pattern supplies the regular expression.
+   * @throw EnvoyException if the regular expression is invalid.
+   */
+  explicit Pattern(const std::string& pattern);
+
+  /**
+   * @param data supplies the value to match.
+   * @param length supplies the length of the value.
+   * @param groups supplies where to store the text matched by each capturing group of the pattern
+   *        if the whole value matches. May be nullptr.
+   * @return bool whether the whole value matches the pattern.
+   */
+  bool fullMatch(const char* data, size_t length, std::vector<std::string>* groups = nullptr) const;
+
+  /**
+   * @param value supplies the value to match.
+   * @return bool whether the whole value matches the pattern.
+   */
+  bool fullMatch(const std::string& value) const {
+    return fullMatch(value.data(), value.size());
+  }
+
+private:
+  re2::RE2 re2_;
+};
+
+typedef std::unique_ptr<const Pattern> PatternConstPtr;
+
+/**
+ * A list of regular expressions in RE2 syntax that are all matched against a value in a single
+ * pass, instead of one after the other.
+ */
+class PatternSet : NonCopyable {
+public:
+  /**
+   * @param patterns supplies the regular expressions.
+   * @throw EnvoyException if a regular expression is invalid, or the set is too large to compile.
+   */
+  explicit PatternSet(const std::vector<std::string>& patterns);
+
+  /**
+   * @param data supplies the value to match.
+   * @param length supplies the length of the value.
+   * @param indexes supplies where to store the indexes into the patterns of all the patterns that
+   *        match the whole value, in ascending order.
+   * @return bool whether any pattern matches the whole value.
+   */
+  bool fullMatch(const char* data, size_t length, std::vector<int>& indexes) const;
+
+private:
+  re2::RE2::Set set_;
+};
+
+typedef std::unique_ptr<const PatternSet> PatternSetConstPtr;
+
+} // namespace Regex
+} // namespace Envoy
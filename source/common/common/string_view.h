@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+namespace Envoy {
+
+/**
+ * A non-owning reference to a range of characters, for parsing strings such as header values
+ * without copying pieces of them into std::strings. The referenced characters must outlive the
+ * view, and need not be null terminated. A minimal stand-in for C++17's std::string_view.
+ */
+class StringView {
+public:
+  static const size_t npos = std::string::npos;
+
+  StringView() : data_(nullptr), size_(0) {}
+  StringView(const char* data, size_t size) : data_(data), size_(size) {}
+  StringView(const char* str) : data_(str), size_(strlen(str)) {}
+  StringView(const std::string& str) : data_(str.data()), size_(str.size()) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  char operator[](size_t pos) const { return data_[pos]; }
+
+  /**
+   * @return the position of the first c at or after pos, or npos.
+   */
+  size_t find(char c, size_t pos = 0) const {
+    if (pos >= size_) {
+      return npos;
+    }
+    const void* found = memchr(data_ + pos, c, size_ - pos);
+    return found ? static_cast<const char*>(found) - data_ : npos;
+  }
+
+  /**
+   * @return the position of the first occurrence of str at or after pos, or npos.
+   */
+  size_t find(StringView str, size_t pos = 0) const {
+    if (pos > size_ || str.size_ > size_ - pos) {
+      return npos;
+    }
+    const char* found = std::search(data_ + pos, end(), str.begin(), str.end());
+    return found == end() && !str.empty() ? npos : found - data_;
+  }
+
+  /**
+   * @return the position of the last occurrence of str, or npos.
+   */
+  size_t rfind(StringView str) const {
+    if (str.size_ > size_) {
+      return npos;
+    }
+    const char* found = std::find_end(begin(), end(), str.begin(), str.end());
+    return found == end() && !str.empty() ? npos : found - data_;
+  }
+
+  /**
+   * @return the view of up to n characters starting at pos, which must not be past the end.
+   */
+  StringView substr(size_t pos, size_t n = npos) const {
+    return StringView(data_ + pos, std::min(n, size_ - pos));
+  }
+
+  void removePrefix(size_t n) {
+    data_ += n;
+    size_ -= n;
+  }
+
+  void removeSuffix(size_t n) { size_ -= n; }
+
+  /**
+   * @return a copy of the referenced characters.
+   */
+  std::string toString() const { return std::string(data_, size_); }
+
+  bool operator==(StringView rhs) const {
+    return size_ == rhs.size_ && (size_ == 0 || memcmp(data_, rhs.data_, size_) == 0);
+  }
+  bool operator!=(StringView rhs) const { return !(*this == rhs); }
+
+private:
+  const char* data_;
+  size_t size_;
+};
+
+} // namespace Envoy
@@ -1,7 +1,10 @@
 #include "common/common/thread.h"
 
 #ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
 #include <sys/syscall.h>
+#include <time.h>
 #elif defined(__APPLE__)
 #include <pthread.h>
 #endif
@@ -37,11 +40,74 @@ int32_t Thread::currentThreadId() {
 #endif
 }
 
+bool Thread::pinCurrentThread(uint32_t cpu) {
+#ifdef __linux__
+  if (cpu >= CPU_SETSIZE) {
+    return false;
+  }
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+  UNREFERENCED_PARAMETER(cpu);
+  return false;
+#endif
+}
+
 void Thread::join() {
   int rc = pthread_join(thread_id_, nullptr);
   RELEASE_ASSERT(rc == 0);
   UNREFERENCED_PARAMETER(rc);
 }
 
+uint64_t UsageRegistry::add(const std::string& prefix, IdleTimeCb idle_time) {
+  Entry entry{0, prefix, idle_time};
+#ifdef __linux__
+  // The clock is the CLOCK_THREAD_CPUTIME_ID of the calling thread, in a form other threads can
+  // read.
+  int rc = pthread_getcpuclockid(pthread_self(), &entry.cpu_clock_);
+  RELEASE_ASSERT(rc == 0);
+  UNREFERENCED_PARAMETER(rc);
+#endif
+
+  std::unique_lock<std::mutex> lock(lock_);
+  entry.handle_ = next_handle_++;
+  entries_.emplace_back(std::move(entry));
+  return entries_.back().handle_;
+}
+
+void UsageRegistry::remove(uint64_t handle) {
+  std::unique_lock<std::mutex> lock(lock_);
+  entries_.remove_if([handle](const Entry& entry) -> bool { return entry.handle_ == handle; });
+}
+
+std::vector<UsageRegistry::Sample> UsageRegistry::sample() const {
+  std::vector<Sample> samples;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (const Entry& entry : entries_) {
+    Sample sample{entry.prefix_, std::chrono::nanoseconds(0), std::chrono::nanoseconds(0),
+                  entry.idle_time_ != nullptr};
+#ifdef __linux__
+    timespec cpu_time;
+    if (clock_gettime(entry.cpu_clock_, &cpu_time) == 0) {
+      sample.cpu_time_ =
+          std::chrono::seconds(cpu_time.tv_sec) + std::chrono::nanoseconds(cpu_time.tv_nsec);
+    }
+#endif
+    if (sample.has_idle_time_) {
+      sample.idle_time_ = entry.idle_time_();
+    }
+    samples.emplace_back(std::move(sample));
+  }
+  return samples;
+}
+
+UsageRegistry& UsageRegistry::instance() {
+  static UsageRegistry* instance = new UsageRegistry();
+  return *instance;
+}
+
 } // namespace Thread
 } // namespace Envoy
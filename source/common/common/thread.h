@@ -1,8 +1,13 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <list>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include "envoy/thread/thread.h"
 
@@ -24,6 +29,14 @@ public:
    */
   static ThreadId currentThreadId();
 
+  /**
+   * Pin the calling thread to a single CPU. Memory the thread touches first afterwards is then
+   * allocated on the NUMA node of that CPU.
+   * @param cpu supplies the CPU.
+   * @return bool whether the thread was pinned. This always fails on platforms other than Linux.
+   */
+  static bool pinCurrentThread(uint32_t cpu);
+
   /**
    * Join on thread exit.
    */
@@ -36,6 +49,64 @@ private:
 
 typedef std::unique_ptr<Thread> ThreadPtr;
 
+/**
+ * The long running threads of the process whose CPU use is reported in the stats. A thread adds
+ * itself when it starts running and removes itself before it exits, and the main thread samples
+ * them all once per stats flush. The CPU time is read from the thread's CPU clock, which other
+ * threads can read as well. It reads as zero on platforms other than Linux.
+ */
+class UsageRegistry {
+public:
+  /**
+   * Supplies how long a thread has been idle, i.e. waiting for work, since it was added.
+   */
+  typedef std::function<std::chrono::nanoseconds()> IdleTimeCb;
+
+  struct Sample {
+    // The stat prefix the thread was added with.
+    std::string prefix_;
+    std::chrono::nanoseconds cpu_time_;
+    // Only set for threads that were added with an IdleTimeCb.
+    std::chrono::nanoseconds idle_time_;
+    bool has_idle_time_;
+  };
+
+  /**
+   * Add the calling thread.
+   * @param prefix supplies the stat prefix of the thread.
+   * @param idle_time supplies the idle time of the thread, or nullptr if it is not tracked. It is
+   *        called on the sampling thread while the thread is added.
+   * @return uint64_t a handle to remove the thread with.
+   */
+  uint64_t add(const std::string& prefix, IdleTimeCb idle_time);
+
+  /**
+   * Remove a thread. Once this returns, its IdleTimeCb is no longer called.
+   */
+  void remove(uint64_t handle);
+
+  /**
+   * @return std::vector<Sample> the current CPU and idle time of each added thread.
+   */
+  std::vector<Sample> sample() const;
+
+  static UsageRegistry& instance();
+
+private:
+  struct Entry {
+    uint64_t handle_;
+    std::string prefix_;
+    IdleTimeCb idle_time_;
+#ifdef __linux__
+    clockid_t cpu_clock_;
+#endif
+  };
+
+  mutable std::mutex lock_;
+  std::list<Entry> entries_;
+  uint64_t next_handle_{};
+};
+
 /**
  * Implementation of BasicLockable
  */
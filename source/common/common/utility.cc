@@ -87,12 +87,49 @@ void StringUtil::rtrim(std::string& source) {
   }
 }
 
+void StringUtil::trim(std::string& source) {
+  rtrim(source);
+  source.erase(0, source.find_first_not_of(" \t\f\v\n\r"));
+}
+
+StringView StringUtil::trimView(StringView source) {
+  static const char* const whitespace = " \t\f\v\n\r";
+  while (!source.empty() && strchr(whitespace, source[0]) != nullptr) {
+    source.removePrefix(1);
+  }
+  while (!source.empty() && strchr(whitespace, source[source.size() - 1]) != nullptr) {
+    source.removeSuffix(1);
+  }
+  return source;
+}
+
 size_t StringUtil::strlcpy(char* dst, const char* src, size_t size) {
   strncpy(dst, src, size - 1);
   dst[size - 1] = '\0';
   return strlen(src);
 }
 
+std::vector<StringView> StringUtil::splitToViews(StringView source, char split,
+                                                 bool keep_empty_string) {
+  std::vector<StringView> ret;
+  size_t last_index = 0;
+  size_t next_index;
+  do {
+    next_index = source.find(split, last_index);
+    if (next_index == StringView::npos) {
+      next_index = source.size();
+    }
+
+    if (next_index != last_index || keep_empty_string) {
+      ret.push_back(source.substr(last_index, next_index - last_index));
+    }
+
+    last_index = next_index + 1;
+  } while (next_index != source.size());
+
+  return ret;
+}
+
 std::vector<std::string> StringUtil::split(const std::string& source, char split) {
   return StringUtil::split(source, std::string{split});
 }
@@ -191,6 +228,17 @@ bool StringUtil::startsWith(const char* source, const std::string& start, bool c
   }
 }
 
+bool StringUtil::startsWith(StringView source, StringView start, bool case_sensitive) {
+  if (source.size() < start.size()) {
+    return false;
+  }
+  if (case_sensitive) {
+    return memcmp(source.data(), start.data(), start.size()) == 0;
+  } else {
+    return strncasecmp(source.data(), start.data(), start.size()) == 0;
+  }
+}
+
 const std::string& StringUtil::nonEmptyStringOrDefault(const std::string& s,
                                                        const std::string& default_value) {
   return s.empty() ? default_value : s;
@@ -10,6 +10,8 @@
 
 #include "envoy/common/time.h"
 
+#include "common/common/string_view.h"
+
 namespace Envoy {
 /**
  * Utility class for formatting dates given a strftime style format string.
@@ -101,6 +103,13 @@ public:
     return strcasecmp(lhs, rhs);
   }
 
+  /**
+   * @return true if @param lhs and @param rhs are equal when ignoring case.
+   */
+  static bool caseInsensitiveEqual(StringView lhs, StringView rhs) {
+    return lhs.size() == rhs.size() && strncasecmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+  }
+
   /**
    * Convert an unsigned integer to a base 10 string as fast as possible.
    * @param out supplies the string to fill.
@@ -115,6 +124,16 @@ public:
    */
   static void rtrim(std::string& source);
 
+  /**
+   * Trim leading and trailing whitespace from a string in place.
+   */
+  static void trim(std::string& source);
+
+  /**
+   * @return the view of @param source without leading and trailing whitespace.
+   */
+  static StringView trimView(StringView source);
+
   /**
    * Size-bounded string copying and concatenation
    */
@@ -147,6 +166,18 @@ public:
    */
   static std::vector<std::string> split(const std::string& source, char split);
 
+  /**
+   * Split a string into views of its pieces, without copying them. Unlike split(), this is meant
+   * for per-request parsing, e.g. of header values.
+   * @param source supplies the string to split. It must outlive the returned views.
+   * @param split supplies the char to split on.
+   * @param keep_empty_string result contains empty views if the string starts or ends with
+   * 'split', or if instances of 'split' are adjacent.
+   * @return vector of views of `source` between all instances of `split`.
+   */
+  static std::vector<StringView> splitToViews(StringView source, char split,
+                                              bool keep_empty_string = false);
+
   /**
    * Version of substr() that operates on a start and end index instead of a start index and a
    * length.
@@ -172,6 +203,12 @@ public:
    */
   static bool startsWith(const char* source, const std::string& start, bool case_sensitive = true);
 
+  /**
+   * @param case_sensitive determines if the compare is case sensitive
+   * @return true if @param source starts with @param start.
+   */
+  static bool startsWith(StringView source, StringView start, bool case_sensitive = true);
+
   /**
    * Provide a default value for a string if empty.
    * @param s string.
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <list>
+
+namespace Envoy {
+
+/**
+ * The waiters for a result that is being produced on a worker, such as a response from upstream,
+ * which are called back in the order they started waiting.
+ */
+template <class Waiter> class WaiterList {
+public:
+  void add(Waiter& waiter) { waiters_.push_back(&waiter); }
+  void remove(Waiter& waiter) { waiters_.remove(&waiter); }
+  bool empty() const { return waiters_.empty(); }
+
+  /**
+   * Stop all the waiters waiting and call a function on each of them. Waiters may be added to the
+   * list again, or be destroyed, while the function runs.
+   */
+  template <class Function> void notifyAll(Function function) {
+    std::list<Waiter*> waiters;
+    waiters.swap(waiters_);
+    for (Waiter* waiter : waiters) {
+      function(*waiter);
+    }
+  }
+
+private:
+  std::list<Waiter*> waiters_;
+};
+
+} // namespace Envoy
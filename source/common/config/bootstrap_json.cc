@@ -76,6 +76,10 @@ void BootstrapJson::translateBootstrap(const Json::Object& json_config,
     AddressJson::translateAddress(json_config.getString("statsd_udp_ip_address"), false, true,
                                   *statsd_sink.mutable_address());
     MessageUtil::jsonConvert(statsd_sink, *stats_sink->mutable_config());
+    if (json_config.hasObject("statsd_udp_max_packet_size")) {
+      (*stats_sink->mutable_config()->mutable_fields())["max_packet_size"].set_number_value(
+          json_config.getInteger("statsd_udp_max_packet_size"));
+    }
   }
 
   if (json_config.hasObject("statsd_tcp_cluster_name")) {
@@ -86,6 +90,13 @@ void BootstrapJson::translateBootstrap(const Json::Object& json_config,
     MessageUtil::jsonConvert(statsd_sink, *stats_sink->mutable_config());
   }
 
+  if (json_config.hasObject("metrics_service_cluster_name")) {
+    auto* stats_sink = stats_sinks->Add();
+    stats_sink->set_name("envoy.metrics_service");
+    (*stats_sink->mutable_config()->mutable_fields())["cluster_name"].set_string_value(
+        json_config.getString("metrics_service_cluster_name"));
+  }
+
   JSON_UTIL_SET_DURATION(json_config, bootstrap, stats_flush_interval);
 
   auto* watchdog = bootstrap.mutable_watchdog();
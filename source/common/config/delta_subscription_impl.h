@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/common/optional.h"
+#include "envoy/config/subscription.h"
+
+#include "common/common/assert.h"
+#include "common/protobuf/utility.h"
+
+namespace Envoy {
+namespace Config {
+
+/**
+ * Subscription that gives its callbacks only the resources that were added, changed or removed
+ * since the previous accepted update, so that consumers of large configurations do work in
+ * proportion to the change. Resources are known by name(), and the version of a resource is the
+ * hash of its contents, as the management server's responses carry no per-resource versions.
+ */
+template <class ResourceType>
+class DeltaSubscriptionImpl : SubscriptionCallbacks<ResourceType> {
+public:
+  DeltaSubscriptionImpl(std::unique_ptr<Subscription<ResourceType>>&& subscription)
+      : subscription_(std::move(subscription)) {}
+
+  /**
+   * Start the wrapped subscription. @see Subscription::start().
+   */
+  void start(const std::vector<std::string>& resources,
+             DeltaSubscriptionCallbacks<ResourceType>& callbacks) {
+    ASSERT(callbacks_ == nullptr);
+    callbacks_ = &callbacks;
+    subscription_->start(resources, *this);
+  }
+
+  /**
+   * Update the resources to fetch. @see Subscription::updateResources().
+   */
+  void updateResources(const std::vector<std::string>& resources) {
+    subscription_->updateResources(resources);
+  }
+
+private:
+  typedef typename SubscriptionCallbacks<ResourceType>::ResourceVector ResourceVector;
+
+  // Config::SubscriptionCallbacks
+  void onConfigUpdate(const ResourceVector& resources) override {
+    // Each resource is hashed once per update, and the hash is kept until the next one.
+    std::unordered_map<std::string, Optional<uint64_t>> versions;
+    ResourceVector added_or_changed;
+    std::vector<uint64_t> hashes;
+    for (const ResourceType& resource : resources) {
+      const uint64_t hash = MessageUtil::hash(resource);
+      auto previous = versions_.find(resource.name());
+      if (previous == versions_.end() || !previous->second.valid() ||
+          previous->second.value() != hash) {
+        added_or_changed.Add()->CopyFrom(resource);
+        hashes.push_back(hash);
+      }
+      versions.emplace(resource.name(), hash);
+    }
+
+    std::vector<std::string> removed;
+    for (const auto& previous : versions_) {
+      if (versions.count(previous.first) == 0) {
+        removed.push_back(previous.first);
+      }
+    }
+
+    try {
+      callbacks_->onConfigUpdate(added_or_changed, hashes, removed);
+    } catch (const EnvoyException&) {
+      // Some of the changes may have been applied. The resources keep their previous versions, and
+      // those that were offered become of unknown version, so that the next update offers or
+      // removes them again.
+      for (const ResourceType& resource : added_or_changed) {
+        versions_[resource.name()] = Optional<uint64_t>();
+      }
+      throw;
+    }
+    versions_ = std::move(versions);
+  }
+
+  void onConfigUpdateFailed(const EnvoyException* e) override {
+    callbacks_->onConfigUpdateFailed(e);
+  }
+
+  std::unique_ptr<Subscription<ResourceType>> subscription_;
+  DeltaSubscriptionCallbacks<ResourceType>* callbacks_{};
+  // The hash of each resource of the last accepted update, by name. A resource whose hash is not
+  // set may or may not have been applied.
+  std::unordered_map<std::string, Optional<uint64_t>> versions_;
+};
+
+} // namespace Config
+} // namespace Envoy
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "envoy/config/subscription.h"
+#include "envoy/event/dispatcher.h"
+
+#include "common/common/logger.h"
+#include "common/config/utility.h"
+#include "common/grpc/async_client_impl.h"
+#include "common/protobuf/protobuf.h"
+
+#include "api/base.pb.h"
+#include "api/eds.pb.h"
+
+namespace Envoy {
+namespace Config {
+
+/**
+ * @return const std::string& the name that subscriptions know a resource by.
+ */
+template <class ResourceType> const std::string& resourceName(const ResourceType& resource) {
+  return resource.name();
+}
+
+inline const std::string& resourceName(const envoy::api::v2::ClusterLoadAssignment& resource) {
+  return resource.cluster_name();
+}
+
+template <class ResourceType> class GrpcMuxSubscriptionImpl;
+
+/**
+ * A single bidi stream to a management server that is shared by all of the subscriptions to one
+ * of its methods, e.g. the EDS subscriptions of every cluster. Each request names the union of
+ * the resources of the subscriptions, and each subscription gets the resources it named from the
+ * responses. Changes to the subscriptions made in the same event loop iteration are sent in one
+ * request.
+ *
+ * A response is acknowledged only if every subscription accepts its part of it. Subscription
+ * callbacks must not delete other subscriptions of the same mux.
+ */
+template <class ResourceType>
+class GrpcMuxImpl : Grpc::AsyncStreamCallbacks<envoy::api::v2::DiscoveryResponse>,
+                    Logger::Loggable<Logger::Id::config> {
+public:
+  typedef GrpcMuxSubscriptionImpl<ResourceType> MuxSubscription;
+  typedef std::shared_ptr<GrpcMuxImpl> SharedPtr;
+
+  GrpcMuxImpl(const envoy::api::v2::Node& node,
+              std::unique_ptr<Grpc::AsyncClient<envoy::api::v2::DiscoveryRequest,
+                                                envoy::api::v2::DiscoveryResponse>>
+                  async_client,
+              Event::Dispatcher& dispatcher, const Protobuf::MethodDescriptor& service_method)
+      : async_client_(std::move(async_client)), service_method_(service_method),
+        retry_timer_(dispatcher.createTimer([this]() -> void { establishNewStream(); })),
+        flush_timer_(dispatcher.createTimer([this]() -> void { flush(); })) {
+    request_.mutable_node()->CopyFrom(node);
+  }
+
+  /**
+   * @return SharedPtr the mux of the subscriptions to a method of a management server, which is
+   *         created if no subscription uses it yet. Muxes are only used on the thread they are
+   *         created on, which is the main thread except when validating several configurations
+   *         at once.
+   */
+  static SharedPtr get(const envoy::api::v2::Node& node, Upstream::ClusterManager& cm,
+                       const std::string& remote_cluster_name, Event::Dispatcher& dispatcher,
+                       const Protobuf::MethodDescriptor& service_method) {
+    static thread_local std::map<
+        std::tuple<const Upstream::ClusterManager*, std::string, std::string>,
+        std::weak_ptr<GrpcMuxImpl>>
+        muxes;
+    const auto key = std::make_tuple(&cm, remote_cluster_name, service_method.full_name());
+    SharedPtr mux = muxes[key].lock();
+    if (!mux) {
+      mux = std::make_shared<GrpcMuxImpl>(
+          node,
+          std::unique_ptr<Grpc::AsyncClientImpl<envoy::api::v2::DiscoveryRequest,
+                                                envoy::api::v2::DiscoveryResponse>>(
+              new Grpc::AsyncClientImpl<envoy::api::v2::DiscoveryRequest,
+                                        envoy::api::v2::DiscoveryResponse>(cm,
+                                                                           remote_cluster_name)),
+          dispatcher, service_method);
+      muxes[key] = mux;
+    }
+    return mux;
+  }
+
+  void addSubscription(MuxSubscription& subscription) {
+    subscriptions_.push_back(&subscription);
+    queueDiscoveryRequest();
+  }
+
+  void removeSubscription(MuxSubscription& subscription) {
+    subscriptions_.remove(&subscription);
+    queueDiscoveryRequest();
+  }
+
+  void updateSubscription() { queueDiscoveryRequest(); }
+
+  // Grpc::AsyncStreamCallbacks
+  void onCreateInitialMetadata(Http::HeaderMap& metadata) override {
+    UNREFERENCED_PARAMETER(metadata);
+  }
+
+  void onReceiveInitialMetadata(Http::HeaderMapPtr&& metadata) override {
+    UNREFERENCED_PARAMETER(metadata);
+  }
+
+  void onReceiveMessage(Grpc::ResponsePtr<envoy::api::v2::DiscoveryResponse>&& message) override {
+    auto typed_resources = Config::Utility::getTypedResources<ResourceType>(*message);
+    bool accepted = true;
+    if (subscriptions_.size() == 1) {
+      // A subscription that has the stream to itself gets all of every response, as it would on a
+      // stream of its own.
+      accepted = subscriptions_.front()->onConfigUpdate(typed_resources);
+    } else {
+      std::unordered_map<std::string, const ResourceType*> resources_by_name;
+      for (const ResourceType& resource : typed_resources) {
+        resources_by_name.emplace(resourceName(resource), &resource);
+      }
+
+      for (MuxSubscription* subscription : subscriptions_) {
+        if (subscription->resources_.empty()) {
+          accepted &= subscription->onConfigUpdate(typed_resources);
+          continue;
+        }
+
+        typename Config::SubscriptionCallbacks<ResourceType>::ResourceVector resources;
+        for (const std::string& name : subscription->resources_) {
+          auto resource = resources_by_name.find(name);
+          if (resource != resources_by_name.end()) {
+            resources.Add()->CopyFrom(*resource->second);
+          }
+        }
+        // Subscriptions that none of the resources are for have nothing to update.
+        if (!resources.empty()) {
+          accepted &= subscription->onConfigUpdate(resources);
+        }
+      }
+    }
+
+    // This effectively ACK/NACKs the accepted configuration.
+    if (accepted) {
+      request_.set_version_info(message->version_info());
+      ENVOY_LOG(debug, "gRPC config update accepted: {}", message->version_info());
+    }
+    ENVOY_LOG(debug, "Sending version update: {}", request_.version_info());
+    sendDiscoveryRequest();
+  }
+
+  void onReceiveTrailingMetadata(Http::HeaderMapPtr&& metadata) override {
+    UNREFERENCED_PARAMETER(metadata);
+  }
+
+  void onRemoteClose(Grpc::Status::GrpcStatus status, const std::string& message) override {
+    ENVOY_LOG(warn, "gRPC config stream closed: {}, {}", status, message);
+    stream_ = nullptr;
+    handleFailure();
+  }
+
+  // TODO(htuch): Make this configurable or some static.
+  const uint32_t RETRY_DELAY_MS = 5000;
+
+private:
+  void queueDiscoveryRequest() {
+    if (!flush_pending_) {
+      flush_pending_ = true;
+      flush_timer_->enableTimer(std::chrono::milliseconds(0));
+    }
+  }
+
+  void flush() {
+    flush_pending_ = false;
+    if (subscriptions_.empty()) {
+      return;
+    }
+    if (stream_ == nullptr) {
+      // A failed stream is established again by the retry timer.
+      if (!retry_pending_) {
+        establishNewStream();
+      }
+      return;
+    }
+    sendDiscoveryRequest();
+  }
+
+  void establishNewStream() {
+    ENVOY_LOG(debug, "Establishing new gRPC bidi stream for {}", service_method_.DebugString());
+    retry_pending_ = false;
+    for (MuxSubscription* subscription : subscriptions_) {
+      subscription->stats_.update_attempt_.inc();
+    }
+    stream_ = async_client_->start(service_method_, *this);
+    if (stream_ == nullptr) {
+      ENVOY_LOG(warn, "Unable to establish new stream");
+      handleFailure();
+      return;
+    }
+    sendDiscoveryRequest();
+  }
+
+  void sendDiscoveryRequest() {
+    if (stream_ == nullptr) {
+      return;
+    }
+
+    // A subscription without resource names asks for all of them, so the request does too.
+    std::unordered_set<std::string> names;
+    bool all = false;
+    for (const MuxSubscription* subscription : subscriptions_) {
+      all |= subscription->resources_.empty();
+      names.insert(subscription->resources_.begin(), subscription->resources_.end());
+    }
+    request_.clear_resource_names();
+    if (!all) {
+      std::vector<std::string> sorted_names(names.begin(), names.end());
+      std::sort(sorted_names.begin(), sorted_names.end());
+      for (const std::string& name : sorted_names) {
+        request_.add_resource_names(name);
+      }
+    }
+    stream_->sendMessage(request_, false);
+  }
+
+  void handleFailure() {
+    for (MuxSubscription* subscription : subscriptions_) {
+      subscription->onConfigUpdateFailed(nullptr);
+    }
+    retry_pending_ = true;
+    retry_timer_->enableTimer(std::chrono::milliseconds(RETRY_DELAY_MS));
+  }
+
+  std::unique_ptr<
+      Grpc::AsyncClient<envoy::api::v2::DiscoveryRequest, envoy::api::v2::DiscoveryResponse>>
+      async_client_;
+  const Protobuf::MethodDescriptor& service_method_;
+  Event::TimerPtr retry_timer_;
+  bool retry_pending_{};
+  Event::TimerPtr flush_timer_;
+  bool flush_pending_{};
+  std::list<MuxSubscription*> subscriptions_;
+  Grpc::AsyncStream<envoy::api::v2::DiscoveryRequest>* stream_{};
+  envoy::api::v2::DiscoveryRequest request_;
+};
+
+/**
+ * A subscription that shares the stream of a GrpcMuxImpl with the other subscriptions to the same
+ * method of a management server.
+ */
+template <class ResourceType>
+class GrpcMuxSubscriptionImpl : public Subscription<ResourceType>,
+                                Logger::Loggable<Logger::Id::config> {
+public:
+  GrpcMuxSubscriptionImpl(typename GrpcMuxImpl<ResourceType>::SharedPtr mux,
+                          SubscriptionStats stats)
+      : mux_(mux), stats_(stats) {}
+
+  ~GrpcMuxSubscriptionImpl() {
+    if (callbacks_ != nullptr) {
+      mux_->removeSubscription(*this);
+    }
+  }
+
+  // Config::Subscription
+  void start(const std::vector<std::string>& resources,
+             SubscriptionCallbacks<ResourceType>& callbacks) override {
+    ASSERT(callbacks_ == nullptr);
+    resources_ = resources;
+    callbacks_ = &callbacks;
+    mux_->addSubscription(*this);
+  }
+
+  void updateResources(const std::vector<std::string>& resources) override {
+    resources_ = resources;
+    mux_->updateSubscription();
+  }
+
+private:
+  typedef typename SubscriptionCallbacks<ResourceType>::ResourceVector ResourceVector;
+
+  bool onConfigUpdate(const ResourceVector& resources) {
+    stats_.update_attempt_.inc();
+    try {
+      callbacks_->onConfigUpdate(resources);
+      stats_.update_success_.inc();
+      return true;
+    } catch (const EnvoyException& e) {
+      ENVOY_LOG(warn, "gRPC config update rejected: {}", e.what());
+      stats_.update_rejected_.inc();
+      callbacks_->onConfigUpdateFailed(&e);
+      return false;
+    }
+  }
+
+  void onConfigUpdateFailed(const EnvoyException* e) {
+    stats_.update_failure_.inc();
+    callbacks_->onConfigUpdateFailed(e);
+  }
+
+  typename GrpcMuxImpl<ResourceType>::SharedPtr mux_;
+  std::vector<std::string> resources_;
+  SubscriptionCallbacks<ResourceType>* callbacks_{};
+  SubscriptionStats stats_;
+
+  friend class GrpcMuxImpl<ResourceType>;
+};
+
+} // namespace Config
+} // namespace Envoy
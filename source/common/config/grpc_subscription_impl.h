@@ -90,7 +90,7 @@ public:
     UNREFERENCED_PARAMETER(metadata);
   }
 
-  void onReceiveMessage(std::unique_ptr<envoy::api::v2::DiscoveryResponse>&& message) override {
+  void onReceiveMessage(Grpc::ResponsePtr<envoy::api::v2::DiscoveryResponse>&& message) override {
     const auto typed_resources = Config::Utility::getTypedResources<ResourceType>(*message);
     try {
       callbacks_->onConfigUpdate(typed_resources);
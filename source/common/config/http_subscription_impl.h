@@ -34,7 +34,8 @@ public:
                        const std::string& remote_cluster_name, Event::Dispatcher& dispatcher,
                        Runtime::RandomGenerator& random, std::chrono::milliseconds refresh_interval,
                        const Protobuf::MethodDescriptor& service_method, SubscriptionStats stats)
-      : Http::RestApiFetcher(cm, remote_cluster_name, dispatcher, random, refresh_interval),
+      : Http::RestApiFetcher(cm, remote_cluster_name, dispatcher, random, refresh_interval,
+                             "http_subscription"),
         stats_(stats) {
     request_.mutable_node()->CopyFrom(node);
     ASSERT(service_method.options().HasExtension(google::api::http));
@@ -1,5 +1,9 @@
 #include "common/config/metadata.h"
 
+#include <string>
+
+#include "spdlog/spdlog.h"
+
 namespace Envoy {
 namespace Config {
 
@@ -23,5 +27,18 @@ ProtobufWkt::Value& Metadata::mutableMetadataValue(envoy::api::v2::Metadata& met
   return (*(*metadata.mutable_filter_metadata())[filter].mutable_fields())[key];
 }
 
+std::string Metadata::valueString(const ProtobufWkt::Value& value) {
+  switch (value.kind_case()) {
+  case ProtobufWkt::Value::kStringValue:
+    return value.string_value();
+  case ProtobufWkt::Value::kNumberValue:
+    return fmt::format("{}", value.number_value());
+  case ProtobufWkt::Value::kBoolValue:
+    return value.bool_value() ? "true" : "false";
+  default:
+    return "";
+  }
+}
+
 } // namespace Config
 } // namespace Envoy
@@ -35,6 +35,15 @@ public:
   static ProtobufWkt::Value& mutableMetadataValue(envoy::api::v2::Metadata& metadata,
                                                   const std::string& filter,
                                                   const std::string& key);
+
+  /**
+   * Render a scalar metadata value as a string, e.g. to compare values of different messages.
+   * @param value supplies the value.
+   * @return std::string the string of a string value, the shortest form of a number value and
+   *         "true" or "false" for a bool value. Other values, including lists and structs, render
+   *         as an empty string.
+   */
+  static std::string valueString(const ProtobufWkt::Value& value);
 };
 
 /**
@@ -273,6 +273,16 @@ void RdsJson::translateRoute(const Json::Object& json_route, envoy::api::v2::Rou
       return true;
     });
   }
+
+  if (json_route.hasObject("metadata_match")) {
+    const Json::ObjectSharedPtr obj = json_route.getObject("metadata_match");
+    auto& filter_metadata =
+        (*route.mutable_metadata()->mutable_filter_metadata())[MetadataFilters::get().ENVOY_LB];
+    obj->iterate([&filter_metadata](const std::string& name, const Json::Object& value) {
+      (*filter_metadata.mutable_fields())[name].set_string_value(value.asString());
+      return true;
+    });
+  }
 }
 
 } // namespace Config
@@ -0,0 +1,57 @@
+#include "common/config/snapshot_store.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fstream>
+
+#include "envoy/common/exception.h"
+
+#include "common/filesystem/filesystem_impl.h"
+#include "common/protobuf/utility.h"
+
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Config {
+
+std::string SnapshotStore::directory_;
+
+bool SnapshotStore::load(const std::string& name, envoy::api::v2::DiscoveryResponse& snapshot) {
+  const std::string snapshot_path = path(name);
+  if (!Filesystem::fileExists(snapshot_path)) {
+    return false;
+  }
+
+  try {
+    MessageUtil::loadFromFile(snapshot_path, snapshot);
+  } catch (const EnvoyException& e) {
+    ENVOY_LOG(warn, "unable to load config snapshot {}: {}", snapshot_path, e.what());
+    return false;
+  }
+  return true;
+}
+
+void SnapshotStore::store(const std::string& name,
+                          const envoy::api::v2::DiscoveryResponse& snapshot) {
+  // Write next to the snapshot and rename over it, so that a crash or a hot restarted server never
+  // sees half of a snapshot.
+  const std::string snapshot_path = path(name);
+  const std::string temporary_path = fmt::format("{}.{}", snapshot_path, getpid());
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file || !snapshot.SerializeToOstream(&file)) {
+      ENVOY_LOG(warn, "unable to write config snapshot {}", temporary_path);
+      return;
+    }
+  }
+  if (::rename(temporary_path.c_str(), snapshot_path.c_str()) != 0) {
+    ENVOY_LOG(warn, "unable to replace config snapshot {}", snapshot_path);
+    ::unlink(temporary_path.c_str());
+    return;
+  }
+  ENVOY_LOG(debug, "wrote config snapshot {}", snapshot_path);
+}
+
+} // namespace Config
+} // namespace Envoy
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+
+#include "common/common/logger.h"
+
+#include "api/base.pb.h"
+
+namespace Envoy {
+namespace Config {
+
+/**
+ * Keeps the last accepted configuration on disk as binary protobuf, so that a restarted server can
+ * serve it without translating JSON or waiting for the management server. A snapshot is a
+ * DiscoveryResponse whose resources are the configuration, and whose version_info is up to the
+ * writer. Snapshots are only an optimization, so failing to write one is logged and otherwise
+ * ignored.
+ *
+ * The directory is process wide, and is set once at startup before any subscription is created.
+ */
+class SnapshotStore : Logger::Loggable<Logger::Id::config> {
+public:
+  /**
+   * @param directory supplies the directory that snapshots are kept in. Empty disables snapshots.
+   */
+  static void setDirectory(const std::string& directory) { directory_ = directory; }
+
+  /**
+   * @return bool whether snapshots are kept.
+   */
+  static bool enabled() { return !directory_.empty(); }
+
+  /**
+   * Load a snapshot.
+   * @param name supplies the name of the snapshot.
+   * @param snapshot receives the snapshot.
+   * @return bool whether the snapshot exists and could be parsed.
+   */
+  static bool load(const std::string& name, envoy::api::v2::DiscoveryResponse& snapshot);
+
+  /**
+   * Replace a snapshot. Readers see either the previous snapshot or the new one.
+   * @param name supplies the name of the snapshot.
+   * @param snapshot supplies the snapshot.
+   */
+  static void store(const std::string& name, const envoy::api::v2::DiscoveryResponse& snapshot);
+
+private:
+  static std::string path(const std::string& name) { return directory_ + "/" + name + ".pb"; }
+
+  static std::string directory_;
+};
+
+} // namespace Config
+} // namespace Envoy
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/config/subscription.h"
+
+#include "common/common/assert.h"
+#include "common/common/hash.h"
+#include "common/common/logger.h"
+#include "common/common/utility.h"
+#include "common/config/snapshot_store.h"
+#include "common/config/utility.h"
+#include "common/protobuf/utility.h"
+
+#include "api/base.pb.h"
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Config {
+
+/**
+ * Subscription that gives its callbacks the resources it last accepted, as kept in the
+ * SnapshotStore, as soon as it starts, and then whatever the wrapped subscription fetches.
+ * Consumers that wait for their first update, such as CDS, LDS and the init targets of EDS clusters
+ * and RDS route configurations, can then serve the last known good configuration without waiting
+ * for the management server. Each accepted update replaces the snapshot.
+ */
+template <class ResourceType>
+class SnapshotSubscriptionImpl : public Subscription<ResourceType>,
+                                 SubscriptionCallbacks<ResourceType>,
+                                 Logger::Loggable<Logger::Id::config> {
+public:
+  SnapshotSubscriptionImpl(std::unique_ptr<Subscription<ResourceType>>&& subscription)
+      : subscription_(std::move(subscription)) {}
+
+  // Config::Subscription
+  void start(const std::vector<std::string>& resources,
+             SubscriptionCallbacks<ResourceType>& callbacks) override {
+    ASSERT(callbacks_ == nullptr);
+    callbacks_ = &callbacks;
+    // The snapshot is of what the subscription was started with, e.g. the cluster of EDS or the
+    // route configuration of RDS.
+    name_ = fmt::format("{}.{:016x}", ResourceType::descriptor()->full_name(),
+                        HashUtil::xxHash64(StringUtil::join(resources, ",")));
+
+    envoy::api::v2::DiscoveryResponse snapshot;
+    if (SnapshotStore::load(name_, snapshot)) {
+      try {
+        callbacks_->onConfigUpdate(Utility::getTypedResources<ResourceType>(snapshot));
+        snapshot_hash_ = MessageUtil::hash(snapshot);
+        ENVOY_LOG(info, "loaded config snapshot {} with {} resources", name_,
+                  snapshot.resources().size());
+      } catch (const EnvoyException& e) {
+        // The management server still gets to provide the configuration.
+        ENVOY_LOG(warn, "config snapshot {} rejected: {}", name_, e.what());
+      }
+    }
+    subscription_->start(resources, *this);
+  }
+
+  void updateResources(const std::vector<std::string>& resources) override {
+    subscription_->updateResources(resources);
+  }
+
+private:
+  typedef typename SubscriptionCallbacks<ResourceType>::ResourceVector ResourceVector;
+
+  // Config::SubscriptionCallbacks
+  void onConfigUpdate(const ResourceVector& resources) override {
+    // A rejected update throws through, and leaves the snapshot as it is.
+    callbacks_->onConfigUpdate(resources);
+
+    envoy::api::v2::DiscoveryResponse snapshot;
+    for (const ResourceType& resource : resources) {
+      snapshot.add_resources()->PackFrom(resource);
+    }
+    // Management servers commonly resend the same configuration, which is already on disk.
+    const uint64_t hash = MessageUtil::hash(snapshot);
+    if (hash != snapshot_hash_) {
+      SnapshotStore::store(name_, snapshot);
+      snapshot_hash_ = hash;
+    }
+  }
+
+  void onConfigUpdateFailed(const EnvoyException* e) override {
+    callbacks_->onConfigUpdateFailed(e);
+  }
+
+  std::unique_ptr<Subscription<ResourceType>> subscription_;
+  SubscriptionCallbacks<ResourceType>* callbacks_{};
+  std::string name_;
+  uint64_t snapshot_hash_{};
+};
+
+} // namespace Config
+} // namespace Envoy
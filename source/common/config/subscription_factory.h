@@ -5,8 +5,10 @@
 #include "envoy/config/subscription.h"
 
 #include "common/config/filesystem_subscription_impl.h"
-#include "common/config/grpc_subscription_impl.h"
+#include "common/config/grpc_mux_impl.h"
 #include "common/config/http_subscription_impl.h"
+#include "common/config/snapshot_store.h"
+#include "common/config/snapshot_subscription_impl.h"
 #include "common/config/utility.h"
 #include "common/protobuf/protobuf.h"
 
@@ -64,13 +66,21 @@ public:
             *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(rest_method), stats));
         break;
       case envoy::api::v2::ApiConfigSource::GRPC:
-        result.reset(new GrpcSubscriptionImpl<ResourceType>(
-            node, cm, cluster_name, dispatcher,
-            *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(grpc_method), stats));
+        // Subscriptions to the same management server share a stream.
+        result.reset(new GrpcMuxSubscriptionImpl<ResourceType>(
+            GrpcMuxImpl<ResourceType>::get(
+                node, cm, cluster_name, dispatcher,
+                *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(grpc_method)),
+            stats));
         break;
       default:
         NOT_REACHED;
       }
+      // Configuration from a management server is kept in a snapshot, so that a restart does not
+      // wait for it. Configuration from a file is read at start anyway.
+      if (SnapshotStore::enabled()) {
+        result.reset(new SnapshotSubscriptionImpl<ResourceType>(std::move(result)));
+      }
       break;
     }
     default:
@@ -1,5 +1,6 @@
 #include "common/dynamo/dynamo_filter.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <string>
@@ -11,16 +12,50 @@
 #include "common/http/codes.h"
 #include "common/http/exception.h"
 #include "common/http/utility.h"
-#include "common/json/json_loader.h"
 
 #include "spdlog/spdlog.h"
 
 namespace Envoy {
 namespace Dynamo {
 
+EntityStats::EntityStats(Stats::Scope& scope, const std::string& prefix, const std::string& name)
+    : scope_(scope), name_(name), upstream_rq_total_(scope.counter(prefix + "upstream_rq_total")),
+      upstream_rq_total_codes_(scope, prefix + "upstream_rq_total_"),
+      upstream_rq_time_(prefix + "upstream_rq_time") {
+  for (uint64_t i = 0; i < NUM_CODE_CLASSES; i++) {
+    upstream_rq_time_classes_[i] =
+        upstream_rq_time_ + "_" +
+        Http::CodeUtility::groupStringForResponseCode(static_cast<Http::Code>(i * 100));
+  }
+}
+
+void EntityStats::charge(uint64_t status, std::chrono::milliseconds latency) {
+  const Http::Code code = static_cast<Http::Code>(status);
+  upstream_rq_total_.inc();
+  upstream_rq_total_codes_.charge(code);
+
+  scope_.deliverTimingToSinks(upstream_rq_time_, latency);
+  // Codes past 5xx have no class, like 1xx codes.
+  scope_.deliverTimingToSinks(
+      upstream_rq_time_classes_[status < NUM_CODE_CLASSES * 100 ? status / 100 : 0], latency);
+  scope_.deliverTimingToSinks(upstream_rq_time_ + "_" + std::to_string(status), latency);
+}
+
+DynamoStats::DynamoStats(Stats::Scope& scope, const std::string& stat_prefix,
+                         ThreadLocal::SlotAllocator& tls)
+    : operations_(tls, MAX_OPERATIONS, "overflow",
+                  [&scope, stat_prefix](const std::string& name) -> EntityStats* {
+                    return new EntityStats(scope, stat_prefix + "dynamodb.operation." + name + ".",
+                                           name);
+                  }),
+      tables_(tls, MAX_TABLES, "overflow",
+              [&scope, stat_prefix](const std::string& name) -> EntityStats* {
+                return new EntityStats(scope, stat_prefix + "dynamodb.table." + name + ".", name);
+              }) {}
+
 Http::FilterHeadersStatus DynamoFilter::decodeHeaders(Http::HeaderMap& headers, bool) {
   if (enabled_) {
-    start_decode_ = std::chrono::steady_clock::now();
+    start_decode_ = decoder_callbacks_->dispatcher().approximateMonotonicTime().currentTime();
     operation_ = RequestParser::parseOperation(headers);
   }
 
@@ -49,11 +84,10 @@ Http::FilterTrailersStatus DynamoFilter::decodeTrailers(Http::HeaderMap&) {
 }
 
 void DynamoFilter::onDecodeComplete(const Buffer::Instance& data) {
-  std::string body = buildBody(decoder_callbacks_->decodingBuffer(), data);
+  std::vector<Buffer::RawSlice> body = bodySlices(decoder_callbacks_->decodingBuffer(), data);
   if (!body.empty()) {
     try {
-      Json::ObjectSharedPtr json_body = Json::Factory::loadFromString(body);
-      table_descriptor_ = RequestParser::parseTable(operation_, *json_body);
+      table_descriptor_ = RequestParser::parseTable(operation_, body);
     } catch (const Json::Exception& jsonEx) {
       // Body parsing failed. This should not happen, just put a stat for that.
       scope_.counter(fmt::format("{}invalid_req_body", stat_prefix_)).inc();
@@ -69,20 +103,20 @@ void DynamoFilter::onEncodeComplete(const Buffer::Instance& data) {
   uint64_t status = Http::Utility::getResponseStatus(*response_headers_);
   chargeBasicStats(status);
 
-  std::string body = buildBody(encoder_callbacks_->encodingBuffer(), data);
+  std::vector<Buffer::RawSlice> body = bodySlices(encoder_callbacks_->encodingBuffer(), data);
   if (!body.empty()) {
     try {
-      Json::ObjectSharedPtr json_body = Json::Factory::loadFromString(body);
-      chargeTablePartitionIdStats(*json_body);
+      const RequestParser::ResponseDescriptor response = RequestParser::parseResponse(body);
+      chargeTablePartitionIdStats(response);
 
       if (Http::CodeUtility::is4xx(status)) {
-        chargeFailureSpecificStats(*json_body);
+        chargeFailureSpecificStats(response);
       }
       // Batch Operations will always return status 200 for a partial or full success. Check
       // unprocessed keys to determine partial success.
       // http://docs.aws.amazon.com/amazondynamodb/latest/developerguide/Programming.Errors.html#Programming.Errors.BatchOperations
       if (RequestParser::isBatchOperation(operation_)) {
-        chargeUnProcessedKeysStats(*json_body);
+        chargeUnProcessedKeysStats(response);
       }
     } catch (const Json::Exception&) {
       // Body parsing failed. This should not happen, just put a stat for that.
@@ -125,37 +159,39 @@ Http::FilterTrailersStatus DynamoFilter::encodeTrailers(Http::HeaderMap&) {
   return Http::FilterTrailersStatus::Continue;
 }
 
-std::string DynamoFilter::buildBody(const Buffer::Instance* buffered,
-                                    const Buffer::Instance& last) {
-  std::string body;
-  if (buffered) {
-    uint64_t num_slices = buffered->getRawSlices(nullptr, 0);
-    Buffer::RawSlice slices[num_slices];
-    buffered->getRawSlices(slices, num_slices);
-    for (Buffer::RawSlice& slice : slices) {
-      body.append(static_cast<const char*>(slice.mem_), slice.len_);
+std::vector<Buffer::RawSlice> DynamoFilter::bodySlices(const Buffer::Instance* buffered,
+                                                       const Buffer::Instance& last) {
+  // The body is parsed where it is, rather than copied into one string.
+  std::vector<Buffer::RawSlice> slices;
+  for (const Buffer::Instance* data : {buffered, &last}) {
+    if (!data) {
+      continue;
     }
+    const uint64_t num_slices = data->getRawSlices(nullptr, 0);
+    const uint64_t first = slices.size();
+    slices.resize(first + num_slices);
+    data->getRawSlices(slices.data() + first, num_slices);
   }
 
-  uint64_t num_slices = last.getRawSlices(nullptr, 0);
-  Buffer::RawSlice slices[num_slices];
-  last.getRawSlices(slices, num_slices);
-  for (Buffer::RawSlice& slice : slices) {
-    body.append(static_cast<const char*>(slice.mem_), slice.len_);
-  }
-
-  return body;
+  // An empty body is not parsed.
+  slices.erase(std::remove_if(slices.begin(), slices.end(),
+                              [](const Buffer::RawSlice& slice) { return slice.len_ == 0; }),
+               slices.end());
+  return slices;
 }
 
 void DynamoFilter::chargeBasicStats(uint64_t status) {
+  std::chrono::milliseconds latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+      decoder_callbacks_->dispatcher().approximateMonotonicTime().currentTime() - start_decode_);
+
   if (!operation_.empty()) {
-    chargeStatsPerEntity(operation_, "operation", status);
+    stats_->operation(operation_).charge(status, latency);
   } else {
     scope_.counter(fmt::format("{}operation_missing", stat_prefix_)).inc();
   }
 
   if (!table_descriptor_.table_name.empty()) {
-    chargeStatsPerEntity(table_descriptor_.table_name, "table", status);
+    stats_->table(table_descriptor_.table_name).charge(status, latency);
   } else if (table_descriptor_.is_single_table) {
     scope_.counter(fmt::format("{}table_missing", stat_prefix_)).inc();
   } else {
@@ -163,56 +199,29 @@ void DynamoFilter::chargeBasicStats(uint64_t status) {
   }
 }
 
-void DynamoFilter::chargeStatsPerEntity(const std::string& entity, const std::string& entity_type,
-                                        uint64_t status) {
-  std::chrono::milliseconds latency = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::steady_clock::now() - start_decode_);
-
-  std::string group_string =
-      Http::CodeUtility::groupStringForResponseCode(static_cast<Http::Code>(status));
-
-  scope_.counter(fmt::format("{}{}.{}.upstream_rq_total", stat_prefix_, entity_type, entity)).inc();
-  scope_
-      .counter(fmt::format("{}{}.{}.upstream_rq_total_{}", stat_prefix_, entity_type, entity,
-                           group_string))
-      .inc();
-  scope_
-      .counter(fmt::format("{}{}.{}.upstream_rq_total_{}", stat_prefix_, entity_type, entity,
-                           std::to_string(status)))
-      .inc();
-
-  scope_.deliverTimingToSinks(
-      fmt::format("{}{}.{}.upstream_rq_time", stat_prefix_, entity_type, entity), latency);
-  scope_.deliverTimingToSinks(
-      fmt::format("{}{}.{}.upstream_rq_time_{}", stat_prefix_, entity_type, entity, group_string),
-      latency);
-  scope_.deliverTimingToSinks(fmt::format("{}{}.{}.upstream_rq_time_{}", stat_prefix_, entity_type,
-                                          entity, std::to_string(status)),
-                              latency);
-}
-
-void DynamoFilter::chargeUnProcessedKeysStats(const Json::Object& json_body) {
+void DynamoFilter::chargeUnProcessedKeysStats(
+    const RequestParser::ResponseDescriptor& response) {
   // The unprocessed keys block contains a list of tables and keys for that table that did not
   // complete apart of the batch operation. Only the table names will be logged for errors.
-  std::vector<std::string> unprocessed_tables = RequestParser::parseBatchUnProcessedKeys(json_body);
-  for (const std::string& unprocessed_table : unprocessed_tables) {
+  for (const std::string& unprocessed_table : response.unprocessed_tables) {
     scope_
-        .counter(
-            fmt::format("{}error.{}.BatchFailureUnprocessedKeys", stat_prefix_, unprocessed_table))
+        .counter(fmt::format("{}error.{}.BatchFailureUnprocessedKeys", stat_prefix_,
+                             stats_->table(unprocessed_table).name()))
         .inc();
   }
 }
 
-void DynamoFilter::chargeFailureSpecificStats(const Json::Object& json_body) {
-  std::string error_type = RequestParser::parseErrorType(json_body);
+void DynamoFilter::chargeFailureSpecificStats(
+    const RequestParser::ResponseDescriptor& response) {
+  const std::string& error_type = response.error_type;
 
   if (!error_type.empty()) {
     if (table_descriptor_.table_name.empty()) {
       scope_.counter(fmt::format("{}error.no_table.{}", stat_prefix_, error_type)).inc();
     } else {
       scope_
-          .counter(
-              fmt::format("{}error.{}.{}", stat_prefix_, table_descriptor_.table_name, error_type))
+          .counter(fmt::format("{}error.{}.{}", stat_prefix_,
+                               stats_->table(table_descriptor_.table_name).name(), error_type))
           .inc();
     }
   } else {
@@ -220,16 +229,17 @@ void DynamoFilter::chargeFailureSpecificStats(const Json::Object& json_body) {
   }
 }
 
-void DynamoFilter::chargeTablePartitionIdStats(const Json::Object& json_body) {
+void DynamoFilter::chargeTablePartitionIdStats(
+    const RequestParser::ResponseDescriptor& response) {
   if (table_descriptor_.table_name.empty() || operation_.empty()) {
     return;
   }
 
-  std::vector<RequestParser::PartitionDescriptor> partitions =
-      RequestParser::parsePartitions(json_body);
-  for (const RequestParser::PartitionDescriptor& partition : partitions) {
-    std::string scope_string = Utility::buildPartitionStatString(
-        stat_prefix_, table_descriptor_.table_name, operation_, partition.partition_id_);
+  const std::string& table = stats_->table(table_descriptor_.table_name).name();
+  const std::string& operation = stats_->operation(operation_).name();
+  for (const RequestParser::PartitionDescriptor& partition : response.partitions) {
+    std::string scope_string = Utility::buildPartitionStatString(stat_prefix_, table, operation,
+                                                                 partition.partition_id_);
     scope_.counter(scope_string).add(partition.capacity_);
   }
 }
@@ -1,18 +1,75 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "envoy/http/filter.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/stats/stats.h"
+#include "envoy/thread_local/thread_local.h"
 
 #include "common/dynamo/dynamo_request_parser.h"
-#include "common/json/json_loader.h"
+#include "common/http/codes.h"
+#include "common/stats/dynamic_stat_family.h"
 
 namespace Envoy {
 namespace Dynamo {
 
+/**
+ * Prebuilt stats of a single operation or table.
+ */
+class EntityStats {
+public:
+  EntityStats(Stats::Scope& scope, const std::string& prefix, const std::string& name);
+
+  /**
+   * Charge a response and its latency.
+   */
+  void charge(uint64_t status, std::chrono::milliseconds latency);
+
+  /**
+   * @return const std::string& the name of the operation or table in stat names.
+   */
+  const std::string& name() const { return name_; }
+
+private:
+  // Response code classes 1xx through 5xx are indexed by code / 100.
+  static const uint64_t NUM_CODE_CLASSES = 6;
+
+  Stats::Scope& scope_;
+  const std::string name_;
+  Stats::Counter& upstream_rq_total_;
+  Http::CodeCounterTable upstream_rq_total_codes_;
+  const std::string upstream_rq_time_;
+  std::string upstream_rq_time_classes_[NUM_CODE_CLASSES];
+};
+
+/**
+ * The stats that are named after operations and tables, shared by all the filters of a filter
+ * chain. Operation and table names come from requests, so the number of names that get stats of
+ * their own is bounded. Other names are charged to the "overflow" operation or table.
+ */
+class DynamoStats {
+public:
+  DynamoStats(Stats::Scope& scope, const std::string& stat_prefix,
+              ThreadLocal::SlotAllocator& tls);
+
+  EntityStats& operation(const std::string& name) { return operations_.get(name); }
+  EntityStats& table(const std::string& name) { return tables_.get(name); }
+
+  static const uint32_t MAX_OPERATIONS = 256;
+  static const uint32_t MAX_TABLES = 1024;
+
+private:
+  Stats::DynamicStatFamily<EntityStats> operations_;
+  Stats::DynamicStatFamily<EntityStats> tables_;
+};
+
+typedef std::shared_ptr<DynamoStats> DynamoStatsSharedPtr;
+
 /**
  * DynamoDb filter to process egress request to dynamo and capture comprehensive stats
  * It captures RPS/latencies:
@@ -21,8 +78,9 @@ namespace Dynamo {
  */
 class DynamoFilter : public Http::StreamFilter {
 public:
-  DynamoFilter(Runtime::Loader& runtime, const std::string& stat_prefix, Stats::Scope& scope)
-      : runtime_(runtime), stat_prefix_(stat_prefix + "dynamodb."), scope_(scope) {
+  DynamoFilter(Runtime::Loader& runtime, const std::string& stat_prefix, Stats::Scope& scope,
+               DynamoStatsSharedPtr stats)
+      : runtime_(runtime), stat_prefix_(stat_prefix + "dynamodb."), scope_(scope), stats_(stats) {
     enabled_ = runtime_.snapshot().featureEnabled("dynamodb.filter_enabled", 100);
   }
 
@@ -48,17 +106,17 @@ public:
 private:
   void onDecodeComplete(const Buffer::Instance& data);
   void onEncodeComplete(const Buffer::Instance& data);
-  std::string buildBody(const Buffer::Instance* buffered, const Buffer::Instance& last);
+  static std::vector<Buffer::RawSlice> bodySlices(const Buffer::Instance* buffered,
+                                                  const Buffer::Instance& last);
   void chargeBasicStats(uint64_t status);
-  void chargeStatsPerEntity(const std::string& entity, const std::string& entity_type,
-                            uint64_t status);
-  void chargeFailureSpecificStats(const Json::Object& json_body);
-  void chargeUnProcessedKeysStats(const Json::Object& json_body);
-  void chargeTablePartitionIdStats(const Json::Object& json_body);
+  void chargeFailureSpecificStats(const RequestParser::ResponseDescriptor& response);
+  void chargeUnProcessedKeysStats(const RequestParser::ResponseDescriptor& response);
+  void chargeTablePartitionIdStats(const RequestParser::ResponseDescriptor& response);
 
   Runtime::Loader& runtime_;
   std::string stat_prefix_;
   Stats::Scope& scope_;
+  DynamoStatsSharedPtr stats_;
 
   bool enabled_{};
   std::string operation_{};
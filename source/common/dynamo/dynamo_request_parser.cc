@@ -1,14 +1,187 @@
 #include "common/dynamo/dynamo_request_parser.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#include "common/common/assert.h"
 #include "common/common/utility.h"
 
+#include "rapidjson/error/en.h"
+#include "rapidjson/reader.h"
+#include "spdlog/spdlog.h"
+
 namespace Envoy {
 namespace Dynamo {
+namespace {
+
+/**
+ * rapidjson input stream over the slices of a body.
+ */
+class SliceStream {
+public:
+  typedef char Ch;
+
+  SliceStream(const std::vector<Buffer::RawSlice>& slices) : slices_(slices) { skipEmpty(); }
+
+  Ch Peek() const {
+    return slice_ < slices_.size() ? static_cast<const Ch*>(slices_[slice_].mem_)[offset_] : '\0';
+  }
+
+  Ch Take() {
+    if (slice_ == slices_.size()) {
+      return '\0';
+    }
+    const Ch c = static_cast<const Ch*>(slices_[slice_].mem_)[offset_];
+    tell_++;
+    if (++offset_ == slices_[slice_].len_) {
+      slice_++;
+      offset_ = 0;
+      skipEmpty();
+    }
+    return c;
+  }
+
+  size_t Tell() const { return tell_; }
+
+  // Only used for in situ parsing, which is not used.
+  Ch* PutBegin() { NOT_REACHED; }
+  void Put(Ch) { NOT_REACHED; }
+  void Flush() { NOT_REACHED; }
+  size_t PutEnd(Ch*) { NOT_REACHED; }
+
+private:
+  void skipEmpty() {
+    while (slice_ < slices_.size() && slices_[slice_].len_ == 0) {
+      slice_++;
+    }
+  }
+
+  const std::vector<Buffer::RawSlice>& slices_;
+  size_t slice_{};
+  uint64_t offset_{};
+  size_t tell_{};
+};
+
+/**
+ * Consume events from SAX callbacks to pick out the fields of a request or response body that
+ * stats are charged for. Everything else is skipped without being copied. All the fields are at
+ * most three objects deep:
+ *   {"TableName": "...", "__type": "...",
+ *    "RequestItems": {"<table>": ...}, "UnprocessedKeys": {"<table>": ...},
+ *    "ConsumedCapacity": {"Partitions": {"<partition>": <capacity>}}}
+ */
+class FieldHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, FieldHandler> {
+public:
+  bool StartObject() {
+    objects_.push_back(true);
+    return true;
+  }
+  bool EndObject(rapidjson::SizeType) {
+    objects_.pop_back();
+    return true;
+  }
+  bool StartArray() {
+    objects_.push_back(false);
+    return true;
+  }
+  bool EndArray(rapidjson::SizeType) {
+    objects_.pop_back();
+    return true;
+  }
+
+  bool Key(const char* value, rapidjson::SizeType size, bool) {
+    // Keys only come from objects, so the innermost container is an object.
+    if (!objects_[0]) {
+      return true;
+    }
+
+    switch (objects_.size()) {
+    case 1:
+      top_key_.assign(value, size);
+      break;
+    case 2:
+      if (top_key_ == "RequestItems") {
+        addUnique(request_tables_, std::string(value, size));
+      } else if (top_key_ == "UnprocessedKeys") {
+        addUnique(unprocessed_tables_, std::string(value, size));
+      } else if (top_key_ == "ConsumedCapacity") {
+        second_key_.assign(value, size);
+      }
+      break;
+    case 3:
+      if (inPartitions()) {
+        partition_key_.assign(value, size);
+      }
+      break;
+    }
+    return true;
+  }
+
+  bool String(const char* value, rapidjson::SizeType size, bool) {
+    if (objects_.size() == 1 && objects_[0]) {
+      if (top_key_ == "TableName") {
+        table_name_.assign(value, size);
+      } else if (top_key_ == "__type") {
+        error_type_.assign(value, size);
+      }
+    }
+    return true;
+  }
+
+  bool Double(double value) {
+    if (objects_.size() == 3 && inPartitions()) {
+      partitions_.emplace_back(partition_key_, static_cast<uint64_t>(std::ceil(value)));
+    }
+    return true;
+  }
+  bool Int(int value) { return Double(value); }
+  bool Uint(unsigned value) { return Double(value); }
+  bool Int64(int64_t value) { return Double(value); }
+  bool Uint64(uint64_t value) { return Double(value); }
+
+  std::string table_name_;
+  std::vector<std::string> request_tables_;
+  std::string error_type_;
+  std::vector<std::string> unprocessed_tables_;
+  std::vector<RequestParser::PartitionDescriptor> partitions_;
+
+private:
+  // Whether the innermost container is the object of ConsumedCapacity.Partitions.
+  bool inPartitions() const {
+    return objects_[0] && objects_[1] && top_key_ == "ConsumedCapacity" &&
+           second_key_ == "Partitions";
+  }
+
+  // Objects may repeat a key, which only counts once.
+  static void addUnique(std::vector<std::string>& values, std::string&& value) {
+    if (std::find(values.begin(), values.end(), value) == values.end()) {
+      values.push_back(std::move(value));
+    }
+  }
+
+  // Whether each open container is an object, outermost first.
+  std::vector<bool> objects_;
+  std::string top_key_;
+  std::string second_key_;
+  std::string partition_key_;
+};
+
+void parseFields(const std::vector<Buffer::RawSlice>& body, FieldHandler& handler) {
+  SliceStream stream(body);
+  rapidjson::Reader reader;
+  reader.Parse(stream, handler);
+
+  if (reader.HasParseError()) {
+    throw Json::Exception(fmt::format("JSON supplied is not valid. Error(offset {}): {}\n",
+                                      reader.GetErrorOffset(),
+                                      GetParseError_En(reader.GetParseErrorCode())));
+  }
+}
+
+} // namespace
 
 /*
  * Basic json request/response format:
@@ -65,56 +238,46 @@ std::string RequestParser::parseOperation(const Http::HeaderMap& headerMap) {
   return operation;
 }
 
-RequestParser::TableDescriptor RequestParser::parseTable(const std::string& operation,
-                                                         const Json::Object& json_data) {
+RequestParser::TableDescriptor
+RequestParser::parseTable(const std::string& operation, const std::vector<Buffer::RawSlice>& body) {
+  FieldHandler fields;
+  parseFields(body, fields);
   TableDescriptor table{"", true};
 
   // Simple operations on a single table, have "TableName" explicitly specified.
   if (find(SINGLE_TABLE_OPERATIONS.begin(), SINGLE_TABLE_OPERATIONS.end(), operation) !=
       SINGLE_TABLE_OPERATIONS.end()) {
-    table.table_name = json_data.getString("TableName", "");
+    table.table_name = fields.table_name_;
   } else if (find(BATCH_OPERATIONS.begin(), BATCH_OPERATIONS.end(), operation) !=
              BATCH_OPERATIONS.end()) {
-    Json::ObjectSharedPtr tables = json_data.getObject("RequestItems", true);
-    tables->iterate([&table](const std::string& key, const Json::Object&) {
-      if (table.table_name.empty()) {
-        table.table_name = key;
-      } else {
-        if (table.table_name != key) {
-          table.table_name = "";
-          table.is_single_table = false;
-          return false;
-        }
-      }
-      return true;
-    });
+    if (fields.request_tables_.size() == 1) {
+      table.table_name = fields.request_tables_[0];
+    } else if (fields.request_tables_.size() > 1) {
+      table.is_single_table = false;
+    }
   }
 
   return table;
 }
-std::vector<std::string> RequestParser::parseBatchUnProcessedKeys(const Json::Object& json_data) {
-  std::vector<std::string> unprocessed_tables;
-  Json::ObjectSharedPtr tables = json_data.getObject("UnprocessedKeys", true);
-  tables->iterate([&unprocessed_tables](const std::string& key, const Json::Object&) {
-    unprocessed_tables.emplace_back(key);
-    return true;
-  });
 
-  return unprocessed_tables;
-}
-std::string RequestParser::parseErrorType(const Json::Object& json_data) {
-  std::string error_type = json_data.getString("__type", "");
-  if (error_type.empty()) {
-    return "";
-  }
+RequestParser::ResponseDescriptor
+RequestParser::parseResponse(const std::vector<Buffer::RawSlice>& body) {
+  FieldHandler fields;
+  parseFields(body, fields);
+  ResponseDescriptor response;
+  response.unprocessed_tables.swap(fields.unprocessed_tables_);
+  response.partitions.swap(fields.partitions_);
 
-  for (const std::string& supported_error_type : SUPPORTED_ERROR_TYPES) {
-    if (StringUtil::endsWith(error_type, supported_error_type)) {
-      return supported_error_type;
+  if (!fields.error_type_.empty()) {
+    for (const std::string& supported_error_type : SUPPORTED_ERROR_TYPES) {
+      if (StringUtil::endsWith(fields.error_type_, supported_error_type)) {
+        response.error_type = supported_error_type;
+        break;
+      }
     }
   }
 
-  return "";
+  return response;
 }
 
 bool RequestParser::isBatchOperation(const std::string& operation) {
@@ -122,25 +285,5 @@ bool RequestParser::isBatchOperation(const std::string& operation) {
          BATCH_OPERATIONS.end();
 }
 
-std::vector<RequestParser::PartitionDescriptor>
-RequestParser::parsePartitions(const Json::Object& json_data) {
-  std::vector<RequestParser::PartitionDescriptor> partition_descriptors;
-
-  Json::ObjectSharedPtr partitions =
-      json_data.getObject("ConsumedCapacity", true)->getObject("Partitions", true);
-  partitions->iterate([&partition_descriptors, &partitions](const std::string& key,
-                                                            const Json::Object&) {
-    // For a given partition id, the amount of capacity used is returned in the body as a double.
-    // A stat will be created to track the capacity consumed for the operation, table and partition.
-    // Stats counter only increments by whole numbers, capacity is round up to the nearest integer
-    // to account for this.
-    uint64_t capacity_integer = static_cast<uint64_t>(std::ceil(partitions->getDouble(key, 0.0)));
-    partition_descriptors.emplace_back(key, capacity_integer);
-    return true;
-  });
-
-  return partition_descriptors;
-}
-
 } // namespace Dynamo
 } // namespace Envoy
@@ -4,9 +4,9 @@
 #include <string>
 #include <vector>
 
+#include "envoy/buffer/buffer.h"
 #include "envoy/http/header_map.h"
-
-#include "common/json/json_loader.h"
+#include "envoy/json/json_object.h"
 
 namespace Envoy {
 namespace Dynamo {
@@ -16,6 +16,9 @@ namespace Dynamo {
  *
  * Basic dynamodb json request/response format:
  * http://docs.aws.amazon.com/amazondynamodb/latest/developerguide/Appendix.CurrentAPI.html
+ *
+ * Bodies are read in place with a SAX parser, which only keeps the few fields needed for stats
+ * instead of building a document of the whole body.
  */
 class RequestParser {
 public:
@@ -39,56 +42,55 @@ public:
   static std::string parseOperation(const Http::HeaderMap& headerMap);
 
   /**
-   * Parse table name out of data, based on the operation.
+   * The parts of a response body that stats are charged for.
+   */
+  struct ResponseDescriptor {
+    // Empty if there is no error, or if it is not one of SUPPORTED_ERROR_TYPES.
+    std::string error_type;
+    // Tables with unprocessed keys, for the results of batch operations.
+    std::vector<std::string> unprocessed_tables;
+    std::vector<PartitionDescriptor> partitions;
+  };
+
+  /**
+   * Parse table name out of a request body, based on the operation.
+   * @param body supplies the slices of the body, in order.
    * @return empty string as TableDescriptor.table_name if table name cannot be parsed out of valid
-   *json data
-   * or if operation is not in the list of operations that we support.
+   * json data or if operation is not in the list of operations that we support.
    *
    * For simple operations on single table, e.g., GetItem, PutItem, Query etc @return table
    * name in TableDescriptor.table_name.
    *
    * For batch operations, e.g. BatchGetItem/BatchWriteItem, @return table name in
-   *TableDescriptor.table_name if it's only one
-   * table used in all operations, @return empty string in TableDescriptor.table_name and
-   *TableDescriptor.is_single_table=false in case of multiple.
+   * TableDescriptor.table_name if it's only one table used in all operations, @return empty string
+   * in TableDescriptor.table_name and TableDescriptor.is_single_table=false in case of multiple.
    *
    * @throw Json::Exception if data is not in valid Json format.
    */
-  static TableDescriptor parseTable(const std::string& operation, const Json::Object& json_data);
+  static TableDescriptor parseTable(const std::string& operation,
+                                    const std::vector<Buffer::RawSlice>& body);
 
   /**
-   * Parse error details which might be provided for a given response code.
-   * @return empty string if cannot get error details.
+   * Parse the error type, the tables with unprocessed keys and the partitions with their consumed
+   * capacity out of a response body.
    * For the full list of errors, see
    * http://docs.aws.amazon.com/amazondynamodb/latest/APIReference/CommonErrors.html
    * Operation specific errors, for example, error section of
    * http://docs.aws.amazon.com/amazondynamodb/latest/APIReference/API_UpdateItem.html
    *
+   * The capacity consumed by a partition is rounded up to an integer, since stats counters only
+   * increment by whole numbers.
+   *
+   * @param body supplies the slices of the body, in order.
    * @throw Json::Exception if data is not in valid Json format.
    */
-  static std::string parseErrorType(const Json::Object& json_data);
-
-  /**
-   * Parse unprocessed keys for batch operation results.
-   * @return empty set if there are no unprocessed keys or a set of table names that did not get
-   * processed in the batch operation.
-   */
-  static std::vector<std::string> parseBatchUnProcessedKeys(const Json::Object& json_data);
+  static ResponseDescriptor parseResponse(const std::vector<Buffer::RawSlice>& body);
 
   /**
    * @return true if the operation is in the set of supported BATCH_OPERATIONS
    */
   static bool isBatchOperation(const std::string& operation);
 
-  /**
-   * Parse the Partition ids and the consumed capacity from the body.
-   * @return empty set if there is no partition data or a set of partition data containing
-   * the partition id as a string and the capacity consumed as an integer.
-   *
-   * @throw Json::Exception if data is not in valid Json format.
-   */
-  static std::vector<PartitionDescriptor> parsePartitions(const Json::Object& json_data);
-
 private:
   static const Http::LowerCaseString X_AMZ_TARGET;
   static const std::vector<std::string> SINGLE_TABLE_OPERATIONS;
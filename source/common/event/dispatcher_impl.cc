@@ -1,9 +1,13 @@
 #include "common/event/dispatcher_impl.h"
 
+#include <cxxabi.h>
+
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
-#include <mutex>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -11,6 +15,8 @@
 #include "envoy/network/listener.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
+#include "common/common/utility.h"
 #include "common/event/file_event_impl.h"
 #include "common/event/signal_impl.h"
 #include "common/event/timer_impl.h"
@@ -25,16 +31,100 @@
 namespace Envoy {
 namespace Event {
 
+namespace {
+
+// Written once at startup before any worker exists, then only read.
+bool use_epoll_changelist = false;
+
+Libevent::BasePtr createBase() {
+  // With the epoll backend, the changelist defers the epoll_ctl() calls made while enabling and
+  // disabling events until the next epoll_wait(). Changes that cancel out within one loop
+  // iteration, such as a write event that is activated and then flushed, never reach the kernel,
+  // and the remaining ones are applied in a single pass. libevent documents the changelist as
+  // unsafe when a watched fd is dup()'d, or closed and reused while changes are pending, so it is
+  // opt-in. Other backends ignore the flag.
+  event_config* config = event_config_new();
+  RELEASE_ASSERT(config != nullptr);
+  if (use_epoll_changelist) {
+    event_config_set_flag(config, EVENT_BASE_FLAG_EPOLL_USE_CHANGELIST);
+  }
+  event_base* base = event_base_new_with_config(config);
+  event_config_free(config);
+  RELEASE_ASSERT(base != nullptr);
+  return Libevent::BasePtr{base};
+}
+
+std::string demangle(const char* name) {
+  int status;
+  char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  if (status != 0) {
+    return name;
+  }
+
+  std::string result(demangled);
+  free(demangled);
+  return result;
+}
+
+} // namespace
+
+const size_t SlowCallbackLog::MAX_ENTRIES;
+
+void SlowCallbackLog::add(Entry&& entry) {
+  std::unique_lock<std::mutex> lock(lock_);
+  entries_.emplace_back(std::move(entry));
+  if (entries_.size() > MAX_ENTRIES) {
+    entries_.pop_front();
+  }
+}
+
+std::list<SlowCallbackLog::Entry> SlowCallbackLog::entries() const {
+  std::unique_lock<std::mutex> lock(lock_);
+  return entries_;
+}
+
+SlowCallbackLog& SlowCallbackLog::instance() {
+  static SlowCallbackLog* instance = new SlowCallbackLog();
+  return *instance;
+}
+
+const std::chrono::milliseconds DispatcherImpl::SLOW_CALLBACK_DURATION(10);
+const std::chrono::milliseconds DispatcherImpl::LOOP_DELAY_PROBE_INTERVAL(100);
+const uint32_t DispatcherImpl::LOOP_DELAY_WINDOW_PROBES;
+
+void LoopTime::update() {
+  timeval now;
+  event_base_gettimeofday_cached(&base_, &now);
+  if (now.tv_sec == cached_.tv_sec && now.tv_usec == cached_.tv_usec) {
+    return;
+  }
+
+  cached_ = now;
+  system_time_ = SystemTime(std::chrono::duration_cast<SystemTime::duration>(
+      std::chrono::seconds(now.tv_sec) + std::chrono::microseconds(now.tv_usec)));
+  monotonic_time_ = std::chrono::steady_clock::now();
+}
+
+void DispatcherImpl::epollChangelist(bool enabled) { use_epoll_changelist = enabled; }
+
 DispatcherImpl::DispatcherImpl()
     : DispatcherImpl(Buffer::FactoryPtr{new Buffer::OwnedImplFactory}) {}
 
 DispatcherImpl::DispatcherImpl(Buffer::FactoryPtr&& factory)
-    : buffer_factory_(std::move(factory)), base_(event_base_new()),
+    : buffer_factory_(std::move(factory)), base_(createBase()),
       deferred_delete_timer_(createTimer([this]() -> void { clearDeferredDeleteList(); })),
       post_timer_(createTimer([this]() -> void { runPostCallbacks(); })),
-      current_to_delete_(&to_delete_1_) {}
-
-DispatcherImpl::~DispatcherImpl() {}
+      timer_wheel_(new TimerWheel(*this, ProdMonotonicTimeSource::instance_)),
+      current_to_delete_(&to_delete_1_), time_source_(ProdMonotonicTimeSource::instance_),
+      loop_time_(*base_) {}
+
+DispatcherImpl::~DispatcherImpl() {
+  PostNode* node = post_head_.exchange(nullptr);
+  while (node != nullptr) {
+    std::unique_ptr<PostNode> to_delete(node);
+    node = node->next_;
+  }
+}
 
 void DispatcherImpl::clearDeferredDeleteList() {
   ASSERT(isThreadSafe());
@@ -127,6 +217,11 @@ TimerPtr DispatcherImpl::createTimer(TimerCb cb) {
   return TimerPtr{new TimerImpl(*this, cb)};
 }
 
+TimerPtr DispatcherImpl::createCoarseTimer(TimerCb cb) {
+  ASSERT(isThreadSafe());
+  return timer_wheel_->createTimer(cb);
+}
+
 void DispatcherImpl::deferredDelete(DeferredDeletablePtr&& to_delete) {
   ASSERT(isThreadSafe());
   current_to_delete_->emplace_back(std::move(to_delete));
@@ -138,20 +233,131 @@ void DispatcherImpl::deferredDelete(DeferredDeletablePtr&& to_delete) {
 
 void DispatcherImpl::exit() { event_base_loopexit(base_.get(), nullptr); }
 
+void DispatcherImpl::initializeStats(Stats::Scope& scope, const std::string& prefix) {
+  ASSERT(stats_scope_ == nullptr);
+  stats_scope_ = &scope;
+  stats_prefix_ = prefix;
+  stats_.reset(new DispatcherStats{ALL_DISPATCHER_STATS(POOL_COUNTER_PREFIX(scope, prefix))});
+
+  // A timer that is due every LOOP_DELAY_PROBE_INTERVAL measures how long events wait for the loop
+  // to get to them.
+  loop_delay_probe_ = createTimer([this]() -> void { onLoopDelayProbe(); });
+  loop_delay_probe_due_ =
+      (time_source_.currentTime() + LOOP_DELAY_PROBE_INTERVAL).time_since_epoch().count();
+  loop_delay_probe_->enableTimer(LOOP_DELAY_PROBE_INTERVAL);
+}
+
+Stats::Gauge* DispatcherImpl::gauge(const std::string& name) {
+  return stats_scope_ != nullptr ? &stats_scope_->gauge(stats_prefix_ + name) : nullptr;
+}
+
+std::chrono::milliseconds DispatcherImpl::loopDelay() {
+  if (stats_ == nullptr) {
+    return std::chrono::milliseconds(0);
+  }
+
+  const MonotonicTime now = time_source_.currentTime();
+  const MonotonicTime due(MonotonicTime::duration(loop_delay_probe_due_.load()));
+  const uint64_t overdue_us =
+      now > due ? std::chrono::duration_cast<std::chrono::microseconds>(now - due).count() : 0;
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::microseconds(std::max(loop_delay_us_.load(), overdue_us)));
+}
+
+void DispatcherImpl::onLoopDelayProbe() {
+  const MonotonicTime now = time_source_.currentTime();
+  const MonotonicTime due(MonotonicTime::duration(loop_delay_probe_due_.load()));
+  const uint64_t delay_us =
+      now > due ? std::chrono::duration_cast<std::chrono::microseconds>(now - due).count() : 0;
+  stats_scope_->deliverHistogramToSinks(stats_prefix_ + "loop_delay_us", delay_us);
+
+  // The delay is kept over two windows so that it does not drop to 0 at the start of a window.
+  window_loop_delay_us_ = std::max(window_loop_delay_us_, delay_us);
+  loop_delay_us_ = std::max(window_loop_delay_us_, previous_window_loop_delay_us_);
+  if (++window_probes_ == LOOP_DELAY_WINDOW_PROBES) {
+    previous_window_loop_delay_us_ = window_loop_delay_us_;
+    window_loop_delay_us_ = 0;
+    window_probes_ = 0;
+  }
+
+  loop_delay_probe_due_ = (now + LOOP_DELAY_PROBE_INTERVAL).time_since_epoch().count();
+  loop_delay_probe_->enableTimer(LOOP_DELAY_PROBE_INTERVAL);
+}
+
+template <class Callback, class... Args>
+void DispatcherImpl::runCallback(const char* kind, const Callback& cb, Args... args) {
+  if (stats_ == nullptr) {
+    cb(args...);
+    return;
+  }
+
+  // The callback may destroy its owner, so its type is looked up beforehand.
+  const std::type_info& origin = cb.target_type();
+  const uint64_t slow_callbacks = slow_callbacks_;
+  const MonotonicTime start = time_source_.currentTime();
+  callback_depth_++;
+  cb(args...);
+  callback_depth_--;
+  const MonotonicTime end = time_source_.currentTime();
+
+  // Only the outermost callback counts towards the busy time, since it includes the ones it ran.
+  if (callback_depth_ == 0) {
+    busy_time_ns_.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+        std::memory_order_relaxed);
+  }
+
+  // A callback that runs other callbacks, like the one that runs posted callbacks, is only logged
+  // if none of the callbacks it ran was.
+  if (slow_callbacks == slow_callbacks_) {
+    onCallbackComplete(kind, origin, start, end);
+  }
+}
+
+void DispatcherImpl::runTimerCallback(const TimerCb& cb) { runCallback("timer", cb); }
+
+void DispatcherImpl::runFileEventCallback(const FileReadyCb& cb, uint32_t events) {
+  runCallback("file_event", cb, events);
+}
+
+void DispatcherImpl::onCallbackComplete(const char* kind, const std::type_info& origin,
+                                        MonotonicTime start, MonotonicTime end) {
+  const std::chrono::microseconds duration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+  if (duration < SLOW_CALLBACK_DURATION) {
+    return;
+  }
+
+  slow_callbacks_++;
+  stats_->slow_callback_.inc();
+  stats_scope_->deliverHistogramToSinks(stats_prefix_ + "slow_callback_us", duration.count());
+  // Demangling is only paid for by callbacks that are already slow.
+  std::string origin_name = demangle(origin.name());
+  ENVOY_LOG(debug, "slow {} callback ({}us): {}", kind, duration.count(), origin_name);
+  SlowCallbackLog::instance().add({ProdSystemTimeSource::instance_.currentTime(), stats_prefix_,
+                                   kind, std::move(origin_name), duration});
+}
+
 SignalEventPtr DispatcherImpl::listenForSignal(int signal_num, SignalCb cb) {
   ASSERT(isThreadSafe());
   return SignalEventPtr{new SignalEventImpl(*this, signal_num, cb)};
 }
 
 void DispatcherImpl::post(std::function<void()> callback) {
-  bool do_post;
-  {
-    std::unique_lock<std::mutex> lock(post_lock_);
-    do_post = post_callbacks_.empty();
-    post_callbacks_.push_back(callback);
+  PostNode* node = new PostNode{std::move(callback), nullptr, MonotonicTime()};
+  if (stats_scope_ != nullptr) {
+    node->posted_at_ = time_source_.currentTime();
   }
-
-  if (do_post) {
+  PostNode* head = post_head_.load(std::memory_order_relaxed);
+  do {
+    node->next_ = head;
+  } while (!post_head_.compare_exchange_weak(head, node, std::memory_order_release,
+                                             std::memory_order_relaxed));
+
+  // Only the post that finds the stack empty wakes up the dispatcher. Any later post before the
+  // stack is taken will be picked up by the same wake up. The node must not be touched anymore
+  // since the dispatcher thread may already have run and freed it.
+  if (head == nullptr) {
     post_timer_->enableTimer(std::chrono::milliseconds(0));
   }
 }
@@ -165,18 +371,59 @@ void DispatcherImpl::run(RunType type) {
   // event_base_once() before some other event, the other event might get called first.
   runPostCallbacks();
 
+  // A blocking loop with stats reports the CPU use of its thread, and as idle time the part of
+  // the run that no callback was running, which is mostly spent in epoll_wait().
+  uint64_t usage_handle = 0;
+  const bool report_usage = type == RunType::Block && stats_ != nullptr;
+  if (report_usage) {
+    const MonotonicTime run_start = time_source_.currentTime();
+    usage_handle = Thread::UsageRegistry::instance().add(
+        stats_prefix_, [this, run_start]() -> std::chrono::nanoseconds {
+          return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     time_source_.currentTime() - run_start) -
+                 std::chrono::nanoseconds(busy_time_ns_.load(std::memory_order_relaxed));
+        });
+  }
+
   event_base_loop(base_.get(), type == RunType::NonBlock ? EVLOOP_NONBLOCK : 0);
+
+  if (report_usage) {
+    Thread::UsageRegistry::instance().remove(usage_handle);
+  }
 }
 
 void DispatcherImpl::runPostCallbacks() {
-  std::unique_lock<std::mutex> lock(post_lock_);
-  while (!post_callbacks_.empty()) {
-    std::function<void()> callback = post_callbacks_.front();
-    post_callbacks_.pop_front();
-
-    lock.unlock();
-    callback();
-    lock.lock();
+  // Take the whole stack at once, then reverse it to run the callbacks in the order they were
+  // posted. Callbacks posted while running are picked up by the next pass.
+  PostNode* stack;
+  while ((stack = post_head_.exchange(nullptr, std::memory_order_acquire)) != nullptr) {
+    PostNode* head = nullptr;
+    uint64_t batch_size = 0;
+    while (stack != nullptr) {
+      PostNode* next = stack->next_;
+      stack->next_ = head;
+      head = stack;
+      stack = next;
+      batch_size++;
+    }
+
+    if (stats_ != nullptr) {
+      stats_scope_->deliverHistogramToSinks(stats_prefix_ + "post_batch_size", batch_size);
+      // The oldest callback of the batch waited the longest.
+      if (head->posted_at_ != MonotonicTime()) {
+        stats_scope_->deliverHistogramToSinks(
+            stats_prefix_ + "post_wait_us",
+            std::chrono::duration_cast<std::chrono::microseconds>(time_source_.currentTime() -
+                                                                  head->posted_at_)
+                .count());
+      }
+    }
+
+    while (head != nullptr) {
+      std::unique_ptr<PostNode> node(head);
+      head = head->next_;
+      runCallback("post", node->callback_);
+    }
   }
 }
 
@@ -1,14 +1,23 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <sys/time.h>
+#include <typeinfo>
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/event/deferred_deletable.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/network/connection_handler.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
 
 #include "common/common/logger.h"
 #include "common/common/thread.h"
@@ -17,6 +26,103 @@
 namespace Envoy {
 namespace Event {
 
+class TimerWheel;
+
+/**
+ * All dispatcher stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_DISPATCHER_STATS(COUNTER)                                                              \
+  COUNTER(slow_callback)
+// clang-format on
+
+/**
+ * Struct definition for all dispatcher stats. @see stats_macros.h
+ */
+struct DispatcherStats {
+  ALL_DISPATCHER_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * The most recent slow callbacks of all dispatchers in the process, for the admin endpoint.
+ */
+class SlowCallbackLog {
+public:
+  struct Entry {
+    SystemTime time_;
+    // The stat prefix of the dispatcher.
+    std::string dispatcher_;
+    // "file_event", "timer" or "post".
+    std::string kind_;
+    // The type of the callback, which for a lambda names the function that created it.
+    std::string origin_;
+    std::chrono::microseconds duration_;
+  };
+
+  void add(Entry&& entry);
+
+  /**
+   * @return std::list<Entry> the logged callbacks, oldest first.
+   */
+  std::list<Entry> entries() const;
+
+  static SlowCallbackLog& instance();
+
+  static const size_t MAX_ENTRIES = 100;
+
+private:
+  mutable std::mutex lock_;
+  std::list<Entry> entries_;
+};
+
+/**
+ * The approximate time of a dispatcher. While the event loop runs callbacks, libevent caches the
+ * system time it read when the wait for events returned. The system time is that cached time, and
+ * the monotonic time is read once for each new cached time, i.e. once per loop iteration. Outside
+ * of callbacks libevent reads the clock on every call, so the time is precise there.
+ */
+class LoopTime {
+public:
+  LoopTime(event_base& base) : base_(base), system_(*this), monotonic_(*this) {}
+
+  SystemTimeSource& system() { return system_; }
+  MonotonicTimeSource& monotonic() { return monotonic_; }
+
+private:
+  struct System : public SystemTimeSource {
+    System(LoopTime& parent) : parent_(parent) {}
+
+    // SystemTimeSource
+    SystemTime currentTime() override {
+      parent_.update();
+      return parent_.system_time_;
+    }
+
+    LoopTime& parent_;
+  };
+
+  struct Monotonic : public MonotonicTimeSource {
+    Monotonic(LoopTime& parent) : parent_(parent) {}
+
+    // MonotonicTimeSource
+    MonotonicTime currentTime() override {
+      parent_.update();
+      return parent_.monotonic_time_;
+    }
+
+    LoopTime& parent_;
+  };
+
+  void update();
+
+  event_base& base_;
+  System system_;
+  Monotonic monotonic_;
+  timeval cached_{};
+  SystemTime system_time_;
+  MonotonicTime monotonic_time_;
+};
+
 /**
  * libevent implementation of Event::Dispatcher.
  */
@@ -26,11 +132,24 @@ public:
   DispatcherImpl(Buffer::FactoryPtr&& factory);
   ~DispatcherImpl();
 
+  /**
+   * Set whether dispatchers created afterwards batch epoll_ctl() calls through the libevent
+   * changelist. Must be called before any worker thread starts. Off by default.
+   */
+  static void epollChangelist(bool enabled);
+
   /**
    * @return event_base& the libevent base.
    */
   event_base& base() { return *base_; }
 
+  /**
+   * Run a timer or file event callback. Once stats have been initialized, callbacks that run for
+   * longer than SLOW_CALLBACK_DURATION are counted and logged.
+   */
+  void runTimerCallback(const TimerCb& cb);
+  void runFileEventCallback(const FileReadyCb& cb, uint32_t events);
+
   // Event::Dispatcher
   void clearDeferredDeleteList() override;
   Network::ClientConnectionPtr
@@ -54,15 +173,31 @@ public:
                                          Network::ListenerCallbacks& cb, Stats::Scope& scope,
                                          const Network::ListenerOptions& listener_options) override;
   TimerPtr createTimer(TimerCb cb) override;
+  TimerPtr createCoarseTimer(TimerCb cb) override;
   void deferredDelete(DeferredDeletablePtr&& to_delete) override;
   void exit() override;
+  void initializeStats(Stats::Scope& scope, const std::string& prefix) override;
+  Stats::Gauge* gauge(const std::string& name) override;
+  std::chrono::milliseconds loopDelay() override;
   SignalEventPtr listenForSignal(int signal_num, SignalCb cb) override;
   void post(std::function<void()> callback) override;
   void run(RunType type) override;
   Buffer::Factory& getBufferFactory() override { return *buffer_factory_; }
+  SystemTimeSource& approximateSystemTime() override { return loop_time_.system(); }
+  MonotonicTimeSource& approximateMonotonicTime() override { return loop_time_.monotonic(); }
+
+  static const std::chrono::milliseconds SLOW_CALLBACK_DURATION;
+  static const std::chrono::milliseconds LOOP_DELAY_PROBE_INTERVAL;
+  // loopDelay() covers the current window of this many probes and the previous one.
+  static const uint32_t LOOP_DELAY_WINDOW_PROBES = 10;
 
 private:
   void runPostCallbacks();
+  template <class Callback, class... Args>
+  void runCallback(const char* kind, const Callback& cb, Args... args);
+  void onCallbackComplete(const char* kind, const std::type_info& origin, MonotonicTime start,
+                          MonotonicTime end);
+  void onLoopDelayProbe();
 #ifndef NDEBUG
   // Validate that an operation is thread safe, i.e. it's invoked on the same thread that the
   // dispatcher run loop is executing on. We allow run_tid_ == 0 for tests where we don't invoke
@@ -77,12 +212,38 @@ private:
   Libevent::BasePtr base_;
   TimerPtr deferred_delete_timer_;
   TimerPtr post_timer_;
+  std::unique_ptr<TimerWheel> timer_wheel_;
   std::vector<DeferredDeletablePtr> to_delete_1_;
   std::vector<DeferredDeletablePtr> to_delete_2_;
   std::vector<DeferredDeletablePtr>* current_to_delete_;
-  std::mutex post_lock_;
-  std::list<std::function<void()>> post_callbacks_;
+  // Posted callbacks are pushed onto a lock free stack from any thread and taken off all at once
+  // by the dispatcher thread, so post() never contends with other posters or the dispatcher.
+  struct PostNode {
+    std::function<void()> callback_;
+    PostNode* next_;
+    // Only set once stats have been initialized.
+    MonotonicTime posted_at_;
+  };
+  std::atomic<PostNode*> post_head_{};
   bool deferred_deleting_{};
+  MonotonicTimeSource& time_source_;
+  LoopTime loop_time_;
+  // Stats are off until initializeStats() is called, so that callbacks are not timed.
+  Stats::Scope* stats_scope_{};
+  std::string stats_prefix_;
+  std::unique_ptr<DispatcherStats> stats_;
+  uint64_t slow_callbacks_{};
+  // How many callbacks are running, counting the ones that run inside of other callbacks.
+  uint32_t callback_depth_{};
+  // The time spent running callbacks, which the thread sampling the usage stats reads.
+  std::atomic<uint64_t> busy_time_ns_{};
+  TimerPtr loop_delay_probe_;
+  // Read by loopDelay() from other threads.
+  std::atomic<MonotonicTime::rep> loop_delay_probe_due_{};
+  std::atomic<uint64_t> loop_delay_us_{};
+  uint64_t window_loop_delay_us_{};
+  uint64_t previous_window_loop_delay_us_{};
+  uint32_t window_probes_{};
 };
 
 } // namespace Event
@@ -4,6 +4,7 @@
 
 #include "envoy/event/file_event.h"
 
+#include "common/common/recycler.h"
 #include "common/event/dispatcher_impl.h"
 #include "common/event/event_impl_base.h"
 
@@ -14,7 +15,7 @@ namespace Event {
  * Implementation of FileEvent for libevent that uses persistent events and
  * assumes the user will read/write until EAGAIN is returned from the file.
  */
-class FileEventImpl : public FileEvent, ImplBase {
+class FileEventImpl : public FileEvent, public Recycled, ImplBase {
 public:
   FileEventImpl(DispatcherImpl& dispatcher, int fd, FileReadyCb cb, FileTriggerType trigger,
                 uint32_t events);
@@ -26,6 +27,7 @@ public:
 private:
   void assignEvents(uint32_t events);
 
+  DispatcherImpl& dispatcher_;
   FileReadyCb cb_;
   event_base* base_;
   int fd_;
@@ -1,6 +1,8 @@
 #include "common/event/timer_impl.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 
 #include "common/common/assert.h"
 #include "common/event/dispatcher_impl.h"
@@ -10,11 +12,14 @@
 namespace Envoy {
 namespace Event {
 
-TimerImpl::TimerImpl(DispatcherImpl& dispatcher, TimerCb cb) : cb_(cb) {
+TimerImpl::TimerImpl(DispatcherImpl& dispatcher, TimerCb cb) : dispatcher_(dispatcher), cb_(cb) {
   ASSERT(cb_);
-  evtimer_assign(
-      &raw_event_, &dispatcher.base(),
-      [](evutil_socket_t, short, void* arg) -> void { static_cast<TimerImpl*>(arg)->cb_(); }, this);
+  evtimer_assign(&raw_event_, &dispatcher.base(),
+                 [](evutil_socket_t, short, void* arg) -> void {
+                   TimerImpl* timer = static_cast<TimerImpl*>(arg);
+                   timer->dispatcher_.runTimerCallback(timer->cb_);
+                 },
+                 this);
 }
 
 void TimerImpl::disableTimer() { event_del(&raw_event_); }
@@ -31,5 +36,117 @@ void TimerImpl::enableTimer(const std::chrono::milliseconds& d) {
   }
 }
 
+void TimerWheelEntry::linkBefore(TimerWheelEntry& entry) {
+  ASSERT(!linked());
+  prev_ = entry.prev_;
+  next_ = &entry;
+  prev_->next_ = this;
+  entry.prev_ = this;
+}
+
+void TimerWheelEntry::unlink() {
+  prev_->next_ = next_;
+  next_->prev_ = prev_;
+  prev_ = next_ = this;
+}
+
+const uint64_t TimerWheel::TICK_MS;
+const uint64_t TimerWheel::NUM_SLOTS;
+
+TimerWheel::TimerWheel(DispatcherImpl& dispatcher, MonotonicTimeSource& time_source)
+    : time_source_(time_source), start_time_(time_source.currentTime()),
+      slots_(new TimerWheelEntry[NUM_SLOTS]),
+      tick_timer_(dispatcher.createTimer([this]() -> void { onTick(); })) {}
+
+TimerWheel::~TimerWheel() {
+  // Timers that outlive the wheel must not touch the slots when they are destroyed.
+  for (uint64_t i = 0; i < NUM_SLOTS; i++) {
+    while (slots_[i].linked()) {
+      slots_[i].next_->unlink();
+    }
+  }
+}
+
+TimerPtr TimerWheel::createTimer(TimerCb cb) {
+  ASSERT(cb);
+  return TimerPtr{new CoarseTimerImpl(*this, cb)};
+}
+
+uint64_t TimerWheel::currentMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(time_source_.currentTime() -
+                                                               start_time_)
+      .count();
+}
+
+void TimerWheel::onTick() {
+  const uint64_t now = currentMs() / TICK_MS;
+
+  // If the loop fell behind by more than a revolution, every slot only needs to be visited once.
+  const uint64_t num_ticks = std::min(now - processed_tick_, NUM_SLOTS);
+  for (uint64_t i = 1; i <= num_ticks; i++) {
+    expireSlot(slots_[(processed_tick_ + i) % NUM_SLOTS], now);
+  }
+  processed_tick_ = now;
+
+  if (num_armed_ > 0) {
+    tick_timer_->enableTimer(std::chrono::milliseconds(TICK_MS));
+  } else {
+    ticking_ = false;
+  }
+}
+
+void TimerWheel::expireSlot(TimerWheelEntry& slot, uint64_t now) {
+  if (!slot.linked()) {
+    return;
+  }
+
+  // Move the slot into a local list first. Callbacks may enable, disable or destroy any timer,
+  // including the ones still waiting in the local list, which simply unlinks them from it.
+  TimerWheelEntry expiring;
+  expiring.prev_ = slot.prev_;
+  expiring.next_ = slot.next_;
+  expiring.prev_->next_ = &expiring;
+  expiring.next_->prev_ = &expiring;
+  slot.prev_ = slot.next_ = &slot;
+
+  while (expiring.linked()) {
+    CoarseTimerImpl& timer = static_cast<CoarseTimerImpl&>(*expiring.next_);
+    timer.unlink();
+    if (timer.expiry_tick_ > now) {
+      // Expires in a later revolution.
+      timer.linkBefore(slot);
+      continue;
+    }
+
+    num_armed_--;
+    timer.cb_();
+  }
+}
+
+void TimerWheel::CoarseTimerImpl::disableTimer() {
+  if (linked()) {
+    unlink();
+    wheel_.num_armed_--;
+  }
+}
+
+void TimerWheel::CoarseTimerImpl::enableTimer(const std::chrono::milliseconds& d) {
+  disableTimer();
+
+  const uint64_t now_ms = wheel_.currentMs();
+  if (!wheel_.ticking_) {
+    // The wheel was idle, so there is nothing to catch up on.
+    wheel_.processed_tick_ = now_ms / TICK_MS;
+    wheel_.ticking_ = true;
+    wheel_.tick_timer_->enableTimer(std::chrono::milliseconds(TICK_MS));
+  }
+
+  // The timer expires in the first tick that starts after the deadline, so it never fires early.
+  // This is always after the tick currently being processed.
+  expiry_tick_ = (now_ms + d.count()) / TICK_MS + 1;
+  linkBefore(wheel_.slots_[expiry_tick_ % NUM_SLOTS]);
+  wheel_.num_armed_++;
+}
+
 } // namespace Event
 } // namespace Envoy
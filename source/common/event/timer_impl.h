@@ -1,7 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <memory>
 
+#include "envoy/common/time.h"
 #include "envoy/event/timer.h"
 
 #include "common/event/dispatcher_impl.h"
@@ -22,8 +25,78 @@ public:
   void enableTimer(const std::chrono::milliseconds& d) override;
 
 private:
+  DispatcherImpl& dispatcher_;
   TimerCb cb_;
 };
 
+/**
+ * Link in one of the circular lists of a TimerWheel. An unlinked entry points to itself.
+ */
+struct TimerWheelEntry {
+  TimerWheelEntry() {}
+  TimerWheelEntry(const TimerWheelEntry&) = delete;
+  TimerWheelEntry& operator=(const TimerWheelEntry&) = delete;
+
+  bool linked() const { return next_ != this; }
+  void linkBefore(TimerWheelEntry& entry);
+  void unlink();
+
+  TimerWheelEntry* prev_{this};
+  TimerWheelEntry* next_{this};
+};
+
+/**
+ * A hashed timing wheel for coarse timers. Time is divided into ticks and each armed timer sits in
+ * the slot of the tick it expires in, so enabling and disabling a timer is O(1) and never
+ * allocates. A single libevent timer advances the wheel once per tick while any timer is armed,
+ * and each tick only visits the timers in one slot. Timers fire up to one tick late, and timers
+ * that expire more than one revolution out are visited once per revolution.
+ */
+class TimerWheel {
+public:
+  TimerWheel(DispatcherImpl& dispatcher, MonotonicTimeSource& time_source);
+  ~TimerWheel();
+
+  /**
+   * @param cb supplies the callback to invoke when the timer fires.
+   * @return TimerPtr a new coarse timer on this wheel.
+   */
+  TimerPtr createTimer(TimerCb cb);
+
+  static const uint64_t TICK_MS = 10;
+  static const uint64_t NUM_SLOTS = 1024;
+
+private:
+  class CoarseTimerImpl : public Timer, TimerWheelEntry {
+  public:
+    CoarseTimerImpl(TimerWheel& wheel, TimerCb cb) : wheel_(wheel), cb_(cb) {}
+    ~CoarseTimerImpl() { disableTimer(); }
+
+    // Event::Timer
+    void disableTimer() override;
+    void enableTimer(const std::chrono::milliseconds& d) override;
+
+  private:
+    TimerWheel& wheel_;
+    TimerCb cb_;
+    uint64_t expiry_tick_{};
+
+    friend class TimerWheel;
+  };
+
+  uint64_t currentMs();
+  void onTick();
+  void expireSlot(TimerWheelEntry& slot, uint64_t now);
+
+  MonotonicTimeSource& time_source_;
+  const MonotonicTime start_time_;
+  std::unique_ptr<TimerWheelEntry[]> slots_;
+  // The last tick whose slot has been expired.
+  uint64_t processed_tick_{};
+  uint64_t num_armed_{};
+  bool ticking_{};
+  TimerPtr tick_timer_;
+};
+
 } // namespace Event
 } // namespace Envoy
@@ -2,8 +2,11 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <fstream>
@@ -64,12 +67,78 @@ ssize_t OsSysCallsImpl::write(int fd, const void* buffer, size_t num_bytes) {
   return ::write(fd, buffer, num_bytes);
 }
 
+ssize_t OsSysCallsImpl::writev(int fd, const iovec* iov, int num_iov) {
+  return ::writev(fd, iov, num_iov);
+}
+
+FileFlusher::~FileFlusher() {
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    flush_thread_exit_ = true;
+    flush_event_.notify_one();
+  }
+
+  if (flush_thread_ != nullptr) {
+    flush_thread_->join();
+  }
+}
+
+void FileFlusher::flush(FileImpl& file) {
+  std::unique_lock<std::mutex> lock(lock_);
+  if (std::find(pending_files_.begin(), pending_files_.end(), &file) != pending_files_.end()) {
+    return;
+  }
+
+  if (flush_thread_ == nullptr) {
+    flush_thread_.reset(new Thread::Thread([this]() -> void { flushThreadFunc(); }));
+  }
+  pending_files_.push_back(&file);
+  flush_event_.notify_one();
+}
+
+void FileFlusher::remove(FileImpl& file) {
+  std::unique_lock<std::mutex> lock(lock_);
+  pending_files_.remove(&file);
+  while (flushing_file_ == &file) {
+    flushed_event_.wait(lock);
+  }
+}
+
+void FileFlusher::flushThreadFunc() {
+  // The thread blocks on disk writes, so idle time would not tell how loaded it is.
+  const uint64_t usage_handle =
+      Thread::UsageRegistry::instance().add("filesystem.flush_thread.", nullptr);
+  std::unique_lock<std::mutex> lock(lock_);
+
+  while (true) {
+    while (pending_files_.empty() && !flush_thread_exit_) {
+      flush_event_.wait(lock);
+    }
+
+    if (flush_thread_exit_) {
+      Thread::UsageRegistry::instance().remove(usage_handle);
+      return;
+    }
+
+    flushing_file_ = pending_files_.front();
+    pending_files_.pop_front();
+    lock.unlock();
+
+    flushing_file_->flush();
+
+    lock.lock();
+    flushing_file_ = nullptr;
+    flushed_event_.notify_all();
+  }
+}
+
 FileImpl::FileImpl(const std::string& path, Event::Dispatcher& dispatcher,
-                   Thread::BasicLockable& lock, OsSysCalls& os_sys_calls, Stats::Store& stats_store,
-                   std::chrono::milliseconds flush_interval_msec)
-    : path_(path), flush_lock_(lock), flush_timer_(dispatcher.createTimer([this]() -> void {
+                   Thread::BasicLockable& lock, FileFlusher& flusher, OsSysCalls& os_sys_calls,
+                   Stats::Store& stats_store, std::chrono::milliseconds flush_interval_msec)
+    : path_(path), flush_lock_(lock), flusher_(flusher),
+      flush_timer_(dispatcher.createTimer([this]() -> void {
         stats_.flushed_by_timer_.inc();
-        flush_event_.notify_one();
+        flusher_.flush(*this);
         flush_timer_->enableTimer(flush_interval_msec_);
       })),
       os_sys_calls_(os_sys_calls), flush_interval_msec_(flush_interval_msec),
@@ -90,15 +159,7 @@ void FileImpl::open() {
 void FileImpl::reopen() { reopen_file_ = true; }
 
 FileImpl::~FileImpl() {
-  {
-    std::unique_lock<std::mutex> lock(write_lock_);
-    flush_thread_exit_ = true;
-    flush_event_.notify_one();
-  }
-
-  if (flush_thread_ != nullptr) {
-    flush_thread_->join();
-  }
+  flusher_.remove(*this);
 
   // Flush any remaining data. If file was not opened for some reason, skip flushing part.
   if (fd_ != -1) {
@@ -114,6 +175,11 @@ void FileImpl::doWrite(Buffer::Instance& buffer) {
   uint64_t num_slices = buffer.getRawSlices(nullptr, 0);
   Buffer::RawSlice slices[num_slices];
   buffer.getRawSlices(slices, num_slices);
+  iovec iov[num_slices];
+  for (uint64_t i = 0; i < num_slices; i++) {
+    iov[i].iov_base = slices[i].mem_;
+    iov[i].iov_len = slices[i].len_;
+  }
 
   // We must do the actual writes to disk under lock, so that we don't intermix chunks from
   // different FileImpl pointing to the same underlying file. This can happen either via hot
@@ -124,11 +190,20 @@ void FileImpl::doWrite(Buffer::Instance& buffer) {
   //            actually flush to disk. In the future it would be nice if we did away with the cross
   //            process lock or had multiple locks.
   std::unique_lock<Thread::BasicLockable> lock(flush_lock_);
-  for (Buffer::RawSlice& slice : slices) {
-    ssize_t rc = os_sys_calls_.write(fd_, slice.mem_, slice.len_);
-    ASSERT(rc == static_cast<ssize_t>(slice.len_));
-    UNREFERENCED_PARAMETER(rc);
-    stats_.write_completed_.inc();
+  for (uint64_t i = 0; i < num_slices; i += IOV_MAX) {
+    const int num_iov = std::min<uint64_t>(num_slices - i, IOV_MAX);
+    size_t num_bytes = 0;
+    for (int j = 0; j < num_iov; j++) {
+      num_bytes += iov[i + j].iov_len;
+    }
+    const ssize_t rc = os_sys_calls_.writev(fd_, &iov[i], num_iov);
+    if (rc == static_cast<ssize_t>(num_bytes)) {
+      stats_.write_completed_.inc();
+    } else {
+      // The rest of the data is dropped rather than retried, so that a failing file does not hold
+      // up the other files that share the flusher.
+      stats_.write_failed_.inc();
+    }
   }
   lock.unlock();
 
@@ -136,62 +211,61 @@ void FileImpl::doWrite(Buffer::Instance& buffer) {
   buffer.drain(buffer.length());
 }
 
-void FileImpl::flushThreadFunc() {
-  std::unique_lock<std::mutex> lock(write_lock_);
-
-  while (true) {
-    // flush_event_ can be woken up either by large enough flush_buffer or by timer.
-    // In case it was timer, flush_buffer_ can be empty.
-    while (flush_buffer_.length() == 0 && !flush_thread_exit_) {
-      flush_event_.wait(lock);
-    }
-
-    if (flush_thread_exit_) {
+void FileImpl::flush() {
+  {
+    std::unique_lock<std::mutex> lock(write_lock_);
+    // The flusher can be asked to flush either by a large enough flush_buffer_ or by the timer.
+    // In case it was the timer, flush_buffer_ can be empty.
+    if (flush_buffer_.length() == 0) {
       return;
     }
-
-    ASSERT(flush_buffer_.length() > 0);
     about_to_write_buffer_.move(flush_buffer_);
     ASSERT(flush_buffer_.length() == 0);
-    lock.unlock();
+  }
 
-    // if we failed to open file before (-1 == fd_), then simply ignore
-    if (fd_ != -1) {
-      try {
-        if (reopen_file_) {
-          reopen_file_ = false;
-          os_sys_calls_.close(fd_);
-          open();
-        }
-
-        doWrite(about_to_write_buffer_);
-      } catch (const EnvoyException&) {
-        stats_.reopen_failed_.inc();
+  // if we failed to open file before (-1 == fd_), then simply ignore
+  if (fd_ != -1) {
+    try {
+      if (reopen_file_) {
+        reopen_file_ = false;
+        os_sys_calls_.close(fd_);
+        open();
       }
+
+      doWrite(about_to_write_buffer_);
+    } catch (const EnvoyException&) {
+      stats_.reopen_failed_.inc();
     }
+  }
 
-    lock.lock();
+  if (about_to_write_buffer_.length() > 0) {
+    stats_.write_failed_.inc();
+    stats_.write_total_buffered_.sub(about_to_write_buffer_.length());
+    about_to_write_buffer_.drain(about_to_write_buffer_.length());
   }
 }
 
 void FileImpl::write(const std::string& data) {
-  std::unique_lock<std::mutex> lock(write_lock_);
+  bool flush = false;
+  {
+    std::unique_lock<std::mutex> lock(write_lock_);
 
-  if (flush_thread_ == nullptr) {
-    createFlushStructures();
-  }
+    stats_.write_buffered_.inc();
+    stats_.write_total_buffered_.add(data.length());
+    flush_buffer_.add(data);
+    flush = flush_buffer_.length() > MIN_FLUSH_SIZE;
 
-  stats_.write_buffered_.inc();
-  stats_.write_total_buffered_.add(data.length());
-  flush_buffer_.add(data);
-  if (flush_buffer_.length() > MIN_FLUSH_SIZE) {
-    flush_event_.notify_one();
+    // The first write is flushed right away, and later ones by size or by the timer.
+    if (!flush_timer_enabled_) {
+      flush_timer_enabled_ = true;
+      flush_timer_->enableTimer(flush_interval_msec_);
+      flush = true;
+    }
   }
-}
 
-void FileImpl::createFlushStructures() {
-  flush_thread_.reset(new Thread::Thread([this]() -> void { flushThreadFunc(); }));
-  flush_timer_->enableTimer(flush_interval_msec_);
+  if (flush) {
+    flusher_.flush(*this);
+  }
 }
 
 } // namespace Filesystem
@@ -4,6 +4,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <list>
 #include <mutex>
 #include <string>
 
@@ -21,6 +22,7 @@ namespace Envoy {
   COUNTER(write_completed)                                                                         \
   COUNTER(flushed_by_timer)                                                                        \
   COUNTER(reopen_failed)                                                                           \
+  COUNTER(write_failed)                                                                            \
   GAUGE  (write_total_buffered)
 // clang-format on
 
@@ -51,20 +53,53 @@ public:
   // Filesystem::OsSysCalls
   int open(const std::string& full_path, int flags, int mode) override;
   ssize_t write(int fd, const void* buffer, size_t num_bytes) override;
+  ssize_t writev(int fd, const iovec* iov, int num_iov) override;
   int close(int fd) override;
 };
 
+class FileImpl;
+
+/**
+ * A thread that flushes the buffers of all the files that share it to disk, one file at a time.
+ * The thread is started when the first file asks to be flushed.
+ */
+class FileFlusher {
+public:
+  ~FileFlusher();
+
+  /**
+   * Queue a file to be flushed, unless it already is.
+   */
+  void flush(FileImpl& file);
+
+  /**
+   * Forget a file that is being destroyed. Waits for the file to finish flushing if the flush
+   * thread is flushing it.
+   */
+  void remove(FileImpl& file);
+
+private:
+  void flushThreadFunc();
+
+  std::mutex lock_;
+  std::condition_variable flush_event_;
+  std::condition_variable flushed_event_;
+  std::list<FileImpl*> pending_files_;
+  FileImpl* flushing_file_{};
+  bool flush_thread_exit_{};
+  Thread::ThreadPtr flush_thread_;
+};
+
 /**
  * This is a file implementation geared for writing out access logs. It turn out that in certain
  * cases even if a standard file is opened with O_NONBLOCK, the kernel can still block when writing.
- * This implementation uses a flush thread per file, with the idea there there aren't that many
- * files. If this turns out to be a good implementation we can potentially have a single flush
- * thread that flushes all files, but we will start with this.
+ * Writes are buffered, and the buffer is written out by a FileFlusher shared with other files,
+ * with one writev() per flush. The flusher must outlive the file.
  */
 class FileImpl : public File {
 public:
   FileImpl(const std::string& path, Event::Dispatcher& dispatcher, Thread::BasicLockable& lock,
-           OsSysCalls& osSysCalls, Stats::Store& stats_store,
+           FileFlusher& flusher, OsSysCalls& osSysCalls, Stats::Store& stats_store,
            std::chrono::milliseconds flush_interval_msec);
   ~FileImpl();
 
@@ -79,11 +114,14 @@ public:
    */
   void reopen() override;
 
+  /**
+   * Write the buffered data to disk. Only called by the FileFlusher.
+   */
+  void flush();
+
 private:
   void doWrite(Buffer::Instance& buffer);
-  void flushThreadFunc();
   void open();
-  void createFlushStructures();
 
   // Minimum size before the flush thread will be told to flush.
   static const uint64_t MIN_FLUSH_SIZE = 1024 * 64;
@@ -96,14 +134,13 @@ private:
   std::mutex write_lock_; // The lock is used when filling the flush buffer. It allows multiple
                           // threads to write to the same file at relatively high performance.
                           // It is always local to the process.
-  Thread::ThreadPtr flush_thread_;
-  std::condition_variable_any flush_event_;
-  std::atomic<bool> flush_thread_exit_{};
+  FileFlusher& flusher_;
+  bool flush_timer_enabled_{};
   std::atomic<bool> reopen_file_{};
   Buffer::OwnedImpl flush_buffer_; // This buffer is used by multiple threads. It gets filled and
                                    // then flushed either when max size is reached or when a timer
                                    // fires.
-  Buffer::OwnedImpl about_to_write_buffer_; // This buffer is used only by the flush thread. Data
+  Buffer::OwnedImpl about_to_write_buffer_; // This buffer is used only by the flusher. Data
                                             // is moved from flush_buffer_ under lock, and then
                                             // the lock is released so that flush_buffer_ can
                                             // continue to fill. This buffer is then used for the
@@ -21,11 +21,58 @@ namespace Filter {
 namespace Auth {
 namespace ClientSsl {
 
+namespace {
+
+int hexDigitValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+} // namespace
+
+void AllowedPrincipals::add(const std::string& sha256_digest) {
+  Sha256Digest digest;
+  if (decode(sha256_digest, digest)) {
+    allowed_sha256_digests_.emplace(digest);
+  }
+}
+
+bool AllowedPrincipals::allowed(const std::string& sha256_digest) const {
+  Sha256Digest digest;
+  return decode(sha256_digest, digest) && allowed_sha256_digests_.count(digest) != 0;
+}
+
+bool AllowedPrincipals::decode(const std::string& hex, Sha256Digest& digest) {
+  if (hex.size() != digest.size() * 2) {
+    return false;
+  }
+
+  for (size_t i = 0; i < digest.size(); i++) {
+    const int high = hexDigitValue(hex[i * 2]);
+    const int low = hexDigitValue(hex[i * 2 + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    digest[i] = (high << 4) | low;
+  }
+
+  return true;
+}
+
 Config::Config(const Json::Object& config, ThreadLocal::SlotAllocator& tls,
                Upstream::ClusterManager& cm, Event::Dispatcher& dispatcher, Stats::Scope& scope,
                Runtime::RandomGenerator& random)
     : RestApiFetcher(cm, config.getString("auth_api_cluster"), dispatcher, random,
-                     std::chrono::milliseconds(config.getInteger("refresh_delay_ms", 60000))),
+                     std::chrono::milliseconds(config.getInteger("refresh_delay_ms", 60000)),
+                     "client_ssl_auth"),
       tls_(tls.allocateSlot()), ip_white_list_(config, "ip_white_list"),
       stats_(generateStats(scope, config.getString("stat_prefix"))) {
 
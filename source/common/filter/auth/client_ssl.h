@@ -1,6 +1,8 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <unordered_set>
@@ -43,22 +45,40 @@ struct GlobalStats {
 };
 
 /**
- * Wraps the principals currently allowed to authenticate.
+ * Wraps the principals currently allowed to authenticate. The digests are kept as raw bytes rather
+ * than hex strings, which halves their size and keeps them out of separate string allocations.
  */
 class AllowedPrincipals : public ThreadLocal::ThreadLocalObject {
 public:
-  void add(const std::string& sha256_digest) {
-    if (!sha256_digest.empty()) {
-      allowed_sha256_digests_.emplace(sha256_digest);
-    }
-  }
-  bool allowed(const std::string& sha256_digest) const {
-    return allowed_sha256_digests_.count(sha256_digest) != 0;
-  }
+  /**
+   * @param sha256_digest supplies the hex encoded SHA256 digest of an allowed certificate. Anything
+   *        that is not such a digest is ignored.
+   */
+  void add(const std::string& sha256_digest);
+
+  /**
+   * @param sha256_digest supplies the hex encoded SHA256 digest of a certificate.
+   * @return bool whether the certificate is allowed.
+   */
+  bool allowed(const std::string& sha256_digest) const;
+
   size_t size() const { return allowed_sha256_digests_.size(); }
 
 private:
-  std::unordered_set<std::string> allowed_sha256_digests_;
+  typedef std::array<uint8_t, 32> Sha256Digest;
+
+  struct Sha256DigestHash {
+    // The digest bytes are already uniformly distributed, so any of them make a good hash.
+    size_t operator()(const Sha256Digest& digest) const {
+      size_t hash;
+      memcpy(&hash, digest.data(), sizeof(hash));
+      return hash;
+    }
+  };
+
+  static bool decode(const std::string& hex, Sha256Digest& digest);
+
+  std::unordered_set<Sha256Digest, Sha256DigestHash> allowed_sha256_digests_;
 };
 
 typedef std::shared_ptr<AllowedPrincipals> AllowedPrincipalsSharedPtr;
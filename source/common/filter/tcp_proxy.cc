@@ -1,7 +1,13 @@
 #include "common/filter/tcp_proxy.h"
 
+#include <netinet/in.h>
+
+#include <algorithm>
 #include <cstdint>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "envoy/buffer/buffer.h"
 #include "envoy/event/dispatcher.h"
@@ -33,7 +39,14 @@ TcpProxyConfig::Route::Route(const Json::Object& config) {
   }
 
   if (config.hasObject("destination_ip_list")) {
-    destination_ips_ = Network::Address::IpList(config.getStringArray("destination_ip_list"));
+    for (const std::string& entry : config.getStringArray("destination_ip_list")) {
+      Network::Address::CidrRange range = Network::Address::CidrRange::create(entry);
+      if (!range.isValid()) {
+        throw EnvoyException(
+            fmt::format("invalid ip/mask combo '{}' (format is <ip>/<# mask bits>)", entry));
+      }
+      destination_ips_.push_back(range);
+    }
   }
 
   if (config.hasObject("destination_ports")) {
@@ -42,9 +55,123 @@ TcpProxyConfig::Route::Route(const Json::Object& config) {
   }
 }
 
+namespace {
+
+// A destination prefix, by length first so that sorting puts prefixes after the shorter ones
+// covering them, paired with the index of one of its routes.
+template <class Key> using DestinationPrefix = std::pair<std::pair<uint32_t, Key>, uint32_t>;
+
+} // namespace
+
+/**
+ * Builds the destination index of a TcpProxyConfig, sharing the port tables and route lists that
+ * come out the same.
+ */
+struct TcpProxyConfig::IndexBuilder {
+  IndexBuilder(TcpProxyConfig& config) : config_(config) {}
+
+  /**
+   * @param routes supplies the indexes of the routes matching a destination address, in order.
+   * @return uint32_t the index in port_tables_ of the port table for these routes.
+   */
+  uint32_t portTable(const std::vector<uint32_t>& routes) {
+    auto inserted = port_tables_.emplace(routes, config_.port_tables_.size());
+    if (!inserted.second) {
+      return inserted.first->second;
+    }
+
+    // Split the ports where the routes' destination port ranges start and end, so that each
+    // interval is in the same ranges throughout.
+    std::vector<uint32_t> starts{0};
+    for (uint32_t route : routes) {
+      for (const Network::PortRange& range : config_.routes_[route].destination_port_ranges_) {
+        starts.push_back(range.min());
+        if (range.max() < 65535) {
+          starts.push_back(range.max() + 1);
+        }
+      }
+    }
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+    PortTable table;
+    for (uint32_t start : starts) {
+      std::vector<uint32_t> interval_routes;
+      for (uint32_t route : routes) {
+        const Network::PortRangeList& ranges = config_.routes_[route].destination_port_ranges_;
+        if (ranges.empty() ||
+            std::any_of(ranges.begin(), ranges.end(), [start](const Network::PortRange& range) {
+              return range.contains(start);
+            })) {
+          interval_routes.push_back(route);
+        }
+      }
+
+      const uint32_t route_list = routeList(interval_routes);
+      if (table.route_lists_.empty() || table.route_lists_.back() != route_list) {
+        table.starts_.push_back(start);
+        table.route_lists_.push_back(route_list);
+      }
+    }
+
+    config_.port_tables_.push_back(std::move(table));
+    port_table_routes_.push_back(routes);
+    return inserted.first->second;
+  }
+
+  /**
+   * @return uint32_t the index in route_lists_ of the routes.
+   */
+  uint32_t routeList(const std::vector<uint32_t>& routes) {
+    auto inserted = route_lists_.emplace(routes, config_.route_lists_.size());
+    if (inserted.second) {
+      config_.route_lists_.push_back(routes);
+    }
+    return inserted.first->second;
+  }
+
+  /**
+   * Add the destination prefixes of one IP version to the trie, each with the port table of the
+   * routes that match it: those of the prefix, of the shorter prefixes covering it, and those
+   * without destination prefixes.
+   */
+  template <class Key>
+  void destinations(std::vector<DestinationPrefix<Key>>& prefixes,
+                    const std::vector<uint32_t>& wildcard_routes,
+                    Network::Address::PrefixTrie<Key>& trie) {
+    // Add each prefix after the shorter prefixes covering it, which the trie then already holds.
+    std::sort(prefixes.begin(), prefixes.end());
+    auto it = prefixes.begin();
+    while (it != prefixes.end()) {
+      const uint32_t length = it->first.first;
+      const Key& prefix = it->first.second;
+
+      const uint32_t covering = trie.longestMatch(prefix);
+      std::vector<uint32_t> routes = covering == Network::Address::PrefixTrie<Key>::NO_VALUE
+                                         ? wildcard_routes
+                                         : port_table_routes_[covering];
+      for (; it != prefixes.end() && it->first.first == length && it->first.second == prefix;
+           ++it) {
+        routes.push_back(it->second);
+      }
+      std::sort(routes.begin(), routes.end());
+      routes.erase(std::unique(routes.begin(), routes.end()), routes.end());
+
+      trie.insert(prefix, length, portTable(routes));
+    }
+  }
+
+  TcpProxyConfig& config_;
+  // Route sets to the index of their port table, and the route set of each port table.
+  std::map<std::vector<uint32_t>, uint32_t> port_tables_;
+  std::vector<std::vector<uint32_t>> port_table_routes_;
+  std::map<std::vector<uint32_t>, uint32_t> route_lists_;
+};
+
 TcpProxyConfig::TcpProxyConfig(const Json::Object& config,
                                Upstream::ClusterManager& cluster_manager, Stats::Scope& scope)
-    : stats_(generateStats(config.getString("stat_prefix"), scope)) {
+    : stats_(generateStats(config.getString("stat_prefix"), scope)),
+      splice_(config.getBoolean("splice", false)) {
   config.validateSchema(Json::Schema::TCP_PROXY_NETWORK_FILTER_SCHEMA);
 
   for (const Json::ObjectSharedPtr& route_desc :
@@ -56,32 +183,74 @@ TcpProxyConfig::TcpProxyConfig(const Json::Object& config,
                                        route_desc->getString("cluster")));
     }
   }
-}
 
-const std::string& TcpProxyConfig::getRouteFromEntries(Network::Connection& connection) {
-  for (const TcpProxyConfig::Route& route : routes_) {
-    if (!route.source_port_ranges_.empty() &&
-        !Network::Utility::portInRangeList(connection.remoteAddress(), route.source_port_ranges_)) {
-      continue;
+  std::vector<uint32_t> wildcard_routes;
+  std::vector<uint32_t> non_ip_routes;
+  std::vector<DestinationPrefix<uint32_t>> ipv4_prefixes;
+  std::vector<DestinationPrefix<Network::Address::Ipv6PrefixTrieKey>> ipv6_prefixes;
+  for (uint32_t i = 0; i < routes_.size(); i++) {
+    const Route& route = routes_[i];
+    if (route.destination_ips_.empty()) {
+      wildcard_routes.push_back(i);
+      if (route.destination_port_ranges_.empty()) {
+        non_ip_routes.push_back(i);
+      }
     }
 
-    if (!route.source_ips_.empty() && !route.source_ips_.contains(connection.remoteAddress())) {
-      continue;
+    for (const Network::Address::CidrRange& range : route.destination_ips_) {
+      if (range.version() == Network::Address::IpVersion::v4) {
+        ipv4_prefixes.push_back(
+            {{static_cast<uint32_t>(range.length()), ntohl(range.ipv4()->address())}, i});
+      } else {
+        ipv6_prefixes.push_back(
+            {{static_cast<uint32_t>(range.length()), range.ipv6()->address()}, i});
+      }
     }
+  }
 
-    if (!route.destination_port_ranges_.empty() &&
-        !Network::Utility::portInRangeList(connection.localAddress(),
-                                           route.destination_port_ranges_)) {
-      continue;
-    }
+  IndexBuilder builder(*this);
+  default_port_table_ = builder.portTable(wildcard_routes);
+  non_ip_route_list_ = builder.routeList(non_ip_routes);
+  builder.destinations(ipv4_prefixes, wildcard_routes, ipv4_destinations_);
+  builder.destinations(ipv6_prefixes, wildcard_routes, ipv6_destinations_);
+}
 
-    if (!route.destination_ips_.empty() &&
-        !route.destination_ips_.contains(connection.localAddress())) {
-      continue;
+bool TcpProxyConfig::sourceMatches(const Route& route, Network::Connection& connection) {
+  if (!route.source_port_ranges_.empty() &&
+      !Network::Utility::portInRangeList(connection.remoteAddress(), route.source_port_ranges_)) {
+    return false;
+  }
+
+  return route.source_ips_.empty() || route.source_ips_.contains(connection.remoteAddress());
+}
+
+const std::string& TcpProxyConfig::getRouteFromEntries(Network::Connection& connection) {
+  const Network::Address::Instance& destination = connection.localAddress();
+  uint32_t route_list = non_ip_route_list_;
+  if (destination.type() == Network::Address::Type::Ip) {
+    uint32_t port_table = Network::Address::PrefixTrie<uint32_t>::NO_VALUE;
+    if (destination.ip()->version() == Network::Address::IpVersion::v4) {
+      port_table = ipv4_destinations_.longestMatch(ntohl(destination.ip()->ipv4()->address()));
+    } else {
+      port_table = ipv6_destinations_.longestMatch(destination.ip()->ipv6()->address());
     }
+    const PortTable& table = port_tables_[port_table ==
+                                                  Network::Address::PrefixTrie<uint32_t>::NO_VALUE
+                                              ? default_port_table_
+                                              : port_table];
+
+    // The last interval starting at or before the port. The first one starts at 0.
+    const auto interval =
+        std::upper_bound(table.starts_.begin(), table.starts_.end(), destination.ip()->port()) - 1;
+    route_list = table.route_lists_[interval - table.starts_.begin()];
+  }
 
-    // if we made it past all checks, the route matches
-    return route.cluster_name_;
+  // The candidates already match the destination, and are in config order, so the first one that
+  // matches the source is the route.
+  for (uint32_t route : route_lists_[route_list]) {
+    if (sourceMatches(routes_[route], connection)) {
+      return routes_[route].cluster_name_;
+    }
   }
 
   // no match, no more routes to try
@@ -202,8 +371,16 @@ Network::FilterStatus TcpProxy::initializeUpstreamConnection() {
     onInitFailure();
     return Network::FilterStatus::StopIteration;
   }
-  Upstream::Host::CreateConnectionData conn_info =
-      cluster_manager_.tcpConnForCluster(cluster_name, this);
+  // Claim an upstream connection that is already established if the cluster keeps some. The
+  // WsHandlerImpl class, which has no config, raises its own events around the connect.
+  Upstream::Host::CreateConnectionData conn_info{nullptr, nullptr};
+  if (config_) {
+    conn_info = cluster_manager_.prewarmedTcpConnForCluster(cluster_name, this);
+  }
+  const bool prewarmed = conn_info.connection_ != nullptr;
+  if (!prewarmed) {
+    conn_info = cluster_manager_.tcpConnForCluster(cluster_name, this);
+  }
 
   upstream_connection_ = std::move(conn_info.connection_);
   read_callbacks_->upstreamHost(conn_info.host_description_);
@@ -221,12 +398,14 @@ Network::FilterStatus TcpProxy::initializeUpstreamConnection() {
        read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_rx_bytes_buffered_,
        read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_tx_bytes_total_,
        read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_tx_bytes_buffered_});
-  upstream_connection_->connect();
-  upstream_connection_->noDelay(true);
+  if (!prewarmed) {
+    upstream_connection_->connect();
+    upstream_connection_->noDelay(true);
 
-  connect_timeout_timer_ = read_callbacks_->connection().dispatcher().createTimer(
-      [this]() -> void { onConnectTimeout(); });
-  connect_timeout_timer_->enableTimer(cluster->connectTimeout());
+    connect_timeout_timer_ = read_callbacks_->connection().dispatcher().createCoarseTimer(
+        [this]() -> void { onConnectTimeout(); });
+    connect_timeout_timer_->enableTimer(cluster->connectTimeout());
+  }
 
   read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_total_.inc();
   read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_active_.inc();
@@ -237,6 +416,11 @@ Network::FilterStatus TcpProxy::initializeUpstreamConnection() {
   connected_timespan_ =
       read_callbacks_->upstreamHost()->cluster().stats().upstream_cx_length_ms_.allocateSpan();
 
+  if (prewarmed) {
+    ENVOY_CONN_LOG(debug, "using a prewarmed upstream connection", read_callbacks_->connection());
+    onUpstreamEvent(Network::ConnectionEvent::Connected);
+  }
+
   return Network::FilterStatus::Continue;
 }
 
@@ -255,6 +439,19 @@ Network::FilterStatus TcpProxy::onData(Buffer::Instance& data) {
   return Network::FilterStatus::StopIteration;
 }
 
+void TcpProxy::startSplicing() {
+  // Each direction splices on its own. One that can't, e.g. because of TLS or other filters on the
+  // connection, keeps proxying through onData() and onUpstreamData().
+  Network::Connection& downstream_connection = read_callbacks_->connection();
+  const bool upstream_spliced = downstream_connection.spliceTo(*upstream_connection_);
+  const bool downstream_spliced = upstream_connection_->spliceTo(downstream_connection);
+  ENVOY_CONN_LOG(debug, "splicing upstream={} downstream={}", downstream_connection,
+                 upstream_spliced, downstream_spliced);
+  if ((upstream_spliced || downstream_spliced) && config_) {
+    config_->stats().downstream_cx_spliced_total_.inc();
+  }
+}
+
 void TcpProxy::onDownstreamEvent(Network::ConnectionEvent event) {
   if ((event == Network::ConnectionEvent::RemoteClose ||
        event == Network::ConnectionEvent::LocalClose) &&
@@ -290,6 +487,9 @@ void TcpProxy::onUpstreamEvent(Network::ConnectionEvent event) {
     onConnectionFailure();
   } else if (event == Network::ConnectionEvent::Connected) {
     connect_timespan_->complete();
+    if (shouldSplice()) {
+      startSplicing();
+    }
     onConnectionSuccess();
   }
 
@@ -16,6 +16,7 @@
 #include "common/json/json_loader.h"
 #include "common/network/cidr_range.h"
 #include "common/network/filter_impl.h"
+#include "common/network/prefix_trie.h"
 #include "common/network/utility.h"
 
 namespace Envoy {
@@ -32,6 +33,7 @@ namespace Filter {
   GAUGE  (downstream_cx_tx_bytes_buffered)                                                         \
   COUNTER(downstream_cx_total)                                                                     \
   COUNTER(downstream_cx_no_route)                                                                  \
+  COUNTER(downstream_cx_spliced_total)                                                             \
   COUNTER(downstream_flow_control_paused_reading_total)                                            \
   COUNTER(downstream_flow_control_resumed_reading_total)
 // clang-format on
@@ -63,21 +65,53 @@ public:
 
   const TcpProxyStats& stats() { return stats_; }
 
+  /**
+   * @return bool whether to splice data between the downstream and upstream sockets, rather than
+   *         copying it through the connection buffers. @see Network::Connection::spliceTo().
+   */
+  bool splice() const { return splice_; }
+
 private:
   struct Route {
     Route(const Json::Object& config);
 
     Network::Address::IpList source_ips_;
     Network::PortRangeList source_port_ranges_;
-    Network::Address::IpList destination_ips_;
+    // Matched through the destination index rather than per route.
+    std::vector<Network::Address::CidrRange> destination_ips_;
     Network::PortRangeList destination_port_ranges_;
     std::string cluster_name_;
   };
 
+  /**
+   * Routes by destination port, for the destination addresses that share a set of routes.
+   */
+  struct PortTable {
+    // The first port of each port interval, in increasing order from 0.
+    std::vector<uint32_t> starts_;
+    // For each port interval, the index in route_lists_ of the routes that may match its ports.
+    std::vector<uint32_t> route_lists_;
+  };
+
+  struct IndexBuilder;
+
   static TcpProxyStats generateStats(const std::string& name, Stats::Scope& scope);
+  static bool sourceMatches(const Route& route, Network::Connection& connection);
 
   std::vector<Route> routes_;
+  // The destination index, so that a connection only checks the source of the routes that match
+  // its destination. The longest destination prefix the address is in picks a port table, and the
+  // port picks a list of routes from it, in config order.
+  Network::Address::PrefixTrie<uint32_t> ipv4_destinations_;
+  Network::Address::PrefixTrie<Network::Address::Ipv6PrefixTrieKey> ipv6_destinations_;
+  std::vector<PortTable> port_tables_;
+  std::vector<std::vector<uint32_t>> route_lists_;
+  // The port table of addresses in none of the destination prefixes.
+  uint32_t default_port_table_;
+  // The routes of destinations that aren't IP addresses.
+  uint32_t non_ip_route_list_;
   const TcpProxyStats stats_;
+  const bool splice_;
 };
 
 typedef std::shared_ptr<TcpProxyConfig> TcpProxyConfigSharedPtr;
@@ -104,6 +138,7 @@ public:
   const Network::Connection* downstreamConnection() const override {
     return &read_callbacks_->connection();
   }
+  const Upstream::MetadataMatchCriteria* metadataMatchCriteria() const override { return nullptr; }
 
   // These two functions allow enabling/disabling reads on the upstream and downstream connections.
   // They are called by the Downstream/Upstream Watermark callbacks to limit buffering.
@@ -162,10 +197,16 @@ protected:
   virtual void onConnectionSuccess() {}
   virtual void onUpstreamHostReady() {}
 
+  /**
+   * @return bool whether to splice the connections once the upstream connects.
+   */
+  virtual bool shouldSplice() { return config_->splice(); }
+
   Network::FilterStatus initializeUpstreamConnection();
   void onConnectTimeout();
+  void startSplicing();
   void onDownstreamEvent(Network::ConnectionEvent event);
-  void onUpstreamData(Buffer::Instance& data);
+  virtual void onUpstreamData(Buffer::Instance& data);
   void onUpstreamEvent(Network::ConnectionEvent event);
 
   TcpProxyConfigSharedPtr config_;
@@ -136,7 +136,10 @@ public:
     }
 
     for (auto& frame : decoded_frames_) {
-      std::unique_ptr<ResponseType> response(new ResponseType());
+      // The message tree is allocated on an arena owned by the response, and freed in one shot.
+      std::unique_ptr<Protobuf::Arena> arena(new Protobuf::Arena());
+      ResponseType* message = Protobuf::Arena::CreateMessage<ResponseType>(arena.get());
+      ResponsePtr<ResponseType> response(message, ResponseDeleter<ResponseType>(std::move(arena)));
       // TODO(htuch): Need to add support for compressed responses as well here.
       if (frame.length_ > 0) {
         Buffer::ZeroCopyInputStreamImpl stream(std::move(frame.data_));
@@ -288,7 +291,7 @@ private:
 
   void onReceiveInitialMetadata(Http::HeaderMapPtr&&) override {}
 
-  void onReceiveMessage(std::unique_ptr<ResponseType>&& message) override {
+  void onReceiveMessage(ResponsePtr<ResponseType>&& message) override {
     response_ = std::move(message);
   }
 
@@ -309,7 +312,7 @@ private:
 
   const RequestType& request_;
   AsyncRequestCallbacks<ResponseType>& callbacks_;
-  std::unique_ptr<ResponseType> response_;
+  ResponsePtr<ResponseType> response_;
 };
 
 } // namespace Grpc
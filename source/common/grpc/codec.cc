@@ -1,10 +1,12 @@
 #include "common/grpc/codec.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <vector>
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
 
 namespace Envoy {
 namespace Grpc {
@@ -19,82 +21,140 @@ void Encoder::newFrame(uint8_t flags, uint64_t length, std::array<uint8_t, 5>& o
   output[4] = static_cast<uint8_t>(length);
 }
 
-Decoder::Decoder() : state_(State::FH_FLAG) {}
+Decoder::Decoder() : state_(State::FH_FLAG) { frame_.data_.reset(new Buffer::OwnedImpl()); }
 
 bool Decoder::decode(Buffer::Instance& input, std::vector<Frame>& output) {
-  uint64_t count = input.getRawSlices(nullptr, 0);
-  Buffer::RawSlice slices[count];
-  input.getRawSlices(slices, count);
-  for (Buffer::RawSlice& slice : slices) {
-    uint8_t* mem = reinterpret_cast<uint8_t*>(slice.mem_);
-    for (uint64_t j = 0; j < slice.len_;) {
-      uint8_t c = *mem;
-      switch (state_) {
-      case State::FH_FLAG:
-        if (c & ~GRPC_FH_COMPRESSED) {
-          // Unsupported flags.
+  struct VectorCallbacks : public FrameCallbacks {
+    VectorCallbacks(std::vector<Frame>& output) : output_(output) {}
+
+    // Grpc::FrameCallbacks
+    void onFrame(Frame& frame) override {
+      Buffer::InstancePtr data;
+      if (frame.length_ > 0) {
+        data.reset(new Buffer::OwnedImpl());
+        data->move(*frame.data_);
+      }
+      output_.push_back({frame.flags_, frame.length_, std::move(data)});
+    }
+
+    std::vector<Frame>& output_;
+  } callbacks(output);
+
+  return decode(input, callbacks);
+}
+
+bool Decoder::decode(Buffer::Instance& input, FrameCallbacks& callbacks) {
+  while (input.length() > 0) {
+    if (state_ == State::DATA) {
+      const uint64_t remain_in_frame = frame_.length_ - frame_.data_->length();
+      if (input.length() < remain_in_frame) {
+        frame_.data_->move(input);
+        return true;
+      }
+      frame_.data_->move(input, remain_in_frame);
+      onFrameDone(callbacks);
+    } else if (state_ == State::FH_FLAG && input.length() >= 5) {
+      // The common case of a whole header in the input.
+      const uint8_t* header = static_cast<const uint8_t*>(input.linearize(5));
+      for (uint64_t i = 0; i < 5; i++) {
+        if (!decodeHeaderByte(header[i])) {
+          input.drain(i);
           return false;
         }
-        frame_.flags_ = c;
-        state_ = State::FH_LEN_0;
-        mem++;
-        j++;
-        break;
-      case State::FH_LEN_0:
-        frame_.length_ = static_cast<uint32_t>(c) << 24;
-        state_ = State::FH_LEN_1;
-        mem++;
-        j++;
-        break;
-      case State::FH_LEN_1:
-        frame_.length_ |= static_cast<uint32_t>(c) << 16;
-        state_ = State::FH_LEN_2;
-        mem++;
-        j++;
-        break;
-      case State::FH_LEN_2:
-        frame_.length_ |= static_cast<uint32_t>(c) << 8;
-        state_ = State::FH_LEN_3;
-        mem++;
-        j++;
-        break;
-      case State::FH_LEN_3:
-        frame_.length_ |= static_cast<uint32_t>(c);
-        if (frame_.length_ == 0) {
-          output.push_back(std::move(frame_));
-          state_ = State::FH_FLAG;
-        } else {
-          frame_.data_.reset(new Buffer::OwnedImpl());
-          state_ = State::DATA;
-        }
-        mem++;
-        j++;
-        break;
-      case State::DATA:
-        uint64_t remain_in_buffer = slice.len_ - j;
-        uint64_t remain_in_frame = frame_.length_ - frame_.data_->length();
-        if (remain_in_buffer <= remain_in_frame) {
-          frame_.data_->add(mem, remain_in_buffer);
-          mem += remain_in_buffer;
-          j += remain_in_buffer;
-        } else {
-          frame_.data_->add(mem, remain_in_frame);
-          mem += remain_in_frame;
-          j += remain_in_frame;
-        }
-        if (frame_.length_ == frame_.data_->length()) {
-          output.push_back(std::move(frame_));
-          frame_.flags_ = 0;
-          frame_.length_ = 0;
-          state_ = State::FH_FLAG;
-        }
-        break;
       }
+      input.drain(5);
+    } else {
+      const uint8_t c = *static_cast<const uint8_t*>(input.linearize(1));
+      if (!decodeHeaderByte(c)) {
+        return false;
+      }
+      input.drain(1);
+    }
+
+    if (state_ == State::DATA && frame_.length_ == 0) {
+      onFrameDone(callbacks);
+    }
+  }
+  return true;
+}
+
+bool Decoder::decodeHeaderByte(uint8_t c) {
+  switch (state_) {
+  case State::FH_FLAG:
+    if (c & ~GRPC_FH_COMPRESSED) {
+      // Unsupported flags.
+      return false;
     }
+    frame_.flags_ = c;
+    state_ = State::FH_LEN_0;
+    break;
+  case State::FH_LEN_0:
+    frame_.length_ = static_cast<uint32_t>(c) << 24;
+    state_ = State::FH_LEN_1;
+    break;
+  case State::FH_LEN_1:
+    frame_.length_ |= static_cast<uint32_t>(c) << 16;
+    state_ = State::FH_LEN_2;
+    break;
+  case State::FH_LEN_2:
+    frame_.length_ |= static_cast<uint32_t>(c) << 8;
+    state_ = State::FH_LEN_3;
+    break;
+  case State::FH_LEN_3:
+    frame_.length_ |= static_cast<uint32_t>(c);
+    state_ = State::DATA;
+    break;
+  case State::DATA:
+    NOT_REACHED;
   }
-  input.drain(input.length());
   return true;
 }
 
+void Decoder::onFrameDone(FrameCallbacks& callbacks) {
+  callbacks.onFrame(frame_);
+  if (frame_.data_) {
+    frame_.data_->drain(frame_.data_->length());
+  } else {
+    frame_.data_.reset(new Buffer::OwnedImpl());
+  }
+  frame_.flags_ = 0;
+  frame_.length_ = 0;
+  state_ = State::FH_FLAG;
+}
+
+uint64_t FrameInspector::inspect(const Buffer::Instance& data) {
+  const uint64_t count = count_;
+  uint64_t num_slices = data.getRawSlices(nullptr, 0);
+  Buffer::RawSlice slices[num_slices];
+  data.getRawSlices(slices, num_slices);
+  for (const Buffer::RawSlice& slice : slices) {
+    const uint8_t* mem = static_cast<const uint8_t*>(slice.mem_);
+    uint64_t left = slice.len_;
+    while (left > 0) {
+      if (payload_left_ > 0) {
+        const uint64_t skip = std::min(payload_left_, left);
+        payload_left_ -= skip;
+        mem += skip;
+        left -= skip;
+        continue;
+      }
+
+      if (header_octets_ == 0) {
+        count_++;
+        length_ = 0;
+      } else {
+        length_ = (length_ << 8) | *mem;
+      }
+      mem++;
+      left--;
+      if (++header_octets_ == 5) {
+        header_octets_ = 0;
+        payload_left_ = length_;
+      }
+    }
+  }
+  return count_ - count;
+}
+
 } // namespace Grpc
 } // namespace Envoy
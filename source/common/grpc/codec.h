@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "envoy/buffer/buffer.h"
+#include "envoy/common/pure.h"
 
 namespace Envoy {
 namespace Grpc {
@@ -32,6 +33,17 @@ public:
   void newFrame(uint8_t flags, uint64_t length, std::array<uint8_t, 5>& output);
 };
 
+class FrameCallbacks {
+public:
+  virtual ~FrameCallbacks() {}
+
+  // Called for each complete GRPC data frame.
+  // @param frame supplies the decoded frame. Its data_ holds the payload and is only valid for the
+  //        duration of the call. It may be drained, or moved from to keep the payload without a
+  //        copy. The decoder reuses the frame for the next one.
+  virtual void onFrame(Frame& frame) PURE;
+};
+
 class Decoder {
 public:
   Decoder();
@@ -39,12 +51,22 @@ public:
   // Decodes the given buffer with GRPC data frame. Drains the input buffer when
   // decoding succeeded (returns true). If the input is not sufficient to make a
   // complete GRPC data frame, it will be buffered in the decoder. If a decoding
-  // error happened, the input buffer remains unchanged.
+  // error happened, the frames before the error have been decoded and the
+  // decoder should not be used again.
   // @param input supplies the binary octets wrapped in a GRPC data frame.
   // @param output supplies the buffer to store the decoded data.
   // @return bool whether the decoding succeeded or not.
   bool decode(Buffer::Instance& input, std::vector<Frame>& output);
 
+  // Decodes the given buffer with GRPC data frame like decode() above, but hands
+  // out each frame through callbacks instead of appending it to a vector. The
+  // payload is moved out of the input rather than copied, and no buffer is
+  // allocated per frame.
+  // @param input supplies the binary octets wrapped in a GRPC data frame.
+  // @param callbacks supplies the callbacks invoked for each complete frame.
+  // @return bool whether the decoding succeeded or not.
+  bool decode(Buffer::Instance& input, FrameCallbacks& callbacks);
+
 private:
   // Wire format (http://www.grpc.io/docs/guides/wire.html) of GRPC data frame
   // header:
@@ -78,8 +100,32 @@ private:
     DATA,
   };
 
+  // Decodes one byte of the frame header.
+  // @return bool whether the byte is valid.
+  bool decodeHeaderByte(uint8_t c);
+  void onFrameDone(FrameCallbacks& callbacks);
+
   State state_;
   Frame frame_;
 };
+
+// Counts the GRPC data frames of a stream as it passes by, without consuming or copying it.
+class FrameInspector {
+public:
+  // Inspects the next part of the stream.
+  // @param data supplies the next octets of the stream. It is left unchanged.
+  // @return uint64_t the number of frames that start in the given data.
+  uint64_t inspect(const Buffer::Instance& data);
+
+  // @return uint64_t the number of frames started so far.
+  uint64_t frameCount() const { return count_; }
+
+private:
+  // Header octets of the current frame seen so far, 0 while in its payload or between frames.
+  uint32_t header_octets_{0};
+  uint32_t length_{0};
+  uint64_t payload_left_{0};
+  uint64_t count_{0};
+};
 } // namespace Grpc
 } // namespace Envoy
@@ -78,28 +78,21 @@ Http::FilterDataStatus GrpcWebFilter::decodeData(Buffer::Instance& data, bool) {
     return Http::FilterDataStatus::Continue;
   }
 
-  // Parse application/grpc-web-text format.
-  if (data.length() + decoding_buffer_.length() < 4) {
-    decoding_buffer_.move(data);
-    return Http::FilterDataStatus::StopIterationNoBuffer;
-  }
-
-  const uint64_t needed =
-      (data.length() + decoding_buffer_.length()) / 4 * 4 - decoding_buffer_.length();
-  decoding_buffer_.move(data, needed);
-  const std::string decoded = Base64::decode(
-      std::string(static_cast<const char*>(decoding_buffer_.linearize(decoding_buffer_.length())),
-                  decoding_buffer_.length()));
-  if (decoded.empty()) {
+  // Parse application/grpc-web-text format. The decoder keeps the characters of an incomplete
+  // quantum until more data comes in.
+  Buffer::OwnedImpl decoded;
+  if (!base64_decoder_.decode(data, decoded)) {
     // Error happened when decoding base64.
     Http::Utility::sendLocalReply(*decoder_callbacks_, stream_destroyed_, Http::Code::BadRequest,
                                   "Bad gRPC-web request, invalid base64 data.");
     return Http::FilterDataStatus::StopIterationNoBuffer;
   }
 
-  decoding_buffer_.drain(decoding_buffer_.length());
-  decoding_buffer_.move(data);
-  data.add(decoded);
+  data.drain(data.length());
+  if (decoded.length() == 0) {
+    return Http::FilterDataStatus::StopIterationNoBuffer;
+  }
+  data.move(decoded);
   return Http::FilterDataStatus::Continue;
 }
 
@@ -125,29 +118,30 @@ Http::FilterDataStatus GrpcWebFilter::encodeData(Buffer::Instance& data, bool) {
   }
 
   // The decoder always consumes and drains the given buffer. Incomplete data frame is buffered
-  // inside the decoder.
-  std::vector<Frame> frames;
-  decoder_.decode(data, frames);
-  if (frames.empty()) {
+  // inside the decoder. Each complete frame is encoded with base64 as it is decoded.
+  Buffer::OwnedImpl encoded;
+  Base64FrameEncoder encoder(encoded);
+  decoder_.decode(data, encoder);
+  if (encoder.frames_ == 0) {
     // We don't have enough data to decode for one single frame, stop iteration until more data
     // comes in.
     return Http::FilterDataStatus::StopIterationNoBuffer;
   }
 
-  // Encodes the decoded gRPC frames with base64.
-  for (auto& frame : frames) {
-    Buffer::OwnedImpl temp;
-    temp.add(&frame.flags_, 1);
-    const uint32_t length = htonl(frame.length_);
-    temp.add(&length, 4);
-    if (frame.length_ > 0) {
-      temp.add(*frame.data_);
-    }
-    data.add(Base64::encode(temp, temp.length()));
-  }
+  data.move(encoded);
   return Http::FilterDataStatus::Continue;
 }
 
+void GrpcWebFilter::Base64FrameEncoder::onFrame(Frame& frame) {
+  Buffer::OwnedImpl temp;
+  temp.add(&frame.flags_, 1);
+  const uint32_t length = htonl(frame.length_);
+  temp.add(&length, 4);
+  temp.move(*frame.data_);
+  Base64::encode(temp, output_);
+  frames_++;
+}
+
 Http::FilterTrailersStatus GrpcWebFilter::encodeTrailers(Http::HeaderMap& trailers) {
   if (do_stat_tracking_) {
     chargeStat(trailers);
@@ -173,7 +167,8 @@ Http::FilterTrailersStatus GrpcWebFilter::encodeTrailers(Http::HeaderMap& traile
   buffer.add(&length, 4);
   buffer.move(temp);
   if (is_text_response_) {
-    Buffer::OwnedImpl encoded(Base64::encode(buffer, buffer.length()));
+    Buffer::OwnedImpl encoded;
+    Base64::encode(buffer, encoded);
     encoder_callbacks_->addEncodedData(encoded);
   } else {
     encoder_callbacks_->addEncodedData(buffer);
@@ -6,6 +6,7 @@
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/base64.h"
 #include "common/common/non_copyable.h"
 #include "common/grpc/codec.h"
 
@@ -44,6 +45,17 @@ public:
 private:
   friend class GrpcWebFilterTest;
 
+  // Encodes each decoded gRPC frame with base64 into an output buffer.
+  struct Base64FrameEncoder : public FrameCallbacks {
+    Base64FrameEncoder(Buffer::Instance& output) : output_(output) {}
+
+    // Grpc::FrameCallbacks
+    void onFrame(Frame& frame) override;
+
+    Buffer::Instance& output_;
+    uint64_t frames_{};
+  };
+
   void chargeStat(const Http::HeaderMap& headers);
   void setupStatTracking(const Http::HeaderMap& headers);
   bool isGrpcWebRequest(const Http::HeaderMap& headers);
@@ -57,7 +69,7 @@ private:
   Http::StreamEncoderFilterCallbacks* encoder_callbacks_{};
   bool is_text_request_{};
   bool is_text_response_{};
-  Buffer::OwnedImpl decoding_buffer_;
+  Base64StreamDecoder base64_decoder_;
   Decoder decoder_;
   std::string grpc_service_;
   std::string grpc_method_;
@@ -1,5 +1,7 @@
 #include "common/grpc/json_transcoder_filter.h"
 
+#include <limits>
+
 #include "envoy/common/exception.h"
 #include "envoy/http/filter.h"
 
@@ -117,6 +119,9 @@ JsonTranscoderConfig::JsonTranscoderConfig(const Json::Object& config) {
       print_config->getBoolean("always_print_enums_as_ints", false);
   print_options_.preserve_proto_field_names =
       print_config->getBoolean("preserve_proto_field_names", false);
+
+  max_buffered_response_bytes_ = static_cast<uint64_t>(config.getInteger(
+      "max_buffered_response_bytes", std::numeric_limits<int64_t>::max()));
 }
 
 Status JsonTranscoderConfig::createTranscoder(
@@ -289,6 +294,7 @@ Http::FilterHeadersStatus JsonTranscoderFilter::encodeHeaders(Http::HeaderMap& h
   }
 
   response_headers_ = &headers;
+  headers.removeContentLength();
   headers.insertContentType().value().setReference(Http::Headers::get().ContentTypeValues.Json);
   if (!method_->server_streaming() && !end_stream) {
     return Http::FilterHeadersStatus::StopIteration;
@@ -309,10 +315,27 @@ Http::FilterDataStatus JsonTranscoderFilter::encodeData(Buffer::Instance& data,
 
   readToBuffer(*transcoder_->ResponseOutput(), data);
 
-  if (!method_->server_streaming()) {
-    return Http::FilterDataStatus::StopIterationAndBuffer;
+  const auto& response_status = transcoder_->ResponseStatus();
+  if (!response_status.ok()) {
+    ENVOY_LOG(debug, "Transcoding response error {}", response_status.ToString());
+    error_ = true;
+    encoder_callbacks_->resetStream();
+    return Http::FilterDataStatus::StopIterationNoBuffer;
+  }
+
+  if (!method_->server_streaming() && !streaming_response_) {
+    const Buffer::Instance* buffered = encoder_callbacks_->encodingBuffer();
+    if ((buffered ? buffered->length() : 0) + data.length() <=
+        config_.maxBufferedResponseBytes()) {
+      return Http::FilterDataStatus::StopIterationAndBuffer;
+    }
+    // Continuing sends the headers and the buffered JSON along with this data, so from here on the
+    // response is only held until each gRPC message is complete, and downstream flow control
+    // applies to it as it does to a server streaming response.
+    ENVOY_LOG(debug, "Transcoded response is over {} bytes, streaming it",
+              config_.maxBufferedResponseBytes());
+    streaming_response_ = true;
   }
-  // TODO(lizan): Check ResponseStatus
 
   return Http::FilterDataStatus::Continue;
 }
@@ -331,7 +354,7 @@ Http::FilterTrailersStatus JsonTranscoderFilter::encodeTrailers(Http::HeaderMap&
     encoder_callbacks_->addEncodedData(data);
   }
 
-  if (method_->server_streaming()) {
+  if (method_->server_streaming() || streaming_response_) {
     // For streaming case, the headers are already sent, so just continue here.
     return Http::FilterTrailersStatus::Continue;
   }
@@ -360,7 +383,6 @@ void JsonTranscoderFilter::setEncoderFilterCallbacks(
   encoder_callbacks_ = &callbacks;
 }
 
-// TODO(lizan): Incorporate watermarks to bound buffer sizes
 bool JsonTranscoderFilter::readToBuffer(Protobuf::io::ZeroCopyInputStream& stream,
                                         Buffer::Instance& data) {
   const void* out;
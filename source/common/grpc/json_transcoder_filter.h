@@ -60,6 +60,11 @@ public:
                    std::unique_ptr<google::grpc::transcoding::Transcoder>& transcoder,
                    const Protobuf::MethodDescriptor*& method_descriptor);
 
+  /**
+   * @return the number of bytes of a unary response that are buffered before it gets streamed.
+   */
+  uint64_t maxBufferedResponseBytes() const { return max_buffered_response_bytes_; }
+
 private:
   /**
    * Convert method descriptor to RequestInfo that needed for transcoding library
@@ -72,6 +77,7 @@ private:
   google::grpc::transcoding::PathMatcherPtr<const Protobuf::MethodDescriptor*> path_matcher_;
   std::unique_ptr<google::grpc::transcoding::TypeHelper> type_helper_;
   Protobuf::util::JsonPrintOptions print_options_;
+  uint64_t max_buffered_response_bytes_;
 };
 
 typedef std::shared_ptr<JsonTranscoderConfig> JsonTranscoderConfigSharedPtr;
@@ -112,6 +118,8 @@ private:
 
   bool error_{false};
   bool stream_reset_{false};
+  // Whether a unary response outgrew the buffer limit, and is streamed like a server streaming one.
+  bool streaming_response_{false};
 };
 
 } // namespace Grpc
@@ -0,0 +1,176 @@
+#include "common/grpc/stats_filter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "common/common/hash.h"
+#include "common/common/utility.h"
+#include "common/grpc/common.h"
+#include "common/http/headers.h"
+
+namespace Envoy {
+namespace Grpc {
+
+MethodStats::MethodStats(const std::string& path, const std::string& prefix, Stats::Scope& scope)
+    : path_(path), prefix_(prefix), scope_(scope), total_(scope.counter(prefix + "total")),
+      success_(scope.counter(prefix + "success")), failure_(scope.counter(prefix + "failure")),
+      request_message_count_(scope.counter(prefix + "request_message_count")),
+      response_message_count_(scope.counter(prefix + "response_message_count")),
+      request_time_(prefix + "request_time"), response_time_(prefix + "response_time"),
+      duration_(prefix + "duration") {}
+
+Stats::Counter& MethodStats::status(Status::GrpcStatus status) {
+  const bool valid =
+      status >= Status::GrpcStatus::Ok && status <= Status::GrpcStatus::Unauthenticated;
+  Stats::Counter*& counter = status_[valid ? status : status_.size() - 1];
+  if (!counter) {
+    counter = &scope_.counter(prefix_ + (valid ? std::to_string(status) : "invalid"));
+  }
+  return *counter;
+}
+
+MethodStats* MethodTable::lookup(const char* path, size_t length) {
+  // Only /service/method paths name a method.
+  const char* method = length > 0 && path[0] == '/'
+                           ? static_cast<const char*>(memchr(path + 1, '/', length - 1))
+                           : nullptr;
+  if (method == nullptr || method == path + 1 || method == path + length - 1 ||
+      memchr(method + 1, '/', path + length - method - 1) != nullptr) {
+    return nullptr;
+  }
+
+  std::vector<std::unique_ptr<MethodStats>>& bucket = methods_[HashUtil::xxHash64(path, length)];
+  for (const std::unique_ptr<MethodStats>& stats : bucket) {
+    if (stats->path_.size() == length && memcmp(stats->path_.data(), path, length) == 0) {
+      return stats.get();
+    }
+  }
+
+  const std::string service(path + 1, method - path - 1);
+  const std::string name(method + 1, path + length - method - 1);
+  bucket.emplace_back(new MethodStats(std::string(path, length),
+                                     prefix_ + "grpc." + service + "." + name + ".", scope_));
+  return bucket.back().get();
+}
+
+StatsFilterConfig::StatsFilterConfig(const std::string& stat_prefix, Stats::Scope& scope,
+                                     ThreadLocal::SlotAllocator& tls)
+    : tls_(tls.allocateSlot()) {
+  tls_->set([stat_prefix, &scope](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<MethodTable>(stat_prefix, scope);
+  });
+}
+
+void StatsFilter::onDestroy() {
+  if (method_ && !response_complete_) {
+    // The stream was reset before the response completed.
+    onResponseComplete(Status::GrpcStatus::Canceled);
+  }
+}
+
+Http::FilterHeadersStatus StatsFilter::decodeHeaders(Http::HeaderMap& headers, bool end_stream) {
+  const Http::HeaderEntry* content_type = headers.ContentType();
+  if (!content_type || !(content_type->value() == Common::GRPC_CONTENT_TYPE.c_str() ||
+                         StringUtil::startsWith(content_type->value().c_str(),
+                                                Common::GRPC_CONTENT_TYPE + "+"))) {
+    return Http::FilterHeadersStatus::Continue;
+  }
+
+  const Http::HeaderEntry* path = headers.Path();
+  if (!path) {
+    return Http::FilterHeadersStatus::Continue;
+  }
+  method_ = config_->methods().lookup(path->value().c_str(), path->value().size());
+  if (!method_) {
+    return Http::FilterHeadersStatus::Continue;
+  }
+
+  start_ = time_source_->currentTime();
+  method_->total_.inc();
+  if (end_stream) {
+    onRequestComplete();
+  }
+  return Http::FilterHeadersStatus::Continue;
+}
+
+Http::FilterDataStatus StatsFilter::decodeData(Buffer::Instance& data, bool end_stream) {
+  if (method_) {
+    method_->request_message_count_.add(request_frames_.inspect(data));
+    if (end_stream) {
+      onRequestComplete();
+    }
+  }
+  return Http::FilterDataStatus::Continue;
+}
+
+Http::FilterTrailersStatus StatsFilter::decodeTrailers(Http::HeaderMap&) {
+  if (method_) {
+    onRequestComplete();
+  }
+  return Http::FilterTrailersStatus::Continue;
+}
+
+Http::FilterHeadersStatus StatsFilter::encodeHeaders(Http::HeaderMap& headers, bool end_stream) {
+  if (!method_) {
+    return Http::FilterHeadersStatus::Continue;
+  }
+
+  method_->scope_.deliverTimingToSinks(method_->response_time_, elapsed());
+
+  // A response without a grpc-status gets the one its HTTP status maps to.
+  uint64_t http_status;
+  if (headers.Status() && StringUtil::atoul(headers.Status()->value().c_str(), http_status) &&
+      http_status != 200) {
+    missing_status_ = Common::httpToGrpcStatus(http_status);
+  }
+
+  if (end_stream) {
+    // A trailers-only response carries its grpc-status in the headers.
+    const Optional<Status::GrpcStatus> status = Common::getGrpcStatus(headers);
+    onResponseComplete(status.valid() ? status.value() : missing_status_);
+  }
+  return Http::FilterHeadersStatus::Continue;
+}
+
+Http::FilterDataStatus StatsFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (method_) {
+    method_->response_message_count_.add(response_frames_.inspect(data));
+    if (end_stream) {
+      onResponseComplete(missing_status_);
+    }
+  }
+  return Http::FilterDataStatus::Continue;
+}
+
+Http::FilterTrailersStatus StatsFilter::encodeTrailers(Http::HeaderMap& trailers) {
+  if (method_) {
+    const Optional<Status::GrpcStatus> status = Common::getGrpcStatus(trailers);
+    onResponseComplete(status.valid() ? status.value() : missing_status_);
+  }
+  return Http::FilterTrailersStatus::Continue;
+}
+
+void StatsFilter::onRequestComplete() {
+  method_->scope_.deliverTimingToSinks(method_->request_time_, elapsed());
+}
+
+void StatsFilter::onResponseComplete(Status::GrpcStatus status) {
+  response_complete_ = true;
+  method_->status(status).inc();
+  if (status == Status::GrpcStatus::Ok) {
+    method_->success_.inc();
+  } else {
+    method_->failure_.inc();
+  }
+  method_->scope_.deliverTimingToSinks(method_->duration_, elapsed());
+}
+
+std::chrono::milliseconds StatsFilter::elapsed() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(time_source_->currentTime() -
+                                                               start_);
+}
+
+} // namespace Grpc
+} // namespace Envoy
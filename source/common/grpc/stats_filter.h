@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/grpc/status.h"
+#include "envoy/http/filter.h"
+#include "envoy/stats/stats.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/common/non_copyable.h"
+#include "common/grpc/codec.h"
+
+namespace Envoy {
+namespace Grpc {
+
+/**
+ * The stats of one gRPC method, resolved when the method is first seen so that charging a request
+ * formats nothing. Stats are rooted at <stat_prefix>grpc.<service>.<method>.
+ */
+class MethodStats : NonCopyable {
+public:
+  MethodStats(const std::string& path, const std::string& prefix, Stats::Scope& scope);
+
+  /**
+   * @return Stats::Counter& the counter of a gRPC status code.
+   */
+  Stats::Counter& status(Status::GrpcStatus status);
+
+  const std::string path_;
+  const std::string prefix_;
+  Stats::Scope& scope_;
+  Stats::Counter& total_;
+  Stats::Counter& success_;
+  Stats::Counter& failure_;
+  Stats::Counter& request_message_count_;
+  Stats::Counter& response_message_count_;
+  const std::string request_time_;
+  const std::string response_time_;
+  const std::string duration_;
+
+private:
+  // Resolved on first use, indexed by status code. The last one is for an invalid code.
+  std::array<Stats::Counter*, Status::GrpcStatus::Unauthenticated + 2> status_{};
+};
+
+/**
+ * Table from request paths to the stats of their method. Each worker has its own, so lookups
+ * take no lock, and a method is resolved once per worker.
+ */
+class MethodTable : public ThreadLocal::ThreadLocalObject {
+public:
+  MethodTable(const std::string& prefix, Stats::Scope& scope) : prefix_(prefix), scope_(scope) {}
+
+  /**
+   * @param path supplies the :path of a request.
+   * @return MethodStats* the stats of the method, or nullptr if the path is not /service/method.
+   */
+  MethodStats* lookup(const char* path, size_t length);
+
+private:
+  const std::string prefix_;
+  Stats::Scope& scope_;
+  // By hash of the path. Methods whose paths collide share a bucket.
+  std::unordered_map<uint64_t, std::vector<std::unique_ptr<MethodStats>>> methods_;
+};
+
+/**
+ * Configuration for the gRPC stats filter.
+ */
+class StatsFilterConfig {
+public:
+  StatsFilterConfig(const std::string& stat_prefix, Stats::Scope& scope,
+                    ThreadLocal::SlotAllocator& tls);
+
+  MethodTable& methods() { return tls_->getTyped<MethodTable>(); }
+
+private:
+  ThreadLocal::SlotPtr tls_;
+};
+
+typedef std::shared_ptr<StatsFilterConfig> StatsFilterConfigSharedPtr;
+
+/**
+ * See docs/configuration/http_filters/grpc_stats_filter.rst
+ */
+class StatsFilter : public Http::StreamFilter {
+public:
+  StatsFilter(StatsFilterConfigSharedPtr config) : config_(config) {}
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  Http::FilterHeadersStatus decodeHeaders(Http::HeaderMap& headers, bool end_stream) override;
+  Http::FilterDataStatus decodeData(Buffer::Instance& data, bool end_stream) override;
+  Http::FilterTrailersStatus decodeTrailers(Http::HeaderMap& trailers) override;
+  void setDecoderFilterCallbacks(Http::StreamDecoderFilterCallbacks& callbacks) override {
+    time_source_ = &callbacks.dispatcher().approximateMonotonicTime();
+  }
+
+  // Http::StreamEncoderFilter
+  Http::FilterHeadersStatus encodeHeaders(Http::HeaderMap& headers, bool end_stream) override;
+  Http::FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  Http::FilterTrailersStatus encodeTrailers(Http::HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(Http::StreamEncoderFilterCallbacks&) override {}
+
+private:
+  void onRequestComplete();
+  void onResponseComplete(Status::GrpcStatus status);
+  std::chrono::milliseconds elapsed();
+
+  StatsFilterConfigSharedPtr config_;
+  MethodStats* method_{};
+  MonotonicTimeSource* time_source_{};
+  MonotonicTime start_;
+  FrameInspector request_frames_;
+  FrameInspector response_frames_;
+  // The status charged when the response carries no grpc-status.
+  Status::GrpcStatus missing_status_{Status::GrpcStatus::Unknown};
+  bool response_complete_{};
+};
+
+} // namespace Grpc
+} // namespace Envoy
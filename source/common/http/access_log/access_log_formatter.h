@@ -69,9 +69,9 @@ class FormatterImpl : public Formatter {
 public:
   FormatterImpl(const std::string& format);
 
-  // Formatter::format
-  std::string format(const HeaderMap& request_headers, const HeaderMap& response_headers,
-                     const RequestInfo& request_info) const override;
+  // Formatter::formatTo
+  void formatTo(const HeaderMap& request_headers, const HeaderMap& response_headers,
+                const RequestInfo& request_info, std::string& output) const override;
 
 private:
   std::vector<FormatterPtr> formatters_;
@@ -85,8 +85,9 @@ class PlainStringFormatter : public Formatter {
 public:
   PlainStringFormatter(const std::string& str);
 
-  // Formatter::format
-  std::string format(const HeaderMap&, const HeaderMap&, const RequestInfo&) const override;
+  // Formatter::formatTo
+  void formatTo(const HeaderMap&, const HeaderMap&, const RequestInfo&,
+                std::string& output) const override;
 
 private:
   std::string str_;
@@ -97,7 +98,7 @@ public:
   HeaderFormatter(const std::string& main_header, const std::string& alternative_header,
                   const Optional<size_t>& max_length);
 
-  std::string format(const HeaderMap& headers) const;
+  void formatTo(const HeaderMap& headers, std::string& output) const;
 
 private:
   LowerCaseString main_header_;
@@ -113,9 +114,9 @@ public:
   RequestHeaderFormatter(const std::string& main_header, const std::string& alternative_header,
                          const Optional<size_t>& max_length);
 
-  // Formatter::format
-  std::string format(const HeaderMap& request_headers, const HeaderMap&,
-                     const RequestInfo&) const override;
+  // Formatter::formatTo
+  void formatTo(const HeaderMap& request_headers, const HeaderMap&, const RequestInfo&,
+                std::string& output) const override;
 };
 
 /**
@@ -126,9 +127,9 @@ public:
   ResponseHeaderFormatter(const std::string& main_header, const std::string& alternative_header,
                           const Optional<size_t>& max_length);
 
-  // Formatter::format
-  std::string format(const HeaderMap&, const HeaderMap& response_headers,
-                     const RequestInfo&) const override;
+  // Formatter::formatTo
+  void formatTo(const HeaderMap&, const HeaderMap& response_headers, const RequestInfo&,
+                std::string& output) const override;
 };
 
 /**
@@ -138,12 +139,12 @@ class RequestInfoFormatter : public Formatter {
 public:
   RequestInfoFormatter(const std::string& field_name);
 
-  // Formatter::format
-  std::string format(const HeaderMap&, const HeaderMap&,
-                     const RequestInfo& request_info) const override;
+  // Formatter::formatTo
+  void formatTo(const HeaderMap&, const HeaderMap&, const RequestInfo& request_info,
+                std::string& output) const override;
 
 private:
-  std::function<std::string(const RequestInfo&)> field_extractor_;
+  std::function<void(const RequestInfo&, std::string&)> field_extractor_;
 };
 
 } // namespace AccessLog
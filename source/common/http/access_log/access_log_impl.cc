@@ -1,5 +1,6 @@
 #include "common/http/access_log/access_log_impl.h"
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 
@@ -9,6 +10,7 @@
 #include "envoy/upstream/upstream.h"
 
 #include "common/common/assert.h"
+#include "common/common/hash.h"
 #include "common/common/utility.h"
 #include "common/http/access_log/access_log_formatter.h"
 #include "common/http/header_map_impl.h"
@@ -89,15 +91,18 @@ RuntimeFilter::RuntimeFilter(const envoy::api::v2::filter::RuntimeFilter& config
 
 bool RuntimeFilter::evaluate(const RequestInfo&, const HeaderMap& request_header) {
   const HeaderEntry* uuid = request_header.RequestId();
-  uint16_t sampled_value;
-  if (uuid && UuidUtils::uuidModBy(uuid->value().c_str(), sampled_value, 100)) {
-    uint64_t runtime_value =
-        std::min<uint64_t>(runtime_.snapshot().getInteger(runtime_key_, 0), 100);
-
-    return sampled_value < static_cast<uint16_t>(runtime_value);
-  } else {
+  if (!uuid) {
     return runtime_.snapshot().featureEnabled(runtime_key_, 0);
   }
+
+  // A request ID that is not a UUID is hashed, so that it is sampled the same way at every hop.
+  uint16_t sampled_value;
+  if (!UuidUtils::uuidModBy(uuid->value().c_str(), sampled_value, 100)) {
+    sampled_value = HashUtil::xxHash64(uuid->value().c_str(), uuid->value().size()) % 100;
+  }
+  uint64_t runtime_value = std::min<uint64_t>(runtime_.snapshot().getInteger(runtime_key_, 0), 100);
+
+  return sampled_value < static_cast<uint16_t>(runtime_value);
 }
 
 OperatorFilter::OperatorFilter(
@@ -144,6 +149,8 @@ bool NotHealthCheckFilter::evaluate(const RequestInfo& info, const HeaderMap&) {
   return !info.healthCheck();
 }
 
+const std::string InstanceImpl::MAX_LINES_PER_SECOND_KEY = "access_log.max_lines_per_second";
+
 InstanceImpl::InstanceImpl(const std::string& access_log_path, FilterPtr&& filter,
                            FormatterPtr&& formatter,
                            Envoy::AccessLog::AccessLogManager& log_manager)
@@ -153,7 +160,8 @@ InstanceImpl::InstanceImpl(const std::string& access_log_path, FilterPtr&& filte
 
 InstanceSharedPtr InstanceImpl::fromProto(const envoy::api::v2::filter::AccessLog& config,
                                           Runtime::Loader& runtime,
-                                          Envoy::AccessLog::AccessLogManager& log_manager) {
+                                          Envoy::AccessLog::AccessLogManager& log_manager,
+                                          Stats::Scope& scope) {
   std::string access_log_path = config.path();
 
   FilterPtr filter;
@@ -168,8 +176,21 @@ InstanceSharedPtr InstanceImpl::fromProto(const envoy::api::v2::filter::AccessLo
     formatter.reset(new FormatterImpl(config.format()));
   }
 
-  return InstanceSharedPtr{
+  std::shared_ptr<InstanceImpl> log{
       new InstanceImpl(access_log_path, std::move(filter), std::move(formatter), log_manager)};
+  const uint64_t lines_per_second = runtime.snapshot().getInteger(MAX_LINES_PER_SECOND_KEY, 0);
+  if (lines_per_second > 0) {
+    log->limitRate(std::min<uint64_t>(lines_per_second, UINT32_MAX),
+                   scope.counter("access_log.rate_limited"));
+  }
+  return log;
+}
+
+void InstanceImpl::limitRate(uint32_t lines_per_second, Stats::Counter& rate_limited) {
+  rate_limit_.reset(new RateLimit::TokenBucket(lines_per_second, lines_per_second,
+                                               std::chrono::milliseconds(1000),
+                                               ProdMonotonicTimeSource::instance_));
+  rate_limited_ = &rate_limited;
 }
 
 void InstanceImpl::log(const HeaderMap* request_headers, const HeaderMap* response_headers,
@@ -188,8 +209,17 @@ void InstanceImpl::log(const HeaderMap* request_headers, const HeaderMap* respon
     }
   }
 
-  std::string access_log_line =
-      formatter_->format(*request_headers, *response_headers, request_info);
+  uint32_t remaining;
+  if (rate_limit_ && !rate_limit_->consume(remaining)) {
+    rate_limited_->inc();
+    return;
+  }
+
+  // The line is built in a buffer that each thread reuses, so that logging does not allocate once
+  // the buffer has grown to the size of the longest line.
+  static thread_local std::string access_log_line;
+  access_log_line.clear();
+  formatter_->formatTo(*request_headers, *response_headers, request_info, access_log_line);
   log_file_->write(access_log_line);
 }
 
@@ -7,8 +7,10 @@
 #include "envoy/access_log/access_log.h"
 #include "envoy/http/access_log.h"
 #include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats.h"
 
 #include "common/protobuf/protobuf.h"
+#include "common/ratelimit/local_ratelimit_impl.h"
 
 #include "api/filter/http_connection_manager.pb.h"
 
@@ -121,7 +123,8 @@ public:
 };
 
 /**
- * Filter that uses a runtime feature key to check if the log should be written.
+ * Filter that uses a runtime feature key to check if the log should be written. Requests are
+ * sampled by their x-request-id when they have one, so that every hop logs the same requests.
  */
 class RuntimeFilter : public Filter {
 public:
@@ -140,18 +143,34 @@ public:
   InstanceImpl(const std::string& access_log_path, FilterPtr&& filter, FormatterPtr&& formatter,
                Envoy::AccessLog::AccessLogManager& log_manager);
 
+  /**
+   * Create an access log from proto. If the runtime key MAX_LINES_PER_SECOND_KEY is set when the
+   * log is created, the log writes at most that many lines a second, and counts the lines over the
+   * limit in the access_log.rate_limited counter of the scope.
+   */
   static InstanceSharedPtr fromProto(const envoy::api::v2::filter::AccessLog& config,
                                      Runtime::Loader& runtime,
-                                     Envoy::AccessLog::AccessLogManager& log_manager);
+                                     Envoy::AccessLog::AccessLogManager& log_manager,
+                                     Stats::Scope& scope);
+
+  /**
+   * Write at most lines_per_second lines a second, with bursts of up to as many, and count the
+   * other lines in rate_limited. The limit is shared by all the workers without locking.
+   */
+  void limitRate(uint32_t lines_per_second, Stats::Counter& rate_limited);
 
   // Http::AccessLog::Instance
   void log(const HeaderMap* request_headers, const HeaderMap* response_headers,
            const RequestInfo& request_info) override;
 
+  static const std::string MAX_LINES_PER_SECOND_KEY;
+
 private:
   Filesystem::FileSharedPtr log_file_;
   FilterPtr filter_;
   FormatterPtr formatter_;
+  RateLimit::TokenBucketPtr rate_limit_;
+  Stats::Counter* rate_limited_{};
 };
 
 } // namespace AccessLog
@@ -0,0 +1,210 @@
+#include "common/http/access_log/grpc_access_log_impl.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "common/common/assert.h"
+#include "common/common/logger.h"
+#include "common/common/utility.h"
+#include "common/grpc/async_client_impl.h"
+#include "common/http/access_log/access_log_impl.h"
+#include "common/http/header_map_impl.h"
+
+namespace Envoy {
+namespace Http {
+namespace AccessLog {
+
+const std::string GrpcAccessLogImpl::PATH_PREFIX = "grpc://";
+const uint32_t GrpcAccessLogImpl::MAX_BATCH_ENTRIES;
+const std::chrono::milliseconds GrpcAccessLogImpl::FLUSH_INTERVAL(1000);
+const uint32_t GrpcAccessLogImpl::MAX_BUFFERED_ENTRIES;
+
+GrpcAccessLogImpl::GrpcAccessLogImpl(FilterPtr&& filter, AccessLogAsyncClientFactory client_factory,
+                                     ThreadLocal::SlotAllocator& tls, Stats::Scope& scope,
+                                     const std::string& stat_prefix)
+    : filter_(std::move(filter)), tls_(tls.allocateSlot()) {
+  const GrpcAccessLogStats stats{
+      ALL_GRPC_ACCESS_LOG_STATS(POOL_COUNTER_PREFIX(scope, stat_prefix))};
+  tls_->set([client_factory, stats](
+                Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<ThreadLocalStream>(client_factory(), dispatcher, stats);
+  });
+}
+
+bool GrpcAccessLogImpl::isGrpcPath(const std::string& path) {
+  return StringUtil::startsWith(path.c_str(), PATH_PREFIX);
+}
+
+InstanceSharedPtr GrpcAccessLogImpl::fromProto(const envoy::api::v2::filter::AccessLog& config,
+                                               Runtime::Loader& runtime,
+                                               Upstream::ClusterManager& cm,
+                                               ThreadLocal::SlotAllocator& tls,
+                                               Stats::Scope& scope) {
+  ASSERT(isGrpcPath(config.path()));
+  const std::string cluster_name = config.path().substr(PATH_PREFIX.size());
+  if (cm.get(cluster_name) == nullptr) {
+    throw EnvoyException(
+        fmt::format("unknown gRPC access log collector cluster '{}'", cluster_name));
+  }
+
+  FilterPtr filter;
+  if (config.has_filter()) {
+    filter = FilterFactory::fromProto(config.filter(), runtime);
+  }
+
+  AccessLogAsyncClientFactory client_factory = [&cm, cluster_name]() -> AccessLogAsyncClientPtr {
+    return AccessLogAsyncClientPtr{
+        new Grpc::AsyncClientImpl<pb::envoy::accesslog::StreamAccessLogsMessage,
+                                  pb::envoy::accesslog::StreamAccessLogsResponse>(cm,
+                                                                                  cluster_name)};
+  };
+  return InstanceSharedPtr{new GrpcAccessLogImpl(std::move(filter), client_factory, tls, scope,
+                                                 "access_log.grpc." + cluster_name + ".")};
+}
+
+void GrpcAccessLogImpl::createEntry(pb::envoy::accesslog::HTTPAccessLogEntry& entry,
+                                    const HeaderMap& request_headers,
+                                    const RequestInfo& request_info) {
+  entry.set_start_time_us(std::chrono::duration_cast<std::chrono::microseconds>(
+                              request_info.startTime().time_since_epoch())
+                              .count());
+  entry.set_request_received_duration_us(request_info.requestReceivedDuration().count());
+  entry.set_response_received_duration_us(request_info.responseReceivedDuration().count());
+  entry.set_duration_us(request_info.duration().count());
+  entry.set_bytes_received(request_info.bytesReceived());
+  entry.set_bytes_sent(request_info.bytesSent());
+
+  switch (request_info.protocol()) {
+  case Protocol::Http10:
+    entry.set_protocol(pb::envoy::accesslog::HTTPAccessLogEntry::HTTP10);
+    break;
+  case Protocol::Http11:
+    entry.set_protocol(pb::envoy::accesslog::HTTPAccessLogEntry::HTTP11);
+    break;
+  case Protocol::Http2:
+    entry.set_protocol(pb::envoy::accesslog::HTTPAccessLogEntry::HTTP2);
+    break;
+  }
+
+  if (request_info.responseCode().valid()) {
+    entry.set_response_code(request_info.responseCode().value());
+  }
+
+  uint32_t response_flags = 0;
+  for (uint32_t flag = ResponseFlag::FailedLocalHealthCheck; flag <= ResponseFlag::RateLimited;
+       flag <<= 1) {
+    if (request_info.getResponseFlag(static_cast<ResponseFlag>(flag))) {
+      response_flags |= flag;
+    }
+  }
+  entry.set_response_flags(response_flags);
+
+  if (request_info.upstreamHost()) {
+    entry.set_upstream_host(request_info.upstreamHost()->address()->asString());
+    entry.set_upstream_cluster(request_info.upstreamHost()->cluster().name());
+  }
+
+  if (request_headers.Method()) {
+    entry.set_method(request_headers.Method()->value().c_str());
+  }
+  if (request_headers.EnvoyOriginalPath()) {
+    entry.set_path(request_headers.EnvoyOriginalPath()->value().c_str());
+  } else if (request_headers.Path()) {
+    entry.set_path(request_headers.Path()->value().c_str());
+  }
+  if (request_headers.Host()) {
+    entry.set_authority(request_headers.Host()->value().c_str());
+  }
+  if (request_headers.UserAgent()) {
+    entry.set_user_agent(request_headers.UserAgent()->value().c_str());
+  }
+  if (request_headers.RequestId()) {
+    entry.set_request_id(request_headers.RequestId()->value().c_str());
+  }
+  if (request_headers.ForwardedFor()) {
+    entry.set_forwarded_for(request_headers.ForwardedFor()->value().c_str());
+  }
+}
+
+void GrpcAccessLogImpl::log(const HeaderMap* request_headers, const HeaderMap*,
+                            const RequestInfo& request_info) {
+  static HeaderMapImpl empty_headers;
+  if (!request_headers) {
+    request_headers = &empty_headers;
+  }
+
+  if (filter_ && !filter_->evaluate(request_info, *request_headers)) {
+    return;
+  }
+
+  tls_->getTyped<ThreadLocalStream>().log(*request_headers, request_info);
+}
+
+GrpcAccessLogImpl::ThreadLocalStream::ThreadLocalStream(AccessLogAsyncClientPtr&& client,
+                                                        Event::Dispatcher& dispatcher,
+                                                        const GrpcAccessLogStats& stats)
+    : service_method_(*Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+          "pb.envoy.accesslog.AccessLogService.StreamAccessLogs")),
+      client_(std::move(client)), flush_timer_(dispatcher.createTimer([this]() -> void {
+        flush_pending_ = false;
+        flush();
+      })),
+      stats_(stats) {}
+
+GrpcAccessLogImpl::ThreadLocalStream::~ThreadLocalStream() {
+  if (stream_ != nullptr) {
+    stream_->resetStream();
+  }
+}
+
+void GrpcAccessLogImpl::ThreadLocalStream::log(const HeaderMap& request_headers,
+                                               const RequestInfo& request_info) {
+  if (static_cast<uint32_t>(message_.entries_size()) >= MAX_BUFFERED_ENTRIES) {
+    stats_.dropped_.inc();
+    return;
+  }
+
+  createEntry(*message_.add_entries(), request_headers, request_info);
+  stats_.logged_.inc();
+  if (stream_ != nullptr && static_cast<uint32_t>(message_.entries_size()) >= MAX_BATCH_ENTRIES) {
+    flush();
+  } else if (!flush_pending_) {
+    flush_pending_ = true;
+    flush_timer_->enableTimer(FLUSH_INTERVAL);
+  }
+}
+
+void GrpcAccessLogImpl::ThreadLocalStream::flush() {
+  if (message_.entries_size() == 0) {
+    return;
+  }
+
+  if (stream_ == nullptr) {
+    // A stream that fails to start closes before start() returns, and the records wait for the
+    // next flush.
+    stream_ = client_->start(service_method_, *this);
+    if (stream_ == nullptr) {
+      if (!flush_pending_) {
+        flush_pending_ = true;
+        flush_timer_->enableTimer(FLUSH_INTERVAL);
+      }
+      return;
+    }
+  }
+
+  stream_->sendMessage(message_, false);
+  message_.clear_entries();
+  stats_.batches_sent_.inc();
+}
+
+void GrpcAccessLogImpl::ThreadLocalStream::onRemoteClose(Grpc::Status::GrpcStatus status,
+                                                         const std::string& message) {
+  ENVOY_LOG_MISC(debug, "gRPC access log stream closed: {}, {}", status, message);
+  stats_.stream_failure_.inc();
+  stream_ = nullptr;
+}
+
+} // namespace AccessLog
+} // namespace Http
+} // namespace Envoy
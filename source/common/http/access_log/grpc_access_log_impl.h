@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/grpc/async_client.h"
+#include "envoy/http/access_log.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+#include "envoy/upstream/cluster_manager.h"
+
+#include "common/http/access_log/grpc_access_log.pb.h"
+
+#include "api/filter/http_connection_manager.pb.h"
+
+namespace Envoy {
+namespace Http {
+namespace AccessLog {
+
+/**
+ * All gRPC access log stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_GRPC_ACCESS_LOG_STATS(COUNTER)                                                         \
+  COUNTER(logged)                                                                                  \
+  COUNTER(dropped)                                                                                 \
+  COUNTER(batches_sent)                                                                            \
+  COUNTER(stream_failure)
+// clang-format on
+
+/**
+ * Struct definition for all gRPC access log stats. @see stats_macros.h
+ */
+struct GrpcAccessLogStats {
+  ALL_GRPC_ACCESS_LOG_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+typedef Grpc::AsyncClient<pb::envoy::accesslog::StreamAccessLogsMessage,
+                          pb::envoy::accesslog::StreamAccessLogsResponse>
+    AccessLogAsyncClient;
+typedef std::unique_ptr<AccessLogAsyncClient> AccessLogAsyncClientPtr;
+typedef std::function<AccessLogAsyncClientPtr()> AccessLogAsyncClientFactory;
+
+/**
+ * Access log that sends a binary record of each request to a collector over gRPC, so that the
+ * collector does not parse formatted lines. Each worker batches its records and sends them on a
+ * stream of its own. Logging never waits on the collector: while a stream is down or behind, a
+ * worker buffers up to MAX_BUFFERED_ENTRIES records and drops the records beyond that.
+ */
+class GrpcAccessLogImpl : public Instance {
+public:
+  GrpcAccessLogImpl(FilterPtr&& filter, AccessLogAsyncClientFactory client_factory,
+                    ThreadLocal::SlotAllocator& tls, Stats::Scope& scope,
+                    const std::string& stat_prefix);
+
+  /**
+   * @return bool whether an access log path names a gRPC collector rather than a file.
+   */
+  static bool isGrpcPath(const std::string& path);
+
+  /**
+   * Create an access log whose path is PATH_PREFIX followed by the name of the collector's cluster.
+   * The format of the config is ignored.
+   */
+  static InstanceSharedPtr fromProto(const envoy::api::v2::filter::AccessLog& config,
+                                     Runtime::Loader& runtime, Upstream::ClusterManager& cm,
+                                     ThreadLocal::SlotAllocator& tls, Stats::Scope& scope);
+
+  /**
+   * Fill in the record of a request.
+   */
+  static void createEntry(pb::envoy::accesslog::HTTPAccessLogEntry& entry,
+                          const HeaderMap& request_headers, const RequestInfo& request_info);
+
+  // Http::AccessLog::Instance
+  void log(const HeaderMap* request_headers, const HeaderMap* response_headers,
+           const RequestInfo& request_info) override;
+
+  static const std::string PATH_PREFIX;
+  // A batch is sent once it has this many records, or FLUSH_INTERVAL after its first record.
+  static const uint32_t MAX_BATCH_ENTRIES = 100;
+  static const std::chrono::milliseconds FLUSH_INTERVAL;
+  static const uint32_t MAX_BUFFERED_ENTRIES = 10000;
+
+private:
+  struct ThreadLocalStream
+      : public ThreadLocal::ThreadLocalObject,
+        public Grpc::AsyncStreamCallbacks<pb::envoy::accesslog::StreamAccessLogsResponse> {
+    ThreadLocalStream(AccessLogAsyncClientPtr&& client, Event::Dispatcher& dispatcher,
+                      const GrpcAccessLogStats& stats);
+    ~ThreadLocalStream();
+
+    void log(const HeaderMap& request_headers, const RequestInfo& request_info);
+    void flush();
+
+    // Grpc::AsyncStreamCallbacks
+    void onCreateInitialMetadata(HeaderMap&) override {}
+    void onReceiveInitialMetadata(HeaderMapPtr&&) override {}
+    void
+    onReceiveMessage(Grpc::ResponsePtr<pb::envoy::accesslog::StreamAccessLogsResponse>&&) override {
+    }
+    void onReceiveTrailingMetadata(HeaderMapPtr&&) override {}
+    void onRemoteClose(Grpc::Status::GrpcStatus status, const std::string& message) override;
+
+    const Protobuf::MethodDescriptor& service_method_;
+    AccessLogAsyncClientPtr client_;
+    Grpc::AsyncStream<pb::envoy::accesslog::StreamAccessLogsMessage>* stream_{};
+    Event::TimerPtr flush_timer_;
+    bool flush_pending_{};
+    GrpcAccessLogStats stats_;
+    pb::envoy::accesslog::StreamAccessLogsMessage message_;
+  };
+
+  FilterPtr filter_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+} // namespace AccessLog
+} // namespace Http
+} // namespace Envoy
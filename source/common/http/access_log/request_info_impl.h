@@ -1,8 +1,10 @@
 #pragma once
 
+#include <array>
 #include <chrono>
 #include <cstdint>
 
+#include "envoy/common/time.h"
 #include "envoy/http/access_log.h"
 
 namespace Envoy {
@@ -10,9 +12,16 @@ namespace Http {
 namespace AccessLog {
 
 struct RequestInfoImpl : public RequestInfo {
-  RequestInfoImpl(Protocol protocol)
-      : protocol_(protocol), start_time_(std::chrono::system_clock::now()),
-        start_time_monotonic_(std::chrono::steady_clock::now()) {}
+  /**
+   * @param system_time_source supplies the source of the start time.
+   * @param time_source supplies the source of the start and current time for durations. This is
+   *        usually the approximate time of the owning dispatcher.
+   */
+  RequestInfoImpl(Protocol protocol, SystemTimeSource& system_time_source,
+                  MonotonicTimeSource& time_source)
+      : protocol_(protocol), time_source_(time_source),
+        start_time_(system_time_source.currentTime()),
+        start_time_monotonic_(time_source.currentTime()) {}
 
   // Http::AccessLog::RequestInfo
   SystemTime startTime() const override { return start_time_; }
@@ -33,6 +42,17 @@ struct RequestInfoImpl : public RequestInfo {
         std::chrono::duration_cast<std::chrono::microseconds>(time - start_time_monotonic_);
   }
 
+  void timing(RequestTiming point, MonotonicTime time) override {
+    timings_[static_cast<size_t>(point)] = time;
+  }
+  Optional<std::chrono::microseconds> timing(RequestTiming point) const override {
+    const MonotonicTime& time = timings_[static_cast<size_t>(point)];
+    if (time == MonotonicTime()) {
+      return {};
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - start_time_monotonic_);
+  }
+
   uint64_t bytesReceived() const override { return bytes_received_; }
 
   Protocol protocol() const override { return protocol_; }
@@ -43,7 +63,7 @@ struct RequestInfoImpl : public RequestInfo {
   uint64_t bytesSent() const override { return bytes_sent_; }
 
   std::chrono::microseconds duration() const override {
-    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+    return std::chrono::duration_cast<std::chrono::microseconds>(time_source_.currentTime() -
                                                                  start_time_monotonic_);
   }
 
@@ -64,10 +84,13 @@ struct RequestInfoImpl : public RequestInfo {
   void healthCheck(bool is_hc) override { hc_request_ = is_hc; }
 
   Protocol protocol_;
+  MonotonicTimeSource& time_source_;
   const SystemTime start_time_;
   const MonotonicTime start_time_monotonic_;
   std::chrono::microseconds request_received_duration_{};
   std::chrono::microseconds response_received_duration_{};
+  // A default constructed time marks a point that has not been reached.
+  std::array<MonotonicTime, static_cast<size_t>(RequestTiming::Count)> timings_{};
   uint64_t bytes_received_{};
   Optional<uint32_t> response_code_;
   uint64_t bytes_sent_{};
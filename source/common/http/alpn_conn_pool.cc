@@ -0,0 +1,189 @@
+#include "common/http/alpn_conn_pool.h"
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/http/http2/codec_impl.h"
+
+namespace Envoy {
+namespace Http {
+
+AlpnConnPoolImpl::~AlpnConnPoolImpl() {
+  // The pool of the protocol fails or resets the streams it still has, which removes them here.
+  pool_.reset();
+  closeConnection();
+  drained_callbacks_.clear();
+  while (!pending_streams_.empty()) {
+    PendingStream& stream = *pending_streams_.front();
+    ConnectionPool::Callbacks& callbacks = stream.callbacks_;
+    removeStream(stream);
+    callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::ConnectionFailure,
+                            real_host_description_);
+  }
+}
+
+void AlpnConnPoolImpl::addDrainedCallback(DrainedCb cb) {
+  if (pool_) {
+    pool_->addDrainedCallback(cb);
+    return;
+  }
+
+  drained_callbacks_.push_back(cb);
+  checkForDrained();
+}
+
+void AlpnConnPoolImpl::checkForDrained() {
+  // Without waiting streams there is no reason to keep learning the protocol.
+  if (!pool_ && !drained_callbacks_.empty() && pending_streams_.empty()) {
+    closeConnection();
+    for (const DrainedCb& cb : drained_callbacks_) {
+      cb();
+    }
+  }
+}
+
+ConnectionPool::Cancellable* AlpnConnPoolImpl::newStream(StreamDecoder& response_decoder,
+                                                         ConnectionPool::Callbacks& callbacks) {
+  if (pool_) {
+    return pool_->newStream(response_decoder, callbacks);
+  }
+
+  PendingStreamPtr stream(new PendingStream(*this, response_decoder, callbacks));
+  stream->moveIntoListBack(std::move(stream), pending_streams_);
+  connect();
+  return pending_streams_.back().get();
+}
+
+void AlpnConnPoolImpl::prefetchConnections() {
+  if (pool_) {
+    pool_->prefetchConnections();
+    return;
+  }
+
+  // The pool of the protocol prefetches once there is one.
+  prefetch_ = true;
+  connect();
+}
+
+void AlpnConnPoolImpl::connect() {
+  // Once draining started, only streams warrant learning the protocol.
+  if (connection_ || (!drained_callbacks_.empty() && pending_streams_.empty())) {
+    return;
+  }
+
+  ENVOY_LOG(debug, "connecting to learn the protocol of {}", host_->address()->asString());
+  Upstream::Host::CreateConnectionData data = host_->createConnection(dispatcher_);
+  connection_ = std::move(data.connection_);
+  real_host_description_ = data.host_description_;
+  connection_->addConnectionCallbacks(*this);
+  connect_timer_ = dispatcher_.createCoarseTimer([this]() -> void { onConnectTimeout(); });
+  connect_timer_->enableTimer(host_->cluster().connectTimeout());
+  connection_->connect();
+}
+
+void AlpnConnPoolImpl::onEvent(Network::ConnectionEvent event) {
+  if (event == Network::ConnectionEvent::Connected) {
+    const Protocol protocol =
+        connection_->nextProtocol() == Http2::ALPN_STRING ? Protocol::Http2 : Protocol::Http11;
+    closeConnection();
+    onProtocol(protocol);
+    return;
+  }
+
+  // Like the pools do with a connect failure, fail the streams that wait so that the caller can
+  // decide what to do with them. The next stream tries again.
+  ENVOY_LOG(debug, "failed to learn the protocol of {}", host_->address()->asString());
+  host_->cluster().stats().upstream_cx_connect_fail_.inc();
+  host_->stats().cx_connect_fail_.inc();
+  closeConnection();
+  std::list<PendingStreamPtr> pending_streams_to_purge(std::move(pending_streams_));
+  while (!pending_streams_to_purge.empty()) {
+    PendingStreamPtr stream =
+        pending_streams_to_purge.front()->removeFromList(pending_streams_to_purge);
+    host_->cluster().stats().upstream_rq_pending_failure_eject_.inc();
+    stream->callbacks_.onPoolFailure(ConnectionPool::PoolFailureReason::ConnectionFailure,
+                                     real_host_description_);
+    dispatcher_.deferredDelete(std::move(stream));
+  }
+  checkForDrained();
+}
+
+void AlpnConnPoolImpl::closeConnection() {
+  if (connect_timer_) {
+    connect_timer_->disableTimer();
+    connect_timer_.reset();
+  }
+  if (connection_) {
+    connection_->removeConnectionCallbacks(*this);
+    connection_->close(Network::ConnectionCloseType::NoFlush);
+    dispatcher_.deferredDelete(std::move(connection_));
+  }
+}
+
+void AlpnConnPoolImpl::onConnectTimeout() {
+  // Closing raises the close event, which folds into the connect failure handling.
+  host_->cluster().stats().upstream_cx_connect_timeout_.inc();
+  connection_->close(Network::ConnectionCloseType::NoFlush);
+}
+
+void AlpnConnPoolImpl::onProtocol(Protocol protocol) {
+  ENVOY_LOG(debug, "{} selected {}", host_->address()->asString(),
+            protocol == Protocol::Http2 ? "HTTP/2" : "HTTP/1.1");
+  protocol_ = protocol;
+  pool_ = pool_factory_(protocol);
+  for (const DrainedCb& cb : drained_callbacks_) {
+    pool_->addDrainedCallback(cb);
+  }
+  drained_callbacks_.clear();
+  if (prefetch_) {
+    pool_->prefetchConnections();
+  }
+
+  // Hand the waiting streams over in arrival order. The pool may call back inline, and the
+  // callbacks may cancel other streams. Removed streams are only deleted later, so they can be
+  // skipped.
+  std::vector<PendingStream*> streams;
+  for (const PendingStreamPtr& stream : pending_streams_) {
+    streams.push_back(stream.get());
+  }
+  for (PendingStream* stream : streams) {
+    if (!stream->inserted()) {
+      continue;
+    }
+    ConnectionPool::Cancellable* handle = pool_->newStream(stream->response_decoder_, *stream);
+    if (handle) {
+      stream->handle_ = handle;
+    }
+  }
+}
+
+void AlpnConnPoolImpl::removeStream(PendingStream& stream) {
+  dispatcher_.deferredDelete(stream.removeFromList(pending_streams_));
+  checkForDrained();
+}
+
+void AlpnConnPoolImpl::PendingStream::cancel() {
+  if (handle_) {
+    handle_->cancel();
+  }
+  parent_.removeStream(*this);
+}
+
+void AlpnConnPoolImpl::PendingStream::onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                                                    Upstream::HostDescriptionConstSharedPtr host) {
+  ConnectionPool::Callbacks& callbacks = callbacks_;
+  parent_.removeStream(*this);
+  callbacks.onPoolFailure(reason, host);
+}
+
+void AlpnConnPoolImpl::PendingStream::onPoolReady(StreamEncoder& request_encoder,
+                                                  Upstream::HostDescriptionConstSharedPtr host) {
+  ConnectionPool::Callbacks& callbacks = callbacks_;
+  parent_.removeStream(*this);
+  callbacks.onPoolReady(request_encoder, host);
+}
+
+} // namespace Http
+} // namespace Envoy
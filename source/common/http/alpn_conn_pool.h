@@ -0,0 +1,119 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <memory>
+
+#include "envoy/event/deferred_deletable.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/http/codec.h"
+#include "envoy/http/conn_pool.h"
+#include "envoy/network/connection.h"
+#include "envoy/upstream/upstream.h"
+
+#include "common/common/linked_object.h"
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * A connection pool for hosts that may or may not speak HTTP/2. The first time it is used, the pool
+ * opens a connection to learn which protocol the host selects with ALPN and then hands all streams
+ * to an HTTP/2 pool if the host selected h2 and to an HTTP/1.1 pool otherwise. The result is kept
+ * for the life of the pool, i.e. for as long as the host is part of the cluster.
+ *
+ * Streams that arrive while the protocol is being learned wait in the pool. If the connection
+ * fails, they fail like the pending requests of the other pools, and the next stream tries again.
+ */
+class AlpnConnPoolImpl : Logger::Loggable<Logger::Id::pool>,
+                         public ConnectionPool::Instance,
+                         public Network::ConnectionCallbacks {
+public:
+  /**
+   * Creates the pool for the protocol the host selected.
+   */
+  typedef std::function<ConnectionPool::InstancePtr(Protocol protocol)> PoolFactory;
+
+  AlpnConnPoolImpl(Event::Dispatcher& dispatcher, Upstream::HostConstSharedPtr host,
+                   PoolFactory pool_factory)
+      : dispatcher_(dispatcher), host_(host), pool_factory_(pool_factory) {}
+
+  ~AlpnConnPoolImpl();
+
+  /**
+   * @return the protocol the host selected, or nullptr if it is not known yet.
+   */
+  const Protocol* protocol() const { return pool_ ? &protocol_ : nullptr; }
+
+  // ConnectionPool::Instance
+  void addDrainedCallback(DrainedCb cb) override;
+  ConnectionPool::Cancellable* newStream(StreamDecoder& response_decoder,
+                                         ConnectionPool::Callbacks& callbacks) override;
+  void prefetchConnections() override;
+
+  // Network::ConnectionCallbacks
+  void onEvent(Network::ConnectionEvent event) override;
+  void onAboveWriteBufferHighWatermark() override {}
+  void onBelowWriteBufferLowWatermark() override {}
+
+private:
+  /**
+   * A stream that waits for the protocol, and then for the pool of that protocol.
+   */
+  struct PendingStream : LinkedObject<PendingStream>,
+                         public ConnectionPool::Cancellable,
+                         public ConnectionPool::Callbacks,
+                         public Event::DeferredDeletable {
+    PendingStream(AlpnConnPoolImpl& parent, StreamDecoder& response_decoder,
+                  ConnectionPool::Callbacks& callbacks)
+        : parent_(parent), response_decoder_(response_decoder), callbacks_(callbacks) {}
+
+    // ConnectionPool::Cancellable
+    void cancel() override;
+
+    // ConnectionPool::Callbacks
+    void onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                       Upstream::HostDescriptionConstSharedPtr host) override;
+    void onPoolReady(StreamEncoder& request_encoder,
+                     Upstream::HostDescriptionConstSharedPtr host) override;
+    void onPoolConnectionTiming(const ConnectionPool::ConnectionTiming& timing) override {
+      callbacks_.onPoolConnectionTiming(timing);
+    }
+
+    AlpnConnPoolImpl& parent_;
+    StreamDecoder& response_decoder_;
+    ConnectionPool::Callbacks& callbacks_;
+    // The handle of the stream in the pool of the protocol, once it has been handed over.
+    ConnectionPool::Cancellable* handle_{};
+  };
+
+  typedef std::unique_ptr<PendingStream> PendingStreamPtr;
+
+  void checkForDrained();
+  void closeConnection();
+  void connect();
+  void onConnectTimeout();
+  void onProtocol(Protocol protocol);
+  void removeStream(PendingStream& stream);
+
+  Event::Dispatcher& dispatcher_;
+  Upstream::HostConstSharedPtr host_;
+  PoolFactory pool_factory_;
+  Protocol protocol_{Protocol::Http11};
+  ConnectionPool::InstancePtr pool_;
+  // The connection that learns the protocol, while it connects.
+  Network::ClientConnectionPtr connection_;
+  Upstream::HostDescriptionConstSharedPtr real_host_description_;
+  Event::TimerPtr connect_timer_;
+  // Streams waiting for the protocol, and then the ones the pool of the protocol has not made
+  // ready yet, oldest first.
+  std::list<PendingStreamPtr> pending_streams_;
+  std::list<DrainedCb> drained_callbacks_;
+  // Whether to prefetch once the pool of the protocol exists.
+  bool prefetch_{};
+};
+
+} // namespace Http
+} // namespace Envoy
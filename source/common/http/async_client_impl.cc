@@ -6,6 +6,9 @@
 #include <string>
 #include <vector>
 
+#include "common/buffer/buffer_impl.h"
+#include "common/common/enum_to_int.h"
+#include "common/http/header_map_impl.h"
 #include "common/http/utility.h"
 
 namespace Envoy {
@@ -19,6 +22,7 @@ const AsyncStreamImpl::NullShadowPolicy AsyncStreamImpl::RouteEntryImpl::shadow_
 const AsyncStreamImpl::NullVirtualHost AsyncStreamImpl::RouteEntryImpl::virtual_host_;
 const AsyncStreamImpl::NullRateLimitPolicy AsyncStreamImpl::NullVirtualHost::rate_limit_policy_;
 const std::multimap<std::string, std::string> AsyncStreamImpl::RouteEntryImpl::opaque_config_;
+const Optional<uint32_t> AsyncStreamImpl::RouteEntryImpl::cluster_id_;
 
 AsyncClientImpl::AsyncClientImpl(const Upstream::ClusterInfo& cluster, Stats::Store& stats_store,
                                  Event::Dispatcher& dispatcher,
@@ -34,6 +38,10 @@ AsyncClientImpl::~AsyncClientImpl() {
   while (!active_streams_.empty()) {
     active_streams_.front()->reset();
   }
+  while (!active_direct_requests_.empty()) {
+    active_direct_requests_.front()->resetUpstream();
+    active_direct_requests_.front()->onFailure();
+  }
 }
 
 AsyncClient::Request* AsyncClientImpl::send(MessagePtr&& request, AsyncClient::Callbacks& callbacks,
@@ -53,6 +61,34 @@ AsyncClient::Request* AsyncClientImpl::send(MessagePtr&& request, AsyncClient::C
   }
 }
 
+AsyncClient::Request*
+AsyncClientImpl::sendDirect(MessagePtr&& request, AsyncClient::Callbacks& callbacks,
+                            const Optional<std::chrono::milliseconds>& timeout,
+                            const std::string& caller) {
+  std::unique_ptr<AsyncDirectRequestImpl> new_request{new AsyncDirectRequestImpl(
+      std::move(request), *this, callbacks, timeout, callerStats(caller))};
+  new_request->initialize();
+
+  // The request may complete inline, e.g. when there is no healthy host. If so, we will return
+  // nullptr and the request is destroyed here.
+  if (new_request->complete_) {
+    return nullptr;
+  }
+  new_request->moveIntoList(std::move(new_request), active_direct_requests_);
+  return active_direct_requests_.front().get();
+}
+
+AsyncClientCallerStats& AsyncClientImpl::callerStats(const std::string& caller) {
+  std::unique_ptr<AsyncClientCallerStats>& stats = caller_stats_[caller];
+  if (!stats) {
+    Stats::Scope& scope = cluster_.statsScope();
+    const std::string prefix = "async_client." + caller + ".";
+    stats.reset(new AsyncClientCallerStats{ALL_ASYNC_CLIENT_CALLER_STATS(
+        POOL_COUNTER_PREFIX(scope, prefix), POOL_TIMER_PREFIX(scope, prefix))});
+  }
+  return *stats;
+}
+
 AsyncClient::Stream* AsyncClientImpl::start(AsyncClient::StreamCallbacks& callbacks,
                                             const Optional<std::chrono::milliseconds>& timeout) {
   std::unique_ptr<AsyncStreamImpl> new_stream{new AsyncStreamImpl(*this, callbacks, timeout)};
@@ -63,7 +99,9 @@ AsyncClient::Stream* AsyncClientImpl::start(AsyncClient::StreamCallbacks& callba
 AsyncStreamImpl::AsyncStreamImpl(AsyncClientImpl& parent, AsyncClient::StreamCallbacks& callbacks,
                                  const Optional<std::chrono::milliseconds>& timeout)
     : parent_(parent), stream_callbacks_(callbacks), stream_id_(parent.config_.random_.random()),
-      router_(parent.config_), request_info_(Protocol::Http11),
+      router_(parent.config_), request_info_(Protocol::Http11,
+                                             parent.dispatcher_.approximateSystemTime(),
+                                             parent.dispatcher_.approximateMonotonicTime()),
       route_(std::make_shared<RouteImpl>(parent_.cluster_.name(), timeout)) {
 
   router_.setDecoderFilterCallbacks(*this);
@@ -71,14 +109,14 @@ AsyncStreamImpl::AsyncStreamImpl(AsyncClientImpl& parent, AsyncClient::StreamCal
 }
 
 void AsyncStreamImpl::encodeHeaders(HeaderMapPtr&& headers, bool end_stream) {
-#ifndef NVLOG
-  ENVOY_LOG(debug, "async http request response headers (end_stream={}):", end_stream);
-  headers->iterate(
-      [](const HeaderEntry& header, void*) -> void {
-        ENVOY_LOG(debug, "  '{}':'{}'", header.key().c_str(), header.value().c_str());
-      },
-      nullptr);
-#endif
+  if (ENVOY_LOG_CHECK_LEVEL(debug)) {
+    ENVOY_LOG(debug, "async http request response headers (end_stream={}):", end_stream);
+    headers->iterate(
+        [](const HeaderEntry& header, void*) -> void {
+          ENVOY_LOG(debug, "  '{}':'{}'", header.key().c_str(), header.value().c_str());
+        },
+        nullptr);
+  }
   ASSERT(!remote_closed_);
   stream_callbacks_.onHeaders(std::move(headers), end_stream);
   closeRemote(end_stream);
@@ -93,14 +131,14 @@ void AsyncStreamImpl::encodeData(Buffer::Instance& data, bool end_stream) {
 }
 
 void AsyncStreamImpl::encodeTrailers(HeaderMapPtr&& trailers) {
-#ifndef NVLOG
-  ENVOY_LOG(debug, "async http request response trailers:");
-  trailers->iterate(
-      [](const HeaderEntry& header, void*) -> void {
-        ENVOY_LOG(debug, "  '{}':'{}'", header.key().c_str(), header.value().c_str());
-      },
-      nullptr);
-#endif
+  if (ENVOY_LOG_CHECK_LEVEL(debug)) {
+    ENVOY_LOG(debug, "async http request response trailers:");
+    trailers->iterate(
+        [](const HeaderEntry& header, void*) -> void {
+          ENVOY_LOG(debug, "  '{}':'{}'", header.key().c_str(), header.value().c_str());
+        },
+        nullptr);
+  }
   ASSERT(!remote_closed_);
   stream_callbacks_.onTrailers(std::move(trailers));
   closeRemote(true);
@@ -211,5 +249,160 @@ void AsyncRequestImpl::cancel() {
   reset();
 }
 
+AsyncDirectRequestImpl::AsyncDirectRequestImpl(MessagePtr&& request, AsyncClientImpl& parent,
+                                               AsyncClient::Callbacks& callbacks,
+                                               const Optional<std::chrono::milliseconds>& timeout,
+                                               AsyncClientCallerStats& stats)
+    : parent_(parent), request_(std::move(request)), callbacks_(callbacks), timeout_(timeout),
+      stats_(stats) {}
+
+void AsyncDirectRequestImpl::initialize() {
+  stats_.rq_total_.inc();
+  request_timespan_ = stats_.rq_time_.allocateSpan(parent_.dispatcher_.approximateMonotonicTime());
+
+  HeaderMap& headers = request_->headers();
+  headers.insertEnvoyInternalRequest().value().setReference(
+      Headers::get().EnvoyInternalRequestValues.True);
+  Utility::appendXff(headers, *parent_.config_.local_info_.address());
+  Router::FilterUtility::setUpstreamScheme(headers, parent_.cluster_);
+
+  ConnectionPool::Instance* conn_pool = parent_.config_.cm_.httpConnPoolForCluster(
+      parent_.cluster_.name(), Upstream::ResourcePriority::Default, nullptr);
+  if (!conn_pool) {
+    stats_.rq_error_.inc();
+    sendLocalReply(Code::ServiceUnavailable, "no healthy upstream");
+    return;
+  }
+
+  if (timeout_.valid()) {
+    response_timeout_ = parent_.dispatcher_.createTimer([this]() -> void { onTimeout(); });
+    response_timeout_->enableTimer(timeout_.value());
+  }
+
+  // The pool may call back inline, in which case there is no handle to cancel.
+  conn_pool_stream_handle_ = conn_pool->newStream(*this, *this);
+}
+
+void AsyncDirectRequestImpl::onPoolFailure(ConnectionPool::PoolFailureReason,
+                                           Upstream::HostDescriptionConstSharedPtr) {
+  conn_pool_stream_handle_ = nullptr;
+  stats_.rq_error_.inc();
+  sendLocalReply(Code::ServiceUnavailable,
+                 "upstream connect error or disconnect/reset before headers");
+}
+
+void AsyncDirectRequestImpl::onPoolReady(StreamEncoder& request_encoder,
+                                         Upstream::HostDescriptionConstSharedPtr) {
+  ENVOY_LOG(debug, "async http direct request pool ready");
+  conn_pool_stream_handle_ = nullptr;
+  request_encoder_ = &request_encoder;
+  request_encoder.getStream().addCallbacks(*this);
+  request_encoder.encodeHeaders(request_->headers(), !request_->body());
+  // Encoding can reset the stream inline.
+  if (request_encoder_ && request_->body()) {
+    request_encoder.encodeData(*request_->body(), true);
+  }
+  // TODO(mattklein123): Support request trailers.
+}
+
+void AsyncDirectRequestImpl::decodeHeaders(HeaderMapPtr&& headers, bool end_stream) {
+  response_.reset(new ResponseMessageImpl(std::move(headers)));
+  if (end_stream) {
+    onComplete();
+  }
+}
+
+void AsyncDirectRequestImpl::decodeData(Buffer::Instance& data, bool end_stream) {
+  if (!response_->body()) {
+    response_->body().reset(new Buffer::OwnedImpl());
+  }
+  response_->body()->move(data);
+  if (end_stream) {
+    onComplete();
+  }
+}
+
+void AsyncDirectRequestImpl::decodeTrailers(HeaderMapPtr&& trailers) {
+  response_->trailers(std::move(trailers));
+  onComplete();
+}
+
+void AsyncDirectRequestImpl::onResetStream(StreamResetReason) {
+  request_encoder_ = nullptr;
+  stats_.rq_error_.inc();
+  if (response_) {
+    onFailure();
+  } else {
+    sendLocalReply(Code::ServiceUnavailable,
+                   "upstream connect error or disconnect/reset before headers");
+  }
+}
+
+void AsyncDirectRequestImpl::onTimeout() {
+  ENVOY_LOG(debug, "async http direct request timeout");
+  stats_.rq_timeout_.inc();
+  resetUpstream();
+  if (response_) {
+    onFailure();
+  } else {
+    sendLocalReply(Code::GatewayTimeout, "upstream request timeout");
+  }
+}
+
+void AsyncDirectRequestImpl::cancel() {
+  resetUpstream();
+  cleanup();
+}
+
+void AsyncDirectRequestImpl::resetUpstream() {
+  if (conn_pool_stream_handle_) {
+    conn_pool_stream_handle_->cancel();
+    conn_pool_stream_handle_ = nullptr;
+  }
+  if (request_encoder_) {
+    request_encoder_->getStream().removeCallbacks(*this);
+    request_encoder_->getStream().resetStream(StreamResetReason::LocalReset);
+    request_encoder_ = nullptr;
+  }
+}
+
+void AsyncDirectRequestImpl::onComplete() {
+  // The stream is done, so it no longer needs to be reset.
+  request_encoder_ = nullptr;
+  stats_.rq_success_.inc();
+  request_timespan_->complete();
+  callbacks_.onSuccess(std::move(response_));
+  cleanup();
+}
+
+void AsyncDirectRequestImpl::onFailure() {
+  callbacks_.onFailure(AsyncClient::FailureReason::Reset);
+  cleanup();
+}
+
+void AsyncDirectRequestImpl::sendLocalReply(Code code, const std::string& body) {
+  HeaderMapPtr headers{new HeaderMapImpl{
+      {Headers::get().Status, std::to_string(enumToInt(code))},
+      {Headers::get().ContentLength, std::to_string(body.size())},
+      {Headers::get().ContentType, Headers::get().ContentTypeValues.Text}}};
+  MessagePtr response{new ResponseMessageImpl(std::move(headers))};
+  response->body().reset(new Buffer::OwnedImpl(body));
+  callbacks_.onSuccess(std::move(response));
+  cleanup();
+}
+
+void AsyncDirectRequestImpl::cleanup() {
+  complete_ = true;
+  if (response_timeout_) {
+    response_timeout_->disableTimer();
+    response_timeout_.reset();
+  }
+  // This will destroy us, but only do so if we are actually in a list. This does not happen in
+  // the inline completion case.
+  if (inserted()) {
+    parent_.dispatcher_.deferredDelete(removeFromList(parent_.active_direct_requests_));
+  }
+}
+
 } // namespace Http
 } // namespace Envoy
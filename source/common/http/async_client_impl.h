@@ -7,17 +7,21 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "envoy/event/dispatcher.h"
 #include "envoy/http/async_client.h"
 #include "envoy/http/codec.h"
+#include "envoy/http/codes.h"
+#include "envoy/http/conn_pool.h"
 #include "envoy/http/header_map.h"
 #include "envoy/http/message.h"
 #include "envoy/router/router.h"
 #include "envoy/router/router_ratelimit.h"
 #include "envoy/router/shadow_writer.h"
 #include "envoy/ssl/connection.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/tracing/http_tracer.h"
 
 #include "common/common/empty_string.h"
@@ -30,8 +34,28 @@
 namespace Envoy {
 namespace Http {
 
+/**
+ * All stats of the direct requests of one async client caller. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_ASYNC_CLIENT_CALLER_STATS(COUNTER, TIMER)                                              \
+  COUNTER(rq_total)                                                                                \
+  COUNTER(rq_success)                                                                              \
+  COUNTER(rq_error)                                                                                \
+  COUNTER(rq_timeout)                                                                              \
+  TIMER(rq_time)
+// clang-format on
+
+/**
+ * Struct definition for all async client caller stats. @see stats_macros.h
+ */
+struct AsyncClientCallerStats {
+  ALL_ASYNC_CLIENT_CALLER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_TIMER_STRUCT)
+};
+
 class AsyncStreamImpl;
 class AsyncRequestImpl;
+class AsyncDirectRequestImpl;
 
 class AsyncClientImpl final : public AsyncClient {
 public:
@@ -45,19 +69,37 @@ public:
   Request* send(MessagePtr&& request, Callbacks& callbacks,
                 const Optional<std::chrono::milliseconds>& timeout) override;
 
+  Request* sendDirect(MessagePtr&& request, Callbacks& callbacks,
+                      const Optional<std::chrono::milliseconds>& timeout,
+                      const std::string& caller) override;
+
   Stream* start(StreamCallbacks& callbacks,
                 const Optional<std::chrono::milliseconds>& timeout) override;
 
   Event::Dispatcher& dispatcher() override { return dispatcher_; }
 
+  /**
+   * @return bool whether any request or stream is still open.
+   */
+  bool hasActiveStreams() const {
+    return !active_streams_.empty() || !active_direct_requests_.empty();
+  }
+
 private:
+  AsyncClientCallerStats& callerStats(const std::string& caller);
+
   const Upstream::ClusterInfo& cluster_;
   Router::FilterConfig config_;
   Event::Dispatcher& dispatcher_;
   std::list<std::unique_ptr<AsyncStreamImpl>> active_streams_;
+  std::list<std::unique_ptr<AsyncDirectRequestImpl>> active_direct_requests_;
+  // The client belongs to one thread, so the stats of its callers are looked up once per caller
+  // and thread without locking.
+  std::unordered_map<std::string, std::unique_ptr<AsyncClientCallerStats>> caller_stats_;
 
   friend class AsyncStreamImpl;
   friend class AsyncRequestImpl;
+  friend class AsyncDirectRequestImpl;
 };
 
 /**
@@ -127,6 +169,7 @@ private:
 
     // Router::RouteEntry
     const std::string& clusterName() const override { return cluster_name_; }
+    const Optional<uint32_t>& clusterId() const override { return cluster_id_; }
     void finalizeRequestHeaders(Http::HeaderMap&) const override {}
     const Router::HashPolicy* hashPolicy() const override { return nullptr; }
     Upstream::ResourcePriority priority() const override {
@@ -148,6 +191,9 @@ private:
     const std::multimap<std::string, std::string>& opaqueConfig() const override {
       return opaque_config_;
     }
+    const Upstream::MetadataMatchCriteria* metadataMatchCriteria() const override {
+      return nullptr;
+    }
     const Router::VirtualHost& virtualHost() const override { return virtual_host_; }
     bool autoHostRewrite() const override { return false; }
     bool useWebSocket() const override { return false; }
@@ -158,6 +204,7 @@ private:
     static const NullShadowPolicy shadow_policy_;
     static const NullVirtualHost virtual_host_;
     static const std::multimap<std::string, std::string> opaque_config_;
+    static const Optional<uint32_t> cluster_id_;
 
     const std::string& cluster_name_;
     Optional<std::chrono::milliseconds> timeout_;
@@ -245,5 +292,68 @@ private:
   friend class AsyncClientImpl;
 };
 
+/**
+ * A request that is sent straight to a connection pool of the cluster, without the router filter
+ * and the null route that AsyncRequestImpl goes through. The connection pool stream is driven
+ * directly, and a timeout or a failure before the response starts is turned into a local reply
+ * like the one the router would send, so callers see the same responses on both paths.
+ */
+class AsyncDirectRequestImpl final : public AsyncClient::Request,
+                                     public StreamDecoder,
+                                     public StreamCallbacks,
+                                     public ConnectionPool::Callbacks,
+                                     public Event::DeferredDeletable,
+                                     Logger::Loggable<Logger::Id::http>,
+                                     LinkedObject<AsyncDirectRequestImpl> {
+public:
+  AsyncDirectRequestImpl(MessagePtr&& request, AsyncClientImpl& parent,
+                         AsyncClient::Callbacks& callbacks,
+                         const Optional<std::chrono::milliseconds>& timeout,
+                         AsyncClientCallerStats& stats);
+
+  // AsyncClient::Request
+  void cancel() override;
+
+  // Http::StreamDecoder
+  void decodeHeaders(HeaderMapPtr&& headers, bool end_stream) override;
+  void decodeData(Buffer::Instance& data, bool end_stream) override;
+  void decodeTrailers(HeaderMapPtr&& trailers) override;
+
+  // Http::StreamCallbacks
+  void onResetStream(StreamResetReason reason) override;
+  void onAboveWriteBufferHighWatermark() override {}
+  void onBelowWriteBufferLowWatermark() override {}
+
+  // Http::ConnectionPool::Callbacks
+  void onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                     Upstream::HostDescriptionConstSharedPtr host) override;
+  void onPoolReady(StreamEncoder& request_encoder,
+                   Upstream::HostDescriptionConstSharedPtr host) override;
+  void onPoolConnectionTiming(const ConnectionPool::ConnectionTiming&) override {}
+
+private:
+  void initialize();
+  void onTimeout();
+  void resetUpstream();
+  void onComplete();
+  void onFailure();
+  void sendLocalReply(Code code, const std::string& body);
+  void cleanup();
+
+  AsyncClientImpl& parent_;
+  MessagePtr request_;
+  AsyncClient::Callbacks& callbacks_;
+  const Optional<std::chrono::milliseconds> timeout_;
+  AsyncClientCallerStats& stats_;
+  Stats::TimespanPtr request_timespan_;
+  Event::TimerPtr response_timeout_;
+  ConnectionPool::Cancellable* conn_pool_stream_handle_{};
+  StreamEncoder* request_encoder_{};
+  std::unique_ptr<MessageImpl> response_;
+  bool complete_{};
+
+  friend class AsyncClientImpl;
+};
+
 } // namespace Http
 } // namespace Envoy
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include "envoy/event/dispatcher.h"
+
 #include "common/common/enum_to_int.h"
 #include "common/http/exception.h"
 #include "common/http/http1/codec_impl.h"
@@ -18,6 +20,9 @@ CodecClient::CodecClient(Type type, Network::ClientConnectionPtr&& connection,
   connection_->addConnectionCallbacks(*this);
   connection_->addReadFilter(Network::ReadFilterSharedPtr{new CodecReadFilter(*this)});
 
+  connection_timing_.connect_start_ =
+      connection_->dispatcher().approximateMonotonicTime().currentTime();
+
   ENVOY_CONN_LOG(info, "connecting", *connection_);
   connection_->connect();
 
@@ -49,6 +54,16 @@ void CodecClient::onEvent(Network::ConnectionEvent event) {
   if (event == Network::ConnectionEvent::Connected) {
     ENVOY_CONN_LOG(debug, "connected", *connection_);
     connected_ = true;
+
+    // An SSL connection raises Connected once the handshake is done. The TCP connect finished
+    // when the handshake started.
+    const MonotonicTime now = connection_->dispatcher().approximateMonotonicTime().currentTime();
+    if (connection_->ssl()) {
+      connection_timing_.connect_end_ = connection_->ssl()->handshakeStartTime();
+      connection_timing_.handshake_end_ = now;
+    } else {
+      connection_timing_.connect_end_ = now;
+    }
   }
 
   if (event == Network::ConnectionEvent::RemoteClose) {
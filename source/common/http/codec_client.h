@@ -6,6 +6,7 @@
 
 #include "envoy/event/deferred_deletable.h"
 #include "envoy/http/codec.h"
+#include "envoy/http/conn_pool.h"
 #include "envoy/network/connection.h"
 #include "envoy/network/filter.h"
 
@@ -81,6 +82,12 @@ public:
    */
   size_t numActiveRequests() { return active_requests_.size(); }
 
+  /**
+   * @return uint32_t the maximum number of requests that the peer allows to be outstanding at the
+   *         same time.
+   */
+  uint32_t maxConcurrentStreams() { return codec_->maxConcurrentStreams(); }
+
   /**
    * Create a new stream. Note: The CodecClient will NOT buffer multiple requests for HTTP1
    * connections. Thus, calling newStream() before the previous request has been fully encoded
@@ -104,6 +111,12 @@ public:
 
   bool remoteClosed() const { return remote_closed_; }
 
+  /**
+   * @return const ConnectionPool::ConnectionTiming& when the underlying connection started and
+   *         finished connecting. The end points are not set until the connection is connected.
+   */
+  const ConnectionPool::ConnectionTiming& connectionTiming() const { return connection_timing_; }
+
 protected:
   /**
    * Create a codec client and connect to a remote host/port.
@@ -196,6 +209,7 @@ private:
   CodecClientCallbacks* codec_client_callbacks_{};
   bool connected_{};
   bool remote_closed_{};
+  ConnectionPool::ConnectionTiming connection_timing_;
 };
 
 typedef std::unique_ptr<CodecClient> CodecClientPtr;
@@ -1,11 +1,14 @@
 #include "common/http/codes.h"
 
+#include <array>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/http/header_map.h"
 #include "envoy/stats/stats.h"
 
+#include "common/common/assert.h"
 #include "common/common/enum_to_int.h"
 #include "common/common/utility.h"
 #include "common/http/headers.h"
@@ -26,6 +29,46 @@ void CodeUtility::chargeBasicResponseStat(Stats::Scope& scope, const std::string
 
 void CodeUtility::chargeResponseStat(const ResponseStatInfo& info) {
   uint64_t response_code = Utility::getResponseStatus(info.response_headers_);
+  if (info.code_stats_) {
+    info.code_stats_->chargeResponseStat(static_cast<Code>(response_code), info.upstream_canary_,
+                                         info.internal_request_);
+  } else {
+    chargeCodeStatsByName(info, response_code);
+  }
+
+  // Handle request virtual cluster.
+  if (!info.request_vcluster_name_.empty()) {
+    std::string group_string = groupStringForResponseCode(static_cast<Code>(response_code));
+    info.global_scope_
+        .counter(fmt::format("vhost.{}.vcluster.{}.upstream_rq_{}", info.request_vhost_name_,
+                             info.request_vcluster_name_, group_string))
+        .inc();
+    info.global_scope_
+        .counter(fmt::format("vhost.{}.vcluster.{}.upstream_rq_{}", info.request_vhost_name_,
+                             info.request_vcluster_name_, response_code))
+        .inc();
+  }
+
+  // Handle per zone stats.
+  if (!info.from_zone_.empty() && !info.to_zone_.empty()) {
+    if (info.code_stats_) {
+      info.code_stats_->chargeZoneResponseStat(info.from_zone_, info.to_zone_,
+                                               static_cast<Code>(response_code));
+    } else {
+      std::string group_string = groupStringForResponseCode(static_cast<Code>(response_code));
+      info.cluster_scope_
+          .counter(fmt::format("{}zone.{}.{}.upstream_rq_{}", info.prefix_, info.from_zone_,
+                               info.to_zone_, group_string))
+          .inc();
+      info.cluster_scope_
+          .counter(fmt::format("{}zone.{}.{}.upstream_rq_{}", info.prefix_, info.from_zone_,
+                               info.to_zone_, response_code))
+          .inc();
+    }
+  }
+}
+
+void CodeUtility::chargeCodeStatsByName(const ResponseStatInfo& info, uint64_t response_code) {
   chargeBasicResponseStat(info.cluster_scope_, info.prefix_, static_cast<Code>(response_code));
 
   std::string group_string = groupStringForResponseCode(static_cast<Code>(response_code));
@@ -54,30 +97,6 @@ void CodeUtility::chargeResponseStat(const ResponseStatInfo& info) {
         .counter(fmt::format("{}external.upstream_rq_{}", info.prefix_, response_code))
         .inc();
   }
-
-  // Handle request virtual cluster.
-  if (!info.request_vcluster_name_.empty()) {
-    info.global_scope_
-        .counter(fmt::format("vhost.{}.vcluster.{}.upstream_rq_{}", info.request_vhost_name_,
-                             info.request_vcluster_name_, group_string))
-        .inc();
-    info.global_scope_
-        .counter(fmt::format("vhost.{}.vcluster.{}.upstream_rq_{}", info.request_vhost_name_,
-                             info.request_vcluster_name_, response_code))
-        .inc();
-  }
-
-  // Handle per zone stats.
-  if (!info.from_zone_.empty() && !info.to_zone_.empty()) {
-    info.cluster_scope_
-        .counter(fmt::format("{}zone.{}.{}.upstream_rq_{}", info.prefix_, info.from_zone_,
-                             info.to_zone_, group_string))
-        .inc();
-    info.cluster_scope_
-        .counter(fmt::format("{}zone.{}.{}.upstream_rq_{}", info.prefix_, info.from_zone_,
-                             info.to_zone_, response_code))
-        .inc();
-  }
 }
 
 void CodeUtility::chargeResponseTiming(const ResponseTimingInfo& info) {
@@ -109,6 +128,166 @@ void CodeUtility::chargeResponseTiming(const ResponseTimingInfo& info) {
   }
 }
 
+namespace {
+
+// The known HTTP codes, used to build a dense index for CodeStatsImpl.
+const std::vector<Code>& knownCodes() {
+  static const std::vector<Code>* codes = new std::vector<Code>{
+      Code::Continue,
+      Code::OK,
+      Code::Created,
+      Code::Accepted,
+      Code::NonAuthoritativeInformation,
+      Code::NoContent,
+      Code::ResetContent,
+      Code::PartialContent,
+      Code::MultiStatus,
+      Code::AlreadyReported,
+      Code::IMUsed,
+      Code::MultipleChoices,
+      Code::MovedPermanently,
+      Code::Found,
+      Code::SeeOther,
+      Code::NotModified,
+      Code::UseProxy,
+      Code::TemporaryRedirect,
+      Code::PermanentRedirect,
+      Code::BadRequest,
+      Code::Unauthorized,
+      Code::PaymentRequired,
+      Code::Forbidden,
+      Code::NotFound,
+      Code::MethodNotAllowed,
+      Code::NotAcceptable,
+      Code::ProxyAuthenticationRequired,
+      Code::RequestTimeout,
+      Code::Conflict,
+      Code::Gone,
+      Code::LengthRequired,
+      Code::PreconditionFailed,
+      Code::PayloadTooLarge,
+      Code::URITooLong,
+      Code::UnsupportedMediaType,
+      Code::RangeNotSatisfiable,
+      Code::ExpectationFailed,
+      Code::MisdirectedRequest,
+      Code::UnprocessableEntity,
+      Code::Locked,
+      Code::FailedDependency,
+      Code::UpgradeRequired,
+      Code::PreconditionRequired,
+      Code::TooManyRequests,
+      Code::RequestHeaderFieldsTooLarge,
+      Code::InternalServerError,
+      Code::NotImplemented,
+      Code::BadGateway,
+      Code::ServiceUnavailable,
+      Code::GatewayTimeout,
+      Code::HTTPVersionNotSupported,
+      Code::VariantAlsoNegotiates,
+      Code::InsufficientStorage,
+      Code::LoopDetected,
+      Code::NotExtended,
+      Code::NetworkAuthenticationRequired};
+  return *codes;
+}
+
+const uint64_t MAX_INDEXED_CODE = 600;
+const uint8_t UNKNOWN_CODE_INDEX = 0xFF;
+
+// Maps a code in [0, MAX_INDEXED_CODE) to its position in knownCodes() or UNKNOWN_CODE_INDEX.
+const std::array<uint8_t, MAX_INDEXED_CODE>& codeIndex() {
+  static const std::array<uint8_t, MAX_INDEXED_CODE>* index = []() {
+    auto* index = new std::array<uint8_t, MAX_INDEXED_CODE>();
+    index->fill(UNKNOWN_CODE_INDEX);
+    const std::vector<Code>& codes = knownCodes();
+    ASSERT(codes.size() < UNKNOWN_CODE_INDEX);
+    for (size_t i = 0; i < codes.size(); i++) {
+      (*index)[enumToInt(codes[i])] = i;
+    }
+    return index;
+  }();
+  return *index;
+}
+
+} // namespace
+
+CodeCounterTable::CodeCounterTable(Stats::Scope& scope, const std::string& stat_prefix)
+    : scope_(scope), stat_prefix_(stat_prefix),
+      codes_(new std::atomic<Stats::Counter*>[knownCodes().size()]) {
+  for (std::atomic<Stats::Counter*>& slot : classes_) {
+    slot = nullptr;
+  }
+  for (size_t i = 0; i < knownCodes().size(); i++) {
+    codes_[i] = nullptr;
+  }
+}
+
+void CodeCounterTable::charge(Code code) {
+  const uint64_t code_value = enumToInt(code);
+  const uint8_t index = code_value < MAX_INDEXED_CODE ? codeIndex()[code_value] : UNKNOWN_CODE_INDEX;
+  if (index == UNKNOWN_CODE_INDEX) {
+    // Codes outside the table are rare. Charge them by name, matching
+    // CodeUtility::chargeBasicResponseStat().
+    scope_.counter(stat_prefix_ + CodeUtility::groupStringForResponseCode(code)).inc();
+    scope_.counter(stat_prefix_ + std::to_string(code_value)).inc();
+    return;
+  }
+
+  resolve(classes_[code_value / 100], CodeUtility::groupStringForResponseCode(code)).inc();
+  resolve(codes_[index], std::to_string(code_value)).inc();
+}
+
+Stats::Counter& CodeCounterTable::resolve(std::atomic<Stats::Counter*>& slot,
+                                          const std::string& suffix) {
+  Stats::Counter* counter = slot.load(std::memory_order_acquire);
+  if (!counter) {
+    // Multiple threads may race to fill the same slot. The scope returns the same counter to all
+    // of them so the race is benign. The suffix is only built on this slow path.
+    counter = &scope_.counter(stat_prefix_ + suffix);
+    slot.store(counter, std::memory_order_release);
+  }
+
+  return *counter;
+}
+
+CodeStatsImpl::CodeStatsImpl(Stats::Scope& scope, const std::string& prefix)
+    : scope_(scope), prefix_(prefix), upstream_(scope, prefix + "upstream_rq_"),
+      canary_(scope, prefix + "canary.upstream_rq_"),
+      internal_(scope, prefix + "internal.upstream_rq_"),
+      external_(scope, prefix + "external.upstream_rq_") {}
+
+void CodeStatsImpl::chargeResponseStat(Code code, bool canary, bool internal_request) {
+  upstream_.charge(code);
+  if (canary) {
+    canary_.charge(code);
+  }
+
+  if (internal_request) {
+    internal_.charge(code);
+  } else {
+    external_.charge(code);
+  }
+}
+
+void CodeStatsImpl::chargeZoneResponseStat(const std::string& from_zone,
+                                           const std::string& to_zone, Code code) {
+  CodeCounterTable* table;
+  {
+    // The set of zones is small and fixed for the lifetime of the cluster, so a lookup under the
+    // lock is cheap compared to building the stat names.
+    std::unique_lock<std::mutex> lock(zone_lock_);
+    CodeCounterTablePtr& entry = zones_[from_zone][to_zone];
+    if (!entry) {
+      entry.reset(new CodeCounterTable(
+          scope_, fmt::format("{}zone.{}.{}.upstream_rq_", prefix_, from_zone, to_zone)));
+    }
+    table = entry.get();
+  }
+
+  table->charge(code);
+}
+
 std::string CodeUtility::groupStringForResponseCode(Code response_code) {
   if (CodeUtility::is2xx(enumToInt(response_code))) {
     return "2xx";
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "envoy/http/codes.h"
 #include "envoy/http/header_map.h"
@@ -33,6 +37,9 @@ public:
     const std::string& from_zone_;
     const std::string& to_zone_;
     bool upstream_canary_;
+    // Optional pre-resolved stats for cluster_scope_ and prefix_. If nullptr, the cluster stats
+    // are looked up by name.
+    CodeStats* code_stats_;
   };
 
   /**
@@ -74,6 +81,59 @@ public:
   static bool is5xx(uint64_t code) { return code >= 500 && code < 600; }
 
   static std::string groupStringForResponseCode(Code response_code);
+
+private:
+  static void chargeCodeStatsByName(const ResponseStatInfo& info, uint64_t response_code);
+};
+
+/**
+ * Counter handles for the response codes of a single stat family, e.g. "{prefix}upstream_rq_".
+ * Each code is charged to both "{stat_prefix}{code class}" (e.g. 2xx) and "{stat_prefix}{code}".
+ * Each counter is resolved from the scope the first time it is charged and cached in a fixed table,
+ * so subsequent charges cost an array index and an atomic increment. Codes that are not known HTTP
+ * codes fall back to a lookup by name. Thread safe.
+ */
+class CodeCounterTable {
+public:
+  CodeCounterTable(Stats::Scope& scope, const std::string& stat_prefix);
+
+  void charge(Code code);
+
+private:
+  // Response code classes 1xx through 5xx are indexed by code / 100.
+  static const uint64_t NUM_CODE_CLASSES = 6;
+
+  Stats::Counter& resolve(std::atomic<Stats::Counter*>& slot, const std::string& suffix);
+
+  Stats::Scope& scope_;
+  const std::string stat_prefix_;
+  std::atomic<Stats::Counter*> classes_[NUM_CODE_CLASSES];
+  std::unique_ptr<std::atomic<Stats::Counter*>[]> codes_;
+};
+
+typedef std::unique_ptr<CodeCounterTable> CodeCounterTablePtr;
+
+/**
+ * Implementation of CodeStats that charges response codes through CodeCounterTables.
+ */
+class CodeStatsImpl : public CodeStats {
+public:
+  CodeStatsImpl(Stats::Scope& scope, const std::string& prefix);
+
+  // Http::CodeStats
+  void chargeResponseStat(Code code, bool canary, bool internal_request) override;
+  void chargeZoneResponseStat(const std::string& from_zone, const std::string& to_zone,
+                              Code code) override;
+
+private:
+  Stats::Scope& scope_;
+  const std::string prefix_;
+  CodeCounterTable upstream_;
+  CodeCounterTable canary_;
+  CodeCounterTable internal_;
+  CodeCounterTable external_;
+  std::mutex zone_lock_;
+  std::unordered_map<std::string, std::unordered_map<std::string, CodeCounterTablePtr>> zones_;
 };
 
 } // namespace Http
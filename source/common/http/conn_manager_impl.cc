@@ -54,10 +54,12 @@ ConnectionManagerImpl::ConnectionManagerImpl(ConnectionManagerConfig& config,
                                              Tracing::HttpTracer& tracer, Runtime::Loader& runtime,
                                              const LocalInfo::LocalInfo& local_info,
                                              Upstream::ClusterManager& cluster_manager)
-    : config_(config), stats_(config_.stats()),
+    : config_(config), stats_(config_.stats()), plain_proxy_(config_.plainProxy()),
       conn_length_(stats_.named_.downstream_cx_length_ms_.allocateSpan()),
       drain_close_(drain_close), random_generator_(random_generator), tracer_(tracer),
-      runtime_(runtime), local_info_(local_info), cluster_manager_(cluster_manager) {}
+      runtime_(runtime), local_info_(local_info), cluster_manager_(cluster_manager),
+      disable_keepalive_key_(stats_.prefix_ + "overload.loop_delay.disable_keepalive_ms"),
+      reject_requests_key_(stats_.prefix_ + "overload.loop_delay.reject_requests_ms") {}
 
 void ConnectionManagerImpl::initializeReadFilterCallbacks(Network::ReadFilterCallbacks& callbacks) {
   read_callbacks_ = &callbacks;
@@ -71,7 +73,7 @@ void ConnectionManagerImpl::initializeReadFilterCallbacks(Network::ReadFilterCal
   read_callbacks_->connection().addConnectionCallbacks(*this);
 
   if (config_.idleTimeout().valid()) {
-    idle_timer_ = read_callbacks_->connection().dispatcher().createTimer(
+    idle_timer_ = read_callbacks_->connection().dispatcher().createCoarseTimer(
         [this]() -> void { onIdleTimeout(); });
     idle_timer_->enableTimer(config_.idleTimeout().value());
   }
@@ -172,6 +174,10 @@ StreamDecoder& ConnectionManagerImpl::newStream(StreamEncoder& response_encoder)
   ActiveStreamPtr new_stream(new ActiveStream(*this));
   new_stream->response_encoder_ = &response_encoder;
   new_stream->response_encoder_->getStream().addCallbacks(*new_stream);
+  const FilterChainSize filter_chain_size =
+      plain_proxy_ ? FilterChainSize{1, 0} : config_.filterFactory().filterChainSize();
+  new_stream->decoder_filters_.reserve(filter_chain_size.decoder_filters_);
+  new_stream->encoder_filters_.reserve(filter_chain_size.encoder_filters_);
   config_.filterFactory().createFilterChain(*new_stream);
   // Make sure new streams are apprised that the underlying connection is blocked.
   if (read_callbacks_->connection().aboveHighWatermark()) {
@@ -337,8 +343,18 @@ ConnectionManagerImpl::ActiveStream::ActiveStream(ConnectionManagerImpl& connect
       snapped_route_config_(connection_manager.config_.routeConfigProvider().config()),
       stream_id_(ConnectionManagerUtility::generateStreamId(*snapped_route_config_,
                                                             connection_manager.random_generator_)),
-      request_timer_(connection_manager_.stats_.named_.downstream_rq_time_.allocateSpan()),
-      request_info_(connection_manager_.codec_->protocol()) {
+      decoder_filters_(arena_), encoder_filters_(arena_),
+      access_log_handlers_(ArenaAllocator<Http::AccessLog::InstanceSharedPtr>(arena_)),
+      request_timer_(connection_manager_.stats_.named_.downstream_rq_time_.allocateSpan(
+          connection_manager_.read_callbacks_->connection()
+              .dispatcher()
+              .approximateMonotonicTime())),
+      request_info_(
+          connection_manager_.codec_->protocol(),
+          connection_manager_.read_callbacks_->connection().dispatcher().approximateSystemTime(),
+          connection_manager_.read_callbacks_->connection()
+              .dispatcher()
+              .approximateMonotonicTime()) {
   connection_manager_.stats_.named_.downstream_rq_total_.inc();
   connection_manager_.stats_.named_.downstream_rq_active_.inc();
   if (connection_manager_.codec_->protocol() == Protocol::Http2) {
@@ -350,16 +366,19 @@ ConnectionManagerImpl::ActiveStream::ActiveStream(ConnectionManagerImpl& connect
 
 ConnectionManagerImpl::ActiveStream::~ActiveStream() {
   connection_manager_.stats_.named_.downstream_rq_active_.dec();
-  for (const AccessLog::InstanceSharedPtr& access_log : connection_manager_.config_.accessLogs()) {
-    access_log->log(request_headers_.get(), response_headers_.get(), request_info_);
-  }
-  for (const auto& log_handler : access_log_handlers_) {
-    log_handler->log(request_headers_.get(), response_headers_.get(), request_info_);
+  if (!connection_manager_.plain_proxy_) {
+    for (const AccessLog::InstanceSharedPtr& access_log :
+         connection_manager_.config_.accessLogs()) {
+      access_log->log(request_headers_.get(), response_headers_.get(), request_info_);
+    }
+    for (const auto& log_handler : access_log_handlers_) {
+      log_handler->log(request_headers_.get(), response_headers_.get(), request_info_);
+    }
   }
 
   if (request_info_.healthCheck()) {
     connection_manager_.config_.tracingStats().health_check_.inc();
-  } else {
+  } else if (active_span_) {
     Tracing::HttpConnManFinalizerImpl finalizer(request_headers_.get(), request_info_, *this);
     active_span_->finishSpan(finalizer);
   }
@@ -369,16 +388,12 @@ ConnectionManagerImpl::ActiveStream::~ActiveStream() {
 
 void ConnectionManagerImpl::ActiveStream::addStreamDecoderFilterWorker(
     StreamDecoderFilterSharedPtr filter, bool dual_filter) {
-  ActiveStreamDecoderFilterPtr wrapper(new ActiveStreamDecoderFilter(*this, filter, dual_filter));
-  filter->setDecoderFilterCallbacks(*wrapper);
-  wrapper->moveIntoListBack(std::move(wrapper), decoder_filters_);
+  filter->setDecoderFilterCallbacks(decoder_filters_.emplaceBack(*this, filter, dual_filter));
 }
 
 void ConnectionManagerImpl::ActiveStream::addStreamEncoderFilterWorker(
     StreamEncoderFilterSharedPtr filter, bool dual_filter) {
-  ActiveStreamEncoderFilterPtr wrapper(new ActiveStreamEncoderFilter(*this, filter, dual_filter));
-  filter->setEncoderFilterCallbacks(*wrapper);
-  wrapper->moveIntoListBack(std::move(wrapper), encoder_filters_);
+  filter->setEncoderFilterCallbacks(encoder_filters_.emplaceBack(*this, filter, dual_filter));
 }
 
 void ConnectionManagerImpl::ActiveStream::addAccessLogHandler(
@@ -423,14 +438,14 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
 
   request_headers_ = std::move(headers);
   ENVOY_STREAM_LOG(debug, "request headers complete (end_stream={}):", *this, end_stream);
-#ifndef NVLOG
-  request_headers_->iterate(
-      [](const HeaderEntry& header, void* context) -> void {
-        ENVOY_STREAM_LOG(debug, "  '{}':'{}'", *static_cast<ActiveStream*>(context),
-                         header.key().c_str(), header.value().c_str());
-      },
-      this);
-#endif
+  if (ENVOY_LOG_CHECK_LEVEL(debug)) {
+    request_headers_->iterate(
+        [](const HeaderEntry& header, void* context) -> void {
+          ENVOY_STREAM_LOG(debug, "  '{}':'{}'", *static_cast<ActiveStream*>(context),
+                           header.key().c_str(), header.value().c_str());
+        },
+        this);
+  }
 
   connection_manager_.user_agent_.initializeFromHeaders(
       *request_headers_, connection_manager_.stats_.prefix_, connection_manager_.stats_.scope_);
@@ -453,6 +468,16 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
     return;
   }
 
+  // A worker that has fallen far behind turns new requests away before spending any more time on
+  // them, so that the requests it already has can complete.
+  if (connection_manager_.loopDelayAtLeast(connection_manager_.reject_requests_key_)) {
+    connection_manager_.stats_.named_.downstream_rq_overload_rejected_.inc();
+    HeaderMapImpl headers{
+        {Headers::get().Status, std::to_string(enumToInt(Code::ServiceUnavailable))}};
+    encodeHeaders(nullptr, headers, true);
+    return;
+  }
+
   // Check for maximum incoming header size. Both codecs have some amount of checking for maximum
   // header size. For HTTP/1.1 the entire headers data has be less than ~80K (hard coded in
   // http_parser). For HTTP/2 the default allowed header block length is 64k.
@@ -506,9 +531,15 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
       if (websocket_requested && websocket_required) {
         ENVOY_STREAM_LOG(debug, "found websocket connection. (end_stream={}):", *this, end_stream);
 
+        Runtime::Snapshot& snapshot = connection_manager_.runtime_.snapshot();
+        const std::string& prefix = connection_manager_.stats_.prefix_;
+        const WebSocket::WsSettings ws_settings{
+            snapshot.featureEnabled(prefix + "websocket.splice", 0),
+            std::chrono::milliseconds(
+                snapshot.getInteger(prefix + "websocket.buffer_idle_timeout_ms", 0))};
         connection_manager_.ws_connection_.reset(new WebSocket::WsHandlerImpl(
             *request_headers_, *route_entry, *this, connection_manager_.cluster_manager_,
-            connection_manager_.read_callbacks_));
+            connection_manager_.read_callbacks_, ws_settings));
         connection_manager_.ws_connection_->onNewConnection();
         connection_manager_.stats_.named_.downstream_cx_websocket_active_.inc();
         connection_manager_.stats_.named_.downstream_cx_http1_active_.dec();
@@ -530,7 +561,17 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
   }
 
   // Check if tracing is enabled at all.
-  if (connection_manager_.config_.tracingConfig()) {
+  if (!connection_manager_.plain_proxy_ && connection_manager_.config_.tracingConfig()) {
+    // Adaptive sampling targets a rate per upstream cluster, so it waits for the route.
+    Tracing::AdaptiveSampler* adaptive_sampler =
+        connection_manager_.config_.tracingConfig()->adaptive_sampler_.get();
+    if (adaptive_sampler && adaptive_sampler->enabled() && cached_route_.value() &&
+        cached_route_.value()->routeEntry()) {
+      Tracing::HttpTracerUtility::mutateHeaders(
+          *request_headers_, connection_manager_.runtime_, *adaptive_sampler,
+          cached_route_.value()->routeEntry()->clusterName());
+    }
+
     Tracing::Decision tracing_decision =
         Tracing::HttpTracerUtility::isTracing(request_info_, *request_headers_);
     ConnectionManagerImpl::chargeTracingStats(tracing_decision.reason,
@@ -549,12 +590,12 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(HeaderMapPtr&& headers,
 
 void ConnectionManagerImpl::ActiveStream::decodeHeaders(ActiveStreamDecoderFilter* filter,
                                                         HeaderMap& headers, bool end_stream) {
-  std::list<ActiveStreamDecoderFilterPtr>::iterator entry;
-  std::list<ActiveStreamDecoderFilterPtr>::iterator continue_data_entry = decoder_filters_.end();
+  ActiveStreamDecoderFilterList::iterator entry;
+  ActiveStreamDecoderFilterList::iterator continue_data_entry = decoder_filters_.end();
   if (!filter) {
     entry = decoder_filters_.begin();
   } else {
-    entry = std::next(filter->entry());
+    entry = std::next(decoder_filters_.entry(*filter));
   }
 
   for (; entry != decoder_filters_.end(); entry++) {
@@ -564,7 +605,7 @@ void ConnectionManagerImpl::ActiveStream::decodeHeaders(ActiveStreamDecoderFilte
         headers, end_stream && continue_data_entry == decoder_filters_.end());
     state_.filter_call_state_ &= ~FilterCallState::DecodeHeaders;
     ENVOY_STREAM_LOG(trace, "decode headers called: filter={} status={}", *this,
-                     static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
+                     static_cast<const void*>(*entry), static_cast<uint64_t>(status));
     if (!(*entry)->commonHandleAfterHeadersCallback(status) &&
         std::next(entry) != decoder_filters_.end()) {
       // Stop iteration IFF this is not the last filter. If it is the last filter, continue with
@@ -608,11 +649,11 @@ void ConnectionManagerImpl::ActiveStream::decodeData(ActiveStreamDecoderFilter*
     return;
   }
 
-  std::list<ActiveStreamDecoderFilterPtr>::iterator entry;
+  ActiveStreamDecoderFilterList::iterator entry;
   if (!filter) {
     entry = decoder_filters_.begin();
   } else {
-    entry = std::next(filter->entry());
+    entry = std::next(decoder_filters_.entry(*filter));
   }
 
   for (; entry != decoder_filters_.end(); entry++) {
@@ -621,7 +662,7 @@ void ConnectionManagerImpl::ActiveStream::decodeData(ActiveStreamDecoderFilter*
     FilterDataStatus status = (*entry)->handle_->decodeData(data, end_stream);
     state_.filter_call_state_ &= ~FilterCallState::DecodeData;
     ENVOY_STREAM_LOG(trace, "decode data called: filter={} status={}", *this,
-                     static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
+                     static_cast<const void*>(*entry), static_cast<uint64_t>(status));
     if (!(*entry)->commonHandleAfterDataCallback(status, data)) {
       return;
     }
@@ -636,9 +677,15 @@ void ConnectionManagerImpl::ActiveStream::addDecodedData(ActiveStreamDecoderFilt
     // processing happens in the decodeHeaders() callback if necessary.
     filter.commonHandleBufferData(data);
   } else if (state_.filter_call_state_ & FilterCallState::DecodeTrailers) {
-    // In this case we need to inline dispatch the data to further filters. If those filters
-    // choose to buffer/stop iteration that's fine.
-    decodeData(&filter, data, false);
+    if (filter.stopped_) {
+      // The filter stopped iteration before its trailers, so further filters have not seen the
+      // data that came before them. Buffer the data behind it, and continuing sends it in order.
+      filter.commonHandleBufferData(data);
+    } else {
+      // In this case we need to inline dispatch the data to further filters. If those filters
+      // choose to buffer/stop iteration that's fine.
+      decodeData(&filter, data, false);
+    }
   } else {
     // TODO(mattklein123): Formalize error handling for filters and add tests. Should probably
     // throw an exception here.
@@ -660,11 +707,11 @@ void ConnectionManagerImpl::ActiveStream::decodeTrailers(ActiveStreamDecoderFilt
     return;
   }
 
-  std::list<ActiveStreamDecoderFilterPtr>::iterator entry;
+  ActiveStreamDecoderFilterList::iterator entry;
   if (!filter) {
     entry = decoder_filters_.begin();
   } else {
-    entry = std::next(filter->entry());
+    entry = std::next(decoder_filters_.entry(*filter));
   }
 
   for (; entry != decoder_filters_.end(); entry++) {
@@ -673,14 +720,14 @@ void ConnectionManagerImpl::ActiveStream::decodeTrailers(ActiveStreamDecoderFilt
     FilterTrailersStatus status = (*entry)->handle_->decodeTrailers(trailers);
     state_.filter_call_state_ &= ~FilterCallState::DecodeTrailers;
     ENVOY_STREAM_LOG(trace, "decode trailers called: filter={} status={}", *this,
-                     static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
+                     static_cast<const void*>(*entry), static_cast<uint64_t>(status));
     if (!(*entry)->commonHandleAfterTrailersCallback(status)) {
       return;
     }
   }
 }
 
-std::list<ConnectionManagerImpl::ActiveStreamEncoderFilterPtr>::iterator
+ConnectionManagerImpl::ActiveStreamEncoderFilterList::iterator
 ConnectionManagerImpl::ActiveStream::commonEncodePrefix(ActiveStreamEncoderFilter* filter,
                                                         bool end_stream) {
   // Only do base state setting on the initial call. Subsequent calls for filtering do not touch
@@ -693,7 +740,7 @@ ConnectionManagerImpl::ActiveStream::commonEncodePrefix(ActiveStreamEncoderFilte
   if (!filter) {
     return encoder_filters_.begin();
   } else {
-    return std::next(filter->entry());
+    return std::next(encoder_filters_.entry(*filter));
   }
 }
 
@@ -706,10 +753,17 @@ void ConnectionManagerImpl::startDrainSequence() {
   drain_timer_->enableTimer(config_.drainTimeout());
 }
 
+bool ConnectionManagerImpl::loopDelayAtLeast(const std::string& runtime_key) {
+  const uint64_t threshold_ms = runtime_.snapshot().getInteger(runtime_key, 0);
+  return threshold_ms > 0 &&
+         static_cast<uint64_t>(read_callbacks_->connection().dispatcher().loopDelay().count()) >=
+             threshold_ms;
+}
+
 void ConnectionManagerImpl::ActiveStream::encodeHeaders(ActiveStreamEncoderFilter* filter,
                                                         HeaderMap& headers, bool end_stream) {
-  std::list<ActiveStreamEncoderFilterPtr>::iterator entry = commonEncodePrefix(filter, end_stream);
-  std::list<ActiveStreamEncoderFilterPtr>::iterator continue_data_entry = encoder_filters_.end();
+  ActiveStreamEncoderFilterList::iterator entry = commonEncodePrefix(filter, end_stream);
+  ActiveStreamEncoderFilterList::iterator continue_data_entry = encoder_filters_.end();
 
   for (; entry != encoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::EncodeHeaders));
@@ -718,7 +772,7 @@ void ConnectionManagerImpl::ActiveStream::encodeHeaders(ActiveStreamEncoderFilte
         headers, end_stream && continue_data_entry == encoder_filters_.end());
     state_.filter_call_state_ &= ~FilterCallState::EncodeHeaders;
     ENVOY_STREAM_LOG(trace, "encode headers called: filter={} status={}", *this,
-                     static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
+                     static_cast<const void*>(*entry), static_cast<uint64_t>(status));
     if (!(*entry)->commonHandleAfterHeadersCallback(status)) {
       return;
     }
@@ -750,6 +804,18 @@ void ConnectionManagerImpl::ActiveStream::encodeHeaders(ActiveStreamEncoderFilte
     ENVOY_STREAM_LOG(debug, "drain closing connection", *this);
   }
 
+  // A worker that has fallen behind stops keeping connections alive, so that clients open new ones
+  // which may land on a worker or process with more headroom.
+  if (connection_manager_.drain_state_ == DrainState::NotDraining &&
+      connection_manager_.loopDelayAtLeast(connection_manager_.disable_keepalive_key_)) {
+    connection_manager_.stats_.named_.downstream_cx_overload_disable_keepalive_.inc();
+    if (connection_manager_.codec_->protocol() == Protocol::Http2) {
+      connection_manager_.startDrainSequence();
+    } else {
+      connection_manager_.drain_state_ = DrainState::Closing;
+    }
+  }
+
   if (connection_manager_.drain_state_ == DrainState::NotDraining && state_.saw_connection_close_) {
     ENVOY_STREAM_LOG(debug, "closing connection due to connection close header", *this);
     connection_manager_.drain_state_ = DrainState::Closing;
@@ -775,14 +841,14 @@ void ConnectionManagerImpl::ActiveStream::encodeHeaders(ActiveStreamEncoderFilte
 
   ENVOY_STREAM_LOG(debug, "encoding headers via codec (end_stream={}):", *this,
                    end_stream && continue_data_entry == encoder_filters_.end());
-#ifndef NVLOG
-  headers.iterate(
-      [](const HeaderEntry& header, void* context) -> void {
-        ENVOY_STREAM_LOG(debug, "  '{}':'{}'", *static_cast<ActiveStream*>(context),
-                         header.key().c_str(), header.value().c_str());
-      },
-      this);
-#endif
+  if (ENVOY_LOG_CHECK_LEVEL(debug)) {
+    headers.iterate(
+        [](const HeaderEntry& header, void* context) -> void {
+          ENVOY_STREAM_LOG(debug, "  '{}':'{}'", *static_cast<ActiveStream*>(context),
+                           header.key().c_str(), header.value().c_str());
+        },
+        this);
+  }
 
   // Now actually encode via the codec.
   response_encoder_->encodeHeaders(headers,
@@ -819,14 +885,14 @@ void ConnectionManagerImpl::ActiveStream::addEncodedData(ActiveStreamEncoderFilt
 
 void ConnectionManagerImpl::ActiveStream::encodeData(ActiveStreamEncoderFilter* filter,
                                                      Buffer::Instance& data, bool end_stream) {
-  std::list<ActiveStreamEncoderFilterPtr>::iterator entry = commonEncodePrefix(filter, end_stream);
+  ActiveStreamEncoderFilterList::iterator entry = commonEncodePrefix(filter, end_stream);
   for (; entry != encoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::EncodeData));
     state_.filter_call_state_ |= FilterCallState::EncodeData;
     FilterDataStatus status = (*entry)->handle_->encodeData(data, end_stream);
     state_.filter_call_state_ &= ~FilterCallState::EncodeData;
     ENVOY_STREAM_LOG(trace, "encode data called: filter={} status={}", *this,
-                     static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
+                     static_cast<const void*>(*entry), static_cast<uint64_t>(status));
     if (!(*entry)->commonHandleAfterDataCallback(status, data)) {
       return;
     }
@@ -842,28 +908,28 @@ void ConnectionManagerImpl::ActiveStream::encodeData(ActiveStreamEncoderFilter*
 
 void ConnectionManagerImpl::ActiveStream::encodeTrailers(ActiveStreamEncoderFilter* filter,
                                                          HeaderMap& trailers) {
-  std::list<ActiveStreamEncoderFilterPtr>::iterator entry = commonEncodePrefix(filter, true);
+  ActiveStreamEncoderFilterList::iterator entry = commonEncodePrefix(filter, true);
   for (; entry != encoder_filters_.end(); entry++) {
     ASSERT(!(state_.filter_call_state_ & FilterCallState::EncodeTrailers));
     state_.filter_call_state_ |= FilterCallState::EncodeTrailers;
     FilterTrailersStatus status = (*entry)->handle_->encodeTrailers(trailers);
     state_.filter_call_state_ &= ~FilterCallState::EncodeTrailers;
     ENVOY_STREAM_LOG(trace, "encode trailers called: filter={} status={}", *this,
-                     static_cast<const void*>((*entry).get()), static_cast<uint64_t>(status));
+                     static_cast<const void*>(*entry), static_cast<uint64_t>(status));
     if (!(*entry)->commonHandleAfterTrailersCallback(status)) {
       return;
     }
   }
 
   ENVOY_STREAM_LOG(debug, "encoding trailers via codec", *this);
-#ifndef NVLOG
-  trailers.iterate(
-      [](const HeaderEntry& header, void* context) -> void {
-        ENVOY_STREAM_LOG(debug, "  '{}':'{}'", *static_cast<ActiveStream*>(context),
-                         header.key().c_str(), header.value().c_str());
-      },
-      this);
-#endif
+  if (ENVOY_LOG_CHECK_LEVEL(debug)) {
+    trailers.iterate(
+        [](const HeaderEntry& header, void* context) -> void {
+          ENVOY_STREAM_LOG(debug, "  '{}':'{}'", *static_cast<ActiveStream*>(context),
+                           header.key().c_str(), header.value().c_str());
+        },
+        this);
+  }
 
   response_encoder_->encodeTrailers(trailers);
   maybeEndEncode(true);
@@ -871,6 +937,11 @@ void ConnectionManagerImpl::ActiveStream::encodeTrailers(ActiveStreamEncoderFilt
 
 void ConnectionManagerImpl::ActiveStream::maybeEndEncode(bool end_stream) {
   if (end_stream) {
+    request_info_.timing(AccessLog::RequestTiming::DownstreamLastByte,
+                         connection_manager_.read_callbacks_->connection()
+                             .dispatcher()
+                             .approximateMonotonicTime()
+                             .currentTime());
     request_timer_->complete();
     connection_manager_.doEndStream(*this);
   }
@@ -1032,7 +1103,10 @@ AccessLog::RequestInfo& ConnectionManagerImpl::ActiveStreamFilterBase::requestIn
 }
 
 Tracing::Span& ConnectionManagerImpl::ActiveStreamFilterBase::activeSpan() {
-  return *parent_.active_span_;
+  if (parent_.active_span_) {
+    return *parent_.active_span_;
+  }
+  return Tracing::NullSpan::instance();
 }
 
 Router::RouteConstSharedPtr ConnectionManagerImpl::ActiveStreamFilterBase::route() {
@@ -23,7 +23,10 @@
 #include "envoy/tracing/http_tracer.h"
 #include "envoy/upstream/upstream.h"
 
+#include "common/common/arena.h"
+#include "common/common/assert.h"
 #include "common/common/linked_object.h"
+#include "common/common/recycler.h"
 #include "common/http/access_log/request_info_impl.h"
 #include "common/http/date_provider.h"
 #include "common/http/user_agent.h"
@@ -61,6 +64,7 @@ namespace Http {
   COUNTER(downstream_cx_tx_bytes_total)                                                            \
   GAUGE  (downstream_cx_tx_bytes_buffered)                                                         \
   COUNTER(downstream_cx_drain_close)                                                               \
+  COUNTER(downstream_cx_overload_disable_keepalive)                                                \
   COUNTER(downstream_cx_idle_timeout)                                                              \
   COUNTER(downstream_flow_control_paused_reading_total)                                            \
   COUNTER(downstream_flow_control_resumed_reading_total)                                           \
@@ -74,6 +78,7 @@ namespace Http {
   COUNTER(downstream_rq_non_relative_path)                                                         \
   COUNTER(downstream_rq_ws_on_non_ws_route)                                                        \
   COUNTER(downstream_rq_non_ws_on_ws_route)                                                        \
+  COUNTER(downstream_rq_overload_rejected)                                                         \
   COUNTER(downstream_rq_2xx)                                                                       \
   COUNTER(downstream_rq_3xx)                                                                       \
   COUNTER(downstream_rq_4xx)                                                                       \
@@ -121,6 +126,8 @@ struct ConnectionManagerTracingStats {
 struct TracingConnectionManagerConfig {
   Tracing::OperationName operation_name_;
   std::vector<Http::LowerCaseString> request_headers_for_tags_;
+  // Shared by all connection managers. May be null.
+  std::shared_ptr<Tracing::AdaptiveSampler> adaptive_sampler_;
 };
 
 typedef std::unique_ptr<TracingConnectionManagerConfig> TracingConnectionManagerConfigPtr;
@@ -250,6 +257,13 @@ public:
    * @return tracing config.
    */
   virtual const TracingConnectionManagerConfig* tracingConfig() PURE;
+
+  /**
+   * @return bool whether streams take the plain proxy path. A config only says so when its filter
+   *         chains are a single decoder filter that adds no access log handlers, and when it has
+   *         no access logs and no tracing. Streams then skip looking for any of those.
+   */
+  virtual bool plainProxy() PURE;
 };
 
 /**
@@ -260,7 +274,8 @@ public:
 class ConnectionManagerImpl : Logger::Loggable<Logger::Id::http>,
                               public Network::ReadFilter,
                               public ServerConnectionCallbacks,
-                              public Network::ConnectionCallbacks {
+                              public Network::ConnectionCallbacks,
+                              public Recycled {
 public:
   ConnectionManagerImpl(ConnectionManagerConfig& config, const Network::DrainDecision& drain_close,
                         Runtime::RandomGenerator& random_generator, Tracing::HttpTracer& tracer,
@@ -330,6 +345,8 @@ private:
     const std::string& downstreamAddress() override;
 
     ActiveStream& parent_;
+    // The position of the filter in its FilterList.
+    uint32_t index_{};
     bool headers_continued_ : 1;
     bool stopped_ : 1;
     const bool dual_filter_ : 1;
@@ -339,8 +356,7 @@ private:
    * Wrapper for a stream decoder filter.
    */
   struct ActiveStreamDecoderFilter : public ActiveStreamFilterBase,
-                                     public StreamDecoderFilterCallbacks,
-                                     LinkedObject<ActiveStreamDecoderFilter> {
+                                     public StreamDecoderFilterCallbacks {
     ActiveStreamDecoderFilter(ActiveStream& parent, StreamDecoderFilterSharedPtr filter,
                               bool dual_filter)
         : ActiveStreamFilterBase(parent, dual_filter), handle_(filter) {}
@@ -376,14 +392,11 @@ private:
     StreamDecoderFilterSharedPtr handle_;
   };
 
-  typedef std::unique_ptr<ActiveStreamDecoderFilter> ActiveStreamDecoderFilterPtr;
-
   /**
    * Wrapper for a stream encoder filter.
    */
   struct ActiveStreamEncoderFilter : public ActiveStreamFilterBase,
-                                     public StreamEncoderFilterCallbacks,
-                                     LinkedObject<ActiveStreamEncoderFilter> {
+                                     public StreamEncoderFilterCallbacks {
     ActiveStreamEncoderFilter(ActiveStream& parent, StreamEncoderFilterSharedPtr filter,
                               bool dual_filter)
         : ActiveStreamFilterBase(parent, dual_filter), handle_(filter) {}
@@ -412,7 +425,41 @@ private:
     StreamEncoderFilterSharedPtr handle_;
   };
 
-  typedef std::unique_ptr<ActiveStreamEncoderFilter> ActiveStreamEncoderFilterPtr;
+  /**
+   * The filter wrappers of one direction of a stream, in chain order. The wrappers live in the
+   * stream's arena, next to each other, and iteration walks an array. Room for as many filters as
+   * the filter chain factory declares is set aside when the stream is created, so that the array
+   * of a typical chain is sized once.
+   */
+  template <class T> class FilterList {
+  public:
+    typedef typename std::vector<T*, ArenaAllocator<T*>>::iterator iterator;
+
+    FilterList(Arena& arena) : arena_(arena), filters_(ArenaAllocator<T*>(arena)) {}
+
+    void reserve(uint32_t size) {
+      ASSERT(filters_.empty());
+      filters_.reserve(size);
+    }
+
+    template <class... Args> T& emplaceBack(Args&&... args) {
+      T* filter = arena_.create<T>(std::forward<Args>(args)...);
+      filter->index_ = filters_.size();
+      filters_.push_back(filter);
+      return *filter;
+    }
+
+    iterator begin() { return filters_.begin(); }
+    iterator end() { return filters_.end(); }
+    iterator entry(const T& filter) { return filters_.begin() + filter.index_; }
+
+  private:
+    Arena& arena_;
+    std::vector<T*, ArenaAllocator<T*>> filters_;
+  };
+
+  typedef FilterList<ActiveStreamDecoderFilter> ActiveStreamDecoderFilterList;
+  typedef FilterList<ActiveStreamEncoderFilter> ActiveStreamEncoderFilterList;
 
   /**
    * Wraps a single active stream on the connection. These are either full request/response pairs
@@ -431,8 +478,8 @@ private:
     void addStreamDecoderFilterWorker(StreamDecoderFilterSharedPtr filter, bool dual_filter);
     void addStreamEncoderFilterWorker(StreamEncoderFilterSharedPtr filter, bool dual_filter);
     void chargeStats(HeaderMap& headers);
-    std::list<ActiveStreamEncoderFilterPtr>::iterator
-    commonEncodePrefix(ActiveStreamEncoderFilter* filter, bool end_stream);
+    ActiveStreamEncoderFilterList::iterator commonEncodePrefix(ActiveStreamEncoderFilter* filter,
+                                                               bool end_stream);
     uint64_t connectionId();
     const Network::Connection* connection();
     Ssl::Connection* ssl();
@@ -508,9 +555,13 @@ private:
       bool saw_connection_close_ : 1;
     };
 
+    // Holds the stream state that goes away with the stream. It is declared first so that it
+    // outlives everything that uses it.
+    Arena arena_;
     ConnectionManagerImpl& connection_manager_;
     Router::ConfigConstSharedPtr snapped_route_config_;
-    Tracing::SpanPtr active_span_{new Tracing::NullSpan()};
+    // Null unless the request is traced, so that untraced requests allocate no span.
+    Tracing::SpanPtr active_span_;
     const uint64_t stream_id_;
     StreamEncoder* response_encoder_{};
     HeaderMapPtr response_headers_;
@@ -519,9 +570,11 @@ private:
     HeaderMapPtr request_headers_;
     Buffer::InstancePtr buffered_request_data_; // TODO(mattklein123): buffer data stat
     HeaderMapPtr request_trailers_;
-    std::list<ActiveStreamDecoderFilterPtr> decoder_filters_;
-    std::list<ActiveStreamEncoderFilterPtr> encoder_filters_;
-    std::list<Http::AccessLog::InstanceSharedPtr> access_log_handlers_;
+    ActiveStreamDecoderFilterList decoder_filters_;
+    ActiveStreamEncoderFilterList encoder_filters_;
+    std::list<Http::AccessLog::InstanceSharedPtr,
+              ArenaAllocator<Http::AccessLog::InstanceSharedPtr>>
+        access_log_handlers_;
     Stats::TimespanPtr request_timer_;
     State state_;
     AccessLog::RequestInfoImpl request_info_;
@@ -555,6 +608,12 @@ private:
   void onDrainTimeout();
   void startDrainSequence();
 
+  /**
+   * @return whether the event loop of the worker has fallen behind by at least the threshold in
+   *         milliseconds that is set in runtime at a key. An unset or 0 threshold is never met.
+   */
+  bool loopDelayAtLeast(const std::string& runtime_key);
+
   bool isWebSocketConnection() const { return ws_connection_ != nullptr; }
 
   enum class DrainState { NotDraining, Draining, Closing };
@@ -562,6 +621,7 @@ private:
   ConnectionManagerConfig& config_;
   ConnectionManagerStats& stats_; // We store a reference here to avoid an extra stats() call on the
                                   // config in the hot path.
+  const bool plain_proxy_;
   ServerConnectionPtr codec_;
   std::list<ActiveStreamPtr> streams_;
   Stats::TimespanPtr conn_length_;
@@ -575,6 +635,9 @@ private:
   Runtime::Loader& runtime_;
   const LocalInfo::LocalInfo& local_info_;
   Upstream::ClusterManager& cluster_manager_;
+  // The load shedding thresholds for when the worker falls behind, which are per listener.
+  const std::string disable_keepalive_key_;
+  const std::string reject_requests_key_;
   WebSocket::WsHandlerImplPtr ws_connection_{};
   Network::ReadFilterCallbacks* read_callbacks_{};
 };
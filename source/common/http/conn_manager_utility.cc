@@ -85,16 +85,16 @@ void ConnectionManagerUtility::mutateRequestHeaders(
     }
 
     request_headers.removeEnvoyRetryOn();
+    request_headers.removeEnvoyRetryBufferLimitBytes();
     request_headers.removeEnvoyUpstreamAltStatName();
     request_headers.removeEnvoyUpstreamRequestTimeoutMs();
     request_headers.removeEnvoyUpstreamRequestPerTryTimeoutMs();
+    request_headers.removeEnvoyUpstreamRequestHedgeDelayMs();
     request_headers.removeEnvoyUpstreamRequestTimeoutAltResponse();
     request_headers.removeEnvoyExpectedRequestTimeoutMs();
     request_headers.removeEnvoyForceTrace();
 
-    for (const Http::LowerCaseString& header : route_config.internalOnlyHeaders()) {
-      request_headers.remove(header);
-    }
+    request_headers.removeKeys(route_config.internalOnlyHeaders());
   }
 
   if (config.userAgent().valid()) {
@@ -162,8 +162,9 @@ void ConnectionManagerUtility::mutateXfccRequestHeader(Http::HeaderMap& request_
     if (!connection.ssl()->uriSanLocalCertificate().empty()) {
       client_cert_details.push_back("By=" + connection.ssl()->uriSanLocalCertificate());
     }
-    if (!connection.ssl()->sha256PeerCertificateDigest().empty()) {
-      client_cert_details.push_back("Hash=" + connection.ssl()->sha256PeerCertificateDigest());
+    const std::string& digest = connection.ssl()->sha256PeerCertificateDigest();
+    if (!digest.empty()) {
+      client_cert_details.push_back("Hash=" + digest);
     }
     for (const auto& detail : config.setCurrentClientCertDetails()) {
       switch (detail) {
@@ -202,9 +203,7 @@ void ConnectionManagerUtility::mutateResponseHeaders(Http::HeaderMap& response_h
   response_headers.removeConnection();
   response_headers.removeTransferEncoding();
 
-  for (const Http::LowerCaseString& to_remove : route_config.responseHeadersToRemove()) {
-    response_headers.remove(to_remove);
-  }
+  response_headers.removeKeys(route_config.responseHeadersToRemove());
 
   for (const std::pair<Http::LowerCaseString, std::string>& to_add :
        route_config.responseHeadersToAdd()) {
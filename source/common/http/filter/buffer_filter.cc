@@ -1,6 +1,13 @@
 #include "common/http/filter/buffer_filter.h"
 
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include "envoy/event/dispatcher.h"
 #include "envoy/event/timer.h"
@@ -32,27 +39,147 @@ FilterHeadersStatus BufferFilter::decodeHeaders(HeaderMap&, bool end_stream) {
   }
 }
 
-FilterDataStatus BufferFilter::decodeData(Buffer::Instance&, bool end_stream) {
+FilterDataStatus BufferFilter::decodeData(Buffer::Instance& data, bool end_stream) {
+  request_bytes_ += data.length();
+  if (request_bytes_ > config_->max_request_bytes_) {
+    sendLocalReply(Code::PayloadTooLarge);
+    config_->stats_.rq_too_large_.inc();
+    return FilterDataStatus::StopIterationNoBuffer;
+  }
+
+  if (spill_fd_ == -1) {
+    // The connection manager buffers the body for as long as the request holds memory for it.
+    if (reserveMemory(data.length())) {
+      if (end_stream) {
+        resetInternalState();
+        return FilterDataStatus::Continue;
+      }
+      return FilterDataStatus::StopIterationAndBuffer;
+    }
+
+    if (config_->max_request_memory_bytes_ == 0) {
+      sendLocalReply(Code::ServiceUnavailable);
+      config_->stats_.rq_memory_exhausted_.inc();
+      return FilterDataStatus::StopIterationNoBuffer;
+    }
+
+    // The file is unlinked straight away so that it goes away with the descriptor and the mapping,
+    // however the request ends.
+    std::string path = config_->spill_directory_ + "/envoy_buffer_XXXXXX";
+    spill_fd_ = mkstemp(&path[0]);
+    if (spill_fd_ == -1) {
+      ENVOY_STREAM_LOG(warn, "unable to create spill file in {}: {}", *callbacks_,
+                       config_->spill_directory_, strerror(errno));
+      sendLocalReply(Code::ServiceUnavailable);
+      config_->stats_.rq_spill_failed_.inc();
+      return FilterDataStatus::StopIterationNoBuffer;
+    }
+    unlink(path.c_str());
+    config_->stats_.rq_spilled_.inc();
+  }
+
+  // The spilled tail follows the body buffered in memory.
+  if (!spill(data) || (end_stream && !addSpilled(data))) {
+    sendLocalReply(Code::ServiceUnavailable);
+    config_->stats_.rq_spill_failed_.inc();
+    return FilterDataStatus::StopIterationNoBuffer;
+  }
+
   if (end_stream) {
     resetInternalState();
     return FilterDataStatus::Continue;
-  } else if (callbacks_->decodingBuffer() &&
-             callbacks_->decodingBuffer()->length() > config_->max_request_bytes_) {
-    // TODO(htuch): Switch this to Utility::sendLocalReply().
-    Http::HeaderMapPtr response_headers{new HeaderMapImpl{
-        {Headers::get().Status, std::to_string(enumToInt(Http::Code::PayloadTooLarge))}}};
-    callbacks_->encodeHeaders(std::move(response_headers), true);
-    config_->stats_.rq_too_large_.inc();
   }
-
-  return FilterDataStatus::StopIterationAndBuffer;
+  return FilterDataStatus::StopIterationNoBuffer;
 }
 
 FilterTrailersStatus BufferFilter::decodeTrailers(HeaderMap&) {
+  if (spill_fd_ != -1) {
+    Buffer::OwnedImpl data;
+    if (!addSpilled(data)) {
+      sendLocalReply(Code::ServiceUnavailable);
+      config_->stats_.rq_spill_failed_.inc();
+      return FilterTrailersStatus::StopIteration;
+    }
+    if (data.length() > 0) {
+      callbacks_->addDecodedData(data);
+    }
+  }
+
   resetInternalState();
   return FilterTrailersStatus::Continue;
 }
 
+bool BufferFilter::reserveMemory(uint64_t bytes) {
+  if (config_->max_request_memory_bytes_ > 0 &&
+      memory_bytes_ + bytes > config_->max_request_memory_bytes_) {
+    return false;
+  }
+
+  const uint64_t total = config_->total_memory_bytes_.fetch_add(bytes) + bytes;
+  if (config_->max_total_memory_bytes_ > 0 && total > config_->max_total_memory_bytes_) {
+    config_->total_memory_bytes_.fetch_sub(bytes);
+    return false;
+  }
+
+  memory_bytes_ += bytes;
+  return true;
+}
+
+bool BufferFilter::spill(Buffer::Instance& data) {
+  const uint64_t num_slices = data.getRawSlices(nullptr, 0);
+  std::vector<Buffer::RawSlice> slices(num_slices);
+  data.getRawSlices(slices.data(), num_slices);
+  for (const Buffer::RawSlice& slice : slices) {
+    const char* mem = static_cast<const char*>(slice.mem_);
+    uint64_t remaining = slice.len_;
+    while (remaining > 0) {
+      const ssize_t rc = write(spill_fd_, mem, remaining);
+      if (rc == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        ENVOY_STREAM_LOG(warn, "unable to write spill file: {}", *callbacks_, strerror(errno));
+        return false;
+      }
+      mem += rc;
+      remaining -= rc;
+    }
+  }
+
+  spilled_bytes_ += data.length();
+  data.drain(data.length());
+  return true;
+}
+
+bool BufferFilter::addSpilled(Buffer::Instance& data) {
+  if (spilled_bytes_ == 0) {
+    return true;
+  }
+
+  // The mapping is read back by the kernel as the body is written upstream, and unmapped once the
+  // last reference to it is drained.
+  void* mem = mmap(nullptr, spilled_bytes_, PROT_READ, MAP_PRIVATE, spill_fd_, 0);
+  if (mem == MAP_FAILED) {
+    ENVOY_STREAM_LOG(warn, "unable to map spill file: {}", *callbacks_, strerror(errno));
+    return false;
+  }
+  data.addBufferFragment(*new Buffer::BufferFragmentImpl(
+      mem, spilled_bytes_, [](const void* mem, size_t size,
+                              const Buffer::BufferFragmentImpl* fragment) -> void {
+        munmap(const_cast<void*>(mem), size);
+        delete fragment;
+      }));
+  spilled_bytes_ = 0;
+  return true;
+}
+
+void BufferFilter::sendLocalReply(Code code) {
+  // TODO(htuch): Switch this to Utility::sendLocalReply().
+  Http::HeaderMapPtr response_headers{
+      new HeaderMapImpl{{Headers::get().Status, std::to_string(enumToInt(code))}}};
+  callbacks_->encodeHeaders(std::move(response_headers), true);
+}
+
 BufferFilterStats BufferFilter::generateStats(const std::string& prefix, Stats::Scope& scope) {
   std::string final_prefix = prefix + "buffer.";
   return {ALL_BUFFER_FILTER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
@@ -61,14 +188,20 @@ BufferFilterStats BufferFilter::generateStats(const std::string& prefix, Stats::
 void BufferFilter::onDestroy() { resetInternalState(); }
 
 void BufferFilter::onRequestTimeout() {
-  // TODO(htuch): Switch this to Utility::sendLocalReply().
-  Http::HeaderMapPtr response_headers{new HeaderMapImpl{
-      {Headers::get().Status, std::to_string(enumToInt(Http::Code::RequestTimeout))}}};
-  callbacks_->encodeHeaders(std::move(response_headers), true);
+  sendLocalReply(Code::RequestTimeout);
   config_->stats_.rq_timeout_.inc();
 }
 
-void BufferFilter::resetInternalState() { request_timeout_.reset(); }
+void BufferFilter::resetInternalState() {
+  request_timeout_.reset();
+  config_->total_memory_bytes_.fetch_sub(memory_bytes_);
+  memory_bytes_ = 0;
+  if (spill_fd_ != -1) {
+    // Any mapping of the file stays valid after the descriptor is closed.
+    close(spill_fd_);
+    spill_fd_ = -1;
+  }
+}
 
 void BufferFilter::setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) {
   callbacks_ = &callbacks;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <memory>
@@ -9,6 +10,7 @@
 #include "envoy/stats/stats_macros.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/logger.h"
 
 namespace Envoy {
 namespace Http {
@@ -19,7 +21,10 @@ namespace Http {
 // clang-format off
 #define ALL_BUFFER_FILTER_STATS(COUNTER)                                                           \
   COUNTER(rq_timeout)                                                                              \
-  COUNTER(rq_too_large)
+  COUNTER(rq_too_large)                                                                            \
+  COUNTER(rq_spilled)                                                                              \
+  COUNTER(rq_spill_failed)                                                                         \
+  COUNTER(rq_memory_exhausted)
 // clang-format on
 
 /**
@@ -36,14 +41,26 @@ struct BufferFilterConfig {
   BufferFilterStats stats_;
   uint64_t max_request_bytes_;
   std::chrono::seconds max_request_time_;
+  // The body of a request beyond this many bytes is spilled to a file in spill_directory_ rather
+  // than held in memory. 0 disables spilling.
+  uint64_t max_request_memory_bytes_;
+  std::string spill_directory_;
+  // The request body bytes that all requests through the config together may hold in memory. 0
+  // is unlimited.
+  uint64_t max_total_memory_bytes_;
+  // The request body bytes that requests through the config hold in memory, on all workers.
+  mutable std::atomic<uint64_t> total_memory_bytes_;
 };
 
 typedef std::shared_ptr<const BufferFilterConfig> BufferFilterConfigConstSharedPtr;
 
 /**
- * A filter that is capable of buffering an entire request before dispatching it upstream.
+ * A filter that is capable of buffering an entire request before dispatching it upstream. Once a
+ * request holds its share of memory, the rest of its body is written to an unlinked temporary file
+ * and mapped back into the request when it is complete, so that the pages of large bodies are
+ * backed by the file rather than by anonymous memory.
  */
-class BufferFilter : public StreamDecoderFilter {
+class BufferFilter : public StreamDecoderFilter, Logger::Loggable<Logger::Id::http> {
 public:
   BufferFilter(BufferFilterConfigConstSharedPtr config);
   ~BufferFilter();
@@ -60,12 +77,22 @@ public:
   void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override;
 
 private:
+  bool reserveMemory(uint64_t bytes);
+  bool spill(Buffer::Instance& data);
+  bool addSpilled(Buffer::Instance& data);
+  void sendLocalReply(Code code);
   void onRequestTimeout();
   void resetInternalState();
 
   BufferFilterConfigConstSharedPtr config_;
   StreamDecoderFilterCallbacks* callbacks_{};
   Event::TimerPtr request_timeout_;
+  uint64_t request_bytes_{};
+  // The bytes of the body held in memory by the connection manager, which count against the
+  // total of the config.
+  uint64_t memory_bytes_{};
+  int spill_fd_{-1};
+  uint64_t spilled_bytes_{};
 };
 
 } // Http
@@ -0,0 +1,480 @@
+#include "common/http/filter/cache_filter.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "envoy/http/codes.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
+#include "common/common/enum_to_int.h"
+#include "common/common/utility.h"
+#include "common/http/headers.h"
+#include "common/http/utility.h"
+#include "common/json/config_schemas.h"
+
+namespace Envoy {
+namespace Http {
+
+namespace {
+
+std::chrono::seconds ageOf(const HeaderMap& headers) {
+  const HeaderEntry* age = headers.get(Headers::get().Age);
+  uint64_t seconds;
+  if (age == nullptr || !StringUtil::atoul(age->value().c_str(), seconds)) {
+    return std::chrono::seconds(0);
+  }
+  return std::chrono::seconds(seconds);
+}
+
+} // namespace
+
+CacheControlDirectives CacheControlDirectives::parse(const HeaderEntry* cache_control) {
+  CacheControlDirectives directives;
+  if (cache_control == nullptr) {
+    return directives;
+  }
+
+  Optional<std::chrono::seconds> max_age;
+  Optional<std::chrono::seconds> s_maxage;
+  for (StringView directive :
+       StringUtil::splitToViews(cache_control->value().getStringView(), ',')) {
+    directive = StringUtil::trimView(directive);
+    const size_t equals = directive.find('=');
+    const StringView name = directive.substr(0, equals);
+
+    if (StringUtil::caseInsensitiveEqual(name, Headers::get().CacheControlValues.NoCache)) {
+      directives.no_cache_ = true;
+    } else if (StringUtil::caseInsensitiveEqual(name, Headers::get().CacheControlValues.NoStore)) {
+      directives.no_store_ = true;
+    } else if (StringUtil::caseInsensitiveEqual(name, Headers::get().CacheControlValues.Private)) {
+      directives.private_ = true;
+    } else if (equals != StringView::npos) {
+      // Only the ages have values worth copying out, without the quotes they may come in.
+      const bool is_max_age =
+          StringUtil::caseInsensitiveEqual(name, Headers::get().CacheControlValues.MaxAge);
+      const bool is_s_maxage =
+          StringUtil::caseInsensitiveEqual(name, Headers::get().CacheControlValues.SMaxAge);
+      if (!is_max_age && !is_s_maxage) {
+        continue;
+      }
+      std::string value = directive.substr(equals + 1).toString();
+      value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+      uint64_t seconds;
+      if (StringUtil::atoul(value.c_str(), seconds)) {
+        (is_max_age ? max_age : s_maxage).value(std::chrono::seconds(seconds));
+      }
+    }
+  }
+
+  directives.max_age_ = s_maxage.valid() ? s_maxage : max_age;
+  return directives;
+}
+
+bool CacheEntry::matches(const HeaderMap& request_headers) const {
+  for (const std::pair<LowerCaseString, std::string>& vary_value : vary_values_) {
+    const HeaderEntry* header = request_headers.get(vary_value.first);
+    if (vary_value.second != (header != nullptr ? header->value().c_str() : "")) {
+      return false;
+    }
+  }
+  return true;
+}
+
+HttpCache::HttpCache(uint64_t max_bytes, const CacheStats& stats)
+    : max_bytes_(max_bytes), stats_(stats) {}
+
+HttpCache::~HttpCache() {
+  stats_.entries_.sub(lru_.size());
+  stats_.bytes_.sub(bytes_);
+}
+
+CacheEntrySharedPtr HttpCache::lookup(const std::string& key, const HeaderMap& request_headers) {
+  auto variants = entries_.find(key);
+  if (variants == entries_.end()) {
+    return nullptr;
+  }
+
+  for (const CacheEntrySharedPtr& entry : variants->second) {
+    if (entry->matches(request_headers)) {
+      lru_.touch(entry->lru_position_);
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+void HttpCache::insert(CacheEntrySharedPtr&& entry) {
+  auto variants = entries_.find(entry->key_);
+  if (variants != entries_.end()) {
+    for (const CacheEntrySharedPtr& variant : variants->second) {
+      if (variant->vary_values_ == entry->vary_values_) {
+        remove(CacheEntrySharedPtr{variant});
+        break;
+      }
+    }
+  }
+
+  stats_.insert_.inc();
+  stats_.entries_.inc();
+  stats_.bytes_.add(entry->byte_size_);
+  bytes_ += entry->byte_size_;
+  entry->lru_position_ = lru_.insert(entry);
+  entries_[entry->key_].emplace_back(std::move(entry));
+
+  while (bytes_ > max_bytes_) {
+    stats_.eviction_.inc();
+    remove(CacheEntrySharedPtr{lru_.leastRecentlyUsed()});
+  }
+}
+
+void HttpCache::remove(const CacheEntrySharedPtr& entry) {
+  lru_.remove(entry->lru_position_);
+  std::vector<CacheEntrySharedPtr>& variants = entries_[entry->key_];
+  variants.erase(std::find(variants.begin(), variants.end(), entry));
+  if (variants.empty()) {
+    entries_.erase(entry->key_);
+  }
+
+  stats_.entries_.dec();
+  stats_.bytes_.sub(entry->byte_size_);
+  bytes_ -= entry->byte_size_;
+}
+
+void HttpCache::startFill(const std::string& key) {
+  ASSERT(!filling(key));
+  fills_[key];
+}
+
+void HttpCache::addWaiter(const std::string& key, CacheFilter& filter) {
+  ASSERT(filling(key));
+  fills_[key].add(filter);
+}
+
+void HttpCache::removeWaiter(const std::string& key, CacheFilter& filter) {
+  auto fill = fills_.find(key);
+  if (fill != fills_.end()) {
+    fill->second.remove(filter);
+  }
+}
+
+void HttpCache::finishFill(const std::string& key) {
+  auto fill = fills_.find(key);
+  ASSERT(fill != fills_.end());
+  WaiterList<CacheFilter> waiters = std::move(fill->second);
+  fills_.erase(fill);
+  waiters.notifyAll([](CacheFilter& waiter) -> void { waiter.onFillComplete(); });
+}
+
+CacheFilterConfig::CacheFilterConfig(const Json::Object& json_config,
+                                     const std::string& stat_prefix, Stats::Scope& scope,
+                                     ThreadLocal::SlotAllocator& tls,
+                                     MonotonicTimeSource& time_source)
+    : Json::Validator(json_config, Json::Schema::CACHE_HTTP_FILTER_SCHEMA),
+      max_entry_bytes_(json_config.getInteger("max_entry_bytes", 1024 * 1024)),
+      stats_(generateStats(stat_prefix, scope)), tls_(tls.allocateSlot()),
+      time_source_(time_source) {
+  const uint64_t max_bytes = json_config.getInteger("max_bytes_per_worker", 64 * 1024 * 1024);
+  const CacheStats stats = stats_;
+  tls_->set([max_bytes, stats](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<HttpCache>(max_bytes, stats);
+  });
+}
+
+CacheStats CacheFilterConfig::generateStats(const std::string& prefix, Stats::Scope& scope) {
+  std::string final_prefix = prefix + "cache.";
+  return {ALL_CACHE_STATS(POOL_COUNTER_PREFIX(scope, final_prefix),
+                          POOL_GAUGE_PREFIX(scope, final_prefix))};
+}
+
+CacheFilter::CacheFilter(CacheFilterConfigSharedPtr config) : config_(config) {}
+
+CacheFilter::~CacheFilter() { ASSERT(state_ != State::Waiting && state_ != State::Filling); }
+
+void CacheFilter::onDestroy() {
+  if (state_ == State::Waiting) {
+    config_->cache().removeWaiter(key_, *this);
+    state_ = State::PassThrough;
+  } else if (state_ == State::Filling) {
+    finishFill();
+  }
+}
+
+FilterHeadersStatus CacheFilter::decodeHeaders(HeaderMap& headers, bool end_stream) {
+  // Only GET requests without a body are cached, and never ones that carry credentials.
+  if (!end_stream || headers.Method() == nullptr || headers.Host() == nullptr ||
+      headers.Path() == nullptr ||
+      headers.Method()->value() != Headers::get().MethodValues.Get.c_str() ||
+      headers.Authorization() != nullptr) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  const CacheControlDirectives cache_control =
+      CacheControlDirectives::parse(headers.get(Headers::get().CacheControl));
+  if (cache_control.no_store_) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  request_headers_ = &headers;
+  key_ = std::string(headers.Host()->value().c_str()) + headers.Path()->value().c_str();
+  HttpCache& cache = config_->cache();
+  CacheEntrySharedPtr entry = cache.lookup(key_, headers);
+  if (entry != nullptr && !cache_control.no_cache_ && entry->fresh(now())) {
+    config_->stats().hit_.inc();
+    state_ = State::Serving;
+    serve(*entry);
+    return FilterHeadersStatus::StopIteration;
+  }
+
+  if (cache.filling(key_)) {
+    config_->stats().coalesced_.inc();
+    state_ = State::Waiting;
+    cache.addWaiter(key_, *this);
+    return FilterHeadersStatus::StopIteration;
+  }
+
+  config_->stats().miss_.inc();
+  state_ = State::Filling;
+  cache.startFill(key_);
+
+  // Revalidate a stale entry, unless the client sent its own conditions, in which case a 304 is
+  // meant for the client rather than for the cache.
+  if (entry != nullptr && headers.get(Headers::get().IfNoneMatch) == nullptr &&
+      headers.get(Headers::get().IfModifiedSince) == nullptr) {
+    const HeaderEntry* etag = entry->headers_->get(Headers::get().Etag);
+    const HeaderEntry* last_modified = entry->headers_->get(Headers::get().LastModified);
+    if (etag != nullptr) {
+      headers.addCopy(Headers::get().IfNoneMatch, etag->value().c_str());
+    }
+    if (last_modified != nullptr) {
+      headers.addCopy(Headers::get().IfModifiedSince, last_modified->value().c_str());
+    }
+    if (etag != nullptr || last_modified != nullptr) {
+      validating_ = entry;
+    }
+  }
+
+  return FilterHeadersStatus::Continue;
+}
+
+void CacheFilter::onFillComplete() {
+  ASSERT(state_ == State::Waiting);
+  if (!serveFresh()) {
+    // The fill did not cache a response for this request, which now goes upstream on its own.
+    state_ = State::PassThrough;
+    decoder_callbacks_->continueDecoding();
+  }
+}
+
+bool CacheFilter::serveFresh() {
+  CacheEntrySharedPtr entry = config_->cache().lookup(key_, *request_headers_);
+  if (entry == nullptr || !entry->fresh(now())) {
+    return false;
+  }
+
+  config_->stats().hit_.inc();
+  state_ = State::Serving;
+  serve(*entry);
+  return true;
+}
+
+void CacheFilter::serve(const CacheEntry& entry) {
+  HeaderMapPtr headers{new HeaderMapImpl(*entry.headers_)};
+  headers->remove(Headers::get().Age);
+  headers->addCopy(Headers::get().Age, entry.age(now()).count());
+  const bool end_stream = entry.body_->empty();
+  decoder_callbacks_->encodeHeaders(std::move(headers), end_stream);
+  if (!end_stream) {
+    Buffer::OwnedImpl body;
+    addBody(entry, body);
+    decoder_callbacks_->encodeData(body, true);
+  }
+}
+
+void CacheFilter::addBody(const CacheEntry& entry, Buffer::Instance& buffer) {
+  if (entry.body_->empty()) {
+    return;
+  }
+
+  // The fragment holds a reference to the body, which outlives the entry if it is evicted while
+  // the buffer is still being written out.
+  std::shared_ptr<const std::string>* body = new std::shared_ptr<const std::string>(entry.body_);
+  buffer.addBufferFragment(*new Buffer::BufferFragmentImpl(
+      (*body)->data(), (*body)->size(),
+      [body](const void*, size_t, const Buffer::BufferFragmentImpl* fragment) {
+        delete body;
+        delete fragment;
+      }));
+}
+
+FilterHeadersStatus CacheFilter::encodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (state_ != State::Filling) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  if (validating_ != nullptr &&
+      Utility::getResponseStatus(headers) == enumToInt(Code::NotModified)) {
+    revalidated(headers, end_stream);
+  } else {
+    startStore(headers, end_stream);
+  }
+  return FilterHeadersStatus::Continue;
+}
+
+void CacheFilter::revalidated(HeaderMap& headers, bool end_stream) {
+  config_->stats().validated_.inc();
+  CacheEntry& entry = *validating_;
+  const CacheControlDirectives cache_control =
+      CacheControlDirectives::parse(headers.get(Headers::get().CacheControl));
+  entry.response_time_ = now();
+  entry.initial_age_ = ageOf(headers);
+  if (cache_control.max_age_.valid() && !cache_control.no_cache_) {
+    entry.max_age_ = cache_control.max_age_.value();
+  }
+
+  // Replace the 304 with the cached response, which the client did not ask to validate.
+  std::vector<std::string> keys;
+  headers.iterate(
+      [](const HeaderEntry& header, void* context) -> void {
+        static_cast<std::vector<std::string>*>(context)->emplace_back(header.key().c_str());
+      },
+      &keys);
+  for (const std::string& key : keys) {
+    headers.remove(LowerCaseString(key));
+  }
+  entry.headers_->iterate(
+      [](const HeaderEntry& header, void* context) -> void {
+        static_cast<HeaderMap*>(context)->addCopy(LowerCaseString(header.key().c_str()),
+                                                  header.value().c_str());
+      },
+      &headers);
+  headers.remove(Headers::get().Age);
+  headers.addCopy(Headers::get().Age, entry.age(now()).count());
+
+  if (end_stream) {
+    Buffer::OwnedImpl body;
+    addBody(entry, body);
+    if (body.length() > 0) {
+      encoder_callbacks_->addEncodedData(body);
+    }
+  } else {
+    replacing_body_ = true;
+  }
+  finishFill();
+}
+
+void CacheFilter::startStore(const HeaderMap& headers, bool end_stream) {
+  const CacheControlDirectives cache_control =
+      CacheControlDirectives::parse(headers.get(Headers::get().CacheControl));
+  const HeaderEntry* vary = headers.get(Headers::get().Vary);
+  const std::chrono::seconds max_age =
+      cache_control.max_age_.valid() && !cache_control.no_cache_ ? cache_control.max_age_.value()
+                                                                 : std::chrono::seconds(0);
+  uint64_t content_length;
+  // A response that is never fresh is still worth storing when it can be revalidated.
+  const bool cacheable =
+      Utility::getResponseStatus(headers) == enumToInt(Code::OK) && !cache_control.no_store_ &&
+      !cache_control.private_ && headers.get(Headers::get().SetCookie) == nullptr &&
+      (vary == nullptr || !vary->value().find("*")) &&
+      (max_age.count() > 0 || headers.get(Headers::get().Etag) != nullptr ||
+       headers.get(Headers::get().LastModified) != nullptr) &&
+      !(headers.ContentLength() != nullptr &&
+        StringUtil::atoul(headers.ContentLength()->value().c_str(), content_length) &&
+        content_length > config_->maxEntryBytes());
+  if (!cacheable) {
+    finishFill();
+    return;
+  }
+
+  storing_ = std::make_shared<CacheEntry>();
+  storing_->key_ = key_;
+  if (vary != nullptr) {
+    for (std::string name : StringUtil::split(vary->value().c_str(), ',')) {
+      StringUtil::trim(name);
+      if (name.empty()) {
+        continue;
+      }
+      LowerCaseString header_name(name);
+      const HeaderEntry* header = request_headers_->get(header_name);
+      storing_->vary_values_.emplace_back(header_name,
+                                          header != nullptr ? header->value().c_str() : "");
+    }
+  }
+  storing_->headers_.reset(new HeaderMapImpl(headers));
+  storing_->response_time_ = now();
+  storing_->initial_age_ = ageOf(headers);
+  storing_->max_age_ = max_age;
+
+  if (end_stream) {
+    store();
+  }
+}
+
+void CacheFilter::store() {
+  storing_->body_ = std::make_shared<const std::string>(std::move(body_));
+  storing_->byte_size_ =
+      storing_->key_.size() + storing_->headers_->byteSize() + storing_->body_->size();
+  config_->cache().insert(std::move(storing_));
+  storing_.reset();
+  finishFill();
+}
+
+void CacheFilter::abandonStore() {
+  storing_.reset();
+  body_.clear();
+  finishFill();
+}
+
+void CacheFilter::finishFill() {
+  ASSERT(state_ == State::Filling);
+  state_ = State::PassThrough;
+  config_->cache().finishFill(key_);
+}
+
+FilterDataStatus CacheFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (replacing_body_) {
+    data.drain(data.length());
+    if (end_stream) {
+      addBody(*validating_, data);
+    }
+    return FilterDataStatus::Continue;
+  }
+
+  if (storing_ != nullptr) {
+    if (body_.size() + data.length() > config_->maxEntryBytes()) {
+      abandonStore();
+      return FilterDataStatus::Continue;
+    }
+
+    const uint64_t num_slices = data.getRawSlices(nullptr, 0);
+    std::vector<Buffer::RawSlice> slices(num_slices);
+    data.getRawSlices(slices.data(), num_slices);
+    for (const Buffer::RawSlice& slice : slices) {
+      body_.append(static_cast<const char*>(slice.mem_), slice.len_);
+    }
+    if (end_stream) {
+      store();
+    }
+  }
+
+  return FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus CacheFilter::encodeTrailers(HeaderMap&) {
+  if (replacing_body_) {
+    Buffer::OwnedImpl body;
+    addBody(*validating_, body);
+    if (body.length() > 0) {
+      encoder_callbacks_->addEncodedData(body);
+    }
+  } else if (storing_ != nullptr) {
+    // Trailers are not cached, so neither is a response that has them.
+    abandonStore();
+  }
+
+  return FilterTrailersStatus::Continue;
+}
+
+} // namespace Http
+} // namespace Envoy
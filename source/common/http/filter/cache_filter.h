@@ -0,0 +1,273 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "envoy/common/optional.h"
+#include "envoy/common/time.h"
+#include "envoy/http/filter.h"
+#include "envoy/json/json_object.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/common/lru_list.h"
+#include "common/common/waiter_list.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_validator.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All cache filter stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_CACHE_STATS(COUNTER, GAUGE)                                                            \
+  COUNTER(hit)                                                                                     \
+  COUNTER(miss)                                                                                    \
+  COUNTER(coalesced)                                                                               \
+  COUNTER(validated)                                                                               \
+  COUNTER(insert)                                                                                  \
+  COUNTER(eviction)                                                                                \
+  GAUGE  (entries)                                                                                 \
+  GAUGE  (bytes)
+// clang-format on
+
+/**
+ * Struct definition for all cache filter stats. @see stats_macros.h
+ */
+struct CacheStats {
+  ALL_CACHE_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * The directives of a cache-control header that the cache acts on.
+ */
+struct CacheControlDirectives {
+  /**
+   * @param cache_control supplies the cache-control header, or nullptr.
+   * @return CacheControlDirectives the parsed directives. Unknown directives are ignored.
+   */
+  static CacheControlDirectives parse(const HeaderEntry* cache_control);
+
+  bool no_cache_{};
+  bool no_store_{};
+  bool private_{};
+  // s-maxage when present, since this is a shared cache, otherwise max-age.
+  Optional<std::chrono::seconds> max_age_;
+};
+
+struct CacheEntry;
+typedef std::shared_ptr<CacheEntry> CacheEntrySharedPtr;
+
+/**
+ * A cached response. An entry is only modified by a revalidation, which renews its freshness.
+ */
+struct CacheEntry {
+  /**
+   * @return bool whether the entry is fresh at the given time.
+   */
+  bool fresh(MonotonicTime now) const { return age(now) < max_age_; }
+
+  /**
+   * @return std::chrono::seconds the age of the response at the given time.
+   */
+  std::chrono::seconds age(MonotonicTime now) const {
+    return initial_age_ +
+           std::chrono::duration_cast<std::chrono::seconds>(now - response_time_);
+  }
+
+  /**
+   * @return bool whether the entry is the variant of its response selected by the request.
+   */
+  bool matches(const HeaderMap& request_headers) const;
+
+  std::string key_;
+  // The request header values of the response's vary header names.
+  std::vector<std::pair<LowerCaseString, std::string>> vary_values_;
+  HeaderMapImplPtr headers_;
+  // Shared with the buffers a hit is served from, so that evicting the entry does not free a body
+  // that is still being written out.
+  std::shared_ptr<const std::string> body_;
+  MonotonicTime response_time_;
+  std::chrono::seconds initial_age_;
+  std::chrono::seconds max_age_;
+  uint64_t byte_size_{};
+  LruList<CacheEntrySharedPtr>::Position lru_position_;
+};
+
+class CacheFilter;
+
+/**
+ * The response cache of one worker. Each worker caches independently up to its own byte budget,
+ * so the cache needs no locking, and the least recently used entries are evicted once the budget
+ * is exceeded. The cache also tracks the responses being filled, so that concurrent misses for a
+ * key on the worker wait for one response from upstream.
+ */
+class HttpCache : public ThreadLocal::ThreadLocalObject {
+public:
+  HttpCache(uint64_t max_bytes, const CacheStats& stats);
+  ~HttpCache();
+
+  /**
+   * @param key supplies the cache key of the request.
+   * @param request_headers supplies the request headers, which select among variants.
+   * @return CacheEntrySharedPtr the matching entry, fresh or not, or nullptr.
+   */
+  CacheEntrySharedPtr lookup(const std::string& key, const HeaderMap& request_headers);
+
+  /**
+   * Insert an entry, replacing the entry of the same variant if there is one.
+   */
+  void insert(CacheEntrySharedPtr&& entry);
+
+  /**
+   * @return bool whether a response for the key is being filled from upstream.
+   */
+  bool filling(const std::string& key) const { return fills_.count(key) > 0; }
+
+  /**
+   * Record that a response for the key is being filled from upstream.
+   */
+  void startFill(const std::string& key);
+
+  /**
+   * Wait for the fill of a key. The filter is called back with onFillComplete() when the fill
+   * completes, successfully or not.
+   */
+  void addWaiter(const std::string& key, CacheFilter& filter);
+
+  /**
+   * Stop waiting for the fill of a key.
+   */
+  void removeWaiter(const std::string& key, CacheFilter& filter);
+
+  /**
+   * Complete the fill of a key and call back its waiters.
+   */
+  void finishFill(const std::string& key);
+
+private:
+  void remove(const CacheEntrySharedPtr& entry);
+
+  const uint64_t max_bytes_;
+  CacheStats stats_;
+  uint64_t bytes_{};
+  LruList<CacheEntrySharedPtr> lru_;
+  // The variants of each key.
+  std::unordered_map<std::string, std::vector<CacheEntrySharedPtr>> entries_;
+  std::unordered_map<std::string, WaiterList<CacheFilter>> fills_;
+};
+
+/**
+ * Configuration for the cache filter.
+ */
+class CacheFilterConfig : Json::Validator {
+public:
+  CacheFilterConfig(const Json::Object& json_config, const std::string& stat_prefix,
+                    Stats::Scope& scope, ThreadLocal::SlotAllocator& tls,
+                    MonotonicTimeSource& time_source);
+
+  HttpCache& cache() { return tls_->getTyped<HttpCache>(); }
+  CacheStats& stats() { return stats_; }
+  uint64_t maxEntryBytes() const { return max_entry_bytes_; }
+  MonotonicTimeSource& timeSource() { return time_source_; }
+
+private:
+  static CacheStats generateStats(const std::string& prefix, Stats::Scope& scope);
+
+  const uint64_t max_entry_bytes_;
+  CacheStats stats_;
+  ThreadLocal::SlotPtr tls_;
+  MonotonicTimeSource& time_source_;
+};
+
+typedef std::shared_ptr<CacheFilterConfig> CacheFilterConfigSharedPtr;
+
+/**
+ * A filter that serves GET requests from the worker's response cache. A miss goes upstream and
+ * stores the response if its cache-control allows it. Requests that miss while the same key is
+ * being filled wait for that response instead of going upstream, and a stale entry with a
+ * validator is revalidated with a conditional request, which a 304 response renews.
+ */
+class CacheFilter : public StreamFilter {
+public:
+  CacheFilter(CacheFilterConfigSharedPtr config);
+  ~CacheFilter();
+
+  /**
+   * Called by the cache once the fill the filter waits for completes.
+   */
+  void onFillComplete();
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance&, bool) override {
+    return FilterDataStatus::Continue;
+  }
+  FilterTrailersStatus decodeTrailers(HeaderMap&) override {
+    return FilterTrailersStatus::Continue;
+  }
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override {
+    decoder_callbacks_ = &callbacks;
+  }
+
+  // Http::StreamEncoderFilter
+  FilterHeadersStatus encodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus encodeTrailers(HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(StreamEncoderFilterCallbacks& callbacks) override {
+    encoder_callbacks_ = &callbacks;
+  }
+
+private:
+  enum class State {
+    // The request is not cached, or waited for a fill that did not cache it.
+    PassThrough,
+    // The request waits for the fill of its key.
+    Waiting,
+    // The request goes upstream and its response is stored if it is cacheable.
+    Filling,
+    // The request is served from the cache.
+    Serving
+  };
+
+  bool serveFresh();
+  void serve(const CacheEntry& entry);
+  void revalidated(HeaderMap& headers, bool end_stream);
+  void startStore(const HeaderMap& headers, bool end_stream);
+  void store();
+  void abandonStore();
+  void finishFill();
+  MonotonicTime now() { return config_->timeSource().currentTime(); }
+
+  /**
+   * Add the body of an entry to a buffer without copying it.
+   */
+  static void addBody(const CacheEntry& entry, Buffer::Instance& buffer);
+
+  CacheFilterConfigSharedPtr config_;
+  StreamDecoderFilterCallbacks* decoder_callbacks_{};
+  StreamEncoderFilterCallbacks* encoder_callbacks_{};
+  State state_{State::PassThrough};
+  std::string key_;
+  const HeaderMap* request_headers_{};
+  // The stale entry that the upstream request revalidates.
+  CacheEntrySharedPtr validating_;
+  // Whether the body of a revalidated response replaces the upstream body.
+  bool replacing_body_{};
+  // The entry being stored, with the body received so far.
+  CacheEntrySharedPtr storing_;
+  std::string body_;
+};
+
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,223 @@
+#include "common/http/filter/collapse_filter.h"
+
+#include <map>
+#include <string>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/router/router.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
+#include "common/http/header_map_impl.h"
+#include "common/http/headers.h"
+#include "common/http/utility.h"
+#include "common/json/config_schemas.h"
+
+namespace Envoy {
+namespace Http {
+
+CollapseFilter* InFlightRequests::find(const std::string& key) const {
+  auto request = requests_.find(key);
+  return request != requests_.end() ? request->second : nullptr;
+}
+
+const std::string CollapseFilterConfig::ROUTE_OPT_IN_KEY = "collapse_requests";
+
+CollapseFilterConfig::CollapseFilterConfig(const Json::Object& json_config,
+                                           const std::string& stat_prefix, Stats::Scope& scope,
+                                           ThreadLocal::SlotAllocator& tls)
+    : Json::Validator(json_config, Json::Schema::COLLAPSE_HTTP_FILTER_SCHEMA),
+      max_wait_(json_config.getInteger("max_wait_ms", 1000)),
+      stats_(generateStats(stat_prefix, scope)), tls_(tls.allocateSlot()) {
+  for (const std::string& header : json_config.getStringArray("headers", true)) {
+    headers_.emplace_back(header);
+  }
+
+  tls_->set([](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<InFlightRequests>();
+  });
+}
+
+CollapseStats CollapseFilterConfig::generateStats(const std::string& prefix, Stats::Scope& scope) {
+  std::string final_prefix = prefix + "collapse.";
+  return {ALL_COLLAPSE_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
+}
+
+CollapseFilter::CollapseFilter(CollapseFilterConfigSharedPtr config) : config_(config) {}
+
+CollapseFilter::~CollapseFilter() { ASSERT(state_ == State::PassThrough); }
+
+void CollapseFilter::onDestroy() {
+  if (state_ == State::Following) {
+    unfollow();
+    wait_timer_.reset();
+    return;
+  } else if (state_ != State::Leading) {
+    return;
+  }
+
+  state_ = State::PassThrough;
+  if (responding_) {
+    // The response ended early, so the followers that have been sent part of it are reset.
+    forEachFollower([this](CollapseFilter& follower) -> void {
+      config_->stats().leader_reset_.inc();
+      follower.state_ = State::PassThrough;
+      follower.leader_ = nullptr;
+      follower.decoder_callbacks_->resetStream();
+    });
+    followers_.clear();
+    return;
+  }
+
+  // No response has started, so the longest waiting follower goes upstream in place of this
+  // request and the others follow it.
+  config_->inFlight().remove(key_);
+  std::list<CollapseFilter*> followers;
+  followers.splice(followers.end(), followers_);
+  followers.remove(nullptr);
+  if (!followers.empty()) {
+    CollapseFilter* next = followers.front();
+    followers.pop_front();
+    next->lead(followers);
+  }
+}
+
+bool CollapseFilter::collapsible(const HeaderMap& headers) const {
+  if (headers.Method() == nullptr || headers.Host() == nullptr || headers.Path() == nullptr ||
+      (headers.Method()->value() != Headers::get().MethodValues.Get.c_str() &&
+       headers.Method()->value() != Headers::get().MethodValues.Head.c_str())) {
+    return false;
+  }
+
+  Router::RouteConstSharedPtr route = decoder_callbacks_->route();
+  if (route == nullptr || route->routeEntry() == nullptr) {
+    return false;
+  }
+
+  const std::multimap<std::string, std::string>& opaque_config =
+      route->routeEntry()->opaqueConfig();
+  auto opt_in = opaque_config.find(CollapseFilterConfig::ROUTE_OPT_IN_KEY);
+  return opt_in != opaque_config.end() && opt_in->second == "true";
+}
+
+FilterHeadersStatus CollapseFilter::decodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (!end_stream || !collapsible(headers)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  key_ = std::string(headers.Method()->value().c_str()) + "\n" + headers.Host()->value().c_str() +
+         "\n" + headers.Path()->value().c_str();
+  Utility::appendHeaderValues(headers, config_->headers(), key_);
+
+  InFlightRequests& in_flight = config_->inFlight();
+  CollapseFilter* leader = in_flight.find(key_);
+  if (leader == nullptr) {
+    state_ = State::Leading;
+    in_flight.insert(key_, *this);
+    return FilterHeadersStatus::Continue;
+  }
+
+  config_->stats().collapsed_.inc();
+  follow(*leader);
+  wait_timer_ =
+      decoder_callbacks_->dispatcher().createTimer([this]() -> void { onWaitTimeout(); });
+  wait_timer_->enableTimer(config_->maxWait());
+  return FilterHeadersStatus::StopIteration;
+}
+
+void CollapseFilter::follow(CollapseFilter& leader) {
+  state_ = State::Following;
+  leader_ = &leader;
+  position_ = leader.followers_.insert(leader.followers_.end(), this);
+}
+
+void CollapseFilter::lead(std::list<CollapseFilter*>& followers) {
+  wait_timer_.reset();
+  leader_ = nullptr;
+  state_ = State::Leading;
+  for (CollapseFilter* follower : followers) {
+    follower->leader_ = this;
+  }
+  // Splicing keeps the positions of the followers valid.
+  followers_.splice(followers_.end(), followers);
+  config_->inFlight().insert(key_, *this);
+  decoder_callbacks_->continueDecoding();
+}
+
+void CollapseFilter::unfollow() {
+  ASSERT(state_ == State::Following);
+  if (leader_ != nullptr) {
+    *position_ = nullptr;
+    leader_ = nullptr;
+  }
+  state_ = State::PassThrough;
+}
+
+void CollapseFilter::onWaitTimeout() {
+  // The request goes upstream on its own.
+  config_->stats().wait_timeout_.inc();
+  unfollow();
+  decoder_callbacks_->continueDecoding();
+}
+
+FilterHeadersStatus CollapseFilter::encodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (state_ != State::Leading) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  // Requests that arrive from now on would miss the start of the response.
+  config_->inFlight().remove(key_);
+  responding_ = true;
+  forEachFollower([&headers, end_stream](CollapseFilter& follower) -> void {
+    follower.wait_timer_.reset();
+    follower.decoder_callbacks_->encodeHeaders(HeaderMapPtr{new HeaderMapImpl(headers)},
+                                               end_stream);
+  });
+
+  if (end_stream) {
+    finishResponse();
+  }
+  return FilterHeadersStatus::Continue;
+}
+
+FilterDataStatus CollapseFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (state_ != State::Leading) {
+    return FilterDataStatus::Continue;
+  }
+
+  forEachFollower([&data, end_stream](CollapseFilter& follower) -> void {
+    Buffer::OwnedImpl copy;
+    copy.add(data);
+    follower.decoder_callbacks_->encodeData(copy, end_stream);
+  });
+
+  if (end_stream) {
+    finishResponse();
+  }
+  return FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus CollapseFilter::encodeTrailers(HeaderMap& trailers) {
+  if (state_ != State::Leading) {
+    return FilterTrailersStatus::Continue;
+  }
+
+  forEachFollower([&trailers](CollapseFilter& follower) -> void {
+    follower.decoder_callbacks_->encodeTrailers(HeaderMapPtr{new HeaderMapImpl(trailers)});
+  });
+
+  finishResponse();
+  return FilterTrailersStatus::Continue;
+}
+
+void CollapseFilter::finishResponse() {
+  forEachFollower([](CollapseFilter& follower) -> void {
+    follower.state_ = State::PassThrough;
+    follower.leader_ = nullptr;
+  });
+  followers_.clear();
+  state_ = State::PassThrough;
+}
+
+} // namespace Http
+} // namespace Envoy
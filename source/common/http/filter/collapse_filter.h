@@ -0,0 +1,166 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/event/timer.h"
+#include "envoy/http/filter.h"
+#include "envoy/json/json_object.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/json/json_validator.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All collapse filter stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_COLLAPSE_STATS(COUNTER)                                                                \
+  COUNTER(collapsed)                                                                               \
+  COUNTER(wait_timeout)                                                                            \
+  COUNTER(leader_reset)
+// clang-format on
+
+/**
+ * Struct definition for all collapse filter stats. @see stats_macros.h
+ */
+struct CollapseStats {
+  ALL_COLLAPSE_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+class CollapseFilter;
+
+/**
+ * The collapsible requests of one worker that are in flight upstream and have not yet received
+ * response headers, by key. Requests only collapse with requests on the same worker, so no
+ * locking is needed.
+ */
+class InFlightRequests : public ThreadLocal::ThreadLocalObject {
+public:
+  /**
+   * @return CollapseFilter* the filter of the in flight request with the key, or nullptr.
+   */
+  CollapseFilter* find(const std::string& key) const;
+
+  void insert(const std::string& key, CollapseFilter& leader) { requests_[key] = &leader; }
+  void remove(const std::string& key) { requests_.erase(key); }
+
+private:
+  std::unordered_map<std::string, CollapseFilter*> requests_;
+};
+
+/**
+ * Configuration for the collapse filter.
+ */
+class CollapseFilterConfig : Json::Validator {
+public:
+  CollapseFilterConfig(const Json::Object& json_config, const std::string& stat_prefix,
+                       Stats::Scope& scope, ThreadLocal::SlotAllocator& tls);
+
+  InFlightRequests& inFlight() { return tls_->getTyped<InFlightRequests>(); }
+  const std::vector<LowerCaseString>& headers() const { return headers_; }
+  std::chrono::milliseconds maxWait() const { return max_wait_; }
+  CollapseStats& stats() { return stats_; }
+
+  /**
+   * The route opaque config key that opts the requests of a route in to collapsing.
+   */
+  static const std::string ROUTE_OPT_IN_KEY;
+
+private:
+  static CollapseStats generateStats(const std::string& prefix, Stats::Scope& scope);
+
+  std::vector<LowerCaseString> headers_;
+  const std::chrono::milliseconds max_wait_;
+  CollapseStats stats_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+typedef std::shared_ptr<CollapseFilterConfig> CollapseFilterConfigSharedPtr;
+
+/**
+ * A filter that collapses identical GET and HEAD requests without a body on routes that opt in.
+ * The first request for a key goes upstream as the leader, and requests for the key that arrive
+ * before its response headers follow it: they wait, for up to the max wait time, and are sent a
+ * copy of the leader's response through their own encoder filter chains. If the leader goes away
+ * before its response starts, the longest waiting follower goes upstream in its place.
+ */
+class CollapseFilter : public StreamFilter {
+public:
+  CollapseFilter(CollapseFilterConfigSharedPtr config);
+  ~CollapseFilter();
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance&, bool) override {
+    return FilterDataStatus::Continue;
+  }
+  FilterTrailersStatus decodeTrailers(HeaderMap&) override {
+    return FilterTrailersStatus::Continue;
+  }
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override {
+    decoder_callbacks_ = &callbacks;
+  }
+
+  // Http::StreamEncoderFilter
+  FilterHeadersStatus encodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus encodeTrailers(HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(StreamEncoderFilterCallbacks&) override {}
+
+private:
+  enum class State {
+    // The request is not collapsed.
+    PassThrough,
+    // The request goes upstream and its response is copied to its followers.
+    Leading,
+    // The request is sent the response of its leader.
+    Following
+  };
+
+  bool collapsible(const HeaderMap& headers) const;
+  void follow(CollapseFilter& leader);
+  void lead(std::list<CollapseFilter*>& followers);
+  void unfollow();
+  void onWaitTimeout();
+  void finishResponse();
+
+  /**
+   * Call a function on each follower that is still attached. Followers may detach while the
+   * function runs.
+   */
+  template <class Function> void forEachFollower(Function function) {
+    for (CollapseFilter* follower : followers_) {
+      if (follower != nullptr) {
+        function(*follower);
+      }
+    }
+  }
+
+  CollapseFilterConfigSharedPtr config_;
+  StreamDecoderFilterCallbacks* decoder_callbacks_{};
+  State state_{State::PassThrough};
+  std::string key_;
+  // Whether the response of a leader has started, after which it no longer takes followers.
+  bool responding_{};
+  // The followers of a leader. A follower that detaches leaves nullptr in its place, so that the
+  // list can be iterated while followers detach.
+  std::list<CollapseFilter*> followers_;
+  CollapseFilter* leader_{};
+  std::list<CollapseFilter*>::iterator position_;
+  Event::TimerPtr wait_timer_;
+};
+
+} // namespace Http
+} // namespace Envoy
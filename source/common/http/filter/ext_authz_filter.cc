@@ -0,0 +1,295 @@
+#include "common/http/filter/ext_authz_filter.h"
+
+#include <string>
+#include <vector>
+
+#include "envoy/http/codes.h"
+
+#include "common/common/assert.h"
+#include "common/common/enum_to_int.h"
+#include "common/http/header_map_impl.h"
+#include "common/http/headers.h"
+#include "common/http/message_impl.h"
+#include "common/http/utility.h"
+#include "common/json/config_schemas.h"
+
+namespace Envoy {
+namespace Http {
+
+ExtAuthzCache::ExtAuthzCache(uint64_t max_entries, std::chrono::milliseconds allow_ttl,
+                             std::chrono::milliseconds deny_ttl, const ExtAuthzStats& stats,
+                             Event::Dispatcher& dispatcher, MonotonicTimeSource& time_source)
+    : max_entries_(max_entries), allow_ttl_(allow_ttl), deny_ttl_(deny_ttl), stats_(stats),
+      dispatcher_(dispatcher), time_source_(time_source) {}
+
+ExtAuthzCache::~ExtAuthzCache() { stats_.cache_entries_.sub(entries_.size()); }
+
+const ExtAuthzDecision* ExtAuthzCache::lookup(const std::string& key) {
+  auto entry = entries_.find(key);
+  if (entry == entries_.end()) {
+    return nullptr;
+  }
+  if (entry->second.expiry_ <= time_source_.currentTime()) {
+    remove(entry);
+    return nullptr;
+  }
+
+  lru_.touch(entry->second.lru_position_);
+  return &entry->second.decision_;
+}
+
+void ExtAuthzCache::insert(const std::string& key, const ExtAuthzDecision& decision) {
+  const std::chrono::milliseconds ttl =
+      decision.status_ == ExtAuthzDecision::Status::Allowed
+          ? allow_ttl_
+          : (decision.status_ == ExtAuthzDecision::Status::Denied ? deny_ttl_
+                                                                   : std::chrono::milliseconds(0));
+  if (ttl.count() == 0 || max_entries_ == 0) {
+    return;
+  }
+
+  auto entry = entries_.find(key);
+  if (entry != entries_.end()) {
+    remove(entry);
+  }
+  entries_.emplace(key, Entry{decision, time_source_.currentTime() + ttl, lru_.insert(key)});
+  stats_.cache_entries_.inc();
+
+  while (entries_.size() > max_entries_) {
+    stats_.cache_eviction_.inc();
+    remove(entries_.find(lru_.leastRecentlyUsed()));
+  }
+}
+
+void ExtAuthzCache::remove(std::unordered_map<std::string, Entry>::iterator entry) {
+  lru_.remove(entry->second.lru_position_);
+  entries_.erase(entry);
+  stats_.cache_entries_.dec();
+}
+
+ExtAuthzCheck* ExtAuthzCache::findCheck(const std::string& key) const {
+  auto check = checks_by_key_.find(key);
+  return check != checks_by_key_.end() ? check->second : nullptr;
+}
+
+ExtAuthzCheck& ExtAuthzCache::createCheck(const std::string& key) {
+  ExtAuthzCheckPtr check(new ExtAuthzCheck(*this, key));
+  if (!key.empty()) {
+    ASSERT(checks_by_key_.count(key) == 0);
+    checks_by_key_[key] = check.get();
+  }
+  check->moveIntoList(std::move(check), checks_);
+  return *checks_.front();
+}
+
+void ExtAuthzCache::removeCheck(ExtAuthzCheck& check) {
+  if (!check.key().empty()) {
+    checks_by_key_.erase(check.key());
+  }
+  dispatcher_.deferredDelete(check.removeFromList(checks_));
+}
+
+ExtAuthzCheck::~ExtAuthzCheck() {
+  if (request_ != nullptr) {
+    request_->cancel();
+  }
+}
+
+void ExtAuthzCheck::send(AsyncClient& client, MessagePtr&& request,
+                         std::chrono::milliseconds timeout) {
+  span_ = cache_.stats().check_time_.allocateSpan();
+  // A check that completes inline is given no request, and has already been removed.
+  request_ = client.sendDirect(std::move(request), *this, timeout, "ext_authz");
+}
+
+void ExtAuthzCheck::removeWaiter(ExtAuthzFilter& filter) {
+  waiters_.remove(filter);
+  if (waiters_.empty()) {
+    request_->cancel();
+    request_ = nullptr;
+    cache_.removeCheck(*this);
+  }
+}
+
+void ExtAuthzCheck::onSuccess(MessagePtr&& response) {
+  const uint64_t code = Utility::getResponseStatus(response->headers());
+  if (code >= 200 && code < 300) {
+    cache_.stats().ok_.inc();
+    complete({ExtAuthzDecision::Status::Allowed, Code::OK});
+  } else if (code >= 300 && code < 500) {
+    cache_.stats().denied_.inc();
+    complete({ExtAuthzDecision::Status::Denied, static_cast<Code>(code)});
+  } else {
+    cache_.stats().error_.inc();
+    complete({ExtAuthzDecision::Status::Error, Code::Forbidden});
+  }
+}
+
+void ExtAuthzCheck::onFailure(AsyncClient::FailureReason) {
+  cache_.stats().error_.inc();
+  complete({ExtAuthzDecision::Status::Error, Code::Forbidden});
+}
+
+void ExtAuthzCheck::complete(const ExtAuthzDecision& decision) {
+  request_ = nullptr;
+  span_->complete();
+  if (!key_.empty()) {
+    cache_.insert(key_, decision);
+  }
+  cache_.removeCheck(*this);
+
+  // Waiters may be destroyed as they are given the decision, e.g. when it ends their streams.
+  waiters_.notifyAll(
+      [&decision](ExtAuthzFilter& waiter) -> void { waiter.onDecision(decision); });
+}
+
+ExtAuthzFilterConfig::ExtAuthzFilterConfig(const Json::Object& json_config,
+                                           const std::string& stat_prefix, Stats::Scope& scope,
+                                           ThreadLocal::SlotAllocator& tls,
+                                           Upstream::ClusterManager& cm,
+                                           MonotonicTimeSource& time_source)
+    : Json::Validator(json_config, Json::Schema::EXT_AUTHZ_HTTP_FILTER_SCHEMA),
+      cluster_(json_config.getString("cluster")),
+      timeout_(json_config.getInteger("timeout_ms", 200)),
+      path_prefix_(json_config.getString("path_prefix", "")),
+      failure_mode_allow_(json_config.getBoolean("failure_mode_allow", false)),
+      stats_(generateStats(stat_prefix, scope)), cm_(cm), tls_(tls.allocateSlot()) {
+  for (const std::string& header : json_config.getStringArray("headers", true)) {
+    headers_.emplace_back(header);
+  }
+
+  std::chrono::milliseconds allow_ttl(0);
+  std::chrono::milliseconds deny_ttl(0);
+  uint64_t max_entries = 0;
+  if (json_config.hasObject("cache")) {
+    const Json::ObjectSharedPtr cache = json_config.getObject("cache");
+    for (const std::string& header : cache->getStringArray("key_headers")) {
+      cache_key_headers_.emplace_back(header);
+    }
+    allow_ttl = std::chrono::milliseconds(cache->getInteger("allow_ttl_ms", 0));
+    deny_ttl = std::chrono::milliseconds(cache->getInteger("deny_ttl_ms", 0));
+    max_entries = cache->getInteger("max_entries_per_worker", 10000);
+  }
+
+  ExtAuthzStats stats = stats_;
+  tls_->set([max_entries, allow_ttl, deny_ttl, stats, &time_source](
+                Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<ExtAuthzCache>(max_entries, allow_ttl, deny_ttl, stats, dispatcher,
+                                           time_source);
+  });
+}
+
+ExtAuthzStats ExtAuthzFilterConfig::generateStats(const std::string& prefix,
+                                                  Stats::Scope& scope) {
+  std::string final_prefix = prefix + "ext_authz.";
+  return {ALL_EXT_AUTHZ_STATS(POOL_COUNTER_PREFIX(scope, final_prefix),
+                              POOL_GAUGE_PREFIX(scope, final_prefix),
+                              POOL_TIMER_PREFIX(scope, final_prefix))};
+}
+
+FilterHeadersStatus ExtAuthzFilter::decodeHeaders(HeaderMap& headers, bool) {
+  ExtAuthzCache& cache = config_->cache();
+  const std::string key = cacheKey(headers);
+  initiating_call_ = true;
+  state_ = State::Calling;
+  if (!key.empty()) {
+    const ExtAuthzDecision* decision = cache.lookup(key);
+    if (decision != nullptr) {
+      config_->stats().cache_hit_.inc();
+      onDecision(*decision);
+    } else {
+      config_->stats().cache_miss_.inc();
+      check_ = cache.findCheck(key);
+      if (check_ != nullptr) {
+        config_->stats().coalesced_.inc();
+        check_->addWaiter(*this);
+      }
+    }
+  }
+
+  if (state_ == State::Calling && check_ == nullptr) {
+    if (config_->cm().get(config_->cluster()) == nullptr) {
+      // The check fails like one that cannot connect.
+      config_->stats().error_.inc();
+      onDecision({ExtAuthzDecision::Status::Error, Code::Forbidden});
+    } else {
+      check_ = &cache.createCheck(key);
+      check_->addWaiter(*this);
+      check_->send(config_->cm().httpAsyncClientForCluster(config_->cluster()),
+                   checkRequest(headers), config_->timeout());
+    }
+  }
+  initiating_call_ = false;
+
+  return (state_ == State::Calling || state_ == State::Responded)
+             ? FilterHeadersStatus::StopIteration
+             : FilterHeadersStatus::Continue;
+}
+
+FilterDataStatus ExtAuthzFilter::decodeData(Buffer::Instance&, bool) {
+  ASSERT(state_ != State::Responded);
+  return state_ == State::Calling ? FilterDataStatus::StopIterationAndBuffer
+                                  : FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus ExtAuthzFilter::decodeTrailers(HeaderMap&) {
+  ASSERT(state_ != State::Responded);
+  return state_ == State::Calling ? FilterTrailersStatus::StopIteration
+                                  : FilterTrailersStatus::Continue;
+}
+
+void ExtAuthzFilter::onDestroy() {
+  if (state_ == State::Calling) {
+    state_ = State::Complete;
+    check_->removeWaiter(*this);
+    check_ = nullptr;
+  }
+}
+
+void ExtAuthzFilter::onDecision(const ExtAuthzDecision& decision) {
+  check_ = nullptr;
+  if (decision.status_ == ExtAuthzDecision::Status::Allowed ||
+      (decision.status_ == ExtAuthzDecision::Status::Error && config_->failureModeAllow())) {
+    if (decision.status_ == ExtAuthzDecision::Status::Error) {
+      config_->stats().failure_mode_allowed_.inc();
+    }
+    state_ = State::Complete;
+    if (!initiating_call_) {
+      callbacks_->continueDecoding();
+    }
+    return;
+  }
+
+  state_ = State::Responded;
+  HeaderMapPtr response_headers{
+      new HeaderMapImpl{{Headers::get().Status, std::to_string(enumToInt(decision.code_))}}};
+  callbacks_->encodeHeaders(std::move(response_headers), true);
+}
+
+std::string ExtAuthzFilter::cacheKey(const HeaderMap& headers) const {
+  std::string key;
+  Utility::appendHeaderValues(headers, config_->cacheKeyHeaders(), key);
+  return key;
+}
+
+MessagePtr ExtAuthzFilter::checkRequest(const HeaderMap& headers) const {
+  MessagePtr request(new RequestMessageImpl());
+  if (headers.Method() != nullptr) {
+    request->headers().insertMethod().value(*headers.Method());
+  }
+  request->headers().insertPath().value(
+      config_->pathPrefix() + (headers.Path() != nullptr ? headers.Path()->value().c_str() : ""));
+  if (headers.Host() != nullptr) {
+    request->headers().insertHost().value(*headers.Host());
+  }
+  for (const LowerCaseString& name : config_->headers()) {
+    const HeaderEntry* header = headers.get(name);
+    if (header != nullptr) {
+      request->headers().addCopy(name, header->value().c_str());
+    }
+  }
+  return request;
+}
+
+} // namespace Http
+} // namespace Envoy
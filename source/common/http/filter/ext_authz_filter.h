@@ -0,0 +1,258 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/event/deferred_deletable.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/http/async_client.h"
+#include "envoy/http/codes.h"
+#include "envoy/http/filter.h"
+#include "envoy/json/json_object.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+#include "envoy/upstream/cluster_manager.h"
+
+#include "common/common/linked_object.h"
+#include "common/common/lru_list.h"
+#include "common/common/waiter_list.h"
+#include "common/json/json_validator.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All external authorization filter stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_EXT_AUTHZ_STATS(COUNTER, GAUGE, TIMER)                                                 \
+  COUNTER(ok)                                                                                      \
+  COUNTER(denied)                                                                                  \
+  COUNTER(error)                                                                                   \
+  COUNTER(failure_mode_allowed)                                                                    \
+  COUNTER(cache_hit)                                                                               \
+  COUNTER(cache_miss)                                                                              \
+  COUNTER(cache_eviction)                                                                          \
+  COUNTER(coalesced)                                                                               \
+  GAUGE  (cache_entries)                                                                           \
+  TIMER  (check_time)
+// clang-format on
+
+/**
+ * Struct definition for all external authorization filter stats. @see stats_macros.h
+ */
+struct ExtAuthzStats {
+  ALL_EXT_AUTHZ_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT, GENERATE_TIMER_STRUCT)
+};
+
+/**
+ * What the authorization service decided about a request.
+ */
+struct ExtAuthzDecision {
+  enum class Status {
+    // The service answered with a 2xx response.
+    Allowed,
+    // The service answered with another response below 500, whose code the request is sent.
+    Denied,
+    // The service failed, timed out or could not be reached.
+    Error
+  };
+
+  Status status_;
+  Code code_;
+};
+
+class ExtAuthzFilter;
+class ExtAuthzCheck;
+typedef std::unique_ptr<ExtAuthzCheck> ExtAuthzCheckPtr;
+
+/**
+ * The authorization decisions of one worker, by the values of the cache key headers, and the
+ * checks it has in flight. Allowed and denied decisions expire after their own TTLs, which bound
+ * how long a revoked credential is still let through, and errors are not kept at all, so requests
+ * call the service again as soon as it recovers. Requests whose key has a check in flight wait for
+ * its decision, so that a burst of requests with the same credentials costs one check.
+ */
+class ExtAuthzCache : public ThreadLocal::ThreadLocalObject {
+public:
+  ExtAuthzCache(uint64_t max_entries, std::chrono::milliseconds allow_ttl,
+                std::chrono::milliseconds deny_ttl, const ExtAuthzStats& stats,
+                Event::Dispatcher& dispatcher, MonotonicTimeSource& time_source);
+  ~ExtAuthzCache();
+
+  const ExtAuthzStats& stats() const { return stats_; }
+
+  /**
+   * @param key supplies the cache key of a request.
+   * @return const ExtAuthzDecision* the unexpired decision for the key, or nullptr.
+   */
+  const ExtAuthzDecision* lookup(const std::string& key);
+
+  /**
+   * Insert a decision for as long as the TTL of its status, replacing the one for the key if there
+   * is one. Errors are not cached.
+   */
+  void insert(const std::string& key, const ExtAuthzDecision& decision);
+
+  /**
+   * @return ExtAuthzCheck* the check in flight for the key, or nullptr.
+   */
+  ExtAuthzCheck* findCheck(const std::string& key) const;
+
+  /**
+   * Create a check, which is found by its key, if it is not empty, until it completes.
+   */
+  ExtAuthzCheck& createCheck(const std::string& key);
+
+  /**
+   * Forget a check that completed or was cancelled.
+   */
+  void removeCheck(ExtAuthzCheck& check);
+
+private:
+  struct Entry {
+    ExtAuthzDecision decision_;
+    MonotonicTime expiry_;
+    LruList<std::string>::Position lru_position_;
+  };
+
+  void remove(std::unordered_map<std::string, Entry>::iterator entry);
+
+  const uint64_t max_entries_;
+  const std::chrono::milliseconds allow_ttl_;
+  const std::chrono::milliseconds deny_ttl_;
+  ExtAuthzStats stats_;
+  Event::Dispatcher& dispatcher_;
+  MonotonicTimeSource& time_source_;
+  LruList<std::string> lru_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::list<ExtAuthzCheckPtr> checks_;
+  std::unordered_map<std::string, ExtAuthzCheck*> checks_by_key_;
+};
+
+/**
+ * A call to the authorization service and the requests that wait for its decision. The call is
+ * cancelled once no request waits for it.
+ */
+class ExtAuthzCheck : public LinkedObject<ExtAuthzCheck>,
+                      public AsyncClient::Callbacks,
+                      public Event::DeferredDeletable {
+public:
+  ExtAuthzCheck(ExtAuthzCache& cache, const std::string& key) : cache_(cache), key_(key) {}
+  ~ExtAuthzCheck();
+
+  const std::string& key() const { return key_; }
+
+  /**
+   * Send the check. The waiters may be given the decision inline.
+   * @param client supplies the client of the authorization service cluster.
+   * @param request supplies the check request.
+   * @param timeout supplies the timeout of the check.
+   */
+  void send(AsyncClient& client, MessagePtr&& request, std::chrono::milliseconds timeout);
+
+  void addWaiter(ExtAuthzFilter& filter) { waiters_.add(filter); }
+
+  /**
+   * Stop waiting for the decision, which cancels the check if no other request waits for it.
+   */
+  void removeWaiter(ExtAuthzFilter& filter);
+
+  // Http::AsyncClient::Callbacks
+  void onSuccess(MessagePtr&& response) override;
+  void onFailure(AsyncClient::FailureReason reason) override;
+
+private:
+  void complete(const ExtAuthzDecision& decision);
+
+  ExtAuthzCache& cache_;
+  const std::string key_;
+  WaiterList<ExtAuthzFilter> waiters_;
+  AsyncClient::Request* request_{};
+  Stats::TimespanPtr span_;
+};
+
+/**
+ * Configuration for the external authorization filter.
+ */
+class ExtAuthzFilterConfig : Json::Validator {
+public:
+  ExtAuthzFilterConfig(const Json::Object& json_config, const std::string& stat_prefix,
+                       Stats::Scope& scope, ThreadLocal::SlotAllocator& tls,
+                       Upstream::ClusterManager& cm, MonotonicTimeSource& time_source);
+
+  ExtAuthzCache& cache() { return tls_->getTyped<ExtAuthzCache>(); }
+  Upstream::ClusterManager& cm() { return cm_; }
+  ExtAuthzStats& stats() { return stats_; }
+  const std::string& cluster() const { return cluster_; }
+  std::chrono::milliseconds timeout() const { return timeout_; }
+  const std::string& pathPrefix() const { return path_prefix_; }
+  const std::vector<LowerCaseString>& headers() const { return headers_; }
+  const std::vector<LowerCaseString>& cacheKeyHeaders() const { return cache_key_headers_; }
+  bool failureModeAllow() const { return failure_mode_allow_; }
+
+private:
+  static ExtAuthzStats generateStats(const std::string& prefix, Stats::Scope& scope);
+
+  const std::string cluster_;
+  const std::chrono::milliseconds timeout_;
+  const std::string path_prefix_;
+  std::vector<LowerCaseString> headers_;
+  std::vector<LowerCaseString> cache_key_headers_;
+  const bool failure_mode_allow_;
+  ExtAuthzStats stats_;
+  Upstream::ClusterManager& cm_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+typedef std::shared_ptr<ExtAuthzFilterConfig> ExtAuthzFilterConfigSharedPtr;
+
+/**
+ * A filter that asks an HTTP authorization service whether to let each request through. The
+ * service is sent the method, path, host and configured headers of the request, without its body,
+ * and a 2xx response allows the request. A response below 500 otherwise denies it, and the request
+ * is sent the response code. When a cache is configured, decisions are kept per worker by the
+ * values of the cache key headers, and requests that have the key of a check in flight wait for
+ * its decision.
+ */
+class ExtAuthzFilter : public StreamDecoderFilter {
+public:
+  ExtAuthzFilter(ExtAuthzFilterConfigSharedPtr config) : config_(config) {}
+
+  /**
+   * Called with the decision on the request, possibly while the request is being decoded.
+   */
+  void onDecision(const ExtAuthzDecision& decision);
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus decodeTrailers(HeaderMap& trailers) override;
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override {
+    callbacks_ = &callbacks;
+  }
+
+private:
+  enum class State { NotStarted, Calling, Complete, Responded };
+
+  std::string cacheKey(const HeaderMap& headers) const;
+  MessagePtr checkRequest(const HeaderMap& headers) const;
+
+  ExtAuthzFilterConfigSharedPtr config_;
+  StreamDecoderFilterCallbacks* callbacks_{};
+  State state_{State::NotStarted};
+  bool initiating_call_{};
+  ExtAuthzCheck* check_{};
+};
+
+} // namespace Http
+} // namespace Envoy
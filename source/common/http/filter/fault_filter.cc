@@ -17,14 +17,24 @@
 #include "common/http/headers.h"
 #include "common/json/config_schemas.h"
 #include "common/router/config_impl.h"
+#include "common/runtime/key_registry.h"
 
 namespace Envoy {
 namespace Http {
 
-const std::string FaultFilter::DELAY_PERCENT_KEY = "fault.http.delay.fixed_delay_percent";
-const std::string FaultFilter::ABORT_PERCENT_KEY = "fault.http.abort.abort_percent";
-const std::string FaultFilter::DELAY_DURATION_KEY = "fault.http.delay.fixed_duration_ms";
-const std::string FaultFilter::ABORT_HTTP_STATUS_KEY = "fault.http.abort.http_status";
+const char* const FaultFilter::DELAY_PERCENT_NAME = "delay.fixed_delay_percent";
+const char* const FaultFilter::ABORT_PERCENT_NAME = "abort.abort_percent";
+const char* const FaultFilter::DELAY_DURATION_NAME = "delay.fixed_duration_ms";
+const char* const FaultFilter::ABORT_HTTP_STATUS_NAME = "abort.http_status";
+
+const Runtime::Key FaultFilter::DELAY_PERCENT_KEY =
+    Runtime::KeyRegistry::key(std::string("fault.http.") + DELAY_PERCENT_NAME);
+const Runtime::Key FaultFilter::ABORT_PERCENT_KEY =
+    Runtime::KeyRegistry::key(std::string("fault.http.") + ABORT_PERCENT_NAME);
+const Runtime::Key FaultFilter::DELAY_DURATION_KEY =
+    Runtime::KeyRegistry::key(std::string("fault.http.") + DELAY_DURATION_NAME);
+const Runtime::Key FaultFilter::ABORT_HTTP_STATUS_KEY =
+    Runtime::KeyRegistry::key(std::string("fault.http.") + ABORT_HTTP_STATUS_NAME);
 
 FaultFilterConfig::FaultFilterConfig(const Json::Object& json_config, Runtime::Loader& runtime,
                                      const std::string& stats_prefix, Stats::Scope& scope)
@@ -80,6 +90,16 @@ FaultFilter::~FaultFilter() { ASSERT(!delay_timer_); }
 // if we inject a delay, then we will inject the abort in the delay timer
 // callback.
 FilterHeadersStatus FaultFilter::decodeHeaders(HeaderMap& headers, bool) {
+  if (headers.EnvoyDownstreamServiceCluster()) {
+    downstream_cluster_ = headers.EnvoyDownstreamServiceCluster()->value().c_str();
+  }
+
+  // Fault injection is commonly left configured at 0%, so check the percentages first and skip
+  // the route and header matching of requests that no fault can fire for.
+  if (!isFaultPossible()) {
+    return FilterHeadersStatus::Continue;
+  }
+
   if (!matchesTargetUpstreamCluster()) {
     return FilterHeadersStatus::Continue;
   }
@@ -93,19 +113,6 @@ FilterHeadersStatus FaultFilter::decodeHeaders(HeaderMap& headers, bool) {
     return FilterHeadersStatus::Continue;
   }
 
-  if (headers.EnvoyDownstreamServiceCluster()) {
-    downstream_cluster_ = headers.EnvoyDownstreamServiceCluster()->value().c_str();
-
-    downstream_cluster_delay_percent_key_ =
-        fmt::format("fault.http.{}.delay.fixed_delay_percent", downstream_cluster_);
-    downstream_cluster_abort_percent_key_ =
-        fmt::format("fault.http.{}.abort.abort_percent", downstream_cluster_);
-    downstream_cluster_delay_duration_key_ =
-        fmt::format("fault.http.{}.delay.fixed_duration_ms", downstream_cluster_);
-    downstream_cluster_abort_http_status_key_ =
-        fmt::format("fault.http.{}.abort.http_status", downstream_cluster_);
-  }
-
   Optional<uint64_t> duration_ms = delayDuration();
   if (duration_ms.valid()) {
     delay_timer_ = callbacks_->dispatcher().createTimer([this]() -> void { postDelayInjection(); });
@@ -123,13 +130,36 @@ FilterHeadersStatus FaultFilter::decodeHeaders(HeaderMap& headers, bool) {
   return FilterHeadersStatus::Continue;
 }
 
+std::string FaultFilter::downstreamClusterKey(const char* name) const {
+  ASSERT(!downstream_cluster_.empty());
+  return "fault.http." + downstream_cluster_ + "." + name;
+}
+
+bool FaultFilter::isFaultPossible() {
+  const Runtime::Snapshot& snapshot = config_->runtime().snapshot();
+  if (snapshot.getInteger(DELAY_PERCENT_KEY, config_->delayPercent()) > 0 ||
+      snapshot.getInteger(ABORT_PERCENT_KEY, config_->abortPercent()) > 0) {
+    return true;
+  }
+
+  if (downstream_cluster_.empty()) {
+    return false;
+  }
+
+  const uint64_t delay_percent =
+      snapshot.getInteger(downstreamClusterKey(DELAY_PERCENT_NAME), config_->delayPercent());
+  const uint64_t abort_percent =
+      snapshot.getInteger(downstreamClusterKey(ABORT_PERCENT_NAME), config_->abortPercent());
+  return delay_percent > 0 || abort_percent > 0;
+}
+
 bool FaultFilter::isDelayEnabled() {
   bool enabled =
       config_->runtime().snapshot().featureEnabled(DELAY_PERCENT_KEY, config_->delayPercent());
 
-  if (!downstream_cluster_delay_percent_key_.empty()) {
-    enabled |= config_->runtime().snapshot().featureEnabled(downstream_cluster_delay_percent_key_,
-                                                            config_->delayPercent());
+  if (!downstream_cluster_.empty()) {
+    enabled |= config_->runtime().snapshot().featureEnabled(
+        downstreamClusterKey(DELAY_PERCENT_NAME), config_->delayPercent());
   }
 
   return enabled;
@@ -139,9 +169,9 @@ bool FaultFilter::isAbortEnabled() {
   bool enabled =
       config_->runtime().snapshot().featureEnabled(ABORT_PERCENT_KEY, config_->abortPercent());
 
-  if (!downstream_cluster_abort_percent_key_.empty()) {
-    enabled |= config_->runtime().snapshot().featureEnabled(downstream_cluster_abort_percent_key_,
-                                                            config_->abortPercent());
+  if (!downstream_cluster_.empty()) {
+    enabled |= config_->runtime().snapshot().featureEnabled(
+        downstreamClusterKey(ABORT_PERCENT_NAME), config_->abortPercent());
   }
 
   return enabled;
@@ -156,9 +186,9 @@ Optional<uint64_t> FaultFilter::delayDuration() {
 
   uint64_t duration =
       config_->runtime().snapshot().getInteger(DELAY_DURATION_KEY, config_->delayDuration());
-  if (!downstream_cluster_delay_duration_key_.empty()) {
-    duration =
-        config_->runtime().snapshot().getInteger(downstream_cluster_delay_duration_key_, duration);
+  if (!downstream_cluster_.empty()) {
+    duration = config_->runtime().snapshot().getInteger(downstreamClusterKey(DELAY_DURATION_NAME),
+                                                        duration);
   }
 
   // Delay only if the duration is >0ms
@@ -174,9 +204,9 @@ std::string FaultFilter::abortHttpStatus() {
   uint64_t http_status =
       config_->runtime().snapshot().getInteger(ABORT_HTTP_STATUS_KEY, config_->abortCode());
 
-  if (!downstream_cluster_abort_http_status_key_.empty()) {
+  if (!downstream_cluster_.empty()) {
     http_status = config_->runtime().snapshot().getInteger(
-        downstream_cluster_abort_http_status_key_, http_status);
+        downstreamClusterKey(ABORT_HTTP_STATUS_NAME), http_status);
   }
 
   return std::to_string(http_status);
@@ -98,6 +98,18 @@ private:
   bool matchesTargetUpstreamCluster();
   bool matchesDownstreamNodes(const HeaderMap& headers);
 
+  /**
+   * @return std::string the runtime key of the given fault setting for the downstream cluster of
+   *         the request, e.g. fault.http.<cluster>.abort.abort_percent. Keys built from request
+   *         headers are not registered.
+   */
+  std::string downstreamClusterKey(const char* name) const;
+
+  /**
+   * @return bool whether any of the percentages of the current runtime snapshot can fire a fault
+   *         for the request. This is cheaper than rolling for delays and aborts.
+   */
+  bool isFaultPossible();
   bool isAbortEnabled();
   bool isDelayEnabled();
   Optional<uint64_t> delayDuration();
@@ -108,15 +120,14 @@ private:
   Event::TimerPtr delay_timer_;
   std::string downstream_cluster_{};
 
-  std::string downstream_cluster_delay_percent_key_{};
-  std::string downstream_cluster_abort_percent_key_{};
-  std::string downstream_cluster_delay_duration_key_{};
-  std::string downstream_cluster_abort_http_status_key_{};
-
-  const static std::string DELAY_PERCENT_KEY;
-  const static std::string ABORT_PERCENT_KEY;
-  const static std::string DELAY_DURATION_KEY;
-  const static std::string ABORT_HTTP_STATUS_KEY;
+  const static char* const DELAY_PERCENT_NAME;
+  const static char* const ABORT_PERCENT_NAME;
+  const static char* const DELAY_DURATION_NAME;
+  const static char* const ABORT_HTTP_STATUS_NAME;
+  const static Runtime::Key DELAY_PERCENT_KEY;
+  const static Runtime::Key ABORT_PERCENT_KEY;
+  const static Runtime::Key DELAY_DURATION_KEY;
+  const static Runtime::Key ABORT_HTTP_STATUS_KEY;
 };
 
 } // Http
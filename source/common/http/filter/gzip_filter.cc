@@ -0,0 +1,251 @@
+#include "common/http/filter/gzip_filter.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
+#include "common/common/utility.h"
+#include "common/http/headers.h"
+#include "common/json/config_schemas.h"
+
+namespace Envoy {
+namespace Http {
+
+namespace {
+
+// Lower cased media type of a content-type header, without parameters.
+std::string mediaType(const std::string& content_type) {
+  std::string media_type = content_type.substr(0, content_type.find(';'));
+  StringUtil::trim(media_type);
+  for (char& c : media_type) {
+    c = tolower(c);
+  }
+  return media_type;
+}
+
+} // namespace
+
+const uint64_t ZlibCompressor::CHUNK_SIZE;
+
+ZlibCompressor::ZlibCompressor(uint64_t compression_level, uint64_t window_bits,
+                               uint64_t memory_level) {
+  zstream_.zalloc = Z_NULL;
+  zstream_.zfree = Z_NULL;
+  zstream_.opaque = Z_NULL;
+  // Adding 16 to the window bits writes a gzip header and trailer instead of the zlib ones.
+  const int result = deflateInit2(&zstream_, compression_level, Z_DEFLATED, window_bits + 16,
+                                  memory_level, Z_DEFAULT_STRATEGY);
+  RELEASE_ASSERT(result == Z_OK);
+}
+
+ZlibCompressor::~ZlibCompressor() { deflateEnd(&zstream_); }
+
+void ZlibCompressor::compress(Buffer::Instance& data, bool finish) {
+  Buffer::OwnedImpl output;
+  const uint64_t num_slices = data.getRawSlices(nullptr, 0);
+  std::vector<Buffer::RawSlice> slices(num_slices);
+  data.getRawSlices(slices.data(), num_slices);
+  for (const Buffer::RawSlice& slice : slices) {
+    zstream_.next_in = static_cast<Bytef*>(slice.mem_);
+    zstream_.avail_in = slice.len_;
+    deflateInto(output, Z_NO_FLUSH);
+  }
+
+  deflateInto(output, finish ? Z_FINISH : Z_SYNC_FLUSH);
+  data.drain(data.length());
+  data.move(output);
+}
+
+void ZlibCompressor::deflateInto(Buffer::Instance& output, int flush) {
+  // deflate() has consumed all input and completed the flush once it leaves output space unused.
+  do {
+    Buffer::RawSlice slice;
+    output.reserve(CHUNK_SIZE, &slice, 1);
+    zstream_.next_out = static_cast<Bytef*>(slice.mem_);
+    zstream_.avail_out = slice.len_;
+    const int result = deflate(&zstream_, flush);
+    // Z_BUF_ERROR only means that there was nothing to do.
+    RELEASE_ASSERT(result == Z_OK || result == Z_STREAM_END || result == Z_BUF_ERROR);
+    slice.len_ -= zstream_.avail_out;
+    output.commit(&slice, 1);
+  } while (zstream_.avail_out == 0);
+}
+
+void ZlibCompressor::reset() {
+  const int result = deflateReset(&zstream_);
+  RELEASE_ASSERT(result == Z_OK);
+}
+
+const uint64_t GzipFilterConfig::MAX_POOLED_COMPRESSORS;
+
+GzipFilterConfig::GzipFilterConfig(const Json::Object& json_config, const std::string& stat_prefix,
+                                   Stats::Scope& scope, ThreadLocal::SlotAllocator& tls)
+    : Json::Validator(json_config, Json::Schema::GZIP_HTTP_FILTER_SCHEMA),
+      compression_level_(json_config.getInteger("compression_level", 6)),
+      window_bits_(json_config.getInteger("window_bits", 12)),
+      memory_level_(json_config.getInteger("memory_level", 5)),
+      min_content_length_(json_config.getInteger("min_content_length", 30)),
+      stats_(generateStats(stat_prefix, scope)), tls_(tls.allocateSlot()) {
+  const std::vector<std::string> content_types =
+      json_config.hasObject("content_types")
+          ? json_config.getStringArray("content_types")
+          : std::vector<std::string>{"application/javascript", "application/json",
+                                     "application/xml", "image/svg+xml", "text/css", "text/html",
+                                     "text/plain", "text/xml"};
+  for (const std::string& content_type : content_types) {
+    content_types_.insert(mediaType(content_type));
+  }
+
+  tls_->set([](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<CompressorPool>();
+  });
+}
+
+GzipStats GzipFilterConfig::generateStats(const std::string& prefix, Stats::Scope& scope) {
+  std::string final_prefix = prefix + "gzip.";
+  return {ALL_GZIP_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
+}
+
+bool GzipFilterConfig::compressibleContentType(const std::string& content_type) const {
+  return content_types_.count(mediaType(content_type)) > 0;
+}
+
+ZlibCompressorPtr GzipFilterConfig::acquireCompressor() {
+  std::vector<ZlibCompressorPtr>& compressors = tls_->getTyped<CompressorPool>().compressors_;
+  if (compressors.empty()) {
+    return ZlibCompressorPtr{new ZlibCompressor(compression_level_, window_bits_, memory_level_)};
+  }
+
+  ZlibCompressorPtr compressor = std::move(compressors.back());
+  compressors.pop_back();
+  return compressor;
+}
+
+void GzipFilterConfig::releaseCompressor(ZlibCompressorPtr&& compressor) {
+  std::vector<ZlibCompressorPtr>& compressors = tls_->getTyped<CompressorPool>().compressors_;
+  if (compressors.size() < MAX_POOLED_COMPRESSORS) {
+    compressor->reset();
+    compressors.emplace_back(std::move(compressor));
+  }
+}
+
+GzipFilter::GzipFilter(GzipFilterConfigSharedPtr config) : config_(config) {}
+
+GzipFilter::~GzipFilter() { ASSERT(!compressor_); }
+
+bool GzipFilter::acceptsGzip(const HeaderEntry* accept_encoding) {
+  if (accept_encoding == nullptr) {
+    return false;
+  }
+
+  for (const StringView coding :
+       StringUtil::splitToViews(accept_encoding->value().getStringView(), ',')) {
+    const std::vector<StringView> params = StringUtil::splitToViews(coding, ';');
+    if (params.empty()) {
+      continue;
+    }
+
+    const StringView name = StringUtil::trimView(params[0]);
+    if (!StringUtil::caseInsensitiveEqual(name, "gzip") && name != "*") {
+      continue;
+    }
+
+    // A coding with a quality value of 0 is not acceptable.
+    bool acceptable = true;
+    for (size_t i = 1; i < params.size(); i++) {
+      const StringView param = StringUtil::trimView(params[i]);
+      if (StringUtil::startsWith(param, "q=", false) &&
+          atof(param.substr(2).toString().c_str()) <= 0) {
+        acceptable = false;
+      }
+    }
+    if (acceptable) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void GzipFilter::onDestroy() {
+  if (compressor_) {
+    config_->releaseCompressor(std::move(compressor_));
+  }
+}
+
+FilterHeadersStatus GzipFilter::decodeHeaders(HeaderMap& headers, bool) {
+  accepts_gzip_ = acceptsGzip(headers.get(Headers::get().AcceptEncoding));
+  return FilterHeadersStatus::Continue;
+}
+
+bool GzipFilter::shouldCompress(const HeaderMap& headers) const {
+  if (headers.get(Headers::get().ContentEncoding) != nullptr) {
+    return false;
+  }
+
+  if (headers.ContentType() == nullptr ||
+      !config_->compressibleContentType(headers.ContentType()->value().c_str())) {
+    return false;
+  }
+
+  const HeaderEntry* cache_control = headers.get(Headers::get().CacheControl);
+  if (cache_control != nullptr &&
+      cache_control->value().find(Headers::get().CacheControlValues.NoTransform.c_str())) {
+    return false;
+  }
+
+  // A response without a content length is streamed and assumed to be long enough.
+  uint64_t content_length;
+  return headers.ContentLength() == nullptr ||
+         !StringUtil::atoul(headers.ContentLength()->value().c_str(), content_length) ||
+         content_length >= config_->minContentLength();
+}
+
+FilterHeadersStatus GzipFilter::encodeHeaders(HeaderMap& headers, bool end_stream) {
+  if (!accepts_gzip_ || end_stream) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  if (!shouldCompress(headers)) {
+    config_->stats().not_compressed_.inc();
+    return FilterHeadersStatus::Continue;
+  }
+
+  config_->stats().compressed_.inc();
+  compressor_ = config_->acquireCompressor();
+  headers.removeContentLength();
+  headers.addReference(Headers::get().ContentEncoding,
+                       Headers::get().ContentEncodingValues.Gzip);
+  headers.addReference(Headers::get().Vary, Headers::get().VaryValues.AcceptEncoding);
+  return FilterHeadersStatus::Continue;
+}
+
+FilterDataStatus GzipFilter::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (compressor_) {
+    compress(data, end_stream);
+  }
+
+  return FilterDataStatus::Continue;
+}
+
+FilterTrailersStatus GzipFilter::encodeTrailers(HeaderMap&) {
+  if (compressor_) {
+    // The gzip trailer goes out in one more data frame ahead of the trailers.
+    Buffer::OwnedImpl data;
+    compress(data, true);
+    encoder_callbacks_->addEncodedData(data);
+  }
+
+  return FilterTrailersStatus::Continue;
+}
+
+void GzipFilter::compress(Buffer::Instance& data, bool end_stream) {
+  config_->stats().total_uncompressed_bytes_.add(data.length());
+  compressor_->compress(data, end_stream);
+  config_->stats().total_compressed_bytes_.add(data.length());
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "envoy/http/filter.h"
+#include "envoy/json/json_object.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/json/json_validator.h"
+
+#include "zlib.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * All gzip filter stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_GZIP_STATS(COUNTER)                                                                    \
+  COUNTER(compressed)                                                                              \
+  COUNTER(not_compressed)                                                                          \
+  COUNTER(total_uncompressed_bytes)                                                                \
+  COUNTER(total_compressed_bytes)
+// clang-format on
+
+/**
+ * Struct definition for all gzip filter stats. @see stats_macros.h
+ */
+struct GzipStats {
+  ALL_GZIP_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * A zlib deflate stream with gzip framing. The stream is reset rather than freed between responses
+ * so that its window and hash table are allocated once.
+ */
+class ZlibCompressor {
+public:
+  ZlibCompressor(uint64_t compression_level, uint64_t window_bits, uint64_t memory_level);
+  ~ZlibCompressor();
+
+  /**
+   * Replace data with its compressed form. The compressed data deflated so far is flushed, so that
+   * a client can decompress a streamed response as it arrives.
+   * @param data supplies the data to compress.
+   * @param finish supplies whether this is the end of the stream, which writes the gzip trailer.
+   */
+  void compress(Buffer::Instance& data, bool finish);
+
+  /**
+   * Start a new stream.
+   */
+  void reset();
+
+  // Output is deflated into reservations of this size at the end of the output buffer.
+  static const uint64_t CHUNK_SIZE = 4096;
+
+private:
+  void deflateInto(Buffer::Instance& output, int flush);
+
+  z_stream zstream_;
+};
+
+typedef std::unique_ptr<ZlibCompressor> ZlibCompressorPtr;
+
+/**
+ * Configuration for the gzip filter. Each worker keeps a pool of compressors, so that a response
+ * only allocates a deflate stream when more responses are being compressed on the worker than
+ * ever before.
+ */
+class GzipFilterConfig : Json::Validator {
+public:
+  GzipFilterConfig(const Json::Object& json_config, const std::string& stat_prefix,
+                   Stats::Scope& scope, ThreadLocal::SlotAllocator& tls);
+
+  GzipStats& stats() { return stats_; }
+  uint64_t minContentLength() const { return min_content_length_; }
+
+  /**
+   * @param content_type supplies the value of a content-type header.
+   * @return bool whether responses with the content type are compressed.
+   */
+  bool compressibleContentType(const std::string& content_type) const;
+
+  /**
+   * @return ZlibCompressorPtr a compressor at the start of a stream, from the pool of the calling
+   *         worker if it has one.
+   */
+  ZlibCompressorPtr acquireCompressor();
+
+  /**
+   * Return a compressor to the pool of the calling worker.
+   */
+  void releaseCompressor(ZlibCompressorPtr&& compressor);
+
+  // A worker frees compressors beyond this many when they are released.
+  static const uint64_t MAX_POOLED_COMPRESSORS = 32;
+
+private:
+  struct CompressorPool : public ThreadLocal::ThreadLocalObject {
+    std::vector<ZlibCompressorPtr> compressors_;
+  };
+
+  static GzipStats generateStats(const std::string& prefix, Stats::Scope& scope);
+
+  const uint64_t compression_level_;
+  const uint64_t window_bits_;
+  const uint64_t memory_level_;
+  const uint64_t min_content_length_;
+  std::unordered_set<std::string> content_types_;
+  GzipStats stats_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+typedef std::shared_ptr<GzipFilterConfig> GzipFilterConfigSharedPtr;
+
+/**
+ * A filter that compresses responses with gzip when the client accepts it. Responses are
+ * compressed as their data arrives rather than buffered.
+ */
+class GzipFilter : public StreamFilter {
+public:
+  GzipFilter(GzipFilterConfigSharedPtr config);
+  ~GzipFilter();
+
+  /**
+   * @param accept_encoding supplies the accept-encoding header of a request, or nullptr.
+   * @return bool whether the header accepts a gzip coded response.
+   */
+  static bool acceptsGzip(const HeaderEntry* accept_encoding);
+
+  // Http::StreamFilterBase
+  void onDestroy() override;
+
+  // Http::StreamDecoderFilter
+  FilterHeadersStatus decodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus decodeData(Buffer::Instance&, bool) override {
+    return FilterDataStatus::Continue;
+  }
+  FilterTrailersStatus decodeTrailers(HeaderMap&) override {
+    return FilterTrailersStatus::Continue;
+  }
+  void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks&) override {}
+
+  // Http::StreamEncoderFilter
+  FilterHeadersStatus encodeHeaders(HeaderMap& headers, bool end_stream) override;
+  FilterDataStatus encodeData(Buffer::Instance& data, bool end_stream) override;
+  FilterTrailersStatus encodeTrailers(HeaderMap& trailers) override;
+  void setEncoderFilterCallbacks(StreamEncoderFilterCallbacks& callbacks) override {
+    encoder_callbacks_ = &callbacks;
+  }
+
+private:
+  bool shouldCompress(const HeaderMap& headers) const;
+  void compress(Buffer::Instance& data, bool end_stream);
+
+  GzipFilterConfigSharedPtr config_;
+  StreamEncoderFilterCallbacks* encoder_callbacks_{};
+  bool accepts_gzip_{};
+  ZlibCompressorPtr compressor_;
+};
+
+} // namespace Http
+} // namespace Envoy
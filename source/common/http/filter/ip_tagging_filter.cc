@@ -1,15 +1,181 @@
 #include "common/http/filter/ip_tagging_filter.h"
 
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/utility.h"
+#include "common/http/headers.h"
+#include "common/json/json_loader.h"
+#include "common/network/cidr_range.h"
+
+#include "spdlog/spdlog.h"
+
 namespace Envoy {
 namespace Http {
 
+IpTagTable::IpTagTable(const std::vector<Json::ObjectSharedPtr>& ip_tags) {
+  std::vector<TaggedPrefix<uint32_t>> ipv4_prefixes;
+  std::vector<TaggedPrefix<Network::Address::Ipv6PrefixTrieKey>> ipv6_prefixes;
+  for (const Json::ObjectSharedPtr& ip_tag : ip_tags) {
+    const uint32_t tag = tag_names_.size();
+    tag_names_.push_back(ip_tag->getString("ip_tag_name"));
+
+    for (const std::string& entry : ip_tag->getStringArray("ip_list")) {
+      // A bare address is a prefix of all of its bits.
+      const Network::Address::CidrRange range =
+          entry.find('/') == std::string::npos ? Network::Address::CidrRange::create(entry, 128)
+                                               : Network::Address::CidrRange::create(entry);
+      if (!range.isValid()) {
+        throw EnvoyException(
+            fmt::format("invalid ip/mask combo '{}' (format is <ip>/<# mask bits>)", entry));
+      }
+
+      if (range.version() == Network::Address::IpVersion::v4) {
+        ipv4_prefixes.push_back(
+            {{static_cast<uint32_t>(range.length()), ntohl(range.ipv4()->address())}, tag});
+      } else {
+        ipv6_prefixes.push_back(
+            {{static_cast<uint32_t>(range.length()), range.ipv6()->address()}, tag});
+      }
+    }
+  }
+
+  build(ipv4_prefixes, ipv4_trie_);
+  build(ipv6_prefixes, ipv6_trie_);
+  tag_sets_.clear();
+  tag_set_members_.clear();
+}
+
+template <class Key>
+void IpTagTable::build(std::vector<TaggedPrefix<Key>>& prefixes,
+                       Network::Address::PrefixTrie<Key>& trie) {
+  // Add each prefix after the shorter prefixes covering it, which the trie then already holds with
+  // their merged tags.
+  std::sort(prefixes.begin(), prefixes.end());
+  auto it = prefixes.begin();
+  while (it != prefixes.end()) {
+    const uint32_t length = it->first.first;
+    const Key& prefix = it->first.second;
+
+    std::vector<uint32_t> tags;
+    const uint32_t covering = trie.longestMatch(prefix);
+    if (covering != Network::Address::PrefixTrie<Key>::NO_VALUE) {
+      tags = tag_set_members_[covering];
+    }
+    for (; it != prefixes.end() && it->first.first == length && it->first.second == prefix; ++it) {
+      tags.push_back(it->second);
+    }
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+
+    auto inserted = tag_sets_.emplace(tags, values_.size());
+    if (inserted.second) {
+      std::vector<std::string> names;
+      for (uint32_t tag : tags) {
+        names.push_back(tag_names_[tag]);
+      }
+      values_.push_back(StringUtil::join(names, ","));
+      tag_set_members_.push_back(tags);
+    }
+    trie.insert(prefix, length, inserted.first->second);
+  }
+}
+
+const std::string* IpTagTable::lookup(const std::string& address) const {
+  uint32_t value = Network::Address::PrefixTrie<uint32_t>::NO_VALUE;
+  in_addr ipv4;
+  in6_addr ipv6;
+  if (inet_pton(AF_INET, address.c_str(), &ipv4) == 1) {
+    value = ipv4_trie_.longestMatch(ntohl(ipv4.s_addr));
+  } else if (inet_pton(AF_INET6, address.c_str(), &ipv6) == 1) {
+    Network::Address::Ipv6PrefixTrieKey key;
+    std::copy(ipv6.s6_addr, ipv6.s6_addr + key.size(), key.begin());
+    value = ipv6_trie_.longestMatch(key);
+  }
+
+  return value == Network::Address::PrefixTrie<uint32_t>::NO_VALUE ? nullptr : &values_[value];
+}
+
+IpTaggingFilterConfig::IpTaggingFilterConfig(const Json::Object& json_config,
+                                             const std::string& stat_prefix, Stats::Scope& scope,
+                                             ThreadLocal::SlotAllocator& tls,
+                                             Event::Dispatcher& dispatcher)
+    : Json::Validator(json_config, Json::Schema::IP_TAGGING_HTTP_FILTER_SCHEMA),
+      request_type_(stringToType(json_config.getString("request_type", "both"))),
+      ip_tags_path_(json_config.getString("ip_tags_path", "")),
+      stats_(generateStats(stat_prefix, scope)), tls_(tls.allocateSlot()) {
+  if (ip_tags_path_.empty()) {
+    setIpTags(json_config.getObjectArray("ip_tags", true));
+    return;
+  }
+
+  if (json_config.hasObject("ip_tags")) {
+    throw EnvoyException("ip tagging filter config can't have both ip_tags and ip_tags_path");
+  }
+
+  // A bad file fails the config. After that, bad versions are rejected and the last good one stays.
+  Json::ObjectSharedPtr file = Json::Factory::loadFromFile(ip_tags_path_);
+  file->validateSchema(Json::Schema::IP_TAGS_FILE_SCHEMA);
+  setIpTags(file->getObjectArray("ip_tags", true));
+
+  watcher_ = dispatcher.createFilesystemWatcher();
+  watcher_->addWatch(ip_tags_path_, Filesystem::Watcher::Events::MovedTo,
+                     [this](uint32_t) -> void { reloadIpTags(); });
+}
+
+IpTaggingStats IpTaggingFilterConfig::generateStats(const std::string& prefix,
+                                                    Stats::Scope& scope) {
+  std::string final_prefix = prefix + "ip_tagging.";
+  return {ALL_IP_TAGGING_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
+}
+
+void IpTaggingFilterConfig::setIpTags(const std::vector<Json::ObjectSharedPtr>& ip_tags) {
+  IpTagTableSharedPtr table(new IpTagTable(ip_tags));
+  tls_->set(
+      [table](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr { return table; });
+}
+
+void IpTaggingFilterConfig::reloadIpTags() {
+  try {
+    Json::ObjectSharedPtr file = Json::Factory::loadFromFile(ip_tags_path_);
+    file->validateSchema(Json::Schema::IP_TAGS_FILE_SCHEMA);
+    setIpTags(file->getObjectArray("ip_tags", true));
+    stats_.reload_success_.inc();
+  } catch (const EnvoyException& e) {
+    ENVOY_LOG(warn, "ip tags reload from {} failed: {}", ip_tags_path_, e.what());
+    stats_.reload_failure_.inc();
+  }
+}
+
 IpTaggingFilter::IpTaggingFilter(IpTaggingFilterConfigSharedPtr config) : config_(config) {}
 
 IpTaggingFilter::~IpTaggingFilter() {}
 
 void IpTaggingFilter::onDestroy() {}
 
-FilterHeadersStatus IpTaggingFilter::decodeHeaders(HeaderMap&, bool) {
+FilterHeadersStatus IpTaggingFilter::decodeHeaders(HeaderMap& headers, bool) {
+  const bool internal_request =
+      headers.EnvoyInternalRequest() && (headers.EnvoyInternalRequest()->value() == "true");
+  if ((config_->requestType() == FilterRequestType::Internal && !internal_request) ||
+      (config_->requestType() == FilterRequestType::External && internal_request)) {
+    return FilterHeadersStatus::Continue;
+  }
+
+  const std::string* tags = config_->ipTags().lookup(callbacks_->downstreamAddress());
+  if (tags == nullptr) {
+    config_->stats().no_hit_.inc();
+    return FilterHeadersStatus::Continue;
+  }
+
+  // The value was joined when the table was built, so this is one copy.
+  config_->stats().hit_.inc();
+  headers.addReferenceKey(Headers::get().EnvoyIpTags, *tags);
   return FilterHeadersStatus::Continue;
 }
 
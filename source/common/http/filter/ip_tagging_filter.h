@@ -1,35 +1,105 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "envoy/event/dispatcher.h"
+#include "envoy/filesystem/filesystem.h"
 #include "envoy/http/filter.h"
 #include "envoy/json/json_object.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
 
 #include "common/common/assert.h"
+#include "common/common/logger.h"
 #include "common/json/config_schemas.h"
 #include "common/json/json_validator.h"
+#include "common/network/prefix_trie.h"
 
 namespace Envoy {
 namespace Http {
 
+/**
+ * All ip tagging filter stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_IP_TAGGING_STATS(COUNTER)                                                              \
+  COUNTER(hit)                                                                                     \
+  COUNTER(no_hit)                                                                                  \
+  COUNTER(reload_success)                                                                          \
+  COUNTER(reload_failure)
+// clang-format on
+
+/**
+ * Struct definition for all ip tagging filter stats. @see stats_macros.h
+ */
+struct IpTaggingStats {
+  ALL_IP_TAGGING_STATS(GENERATE_COUNTER_STRUCT)
+};
+
 /**
  * Type of requests the filter should apply to.
  */
 enum class FilterRequestType { Internal, External, Both };
 
 /**
- * Configuration for the ip tagging filter.
+ * Immutable table from address prefixes to ip tags. An address gets the tags of every prefix it
+ * falls in, which are merged into the longest matching prefix when the table is built, so a lookup
+ * is one longest prefix match. The merged tags are joined into their header value up front, and
+ * prefixes with the same tags share one value.
  */
-class IpTaggingFilterConfig : Json::Validator {
+class IpTagTable : public ThreadLocal::ThreadLocalObject {
 public:
-  IpTaggingFilterConfig(const Json::Object& json_config)
-      : Json::Validator(json_config, Json::Schema::IP_TAGGING_HTTP_FILTER_SCHEMA),
-        request_type_(stringToType(json_config.getString("request_type", "both"))) {}
+  /**
+   * @param ip_tags supplies the ip tag objects of the filter config. Throws EnvoyException on an
+   *        invalid prefix.
+   */
+  IpTagTable(const std::vector<Json::ObjectSharedPtr>& ip_tags);
+
+  /**
+   * @param address supplies an IPv4 or IPv6 address without a port.
+   * @return const std::string* the comma separated tags of the address, or nullptr if it has none
+   *         or is not an IP address.
+   */
+  const std::string* lookup(const std::string& address) const;
+
+private:
+  // A prefix, by length first so that sorting puts prefixes after the shorter ones covering them,
+  // paired with the index of one of its tags.
+  template <class Key> using TaggedPrefix = std::pair<std::pair<uint32_t, Key>, uint32_t>;
+
+  template <class Key>
+  void build(std::vector<TaggedPrefix<Key>>& prefixes, Network::Address::PrefixTrie<Key>& trie);
+
+  std::vector<std::string> tag_names_;
+  // Tag sets, as sorted tag_names_ indexes, to their index in values_.
+  std::map<std::vector<uint32_t>, uint32_t> tag_sets_;
+  std::vector<std::vector<uint32_t>> tag_set_members_;
+  std::vector<std::string> values_;
+  Network::Address::PrefixTrie<uint32_t> ipv4_trie_;
+  Network::Address::PrefixTrie<Network::Address::Ipv6PrefixTrieKey> ipv6_trie_;
+};
+
+typedef std::shared_ptr<IpTagTable> IpTagTableSharedPtr;
+
+/**
+ * Configuration for the ip tagging filter. The tags come from the config, or from a file that is
+ * loaded again whenever a new version is moved into place. Each worker reads the table through a
+ * thread local slot, so a reload swaps it without locking.
+ */
+class IpTaggingFilterConfig : Json::Validator, Logger::Loggable<Logger::Id::filter> {
+public:
+  IpTaggingFilterConfig(const Json::Object& json_config, const std::string& stat_prefix,
+                        Stats::Scope& scope, ThreadLocal::SlotAllocator& tls,
+                        Event::Dispatcher& dispatcher);
 
   FilterRequestType requestType() const { return request_type_; }
+  const IpTagTable& ipTags() { return tls_->getTyped<IpTagTable>(); }
+  IpTaggingStats& stats() { return stats_; }
 
 private:
   static FilterRequestType stringToType(const std::string& request_type) {
@@ -43,7 +113,15 @@ private:
     }
   }
 
+  static IpTaggingStats generateStats(const std::string& prefix, Stats::Scope& scope);
+  void setIpTags(const std::vector<Json::ObjectSharedPtr>& ip_tags);
+  void reloadIpTags();
+
   const FilterRequestType request_type_;
+  const std::string ip_tags_path_;
+  IpTaggingStats stats_;
+  ThreadLocal::SlotPtr tls_;
+  Filesystem::WatcherPtr watcher_;
 };
 
 typedef std::shared_ptr<IpTaggingFilterConfig> IpTaggingFilterConfigSharedPtr;
@@ -126,7 +126,8 @@ void Filter::complete(Envoy::RateLimit::LimitStatus status) {
                                              EMPTY_STRING,
                                              EMPTY_STRING,
                                              EMPTY_STRING,
-                                             false};
+                                             false,
+                                             &cluster_->codeStats()};
     Http::CodeUtility::chargeResponseStat(info);
     break;
   }
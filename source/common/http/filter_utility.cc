@@ -12,7 +12,9 @@ FilterUtility::resolveClusterInfo(Http::StreamDecoderFilterCallbacks* decoder_ca
   }
 
   const Router::RouteEntry* route_entry = route->routeEntry();
-  Upstream::ThreadLocalCluster* cluster = cm.get(route_entry->clusterName());
+  const Optional<uint32_t>& cluster_id = route_entry->clusterId();
+  Upstream::ThreadLocalCluster* cluster = cluster_id.valid() ? cm.getById(cluster_id.value())
+                                                             : cm.get(route_entry->clusterName());
   if (!cluster) {
     return nullptr;
   }
@@ -0,0 +1,398 @@
+#include "common/http/forwarding_conn_pool.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/assert.h"
+#include "common/http/header_map_impl.h"
+
+namespace Envoy {
+namespace Http {
+
+ForwardingConnPoolImpl::ForwardingConnPoolImpl(Event::Dispatcher& dispatcher,
+                                               Event::Dispatcher& owner_dispatcher,
+                                               Upstream::HostConstSharedPtr host,
+                                               PoolGetter owner_pool)
+    : dispatcher_(dispatcher), owner_dispatcher_(owner_dispatcher), host_(host),
+      owner_pool_(owner_pool) {}
+
+ForwardingConnPoolImpl::~ForwardingConnPoolImpl() {
+  // Like the other pools when they close their connections, reset the streams that are still in
+  // flight and fail the pending ones. The owner is told to do the same with its side.
+  drained_callbacks_.clear();
+  while (!streams_.empty()) {
+    LocalStream& stream = streams_.front()->local_;
+    if (stream.ready_) {
+      stream.resetStream(StreamResetReason::ConnectionTermination);
+    } else {
+      ConnectionPool::Callbacks& callbacks = stream.callbacks_;
+      stream.cancel();
+      callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::ConnectionFailure, host_);
+    }
+  }
+}
+
+void ForwardingConnPoolImpl::addDrainedCallback(DrainedCb cb) {
+  drained_callbacks_.push_back(cb);
+  checkForDrained();
+}
+
+void ForwardingConnPoolImpl::checkForDrained() {
+  // There are no connections to close here. The owner's pool drains on its own when the host goes
+  // away there.
+  if (!drained_callbacks_.empty() && streams_.empty()) {
+    for (const DrainedCb& cb : drained_callbacks_) {
+      cb();
+    }
+  }
+}
+
+ConnectionPool::Cancellable*
+ForwardingConnPoolImpl::newStream(StreamDecoder& response_decoder,
+                                  ConnectionPool::Callbacks& callbacks) {
+  ENVOY_LOG(debug, "forwarding stream to the worker that owns the host");
+  ForwardedStreamSharedPtr stream(new ForwardedStream(*this, response_decoder, callbacks));
+  streams_.push_front(stream);
+  stream->local_.pool_ = this;
+  stream->local_.pool_entry_ = streams_.begin();
+
+  PoolGetter owner_pool = owner_pool_;
+  stream->postRemote([owner_pool](RemoteStream& remote) -> void { remote.start(owner_pool); });
+  return &stream->local_;
+}
+
+void ForwardingConnPoolImpl::prefetchConnections() {
+  // Connections are only ever opened by the owner's pool, which prefetches for the streams it gets
+  // and keeps its own warm connections.
+}
+
+void ForwardingConnPoolImpl::release(Event::Dispatcher& dispatcher,
+                                     ForwardedStreamSharedPtr&& stream) {
+  dispatcher.deferredDelete(Event::DeferredDeletablePtr{new StreamReleaser(std::move(stream))});
+}
+
+void ForwardingConnPoolImpl::onStreamDone(LocalStream& stream) {
+  ForwardedStreamSharedPtr removed = std::move(*stream.pool_entry_);
+  streams_.erase(stream.pool_entry_);
+  release(dispatcher_, std::move(removed));
+  checkForDrained();
+}
+
+ForwardingConnPoolImpl::ForwardedStream::ForwardedStream(ForwardingConnPoolImpl& pool,
+                                                         StreamDecoder& response_decoder,
+                                                         ConnectionPool::Callbacks& callbacks)
+    : dispatcher_(pool.dispatcher_), owner_dispatcher_(pool.owner_dispatcher_), host_(pool.host_),
+      local_(*this, response_decoder, callbacks), remote_(*this) {}
+
+void ForwardingConnPoolImpl::ForwardedStream::postRemote(std::function<void(RemoteStream&)> cb) {
+  ForwardedStreamSharedPtr stream = shared_from_this();
+  owner_dispatcher_.post([stream, cb]() -> void { cb(stream->remote_); });
+}
+
+void ForwardingConnPoolImpl::ForwardedStream::postLocal(std::function<void(LocalStream&)> cb) {
+  ForwardedStreamSharedPtr stream = shared_from_this();
+  dispatcher_.post([stream, cb]() -> void { cb(stream->local_); });
+}
+
+void ForwardingConnPoolImpl::LocalStream::cancel() {
+  ASSERT(pool_ && !ready_);
+  parent_.postRemote([](RemoteStream& remote) -> void { remote.cancel(); });
+  onDone();
+}
+
+void ForwardingConnPoolImpl::LocalStream::encodeHeaders(const HeaderMap& headers,
+                                                        bool end_stream) {
+  // The caller keeps the headers, so the owner gets a copy.
+  std::shared_ptr<HeaderMapImpl> copy(new HeaderMapImpl(headers));
+  parent_.postRemote([copy, end_stream](RemoteStream& remote) -> void {
+    remote.encodeHeaders(*copy, end_stream);
+  });
+  encode_complete_ = end_stream;
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::LocalStream::encodeData(Buffer::Instance& data, bool end_stream) {
+  std::shared_ptr<Buffer::OwnedImpl> buffer(new Buffer::OwnedImpl());
+  buffer->move(data);
+  parent_.postRemote([buffer, end_stream](RemoteStream& remote) -> void {
+    remote.encodeData(*buffer, end_stream);
+  });
+  encode_complete_ = end_stream;
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::LocalStream::encodeTrailers(const HeaderMap& trailers) {
+  std::shared_ptr<HeaderMapImpl> copy(new HeaderMapImpl(trailers));
+  parent_.postRemote([copy](RemoteStream& remote) -> void { remote.encodeTrailers(*copy); });
+  encode_complete_ = true;
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::LocalStream::resetStream(StreamResetReason reason) {
+  if (!pool_) {
+    return;
+  }
+
+  parent_.postRemote([reason](RemoteStream& remote) -> void { remote.resetStream(reason); });
+  onDone();
+  runResetCallbacks(reason);
+}
+
+void ForwardingConnPoolImpl::LocalStream::readDisable(bool disable) {
+  parent_.postRemote([disable](RemoteStream& remote) -> void { remote.readDisable(disable); });
+}
+
+void ForwardingConnPoolImpl::LocalStream::onPoolFailure(
+    ConnectionPool::PoolFailureReason reason, Upstream::HostDescriptionConstSharedPtr host) {
+  if (!pool_) {
+    return;
+  }
+
+  onDone();
+  callbacks_.onPoolFailure(reason, host);
+}
+
+void ForwardingConnPoolImpl::LocalStream::onPoolReady(
+    Upstream::HostDescriptionConstSharedPtr host) {
+  if (!pool_) {
+    return;
+  }
+
+  ready_ = true;
+  callbacks_.onPoolReady(*this, host);
+}
+
+void ForwardingConnPoolImpl::LocalStream::onPoolConnectionTiming(
+    const ConnectionPool::ConnectionTiming& timing) {
+  if (!pool_) {
+    return;
+  }
+
+  callbacks_.onPoolConnectionTiming(timing);
+}
+
+void ForwardingConnPoolImpl::LocalStream::onDecodeHeaders(HeaderMapPtr&& headers,
+                                                          bool end_stream) {
+  if (!pool_) {
+    return;
+  }
+
+  decode_complete_ = end_stream;
+  response_decoder_.decodeHeaders(std::move(headers), end_stream);
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::LocalStream::onDecodeData(Buffer::Instance& data, bool end_stream) {
+  if (!pool_) {
+    return;
+  }
+
+  decode_complete_ = end_stream;
+  response_decoder_.decodeData(data, end_stream);
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::LocalStream::onDecodeTrailers(HeaderMapPtr&& trailers) {
+  if (!pool_) {
+    return;
+  }
+
+  decode_complete_ = true;
+  response_decoder_.decodeTrailers(std::move(trailers));
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::LocalStream::onResetStream(StreamResetReason reason) {
+  if (!pool_) {
+    return;
+  }
+
+  onDone();
+  runResetCallbacks(reason);
+}
+
+void ForwardingConnPoolImpl::LocalStream::onAboveWriteBufferHighWatermark() {
+  if (pool_) {
+    runHighWatermarkCallbacks();
+  }
+}
+
+void ForwardingConnPoolImpl::LocalStream::onBelowWriteBufferLowWatermark() {
+  if (pool_) {
+    runLowWatermarkCallbacks();
+  }
+}
+
+void ForwardingConnPoolImpl::LocalStream::checkForComplete() {
+  // A response can complete before the request does. The caller then either finishes the request
+  // or resets the stream, so the stream stays in the pool until one of those happens.
+  if (pool_ && encode_complete_ && decode_complete_) {
+    onDone();
+  }
+}
+
+void ForwardingConnPoolImpl::LocalStream::onDone() {
+  ASSERT(pool_);
+  ForwardingConnPoolImpl* pool = pool_;
+  pool_ = nullptr;
+  pool->onStreamDone(*this);
+}
+
+void ForwardingConnPoolImpl::RemoteStream::start(const PoolGetter& owner_pool) {
+  self_ = parent_.shared_from_this();
+  ConnectionPool::Instance* pool = owner_pool();
+  if (!pool) {
+    onPoolFailure(ConnectionPool::PoolFailureReason::ConnectionFailure, parent_.host_);
+    return;
+  }
+
+  // The pool may call back inline, in which case there is no handle.
+  ConnectionPool::Cancellable* handle = pool->newStream(*this, *this);
+  if (handle) {
+    handle_ = handle;
+  }
+}
+
+void ForwardingConnPoolImpl::RemoteStream::cancel() {
+  if (handle_) {
+    handle_->cancel();
+    handle_ = nullptr;
+    onDone();
+  } else {
+    // The stream became ready while the cancel was on its way.
+    resetStream(StreamResetReason::LocalReset);
+  }
+}
+
+void ForwardingConnPoolImpl::RemoteStream::encodeHeaders(const HeaderMap& headers,
+                                                         bool end_stream) {
+  if (!request_encoder_) {
+    return;
+  }
+
+  encode_complete_ = end_stream;
+  request_encoder_->encodeHeaders(headers, end_stream);
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::encodeData(Buffer::Instance& data, bool end_stream) {
+  if (!request_encoder_) {
+    return;
+  }
+
+  encode_complete_ = end_stream;
+  request_encoder_->encodeData(data, end_stream);
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::encodeTrailers(const HeaderMap& trailers) {
+  if (!request_encoder_) {
+    return;
+  }
+
+  encode_complete_ = true;
+  request_encoder_->encodeTrailers(trailers);
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::resetStream(StreamResetReason reason) {
+  if (!request_encoder_) {
+    return;
+  }
+
+  // Reset callbacks are not wanted for a reset that came from the other side.
+  Stream& stream = request_encoder_->getStream();
+  request_encoder_ = nullptr;
+  stream.removeCallbacks(*this);
+  stream.resetStream(reason);
+  onDone();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::readDisable(bool disable) {
+  if (request_encoder_) {
+    request_encoder_->getStream().readDisable(disable);
+  }
+}
+
+void ForwardingConnPoolImpl::RemoteStream::checkForComplete() {
+  if (request_encoder_ && encode_complete_ && decode_complete_) {
+    request_encoder_->getStream().removeCallbacks(*this);
+    request_encoder_ = nullptr;
+    onDone();
+  }
+}
+
+void ForwardingConnPoolImpl::RemoteStream::onDone() {
+  ASSERT(self_);
+  release(parent_.owner_dispatcher_, std::move(self_));
+}
+
+void ForwardingConnPoolImpl::RemoteStream::decodeHeaders(HeaderMapPtr&& headers,
+                                                         bool end_stream) {
+  // Wrapped so that the headers can travel in a copyable callback without being copied.
+  std::shared_ptr<HeaderMapPtr> moved(new HeaderMapPtr(std::move(headers)));
+  parent_.postLocal([moved, end_stream](LocalStream& local) -> void {
+    local.onDecodeHeaders(std::move(*moved), end_stream);
+  });
+  decode_complete_ = end_stream;
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::decodeData(Buffer::Instance& data, bool end_stream) {
+  std::shared_ptr<Buffer::OwnedImpl> buffer(new Buffer::OwnedImpl());
+  buffer->move(data);
+  parent_.postLocal([buffer, end_stream](LocalStream& local) -> void {
+    local.onDecodeData(*buffer, end_stream);
+  });
+  decode_complete_ = end_stream;
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::decodeTrailers(HeaderMapPtr&& trailers) {
+  std::shared_ptr<HeaderMapPtr> moved(new HeaderMapPtr(std::move(trailers)));
+  parent_.postLocal(
+      [moved](LocalStream& local) -> void { local.onDecodeTrailers(std::move(*moved)); });
+  decode_complete_ = true;
+  checkForComplete();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::onPoolFailure(
+    ConnectionPool::PoolFailureReason reason, Upstream::HostDescriptionConstSharedPtr host) {
+  handle_ = nullptr;
+  parent_.postLocal(
+      [reason, host](LocalStream& local) -> void { local.onPoolFailure(reason, host); });
+  onDone();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::onPoolReady(
+    StreamEncoder& request_encoder, Upstream::HostDescriptionConstSharedPtr host) {
+  handle_ = nullptr;
+  request_encoder_ = &request_encoder;
+  request_encoder.getStream().addCallbacks(*this);
+  parent_.postLocal([host](LocalStream& local) -> void { local.onPoolReady(host); });
+}
+
+void ForwardingConnPoolImpl::RemoteStream::onPoolConnectionTiming(
+    const ConnectionPool::ConnectionTiming& timing) {
+  parent_.postLocal(
+      [timing](LocalStream& local) -> void { local.onPoolConnectionTiming(timing); });
+}
+
+void ForwardingConnPoolImpl::RemoteStream::onResetStream(StreamResetReason reason) {
+  request_encoder_ = nullptr;
+  parent_.postLocal([reason](LocalStream& local) -> void { local.onResetStream(reason); });
+  onDone();
+}
+
+void ForwardingConnPoolImpl::RemoteStream::onAboveWriteBufferHighWatermark() {
+  parent_.postLocal([](LocalStream& local) -> void { local.onAboveWriteBufferHighWatermark(); });
+}
+
+void ForwardingConnPoolImpl::RemoteStream::onBelowWriteBufferLowWatermark() {
+  parent_.postLocal([](LocalStream& local) -> void { local.onBelowWriteBufferLowWatermark(); });
+}
+
+} // namespace Http
+} // namespace Envoy
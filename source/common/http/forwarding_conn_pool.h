@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/http/codec.h"
+#include "envoy/http/conn_pool.h"
+#include "envoy/upstream/upstream.h"
+
+#include "common/common/assert.h"
+#include "common/common/logger.h"
+#include "common/http/codec_helper.h"
+
+namespace Envoy {
+namespace Http {
+
+/**
+ * A connection pool that owns no connections. Every stream is handed over to the pool for the same
+ * host on another worker (the owner), and all stream events are posted back and forth between the
+ * two dispatchers. This lets the workers share one set of upstream connections per host.
+ *
+ * Each stream has a half on each side. The local half is what the caller sees: the cancellable
+ * handle, the request encoder and the stream. The remote half is the caller of the owner's pool.
+ * Either half only ever runs on its own worker, and a stream lives until neither worker holds it.
+ */
+class ForwardingConnPoolImpl : Logger::Loggable<Logger::Id::pool>,
+                               public ConnectionPool::Instance {
+public:
+  /**
+   * Returns the pool of the owner for the host, or nullptr if the owner no longer has one, for
+   * example because the host has been removed from the cluster there already. Only ever called on
+   * the owner.
+   */
+  typedef std::function<ConnectionPool::Instance*()> PoolGetter;
+
+  ForwardingConnPoolImpl(Event::Dispatcher& dispatcher, Event::Dispatcher& owner_dispatcher,
+                         Upstream::HostConstSharedPtr host, PoolGetter owner_pool);
+  ~ForwardingConnPoolImpl();
+
+  // Http::ConnectionPool::Instance
+  void addDrainedCallback(DrainedCb cb) override;
+  ConnectionPool::Cancellable* newStream(StreamDecoder& response_decoder,
+                                         ConnectionPool::Callbacks& callbacks) override;
+  void prefetchConnections() override;
+
+private:
+  struct ForwardedStream;
+  typedef std::shared_ptr<ForwardedStream> ForwardedStreamSharedPtr;
+
+  struct LocalStream : public ConnectionPool::Cancellable,
+                       public StreamEncoder,
+                       public Stream,
+                       public StreamCallbackHelper {
+    LocalStream(ForwardedStream& parent, StreamDecoder& response_decoder,
+                ConnectionPool::Callbacks& callbacks)
+        : parent_(parent), response_decoder_(response_decoder), callbacks_(callbacks) {}
+
+    void onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                       Upstream::HostDescriptionConstSharedPtr host);
+    void onPoolReady(Upstream::HostDescriptionConstSharedPtr host);
+    void onPoolConnectionTiming(const ConnectionPool::ConnectionTiming& timing);
+    void onDecodeHeaders(HeaderMapPtr&& headers, bool end_stream);
+    void onDecodeData(Buffer::Instance& data, bool end_stream);
+    void onDecodeTrailers(HeaderMapPtr&& trailers);
+    void onResetStream(StreamResetReason reason);
+    void onAboveWriteBufferHighWatermark();
+    void onBelowWriteBufferLowWatermark();
+    void checkForComplete();
+    void onDone();
+
+    // ConnectionPool::Cancellable
+    void cancel() override;
+
+    // Http::StreamEncoder
+    void encodeHeaders(const HeaderMap& headers, bool end_stream) override;
+    void encodeData(Buffer::Instance& data, bool end_stream) override;
+    void encodeTrailers(const HeaderMap& trailers) override;
+    Stream& getStream() override { return *this; }
+
+    // Http::Stream
+    void addCallbacks(StreamCallbacks& callbacks) override { addCallbacks_(callbacks); }
+    void removeCallbacks(StreamCallbacks& callbacks) override { removeCallbacks_(callbacks); }
+    void resetStream(StreamResetReason reason) override;
+    void readDisable(bool disable) override;
+
+    ForwardedStream& parent_;
+    StreamDecoder& response_decoder_;
+    ConnectionPool::Callbacks& callbacks_;
+    // The pool while the stream is in it. Nothing reaches the caller once the stream is done.
+    ForwardingConnPoolImpl* pool_{};
+    std::list<ForwardedStreamSharedPtr>::iterator pool_entry_;
+    bool ready_{};
+    bool encode_complete_{};
+    bool decode_complete_{};
+  };
+
+  struct RemoteStream : public StreamDecoder,
+                        public ConnectionPool::Callbacks,
+                        public StreamCallbacks {
+    RemoteStream(ForwardedStream& parent) : parent_(parent) {}
+
+    void start(const PoolGetter& owner_pool);
+    void cancel();
+    void encodeHeaders(const HeaderMap& headers, bool end_stream);
+    void encodeData(Buffer::Instance& data, bool end_stream);
+    void encodeTrailers(const HeaderMap& trailers);
+    void resetStream(StreamResetReason reason);
+    void readDisable(bool disable);
+    void checkForComplete();
+    void onDone();
+
+    // Http::StreamDecoder
+    void decodeHeaders(HeaderMapPtr&& headers, bool end_stream) override;
+    void decodeData(Buffer::Instance& data, bool end_stream) override;
+    void decodeTrailers(HeaderMapPtr&& trailers) override;
+
+    // Http::ConnectionPool::Callbacks
+    void onPoolFailure(ConnectionPool::PoolFailureReason reason,
+                       Upstream::HostDescriptionConstSharedPtr host) override;
+    void onPoolReady(StreamEncoder& request_encoder,
+                     Upstream::HostDescriptionConstSharedPtr host) override;
+    void onPoolConnectionTiming(const ConnectionPool::ConnectionTiming& timing) override;
+
+    // Http::StreamCallbacks
+    void onResetStream(StreamResetReason reason) override;
+    void onAboveWriteBufferHighWatermark() override;
+    void onBelowWriteBufferLowWatermark() override;
+
+    ForwardedStream& parent_;
+    // Keeps the stream alive on the owner while it is in the owner's pool.
+    ForwardedStreamSharedPtr self_;
+    ConnectionPool::Cancellable* handle_{};
+    StreamEncoder* request_encoder_{};
+    bool encode_complete_{};
+    bool decode_complete_{};
+  };
+
+  struct ForwardedStream : public std::enable_shared_from_this<ForwardedStream> {
+    ForwardedStream(ForwardingConnPoolImpl& pool, StreamDecoder& response_decoder,
+                    ConnectionPool::Callbacks& callbacks);
+
+    /**
+     * Run a callback on the owner.
+     */
+    void postRemote(std::function<void(RemoteStream&)> cb);
+
+    /**
+     * Run a callback on the worker the stream was created on.
+     */
+    void postLocal(std::function<void(LocalStream&)> cb);
+
+    Event::Dispatcher& dispatcher_;
+    Event::Dispatcher& owner_dispatcher_;
+    const Upstream::HostConstSharedPtr host_;
+    LocalStream local_;
+    RemoteStream remote_;
+  };
+
+  /**
+   * Holds a reference to a stream until the dispatcher gets to deferred deletion, so that a stream
+   * is never freed from within one of its own calls.
+   */
+  struct StreamReleaser : public Event::DeferredDeletable {
+    StreamReleaser(ForwardedStreamSharedPtr&& stream) : stream_(std::move(stream)) {}
+
+    ForwardedStreamSharedPtr stream_;
+  };
+
+  static void release(Event::Dispatcher& dispatcher, ForwardedStreamSharedPtr&& stream);
+  void checkForDrained();
+  void onStreamDone(LocalStream& stream);
+
+  Event::Dispatcher& dispatcher_;
+  Event::Dispatcher& owner_dispatcher_;
+  Upstream::HostConstSharedPtr host_;
+  PoolGetter owner_pool_;
+  std::list<ForwardedStreamSharedPtr> streams_;
+  std::list<DrainedCb> drained_callbacks_;
+};
+
+} // namespace Http
+} // namespace Envoy
@@ -1,7 +1,8 @@
 #include "common/http/header_map_impl.h"
 
+#include <algorithm>
 #include <cstdint>
-#include <list>
+#include <new>
 #include <string>
 
 #include "common/common/assert.h"
@@ -210,7 +211,7 @@ void HeaderMapImpl::HeaderEntryImpl::value(const HeaderEntry& header) {
 }
 
 #define INLINE_HEADER_STATIC_MAP_ENTRY(name)                                                       \
-  add(Headers::get().name.get().c_str(), [](HeaderMapImpl& h) -> StaticLookupResponse {            \
+  add(Headers::get().name.get(), [](HeaderMapImpl& h) -> StaticLookupResponse {                    \
     return {&h.inline_headers_.name##_, &Headers::get().name};                                     \
   });
 
@@ -218,57 +219,121 @@ HeaderMapImpl::StaticLookupTable::StaticLookupTable() {
   ALL_INLINE_HEADERS(INLINE_HEADER_STATIC_MAP_ENTRY)
 
   // Special case where we map a legacy host header to :authority.
-  add(Headers::get().HostLegacy.get().c_str(), [](HeaderMapImpl& h) -> StaticLookupResponse {
+  add(Headers::get().HostLegacy.get(), [](HeaderMapImpl& h) -> StaticLookupResponse {
     return {&h.inline_headers_.Host_, &Headers::get().Host};
   });
-}
 
-void HeaderMapImpl::StaticLookupTable::add(const char* key, StaticLookupEntry::EntryCb cb) {
-  StaticLookupEntry* current = &root_;
-  while (uint8_t c = *key) {
-    if (!current->entries_[c]) {
-      current->entries_[c].reset(new StaticLookupEntry());
+  // For every length, pick the position where the keys have the most distinct characters. This
+  // almost always tells all of them apart. Keys that share the character are still told apart by
+  // the memcmp() in find(), at the cost of an extra compare.
+  for (size_t size = 0; size < buckets_.size(); size++) {
+    Bucket& bucket = buckets_[size];
+    size_t best_distinct = 0;
+    for (size_t position = 0; position < size; position++) {
+      std::array<bool, 256> seen{};
+      size_t distinct = 0;
+      for (const StaticLookupEntry& entry : bucket.entries_) {
+        bool& seen_char = seen[static_cast<uint8_t>(entry.key_[position])];
+        distinct += !seen_char;
+        seen_char = true;
+      }
+      if (distinct > best_distinct) {
+        best_distinct = distinct;
+        bucket.position_ = position;
+      }
     }
 
-    current = current->entries_[c].get();
-    key++;
+    for (StaticLookupEntry& entry : bucket.entries_) {
+      entry.discriminator_ = entry.key_[bucket.position_];
+    }
+  }
+}
+
+void HeaderMapImpl::StaticLookupTable::add(const std::string& key, StaticLookupEntry::EntryCb cb) {
+  ASSERT(!key.empty());
+  if (buckets_.size() <= key.size()) {
+    buckets_.resize(key.size() + 1);
   }
 
-  current->cb_ = cb;
+  StaticLookupEntry entry;
+  entry.key_ = key;
+  entry.cb_ = cb;
+  buckets_[key.size()].entries_.push_back(std::move(entry));
 }
 
 HeaderMapImpl::StaticLookupEntry::EntryCb
-HeaderMapImpl::StaticLookupTable::find(const char* key) const {
-  const StaticLookupEntry* current = &root_;
-  while (uint8_t c = *key) {
-    current = current->entries_[c].get();
-    if (current) {
-      key++;
-    } else {
-      return nullptr;
+HeaderMapImpl::StaticLookupTable::find(const char* key, size_t size) const {
+  if (size >= buckets_.size()) {
+    return nullptr;
+  }
+
+  const Bucket& bucket = buckets_[size];
+  for (const StaticLookupEntry& entry : bucket.entries_) {
+    if (key[bucket.position_] == entry.discriminator_ &&
+        memcmp(key, entry.key_.data(), size) == 0) {
+      return entry.cb_;
     }
   }
 
-  return current->cb_;
+  return nullptr;
+}
+
+const uint32_t HeaderMapImpl::MIN_BLOCK_ENTRIES;
+
+template <class... Args>
+HeaderMapImpl::HeaderEntryImpl& HeaderMapImpl::appendEntry(Args&&... args) {
+  HeaderEntryImpl* entry = new (allocateSlot()) HeaderEntryImpl(std::forward<Args>(args)...);
+  entry->prev_ = tail_;
+  if (tail_) {
+    tail_->next_ = entry;
+  } else {
+    head_ = entry;
+  }
+  tail_ = entry;
+  size_++;
+  return *entry;
 }
 
 HeaderMapImpl::HeaderMapImpl() { memset(&inline_headers_, 0, sizeof(inline_headers_)); }
 
 HeaderMapImpl::HeaderMapImpl(const HeaderMap& rhs) : HeaderMapImpl() {
+  reserve(rhs.size());
   rhs.iterate(
       [](const HeaderEntry& header, void* context) -> void {
-        // TODO(mattklein123) PERF: Avoid copying here is not necessary.
-        HeaderString key_string;
-        key_string.setCopy(header.key().c_str(), header.key().size());
-        HeaderString value_string;
-        value_string.setCopy(header.value().c_str(), header.value().size());
-
-        static_cast<HeaderMapImpl*>(context)->addViaMove(std::move(key_string),
-                                                         std::move(value_string));
+        HeaderMapImpl& map = *static_cast<HeaderMapImpl*>(context);
+        StaticLookupEntry::EntryCb cb = ConstSingleton<StaticLookupTable>::get().find(
+            header.key().c_str(), header.key().size());
+        if (cb) {
+          // Inline keys can reference the static header names instead of being copied.
+          StaticLookupResponse ref_lookup_response = cb(map);
+          if (!*ref_lookup_response.entry_) {
+            HeaderEntryImpl& entry = map.appendEntry(*ref_lookup_response.key_);
+            entry.value(header);
+            *ref_lookup_response.entry_ = &entry;
+          }
+        } else {
+          HeaderEntryImpl& entry = map.appendEntry();
+          entry.key_.setCopy(header.key().c_str(), header.key().size());
+          entry.value(header);
+        }
       },
       this);
 }
 
+HeaderMapImpl::~HeaderMapImpl() {
+  for (HeaderEntryImpl* entry = head_; entry != nullptr;) {
+    HeaderEntryImpl* next = entry->next_;
+    entry->~HeaderEntryImpl();
+    entry = next;
+  }
+
+  while (blocks_) {
+    EntryBlock* next = blocks_->next_;
+    ::operator delete(blocks_);
+    blocks_ = next;
+  }
+}
+
 HeaderMapImpl::HeaderMapImpl(
     const std::initializer_list<std::pair<LowerCaseString, std::string>>& values)
     : HeaderMapImpl() {
@@ -286,7 +351,7 @@ bool HeaderMapImpl::operator==(const HeaderMapImpl& rhs) const {
     return false;
   }
 
-  for (auto i = headers_.begin(), j = rhs.headers_.begin(); i != headers_.end(); ++i, ++j) {
+  for (const HeaderEntryImpl *i = head_, *j = rhs.head_; i != nullptr; i = i->next_, j = j->next_) {
     if (i->key() != j->key().c_str() || i->value() != j->value().c_str()) {
       return false;
     }
@@ -296,7 +361,8 @@ bool HeaderMapImpl::operator==(const HeaderMapImpl& rhs) const {
 }
 
 void HeaderMapImpl::insertByKey(HeaderString&& key, HeaderString&& value) {
-  StaticLookupEntry::EntryCb cb = ConstSingleton<StaticLookupTable>::get().find(key.c_str());
+  StaticLookupEntry::EntryCb cb =
+      ConstSingleton<StaticLookupTable>::get().find(key.c_str(), key.size());
   if (cb) {
     // TODO(mattklein123): Currently, for all of the inline headers, we don't support appending. The
     // only inline header where we should be converting multiple headers into a comma delimited
@@ -307,9 +373,7 @@ void HeaderMapImpl::insertByKey(HeaderString&& key, HeaderString&& value) {
     StaticLookupResponse ref_lookup_response = cb(*this);
     maybeCreateInline(ref_lookup_response.entry_, *ref_lookup_response.key_, std::move(value));
   } else {
-    std::list<HeaderEntryImpl>::iterator i =
-        headers_.emplace(headers_.end(), std::move(key), std::move(value));
-    i->entry_ = i;
+    appendEntry(std::move(key), std::move(value));
   }
 }
 
@@ -361,18 +425,18 @@ void HeaderMapImpl::addCopy(const LowerCaseString& key, const std::string& value
 
 uint64_t HeaderMapImpl::byteSize() const {
   uint64_t byte_size = 0;
-  for (const HeaderEntryImpl& header : headers_) {
-    byte_size += header.key().size();
-    byte_size += header.value().size();
+  for (const HeaderEntryImpl* header = head_; header != nullptr; header = header->next_) {
+    byte_size += header->key().size();
+    byte_size += header->value().size();
   }
 
   return byte_size;
 }
 
 const HeaderEntry* HeaderMapImpl::get(const LowerCaseString& key) const {
-  for (const HeaderEntryImpl& header : headers_) {
-    if (header.key() == key.get().c_str()) {
-      return &header;
+  for (const HeaderEntryImpl* header = head_; header != nullptr; header = header->next_) {
+    if (header->key() == key.get().c_str()) {
+      return header;
     }
   }
 
@@ -380,36 +444,66 @@ const HeaderEntry* HeaderMapImpl::get(const LowerCaseString& key) const {
 }
 
 void HeaderMapImpl::iterate(ConstIterateCb cb, void* context) const {
-  for (const HeaderEntryImpl& header : headers_) {
-    cb(header, context);
+  for (const HeaderEntryImpl* header = head_; header != nullptr; header = header->next_) {
+    cb(*header, context);
   }
 }
 
 void HeaderMapImpl::remove(const LowerCaseString& key) {
-  StaticLookupEntry::EntryCb cb = ConstSingleton<StaticLookupTable>::get().find(key.get().c_str());
+  StaticLookupEntry::EntryCb cb =
+      ConstSingleton<StaticLookupTable>::get().find(key.get().c_str(), key.get().size());
   if (cb) {
     StaticLookupResponse ref_lookup_response = cb(*this);
     removeInline(ref_lookup_response.entry_);
   } else {
-    for (auto i = headers_.begin(); i != headers_.end();) {
-      if (i->key() == key.get().c_str()) {
-        i = headers_.erase(i);
-      } else {
-        ++i;
+    for (HeaderEntryImpl* entry = head_; entry != nullptr;) {
+      HeaderEntryImpl* next = entry->next_;
+      if (entry->key() == key.get().c_str()) {
+        removeEntry(*entry);
       }
+      entry = next;
     }
   }
 }
 
+void HeaderMapImpl::removeKeys(const std::list<LowerCaseString>& keys) {
+  // O(1) headers are removed through their inline slots. Any other key takes a pass over the map,
+  // which is shared by all of them. Removed O(1) headers can no longer match in that pass.
+  bool other_keys = false;
+  for (const LowerCaseString& key : keys) {
+    StaticLookupEntry::EntryCb cb =
+        ConstSingleton<StaticLookupTable>::get().find(key.get().c_str(), key.get().size());
+    if (cb) {
+      removeInline(cb(*this).entry_);
+    } else {
+      other_keys = true;
+    }
+  }
+
+  if (!other_keys) {
+    return;
+  }
+
+  for (HeaderEntryImpl* entry = head_; entry != nullptr;) {
+    HeaderEntryImpl* next = entry->next_;
+    for (const LowerCaseString& key : keys) {
+      if (entry->key().size() == key.get().size() &&
+          memcmp(entry->key().c_str(), key.get().c_str(), key.get().size()) == 0) {
+        removeEntry(*entry);
+        break;
+      }
+    }
+    entry = next;
+  }
+}
+
 HeaderMapImpl::HeaderEntryImpl& HeaderMapImpl::maybeCreateInline(HeaderEntryImpl** entry,
                                                                  const LowerCaseString& key) {
   if (*entry) {
     return **entry;
   }
 
-  std::list<HeaderEntryImpl>::iterator i = headers_.emplace(headers_.end(), key);
-  i->entry_ = i;
-  *entry = &(*i);
+  *entry = &appendEntry(key);
   return **entry;
 }
 
@@ -421,9 +515,7 @@ HeaderMapImpl::HeaderEntryImpl& HeaderMapImpl::maybeCreateInline(HeaderEntryImpl
     return **entry;
   }
 
-  std::list<HeaderEntryImpl>::iterator i = headers_.emplace(headers_.end(), key, std::move(value));
-  i->entry_ = i;
-  *entry = &(*i);
+  *entry = &appendEntry(key, std::move(value));
   return **entry;
 }
 
@@ -434,7 +526,56 @@ void HeaderMapImpl::removeInline(HeaderEntryImpl** ptr_to_entry) {
 
   HeaderEntryImpl* entry = *ptr_to_entry;
   *ptr_to_entry = nullptr;
-  headers_.erase(entry->entry_);
+  removeEntry(*entry);
+}
+
+void HeaderMapImpl::removeEntry(HeaderEntryImpl& entry) {
+  if (entry.prev_) {
+    entry.prev_->next_ = entry.next_;
+  } else {
+    head_ = entry.next_;
+  }
+  if (entry.next_) {
+    entry.next_->prev_ = entry.prev_;
+  } else {
+    tail_ = entry.prev_;
+  }
+  size_--;
+
+  entry.~HeaderEntryImpl();
+  free_slots_ = new (&entry) FreeSlot{free_slots_};
+}
+
+void* HeaderMapImpl::allocateSlot() {
+  if (free_slots_) {
+    FreeSlot* slot = free_slots_;
+    free_slots_ = slot->next_;
+    return slot;
+  }
+
+  if (!blocks_ || blocks_->used_ == blocks_->capacity_) {
+    addBlock(std::max<uint32_t>(MIN_BLOCK_ENTRIES, size_));
+  }
+
+  static_assert(sizeof(EntryBlock) % alignof(HeaderEntryImpl) == 0,
+                "entries following a block must be aligned");
+  static_assert(sizeof(FreeSlot) <= sizeof(HeaderEntryImpl), "free slots must fit in an entry");
+  return reinterpret_cast<HeaderEntryImpl*>(blocks_ + 1) + blocks_->used_++;
+}
+
+void HeaderMapImpl::addBlock(uint32_t capacity) {
+  EntryBlock* block = static_cast<EntryBlock*>(
+      ::operator new(sizeof(EntryBlock) + capacity * sizeof(HeaderEntryImpl)));
+  block->next_ = blocks_;
+  block->capacity_ = capacity;
+  block->used_ = 0;
+  blocks_ = block;
+}
+
+void HeaderMapImpl::reserve(uint32_t entries) {
+  if (!blocks_ || blocks_->capacity_ - blocks_->used_ < entries) {
+    addBlock(std::max(MIN_BLOCK_ENTRIES, entries));
+  }
 }
 
 } // namespace Http
@@ -5,6 +5,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "envoy/http/header_map.h"
 
@@ -34,12 +35,20 @@ public:
  * If it is, we store a reference to it that can be accessed later directly. Most high performance
  * paths use O(1) direct access. In general, we try to copy as little as possible and allocate as
  * little as possible in any of the paths.
+ *
+ * Entries are carved out of a few blocks owned by the map instead of being allocated one at a time,
+ * so building a typical request costs a couple of allocations and copying a map costs one. Entries
+ * never move once created, which keeps the O(1) header pointers and anything returned by get()
+ * valid until the entry itself is removed.
  */
 class HeaderMapImpl : public HeaderMap {
 public:
   HeaderMapImpl();
   HeaderMapImpl(const std::initializer_list<std::pair<LowerCaseString, std::string>>& values);
   HeaderMapImpl(const HeaderMap& rhs);
+  HeaderMapImpl(const HeaderMapImpl& rhs) : HeaderMapImpl(static_cast<const HeaderMap&>(rhs)) {}
+  HeaderMapImpl& operator=(const HeaderMapImpl&) = delete;
+  ~HeaderMapImpl();
 
   /**
    * Add a header via full move. This is the expected high performance paths for codecs populating
@@ -64,10 +73,12 @@ public:
   const HeaderEntry* get(const LowerCaseString& key) const override;
   void iterate(ConstIterateCb cb, void* context) const override;
   void remove(const LowerCaseString& key) override;
-  size_t size() const override { return headers_.size(); }
+  void removeKeys(const std::list<LowerCaseString>& keys) override;
+  size_t size() const override { return size_; }
 
 protected:
   struct HeaderEntryImpl : public HeaderEntry, NonCopyable {
+    HeaderEntryImpl() {}
     HeaderEntryImpl(const LowerCaseString& key);
     HeaderEntryImpl(const LowerCaseString& key, HeaderString&& value);
     HeaderEntryImpl(HeaderString&& key, HeaderString&& value);
@@ -83,9 +94,32 @@ protected:
 
     HeaderString key_;
     HeaderString value_;
-    std::list<HeaderEntryImpl>::iterator entry_;
+    // Neighbours in insertion order.
+    HeaderEntryImpl* prev_{};
+    HeaderEntryImpl* next_{};
   };
 
+  /**
+   * Storage for entries, followed in memory by room for capacity_ of them. Slots are handed out in
+   * order and never given back to the allocator until the map is destroyed.
+   */
+  struct EntryBlock {
+    EntryBlock* next_;
+    uint32_t capacity_;
+    uint32_t used_;
+  };
+
+  /**
+   * Overlaid on the slot of a removed entry so that the slot can be reused.
+   */
+  struct FreeSlot {
+    FreeSlot* next_;
+  };
+
+  // The smallest number of entries a block is created with. Later blocks are at least as large as
+  // the map, so the number of blocks grows logarithmically with the number of headers.
+  static const uint32_t MIN_BLOCK_ENTRIES = 8;
+
   struct StaticLookupResponse {
     HeaderEntryImpl** entry_;
     const LowerCaseString* key_;
@@ -94,20 +128,30 @@ protected:
   struct StaticLookupEntry {
     typedef StaticLookupResponse (*EntryCb)(HeaderMapImpl&);
 
+    std::string key_;
+    // The character of key_ at the position that tells apart the keys of the same length.
+    char discriminator_{};
     EntryCb cb_{};
-    std::array<std::unique_ptr<StaticLookupEntry>, 256> entries_;
   };
 
   /**
    * This is the static lookup table that is used to determine whether a header is one of the O(1)
-   * headers. This uses a trie for lookup time at most equal to the size of the incoming string.
+   * headers. Keys are bucketed by length, and the keys of each length are told apart by the
+   * character at a position picked when the table is built. A lookup is an index by length, a scan
+   * over a handful of entries comparing a single character, and one memcmp() to confirm the match.
    */
   struct StaticLookupTable {
+    struct Bucket {
+      size_t position_{};
+      std::vector<StaticLookupEntry> entries_;
+    };
+
     StaticLookupTable();
-    void add(const char* key, StaticLookupEntry::EntryCb cb);
-    StaticLookupEntry::EntryCb find(const char* key) const;
+    void add(const std::string& key, StaticLookupEntry::EntryCb cb);
+    StaticLookupEntry::EntryCb find(const char* key, size_t size) const;
 
-    StaticLookupEntry root_;
+    // Indexed by key length.
+    std::vector<Bucket> buckets_;
   };
 
   struct AllInlineHeaders {
@@ -119,9 +163,25 @@ protected:
   HeaderEntryImpl& maybeCreateInline(HeaderEntryImpl** entry, const LowerCaseString& key,
                                      HeaderString&& value);
   void removeInline(HeaderEntryImpl** entry);
+  template <class... Args> HeaderEntryImpl& appendEntry(Args&&... args);
+  void removeEntry(HeaderEntryImpl& entry);
+  void* allocateSlot();
+  void addBlock(uint32_t capacity);
+
+  /**
+   * Make sure that at least the given number of entries can be added without allocating. Any room
+   * left in the current block is given up if it is too small, so this is meant for maps that are
+   * about to be filled in one go.
+   */
+  void reserve(uint32_t entries);
 
   AllInlineHeaders inline_headers_;
-  std::list<HeaderEntryImpl> headers_;
+  HeaderEntryImpl* head_{};
+  HeaderEntryImpl* tail_{};
+  size_t size_{};
+  // Most recently created block first.
+  EntryBlock* blocks_{};
+  FreeSlot* free_slots_{};
 
   ALL_INLINE_HEADERS(DEFINE_INLINE_HEADER_FUNCS)
 };
@@ -1,9 +1,12 @@
 #include "common/http/http1/codec_impl.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <string>
 
 #include "envoy/buffer/buffer.h"
+#include "envoy/event/dispatcher.h"
 #include "envoy/http/header_map.h"
 #include "envoy/network/connection.h"
 
@@ -22,10 +25,47 @@ namespace Http1 {
 const std::string StreamEncoderImpl::CRLF = "\r\n";
 const std::string StreamEncoderImpl::LAST_CHUNK = "0\r\n\r\n";
 
+bool StreamEncoderImpl::encodedKey(const HeaderEntry& header, const char*& key,
+                                   uint32_t& key_size) {
+  key = header.key().c_str();
+  key_size = header.key().size();
+  // Translate :authority -> host so that upper layers do not need to deal with this.
+  if (key_size > 1 && key[0] == ':' && key[1] == 'a') {
+    key = Headers::get().HostLegacy.get().c_str();
+    key_size = Headers::get().HostLegacy.get().size();
+  }
+
+  // Skip all headers starting with ':' that make it here.
+  return key[0] != ':';
+}
+
+uint64_t StreamEncoderImpl::headerBlockSize(const HeaderMap& headers, bool end_stream) {
+  uint64_t size = 0;
+  headers.iterate(
+      [](const HeaderEntry& header, void* context) -> void {
+        const char* key;
+        uint32_t key_size;
+        if (encodedKey(header, key, key_size)) {
+          *static_cast<uint64_t*>(context) += key_size + header.value().size() + 4;
+        }
+      },
+      &size);
+
+  if (!headers.ContentLength()) {
+    if (end_stream) {
+      size += Headers::get().ContentLength.get().size() + 5;
+    } else {
+      size += Headers::get().TransferEncoding.get().size() +
+              Headers::get().TransferEncodingValues.Chunked.size() + 4;
+    }
+  }
+
+  // The empty line that ends the head.
+  return size + 2;
+}
+
 void StreamEncoderImpl::encodeHeader(const char* key, uint32_t key_size, const char* value,
                                      uint32_t value_size) {
-
-  connection_.reserveBuffer(key_size + value_size + 4);
   ASSERT(key_size > 0);
 
   connection_.copyToBuffer(key, key_size);
@@ -36,25 +76,16 @@ void StreamEncoderImpl::encodeHeader(const char* key, uint32_t key_size, const c
   connection_.addCharToBuffer('\n');
 }
 
-void StreamEncoderImpl::encodeHeaders(const HeaderMap& headers, bool end_stream) {
+void StreamEncoderImpl::encodeHeaderBlock(const HeaderMap& headers, bool end_stream) {
   bool saw_content_length = false;
   headers.iterate(
       [](const HeaderEntry& header, void* context) -> void {
-        const char* key_to_use = header.key().c_str();
-        uint32_t key_size_to_use = header.key().size();
-        // Translate :authority -> host so that upper layers do not need to deal with this.
-        if (key_size_to_use > 1 && key_to_use[0] == ':' && key_to_use[1] == 'a') {
-          key_to_use = Headers::get().HostLegacy.get().c_str();
-          key_size_to_use = Headers::get().HostLegacy.get().size();
-        }
-
-        // Skip all headers starting with ':' that make it here.
-        if (key_to_use[0] == ':') {
-          return;
+        const char* key;
+        uint32_t key_size;
+        if (encodedKey(header, key, key_size)) {
+          static_cast<StreamEncoderImpl*>(context)->encodeHeader(
+              key, key_size, header.value().c_str(), header.value().size());
         }
-
-        static_cast<StreamEncoderImpl*>(context)->encodeHeader(
-            key_to_use, key_size_to_use, header.value().c_str(), header.value().size());
       },
       this);
 
@@ -83,7 +114,6 @@ void StreamEncoderImpl::encodeHeaders(const HeaderMap& headers, bool end_stream)
     }
   }
 
-  connection_.reserveBuffer(2);
   connection_.addCharToBuffer('\r');
   connection_.addCharToBuffer('\n');
 
@@ -95,18 +125,35 @@ void StreamEncoderImpl::encodeHeaders(const HeaderMap& headers, bool end_stream)
 }
 
 void StreamEncoderImpl::encodeData(Buffer::Instance& data, bool end_stream) {
-  // end_stream may be indicated with a zero length data buffer. If that is the case, so not
-  // atually write the zero length buffer out.
-  if (data.length() > 0) {
-    if (chunk_encoding_) {
-      connection_.buffer().add(fmt::format("{:x}\r\n", data.length()));
+  const uint32_t chunk_coalesce_bytes = connection_.chunkCoalesceBytes();
+  if (chunk_encoding_ && !end_stream && data.length() > 0 &&
+      data.length() < chunk_coalesce_bytes) {
+    // Hold small chunks back until the end of the event loop iteration. A zero timeout timer runs
+    // after the events that are already active, which bounds the added latency.
+    if (pending_chunks_.length() == 0) {
+      if (!pending_chunks_timer_) {
+        pending_chunks_timer_ = connection_.connection().dispatcher().createTimer([this]() -> void {
+          flushPendingChunks();
+          connection_.flushOutput();
+        });
+      }
+      pending_chunks_timer_->enableTimer(std::chrono::milliseconds(0));
     }
 
-    connection_.buffer().move(data);
-
-    if (chunk_encoding_) {
-      connection_.buffer().add(CRLF);
+    pending_chunks_.move(data);
+    if (pending_chunks_.length() >= chunk_coalesce_bytes) {
+      flushPendingChunks();
+      connection_.flushOutput();
     }
+    return;
+  }
+
+  flushPendingChunks();
+
+  // end_stream may be indicated with a zero length data buffer. If that is the case, so not
+  // atually write the zero length buffer out.
+  if (data.length() > 0) {
+    encodeBody(data);
   }
 
   if (end_stream) {
@@ -116,9 +163,31 @@ void StreamEncoderImpl::encodeData(Buffer::Instance& data, bool end_stream) {
   }
 }
 
+void StreamEncoderImpl::encodeBody(Buffer::Instance& data) {
+  if (chunk_encoding_) {
+    connection_.buffer().add(fmt::format("{:x}\r\n", data.length()));
+  }
+
+  connection_.buffer().move(data);
+
+  if (chunk_encoding_) {
+    connection_.buffer().add(CRLF);
+  }
+}
+
+void StreamEncoderImpl::flushPendingChunks() {
+  if (pending_chunks_.length() == 0) {
+    return;
+  }
+
+  pending_chunks_timer_->disableTimer();
+  encodeBody(pending_chunks_);
+}
+
 void StreamEncoderImpl::encodeTrailers(const HeaderMap&) { endEncode(); }
 
 void StreamEncoderImpl::endEncode() {
+  flushPendingChunks();
   if (chunk_encoding_) {
     connection_.buffer().add(LAST_CHUNK);
   }
@@ -174,6 +243,10 @@ void ConnectionImpl::reserveBuffer(uint64_t size) {
 }
 
 void StreamEncoderImpl::resetStream(StreamResetReason reason) {
+  if (pending_chunks_timer_) {
+    pending_chunks_timer_->disableTimer();
+  }
+  pending_chunks_.drain(pending_chunks_.length());
   connection_.onResetStreamBase(reason);
 }
 
@@ -181,23 +254,42 @@ void StreamEncoderImpl::readDisable(bool disable) { connection_.readDisable(disa
 
 static const char RESPONSE_PREFIX[] = "HTTP/1.1 ";
 
+std::string ResponseStreamEncoderImpl::formatStatusLine(uint64_t status) {
+  return fmt::format("{}{} {}\r\n", RESPONSE_PREFIX, status,
+                     CodeUtility::toString(static_cast<Code>(status)));
+}
+
+const std::string& ResponseStreamEncoderImpl::statusLine(uint64_t status) {
+  typedef std::array<std::string, MAX_CACHED_STATUS - MIN_CACHED_STATUS + 1> StatusLines;
+  static const StatusLines* status_lines = []() {
+    StatusLines* status_lines = new StatusLines();
+    for (uint64_t status = MIN_CACHED_STATUS; status <= MAX_CACHED_STATUS; status++) {
+      (*status_lines)[status - MIN_CACHED_STATUS] = formatStatusLine(status);
+    }
+    return status_lines;
+  }();
+
+  ASSERT(status >= MIN_CACHED_STATUS && status <= MAX_CACHED_STATUS);
+  return (*status_lines)[status - MIN_CACHED_STATUS];
+}
+
 void ResponseStreamEncoderImpl::encodeHeaders(const HeaderMap& headers, bool end_stream) {
   started_response_ = true;
   uint64_t numeric_status = Utility::getResponseStatus(headers);
 
-  connection_.reserveBuffer(4096);
-  connection_.copyToBuffer(RESPONSE_PREFIX, sizeof(RESPONSE_PREFIX) - 1);
-  connection_.addIntToBuffer(numeric_status);
-  connection_.addCharToBuffer(' ');
-
-  const char* status_string = CodeUtility::toString(static_cast<Code>(numeric_status));
-  uint32_t status_string_len = strlen(status_string);
-  connection_.copyToBuffer(status_string, status_string_len);
-
-  connection_.addCharToBuffer('\r');
-  connection_.addCharToBuffer('\n');
+  // Status lines are serialized ahead of time, except for codes outside of the standard range.
+  std::string uncached_status_line;
+  const std::string* status_line;
+  if (numeric_status >= MIN_CACHED_STATUS && numeric_status <= MAX_CACHED_STATUS) {
+    status_line = &statusLine(numeric_status);
+  } else {
+    uncached_status_line = formatStatusLine(numeric_status);
+    status_line = &uncached_status_line;
+  }
 
-  StreamEncoderImpl::encodeHeaders(headers, end_stream);
+  connection_.reserveBuffer(status_line->size() + headerBlockSize(headers, end_stream));
+  connection_.copyToBuffer(status_line->data(), status_line->size());
+  encodeHeaderBlock(headers, end_stream);
 }
 
 static const char REQUEST_POSTFIX[] = " HTTP/1.1\r\n";
@@ -213,13 +305,13 @@ void RequestStreamEncoderImpl::encodeHeaders(const HeaderMap& headers, bool end_
     head_request_ = true;
   }
 
-  connection_.reserveBuffer(std::max(4096U, path->value().size() + 4096));
+  connection_.reserveBuffer(method->value().size() + 1 + path->value().size() +
+                            sizeof(REQUEST_POSTFIX) - 1 + headerBlockSize(headers, end_stream));
   connection_.copyToBuffer(method->value().c_str(), method->value().size());
   connection_.addCharToBuffer(' ');
   connection_.copyToBuffer(path->value().c_str(), path->value().size());
   connection_.copyToBuffer(REQUEST_POSTFIX, sizeof(REQUEST_POSTFIX) - 1);
-
-  StreamEncoderImpl::encodeHeaders(headers, end_stream);
+  encodeHeaderBlock(headers, end_stream);
 }
 
 http_parser_settings ConnectionImpl::settings_{
@@ -244,11 +336,11 @@ http_parser_settings ConnectionImpl::settings_{
       return static_cast<ConnectionImpl*>(parser->data)->onHeadersCompleteBase();
     },
     [](http_parser* parser, const char* at, size_t length) -> int {
-      static_cast<ConnectionImpl*>(parser->data)->onBody(at, length);
+      static_cast<ConnectionImpl*>(parser->data)->onBodyBase(at, length);
       return 0;
     },
     [](http_parser* parser) -> int {
-      static_cast<ConnectionImpl*>(parser->data)->onMessageComplete();
+      static_cast<ConnectionImpl*>(parser->data)->onMessageCompleteBase();
       return 0;
     },
     nullptr, // on_chunk_header
@@ -260,10 +352,12 @@ const ToLowerTable& ConnectionImpl::toLowerTable() {
   return *table;
 }
 
-ConnectionImpl::ConnectionImpl(Network::Connection& connection, http_parser_type type)
+ConnectionImpl::ConnectionImpl(Network::Connection& connection, http_parser_type type,
+                               bool fast_head_parser, uint32_t chunk_coalesce_bytes)
     : connection_(connection), output_buffer_(Buffer::InstancePtr{new Buffer::OwnedImpl()},
                                               [&]() -> void { this->onBelowLowWatermark(); },
-                                              [&]() -> void { this->onAboveHighWatermark(); }) {
+                                              [&]() -> void { this->onAboveHighWatermark(); }),
+      fast_head_parser_(fast_head_parser), chunk_coalesce_bytes_(chunk_coalesce_bytes) {
   output_buffer_.setWatermarks(connection.bufferLimit());
   http_parser_init(&parser_, type);
   parser_.data = this;
@@ -300,25 +394,58 @@ void ConnectionImpl::dispatch(Buffer::Instance& data) {
   } else {
     dispatchSlice(nullptr, 0);
   }
+  flushBody();
 
   ENVOY_CONN_LOG(trace, "parsed {} bytes", connection_, total_parsed);
   data.drain(total_parsed);
 }
 
 size_t ConnectionImpl::dispatchSlice(const char* slice, size_t len) {
+  size_t head_size = 0;
+  if (fast_head_parser_ && at_message_start_ && HTTP_PARSER_ERRNO(&parser_) == HPE_OK) {
+    head_size = dispatchHead(slice, len);
+    if (head_size > 0) {
+      // http_parser stops at the end of the head when it pauses or the connection is upgraded,
+      // and so do we.
+      if (head_size == len || HTTP_PARSER_ERRNO(&parser_) == HPE_PAUSED || parser_.upgrade) {
+        return head_size;
+      }
+      slice += head_size;
+      len -= head_size;
+    }
+  }
+
   ssize_t rc = http_parser_execute(&parser_, &settings_, slice, len);
+  checkParserError();
+  return head_size + rc;
+}
+
+size_t ConnectionImpl::dispatchHead(const char* slice, size_t len) {
+  // Heads that http_parser would reject as too large are left to it so that it can do so.
+  const size_t head_size = head_parser_.parse(slice, std::min<size_t>(len, HTTP_MAX_HEADER_SIZE));
+  if (head_size == 0) {
+    return 0;
+  }
+
+  const std::string& framing_head = head_parser_.framingHead();
+  replaying_head_ = true;
+  http_parser_execute(&parser_, &settings_, framing_head.data(), framing_head.size());
+  replaying_head_ = false;
+  checkParserError();
+  return head_size;
+}
+
+void ConnectionImpl::checkParserError() {
   if (HTTP_PARSER_ERRNO(&parser_) != HPE_OK && HTTP_PARSER_ERRNO(&parser_) != HPE_PAUSED) {
     sendProtocolError();
     throw CodecProtocolException("http/1.1 protocol error: " +
                                  std::string(http_errno_name(HTTP_PARSER_ERRNO(&parser_))));
   }
-
-  return rc;
 }
 
 void ConnectionImpl::onHeaderField(const char* data, size_t length) {
-  if (header_parsing_state_ == HeaderParsingState::Done) {
-    // Ignore trailers.
+  if (header_parsing_state_ == HeaderParsingState::Done || replaying_head_) {
+    // Ignore trailers, and the framing headers of a head that has already been parsed.
     return;
   }
 
@@ -330,8 +457,8 @@ void ConnectionImpl::onHeaderField(const char* data, size_t length) {
 }
 
 void ConnectionImpl::onHeaderValue(const char* data, size_t length) {
-  if (header_parsing_state_ == HeaderParsingState::Done) {
-    // Ignore trailers.
+  if (header_parsing_state_ == HeaderParsingState::Done || replaying_head_) {
+    // Ignore trailers, and the framing headers of a head that has already been parsed.
     return;
   }
 
@@ -342,6 +469,19 @@ void ConnectionImpl::onHeaderValue(const char* data, size_t length) {
 int ConnectionImpl::onHeadersCompleteBase() {
   ENVOY_CONN_LOG(trace, "headers complete", connection_);
   completeLastHeader();
+  if (replaying_head_) {
+    replaying_head_ = false;
+    for (const HeadParser::Header& header : head_parser_.headers()) {
+      HeaderString key;
+      key.setCopy(header.name_, header.name_size_);
+      toLowerTable().toLowerCase(key.buffer(), key.size());
+      HeaderString value;
+      value.setCopy(header.value_, header.value_size_);
+      ENVOY_CONN_LOG(trace, "completed header: key={} value={}", connection_, key.c_str(),
+                     value.c_str());
+      current_header_map_->addViaMove(std::move(key), std::move(value));
+    }
+  }
   if (!(parser_.http_major == 1 && parser_.http_minor == 1)) {
     // This is not necessarily true, but it's good enough since higher layers only care if this is
     // HTTP/1.1 or not.
@@ -356,11 +496,29 @@ int ConnectionImpl::onHeadersCompleteBase() {
 
 void ConnectionImpl::onMessageBeginBase() {
   ASSERT(!current_header_map_);
+  at_message_start_ = false;
   current_header_map_.reset(new HeaderMapImpl());
   header_parsing_state_ = HeaderParsingState::Field;
   onMessageBegin();
 }
 
+void ConnectionImpl::onBodyBase(const char* data, size_t length) {
+  pending_body_.add(data, length);
+}
+
+void ConnectionImpl::flushBody() {
+  if (pending_body_.length() > 0) {
+    onBody(pending_body_);
+    pending_body_.drain(pending_body_.length());
+  }
+}
+
+void ConnectionImpl::onMessageCompleteBase() {
+  at_message_start_ = true;
+  flushBody();
+  onMessageComplete();
+}
+
 void ConnectionImpl::onResetStreamBase(StreamResetReason reason) {
   ASSERT(!reset_stream_called_);
   reset_stream_called_ = true;
@@ -370,7 +528,9 @@ void ConnectionImpl::onResetStreamBase(StreamResetReason reason) {
 ServerConnectionImpl::ServerConnectionImpl(Network::Connection& connection,
                                            ServerConnectionCallbacks& callbacks,
                                            Http1Settings settings)
-    : ConnectionImpl(connection, HTTP_REQUEST), callbacks_(callbacks), codec_settings_(settings) {}
+    : ConnectionImpl(connection, HTTP_REQUEST, settings.fast_head_parser_,
+                     settings.chunk_coalesce_bytes_),
+      callbacks_(callbacks), codec_settings_(settings) {}
 
 void ServerConnectionImpl::onEncodeComplete() {
   ASSERT(active_request_);
@@ -521,12 +681,11 @@ void ServerConnectionImpl::onUrl(const char* data, size_t length) {
   }
 }
 
-void ServerConnectionImpl::onBody(const char* data, size_t length) {
+void ServerConnectionImpl::onBody(Buffer::Instance& data) {
   ASSERT(!deferred_end_stream_headers_);
   if (active_request_) {
-    ENVOY_CONN_LOG(trace, "body size={}", connection_, length);
-    Buffer::OwnedImpl buffer(data, length);
-    active_request_->request_decoder_->decodeData(buffer, false);
+    ENVOY_CONN_LOG(trace, "body size={}", connection_, data.length());
+    active_request_->request_decoder_->decodeData(data, false);
   }
 }
 
@@ -583,7 +742,7 @@ void ServerConnectionImpl::onBelowLowWatermark() {
 }
 
 ClientConnectionImpl::ClientConnectionImpl(Network::Connection& connection, ConnectionCallbacks&)
-    : ConnectionImpl(connection, HTTP_RESPONSE) {}
+    : ConnectionImpl(connection, HTTP_RESPONSE, false, 0) {}
 
 bool ClientConnectionImpl::cannotHaveBody() {
   if ((!pending_responses_.empty() && pending_responses_.front().head_request_) ||
@@ -636,12 +795,10 @@ int ClientConnectionImpl::onHeadersComplete(HeaderMapImplPtr&& headers) {
   return cannotHaveBody() ? 1 : 0;
 }
 
-void ClientConnectionImpl::onBody(const char* data, size_t length) {
+void ClientConnectionImpl::onBody(Buffer::Instance& data) {
   ASSERT(!deferred_end_stream_headers_);
   if (!pending_responses_.empty()) {
-    Buffer::OwnedImpl buffer;
-    buffer.add(data, length);
-    pending_responses_.front().decoder_->decodeData(buffer, false);
+    pending_responses_.front().decoder_->decodeData(data, false);
   }
 }
 
@@ -6,15 +6,19 @@
 #include <memory>
 #include <string>
 
+#include "envoy/event/timer.h"
 #include "envoy/http/codec.h"
 #include "envoy/network/connection.h"
 
+#include "common/buffer/buffer_impl.h"
 #include "common/buffer/watermark_buffer.h"
 #include "common/common/assert.h"
+#include "common/common/recycler.h"
 #include "common/common/to_lower_table.h"
 #include "common/http/codec_helper.h"
 #include "common/http/codes.h"
 #include "common/http/header_map_impl.h"
+#include "common/http/http1/head_parser.h"
 
 #include "http_parser.h"
 
@@ -33,7 +37,6 @@ class StreamEncoderImpl : public StreamEncoder,
                           public StreamCallbackHelper {
 public:
   // Http::StreamEncoder
-  void encodeHeaders(const HeaderMap& headers, bool end_stream) override;
   void encodeData(Buffer::Instance& data, bool end_stream) override;
   void encodeTrailers(const HeaderMap& trailers) override;
   Stream& getStream() override { return *this; }
@@ -47,6 +50,22 @@ public:
 protected:
   StreamEncoderImpl(ConnectionImpl& connection) : connection_(connection) {}
 
+  /**
+   * @param headers supplies the headers to encode.
+   * @param end_stream supplies whether the head ends the stream.
+   * @return uint64_t the exact number of bytes encodeHeaderBlock() writes for the headers.
+   */
+  static uint64_t headerBlockSize(const HeaderMap& headers, bool end_stream);
+
+  /**
+   * Encode the headers that follow the start line, and the empty line that ends the head. The
+   * caller reserves room for the whole head up front with ConnectionImpl::reserveBuffer(), so that
+   * the head is written into a single slice without further checks.
+   * @param headers supplies the headers to encode.
+   * @param end_stream supplies whether the head ends the stream.
+   */
+  void encodeHeaderBlock(const HeaderMap& headers, bool end_stream);
+
   static const std::string CRLF;
   static const std::string LAST_CHUNK;
 
@@ -54,7 +73,16 @@ protected:
 
 private:
   /**
-   * Called to encode an individual header.
+   * @param header supplies a header to encode.
+   * @param key supplies the key to write on the wire, which differs from the key of the header
+   *        for :authority.
+   * @param key_size supplies the byte size of the key.
+   * @return bool whether the header is written on the wire at all.
+   */
+  static bool encodedKey(const HeaderEntry& header, const char*& key, uint32_t& key_size);
+
+  /**
+   * Called to encode an individual header into the current reservation.
    * @param key supplies the header to encode.
    * @param key_size supplies the byte size of the key.
    * @param value supplies the value to encode.
@@ -62,12 +90,27 @@ private:
    */
   void encodeHeader(const char* key, uint32_t key_size, const char* value, uint32_t value_size);
 
+  /**
+   * Write body data as one chunk, or as is without chunk encoding.
+   * @param data supplies the data, which is moved to the connection's output buffer.
+   */
+  void encodeBody(Buffer::Instance& data);
+
+  /**
+   * Write the body data held back by encodeData() as one chunk.
+   */
+  void flushPendingChunks();
+
   /**
    * Called to finalize a stream encode.
    */
   void endEncode();
 
   bool chunk_encoding_{true};
+  // Body data of small chunks that is written as one chunk at the end of the event loop iteration.
+  // @see Http1Settings::chunk_coalesce_bytes_.
+  Buffer::OwnedImpl pending_chunks_;
+  Event::TimerPtr pending_chunks_timer_;
 };
 
 /**
@@ -83,6 +126,20 @@ public:
   void encodeHeaders(const HeaderMap& headers, bool end_stream) override;
 
 private:
+  // The range of status codes whose status lines are serialized once and reused.
+  static const uint64_t MIN_CACHED_STATUS = 100;
+  static const uint64_t MAX_CACHED_STATUS = 599;
+
+  /**
+   * @return std::string the status line for a status code, including the CRLF that ends it.
+   */
+  static std::string formatStatusLine(uint64_t status);
+
+  /**
+   * @return const std::string& the cached status line for a status code in the cached range.
+   */
+  static const std::string& statusLine(uint64_t status);
+
   bool started_response_{};
 };
 
@@ -105,7 +162,9 @@ private:
 /**
  * Base class for HTTP/1.1 client and server connections.
  */
-class ConnectionImpl : public virtual Connection, protected Logger::Loggable<Logger::Id::http> {
+class ConnectionImpl : public virtual Connection,
+                       public Recycled,
+                       protected Logger::Loggable<Logger::Id::http> {
 public:
   /**
    * @return Network::Connection& the backing network connection.
@@ -147,9 +206,19 @@ public:
 
   void readDisable(bool disable) { connection_.readDisable(disable); }
   uint32_t bufferLimit() { return connection_.bufferLimit(); }
+  uint32_t chunkCoalesceBytes() { return chunk_coalesce_bytes_; }
 
 protected:
-  ConnectionImpl(Network::Connection& connection, http_parser_type type);
+  /**
+   * @param connection supplies the backing network connection.
+   * @param type supplies whether requests or responses are parsed.
+   * @param fast_head_parser supplies whether message heads that arrive in one piece are parsed by
+   *        HeadParser instead of being driven through http_parser byte by byte.
+   * @param chunk_coalesce_bytes supplies the size below which chunked body data is held back by
+   *        the encoders. @see Http1Settings::chunk_coalesce_bytes_.
+   */
+  ConnectionImpl(Network::Connection& connection, http_parser_type type, bool fast_head_parser,
+                 uint32_t chunk_coalesce_bytes);
 
   bool resetStreamCalled() { return reset_stream_called_; }
 
@@ -173,6 +242,20 @@ private:
    */
   size_t dispatchSlice(const char* slice, size_t len);
 
+  /**
+   * Try to parse a complete message head at the start of a span with head_parser_, and run just
+   * the framing part of it through http_parser.
+   * @param slice supplies the start address.
+   * @param len supplies the length of the span.
+   * @return size_t the size of the head if it was handled, or 0 if it is left to http_parser.
+   */
+  size_t dispatchHead(const char* slice, size_t len);
+
+  /**
+   * Throw if http_parser ran into an error, after sending a protocol error to remote.
+   */
+  void checkParserError();
+
   /**
    * Called when a request/response is beginning. A base routine happens first then a virtual
    * dispatch is invoked.
@@ -210,15 +293,25 @@ private:
   virtual int onHeadersComplete(HeaderMapImplPtr&& headers) PURE;
 
   /**
-   * Called when body data is received.
+   * Called when body data is received. The data is collected in pending_body_ and handed on in
+   * one piece before the message completes or dispatch() returns, so that a body that arrives in
+   * many small chunks is decoded once per read.
    * @param data supplies the start address.
    * @param length supplies the length.
    */
-  virtual void onBody(const char* data, size_t length) PURE;
+  void onBodyBase(const char* data, size_t length);
+  virtual void onBody(Buffer::Instance& data) PURE;
 
   /**
-   * Called when the request/response is complete.
+   * Hand the body data collected by onBodyBase() to onBody().
+   */
+  void flushBody();
+
+  /**
+   * Called when the request/response is complete. A base routine happens first then a virtual
+   * dispatch is invoked.
    */
+  void onMessageCompleteBase();
   virtual void onMessageComplete() PURE;
 
   /**
@@ -250,11 +343,20 @@ private:
   HeaderParsingState header_parsing_state_{HeaderParsingState::Field};
   HeaderString current_header_field_;
   HeaderString current_header_value_;
+  Buffer::OwnedImpl pending_body_;
   bool reset_stream_called_{};
   Buffer::WatermarkBuffer output_buffer_;
   Buffer::RawSlice reserved_iovec_;
   char* reserved_current_{};
   Protocol protocol_{Protocol::Http11};
+  const bool fast_head_parser_;
+  const uint32_t chunk_coalesce_bytes_;
+  HeadParser head_parser_;
+  // Whether the next byte starts a new message.
+  bool at_message_start_{true};
+  // Whether http_parser is running the framing head of a message parsed by head_parser_, whose
+  // headers are added when the head is complete instead of through the header callbacks.
+  bool replaying_head_{};
 };
 
 /**
@@ -293,7 +395,7 @@ private:
   void onMessageBegin() override;
   void onUrl(const char* data, size_t length) override;
   int onHeadersComplete(HeaderMapImplPtr&& headers) override;
-  void onBody(const char* data, size_t length) override;
+  void onBody(Buffer::Instance& data) override;
   void onMessageComplete() override;
   void onResetStream(StreamResetReason reason) override;
   void sendProtocolError() override;
@@ -314,6 +416,7 @@ public:
 
   // Http::ClientConnection
   StreamEncoder& newStream(StreamDecoder& response_decoder) override;
+  uint32_t maxConcurrentStreams() override { return 1; }
 
 private:
   struct PendingResponse {
@@ -330,7 +433,7 @@ private:
   void onMessageBegin() override {}
   void onUrl(const char*, size_t) override { NOT_IMPLEMENTED; }
   int onHeadersComplete(HeaderMapImplPtr&& headers) override;
-  void onBody(const char* data, size_t length) override;
+  void onBody(Buffer::Instance& data) override;
   void onMessageComplete() override;
   void onResetStream(StreamResetReason reason) override;
   void sendProtocolError() override {}
@@ -1,5 +1,7 @@
 #include "common/http/http1/conn_pool.h"
 
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <list>
 
@@ -42,6 +44,12 @@ void ConnPoolImpl::attachRequestToClient(ActiveClient& client, StreamDecoder& re
                                          ConnectionPool::Callbacks& callbacks) {
   ASSERT(!client.stream_wrapper_);
   client.stream_wrapper_.reset(new StreamWrapper(response_decoder, client));
+  num_attached_requests_++;
+  if (!client.connection_timing_reported_) {
+    // Only the request that waited for the connection to be established is told how long it took.
+    client.connection_timing_reported_ = true;
+    callbacks.onPoolConnectionTiming(client.codec_client_->connectionTiming());
+  }
   callbacks.onPoolReady(*client.stream_wrapper_, client.real_host_description_);
 }
 
@@ -66,9 +74,13 @@ void ConnPoolImpl::createNewConnection() {
 ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_decoder,
                                                      ConnectionPool::Callbacks& callbacks) {
   if (!ready_clients_.empty()) {
+    if (ready_clients_.front()->idle_timer_) {
+      ready_clients_.front()->idle_timer_->disableTimer();
+    }
     ready_clients_.front()->moveBetweenLists(ready_clients_, busy_clients_);
     ENVOY_CONN_LOG(debug, "using existing connection", *busy_clients_.front()->codec_client_);
     attachRequestToClient(*busy_clients_.front(), response_decoder, callbacks);
+    prefetchConnections();
     return nullptr;
   }
 
@@ -87,6 +99,7 @@ ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_dec
     ENVOY_LOG(debug, "queueing request due to no available connections");
     PendingRequestPtr pending_request(new PendingRequest(*this, response_decoder, callbacks));
     pending_request->moveIntoList(std::move(pending_request), pending_requests_);
+    prefetchConnections();
     return pending_requests_.front().get();
   } else {
     ENVOY_LOG(debug, "max pending requests overflow");
@@ -96,6 +109,25 @@ ConnectionPool::Cancellable* ConnPoolImpl::newStream(StreamDecoder& response_dec
   }
 }
 
+void ConnPoolImpl::prefetchConnections() {
+  if (!drained_callbacks_.empty()) {
+    // Anything opened now would be closed again as soon as it is ready.
+    return;
+  }
+
+  const uint64_t requests = num_attached_requests_ + pending_requests_.size();
+  const uint64_t wanted =
+      std::max<uint64_t>(host_->cluster().minWarmConnections(),
+                         std::ceil(requests * host_->cluster().prefetchRatio()));
+  uint64_t connections = ready_clients_.size() + busy_clients_.size();
+  while (connections < wanted &&
+         host_->cluster().resourceManager(priority_).connections().canCreate()) {
+    ENVOY_LOG(debug, "prefetching a connection");
+    createNewConnection();
+    connections++;
+  }
+}
+
 void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEvent event) {
   if (event == Network::ConnectionEvent::RemoteClose ||
       event == Network::ConnectionEvent::LocalClose) {
@@ -103,6 +135,7 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
     ENVOY_CONN_LOG(debug, "client disconnected", *client.codec_client_);
     ActiveClientPtr removed;
     bool check_for_drained = true;
+    bool connect_failure = false;
     if (client.stream_wrapper_) {
       if (!client.stream_wrapper_->decode_complete_) {
         if (event == Network::ConnectionEvent::LocalClose) {
@@ -118,6 +151,7 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
       // already have "reset" the stream to fire the reset callback. All we do here is just
       // destroy the client.
       removed = client.removeFromList(busy_clients_);
+      num_attached_requests_--;
     } else if (!client.connect_timer_) {
       // The connect timer is destroyed on connect. The lack of a connect timer means that this
       // client is idle and in the ready pool.
@@ -125,6 +159,7 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
       check_for_drained = false;
     } else {
       // The only time this happens is if we actually saw a connect failure.
+      connect_failure = true;
       host_->cluster().stats().upstream_cx_connect_fail_.inc();
       host_->stats().cx_connect_fail_.inc();
       removed = client.removeFromList(busy_clients_);
@@ -152,12 +187,20 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
       createNewConnection();
     }
 
+    // Replace a connection that the upstream closed. After a connect failure the host is likely to
+    // fail the next attempt as well, so that waits for the next request. Local closes are ours,
+    // including the ones from draining and destroying the pool.
+    if (event == Network::ConnectionEvent::RemoteClose && !connect_failure) {
+      prefetchConnections();
+    }
+
     if (check_for_drained) {
       checkForDrained();
     }
   } else if (event == Network::ConnectionEvent::Connected) {
     conn_connect_ms_->complete();
     processIdleClient(client);
+    client.connection_timing_reported_ = true;
   }
 
   if (client.connect_timer_) {
@@ -196,11 +239,22 @@ void ConnPoolImpl::onResponseComplete(ActiveClient& client) {
 }
 
 void ConnPoolImpl::processIdleClient(ActiveClient& client) {
-  client.stream_wrapper_.reset();
+  if (client.stream_wrapper_) {
+    client.stream_wrapper_.reset();
+    num_attached_requests_--;
+  }
   if (pending_requests_.empty()) {
     // There is nothing to service so just move the connection into the ready list.
     ENVOY_CONN_LOG(debug, "moving to ready", *client.codec_client_);
     client.moveBetweenLists(busy_clients_, ready_clients_);
+    const std::chrono::milliseconds idle_timeout = host_->cluster().connectionIdleTimeout();
+    if (idle_timeout.count() > 0) {
+      if (!client.idle_timer_) {
+        client.idle_timer_ =
+            dispatcher_.createCoarseTimer([&client]() -> void { client.onIdleTimeout(); });
+      }
+      client.idle_timer_->enableTimer(idle_timeout);
+    }
   } else {
     // There is work to do so bind a request to the client and move it to the busy list. Pending
     // requests are pushed onto the front, so pull from the back.
@@ -262,7 +316,8 @@ ConnPoolImpl::PendingRequest::~PendingRequest() {
 
 ConnPoolImpl::ActiveClient::ActiveClient(ConnPoolImpl& parent)
     : parent_(parent),
-      connect_timer_(parent_.dispatcher_.createTimer([this]() -> void { onConnectTimeout(); })),
+      connect_timer_(
+          parent_.dispatcher_.createCoarseTimer([this]() -> void { onConnectTimeout(); })),
       remaining_requests_(parent_.host_->cluster().maxRequestsPerConnection()) {
 
   parent_.conn_connect_ms_ =
@@ -302,6 +357,19 @@ void ConnPoolImpl::ActiveClient::onConnectTimeout() {
   codec_client_->close();
 }
 
+void ConnPoolImpl::ActiveClient::onIdleTimeout() {
+  // Keep the warm connections. Since the most recently used client is reused first, the clients
+  // that time out are the ones a burst opened beyond what the traffic needs.
+  if (parent_.ready_clients_.size() + parent_.busy_clients_.size() <=
+      parent_.host_->cluster().minWarmConnections()) {
+    return;
+  }
+
+  ENVOY_CONN_LOG(debug, "idle timeout", *codec_client_);
+  parent_.host_->cluster().stats().upstream_cx_idle_timeout_.inc();
+  codec_client_->close();
+}
+
 CodecClientPtr ConnPoolImplProd::createCodecClient(Upstream::Host::CreateConnectionData& data) {
   CodecClientPtr codec{new CodecClientProd(CodecClient::Type::HTTP1, std::move(data.connection_),
                                            data.host_description_)};
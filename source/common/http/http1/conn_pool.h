@@ -37,6 +37,7 @@ public:
   void addDrainedCallback(DrainedCb cb) override;
   ConnectionPool::Cancellable* newStream(StreamDecoder& response_decoder,
                                          ConnectionPool::Callbacks& callbacks) override;
+  void prefetchConnections() override;
 
 protected:
   struct ActiveClient;
@@ -75,6 +76,7 @@ protected:
     ~ActiveClient();
 
     void onConnectTimeout();
+    void onIdleTimeout();
 
     // Network::ConnectionCallbacks
     void onEvent(Network::ConnectionEvent event) override {
@@ -88,8 +90,12 @@ protected:
     Upstream::HostDescriptionConstSharedPtr real_host_description_;
     StreamWrapperPtr stream_wrapper_;
     Event::TimerPtr connect_timer_;
+    // Runs while the client is in the ready list, if the cluster has an idle timeout.
+    Event::TimerPtr idle_timer_;
     Stats::TimespanPtr conn_length_;
     uint64_t remaining_requests_;
+    // Whether a request has been attached, after which the connection timing is not reported.
+    bool connection_timing_reported_{};
   };
 
   typedef std::unique_ptr<ActiveClient> ActiveClientPtr;
@@ -123,11 +129,15 @@ protected:
   Stats::TimespanPtr conn_connect_ms_;
   Event::Dispatcher& dispatcher_;
   Upstream::HostConstSharedPtr host_;
+  // Clients are taken from and returned to the front, so the most recently used client is reused
+  // first and the clients at the back can go idle.
   std::list<ActiveClientPtr> ready_clients_;
   std::list<ActiveClientPtr> busy_clients_;
   std::list<PendingRequestPtr> pending_requests_;
   std::list<DrainedCb> drained_callbacks_;
   Upstream::ResourcePriority priority_;
+  // The number of requests that are attached to a client.
+  uint64_t num_attached_requests_{};
 };
 
 /**
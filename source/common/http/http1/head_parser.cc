@@ -0,0 +1,182 @@
+#include "common/http/http1/head_parser.h"
+
+#include <strings.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace Envoy {
+namespace Http {
+namespace Http1 {
+
+const size_t HeadParser::MAX_HEADERS;
+
+namespace {
+
+/**
+ * The characters allowed in a header name (tchar in RFC 7230).
+ */
+class TokenTable {
+public:
+  TokenTable() {
+    for (const char c : std::string("!#$%&'*+-.^_`|~")) {
+      table_[static_cast<uint8_t>(c)] = true;
+    }
+    for (int c = 0; c < 256; c++) {
+      if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+        table_[c] = true;
+      }
+    }
+  }
+
+  bool isToken(char c) const { return table_[static_cast<uint8_t>(c)]; }
+
+private:
+  std::array<bool, 256> table_{};
+};
+
+const TokenTable& tokenTable() {
+  static TokenTable* table = new TokenTable();
+  return *table;
+}
+
+bool isControl(uint8_t c) { return (c < 0x20 && c != '\t') || c == 0x7f; }
+
+/**
+ * @return const char* the first control character other than HTAB in [pos, end), or end. This is
+ *         what ends a header value; anything else, including obs-text, is part of the value.
+ */
+const char* findControl(const char* pos, const char* end) {
+#if defined(__AVX2__)
+  const __m256i tab_avx2 = _mm256_set1_epi8('\t');
+  const __m256i space_avx2 = _mm256_set1_epi8(0x20);
+  const __m256i del_avx2 = _mm256_set1_epi8(0x7f);
+  for (; end - pos >= 32; pos += 32) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    // Signed compares: bytes of 0x80 and above are negative, and are not control characters.
+    const __m256i below_space = _mm256_andnot_si256(_mm256_cmpgt_epi8(_mm256_setzero_si256(), v),
+                                                    _mm256_cmpgt_epi8(space_avx2, v));
+    const __m256i control =
+        _mm256_or_si256(_mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab_avx2), below_space),
+                        _mm256_cmpeq_epi8(v, del_avx2));
+    const uint32_t mask = _mm256_movemask_epi8(control);
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i tab_sse2 = _mm_set1_epi8('\t');
+  const __m128i space_sse2 = _mm_set1_epi8(0x20);
+  const __m128i del_sse2 = _mm_set1_epi8(0x7f);
+  for (; end - pos >= 16; pos += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const __m128i below_space =
+        _mm_andnot_si128(_mm_cmplt_epi8(v, _mm_setzero_si128()), _mm_cmplt_epi8(v, space_sse2));
+    const __m128i control = _mm_or_si128(
+        _mm_andnot_si128(_mm_cmpeq_epi8(v, tab_sse2), below_space), _mm_cmpeq_epi8(v, del_sse2));
+    const uint32_t mask = _mm_movemask_epi8(control);
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+#endif
+
+  for (; pos < end; pos++) {
+    if (isControl(*pos)) {
+      return pos;
+    }
+  }
+
+  return end;
+}
+
+/**
+ * @return bool whether http_parser looks at a header to frame the message.
+ */
+bool affectsFraming(const char* name, size_t size) {
+  static const char* const framing_headers[] = {"connection", "content-length", "proxy-connection",
+                                                "transfer-encoding", "upgrade"};
+  for (const char* framing_header : framing_headers) {
+    if (size == strlen(framing_header) && strncasecmp(name, framing_header, size) == 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace
+
+size_t HeadParser::parse(const char* data, size_t size) {
+  headers_.clear();
+  framing_head_.clear();
+  const char* pos = data;
+  const char* const end = data + size;
+
+  // The start line is only split off here. Its contents are checked by http_parser when it parses
+  // framingHead().
+  const char* line_end = static_cast<const char*>(memchr(pos, '\n', size));
+  if (line_end == nullptr || line_end - pos < 2 || line_end[-1] != '\r') {
+    return 0;
+  }
+  pos = line_end + 1;
+  framing_head_.append(data, pos - data);
+
+  while (true) {
+    if (end - pos < 2) {
+      return 0;
+    }
+    if (pos[0] == '\r') {
+      if (pos[1] != '\n') {
+        return 0;
+      }
+      pos += 2;
+      break;
+    }
+    if (headers_.size() == MAX_HEADERS) {
+      return 0;
+    }
+
+    const char* name = pos;
+    while (pos < end && tokenTable().isToken(*pos)) {
+      pos++;
+    }
+    if (pos == end || pos == name || *pos != ':') {
+      return 0;
+    }
+    const uint32_t name_size = pos - name;
+
+    pos++;
+    while (pos < end && (*pos == ' ' || *pos == '\t')) {
+      pos++;
+    }
+    const char* value = pos;
+    pos = findControl(pos, end);
+    if (end - pos < 2 || pos[0] != '\r' || pos[1] != '\n') {
+      return 0;
+    }
+    if (pos > value && (pos[-1] == ' ' || pos[-1] == '\t')) {
+      return 0;
+    }
+
+    headers_.push_back({name, name_size, value, static_cast<uint32_t>(pos - value)});
+    pos += 2;
+    if (affectsFraming(name, name_size)) {
+      framing_head_.append(name, pos - name);
+    }
+  }
+
+  framing_head_.append("\r\n");
+  return pos - data;
+}
+
+} // namespace Http1
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Envoy {
+namespace Http {
+namespace Http1 {
+
+/**
+ * Parser for an HTTP/1.x message head (the start line and the headers) that is available in
+ * contiguous memory, in the style of picohttpparser. Header lines are scanned a vector at a time
+ * instead of being driven byte by byte through a state machine, and every header comes out in one
+ * piece instead of being split over callbacks.
+ *
+ * It is a fast path in front of http_parser, not a replacement for it. It only accepts the common,
+ * well formed shape of a head and refuses anything else (obsolete line folding, bare LF line
+ * endings, whitespace around names or at the end of values, ...) without side effects, leaving the
+ * message to http_parser. Framing is still up to http_parser: the start line and the headers that
+ * affect framing are collected into framingHead(), which the codec runs through http_parser so
+ * that its view of the message is exactly what it would have been had it parsed the whole head.
+ */
+class HeadParser {
+public:
+  struct Header {
+    const char* name_;
+    uint32_t name_size_;
+    const char* value_;
+    uint32_t value_size_;
+  };
+
+  // Heads with more headers than this are left to http_parser.
+  static const size_t MAX_HEADERS = 128;
+
+  /**
+   * Parse a head at the start of data.
+   * @param data supplies the data.
+   * @param size supplies the size of the data.
+   * @return size_t the size of the head, including the empty line that ends it, or 0 if data does
+   *         not start with a complete head that is handled here. headers() and framingHead() are
+   *         only valid after a successful parse and refer into data.
+   */
+  size_t parse(const char* data, size_t size);
+
+  /**
+   * @return the headers of the last parsed head in order, with names as they were received.
+   */
+  const std::vector<Header>& headers() const { return headers_; }
+
+  /**
+   * @return the start line of the last parsed head followed by only the headers that affect
+   *         framing (connection, content-length, proxy-connection, transfer-encoding and upgrade)
+   *         and the empty line that ends the head.
+   */
+  const std::string& framingHead() const { return framing_head_; }
+
+private:
+  std::vector<Header> headers_;
+  std::string framing_head_;
+};
+
+} // namespace Http1
+} // namespace Http
+} // namespace Envoy
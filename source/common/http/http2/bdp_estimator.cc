@@ -0,0 +1,56 @@
+#include "common/http/http2/bdp_estimator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace Envoy {
+namespace Http {
+namespace Http2 {
+
+BdpEstimator::BdpEstimator(uint64_t initial_estimate, uint64_t max_estimate,
+                           MonotonicTimeSource& time_source)
+    : initial_estimate_(initial_estimate), max_estimate_(std::max(initial_estimate, max_estimate)),
+      time_source_(time_source), estimate_(initial_estimate) {}
+
+bool BdpEstimator::onDataReceived(uint64_t bytes) {
+  accumulator_ += bytes;
+  // There is nothing left to measure once the estimate is as large as it is allowed to be.
+  return !ping_in_flight_ && estimate_ < max_estimate_;
+}
+
+void BdpEstimator::onPingSent() {
+  ping_in_flight_ = true;
+  ping_sent_time_ = time_source_.currentTime();
+}
+
+bool BdpEstimator::onPingAck() {
+  if (!ping_in_flight_) {
+    return false;
+  }
+
+  const double seconds =
+      std::chrono::duration<double>(time_source_.currentTime() - ping_sent_time_).count();
+  const double bandwidth = seconds > 0 ? accumulator_ / seconds : 0;
+  const uint64_t previous_estimate = estimate_;
+  if (accumulator_ > 2 * estimate_ / 3 && bandwidth > max_bandwidth_) {
+    estimate_ = std::min(max_estimate_, std::max(accumulator_, 2 * estimate_));
+    max_bandwidth_ = bandwidth;
+  }
+
+  accumulator_ = 0;
+  ping_in_flight_ = false;
+  return estimate_ > previous_estimate;
+}
+
+bool BdpEstimator::shrink() {
+  // The bandwidth seen before the receiver fell behind says nothing about what it can take now.
+  max_bandwidth_ = 0;
+  const uint64_t previous_estimate = estimate_;
+  estimate_ = std::max(initial_estimate_, estimate_ / 2);
+  return estimate_ < previous_estimate;
+}
+
+} // namespace Http2
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+#include "envoy/common/time.h"
+
+namespace Envoy {
+namespace Http {
+namespace Http2 {
+
+/**
+ * Estimates the bandwidth-delay product (BDP) of a connection from the amount of data that is
+ * received while a PING is in flight, in the style of the gRPC BDP estimator. While the peer
+ * delivers most of the current estimate within one round trip and the measured bandwidth keeps
+ * going up, the receive window is what limits throughput, so the estimate is doubled.
+ */
+class BdpEstimator {
+public:
+  /**
+   * @param initial_estimate supplies the estimate to start from. It is also the smallest estimate.
+   * @param max_estimate supplies the largest estimate.
+   * @param time_source supplies the time source used to measure round trips.
+   */
+  BdpEstimator(uint64_t initial_estimate, uint64_t max_estimate, MonotonicTimeSource& time_source);
+
+  /**
+   * Account for received data.
+   * @param bytes supplies the number of DATA payload bytes received.
+   * @return bool whether a PING should be sent to start a new sample. If so, the caller must send
+   *         one and call onPingSent().
+   */
+  bool onDataReceived(uint64_t bytes);
+
+  /**
+   * Start a sample. Called when the PING is sent.
+   */
+  void onPingSent();
+
+  /**
+   * Complete the current sample. Called when the PING is acknowledged.
+   * @return bool whether the estimate grew.
+   */
+  bool onPingAck();
+
+  /**
+   * Halve the estimate, not going below the initial estimate. Called when the receiver stops
+   * reading because whatever it forwards the data to is falling behind.
+   * @return bool whether the estimate shrank.
+   */
+  bool shrink();
+
+  /**
+   * @return uint64_t the current estimate in bytes.
+   */
+  uint64_t estimate() const { return estimate_; }
+
+private:
+  const uint64_t initial_estimate_;
+  const uint64_t max_estimate_;
+  MonotonicTimeSource& time_source_;
+  uint64_t estimate_;
+  // Bytes received since the current sample started.
+  uint64_t accumulator_{};
+  // The highest bandwidth seen, in bytes per second.
+  double max_bandwidth_{};
+  MonotonicTime ping_sent_time_;
+  bool ping_in_flight_{};
+};
+
+} // namespace Http2
+} // namespace Http
+} // namespace Envoy
@@ -1,6 +1,8 @@
 #include "common/http/http2/codec_impl.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <vector>
 
@@ -38,7 +40,9 @@ bool Utility::reconstituteCrumbledCookies(const HeaderString& key, const HeaderS
 }
 
 ConnectionImpl::Http2Callbacks ConnectionImpl::http2_callbacks_;
-ConnectionImpl::Http2Options ConnectionImpl::http2_options_;
+
+// The opaque data of the PINGs that measure the bandwidth-delay product.
+static const uint8_t BDP_PING_DATA[8] = {'e', 'n', 'v', 'o', 'y', 'b', 'd', 'p'};
 const std::unique_ptr<const Http::HeaderMap> ConnectionImpl::CONTINUE_HEADER{
     new Http::HeaderMapImpl{
         {Http::Headers::get().Status, std::to_string(enumToInt(Code::Continue))}}};
@@ -62,7 +66,7 @@ ConnectionImpl::StreamImpl::StreamImpl(ConnectionImpl& parent, uint32_t buffer_l
   }
 }
 
-static void insertHeader(std::vector<nghttp2_nv>& headers, const HeaderEntry& header) {
+void ConnectionImpl::insertHeader(std::vector<nghttp2_nv>& headers, const HeaderEntry& header) {
   uint8_t flags = 0;
   if (header.key().type() == HeaderString::Type::Reference) {
     flags |= NGHTTP2_NV_FLAG_NO_COPY_NAME;
@@ -70,38 +74,51 @@ static void insertHeader(std::vector<nghttp2_nv>& headers, const HeaderEntry& he
   if (header.value().type() == HeaderString::Type::Reference) {
     flags |= NGHTTP2_NV_FLAG_NO_COPY_VALUE;
   }
+  for (const std::string& never_index_header : never_index_headers_) {
+    if (header.key().size() == never_index_header.size() &&
+        memcmp(header.key().c_str(), never_index_header.c_str(), header.key().size()) == 0) {
+      flags |= NGHTTP2_NV_FLAG_NO_INDEX;
+      break;
+    }
+  }
   headers.push_back({remove_const<uint8_t>(header.key().c_str()),
                      remove_const<uint8_t>(header.value().c_str()), header.key().size(),
                      header.value().size(), flags});
+  stats_.tx_header_bytes_.add(header.key().size() + header.value().size());
 }
 
-void ConnectionImpl::StreamImpl::buildHeaders(std::vector<nghttp2_nv>& final_headers,
-                                              const HeaderMap& headers) {
+void ConnectionImpl::buildHeaders(std::vector<nghttp2_nv>& final_headers,
+                                  const HeaderMap& headers) {
+  struct BuildContext {
+    ConnectionImpl* connection_;
+    std::vector<nghttp2_nv>* final_headers_;
+  } context{this, &final_headers};
+
   // nghttp2 requires that all ':' headers come before all other headers. To avoid making higher
   // layers understand that we do two passes here to build the final header list to encode.
   final_headers.reserve(headers.size());
   headers.iterate(
       [](const HeaderEntry& header, void* context) -> void {
-        std::vector<nghttp2_nv>* final_headers = static_cast<std::vector<nghttp2_nv>*>(context);
+        BuildContext* build_context = static_cast<BuildContext*>(context);
         if (header.key().c_str()[0] == ':') {
-          insertHeader(*final_headers, header);
+          build_context->connection_->insertHeader(*build_context->final_headers_, header);
         }
       },
-      &final_headers);
+      &context);
 
   headers.iterate(
       [](const HeaderEntry& header, void* context) -> void {
-        std::vector<nghttp2_nv>* final_headers = static_cast<std::vector<nghttp2_nv>*>(context);
+        BuildContext* build_context = static_cast<BuildContext*>(context);
         if (header.key().c_str()[0] != ':') {
-          insertHeader(*final_headers, header);
+          build_context->connection_->insertHeader(*build_context->final_headers_, header);
         }
       },
-      &final_headers);
+      &context);
 }
 
 void ConnectionImpl::StreamImpl::encodeHeaders(const HeaderMap& headers, bool end_stream) {
   std::vector<nghttp2_nv> final_headers;
-  buildHeaders(final_headers, headers);
+  parent_.buildHeaders(final_headers, headers);
 
   nghttp2_data_provider provider;
   if (!end_stream) {
@@ -115,7 +132,7 @@ void ConnectionImpl::StreamImpl::encodeHeaders(const HeaderMap& headers, bool en
 
   local_end_stream_ = end_stream;
   submitHeaders(final_headers, end_stream ? nullptr : &provider);
-  parent_.sendPendingFrames();
+  parent_.schedulePendingFrames();
 }
 
 void ConnectionImpl::StreamImpl::encodeTrailers(const HeaderMap& trailers) {
@@ -128,7 +145,7 @@ void ConnectionImpl::StreamImpl::encodeTrailers(const HeaderMap& trailers) {
     pending_trailers_.reset(new HeaderMapImpl(trailers));
   } else {
     submitTrailers(trailers);
-    parent_.sendPendingFrames();
+    parent_.schedulePendingFrames();
   }
 }
 void ConnectionImpl::StreamImpl::readDisable(bool disable) {
@@ -136,14 +153,16 @@ void ConnectionImpl::StreamImpl::readDisable(bool disable) {
                  parent_.connection_, stream_id_, (disable ? "disabled" : "enabled"),
                  unconsumed_bytes_, read_disable_count_);
   if (disable) {
-    ++read_disable_count_;
+    if (read_disable_count_++ == 0) {
+      parent_.onStreamReadDisabled();
+    }
   } else {
     ASSERT(read_disable_count_ > 0);
     --read_disable_count_;
     if (!buffers_overrun()) {
       nghttp2_session_consume(parent_.session_, stream_id_, unconsumed_bytes_);
       unconsumed_bytes_ = 0;
-      parent_.sendPendingFrames();
+      parent_.schedulePendingFrames();
     }
   }
 }
@@ -184,7 +203,7 @@ void ConnectionImpl::StreamImpl::saveHeader(HeaderString&& name, HeaderString&&
 
 void ConnectionImpl::StreamImpl::submitTrailers(const HeaderMap& trailers) {
   std::vector<nghttp2_nv> final_headers;
-  buildHeaders(final_headers, trailers);
+  parent_.buildHeaders(final_headers, trailers);
   int rc =
       nghttp2_submit_trailer(parent_.session_, stream_id_, &final_headers[0], final_headers.size());
   ASSERT(rc == 0);
@@ -192,6 +211,10 @@ void ConnectionImpl::StreamImpl::submitTrailers(const HeaderMap& trailers) {
 }
 
 ssize_t ConnectionImpl::StreamImpl::onDataSourceRead(uint64_t length, uint32_t* data_flags) {
+  if (parent_.stream_write_quantum_ > 0) {
+    length = std::min<uint64_t>(length, parent_.stream_write_quantum_);
+  }
+
   if (pending_send_data_.length() == 0 && !local_end_stream_) {
     ASSERT(!data_deferred_);
     data_deferred_ = true;
@@ -218,10 +241,9 @@ int ConnectionImpl::StreamImpl::onDataSourceSend(const uint8_t* framehd, size_t
   // https://nghttp2.org/documentation/types.html#c.nghttp2_send_data_callback
   static const uint64_t FRAME_HEADER_SIZE = 9;
 
-  // TODO(mattklein123): Back pressure.
-  Buffer::OwnedImpl output(framehd, FRAME_HEADER_SIZE);
-  output.move(pending_send_data_, length);
-  parent_.connection_.write(output);
+  // The frame header is the only thing that is copied, the body slices are moved.
+  parent_.outbound_buffer_.add(framehd, FRAME_HEADER_SIZE);
+  parent_.outbound_buffer_.move(pending_send_data_, length);
   return 0;
 }
 
@@ -254,7 +276,7 @@ void ConnectionImpl::StreamImpl::encodeData(Buffer::Instance& data, bool end_str
     data_deferred_ = false;
   }
 
-  parent_.sendPendingFrames();
+  parent_.schedulePendingFrames();
 }
 
 void ConnectionImpl::StreamImpl::resetStream(StreamResetReason reason) {
@@ -287,7 +309,39 @@ void ConnectionImpl::StreamImpl::resetStreamWorker(StreamResetReason reason) {
   UNREFERENCED_PARAMETER(rc);
 }
 
-ConnectionImpl::~ConnectionImpl() { nghttp2_session_del(session_); }
+ConnectionImpl::ConnectionImpl(Network::Connection& connection, Stats::Scope& stats,
+                               const Http2Settings& http2_settings)
+    : stats_{ALL_HTTP2_CODEC_STATS(POOL_COUNTER_PREFIX(stats, "http2."),
+                                   POOL_GAUGE_PREFIX(stats, "http2."))},
+      connection_(connection),
+      per_stream_buffer_limit_(http2_settings.initial_stream_window_size_),
+      never_index_headers_(http2_settings.never_index_headers_),
+      initial_stream_window_size_(http2_settings.initial_stream_window_size_),
+      initial_connection_window_size_(http2_settings.initial_connection_window_size_),
+      max_stream_window_size_(
+          std::max(http2_settings.max_stream_window_size_, initial_stream_window_size_)),
+      max_connection_window_size_(
+          std::max(http2_settings.max_connection_window_size_, initial_connection_window_size_)),
+      stream_window_size_(initial_stream_window_size_),
+      connection_window_size_(initial_connection_window_size_),
+      stream_write_quantum_(http2_settings.stream_write_quantum_),
+      coalesce_frame_writes_(http2_settings.coalesce_frame_writes_), dispatching_(false),
+      raised_goaway_(false), pending_deferred_reset_(false) {
+  if (http2_settings.window_auto_tuning_) {
+    bdp_estimator_.reset(new BdpEstimator(
+        std::min(initial_stream_window_size_, initial_connection_window_size_),
+        std::max(max_stream_window_size_, max_connection_window_size_),
+        ProdMonotonicTimeSource::instance_));
+  }
+  stats_.stream_window_size_.add(stream_window_size_);
+  stats_.connection_window_size_.add(connection_window_size_);
+}
+
+ConnectionImpl::~ConnectionImpl() {
+  stats_.stream_window_size_.sub(stream_window_size_);
+  stats_.connection_window_size_.sub(connection_window_size_);
+  nghttp2_session_del(session_);
+}
 
 void ConnectionImpl::dispatch(Buffer::Instance& data) {
   ENVOY_CONN_LOG(trace, "dispatching {} bytes", connection_, data.length());
@@ -321,6 +375,12 @@ int ConnectionImpl::onData(int32_t stream_id, const uint8_t* data, size_t len) {
   // If this results in buffering too much data, the watermark buffer will call
   // pendingRecvBufferHighWatermark, resulting in ++read_disable_count_
   stream->pending_recv_data_.add(data, len);
+  if (bdp_estimator_ && bdp_estimator_->onDataReceived(len)) {
+    int rc = nghttp2_submit_ping(session_, NGHTTP2_FLAG_NONE, BDP_PING_DATA);
+    ASSERT(rc == 0);
+    UNREFERENCED_PARAMETER(rc);
+    bdp_estimator_->onPingSent();
+  }
   // Update the window to the peer unless some consumer of this stream's data has hit a flow control
   // limit and disabled reads on this stream
   if (!stream->buffers_overrun()) {
@@ -349,6 +409,65 @@ void ConnectionImpl::shutdownNotice() {
   sendPendingFrames();
 }
 
+int ConnectionImpl::onBeginFrame(const nghttp2_frame_hd* hd) {
+  if (hd->type == NGHTTP2_HEADERS || hd->type == NGHTTP2_CONTINUATION) {
+    stats_.rx_header_bytes_compressed_.add(hd->length);
+  }
+
+  return 0;
+}
+
+void ConnectionImpl::onBdpPingAck() {
+  if (bdp_estimator_ && bdp_estimator_->onPingAck()) {
+    ENVOY_CONN_LOG(debug, "BDP estimate grew to {}", connection_, bdp_estimator_->estimate());
+    updateWindowSizes();
+  }
+}
+
+void ConnectionImpl::onStreamReadDisabled() {
+  if (bdp_estimator_ && bdp_estimator_->shrink()) {
+    ENVOY_CONN_LOG(debug, "BDP estimate shrank to {}", connection_, bdp_estimator_->estimate());
+    updateWindowSizes();
+  }
+}
+
+void ConnectionImpl::updateWindowSizes() {
+  const uint64_t estimate = bdp_estimator_->estimate();
+  const uint32_t stream_window_size = std::max<uint64_t>(
+      initial_stream_window_size_, std::min<uint64_t>(max_stream_window_size_, estimate));
+  const uint32_t connection_window_size = std::max<uint64_t>(
+      initial_connection_window_size_, std::min<uint64_t>(max_connection_window_size_, estimate));
+
+  if (stream_window_size != stream_window_size_) {
+    // This applies to the streams that are already open as well as to new ones.
+    nghttp2_settings_entry iv{NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, stream_window_size};
+    int rc = nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, &iv, 1);
+    ASSERT(rc == 0);
+    UNREFERENCED_PARAMETER(rc);
+    ENVOY_CONN_LOG(debug, "setting stream-level window size to {}", connection_,
+                   stream_window_size);
+    stats_.stream_window_size_.sub(stream_window_size_);
+    stats_.stream_window_size_.add(stream_window_size);
+    stream_window_size_ = stream_window_size;
+  }
+
+  if (connection_window_size != connection_window_size_) {
+    // nghttp2 sends a WINDOW_UPDATE if the window grew. If it shrank, it holds back WINDOW_UPDATEs
+    // until the peer is within the new window.
+    int rc = nghttp2_session_set_local_window_size(session_, NGHTTP2_FLAG_NONE, 0,
+                                                   connection_window_size);
+    ASSERT(rc == 0);
+    UNREFERENCED_PARAMETER(rc);
+    ENVOY_CONN_LOG(debug, "setting connection-level window size to {}", connection_,
+                   connection_window_size);
+    stats_.connection_window_size_.sub(connection_window_size_);
+    stats_.connection_window_size_.add(connection_window_size);
+    connection_window_size_ = connection_window_size;
+  }
+
+  sendPendingFrames();
+}
+
 int ConnectionImpl::onFrameReceived(const nghttp2_frame* frame) {
   ENVOY_CONN_LOG(trace, "recv frame type={}", connection_, static_cast<uint64_t>(frame->hd.type));
 
@@ -361,6 +480,12 @@ int ConnectionImpl::onFrameReceived(const nghttp2_frame* frame) {
     return 0;
   }
 
+  if (frame->hd.type == NGHTTP2_PING && (frame->hd.flags & NGHTTP2_FLAG_ACK) &&
+      memcmp(frame->ping.opaque_data, BDP_PING_DATA, sizeof(BDP_PING_DATA)) == 0) {
+    onBdpPingAck();
+    return 0;
+  }
+
   StreamImpl* stream = getStream(frame->hd.stream_id);
   if (!stream) {
     return 0;
@@ -380,7 +505,7 @@ int ConnectionImpl::onFrameReceived(const nghttp2_frame* frame) {
       // Deal with expect: 100-continue here since higher layers are never going to do anything
       // other than say to continue so that we can respond before request complete if necessary.
       std::vector<nghttp2_nv> final_headers;
-      StreamImpl::buildHeaders(final_headers, *CONTINUE_HEADER);
+      buildHeaders(final_headers, *CONTINUE_HEADER);
       int rc = nghttp2_submit_headers(session_, 0, stream->stream_id_, nullptr, &final_headers[0],
                                       final_headers.size(), nullptr);
       ASSERT(rc == 0);
@@ -479,6 +604,10 @@ int ConnectionImpl::onFrameSend(const nghttp2_frame* frame) {
   }
 
   case NGHTTP2_HEADERS:
+    // The length of a HEADERS frame is the length of the whole header block, including any
+    // CONTINUATION frames it was split into.
+    stats_.tx_header_bytes_compressed_.add(frame->hd.length - frame->headers.padlen);
+    FALLTHRU;
   case NGHTTP2_DATA: {
     StreamImpl* stream = getStream(frame->hd.stream_id);
     stream->local_end_stream_sent_ = frame->hd.flags & NGHTTP2_FLAG_END_STREAM;
@@ -503,10 +632,8 @@ int ConnectionImpl::onInvalidFrame(int error_code) {
 }
 
 ssize_t ConnectionImpl::onSend(const uint8_t* data, size_t length) {
-  // TODO(mattklein123): Back pressure.
   ENVOY_CONN_LOG(trace, "send data: bytes={}", connection_, length);
-  Buffer::OwnedImpl buffer(data, length);
-  connection_.write(buffer);
+  outbound_buffer_.add(data, length);
   return length;
 }
 
@@ -563,7 +690,21 @@ void ConnectionImpl::sendPendingFrames() {
     return;
   }
 
+  if (send_timer_) {
+    send_timer_->disableTimer();
+  }
+
   int rc = nghttp2_session_send(session_);
+
+  // Everything nghttp2 sent is written to the connection at once instead of frame by frame.
+  // TODO(mattklein123): Back pressure.
+  // The frames are moved out first as writing may re-enter the codec.
+  if (outbound_buffer_.length() > 0) {
+    Buffer::OwnedImpl output;
+    output.move(outbound_buffer_);
+    connection_.write(output);
+  }
+
   if (rc != 0) {
     ASSERT(rc == NGHTTP2_ERR_CALLBACK_FAILURE);
     throw CodecProtocolException(fmt::format("{}", nghttp2_strerror(rc)));
@@ -592,6 +733,19 @@ void ConnectionImpl::sendPendingFrames() {
   }
 }
 
+void ConnectionImpl::schedulePendingFrames() {
+  // While dispatching, the frames are sent once dispatch() is done.
+  if (!coalesce_frame_writes_ || dispatching_) {
+    sendPendingFrames();
+    return;
+  }
+
+  if (!send_timer_) {
+    send_timer_ = connection_.dispatcher().createTimer([this]() -> void { sendPendingFrames(); });
+  }
+  send_timer_->enableTimer(std::chrono::milliseconds(0));
+}
+
 void ConnectionImpl::sendSettings(const Http2Settings& http2_settings) {
   ASSERT(http2_settings.hpack_table_size_ <= Http2Settings::MAX_HPACK_TABLE_SIZE);
   ASSERT(Http2Settings::MIN_MAX_CONCURRENT_STREAMS <= http2_settings.max_concurrent_streams_ &&
@@ -665,6 +819,11 @@ ConnectionImpl::Http2Callbacks::Http2Callbacks() {
         return static_cast<StreamImpl*>(source->ptr)->onDataSourceSend(framehd, length);
       });
 
+  nghttp2_session_callbacks_set_on_begin_frame_callback(
+      callbacks_, [](nghttp2_session*, const nghttp2_frame_hd* hd, void* user_data) -> int {
+        return static_cast<ConnectionImpl*>(user_data)->onBeginFrame(hd);
+      });
+
   nghttp2_session_callbacks_set_on_begin_headers_callback(
       callbacks_, [](nghttp2_session*, const nghttp2_frame* frame, void* user_data) -> int {
         return static_cast<ConnectionImpl*>(user_data)->onBeginHeaders(frame);
@@ -675,13 +834,15 @@ ConnectionImpl::Http2Callbacks::Http2Callbacks() {
       [](nghttp2_session*, const nghttp2_frame* frame, const uint8_t* raw_name, size_t name_length,
          const uint8_t* raw_value, size_t value_length, uint8_t, void* user_data) -> int {
 
+        ConnectionImpl* connection = static_cast<ConnectionImpl*>(user_data);
+        connection->stats_.rx_header_bytes_.add(name_length + value_length);
+
         // TODO PERF: Can reference count here to avoid copies.
         HeaderString name;
         name.setCopy(reinterpret_cast<const char*>(raw_name), name_length);
         HeaderString value;
         value.setCopy(reinterpret_cast<const char*>(raw_value), value_length);
-        return static_cast<ConnectionImpl*>(user_data)->onHeader(frame, std::move(name),
-                                                                 std::move(value));
+        return connection->onHeader(frame, std::move(name), std::move(value));
       });
 
   nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
@@ -723,14 +884,19 @@ ConnectionImpl::Http2Callbacks::Http2Callbacks() {
 
 ConnectionImpl::Http2Callbacks::~Http2Callbacks() { nghttp2_session_callbacks_del(callbacks_); }
 
-ConnectionImpl::Http2Options::Http2Options() {
+ConnectionImpl::Http2Options::Http2Options(const Http2Settings& http2_settings) {
   nghttp2_option_new(&options_);
-  // Currently we do not do anything with stream priority. Setting the following option prevents
-  // nghttp2 from keeping around closed streams for use during stream priority dependency graph
-  // calculations. This saves a tremendous amount of memory in cases where there are a large number
-  // of kept alive HTTP/2 connections.
+  // nghttp2 schedules the DATA frames of open streams by the priorities signalled by the peer.
+  // Setting the following option prevents nghttp2 from keeping around closed streams for use
+  // during stream priority dependency graph calculations. This saves a tremendous amount of memory
+  // in cases where there are a large number of kept alive HTTP/2 connections.
   nghttp2_option_set_no_closed_streams(options_, 1);
   nghttp2_option_set_no_auto_window_update(options_, 1);
+
+  if (http2_settings.hpack_encoder_table_size_ != NGHTTP2_DEFAULT_HEADER_TABLE_SIZE) {
+    nghttp2_option_set_max_deflate_dynamic_table_size(options_,
+                                                      http2_settings.hpack_encoder_table_size_);
+  }
 }
 
 ConnectionImpl::Http2Options::~Http2Options() { nghttp2_option_del(options_); }
@@ -739,8 +905,9 @@ ClientConnectionImpl::ClientConnectionImpl(Network::Connection& connection,
                                            Http::ConnectionCallbacks& callbacks,
                                            Stats::Scope& stats, const Http2Settings& http2_settings)
     : ConnectionImpl(connection, stats, http2_settings), callbacks_(callbacks) {
+  Http2Options http2_options(http2_settings);
   nghttp2_session_client_new2(&session_, http2_callbacks_.callbacks(), base(),
-                              http2_options_.options());
+                              http2_options.options());
   sendSettings(http2_settings);
 }
 
@@ -757,6 +924,11 @@ Http::StreamEncoder& ClientConnectionImpl::newStream(StreamDecoder& decoder) {
   return *active_streams_.front();
 }
 
+uint32_t ClientConnectionImpl::maxConcurrentStreams() {
+  // Until the SETTINGS of the peer arrive this is the unlimited default of nghttp2.
+  return nghttp2_session_get_remote_settings(session_, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+}
+
 int ClientConnectionImpl::onBeginHeaders(const nghttp2_frame* frame) {
   // The client code explicitly does not currently suport push promise.
   RELEASE_ASSERT(frame->hd.type == NGHTTP2_HEADERS);
@@ -783,8 +955,9 @@ ServerConnectionImpl::ServerConnectionImpl(Network::Connection& connection,
                                            Http::ServerConnectionCallbacks& callbacks,
                                            Stats::Scope& scope, const Http2Settings& http2_settings)
     : ConnectionImpl(connection, scope, http2_settings), callbacks_(callbacks) {
+  Http2Options http2_options(http2_settings);
   nghttp2_session_server_new2(&session_, http2_callbacks_.callbacks(), base(),
-                              http2_options_.options());
+                              http2_options.options());
   sendSettings(http2_settings);
 }
 
@@ -8,6 +8,7 @@
 
 #include "envoy/common/optional.h"
 #include "envoy/event/deferred_deletable.h"
+#include "envoy/event/timer.h"
 #include "envoy/http/codec.h"
 #include "envoy/network/connection.h"
 #include "envoy/stats/stats.h"
@@ -17,8 +18,10 @@
 #include "common/buffer/watermark_buffer.h"
 #include "common/common/linked_object.h"
 #include "common/common/logger.h"
+#include "common/common/recycler.h"
 #include "common/http/codec_helper.h"
 #include "common/http/header_map_impl.h"
+#include "common/http/http2/bdp_estimator.h"
 
 #include "nghttp2/nghttp2.h"
 
@@ -36,19 +39,25 @@ const std::string CLIENT_MAGIC_PREFIX = "PRI * HTTP/2";
  * All stats for the HTTP/2 codec. @see stats_macros.h
  */
 // clang-format off
-#define ALL_HTTP2_CODEC_STATS(COUNTER)                                                             \
+#define ALL_HTTP2_CODEC_STATS(COUNTER, GAUGE)                                                      \
   COUNTER(rx_reset)                                                                                \
   COUNTER(tx_reset)                                                                                \
   COUNTER(header_overflow)                                                                         \
   COUNTER(trailers)                                                                                \
-  COUNTER(headers_cb_no_stream)
+  COUNTER(headers_cb_no_stream)                                                                    \
+  COUNTER(rx_header_bytes)                                                                         \
+  COUNTER(rx_header_bytes_compressed)                                                              \
+  COUNTER(tx_header_bytes)                                                                         \
+  COUNTER(tx_header_bytes_compressed)                                                              \
+  GAUGE  (connection_window_size)                                                                  \
+  GAUGE  (stream_window_size)
 // clang-format on
 
 /**
  * Wrapper struct for the HTTP/2 codec stats. @see stats_macros.h
  */
 struct CodecStats {
-  ALL_HTTP2_CODEC_STATS(GENERATE_COUNTER_STRUCT)
+  ALL_HTTP2_CODEC_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
 };
 
 class Utility {
@@ -67,14 +76,12 @@ public:
 /**
  * Base class for HTTP/2 client and server codecs.
  */
-class ConnectionImpl : public virtual Connection, protected Logger::Loggable<Logger::Id::http2> {
+class ConnectionImpl : public virtual Connection,
+                       public Recycled,
+                       protected Logger::Loggable<Logger::Id::http2> {
 public:
   ConnectionImpl(Network::Connection& connection, Stats::Scope& stats,
-                 const Http2Settings& http2_settings)
-      : stats_{ALL_HTTP2_CODEC_STATS(POOL_COUNTER_PREFIX(stats, "http2."))},
-        connection_(connection),
-        per_stream_buffer_limit_(http2_settings.initial_stream_window_size_), dispatching_(false),
-        raised_goaway_(false), pending_deferred_reset_(false) {}
+                 const Http2Settings& http2_settings);
 
   ~ConnectionImpl();
 
@@ -112,11 +119,11 @@ protected:
   };
 
   /**
-   * Wrapper for static nghttp2 session options.
+   * Wrapper for nghttp2 session options.
    */
   class Http2Options {
   public:
-    Http2Options();
+    Http2Options(const Http2Settings& http2_settings);
     ~Http2Options();
 
     const nghttp2_option* options() { return options_; }
@@ -140,7 +147,6 @@ protected:
     ssize_t onDataSourceRead(uint64_t length, uint32_t* data_flags);
     int onDataSourceSend(const uint8_t* framehd, size_t length);
     void resetStreamWorker(StreamResetReason reason);
-    static void buildHeaders(std::vector<nghttp2_nv>& final_headers, const HeaderMap& headers);
     void saveHeader(HeaderString&& name, HeaderString&& value);
     virtual void submitHeaders(const std::vector<nghttp2_nv>& final_headers,
                                nghttp2_data_provider* provider) PURE;
@@ -229,23 +235,29 @@ protected:
   };
 
   ConnectionImpl* base() { return this; }
+  void buildHeaders(std::vector<nghttp2_nv>& final_headers, const HeaderMap& headers);
   StreamImpl* getStream(int32_t stream_id);
   int saveHeader(const nghttp2_frame* frame, HeaderString&& name, HeaderString&& value);
   void sendPendingFrames();
+  void schedulePendingFrames();
   void sendSettings(const Http2Settings& http2_settings);
 
   static Http2Callbacks http2_callbacks_;
-  static Http2Options http2_options_;
 
   std::list<StreamImplPtr> active_streams_;
   nghttp2_session* session_{};
   CodecStats stats_;
   Network::Connection& connection_;
+  // Frames sent by nghttp2 during sendPendingFrames(), written to the connection in one go.
+  Buffer::OwnedImpl outbound_buffer_;
   uint32_t per_stream_buffer_limit_;
 
 private:
   virtual ConnectionCallbacks& callbacks() PURE;
   virtual int onBeginHeaders(const nghttp2_frame* frame) PURE;
+  int onBeginFrame(const nghttp2_frame_hd* hd);
+  void onBdpPingAck();
+  void onStreamReadDisabled();
   int onData(int32_t stream_id, const uint8_t* data, size_t len);
   int onFrameReceived(const nghttp2_frame* frame);
   int onFrameSend(const nghttp2_frame* frame);
@@ -254,8 +266,25 @@ private:
   ssize_t onSend(const uint8_t* data, size_t length);
   int onStreamClose(int32_t stream_id, uint32_t error_code);
 
+  void insertHeader(std::vector<nghttp2_nv>& headers, const HeaderEntry& header);
+  void updateWindowSizes();
+
   static const std::unique_ptr<const Http::HeaderMap> CONTINUE_HEADER;
 
+  const std::vector<std::string> never_index_headers_;
+  const uint32_t initial_stream_window_size_;
+  const uint32_t initial_connection_window_size_;
+  const uint32_t max_stream_window_size_;
+  const uint32_t max_connection_window_size_;
+  uint32_t stream_window_size_;
+  uint32_t connection_window_size_;
+  const uint32_t stream_write_quantum_;
+  const bool coalesce_frame_writes_;
+  // Created on first use if frame writes are coalesced.
+  Event::TimerPtr send_timer_;
+  // Only set if window auto-tuning is enabled.
+  std::unique_ptr<BdpEstimator> bdp_estimator_;
+
   bool dispatching_ : 1;
   bool raised_goaway_ : 1;
   bool pending_deferred_reset_ : 1;
@@ -271,6 +300,7 @@ public:
 
   // Http::ClientConnection
   Http::StreamEncoder& newStream(StreamDecoder& response_decoder) override;
+  uint32_t maxConcurrentStreams() override;
 
 private:
   // ConnectionImpl
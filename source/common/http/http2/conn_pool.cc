@@ -1,5 +1,6 @@
 #include "common/http/http2/conn_pool.h"
 
+#include <algorithm>
 #include <cstdint>
 
 #include "envoy/event/dispatcher.h"
@@ -19,12 +20,12 @@ ConnPoolImpl::ConnPoolImpl(Event::Dispatcher& dispatcher, Upstream::HostConstSha
     : dispatcher_(dispatcher), host_(host), priority_(priority) {}
 
 ConnPoolImpl::~ConnPoolImpl() {
-  if (primary_client_) {
-    primary_client_->client_->close();
+  while (!ready_clients_.empty()) {
+    ready_clients_.front()->client_->close();
   }
 
-  if (draining_client_) {
-    draining_client_->client_->close();
+  while (!draining_clients_.empty()) {
+    draining_clients_.front()->client_->close();
   }
 
   // Make sure all clients are destroyed before we are destroyed.
@@ -41,22 +42,15 @@ void ConnPoolImpl::checkForDrained() {
     return;
   }
 
-  bool drained = true;
-  if (primary_client_) {
-    if (primary_client_->client_->numActiveRequests() == 0) {
-      primary_client_->client_->close();
-      ASSERT(!primary_client_);
-    } else {
-      drained = false;
+  for (auto it = ready_clients_.begin(); it != ready_clients_.end();) {
+    // Closing the client removes it from the list.
+    ActiveClient& client = **it++;
+    if (client.client_->numActiveRequests() == 0) {
+      client.client_->close();
     }
   }
 
-  ASSERT(!draining_client_ || (draining_client_->client_->numActiveRequests() > 0));
-  if (draining_client_ && draining_client_->client_->numActiveRequests() > 0) {
-    drained = false;
-  }
-
-  if (drained) {
+  if (ready_clients_.empty() && draining_clients_.empty()) {
     ENVOY_LOG(debug, "invoking drained callbacks");
     for (const DrainedCb& cb : drained_callbacks_) {
       cb();
@@ -74,33 +68,88 @@ ConnectionPool::Cancellable* ConnPoolImpl::newStream(Http::StreamDecoder& respon
     max_streams = maxTotalStreams();
   }
 
-  if (primary_client_ && primary_client_->total_streams_ >= max_streams) {
-    movePrimaryClientToDraining();
-  }
-
-  if (!primary_client_) {
-    primary_client_.reset(new ActiveClient(*this));
+  for (auto it = ready_clients_.begin(); it != ready_clients_.end();) {
+    ActiveClient& client = **it++;
+    if (client.total_streams_ >= max_streams) {
+      moveClientToDraining(client);
+    }
   }
 
+  ActiveClient& client = pickClient();
   if (!host_->cluster().resourceManager(priority_).requests().canCreate()) {
     ENVOY_LOG(debug, "max requests overflow");
     callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::Overflow, nullptr);
     host_->cluster().stats().upstream_rq_pending_overflow_.inc();
   } else {
-    ENVOY_CONN_LOG(debug, "creating stream", *primary_client_->client_);
-    primary_client_->total_streams_++;
+    ENVOY_CONN_LOG(debug, "creating stream", *client.client_);
+    client.total_streams_++;
     host_->stats().rq_total_.inc();
     host_->stats().rq_active_.inc();
     host_->cluster().stats().upstream_rq_total_.inc();
     host_->cluster().stats().upstream_rq_active_.inc();
     host_->cluster().resourceManager(priority_).requests().inc();
-    callbacks.onPoolReady(primary_client_->client_->newStream(response_decoder),
-                          primary_client_->real_host_description_);
+    callbacks.onPoolReady(client.client_->newStream(response_decoder),
+                          client.real_host_description_);
   }
 
   return nullptr;
 }
 
+void ConnPoolImpl::prefetchConnections() {
+  if (!drained_callbacks_.empty()) {
+    return;
+  }
+
+  // Every connection takes many streams, so there is nothing to prefetch for requests. Only warm
+  // connections are opened, and no more than streams are spread over.
+  const uint64_t wanted =
+      std::min<uint64_t>(maxConnections(), host_->cluster().minWarmConnections());
+  while (ready_clients_.size() < wanted) {
+    ENVOY_LOG(debug, "prefetching a connection");
+    ActiveClientPtr client(new ActiveClient(*this));
+    client->moveIntoListBack(std::move(client), ready_clients_);
+  }
+}
+
+ConnPoolImpl::ActiveClient& ConnPoolImpl::pickClient() {
+  // Of the connections that have room for another stream under the limit advertised by the peer,
+  // prefer the one with the fewest active streams.
+  ActiveClient* least_active = nullptr;
+  for (const ActiveClientPtr& client : ready_clients_) {
+    const uint64_t active = client->client_->numActiveRequests();
+    if (active < client->client_->maxConcurrentStreams() &&
+        (least_active == nullptr || active < least_active->client_->numActiveRequests())) {
+      least_active = client.get();
+    }
+  }
+
+  // Open another connection rather than adding a stream to a busy one, as long as there are fewer
+  // than the maximum.
+  if (ready_clients_.size() < maxConnections() &&
+      (least_active == nullptr || least_active->client_->numActiveRequests() > 0)) {
+    ActiveClientPtr client(new ActiveClient(*this));
+    client->moveIntoListBack(std::move(client), ready_clients_);
+    return *ready_clients_.back();
+  }
+
+  if (least_active == nullptr) {
+    // Every connection is at the limit of its peer. The codec holds the stream back until one of
+    // the active streams completes, so queue it behind the fewest streams.
+    least_active = std::min_element(ready_clients_.begin(), ready_clients_.end(),
+                                    [](const ActiveClientPtr& lhs, const ActiveClientPtr& rhs) {
+                                      return lhs->client_->numActiveRequests() <
+                                             rhs->client_->numActiveRequests();
+                                    })
+                       ->get();
+  }
+
+  return *least_active;
+}
+
+uint32_t ConnPoolImpl::maxConnections() {
+  return std::max<uint32_t>(1, host_->cluster().http2Settings().max_connections_per_pool_);
+}
+
 void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEvent event) {
   if (event == Network::ConnectionEvent::RemoteClose ||
       event == Network::ConnectionEvent::LocalClose) {
@@ -114,17 +163,20 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
       }
     }
 
-    if (&client == primary_client_.get()) {
-      ENVOY_CONN_LOG(debug, "destroying primary client", *client.client_);
-      dispatcher_.deferredDelete(std::move(primary_client_));
-    } else {
+    if (client.draining_) {
       ENVOY_CONN_LOG(debug, "destroying draining client", *client.client_);
-      dispatcher_.deferredDelete(std::move(draining_client_));
+      dispatcher_.deferredDelete(client.removeFromList(draining_clients_));
+    } else {
+      ENVOY_CONN_LOG(debug, "destroying ready client", *client.client_);
+      dispatcher_.deferredDelete(client.removeFromList(ready_clients_));
     }
 
     if (client.connect_timer_) {
       host_->cluster().stats().upstream_cx_connect_fail_.inc();
       host_->stats().cx_connect_fail_.inc();
+    } else if (event == Network::ConnectionEvent::RemoteClose) {
+      // Replace a connection that the upstream closed.
+      prefetchConnections();
     }
 
     if (client.closed_with_active_rq_) {
@@ -142,25 +194,17 @@ void ConnPoolImpl::onConnectionEvent(ActiveClient& client, Network::ConnectionEv
   }
 }
 
-void ConnPoolImpl::movePrimaryClientToDraining() {
-  ENVOY_CONN_LOG(debug, "moving primary to draining", *primary_client_->client_);
-  if (draining_client_) {
-    // This should pretty much never happen, but is possible if we start draining and then get
-    // a goaway for example. In this case just kill the current draining connection. It's not
-    // worth keeping a list.
-    draining_client_->client_->close();
-  }
-
-  ASSERT(!draining_client_);
-  if (primary_client_->client_->numActiveRequests() == 0) {
-    // If we are making a new connection and the primary does not have any active requests just
-    // close it now.
-    primary_client_->client_->close();
+void ConnPoolImpl::moveClientToDraining(ActiveClient& client) {
+  ENVOY_CONN_LOG(debug, "moving client to draining", *client.client_);
+  ASSERT(!client.draining_);
+  if (client.client_->numActiveRequests() == 0) {
+    // If the client does not have any active requests there is nothing to wait for, so just close
+    // it now.
+    client.client_->close();
   } else {
-    draining_client_ = std::move(primary_client_);
+    client.draining_ = true;
+    client.moveBetweenLists(ready_clients_, draining_clients_);
   }
-
-  ASSERT(!primary_client_);
 }
 
 void ConnPoolImpl::onConnectTimeout(ActiveClient& client) {
@@ -172,8 +216,8 @@ void ConnPoolImpl::onConnectTimeout(ActiveClient& client) {
 void ConnPoolImpl::onGoAway(ActiveClient& client) {
   ENVOY_CONN_LOG(debug, "remote goaway", *client.client_);
   host_->cluster().stats().upstream_cx_close_notify_.inc();
-  if (&client == primary_client_.get()) {
-    movePrimaryClientToDraining();
+  if (!client.draining_) {
+    moveClientToDraining(client);
   }
 }
 
@@ -183,7 +227,7 @@ void ConnPoolImpl::onStreamDestroy(ActiveClient& client) {
   host_->stats().rq_active_.dec();
   host_->cluster().stats().upstream_rq_active_.dec();
   host_->cluster().resourceManager(priority_).requests().dec();
-  if (&client == draining_client_.get() && client.client_->numActiveRequests() == 0) {
+  if (client.draining_ && client.client_->numActiveRequests() == 0) {
     // Close out the draining client if we no long have active requests.
     client.client_->close();
   }
@@ -210,7 +254,8 @@ void ConnPoolImpl::onStreamReset(ActiveClient& client, Http::StreamResetReason r
 
 ConnPoolImpl::ActiveClient::ActiveClient(ConnPoolImpl& parent)
     : parent_(parent),
-      connect_timer_(parent_.dispatcher_.createTimer([this]() -> void { onConnectTimeout(); })) {
+      connect_timer_(
+          parent_.dispatcher_.createCoarseTimer([this]() -> void { onConnectTimeout(); })) {
 
   parent_.conn_connect_ms_ =
       parent_.host_->cluster().stats().upstream_cx_connect_ms_.allocateSpan();
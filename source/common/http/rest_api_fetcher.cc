@@ -13,9 +13,10 @@ namespace Http {
 
 RestApiFetcher::RestApiFetcher(Upstream::ClusterManager& cm, const std::string& remote_cluster_name,
                                Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random,
-                               std::chrono::milliseconds refresh_interval)
+                               std::chrono::milliseconds refresh_interval,
+                               const std::string& caller)
     : remote_cluster_name_(remote_cluster_name), cm_(cm), random_(random),
-      refresh_interval_(refresh_interval),
+      refresh_interval_(refresh_interval), caller_(caller),
       refresh_timer_(dispatcher.createTimer([this]() -> void { refresh(); })) {}
 
 RestApiFetcher::~RestApiFetcher() {
@@ -51,9 +52,9 @@ void RestApiFetcher::refresh() {
   MessagePtr message(new RequestMessageImpl());
   createRequest(*message);
   message->headers().insertHost().value(remote_cluster_name_);
+  const Optional<std::chrono::milliseconds> timeout(std::chrono::milliseconds(1000));
   active_request_ = cm_.httpAsyncClientForCluster(remote_cluster_name_)
-                        .send(std::move(message), *this,
-                              Optional<std::chrono::milliseconds>(std::chrono::milliseconds(1000)));
+                        .sendDirect(std::move(message), *this, timeout, caller_);
 }
 
 void RestApiFetcher::requestComplete() {
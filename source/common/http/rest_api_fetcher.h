@@ -12,13 +12,14 @@ namespace Http {
 
 /**
  * A helper base class used to fetch a REST API at a jittered periodic interval. Once initialize()
- * is called, the API will be fetched and events raised.
+ * is called, the API will be fetched and events raised. Fetches go straight to a connection pool of
+ * the remote cluster and are counted in its async_client.<caller>. stats.
  */
 class RestApiFetcher : public Http::AsyncClient::Callbacks {
 protected:
   RestApiFetcher(Upstream::ClusterManager& cm, const std::string& remote_cluster_name,
                  Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random,
-                 std::chrono::milliseconds refresh_interval);
+                 std::chrono::milliseconds refresh_interval, const std::string& caller);
   ~RestApiFetcher();
 
   /**
@@ -63,6 +64,7 @@ private:
 
   Runtime::RandomGenerator& random_;
   const std::chrono::milliseconds refresh_interval_;
+  const std::string caller_;
   Event::TimerPtr refresh_timer_;
   Http::AsyncClient::Request* active_request_{};
 };
@@ -1,7 +1,9 @@
 #include "common/http/utility.h"
 
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "envoy/http/header_map.h"
@@ -22,6 +24,55 @@
 namespace Envoy {
 namespace Http {
 
+namespace {
+
+// The parts of a local reply that all replies with the same code and body share. They are
+// formatted once per thread and referenced by each reply instead of being copied into it.
+struct LocalReplyTemplate {
+  LocalReplyTemplate(Code code, const std::string& body)
+      : status_(std::to_string(enumToInt(code))), content_length_(std::to_string(body.size())),
+        body_(body), body_fragment_(body_.data(), body_.size(), nullptr) {}
+
+  const std::string status_;
+  const std::string content_length_;
+  const std::string body_;
+  // The template outlives the buffers of the replies sent on its thread, so the fragment is shared
+  // by all of them and never released.
+  Buffer::BufferFragmentImpl body_fragment_;
+};
+
+// Local replies with bodies that carry details of the error would otherwise grow the templates
+// without bound. Replies beyond this are formatted from scratch.
+const size_t MAX_LOCAL_REPLY_TEMPLATES = 128;
+
+/**
+ * @return LocalReplyTemplate* the template of this thread for a local reply, or nullptr if there
+ *         are too many templates already.
+ */
+LocalReplyTemplate* localReplyTemplate(Code code, const std::string& body) {
+  static thread_local std::unordered_map<
+      uint32_t, std::unordered_map<std::string, std::unique_ptr<LocalReplyTemplate>>>
+      templates;
+  static thread_local size_t num_templates = 0;
+
+  auto& templates_for_code = templates[enumToInt(code)];
+  auto it = templates_for_code.find(body);
+  if (it != templates_for_code.end()) {
+    return it->second.get();
+  }
+
+  if (num_templates == MAX_LOCAL_REPLY_TEMPLATES) {
+    return nullptr;
+  }
+
+  num_templates++;
+  LocalReplyTemplate* reply_template = new LocalReplyTemplate(code, body);
+  templates_for_code.emplace(body, std::unique_ptr<LocalReplyTemplate>(reply_template));
+  return reply_template;
+}
+
+} // namespace
+
 void Utility::appendXff(HeaderMap& headers, const Network::Address::Instance& remote_address) {
   if (remote_address.type() != Network::Address::Type::Ip) {
     return;
@@ -58,7 +109,7 @@ Utility::QueryParams Utility::parseQueryString(const std::string& url) {
     }
 
     size_t equal = url.find('=', start);
-    if (equal != std::string::npos) {
+    if (equal != std::string::npos && equal < end) {
       params.emplace(StringUtil::subspan(url, start, equal),
                      StringUtil::subspan(url, equal + 1, end));
     } else {
@@ -86,27 +137,28 @@ std::string Utility::parseCookieValue(const HeaderMap& headers, const std::strin
         // Find the cookie headers in the request (typically, there's only one).
         if (header.key() == Http::Headers::get().Cookie.get().c_str()) {
           // Split the cookie header into individual cookies.
-          for (const std::string& s : StringUtil::split(std::string{header.value().c_str()}, ';')) {
+          for (StringView s : StringUtil::splitToViews(header.value().getStringView(), ';')) {
             // Find the key part of the cookie (i.e. the name of the cookie).
-            size_t first_non_space = s.find_first_not_of(" ");
+            while (!s.empty() && s[0] == ' ') {
+              s.removePrefix(1);
+            }
             size_t equals_index = s.find('=');
-            if (equals_index == std::string::npos) {
+            if (equals_index == StringView::npos) {
               // The cookie is malformed if it does not have an `=`. Continue
               // checking other cookies in this header.
               continue;
             }
-            std::string k = s.substr(first_non_space, equals_index - first_non_space);
             State* state = static_cast<State*>(context);
             // If the key matches, parse the value from the rest of the cookie string.
-            if (k == state->key_) {
-              std::string v = s.substr(equals_index + 1, s.size() - 1);
+            if (s.substr(0, equals_index) == state->key_) {
+              StringView v = s.substr(equals_index + 1);
 
               // Cookie values may be wrapped in double quotes.
               // https://tools.ietf.org/html/rfc6265#section-4.1.1
-              if (v.size() >= 2 && v.back() == '"' && v[0] == '"') {
+              if (v.size() >= 2 && v[v.size() - 1] == '"' && v[0] == '"') {
                 v = v.substr(1, v.size() - 2);
               }
-              state->ret_ = v;
+              state->ret_ = v.toString();
               return;
             }
           }
@@ -127,6 +179,17 @@ uint64_t Utility::getResponseStatus(const HeaderMap& headers) {
   return response_code;
 }
 
+void Utility::appendHeaderValues(const HeaderMap& headers,
+                                 const std::vector<LowerCaseString>& names, std::string& key) {
+  for (const LowerCaseString& name : names) {
+    const HeaderEntry* header = headers.get(name);
+    key += "\n";
+    if (header != nullptr) {
+      key += std::string("=") + header->value().c_str();
+    }
+  }
+}
+
 bool Utility::isInternalRequest(const HeaderMap& headers) {
   // The current header
   const HeaderEntry* forwarded_for = headers.ForwardedFor();
@@ -151,6 +214,11 @@ Http2Settings Utility::parseHttp2Settings(const envoy::api::v2::Http2ProtocolOpt
   Http2Settings ret;
   ret.hpack_table_size_ = PROTOBUF_GET_WRAPPED_OR_DEFAULT(
       config, hpack_table_size, Http::Http2Settings::DEFAULT_HPACK_TABLE_SIZE);
+  // Bound the memory used by our encoder the same way as the memory used by the peer's.
+  ret.hpack_encoder_table_size_ = ret.hpack_table_size_;
+  ret.never_index_headers_ = {Headers::get().RequestId.get(), Headers::get().OtSpanContext.get(),
+                              Headers::get().XB3TraceId.get(), Headers::get().XB3SpanId.get(),
+                              Headers::get().XB3ParentSpanId.get()};
   ret.max_concurrent_streams_ = PROTOBUF_GET_WRAPPED_OR_DEFAULT(
       config, max_concurrent_streams, Http::Http2Settings::DEFAULT_MAX_CONCURRENT_STREAMS);
   ret.initial_stream_window_size_ = PROTOBUF_GET_WRAPPED_OR_DEFAULT(
@@ -168,17 +236,44 @@ Http1Settings Utility::parseHttp1Settings(const envoy::api::v2::Http1ProtocolOpt
 }
 
 void Utility::sendLocalReply(StreamDecoderFilterCallbacks& callbacks, const bool& is_reset,
-                             Code response_code, const std::string& body_text) {
-  HeaderMapPtr response_headers{
-      new HeaderMapImpl{{Headers::get().Status, std::to_string(enumToInt(response_code))}}};
+                             Code response_code, std::string body_text) {
+  // Incidents can make the same few local replies very frequent, so their header values and body
+  // are only formatted the first time.
+  LocalReplyTemplate* reply_template = localReplyTemplate(response_code, body_text);
+  HeaderMapPtr response_headers{new HeaderMapImpl()};
+  if (reply_template != nullptr) {
+    response_headers->insertStatus().value().setReference(reply_template->status_);
+    if (!body_text.empty()) {
+      response_headers->insertContentLength().value().setReference(
+          reply_template->content_length_);
+    }
+  } else {
+    response_headers->insertStatus().value(enumToInt(response_code));
+    if (!body_text.empty()) {
+      response_headers->insertContentLength().value(body_text.size());
+    }
+  }
   if (!body_text.empty()) {
-    response_headers->insertContentLength().value(body_text.size());
-    response_headers->insertContentType().value(Headers::get().ContentTypeValues.Text);
+    response_headers->insertContentType().value().setReference(
+        Headers::get().ContentTypeValues.Text);
   }
 
   callbacks.encodeHeaders(std::move(response_headers), body_text.empty());
   if (!body_text.empty() && !is_reset) {
-    Buffer::OwnedImpl buffer(body_text);
+    Buffer::OwnedImpl buffer;
+    if (reply_template != nullptr) {
+      buffer.addBufferFragment(reply_template->body_fragment_);
+    } else {
+      // Hand the body over as a fragment that owns the text so that it is not copied again on its
+      // way to the connection.
+      std::string* body = new std::string(std::move(body_text));
+      buffer.addBufferFragment(*new Buffer::BufferFragmentImpl(
+          body->data(), body->size(),
+          [body](const void*, size_t, const Buffer::BufferFragmentImpl* fragment) {
+            delete body;
+            delete fragment;
+          }));
+    }
     // TODO(htuch): We shouldn't encodeData() if the stream is reset in the encodeHeaders() above,
     // see https://github.com/lyft/envoy/issues/1283.
     callbacks.encodeData(buffer, true);
@@ -198,13 +293,18 @@ std::string Utility::getLastAddressFromXFF(const Http::HeaderMap& request_header
     return EMPTY_STRING;
   }
 
-  std::vector<std::string> xff_address_list =
-      StringUtil::split(request_headers.ForwardedFor()->value().c_str(), ", ");
-
-  if (xff_address_list.empty()) {
-    return EMPTY_STRING;
+  // The last address is what follows the last ", ", ignoring empty entries, e.g. a trailing ", ".
+  static const StringView separator(", ");
+  StringView xff = request_headers.ForwardedFor()->value().getStringView();
+  while (xff.size() >= separator.size() &&
+         xff.substr(xff.size() - separator.size()) == separator) {
+    xff.removeSuffix(separator.size());
+  }
+  const size_t last_separator = xff.rfind(separator);
+  if (last_separator != StringView::npos) {
+    xff.removePrefix(last_separator + separator.size());
   }
-  return xff_address_list.back();
+  return xff.toString();
 }
 
 } // namespace Http
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/http/codes.h"
 #include "envoy/http/filter.h"
@@ -56,6 +57,16 @@ public:
    */
   static uint64_t getResponseStatus(const HeaderMap& headers);
 
+  /**
+   * Append the values of headers to a key that identifies requests, one line per header. A
+   * present but empty header is distinct from an absent one.
+   * @param headers supplies the headers to get the values from.
+   * @param names supplies the names of the headers.
+   * @param key supplies the key to append to.
+   */
+  static void appendHeaderValues(const HeaderMap& headers,
+                                 const std::vector<LowerCaseString>& names, std::string& key);
+
   /**
    * Determine whether this is an internal origin request by parsing out x-forwarded-for from
    * HTTP headers. Currently this returns true IFF the following holds true:
@@ -96,7 +107,7 @@ public:
    *                  type.
    */
   static void sendLocalReply(StreamDecoderFilterCallbacks& callbacks, const bool& is_reset,
-                             Code response_code, const std::string& body_text);
+                             Code response_code, std::string body_text);
 
   /**
    * Send a redirect response (301).
@@ -1,5 +1,6 @@
 #include "common/http/websocket/ws_handler_impl.h"
 
+#include "envoy/event/dispatcher.h"
 #include "envoy/network/connection.h"
 
 #include "common/common/enum_to_int.h"
@@ -16,12 +17,39 @@ namespace WebSocket {
 WsHandlerImpl::WsHandlerImpl(HeaderMap& request_headers, const Router::RouteEntry& route_entry,
                              WsHandlerCallbacks& callbacks,
                              Upstream::ClusterManager& cluster_manager,
-                             Network::ReadFilterCallbacks* read_callbacks)
+                             Network::ReadFilterCallbacks* read_callbacks,
+                             const WsSettings& settings)
     : Filter::TcpProxy(nullptr, cluster_manager), request_headers_(request_headers),
-      route_entry_(route_entry), ws_callbacks_(callbacks) {
+      route_entry_(route_entry), ws_callbacks_(callbacks), settings_(settings) {
 
   read_callbacks_ = read_callbacks;
   read_callbacks_->connection().addConnectionCallbacks(downstream_callbacks_);
+
+  Event::Dispatcher& dispatcher = read_callbacks_->connection().dispatcher();
+  active_gauge_ = dispatcher.gauge("websocket_active");
+  buffered_bytes_gauge_ = dispatcher.gauge("websocket_buffered_bytes");
+  if (active_gauge_ != nullptr) {
+    active_gauge_->inc();
+  }
+}
+
+WsHandlerImpl::~WsHandlerImpl() {
+  if (active_gauge_ != nullptr) {
+    active_gauge_->dec();
+  }
+  if (buffered_bytes_gauge_ != nullptr) {
+    buffered_bytes_gauge_->sub(reported_buffered_bytes_);
+  }
+}
+
+Network::FilterStatus WsHandlerImpl::onData(Buffer::Instance& data) {
+  active_ = true;
+  return TcpProxy::onData(data);
+}
+
+void WsHandlerImpl::onUpstreamData(Buffer::Instance& data) {
+  active_ = true;
+  TcpProxy::onUpstreamData(data);
 }
 
 void WsHandlerImpl::onInitFailure() {
@@ -78,6 +106,33 @@ void WsHandlerImpl::onConnectionSuccess() {
   Http1::ClientConnectionImpl upstream_http(*upstream_connection_, http_conn_callbacks_);
   Http1::RequestStreamEncoderImpl upstream_request = Http1::RequestStreamEncoderImpl(upstream_http);
   upstream_request.encodeHeaders(request_headers_, false);
+
+  if (settings_.buffer_idle_timeout_.count() > 0) {
+    idle_timer_ = read_callbacks_->connection().dispatcher().createCoarseTimer(
+        [this]() -> void { onIdleTimer(); });
+    idle_timer_->enableTimer(settings_.buffer_idle_timeout_);
+  }
+}
+
+void WsHandlerImpl::onIdleTimer() {
+  // Spliced data never goes through the buffers, so spliced connections always look idle here.
+  Network::Connection& downstream_connection = read_callbacks_->connection();
+  if (!active_) {
+    ENVOY_CONN_LOG(trace, "shrinking idle websocket buffers", downstream_connection);
+    downstream_connection.shrinkBuffers();
+    upstream_connection_->shrinkBuffers();
+  }
+  active_ = false;
+
+  if (buffered_bytes_gauge_ != nullptr) {
+    const uint64_t buffered_bytes =
+        downstream_connection.bufferedBytes() + upstream_connection_->bufferedBytes();
+    buffered_bytes_gauge_->add(buffered_bytes);
+    buffered_bytes_gauge_->sub(reported_buffered_bytes_);
+    reported_buffered_bytes_ = buffered_bytes;
+  }
+
+  idle_timer_->enableTimer(settings_.buffer_idle_timeout_);
 }
 
 } // namespace WebSocket
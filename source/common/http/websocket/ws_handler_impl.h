@@ -1,12 +1,16 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <string>
 
+#include "envoy/event/timer.h"
 #include "envoy/http/codec.h"
 #include "envoy/http/header_map.h"
 #include "envoy/http/websocket.h"
 #include "envoy/network/filter.h"
 #include "envoy/router/router.h"
+#include "envoy/stats/stats.h"
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/filter/tcp_proxy.h"
@@ -15,6 +19,19 @@ namespace Envoy {
 namespace Http {
 namespace WebSocket {
 
+/**
+ * Settings that cut the per connection cost of WebSocket connections, which tend to be long lived
+ * and mostly idle.
+ */
+struct WsSettings {
+  // Splice data between the downstream and upstream sockets once the upstream connects, rather
+  // than copying it through the connection buffers. @see Network::Connection::spliceTo().
+  bool splice_;
+  // How long no data may flow through either connection before their buffers release the memory
+  // they keep around, or 0 to keep it.
+  std::chrono::milliseconds buffer_idle_timeout_;
+};
+
 /**
  * An implementation of a WebSocket proxy based on TCP proxy. This will be used for
  * handling client connection only after a WebSocket upgrade request succeeds
@@ -22,12 +39,20 @@ namespace WebSocket {
  * instantiate a new outgoing TCP connection for the configured upstream cluster.
  * All data will be proxied back and forth between the two connections, without any
  * knowledge of the underlying WebSocket protocol.
+ *
+ * The number of WebSocket connections on a worker and the bytes buffered by them are reported as
+ * the websocket_active and websocket_buffered_bytes gauges of the worker's dispatcher. The buffered
+ * bytes are sampled every buffer idle timeout.
  */
 class WsHandlerImpl : public Filter::TcpProxy {
 public:
   WsHandlerImpl(HeaderMap& request_headers, const Router::RouteEntry& route_entry,
                 WsHandlerCallbacks& callbacks, Upstream::ClusterManager& cluster_manager,
-                Network::ReadFilterCallbacks* read_callbacks);
+                Network::ReadFilterCallbacks* read_callbacks, const WsSettings& settings);
+  ~WsHandlerImpl();
+
+  // Network::ReadFilter
+  Network::FilterStatus onData(Buffer::Instance& data) override;
 
 protected:
   // Filter::TcpProxy
@@ -38,6 +63,8 @@ protected:
   void onConnectTimeoutError() override;
   void onConnectionFailure() override;
   void onConnectionSuccess() override;
+  bool shouldSplice() override { return settings_.splice_; }
+  void onUpstreamData(Buffer::Instance& data) override;
 
 private:
   struct NullHttpConnectionCallbacks : public ConnectionCallbacks {
@@ -45,10 +72,20 @@ private:
     void onGoAway() override {}
   };
 
+  void onIdleTimer();
+
   HeaderMap& request_headers_;
   const Router::RouteEntry& route_entry_;
   WsHandlerCallbacks& ws_callbacks_;
   NullHttpConnectionCallbacks http_conn_callbacks_;
+  const WsSettings settings_;
+  Event::TimerPtr idle_timer_;
+  // Whether data has flowed since the idle timer was last enabled.
+  bool active_{};
+  Stats::Gauge* active_gauge_{};
+  Stats::Gauge* buffered_bytes_gauge_{};
+  // The buffered bytes last added to buffered_bytes_gauge_.
+  uint64_t reported_buffered_bytes_{};
 };
 
 typedef std::unique_ptr<WsHandlerImpl> WsHandlerImplPtr;
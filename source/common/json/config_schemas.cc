@@ -24,7 +24,22 @@ const std::string Json::Schema::LISTENER_SCHEMA(R"EOF(
             }
           },
           "cipher_suites" : {"type" : "string", "minLength" : 1},
-          "ecdh_curves" : {"type" : "string", "minLength" : 1}
+          "ecdh_curves" : {"type" : "string", "minLength" : 1},
+          "session_ticket_key_paths" : {
+            "type" : "array",
+            "items" : {
+              "type" : "string"
+            }
+          },
+          "private_key_method" : {
+            "type" : "object",
+            "properties" : {
+              "name" : {"type" : "string"},
+              "config" : {"type" : "object"}
+            },
+            "required" : ["name"],
+            "additionalProperties" : false
+          }
         },
         "required": ["cert_chain_file", "private_key_file"],
         "additionalProperties": false
@@ -378,6 +393,18 @@ const std::string Json::Schema::MONGO_PROXY_NETWORK_FILTER_SCHEMA(R"EOF(
         },
         "required": ["fixed_delay"],
         "additionalProperties" : false
+      },
+      "multiplex" : {
+        "type" : "object",
+        "properties" : {
+          "cluster_name" : {"type" : "string"},
+          "connections" : {
+            "type" : "integer",
+            "minimum" : 1
+          }
+        },
+        "required" : ["cluster_name"],
+        "additionalProperties" : false
       }
     },
     "required": ["stat_prefix"],
@@ -413,13 +440,72 @@ const std::string Json::Schema::RATELIMIT_NETWORK_FILTER_SCHEMA(R"EOF(
         "type" : "integer",
         "minimum" : 0,
         "exclusiveMinimum" : true
-      }
+      },
+      "local_rate_limit" : {"type" : "object"}
     },
     "required": ["stat_prefix", "descriptors", "domain"],
     "additionalProperties": false
   }
   )EOF");
 
+const std::string Json::Schema::LOCAL_RATE_LIMIT_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties":{
+      "mode" : {
+        "type" : "string",
+        "enum" : ["local", "prefilter", "report"]
+      },
+      "near_limit_ratio" : {
+        "type" : "number",
+        "minimum" : 0,
+        "maximum" : 1
+      },
+      "shared" : {"type" : "boolean"},
+      "buckets" : {
+        "type" : "array",
+        "items" : {
+          "type" : "object",
+          "properties" : {
+            "descriptor" : {
+              "type" : "array",
+              "minItems" : 1,
+              "items" : {
+                "type" : "object",
+                "properties" : {
+                  "key" : {"type" : "string"},
+                  "value" : {"type" : "string"}
+                },
+                "required" : ["key", "value"],
+                "additionalProperties" : false
+              }
+            },
+            "max_tokens" : {
+              "type" : "integer",
+              "minimum" : 1,
+              "maximum" : 4294967295
+            },
+            "tokens_per_fill" : {
+              "type" : "integer",
+              "minimum" : 1,
+              "maximum" : 4294967295
+            },
+            "fill_interval_ms" : {
+              "type" : "integer",
+              "minimum" : 1
+            }
+          },
+          "required" : ["descriptor", "max_tokens", "fill_interval_ms"],
+          "additionalProperties" : false
+        }
+      }
+    },
+    "required": ["buckets"],
+    "additionalProperties": false
+  }
+  )EOF");
+
 const std::string Json::Schema::REDIS_PROXY_NETWORK_FILTER_SCHEMA(R"EOF(
   {
     "$schema": "http://json-schema.org/schema#",
@@ -427,7 +513,24 @@ const std::string Json::Schema::REDIS_PROXY_NETWORK_FILTER_SCHEMA(R"EOF(
     "properties":{
       "cluster_name" : {"type" : "string"},
       "stat_prefix" : {"type" : "string"},
-      "conn_pool" : {"type" : "object"}
+      "conn_pool" : {"type" : "object"},
+      "cache" : {"type" : "object"},
+      "slow_command_log" : {
+        "type" : "object",
+        "properties" : {
+          "threshold_ms" : {
+            "type" : "integer",
+            "minimum" : 0,
+            "exclusiveMinimum" : true
+          },
+          "sample_one_in" : {
+            "type" : "integer",
+            "minimum" : 1
+          }
+        },
+        "required" : ["threshold_ms"],
+        "additionalProperties" : false
+      }
     },
     "required": ["cluster_name", "stat_prefix", "conn_pool"],
     "additionalProperties": false
@@ -443,6 +546,19 @@ const std::string Json::Schema::REDIS_CONN_POOL_SCHEMA(R"EOF(
         "type" : "integer",
         "minimum" : 0,
         "exclusiveMinimum" : true
+      },
+      "max_batch_requests" : {
+        "type" : "integer",
+        "minimum" : 0
+      },
+      "max_batch_bytes" : {
+        "type" : "integer",
+        "minimum" : 0
+      },
+      "cluster_mode" : {"type" : "boolean"},
+      "read_policy" : {
+        "type" : "string",
+        "enum" : ["master", "prefer_replica", "replica", "any"]
       }
     },
     "required": ["op_timeout_ms"],
@@ -450,6 +566,44 @@ const std::string Json::Schema::REDIS_CONN_POOL_SCHEMA(R"EOF(
   }
   )EOF");
 
+const std::string Json::Schema::REDIS_KEY_CACHE_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties":{
+      "max_entries" : {
+        "type" : "integer",
+        "minimum" : 1
+      },
+      "ttl_ms" : {
+        "type" : "integer",
+        "minimum" : 1
+      },
+      "key_prefixes" : {
+        "type" : "array",
+        "items" : {"type" : "string"}
+      },
+      "hot_keys" : {
+        "type" : "object",
+        "properties" : {
+          "sample_rate" : {
+            "type" : "integer",
+            "minimum" : 1
+          },
+          "top_k" : {
+            "type" : "integer",
+            "minimum" : 1
+          }
+        },
+        "required" : ["top_k"],
+        "additionalProperties" : false
+      }
+    },
+    "required": ["max_entries", "ttl_ms"],
+    "additionalProperties": false
+  }
+  )EOF");
+
 const std::string Json::Schema::TCP_PROXY_NETWORK_FILTER_SCHEMA(R"EOF(
   {
       "$schema": "http://json-schema.org/schema#",
@@ -495,7 +649,8 @@ const std::string Json::Schema::TCP_PROXY_NETWORK_FILTER_SCHEMA(R"EOF(
             }
           },
           "additionalProperties": false
-        }
+        },
+        "splice": {"type": "boolean"}
       },
       "required": ["stat_prefix", "route_config"],
       "additionalProperties": false
@@ -714,6 +869,10 @@ const std::string Json::Schema::ROUTE_ENTRY_CONFIGURATION_SCHEMA(R"EOF(
       "opaque_config" : {
         "type" : "object",
         "additionalProperties" : true
+      },
+      "metadata_match" : {
+        "type" : "object",
+        "additionalProperties" : {"type" : "string"}
       }
     },
     "additionalProperties" : false
@@ -851,13 +1010,78 @@ const std::string Json::Schema::BUFFER_HTTP_FILTER_SCHEMA(R"EOF(
     "type" : "object",
     "properties" : {
       "max_request_bytes" : {"type" : "integer"},
-      "max_request_time_s" : {"type" : "integer"}
+      "max_request_time_s" : {"type" : "integer"},
+      "max_request_memory_bytes" : {"type" : "integer", "minimum" : 0},
+      "spill_directory" : {"type" : "string", "minLength" : 1},
+      "max_total_memory_bytes" : {"type" : "integer", "minimum" : 0}
     },
     "required" : ["max_request_bytes", "max_request_time_s"],
     "additionalProperties" : false
   }
   )EOF");
 
+const std::string Json::Schema::CACHE_HTTP_FILTER_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties" : {
+      "max_bytes_per_worker" : {"type" : "integer", "minimum" : 0},
+      "max_entry_bytes" : {"type" : "integer", "minimum" : 0}
+    },
+    "additionalProperties" : false
+  }
+  )EOF");
+
+const std::string Json::Schema::COLLAPSE_HTTP_FILTER_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties" : {
+      "headers" : {
+        "type" : "array",
+        "items" : {"type" : "string", "minLength" : 1},
+        "uniqueItems" : true
+      },
+      "max_wait_ms" : {"type" : "integer", "minimum" : 0}
+    },
+    "additionalProperties" : false
+  }
+  )EOF");
+
+const std::string Json::Schema::EXT_AUTHZ_HTTP_FILTER_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "definitions" : {
+      "headers" : {
+        "type" : "array",
+        "items" : {"type" : "string", "minLength" : 1},
+        "uniqueItems" : true
+      }
+    },
+    "type" : "object",
+    "properties" : {
+      "cluster" : {"type" : "string", "minLength" : 1},
+      "timeout_ms" : {"type" : "integer", "minimum" : 0, "exclusiveMinimum" : true},
+      "path_prefix" : {"type" : "string"},
+      "headers" : {"$ref" : "#/definitions/headers"},
+      "failure_mode_allow" : {"type" : "boolean"},
+      "cache" : {
+        "type" : "object",
+        "properties" : {
+          "key_headers" : {"$ref" : "#/definitions/headers"},
+          "allow_ttl_ms" : {"type" : "integer", "minimum" : 0},
+          "deny_ttl_ms" : {"type" : "integer", "minimum" : 0},
+          "max_entries_per_worker" : {"type" : "integer", "minimum" : 0}
+        },
+        "required" : ["key_headers"],
+        "additionalProperties" : false
+      }
+    },
+    "required" : ["cluster"],
+    "additionalProperties" : false
+  }
+  )EOF");
+
 const std::string Json::Schema::FAULT_HTTP_FILTER_SCHEMA(R"EOF(
   {
     "$schema": "http://json-schema.org/schema#",
@@ -942,13 +1166,33 @@ const std::string Json::Schema::GRPC_JSON_TRANSCODER_FILTER_SCHEMA(R"EOF(
           "preserve_proto_field_names": {"type" : "boolean"}
         },
         "additionalProperties" : false
-      }
+      },
+      "max_buffered_response_bytes" : {"type" : "integer", "minimum" : 0}
     },
     "required" : ["proto_descriptor", "services"],
     "additionalProperties" : false
   }
   )EOF");
 
+const std::string Json::Schema::GZIP_HTTP_FILTER_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties" : {
+      "compression_level" : {"type" : "integer", "minimum" : 1, "maximum" : 9},
+      "window_bits" : {"type" : "integer", "minimum" : 9, "maximum" : 15},
+      "memory_level" : {"type" : "integer", "minimum" : 1, "maximum" : 9},
+      "min_content_length" : {"type" : "integer", "minimum" : 0},
+      "content_types" : {
+        "type" : "array",
+        "uniqueItems" : true,
+        "items" : {"type" : "string"}
+      }
+    },
+    "additionalProperties" : false
+  }
+  )EOF");
+
 const std::string Json::Schema::IP_TAGGING_HTTP_FILTER_SCHEMA(R"EOF(
   {
     "$schema": "http://json-schema.org/schema#",
@@ -958,6 +1202,7 @@ const std::string Json::Schema::IP_TAGGING_HTTP_FILTER_SCHEMA(R"EOF(
         "type" : "string",
         "enum" : ["internal", "external", "both"]
       },
+      "ip_tags_path" : {"type" : "string"},
       "ip_tags" : {
         "type" : "array",
         "minItems" : 1,
@@ -982,6 +1227,32 @@ const std::string Json::Schema::IP_TAGGING_HTTP_FILTER_SCHEMA(R"EOF(
   }
   )EOF");
 
+const std::string Json::Schema::IP_TAGS_FILE_SCHEMA(R"EOF(
+  {
+    "$schema": "http://json-schema.org/schema#",
+    "type" : "object",
+    "properties" : {
+      "ip_tags" : {
+        "type" : "array",
+        "items" : {
+          "type" : "object",
+          "properties" : {
+            "ip_tag_name" : { "type" : "string" },
+            "ip_list" : {
+              "type" : "array",
+              "items" : { "type" : "string" }
+            }
+          },
+          "required" : ["ip_tag_name", "ip_list"],
+          "additionalProperties" : false
+        }
+      }
+    },
+    "required" : ["ip_tags"],
+    "additionalProperties" : false
+  }
+  )EOF");
+
 const std::string Json::Schema::HEALTH_CHECK_HTTP_FILTER_SCHEMA(R"EOF(
   {
     "$schema": "http://json-schema.org/schema#",
@@ -989,7 +1260,15 @@ const std::string Json::Schema::HEALTH_CHECK_HTTP_FILTER_SCHEMA(R"EOF(
     "properties" : {
       "pass_through_mode" : {"type" : "boolean"},
       "endpoint" : {"type" : "string"},
-      "cache_time_ms" : {"type" : "integer"}
+      "cache_time_ms" : {"type" : "integer"},
+      "cluster_min_healthy_percentages" : {
+        "type" : "object",
+        "additionalProperties" : {
+          "type" : "integer",
+          "minimum" : 0,
+          "maximum" : 100
+        }
+      }
     },
     "required" : ["pass_through_mode", "endpoint"],
     "additionalProperties" : false
@@ -1015,7 +1294,8 @@ const std::string Json::Schema::RATE_LIMIT_HTTP_FILTER_SCHEMA(R"EOF(
         "type" : "integer",
         "minimum" : 0,
         "exclusiveMinimum" : true
-      }
+      },
+      "local_rate_limit" : {"type" : "object"}
     },
     "required" : ["domain"],
     "additionalProperties" : false
@@ -1155,7 +1435,8 @@ const std::string Json::Schema::TOP_LEVEL_CONFIG_SCHEMA(R"EOF(
             "type" : "object",
             "properties" : {
               "collector_cluster" : {"type" : "string"},
-              "collector_endpoint": {"type": "string"}
+              "collector_endpoint": {"type": "string"},
+              "collector_encoding": {"type": "string", "enum": ["json", "proto"]}
             },
             "required": ["collector_cluster"],
             "additionalProperties" : false
@@ -1204,7 +1485,9 @@ const std::string Json::Schema::TOP_LEVEL_CONFIG_SCHEMA(R"EOF(
       "cluster_manager" : {"type" : "object"},
       "flags_path" : {"type" : "string"},
       "statsd_udp_ip_address" : {"type" : "string"},
+      "statsd_udp_max_packet_size" : {"type" : "integer", "minimum" : 0},
       "statsd_tcp_cluster_name" : {"type" : "string"},
+      "metrics_service_cluster_name" : {"type" : "string"},
       "stats_flush_interval_ms" : {"type" : "integer"},
       "watchdog_miss_timeout_ms" : {"type" : "integer"},
       "watchdog_megamiss_timeout_ms" : {"type" : "integer"},
@@ -20,6 +20,7 @@ public:
   static const std::string HTTP_CONN_NETWORK_FILTER_SCHEMA;
   static const std::string MONGO_PROXY_NETWORK_FILTER_SCHEMA;
   static const std::string RATELIMIT_NETWORK_FILTER_SCHEMA;
+  static const std::string LOCAL_RATE_LIMIT_SCHEMA;
   static const std::string REDIS_PROXY_NETWORK_FILTER_SCHEMA;
   static const std::string TCP_PROXY_NETWORK_FILTER_SCHEMA;
 
@@ -33,10 +34,15 @@ public:
 
   // HTTP Filter Schemas
   static const std::string BUFFER_HTTP_FILTER_SCHEMA;
+  static const std::string CACHE_HTTP_FILTER_SCHEMA;
+  static const std::string COLLAPSE_HTTP_FILTER_SCHEMA;
+  static const std::string EXT_AUTHZ_HTTP_FILTER_SCHEMA;
   static const std::string FAULT_HTTP_FILTER_SCHEMA;
   static const std::string GRPC_JSON_TRANSCODER_FILTER_SCHEMA;
+  static const std::string GZIP_HTTP_FILTER_SCHEMA;
   static const std::string HEALTH_CHECK_HTTP_FILTER_SCHEMA;
   static const std::string IP_TAGGING_HTTP_FILTER_SCHEMA;
+  static const std::string IP_TAGS_FILE_SCHEMA;
   static const std::string RATE_LIMIT_HTTP_FILTER_SCHEMA;
   static const std::string ROUTER_HTTP_FILTER_SCHEMA;
 
@@ -51,6 +57,7 @@ public:
 
   // Redis Schemas
   static const std::string REDIS_CONN_POOL_SCHEMA;
+  static const std::string REDIS_KEY_CACHE_SCHEMA;
 };
 
 } // namespace Json
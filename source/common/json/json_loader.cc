@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <fstream>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stack>
 #include <string>
@@ -151,7 +153,7 @@ private:
     checkType(Type::String);
     return value_.string_value_;
   }
-  std::vector<FieldSharedPtr> arrayValue() const {
+  const std::vector<FieldSharedPtr>& arrayValue() const {
     checkType(Type::Array);
     return value_.array_value_;
   }
@@ -168,9 +170,9 @@ private:
     return value_.integer_value_;
   }
 
-  rapidjson::Document asRapidJsonDocument() const;
-  static void buildRapidJsonDocument(const Field& field, rapidjson::Value& value,
-                                     rapidjson::Document::AllocatorType& allocator);
+  // Replays the field to a rapidjson SAX handler, as Document::Accept() would.
+  template <typename Handler> bool accept(Handler& handler) const;
+  static std::shared_ptr<const rapidjson::SchemaDocument> compiledSchema(const std::string& schema);
 
   uint64_t line_number_start_;
   uint64_t line_number_end_;
@@ -241,89 +243,48 @@ private:
   FieldSharedPtr root_;
 };
 
-void Field::buildRapidJsonDocument(const Field& field, rapidjson::Value& value,
-                                   rapidjson::Document::AllocatorType& allocator) {
-
-  switch (field.type_) {
-  case Type::Array: {
-    value.SetArray();
-    value.Reserve(field.value_.array_value_.size(), allocator);
-    for (const auto& element : field.value_.array_value_) {
-      switch (element->type_) {
-      case Type::Array:
-      case Type::Object: {
-        rapidjson::Value nested_value;
-        buildRapidJsonDocument(*element, nested_value, allocator);
-        value.PushBack(nested_value, allocator);
-        break;
-      }
-      case Type::Boolean:
-        value.PushBack(element->value_.boolean_value_, allocator);
-        break;
-      case Type::Double:
-        value.PushBack(element->value_.double_value_, allocator);
-        break;
-      case Type::Integer:
-        value.PushBack(element->value_.integer_value_, allocator);
-        break;
-      case Type::Null:
-        value.PushBack(rapidjson::Value(), allocator);
-        break;
-      case Type::String:
-        value.PushBack(rapidjson::StringRef(element->value_.string_value_.c_str()), allocator);
-      }
+template <typename Handler> bool Field::accept(Handler& handler) const {
+  switch (type_) {
+  case Type::Array:
+    if (!handler.StartArray()) {
+      return false;
     }
-    break;
-  }
-  case Type::Object: {
-    value.SetObject();
-    for (const auto& item : field.value_.object_value_) {
-      auto name = rapidjson::StringRef(item.first.c_str());
-
-      switch (item.second->type_) {
-      case Type::Array:
-      case Type::Object: {
-        rapidjson::Value nested_value;
-        buildRapidJsonDocument(*item.second, nested_value, allocator);
-        value.AddMember(name, nested_value, allocator);
-        break;
+    for (const auto& element : value_.array_value_) {
+      if (!element->accept(handler)) {
+        return false;
       }
-      case Type::Boolean:
-        value.AddMember(name, item.second->value_.boolean_value_, allocator);
-        break;
-      case Type::Double:
-        value.AddMember(name, item.second->value_.double_value_, allocator);
-        break;
-      case Type::Integer:
-        value.AddMember(name, item.second->value_.integer_value_, allocator);
-        break;
-      case Type::Null:
-        value.AddMember(name, rapidjson::Value(), allocator);
-        break;
-      case Type::String:
-        value.AddMember(name, rapidjson::StringRef(item.second->value_.string_value_.c_str()),
-                        allocator);
-        break;
+    }
+    return handler.EndArray(value_.array_value_.size());
+  case Type::Boolean:
+    return handler.Bool(value_.boolean_value_);
+  case Type::Double:
+    return handler.Double(value_.double_value_);
+  case Type::Integer:
+    return handler.Int64(value_.integer_value_);
+  case Type::Null:
+    return handler.Null();
+  case Type::Object:
+    if (!handler.StartObject()) {
+      return false;
+    }
+    for (const auto& item : value_.object_value_) {
+      if (!handler.Key(item.first.c_str(), item.first.size(), false) ||
+          !item.second->accept(handler)) {
+        return false;
       }
     }
-    break;
+    return handler.EndObject(value_.object_value_.size());
+  case Type::String:
+    return handler.String(value_.string_value_.c_str(), value_.string_value_.size(), false);
   }
-  default:
-    NOT_REACHED;
-  }
-}
 
-rapidjson::Document Field::asRapidJsonDocument() const {
-  rapidjson::Document document;
-  rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
-  buildRapidJsonDocument(*this, document, allocator);
-  return document;
+  NOT_REACHED;
 }
 
 uint64_t Field::hash() const {
   rapidjson::StringBuffer buffer;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-  asRapidJsonDocument().Accept(writer);
+  accept(writer);
   return std::hash<std::string>{}(buffer.GetString());
 }
 
@@ -417,7 +378,7 @@ std::vector<ObjectSharedPtr> Field::getObjectArray(const std::string& name,
                                 line_number_start_, line_number_end_));
   }
 
-  std::vector<FieldSharedPtr> array_value = value_itr->second->arrayValue();
+  const std::vector<FieldSharedPtr>& array_value = value_itr->second->arrayValue();
   return {array_value.begin(), array_value.end()};
 }
 
@@ -453,7 +414,7 @@ std::vector<std::string> Field::getStringArray(const std::string& name, bool all
                                 line_number_start_, line_number_end_));
   }
 
-  std::vector<FieldSharedPtr> array = value_itr->second->arrayValue();
+  const std::vector<FieldSharedPtr>& array = value_itr->second->arrayValue();
   string_array.reserve(array.size());
   for (const auto& element : array) {
     if (!element->isType(Type::String)) {
@@ -474,8 +435,7 @@ std::vector<ObjectSharedPtr> Field::asObjectArray() const {
 std::string Field::asJsonString() const {
   rapidjson::StringBuffer buffer;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-  rapidjson::Document document = asRapidJsonDocument();
-  document.Accept(writer);
+  accept(writer);
   return buffer.GetString();
 }
 
@@ -506,18 +466,44 @@ void Field::iterate(const ObjectCallback& callback) const {
   }
 }
 
-void Field::validateSchema(const std::string& schema) const {
-  rapidjson::Document schema_document;
-  if (schema_document.Parse<0>(schema.c_str()).HasParseError()) {
-    throw std::invalid_argument(fmt::format(
-        "Schema supplied to validateSchema is not valid JSON\n Error(offset {}) : {}\n",
-        schema_document.GetErrorOffset(), GetParseError_En(schema_document.GetParseError())));
+std::shared_ptr<const rapidjson::SchemaDocument> Field::compiledSchema(const std::string& schema) {
+  // The same few schemas validate every object of a config, so each is compiled once. A compiled
+  // schema is immutable and may be used by several validators at once.
+  struct CompiledSchema {
+    std::string text_;
+    // Kept alongside the compiled schema, as it may refer to the source document.
+    rapidjson::Document document_;
+    std::unique_ptr<rapidjson::SchemaDocument> schema_;
+  };
+
+  // Schemas are the constants of Json::Schema, so they are found by address, without hashing their
+  // text. The text is still compared, as a schema built elsewhere may reuse an earlier address.
+  static std::mutex lock;
+  static std::unordered_map<const std::string*, std::shared_ptr<CompiledSchema>> schemas;
+  std::lock_guard<std::mutex> guard(lock);
+  std::shared_ptr<CompiledSchema>& compiled = schemas[&schema];
+  if (!compiled || compiled->text_ != schema) {
+    std::shared_ptr<CompiledSchema> fresh = std::make_shared<CompiledSchema>();
+    if (fresh->document_.Parse<0>(schema.c_str()).HasParseError()) {
+      schemas.erase(&schema);
+      throw std::invalid_argument(fmt::format(
+          "Schema supplied to validateSchema is not valid JSON\n Error(offset {}) : {}\n",
+          fresh->document_.GetErrorOffset(), GetParseError_En(fresh->document_.GetParseError())));
+    }
+    fresh->text_ = schema;
+    fresh->schema_.reset(new rapidjson::SchemaDocument(fresh->document_));
+    compiled = fresh;
   }
+  // Validators hold on to the schema, in case its entry is replaced while they run.
+  return std::shared_ptr<const rapidjson::SchemaDocument>(compiled, compiled->schema_.get());
+}
 
-  rapidjson::SchemaDocument schema_document_for_validator(schema_document);
-  rapidjson::SchemaValidator schema_validator(schema_document_for_validator);
+void Field::validateSchema(const std::string& schema) const {
+  std::shared_ptr<const rapidjson::SchemaDocument> compiled = compiledSchema(schema);
+  rapidjson::SchemaValidator schema_validator(*compiled);
 
-  if (!asRapidJsonDocument().Accept(schema_validator)) {
+  // The validator consumes the events of the tree directly, without a copy of it as a document.
+  if (!accept(schema_validator)) {
     rapidjson::StringBuffer schema_string_buffer;
     rapidjson::StringBuffer document_string_buffer;
 
@@ -0,0 +1,56 @@
+#include "common/memory/accounting.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Memory {
+
+namespace {
+
+typedef std::array<std::atomic<int64_t>, static_cast<size_t>(Owner::Count)> Totals;
+
+Totals& totals() {
+  // Never destroyed, since owners with static storage may credit while the process exits.
+  static Totals* totals = new Totals{};
+  return *totals;
+}
+
+} // namespace
+
+void Accounting::charge(Owner owner, uint64_t bytes) {
+  totals()[static_cast<size_t>(owner)].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Accounting::credit(Owner owner, uint64_t bytes) {
+  totals()[static_cast<size_t>(owner)].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+uint64_t Accounting::bytes(Owner owner) {
+  // A credit on one thread may be seen before the charge it pairs with on another.
+  const int64_t total = totals()[static_cast<size_t>(owner)].load(std::memory_order_relaxed);
+  return total > 0 ? total : 0;
+}
+
+const char* Accounting::name(Owner owner) {
+  switch (owner) {
+  case Owner::ClusterManager:
+    return "cluster_manager";
+  case Owner::RouteConfigs:
+    return "route_configs";
+  case Owner::ConnectionBuffers:
+    return "connection_buffers";
+  case Owner::Stats:
+    return "stats";
+  case Owner::Count:
+    break;
+  }
+
+  NOT_REACHED;
+}
+
+} // namespace Memory
+} // namespace Envoy
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Envoy {
+namespace Memory {
+
+/**
+ * The subsystems that memory is accounted to.
+ */
+enum class Owner {
+  // Upstream clusters and their hosts.
+  ClusterManager,
+  // Route tables of HTTP connection managers.
+  RouteConfigs,
+  // Data held in the read and write buffers of connections.
+  ConnectionBuffers,
+  // Counters and gauges kept on the heap.
+  Stats,
+  // Not an owner. The number of owners.
+  Count
+};
+
+/**
+ * Running totals of the memory that the major subsystems hold, so that instances can be sized and
+ * memory regressions attributed. Owners charge the bytes of what they keep and credit them back
+ * when they let go. Most charges are estimates from the size of the objects kept rather than exact
+ * heap usage. The totals are relaxed atomics, so they are cheap to update from any thread.
+ */
+class Accounting {
+public:
+  /**
+   * @param owner supplies the owner of the memory.
+   * @param bytes supplies the number of bytes that the owner now keeps.
+   */
+  static void charge(Owner owner, uint64_t bytes);
+
+  /**
+   * @param owner supplies the owner of the memory.
+   * @param bytes supplies the number of previously charged bytes that the owner let go of.
+   */
+  static void credit(Owner owner, uint64_t bytes);
+
+  /**
+   * @param owner supplies the owner of the memory.
+   * @return uint64_t the number of bytes currently charged to the owner.
+   */
+  static uint64_t bytes(Owner owner);
+
+  /**
+   * @param owner supplies the owner of the memory.
+   * @return const char* the name of the owner, e.g. for reporting.
+   */
+  static const char* name(Owner owner);
+};
+
+/**
+ * Charges an owner a fixed number of bytes for as long as it lives, typically as a member of the
+ * object that is accounted.
+ */
+class Charge {
+public:
+  Charge(Owner owner, uint64_t bytes) : owner_(owner), bytes_(bytes) {
+    Accounting::charge(owner_, bytes_);
+  }
+  Charge(const Charge&) = delete;
+  Charge& operator=(const Charge&) = delete;
+  ~Charge() { Accounting::credit(owner_, bytes_); }
+
+private:
+  const Owner owner_;
+  const uint64_t bytes_;
+};
+
+} // namespace Memory
+} // namespace Envoy
@@ -20,6 +20,22 @@ public:
    *                  allocated.
    */
   static uint64_t totalCurrentlyReserved();
+
+  /**
+   * @return uint64_t the free memory of the page heap that is still mapped, i.e. counts towards
+   *                  the resident size of the process.
+   */
+  static uint64_t totalPageHeapFree();
+
+  /**
+   * @return uint64_t the free memory of the page heap that has been returned to the system.
+   */
+  static uint64_t totalPageHeapUnmapped();
+
+  /**
+   * @return uint64_t the free memory held in the caches of all threads.
+   */
+  static uint64_t totalThreadCacheBytes();
 };
 
 } // namespace Memory
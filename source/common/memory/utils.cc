@@ -0,0 +1,39 @@
+#include "common/memory/utils.h"
+
+#include <cstdint>
+
+#include "common/memory/stats.h"
+
+#ifdef TCMALLOC
+
+#include "gperftools/malloc_extension.h"
+
+namespace Envoy {
+namespace Memory {
+
+uint64_t Utils::releaseFreeMemory(uint64_t max_bytes) {
+  const uint64_t unmapped = Stats::totalPageHeapUnmapped();
+  if (max_bytes == 0) {
+    MallocExtension::instance()->ReleaseFreeMemory();
+  } else {
+    MallocExtension::instance()->ReleaseToSystem(max_bytes);
+  }
+  // Other threads may have reused unmapped pages in the meantime.
+  const uint64_t new_unmapped = Stats::totalPageHeapUnmapped();
+  return new_unmapped > unmapped ? new_unmapped - unmapped : 0;
+}
+
+} // namespace Memory
+} // namespace Envoy
+
+#else
+
+namespace Envoy {
+namespace Memory {
+
+uint64_t Utils::releaseFreeMemory(uint64_t) { return 0; }
+
+} // namespace Memory
+} // namespace Envoy
+
+#endif // #ifdef TCMALLOC
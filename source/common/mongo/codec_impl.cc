@@ -1,6 +1,7 @@
 #include "common/mongo/codec_impl.h"
 
 #include <cstdint>
+#include <cstring>
 #include <list>
 #include <memory>
 #include <sstream>
@@ -10,6 +11,7 @@
 #include "envoy/common/exception.h"
 
 #include "common/common/assert.h"
+#include "common/common/byte_order.h"
 #include "common/mongo/bson_impl.h"
 
 #include "spdlog/spdlog.h"
@@ -36,6 +38,41 @@ MessageImpl::documentListToString(const std::list<Bson::DocumentSharedPtr>& docu
   return out.str();
 }
 
+void LazyDocumentList::addEncoded(Buffer::Instance& data) {
+  const int32_t length = Bson::BufferHelper::peakInt32(data);
+  if (length < 5 || static_cast<uint64_t>(length) > data.length()) {
+    throw EnvoyException("invalid BSON message length");
+  }
+
+  encoded_.move(data, length);
+  encoded_count_++;
+}
+
+const std::list<Bson::DocumentSharedPtr>& LazyDocumentList::documents() const {
+  decode();
+  return documents_;
+}
+
+std::list<Bson::DocumentSharedPtr>& LazyDocumentList::documents() {
+  decode();
+  return documents_;
+}
+
+uint64_t LazyDocumentList::byteSize() const {
+  uint64_t byte_size = encoded_.length();
+  for (const Bson::DocumentSharedPtr& document : documents_) {
+    byte_size += document->byteSize();
+  }
+  return byte_size;
+}
+
+void LazyDocumentList::decode() const {
+  while (encoded_count_ > 0) {
+    documents_.emplace_back(Bson::DocumentImpl::create(encoded_));
+    encoded_count_--;
+  }
+}
+
 void GetMoreMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data) {
   ENVOY_LOG(trace, "decoding get more message");
   Bson::BufferHelper::removeInt32(data); // "zero" (unused)
@@ -66,10 +103,10 @@ void InsertMessageImpl::fromBuffer(uint32_t message_length, Buffer::Instance& da
   flags_ = Bson::BufferHelper::removeInt32(data);
   full_collection_name_ = Bson::BufferHelper::removeCString(data);
   while (data.length() - (original_buffer_length - message_length) > 0) {
-    documents_.emplace_back(Bson::DocumentImpl::create(data));
+    documents_.addEncoded(data);
   }
 
-  ENVOY_LOG(trace, "{}", toString(true));
+  ENVOY_LOG(trace, "{}", toString(false));
 }
 
 bool InsertMessageImpl::operator==(const InsertMessage& rhs) const {
@@ -94,7 +131,7 @@ std::string InsertMessageImpl::toString(bool full) const {
       R"EOF({{"opcode": "OP_INSERT", "id": {}, "response_to": {}, "flags": "{:#x}", "collection": "{}", )EOF"
       R"EOF("documents": {}}})EOF",
       request_id_, response_to_, flags_, full_collection_name_,
-      full ? documentListToString(documents_) : std::to_string(documents_.size()));
+      full ? documentListToString(documents_.documents()) : std::to_string(documents_.size()));
 }
 
 void KillCursorsMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data) {
@@ -188,10 +225,10 @@ void ReplyMessageImpl::fromBuffer(uint32_t, Buffer::Instance& data) {
   starting_from_ = Bson::BufferHelper::removeInt32(data);
   number_returned_ = Bson::BufferHelper::removeInt32(data);
   for (int32_t i = 0; i < number_returned_; i++) {
-    documents_.emplace_back(Bson::DocumentImpl::create(data));
+    documents_.addEncoded(data);
   }
 
-  ENVOY_LOG(trace, "{}", toString(true));
+  ENVOY_LOG(trace, "{}", toString(false));
 }
 
 bool ReplyMessageImpl::operator==(const ReplyMessage& rhs) const {
@@ -217,7 +254,21 @@ std::string ReplyMessageImpl::toString(bool full) const {
       R"EOF({{"opcode": "OP_REPLY", "id": {}, "response_to": {}, "flags": "{:#x}", "cursor": "{}", )EOF"
       R"EOF("from": {}, "returned": {}, "documents": {}}})EOF",
       request_id_, response_to_, flags_, cursor_id_, starting_from_, number_returned_,
-      full ? documentListToString(documents_) : std::to_string(documents_.size()));
+      full ? documentListToString(documents_.documents()) : std::to_string(documents_.size()));
+}
+
+bool DecoderImpl::peekHeader(Buffer::Instance& data, MessageHeader& header) {
+  if (data.length() < MessageHeader::SIZE) {
+    return false;
+  }
+
+  int32_t values[4];
+  std::memcpy(values, data.linearize(MessageHeader::SIZE), MessageHeader::SIZE);
+  header.message_length_ = le32toh(values[0]);
+  header.request_id_ = le32toh(values[1]);
+  header.response_to_ = le32toh(values[2]);
+  header.op_code_ = le32toh(values[3]);
+  return true;
 }
 
 bool DecoderImpl::decode(Buffer::Instance& data) {
@@ -295,10 +346,14 @@ void DecoderImpl::onData(Buffer::Instance& data) {
 
 void EncoderImpl::encodeCommonHeader(int32_t total_size, const Message& message,
                                      Message::OpCode op) {
-  Bson::BufferHelper::writeInt32(output_, total_size);
-  Bson::BufferHelper::writeInt32(output_, message.requestId());
-  Bson::BufferHelper::writeInt32(output_, message.responseTo());
-  Bson::BufferHelper::writeInt32(output_, static_cast<int32_t>(op));
+  encodeHeader({total_size, message.requestId(), message.responseTo(), static_cast<int32_t>(op)});
+}
+
+void EncoderImpl::encodeHeader(const MessageHeader& header) {
+  Bson::BufferHelper::writeInt32(output_, header.message_length_);
+  Bson::BufferHelper::writeInt32(output_, header.request_id_);
+  Bson::BufferHelper::writeInt32(output_, header.response_to_);
+  Bson::BufferHelper::writeInt32(output_, header.op_code_);
 }
 
 void EncoderImpl::encodeGetMore(const GetMoreMessage& message) {
@@ -7,6 +7,7 @@
 
 #include "envoy/mongo/codec.h"
 
+#include "common/buffer/buffer_impl.h"
 #include "common/common/logger.h"
 
 namespace Envoy {
@@ -30,6 +31,31 @@ protected:
   const int32_t response_to_;
 };
 
+/**
+ * The documents of a message. Decoded documents are kept encoded, as they came off the wire, until
+ * they are first accessed. Stats only need their number and size, so unless a message is logged
+ * its documents are never built.
+ */
+class LazyDocumentList {
+public:
+  /**
+   * Take the next encoded document off a buffer, without decoding it.
+   */
+  void addEncoded(Buffer::Instance& data);
+
+  const std::list<Bson::DocumentSharedPtr>& documents() const;
+  std::list<Bson::DocumentSharedPtr>& documents();
+  uint32_t size() const { return encoded_count_ + documents_.size(); }
+  uint64_t byteSize() const;
+
+private:
+  void decode() const;
+
+  mutable Buffer::OwnedImpl encoded_;
+  mutable uint32_t encoded_count_{};
+  mutable std::list<Bson::DocumentSharedPtr> documents_;
+};
+
 class GetMoreMessageImpl : public MessageImpl,
                            public GetMoreMessage,
                            Logger::Loggable<Logger::Id::mongo> {
@@ -75,13 +101,15 @@ public:
   void flags(int32_t flags) override { flags_ = flags; }
   const std::string& fullCollectionName() const override { return full_collection_name_; }
   void fullCollectionName(const std::string& name) override { full_collection_name_ = name; }
-  const std::list<Bson::DocumentSharedPtr>& documents() const override { return documents_; }
-  std::list<Bson::DocumentSharedPtr>& documents() override { return documents_; }
+  const std::list<Bson::DocumentSharedPtr>& documents() const override {
+    return documents_.documents();
+  }
+  std::list<Bson::DocumentSharedPtr>& documents() override { return documents_.documents(); }
 
 private:
   int32_t flags_{};
   std::string full_collection_name_;
-  std::list<Bson::DocumentSharedPtr> documents_;
+  LazyDocumentList documents_;
 };
 
 class KillCursorsMessageImpl : public MessageImpl,
@@ -174,21 +202,33 @@ public:
   void startingFrom(int32_t starting_from) override { starting_from_ = starting_from; }
   int32_t numberReturned() const override { return number_returned_; }
   void numberReturned(int32_t number_returned) override { number_returned_ = number_returned; }
-  const std::list<Bson::DocumentSharedPtr>& documents() const override { return documents_; }
-  std::list<Bson::DocumentSharedPtr>& documents() override { return documents_; }
+  const std::list<Bson::DocumentSharedPtr>& documents() const override {
+    return documents_.documents();
+  }
+  std::list<Bson::DocumentSharedPtr>& documents() override { return documents_.documents(); }
+  uint32_t numberOfDocuments() const override { return documents_.size(); }
+  uint64_t documentsByteSize() const override { return documents_.byteSize(); }
 
 private:
   int32_t flags_{};
   int64_t cursor_id_{};
   int32_t starting_from_{};
   int32_t number_returned_{};
-  std::list<Bson::DocumentSharedPtr> documents_;
+  LazyDocumentList documents_;
 };
 
 class DecoderImpl : public Decoder, Logger::Loggable<Logger::Id::mongo> {
 public:
   DecoderImpl(DecoderCallbacks& callbacks) : callbacks_(callbacks) {}
 
+  /**
+   * Read the header of the next message without removing it from a buffer.
+   * @param data supplies the buffer.
+   * @param header receives the header.
+   * @return bool true if the buffer holds a whole header.
+   */
+  static bool peekHeader(Buffer::Instance& data, MessageHeader& header);
+
   // Mongo::Decoder
   void onData(Buffer::Instance& data) override;
 
@@ -209,6 +249,8 @@ public:
   void encodeQuery(const QueryMessage& message) override;
   void encodeReply(const ReplyMessage& message) override;
 
+  void encodeHeader(const MessageHeader& header);
+
 private:
   void encodeCommonHeader(int32_t total_size, const Message& message, Message::OpCode op);
 
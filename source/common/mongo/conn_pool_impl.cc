@@ -0,0 +1,199 @@
+#include "common/mongo/conn_pool_impl.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/mongo/codec_impl.h"
+
+#include "spdlog/spdlog.h"
+
+namespace Envoy {
+namespace Mongo {
+namespace ConnPool {
+
+InstanceImpl::InstanceImpl(const std::string& cluster_name, Upstream::ClusterManager& cm,
+                           ThreadLocal::SlotAllocator& tls, uint32_t connections)
+    : cm_(cm), tls_(tls.allocateSlot()), connections_(connections) {
+  tls_->set([this, cluster_name](
+                Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<ThreadLocalPool>(*this, dispatcher, cluster_name);
+  });
+}
+
+PoolRequest* InstanceImpl::makeRequest(const MessageHeader& header, Buffer::Instance& body,
+                                       PoolCallbacks& callbacks) {
+  UpstreamConnection* connection = tls_->getTyped<ThreadLocalPool>().connection();
+  if (!connection) {
+    return nullptr;
+  }
+  return connection->send(header, body, &callbacks);
+}
+
+bool InstanceImpl::send(const MessageHeader& header, Buffer::Instance& body) {
+  UpstreamConnection* connection = tls_->getTyped<ThreadLocalPool>().connection();
+  if (!connection) {
+    return false;
+  }
+  connection->send(header, body, nullptr);
+  return true;
+}
+
+InstanceImpl::UpstreamConnection::UpstreamConnection(ThreadLocalPool& parent, uint32_t index,
+                                                     Upstream::HostConstSharedPtr host)
+    : parent_(parent), index_(index), host_(host) {
+  host->cluster().stats().upstream_cx_total_.inc();
+  host->cluster().stats().upstream_cx_active_.inc();
+  host->stats().cx_total_.inc();
+  host->stats().cx_active_.inc();
+  connection_ = host->createConnection(parent_.dispatcher_).connection_;
+  connection_->addConnectionCallbacks(*this);
+  connection_->addReadFilter(Network::ReadFilterSharedPtr{new UpstreamReadFilter(*this)});
+  connection_->connect();
+  connection_->noDelay(true);
+}
+
+InstanceImpl::UpstreamConnection::~UpstreamConnection() {
+  ASSERT(pending_requests_.empty());
+  host_->cluster().stats().upstream_cx_active_.dec();
+  host_->stats().cx_active_.dec();
+}
+
+InstanceImpl::UpstreamConnection::PendingRequest*
+InstanceImpl::UpstreamConnection::send(const MessageHeader& header, Buffer::Instance& body,
+                                       PoolCallbacks* callbacks) {
+  MessageHeader upstream_header = header;
+  upstream_header.request_id_ = static_cast<int32_t>(++next_request_id_);
+  PendingRequest* request = nullptr;
+  if (callbacks) {
+    // A canceled request may still hold an ID from before the counter wrapped.
+    while (pending_requests_.count(upstream_header.request_id_) > 0) {
+      upstream_header.request_id_ = static_cast<int32_t>(++next_request_id_);
+    }
+    request = &pending_requests_.emplace(upstream_header.request_id_, PendingRequest(*callbacks))
+                   .first->second;
+  }
+
+  EncoderImpl(write_buffer_).encodeHeader(upstream_header);
+  write_buffer_.move(body);
+  connection_->write(write_buffer_);
+  return request;
+}
+
+void InstanceImpl::UpstreamConnection::onData(Buffer::Instance& data) {
+  read_buffer_.move(data);
+  MessageHeader header;
+  while (DecoderImpl::peekHeader(read_buffer_, header)) {
+    if (header.message_length_ < static_cast<int32_t>(MessageHeader::SIZE)) {
+      ENVOY_LOG(debug, "mongo upstream: invalid message length {}", header.message_length_);
+      host_->cluster().stats().upstream_cx_protocol_error_.inc();
+      connection_->close(Network::ConnectionCloseType::NoFlush);
+      return;
+    }
+    if (read_buffer_.length() < static_cast<uint64_t>(header.message_length_)) {
+      return;
+    }
+
+    read_buffer_.drain(MessageHeader::SIZE);
+    Buffer::OwnedImpl body;
+    body.move(read_buffer_, header.message_length_ - MessageHeader::SIZE);
+
+    auto it = pending_requests_.find(header.response_to_);
+    if (it == pending_requests_.end()) {
+      ENVOY_LOG(debug, "mongo upstream: reply to unknown request {}", header.response_to_);
+      continue;
+    }
+
+    PendingRequest request = it->second;
+    pending_requests_.erase(it);
+    if (!request.canceled_) {
+      request.callbacks_.onReply(header, body);
+    } else {
+      host_->cluster().stats().upstream_rq_cancelled_.inc();
+    }
+  }
+}
+
+void InstanceImpl::UpstreamConnection::onEvent(Network::ConnectionEvent event) {
+  if (event == Network::ConnectionEvent::Connected) {
+    connected_ = true;
+    return;
+  }
+
+  if (event == Network::ConnectionEvent::RemoteClose && !connected_) {
+    host_->cluster().stats().upstream_cx_connect_fail_.inc();
+    host_->stats().cx_connect_fail_.inc();
+  }
+
+  if (!pending_requests_.empty()) {
+    host_->cluster().stats().upstream_cx_destroy_with_active_rq_.inc();
+  }
+
+  // The failure callbacks may cancel other requests of this connection.
+  std::unordered_map<int32_t, PendingRequest> pending_requests;
+  pending_requests.swap(pending_requests_);
+  for (auto& request : pending_requests) {
+    if (!request.second.canceled_) {
+      request.second.callbacks_.onFailure();
+    } else {
+      host_->cluster().stats().upstream_rq_cancelled_.inc();
+    }
+  }
+
+  parent_.dispatcher_.deferredDelete(std::move(parent_.connections_[index_]));
+}
+
+InstanceImpl::ThreadLocalPool::ThreadLocalPool(InstanceImpl& parent, Event::Dispatcher& dispatcher,
+                                               const std::string& cluster_name)
+    : parent_(parent), dispatcher_(dispatcher), cluster_(parent_.cm_.get(cluster_name)),
+      connections_(parent.connections_) {
+  // Like the redis proxy, the cluster is assumed to outlive the pool, so it must not be added
+  // via CDS.
+  ASSERT(!cluster_->info()->addedViaApi());
+  local_host_set_member_update_cb_handle_ = cluster_->hostSet().addMemberUpdateCb(
+      [this](const std::vector<Upstream::HostSharedPtr>&,
+             const std::vector<Upstream::HostSharedPtr>& hosts_removed) -> void {
+        onHostsRemoved(hosts_removed);
+      });
+}
+
+InstanceImpl::ThreadLocalPool::~ThreadLocalPool() {
+  local_host_set_member_update_cb_handle_->remove();
+  for (UpstreamConnectionPtr& connection : connections_) {
+    if (connection) {
+      connection->connection_->close(Network::ConnectionCloseType::NoFlush);
+    }
+  }
+}
+
+InstanceImpl::UpstreamConnection* InstanceImpl::ThreadLocalPool::connection() {
+  const uint32_t index = next_connection_++ % connections_.size();
+  UpstreamConnectionPtr& connection = connections_[index];
+  if (!connection) {
+    Upstream::HostConstSharedPtr host = cluster_->loadBalancer().chooseHost(nullptr);
+    if (!host) {
+      return nullptr;
+    }
+    connection.reset(new UpstreamConnection(*this, index, host));
+  }
+  return connection.get();
+}
+
+void InstanceImpl::ThreadLocalPool::onHostsRemoved(
+    const std::vector<Upstream::HostSharedPtr>& hosts_removed) {
+  for (const Upstream::HostSharedPtr& host : hosts_removed) {
+    for (UpstreamConnectionPtr& connection : connections_) {
+      // There is no draining. Closing the connection fails its pending requests.
+      if (connection && connection->host_ == host) {
+        connection->connection_->close(Network::ConnectionCloseType::NoFlush);
+      }
+    }
+  }
+}
+
+} // namespace ConnPool
+} // namespace Mongo
+} // namespace Envoy
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/event/deferred_deletable.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/mongo/conn_pool.h"
+#include "envoy/network/connection.h"
+#include "envoy/thread_local/thread_local.h"
+#include "envoy/upstream/cluster_manager.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/logger.h"
+#include "common/network/filter_impl.h"
+
+namespace Envoy {
+namespace Mongo {
+namespace ConnPool {
+
+/**
+ * Connection pool keeping a fixed number of upstream connections per worker. Each request goes to
+ * the next connection in turn, which is made to a host chosen by the cluster's load balancer when
+ * it is first needed. Request IDs are rewritten with IDs unique on each connection, which replies
+ * are matched to.
+ */
+class InstanceImpl : public Instance {
+public:
+  InstanceImpl(const std::string& cluster_name, Upstream::ClusterManager& cm,
+               ThreadLocal::SlotAllocator& tls, uint32_t connections);
+
+  // Mongo::ConnPool::Instance
+  PoolRequest* makeRequest(const MessageHeader& header, Buffer::Instance& body,
+                           PoolCallbacks& callbacks) override;
+  bool send(const MessageHeader& header, Buffer::Instance& body) override;
+
+private:
+  struct ThreadLocalPool;
+
+  struct UpstreamConnection : public Network::ConnectionCallbacks,
+                              public Event::DeferredDeletable,
+                              Logger::Loggable<Logger::Id::mongo> {
+    struct UpstreamReadFilter : public Network::ReadFilterBaseImpl {
+      UpstreamReadFilter(UpstreamConnection& parent) : parent_(parent) {}
+
+      // Network::ReadFilter
+      Network::FilterStatus onData(Buffer::Instance& data) override {
+        parent_.onData(data);
+        return Network::FilterStatus::Continue;
+      }
+
+      UpstreamConnection& parent_;
+    };
+
+    struct PendingRequest : public PoolRequest {
+      PendingRequest(PoolCallbacks& callbacks) : callbacks_(callbacks) {}
+
+      // Mongo::ConnPool::PoolRequest
+      void cancel() override { canceled_ = true; }
+
+      PoolCallbacks& callbacks_;
+      bool canceled_{};
+    };
+
+    UpstreamConnection(ThreadLocalPool& parent, uint32_t index, Upstream::HostConstSharedPtr host);
+    ~UpstreamConnection();
+
+    PendingRequest* send(const MessageHeader& header, Buffer::Instance& body,
+                         PoolCallbacks* callbacks);
+    void onData(Buffer::Instance& data);
+
+    // Network::ConnectionCallbacks
+    void onEvent(Network::ConnectionEvent event) override;
+    void onAboveWriteBufferHighWatermark() override {}
+    void onBelowWriteBufferLowWatermark() override {}
+
+    ThreadLocalPool& parent_;
+    const uint32_t index_;
+    Upstream::HostConstSharedPtr host_;
+    Network::ClientConnectionPtr connection_;
+    Buffer::OwnedImpl read_buffer_;
+    Buffer::OwnedImpl write_buffer_;
+    uint32_t next_request_id_{};
+    bool connected_{};
+    // Requests awaiting a reply, by the request ID they were sent upstream with. Canceled requests
+    // stay until their reply is received, so that the ID isn't reused before then.
+    std::unordered_map<int32_t, PendingRequest> pending_requests_;
+  };
+
+  typedef std::unique_ptr<UpstreamConnection> UpstreamConnectionPtr;
+
+  struct ThreadLocalPool : public ThreadLocal::ThreadLocalObject {
+    ThreadLocalPool(InstanceImpl& parent, Event::Dispatcher& dispatcher,
+                    const std::string& cluster_name);
+    ~ThreadLocalPool();
+    UpstreamConnection* connection();
+    void onHostsRemoved(const std::vector<Upstream::HostSharedPtr>& hosts_removed);
+
+    InstanceImpl& parent_;
+    Event::Dispatcher& dispatcher_;
+    Upstream::ThreadLocalCluster* cluster_;
+    Common::CallbackHandle* local_host_set_member_update_cb_handle_;
+    std::vector<UpstreamConnectionPtr> connections_;
+    uint32_t next_connection_{};
+  };
+
+  Upstream::ClusterManager& cm_;
+  ThreadLocal::SlotPtr tls_;
+  const uint32_t connections_;
+};
+
+} // namespace ConnPool
+} // namespace Mongo
+} // namespace Envoy
@@ -0,0 +1,111 @@
+#include "common/mongo/multiplex_filter.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+
+#include "common/common/assert.h"
+#include "common/mongo/codec_impl.h"
+
+#include "spdlog/spdlog.h"
+
+namespace Envoy {
+namespace Mongo {
+
+MultiplexFilter::~MultiplexFilter() { ASSERT(active_requests_.empty()); }
+
+Network::FilterStatus MultiplexFilter::onData(Buffer::Instance& data) {
+  read_buffer_.move(data);
+  MessageHeader header;
+  while (DecoderImpl::peekHeader(read_buffer_, header)) {
+    if (header.message_length_ < static_cast<int32_t>(MessageHeader::SIZE)) {
+      ENVOY_CONN_LOG(debug, "invalid message length {}", read_callbacks_->connection(),
+                     header.message_length_);
+      close();
+      break;
+    }
+    if (read_buffer_.length() < static_cast<uint64_t>(header.message_length_)) {
+      break;
+    }
+
+    read_buffer_.drain(MessageHeader::SIZE);
+    Buffer::OwnedImpl body;
+    body.move(read_buffer_, header.message_length_ - MessageHeader::SIZE);
+
+    bool sent;
+    switch (static_cast<Message::OpCode>(header.op_code_)) {
+    case Message::OpCode::OP_QUERY:
+    case Message::OpCode::OP_GET_MORE: {
+      active_requests_.emplace_back(new ActiveRequest(*this, header.request_id_));
+      ActiveRequest& request = *active_requests_.back();
+      request.handle_ = conn_pool_->makeRequest(header, body, request);
+      sent = request.handle_ != nullptr;
+      if (!sent) {
+        active_requests_.pop_back();
+      }
+      break;
+    }
+    case Message::OpCode::OP_UPDATE:
+    case Message::OpCode::OP_INSERT:
+    case Message::OpCode::OP_DELETE:
+    case Message::OpCode::OP_KILL_CURSORS:
+      sent = conn_pool_->send(header, body);
+      break;
+    default:
+      ENVOY_CONN_LOG(debug, "cannot multiplex op code {}", read_callbacks_->connection(),
+                     header.op_code_);
+      sent = false;
+      break;
+    }
+
+    if (!sent) {
+      close();
+      break;
+    }
+  }
+
+  return Network::FilterStatus::StopIteration;
+}
+
+void MultiplexFilter::onEvent(Network::ConnectionEvent event) {
+  if (event == Network::ConnectionEvent::RemoteClose ||
+      event == Network::ConnectionEvent::LocalClose) {
+    while (!active_requests_.empty()) {
+      active_requests_.front()->handle_->cancel();
+      active_requests_.pop_front();
+    }
+  }
+}
+
+void MultiplexFilter::onRequestDone(ActiveRequest& request) {
+  for (auto it = active_requests_.begin(); it != active_requests_.end(); ++it) {
+    if (it->get() == &request) {
+      active_requests_.erase(it);
+      return;
+    }
+  }
+  NOT_REACHED;
+}
+
+void MultiplexFilter::close() {
+  read_buffer_.drain(read_buffer_.length());
+  read_callbacks_->connection().close(Network::ConnectionCloseType::NoFlush);
+}
+
+void MultiplexFilter::ActiveRequest::onReply(const MessageHeader& header, Buffer::Instance& body) {
+  MessageHeader downstream_header = header;
+  downstream_header.response_to_ = request_id_;
+  EncoderImpl(parent_.write_buffer_).encodeHeader(downstream_header);
+  parent_.write_buffer_.move(body);
+  parent_.read_callbacks_->connection().write(parent_.write_buffer_);
+  parent_.onRequestDone(*this);
+}
+
+void MultiplexFilter::ActiveRequest::onFailure() {
+  MultiplexFilter& parent = parent_;
+  parent.onRequestDone(*this);
+  parent.close();
+}
+
+} // namespace Mongo
+} // namespace Envoy
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+
+#include "envoy/mongo/codec.h"
+#include "envoy/mongo/conn_pool.h"
+#include "envoy/network/connection.h"
+#include "envoy/network/filter.h"
+
+#include "common/buffer/buffer_impl.h"
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Mongo {
+
+/**
+ * Terminal read filter that forwards the messages of a downstream connection over a connection
+ * pool shared by all the downstream connections of a worker, instead of over a dedicated upstream
+ * connection. Replies are written back with the request ID the downstream client used. Since the
+ * upstream connection may differ from one message to the next, state kept per connection by the
+ * server, such as authentication or getLastError, does not carry over between messages.
+ * Exhaust cursors only get their first reply.
+ */
+class MultiplexFilter : public Network::ReadFilter,
+                        public Network::ConnectionCallbacks,
+                        Logger::Loggable<Logger::Id::mongo> {
+public:
+  MultiplexFilter(ConnPool::InstanceSharedPtr conn_pool) : conn_pool_(conn_pool) {}
+  ~MultiplexFilter();
+
+  // Network::ReadFilter
+  Network::FilterStatus onData(Buffer::Instance& data) override;
+  Network::FilterStatus onNewConnection() override { return Network::FilterStatus::Continue; }
+  void initializeReadFilterCallbacks(Network::ReadFilterCallbacks& callbacks) override {
+    read_callbacks_ = &callbacks;
+    read_callbacks_->connection().addConnectionCallbacks(*this);
+  }
+
+  // Network::ConnectionCallbacks
+  void onEvent(Network::ConnectionEvent event) override;
+  void onAboveWriteBufferHighWatermark() override {}
+  void onBelowWriteBufferLowWatermark() override {}
+
+private:
+  struct ActiveRequest : public ConnPool::PoolCallbacks {
+    ActiveRequest(MultiplexFilter& parent, int32_t request_id)
+        : parent_(parent), request_id_(request_id) {}
+
+    // Mongo::ConnPool::PoolCallbacks
+    void onReply(const MessageHeader& header, Buffer::Instance& body) override;
+    void onFailure() override;
+
+    MultiplexFilter& parent_;
+    const int32_t request_id_;
+    ConnPool::PoolRequest* handle_{};
+  };
+
+  typedef std::unique_ptr<ActiveRequest> ActiveRequestPtr;
+
+  void onRequestDone(ActiveRequest& request);
+  void close();
+
+  ConnPool::InstanceSharedPtr conn_pool_;
+  Network::ReadFilterCallbacks* read_callbacks_{};
+  Buffer::OwnedImpl read_buffer_;
+  Buffer::OwnedImpl write_buffer_;
+  std::list<ActiveRequestPtr> active_requests_;
+};
+
+} // namespace Mongo
+} // namespace Envoy
@@ -18,6 +18,53 @@
 namespace Envoy {
 namespace Mongo {
 
+QueryStats::QueryStats(Stats::Scope& scope, const std::string& prefix)
+    : scope_(scope), total_(scope.counter(prefix + "total")),
+      scatter_get_name_(prefix + "scatter_get"), multi_get_name_(prefix + "multi_get"),
+      reply_num_docs_(prefix + "reply_num_docs"), reply_size_(prefix + "reply_size"),
+      reply_time_ms_(prefix + "reply_time_ms") {}
+
+void QueryStats::chargeQuery(QueryMessageInfo::QueryType type) {
+  total_.inc();
+  if (type == QueryMessageInfo::QueryType::ScatterGet) {
+    resolve(scatter_get_, scatter_get_name_).inc();
+  } else if (type == QueryMessageInfo::QueryType::MultiGet) {
+    resolve(multi_get_, multi_get_name_).inc();
+  }
+}
+
+void QueryStats::chargeReply(const ReplyMessage& message, std::chrono::milliseconds reply_time) {
+  scope_.deliverHistogramToSinks(reply_num_docs_, message.numberOfDocuments());
+  scope_.deliverHistogramToSinks(reply_size_, message.documentsByteSize());
+  scope_.deliverTimingToSinks(reply_time_ms_, reply_time);
+}
+
+Stats::Counter& QueryStats::resolve(std::atomic<Stats::Counter*>& slot, const std::string& name) {
+  Stats::Counter* counter = slot.load(std::memory_order_acquire);
+  if (!counter) {
+    // Threads racing to fill the slot all get the same counter from the scope.
+    counter = &scope_.counter(name);
+    slot.store(counter, std::memory_order_release);
+  }
+  return *counter;
+}
+
+QueryStatFamilies::QueryStatFamilies(Stats::Scope& scope, const std::string& stat_prefix,
+                                     ThreadLocal::SlotAllocator& tls)
+    : commands_(tls, MAX_COMMANDS, "overflow",
+                [&scope, stat_prefix](const std::string& name) -> QueryStats* {
+                  return new QueryStats(scope, stat_prefix + "cmd." + name + ".");
+                }),
+      collections_(tls, MAX_COLLECTIONS, "overflow",
+                   [&scope, stat_prefix](const std::string& name) -> QueryStats* {
+                     return new QueryStats(scope, stat_prefix + "collection." + name + ".query.");
+                   }),
+      // Callsites are keyed by "{collection}.callsite.{callsite}".
+      callsites_(tls, MAX_CALLSITES, "overflow.callsite.overflow",
+                 [&scope, stat_prefix](const std::string& name) -> QueryStats* {
+                   return new QueryStats(scope, stat_prefix + "collection." + name + ".query.");
+                 }) {}
+
 AccessLog::AccessLog(const std::string& file_name,
                      Envoy::AccessLog::AccessLogManager& log_manager) {
   file_ = log_manager.createAccessLog(file_name);
@@ -38,9 +85,10 @@ void AccessLog::logMessage(const Message& message, bool full,
 
 ProxyFilter::ProxyFilter(const std::string& stat_prefix, Stats::Scope& scope,
                          Runtime::Loader& runtime, AccessLogSharedPtr access_log,
-                         const FaultConfigSharedPtr& fault_config)
-    : stat_prefix_(stat_prefix), scope_(scope), stats_(generateStats(stat_prefix, scope)),
-      runtime_(runtime), access_log_(access_log), fault_config_(fault_config) {
+                         const FaultConfigSharedPtr& fault_config,
+                         QueryStatFamiliesSharedPtr query_stats)
+    : stats_(generateStats(stat_prefix, scope)), query_stats_(query_stats), runtime_(runtime),
+      access_log_(access_log), fault_config_(fault_config) {
   if (!runtime_.snapshot().featureEnabled(MongoRuntimeConfig::get().ConnectionLoggingEnabled,
                                           100)) {
     // If we are not logging at the connection level, just release the shared pointer so that we
@@ -56,7 +104,7 @@ void ProxyFilter::decodeGetMore(GetMoreMessagePtr&& message) {
 
   stats_.op_get_more_.inc();
   logMessage(*message, true);
-  ENVOY_LOG(debug, "decoded GET_MORE: {}", message->toString(true));
+  debugLogMessage("GET_MORE", *message);
 }
 
 void ProxyFilter::decodeInsert(InsertMessagePtr&& message) {
@@ -64,7 +112,7 @@ void ProxyFilter::decodeInsert(InsertMessagePtr&& message) {
 
   stats_.op_insert_.inc();
   logMessage(*message, true);
-  ENVOY_LOG(debug, "decoded INSERT: {}", message->toString(true));
+  debugLogMessage("INSERT", *message);
 }
 
 void ProxyFilter::decodeKillCursors(KillCursorsMessagePtr&& message) {
@@ -72,7 +120,7 @@ void ProxyFilter::decodeKillCursors(KillCursorsMessagePtr&& message) {
 
   stats_.op_kill_cursors_.inc();
   logMessage(*message, true);
-  ENVOY_LOG(debug, "decoded KILL_CURSORS: {}", message->toString(true));
+  debugLogMessage("KILL_CURSORS", *message);
 }
 
 void ProxyFilter::decodeQuery(QueryMessagePtr&& message) {
@@ -80,7 +128,7 @@ void ProxyFilter::decodeQuery(QueryMessagePtr&& message) {
 
   stats_.op_query_.inc();
   logMessage(*message, true);
-  ENVOY_LOG(debug, "decoded QUERY: {}", message->toString(true));
+  debugLogMessage("QUERY", *message);
 
   if (message->flags() & QueryMessage::Flags::TailableCursor) {
     stats_.op_query_tailable_cursor_.inc();
@@ -96,23 +144,22 @@ void ProxyFilter::decodeQuery(QueryMessagePtr&& message) {
   }
 
   ActiveQueryPtr active_query(new ActiveQuery(*this, *message));
-  if (!active_query->query_info_.command().empty()) {
+  const QueryMessageInfo& query_info = active_query->query_info_;
+  if (!query_info.command().empty()) {
     // First field key is the operation.
-    scope_.counter(fmt::format("{}cmd.{}.total", stat_prefix_, active_query->query_info_.command()))
-        .inc();
+    active_query->query_stats_ = &query_stats_->command(query_info.command());
+    active_query->query_stats_->chargeTotal();
   } else {
     // Normal query, get stats on a per collection basis first.
-    std::string collection_stat_prefix =
-        fmt::format("{}collection.{}", stat_prefix_, active_query->query_info_.collection());
-    QueryMessageInfo::QueryType query_type = active_query->query_info_.type();
-    chargeQueryStats(collection_stat_prefix, query_type);
+    QueryMessageInfo::QueryType query_type = query_info.type();
+    active_query->query_stats_ = &query_stats_->collection(query_info.collection());
+    active_query->query_stats_->chargeQuery(query_type);
 
     // Callsite stats if we have it.
-    if (!active_query->query_info_.callsite().empty()) {
-      std::string callsite_stat_prefix =
-          fmt::format("{}collection.{}.callsite.{}", stat_prefix_,
-                      active_query->query_info_.collection(), active_query->query_info_.callsite());
-      chargeQueryStats(callsite_stat_prefix, query_type);
+    if (!query_info.callsite().empty()) {
+      active_query->callsite_stats_ =
+          &query_stats_->callsite(query_info.collection(), query_info.callsite());
+      active_query->callsite_stats_->chargeQuery(query_type);
     }
 
     // Global stats.
@@ -129,20 +176,10 @@ void ProxyFilter::decodeQuery(QueryMessagePtr&& message) {
   active_query_list_.emplace_back(std::move(active_query));
 }
 
-void ProxyFilter::chargeQueryStats(const std::string& prefix,
-                                   QueryMessageInfo::QueryType query_type) {
-  scope_.counter(fmt::format("{}.query.total", prefix)).inc();
-  if (query_type == QueryMessageInfo::QueryType::ScatterGet) {
-    scope_.counter(fmt::format("{}.query.scatter_get", prefix)).inc();
-  } else if (query_type == QueryMessageInfo::QueryType::MultiGet) {
-    scope_.counter(fmt::format("{}.query.multi_get", prefix)).inc();
-  }
-}
-
 void ProxyFilter::decodeReply(ReplyMessagePtr&& message) {
   stats_.op_reply_.inc();
   logMessage(*message, false);
-  ENVOY_LOG(debug, "decoded REPLY: {}", message->toString(true));
+  debugLogMessage("REPLY", *message);
 
   if (message->cursorId() != 0) {
     stats_.op_reply_valid_cursor_.inc();
@@ -160,23 +197,12 @@ void ProxyFilter::decodeReply(ReplyMessagePtr&& message) {
       continue;
     }
 
-    if (!active_query.query_info_.command().empty()) {
-      std::string stat_prefix =
-          fmt::format("{}cmd.{}", stat_prefix_, active_query.query_info_.command());
-      chargeReplyStats(active_query, stat_prefix, *message);
-    } else {
-      // Collection stats first.
-      std::string stat_prefix =
-          fmt::format("{}collection.{}.query", stat_prefix_, active_query.query_info_.collection());
-      chargeReplyStats(active_query, stat_prefix, *message);
-
-      // Callsite stats if we have it.
-      if (!active_query.query_info_.callsite().empty()) {
-        std::string callsite_stat_prefix =
-            fmt::format("{}collection.{}.callsite.{}.query", stat_prefix_,
-                        active_query.query_info_.collection(), active_query.query_info_.callsite());
-        chargeReplyStats(active_query, callsite_stat_prefix, *message);
-      }
+    const std::chrono::milliseconds reply_time =
+        std::chrono::duration_cast<std::chrono::milliseconds>(currentTime() -
+                                                              active_query.start_time_);
+    active_query.query_stats_->chargeReply(*message, reply_time);
+    if (active_query.callsite_stats_ != nullptr) {
+      active_query.callsite_stats_->chargeReply(*message, reply_time);
     }
 
     active_query_list_.erase(i);
@@ -184,21 +210,6 @@ void ProxyFilter::decodeReply(ReplyMessagePtr&& message) {
   }
 }
 
-void ProxyFilter::chargeReplyStats(ActiveQuery& active_query, const std::string& prefix,
-                                   const ReplyMessage& message) {
-  uint64_t reply_documents_byte_size = 0;
-  for (const Bson::DocumentSharedPtr& document : message.documents()) {
-    reply_documents_byte_size += document->byteSize();
-  }
-
-  scope_.deliverHistogramToSinks(fmt::format("{}.reply_num_docs", prefix),
-                                 message.documents().size());
-  scope_.deliverHistogramToSinks(fmt::format("{}.reply_size", prefix), reply_documents_byte_size);
-  scope_.deliverTimingToSinks(fmt::format("{}.reply_time_ms", prefix),
-                              std::chrono::duration_cast<std::chrono::milliseconds>(
-                                  std::chrono::steady_clock::now() - active_query.start_time_));
-}
-
 void ProxyFilter::doDecode(Buffer::Instance& buffer) {
   if (!sniffing_ ||
       !runtime_.snapshot().featureEnabled(MongoRuntimeConfig::get().ProxyEnabled, 100)) {
@@ -228,6 +239,13 @@ void ProxyFilter::logMessage(Message& message, bool full) {
   }
 }
 
+void ProxyFilter::debugLogMessage(const std::string& op, const Message& message) {
+  // Printing a message decodes all of its documents, which is only worth it if it is logged.
+  if (ENVOY_LOGGER().level() <= spdlog::level::debug) {
+    ENVOY_LOG(debug, "decoded {}: {}", op, message.toString(true));
+  }
+}
+
 void ProxyFilter::onEvent(Network::ConnectionEvent event) {
   if (event == Network::ConnectionEvent::RemoteClose ||
       event == Network::ConnectionEvent::LocalClose) {
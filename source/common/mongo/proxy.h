@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <list>
@@ -15,6 +16,7 @@
 #include "envoy/runtime/runtime.h"
 #include "envoy/stats/stats.h"
 #include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
 
 #include "common/buffer/buffer_impl.h"
 #include "common/common/logger.h"
@@ -22,6 +24,7 @@
 #include "common/json/json_loader.h"
 #include "common/mongo/utility.h"
 #include "common/network/filter_impl.h"
+#include "common/stats/dynamic_stat_family.h"
 
 namespace Envoy {
 namespace Mongo {
@@ -71,6 +74,72 @@ struct MongoProxyStats {
   ALL_MONGO_PROXY_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT, GENERATE_TIMER_STRUCT)
 };
 
+/**
+ * Prebuilt stats of a single command, collection or callsite.
+ */
+class QueryStats {
+public:
+  QueryStats(Stats::Scope& scope, const std::string& prefix);
+
+  /**
+   * Charge a command.
+   */
+  void chargeTotal() { total_.inc(); }
+
+  /**
+   * Charge a query of a collection or callsite.
+   */
+  void chargeQuery(QueryMessageInfo::QueryType type);
+
+  /**
+   * Charge the reply to a query or command.
+   */
+  void chargeReply(const ReplyMessage& message, std::chrono::milliseconds reply_time);
+
+private:
+  Stats::Counter& resolve(std::atomic<Stats::Counter*>& slot, const std::string& name);
+
+  Stats::Scope& scope_;
+  Stats::Counter& total_;
+  // These are only created once charged, so that commands and unsharded collections do not have
+  // them.
+  std::atomic<Stats::Counter*> scatter_get_{};
+  std::atomic<Stats::Counter*> multi_get_{};
+  const std::string scatter_get_name_;
+  const std::string multi_get_name_;
+  const std::string reply_num_docs_;
+  const std::string reply_size_;
+  const std::string reply_time_ms_;
+};
+
+/**
+ * The stats that are named after commands, collections and callsites, shared by all the filters
+ * of a filter chain. These names come from clients, so the number of names that get stats of their
+ * own is bounded. Other names are charged to the "overflow" command, collection or callsite.
+ */
+class QueryStatFamilies {
+public:
+  QueryStatFamilies(Stats::Scope& scope, const std::string& stat_prefix,
+                    ThreadLocal::SlotAllocator& tls);
+
+  QueryStats& command(const std::string& command) { return commands_.get(command); }
+  QueryStats& collection(const std::string& collection) { return collections_.get(collection); }
+  QueryStats& callsite(const std::string& collection, const std::string& callsite) {
+    return callsites_.get(collection + ".callsite." + callsite);
+  }
+
+  static const uint32_t MAX_COMMANDS = 256;
+  static const uint32_t MAX_COLLECTIONS = 1024;
+  static const uint32_t MAX_CALLSITES = 1024;
+
+private:
+  Stats::DynamicStatFamily<QueryStats> commands_;
+  Stats::DynamicStatFamily<QueryStats> collections_;
+  Stats::DynamicStatFamily<QueryStats> callsites_;
+};
+
+typedef std::shared_ptr<QueryStatFamilies> QueryStatFamiliesSharedPtr;
+
 /**
  * Access logger for mongo messages.
  */
@@ -118,7 +187,8 @@ class ProxyFilter : public Network::Filter,
                     Logger::Loggable<Logger::Id::mongo> {
 public:
   ProxyFilter(const std::string& stat_prefix, Stats::Scope& scope, Runtime::Loader& runtime,
-              AccessLogSharedPtr access_log, const FaultConfigSharedPtr& fault_config);
+              AccessLogSharedPtr access_log, const FaultConfigSharedPtr& fault_config,
+              QueryStatFamiliesSharedPtr query_stats);
   ~ProxyFilter();
 
   virtual DecoderPtr createDecoder(DecoderCallbacks& callbacks) PURE;
@@ -149,7 +219,7 @@ public:
 private:
   struct ActiveQuery {
     ActiveQuery(ProxyFilter& parent, const QueryMessage& query)
-        : parent_(parent), query_info_(query), start_time_(std::chrono::steady_clock::now()) {
+        : parent_(parent), query_info_(query), start_time_(parent.currentTime()) {
       parent_.stats_.op_query_active_.inc();
     }
 
@@ -158,6 +228,9 @@ private:
     ProxyFilter& parent_;
     QueryMessageInfo query_info_;
     MonotonicTime start_time_;
+    // The command or collection stats and the callsite stats that the reply is charged to.
+    QueryStats* query_stats_{};
+    QueryStats* callsite_stats_{};
   };
 
   typedef std::unique_ptr<ActiveQuery> ActiveQueryPtr;
@@ -168,20 +241,20 @@ private:
                                                  POOL_TIMER_PREFIX(scope, prefix))};
   }
 
-  void chargeQueryStats(const std::string& prefix, QueryMessageInfo::QueryType query_type);
-  void chargeReplyStats(ActiveQuery& active_query, const std::string& prefix,
-                        const ReplyMessage& message);
+  MonotonicTime currentTime() {
+    return read_callbacks_->connection().dispatcher().approximateMonotonicTime().currentTime();
+  }
   void doDecode(Buffer::Instance& buffer);
   void logMessage(Message& message, bool full);
+  void debugLogMessage(const std::string& op, const Message& message);
 
   Optional<uint64_t> delayDuration();
   void delayInjectionTimerCallback();
   void tryInjectDelay();
 
   std::unique_ptr<Decoder> decoder_;
-  std::string stat_prefix_;
-  Stats::Scope& scope_;
   MongoProxyStats stats_;
+  QueryStatFamiliesSharedPtr query_stats_;
   Runtime::Loader& runtime_;
   Buffer::OwnedImpl read_buffer_;
   Buffer::OwnedImpl write_buffer_;
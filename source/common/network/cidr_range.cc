@@ -226,22 +226,31 @@ InstanceConstSharedPtr CidrRange::truncateIpAddressAndLength(InstanceConstShared
 IpList::IpList(const std::vector<std::string>& subnets) {
   for (const std::string& entry : subnets) {
     CidrRange list_entry = CidrRange::create(entry);
-    if (list_entry.isValid()) {
-      ip_list_.push_back(list_entry);
-    } else {
+    if (!list_entry.isValid()) {
       throw EnvoyException(
           fmt::format("invalid ip/mask combo '{}' (format is <ip>/<# mask bits>)", entry));
     }
+
+    if (list_entry.version() == IpVersion::v4) {
+      ipv4_trie_.insert(ntohl(list_entry.ipv4()->address()), list_entry.length());
+    } else {
+      ipv6_trie_.insert(list_entry.ipv6()->address(), list_entry.length());
+    }
   }
 }
 
 bool IpList::contains(const Instance& address) const {
-  for (const CidrRange& entry : ip_list_) {
-    if (entry.isInRange(address)) {
-      return true;
-    }
+  if (address.type() != Type::Ip) {
+    return false;
   }
-  return false;
+
+  switch (address.ip()->version()) {
+  case IpVersion::v4:
+    return ipv4_trie_.contains(ntohl(address.ip()->ipv4()->address()));
+  case IpVersion::v6:
+    return ipv6_trie_.contains(address.ip()->ipv6()->address());
+  }
+  NOT_REACHED
 }
 
 IpList::IpList(const Json::Object& config, const std::string& member_name)
@@ -6,6 +6,8 @@
 #include "envoy/json/json_object.h"
 #include "envoy/network/address.h"
 
+#include "common/network/prefix_trie.h"
+
 namespace Envoy {
 namespace Network {
 namespace Address {
@@ -121,7 +123,8 @@ private:
 
 /**
  * Class for keeping a list of CidrRanges, and then determining whether an
- * IP address is in the CidrRange list.
+ * IP address is in the CidrRange list. The ranges are kept in a PrefixTrie per IP version, so
+ * lookups don't slow down as the list grows.
  */
 class IpList {
 public:
@@ -130,10 +133,11 @@ public:
   IpList(){};
 
   bool contains(const Instance& address) const;
-  bool empty() const { return ip_list_.empty(); }
+  bool empty() const { return ipv4_trie_.empty() && ipv6_trie_.empty(); }
 
 private:
-  std::vector<CidrRange> ip_list_;
+  PrefixTrie<uint32_t> ipv4_trie_;
+  PrefixTrie<Ipv6PrefixTrieKey> ipv6_trie_;
 };
 
 } // namespace Address
@@ -1,10 +1,12 @@
 #include "common/network/connection_impl.h"
 
+#include <fcntl.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 
@@ -16,6 +18,7 @@
 #include "common/common/empty_string.h"
 #include "common/common/enum_to_int.h"
 #include "common/event/dispatcher_impl.h"
+#include "common/memory/accounting.h"
 #include "common/network/address_impl.h"
 #include "common/network/utility.h"
 
@@ -32,6 +35,14 @@ Address::InstanceConstSharedPtr getNullLocalAddress(const Address::Instance& add
   // Default to IPv4 any address.
   return Utility::getIpv4AnyAddress();
 }
+
+void accountBufferedBytes(uint64_t previous_size, uint64_t new_size) {
+  if (new_size > previous_size) {
+    Memory::Accounting::charge(Memory::Owner::ConnectionBuffers, new_size - previous_size);
+  } else if (new_size < previous_size) {
+    Memory::Accounting::credit(Memory::Owner::ConnectionBuffers, previous_size - new_size);
+  }
+}
 } // namespace
 
 int ConnectionImplUtility::createSocket(Address::InstanceConstSharedPtr address,
@@ -67,6 +78,23 @@ void ConnectionImplUtility::updateBufferStats(uint64_t delta, uint64_t new_total
   }
 }
 
+const uint64_t ConnectionImplUtility::MIN_READ_SIZE;
+const uint64_t ConnectionImplUtility::DEFAULT_READ_SIZE;
+const uint64_t ConnectionImplUtility::MAX_READ_SIZE;
+const uint64_t ConnectionImplUtility::COALESCE_WRITE_SIZE;
+const uint64_t ConnectionImplUtility::SPLICE_SIZE;
+
+uint64_t ConnectionImplUtility::nextReadSize(uint64_t read_size, uint64_t bytes_read,
+                                             uint64_t max_read_size) {
+  if (bytes_read >= read_size) {
+    read_size *= 2;
+  } else if (bytes_read < read_size / 2) {
+    read_size /= 2;
+  }
+
+  return std::min(std::max(read_size, MIN_READ_SIZE), std::max(max_read_size, MIN_READ_SIZE));
+}
+
 std::atomic<uint64_t> ConnectionImpl::next_global_id_;
 
 ConnectionImpl::ConnectionImpl(Event::DispatcherImpl& dispatcher, int fd,
@@ -123,7 +151,7 @@ void ConnectionImpl::close(ConnectionCloseType type) {
     return;
   }
 
-  uint64_t data_to_write = write_buffer_.length();
+  uint64_t data_to_write = pendingWriteBytes();
   ENVOY_CONN_LOG(debug, "closing data_to_write={} type={}", *this, data_to_write, enumToInt(type));
   if (data_to_write == 0 || type == ConnectionCloseType::NoFlush) {
     if (data_to_write > 0) {
@@ -164,6 +192,23 @@ void ConnectionImpl::closeSocket(ConnectionEvent close_type) {
   updateWriteBufferStats(0, 0);
   buffer_stats_.reset();
 
+  // Stop splicing in both directions. The source falls back to reading through its filters.
+  if (splice_sink_ != nullptr) {
+    splice_sink_->splice_source_ = nullptr;
+    splice_sink_ = nullptr;
+  }
+  if (splice_source_ != nullptr) {
+    splice_source_->splice_sink_ = nullptr;
+    splice_source_ = nullptr;
+  }
+  if (splice_pipe_[0] != -1) {
+    ::close(splice_pipe_[0]);
+    ::close(splice_pipe_[1]);
+    splice_pipe_[0] = splice_pipe_[1] = -1;
+    splice_pipe_bytes_ = 0;
+  }
+
+  cancelFallbackConnect();
   file_event_.reset();
   ::close(fd_);
   fd_ = -1;
@@ -278,6 +323,8 @@ bool ConnectionImpl::readEnabled() const { return state_ & InternalState::ReadEn
 
 void ConnectionImpl::addConnectionCallbacks(ConnectionCallbacks& cb) { callbacks_.push_back(&cb); }
 
+void ConnectionImpl::removeConnectionCallbacks(ConnectionCallbacks& cb) { callbacks_.remove(&cb); }
+
 void ConnectionImpl::write(Buffer::Instance& data) {
   // NOTE: This is kind of a hack, but currently we don't support restart/continue on the write
   //       path, so we just pass around the buffer passed to us in this function. If we ever support
@@ -292,13 +339,17 @@ void ConnectionImpl::write(Buffer::Instance& data) {
 
   if (data.length() > 0) {
     ENVOY_CONN_LOG(trace, "writing {} bytes", *this, data.length());
-    // TODO(mattklein123): All data currently gets moved from the source buffer to the write buffer.
-    // This can lead to inefficient behavior if writing a bunch of small chunks. In this case, it
-    // would likely be more efficient to copy data below a certain size. VERY IMPORTANT: If this is
-    // ever changed, read the comment in Ssl::ConnectionImpl::doWriteToSocket() VERY carefully.
-    // That code assumes that we never change existing write_buffer_ chain elements between calls
-    // to SSL_write(). That code will have to change if we ever copy here.
-    write_buffer_.move(data);
+    // Small writes are copied onto the end of the write buffer rather than moved, so that the many
+    // small frames a codec emits within one dispatcher iteration end up in a few contiguous slices
+    // and go out in a single writev() when the write event fires. Ssl::ConnectionImpl keeps the
+    // plaintext it has encrypted at the front of the write buffer, tracked by length only, so
+    // appending to the last chain element is safe there too.
+    if (data.length() <= ConnectionImplUtility::COALESCE_WRITE_SIZE) {
+      write_buffer_.add(data);
+      data.drain(data.length());
+    } else {
+      write_buffer_.move(data);
+    }
 
     // Activating a write event before the socket is connected has the side-effect of tricking
     // doWriteReady into thinking the socket is connected. On OS X, the underlying write may fail
@@ -335,6 +386,36 @@ void ConnectionImpl::setBufferLimits(uint32_t limit) {
   }
 }
 
+void ConnectionImpl::setEventByteBudget(uint32_t bytes, Stats::Counter& read_exhausted,
+                                        Stats::Counter& write_exhausted) {
+  event_byte_budget_ = bytes;
+  read_budget_exhausted_ = &read_exhausted;
+  write_budget_exhausted_ = &write_exhausted;
+}
+
+bool ConnectionImpl::readBudgetExhausted(uint64_t bytes_read) {
+  if (event_byte_budget_ == 0 || bytes_read < event_byte_budget_) {
+    return false;
+  }
+
+  // The socket has not returned EAGAIN, so edge triggered events would not fire for the data that
+  // is left. Activating the event keeps reading without starving other connections.
+  read_budget_exhausted_->inc();
+  setReadBufferReady();
+  return true;
+}
+
+bool ConnectionImpl::writeBudgetExhausted(uint64_t bytes_written) {
+  if (event_byte_budget_ == 0 || bytes_written < event_byte_budget_ ||
+      write_buffer_.length() == 0) {
+    return false;
+  }
+
+  write_budget_exhausted_->inc();
+  file_event_->activate(Event::FileReadyType::Write);
+  return true;
+}
+
 void ConnectionImpl::onLowWatermark() {
   ENVOY_CONN_LOG(debug, "onBelowWriteBufferLowWatermark", *this);
   ASSERT(above_high_watermark_);
@@ -388,12 +469,12 @@ ConnectionImpl::IoResult ConnectionImpl::doReadFromSocket() {
   PostIoAction action = PostIoAction::KeepOpen;
   uint64_t bytes_read = 0;
   do {
-    // 16K read is arbitrary. IIRC, libevent will currently clamp this to 4K. libevent will also
-    // use an ioctl() before every read to figure out how much data there is to read.
-    //
-    // TODO(mattklein123) PERF: Tune the read size and figure out a way of getting rid of the
-    // ioctl(). The extra syscall is not worth it.
-    int rc = read_buffer_->read(fd_, 16384);
+    // The buffer reads straight into reserved slices with a single readv(). The read size adapts
+    // to the connection: bulk transfers grow it to cut syscalls, small messages shrink it to avoid
+    // reserving memory they do not use. It is capped by the connection's buffer limit, which is
+    // configured per listener.
+    const uint64_t read_size = read_size_;
+    int rc = read_buffer_->read(fd_, read_size);
     ENVOY_CONN_LOG(trace, "read returns: {}", *this, rc);
 
     // Remote close. Might need to raise data before raising close.
@@ -410,20 +491,143 @@ ConnectionImpl::IoResult ConnectionImpl::doReadFromSocket() {
       break;
     } else {
       bytes_read += rc;
+      read_size_ = ConnectionImplUtility::nextReadSize(read_size, rc, maxReadSize());
       if (shouldDrainReadBuffer()) {
         setReadBufferReady();
         break;
       }
+      if (readBudgetExhausted(bytes_read)) {
+        break;
+      }
+    }
+  } while (true);
+
+  return {action, bytes_read};
+}
+
+uint64_t ConnectionImpl::maxReadSize() const {
+  if (read_buffer_limit_ == 0) {
+    return ConnectionImplUtility::MAX_READ_SIZE;
+  }
+  return std::min<uint64_t>(read_buffer_limit_, ConnectionImplUtility::MAX_READ_SIZE);
+}
+
+bool ConnectionImpl::spliceTo(Connection& peer) {
+#ifdef __linux__
+  ConnectionImpl* sink = dynamic_cast<ConnectionImpl*>(&peer);
+  if (sink == nullptr || sink == this || splice_sink_ != nullptr ||
+      sink->splice_source_ != nullptr) {
+    return false;
+  }
+
+  // Only plaintext moves through the kernel, and nothing may need to see or transform it.
+  if (ssl() != nullptr || sink->ssl() != nullptr || filter_manager_.readFilterCount() > 1 ||
+      sink->filter_manager_.writeFilterCount() > 0 || read_buffer_->length() > 0) {
+    return false;
+  }
+
+  if (state() != State::Open || sink->state() != State::Open ||
+      (state_ & InternalState::Connecting) || (sink->state_ & InternalState::Connecting)) {
+    return false;
+  }
+
+  if (pipe2(sink->splice_pipe_, O_NONBLOCK | O_CLOEXEC) != 0) {
+    ENVOY_CONN_LOG(debug, "splice pipe creation failed: {}", *this, errno);
+    return false;
+  }
+
+  ENVOY_CONN_LOG(debug, "splicing to [C{}]", *this, sink->id());
+  splice_sink_ = sink;
+  sink->splice_source_ = this;
+  return true;
+#else
+  UNREFERENCED_PARAMETER(peer);
+  return false;
+#endif
+}
+
+ConnectionImpl::IoResult ConnectionImpl::doSpliceFromSocket() {
+  PostIoAction action = PostIoAction::KeepOpen;
+  uint64_t bytes_read = 0;
+#ifdef __linux__
+  do {
+    const ssize_t rc =
+        splice(fd_, nullptr, splice_sink_->splice_pipe_[1], nullptr,
+               ConnectionImplUtility::SPLICE_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    ENVOY_CONN_LOG(trace, "splice read returns: {}", *this, rc);
+
+    if (rc == 0) {
+      action = PostIoAction::Close;
+      break;
+    } else if (rc == -1) {
+      ENVOY_CONN_LOG(trace, "splice read error: {}", *this, errno);
+      if (errno != EAGAIN) {
+        action = PostIoAction::Close;
+      } else if (splice_sink_->splice_pipe_bytes_ > 0) {
+        // Either the socket is drained or the pipe is full. The sink resumes reading once it
+        // drained the pipe, since the socket won't signal again in the latter case.
+        splice_sink_->splice_source_blocked_ = true;
+      }
+
+      break;
+    } else {
+      bytes_read += rc;
+      splice_sink_->splice_pipe_bytes_ += rc;
     }
   } while (true);
 
+  if (bytes_read > 0) {
+    splice_sink_->file_event_->activate(Event::FileReadyType::Write);
+  }
+#endif
   return {action, bytes_read};
 }
 
+ConnectionImpl::IoResult ConnectionImpl::doSpliceToSocket() {
+  PostIoAction action = PostIoAction::KeepOpen;
+  uint64_t bytes_written = 0;
+#ifdef __linux__
+  while (splice_pipe_bytes_ > 0) {
+    const ssize_t rc = splice(splice_pipe_[0], nullptr, fd_, nullptr, splice_pipe_bytes_,
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    ENVOY_CONN_LOG(trace, "splice write returns: {}", *this, rc);
+    if (rc == -1) {
+      ENVOY_CONN_LOG(trace, "splice write error: {}", *this, errno);
+      if (errno != EAGAIN) {
+        action = PostIoAction::Close;
+      }
+
+      break;
+    }
+
+    bytes_written += rc;
+    splice_pipe_bytes_ -= rc;
+  }
+
+  if (bytes_written > 0 && splice_source_blocked_) {
+    splice_source_blocked_ = false;
+    // A source with reads disabled picks up pending data when reads are enabled again.
+    if (splice_source_ != nullptr && splice_source_->readEnabled()) {
+      splice_source_->file_event_->activate(Event::FileReadyType::Read);
+    }
+  }
+#endif
+  return {action, bytes_written};
+}
+
 void ConnectionImpl::onReadReady() {
   ASSERT(!(state_ & InternalState::Connecting));
 
-  IoResult result = doReadFromSocket();
+  // Whether the SYN data was accepted is known once the handshake completed, which it has by the
+  // time the remote host sends anything.
+  if (tcp_fast_open_accepted_ != nullptr) {
+    if (Utility::tcpFastOpenAccepted(fd_)) {
+      tcp_fast_open_accepted_->inc();
+    }
+    tcp_fast_open_accepted_ = nullptr;
+  }
+
+  IoResult result = splice_sink_ != nullptr ? doSpliceFromSocket() : doReadFromSocket();
   uint64_t new_buffer_size = read_buffer_->length();
   updateReadBufferStats(result.bytes_processed_, new_buffer_size);
   onRead(new_buffer_size);
@@ -447,7 +651,9 @@ ConnectionImpl::IoResult ConnectionImpl::doWriteToSocket() {
     ENVOY_CONN_LOG(trace, "write returns: {}", *this, rc);
     if (rc == -1) {
       ENVOY_CONN_LOG(trace, "write error: {}", *this, errno);
-      if (errno == EAGAIN) {
+      // A TCP Fast Open connection that has no cookie for the remote host yet sends a plain SYN on
+      // the first write and reports EINPROGRESS until the handshake completes.
+      if (errno == EAGAIN || errno == EINPROGRESS) {
         action = PostIoAction::KeepOpen;
       } else {
         action = PostIoAction::Close;
@@ -456,9 +662,20 @@ ConnectionImpl::IoResult ConnectionImpl::doWriteToSocket() {
       break;
     } else {
       bytes_written += rc;
+      if (writeBudgetExhausted(bytes_written)) {
+        action = PostIoAction::KeepOpen;
+        break;
+      }
     }
   } while (true);
 
+  // Spliced data follows the data that was written to the connection before splicing started.
+  if (action == PostIoAction::KeepOpen && write_buffer_.length() == 0 && splice_pipe_bytes_ > 0) {
+    IoResult result = doSpliceToSocket();
+    action = result.action_;
+    bytes_written += result.bytes_processed_;
+  }
+
   return {action, bytes_written};
 }
 
@@ -476,6 +693,7 @@ void ConnectionImpl::onWriteReady() {
 
     if (error == 0) {
       ENVOY_CONN_LOG(debug, "connected", *this);
+      cancelFallbackConnect();
       state_ &= ~InternalState::Connecting;
       onConnected();
       // It's possible that we closed during the connect callback.
@@ -483,6 +701,10 @@ void ConnectionImpl::onWriteReady() {
         ENVOY_CONN_LOG(debug, "close during connected callback", *this);
         return;
       }
+    } else if (fallback_address_) {
+      ENVOY_CONN_LOG(debug, "delayed connection error: {}, falling back", *this, error);
+      useFallbackConnect();
+      return;
     } else {
       ENVOY_CONN_LOG(debug, "delayed connection error: {}", *this, error);
       closeSocket(ConnectionEvent::RemoteClose);
@@ -499,7 +721,7 @@ void ConnectionImpl::onWriteReady() {
     // write callback. This can happen if we manage to complete the SSL handshake in the write
     // callback, raise a connected event, and close the connection.
     closeSocket(ConnectionEvent::RemoteClose);
-  } else if ((state_ & InternalState::CloseWithFlush) && new_buffer_size == 0) {
+  } else if ((state_ & InternalState::CloseWithFlush) && pendingWriteBytes() == 0) {
     ENVOY_CONN_LOG(debug, "write flush complete", *this);
     closeSocket(ConnectionEvent::LocalClose);
   }
@@ -521,8 +743,120 @@ void ConnectionImpl::doConnect() {
       state_ |= InternalState::ImmediateConnectionError;
       state_ &= ~InternalState::Connecting;
       ENVOY_CONN_LOG(debug, "immediate connection error: {}", *this, errno);
+      if (fallback_address_) {
+        useFallbackConnect();
+        return;
+      }
+    }
+  }
+
+  if (fallback_address_ && !fallback_timer_) {
+    fallback_timer_ = dispatcher_.createTimer([this]() -> void { startFallbackConnect(); });
+    fallback_timer_->enableTimer(fallback_delay_);
+  }
+}
+
+void ConnectionImpl::doEnableHappyEyeballs(Address::InstanceConstSharedPtr fallback_address,
+                                           std::chrono::milliseconds delay) {
+  ASSERT(state_ & InternalState::Connecting);
+  fallback_address_ = fallback_address;
+  fallback_delay_ = delay;
+}
+
+void ConnectionImpl::startFallbackConnect() {
+  ENVOY_CONN_LOG(debug, "connecting to fallback {}", *this, fallback_address_->asString());
+  fallback_fd_ = ConnectionImplUtility::createSocket(fallback_address_, nullptr);
+  RELEASE_ASSERT(fallback_fd_ != -1);
+  if (tcp_fast_open_accepted_ != nullptr) {
+    Utility::enableTcpFastOpenConnect(fallback_fd_);
+  }
+
+  if (fallback_address_->connect(fallback_fd_) == -1 && errno != EINPROGRESS) {
+    ENVOY_CONN_LOG(debug, "immediate fallback connection error: {}", *this, errno);
+    cancelFallbackConnect();
+    return;
+  }
+
+  // Write becomes ready once the connect completes, whether it succeeded or not.
+  fallback_file_event_ = dispatcher_.createFileEvent(
+      fallback_fd_, [this](uint32_t) -> void { onFallbackWriteReady(); },
+      Event::FileTriggerType::Edge, Event::FileReadyType::Write);
+}
+
+void ConnectionImpl::onFallbackWriteReady() {
+  int error;
+  socklen_t error_size = sizeof(error);
+  int rc = getsockopt(fallback_fd_, SOL_SOCKET, SO_ERROR, &error, &error_size);
+  ASSERT(0 == rc);
+  UNREFERENCED_PARAMETER(rc);
+
+  if (error != 0) {
+    ENVOY_CONN_LOG(debug, "delayed fallback connection error: {}", *this, error);
+    cancelFallbackConnect();
+    return;
+  }
+
+  useFallbackConnect();
+}
+
+void ConnectionImpl::useFallbackConnect() {
+  ENVOY_CONN_LOG(debug, "using fallback {}", *this, fallback_address_->asString());
+  Address::InstanceConstSharedPtr address = fallback_address_;
+  const bool started = fallback_fd_ != -1;
+  int fd = fallback_fd_;
+  fallback_fd_ = -1;
+  cancelFallbackConnect();
+  if (!started) {
+    fd = ConnectionImplUtility::createSocket(address, nullptr);
+    RELEASE_ASSERT(fd != -1);
+  }
+
+  // Carry over the options that may have been set on the socket before it connected.
+  int no_delay = 0;
+  socklen_t no_delay_size = sizeof(no_delay);
+  if (getsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &no_delay, &no_delay_size) == 0 && no_delay) {
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+  }
+
+  file_event_.reset();
+  ::close(fd_);
+  fd_ = fd;
+  remote_address_ = address;
+  local_address_ = getNullLocalAddress(*address);
+  state_ |= InternalState::Connecting;
+  state_ &= ~InternalState::ImmediateConnectionError;
+  // A fallback connect that already completed makes write ready right away.
+  file_event_ = dispatcher_.createFileEvent(
+      fd_, [this](uint32_t events) -> void { onFileEvent(events); }, Event::FileTriggerType::Edge,
+      Event::FileReadyType::Read | Event::FileReadyType::Write);
+  onSocketReplaced();
+
+  if (!started) {
+    if (tcp_fast_open_accepted_ != nullptr) {
+      Utility::enableTcpFastOpenConnect(fd_);
     }
+    doConnect();
+  }
+}
+
+void ConnectionImpl::cancelFallbackConnect() {
+  fallback_address_ = nullptr;
+  if (fallback_timer_) {
+    fallback_timer_->disableTimer();
+  }
+  fallback_file_event_.reset();
+  if (fallback_fd_ != -1) {
+    ::close(fallback_fd_);
+    fallback_fd_ = -1;
+  }
+}
+
+void ConnectionImpl::doEnableTcpFastOpen(Stats::Counter& syn_data_accepted) {
+  if (fd_ == -1 || !Utility::enableTcpFastOpenConnect(fd_)) {
+    ENVOY_CONN_LOG(debug, "TCP Fast Open is not available: {}", *this, errno);
+    return;
   }
+  tcp_fast_open_accepted_ = &syn_data_accepted;
 }
 
 void ConnectionImpl::setBufferStats(const BufferStats& stats) {
@@ -535,6 +869,7 @@ void ConnectionImpl::updateReadBufferStats(uint64_t num_read, uint64_t new_size)
     return;
   }
 
+  accountBufferedBytes(last_read_buffer_size_, new_size);
   ConnectionImplUtility::updateBufferStats(num_read, new_size, last_read_buffer_size_,
                                            buffer_stats_->read_total_,
                                            buffer_stats_->read_current_);
@@ -545,6 +880,7 @@ void ConnectionImpl::updateWriteBufferStats(uint64_t num_written, uint64_t new_s
     return;
   }
 
+  accountBufferedBytes(last_write_buffer_size_, new_size);
   ConnectionImplUtility::updateBufferStats(num_written, new_size, last_write_buffer_size_,
                                            buffer_stats_->write_total_,
                                            buffer_stats_->write_current_);
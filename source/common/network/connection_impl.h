@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <list>
 #include <memory>
@@ -11,6 +12,7 @@
 
 #include "common/buffer/watermark_buffer.h"
 #include "common/common/logger.h"
+#include "common/common/recycler.h"
 #include "common/event/dispatcher_impl.h"
 #include "common/event/libevent.h"
 #include "common/network/filter_manager_impl.h"
@@ -44,6 +46,25 @@ public:
    */
   static int createSocket(Address::InstanceConstSharedPtr peer_address,
                           Address::InstanceConstSharedPtr source_address);
+
+  /**
+   * Adapt the size of socket reads to the traffic on a connection. The read size doubles when a
+   * read fills it and halves when a read returns less than half of it, staying between
+   * MIN_READ_SIZE and max_read_size.
+   * @param read_size supplies the size of the last read.
+   * @param bytes_read supplies the number of bytes the last read returned.
+   * @param max_read_size supplies the largest read size to grow to.
+   * @return uint64_t the size of the next read.
+   */
+  static uint64_t nextReadSize(uint64_t read_size, uint64_t bytes_read, uint64_t max_read_size);
+
+  static const uint64_t MIN_READ_SIZE = 4096;
+  static const uint64_t DEFAULT_READ_SIZE = 16384;
+  static const uint64_t MAX_READ_SIZE = 262144;
+  // Writes up to this size are copied into the write buffer instead of moved.
+  static const uint64_t COALESCE_WRITE_SIZE = 4096;
+  // The most a single splice() moves from a socket into a pipe.
+  static const uint64_t SPLICE_SIZE = 65536;
 };
 
 /**
@@ -51,6 +72,7 @@ public:
  */
 class ConnectionImpl : public virtual Connection,
                        public BufferSource,
+                       public Recycled,
                        protected Logger::Loggable<Logger::Id::connection> {
 public:
   ConnectionImpl(Event::DispatcherImpl& dispatcher, int fd,
@@ -68,6 +90,7 @@ public:
 
   // Network::Connection
   void addConnectionCallbacks(ConnectionCallbacks& cb) override;
+  void removeConnectionCallbacks(ConnectionCallbacks& cb) override;
   void close(ConnectionCloseType type) override;
   Event::Dispatcher& dispatcher() override;
   uint64_t id() const override;
@@ -84,8 +107,18 @@ public:
   void write(Buffer::Instance& data) override;
   void setBufferLimits(uint32_t limit) override;
   uint32_t bufferLimit() const override { return read_buffer_limit_; }
+  void setEventByteBudget(uint32_t bytes, Stats::Counter& read_exhausted,
+                          Stats::Counter& write_exhausted) override;
   bool usingOriginalDst() const override { return using_original_dst_; }
   bool aboveHighWatermark() const override { return above_high_watermark_; }
+  uint64_t bufferedBytes() const override {
+    return read_buffer_->length() + write_buffer_.length();
+  }
+  bool spliceTo(Connection& peer) override;
+  void shrinkBuffers() override {
+    read_buffer_->shrink();
+    write_buffer_.shrink();
+  }
 
   // Network::BufferSource
   Buffer::Instance& getReadBuffer() override { return *read_buffer_; }
@@ -101,17 +134,34 @@ protected:
 
   virtual void closeSocket(ConnectionEvent close_type);
   void doConnect();
+  void doEnableTcpFastOpen(Stats::Counter& syn_data_accepted);
+  void doEnableHappyEyeballs(Address::InstanceConstSharedPtr fallback_address,
+                             std::chrono::milliseconds delay);
+  // Called once the socket of a connect has been replaced by the socket of its fallback connect.
+  virtual void onSocketReplaced() {}
   void raiseEvent(ConnectionEvent event);
   // Should the read buffer be drained?
   bool shouldDrainReadBuffer() {
     return read_buffer_limit_ > 0 && read_buffer_->length() >= read_buffer_limit_;
   }
   // Mark read buffer ready to read in the event loop. This is used when yielding following
-  // shouldDrainReadBuffer().
-  // TODO(htuch): While this is the basis for also yielding to other connections to provide some
-  // fair sharing of CPU resources, the underlying event loop does not make any fairness guarantees.
-  // Reconsider how to make fairness happen.
+  // shouldDrainReadBuffer() or readBudgetExhausted().
   void setReadBufferReady() { file_event_->activate(Event::FileReadyType::Read); }
+  // Has a read event that read bytes_read used up the event byte budget? If so, the read is
+  // resumed from a new event, which libevent runs after the other events that are already active.
+  bool readBudgetExhausted(uint64_t bytes_read);
+  // Has a write event that wrote bytes_written used up the event byte budget while the write
+  // buffer still has data? If so, the write is resumed from a new event. @see
+  // readBudgetExhausted().
+  bool writeBudgetExhausted(uint64_t bytes_written);
+  // Run the read and write paths in the next event loop iteration, e.g. to resume I/O that waited
+  // on an asynchronous operation rather than on the socket.
+  void activateFileEvents(uint32_t events) { file_event_->activate(events); }
+
+  int fd() const { return fd_; }
+
+  // The size that reads grow to at most, which is capped by the buffer limit.
+  uint64_t maxReadSize() const;
 
   void onLowWatermark();
   void onHighWatermark();
@@ -122,6 +172,7 @@ protected:
   Buffer::InstancePtr read_buffer_;
   Buffer::WatermarkBuffer write_buffer_;
   uint32_t read_buffer_limit_ = 0;
+  uint64_t read_size_{ConnectionImplUtility::DEFAULT_READ_SIZE};
 
 private:
   // clang-format off
@@ -136,7 +187,22 @@ private:
   virtual IoResult doReadFromSocket();
   virtual IoResult doWriteToSocket();
   virtual void onConnected();
+  // Bytes accepted for writing that have not reached the socket yet, including any output the
+  // transport buffers itself, e.g. TLS records.
+  virtual uint64_t pendingWriteBytes() const { return write_buffer_.length() + splice_pipe_bytes_; }
+  // Splice from the socket into the pipe of splice_sink_.
+  IoResult doSpliceFromSocket();
+  // Splice from splice_pipe_ to the socket.
+  IoResult doSpliceToSocket();
   void onFileEvent(uint32_t events);
+  // Start the fallback connect of happy eyeballs, @see ClientConnection::enableHappyEyeballs().
+  void startFallbackConnect();
+  void onFallbackWriteReady();
+  // Continue with the fallback connect in place of the connect to the remote address, starting it
+  // if it has not started yet.
+  void useFallbackConnect();
+  // Give up on the fallback connect.
+  void cancelFallbackConnect();
   void onRead(uint64_t read_buffer_size);
   void onReadReady();
   void onWriteReady();
@@ -161,6 +227,28 @@ private:
   uint32_t read_disable_count_{0};
   const bool using_original_dst_;
   bool above_high_watermark_{false};
+  // The connection that data read from this one is spliced to, @see spliceTo().
+  ConnectionImpl* splice_sink_{};
+  // The connection splicing to this one. It fills splice_pipe_, which this connection drains to
+  // its socket. The pipe outlives the source, so data already read is still sent after the source
+  // closed.
+  ConnectionImpl* splice_source_{};
+  int splice_pipe_[2]{-1, -1};
+  uint64_t splice_pipe_bytes_{};
+  // Did the source stop reading because splice_pipe_ may be full?
+  bool splice_source_blocked_{};
+  // Set while a TCP Fast Open connection has not read anything yet.
+  Stats::Counter* tcp_fast_open_accepted_{};
+  // The bytes that a single read or write event may move, 0 if unlimited.
+  uint32_t event_byte_budget_{};
+  Stats::Counter* read_budget_exhausted_{};
+  Stats::Counter* write_budget_exhausted_{};
+  // Happy eyeballs state, set until the connect completes or gives up on the fallback.
+  Address::InstanceConstSharedPtr fallback_address_;
+  std::chrono::milliseconds fallback_delay_{};
+  Event::TimerPtr fallback_timer_;
+  int fallback_fd_{-1};
+  Event::FileEventPtr fallback_file_event_;
 };
 
 /**
@@ -174,6 +262,13 @@ public:
 
   // Network::ClientConnection
   void connect() override { doConnect(); }
+  void enableTcpFastOpen(Stats::Counter& syn_data_accepted) override {
+    doEnableTcpFastOpen(syn_data_accepted);
+  }
+  void enableHappyEyeballs(Address::InstanceConstSharedPtr fallback_address,
+                           std::chrono::milliseconds delay) override {
+    doEnableHappyEyeballs(fallback_address, delay);
+  }
 };
 
 } // namespace Network
@@ -1,9 +1,12 @@
 #include "common/network/dns_impl.h"
 
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
 #include <netdb.h>
 #include <netinet/ip.h>
 #include <sys/socket.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <list>
@@ -11,6 +14,7 @@
 #include <string>
 
 #include "common/common/assert.h"
+#include "common/common/enum_to_int.h"
 #include "common/network/address_impl.h"
 #include "common/network/utility.h"
 
@@ -23,7 +27,8 @@ DnsResolverImpl::DnsResolverImpl(
     Event::Dispatcher& dispatcher,
     const std::vector<Network::Address::InstanceConstSharedPtr>& resolvers)
     : dispatcher_(dispatcher),
-      timer_(dispatcher.createTimer([this] { onEventCallback(ARES_SOCKET_BAD, 0); })) {
+      timer_(dispatcher.createTimer([this] { onEventCallback(ARES_SOCKET_BAD, 0); })),
+      time_source_(ProdMonotonicTimeSource::instance_) {
   // This is also done in main(), to satisfy the requirement that c-ares is
   // initialized prior to threading. The additional call to ares_library_init()
   // here is a nop in normal execution, but exists for testing where we don't
@@ -59,64 +64,109 @@ void DnsResolverImpl::initializeChannel(ares_options* options, int optmask) {
   ares_init_options(&channel_, options, optmask | ARES_OPT_SOCK_STATE_CB);
 }
 
-void DnsResolverImpl::PendingResolution::onAresHostCallback(int status, int timeouts,
-                                                            hostent* hostent) {
+namespace {
+
+std::list<Address::InstanceConstSharedPtr> addressesFromHostent(const hostent* hostent) {
+  std::list<Address::InstanceConstSharedPtr> address_list;
+  if (hostent->h_addrtype == AF_INET) {
+    for (int i = 0; hostent->h_addr_list[i] != nullptr; ++i) {
+      ASSERT(hostent->h_length == sizeof(in_addr));
+      sockaddr_in address;
+      memset(&address, 0, sizeof(address));
+      address.sin_family = AF_INET;
+      address.sin_port = 0;
+      address.sin_addr = *reinterpret_cast<in_addr*>(hostent->h_addr_list[i]);
+      address_list.emplace_back(new Address::Ipv4Instance(&address));
+    }
+  } else if (hostent->h_addrtype == AF_INET6) {
+    for (int i = 0; hostent->h_addr_list[i] != nullptr; ++i) {
+      ASSERT(hostent->h_length == sizeof(in6_addr));
+      sockaddr_in6 address;
+      memset(&address, 0, sizeof(address));
+      address.sin6_family = AF_INET6;
+      address.sin6_port = 0;
+      address.sin6_addr = *reinterpret_cast<in6_addr*>(hostent->h_addr_list[i]);
+      address_list.emplace_back(new Address::Ipv6Instance(address));
+    }
+  }
+  return address_list;
+}
+
+// The most records whose TTLs are considered. An answer with more records is still used in full.
+const int MAX_TTL_RECORDS = 64;
+
+} // namespace
+
+void DnsResolverImpl::PendingResolution::onAresSearchCallback(int family, int status,
+                                                              int timeouts, unsigned char* abuf,
+                                                              int alen) {
+  ASSERT(pending_queries_ > 0);
+  pending_queries_--;
   // We receive ARES_EDESTRUCTION when destructing with pending queries.
   if (status == ARES_EDESTRUCTION) {
     ASSERT(owned_);
-    delete this;
+    if (pending_queries_ == 0) {
+      delete this;
+    }
     return;
   }
-  if (status == ARES_SUCCESS || !fallback_if_failed_) {
-    completed_ = true;
-  }
 
   std::list<Address::InstanceConstSharedPtr> address_list;
+  uint32_t ttl = 0;
   if (status == ARES_SUCCESS) {
-    if (hostent->h_addrtype == AF_INET) {
-      for (int i = 0; hostent->h_addr_list[i] != nullptr; ++i) {
-        ASSERT(hostent->h_length == sizeof(in_addr));
-        sockaddr_in address;
-        memset(&address, 0, sizeof(address));
-        address.sin_family = AF_INET;
-        address.sin_port = 0;
-        address.sin_addr = *reinterpret_cast<in_addr*>(hostent->h_addr_list[i]);
-        address_list.emplace_back(new Address::Ipv4Instance(&address));
+    hostent* hostent = nullptr;
+    int num_ttls = MAX_TTL_RECORDS;
+    if (family == AF_INET) {
+      ares_addrttl ttls[MAX_TTL_RECORDS];
+      status = ares_parse_a_reply(abuf, alen, &hostent, ttls, &num_ttls);
+      for (int i = 0; status == ARES_SUCCESS && i < num_ttls; ++i) {
+        ttl = i == 0 ? ttls[i].ttl : std::min<uint32_t>(ttl, ttls[i].ttl);
       }
-    } else if (hostent->h_addrtype == AF_INET6) {
-      for (int i = 0; hostent->h_addr_list[i] != nullptr; ++i) {
-        ASSERT(hostent->h_length == sizeof(in6_addr));
-        sockaddr_in6 address;
-        memset(&address, 0, sizeof(address));
-        address.sin6_family = AF_INET6;
-        address.sin6_port = 0;
-        address.sin6_addr = *reinterpret_cast<in6_addr*>(hostent->h_addr_list[i]);
-        address_list.emplace_back(new Address::Ipv6Instance(address));
+    } else {
+      ares_addr6ttl ttls[MAX_TTL_RECORDS];
+      status = ares_parse_aaaa_reply(abuf, alen, &hostent, ttls, &num_ttls);
+      for (int i = 0; status == ARES_SUCCESS && i < num_ttls; ++i) {
+        ttl = i == 0 ? ttls[i].ttl : std::min<uint32_t>(ttl, ttls[i].ttl);
       }
     }
+
+    if (status == ARES_SUCCESS) {
+      address_list = addressesFromHostent(hostent);
+    }
+    if (hostent != nullptr) {
+      ares_free_hostent(hostent);
+    }
   }
 
+  onResolutionComplete(family, status, timeouts, std::move(address_list),
+                       std::chrono::seconds(ttl));
+}
+
+void DnsResolverImpl::PendingResolution::onResolutionComplete(
+    int family, int status, int timeouts, std::list<Address::InstanceConstSharedPtr>&& address_list,
+    std::chrono::seconds ttl) {
   if (timeouts > 0) {
     ENVOY_LOG(debug, "DNS request timed out {} times", timeouts);
   }
 
-  if (completed_) {
-    if (!cancelled_) {
-      callback_(std::move(address_list));
-    }
-    if (owned_) {
-      delete this;
-      return;
-    }
+  if (status == ARES_SUCCESS && !address_list.empty()) {
+    (family == AF_INET ? v4_address_list_ : v6_address_list_) = std::move(address_list);
+    ttl_ = ttl_.count() < 0 ? ttl : std::min(ttl_, ttl);
   }
 
-  if (status != ARES_SUCCESS && fallback_if_failed_) {
-    fallback_if_failed_ = false;
-    getHostByName(AF_INET);
-    // Note: Nothing can follow this call to getHostByName due to deletion of this
-    // object upon synchronous resolution.
+  ASSERT(pending_families_ > 0);
+  if (--pending_families_ > 0) {
     return;
   }
+
+  completed_ = true;
+  std::list<Address::InstanceConstSharedPtr> result = std::move(v6_address_list_);
+  result.splice(result.end(), v4_address_list_);
+  callback_(std::move(result), ttl_.count() < 0 ? std::chrono::seconds(0) : ttl_);
+  ASSERT(pending_queries_ == 0);
+  if (owned_) {
+    delete this;
+  }
 }
 
 void DnsResolverImpl::updateAresTimer() {
@@ -163,43 +213,148 @@ void DnsResolverImpl::onAresSocketStateChange(int fd, int read, int write) {
 
 ActiveDnsQuery* DnsResolverImpl::resolve(const std::string& dns_name,
                                          DnsLookupFamily dns_lookup_family, ResolveCb callback) {
-  // TODO(hennna): Add DNS caching which will allow testing the edge case of a
-  // failed intial call to getHostbyName followed by a synchronous IPv4
-  // resolution.
-  std::unique_ptr<PendingResolution> pending_resolution(
-      new PendingResolution(callback, channel_, dns_name));
-  if (dns_lookup_family == DnsLookupFamily::Auto) {
-    pending_resolution->fallback_if_failed_ = true;
+  const std::string key = fmt::format("{}/{}", enumToInt(dns_lookup_family), dns_name);
+  const MonotonicTime now = time_source_.currentTime();
+
+  auto cached = cache_.find(key);
+  if (cached != cache_.end()) {
+    if (now < cached->second.expiry_time_) {
+      // Copy the addresses first, a refresh may complete synchronously and replace the entry.
+      std::list<Address::InstanceConstSharedPtr> address_list = cached->second.address_list_;
+      if (now >= cached->second.refresh_time_ && in_flight_.count(key) == 0) {
+        // Refresh ahead of expiry, so callers keep hitting the cache.
+        startResolution(key, dns_name, dns_lookup_family);
+      }
+      callback(std::move(address_list));
+      return nullptr;
+    }
+    cache_.erase(cached);
   }
 
-  if (dns_lookup_family == DnsLookupFamily::V4Only) {
-    pending_resolution->getHostByName(AF_INET);
-  } else {
-    pending_resolution->getHostByName(AF_INET6);
+  WaitingQuery* query = new WaitingQuery(callback);
+  auto in_flight = in_flight_.find(key);
+  if (in_flight != in_flight_.end()) {
+    // Share the query already in flight.
+    in_flight->second.emplace_back(query);
+    return query;
   }
 
-  if (pending_resolution->completed_) {
-    // Resolution does not need asynchronous behavior or network events. For
-    // example, localhost lookup.
+  in_flight_[key].emplace_back(query);
+  startResolution(key, dns_name, dns_lookup_family);
+
+  // Resolution does not need asynchronous behavior or network events if it completed already, for
+  // example for a localhost lookup.
+  in_flight = in_flight_.find(key);
+  if (in_flight == in_flight_.end()) {
     return nullptr;
-  } else {
+  }
+  for (const WaitingQueryPtr& waiting : in_flight->second) {
+    if (waiting.get() == query) {
+      return query;
+    }
+  }
+  return nullptr;
+}
+
+void DnsResolverImpl::startResolution(const std::string& key, const std::string& dns_name,
+                                      DnsLookupFamily dns_lookup_family) {
+  // Mark the resolution in flight, also for background refreshes without waiting callers.
+  in_flight_[key];
+
+  std::unique_ptr<PendingResolution> pending_resolution(new PendingResolution(
+      [this, key](std::list<Address::InstanceConstSharedPtr>&& address_list,
+                  std::chrono::seconds ttl) -> void {
+        onResolution(key, std::move(address_list), ttl);
+      },
+      channel_, dns_name));
+  const bool resolve_v6 = dns_lookup_family != DnsLookupFamily::V4Only;
+  const bool resolve_v4 = dns_lookup_family != DnsLookupFamily::V6Only;
+  pending_resolution->pending_families_ = (resolve_v6 ? 1 : 0) + (resolve_v4 ? 1 : 0);
+  // Both families of Auto are queried at the same time. The resolution only completes, and is
+  // only deleted, after the last family, so pending_resolution stays valid in between.
+  if (resolve_v6) {
+    pending_resolution->getHostByName(AF_INET6);
+  }
+  if (resolve_v4) {
+    pending_resolution->getHostByName(AF_INET);
+  }
+
+  if (!pending_resolution->completed_) {
     // Enable timer to wake us up if the request times out.
     updateAresTimer();
 
     // The PendingResolution will self-delete when the request completes
-    // (including if cancelled or if ~DnsResolverImpl() happens).
+    // (including if ~DnsResolverImpl() happens).
     pending_resolution->owned_ = true;
-    return pending_resolution.release();
+    pending_resolution.release();
+  }
+}
+
+void DnsResolverImpl::onResolution(const std::string& key,
+                                   std::list<Address::InstanceConstSharedPtr>&& address_list,
+                                   std::chrono::seconds ttl) {
+  // A failed refresh keeps serving the cached entry until it expires.
+  if (!address_list.empty() && ttl.count() > 0) {
+    const MonotonicTime now = time_source_.currentTime();
+    CachedResolution& cached = cache_[key];
+    cached.address_list_ = address_list;
+    cached.refresh_time_ =
+        now + std::chrono::duration_cast<std::chrono::milliseconds>(ttl) * 9 / 10;
+    cached.expiry_time_ = now + ttl;
+  }
+
+  // Callbacks may resolve again, so take the waiting queries out first.
+  auto in_flight = in_flight_.find(key);
+  ASSERT(in_flight != in_flight_.end());
+  std::list<WaitingQueryPtr> waiting = std::move(in_flight->second);
+  in_flight_.erase(in_flight);
+
+  for (const WaitingQueryPtr& query : waiting) {
+    if (!query->cancelled_) {
+      query->callback_(std::list<Address::InstanceConstSharedPtr>(address_list));
+    }
   }
 }
 
 void DnsResolverImpl::PendingResolution::getHostByName(int family) {
-  ares_gethostbyname(channel_, dns_name_.c_str(), family,
-                     [](void* arg, int status, int timeouts, hostent* hostent) {
-                       static_cast<PendingResolution*>(arg)->onAresHostCallback(status, timeouts,
-                                                                                hostent);
-                     },
-                     this);
+  // IP literals resolve to themselves, and only for their own family.
+  in6_addr literal;
+  if (inet_pton(AF_INET, dns_name_.c_str(), &literal) == 1 ||
+      inet_pton(AF_INET6, dns_name_.c_str(), &literal) == 1) {
+    std::list<Address::InstanceConstSharedPtr> address_list;
+    if (inet_pton(family, dns_name_.c_str(), &literal) == 1) {
+      address_list.emplace_back(Utility::parseInternetAddress(dns_name_));
+    }
+    onResolutionComplete(family, address_list.empty() ? ARES_ENOTFOUND : ARES_SUCCESS, 0,
+                         std::move(address_list), std::chrono::seconds(0));
+    // Note: Nothing can follow this call due to deletion of this object upon resolution.
+    return;
+  }
+
+  hostent* hostent = nullptr;
+  if (ares_gethostbyname_file(channel_, dns_name_.c_str(), family, &hostent) == ARES_SUCCESS) {
+    std::list<Address::InstanceConstSharedPtr> address_list = addressesFromHostent(hostent);
+    ares_free_hostent(hostent);
+    onResolutionComplete(family, ARES_SUCCESS, 0, std::move(address_list),
+                         std::chrono::seconds(0));
+    return;
+  }
+
+  // The callback tells the families apart, both may be in flight at the same time.
+  ares_callback callback;
+  if (family == AF_INET) {
+    callback = [](void* arg, int status, int timeouts, unsigned char* abuf, int alen) {
+      static_cast<PendingResolution*>(arg)->onAresSearchCallback(AF_INET, status, timeouts, abuf,
+                                                                 alen);
+    };
+  } else {
+    callback = [](void* arg, int status, int timeouts, unsigned char* abuf, int alen) {
+      static_cast<PendingResolution*>(arg)->onAresSearchCallback(AF_INET6, status, timeouts, abuf,
+                                                                 alen);
+    };
+  }
+  pending_queries_++;
+  ares_search(channel_, dns_name_.c_str(), C_IN, family == AF_INET ? T_A : T_AAAA, callback, this);
 }
 
 } // namespace Network
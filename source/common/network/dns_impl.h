@@ -2,10 +2,15 @@
 
 #include <netdb.h>
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
+#include "envoy/common/time.h"
 #include "envoy/event/dispatcher.h"
 #include "envoy/event/file_event.h"
 #include "envoy/network/dns.h"
@@ -24,6 +29,13 @@ class DnsResolverImplPeer;
 /**
  * Implementation of DnsResolver that uses c-ares. All calls and callbacks are assumed to
  * happen on the thread that owns the creating dispatcher.
+ *
+ * Successful DNS answers are cached for their TTL, so clusters resolving the same name through the
+ * same resolver share one lookup per TTL. An entry is refreshed in the background once it is near
+ * expiry, and concurrent resolutions of the same name share one query.
+ *
+ * DnsLookupFamily::Auto queries both families at the same time, so a failing or slow family does
+ * not hold up the other one. The IPv6 addresses are returned first, followed by the IPv4 ones.
  */
 class DnsResolverImpl : public DnsResolver, protected Logger::Loggable<Logger::Id::upstream> {
 public:
@@ -37,46 +49,84 @@ public:
 
 private:
   friend class DnsResolverImplPeer;
-  struct PendingResolution : public ActiveDnsQuery {
-    // Network::ActiveDnsQuery
-    PendingResolution(ResolveCb callback, ares_channel channel, const std::string& dns_name)
-        : callback_(callback), channel_(channel), dns_name_(dns_name) {}
 
-    void cancel() override {
-      // c-ares only supports channel-wide cancellation, so we just allow the
-      // network events to continue but don't invoke the callback on completion.
-      cancelled_ = true;
-    }
+  /**
+   * Called when a c-ares resolution is complete.
+   * @param address_list supplies the resolved addresses, empty if the resolution failed.
+   * @param ttl supplies how long the addresses may be cached. Zero if they must not be cached.
+   */
+  typedef std::function<void(std::list<Address::InstanceConstSharedPtr>&& address_list,
+                             std::chrono::seconds ttl)>
+      ResolutionCb;
+
+  struct PendingResolution {
+    PendingResolution(ResolutionCb callback, ares_channel channel, const std::string& dns_name)
+        : callback_(callback), channel_(channel), dns_name_(dns_name) {}
 
     /**
-     * c-ares ares_gethostbyname() query callback.
-     * @param status return status of call to ares_gethostbyname.
+     * c-ares ares_search() query callback.
+     * @param family supplies the family that was queried.
+     * @param status return status of call to ares_search.
      * @param timeouts the number of times the request timed out.
-     * @param hostent structure that stores information about a given host.
+     * @param abuf supplies the DNS answer.
+     * @param alen supplies the length of the DNS answer.
+     */
+    void onAresSearchCallback(int family, int status, int timeouts, unsigned char* abuf,
+                              int alen);
+    /**
+     * Completes the resolution of a family. The resolution completes once all families have.
      */
-    void onAresHostCallback(int status, int timeouts, hostent* hostent);
+    void onResolutionComplete(int family, int status, int timeouts,
+                              std::list<Address::InstanceConstSharedPtr>&& address_list,
+                              std::chrono::seconds ttl);
     /**
-     * wrapper function of call to ares_gethostbyname.
+     * Resolve dns_name for a family. IP literals and names in the hosts file resolve synchronously
+     * and are not cached. Other names are queried with ares_search(), unlike
+     * ares_gethostbyname() it returns the TTLs of the answer. Every family to be resolved must be
+     * counted in pending_families_ before the first call.
      * @param family currently AF_INET and AF_INET6 are supported.
      */
     void getHostByName(int family);
 
-    // Caller supplied callback to invoke on query completion or error.
-    const ResolveCb callback_;
+    // Resolution callback to invoke on query completion or error.
+    const ResolutionCb callback_;
     // Does the object own itself? Resource reclamation occurs via self-deleting
     // on query completion or error.
     bool owned_ = false;
     // Has the query completed? Only meaningful if !owned_;
     bool completed_ = false;
-    // Was the query cancelled via cancel()?
-    bool cancelled_ = false;
-    // If dns_lookup_family is "fallback", fallback to v4 address if v6
-    // resolution failed.
-    bool fallback_if_failed_ = false;
+    // The families whose resolution has not completed yet.
+    uint32_t pending_families_ = 0;
+    // ares_search() queries that c-ares still has to call back.
+    uint32_t pending_queries_ = 0;
+    std::list<Address::InstanceConstSharedPtr> v6_address_list_;
+    std::list<Address::InstanceConstSharedPtr> v4_address_list_;
+    // The smallest TTL of the families that resolved, unset until one has.
+    std::chrono::seconds ttl_{-1};
     const ares_channel channel_;
     const std::string dns_name_;
   };
 
+  // A caller waiting on a resolution.
+  struct WaitingQuery : public ActiveDnsQuery {
+    WaitingQuery(ResolveCb callback) : callback_(callback) {}
+
+    // Network::ActiveDnsQuery
+    void cancel() override { cancelled_ = true; }
+
+    const ResolveCb callback_;
+    bool cancelled_ = false;
+  };
+
+  typedef std::unique_ptr<WaitingQuery> WaitingQueryPtr;
+
+  struct CachedResolution {
+    std::list<Address::InstanceConstSharedPtr> address_list_;
+    // Once passed, the next hit refreshes the entry in the background.
+    MonotonicTime refresh_time_;
+    MonotonicTime expiry_time_;
+  };
+
   // Callback for events on sockets tracked in events_.
   void onEventCallback(int fd, uint32_t events);
   // c-ares callback when a socket state changes, indicating that libevent
@@ -86,11 +136,23 @@ private:
   void initializeChannel(ares_options* options, int optmask);
   // Update timer for c-ares timeouts.
   void updateAresTimer();
+  // Start a c-ares resolution for a cache key that has none in flight.
+  void startResolution(const std::string& key, const std::string& dns_name,
+                       DnsLookupFamily dns_lookup_family);
+  // Cache a completed resolution and invoke the callers waiting on it.
+  void onResolution(const std::string& key,
+                    std::list<Address::InstanceConstSharedPtr>&& address_list,
+                    std::chrono::seconds ttl);
 
   Event::Dispatcher& dispatcher_;
   Event::TimerPtr timer_;
   ares_channel channel_;
   std::unordered_map<int, Event::FileEventPtr> events_;
+  MonotonicTimeSource& time_source_;
+  // Keyed by lookup family and DNS name.
+  std::unordered_map<std::string, CachedResolution> cache_;
+  // Resolutions in flight and the callers waiting on each. Background refreshes have none.
+  std::unordered_map<std::string, std::list<WaitingQueryPtr>> in_flight_;
 };
 
 } // namespace Network
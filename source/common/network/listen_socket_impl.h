@@ -39,7 +39,14 @@ protected:
  */
 class TcpListenSocket : public ListenSocketImpl {
 public:
-  TcpListenSocket(Address::InstanceConstSharedPtr address, bool bind_to_port);
+  /**
+   * @param address supplies the address to bind to.
+   * @param bind_to_port supplies whether to bind the socket.
+   * @param reuse_port supplies whether to set SO_REUSEPORT so that several sockets can be bound to
+   *        the same address, with the kernel balancing incoming connections between them.
+   */
+  TcpListenSocket(Address::InstanceConstSharedPtr address, bool bind_to_port,
+                  bool reuse_port = false);
   TcpListenSocket(int fd, Address::InstanceConstSharedPtr address);
 };
 
@@ -1,10 +1,13 @@
 #include "common/network/listener_impl.h"
 
+#include <fcntl.h>
+#include <sys/socket.h>
 #include <sys/un.h>
 
 #include "envoy/common/exception.h"
 #include "envoy/network/connection_handler.h"
 
+#include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/event/dispatcher_impl.h"
 #include "common/event/file_event_impl.h"
@@ -13,7 +16,6 @@
 #include "common/network/utility.h"
 #include "common/ssl/connection_impl.h"
 
-#include "event2/listener.h"
 #include "spdlog/spdlog.h"
 
 namespace Envoy {
@@ -27,12 +29,66 @@ Address::InstanceConstSharedPtr ListenerImpl::getOriginalDst(int fd) {
   return Utility::getOriginalDst(fd);
 }
 
-void ListenerImpl::listenCallback(evconnlistener*, evutil_socket_t fd, sockaddr* remote_addr,
-                                  int remote_addr_len, void* arg) {
-  ListenerImpl* listener = static_cast<ListenerImpl*>(arg);
+void ListenerImpl::onSocketEvent() {
+  for (uint32_t accepted = 0;
+       options_.max_accepts_per_wakeup_ == 0 || accepted < options_.max_accepts_per_wakeup_;) {
+    // Connections over the limit stay in the listen backlog, where the kernel pushes back on
+    // clients once it is full, instead of being accepted only to be closed.
+    if (options_.accept_limiter_ != nullptr && !options_.accept_limiter_->tryAccept()) {
+      downstream_cx_accept_rate_limited_.inc();
+      rate_limited_ = true;
+      updateSocketEvent();
+      accept_retry_timer_->enableTimer(options_.accept_limiter_->retryInterval());
+      return;
+    }
+
+    sockaddr_storage remote_addr;
+    socklen_t remote_addr_len = sizeof(remote_addr);
+#ifdef __linux__
+    const int fd = accept4(socket_.fd(), reinterpret_cast<sockaddr*>(&remote_addr),
+                           &remote_addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    const int fd =
+        accept(socket_.fd(), reinterpret_cast<sockaddr*>(&remote_addr), &remote_addr_len);
+    if (fd != -1) {
+      RELEASE_ASSERT(fcntl(fd, F_SETFL, O_NONBLOCK) != -1);
+      RELEASE_ASSERT(fcntl(fd, F_SETFD, FD_CLOEXEC) != -1);
+    }
+#endif
+    if (fd == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      } else if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // We should never get any other error. This can happen if we run out of FDs or memory. In
+      // those cases just crash.
+      PANIC(fmt::format("listener accept failure: {}", strerror(errno)));
+    }
+
+    accepted++;
+    acceptConnection(fd, reinterpret_cast<const sockaddr*>(&remote_addr), remote_addr_len);
+    // The callbacks may have disabled the listener.
+    if (disabled_) {
+      return;
+    }
+  }
+
+  // The socket is level triggered, so the remaining connections are accepted on the next wakeup,
+  // after the events that are already ready.
+  downstream_cx_accept_batch_limited_.inc();
+}
+
+void ListenerImpl::acceptConnection(int fd, const sockaddr* remote_addr,
+                                    socklen_t remote_addr_len) {
+  ListenerImpl* listener = this;
   Address::InstanceConstSharedPtr final_local_address = listener->socket_.localAddress();
   bool using_original_dst = false;
 
+  if (listener->options_.tcp_fast_open_ && Utility::tcpFastOpenAccepted(fd)) {
+    listener->downstream_cx_tcp_fast_open_.inc();
+  }
+
   // Get the local address from the new socket if the listener is listening on the all hosts
   // address (e.g., 0.0.0.0 for IPv4).
   auto ip = final_local_address->ip();
@@ -80,7 +136,10 @@ void ListenerImpl::listenCallback(evconnlistener*, evutil_socket_t fd, sockaddr*
     // TODO(jamessynge): We need to keep per-family stats. BUT, should it be based on the original
     // family or the local family? Probably local family, as the original proxy can take care of
     // stats for the original family.
-    listener->newConnection(fd, final_remote_address, final_local_address, using_original_dst);
+    if (!listener->cb_.onAccept(fd, final_remote_address, final_local_address,
+                                using_original_dst)) {
+      listener->newConnection(fd, final_remote_address, final_local_address, using_original_dst);
+    }
   }
 }
 
@@ -89,25 +148,55 @@ ListenerImpl::ListenerImpl(Network::ConnectionHandler& conn_handler,
                            ListenerCallbacks& cb, Stats::Scope& scope,
                            const Network::ListenerOptions& listener_options)
     : connection_handler_(conn_handler), dispatcher_(dispatcher), socket_(socket), cb_(cb),
-      proxy_protocol_(scope), options_(listener_options), listener_(nullptr) {
+      proxy_protocol_(scope), options_(listener_options),
+      downstream_cx_tcp_fast_open_(scope.counter("downstream_cx_tcp_fast_open")),
+      downstream_cx_read_budget_exhausted_(scope.counter("downstream_cx_read_budget_exhausted")),
+      downstream_cx_write_budget_exhausted_(scope.counter("downstream_cx_write_budget_exhausted")),
+      downstream_cx_accept_batch_limited_(scope.counter("downstream_cx_accept_batch_limited")),
+      downstream_cx_accept_rate_limited_(scope.counter("downstream_cx_accept_rate_limited")) {
 
   if (options_.bind_to_port_) {
-    listener_.reset(
-        evconnlistener_new(&dispatcher_.base(), listenCallback, this, 0, -1, socket.fd()));
-
-    if (!listener_) {
+    // The backlog that evconnlistener used.
+    if (::listen(socket.fd(), 128) != 0) {
       throw CreateListenerException(
           fmt::format("cannot listen on socket: {}", socket.localAddress()->asString()));
     }
 
-    evconnlistener_set_error_cb(listener_.get(), errorCallback);
+    file_event_ = dispatcher_.createFileEvent(socket.fd(), [this](uint32_t) { onSocketEvent(); },
+                                              Event::FileTriggerType::Level,
+                                              Event::FileReadyType::Read);
+    if (options_.accept_limiter_ != nullptr) {
+      accept_retry_timer_ = dispatcher_.createTimer([this]() -> void {
+        rate_limited_ = false;
+        updateSocketEvent();
+      });
+    }
+  }
+}
+
+void ListenerImpl::disable() {
+  disabled_ = true;
+  updateSocketEvent();
+}
+
+void ListenerImpl::enable() {
+  disabled_ = false;
+  updateSocketEvent();
+}
+
+void ListenerImpl::updateSocketEvent() {
+  if (file_event_) {
+    file_event_->setEnabled(disabled_ || rate_limited_ ? 0 : Event::FileReadyType::Read);
   }
 }
 
-void ListenerImpl::errorCallback(evconnlistener*, void*) {
-  // We should never get an error callback. This can happen if we run out of FDs or memory. In those
-  // cases just crash.
-  PANIC(fmt::format("listener accept failure: {}", strerror(errno)));
+void ListenerImpl::setConnectionOptions(Connection& connection) {
+  connection.setBufferLimits(options_.per_connection_buffer_limit_bytes_);
+  if (options_.per_event_byte_budget_ > 0) {
+    connection.setEventByteBudget(options_.per_event_byte_budget_,
+                                  downstream_cx_read_budget_exhausted_,
+                                  downstream_cx_write_budget_exhausted_);
+  }
 }
 
 void ListenerImpl::newConnection(int fd, Address::InstanceConstSharedPtr remote_address,
@@ -115,7 +204,7 @@ void ListenerImpl::newConnection(int fd, Address::InstanceConstSharedPtr remote_
                                  bool using_original_dst) {
   ConnectionPtr new_connection(
       new ConnectionImpl(dispatcher_, fd, remote_address, local_address, using_original_dst, true));
-  new_connection->setBufferLimits(options_.per_connection_buffer_limit_bytes_);
+  setConnectionOptions(*new_connection);
   cb_.onNewConnection(std::move(new_connection));
 }
 
@@ -125,7 +214,7 @@ void SslListenerImpl::newConnection(int fd, Address::InstanceConstSharedPtr remo
   ConnectionPtr new_connection(
       new Ssl::ConnectionImpl(dispatcher_, fd, remote_address, local_address, using_original_dst,
                               true, ssl_ctx_, Ssl::ConnectionImpl::InitialState::Server));
-  new_connection->setBufferLimits(options_.per_connection_buffer_limit_bytes_);
+  setConnectionOptions(*new_connection);
   cb_.onNewConnection(std::move(new_connection));
 }
 
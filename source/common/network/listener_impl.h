@@ -1,20 +1,23 @@
 #pragma once
 
+#include <sys/socket.h>
+
+#include "envoy/event/file_event.h"
+#include "envoy/event/timer.h"
 #include "envoy/network/connection_handler.h"
 #include "envoy/network/listener.h"
 
 #include "common/event/dispatcher_impl.h"
-#include "common/event/libevent.h"
 #include "common/network/listen_socket_impl.h"
 #include "common/network/proxy_protocol.h"
 
-#include "event2/event.h"
-
 namespace Envoy {
 namespace Network {
 
 /**
- * libevent implementation of Network::Listener.
+ * libevent implementation of Network::Listener. Connections are accepted by a loop of its own
+ * rather than by an evconnlistener, so that each wakeup accepts a bounded number of connections
+ * and the accept rate can be limited. Connections over a limit wait in the listen backlog.
  */
 class ListenerImpl : public Listener {
 public:
@@ -22,24 +25,23 @@ public:
                ListenSocket& socket, ListenerCallbacks& cb, Stats::Scope& scope,
                const ListenerOptions& listener_options);
 
-  /**
-   * Accept/process a new connection.
-   * @param fd supplies the new connection's fd.
-   * @param remote_address supplies the remote address for the new connection.
-   * @param local_address supplies the local address for the new connection.
-   */
-  virtual void newConnection(int fd, Address::InstanceConstSharedPtr remote_address,
-                             Address::InstanceConstSharedPtr local_address,
-                             bool using_original_dst);
-
   /**
    * @return the socket supplied to the listener at construction time
    */
   ListenSocket& socket() { return socket_; }
 
+  // Network::Listener
+  void disable() override;
+  void enable() override;
+  void newConnection(int fd, Address::InstanceConstSharedPtr remote_address,
+                     Address::InstanceConstSharedPtr local_address,
+                     bool using_original_dst) override;
+
 protected:
   virtual Address::InstanceConstSharedPtr getLocalAddress(int fd);
   virtual Address::InstanceConstSharedPtr getOriginalDst(int fd);
+  // Apply the per connection options of the listener to a newly accepted connection.
+  void setConnectionOptions(Connection& connection);
 
   Network::ConnectionHandler& connection_handler_;
   Event::DispatcherImpl& dispatcher_;
@@ -47,13 +49,26 @@ protected:
   ListenerCallbacks& cb_;
   ProxyProtocol proxy_protocol_;
   const ListenerOptions options_;
+  // Accepted connections whose SYN carried data, only counted if options_.tcp_fast_open_ is set.
+  Stats::Counter& downstream_cx_tcp_fast_open_;
+  // Read and write events of accepted connections that used up options_.per_event_byte_budget_.
+  Stats::Counter& downstream_cx_read_budget_exhausted_;
+  Stats::Counter& downstream_cx_write_budget_exhausted_;
 
 private:
-  static void errorCallback(evconnlistener* listener, void* context);
-  static void listenCallback(evconnlistener*, evutil_socket_t fd, sockaddr* remote_addr,
-                             int remote_addr_len, void* arg);
+  void onSocketEvent();
+  void acceptConnection(int fd, const sockaddr* remote_addr, socklen_t remote_addr_len);
+  // Whether the listen socket is watched, which it is unless the listener is disabled or waits
+  // for the accept limiter.
+  void updateSocketEvent();
 
-  Event::Libevent::ListenerPtr listener_;
+  Event::FileEventPtr file_event_;
+  // Set if options_.accept_limiter_ is, to accept again once the limiter allows it.
+  Event::TimerPtr accept_retry_timer_;
+  Stats::Counter& downstream_cx_accept_batch_limited_;
+  Stats::Counter& downstream_cx_accept_rate_limited_;
+  bool disabled_{};
+  bool rate_limited_{};
 };
 
 class SslListenerImpl : public ListenerImpl {
@@ -64,7 +79,7 @@ public:
       : ListenerImpl(conn_handler, dispatcher, socket, cb, scope, listener_options),
         ssl_ctx_(ssl_ctx) {}
 
-  // ListenerImpl
+  // Network::Listener
   void newConnection(int fd, Address::InstanceConstSharedPtr remote_address,
                      Address::InstanceConstSharedPtr local_address,
                      bool using_original_dst) override;
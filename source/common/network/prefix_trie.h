@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Network {
+namespace Address {
+
+/**
+ * Bit operations on the keys of a PrefixTrie. Keys are addresses with the most significant bit
+ * first: uint32_t in host byte order for IPv4, and the network byte order array for IPv6.
+ */
+template <class Key> struct PrefixTrieKey;
+
+template <> struct PrefixTrieKey<uint32_t> {
+  static const uint32_t BITS = 32;
+
+  static bool bit(uint32_t key, uint32_t index) { return (key >> (31 - index)) & 1; }
+
+  static uint32_t mask(uint32_t key, uint32_t length) {
+    return length == 0 ? 0 : key & (~0U << (32 - length));
+  }
+
+  static uint32_t commonLength(uint32_t a, uint32_t b, uint32_t max_length) {
+    const uint32_t diff = a ^ b;
+    return diff == 0 ? max_length : std::min<uint32_t>(__builtin_clz(diff), max_length);
+  }
+};
+
+typedef std::array<uint8_t, 16> Ipv6PrefixTrieKey;
+
+template <> struct PrefixTrieKey<Ipv6PrefixTrieKey> {
+  static const uint32_t BITS = 128;
+
+  static bool bit(const Ipv6PrefixTrieKey& key, uint32_t index) {
+    return (key[index / 8] >> (7 - index % 8)) & 1;
+  }
+
+  static Ipv6PrefixTrieKey mask(const Ipv6PrefixTrieKey& key, uint32_t length) {
+    Ipv6PrefixTrieKey masked = key;
+    for (uint8_t& byte : masked) {
+      if (length >= 8) {
+        length -= 8;
+      } else {
+        byte &= static_cast<uint8_t>(0xff00 >> length);
+        length = 0;
+      }
+    }
+    return masked;
+  }
+
+  static uint32_t commonLength(const Ipv6PrefixTrieKey& a, const Ipv6PrefixTrieKey& b,
+                               uint32_t max_length) {
+    for (uint32_t i = 0; i < a.size() && i * 8 < max_length; i++) {
+      const uint32_t diff = a[i] ^ b[i];
+      if (diff != 0) {
+        // __builtin_clz() counts the 24 high bits of the promoted byte as well.
+        return std::min<uint32_t>(i * 8 + __builtin_clz(diff) - 24, max_length);
+      }
+    }
+    return max_length;
+  }
+};
+
+/**
+ * Set of address prefixes, each with a value, answering whether an address falls in any of them and
+ * which of them it matches longest. The prefixes are kept in a path compressed binary trie, which
+ * has at most two nodes per prefix stored in one vector, and a lookup visits at most one node per
+ * bit of the longest matching prefix.
+ */
+template <class Key> class PrefixTrie {
+public:
+  // Value of the lookups that match no prefix.
+  static const uint32_t NO_VALUE = UINT32_MAX;
+
+  /**
+   * Add a prefix, or replace the value of one added before. Bits of the prefix past its length are
+   * ignored.
+   * @param prefix supplies the prefix.
+   * @param length supplies the number of leading bits of the prefix, at most Key's bit count.
+   * @param value supplies the value returned by longestMatch() for addresses that match this
+   *        prefix longest. It must not be NO_VALUE.
+   */
+  void insert(const Key& prefix, uint32_t length, uint32_t value = 0) {
+    ASSERT(length <= Traits::BITS);
+    ASSERT(value != NO_VALUE);
+    const Key key = Traits::mask(prefix, length);
+    if (nodes_.empty()) {
+      addNode(Traits::mask(key, 0), 0, NO_VALUE);
+    }
+
+    // Indexes rather than references, as adding nodes may reallocate the vector. Each node visited
+    // matches the prefix up to its own length, which is less than or equal to the prefix's.
+    uint32_t index = 0;
+    while (true) {
+      if (nodes_[index].length_ == length) {
+        nodes_[index].value_ = value;
+        return;
+      }
+
+      const bool branch = Traits::bit(key, nodes_[index].length_);
+      const uint32_t child = nodes_[index].children_[branch];
+      if (child == NONE) {
+        const uint32_t leaf = addNode(key, length, value);
+        nodes_[index].children_[branch] = leaf;
+        return;
+      }
+
+      const uint32_t child_length = nodes_[child].length_;
+      const uint32_t common =
+          Traits::commonLength(nodes_[child].prefix_, key, std::min(child_length, length));
+      if (common == child_length) {
+        index = child;
+        continue;
+      }
+
+      // The prefix leaves the child's path before its end, so a node is spliced in where they
+      // part. It is the prefix itself if the prefix ends there.
+      const uint32_t split =
+          addNode(Traits::mask(key, common), common, common == length ? value : NO_VALUE);
+      nodes_[split].children_[Traits::bit(nodes_[child].prefix_, common)] = child;
+      if (common != length) {
+        const uint32_t leaf = addNode(key, length, value);
+        nodes_[split].children_[Traits::bit(key, common)] = leaf;
+      }
+      nodes_[index].children_[branch] = split;
+      return;
+    }
+  }
+
+  /**
+   * @return true if the address falls in any of the prefixes.
+   */
+  bool contains(const Key& address) const { return lookup(address, false) != NO_VALUE; }
+
+  /**
+   * @return uint32_t the value of the longest prefix the address falls in, or NO_VALUE if there is
+   *         none.
+   */
+  uint32_t longestMatch(const Key& address) const { return lookup(address, true); }
+
+  /**
+   * @return bool true if no prefix was added.
+   */
+  bool empty() const { return nodes_.empty(); }
+
+private:
+  typedef PrefixTrieKey<Key> Traits;
+
+  struct Node {
+    Key prefix_;
+    uint32_t children_[2];
+    // NO_VALUE unless prefix_/length_ is one of the prefixes.
+    uint32_t value_;
+    uint8_t length_;
+  };
+
+  static const uint32_t NONE = 0;
+
+  uint32_t addNode(const Key& prefix, uint32_t length, uint32_t value) {
+    nodes_.push_back(Node{prefix, {NONE, NONE}, value, static_cast<uint8_t>(length)});
+    return nodes_.size() - 1;
+  }
+
+  uint32_t lookup(const Key& address, bool longest) const {
+    uint32_t value = NO_VALUE;
+    if (nodes_.empty()) {
+      return value;
+    }
+
+    uint32_t index = 0;
+    do {
+      const Node& node = nodes_[index];
+      if (Traits::commonLength(node.prefix_, address, node.length_) != node.length_) {
+        break;
+      }
+      if (node.value_ != NO_VALUE) {
+        value = node.value_;
+        if (!longest) {
+          break;
+        }
+      }
+      if (node.length_ == Traits::BITS) {
+        break;
+      }
+      index = node.children_[Traits::bit(address, node.length_)];
+    } while (index != NONE);
+    return value;
+  }
+
+  // The root, which has length 0, is at index 0. No node points back to it, so 0 marks a missing
+  // child.
+  std::vector<Node> nodes_;
+};
+
+template <class Key> const uint32_t PrefixTrie<Key>::NO_VALUE;
+template <class Key> const uint32_t PrefixTrie<Key>::NONE;
+
+} // namespace Address
+} // namespace Network
+} // namespace Envoy
@@ -1,8 +1,12 @@
 #include "common/network/proxy_protocol.h"
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 
@@ -11,15 +15,78 @@
 #include "envoy/event/file_event.h"
 #include "envoy/stats/stats.h"
 
-#include "common/common/empty_string.h"
-#include "common/common/utility.h"
+#include "common/common/assert.h"
 #include "common/network/address_impl.h"
 #include "common/network/listener_impl.h"
-#include "common/network/utility.h"
 
 namespace Envoy {
 namespace Network {
 
+namespace {
+
+// The V2 signature can't start a V1 header, so the first byte tells the versions apart.
+const char PROXY_PROTO_V2_SIGNATURE[] = "\r\n\r\n\0\r\nQUIT\n";
+const size_t PROXY_PROTO_V2_SIGNATURE_LEN = 12;
+const char PROXY_PROTO_V1_SIGNATURE[] = "PROXY ";
+const size_t PROXY_PROTO_V1_SIGNATURE_LEN = 6;
+
+const uint8_t PROXY_PROTO_V2_LOCAL = 0x0;
+const uint8_t PROXY_PROTO_V2_PROXY = 0x1;
+const uint8_t PROXY_PROTO_V2_TCP4 = 0x11;
+const uint8_t PROXY_PROTO_V2_TCP6 = 0x21;
+
+/**
+ * @return bool true if the first len bytes of buf match the start of signature, or all of it.
+ */
+bool startsWith(const char* buf, size_t len, const char* signature, size_t signature_len) {
+  return memcmp(buf, signature, std::min(len, signature_len)) == 0;
+}
+
+/**
+ * Parse a V1 address and port without going through a string. Throws EnvoyException if either is
+ * malformed.
+ */
+Address::InstanceConstSharedPtr parseV1Address(Address::IpVersion version, const char* address,
+                                               const char* port) {
+  uint32_t port_value = 0;
+  size_t i = 0;
+  for (; port[i] != '\0'; i++) {
+    if (i == 5 || port[i] < '0' || port[i] > '9') {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    port_value = port_value * 10 + (port[i] - '0');
+  }
+  if (i == 0 || port_value > 65535) {
+    throw EnvoyException("failed to read proxy protocol");
+  }
+
+  if (version == Address::IpVersion::v4) {
+    sockaddr_in sa4;
+    memset(&sa4, 0, sizeof(sa4));
+    sa4.sin_family = AF_INET;
+    sa4.sin_port = htons(port_value);
+    if (inet_pton(AF_INET, address, &sa4.sin_addr) != 1) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    return std::make_shared<Address::Ipv4Instance>(&sa4);
+  }
+
+  sockaddr_in6 sa6;
+  memset(&sa6, 0, sizeof(sa6));
+  sa6.sin6_family = AF_INET6;
+  sa6.sin6_port = htons(port_value);
+  if (inet_pton(AF_INET6, address, &sa6.sin6_addr) != 1) {
+    throw EnvoyException("failed to read proxy protocol");
+  }
+  return std::make_shared<Address::Ipv6Instance>(sa6);
+}
+
+} // namespace
+
+const size_t ProxyProtocol::ActiveConnection::MAX_PROXY_PROTO_V1_LEN;
+const size_t ProxyProtocol::ActiveConnection::PROXY_PROTO_V2_HEADER_LEN;
+const size_t ProxyProtocol::ActiveConnection::MAX_PROXY_PROTO_LEN;
+
 ProxyProtocol::ProxyProtocol(Stats::Scope& scope)
     : stats_{ALL_PROXY_PROTOCOL_STATS(POOL_COUNTER(scope))} {}
 
@@ -31,7 +98,7 @@ void ProxyProtocol::newConnection(Event::Dispatcher& dispatcher, int fd, Listene
 ProxyProtocol::ActiveConnection::ActiveConnection(ProxyProtocol& parent,
                                                   Event::Dispatcher& dispatcher, int fd,
                                                   ListenerImpl& listener)
-    : parent_(parent), fd_(fd), listener_(listener), search_index_(1) {
+    : parent_(parent), fd_(fd), listener_(listener) {
   file_event_ =
       dispatcher.createFileEvent(fd,
                                  [this](uint32_t events) {
@@ -58,102 +125,202 @@ void ProxyProtocol::ActiveConnection::onRead() {
 }
 
 void ProxyProtocol::ActiveConnection::onReadWorker() {
-  std::string proxy_line;
-  if (!readLine(fd_, proxy_line)) {
+  if (discard_len_ == 0) {
+    // Peek at everything received so far, and only read the header once it can be parsed.
+    const ssize_t nread = recv(fd_, buf_, MAX_PROXY_PROTO_LEN, MSG_PEEK);
+    if (nread == -1 && errno == EAGAIN) {
+      return;
+    } else if (nread < 1) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+
+    const size_t header_len = parseHeader(nread);
+    if (header_len == 0) {
+      return;
+    }
+
+    // Read the header, or the part of it that was peeked at, but nothing past it. This should never
+    // fail, as we're asking only for bytes we have already seen.
+    const size_t read_len = std::min<size_t>(header_len, nread);
+    const ssize_t consumed = recv(fd_, buf_, read_len, 0);
+    ASSERT(size_t(consumed) == read_len);
+    UNREFERENCED_PARAMETER(consumed);
+    discard_len_ = header_len - read_len;
+  }
+
+  if (discard_len_ > 0 && !discard()) {
     return;
   }
 
-  // Remove the line feed at the end
-  StringUtil::rtrim(proxy_line);
+  done();
+}
 
-  // Parse proxy protocol line with format: PROXY TCP4/TCP6 SOURCE_ADDRESS DESTINATION_ADDRESS
-  // SOURCE_PORT DESTINATION_PORT.
-  const auto line_parts = StringUtil::split(proxy_line, " ", true);
+size_t ProxyProtocol::ActiveConnection::parseHeader(size_t len) {
+  size_t header_len;
+  if (startsWith(buf_, len, PROXY_PROTO_V2_SIGNATURE, PROXY_PROTO_V2_SIGNATURE_LEN)) {
+    header_len = parseV2(len);
+  } else if (startsWith(buf_, len, PROXY_PROTO_V1_SIGNATURE, PROXY_PROTO_V1_SIGNATURE_LEN)) {
+    header_len = parseV1(len);
+  } else {
+    throw EnvoyException("failed to read proxy protocol");
+  }
 
-  if (line_parts.size() != 6 || line_parts[0] != "PROXY") {
+  // Check that both addresses are valid unicast addresses, as required for TCP. Remote address
+  // refers to the source address.
+  if (remote_address_ &&
+      (!remote_address_->ip()->isUnicastAddress() || !local_address_->ip()->isUnicastAddress())) {
     throw EnvoyException("failed to read proxy protocol");
   }
+  return header_len;
+}
+
+size_t ProxyProtocol::ActiveConnection::parseV1(size_t len) {
+  // Continue searching buf_ for '\r\n' from where the last read event left off.
+  const size_t end = std::min(len, MAX_PROXY_PROTO_V1_LEN);
+  for (; search_index_ < end; search_index_++) {
+    if (buf_[search_index_] == '\n' && buf_[search_index_ - 1] == '\r') {
+      break;
+    }
+  }
+  if (search_index_ == end) {
+    if (end == MAX_PROXY_PROTO_V1_LEN) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    return 0;
+  }
 
-  Address::IpVersion protocol_version;
-  Address::InstanceConstSharedPtr remote_address;
-  Address::InstanceConstSharedPtr local_address;
-  if (line_parts[1] == "TCP4") {
-    protocol_version = Address::IpVersion::v4;
-    remote_address = Utility::parseInternetAddressAndPort(line_parts[2] + ":" + line_parts[4]);
-    local_address = Utility::parseInternetAddressAndPort(line_parts[3] + ":" + line_parts[5]);
-  } else if (line_parts[1] == "TCP6") {
-    protocol_version = Address::IpVersion::v6;
-    remote_address =
-        Utility::parseInternetAddressAndPort("[" + line_parts[2] + "]:" + line_parts[4]);
-    local_address =
-        Utility::parseInternetAddressAndPort("[" + line_parts[3] + "]:" + line_parts[5]);
+  // Split the line into NUL terminated fields in place, with format: PROXY TCP4/TCP6
+  // SOURCE_ADDRESS DESTINATION_ADDRESS SOURCE_PORT DESTINATION_PORT.
+  const char* fields[6];
+  size_t num_fields = 0;
+  size_t field_start = 0;
+  buf_[search_index_ - 1] = ' ';
+  for (size_t i = 0; i < search_index_; i++) {
+    if (buf_[i] != ' ') {
+      continue;
+    }
+    if (i == field_start || num_fields == 6) {
+      throw EnvoyException("failed to read proxy protocol");
+    }
+    buf_[i] = '\0';
+    fields[num_fields++] = buf_ + field_start;
+    field_start = i + 1;
+  }
+
+  // The signature check means there are at least two fields. With UNKNOWN, the connection's own
+  // addresses are used and the rest of the line is ignored.
+  ASSERT(num_fields >= 2);
+  if (strcmp(fields[1], "UNKNOWN") == 0) {
+    return search_index_ + 1;
+  }
+
+  Address::IpVersion version;
+  if (num_fields == 6 && strcmp(fields[1], "TCP4") == 0) {
+    version = Address::IpVersion::v4;
+  } else if (num_fields == 6 && strcmp(fields[1], "TCP6") == 0) {
+    version = Address::IpVersion::v6;
   } else {
     throw EnvoyException("failed to read proxy protocol");
   }
 
-  // Error check the source and destination fields.  Most errors are cought by the address
-  // parsing above, but a malformed IPv6 address may combine with a malformed port and parse as
-  // an IPv6 address when parsing for an IPv4 address.  Remote address refers to the source
-  // address.
-  const auto remote_version = remote_address->ip()->version();
-  const auto local_version = local_address->ip()->version();
-  if (remote_version != protocol_version || local_version != protocol_version) {
-    throw EnvoyException("failed to read proxy protocol");
+  remote_address_ = parseV1Address(version, fields[2], fields[4]);
+  local_address_ = parseV1Address(version, fields[3], fields[5]);
+  return search_index_ + 1;
+}
+
+size_t ProxyProtocol::ActiveConnection::parseV2(size_t len) {
+  if (len < PROXY_PROTO_V2_HEADER_LEN) {
+    return 0;
   }
-  // Check that both addresses are valid unicast addresses, as required for TCP
-  if (!remote_address->ip()->isUnicastAddress() || !local_address->ip()->isUnicastAddress()) {
+
+  // The signature is followed by the version and command, the address family and transport
+  // protocol, and the length of the rest of the header in network byte order.
+  const uint8_t* header = reinterpret_cast<const uint8_t*>(buf_);
+  const uint8_t version = header[12] >> 4;
+  const uint8_t command = header[12] & 0xf;
+  if (version != 2 || (command != PROXY_PROTO_V2_LOCAL && command != PROXY_PROTO_V2_PROXY)) {
     throw EnvoyException("failed to read proxy protocol");
   }
-  ListenerImpl& listener = listener_;
-  int fd = fd_;
-  fd_ = -1;
+  const size_t header_len = PROXY_PROTO_V2_HEADER_LEN + ((header[14] << 8) | header[15]);
 
-  removeFromList(parent_.connections_);
+  // LOCAL connections, such as health checks from the proxy itself, keep their own addresses, as
+  // do connections of families other than TCP over IPv4 and IPv6.
+  const uint8_t family = header[13];
+  if (command == PROXY_PROTO_V2_LOCAL ||
+      (family != PROXY_PROTO_V2_TCP4 && family != PROXY_PROTO_V2_TCP6)) {
+    return header_len;
+  }
 
-  listener.newConnection(fd, remote_address, local_address, true);
-}
+  // The addresses and then the ports, all in network byte order. Any TLVs after them are dropped.
+  const size_t address_len = family == PROXY_PROTO_V2_TCP4 ? 12 : 36;
+  if (header_len < PROXY_PROTO_V2_HEADER_LEN + address_len) {
+    throw EnvoyException("failed to read proxy protocol");
+  }
+  if (len < PROXY_PROTO_V2_HEADER_LEN + address_len) {
+    return 0;
+  }
 
-void ProxyProtocol::ActiveConnection::close() {
-  ::close(fd_);
-  fd_ = -1;
-  removeFromList(parent_.connections_);
+  const uint8_t* addresses = header + PROXY_PROTO_V2_HEADER_LEN;
+  if (family == PROXY_PROTO_V2_TCP4) {
+    sockaddr_in remote;
+    sockaddr_in local;
+    memset(&remote, 0, sizeof(remote));
+    memset(&local, 0, sizeof(local));
+    remote.sin_family = local.sin_family = AF_INET;
+    memcpy(&remote.sin_addr, addresses, 4);
+    memcpy(&local.sin_addr, addresses + 4, 4);
+    memcpy(&remote.sin_port, addresses + 8, 2);
+    memcpy(&local.sin_port, addresses + 10, 2);
+    remote_address_ = std::make_shared<Address::Ipv4Instance>(&remote);
+    local_address_ = std::make_shared<Address::Ipv4Instance>(&local);
+  } else {
+    sockaddr_in6 remote;
+    sockaddr_in6 local;
+    memset(&remote, 0, sizeof(remote));
+    memset(&local, 0, sizeof(local));
+    remote.sin6_family = local.sin6_family = AF_INET6;
+    memcpy(&remote.sin6_addr, addresses, 16);
+    memcpy(&local.sin6_addr, addresses + 16, 16);
+    memcpy(&remote.sin6_port, addresses + 32, 2);
+    memcpy(&local.sin6_port, addresses + 34, 2);
+    remote_address_ = std::make_shared<Address::Ipv6Instance>(remote);
+    local_address_ = std::make_shared<Address::Ipv6Instance>(local);
+  }
+  return header_len;
 }
 
-bool ProxyProtocol::ActiveConnection::readLine(int fd, std::string& s) {
-  while (buf_off_ < MAX_PROXY_PROTO_LEN) {
-    ssize_t nread = recv(fd, buf_ + buf_off_, MAX_PROXY_PROTO_LEN - buf_off_, MSG_PEEK);
-
+bool ProxyProtocol::ActiveConnection::discard() {
+  while (discard_len_ > 0) {
+    const ssize_t nread = recv(fd_, buf_, std::min(discard_len_, MAX_PROXY_PROTO_LEN), 0);
     if (nread == -1 && errno == EAGAIN) {
       return false;
     } else if (nread < 1) {
       throw EnvoyException("failed to read proxy protocol");
     }
+    discard_len_ -= nread;
+  }
+  return true;
+}
 
-    bool found = false;
-    // continue searching buf_ from where we left off
-    for (; search_index_ < buf_off_ + nread; search_index_++) {
-      if (buf_[search_index_] == '\n' && buf_[search_index_ - 1] == '\r') {
-        search_index_++;
-        found = true;
-        break;
-      }
-    }
-
-    // Read the data upto and including the line feed, if available, but not past it.
-    // This should never fail, as search_index_ - buf_off_ <= nread, so we're asking
-    // only for bytes we have already seen.
-    nread = recv(fd, buf_ + buf_off_, search_index_ - buf_off_, 0);
-    ASSERT(size_t(nread) == search_index_ - buf_off_);
+void ProxyProtocol::ActiveConnection::done() {
+  const bool proxied = remote_address_ != nullptr;
+  Address::InstanceConstSharedPtr remote_address =
+      proxied ? remote_address_ : Address::peerAddressFromFd(fd_);
+  Address::InstanceConstSharedPtr local_address =
+      proxied ? local_address_ : Address::addressFromFd(fd_);
+  ListenerImpl& listener = listener_;
+  int fd = fd_;
+  fd_ = -1;
 
-    buf_off_ += nread;
+  removeFromList(parent_.connections_);
 
-    if (found) {
-      s.assign(buf_, buf_off_);
-      return true;
-    }
-  }
+  listener.newConnection(fd, remote_address, local_address, proxied);
+}
 
-  throw EnvoyException("failed to read proxy protocol");
+void ProxyProtocol::ActiveConnection::close() {
+  ::close(fd_);
+  fd_ = -1;
+  removeFromList(parent_.connections_);
 }
 
 } // namespace Network
@@ -5,6 +5,7 @@
 #include <string>
 
 #include "envoy/event/dispatcher.h"
+#include "envoy/network/address.h"
 #include "envoy/stats/stats_macros.h"
 
 #include "common/common/linked_object.h"
@@ -30,8 +31,8 @@ struct ProxyProtocolStats {
 };
 
 /**
- * Implementation the PROXY Protocol V1
- * (http://www.haproxy.org/download/1.5/doc/proxy-protocol.txt)
+ * Implementation of the PROXY protocol V1 and V2
+ * (http://www.haproxy.org/download/1.8/doc/proxy-protocol.txt)
  */
 class ProxyProtocol {
 public:
@@ -42,17 +43,31 @@ public:
     ~ActiveConnection();
 
   private:
-    static const size_t MAX_PROXY_PROTO_LEN = 108;
+    static const size_t MAX_PROXY_PROTO_V1_LEN = 108;
+    static const size_t PROXY_PROTO_V2_HEADER_LEN = 16;
+    // The V2 header followed by the largest address block, for AF_UNIX. TLVs past it are read and
+    // dropped after the addresses are parsed.
+    static const size_t MAX_PROXY_PROTO_LEN = PROXY_PROTO_V2_HEADER_LEN + 216;
 
     void onRead();
     void onReadWorker();
 
     /**
-     * Helper function that attempts to read a line (delimited by '\r\n') from the socket.
-     * throws EnvoyException on any socket errors.
-     * @return bool true if a line should be read, false if more data is needed.
+     * Parse the header in the first len bytes of buf_, which is not copied. Sets remote_address_
+     * and local_address_, which are left empty if the connection's own addresses should be used.
+     * Throws EnvoyException on a malformed header.
+     * @return size_t the length of the header, or 0 if more data is needed.
      */
-    bool readLine(int fd, std::string& s);
+    size_t parseHeader(size_t len);
+    size_t parseV1(size_t len);
+    size_t parseV2(size_t len);
+
+    /**
+     * Read and drop the rest of a header that did not fit in buf_.
+     * @return bool true if all of it has been read.
+     */
+    bool discard();
+    void done();
     void close();
 
     ProxyProtocol& parent_;
@@ -60,13 +75,16 @@ public:
     ListenerImpl& listener_;
     Event::FileEventPtr file_event_;
 
-    // The offset in buf_ that has been fully read
-    size_t buf_off_{};
+    // The index in buf_ where the search for the V1 '\r\n' should continue from.
+    size_t search_index_{1};
+
+    // The bytes of the header left to read after it has been parsed.
+    size_t discard_len_{};
 
-    // The index in buf_ where the search for '\r\n' should continue from
-    size_t search_index_;
+    Address::InstanceConstSharedPtr remote_address_;
+    Address::InstanceConstSharedPtr local_address_;
 
-    // Stores the portion of the first line that has been read so far.
+    // The start of the stream, peeked at on each read event until it holds a whole header.
     char buf_[MAX_PROXY_PROTO_LEN];
   };
 
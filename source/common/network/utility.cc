@@ -8,6 +8,7 @@
 #endif
 
 #include <netinet/ip.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 
 #include <cstdint>
@@ -320,6 +321,53 @@ Address::InstanceConstSharedPtr Utility::getOriginalDst(int fd) {
 #endif
 }
 
+void Utility::setListenSocketOptions(int fd, uint32_t tcp_fast_open_queue_length,
+                                     uint32_t defer_accept_seconds) {
+#ifdef __linux__
+  if (tcp_fast_open_queue_length > 0) {
+    const int queue_length = tcp_fast_open_queue_length;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &queue_length, sizeof(queue_length)) == -1) {
+      throw EnvoyException(fmt::format("cannot set TCP_FASTOPEN: {}", strerror(errno)));
+    }
+  }
+  if (defer_accept_seconds > 0) {
+    const int seconds = defer_accept_seconds;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, sizeof(seconds)) == -1) {
+      throw EnvoyException(fmt::format("cannot set TCP_DEFER_ACCEPT: {}", strerror(errno)));
+    }
+  }
+#else
+  UNREFERENCED_PARAMETER(fd);
+  if (tcp_fast_open_queue_length > 0 || defer_accept_seconds > 0) {
+    throw EnvoyException("TCP Fast Open and deferred accept are only supported on Linux");
+  }
+#endif
+}
+
+bool Utility::enableTcpFastOpenConnect(int fd) {
+#ifdef __linux__
+  const int on = 1;
+  return setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on)) == 0;
+#else
+  UNREFERENCED_PARAMETER(fd);
+  return false;
+#endif
+}
+
+bool Utility::tcpFastOpenAccepted(int fd) {
+#ifdef __linux__
+  tcp_info info;
+  socklen_t info_len = sizeof(info);
+  if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &info_len) == -1) {
+    return false;
+  }
+  return (info.tcpi_options & TCPI_OPT_SYN_DATA) != 0;
+#else
+  UNREFERENCED_PARAMETER(fd);
+  return false;
+#endif
+}
+
 void Utility::parsePortRangeList(const std::string& string, std::list<PortRange>& list) {
   std::vector<std::string> ranges = StringUtil::split(string.c_str(), ',');
   for (const std::string& s : ranges) {
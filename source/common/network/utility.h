@@ -20,6 +20,8 @@ public:
   PortRange(uint32_t min, uint32_t max) : min_(min), max_(max) {}
 
   bool contains(uint32_t port) const { return (port >= min_ && port <= max_); }
+  uint32_t min() const { return min_; }
+  uint32_t max() const { return max_; }
 
 private:
   const uint32_t min_;
@@ -166,6 +168,33 @@ public:
    */
   static Address::InstanceConstSharedPtr getOriginalDst(int fd);
 
+  /**
+   * Set the TCP options of a listen socket. Throws an EnvoyException if an option is set but is
+   * not supported.
+   * @param fd supplies the listen socket.
+   * @param tcp_fast_open_queue_length supplies the maximum number of pending TCP Fast Open
+   *        connections, or 0 to leave TCP Fast Open disabled.
+   * @param defer_accept_seconds supplies how long the kernel holds a connection back from accept
+   *        until it has sent data, or 0 to accept connections as soon as they are established.
+   */
+  static void setListenSocketOptions(int fd, uint32_t tcp_fast_open_queue_length,
+                                     uint32_t defer_accept_seconds);
+
+  /**
+   * Make connect() on a socket return right away, and send the first data written to it with the
+   * SYN using TCP Fast Open.
+   * @param fd supplies the socket, which must not be connected yet.
+   * @return bool whether TCP Fast Open is enabled. It is not if the platform does not support it.
+   */
+  static bool enableTcpFastOpenConnect(int fd);
+
+  /**
+   * @param fd supplies a connected socket.
+   * @return bool whether the data the SYN of the connection carried was accepted, i.e. whether the
+   *         connection saved a round trip with TCP Fast Open.
+   */
+  static bool tcpFastOpenAccepted(int fd);
+
   /**
    * Parses a string containing a comma-separated list of port numbers and/or
    * port ranges and appends the values to a caller-provided list of PortRange structures.
@@ -28,11 +28,32 @@ public:
 };
 
 /**
- * Process wide heap profiling
+ * Process wide heap profiling.
  */
 class Heap {
-private:
-  static void forceLink();
+public:
+  /**
+   * @return whether the profiler is running or not.
+   */
+  static bool profilerEnabled();
+
+  /**
+   * Start the profiler. Profiles are dumped to files named after the specified prefix as the heap
+   * grows and when the profiler is stopped.
+   * @return bool whether the call to start the profiler succeeded.
+   */
+  static bool startProfiler(const std::string& output_prefix);
+
+  /**
+   * Stop the profiler.
+   */
+  static void stopProfiler();
+
+  /**
+   * @return std::string the live allocations in the pprof heap profile format, or an empty string
+   *         if the profiler is not running.
+   */
+  static std::string currentProfile();
 };
 
 } // namespace Profiler
@@ -0,0 +1,211 @@
+#include "common/ratelimit/local_ratelimit_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/json/config_schemas.h"
+
+#include "spdlog/spdlog.h"
+
+namespace Envoy {
+namespace RateLimit {
+
+TokenBucket::TokenBucket(uint32_t max_tokens, uint32_t tokens_per_fill,
+                         std::chrono::milliseconds fill_interval,
+                         MonotonicTimeSource& time_source)
+    : max_tokens_(max_tokens), tokens_per_fill_(tokens_per_fill), fill_interval_(fill_interval),
+      time_source_(time_source), start_(time_source.currentTime()), state_(max_tokens) {}
+
+bool TokenBucket::consume(uint32_t& remaining) {
+  const uint32_t fill = (time_source_.currentTime() - start_) / fill_interval_;
+  uint64_t state = state_.load();
+  while (true) {
+    const uint32_t last_fill = state >> 32;
+    uint64_t tokens = state & 0xffffffff;
+    // Another thread may have refilled for a later interval than this thread read the time for.
+    const int32_t fills = static_cast<int32_t>(fill - last_fill);
+    const uint32_t new_fill = fills > 0 ? fill : last_fill;
+    if (fills > 0) {
+      tokens = std::min<uint64_t>(max_tokens_, tokens + static_cast<uint64_t>(fills) *
+                                                            tokens_per_fill_);
+    }
+
+    if (tokens == 0) {
+      remaining = 0;
+      return false;
+    }
+
+    const uint64_t new_state = (static_cast<uint64_t>(new_fill) << 32) | (tokens - 1);
+    if (state_.compare_exchange_weak(state, new_state)) {
+      remaining = tokens - 1;
+      return true;
+    }
+  }
+}
+
+LocalRateLimiter::LocalRateLimiter(const Json::Object& config, const std::string& stat_prefix,
+                                   Stats::Scope& scope, ThreadLocal::SlotAllocator& tls,
+                                   MonotonicTimeSource& time_source)
+    : Json::Validator(config, Json::Schema::LOCAL_RATE_LIMIT_SCHEMA),
+      mode_(stringToMode(config.getString("mode", "prefilter"))),
+      stats_(generateStats(stat_prefix, scope)) {
+  const double near_limit_ratio = config.getDouble("near_limit_ratio", 0.1);
+  for (const Json::ObjectSharedPtr& bucket : config.getObjectArray("buckets")) {
+    BucketConfig bucket_config;
+    for (const Json::ObjectSharedPtr& entry : bucket->getObjectArray("descriptor")) {
+      bucket_config.descriptor_.entries_.push_back(
+          {entry->getString("key"), entry->getString("value")});
+    }
+    bucket_config.max_tokens_ = bucket->getInteger("max_tokens");
+    bucket_config.tokens_per_fill_ = bucket->getInteger("tokens_per_fill", 1);
+    bucket_config.fill_interval_ =
+        std::chrono::milliseconds(bucket->getInteger("fill_interval_ms"));
+    bucket_config.near_limit_tokens_ = bucket_config.max_tokens_ * near_limit_ratio;
+    bucket_configs_.push_back(bucket_config);
+  }
+
+  if (config.getBoolean("shared", false)) {
+    shared_buckets_ = createBuckets(bucket_configs_, time_source);
+    return;
+  }
+
+  tls_ = tls.allocateSlot();
+  std::vector<BucketConfig> bucket_configs = bucket_configs_;
+  MonotonicTimeSource* time_source_ptr = &time_source;
+  tls_->set([bucket_configs, time_source_ptr](
+                Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    std::shared_ptr<ThreadLocalBuckets> buckets(new ThreadLocalBuckets());
+    buckets->buckets_ = createBuckets(bucket_configs, *time_source_ptr);
+    return buckets;
+  });
+}
+
+LocalRateLimiter::Mode LocalRateLimiter::stringToMode(const std::string& mode) {
+  if (mode == "local") {
+    return Mode::Local;
+  } else if (mode == "report") {
+    return Mode::Report;
+  } else {
+    ASSERT(mode == "prefilter");
+    return Mode::Prefilter;
+  }
+}
+
+LocalRateLimitStats LocalRateLimiter::generateStats(const std::string& prefix,
+                                                    Stats::Scope& scope) {
+  std::string final_prefix = prefix + "local.";
+  return {ALL_LOCAL_RATE_LIMIT_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
+}
+
+std::vector<TokenBucketPtr>
+LocalRateLimiter::createBuckets(const std::vector<BucketConfig>& configs,
+                                MonotonicTimeSource& time_source) {
+  std::vector<TokenBucketPtr> buckets;
+  for (const BucketConfig& config : configs) {
+    buckets.emplace_back(new TokenBucket(config.max_tokens_, config.tokens_per_fill_,
+                                         config.fill_interval_, time_source));
+  }
+  return buckets;
+}
+
+bool LocalRateLimiter::matches(const Descriptor& descriptor, const Descriptor& bucket_descriptor) {
+  return descriptor.entries_.size() == bucket_descriptor.entries_.size() &&
+         std::equal(descriptor.entries_.begin(), descriptor.entries_.end(),
+                    bucket_descriptor.entries_.begin(),
+                    [](const DescriptorEntry& a, const DescriptorEntry& b) -> bool {
+                      return a.key_ == b.key_ && a.value_ == b.value_;
+                    });
+}
+
+LocalLimitStatus LocalRateLimiter::check(const std::vector<Descriptor>& descriptors) {
+  std::vector<TokenBucketPtr>& buckets =
+      tls_ ? tls_->getTyped<ThreadLocalBuckets>().buckets_ : shared_buckets_;
+
+  LocalLimitStatus status = LocalLimitStatus::OK;
+  for (const Descriptor& descriptor : descriptors) {
+    uint32_t index = 0;
+    while (index < bucket_configs_.size() &&
+           !matches(descriptor, bucket_configs_[index].descriptor_)) {
+      index++;
+    }
+    if (index == bucket_configs_.size()) {
+      status = LocalLimitStatus::Uncertain;
+      continue;
+    }
+
+    uint32_t remaining;
+    if (!buckets[index]->consume(remaining)) {
+      return LocalLimitStatus::OverLimit;
+    }
+    if (remaining < bucket_configs_[index].near_limit_tokens_) {
+      status = LocalLimitStatus::Uncertain;
+    }
+  }
+  return status;
+}
+
+LocalClientImpl::LocalClientImpl(LocalRateLimiterSharedPtr limiter, ClientPtr&& global_client)
+    : limiter_(limiter), global_client_(std::move(global_client)) {}
+
+LocalClientImpl::~LocalClientImpl() {
+  ASSERT(!callbacks_);
+  if (reporting_) {
+    global_client_->cancel();
+  }
+}
+
+void LocalClientImpl::cancel() {
+  ASSERT(callbacks_ != nullptr);
+  global_client_->cancel();
+  callbacks_ = nullptr;
+}
+
+void LocalClientImpl::limit(RequestCallbacks& callbacks, const std::string& domain,
+                            const std::vector<Descriptor>& descriptors,
+                            const Tracing::TransportContext& context) {
+  ASSERT(callbacks_ == nullptr);
+  const LocalLimitStatus local_status = limiter_->check(descriptors);
+  const LocalRateLimiter::Mode mode = limiter_->mode();
+  if (mode == LocalRateLimiter::Mode::Prefilter && local_status == LocalLimitStatus::Uncertain) {
+    limiter_->stats().global_call_.inc();
+    callbacks_ = &callbacks;
+    global_client_->limit(*this, domain, descriptors, context);
+    return;
+  }
+
+  // The global client handles one request at a time, so a report is skipped while the last one is
+  // outstanding.
+  if (mode == LocalRateLimiter::Mode::Report && !reporting_) {
+    limiter_->stats().report_.inc();
+    reporting_ = true;
+    global_client_->limit(*this, domain, descriptors, context);
+  }
+
+  if (local_status == LocalLimitStatus::OverLimit) {
+    limiter_->stats().over_limit_.inc();
+    callbacks.complete(LimitStatus::OverLimit);
+  } else {
+    limiter_->stats().ok_.inc();
+    callbacks.complete(LimitStatus::OK);
+  }
+}
+
+void LocalClientImpl::complete(LimitStatus status) {
+  if (reporting_) {
+    // The local buckets already decided the request.
+    reporting_ = false;
+    return;
+  }
+
+  ASSERT(callbacks_ != nullptr);
+  RequestCallbacks* callbacks = callbacks_;
+  callbacks_ = nullptr;
+  callbacks->complete(status);
+}
+
+} // namespace RateLimit
+} // namespace Envoy
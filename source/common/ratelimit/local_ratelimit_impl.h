@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/json/json_object.h"
+#include "envoy/ratelimit/ratelimit.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/json/json_validator.h"
+
+namespace Envoy {
+namespace RateLimit {
+
+/**
+ * All local rate limit stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_LOCAL_RATE_LIMIT_STATS(COUNTER)                                                        \
+  COUNTER(ok)                                                                                      \
+  COUNTER(over_limit)                                                                              \
+  COUNTER(global_call)                                                                             \
+  COUNTER(report)
+// clang-format on
+
+/**
+ * Struct definition for all local rate limit stats. @see stats_macros.h
+ */
+struct LocalRateLimitStats {
+  ALL_LOCAL_RATE_LIMIT_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Token bucket holding at most max_tokens tokens, and refilled with tokens_per_fill tokens at the
+ * start of every fill interval. The refill is done lazily by consume(). The tokens and the last
+ * fill share one atomic word, so a bucket may be used from several threads without locking.
+ */
+class TokenBucket {
+public:
+  TokenBucket(uint32_t max_tokens, uint32_t tokens_per_fill,
+              std::chrono::milliseconds fill_interval, MonotonicTimeSource& time_source);
+
+  /**
+   * Take a token if there is one.
+   * @param remaining receives the number of tokens left.
+   * @return bool true if a token was taken.
+   */
+  bool consume(uint32_t& remaining);
+
+private:
+  const uint32_t max_tokens_;
+  const uint32_t tokens_per_fill_;
+  const std::chrono::milliseconds fill_interval_;
+  MonotonicTimeSource& time_source_;
+  const MonotonicTime start_;
+  // The number of fill intervals since start_ at the last refill in the high 32 bits, and the
+  // tokens in the low 32 bits.
+  std::atomic<uint64_t> state_;
+};
+
+typedef std::unique_ptr<TokenBucket> TokenBucketPtr;
+
+/**
+ * Result of checking descriptors against the local buckets.
+ */
+enum class LocalLimitStatus {
+  // Every descriptor has a bucket, and none of them is near its limit.
+  OK,
+  // Some descriptor has no bucket, or its bucket is near its limit.
+  Uncertain,
+  // Some descriptor's bucket is empty.
+  OverLimit
+};
+
+/**
+ * Local rate limit configuration of a rate limit filter, with its token buckets. The buckets are
+ * either per worker, in which case each worker allows the configured rate, or shared by all the
+ * workers.
+ */
+class LocalRateLimiter : Json::Validator {
+public:
+  enum class Mode {
+    // Only the local buckets decide. The rate limit service is never called.
+    Local,
+    // Requests over a local limit are rejected without calling the rate limit service, which
+    // decides the rest unless all their buckets are well within their limits.
+    Prefilter,
+    // The local buckets decide, and each request is reported to the rate limit service without
+    // waiting for its answer.
+    Report
+  };
+
+  LocalRateLimiter(const Json::Object& config, const std::string& stat_prefix,
+                   Stats::Scope& scope, ThreadLocal::SlotAllocator& tls,
+                   MonotonicTimeSource& time_source);
+
+  /**
+   * Take a token for each descriptor from its bucket, if it has one.
+   * @param descriptors supplies the descriptors of a request.
+   * @return LocalLimitStatus the local verdict.
+   */
+  LocalLimitStatus check(const std::vector<Descriptor>& descriptors);
+
+  Mode mode() const { return mode_; }
+  LocalRateLimitStats& stats() { return stats_; }
+
+private:
+  struct BucketConfig {
+    Descriptor descriptor_;
+    uint32_t max_tokens_;
+    uint32_t tokens_per_fill_;
+    std::chrono::milliseconds fill_interval_;
+    // Buckets with fewer tokens left are near their limit.
+    uint32_t near_limit_tokens_;
+  };
+
+  struct ThreadLocalBuckets : public ThreadLocal::ThreadLocalObject {
+    std::vector<TokenBucketPtr> buckets_;
+  };
+
+  static Mode stringToMode(const std::string& mode);
+  static bool matches(const Descriptor& descriptor, const Descriptor& bucket_descriptor);
+  static LocalRateLimitStats generateStats(const std::string& prefix, Stats::Scope& scope);
+  static std::vector<TokenBucketPtr> createBuckets(const std::vector<BucketConfig>& configs,
+                                                   MonotonicTimeSource& time_source);
+
+  const Mode mode_;
+  LocalRateLimitStats stats_;
+  std::vector<BucketConfig> bucket_configs_;
+  // Set if the buckets are shared by the workers. Otherwise each worker has its own in tls_.
+  std::vector<TokenBucketPtr> shared_buckets_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+typedef std::shared_ptr<LocalRateLimiter> LocalRateLimiterSharedPtr;
+
+/**
+ * Rate limit client that checks the local buckets of a LocalRateLimiter first, and calls the rate
+ * limit service through another client as its mode requires.
+ */
+class LocalClientImpl : public Client, public RequestCallbacks {
+public:
+  LocalClientImpl(LocalRateLimiterSharedPtr limiter, ClientPtr&& global_client);
+  ~LocalClientImpl();
+
+  // RateLimit::Client
+  void cancel() override;
+  void limit(RequestCallbacks& callbacks, const std::string& domain,
+             const std::vector<Descriptor>& descriptors,
+             const Tracing::TransportContext& context) override;
+
+  // RateLimit::RequestCallbacks
+  void complete(LimitStatus status) override;
+
+private:
+  LocalRateLimiterSharedPtr limiter_;
+  ClientPtr global_client_;
+  // Set while a call to the rate limit service decides a request.
+  RequestCallbacks* callbacks_{};
+  // Set while a report is outstanding.
+  bool reporting_{};
+};
+
+} // namespace RateLimit
+} // namespace Envoy
@@ -9,6 +9,7 @@
 
 #include "common/common/assert.h"
 #include "common/common/empty_string.h"
+#include "common/common/logger.h"
 #include "common/grpc/async_client_impl.h"
 #include "common/http/headers.h"
 
@@ -45,6 +46,15 @@ void GrpcClientImpl::createRequest(pb::lyft::ratelimit::RateLimitRequest& reques
   }
 }
 
+LimitStatus
+GrpcClientImpl::responseStatus(const pb::lyft::ratelimit::RateLimitResponse& response) {
+  ASSERT(response.overall_code() != pb::lyft::ratelimit::RateLimitResponse_Code_UNKNOWN);
+  if (response.overall_code() == pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT) {
+    return LimitStatus::OverLimit;
+  }
+  return LimitStatus::OK;
+}
+
 void GrpcClientImpl::limit(RequestCallbacks& callbacks, const std::string& domain,
                            const std::vector<Descriptor>& descriptors,
                            const Tracing::TransportContext& context) {
@@ -68,13 +78,9 @@ void GrpcClientImpl::onCreateInitialMetadata(Http::HeaderMap& metadata) {
   }
 }
 
-void GrpcClientImpl::onSuccess(std::unique_ptr<pb::lyft::ratelimit::RateLimitResponse>&& response) {
-  LimitStatus status = LimitStatus::OK;
-  ASSERT(response->overall_code() != pb::lyft::ratelimit::RateLimitResponse_Code_UNKNOWN);
-  if (response->overall_code() == pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT) {
-    status = LimitStatus::OverLimit;
-  }
-  callbacks_->complete(status);
+void GrpcClientImpl::onSuccess(
+    Grpc::ResponsePtr<pb::lyft::ratelimit::RateLimitResponse>&& response) {
+  callbacks_->complete(responseStatus(*response));
   callbacks_ = nullptr;
 }
 
@@ -85,15 +91,166 @@ void GrpcClientImpl::onFailure(Grpc::Status::GrpcStatus status, const std::strin
   callbacks_ = nullptr;
 }
 
+GrpcBatcher::GrpcBatcher(BatchRateLimitAsyncClientPtr&& async_client,
+                         Event::Dispatcher& dispatcher, Runtime::Loader& runtime)
+    : service_method_(*Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+          "pb.lyft.ratelimit.RateLimitService.ShouldRateLimitBatch")),
+      async_client_(std::move(async_client)), dispatcher_(dispatcher), runtime_(runtime),
+      flush_timer_(dispatcher.createTimer([this]() -> void { flush(); })) {}
+
+GrpcBatcher::~GrpcBatcher() {
+  if (stream_ != nullptr) {
+    stream_->resetStream();
+  }
+}
+
+uint64_t GrpcBatcher::limit(RequestCallbacks& callbacks, const std::string& domain,
+                            const std::vector<Descriptor>& descriptors) {
+  const uint64_t id = next_id_++;
+  checks_.emplace(id, Check{&callbacks, false});
+  pb::lyft::ratelimit::BatchRateLimitRequest::Item* item = batch_.add_items();
+  item->set_id(id);
+  GrpcClientImpl::createRequest(*item->mutable_request(), domain, descriptors);
+
+  if (static_cast<uint64_t>(batch_.items_size()) >=
+      runtime_.snapshot().getInteger("ratelimit.batch_max_requests", 100)) {
+    flush();
+  } else if (batch_.items_size() == 1) {
+    flush_timer_->enableTimer(
+        std::chrono::milliseconds(runtime_.snapshot().getInteger("ratelimit.batch_window_ms", 0)));
+  }
+  return id;
+}
+
+void GrpcBatcher::flush() {
+  flush_timer_->disableTimer();
+  if (batch_.items_size() == 0) {
+    return;
+  }
+
+  // Checks added while this batch goes out, e.g. by callbacks completed because the stream failed
+  // to start, make up the next batch. Cancelled checks are sent all the same.
+  pb::lyft::ratelimit::BatchRateLimitRequest batch;
+  batch.Swap(&batch_);
+  for (const pb::lyft::ratelimit::BatchRateLimitRequest::Item& item : batch.items()) {
+    auto check = checks_.find(item.id());
+    if (check != checks_.end()) {
+      check->second.sent_ = true;
+    }
+  }
+
+  if (stream_ == nullptr) {
+    // A stream that fails to start closes before start() returns, which fails the checks.
+    stream_ = async_client_->start(service_method_, *this);
+    if (stream_ == nullptr) {
+      return;
+    }
+  }
+  stream_->sendMessage(batch, false);
+}
+
+void GrpcBatcher::onReceiveMessage(
+    Grpc::ResponsePtr<pb::lyft::ratelimit::BatchRateLimitResponse>&& message) {
+  for (const pb::lyft::ratelimit::BatchRateLimitResponse::Item& item : message->items()) {
+    // Answers to cancelled checks are ignored.
+    auto check = checks_.find(item.id());
+    if (check == checks_.end()) {
+      continue;
+    }
+    RequestCallbacks& callbacks = *check->second.callbacks_;
+    checks_.erase(check);
+    callbacks.complete(GrpcClientImpl::responseStatus(item.response()));
+  }
+}
+
+void GrpcBatcher::onRemoteClose(Grpc::Status::GrpcStatus status, const std::string& message) {
+  ENVOY_LOG_MISC(debug, "rate limit batch stream closed: {}, {}", status, message);
+  stream_ = nullptr;
+
+  // The callbacks may add and cancel checks, so the failed checks are taken out first.
+  std::vector<RequestCallbacks*> failed;
+  for (auto check = checks_.begin(); check != checks_.end();) {
+    if (check->second.sent_) {
+      failed.push_back(check->second.callbacks_);
+      check = checks_.erase(check);
+    } else {
+      ++check;
+    }
+  }
+  for (RequestCallbacks* callbacks : failed) {
+    callbacks->complete(LimitStatus::Error);
+  }
+}
+
+BatchedClientImpl::BatchedClientImpl(GrpcBatcher& batcher,
+                                     const Optional<std::chrono::milliseconds>& timeout)
+    : batcher_(batcher), timeout_(timeout) {}
+
+BatchedClientImpl::~BatchedClientImpl() { ASSERT(!callbacks_); }
+
+void BatchedClientImpl::cancel() {
+  ASSERT(callbacks_ != nullptr);
+  batcher_.cancel(id_);
+  if (timeout_timer_) {
+    timeout_timer_->disableTimer();
+  }
+  callbacks_ = nullptr;
+}
+
+void BatchedClientImpl::limit(RequestCallbacks& callbacks, const std::string& domain,
+                              const std::vector<Descriptor>& descriptors,
+                              const Tracing::TransportContext&) {
+  ASSERT(callbacks_ == nullptr);
+  callbacks_ = &callbacks;
+  if (timeout_.valid()) {
+    if (!timeout_timer_) {
+      timeout_timer_ = batcher_.dispatcher().createTimer([this]() -> void {
+        batcher_.cancel(id_);
+        complete(LimitStatus::Error);
+      });
+    }
+    timeout_timer_->enableTimer(timeout_.value());
+  }
+
+  id_ = batcher_.limit(*this, domain, descriptors);
+}
+
+void BatchedClientImpl::complete(LimitStatus status) {
+  if (timeout_timer_) {
+    timeout_timer_->disableTimer();
+  }
+  RequestCallbacks* callbacks = callbacks_;
+  callbacks_ = nullptr;
+  callbacks->complete(status);
+}
+
 GrpcFactoryImpl::GrpcFactoryImpl(const envoy::api::v2::RateLimitServiceConfig& config,
-                                 Upstream::ClusterManager& cm)
-    : cluster_name_(config.cluster_name()), cm_(cm) {
+                                 Upstream::ClusterManager& cm, ThreadLocal::SlotAllocator& tls,
+                                 Runtime::Loader& runtime)
+    : cluster_name_(config.cluster_name()), cm_(cm), runtime_(runtime), tls_(tls.allocateSlot()) {
   if (!cm_.get(cluster_name_)) {
     throw EnvoyException(fmt::format("unknown rate limit service cluster '{}'", cluster_name_));
   }
+
+  Upstream::ClusterManager* cm_ptr = &cm_;
+  Runtime::Loader* runtime_ptr = &runtime_;
+  const std::string cluster_name = cluster_name_;
+  tls_->set([cm_ptr, runtime_ptr, cluster_name](
+                Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<GrpcBatcher>(
+        BatchRateLimitAsyncClientPtr{
+            new Grpc::AsyncClientImpl<pb::lyft::ratelimit::BatchRateLimitRequest,
+                                      pb::lyft::ratelimit::BatchRateLimitResponse>(*cm_ptr,
+                                                                                   cluster_name)},
+        dispatcher, *runtime_ptr);
+  });
 }
 
 ClientPtr GrpcFactoryImpl::create(const Optional<std::chrono::milliseconds>& timeout) {
+  if (runtime_.snapshot().getInteger("ratelimit.batch_window_ms", 0) > 0) {
+    return ClientPtr{new BatchedClientImpl(tls_->getTyped<GrpcBatcher>(), timeout)};
+  }
+
   return ClientPtr{new GrpcClientImpl(
       RateLimitAsyncClientPtr{
           new Grpc::AsyncClientImpl<pb::lyft::ratelimit::RateLimitRequest,
@@ -3,10 +3,15 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
 #include "envoy/grpc/async_client.h"
 #include "envoy/ratelimit/ratelimit.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/thread_local/thread_local.h"
 #include "envoy/tracing/context.h"
 #include "envoy/upstream/cluster_manager.h"
 
@@ -24,6 +29,11 @@ typedef std::unique_ptr<RateLimitAsyncClient> RateLimitAsyncClientPtr;
 
 typedef Grpc::AsyncRequestCallbacks<pb::lyft::ratelimit::RateLimitResponse> RateLimitAsyncCallbacks;
 
+typedef Grpc::AsyncClient<pb::lyft::ratelimit::BatchRateLimitRequest,
+                          pb::lyft::ratelimit::BatchRateLimitResponse>
+    BatchRateLimitAsyncClient;
+typedef std::unique_ptr<BatchRateLimitAsyncClient> BatchRateLimitAsyncClientPtr;
+
 // TODO(htuch): We should have only one client per thread, but today we create one per filter stack.
 // This will require support for more than one outstanding request per client (limit() assumes only
 // one today).
@@ -36,6 +46,11 @@ public:
   static void createRequest(pb::lyft::ratelimit::RateLimitRequest& request,
                             const std::string& domain, const std::vector<Descriptor>& descriptors);
 
+  /**
+   * @return LimitStatus the status a response from the rate limit service stands for.
+   */
+  static LimitStatus responseStatus(const pb::lyft::ratelimit::RateLimitResponse& response);
+
   // RateLimit::Client
   void cancel() override;
   void limit(RequestCallbacks& callbacks, const std::string& domain,
@@ -44,7 +59,7 @@ public:
 
   // Grpc::AsyncRequestCallbacks
   void onCreateInitialMetadata(Http::HeaderMap& metadata) override;
-  void onSuccess(std::unique_ptr<pb::lyft::ratelimit::RateLimitResponse>&& response) override;
+  void onSuccess(Grpc::ResponsePtr<pb::lyft::ratelimit::RateLimitResponse>&& response) override;
   void onFailure(Grpc::Status::GrpcStatus status, const std::string& message) override;
 
 private:
@@ -56,10 +71,103 @@ private:
   Tracing::TransportContext context_;
 };
 
+/**
+ * Sends the limit checks of the clients of one worker to the rate limit service in batches, as
+ * messages on a stream that lasts across batches. A batch is sent once it has
+ * ratelimit.batch_max_requests checks, or ratelimit.batch_window_ms after its first check. The
+ * answers are routed back to the clients by the IDs of their checks. When the stream closes, the
+ * checks sent on it that have no answer fail, and the next batch starts a new stream.
+ */
+class GrpcBatcher
+    : public ThreadLocal::ThreadLocalObject,
+      public Grpc::AsyncStreamCallbacks<pb::lyft::ratelimit::BatchRateLimitResponse> {
+public:
+  GrpcBatcher(BatchRateLimitAsyncClientPtr&& async_client, Event::Dispatcher& dispatcher,
+              Runtime::Loader& runtime);
+  ~GrpcBatcher();
+
+  /**
+   * Add a check to the current batch.
+   * NOTE: The callbacks may be completed before this returns.
+   * @param callbacks supplies the callbacks to complete with the answer.
+   * @param domain specifies the rate limit domain.
+   * @param descriptors specifies a list of descriptors to query.
+   * @return uint64_t the ID of the check.
+   */
+  uint64_t limit(RequestCallbacks& callbacks, const std::string& domain,
+                 const std::vector<Descriptor>& descriptors);
+
+  /**
+   * Forget a check. Its callbacks are not completed.
+   * @param id supplies the ID of the check.
+   */
+  void cancel(uint64_t id) { checks_.erase(id); }
+
+  Event::Dispatcher& dispatcher() { return dispatcher_; }
+
+  // Grpc::AsyncStreamCallbacks
+  void onCreateInitialMetadata(Http::HeaderMap&) override {}
+  void onReceiveInitialMetadata(Http::HeaderMapPtr&&) override {}
+  void onReceiveMessage(
+      Grpc::ResponsePtr<pb::lyft::ratelimit::BatchRateLimitResponse>&& message) override;
+  void onReceiveTrailingMetadata(Http::HeaderMapPtr&&) override {}
+  void onRemoteClose(Grpc::Status::GrpcStatus status, const std::string& message) override;
+
+private:
+  struct Check {
+    RequestCallbacks* callbacks_;
+    // Whether the check was sent on the current stream.
+    bool sent_;
+  };
+
+  void flush();
+
+  const Protobuf::MethodDescriptor& service_method_;
+  BatchRateLimitAsyncClientPtr async_client_;
+  Grpc::AsyncStream<pb::lyft::ratelimit::BatchRateLimitRequest>* stream_{};
+  Event::Dispatcher& dispatcher_;
+  Runtime::Loader& runtime_;
+  Event::TimerPtr flush_timer_;
+  pb::lyft::ratelimit::BatchRateLimitRequest batch_;
+  std::unordered_map<uint64_t, Check> checks_;
+  uint64_t next_id_{};
+};
+
+/**
+ * Rate limit client whose checks go out in the batches of its worker's GrpcBatcher. The transport
+ * context of a check is not sent, since a batch has checks of many requests.
+ */
+class BatchedClientImpl : public Client, public RequestCallbacks {
+public:
+  BatchedClientImpl(GrpcBatcher& batcher, const Optional<std::chrono::milliseconds>& timeout);
+  ~BatchedClientImpl();
+
+  // RateLimit::Client
+  void cancel() override;
+  void limit(RequestCallbacks& callbacks, const std::string& domain,
+             const std::vector<Descriptor>& descriptors,
+             const Tracing::TransportContext& context) override;
+
+  // RateLimit::RequestCallbacks
+  void complete(LimitStatus status) override;
+
+private:
+  GrpcBatcher& batcher_;
+  const Optional<std::chrono::milliseconds> timeout_;
+  Event::TimerPtr timeout_timer_;
+  RequestCallbacks* callbacks_{};
+  uint64_t id_{};
+};
+
+/**
+ * Creates the clients of the gRPC rate limit service. While ratelimit.batch_window_ms is set, the
+ * clients batch their checks with GrpcBatcher. Otherwise each check is a call of its own.
+ */
 class GrpcFactoryImpl : public ClientFactory {
 public:
   GrpcFactoryImpl(const envoy::api::v2::RateLimitServiceConfig& config,
-                  Upstream::ClusterManager& cm);
+                  Upstream::ClusterManager& cm, ThreadLocal::SlotAllocator& tls,
+                  Runtime::Loader& runtime);
 
   // RateLimit::ClientFactory
   ClientPtr create(const Optional<std::chrono::milliseconds>& timeout) override;
@@ -67,6 +175,8 @@ public:
 private:
   const std::string cluster_name_;
   Upstream::ClusterManager& cm_;
+  Runtime::Loader& runtime_;
+  ThreadLocal::SlotPtr tls_;
 };
 
 class NullClientImpl : public Client {
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Envoy {
+namespace Redis {
+
+/**
+ * Redis Cluster key to hash slot mapping, as described in https://redis.io/topics/cluster-spec
+ */
+class ClusterSlot {
+public:
+  // The number of hash slots a Redis Cluster is split into.
+  static const uint16_t SLOTS;
+
+  /**
+   * @param key supplies a key.
+   * @return uint16_t the hash slot of the key. This is the CRC16 of the key modulo SLOTS, or of
+   *         its hash tag if it has one: the part between its first '{' and the next '}', if that
+   *         is not empty.
+   */
+  static uint16_t keySlot(const std::string& key);
+};
+
+} // namespace Redis
+} // namespace Envoy
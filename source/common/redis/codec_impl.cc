@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 
+#include "common/buffer/buffer_impl.h"
 #include "common/common/assert.h"
 #include "common/common/utility.h"
 
@@ -91,6 +92,7 @@ void RespValue::cleanup() {
 
 void RespValue::type(RespType type) {
   cleanup();
+  raw_.reset();
 
   // Need to use placement new because of the union.
   type_ = type;
@@ -116,14 +118,64 @@ void DecoderImpl::decode(Buffer::Instance& data) {
   uint64_t num_slices = data.getRawSlices(nullptr, 0);
   Buffer::RawSlice slices[num_slices];
   data.getRawSlices(slices, num_slices);
-  for (const Buffer::RawSlice& slice : slices) {
-    parseSlice(slice);
+  uint64_t offset = 0;
+  try {
+    for (const Buffer::RawSlice& slice : slices) {
+      parseSlice(slice, offset);
+      offset += slice.len_;
+    }
+  } catch (ProtocolError&) {
+    // The values completed before the error are still dispatched, as without keep_raw_.
+    dispatchCompleteValues(data);
+    throw;
+  }
+
+  if (!keep_raw_) {
+    data.drain(data.length());
+    return;
   }
 
-  data.drain(data.length());
+  // The slices may not be changed while they are parsed, so the bytes of the values are only
+  // moved out of the input now.
+  dispatchCompleteValues(data);
+  if (state_ != State::ValueRootStart) {
+    if (!pending_raw_) {
+      pending_raw_.reset(new Buffer::OwnedImpl());
+    }
+    pending_raw_->move(data);
+  }
+  ASSERT(data.length() == 0);
+}
+
+void DecoderImpl::onValueRootComplete(uint64_t end) {
+  if (!keep_raw_) {
+    callbacks_.onRespValue(std::move(pending_value_root_));
+  } else {
+    complete_values_.emplace_back(std::move(pending_value_root_), end);
+  }
 }
 
-void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
+void DecoderImpl::dispatchCompleteValues(Buffer::Instance& data) {
+  uint64_t moved = 0;
+  for (auto& complete_value : complete_values_) {
+    Buffer::InstancePtr raw = std::move(pending_raw_);
+    if (!raw) {
+      raw.reset(new Buffer::OwnedImpl());
+    }
+    raw->move(data, complete_value.second - moved);
+    moved = complete_value.second;
+    complete_value.first->raw(std::move(raw));
+  }
+
+  // Clear the list first in case a callback leads to another decode() call.
+  std::vector<std::pair<RespValuePtr, uint64_t>> complete_values;
+  complete_values.swap(complete_values_);
+  for (auto& complete_value : complete_values) {
+    callbacks_.onRespValue(std::move(complete_value.first));
+  }
+}
+
+void DecoderImpl::parseSlice(const Buffer::RawSlice& slice, uint64_t offset) {
   const char* buffer = reinterpret_cast<const char*>(slice.mem_);
   uint64_t remaining = slice.len_;
 
@@ -314,8 +366,8 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
       ASSERT(!pending_value_stack_.empty());
       pending_value_stack_.pop_front();
       if (pending_value_stack_.empty()) {
-        callbacks_.onRespValue(std::move(pending_value_root_));
         state_ = State::ValueRootStart;
+        onValueRootComplete(offset + slice.len_ - remaining);
       } else {
         PendingValue& current_value = pending_value_stack_.front();
         ASSERT(current_value.value_->type() == RespType::Array);
@@ -334,6 +386,11 @@ void DecoderImpl::parseSlice(const Buffer::RawSlice& slice) {
 }
 
 void EncoderImpl::encode(const RespValue& value, Buffer::Instance& out) {
+  if (value.raw() != nullptr) {
+    out.add(*value.raw());
+    return;
+  }
+
   switch (value.type()) {
   case RespType::Array: {
     encodeArray(value.asArray(), out);
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <forward_list>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "envoy/redis/codec.h"
@@ -16,10 +17,14 @@ namespace Redis {
  * Decoder implementation of https://redis.io/topics/protocol
  *
  * This implementation buffers when needed and will always consume all bytes passed for decoding.
+ * If keep_raw is set, each top level value also keeps the bytes it was decoded from, which are
+ * moved out of the input buffer without copying, so that the value can be forwarded verbatim.
+ * @see RespValue::raw().
  */
 class DecoderImpl : public Decoder, Logger::Loggable<Logger::Id::redis> {
 public:
-  DecoderImpl(DecoderCallbacks& callbacks) : callbacks_(callbacks) {}
+  DecoderImpl(DecoderCallbacks& callbacks, bool keep_raw = false)
+      : callbacks_(callbacks), keep_raw_(keep_raw) {}
 
   // Redis::Decoder
   void decode(Buffer::Instance& data) override;
@@ -53,13 +58,21 @@ private:
     uint64_t current_array_element_;
   };
 
-  void parseSlice(const Buffer::RawSlice& slice);
+  void parseSlice(const Buffer::RawSlice& slice, uint64_t offset);
+  void onValueRootComplete(uint64_t end);
+  void dispatchCompleteValues(Buffer::Instance& data);
 
   DecoderCallbacks& callbacks_;
+  const bool keep_raw_;
   State state_{State::ValueRootStart};
   PendingInteger pending_integer_;
   RespValuePtr pending_value_root_;
   std::forward_list<PendingValue> pending_value_stack_;
+  // With keep_raw_, the values completed during a decode() call, each with the offset its bytes
+  // end at in the input. They are dispatched once the bytes can be moved out of the input.
+  std::vector<std::pair<RespValuePtr, uint64_t>> complete_values_;
+  // With keep_raw_, the bytes of the value being decoded that came in earlier decode() calls.
+  Buffer::InstancePtr pending_raw_;
 };
 
 /**
@@ -67,10 +80,18 @@ private:
  */
 class DecoderFactoryImpl : public DecoderFactory {
 public:
+  /**
+   * @param keep_raw supplies whether the decoders keep the bytes of the values. @see DecoderImpl.
+   */
+  DecoderFactoryImpl(bool keep_raw = false) : keep_raw_(keep_raw) {}
+
   // Redis::DecoderFactory
   DecoderPtr create(DecoderCallbacks& callbacks) override {
-    return DecoderPtr{new DecoderImpl(callbacks)};
+    return DecoderPtr{new DecoderImpl(callbacks, keep_raw_)};
   }
+
+private:
+  const bool keep_raw_;
 };
 
 /**
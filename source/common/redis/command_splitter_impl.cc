@@ -1,11 +1,14 @@
 #include "common/redis/command_splitter_impl.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "common/common/assert.h"
+#include "common/redis/cluster_slot.h"
 #include "common/redis/supported_commands.h"
 
 #include "spdlog/spdlog.h"
@@ -101,34 +104,83 @@ void FragmentedRequest::onChildFailure(uint32_t index) {
   onChildResponse(Utility::makeError("upstream failure"), index);
 }
 
+std::vector<std::vector<uint32_t>> FragmentedRequest::fragmentKeys(ConnPool::Instance& conn_pool,
+                                                                   const RespValue& request,
+                                                                   uint32_t args_per_key) {
+  const std::vector<RespValue>& args = request.asArray();
+  std::vector<std::vector<uint32_t>> fragments;
+  if (!conn_pool.clusterMode()) {
+    // Keys hashed to the same host are sent to it in one multi-key command. Keys without a known
+    // host are sent on their own.
+    std::unordered_map<const Upstream::Host*, uint32_t> host_fragments;
+    for (uint32_t i = 1; i < args.size(); i += args_per_key) {
+      Upstream::HostConstSharedPtr host = conn_pool.hostForKey(args[i].asString());
+      if (!host) {
+        fragments.push_back({i});
+        continue;
+      }
+      auto inserted = host_fragments.emplace(host.get(), fragments.size());
+      if (inserted.second) {
+        fragments.emplace_back();
+      }
+      fragments[inserted.first->second].push_back(i);
+    }
+    return fragments;
+  }
+
+  // A cluster node serves multi-key commands for keys in the same slot, in one round trip.
+  std::unordered_map<uint16_t, uint32_t> slot_fragments;
+  for (uint32_t i = 1; i < args.size(); i += args_per_key) {
+    auto inserted =
+        slot_fragments.emplace(ClusterSlot::keySlot(args[i].asString()), fragments.size());
+    if (inserted.second) {
+      fragments.emplace_back();
+    }
+    fragments[inserted.first->second].push_back(i);
+  }
+  return fragments;
+}
+
+void FragmentedRequest::buildFragment(const std::string& command, const RespValue& request,
+                                      const std::vector<uint32_t>& keys, uint32_t args_per_key,
+                                      RespValue& fragment) {
+  std::vector<RespValue> values(1 + keys.size() * args_per_key);
+  values[0].type(RespType::BulkString);
+  values[0].asString() = command;
+  uint32_t value_index = 1;
+  for (uint32_t key : keys) {
+    for (uint32_t i = 0; i < args_per_key; i++) {
+      values[value_index].type(RespType::BulkString);
+      values[value_index++].asString() = request.asArray()[key + i].asString();
+    }
+  }
+  fragment.type(RespType::Array);
+  fragment.asArray().swap(values);
+}
+
 SplitRequestPtr MGETRequest::create(ConnPool::Instance& conn_pool,
                                     const RespValue& incoming_request, SplitCallbacks& callbacks) {
   std::unique_ptr<MGETRequest> request_ptr{new MGETRequest(callbacks)};
 
-  request_ptr->num_pending_responses_ = incoming_request.asArray().size() - 1;
+  request_ptr->fragment_keys_ = fragmentKeys(conn_pool, incoming_request, 1);
+  request_ptr->num_pending_responses_ = request_ptr->fragment_keys_.size();
   request_ptr->pending_requests_.reserve(request_ptr->num_pending_responses_);
 
   request_ptr->pending_response_.reset(new RespValue());
   request_ptr->pending_response_->type(RespType::Array);
-  std::vector<RespValue> responses(request_ptr->num_pending_responses_);
+  std::vector<RespValue> responses(incoming_request.asArray().size() - 1);
   request_ptr->pending_response_->asArray().swap(responses);
 
-  std::vector<RespValue> values(2);
-  values[0].type(RespType::BulkString);
-  values[0].asString() = "get";
-  values[1].type(RespType::BulkString);
-  RespValue single_mget;
-  single_mget.type(RespType::Array);
-  single_mget.asArray().swap(values);
-
-  for (uint64_t i = 1; i < incoming_request.asArray().size(); i++) {
-    request_ptr->pending_requests_.emplace_back(*request_ptr, i - 1);
+  RespValue fragment;
+  for (uint32_t i = 0; i < request_ptr->fragment_keys_.size(); i++) {
+    const std::vector<uint32_t>& keys = request_ptr->fragment_keys_[i];
+    request_ptr->pending_requests_.emplace_back(*request_ptr, i);
     PendingRequest& pending_request = request_ptr->pending_requests_.back();
 
-    single_mget.asArray()[1].asString() = incoming_request.asArray()[i].asString();
-    ENVOY_LOG(debug, "redis: parallel get: '{}'", single_mget.toString());
-    pending_request.handle_ = conn_pool.makeRequest(incoming_request.asArray()[i].asString(),
-                                                    single_mget, pending_request);
+    buildFragment(keys.size() == 1 ? "get" : "mget", incoming_request, keys, 1, fragment);
+    ENVOY_LOG(debug, "redis: parallel get: '{}'", fragment.toString());
+    pending_request.handle_ = conn_pool.makeRequest(incoming_request.asArray()[keys[0]].asString(),
+                                                    fragment, pending_request);
     if (!pending_request.handle_) {
       pending_request.onResponse(Utility::makeError("no upstream host"));
     }
@@ -137,11 +189,9 @@ SplitRequestPtr MGETRequest::create(ConnPool::Instance& conn_pool,
   return request_ptr->num_pending_responses_ > 0 ? std::move(request_ptr) : nullptr;
 }
 
-void MGETRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
-  pending_requests_[index].handle_ = nullptr;
-
-  pending_response_->asArray()[index].type(value->type());
-  switch (value->type()) {
+void MGETRequest::setResponse(uint32_t index, RespValue& value) {
+  pending_response_->asArray()[index].type(value.type());
+  switch (value.type()) {
   case RespType::Array:
   case RespType::Integer:
   case RespType::SimpleString: {
@@ -155,12 +205,35 @@ void MGETRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
     FALLTHRU;
   }
   case RespType::BulkString: {
-    pending_response_->asArray()[index].asString().swap(value->asString());
+    pending_response_->asArray()[index].asString().swap(value.asString());
     break;
   }
   case RespType::Null:
     break;
   }
+}
+
+void MGETRequest::onChildResponse(RespValuePtr&& value, uint32_t index) {
+  pending_requests_[index].handle_ = nullptr;
+
+  // Responses are indexed by key, starting after the command.
+  const std::vector<uint32_t>& keys = fragment_keys_[index];
+  if (keys.size() == 1) {
+    setResponse(keys[0] - 1, *value);
+  } else if (value->type() == RespType::Array && value->asArray().size() == keys.size()) {
+    for (uint32_t i = 0; i < keys.size(); i++) {
+      setResponse(keys[i] - 1, value->asArray()[i]);
+    }
+  } else {
+    // An error or an unexpected response applies to all the keys of the fragment.
+    RespValue error;
+    error.type(RespType::Error);
+    for (uint32_t key : keys) {
+      error.asString() =
+          value->type() == RespType::Error ? value->asString() : "upstream protocol error";
+      setResponse(key - 1, error);
+    }
+  }
 
   ASSERT(num_pending_responses_ > 0);
   if (--num_pending_responses_ == 0) {
@@ -178,32 +251,24 @@ SplitRequestPtr MSETRequest::create(ConnPool::Instance& conn_pool,
 
   std::unique_ptr<MSETRequest> request_ptr{new MSETRequest(callbacks)};
 
-  request_ptr->num_pending_responses_ = (incoming_request.asArray().size() - 1) / 2;
+  const std::vector<std::vector<uint32_t>> fragments =
+      fragmentKeys(conn_pool, incoming_request, 2);
+  request_ptr->num_pending_responses_ = fragments.size();
   request_ptr->pending_requests_.reserve(request_ptr->num_pending_responses_);
 
   request_ptr->pending_response_.reset(new RespValue());
   request_ptr->pending_response_->type(RespType::SimpleString);
 
-  std::vector<RespValue> values(3);
-  values[0].type(RespType::BulkString);
-  values[0].asString() = "set";
-  values[1].type(RespType::BulkString);
-  values[2].type(RespType::BulkString);
-  RespValue single_mset;
-  single_mset.type(RespType::Array);
-  single_mset.asArray().swap(values);
-
-  uint64_t fragment_index = 0;
-  for (uint64_t i = 1; i < incoming_request.asArray().size(); i += 2) {
-    request_ptr->pending_requests_.emplace_back(*request_ptr, fragment_index++);
+  RespValue fragment;
+  for (uint32_t i = 0; i < fragments.size(); i++) {
+    request_ptr->pending_requests_.emplace_back(*request_ptr, i);
     PendingRequest& pending_request = request_ptr->pending_requests_.back();
 
-    single_mset.asArray()[1].asString() = incoming_request.asArray()[i].asString();
-    single_mset.asArray()[2].asString() = incoming_request.asArray()[i + 1].asString();
-
-    ENVOY_LOG(debug, "redis: parallel set: '{}'", single_mset.toString());
-    pending_request.handle_ = conn_pool.makeRequest(incoming_request.asArray()[i].asString(),
-                                                    single_mset, pending_request);
+    buildFragment(fragments[i].size() == 1 ? "set" : "mset", incoming_request, fragments[i], 2,
+                  fragment);
+    ENVOY_LOG(debug, "redis: parallel set: '{}'", fragment.toString());
+    pending_request.handle_ = conn_pool.makeRequest(
+        incoming_request.asArray()[fragments[i][0]].asString(), fragment, pending_request);
     if (!pending_request.handle_) {
       pending_request.onResponse(Utility::makeError("no upstream host"));
     }
@@ -245,29 +310,25 @@ SplitRequestPtr SplitKeysSumResultRequest::create(ConnPool::Instance& conn_pool,
                                                   SplitCallbacks& callbacks) {
   std::unique_ptr<SplitKeysSumResultRequest> request_ptr{new SplitKeysSumResultRequest(callbacks)};
 
-  request_ptr->num_pending_responses_ = incoming_request.asArray().size() - 1;
+  const std::vector<std::vector<uint32_t>> fragments =
+      fragmentKeys(conn_pool, incoming_request, 1);
+  request_ptr->num_pending_responses_ = fragments.size();
   request_ptr->pending_requests_.reserve(request_ptr->num_pending_responses_);
 
   request_ptr->pending_response_.reset(new RespValue());
   request_ptr->pending_response_->type(RespType::Integer);
 
-  std::vector<RespValue> values(2);
-  values[0].type(RespType::BulkString);
-  values[0].asString() = incoming_request.asArray()[0].asString();
-  values[1].type(RespType::BulkString);
-  RespValue single_fragment;
-  single_fragment.type(RespType::Array);
-  single_fragment.asArray().swap(values);
-
-  for (uint64_t i = 1; i < incoming_request.asArray().size(); i++) {
-    request_ptr->pending_requests_.emplace_back(*request_ptr, i - 1);
+  RespValue fragment;
+  for (uint32_t i = 0; i < fragments.size(); i++) {
+    request_ptr->pending_requests_.emplace_back(*request_ptr, i);
     PendingRequest& pending_request = request_ptr->pending_requests_.back();
 
-    single_fragment.asArray()[1].asString() = incoming_request.asArray()[i].asString();
+    buildFragment(incoming_request.asArray()[0].asString(), incoming_request, fragments[i], 1,
+                  fragment);
     ENVOY_LOG(debug, "redis: parallel {}: '{}'", incoming_request.asArray()[0].asString(),
-              single_fragment.toString());
-    pending_request.handle_ = conn_pool.makeRequest(incoming_request.asArray()[i].asString(),
-                                                    single_fragment, pending_request);
+              fragment.toString());
+    pending_request.handle_ = conn_pool.makeRequest(
+        incoming_request.asArray()[fragments[i][0]].asString(), fragment, pending_request);
     if (!pending_request.handle_) {
       pending_request.onResponse(Utility::makeError("no upstream host"));
     }
@@ -302,23 +363,35 @@ void SplitKeysSumResultRequest::onChildResponse(RespValuePtr&& value, uint32_t i
   }
 }
 
+const size_t InstanceImpl::MAX_KEY_PREFIX_SIZE;
+
 InstanceImpl::InstanceImpl(ConnPool::InstancePtr&& conn_pool, Stats::Scope& scope,
-                           const std::string& stat_prefix)
-    : conn_pool_(std::move(conn_pool)), simple_command_handler_(*conn_pool_),
-      eval_command_handler_(*conn_pool_), mget_handler_(*conn_pool_), mset_handler_(*conn_pool_),
-      split_keys_sum_result_handler_(*conn_pool_),
-      stats_{ALL_COMMAND_SPLITTER_STATS(POOL_COUNTER_PREFIX(scope, stat_prefix + "splitter."))} {
+                           const std::string& stat_prefix, MonotonicTimeSource& time_source,
+                           std::chrono::milliseconds slow_command_threshold,
+                           uint32_t slow_command_sample_one_in)
+    : conn_pool_(std::move(conn_pool)), read_conn_pool_(*conn_pool_),
+      simple_command_handler_(*conn_pool_), simple_read_command_handler_(read_conn_pool_),
+      eval_command_handler_(*conn_pool_), mget_handler_(read_conn_pool_),
+      mset_handler_(*conn_pool_), split_keys_sum_result_handler_(*conn_pool_),
+      split_keys_sum_result_read_handler_(read_conn_pool_),
+      stats_{ALL_COMMAND_SPLITTER_STATS(POOL_COUNTER_PREFIX(scope, stat_prefix + "splitter."))},
+      time_source_(time_source), slow_command_threshold_(slow_command_threshold),
+      slow_command_sample_one_in_(slow_command_sample_one_in) {
   // TODO(mattklein123) PERF: Make this a trie (like in header_map_impl).
   for (const std::string& command : SupportedCommands::simpleCommands()) {
-    addHandler(scope, stat_prefix, command, simple_command_handler_);
+    addHandler(scope, stat_prefix, command,
+               isReadOnly(command) ? simple_read_command_handler_ : simple_command_handler_);
   }
 
   for (const std::string& command : SupportedCommands::evalCommands()) {
-    addHandler(scope, stat_prefix, command, eval_command_handler_);
+    // EVAL script numkeys key [key ...] arg [arg ...]
+    addHandler(scope, stat_prefix, command, eval_command_handler_, 3);
   }
 
   for (const std::string& command : SupportedCommands::hashMultipleSumResultCommands()) {
-    addHandler(scope, stat_prefix, command, split_keys_sum_result_handler_);
+    addHandler(scope, stat_prefix, command,
+               isReadOnly(command) ? split_keys_sum_result_read_handler_
+                                   : split_keys_sum_result_handler_);
   }
 
   addHandler(scope, stat_prefix, SupportedCommands::mget(), mget_handler_);
@@ -350,8 +423,61 @@ SplitRequestPtr InstanceImpl::makeRequest(const RespValue& request, SplitCallbac
   }
 
   ENVOY_LOG(debug, "redis: splitting '{}'", request.toString());
-  handler->second.total_.inc();
-  return handler->second.handler_.get().startRequest(request, callbacks);
+  const HandlerData& handler_data = handler->second;
+  handler_data.total_.inc();
+  std::unique_ptr<TimedRequest> timed_request(new TimedRequest(*this, handler_data, callbacks));
+  if (slow_command_threshold_.count() > 0 && handler_data.key_index_ < request.asArray().size()) {
+    timed_request->key_ = request.asArray()[handler_data.key_index_].asString();
+  }
+  timed_request->request_ = handler_data.handler_.get().startRequest(request, *timed_request);
+  if (!timed_request->request_) {
+    return nullptr;
+  }
+  return std::move(timed_request);
+}
+
+void InstanceImpl::TimedRequest::onResponse(RespValuePtr&& value) {
+  if (parent_.slow_command_threshold_.count() > 0) {
+    const std::chrono::milliseconds elapsed = latency_->elapsed();
+    if (elapsed >= parent_.slow_command_threshold_) {
+      parent_.onSlowCommand(handler_, key_, elapsed);
+    }
+  }
+  latency_->complete();
+
+  // This request may be destroyed by the callbacks.
+  callbacks_.onResponse(std::move(value));
+}
+
+void InstanceImpl::onSlowCommand(const HandlerData& handler, const std::string& key,
+                                 std::chrono::milliseconds elapsed) {
+  stats_.slow_command_.inc();
+  if (slow_commands_++ % slow_command_sample_one_in_ != 0) {
+    return;
+  }
+
+  // In cluster mode the node is only known to the pool, and the slot of the key is logged instead.
+  std::string target;
+  Upstream::HostConstSharedPtr host = conn_pool_->hostForKey(key);
+  if (host) {
+    target = host->address()->asString();
+  } else if (conn_pool_->clusterMode()) {
+    target = fmt::format("slot {}", ClusterSlot::keySlot(key));
+  } else {
+    target = "no host";
+  }
+  ENVOY_LOG(info, "redis: slow command '{}' for key prefix '{}' to {} took {}ms", handler.name_,
+            keyPrefix(key), target, elapsed.count());
+}
+
+std::string InstanceImpl::keyPrefix(const std::string& key) {
+  return key.substr(0, std::min(key.find(':'), MAX_KEY_PREFIX_SIZE));
+}
+
+bool InstanceImpl::isReadOnly(const std::string& command) {
+  const std::vector<std::string>& read_only_commands = SupportedCommands::readOnlyCommands();
+  return std::find(read_only_commands.begin(), read_only_commands.end(), command) !=
+         read_only_commands.end();
 }
 
 void InstanceImpl::onInvalidRequest(SplitCallbacks& callbacks) {
@@ -360,13 +486,15 @@ void InstanceImpl::onInvalidRequest(SplitCallbacks& callbacks) {
 }
 
 void InstanceImpl::addHandler(Stats::Scope& scope, const std::string& stat_prefix,
-                              const std::string& name, CommandHandler& handler) {
+                              const std::string& name, CommandHandler& handler,
+                              uint32_t key_index) {
   std::string to_lower_name(name);
   to_lower_table_.toLowerCase(to_lower_name);
   command_map_.emplace(
       to_lower_name,
       HandlerData{scope.counter(fmt::format("{}command.{}.total", stat_prefix, to_lower_name)),
-                  handler});
+                  scope.timer(fmt::format("{}command.{}.latency", stat_prefix, to_lower_name)),
+                  handler, to_lower_name, key_index});
 }
 
 } // namespace CommandSplitter
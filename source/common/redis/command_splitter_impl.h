@@ -1,12 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/redis/command_splitter.h"
 #include "envoy/redis/conn_pool.h"
+#include "envoy/stats/stats_macros.h"
 
 #include "common/common/logger.h"
 #include "common/common/to_lower_table.h"
@@ -86,8 +90,8 @@ private:
 
 /**
  * FragmentedRequest is a base class for requests that contains multiple keys. An individual request
- * is sent to the appropriate server for each key. The responses from all servers are combined and
- * returned to the client.
+ * is sent to the appropriate server for each key, or in cluster mode for all the keys in each hash
+ * slot. The responses from all servers are combined and returned to the client.
  */
 class FragmentedRequest : public SplitRequestBase {
 public:
@@ -113,6 +117,24 @@ protected:
     ConnPool::PoolRequest* handle_{};
   };
 
+  /**
+   * Group the keys of a request into the fragments it is split into.
+   * @param conn_pool supplies the connection pool the fragments are sent to.
+   * @param request supplies the incoming request.
+   * @param args_per_key supplies the number of arguments starting with each key.
+   * @return the indexes of the keys in the request, for each fragment.
+   */
+  static std::vector<std::vector<uint32_t>> fragmentKeys(ConnPool::Instance& conn_pool,
+                                                         const RespValue& request,
+                                                         uint32_t args_per_key);
+
+  /**
+   * Build the request for a fragment, with the arguments of its keys.
+   */
+  static void buildFragment(const std::string& command, const RespValue& request,
+                            const std::vector<uint32_t>& keys, uint32_t args_per_key,
+                            RespValue& fragment);
+
   virtual void onChildResponse(RespValuePtr&& value, uint32_t index) PURE;
   void onChildFailure(uint32_t index);
 
@@ -135,8 +157,13 @@ public:
 private:
   MGETRequest(SplitCallbacks& callbacks) : FragmentedRequest(callbacks) {}
 
+  void setResponse(uint32_t index, RespValue& value);
+
   // Redis::CommandSplitter::FragmentedRequest
   void onChildResponse(RespValuePtr&& value, uint32_t index) override;
+
+  // The keys of each fragment, by their index in the incoming request.
+  std::vector<std::vector<uint32_t>> fragment_keys_;
 };
 
 /**
@@ -176,6 +203,32 @@ private:
   void onChildResponse(RespValuePtr&& value, uint32_t index) override;
 };
 
+/**
+ * Connection pool for read-only commands, which makes each of their requests as a read so that the
+ * pool may send it to a replica.
+ */
+class ReadConnPool : public ConnPool::Instance {
+public:
+  ReadConnPool(ConnPool::Instance& parent) : parent_(parent) {}
+
+  // Redis::ConnPool::Instance
+  ConnPool::PoolRequest* makeRequest(const std::string& hash_key, const RespValue& request,
+                                     ConnPool::PoolCallbacks& callbacks) override {
+    return parent_.makeReadRequest(hash_key, request, callbacks);
+  }
+  ConnPool::PoolRequest* makeReadRequest(const std::string& hash_key, const RespValue& request,
+                                         ConnPool::PoolCallbacks& callbacks) override {
+    return parent_.makeReadRequest(hash_key, request, callbacks);
+  }
+  bool clusterMode() const override { return parent_.clusterMode(); }
+  Upstream::HostConstSharedPtr hostForKey(const std::string& hash_key) override {
+    return parent_.hostForKey(hash_key);
+  }
+
+private:
+  ConnPool::Instance& parent_;
+};
+
 /**
  * CommandHandlerFactory is placed in the command lookup map for each supported command and is used
  * to create Request objects.
@@ -195,7 +248,8 @@ public:
 // clang-format off
 #define ALL_COMMAND_SPLITTER_STATS(COUNTER)                                                        \
   COUNTER(invalid_request)                                                                         \
-  COUNTER(unsupported_command)
+  COUNTER(unsupported_command)                                                                     \
+  COUNTER(slow_command)
 // clang-format on
 
 /**
@@ -205,33 +259,87 @@ struct InstanceStats {
   ALL_COMMAND_SPLITTER_STATS(GENERATE_COUNTER_STRUCT)
 };
 
+/**
+ * The splitter times each supported command from its request to its response in the
+ * command.<name>.latency timer. Commands slower than the slow command threshold, if there is one,
+ * are counted, and one in every slow_command_sample_one_in of them is logged with the prefix of its
+ * key and the host the key hashes to.
+ */
 class InstanceImpl : public Instance, Logger::Loggable<Logger::Id::redis> {
 public:
   InstanceImpl(ConnPool::InstancePtr&& conn_pool, Stats::Scope& scope,
-               const std::string& stat_prefix);
+               const std::string& stat_prefix, MonotonicTimeSource& time_source,
+               std::chrono::milliseconds slow_command_threshold = std::chrono::milliseconds(0),
+               uint32_t slow_command_sample_one_in = 1);
 
   // Redis::CommandSplitter::Instance
   SplitRequestPtr makeRequest(const RespValue& request, SplitCallbacks& callbacks) override;
 
+  /**
+   * @return std::string the part of a key that is logged for slow commands. Keys are commonly
+   *         namespaced like "<type>:<id>", and only the namespace is logged.
+   */
+  static std::string keyPrefix(const std::string& key);
+
 private:
+  static const size_t MAX_KEY_PREFIX_SIZE = 32;
+
   struct HandlerData {
     Stats::Counter& total_;
+    Stats::Timer& latency_;
     std::reference_wrapper<CommandHandler> handler_;
+    const std::string name_;
+    // The argument holding the key of the command.
+    const uint32_t key_index_;
+  };
+
+  /**
+   * A request that passes on the response of the request it wraps, once it has timed it.
+   */
+  struct TimedRequest : public SplitRequest, public SplitCallbacks {
+    TimedRequest(InstanceImpl& parent, const HandlerData& handler, SplitCallbacks& callbacks)
+        : parent_(parent), handler_(handler), callbacks_(callbacks),
+          latency_(handler.latency_.allocateSpan(parent.time_source_)) {}
+
+    // Redis::CommandSplitter::SplitRequest
+    void cancel() override { request_->cancel(); }
+
+    // Redis::CommandSplitter::SplitCallbacks
+    void onResponse(RespValuePtr&& value) override;
+
+    InstanceImpl& parent_;
+    const HandlerData& handler_;
+    SplitCallbacks& callbacks_;
+    Stats::TimespanPtr latency_;
+    // Only kept if slow commands are logged.
+    std::string key_;
+    SplitRequestPtr request_;
   };
 
   void addHandler(Stats::Scope& scope, const std::string& stat_prefix, const std::string& name,
-                  CommandHandler& handler);
+                  CommandHandler& handler, uint32_t key_index = 1);
   void onInvalidRequest(SplitCallbacks& callbacks);
+  void onSlowCommand(const HandlerData& handler, const std::string& key,
+                     std::chrono::milliseconds elapsed);
+  static bool isReadOnly(const std::string& command);
 
   ConnPool::InstancePtr conn_pool_;
+  ReadConnPool read_conn_pool_;
   CommandHandlerFactory<SimpleRequest> simple_command_handler_;
+  CommandHandlerFactory<SimpleRequest> simple_read_command_handler_;
   CommandHandlerFactory<EvalRequest> eval_command_handler_;
   CommandHandlerFactory<MGETRequest> mget_handler_;
   CommandHandlerFactory<MSETRequest> mset_handler_;
   CommandHandlerFactory<SplitKeysSumResultRequest> split_keys_sum_result_handler_;
+  CommandHandlerFactory<SplitKeysSumResultRequest> split_keys_sum_result_read_handler_;
   std::unordered_map<std::string, HandlerData> command_map_;
   InstanceStats stats_;
   const ToLowerTable to_lower_table_;
+  MonotonicTimeSource& time_source_;
+  const std::chrono::milliseconds slow_command_threshold_;
+  const uint32_t slow_command_sample_one_in_;
+  // The splitter is shared by the workers.
+  std::atomic<uint64_t> slow_commands_{};
 };
 
 } // namespace CommandSplitter
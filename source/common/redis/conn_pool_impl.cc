@@ -1,5 +1,6 @@
 #include "common/redis/conn_pool_impl.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -7,8 +8,11 @@
 
 #include "common/common/assert.h"
 #include "common/common/enum_to_int.h"
+#include "common/common/utility.h"
 #include "common/http/codes.h"
 #include "common/json/config_schemas.h"
+#include "common/network/utility.h"
+#include "common/redis/cluster_slot.h"
 
 namespace Envoy {
 namespace Redis {
@@ -16,7 +20,28 @@ namespace ConnPool {
 
 ConfigImpl::ConfigImpl(const Json::Object& config)
     : Validator(config, Json::Schema::REDIS_CONN_POOL_SCHEMA),
-      op_timeout_(config.getInteger("op_timeout_ms")) {}
+      op_timeout_(config.getInteger("op_timeout_ms")),
+      max_batch_requests_(config.getInteger("max_batch_requests", 0)),
+      max_batch_bytes_(config.getInteger("max_batch_bytes", 0)),
+      cluster_mode_(config.getBoolean("cluster_mode", false)),
+      read_policy_(stringToReadPolicy(config.getString("read_policy", "master"))) {}
+
+ReadPolicy ConfigImpl::stringToReadPolicy(const std::string& read_policy) {
+  if (read_policy == "prefer_replica") {
+    return ReadPolicy::PreferReplica;
+  } else if (read_policy == "replica") {
+    return ReadPolicy::Replica;
+  } else if (read_policy == "any") {
+    return ReadPolicy::Any;
+  } else {
+    ASSERT(read_policy == "master");
+    return ReadPolicy::Master;
+  }
+}
+
+const std::string ClientImpl::BATCH_REQUESTS_STAT = "redis.upstream_batch_requests";
+const std::string ClientImpl::BATCH_BYTES_STAT = "redis.upstream_batch_bytes";
+const std::string ClientImpl::UPSTREAM_RQ_TIME_STAT = "redis.upstream_rq_time";
 
 ClientPtr ClientImpl::create(Upstream::HostConstSharedPtr host, Event::Dispatcher& dispatcher,
                              EncoderPtr&& encoder, DecoderFactory& decoder_factory,
@@ -35,7 +60,11 @@ ClientPtr ClientImpl::create(Upstream::HostConstSharedPtr host, Event::Dispatche
 ClientImpl::ClientImpl(Upstream::HostConstSharedPtr host, Event::Dispatcher& dispatcher,
                        EncoderPtr&& encoder, DecoderFactory& decoder_factory, const Config& config)
     : host_(host), encoder_(std::move(encoder)), decoder_(decoder_factory.create(*this)),
-      config_(config),
+      config_(config), time_source_(dispatcher.approximateMonotonicTime()),
+      upstream_rq_time_(host->cluster().statsScope().timer(UPSTREAM_RQ_TIME_STAT)),
+      flush_timer_(config.maxBatchRequests() > 0 || config.maxBatchBytes() > 0
+                       ? dispatcher.createTimer([this]() -> void { flush(); })
+                       : nullptr),
       connect_or_op_timer_(dispatcher.createTimer([this]() -> void { onConnectOrOpTimeout(); })) {
   host->cluster().stats().upstream_cx_total_.inc();
   host->cluster().stats().upstream_cx_active_.inc();
@@ -57,7 +86,16 @@ PoolRequest* ClientImpl::makeRequest(const RespValue& request, PoolCallbacks& ca
   ASSERT(connection_->state() == Network::Connection::State::Open);
   pending_requests_.emplace_back(*this, callbacks);
   encoder_->encode(request, encoder_buffer_);
-  connection_->write(encoder_buffer_);
+  if (!flush_timer_) {
+    connection_->write(encoder_buffer_);
+  } else if (++batch_requests_ == config_.maxBatchRequests() ||
+             (config_.maxBatchBytes() > 0 && encoder_buffer_.length() >= config_.maxBatchBytes())) {
+    flush();
+  } else if (batch_requests_ == 1) {
+    // A zero timeout fires once the events ready in this dispatcher iteration have run, so all the
+    // requests they make go out in one write.
+    flush_timer_->enableTimer(std::chrono::milliseconds(0));
+  }
 
   // Only boost the op timeout if we are not already connected. Otherwise, we are governed by
   // the connect timeout and the timer will be reset when/if connection occurs. This allows a
@@ -69,6 +107,19 @@ PoolRequest* ClientImpl::makeRequest(const RespValue& request, PoolCallbacks& ca
   return &pending_requests_.back();
 }
 
+void ClientImpl::flush() {
+  if (batch_requests_ == 0) {
+    return;
+  }
+
+  Stats::Scope& scope = host_->cluster().statsScope();
+  scope.deliverHistogramToSinks(BATCH_REQUESTS_STAT, batch_requests_);
+  scope.deliverHistogramToSinks(BATCH_BYTES_STAT, encoder_buffer_.length());
+  batch_requests_ = 0;
+  flush_timer_->disableTimer();
+  connection_->write(encoder_buffer_);
+}
+
 void ClientImpl::onConnectOrOpTimeout() {
   host_->outlierDetector().putHttpResponseCode(enumToInt(Http::Code::GatewayTimeout));
   if (connected_) {
@@ -114,6 +165,12 @@ void ClientImpl::onEvent(Network::ConnectionEvent event) {
       pending_requests_.pop_front();
     }
 
+    // Requests still waiting in a batch have failed above.
+    if (flush_timer_) {
+      flush_timer_->disableTimer();
+      batch_requests_ = 0;
+      encoder_buffer_.drain(encoder_buffer_.length());
+    }
     connect_or_op_timer_->disableTimer();
   } else if (event == Network::ConnectionEvent::Connected) {
     connected_ = true;
@@ -130,6 +187,8 @@ void ClientImpl::onEvent(Network::ConnectionEvent event) {
 void ClientImpl::onRespValue(RespValuePtr&& value) {
   ASSERT(!pending_requests_.empty());
   PendingRequest& request = pending_requests_.front();
+  // The upstream took as long whether or not the request is still wanted.
+  request.upstream_rq_time_->complete();
   if (!request.canceled_) {
     request.callbacks_.onResponse(std::move(value));
   } else {
@@ -147,7 +206,8 @@ void ClientImpl::onRespValue(RespValuePtr&& value) {
 }
 
 ClientImpl::PendingRequest::PendingRequest(ClientImpl& parent, PoolCallbacks& callbacks)
-    : parent_(parent), callbacks_(callbacks) {
+    : parent_(parent), callbacks_(callbacks),
+      upstream_rq_time_(parent.upstream_rq_time_.allocateSpan(parent.time_source_)) {
   parent.host_->cluster().stats().upstream_rq_total_.inc();
   parent.host_->cluster().stats().upstream_rq_active_.inc();
   parent.host_->stats().rq_total_.inc();
@@ -174,6 +234,22 @@ ClientPtr ClientFactoryImpl::create(Upstream::HostConstSharedPtr host,
                             config);
 }
 
+namespace {
+
+void makeCommand(const std::vector<std::string>& args, RespValue& command) {
+  std::vector<RespValue> values(args.size());
+  for (size_t i = 0; i < args.size(); i++) {
+    values[i].type(RespType::BulkString);
+    values[i].asString() = args[i];
+  }
+  command.type(RespType::Array);
+  command.asArray().swap(values);
+}
+
+} // namespace
+
+const uint32_t InstanceImpl::MAX_REDIRECTIONS = 3;
+
 InstanceImpl::InstanceImpl(const std::string& cluster_name, Upstream::ClusterManager& cm,
                            ClientFactory& client_factory, ThreadLocal::SlotAllocator& tls,
                            const Json::Object& config)
@@ -186,21 +262,33 @@ InstanceImpl::InstanceImpl(const std::string& cluster_name, Upstream::ClusterMan
 
 PoolRequest* InstanceImpl::makeRequest(const std::string& hash_key, const RespValue& value,
                                        PoolCallbacks& callbacks) {
-  return tls_->getTyped<ThreadLocalPool>().makeRequest(hash_key, value, callbacks);
+  return tls_->getTyped<ThreadLocalPool>().makeRequest(hash_key, value, callbacks, false);
+}
+
+PoolRequest* InstanceImpl::makeReadRequest(const std::string& hash_key, const RespValue& value,
+                                           PoolCallbacks& callbacks) {
+  return tls_->getTyped<ThreadLocalPool>().makeRequest(hash_key, value, callbacks, true);
+}
+
+Upstream::HostConstSharedPtr InstanceImpl::hostForKey(const std::string& hash_key) {
+  return tls_->getTyped<ThreadLocalPool>().hostForKey(hash_key);
 }
 
 InstanceImpl::ThreadLocalPool::ThreadLocalPool(InstanceImpl& parent, Event::Dispatcher& dispatcher,
                                                const std::string& cluster_name)
     : parent_(parent), dispatcher_(dispatcher), cluster_(parent_.cm_.get(cluster_name)) {
+  makeCommand({"cluster", "slots"}, cluster_slots_request_);
+  makeCommand({"asking"}, asking_request_);
+  makeCommand({"readonly"}, readonly_request_);
 
   // TODO(mattklein123): Redis is not currently safe for use with CDS. In order to make this work
   //                     we will need to add thread local cluster removal callbacks so that we can
   //                     safely clean things up and fail requests.
   ASSERT(!cluster_->info()->addedViaApi());
   local_host_set_member_update_cb_handle_ = cluster_->hostSet().addMemberUpdateCb(
-      [this](const std::vector<Upstream::HostSharedPtr>&,
+      [this](const std::vector<Upstream::HostSharedPtr>& hosts_added,
              const std::vector<Upstream::HostSharedPtr>& hosts_removed) -> void {
-        onHostsRemoved(hosts_removed);
+        onHostsChanged(hosts_added, hosts_removed);
       });
 }
 
@@ -211,7 +299,8 @@ InstanceImpl::ThreadLocalPool::~ThreadLocalPool() {
   }
 }
 
-void InstanceImpl::ThreadLocalPool::onHostsRemoved(
+void InstanceImpl::ThreadLocalPool::onHostsChanged(
+    const std::vector<Upstream::HostSharedPtr>& hosts_added,
     const std::vector<Upstream::HostSharedPtr>& hosts_removed) {
   for (const auto& host : hosts_removed) {
     auto it = client_map_.find(host);
@@ -220,18 +309,118 @@ void InstanceImpl::ThreadLocalPool::onHostsRemoved(
       // we just close the connection. This will fail any pending requests.
       it->second->redis_client_->close();
     }
+    for (ShardSharedPtr& shard : slots_) {
+      if (!shard) {
+        continue;
+      }
+      if (shard->master_ == host) {
+        shard = nullptr;
+      } else {
+        shard->replicas_.erase(
+            std::remove(shard->replicas_.begin(), shard->replicas_.end(), host),
+            shard->replicas_.end());
+      }
+    }
+  }
+
+  // The slots are discovered again with the next request.
+  if (!hosts_added.empty() || !hosts_removed.empty()) {
+    slots_current_ = false;
   }
 }
 
 PoolRequest* InstanceImpl::ThreadLocalPool::makeRequest(const std::string& hash_key,
                                                         const RespValue& request,
-                                                        PoolCallbacks& callbacks) {
+                                                        PoolCallbacks& callbacks, bool read) {
+  if (parent_.config_.clusterMode()) {
+    return makeClusterRequest(hash_key, request, callbacks, read);
+  }
+
+  Upstream::HostConstSharedPtr host = hostForKey(hash_key);
+  if (!host) {
+    return nullptr;
+  }
+
+  return client(host).redis_client_->makeRequest(request, callbacks);
+}
+
+Upstream::HostConstSharedPtr
+InstanceImpl::ThreadLocalPool::hostForKey(const std::string& hash_key) {
+  // In cluster mode the node is only known for sure once it answers without redirecting.
+  if (parent_.config_.clusterMode()) {
+    return nullptr;
+  }
+
   LbContextImpl lb_context(hash_key);
-  Upstream::HostConstSharedPtr host = cluster_->loadBalancer().chooseHost(&lb_context);
+  return cluster_->loadBalancer().chooseHost(&lb_context);
+}
+
+PoolRequest* InstanceImpl::ThreadLocalPool::makeClusterRequest(const std::string& hash_key,
+                                                               const RespValue& request,
+                                                               PoolCallbacks& callbacks,
+                                                               bool read) {
+  if (!slots_current_) {
+    refreshSlots();
+  }
+
+  const uint16_t slot = ClusterSlot::keySlot(hash_key);
+  Upstream::HostConstSharedPtr host;
+  bool replica = false;
+  if (!slots_.empty() && slots_[slot]) {
+    host = chooseShardHost(*slots_[slot], read, replica);
+  } else {
+    LbContextImpl lb_context(hash_key);
+    host = cluster_->loadBalancer().chooseHost(&lb_context);
+  }
   if (!host) {
     return nullptr;
   }
 
+  ThreadLocalActiveClient& active_client = client(host);
+  if (replica && !active_client.readonly_) {
+    active_client.redis_client_->makeRequest(readonly_request_, ignore_callbacks_);
+    active_client.readonly_ = true;
+  }
+
+  RedirectingRequestPtr redirecting_request(
+      new RedirectingRequest(*this, request, callbacks, slot));
+  redirecting_request->handle_ = active_client.redis_client_->makeRequest(
+      redirecting_request->request_, *redirecting_request);
+  if (!redirecting_request->handle_) {
+    return nullptr;
+  }
+
+  redirecting_request->moveIntoList(std::move(redirecting_request), redirecting_requests_);
+  return redirecting_requests_.front().get();
+}
+
+Upstream::HostConstSharedPtr InstanceImpl::ThreadLocalPool::chooseShardHost(Shard& shard,
+                                                                            bool read,
+                                                                            bool& replica) {
+  const ReadPolicy policy = parent_.config_.readPolicy();
+  if (!read || policy == ReadPolicy::Master ||
+      (policy == ReadPolicy::PreferReplica && shard.replicas_.empty())) {
+    return shard.master_;
+  }
+
+  if (policy == ReadPolicy::Any) {
+    const uint32_t index = shard.next_read_++ % (shard.replicas_.size() + 1);
+    if (index == shard.replicas_.size()) {
+      return shard.master_;
+    }
+    replica = true;
+    return shard.replicas_[index];
+  }
+
+  if (shard.replicas_.empty()) {
+    return nullptr;
+  }
+  replica = true;
+  return shard.replicas_[shard.next_read_++ % shard.replicas_.size()];
+}
+
+InstanceImpl::ThreadLocalActiveClient&
+InstanceImpl::ThreadLocalPool::client(Upstream::HostConstSharedPtr host) {
   ThreadLocalActiveClientPtr& client = client_map_[host];
   if (!client) {
     client.reset(new ThreadLocalActiveClient(*this));
@@ -240,7 +429,153 @@ PoolRequest* InstanceImpl::ThreadLocalPool::makeRequest(const std::string& hash_
     client->redis_client_->addConnectionCallbacks(*client);
   }
 
-  return client->redis_client_->makeRequest(request, callbacks);
+  return *client;
+}
+
+Upstream::HostConstSharedPtr InstanceImpl::ThreadLocalPool::findHost(const std::string& ip,
+                                                                     uint16_t port) {
+  std::string address;
+  try {
+    address = Network::Utility::parseInternetAddress(ip, port)->asString();
+  } catch (const EnvoyException&) {
+    return nullptr;
+  }
+
+  for (const Upstream::HostSharedPtr& host : cluster_->hostSet().hosts()) {
+    if (host->address()->asString() == address) {
+      return host;
+    }
+  }
+  return nullptr;
+}
+
+void InstanceImpl::ThreadLocalPool::refreshSlots() {
+  if (slots_request_) {
+    return;
+  }
+
+  Upstream::HostConstSharedPtr host = cluster_->loadBalancer().chooseHost(nullptr);
+  if (host) {
+    slots_request_ =
+        client(host).redis_client_->makeRequest(cluster_slots_request_, slots_callbacks_);
+  }
+}
+
+void InstanceImpl::ThreadLocalPool::onSlots(RespValuePtr&& value) {
+  slots_request_ = nullptr;
+  if (value->type() != RespType::Array) {
+    return;
+  }
+
+  // Each slot range looks like: [start, end, [ip, port, id], [ip, port, id] for each replica...]
+  std::vector<ShardSharedPtr> slots(ClusterSlot::SLOTS);
+  for (const RespValue& range : value->asArray()) {
+    if (range.type() != RespType::Array || range.asArray().size() < 3 ||
+        range.asArray()[0].type() != RespType::Integer ||
+        range.asArray()[1].type() != RespType::Integer ||
+        range.asArray()[2].type() != RespType::Array) {
+      continue;
+    }
+    const std::vector<RespValue>& master = range.asArray()[2].asArray();
+    const int64_t start = range.asArray()[0].asInteger();
+    const int64_t end = range.asArray()[1].asInteger();
+    if (master.size() < 2 || master[0].type() != RespType::BulkString ||
+        master[1].type() != RespType::Integer || start < 0 || start > end ||
+        end >= ClusterSlot::SLOTS) {
+      continue;
+    }
+
+    ShardSharedPtr shard(new Shard());
+    shard->master_ = findHost(master[0].asString(), master[1].asInteger());
+    if (!shard->master_) {
+      continue;
+    }
+    for (size_t i = 3; i < range.asArray().size(); i++) {
+      const RespValue& node = range.asArray()[i];
+      if (node.type() == RespType::Array && node.asArray().size() >= 2 &&
+          node.asArray()[0].type() == RespType::BulkString &&
+          node.asArray()[1].type() == RespType::Integer) {
+        Upstream::HostConstSharedPtr replica =
+            findHost(node.asArray()[0].asString(), node.asArray()[1].asInteger());
+        if (replica) {
+          shard->replicas_.push_back(replica);
+        }
+      }
+    }
+    std::fill(slots.begin() + start, slots.begin() + end + 1, shard);
+  }
+
+  slots_.swap(slots);
+  slots_current_ = true;
+}
+
+InstanceImpl::RedirectingRequest::RedirectingRequest(ThreadLocalPool& parent,
+                                                     const RespValue& request,
+                                                     PoolCallbacks& callbacks, uint16_t slot)
+    : parent_(parent), callbacks_(callbacks), slot_(slot) {
+  // The encoder writes out the kept bytes instead of the value.
+  Buffer::InstancePtr raw(new Buffer::OwnedImpl());
+  parent_.encoder_.encode(request, *raw);
+  request_.type(RespType::Array);
+  request_.raw(std::move(raw));
+}
+
+void InstanceImpl::RedirectingRequest::cancel() {
+  handle_->cancel();
+  removeFromList(parent_.redirecting_requests_);
+}
+
+void InstanceImpl::RedirectingRequest::onResponse(RespValuePtr&& value) {
+  handle_ = nullptr;
+  if (value->type() == RespType::Error && redirections_ < MAX_REDIRECTIONS && redirect(*value)) {
+    return;
+  }
+
+  RedirectingRequestPtr self = removeFromList(parent_.redirecting_requests_);
+  callbacks_.onResponse(std::move(value));
+}
+
+void InstanceImpl::RedirectingRequest::onFailure() {
+  handle_ = nullptr;
+  RedirectingRequestPtr self = removeFromList(parent_.redirecting_requests_);
+  callbacks_.onFailure();
+}
+
+bool InstanceImpl::RedirectingRequest::redirect(const RespValue& value) {
+  // Redirections look like: MOVED <slot> <ip>:<port> or ASK <slot> <ip>:<port>
+  const std::vector<std::string> parts = StringUtil::split(value.asString(), ' ');
+  if (parts.size() != 3 || (parts[0] != "MOVED" && parts[0] != "ASK")) {
+    return false;
+  }
+  const size_t colon = parts[2].rfind(':');
+  uint64_t port;
+  if (colon == std::string::npos || !StringUtil::atoul(parts[2].c_str() + colon + 1, port) ||
+      port > UINT16_MAX) {
+    return false;
+  }
+  Upstream::HostConstSharedPtr host = parent_.findHost(parts[2].substr(0, colon), port);
+  if (!host) {
+    return false;
+  }
+
+  Client& client = *parent_.client(host).redis_client_;
+  if (parts[0] == "MOVED") {
+    // The slot has moved for good, and others may have moved with it. Its replicas are found
+    // with the rest.
+    if (!parent_.slots_.empty()) {
+      ShardSharedPtr shard(new Shard());
+      shard->master_ = host;
+      parent_.slots_[slot_] = shard;
+    }
+    parent_.refreshSlots();
+  } else {
+    // The node only serves a slot it is importing to requests preceded by ASKING.
+    client.makeRequest(parent_.asking_request_, parent_.ignore_callbacks_);
+  }
+
+  redirections_++;
+  handle_ = client.makeRequest(request_, *this);
+  return handle_ != nullptr;
 }
 
 void InstanceImpl::ThreadLocalActiveClient::onEvent(Network::ConnectionEvent event) {
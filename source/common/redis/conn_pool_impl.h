@@ -13,6 +13,8 @@
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/hash.h"
+#include "common/common/linked_object.h"
 #include "common/json/json_validator.h"
 #include "common/network/filter_impl.h"
 #include "common/redis/codec_impl.h"
@@ -23,14 +25,39 @@ namespace ConnPool {
 
 // TODO(mattklein123): Circuit breaking
 
+/**
+ * Where the reads of a cluster mode pool go. Replicas are discovered with the slot owners.
+ */
+enum class ReadPolicy {
+  // Reads go to the master, like writes.
+  Master,
+  // Reads go to the replicas of the master, or to the master if it has none.
+  PreferReplica,
+  // Reads go to the replicas of the master, and fail if it has none.
+  Replica,
+  // Reads go to the master and its replicas in turn.
+  Any
+};
+
 class ConfigImpl : public Config, Json::Validator {
 public:
   ConfigImpl(const Json::Object& config);
 
   std::chrono::milliseconds opTimeout() const override { return op_timeout_; }
+  uint32_t maxBatchRequests() const override { return max_batch_requests_; }
+  uint32_t maxBatchBytes() const override { return max_batch_bytes_; }
+
+  bool clusterMode() const { return cluster_mode_; }
+  ReadPolicy readPolicy() const { return read_policy_; }
 
 private:
+  static ReadPolicy stringToReadPolicy(const std::string& read_policy);
+
   const std::chrono::milliseconds op_timeout_;
+  const uint32_t max_batch_requests_;
+  const uint32_t max_batch_bytes_;
+  const bool cluster_mode_;
+  const ReadPolicy read_policy_;
 };
 
 class ClientImpl : public Client, public DecoderCallbacks, public Network::ConnectionCallbacks {
@@ -49,6 +76,10 @@ public:
   PoolRequest* makeRequest(const RespValue& request, PoolCallbacks& callbacks) override;
 
 private:
+  static const std::string BATCH_REQUESTS_STAT;
+  static const std::string BATCH_BYTES_STAT;
+  static const std::string UPSTREAM_RQ_TIME_STAT;
+
   struct UpstreamReadFilter : public Network::ReadFilterBaseImpl {
     UpstreamReadFilter(ClientImpl& parent) : parent_(parent) {}
 
@@ -70,6 +101,8 @@ private:
 
     ClientImpl& parent_;
     PoolCallbacks& callbacks_;
+    // Times the request from when it is queued on the connection until its response.
+    Stats::TimespanPtr upstream_rq_time_;
     bool canceled_{};
   };
 
@@ -77,6 +110,7 @@ private:
              DecoderFactory& decoder_factory, const Config& config);
   void onConnectOrOpTimeout();
   void onData(Buffer::Instance& data);
+  void flush();
 
   // Redis::DecoderCallbacks
   void onRespValue(RespValuePtr&& value) override;
@@ -92,7 +126,13 @@ private:
   Buffer::OwnedImpl encoder_buffer_;
   DecoderPtr decoder_;
   const Config& config_;
+  MonotonicTimeSource& time_source_;
+  Stats::Timer& upstream_rq_time_;
   std::list<PendingRequest> pending_requests_;
+  // Set if requests are batched. Encoded requests then wait in encoder_buffer_ until the batch is
+  // full, or until the timer flushes them at the next dispatcher iteration.
+  Event::TimerPtr flush_timer_;
+  uint32_t batch_requests_{};
   Event::TimerPtr connect_or_op_timer_;
   bool connected_{};
 };
@@ -106,9 +146,18 @@ public:
   static ClientFactoryImpl instance_;
 
 private:
-  DecoderFactoryImpl decoder_factory_;
+  // Responses keep their bytes, so that those of single server commands are forwarded verbatim.
+  DecoderFactoryImpl decoder_factory_{true};
 };
 
+/**
+ * Connection pool routing requests by consistent hashing of their key. In cluster mode, requests
+ * are instead routed to the node owning the hash slot of their key, or for reads to one of its
+ * replicas as the read policy says. Each worker keeps its own table of slot owners, which it
+ * discovers with CLUSTER SLOTS on its first request and again whenever the hosts change or a node
+ * redirects a request with MOVED. Requests for slots without a known owner go to a node chosen
+ * by hashing, which redirects them if needed.
+ */
 class InstanceImpl : public Instance {
 public:
   InstanceImpl(const std::string& cluster_name, Upstream::ClusterManager& cm,
@@ -118,6 +167,10 @@ public:
   // Redis::ConnPool::Instance
   PoolRequest* makeRequest(const std::string& hash_key, const RespValue& request,
                            PoolCallbacks& callbacks) override;
+  PoolRequest* makeReadRequest(const std::string& hash_key, const RespValue& request,
+                               PoolCallbacks& callbacks) override;
+  bool clusterMode() const override { return config_.clusterMode(); }
+  Upstream::HostConstSharedPtr hostForKey(const std::string& hash_key) override;
 
 private:
   struct ThreadLocalPool;
@@ -133,35 +186,123 @@ private:
     ThreadLocalPool& parent_;
     Upstream::HostConstSharedPtr host_;
     ClientPtr redis_client_;
+    // Set once READONLY has been sent, which a replica requires before it serves reads.
+    bool readonly_{};
   };
 
   typedef std::unique_ptr<ThreadLocalActiveClient> ThreadLocalActiveClientPtr;
 
+  /**
+   * A request in cluster mode, which follows MOVED and ASK redirections to other nodes before
+   * its response is passed on.
+   */
+  struct RedirectingRequest : public PoolRequest,
+                              public PoolCallbacks,
+                              public LinkedObject<RedirectingRequest> {
+    RedirectingRequest(ThreadLocalPool& parent, const RespValue& request, PoolCallbacks& callbacks,
+                       uint16_t slot);
+
+    // Redis::ConnPool::PoolRequest
+    void cancel() override;
+
+    // Redis::ConnPool::PoolCallbacks
+    void onResponse(RespValuePtr&& value) override;
+    void onFailure() override;
+
+    bool redirect(const RespValue& value);
+
+    ThreadLocalPool& parent_;
+    // The encoded request, which is kept to send it again.
+    RespValue request_;
+    PoolCallbacks& callbacks_;
+    const uint16_t slot_;
+    uint32_t redirections_{};
+    PoolRequest* handle_{};
+  };
+
+  typedef std::unique_ptr<RedirectingRequest> RedirectingRequestPtr;
+
+  /**
+   * The nodes serving a range of slots.
+   */
+  struct Shard {
+    Upstream::HostConstSharedPtr master_;
+    std::vector<Upstream::HostConstSharedPtr> replicas_;
+    // Turns reads over the replicas, or over the master and its replicas.
+    uint32_t next_read_{};
+  };
+
+  typedef std::shared_ptr<Shard> ShardSharedPtr;
+
   struct ThreadLocalPool : public ThreadLocal::ThreadLocalObject {
+    struct SlotsCallbacks : public PoolCallbacks {
+      SlotsCallbacks(ThreadLocalPool& parent) : parent_(parent) {}
+
+      // Redis::ConnPool::PoolCallbacks
+      void onResponse(RespValuePtr&& value) override { parent_.onSlots(std::move(value)); }
+      void onFailure() override { parent_.slots_request_ = nullptr; }
+
+      ThreadLocalPool& parent_;
+    };
+
+    struct IgnoreCallbacks : public PoolCallbacks {
+      // Redis::ConnPool::PoolCallbacks
+      void onResponse(RespValuePtr&&) override {}
+      void onFailure() override {}
+    };
+
     ThreadLocalPool(InstanceImpl& parent, Event::Dispatcher& dispatcher,
                     const std::string& cluster_name);
     ~ThreadLocalPool();
     PoolRequest* makeRequest(const std::string& hash_key, const RespValue& request,
-                             PoolCallbacks& callbacks);
-    void onHostsRemoved(const std::vector<Upstream::HostSharedPtr>& hosts_removed);
+                             PoolCallbacks& callbacks, bool read);
+    Upstream::HostConstSharedPtr hostForKey(const std::string& hash_key);
+    PoolRequest* makeClusterRequest(const std::string& hash_key, const RespValue& request,
+                                    PoolCallbacks& callbacks, bool read);
+    Upstream::HostConstSharedPtr chooseShardHost(Shard& shard, bool read, bool& replica);
+    ThreadLocalActiveClient& client(Upstream::HostConstSharedPtr host);
+    Upstream::HostConstSharedPtr findHost(const std::string& ip, uint16_t port);
+    void onHostsChanged(const std::vector<Upstream::HostSharedPtr>& hosts_added,
+                        const std::vector<Upstream::HostSharedPtr>& hosts_removed);
+    void refreshSlots();
+    void onSlots(RespValuePtr&& value);
 
     InstanceImpl& parent_;
     Event::Dispatcher& dispatcher_;
     Upstream::ThreadLocalCluster* cluster_;
     std::unordered_map<Upstream::HostConstSharedPtr, ThreadLocalActiveClientPtr> client_map_;
     Common::CallbackHandle* local_host_set_member_update_cb_handle_;
+
+    // The rest is only used in cluster mode. The nodes serving each slot, or an empty table until
+    // the first CLUSTER SLOTS response.
+    std::vector<ShardSharedPtr> slots_;
+    bool slots_current_{};
+    PoolRequest* slots_request_{};
+    SlotsCallbacks slots_callbacks_{*this};
+    IgnoreCallbacks ignore_callbacks_;
+    std::list<RedirectingRequestPtr> redirecting_requests_;
+    EncoderImpl encoder_;
+    RespValue cluster_slots_request_;
+    RespValue asking_request_;
+    RespValue readonly_request_;
   };
 
   struct LbContextImpl : public Upstream::LoadBalancerContext {
-    LbContextImpl(const std::string& hash_key) : hash_key_(std::hash<std::string>()(hash_key)) {}
+    LbContextImpl(const std::string& hash_key) : hash_key_(HashUtil::xxHash64(hash_key)) {}
 
     // Upstream::LoadBalancerContext
     Optional<uint64_t> hashKey() const override { return hash_key_; }
     const Network::Connection* downstreamConnection() const override { return nullptr; }
+    const Upstream::MetadataMatchCriteria* metadataMatchCriteria() const override {
+      return nullptr;
+    }
 
     const Optional<uint64_t> hash_key_;
   };
 
+  // The number of redirections a request follows before the last one is returned as its response.
+  static const uint32_t MAX_REDIRECTIONS;
+
   Upstream::ClusterManager& cm_;
   ClientFactory& client_factory_;
   ThreadLocal::SlotPtr tls_;
@@ -0,0 +1,245 @@
+#include "common/redis/key_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/common/utility.h"
+#include "common/json/config_schemas.h"
+#include "common/redis/supported_commands.h"
+
+#include "spdlog/spdlog.h"
+
+namespace Envoy {
+namespace Redis {
+
+void HotKeyDetector::sample(const std::string& key) {
+  std::lock_guard<std::mutex> guard(lock_);
+  auto it = counts_.find(key);
+  if (it != counts_.end()) {
+    it->second++;
+    return;
+  }
+
+  if (counts_.size() < capacity_) {
+    counts_.emplace(key, 1);
+    return;
+  }
+
+  auto min = std::min_element(counts_.begin(), counts_.end(),
+                              [](const std::pair<const std::string, uint64_t>& a,
+                                 const std::pair<const std::string, uint64_t>& b) -> bool {
+                                return a.second < b.second;
+                              });
+  const uint64_t count = min->second + 1;
+  counts_.erase(min);
+  counts_.emplace(key, count);
+}
+
+std::vector<std::pair<std::string, uint64_t>> HotKeyDetector::topKeys(uint32_t count) const {
+  std::vector<std::pair<std::string, uint64_t>> keys;
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    keys.assign(counts_.begin(), counts_.end());
+  }
+
+  const auto more_frequent = [](const std::pair<std::string, uint64_t>& a,
+                                const std::pair<std::string, uint64_t>& b) -> bool {
+    return a.second > b.second || (a.second == b.second && a.first < b.first);
+  };
+  if (keys.size() > count) {
+    std::partial_sort(keys.begin(), keys.begin() + count, keys.end(), more_frequent);
+    keys.resize(count);
+  } else {
+    std::sort(keys.begin(), keys.end(), more_frequent);
+  }
+  return keys;
+}
+
+KeyCache::KeyCache(const Json::Object& config, const std::string& stat_prefix,
+                   Stats::Scope& scope, ThreadLocal::SlotAllocator& tls,
+                   MonotonicTimeSource& time_source, Server::Admin& admin)
+    : Json::Validator(config, Json::Schema::REDIS_KEY_CACHE_SCHEMA),
+      max_entries_(config.getInteger("max_entries")), ttl_(config.getInteger("ttl_ms")),
+      key_prefixes_(config.getStringArray("key_prefixes", true)),
+      sample_rate_(config.getObject("hot_keys", true)->getInteger("sample_rate", 100)),
+      top_k_(config.getObject("hot_keys", true)->getInteger("top_k", 0)),
+      stats_(generateStats(stat_prefix, scope)), tls_(tls.allocateSlot()),
+      time_source_(time_source), admin_(admin) {
+  tls_->set([](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<ThreadLocalCache>();
+  });
+
+  if (top_k_ == 0) {
+    return;
+  }
+
+  // Counting more keys than are reported keeps the counts of the reported keys accurate.
+  hot_keys_.reset(new HotKeyDetector(top_k_ * 8));
+  std::string path = stat_prefix;
+  std::replace(path.begin(), path.end(), '.', '/');
+  admin_prefix_ = "/" + path + "hot_keys";
+  if (!admin_.addHandler(admin_prefix_, "print out the hottest keys seen by a redis proxy",
+                         MAKE_ADMIN_HANDLER(handlerHotKeys), true)) {
+    ENVOY_LOG(warn, "redis: admin handler {} already exists", admin_prefix_);
+    admin_prefix_.clear();
+  }
+}
+
+KeyCache::~KeyCache() {
+  if (!admin_prefix_.empty()) {
+    admin_.removeHandler(admin_prefix_);
+  }
+}
+
+KeyCacheStats KeyCache::generateStats(const std::string& prefix, Stats::Scope& scope) {
+  std::string final_prefix = prefix + "cache.";
+  return {ALL_REDIS_KEY_CACHE_STATS(POOL_COUNTER_PREFIX(scope, final_prefix))};
+}
+
+bool KeyCache::cacheable(const std::string& key) const {
+  if (key_prefixes_.empty()) {
+    return true;
+  }
+  for (const std::string& prefix : key_prefixes_) {
+    if (StringUtil::startsWith(key.c_str(), prefix)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+RespValuePtr KeyCache::onRequest(const RespValue& request, Lookup& lookup) {
+  // The splitter rejects anything else.
+  if (request.type() != RespType::Array || request.asArray().size() < 2 ||
+      request.asArray()[0].type() != RespType::BulkString ||
+      request.asArray()[1].type() != RespType::BulkString) {
+    return nullptr;
+  }
+
+  ThreadLocalCache& cache = tls_->getTyped<ThreadLocalCache>();
+  const std::vector<RespValue>& args = request.asArray();
+  if (hot_keys_ && ++cache.requests_ % sample_rate_ == 0) {
+    hot_keys_->sample(args[1].asString());
+  }
+
+  std::string command(args[0].asString());
+  to_lower_table_.toLowerCase(command);
+  if (command != "get") {
+    invalidateWrittenKeys(cache, command, request);
+    return nullptr;
+  }
+
+  const std::string& key = args[1].asString();
+  if (args.size() != 2 || !cacheable(key)) {
+    return nullptr;
+  }
+
+  auto it = cache.index_.find(key);
+  if (it != cache.index_.end()) {
+    if (it->second->expiry_ > time_source_.currentTime()) {
+      stats_.hit_.inc();
+      cache.entries_.splice(cache.entries_.begin(), cache.entries_, it->second);
+      RespValuePtr response(new RespValue());
+      response->type(RespType::BulkString);
+      response->asString() = it->second->value_;
+      return response;
+    }
+    cache.entries_.erase(it->second);
+    cache.index_.erase(it);
+  }
+
+  stats_.miss_.inc();
+  lookup.pending_ = true;
+  lookup.key_ = key;
+  lookup.epoch_ = cache.epoch_;
+  return nullptr;
+}
+
+void KeyCache::onResponse(const Lookup& lookup, const RespValue& response) {
+  ThreadLocalCache& cache = tls_->getTyped<ThreadLocalCache>();
+  if (!lookup.pending_ || response.type() != RespType::BulkString ||
+      lookup.epoch_ != cache.epoch_) {
+    return;
+  }
+
+  const MonotonicTime expiry = time_source_.currentTime() + ttl_;
+  auto it = cache.index_.find(lookup.key_);
+  if (it != cache.index_.end()) {
+    it->second->value_ = response.asString();
+    it->second->expiry_ = expiry;
+    cache.entries_.splice(cache.entries_.begin(), cache.entries_, it->second);
+  } else {
+    cache.entries_.push_front({lookup.key_, response.asString(), expiry});
+    cache.index_.emplace(lookup.key_, cache.entries_.begin());
+    if (cache.entries_.size() > max_entries_) {
+      stats_.evict_.inc();
+      cache.index_.erase(cache.entries_.back().key_);
+      cache.entries_.pop_back();
+    }
+  }
+  stats_.insert_.inc();
+}
+
+void KeyCache::invalidate(ThreadLocalCache& cache, const std::string& key) {
+  if (!cacheable(key)) {
+    return;
+  }
+
+  // A GET of the key may be in flight, and its response must not be cached.
+  cache.epoch_++;
+  auto it = cache.index_.find(key);
+  if (it != cache.index_.end()) {
+    stats_.invalidate_.inc();
+    cache.entries_.erase(it->second);
+    cache.index_.erase(it);
+  }
+}
+
+void KeyCache::invalidateWrittenKeys(ThreadLocalCache& cache, const std::string& command,
+                                     const RespValue& request) {
+  const std::vector<std::string>& read_only = SupportedCommands::readOnlyCommands();
+  if (std::find(read_only.begin(), read_only.end(), command) != read_only.end()) {
+    return;
+  }
+
+  const std::vector<RespValue>& args = request.asArray();
+  const std::vector<std::string>& multiple = SupportedCommands::hashMultipleSumResultCommands();
+  const std::vector<std::string>& eval = SupportedCommands::evalCommands();
+  size_t first = 1;
+  size_t end = 2;
+  size_t step = 1;
+  if (command == SupportedCommands::mset()) {
+    end = args.size();
+    step = 2;
+  } else if (std::find(multiple.begin(), multiple.end(), command) != multiple.end()) {
+    end = args.size();
+  } else if (std::find(eval.begin(), eval.end(), command) != eval.end()) {
+    // EVAL looks like: EVAL script numkeys key [key ...] arg [arg ...]
+    uint64_t num_keys;
+    if (args.size() < 4 || args[2].type() != RespType::BulkString ||
+        !StringUtil::atoul(args[2].asString().c_str(), num_keys)) {
+      return;
+    }
+    first = 3;
+    end = std::min<uint64_t>(args.size(), first + num_keys);
+  }
+
+  for (size_t i = first; i < end; i += step) {
+    if (args[i].type() == RespType::BulkString) {
+      invalidate(cache, args[i].asString());
+    }
+  }
+}
+
+Http::Code KeyCache::handlerHotKeys(const std::string&, Buffer::Instance& response) {
+  for (const std::pair<std::string, uint64_t>& key : hot_keys_->topKeys(top_k_)) {
+    response.add(fmt::format("{}: {}\n", key.first, key.second));
+  }
+  return Http::Code::OK;
+}
+
+} // namespace Redis
+} // namespace Envoy
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "envoy/buffer/buffer.h"
+#include "envoy/common/time.h"
+#include "envoy/http/codes.h"
+#include "envoy/json/json_object.h"
+#include "envoy/redis/codec.h"
+#include "envoy/server/admin.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "common/common/logger.h"
+#include "common/common/to_lower_table.h"
+#include "common/json/json_validator.h"
+
+namespace Envoy {
+namespace Redis {
+
+/**
+ * All redis key cache stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_REDIS_KEY_CACHE_STATS(COUNTER)                                                         \
+  COUNTER(hit)                                                                                     \
+  COUNTER(miss)                                                                                    \
+  COUNTER(insert)                                                                                  \
+  COUNTER(invalidate)                                                                              \
+  COUNTER(evict)
+// clang-format on
+
+/**
+ * Struct definition for all redis key cache stats. @see stats_macros.h
+ */
+struct KeyCacheStats {
+  ALL_REDIS_KEY_CACHE_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * Approximate counts of the most frequent keys, kept with the space saving algorithm: a key that
+ * is not counted yet replaces the key with the lowest count, and starts from that count. Any key
+ * more frequent than 1 / capacity of the samples is counted. May be used from several threads.
+ */
+class HotKeyDetector {
+public:
+  HotKeyDetector(uint32_t capacity) : capacity_(capacity) {}
+
+  void sample(const std::string& key);
+
+  /**
+   * @param count supplies the number of keys to return.
+   * @return the most frequent keys with their counts, most frequent first.
+   */
+  std::vector<std::pair<std::string, uint64_t>> topKeys(uint32_t count) const;
+
+private:
+  const uint32_t capacity_;
+  mutable std::mutex lock_;
+  std::unordered_map<std::string, uint64_t> counts_;
+};
+
+/**
+ * Cache of GET responses for a redis proxy. Each worker caches the keys it reads in an LRU list
+ * of at most max_entries, for at most ttl_ms. A write seen by a worker invalidates its keys in the
+ * cache of that worker, so the other workers may serve the old value until it expires. Optionally,
+ * every sample_rate-th request is sampled for the hot key report, which the admin server serves at
+ * /redis/<stat_prefix>/hot_keys.
+ */
+class KeyCache : Json::Validator, Logger::Loggable<Logger::Id::redis> {
+public:
+  /**
+   * A GET that missed, whose response may be cached once it arrives.
+   */
+  struct Lookup {
+    bool pending_{};
+    std::string key_;
+    uint64_t epoch_{};
+  };
+
+  KeyCache(const Json::Object& config, const std::string& stat_prefix, Stats::Scope& scope,
+           ThreadLocal::SlotAllocator& tls, MonotonicTimeSource& time_source,
+           Server::Admin& admin);
+  ~KeyCache();
+
+  /**
+   * Serve a GET from the cache, or invalidate the keys a write request writes.
+   * @param request supplies a valid request from downstream.
+   * @param lookup receives the key of a GET that missed, to pass to onResponse().
+   * @return RespValuePtr the cached response, or nullptr if the request must go upstream.
+   */
+  RespValuePtr onRequest(const RespValue& request, Lookup& lookup);
+
+  /**
+   * Cache the response of a GET that missed, unless a write on this worker may have changed the
+   * value since it was requested.
+   */
+  void onResponse(const Lookup& lookup, const RespValue& response);
+
+  KeyCacheStats& stats() { return stats_; }
+
+private:
+  struct Entry {
+    std::string key_;
+    std::string value_;
+    MonotonicTime expiry_;
+  };
+
+  struct ThreadLocalCache : public ThreadLocal::ThreadLocalObject {
+    // Most recently used first.
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    // Incremented by every invalidation.
+    uint64_t epoch_{};
+    uint64_t requests_{};
+  };
+
+  static KeyCacheStats generateStats(const std::string& prefix, Stats::Scope& scope);
+  bool cacheable(const std::string& key) const;
+  void invalidate(ThreadLocalCache& cache, const std::string& key);
+  void invalidateWrittenKeys(ThreadLocalCache& cache, const std::string& command,
+                             const RespValue& request);
+  Http::Code handlerHotKeys(const std::string& url, Buffer::Instance& response);
+
+  const uint32_t max_entries_;
+  const std::chrono::milliseconds ttl_;
+  const std::vector<std::string> key_prefixes_;
+  const uint32_t sample_rate_;
+  const uint32_t top_k_;
+  std::unique_ptr<HotKeyDetector> hot_keys_;
+  KeyCacheStats stats_;
+  ThreadLocal::SlotPtr tls_;
+  MonotonicTimeSource& time_source_;
+  Server::Admin& admin_;
+  std::string admin_prefix_;
+  const ToLowerTable to_lower_table_;
+};
+
+typedef std::shared_ptr<KeyCache> KeyCacheSharedPtr;
+
+} // namespace Redis
+} // namespace Envoy
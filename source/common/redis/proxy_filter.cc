@@ -21,6 +21,13 @@ ProxyFilterConfig::ProxyFilterConfig(const Json::Object& config, Upstream::Clust
       stat_prefix_(fmt::format("redis.{}.", config.getString("stat_prefix"))),
       stats_(generateStats(stat_prefix_, scope)) {
   Config::Utility::checkCluster("redis", cluster_name_, cm);
+
+  if (config.hasObject("slow_command_log")) {
+    const Json::ObjectSharedPtr slow_command_log = config.getObject("slow_command_log");
+    slow_command_threshold_ =
+        std::chrono::milliseconds(slow_command_log->getInteger("threshold_ms"));
+    slow_command_sample_one_in_ = slow_command_log->getInteger("sample_one_in", 1);
+  }
 }
 
 ProxyStats ProxyFilterConfig::generateStats(const std::string& prefix, Stats::Scope& scope) {
@@ -29,9 +36,10 @@ ProxyStats ProxyFilterConfig::generateStats(const std::string& prefix, Stats::Sc
 }
 
 ProxyFilter::ProxyFilter(DecoderFactory& factory, EncoderPtr&& encoder,
-                         CommandSplitter::Instance& splitter, ProxyFilterConfigSharedPtr config)
+                         CommandSplitter::Instance& splitter, ProxyFilterConfigSharedPtr config,
+                         KeyCacheSharedPtr key_cache)
     : decoder_(factory.create(*this)), encoder_(std::move(encoder)), splitter_(splitter),
-      config_(config) {
+      config_(config), key_cache_(key_cache) {
   config_->stats().downstream_cx_total_.inc();
   config_->stats().downstream_cx_active_.inc();
 }
@@ -53,6 +61,14 @@ void ProxyFilter::initializeReadFilterCallbacks(Network::ReadFilterCallbacks& ca
 void ProxyFilter::onRespValue(RespValuePtr&& value) {
   pending_requests_.emplace_back(*this);
   PendingRequest& request = pending_requests_.back();
+  if (key_cache_) {
+    RespValuePtr cached = key_cache_->onRequest(*value, request.cache_lookup_);
+    if (cached) {
+      onResponse(request, std::move(cached));
+      return;
+    }
+  }
+
   CommandSplitter::SplitRequestPtr split = splitter_.makeRequest(*value, request);
   if (split) {
     // The splitter can immediately respond and destroy the pending request. Only store the handle
@@ -75,6 +91,9 @@ void ProxyFilter::onEvent(Network::ConnectionEvent event) {
 
 void ProxyFilter::onResponse(PendingRequest& request, RespValuePtr&& value) {
   ASSERT(!pending_requests_.empty());
+  if (key_cache_) {
+    key_cache_->onResponse(request.cache_lookup_, *value);
+  }
   request.pending_response_ = std::move(value);
   request.request_handle_ = nullptr;
 
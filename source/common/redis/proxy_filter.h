@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <list>
 #include <memory>
@@ -13,6 +14,7 @@
 #include "common/buffer/buffer_impl.h"
 #include "common/json/json_loader.h"
 #include "common/json/json_validator.h"
+#include "common/redis/key_cache.h"
 
 namespace Envoy {
 namespace Redis {
@@ -50,6 +52,9 @@ public:
   const std::string& clusterName() { return cluster_name_; }
   const std::string& statPrefix() { return stat_prefix_; }
   ProxyStats& stats() { return stats_; }
+  // Zero if slow commands are not logged.
+  std::chrono::milliseconds slowCommandThreshold() const { return slow_command_threshold_; }
+  uint32_t slowCommandSampleOneIn() const { return slow_command_sample_one_in_; }
 
 private:
   static ProxyStats generateStats(const std::string& prefix, Stats::Scope& scope);
@@ -57,6 +62,8 @@ private:
   const std::string cluster_name_;
   const std::string stat_prefix_;
   ProxyStats stats_;
+  std::chrono::milliseconds slow_command_threshold_{};
+  uint32_t slow_command_sample_one_in_{1};
 };
 
 typedef std::shared_ptr<ProxyFilterConfig> ProxyFilterConfigSharedPtr;
@@ -70,7 +77,7 @@ class ProxyFilter : public Network::ReadFilter,
                     public Network::ConnectionCallbacks {
 public:
   ProxyFilter(DecoderFactory& factory, EncoderPtr&& encoder, CommandSplitter::Instance& splitter,
-              ProxyFilterConfigSharedPtr config);
+              ProxyFilterConfigSharedPtr config, KeyCacheSharedPtr key_cache = nullptr);
   ~ProxyFilter();
 
   // Network::ReadFilter
@@ -97,6 +104,7 @@ private:
     ProxyFilter& parent_;
     RespValuePtr pending_response_;
     CommandSplitter::SplitRequestPtr request_handle_;
+    KeyCache::Lookup cache_lookup_;
   };
 
   void onResponse(PendingRequest& request, RespValuePtr&& value);
@@ -105,6 +113,7 @@ private:
   EncoderPtr encoder_;
   CommandSplitter::Instance& splitter_;
   ProxyFilterConfigSharedPtr config_;
+  KeyCacheSharedPtr key_cache_;
   Buffer::OwnedImpl encoder_buffer_;
   Network::ReadFilterCallbacks* callbacks_{};
   std::list<PendingRequest> pending_requests_;
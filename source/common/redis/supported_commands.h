@@ -104,6 +104,59 @@ struct SupportedCommands {
     return *commands;
   }
 
+  /**
+   * @return commands which only read, and may be sent to replicas
+   */
+  static const std::vector<std::string>& readOnlyCommands() {
+    static const std::vector<std::string>* commands =
+        new std::vector<std::string>{"bitcount",
+                                     "bitpos",
+                                     "dump",
+                                     "exists",
+                                     "geodist",
+                                     "geohash",
+                                     "geopos",
+                                     "get",
+                                     "getbit",
+                                     "getrange",
+                                     "hexists",
+                                     "hget",
+                                     "hgetall",
+                                     "hkeys",
+                                     "hlen",
+                                     "hmget",
+                                     "hscan",
+                                     "hstrlen",
+                                     "hvals",
+                                     "lindex",
+                                     "llen",
+                                     "lrange",
+                                     "mget",
+                                     "pttl",
+                                     "scard",
+                                     "sismember",
+                                     "smembers",
+                                     "srandmember",
+                                     "sscan",
+                                     "strlen",
+                                     "ttl",
+                                     "type",
+                                     "zcard",
+                                     "zcount",
+                                     "zlexcount",
+                                     "zrange",
+                                     "zrangebylex",
+                                     "zrangebyscore",
+                                     "zrank",
+                                     "zrevrange",
+                                     "zrevrangebylex",
+                                     "zrevrangebyscore",
+                                     "zrevrank",
+                                     "zscan",
+                                     "zscore"};
+    return *commands;
+  }
+
   /**
    * @return commands which hash on the fourth argument
    */
@@ -1,10 +1,11 @@
 #include "common/router/config_impl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <map>
 #include <memory>
-#include <regex>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -15,6 +16,7 @@
 
 #include "common/common/assert.h"
 #include "common/common/empty_string.h"
+#include "common/common/hash.h"
 #include "common/common/utility.h"
 #include "common/config/metadata.h"
 #include "common/config/rds_json.h"
@@ -68,9 +70,7 @@ Optional<uint64_t> HashPolicyImpl::generateHash(const Http::HeaderMap& headers)
   Optional<uint64_t> hash;
   const Http::HeaderEntry* header = headers.get(header_name_);
   if (header) {
-    // TODO(mattklein123): Compile in murmur3/city/etc. and potentially allow the user to choose so
-    // we know exactly what we are going to get.
-    hash.value(std::hash<std::string>()(header->value().c_str()));
+    hash.value(HashUtil::xxHash64(header->value().c_str(), header->value().size()));
   }
   return hash;
 }
@@ -78,7 +78,8 @@ Optional<uint64_t> HashPolicyImpl::generateHash(const Http::HeaderMap& headers)
 const uint64_t RouteEntryImplBase::WeightedClusterEntry::MAX_CLUSTER_WEIGHT = 100UL;
 
 RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
-                                       const envoy::api::v2::Route& route, Runtime::Loader& loader)
+                                       const envoy::api::v2::Route& route, Runtime::Loader& loader,
+                                       Upstream::ClusterManager& cm)
     : case_sensitive_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(route.match(), case_sensitive, true)),
       prefix_rewrite_(route.route().prefix_rewrite()), host_rewrite_(route.route().host_rewrite()),
       vhost_(vhost),
@@ -91,7 +92,8 @@ RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
       path_redirect_(route.redirect().path_redirect()), retry_policy_(route.route()),
       rate_limit_policy_(route.route().rate_limits()), shadow_policy_(route.route()),
       priority_(ConfigUtility::parsePriority(route.route().priority())),
-      opaque_config_(parseOpaqueConfig(route)) {
+      opaque_config_(parseOpaqueConfig(route)),
+      metadata_match_criteria_(parseMetadataMatchCriteria(route)) {
   // If this is a weighted_cluster, we create N internal route entries
   // (called WeightedClusterEntry), such that each object is a simple
   // single cluster, pointing back to the parent.
@@ -101,9 +103,9 @@ RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
 
     for (const auto& cluster : route.route().weighted_clusters().clusters()) {
       const std::string& cluster_name = cluster.name();
-      std::unique_ptr<WeightedClusterEntry> cluster_entry(
-          new WeightedClusterEntry(this, runtime_key_prefix + "." + cluster_name, loader_,
-                                   cluster_name, PROTOBUF_GET_WRAPPED_REQUIRED(cluster, weight)));
+      std::unique_ptr<WeightedClusterEntry> cluster_entry(new WeightedClusterEntry(
+          this, runtime_key_prefix + "." + cluster_name, loader_, cluster_name,
+          cm.clusterId(cluster_name), PROTOBUF_GET_WRAPPED_REQUIRED(cluster, weight)));
       weighted_clusters_.emplace_back(std::move(cluster_entry));
       total_weight += weighted_clusters_.back()->clusterWeight();
     }
@@ -114,6 +116,11 @@ RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
     }
   }
 
+  // Resolve the cluster once, rather than by name on every request.
+  if (!cluster_name_.empty()) {
+    cluster_id_.value(cm.clusterId(cluster_name_));
+  }
+
   for (const auto& header_map : route.match().headers()) {
     config_headers_.push_back(header_map);
   }
@@ -134,6 +141,12 @@ RouteEntryImplBase::RouteEntryImplBase(const VirtualHostImpl& vhost,
        PROTOBUF_GET_WRAPPED_OR_DEFAULT(route.route(), include_vh_rate_limits, false));
 }
 
+bool RouteEntryImplBase::onlyDependsOnPath() const {
+  // Weighted clusters are picked at random, and the cluster header is read from the request.
+  return !runtime_.valid() && config_headers_.empty() && weighted_clusters_.empty() &&
+         cluster_header_name_.get().empty();
+}
+
 bool RouteEntryImplBase::matchRoute(const Http::HeaderMap& headers, uint64_t random_value) const {
   bool matches = true;
 
@@ -159,7 +172,7 @@ void RouteEntryImplBase::finalizeRequestHeaders(Http::HeaderMap& headers) const
     headers.addReference(to_add.first, to_add.second);
   }
   for (const std::pair<Http::LowerCaseString, std::string>& to_add :
-       vhost_.globalRouteConfig().requestHeadersToAdd()) {
+       vhost_.globalRequestHeadersToAdd()) {
     headers.addReference(to_add.first, to_add.second);
   }
 
@@ -175,7 +188,7 @@ RouteEntryImplBase::loadRuntimeData(const envoy::api::v2::RouteMatch& route_matc
   Optional<RuntimeData> runtime;
   if (route_match.has_runtime()) {
     RuntimeData data;
-    data.key_ = route_match.runtime().runtime_key();
+    data.key_ = Runtime::KeyRegistry::key(route_match.runtime().runtime_key());
     data.default_ = route_match.runtime().default_value();
     runtime.value(data);
   }
@@ -237,6 +250,22 @@ RouteEntryImplBase::parseOpaqueConfig(const envoy::api::v2::Route& route) {
   return ret;
 }
 
+Upstream::MetadataMatchCriteria
+RouteEntryImplBase::parseMetadataMatchCriteria(const envoy::api::v2::Route& route) {
+  Upstream::MetadataMatchCriteria criteria;
+  const auto filter_metadata =
+      route.metadata().filter_metadata().find(Envoy::Config::MetadataFilters::get().ENVOY_LB);
+  if (filter_metadata == route.metadata().filter_metadata().end()) {
+    return criteria;
+  }
+  for (const auto& field : filter_metadata->second.fields()) {
+    criteria.emplace_back(field.first, Envoy::Config::Metadata::valueString(field.second));
+  }
+  // The load balancer looks subsets up by criteria sorted by key. Protobuf maps are unordered.
+  std::sort(criteria.begin(), criteria.end());
+  return criteria;
+}
+
 const RedirectEntry* RouteEntryImplBase::redirectEntry() const {
   // A route for a request can exclusively be a route entry or a redirect entry.
   if (isRedirect()) {
@@ -273,31 +302,58 @@ RouteConstSharedPtr RouteEntryImplBase::clusterEntry(const Http::HeaderMap& head
       // NOTE: Though we return a shared_ptr here, the current ownership model assumes that
       //       the route table sticks around. See snapped_route_config_ in
       //       ConnectionManagerImpl::ActiveStream.
-      return std::make_shared<DynamicRouteEntry>(this, final_cluster_name);
+      return std::make_shared<DynamicRouteEntry>(this, final_cluster_name, Optional<uint32_t>());
     }
   }
 
-  uint64_t selected_value = random_value % WeightedClusterEntry::MAX_CLUSTER_WEIGHT;
-  uint64_t begin = 0UL;
-  uint64_t end = 0UL;
+  const uint32_t cluster = weightedClusterTable()
+                               ->clusters_[random_value % WeightedClusterEntry::MAX_CLUSTER_WEIGHT];
+  if (cluster == NO_WEIGHTED_CLUSTER) {
+    NOT_REACHED;
+  }
+  return weighted_clusters_[cluster];
+}
+
+RouteEntryImplBase::WeightedClusterTableConstSharedPtr
+RouteEntryImplBase::weightedClusterTable() const {
+  const uint64_t runtime_version = loader_.snapshot().version();
+  {
+    std::unique_lock<std::mutex> lock(weighted_cluster_table_lock_);
+    if (weighted_cluster_table_ && weighted_cluster_table_->runtime_version_ == runtime_version) {
+      return weighted_cluster_table_;
+    }
+  }
+
+  std::shared_ptr<WeightedClusterTable> table(new WeightedClusterTable());
+  table->runtime_version_ = runtime_version;
+  table->clusters_.assign(WeightedClusterEntry::MAX_CLUSTER_WEIGHT, NO_WEIGHTED_CLUSTER);
 
-  // Find the right cluster to route to based on the interval in which
-  // the selected value falls.  The intervals are determined as
+  // Each cluster takes the values in its interval. The intervals are determined as
   // [0, cluster1_weight), [cluster1_weight, cluster1_weight+cluster2_weight),..
-  for (const WeightedClusterEntrySharedPtr& cluster : weighted_clusters_) {
-    end = begin + cluster->clusterWeight();
-    if (((selected_value >= begin) && (selected_value < end)) ||
-        (end >= WeightedClusterEntry::MAX_CLUSTER_WEIGHT)) {
+  uint64_t begin = 0UL;
+  for (uint32_t i = 0; i < weighted_clusters_.size(); i++) {
+    uint64_t end = begin + weighted_clusters_[i]->clusterWeight();
+    if (end >= WeightedClusterEntry::MAX_CLUSTER_WEIGHT) {
       // end > WeightedClusterEntry::MAX_CLUSTER_WEIGHT : This case can only occur
       // with Runtimes, when the user specifies invalid weights such that
       // sum(weights) > WeightedClusterEntry::MAX_CLUSTER_WEIGHT.
-      // In this case, terminate the search and just return the cluster
-      // whose weight cased the overflow
-      return cluster;
+      // In this case, the cluster whose weight caused the overflow takes all the remaining values.
+      end = WeightedClusterEntry::MAX_CLUSTER_WEIGHT;
     }
+    std::fill(table->clusters_.begin() + begin, table->clusters_.begin() + end, i);
     begin = end;
+    if (begin == WeightedClusterEntry::MAX_CLUSTER_WEIGHT) {
+      break;
+    }
   }
-  NOT_REACHED;
+
+  if (vhost_.stats()) {
+    vhost_.stats()->weighted_cluster_table_rebuilt_.inc();
+  }
+
+  std::unique_lock<std::mutex> lock(weighted_cluster_table_lock_);
+  weighted_cluster_table_ = table;
+  return table;
 }
 
 void RouteEntryImplBase::validateClusters(Upstream::ClusterManager& cm) const {
@@ -327,8 +383,8 @@ void RouteEntryImplBase::validateClusters(Upstream::ClusterManager& cm) const {
 
 PrefixRouteEntryImpl::PrefixRouteEntryImpl(const VirtualHostImpl& vhost,
                                            const envoy::api::v2::Route& route,
-                                           Runtime::Loader& loader)
-    : RouteEntryImplBase(vhost, route, loader), prefix_(route.match().prefix()) {}
+                                           Runtime::Loader& loader, Upstream::ClusterManager& cm)
+    : RouteEntryImplBase(vhost, route, loader, cm), prefix_(route.match().prefix()) {}
 
 void PrefixRouteEntryImpl::finalizeRequestHeaders(Http::HeaderMap& headers) const {
   RouteEntryImplBase::finalizeRequestHeaders(headers);
@@ -346,8 +402,9 @@ RouteConstSharedPtr PrefixRouteEntryImpl::matches(const Http::HeaderMap& headers
 }
 
 PathRouteEntryImpl::PathRouteEntryImpl(const VirtualHostImpl& vhost,
-                                       const envoy::api::v2::Route& route, Runtime::Loader& loader)
-    : RouteEntryImplBase(vhost, route, loader), path_(route.match().path()) {}
+                                       const envoy::api::v2::Route& route, Runtime::Loader& loader,
+                                       Upstream::ClusterManager& cm)
+    : RouteEntryImplBase(vhost, route, loader, cm), path_(route.match().path()) {}
 
 void PathRouteEntryImpl::finalizeRequestHeaders(Http::HeaderMap& headers) const {
   RouteEntryImplBase::finalizeRequestHeaders(headers);
@@ -384,10 +441,12 @@ RouteConstSharedPtr PathRouteEntryImpl::matches(const Http::HeaderMap& headers,
 }
 
 VirtualHostImpl::VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host,
-                                 const ConfigImpl& global_route_config, Runtime::Loader& runtime,
+                                 HeadersToAddConstSharedPtr global_request_headers_to_add,
+                                 RouteTableStatsSharedPtr stats, Runtime::Loader& runtime,
                                  Upstream::ClusterManager& cm, bool validate_clusters)
-    : name_(virtual_host.name()), rate_limit_policy_(virtual_host.rate_limits()),
-      global_route_config_(global_route_config) {
+    : name_(virtual_host.name()), cache_id_(next_cache_id_++),
+      rate_limit_policy_(virtual_host.rate_limits()),
+      global_request_headers_to_add_(global_request_headers_to_add), stats_(stats) {
   switch (virtual_host.require_tls()) {
   case envoy::api::v2::VirtualHost::NONE:
     ssl_requirements_ = SslRequirements::NONE;
@@ -412,11 +471,13 @@ VirtualHostImpl::VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host
         route.match().path_specifier_case() == envoy::api::v2::RouteMatch::kPrefix;
     const bool has_path = route.match().path_specifier_case() == envoy::api::v2::RouteMatch::kPath;
     if (has_prefix) {
-      routes_.emplace_back(new PrefixRouteEntryImpl(*this, route, runtime));
+      route_trie_.addPrefix(route.match().prefix(), routes_.size());
+      routes_.emplace_back(new PrefixRouteEntryImpl(*this, route, runtime, cm));
     } else {
       ASSERT(has_path);
       UNREFERENCED_PARAMETER(has_path);
-      routes_.emplace_back(new PathRouteEntryImpl(*this, route, runtime));
+      route_trie_.addPath(route.match().path(), routes_.size());
+      routes_.emplace_back(new PathRouteEntryImpl(*this, route, runtime, cm));
     }
 
     if (validate_clusters) {
@@ -430,8 +491,19 @@ VirtualHostImpl::VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host
     }
   }
 
+  std::vector<std::string> virtual_cluster_patterns;
   for (const auto& virtual_cluster : virtual_host.virtual_clusters()) {
     virtual_clusters_.push_back(VirtualClusterEntry(virtual_cluster));
+    virtual_cluster_patterns.push_back(virtual_cluster.pattern());
+  }
+  if (!virtual_clusters_.empty()) {
+    virtual_cluster_patterns_.reset(new Regex::PatternSet(virtual_cluster_patterns));
+  }
+
+  // SSL redirects depend on x-forwarded-proto and x-envoy-internal.
+  cacheable_ = ssl_requirements_ == SslRequirements::NONE;
+  for (const RouteEntryImplBaseConstSharedPtr& route : routes_) {
+    cacheable_ &= route->onlyDependsOnPath();
   }
 }
 
@@ -451,8 +523,6 @@ VirtualHostImpl::VirtualClusterEntry::VirtualClusterEntry(
     method_ = envoy::api::v2::RequestMethod_Name(virtual_cluster.method());
   }
 
-  const std::string pattern = virtual_cluster.pattern();
-  pattern_ = std::regex{pattern, std::regex::optimize};
   name_ = virtual_cluster.name();
 }
 
@@ -477,11 +547,35 @@ const VirtualHostImpl* RouteMatcher::findWildcardVirtualHost(const std::string&
 }
 
 RouteMatcher::RouteMatcher(const envoy::api::v2::RouteConfiguration& route_config,
-                           const ConfigImpl& global_route_config, Runtime::Loader& runtime,
-                           Upstream::ClusterManager& cm, bool validate_clusters) {
+                           HeadersToAddConstSharedPtr global_request_headers_to_add,
+                           RouteTableStatsSharedPtr stats, Runtime::Loader& runtime,
+                           Upstream::ClusterManager& cm, bool validate_clusters,
+                           const RouteMatcher* previous)
+    : validate_clusters_(validate_clusters),
+      max_cache_entries_(runtime.snapshot().getInteger("router.route_cache_size", 0)) {
+  // A virtual host that was built without checking its clusters cannot stand in for one that
+  // has to be checked.
+  if (previous && validate_clusters_ && !previous->validate_clusters_) {
+    previous = nullptr;
+  }
+
   for (const auto& virtual_host_config : route_config.virtual_hosts()) {
-    VirtualHostSharedPtr virtual_host(new VirtualHostImpl(virtual_host_config, global_route_config,
-                                                          runtime, cm, validate_clusters));
+    // Like RDS does for whole route tables, unchanged configuration is told apart by its hash.
+    const uint64_t hash = MessageUtil::hash(virtual_host_config);
+    VirtualHostSharedPtr virtual_host;
+    if (previous) {
+      auto previous_virtual_host = previous->virtual_hosts_by_hash_.find(hash);
+      if (previous_virtual_host != previous->virtual_hosts_by_hash_.end()) {
+        virtual_host = previous_virtual_host->second;
+      }
+    }
+
+    if (!virtual_host) {
+      virtual_host.reset(new VirtualHostImpl(virtual_host_config, global_request_headers_to_add,
+                                             stats, runtime, cm, validate_clusters));
+    }
+
+    virtual_hosts_by_hash_.emplace(hash, virtual_host);
     uses_runtime_ |= virtual_host->usesRuntime();
 
     for (const std::string& domain : virtual_host_config.domains()) {
@@ -514,9 +608,13 @@ RouteConstSharedPtr VirtualHostImpl::getRouteFromEntries(const Http::HeaderMap&
     return SSL_REDIRECT_ROUTE;
   }
 
-  // Check for a route that matches the request.
-  for (const RouteEntryImplBaseConstSharedPtr& route : routes_) {
-    RouteConstSharedPtr route_entry = route->matches(headers, random_value);
+  // Check for a route that matches the request. Only the routes whose path or prefix fits the
+  // request path are checked in full, in the order they are configured in.
+  std::vector<uint32_t> candidates;
+  const Http::HeaderString& path = headers.Path()->value();
+  route_trie_.candidates(path.c_str(), path.size(), candidates);
+  for (uint32_t candidate : candidates) {
+    RouteConstSharedPtr route_entry = routes_[candidate]->matches(headers, random_value);
     if (nullptr != route_entry) {
       return route_entry;
     }
@@ -525,6 +623,29 @@ RouteConstSharedPtr VirtualHostImpl::getRouteFromEntries(const Http::HeaderMap&
   return nullptr;
 }
 
+RouteConstSharedPtr VirtualHostImpl::cachedRouteFromEntries(const Http::HeaderMap& headers,
+                                                            uint64_t random_value,
+                                                            uint64_t max_cache_entries) const {
+  if (max_cache_entries == 0 || !cacheable_) {
+    return getRouteFromEntries(headers, random_value);
+  }
+
+  const Http::HeaderString& path = headers.Path()->value();
+  std::string key;
+  key.reserve(sizeof(cache_id_) + path.size());
+  key.append(reinterpret_cast<const char*>(&cache_id_), sizeof(cache_id_));
+  key.append(path.c_str(), path.size());
+
+  RouteCache& cache = RouteCache::get();
+  RouteConstSharedPtr route;
+  if (!cache.find(key, route)) {
+    route = getRouteFromEntries(headers, random_value);
+    cache.insert(std::move(key), route, max_cache_entries);
+  }
+
+  return route;
+}
+
 const VirtualHostImpl* RouteMatcher::findVirtualHost(const Http::HeaderMap& headers) const {
   // Fast path the case where we only have a default virtual host.
   if (virtual_hosts_.empty() && default_virtual_host_) {
@@ -551,12 +672,13 @@ RouteConstSharedPtr RouteMatcher::route(const Http::HeaderMap& headers,
                                         uint64_t random_value) const {
   const VirtualHostImpl* virtual_host = findVirtualHost(headers);
   if (virtual_host) {
-    return virtual_host->getRouteFromEntries(headers, random_value);
+    return virtual_host->cachedRouteFromEntries(headers, random_value, max_cache_entries_);
   } else {
     return nullptr;
   }
 }
 
+std::atomic<uint64_t> VirtualHostImpl::next_cache_id_;
 const VirtualHostImpl::CatchAllVirtualCluster VirtualHostImpl::VIRTUAL_CLUSTER_CATCH_ALL;
 const SslRedirector SslRedirectRoute::SSL_REDIRECTOR;
 const std::shared_ptr<const SslRedirectRoute> VirtualHostImpl::SSL_REDIRECT_ROUTE{
@@ -564,27 +686,54 @@ const std::shared_ptr<const SslRedirectRoute> VirtualHostImpl::SSL_REDIRECT_ROUT
 
 const VirtualCluster*
 VirtualHostImpl::virtualClusterFromEntries(const Http::HeaderMap& headers) const {
-  for (const VirtualClusterEntry& entry : virtual_clusters_) {
-    bool method_matches =
-        !entry.method_.valid() || headers.Method()->value().c_str() == entry.method_.value();
-
-    if (method_matches && std::regex_match(headers.Path()->value().c_str(), entry.pattern_)) {
-      return &entry;
-    }
+  if (virtual_clusters_.empty()) {
+    return nullptr;
   }
 
-  if (virtual_clusters_.size() > 0) {
-    return &VIRTUAL_CLUSTER_CATCH_ALL;
+  // All the patterns are matched in one pass. The first matching entry whose method also matches
+  // wins, as if the entries were tried in order.
+  std::vector<int> matches;
+  const Http::HeaderString& path = headers.Path()->value();
+  if (virtual_cluster_patterns_->fullMatch(path.c_str(), path.size(), matches)) {
+    for (int index : matches) {
+      const VirtualClusterEntry& entry = virtual_clusters_[index];
+      if (!entry.method_.valid() || headers.Method()->value().c_str() == entry.method_.value()) {
+        return &entry;
+      }
+    }
   }
 
-  return nullptr;
+  return &VIRTUAL_CLUSTER_CATCH_ALL;
 }
 
 ConfigImpl::ConfigImpl(const envoy::api::v2::RouteConfiguration& config, Runtime::Loader& runtime,
-                       Upstream::ClusterManager& cm, bool validate_clusters_default) {
+                       Upstream::ClusterManager& cm, bool validate_clusters_default,
+                       const ConfigImpl* previous, Stats::Scope* scope)
+    : memory_charge_(Memory::Owner::RouteConfigs, sizeof(ConfigImpl) + config.ByteSize()) {
+  if (scope) {
+    stats_.reset(new RouteTableStats{ALL_ROUTE_TABLE_STATS(POOL_COUNTER(*scope))});
+  }
+
+  HeadersToAdd request_headers_to_add;
+  for (const auto& header_value_option : config.request_headers_to_add()) {
+    request_headers_to_add.push_back({Http::LowerCaseString(header_value_option.header().key()),
+                                      header_value_option.header().value()});
+  }
+
+  // Virtual hosts hold on to the request headers of the route table, so they can only be carried
+  // over if those have not changed.
+  const RouteMatcher* previous_route_matcher = nullptr;
+  if (previous && *previous->request_headers_to_add_ == request_headers_to_add) {
+    request_headers_to_add_ = previous->request_headers_to_add_;
+    previous_route_matcher = previous->route_matcher_.get();
+  } else {
+    request_headers_to_add_ = std::make_shared<HeadersToAdd>(std::move(request_headers_to_add));
+  }
+
   route_matcher_.reset(new RouteMatcher(
-      config, *this, runtime, cm,
-      PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, validate_clusters, validate_clusters_default)));
+      config, request_headers_to_add_, stats_, runtime, cm,
+      PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, validate_clusters, validate_clusters_default),
+      previous_route_matcher));
 
   for (const std::string& header : config.internal_only_headers()) {
     internal_only_headers_.push_back(Http::LowerCaseString(header));
@@ -598,11 +747,6 @@ ConfigImpl::ConfigImpl(const envoy::api::v2::RouteConfiguration& config, Runtime
   for (const std::string& header : config.response_headers_to_remove()) {
     response_headers_to_remove_.push_back(Http::LowerCaseString(header));
   }
-
-  for (const auto& header_value_option : config.request_headers_to_add()) {
-    request_headers_to_add_.push_back({Http::LowerCaseString(header_value_option.header().key()),
-                                       header_value_option.header().value()});
-  }
 }
 
 } // namespace Router
@@ -1,11 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
-#include <regex>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -13,10 +14,17 @@
 #include "envoy/common/optional.h"
 #include "envoy/router/router.h"
 #include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/upstream/cluster_manager.h"
 
+#include "common/common/regex.h"
+#include "common/memory/accounting.h"
 #include "common/router/config_utility.h"
+#include "common/router/route_cache.h"
+#include "common/router/route_trie.h"
 #include "common/router/router_ratelimit.h"
+#include "common/runtime/key_registry.h"
 
 #include "api/rds.pb.h"
 
@@ -63,24 +71,62 @@ private:
   static const SslRedirector SSL_REDIRECTOR;
 };
 
-class ConfigImpl;
 /**
- * Holds all routing configuration for an entire virtual host.
+ * Headers to add, as name and value pairs.
+ */
+typedef std::list<std::pair<Http::LowerCaseString, std::string>> HeadersToAdd;
+typedef std::shared_ptr<const HeadersToAdd> HeadersToAddConstSharedPtr;
+
+/**
+ * All route table stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_ROUTE_TABLE_STATS(COUNTER)                                                             \
+  COUNTER(weighted_cluster_table_rebuilt)
+// clang-format on
+
+/**
+ * Struct definition for all route table stats. @see stats_macros.h
+ */
+struct RouteTableStats {
+  ALL_ROUTE_TABLE_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+typedef std::shared_ptr<RouteTableStats> RouteTableStatsSharedPtr;
+
+/**
+ * Holds all routing configuration for an entire virtual host. A virtual host does not refer back
+ * to the route table it was built for, so that it can be carried over into the next one.
  */
 class VirtualHostImpl : public VirtualHost {
 public:
   VirtualHostImpl(const envoy::api::v2::VirtualHost& virtual_host,
-                  const ConfigImpl& global_route_config, Runtime::Loader& runtime,
+                  HeadersToAddConstSharedPtr global_request_headers_to_add,
+                  RouteTableStatsSharedPtr stats, Runtime::Loader& runtime,
                   Upstream::ClusterManager& cm, bool validate_clusters);
 
   RouteConstSharedPtr getRouteFromEntries(const Http::HeaderMap& headers,
                                           uint64_t random_value) const;
+
+  /**
+   * Like getRouteFromEntries(), but goes through the route cache of the calling thread if the
+   * outcome only depends on the request path.
+   * @param max_cache_entries supplies the size of the cache. 0 disables it.
+   */
+  RouteConstSharedPtr cachedRouteFromEntries(const Http::HeaderMap& headers,
+                                             uint64_t random_value,
+                                             uint64_t max_cache_entries) const;
   bool usesRuntime() const;
   const VirtualCluster* virtualClusterFromEntries(const Http::HeaderMap& headers) const;
   const std::list<std::pair<Http::LowerCaseString, std::string>>& requestHeadersToAdd() const {
     return request_headers_to_add_;
   }
-  const ConfigImpl& globalRouteConfig() const { return global_route_config_; }
+  const HeadersToAdd& globalRequestHeadersToAdd() const { return *global_request_headers_to_add_; }
+
+  /**
+   * @return RouteTableStats* the stats of the route table, or nullptr if it has none.
+   */
+  RouteTableStats* stats() const { return stats_.get(); }
 
   // Router::VirtualHost
   const std::string& name() const override { return name_; }
@@ -95,7 +141,6 @@ private:
     // Router::VirtualCluster
     const std::string& name() const override { return name_; }
 
-    std::regex pattern_;
     Optional<std::string> method_;
     std::string name_;
   };
@@ -107,16 +152,27 @@ private:
     std::string name_{"other"};
   };
 
+  static std::atomic<uint64_t> next_cache_id_;
   static const CatchAllVirtualCluster VIRTUAL_CLUSTER_CATCH_ALL;
   static const std::shared_ptr<const SslRedirectRoute> SSL_REDIRECT_ROUTE;
 
   const std::string name_;
   std::vector<RouteEntryImplBaseConstSharedPtr> routes_;
+  // Indexes routes_ by path and prefix.
+  RouteTrie route_trie_;
   std::vector<VirtualClusterEntry> virtual_clusters_;
+  // The patterns of virtual_clusters_, in the same order. Only set if there are virtual clusters.
+  Regex::PatternSetConstPtr virtual_cluster_patterns_;
   SslRequirements ssl_requirements_;
+  // Set if the route only depends on the request path, so that lookups can be cached.
+  bool cacheable_{};
+  // Tells apart the cache entries of this virtual host from those of any other one, including
+  // ones that have come and gone.
+  const uint64_t cache_id_;
   const RateLimitPolicyImpl rate_limit_policy_;
-  const ConfigImpl& global_route_config_; // See note in RouteEntryImplBase::clusterEntry() on why
-                                          // raw ref to the top level config is currently safe.
+  // The request headers to add from the route table.
+  const HeadersToAddConstSharedPtr global_request_headers_to_add_;
+  const RouteTableStatsSharedPtr stats_;
   std::list<std::pair<Http::LowerCaseString, std::string>> request_headers_to_add_;
 };
 
@@ -182,11 +238,17 @@ class RouteEntryImplBase : public RouteEntry,
                            public std::enable_shared_from_this<RouteEntryImplBase> {
 public:
   RouteEntryImplBase(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                     Runtime::Loader& loader);
+                     Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   bool isRedirect() const { return !host_redirect_.empty() || !path_redirect_.empty(); }
   bool usesRuntime() const { return runtime_.valid(); }
 
+  /**
+   * @return bool whether the route matches, and what it resolves to, depends on nothing
+   *         but the request path.
+   */
+  bool onlyDependsOnPath() const;
+
   bool matchRoute(const Http::HeaderMap& headers, uint64_t random_value) const;
   void validateClusters(Upstream::ClusterManager& cm) const;
   const std::list<std::pair<Http::LowerCaseString, std::string>>& requestHeadersToAdd() const {
@@ -195,6 +257,7 @@ public:
 
   // Router::RouteEntry
   const std::string& clusterName() const override;
+  const Optional<uint32_t>& clusterId() const override { return cluster_id_; }
   void finalizeRequestHeaders(Http::HeaderMap& headers) const override;
   const HashPolicy* hashPolicy() const override { return hash_policy_.get(); }
   Upstream::ResourcePriority priority() const override { return priority_; }
@@ -211,6 +274,9 @@ public:
   const std::multimap<std::string, std::string>& opaqueConfig() const override {
     return opaque_config_;
   }
+  const Upstream::MetadataMatchCriteria* metadataMatchCriteria() const override {
+    return metadata_match_criteria_.empty() ? nullptr : &metadata_match_criteria_;
+  }
   bool includeVirtualHostRateLimits() const override { return include_vh_rate_limits_; }
 
   // Router::RedirectEntry
@@ -231,17 +297,19 @@ protected:
 
 private:
   struct RuntimeData {
-    std::string key_;
+    Runtime::Key key_;
     uint64_t default_;
   };
 
   class DynamicRouteEntry : public RouteEntry, public Route {
   public:
-    DynamicRouteEntry(const RouteEntryImplBase* parent, const std::string& name)
-        : parent_(parent), cluster_name_(name) {}
+    DynamicRouteEntry(const RouteEntryImplBase* parent, const std::string& name,
+                      const Optional<uint32_t>& cluster_id)
+        : parent_(parent), cluster_name_(name), cluster_id_(cluster_id) {}
 
     // Router::RouteEntry
     const std::string& clusterName() const override { return cluster_name_; }
+    const Optional<uint32_t>& clusterId() const override { return cluster_id_; }
 
     void finalizeRequestHeaders(Http::HeaderMap& headers) const override {
       return parent_->finalizeRequestHeaders(headers);
@@ -262,6 +330,10 @@ private:
       return parent_->opaqueConfig();
     }
 
+    const Upstream::MetadataMatchCriteria* metadataMatchCriteria() const override {
+      return parent_->metadataMatchCriteria();
+    }
+
     const VirtualHost& virtualHost() const override { return parent_->virtualHost(); }
     bool autoHostRewrite() const override { return parent_->autoHostRewrite(); }
     bool useWebSocket() const override { return parent_->useWebSocket(); }
@@ -276,6 +348,7 @@ private:
   private:
     const RouteEntryImplBase* parent_;
     const std::string cluster_name_;
+    const Optional<uint32_t> cluster_id_;
   };
 
   /**
@@ -287,8 +360,10 @@ private:
   class WeightedClusterEntry : public DynamicRouteEntry {
   public:
     WeightedClusterEntry(const RouteEntryImplBase* parent, const std::string runtime_key,
-                         Runtime::Loader& loader, const std::string& name, uint64_t weight)
-        : DynamicRouteEntry(parent, name), runtime_key_(runtime_key), loader_(loader),
+                         Runtime::Loader& loader, const std::string& name, uint32_t cluster_id,
+                         uint64_t weight)
+        : DynamicRouteEntry(parent, name, cluster_id),
+          runtime_key_(Runtime::KeyRegistry::key(runtime_key)), loader_(loader),
           cluster_weight_(weight) {}
 
     uint64_t clusterWeight() const {
@@ -298,26 +373,50 @@ private:
     static const uint64_t MAX_CLUSTER_WEIGHT;
 
   private:
-    const std::string runtime_key_;
+    const Runtime::Key runtime_key_;
     Runtime::Loader& loader_;
     const uint64_t cluster_weight_;
   };
 
   typedef std::shared_ptr<WeightedClusterEntry> WeightedClusterEntrySharedPtr;
 
+  /**
+   * The weighted cluster picked for every value of random_value % MAX_CLUSTER_WEIGHT, for the
+   * runtime snapshot with the given version.
+   */
+  struct WeightedClusterTable {
+    uint64_t runtime_version_;
+    // Indexes weighted_clusters_, or NO_WEIGHTED_CLUSTER where the weights do not add up.
+    std::vector<uint32_t> clusters_;
+  };
+
+  typedef std::shared_ptr<const WeightedClusterTable> WeightedClusterTableConstSharedPtr;
+
+  /**
+   * @return WeightedClusterTableConstSharedPtr the weighted cluster table for the current runtime
+   *         snapshot, built anew only if the snapshot has changed since the last call.
+   */
+  WeightedClusterTableConstSharedPtr weightedClusterTable() const;
+
   static Optional<RuntimeData> loadRuntimeData(const envoy::api::v2::RouteMatch& route);
 
   static std::multimap<std::string, std::string>
   parseOpaqueConfig(const envoy::api::v2::Route& route);
 
+  static Upstream::MetadataMatchCriteria
+  parseMetadataMatchCriteria(const envoy::api::v2::Route& route);
+
   // Default timeout is 15s if nothing is specified in the route config.
   static const uint64_t DEFAULT_ROUTE_TIMEOUT_MS = 15000;
+  static const uint32_t NO_WEIGHTED_CLUSTER = UINT32_MAX;
 
   const VirtualHostImpl& vhost_; // See note in RouteEntryImplBase::clusterEntry() on why raw ref
                                  // to virtual host is currently safe.
   const bool auto_host_rewrite_;
   const bool use_websocket_;
   const std::string cluster_name_;
+  // Only set if the route names a single cluster.
+  Optional<uint32_t> cluster_id_;
   const Http::LowerCaseString cluster_header_name_;
   const std::chrono::milliseconds timeout_;
   const Optional<RuntimeData> runtime_;
@@ -330,11 +429,15 @@ private:
   const Upstream::ResourcePriority priority_;
   std::vector<ConfigUtility::HeaderData> config_headers_;
   std::vector<WeightedClusterEntrySharedPtr> weighted_clusters_;
+  // Workers share the table, the lock only guards swapping it.
+  mutable std::mutex weighted_cluster_table_lock_;
+  mutable WeightedClusterTableConstSharedPtr weighted_cluster_table_;
   std::unique_ptr<const HashPolicyImpl> hash_policy_;
   std::list<std::pair<Http::LowerCaseString, std::string>> request_headers_to_add_;
 
   // TODO(danielhochman): refactor multimap into unordered_map since JSON is unordered map.
   const std::multimap<std::string, std::string> opaque_config_;
+  const Upstream::MetadataMatchCriteria metadata_match_criteria_;
 };
 
 /**
@@ -343,7 +446,7 @@ private:
 class PrefixRouteEntryImpl : public RouteEntryImplBase {
 public:
   PrefixRouteEntryImpl(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                       Runtime::Loader& loader);
+                       Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   // Router::RouteEntry
   void finalizeRequestHeaders(Http::HeaderMap& headers) const override;
@@ -361,7 +464,7 @@ private:
 class PathRouteEntryImpl : public RouteEntryImplBase {
 public:
   PathRouteEntryImpl(const VirtualHostImpl& vhost, const envoy::api::v2::Route& route,
-                     Runtime::Loader& loader);
+                     Runtime::Loader& loader, Upstream::ClusterManager& cm);
 
   // Router::RouteEntry
   void finalizeRequestHeaders(Http::HeaderMap& headers) const override;
@@ -379,9 +482,15 @@ private:
  */
 class RouteMatcher {
 public:
+  /**
+   * @param previous supplies the route matcher of the previous version of the route table if its
+   *        virtual hosts may be carried over, or nullptr. Virtual hosts whose configuration has
+   *        not changed are shared with it rather than rebuilt.
+   */
   RouteMatcher(const envoy::api::v2::RouteConfiguration& config,
-               const ConfigImpl& global_http_config, Runtime::Loader& runtime,
-               Upstream::ClusterManager& cm, bool validate_clusters);
+               HeadersToAddConstSharedPtr global_request_headers_to_add,
+               RouteTableStatsSharedPtr stats, Runtime::Loader& runtime,
+               Upstream::ClusterManager& cm, bool validate_clusters, const RouteMatcher* previous);
 
   RouteConstSharedPtr route(const Http::HeaderMap& headers, uint64_t random_value) const;
   bool usesRuntime() const { return uses_runtime_; }
@@ -403,7 +512,12 @@ private:
   std::map<int64_t, std::unordered_map<std::string, VirtualHostSharedPtr>, std::greater<int64_t>>
       wildcard_virtual_host_suffixes_;
   VirtualHostSharedPtr default_virtual_host_;
+  // All virtual hosts by the hash of their configuration.
+  std::unordered_map<uint64_t, VirtualHostSharedPtr> virtual_hosts_by_hash_;
+  const bool validate_clusters_;
   bool uses_runtime_{};
+  // The size of the per thread route cache, from runtime when the route table is built.
+  const uint64_t max_cache_entries_;
 };
 
 /**
@@ -411,12 +525,16 @@ private:
  */
 class ConfigImpl : public Config {
 public:
+  /**
+   * @param previous supplies the previous version of the route table, or nullptr. Virtual hosts
+   *        that have not changed since are carried over from it.
+   * @param scope supplies the scope to keep the route table stats in, or nullptr for none.
+   */
   ConfigImpl(const envoy::api::v2::RouteConfiguration& config, Runtime::Loader& runtime,
-             Upstream::ClusterManager& cm, bool validate_clusters_default);
+             Upstream::ClusterManager& cm, bool validate_clusters_default,
+             const ConfigImpl* previous = nullptr, Stats::Scope* scope = nullptr);
 
-  const std::list<std::pair<Http::LowerCaseString, std::string>>& requestHeadersToAdd() const {
-    return request_headers_to_add_;
-  }
+  const HeadersToAdd& requestHeadersToAdd() const { return *request_headers_to_add_; }
 
   // Router::Config
   RouteConstSharedPtr route(const Http::HeaderMap& headers, uint64_t random_value) const override {
@@ -443,7 +561,10 @@ private:
   std::list<Http::LowerCaseString> internal_only_headers_;
   std::list<std::pair<Http::LowerCaseString, std::string>> response_headers_to_add_;
   std::list<Http::LowerCaseString> response_headers_to_remove_;
-  std::list<std::pair<Http::LowerCaseString, std::string>> request_headers_to_add_;
+  HeadersToAddConstSharedPtr request_headers_to_add_;
+  RouteTableStatsSharedPtr stats_;
+  // Estimated from the size of the route configuration.
+  const Memory::Charge memory_charge_;
 };
 
 /**
@@ -102,14 +102,19 @@ void RdsRouteConfigProviderImpl::onConfigUpdate(const ResourceVector& resources)
   }
   const uint64_t new_hash = MessageUtil::hash(route_config);
   if (new_hash != last_config_hash_ || !initialized_) {
-    ConfigConstSharedPtr new_config(new ConfigImpl(route_config, runtime_, cm_, false));
+    std::shared_ptr<const ConfigImpl> new_config(
+        new ConfigImpl(route_config, runtime_, cm_, false, last_config_.get(), scope_.get()));
+    last_config_ = new_config;
     initialized_ = true;
     last_config_hash_ = new_hash;
     stats_.config_reload_.inc();
     ENVOY_LOG(debug, "rds: loading new configuration: config_name={} hash={}", route_config_name_,
               new_hash);
-    tls_->runOnAllThreads(
-        [this, new_config]() -> void { tls_->getTyped<ThreadLocalConfig>().config_ = new_config; });
+    tls_->update(
+        [new_config](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+          return std::make_shared<ThreadLocalConfig>(new_config);
+        },
+        nullptr);
     route_config_proto_ = route_config;
   }
   runInitializeCallbackIfAny();
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -24,6 +25,8 @@
 namespace Envoy {
 namespace Router {
 
+class ConfigImpl;
+
 /**
  * Route configuration provider utilities.
  */
@@ -89,6 +92,7 @@ public:
     initialize_callback_ = callback;
     subscription_->start({route_config_name_}, *this);
   }
+  std::string name() const override { return "rds." + route_config_name_; }
 
   // Router::RouteConfigProvider
   Router::ConfigConstSharedPtr config() override;
@@ -129,6 +133,9 @@ private:
   const std::string route_config_name_;
   bool initialized_{};
   uint64_t last_config_hash_{};
+  // The most recently loaded route table, which the next one carries unchanged virtual hosts
+  // over from. Only used on the main thread.
+  std::shared_ptr<const ConfigImpl> last_config_;
   Stats::ScopePtr scope_;
   RdsStats stats_;
   std::function<void()> initialize_callback_;
@@ -16,7 +16,8 @@ RdsSubscription::RdsSubscription(Envoy::Config::SubscriptionStats stats,
                                  const LocalInfo::LocalInfo& local_info)
     : RestApiFetcher(
           cm, rds.config_source().api_config_source().cluster_name()[0], dispatcher, random,
-          Config::Utility::apiConfigSourceRefreshDelay(rds.config_source().api_config_source())),
+          Config::Utility::apiConfigSourceRefreshDelay(rds.config_source().api_config_source()),
+          "rds"),
       local_info_(local_info), stats_(stats) {
   const auto& api_config_source = rds.config_source().api_config_source();
   UNREFERENCED_PARAMETER(api_config_source);
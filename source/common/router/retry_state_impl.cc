@@ -1,5 +1,6 @@
 #include "common/router/retry_state_impl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <string>
@@ -52,10 +53,10 @@ RetryStateImpl::RetryStateImpl(const RetryPolicy& route_policy, Http::HeaderMap&
       priority_(priority) {
 
   if (request_headers.EnvoyRetryOn()) {
-    retry_on_ = parseRetryOn(request_headers.EnvoyRetryOn()->value().c_str());
+    retry_on_ = parseRetryOn(request_headers.EnvoyRetryOn()->value().getStringView());
   }
   if (request_headers.EnvoyRetryGrpcOn()) {
-    retry_on_ |= parseRetryGrpcOn(request_headers.EnvoyRetryGrpcOn()->value().c_str());
+    retry_on_ |= parseRetryGrpcOn(request_headers.EnvoyRetryGrpcOn()->value().getStringView());
   }
   if (retry_on_ != 0 && request_headers.EnvoyMaxRetries()) {
     const char* max_retries = request_headers.EnvoyMaxRetries()->value().c_str();
@@ -72,12 +73,20 @@ RetryStateImpl::RetryStateImpl(const RetryPolicy& route_policy, Http::HeaderMap&
 
 RetryStateImpl::~RetryStateImpl() { resetRetry(); }
 
-void RetryStateImpl::enableBackoffTimer() {
-  // We use a fully jittered exponential backoff algorithm.
-  current_retry_++;
-  uint32_t multiplier = (1 << current_retry_) - 1;
-  uint64_t base = runtime_.snapshot().getInteger("upstream.base_retry_backoff_ms", 25);
-  uint64_t timeout = random_.random() % (base * multiplier);
+void RetryStateImpl::enableBackoffTimer(const Optional<uint64_t>& backoff_hint_ms) {
+  uint64_t timeout;
+  if (backoff_hint_ms.valid()) {
+    timeout = backoff_hint_ms.value();
+  } else {
+    // We use a decorrelated jitter backoff algorithm: each back off is picked at random between the
+    // base and three times the previous back off (or the base for the first one), and capped at the
+    // max. Unlike fully jittered backoff, retries that started at the same time drift apart rather
+    // than staying in step.
+    const uint64_t base = baseBackoffMs();
+    const uint64_t upper = std::min(maxBackoffMs(), std::max(base, last_backoff_ms_) * 3);
+    timeout = base + random_.random() % (upper - base + 1);
+  }
+  last_backoff_ms_ = timeout;
 
   if (!retry_timer_) {
     retry_timer_ = dispatcher_.createTimer([this]() -> void { callback_(); });
@@ -86,10 +95,49 @@ void RetryStateImpl::enableBackoffTimer() {
   retry_timer_->enableTimer(std::chrono::milliseconds(timeout));
 }
 
-uint32_t RetryStateImpl::parseRetryOn(const std::string& config) {
+bool RetryStateImpl::parseBackoffHint(const Http::HeaderMap* response_headers,
+                                      Optional<uint64_t>& hint_ms) {
+  if (!response_headers) {
+    return true;
+  }
+
+  // Per the gRPC retry design, a pushback that is not a non-negative number of milliseconds means
+  // the server does not want the request retried. A negative pushback wraps around in atoul() and
+  // is turned down by the max back off check below.
+  uint64_t value;
+  const Http::HeaderEntry* pushback =
+      response_headers->get(Http::Headers::get().GrpcRetryPushbackMs);
+  if (pushback) {
+    if (!StringUtil::atoul(pushback->value().c_str(), value)) {
+      return false;
+    }
+    hint_ms.value(value);
+  } else {
+    // Only the delay seconds form of retry-after is honored. An HTTP date is ignored. The delay is
+    // clamped to just over the max back off before it is converted, so that a huge one is turned
+    // down below rather than wrapping around to a short wait.
+    const Http::HeaderEntry* retry_after = response_headers->get(Http::Headers::get().RetryAfter);
+    if (retry_after && StringUtil::atoul(retry_after->value().c_str(), value)) {
+      hint_ms.value(std::min(value, maxBackoffMs() / 1000 + 1) * 1000);
+    }
+  }
+
+  // A server asking for a longer wait than we are willing to back off is not retried at all.
+  return !hint_ms.valid() || hint_ms.value() <= maxBackoffMs();
+}
+
+uint64_t RetryStateImpl::baseBackoffMs() {
+  return runtime_.snapshot().getInteger("upstream.base_retry_backoff_ms", 25);
+}
+
+uint64_t RetryStateImpl::maxBackoffMs() {
+  const uint64_t base = baseBackoffMs();
+  return std::max(base, runtime_.snapshot().getInteger("upstream.max_retry_backoff_ms", base * 10));
+}
+
+uint32_t RetryStateImpl::parseRetryOn(StringView config) {
   uint32_t ret = 0;
-  std::vector<std::string> retry_on_list = StringUtil::split(config, ',');
-  for (const std::string& retry_on : retry_on_list) {
+  for (const StringView retry_on : StringUtil::splitToViews(config, ',')) {
     if (retry_on == Http::Headers::get().EnvoyRetryOnValues._5xx) {
       ret |= RetryPolicy::RETRY_ON_5XX;
     } else if (retry_on == Http::Headers::get().EnvoyRetryOnValues.ConnectFailure) {
@@ -104,10 +152,9 @@ uint32_t RetryStateImpl::parseRetryOn(const std::string& config) {
   return ret;
 }
 
-uint32_t RetryStateImpl::parseRetryGrpcOn(const std::string& retry_grpc_on_header) {
+uint32_t RetryStateImpl::parseRetryGrpcOn(StringView retry_grpc_on_header) {
   uint32_t ret = 0;
-  std::vector<std::string> retry_on_list = StringUtil::split(retry_grpc_on_header, ',');
-  for (const std::string& retry_on : retry_on_list) {
+  for (const StringView retry_on : StringUtil::splitToViews(retry_grpc_on_header, ',')) {
     if (retry_on == Http::Headers::get().EnvoyRetryOnGrpcValues.Cancelled) {
       ret |= RetryPolicy::RETRY_ON_GRPC_CANCELLED;
     } else if (retry_on == Http::Headers::get().EnvoyRetryOnGrpcValues.DeadlineExceeded) {
@@ -151,6 +198,12 @@ bool RetryStateImpl::shouldRetry(const Http::HeaderMap* response_headers,
     return false;
   }
 
+  Optional<uint64_t> backoff_hint_ms;
+  if (!parseBackoffHint(response_headers, backoff_hint_ms)) {
+    cluster_.stats().upstream_rq_retry_pushback_.inc();
+    return false;
+  }
+
   if (!cluster_.resourceManager(priority_).retries().canCreate()) {
     cluster_.stats().upstream_rq_retry_overflow_.inc();
     return false;
@@ -160,7 +213,7 @@ bool RetryStateImpl::shouldRetry(const Http::HeaderMap* response_headers,
   callback_ = callback;
   cluster_.resourceManager(priority_).retries().inc();
   cluster_.stats().upstream_rq_retry_.inc();
-  enableBackoffTimer();
+  enableBackoffTimer(backoff_hint_ms);
   return true;
 }
 
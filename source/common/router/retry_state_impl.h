@@ -11,6 +11,8 @@
 #include "envoy/runtime/runtime.h"
 #include "envoy/upstream/upstream.h"
 
+#include "common/common/string_view.h"
+
 namespace Envoy {
 namespace Router {
 
@@ -25,10 +27,10 @@ public:
                               Upstream::ResourcePriority priority);
   ~RetryStateImpl();
 
-  static uint32_t parseRetryOn(const std::string& config);
+  static uint32_t parseRetryOn(StringView config);
 
   // Returns the RetryPolicy extracted from the x-envoy-retry-grpc-on header.
-  static uint32_t parseRetryGrpcOn(const std::string& retry_grpc_on_header);
+  static uint32_t parseRetryGrpcOn(StringView retry_grpc_on_header);
 
   // Router::RetryState
   bool enabled() override { return retry_on_ != 0; }
@@ -42,7 +44,10 @@ private:
                  Runtime::RandomGenerator& random, Event::Dispatcher& dispatcher,
                  Upstream::ResourcePriority priority);
 
-  void enableBackoffTimer();
+  void enableBackoffTimer(const Optional<uint64_t>& backoff_hint_ms);
+  uint64_t baseBackoffMs();
+  uint64_t maxBackoffMs();
+  bool parseBackoffHint(const Http::HeaderMap* response_headers, Optional<uint64_t>& hint_ms);
   void resetRetry();
   bool wouldRetry(const Http::HeaderMap* response_headers,
                   const Optional<Http::StreamResetReason>& reset_reason);
@@ -53,7 +58,7 @@ private:
   Event::Dispatcher& dispatcher_;
   uint32_t retry_on_{};
   uint32_t retries_remaining_{1};
-  uint32_t current_retry_{};
+  uint64_t last_backoff_ms_{};
   DoRetryCallback callback_;
   Event::TimerPtr retry_timer_;
   Upstream::ResourcePriority priority_;
@@ -0,0 +1,52 @@
+#include "common/router/route_cache.h"
+
+#include <cstdint>
+#include <string>
+
+namespace Envoy {
+namespace Router {
+
+RouteCache& RouteCache::get() {
+  static thread_local RouteCache cache;
+  return cache;
+}
+
+bool RouteCache::find(const std::string& key, RouteConstSharedPtr& route) {
+  auto entry = index_.find(key);
+  if (entry == index_.end()) {
+    return false;
+  }
+
+  entries_.splice(entries_.begin(), entries_, entry->second);
+  route = entry->second->second;
+  return true;
+}
+
+void RouteCache::insert(std::string&& key, RouteConstSharedPtr route, uint64_t max_entries) {
+  if (max_entries == 0) {
+    return;
+  }
+
+  auto entry = index_.find(key);
+  if (entry != index_.end()) {
+    entry->second->second = route;
+    entries_.splice(entries_.begin(), entries_, entry->second);
+    return;
+  }
+
+  while (entries_.size() >= max_entries) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+
+  entries_.emplace_front(std::move(key), route);
+  index_.emplace(entries_.front().first, entries_.begin());
+}
+
+void RouteCache::clear() {
+  index_.clear();
+  entries_.clear();
+}
+
+} // namespace Router
+} // namespace Envoy
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "envoy/router/router.h"
+
+namespace Envoy {
+namespace Router {
+
+/**
+ * A bounded least recently used cache of route lookups. There is one per thread, shared by all
+ * route tables, so that it can be used without locking. Keys must tell apart the route tables
+ * as well as the requests, see VirtualHostImpl.
+ */
+class RouteCache {
+public:
+  /**
+   * @return RouteCache& the cache of the calling thread.
+   */
+  static RouteCache& get();
+
+  /**
+   * Look up a route.
+   * @param key supplies the key.
+   * @param route receives the route if there is one. It may be nullptr if the lookup found that
+   *        no route matches.
+   * @return bool whether the key was found.
+   */
+  bool find(const std::string& key, RouteConstSharedPtr& route);
+
+  /**
+   * Add a route, evicting the least recently used entries as needed.
+   * @param key supplies the key.
+   * @param route supplies the route, which may be nullptr.
+   * @param max_entries supplies the number of entries to keep at most.
+   */
+  void insert(std::string&& key, RouteConstSharedPtr route, uint64_t max_entries);
+
+  /**
+   * @return uint64_t the number of entries in the cache.
+   */
+  uint64_t size() const { return entries_.size(); }
+
+  void clear();
+
+private:
+  typedef std::list<std::pair<std::string, RouteConstSharedPtr>> EntryList;
+
+  // Most recently used first.
+  EntryList entries_;
+  std::unordered_map<std::string, EntryList::iterator> index_;
+};
+
+} // namespace Router
+} // namespace Envoy
@@ -0,0 +1,116 @@
+#include "common/router/route_trie.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Router {
+
+RouteTrie::RouteTrie() : root_(new Node()) {}
+
+void RouteTrie::addPrefix(const std::string& prefix, uint32_t route) {
+  Node& node = insert(prefix);
+  ASSERT(node.prefix_routes_.empty() || node.prefix_routes_.back() < route);
+  node.prefix_routes_.push_back(route);
+}
+
+void RouteTrie::addPath(const std::string& path, uint32_t route) {
+  Node& node = insert(path);
+  ASSERT(node.path_routes_.empty() || node.path_routes_.back() < route);
+  node.path_routes_.push_back(route);
+}
+
+RouteTrie::Node& RouteTrie::insert(const std::string& key) {
+  std::string lower_key(key);
+  std::transform(lower_key.begin(), lower_key.end(), lower_key.begin(), toLower);
+
+  Node* node = root_.get();
+  size_t pos = 0;
+  while (pos < lower_key.size()) {
+    auto child = std::find_if(node->children_.begin(), node->children_.end(),
+                              [&](const std::unique_ptr<Node>& child) -> bool {
+                                return child->label_[0] == lower_key[pos];
+                              });
+    if (child == node->children_.end()) {
+      std::unique_ptr<Node> leaf(new Node());
+      leaf->label_ = lower_key.substr(pos);
+      node->children_.emplace_back(std::move(leaf));
+      return *node->children_.back();
+    }
+
+    const std::string& label = (*child)->label_;
+    size_t common = 0;
+    while (common < label.size() && pos + common < lower_key.size() &&
+           label[common] == lower_key[pos + common]) {
+      common++;
+    }
+
+    if (common < label.size()) {
+      // The key leaves the edge part way along. Split the edge so that there is a node there.
+      std::unique_ptr<Node> split(new Node());
+      split->label_ = label.substr(0, common);
+      (*child)->label_ = label.substr(common);
+      split->children_.emplace_back(std::move(*child));
+      *child = std::move(split);
+    }
+
+    node = child->get();
+    pos += common;
+  }
+
+  return *node;
+}
+
+void RouteTrie::candidates(const char* path, size_t size, std::vector<uint32_t>& candidates) const {
+  const char* query_string_start = static_cast<const char*>(memchr(path, '?', size));
+  const size_t path_size = query_string_start ? query_string_start - path : size;
+
+  const Node* node = root_.get();
+  size_t pos = 0;
+  while (true) {
+    candidates.insert(candidates.end(), node->prefix_routes_.begin(), node->prefix_routes_.end());
+    if (pos == path_size) {
+      candidates.insert(candidates.end(), node->path_routes_.begin(), node->path_routes_.end());
+    }
+
+    if (pos == size) {
+      break;
+    }
+
+    const char next = toLower(path[pos]);
+    const Node* child = nullptr;
+    for (const std::unique_ptr<Node>& entry : node->children_) {
+      if (entry->label_[0] == next) {
+        child = entry.get();
+        break;
+      }
+    }
+
+    if (!child || child->label_.size() > size - pos) {
+      break;
+    }
+
+    for (size_t i = 1; i < child->label_.size(); i++) {
+      if (child->label_[i] != toLower(path[pos + i])) {
+        child = nullptr;
+        break;
+      }
+    }
+
+    if (!child) {
+      break;
+    }
+
+    node = child;
+    pos += child->label_.size();
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+}
+
+} // namespace Router
+} // namespace Envoy
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Envoy {
+namespace Router {
+
+/**
+ * A radix tree over the paths and prefixes of the routes of a virtual host. Looking up a request
+ * path yields the routes whose path or prefix may match it, so that only those have to be checked
+ * in full. Routes are identified by their position in the virtual host.
+ *
+ * The tree ignores ASCII case. Candidates for case sensitive routes must still have their path
+ * checked, which the routes do as part of matching anyway.
+ */
+class RouteTrie {
+public:
+  RouteTrie();
+
+  /**
+   * Add a route that matches paths starting with a prefix.
+   * @param prefix supplies the prefix.
+   * @param route supplies the position of the route. Routes must be added in ascending order.
+   */
+  void addPrefix(const std::string& prefix, uint32_t route);
+
+  /**
+   * Add a route that matches a path exactly, ignoring any query string in the request.
+   * @param path supplies the path.
+   * @param route supplies the position of the route. Routes must be added in ascending order.
+   */
+  void addPath(const std::string& path, uint32_t route);
+
+  /**
+   * Find the routes that may match a request path.
+   * @param path supplies the request path, including any query string.
+   * @param size supplies the length of the path.
+   * @param candidates receives the positions of the routes in ascending order, so that the first
+   *        one that matches in full is the one that is used.
+   */
+  void candidates(const char* path, size_t size, std::vector<uint32_t>& candidates) const;
+
+private:
+  struct Node {
+    // The lower cased bytes on the edge from the parent to this node.
+    std::string label_;
+    std::vector<std::unique_ptr<Node>> children_;
+    // Routes whose prefix ends at this node.
+    std::vector<uint32_t> prefix_routes_;
+    // Routes whose path ends at this node.
+    std::vector<uint32_t> path_routes_;
+  };
+
+  static char toLower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+  /**
+   * @return Node& the node for a key, adding it and splitting edges as needed.
+   */
+  Node& insert(const std::string& key);
+
+  std::unique_ptr<Node> root_;
+};
+
+} // namespace Router
+} // namespace Envoy
@@ -15,6 +15,7 @@
 #include "common/common/assert.h"
 #include "common/common/empty_string.h"
 #include "common/common/enum_to_int.h"
+#include "common/common/hash.h"
 #include "common/common/utility.h"
 #include "common/http/codes.h"
 #include "common/http/header_map_impl.h"
@@ -23,6 +24,7 @@
 #include "common/http/utility.h"
 #include "common/router/config_impl.h"
 #include "common/router/retry_state_impl.h"
+#include "common/runtime/key_registry.h"
 
 namespace Envoy {
 namespace Router {
@@ -92,9 +94,48 @@ FilterUtility::TimeoutData FilterUtility::finalTimeout(const RouteEntry& route,
   return timeout;
 }
 
+std::chrono::milliseconds FilterUtility::hedgeDelay(Http::HeaderMap& request_headers,
+                                                    const TimeoutData& timeout) {
+  std::chrono::milliseconds hedge_delay(0);
+  Http::HeaderEntry* hedge_delay_entry = request_headers.EnvoyUpstreamRequestHedgeDelayMs();
+  if (hedge_delay_entry) {
+    uint64_t header_hedge_delay;
+    if (StringUtil::atoul(hedge_delay_entry->value().c_str(), header_hedge_delay)) {
+      hedge_delay = std::chrono::milliseconds(header_hedge_delay);
+    }
+    request_headers.removeEnvoyUpstreamRequestHedgeDelayMs();
+  }
+
+  // There is no point in hedging a try that will have timed out by then.
+  if ((timeout.per_try_timeout_.count() > 0 && hedge_delay >= timeout.per_try_timeout_) ||
+      (timeout.global_timeout_.count() > 0 && hedge_delay >= timeout.global_timeout_)) {
+    hedge_delay = std::chrono::milliseconds(0);
+  }
+
+  return hedge_delay;
+}
+
+uint64_t FilterUtility::retryBufferLimit(Http::HeaderMap& request_headers,
+                                         Runtime::Loader& runtime) {
+  static const Runtime::Key retry_buffer_limit_key =
+      Runtime::KeyRegistry::key("upstream.retry_buffer_limit_bytes");
+  uint64_t limit = runtime.snapshot().getInteger(retry_buffer_limit_key, 0);
+  Http::HeaderEntry* limit_entry = request_headers.EnvoyRetryBufferLimitBytes();
+  if (limit_entry) {
+    uint64_t header_limit;
+    if (StringUtil::atoul(limit_entry->value().c_str(), header_limit)) {
+      limit = header_limit;
+    }
+    request_headers.removeEnvoyRetryBufferLimitBytes();
+  }
+
+  return limit;
+}
+
 Filter::~Filter() {
   // Upstream resources should already have been cleaned.
   ASSERT(!upstream_request_);
+  ASSERT(!hedge_request_);
   ASSERT(!retry_state_);
 }
 
@@ -122,7 +163,8 @@ void Filter::chargeUpstreamCode(const Http::HeaderMap& response_headers,
                                                                : EMPTY_STRING,
                                              config_.local_info_.zoneName(),
                                              upstreamZone(upstream_host),
-                                             is_canary};
+                                             is_canary,
+                                             &cluster_->codeStats()};
 
     Http::CodeUtility::chargeResponseStat(info);
 
@@ -136,7 +178,8 @@ void Filter::chargeUpstreamCode(const Http::HeaderMap& response_headers,
                                                EMPTY_STRING,
                                                config_.local_info_.zoneName(),
                                                upstreamZone(upstream_host),
-                                               is_canary};
+                                               is_canary,
+                                               nullptr};
 
       Http::CodeUtility::chargeResponseStat(info);
     }
@@ -180,7 +223,7 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
 
   // A route entry matches for the request.
   route_entry_ = route_->routeEntry();
-  Upstream::ThreadLocalCluster* cluster = config_.cm_.get(route_entry_->clusterName());
+  Upstream::ThreadLocalCluster* cluster = getThreadLocalCluster();
   if (!cluster) {
     config_.stats_.no_cluster_.inc();
     ENVOY_STREAM_LOG(debug, "unknown cluster '{}'", *callbacks_, route_entry_->clusterName());
@@ -230,22 +273,32 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
   }
 
   route_entry_->finalizeRequestHeaders(headers);
+  // The route may ask for hedging and limit retry buffering through the headers it adds.
+  hedge_delay_ = FilterUtility::hedgeDelay(headers, timeout_);
+  retry_buffer_limit_ = FilterUtility::retryBufferLimit(headers, config_.runtime_);
   FilterUtility::setUpstreamScheme(headers, *cluster_);
   retry_state_ =
       createRetryState(route_entry_->retryPolicy(), headers, *cluster_, config_.runtime_,
                        config_.random_, callbacks_->dispatcher(), route_entry_->priority());
-  do_shadowing_ = FilterUtility::shouldShadow(route_entry_->shadowPolicy(), config_.runtime_,
-                                              callbacks_->streamId());
-
-#ifndef NVLOG
-  headers.iterate(
-      [](const Http::HeaderEntry& header, void* context) -> void {
-        ENVOY_STREAM_LOG(debug, "  '{}':'{}'",
-                         *static_cast<Http::StreamDecoderFilterCallbacks*>(context),
-                         header.key().c_str(), header.value().c_str());
-      },
-      callbacks_);
-#endif
+  // Sample shadowing by the request ID where there is one, so that every Envoy that shadows with
+  // the same percentage takes the same decision for a request.
+  const Http::HeaderEntry* request_id = headers.RequestId();
+  const uint64_t shadow_random =
+      request_id != nullptr
+          ? HashUtil::xxHash64(request_id->value().c_str(), request_id->value().size())
+          : callbacks_->streamId();
+  do_shadowing_ =
+      FilterUtility::shouldShadow(route_entry_->shadowPolicy(), config_.runtime_, shadow_random);
+
+  if (ENVOY_LOG_CHECK_LEVEL(debug)) {
+    headers.iterate(
+        [](const Http::HeaderEntry& header, void* context) -> void {
+          ENVOY_STREAM_LOG(debug, "  '{}':'{}'",
+                           *static_cast<Http::StreamDecoderFilterCallbacks*>(context),
+                           header.key().c_str(), header.value().c_str());
+        },
+        callbacks_);
+  }
 
   // Do a common header check. We make sure that all outgoing requests have all HTTP/2 headers.
   // These get stripped by HTTP/1 codec where applicable.
@@ -264,10 +317,24 @@ Http::FilterHeadersStatus Filter::decodeHeaders(Http::HeaderMap& headers, bool e
 }
 
 Http::ConnectionPool::Instance* Filter::getConnPool() {
+  const Optional<uint32_t>& cluster_id = route_entry_->clusterId();
+  if (cluster_id.valid()) {
+    return config_.cm_.httpConnPoolForClusterId(cluster_id.value(), route_entry_->priority(), this);
+  }
   return config_.cm_.httpConnPoolForCluster(route_entry_->clusterName(), route_entry_->priority(),
                                             this);
 }
 
+Upstream::ThreadLocalCluster* Filter::getThreadLocalCluster() {
+  // Routes that name their cluster in the configuration have interned it, which saves hashing the
+  // name on every request.
+  const Optional<uint32_t>& cluster_id = route_entry_->clusterId();
+  if (cluster_id.valid()) {
+    return config_.cm_.getById(cluster_id.value());
+  }
+  return config_.cm_.get(route_entry_->clusterName());
+}
+
 void Filter::sendNoHealthyUpstreamResponse() {
   callbacks_->requestInfo().setResponseFlag(Http::AccessLog::ResponseFlag::NoHealthyUpstream);
   chargeUpstreamCode(Http::Code::ServiceUnavailable, nullptr);
@@ -276,10 +343,27 @@ void Filter::sendNoHealthyUpstreamResponse() {
 }
 
 Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_stream) {
-  bool buffering = (retry_state_ && retry_state_->enabled()) || do_shadowing_;
+  bool replayable = (retry_state_ && retry_state_->enabled()) || hedge_delay_.count() > 0;
+
+  // Past the retry buffer limit we give up on retrying or hedging the request and stream the rest
+  // of the body. What has been buffered so far stays with the stream, which the limit bounds.
+  if (replayable && retry_buffer_limit_ > 0) {
+    const uint64_t buffered =
+        callbacks_->decodingBuffer() ? callbacks_->decodingBuffer()->length() : 0;
+    if (buffered + data.length() > retry_buffer_limit_) {
+      ENVOY_STREAM_LOG(debug, "request body over the retry buffer limit, disabling retries",
+                       *callbacks_);
+      cluster_->stats().upstream_rq_retry_buffer_overflow_.inc();
+      retry_state_.reset();
+      hedge_delay_ = std::chrono::milliseconds(0);
+      replayable = false;
+    }
+  }
+
+  const bool buffering = replayable || do_shadowing_;
 
-  // If we are going to buffer for retries or shadowing, we need to make a copy before encoding
-  // since it's all moves from here on.
+  // If we are going to buffer for retries, shadowing or hedging, we need to make a copy before
+  // encoding since it's all moves from here on.
   if (buffering) {
     Buffer::OwnedImpl copy(data);
     upstream_request_->encodeData(copy, end_stream);
@@ -291,7 +375,7 @@ Http::FilterDataStatus Filter::decodeData(Buffer::Instance& data, bool end_strea
     onRequestComplete();
   }
 
-  // If we are potentially going to retry or shadow this request we need to buffer.
+  // If we are potentially going to retry, shadow or hedge this request we need to buffer.
   return buffering ? Http::FilterDataStatus::StopIterationAndBuffer
                    : Http::FilterDataStatus::StopIterationNoBuffer;
 }
@@ -305,6 +389,8 @@ Http::FilterTrailersStatus Filter::decodeTrailers(Http::HeaderMap& trailers) {
 
 void Filter::cleanup() {
   upstream_request_.reset();
+  endHedge();
+  disableHedgeTimeout();
   retry_state_.reset();
   if (response_timeout_) {
     response_timeout_->disableTimer();
@@ -321,7 +407,10 @@ void Filter::maybeDoShadowing() {
   Http::MessagePtr request(new Http::RequestMessageImpl(
       Http::HeaderMapPtr{new Http::HeaderMapImpl(*downstream_headers_)}));
   if (callbacks_->decodingBuffer()) {
-    request->body().reset(new Buffer::OwnedImpl(*callbacks_->decodingBuffer()));
+    // The buffered body is complete and no longer changes, so the shadow can share it.
+    Buffer::OwnedImpl* body = new Buffer::OwnedImpl();
+    body->addShared(*callbacks_->decodingBuffer());
+    request->body().reset(body);
   }
   if (downstream_trailers_) {
     request->trailers(Http::HeaderMapPtr{new Http::HeaderMapImpl(*downstream_trailers_)});
@@ -333,7 +422,8 @@ void Filter::maybeDoShadowing() {
 
 void Filter::onRequestComplete() {
   downstream_end_stream_ = true;
-  downstream_request_complete_time_ = std::chrono::steady_clock::now();
+  downstream_request_complete_time_ =
+      callbacks_->dispatcher().approximateMonotonicTime().currentTime();
   callbacks_->requestInfo().requestReceivedDuration(downstream_request_complete_time_);
 
   // Possible that we got an immediate reset.
@@ -343,9 +433,10 @@ void Filter::onRequestComplete() {
     maybeDoShadowing();
 
     upstream_request_->setupPerTryTimeout();
+    setupHedgeTimeout();
     if (timeout_.global_timeout_.count() > 0) {
       response_timeout_ =
-          callbacks_->dispatcher().createTimer([this]() -> void { onResponseTimeout(); });
+          callbacks_->dispatcher().createCoarseTimer([this]() -> void { onResponseTimeout(); });
       response_timeout_->enableTimer(timeout_.global_timeout_);
     }
   }
@@ -355,6 +446,9 @@ void Filter::onDestroy() {
   if (upstream_request_) {
     upstream_request_->resetStream();
   }
+  if (hedge_request_) {
+    hedge_request_->resetStream();
+  }
   stream_destroyed_ = true;
   cleanup();
 }
@@ -371,6 +465,9 @@ void Filter::onResponseTimeout() {
     }
     upstream_request_->resetStream();
   }
+  if (hedge_request_) {
+    hedge_request_->resetStream();
+  }
 
   onUpstreamReset(UpstreamResetType::GlobalTimeout, Optional<Http::StreamResetReason>());
 }
@@ -424,7 +521,7 @@ void Filter::onUpstreamReset(UpstreamResetType type,
     }
 
     chargeUpstreamCode(code, upstream_host);
-    Http::Utility::sendLocalReply(*callbacks_, stream_destroyed_, code, body);
+    Http::Utility::sendLocalReply(*callbacks_, stream_destroyed_, code, std::move(body));
   }
 }
 
@@ -451,6 +548,8 @@ Filter::streamResetReasonToResponseFlag(Http::StreamResetReason reset_reason) {
 void Filter::onUpstreamHeaders(Http::HeaderMapPtr&& headers, bool end_stream) {
   ENVOY_STREAM_LOG(debug, "upstream headers complete: end_stream={}", *callbacks_, end_stream);
   ASSERT(!downstream_response_started_);
+  ASSERT(!hedge_request_);
+  disableHedgeTimeout();
 
   upstream_request_->upstream_host_->outlierDetector().putHttpResponseCode(
       Http::Utility::getResponseStatus(*headers));
@@ -476,7 +575,8 @@ void Filter::onUpstreamHeaders(Http::HeaderMapPtr&& headers, bool end_stream) {
   // Only send upstream service time if we received the complete request and this is not a
   // premature response.
   if (DateUtil::timePointValid(downstream_request_complete_time_)) {
-    MonotonicTime response_received_time = std::chrono::steady_clock::now();
+    MonotonicTime response_received_time =
+        callbacks_->dispatcher().approximateMonotonicTime().currentTime();
     std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(
         response_received_time - downstream_request_complete_time_);
     headers->insertEnvoyUpstreamServiceTime().value(ms.count());
@@ -514,11 +614,25 @@ void Filter::onUpstreamComplete() {
     upstream_request_->resetStream();
   }
 
-  if (config_.emit_dynamic_stats_ && !callbacks_->requestInfo().healthCheck() &&
-      DateUtil::timePointValid(downstream_request_complete_time_)) {
-    std::chrono::milliseconds response_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now() - downstream_request_complete_time_);
+  const bool response_timed = !callbacks_->requestInfo().healthCheck() &&
+                              DateUtil::timePointValid(downstream_request_complete_time_);
+  std::chrono::milliseconds response_time{};
+  if (response_timed) {
+    const auto elapsed = callbacks_->dispatcher().approximateMonotonicTime().currentTime() -
+                         downstream_request_complete_time_;
+    response_time = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+    cluster_->resourceManager(route_entry_->priority())
+        .onResponseTime(std::chrono::duration_cast<std::chrono::microseconds>(elapsed));
+
+    // Latency aware load balancers keep per worker state, so report to this worker's load balancer.
+    // The cluster may have been removed while the request was in flight.
+    Upstream::ThreadLocalCluster* cluster = getThreadLocalCluster();
+    if (cluster) {
+      cluster->loadBalancer().onResponseTime(*upstream_request_->upstream_host_, response_time);
+    }
+  }
 
+  if (config_.emit_dynamic_stats_ && response_timed) {
     upstream_request_->upstream_host_->outlierDetector().putResponseTime(response_time);
 
     const Http::HeaderEntry* internal_request_header = downstream_headers_->EnvoyInternalRequest();
@@ -573,6 +687,7 @@ bool Filter::setupRetry(bool end_stream) {
   }
 
   upstream_request_.reset();
+  disableHedgeTimeout();
   return true;
 }
 
@@ -587,20 +702,116 @@ void Filter::doRetry() {
   ASSERT(response_timeout_ || timeout_.global_timeout_.count() == 0);
   ASSERT(!upstream_request_);
   upstream_request_.reset(new UpstreamRequest(*this, *conn_pool));
-  upstream_request_->encodeHeaders(!callbacks_->decodingBuffer() && !downstream_trailers_);
-  // It's possible we got immediately reset.
+  encodeBufferedRequest(upstream_request_);
   if (upstream_request_) {
+    setupHedgeTimeout();
+  }
+}
+
+void Filter::encodeBufferedRequest(UpstreamRequestPtr& upstream_request) {
+  upstream_request->encodeHeaders(!callbacks_->decodingBuffer() && !downstream_trailers_);
+  // It's possible we got immediately reset.
+  if (upstream_request) {
     if (callbacks_->decodingBuffer()) {
-      // If we are doing a retry we need to make a copy.
+      // If we are doing a retry or a hedge we need to make a copy.
       Buffer::OwnedImpl copy(*callbacks_->decodingBuffer());
-      upstream_request_->encodeData(copy, !downstream_trailers_);
+      upstream_request->encodeData(copy, !downstream_trailers_);
     }
 
     if (downstream_trailers_) {
-      upstream_request_->encodeTrailers(*downstream_trailers_);
+      upstream_request->encodeTrailers(*downstream_trailers_);
     }
 
-    upstream_request_->setupPerTryTimeout();
+    upstream_request->setupPerTryTimeout();
+  }
+}
+
+void Filter::setupHedgeTimeout() {
+  ASSERT(!hedge_timeout_);
+  if (hedge_delay_.count() > 0) {
+    hedge_timeout_ = callbacks_->dispatcher().createTimer([this]() -> void { onHedgeTimeout(); });
+    hedge_timeout_->enableTimer(hedge_delay_);
+  }
+}
+
+void Filter::disableHedgeTimeout() {
+  if (hedge_timeout_) {
+    hedge_timeout_->disableTimer();
+    hedge_timeout_.reset();
+  }
+}
+
+void Filter::onHedgeTimeout() {
+  ASSERT(upstream_request_ && !hedge_request_);
+
+  Upstream::ResourceManager& resource_manager = cluster_->resourceManager(route_entry_->priority());
+  if (!resource_manager.hedges().canCreate()) {
+    cluster_->stats().upstream_rq_hedge_overflow_.inc();
+    return;
+  }
+
+  // Connection pools are per host, so a different pool means a different host. Sending the hedge
+  // to the host that already has the request would not help, and a load balancer that hashes the
+  // request always picks that one.
+  Http::ConnectionPool::Instance* conn_pool = nullptr;
+  for (uint32_t i = 0; i < MAX_HEDGE_HOST_PICKS && !conn_pool; i++) {
+    Http::ConnectionPool::Instance* candidate = getConnPool();
+    if (candidate && candidate != &upstream_request_->conn_pool_) {
+      conn_pool = candidate;
+    }
+  }
+  if (!conn_pool) {
+    ENVOY_STREAM_LOG(debug, "no other host to hedge to", *callbacks_);
+    return;
+  }
+
+  ENVOY_STREAM_LOG(debug, "hedging request", *callbacks_);
+  cluster_->stats().upstream_rq_hedge_.inc();
+  resource_manager.hedges().inc();
+  hedge_request_.reset(new UpstreamRequest(*this, *conn_pool));
+  encodeBufferedRequest(hedge_request_);
+}
+
+void Filter::pickHedgeWinner(UpstreamRequest& upstream_request) {
+  if (!hedge_request_) {
+    return;
+  }
+
+  if (&upstream_request == hedge_request_.get()) {
+    cluster_->stats().upstream_rq_hedge_won_.inc();
+    upstream_request_.swap(hedge_request_);
+  }
+
+  ENVOY_STREAM_LOG(debug, "resetting the slower of the hedged requests", *callbacks_);
+  hedge_request_->resetStream();
+  endHedge();
+}
+
+bool Filter::onHedgedRequestReset(UpstreamRequest& upstream_request, UpstreamResetType type) {
+  if (!hedge_request_) {
+    return false;
+  }
+
+  // The other request carries on alone. It is up to it whether the request is retried.
+  ENVOY_STREAM_LOG(debug, "hedged request reset", *callbacks_);
+  if (upstream_request.upstream_host_) {
+    upstream_request.upstream_host_->outlierDetector().putHttpResponseCode(
+        enumToInt(type == UpstreamResetType::Reset ? Http::Code::ServiceUnavailable
+                                                   : timeout_response_code_));
+  }
+
+  if (&upstream_request == upstream_request_.get()) {
+    upstream_request_.swap(hedge_request_);
+  }
+  ASSERT(&upstream_request == hedge_request_.get());
+  endHedge();
+  return true;
+}
+
+void Filter::endHedge() {
+  if (hedge_request_) {
+    hedge_request_.reset();
+    cluster_->resourceManager(route_entry_->priority()).hedges().dec();
   }
 }
 
@@ -613,6 +824,13 @@ Filter::UpstreamRequest::~UpstreamRequest() {
 }
 
 void Filter::UpstreamRequest::decodeHeaders(Http::HeaderMapPtr&& headers, bool end_stream) {
+  recordTiming(Http::AccessLog::RequestTiming::UpstreamFirstByte);
+  if (first_byte_) {
+    first_byte_->complete();
+    first_byte_.reset();
+  }
+
+  parent_.pickHedgeWinner(*this);
   parent_.onUpstreamHeaders(std::move(headers), end_stream);
 }
 
@@ -628,6 +846,10 @@ void Filter::UpstreamRequest::encodeHeaders(bool end_stream) {
   ASSERT(!encode_complete_);
   encode_complete_ = end_stream;
 
+  recordTiming(Http::AccessLog::RequestTiming::UpstreamRequestStart);
+  pool_wait_ = parent_.cluster_->stats().upstream_rq_pool_wait_ms_.allocateSpan(
+      parent_.callbacks_->dispatcher().approximateMonotonicTime());
+
   // It's possible for a reset to happen inline within the newStream() call. In this case, we might
   // get deleted inline as well. Only write the returned handle out if it is not nullptr to deal
   // with this case.
@@ -670,7 +892,9 @@ void Filter::UpstreamRequest::encodeTrailers(const Http::HeaderMap& trailers) {
 void Filter::UpstreamRequest::onResetStream(Http::StreamResetReason reason) {
   clearRequestEncoder();
   if (!calling_encode_headers_) {
-    parent_.onUpstreamReset(UpstreamResetType::Reset, Optional<Http::StreamResetReason>(reason));
+    if (!parent_.onHedgedRequestReset(*this, UpstreamResetType::Reset)) {
+      parent_.onUpstreamReset(UpstreamResetType::Reset, Optional<Http::StreamResetReason>(reason));
+    }
   } else {
     deferred_reset_reason_ = reason;
   }
@@ -694,8 +918,8 @@ void Filter::UpstreamRequest::resetStream() {
 void Filter::UpstreamRequest::setupPerTryTimeout() {
   ASSERT(!per_try_timeout_);
   if (parent_.timeout_.per_try_timeout_.count() > 0) {
-    per_try_timeout_ =
-        parent_.callbacks_->dispatcher().createTimer([this]() -> void { onPerTryTimeout(); });
+    per_try_timeout_ = parent_.callbacks_->dispatcher().createCoarseTimer(
+        [this]() -> void { onPerTryTimeout(); });
     per_try_timeout_->enableTimer(parent_.timeout_.per_try_timeout_);
   }
 }
@@ -707,8 +931,10 @@ void Filter::UpstreamRequest::onPerTryTimeout() {
     upstream_host_->stats().rq_timeout_.inc();
   }
   resetStream();
-  parent_.onUpstreamReset(UpstreamResetType::PerTryTimeout,
-                          Optional<Http::StreamResetReason>(Http::StreamResetReason::LocalReset));
+  if (!parent_.onHedgedRequestReset(*this, UpstreamResetType::PerTryTimeout)) {
+    parent_.onUpstreamReset(UpstreamResetType::PerTryTimeout,
+                            Optional<Http::StreamResetReason>(Http::StreamResetReason::LocalReset));
+  }
 }
 
 void Filter::UpstreamRequest::onPoolFailure(Http::ConnectionPool::PoolFailureReason reason,
@@ -731,6 +957,11 @@ void Filter::UpstreamRequest::onPoolFailure(Http::ConnectionPool::PoolFailureRea
 void Filter::UpstreamRequest::onPoolReady(Http::StreamEncoder& request_encoder,
                                           Upstream::HostDescriptionConstSharedPtr host) {
   ENVOY_STREAM_LOG(debug, "pool ready", *parent_.callbacks_);
+  recordTiming(Http::AccessLog::RequestTiming::UpstreamPoolReady);
+  pool_wait_->complete();
+  pool_wait_.reset();
+  first_byte_ = parent_.cluster_->stats().upstream_rq_first_byte_ms_.allocateSpan(
+      parent_.callbacks_->dispatcher().approximateMonotonicTime());
   onUpstreamHostSelected(host);
   request_encoder.getStream().addCallbacks(*this);
 
@@ -763,6 +994,22 @@ void Filter::UpstreamRequest::onPoolReady(Http::StreamEncoder& request_encoder,
   }
 }
 
+void Filter::UpstreamRequest::onPoolConnectionTiming(
+    const Http::ConnectionPool::ConnectionTiming& timing) {
+  Http::AccessLog::RequestInfo& request_info = parent_.callbacks_->requestInfo();
+  request_info.timing(Http::AccessLog::RequestTiming::UpstreamConnectStart, timing.connect_start_);
+  request_info.timing(Http::AccessLog::RequestTiming::UpstreamConnectEnd, timing.connect_end_);
+  if (DateUtil::timePointValid(timing.handshake_end_)) {
+    request_info.timing(Http::AccessLog::RequestTiming::UpstreamHandshakeEnd,
+                        timing.handshake_end_);
+  }
+}
+
+void Filter::UpstreamRequest::recordTiming(Http::AccessLog::RequestTiming point) {
+  parent_.callbacks_->requestInfo().timing(
+      point, parent_.callbacks_->dispatcher().approximateMonotonicTime().currentTime());
+}
+
 RetryStatePtr
 ProdFilter::createRetryState(const RetryPolicy& policy, Http::HeaderMap& request_headers,
                              const Upstream::ClusterInfo& cluster, Runtime::Loader& runtime,
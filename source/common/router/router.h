@@ -70,6 +70,23 @@ public:
    * @return TimeoutData for both the global and per try timeouts.
    */
   static TimeoutData finalTimeout(const RouteEntry& route, Http::HeaderMap& request_headers);
+
+  /**
+   * Determine how long to wait for a response before hedging a request.
+   * @param request_headers supplies the request headers.
+   * @param timeout supplies the final timeouts of the request.
+   * @return std::chrono::milliseconds the hedge delay, or 0 if the request is not hedged.
+   */
+  static std::chrono::milliseconds hedgeDelay(Http::HeaderMap& request_headers,
+                                              const TimeoutData& timeout);
+
+  /**
+   * Determine how much of the request body may be buffered to retry or hedge the request.
+   * @param request_headers supplies the request headers.
+   * @param runtime supplies the runtime to read the default limit from.
+   * @return uint64_t the limit in bytes, or 0 if there is no limit.
+   */
+  static uint64_t retryBufferLimit(Http::HeaderMap& request_headers, Runtime::Loader& runtime);
 };
 
 /**
@@ -138,6 +155,9 @@ public:
   const Network::Connection* downstreamConnection() const override {
     return callbacks_->connection();
   }
+  const Upstream::MetadataMatchCriteria* metadataMatchCriteria() const override {
+    return route_entry_ ? route_entry_->metadataMatchCriteria() : nullptr;
+  }
 
 private:
   struct UpstreamRequest : public Http::StreamDecoder,
@@ -184,7 +204,9 @@ private:
                        Upstream::HostDescriptionConstSharedPtr host) override;
     void onPoolReady(Http::StreamEncoder& request_encoder,
                      Upstream::HostDescriptionConstSharedPtr host) override;
+    void onPoolConnectionTiming(const Http::ConnectionPool::ConnectionTiming& timing) override;
 
+    void recordTiming(Http::AccessLog::RequestTiming point);
     void setRequestEncoder(Http::StreamEncoder& request_encoder);
     void clearRequestEncoder();
 
@@ -209,6 +231,8 @@ private:
     Buffer::InstancePtr buffered_request_body_;
     Upstream::HostDescriptionConstSharedPtr upstream_host_;
     DownstreamWatermarkManager downstream_watermark_manager_{*this};
+    Stats::TimespanPtr pool_wait_;
+    Stats::TimespanPtr first_byte_;
 
     bool calling_encode_headers_ : 1;
     bool upstream_canary_ : 1;
@@ -220,6 +244,9 @@ private:
 
   enum class UpstreamResetType { Reset, GlobalTimeout, PerTryTimeout };
 
+  // How many times the load balancer is asked for another host to send a hedge to.
+  static const uint32_t MAX_HEDGE_HOST_PICKS = 3;
+
   Http::AccessLog::ResponseFlag
   streamResetReasonToResponseFlag(Http::StreamResetReason reset_reason);
 
@@ -235,6 +262,14 @@ private:
                                          Event::Dispatcher& dispatcher,
                                          Upstream::ResourcePriority priority) PURE;
   Http::ConnectionPool::Instance* getConnPool();
+  Upstream::ThreadLocalCluster* getThreadLocalCluster();
+  void encodeBufferedRequest(UpstreamRequestPtr& upstream_request);
+  void setupHedgeTimeout();
+  void disableHedgeTimeout();
+  void onHedgeTimeout();
+  void pickHedgeWinner(UpstreamRequest& upstream_request);
+  bool onHedgedRequestReset(UpstreamRequest& upstream_request, UpstreamResetType type);
+  void endHedge();
   void maybeDoShadowing();
   void onRequestComplete();
   void onResponseTimeout();
@@ -259,7 +294,13 @@ private:
   FilterUtility::TimeoutData timeout_;
   Http::Code timeout_response_code_ = Http::Code::GatewayTimeout;
   UpstreamRequestPtr upstream_request_;
+  // A second request sent while upstream_request_ is still waiting for a response. Whichever of
+  // the two responds first becomes upstream_request_.
+  UpstreamRequestPtr hedge_request_;
+  Event::TimerPtr hedge_timeout_;
+  std::chrono::milliseconds hedge_delay_{0};
   RetryStatePtr retry_state_;
+  uint64_t retry_buffer_limit_{};
   Http::HeaderMap* downstream_headers_{};
   Http::HeaderMap* downstream_trailers_{};
   MonotonicTime downstream_request_complete_time_;
@@ -11,6 +11,15 @@ namespace Router {
 
 void ShadowWriterImpl::shadow(const std::string& cluster, Http::MessagePtr&& request,
                               std::chrono::milliseconds timeout) {
+  // Configuration should guarantee that cluster exists before calling here.
+  Upstream::ThreadLocalCluster* thread_local_cluster = cm_.get(cluster);
+  ASSERT(thread_local_cluster != nullptr);
+  Upstream::ClusterInfoConstSharedPtr info = thread_local_cluster->info();
+  if (!info->resourceManager(Upstream::ResourcePriority::Default).shadows().canCreate()) {
+    info->stats().upstream_rq_shadow_overflow_.inc();
+    return;
+  }
+
   // Switch authority to add a shadow postfix. This allows upstream logging to make a more sense.
   // TODO PERF: Avoid copy.
   std::string host = request->headers().Host()->value().c_str();
@@ -18,11 +27,22 @@ void ShadowWriterImpl::shadow(const std::string& cluster, Http::MessagePtr&& req
   host += "-shadow";
   request->headers().Host()->value(host);
 
-  // Configuration should guarantee that cluster exists before calling here. This is basically
-  // fire and forget. We don't handle cancelling.
-  cm_.httpAsyncClientForCluster(cluster).send(std::move(request), *this,
+  // This is basically fire and forget. We don't handle cancelling. The async client calls back
+  // exactly once, also when the request fails inline or the client goes away.
+  ShadowRequest* shadow_request = new ShadowRequest(info);
+  cm_.httpAsyncClientForCluster(cluster).send(std::move(request), *shadow_request,
                                               Optional<std::chrono::milliseconds>(timeout));
 }
 
+ShadowWriterImpl::ShadowRequest::ShadowRequest(Upstream::ClusterInfoConstSharedPtr cluster)
+    : cluster_(cluster) {
+  cluster_->resourceManager(Upstream::ResourcePriority::Default).shadows().inc();
+}
+
+void ShadowWriterImpl::ShadowRequest::onComplete() {
+  cluster_->resourceManager(Upstream::ResourcePriority::Default).shadows().dec();
+  delete this;
+}
+
 } // namespace Router
 } // namespace Envoy
@@ -5,15 +5,17 @@
 
 #include "envoy/router/shadow_writer.h"
 #include "envoy/upstream/cluster_manager.h"
+#include "envoy/upstream/upstream.h"
 
 namespace Envoy {
 namespace Router {
 
 /**
  * Implementation of ShadowWriter that takes incoming requests to shadow and implements "fire and
- * forget" behavior using an async client.
+ * forget" behavior using an async client. The shadows() circuit breaker of the target cluster
+ * limits how many shadowed requests are outstanding; requests over the limit are dropped.
  */
-class ShadowWriterImpl : public ShadowWriter, public Http::AsyncClient::Callbacks {
+class ShadowWriterImpl : public ShadowWriter {
 public:
   ShadowWriterImpl(Upstream::ClusterManager& cm) : cm_(cm) {}
 
@@ -21,11 +23,25 @@ public:
   void shadow(const std::string& cluster, Http::MessagePtr&& request,
               std::chrono::milliseconds timeout) override;
 
-  // Http::AsyncClient::Callbacks
-  void onSuccess(Http::MessagePtr&&) override {}
-  void onFailure(Http::AsyncClient::FailureReason) override {}
-
 private:
+  /**
+   * Holds the circuit breaker of one outstanding shadowed request until its response arrives.
+   * Deletes itself when the request completes.
+   */
+  class ShadowRequest : public Http::AsyncClient::Callbacks {
+  public:
+    ShadowRequest(Upstream::ClusterInfoConstSharedPtr cluster);
+
+    // Http::AsyncClient::Callbacks
+    void onSuccess(Http::MessagePtr&&) override { onComplete(); }
+    void onFailure(Http::AsyncClient::FailureReason) override { onComplete(); }
+
+  private:
+    void onComplete();
+
+    const Upstream::ClusterInfoConstSharedPtr cluster_;
+  };
+
   Upstream::ClusterManager& cm_;
 };
 
@@ -0,0 +1,45 @@
+#include "common/runtime/key_registry.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Envoy {
+namespace Runtime {
+
+namespace {
+
+struct Registry {
+  std::mutex lock_;
+  std::unordered_map<std::string, uint32_t> indexes_;
+  std::vector<std::string> names_;
+};
+
+Registry& registry() {
+  // Keys are registered during static initialization, so the registry is created on first use.
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+} // namespace
+
+Key KeyRegistry::key(const std::string& name) {
+  Registry& keys = registry();
+  std::lock_guard<std::mutex> guard(keys.lock_);
+  auto index = keys.indexes_.emplace(name, keys.names_.size());
+  if (index.second) {
+    keys.names_.push_back(name);
+  }
+  return Key(name, index.first->second);
+}
+
+std::vector<std::string> KeyRegistry::names() {
+  Registry& keys = registry();
+  std::lock_guard<std::mutex> guard(keys.lock_);
+  return keys.names_;
+}
+
+} // namespace Runtime
+} // namespace Envoy
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "envoy/runtime/runtime.h"
+
+namespace Envoy {
+namespace Runtime {
+
+/**
+ * The process wide registry of runtime keys. Keys are meant to be registered once, when the
+ * object that uses them is created, and the registry only grows, so only names from
+ * configuration or code should be registered, never names that come from requests.
+ */
+class KeyRegistry {
+public:
+  /**
+   * @param name supplies the name of the key.
+   * @return Key the key of the given name. Thread safe.
+   */
+  static Key key(const std::string& name);
+
+  /**
+   * @return std::vector<std::string> the names of all the keys registered so far, by index.
+   *         Thread safe.
+   */
+  static std::vector<std::string> names();
+};
+
+} // namespace Runtime
+} // namespace Envoy
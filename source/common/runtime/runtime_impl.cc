@@ -14,6 +14,7 @@
 #include "common/common/assert.h"
 #include "common/common/utility.h"
 #include "common/filesystem/filesystem_impl.h"
+#include "common/runtime/key_registry.h"
 
 #include "openssl/rand.h"
 #include "spdlog/spdlog.h"
@@ -92,13 +93,27 @@ std::string RandomGeneratorImpl::uuid() {
   return std::string(uuid, UUID_LENGTH);
 }
 
+// Version 0 is left to NullSnapshotImpl.
+std::atomic<uint64_t> SnapshotImpl::next_version_{1};
+
+SnapshotImpl::FileId::FileId(const struct stat& info)
+    : device_(info.st_dev), inode_(info.st_ino), size_(info.st_size) {
+#ifdef __APPLE__
+  const timespec& modified = info.st_mtimespec;
+#else
+  const timespec& modified = info.st_mtim;
+#endif
+  modified_ns_ = static_cast<int64_t>(modified.tv_sec) * 1000000000 + modified.tv_nsec;
+}
+
 SnapshotImpl::SnapshotImpl(const std::string& root_path, const std::string& override_path,
-                           RuntimeStats& stats, RandomGenerator& generator)
-    : generator_(generator) {
+                           RuntimeStats& stats, RandomGenerator& generator,
+                           const SnapshotImpl* previous)
+    : generator_(generator), version_(next_version_++) {
   try {
-    walkDirectory(root_path, "");
+    walkDirectory(root_path, "", previous, stats);
     if (Filesystem::directoryExists(override_path)) {
-      walkDirectory(override_path, "");
+      walkDirectory(override_path, "", previous, stats);
       stats.override_dir_exists_.inc();
     } else {
       stats.override_dir_not_exists_.inc();
@@ -111,6 +126,11 @@ SnapshotImpl::SnapshotImpl(const std::string& root_path, const std::string& over
   }
 
   stats.num_keys_.set(values_.size());
+
+  for (const std::string& name : KeyRegistry::names()) {
+    auto entry = values_.find(name);
+    key_entries_.push_back(entry == values_.end() ? nullptr : entry->second.get());
+  }
 }
 
 const std::string& SnapshotImpl::get(const std::string& key) const {
@@ -118,20 +138,34 @@ const std::string& SnapshotImpl::get(const std::string& key) const {
   if (entry == values_.end()) {
     return EMPTY_STRING;
   } else {
-    return entry->second.string_value_;
+    return entry->second->string_value_;
   }
 }
 
 uint64_t SnapshotImpl::getInteger(const std::string& key, uint64_t default_value) const {
   auto entry = values_.find(key);
-  if (entry == values_.end() || !entry->second.uint_value_.valid()) {
+  if (entry == values_.end() || !entry->second->uint_value_.valid()) {
+    return default_value;
+  } else {
+    return entry->second->uint_value_.value();
+  }
+}
+
+uint64_t SnapshotImpl::getInteger(const Key& key, uint64_t default_value) const {
+  if (key.index() >= key_entries_.size()) {
+    return getInteger(key.name(), default_value);
+  }
+
+  const Entry* entry = key_entries_[key.index()];
+  if (entry == nullptr || !entry->uint_value_.valid()) {
     return default_value;
   } else {
-    return entry->second.uint_value_.value();
+    return entry->uint_value_.value();
   }
 }
 
-void SnapshotImpl::walkDirectory(const std::string& path, const std::string& prefix) {
+void SnapshotImpl::walkDirectory(const std::string& path, const std::string& prefix,
+                                 const SnapshotImpl* previous, RuntimeStats& stats) {
   ENVOY_LOG(debug, "walking directory: {}", path);
   Directory current_dir(path);
   while (true) {
@@ -155,24 +189,42 @@ void SnapshotImpl::walkDirectory(const std::string& path, const std::string& pre
 
     if (entry->d_type == DT_DIR && std::string(entry->d_name) != "." &&
         std::string(entry->d_name) != "..") {
-      walkDirectory(full_path, full_prefix);
+      walkDirectory(full_path, full_prefix, previous, stats);
     } else if (entry->d_type == DT_REG) {
+      struct stat info;
+      if (::stat(full_path.c_str(), &info) != 0) {
+        throw EnvoyException(fmt::format("unable to stat file: {}", full_path));
+      }
+      const FileId file_id(info);
+
+      // A runtime update usually changes a few of many files, so the values of the files that are
+      // unchanged since the previous snapshot are shared with it rather than read again.
+      if (previous != nullptr) {
+        auto previous_entry = previous->values_.find(full_prefix);
+        if (previous_entry != previous->values_.end() &&
+            previous_entry->second->file_id_ == file_id) {
+          values_[full_prefix] = previous_entry->second;
+          stats.file_reused_.inc();
+          continue;
+        }
+      }
+
       // Suck the file into a string. This is not very efficient but it should be good enough
       // for small files. Also, as noted elsewhere, none of this is non-blocking which could
       // theoretically lead to issues.
       ENVOY_LOG(debug, "reading file: {}", full_path);
-      Entry entry;
-      entry.string_value_ = Filesystem::fileReadToEnd(full_path);
-      StringUtil::rtrim(entry.string_value_);
+      std::shared_ptr<Entry> entry(new Entry(file_id));
+      entry->string_value_ = Filesystem::fileReadToEnd(full_path);
+      StringUtil::rtrim(entry->string_value_);
 
       // As a perf optimization, attempt to convert the string into an integer. If we don't
       // succeed that's fine.
       uint64_t converted;
-      if (StringUtil::atoul(entry.string_value_.c_str(), converted)) {
-        entry.uint_value_.value(converted);
+      if (StringUtil::atoul(entry->string_value_.c_str(), converted)) {
+        entry->uint_value_.value(converted);
       }
 
-      values_[full_prefix] = entry;
+      values_[full_prefix] = std::move(entry);
     }
   }
 }
@@ -198,11 +250,14 @@ RuntimeStats LoaderImpl::generateStats(Stats::Store& store) {
 }
 
 void LoaderImpl::onSymlinkSwap() {
-  current_snapshot_.reset(new SnapshotImpl(root_path_, override_path_, stats_, generator_));
+  current_snapshot_.reset(
+      new SnapshotImpl(root_path_, override_path_, stats_, generator_, current_snapshot_.get()));
   ThreadLocal::ThreadLocalObjectSharedPtr ptr_copy = current_snapshot_;
-  tls_->set([ptr_copy](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
-    return ptr_copy;
-  });
+  tls_->update(
+      [ptr_copy](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+        return ptr_copy;
+      },
+      nullptr);
 }
 
 Snapshot& LoaderImpl::snapshot() { return tls_->getTyped<Snapshot>(); }
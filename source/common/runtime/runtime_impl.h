@@ -1,13 +1,16 @@
 #pragma once
 
 #include <dirent.h>
+#include <sys/stat.h>
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <memory>
 #include <random>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/common/exception.h"
 #include "envoy/common/optional.h"
@@ -55,6 +58,7 @@ private:
   COUNTER(override_dir_not_exists)                                                                 \
   COUNTER(override_dir_exists)                                                                     \
   COUNTER(load_success)                                                                            \
+  COUNTER(file_reused)                                                                             \
   GAUGE  (num_keys)
 // clang-format on
 
@@ -66,32 +70,27 @@ struct RuntimeStats {
 };
 
 /**
- * Implementation of Snapshot that reads from disk.
+ * Implementation of Snapshot that reads from disk. A snapshot shares the values of the files that
+ * did not change with the snapshot it replaces, and does not read those files again.
  */
 class SnapshotImpl : public Snapshot,
                      public ThreadLocal::ThreadLocalObject,
                      Logger::Loggable<Logger::Id::runtime> {
 public:
+  /**
+   * @param previous supplies the snapshot being replaced, or nullptr.
+   */
   SnapshotImpl(const std::string& root_path, const std::string& override_path, RuntimeStats& stats,
-               RandomGenerator& generator);
+               RandomGenerator& generator, const SnapshotImpl* previous);
 
   // Runtime::Snapshot
   bool featureEnabled(const std::string& key, uint64_t default_value, uint64_t random_value,
                       uint16_t num_buckets) const override {
-    return random_value % static_cast<uint64_t>(num_buckets) <
-           std::min(getInteger(key, default_value), static_cast<uint64_t>(num_buckets));
+    return enabled(getInteger(key, default_value), random_value, num_buckets);
   }
 
   bool featureEnabled(const std::string& key, uint64_t default_value) const override {
-    // Avoid PNRG if we know we don't need it.
-    uint64_t cutoff = std::min(getInteger(key, default_value), static_cast<uint64_t>(100));
-    if (cutoff == 0) {
-      return false;
-    } else if (cutoff == 100) {
-      return true;
-    } else {
-      return generator_.random() % 100 < cutoff;
-    }
+    return enabled(getInteger(key, default_value));
   }
 
   bool featureEnabled(const std::string& key, uint64_t default_value,
@@ -101,6 +100,23 @@ public:
 
   const std::string& get(const std::string& key) const override;
   uint64_t getInteger(const std::string&, uint64_t default_value) const override;
+  uint64_t version() const override { return version_; }
+
+  bool featureEnabled(const Key& key, uint64_t default_value, uint64_t random_value,
+                      uint16_t num_buckets) const override {
+    return enabled(getInteger(key, default_value), random_value, num_buckets);
+  }
+
+  bool featureEnabled(const Key& key, uint64_t default_value) const override {
+    return enabled(getInteger(key, default_value));
+  }
+
+  bool featureEnabled(const Key& key, uint64_t default_value,
+                      uint64_t random_value) const override {
+    return featureEnabled(key, default_value, random_value, 100);
+  }
+
+  uint64_t getInteger(const Key& key, uint64_t default_value) const override;
 
 private:
   struct Directory {
@@ -116,15 +132,62 @@ private:
     DIR* dir_;
   };
 
+  /**
+   * Identifies the contents of a file without reading it: a file that is replaced or written to
+   * gets a new inode, size or modification time.
+   */
+  struct FileId {
+    FileId(const struct stat& info);
+
+    bool operator==(const FileId& rhs) const {
+      return device_ == rhs.device_ && inode_ == rhs.inode_ && size_ == rhs.size_ &&
+             modified_ns_ == rhs.modified_ns_;
+    }
+
+    dev_t device_;
+    ino_t inode_;
+    off_t size_;
+    int64_t modified_ns_;
+  };
+
   struct Entry {
+    Entry(const FileId& file_id) : file_id_(file_id) {}
+
     std::string string_value_;
     Optional<uint64_t> uint_value_;
+    const FileId file_id_;
   };
 
-  void walkDirectory(const std::string& path, const std::string& prefix);
+  typedef std::shared_ptr<const Entry> EntrySharedPtr;
+
+  bool enabled(uint64_t percent) const {
+    // Avoid PNRG if we know we don't need it.
+    uint64_t cutoff = std::min(percent, static_cast<uint64_t>(100));
+    if (cutoff == 0) {
+      return false;
+    } else if (cutoff == 100) {
+      return true;
+    } else {
+      return generator_.random() % 100 < cutoff;
+    }
+  }
+
+  static bool enabled(uint64_t value, uint64_t random_value, uint16_t num_buckets) {
+    return random_value % static_cast<uint64_t>(num_buckets) <
+           std::min(value, static_cast<uint64_t>(num_buckets));
+  }
+
+  void walkDirectory(const std::string& path, const std::string& prefix,
+                     const SnapshotImpl* previous, RuntimeStats& stats);
 
-  std::unordered_map<std::string, Entry> values_;
+  static std::atomic<uint64_t> next_version_;
+
+  std::unordered_map<std::string, EntrySharedPtr> values_;
+  // The entry of each registered key by index, or nullptr if the key has no value. Keys registered
+  // after the snapshot was loaded are looked up by name.
+  std::vector<const Entry*> key_entries_;
   RandomGenerator& generator_;
+  const uint64_t version_;
 };
 
 /**
@@ -197,6 +260,9 @@ private:
       return default_value;
     }
 
+    // The null snapshot never changes.
+    uint64_t version() const override { return 0; }
+
     RandomGenerator& generator_;
   };
 
@@ -1,5 +1,6 @@
 #include "common/ssl/connection_impl.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -16,6 +17,30 @@ namespace Envoy {
 namespace Ssl {
 
 namespace {
+// Write BIO that appends TLS records to a Buffer::Instance, so they are sealed into buffer slices
+// and can be written out together with a single writev().
+int bufferBioWrite(BIO* bio, const char* data, int len) {
+  static_cast<Buffer::Instance*>(BIO_get_data(bio))->add(data, len);
+  return len;
+}
+
+long bufferBioCtrl(BIO*, int cmd, long, void*) {
+  // BoringSSL flushes after each flight of handshake messages. The records are flushed to the
+  // socket by the connection instead.
+  return cmd == BIO_CTRL_FLUSH ? 1 : 0;
+}
+
+const BIO_METHOD* bufferBioMethod() {
+  static const BIO_METHOD* method = []() -> const BIO_METHOD* {
+    BIO_METHOD* method = BIO_meth_new(BIO_TYPE_MEM, "envoy buffer");
+    RELEASE_ASSERT(method != nullptr);
+    BIO_meth_set_write(method, bufferBioWrite);
+    BIO_meth_set_ctrl(method, bufferBioCtrl);
+    return method;
+  }();
+  return method;
+}
+
 // TODO(mattklein123): Currently we don't populate local address for client connections. Nothing
 // looks at this currently, but we may want to populate this later for logging purposes.
 Network::Address::InstanceConstSharedPtr
@@ -36,17 +61,30 @@ ConnectionImpl::ConnectionImpl(Event::DispatcherImpl& dispatcher, int fd,
                                InitialState state)
     : Network::ConnectionImpl(dispatcher, fd, remote_address, local_address, using_original_dst,
                               connected),
-      ctx_(dynamic_cast<Ssl::ContextImpl&>(ctx)), ssl_(ctx_.newSsl()) {
-  BIO* bio = BIO_new_socket(fd, 0);
-  SSL_set_bio(ssl_.get(), bio, bio);
+      ctx_(dynamic_cast<Ssl::ContextImpl&>(ctx)), ssl_(ctx_.newSsl()),
+      handshake_start_time_(dispatcher.approximateMonotonicTime().currentTime()) {
+  // Records are read straight from the socket, but written to ciphertext_, see flushCiphertext().
+  BIO* write_bio = BIO_new(bufferBioMethod());
+  RELEASE_ASSERT(write_bio != nullptr);
+  BIO_set_data(write_bio, &ciphertext_);
+  BIO_set_init(write_bio, 1);
+  SSL_set_bio(ssl_.get(), BIO_new_socket(fd, 0), write_bio);
 
   SSL_set_mode(ssl_.get(), SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
   if (state == InitialState::Client) {
     SSL_set_connect_state(ssl_.get());
+    client_ctx_ = dynamic_cast<ClientContextImpl*>(&ctx_);
+    if (client_ctx_ != nullptr) {
+      client_ctx_->resumeSession(ssl_.get(), remote_address->asString());
+    }
   } else {
     ASSERT(state == InitialState::Server);
     SSL_set_accept_state(ssl_.get());
   }
+
+  if (ctx_.privateKeyMethodProvider() != nullptr) {
+    ctx_.privateKeyMethodProvider()->registerConnection(ssl_.get(), *this, dispatcher);
+  }
 }
 
 ConnectionImpl::~ConnectionImpl() {
@@ -54,11 +92,17 @@ ConnectionImpl::~ConnectionImpl() {
   // destructors for stat reasons. We destroy the filters here vs. the base class destructors
   // to make sure they have the chance to still inspect SSL specific data via virtual functions.
   filter_manager_.destroyFilters();
+
+  if (ctx_.privateKeyMethodProvider() != nullptr) {
+    ctx_.privateKeyMethodProvider()->unregisterConnection(ssl_.get());
+  }
 }
 
 Network::ConnectionImpl::IoResult ConnectionImpl::doReadFromSocket() {
+  // Buffer stats are only updated by write events, so records written here are not counted.
+  uint64_t bytes_written = 0;
   if (!handshake_complete_) {
-    PostIoAction action = doHandshake();
+    PostIoAction action = doHandshake(bytes_written);
     if (action == PostIoAction::Close || !handshake_complete_) {
       return {action, 0};
     }
@@ -103,20 +147,37 @@ Network::ConnectionImpl::IoResult ConnectionImpl::doReadFromSocket() {
       if (shouldDrainReadBuffer()) {
         setReadBufferReady();
         keep_reading = false;
+      } else if (readBudgetExhausted(bytes_read)) {
+        keep_reading = false;
       }
     }
   }
 
+  // Reading may have produced records of its own, e.g. alerts.
+  if (flushCiphertext(bytes_written) == PostIoAction::Close) {
+    action = PostIoAction::Close;
+  }
+
   return {action, bytes_read};
 }
 
-Network::ConnectionImpl::PostIoAction ConnectionImpl::doHandshake() {
+Network::ConnectionImpl::PostIoAction ConnectionImpl::doHandshake(uint64_t& bytes_written) {
   ASSERT(!handshake_complete_);
   int rc = SSL_do_handshake(ssl_.get());
+  // Send the handshake messages, or the alert of a failed handshake. Whatever the socket does not
+  // take is sent by the next write event.
+  if (flushCiphertext(bytes_written) == PostIoAction::Close) {
+    drainErrorQueue();
+    return PostIoAction::Close;
+  }
+
   if (rc == 1) {
     ENVOY_CONN_LOG(debug, "handshake complete", *this);
     handshake_complete_ = true;
     ctx_.logHandshake(ssl_.get());
+    if (client_ctx_ != nullptr) {
+      client_ctx_->storeSession(ssl_.get(), remoteAddress().asString());
+    }
     raiseEvent(Network::ConnectionEvent::Connected);
 
     // It's possible that we closed during the handshake callback.
@@ -127,6 +188,8 @@ Network::ConnectionImpl::PostIoAction ConnectionImpl::doHandshake() {
     switch (err) {
     case SSL_ERROR_WANT_READ:
     case SSL_ERROR_WANT_WRITE:
+    // The private key method provider calls onPrivateKeyMethodComplete() once the result is ready.
+    case SSL_ERROR_WANT_PRIVATE_KEY_OPERATION:
       return PostIoAction::KeepOpen;
     default:
       drainErrorQueue();
@@ -135,6 +198,16 @@ Network::ConnectionImpl::PostIoAction ConnectionImpl::doHandshake() {
   }
 }
 
+void ConnectionImpl::onPrivateKeyMethodComplete() {
+  if (state() != State::Open) {
+    return;
+  }
+
+  // Resume the handshake from the event loop. Both paths are run since the handshake may complete
+  // with application data already waiting on the socket.
+  activateFileEvents(Event::FileReadyType::Read | Event::FileReadyType::Write);
+}
+
 void ConnectionImpl::drainErrorQueue() {
   bool saw_error = false;
   bool saw_counted_error = false;
@@ -159,67 +232,89 @@ void ConnectionImpl::drainErrorQueue() {
 }
 
 Network::ConnectionImpl::IoResult ConnectionImpl::doWriteToSocket() {
+  uint64_t total_bytes_written = 0;
   if (!handshake_complete_) {
-    PostIoAction action = doHandshake();
+    PostIoAction action = doHandshake(total_bytes_written);
     if (action == PostIoAction::Close || !handshake_complete_) {
-      return {action, 0};
+      return {action, total_bytes_written};
     }
   }
 
-  uint64_t original_buffer_length = write_buffer_.length();
-  uint64_t total_bytes_written = 0;
-  bool keep_writing = true;
-  while ((original_buffer_length != total_bytes_written) && keep_writing) {
-    // Protect against stack overflow if the buffer has a very large buffer chain.
-    // TODO(mattklein123): See the comment on getRawSlices() for why we have to also check
-    // original_buffer_length != total_bytes_written during loop iteration.
-    // TODO(mattklein123): As it relates to our fairness efforts, we might want to limit the number
-    // of iterations of this loop, either by pure iterations, bytes written, etc.
+  // Records of earlier writes go out first.
+  if (flushCiphertext(total_bytes_written) == PostIoAction::Close) {
+    return {PostIoAction::Close, total_bytes_written};
+  }
+
+  while (write_buffer_.length() > encrypted_bytes_ && ciphertext_.length() == 0) {
+    // Encrypt a batch of slices into ciphertext_ and write all of the resulting records with a
+    // single writev(). Batches are bounded so that at most one batch of ciphertext is buffered
+    // when the socket backs up.
+    ASSERT(encrypted_bytes_ == 0);
     const uint64_t MAX_SLICES = 32;
     Buffer::RawSlice slices[MAX_SLICES];
-    uint64_t num_slices = write_buffer_.getRawSlices(slices, MAX_SLICES);
-
-    uint64_t inner_bytes_written = 0;
-    for (uint64_t i = 0; (i < num_slices) && (original_buffer_length != total_bytes_written); i++) {
-      // SSL_write() requires that if a previous call returns SSL_ERROR_WANT_WRITE, we need to call
-      // it again with the same parameters. Most implementations keep track of the last write size.
-      // In our case we don't need to do that because: a) SSL_write() will not write partial
-      // buffers. b) We only move() into the write buffer, which means that it's impossible for a
-      // particular chain to increase in size. So as long as we start writing where we left off we
-      // are guaranteed to call SSL_write() with the same parameters.
+    uint64_t num_slices = std::min(write_buffer_.getRawSlices(slices, MAX_SLICES), MAX_SLICES);
+
+    for (uint64_t i = 0; i < num_slices && encrypted_bytes_ < MAX_ENCRYPT_BATCH_SIZE; i++) {
+      if (slices[i].len_ == 0) {
+        continue;
+      }
+
+      // The write BIO accepts all output, so SSL_write() either writes the whole slice or fails.
       int rc = SSL_write(ssl_.get(), slices[i].mem_, slices[i].len_);
       ENVOY_CONN_LOG(trace, "ssl write returns: {}", *this, rc);
-      if (rc > 0) {
-        inner_bytes_written += rc;
-        total_bytes_written += rc;
-      } else {
-        int err = SSL_get_error(ssl_.get(), rc);
-        switch (err) {
-        case SSL_ERROR_WANT_WRITE:
-          keep_writing = false;
-          break;
-        case SSL_ERROR_WANT_READ:
-        // Renegotiation has started. We don't handle renegotiation so just fall through.
-        default:
-          drainErrorQueue();
-          return {PostIoAction::Close, total_bytes_written};
-        }
-
-        break;
+      if (rc <= 0) {
+        drainErrorQueue();
+        return {PostIoAction::Close, total_bytes_written};
       }
+      ASSERT(static_cast<uint64_t>(rc) == slices[i].len_);
+      encrypted_bytes_ += rc;
     }
 
-    // Draining must be done within the inner loop, otherwise we will keep getting the same slices
-    // at the beginning of the buffer.
-    if (inner_bytes_written > 0) {
-      write_buffer_.drain(inner_bytes_written);
+    if (flushCiphertext(total_bytes_written) == PostIoAction::Close) {
+      return {PostIoAction::Close, total_bytes_written};
+    }
+    // A socket that still holds ciphertext back signals when it is writable again.
+    if (ciphertext_.length() == 0 && writeBudgetExhausted(total_bytes_written)) {
+      break;
     }
   }
 
   return {PostIoAction::KeepOpen, total_bytes_written};
 }
 
-void ConnectionImpl::onConnected() { ASSERT(!handshake_complete_); }
+Network::ConnectionImpl::PostIoAction ConnectionImpl::flushCiphertext(uint64_t& bytes_written) {
+  while (ciphertext_.length() > 0) {
+    int rc = ciphertext_.write(fd());
+    ENVOY_CONN_LOG(trace, "ciphertext write returns: {}", *this, rc);
+    if (rc == -1) {
+      ENVOY_CONN_LOG(trace, "write error: {}", *this, errno);
+      // @see Network::ConnectionImpl::doWriteToSocket() for EINPROGRESS.
+      return errno == EAGAIN || errno == EINPROGRESS ? PostIoAction::KeepOpen : PostIoAction::Close;
+    } else if (rc == 0) {
+      // Nothing was written, so wait for the socket to become writable rather than spin.
+      return PostIoAction::KeepOpen;
+    }
+    bytes_written += rc;
+  }
+
+  // The plaintext of the flushed records leaves the write buffer only now.
+  if (encrypted_bytes_ > 0) {
+    write_buffer_.drain(encrypted_bytes_);
+    encrypted_bytes_ = 0;
+  }
+  return PostIoAction::KeepOpen;
+}
+
+void ConnectionImpl::onConnected() {
+  ASSERT(!handshake_complete_);
+  handshake_start_time_ = dispatcher().approximateMonotonicTime().currentTime();
+}
+
+void ConnectionImpl::onSocketReplaced() {
+  // Nothing has been read before the connect completed, so only the read BIO needs to follow.
+  ASSERT(!handshake_complete_);
+  SSL_set0_rbio(ssl_.get(), BIO_new_socket(fd(), 0));
+}
 
 bool ConnectionImpl::peerCertificatePresented() {
   bssl::UniquePtr<X509> cert(SSL_get_peer_certificate(ssl_.get()));
@@ -235,17 +330,22 @@ std::string ConnectionImpl::uriSanLocalCertificate() {
   return getUriSanFromCertificate(cert);
 }
 
-std::string ConnectionImpl::sha256PeerCertificateDigest() {
+const std::string& ConnectionImpl::sha256PeerCertificateDigest() {
+  if (!sha256_peer_certificate_digest_.empty()) {
+    return sha256_peer_certificate_digest_;
+  }
+
   bssl::UniquePtr<X509> cert(SSL_get_peer_certificate(ssl_.get()));
   if (!cert) {
-    return "";
+    return sha256_peer_certificate_digest_;
   }
 
   std::vector<uint8_t> computed_hash(SHA256_DIGEST_LENGTH);
   unsigned int n;
   X509_digest(cert.get(), EVP_sha256(), computed_hash.data(), &n);
   RELEASE_ASSERT(n == computed_hash.size());
-  return Hex::encode(computed_hash);
+  sha256_peer_certificate_digest_ = Hex::encode(computed_hash);
+  return sha256_peer_certificate_digest_;
 }
 
 std::string ConnectionImpl::subjectPeerCertificate() {
@@ -322,6 +422,8 @@ void ConnectionImpl::closeSocket(Network::ConnectionEvent close_type) {
     ENVOY_CONN_LOG(debug, "SSL shutdown: rc={}", *this, rc);
     UNREFERENCED_PARAMETER(rc);
     drainErrorQueue();
+    uint64_t bytes_written = 0;
+    flushCiphertext(bytes_written);
   }
 
   Network::ConnectionImpl::closeSocket(close_type);
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <string>
 
+#include "common/buffer/buffer_impl.h"
 #include "common/network/connection_impl.h"
 #include "common/ssl/context_impl.h"
 
@@ -11,7 +12,9 @@
 namespace Envoy {
 namespace Ssl {
 
-class ConnectionImpl : public Network::ConnectionImpl, public Connection {
+class ConnectionImpl : public Network::ConnectionImpl,
+                       public Connection,
+                       public PrivateKeyConnectionCallbacks {
 public:
   enum class InitialState { Client, Server };
 
@@ -29,14 +32,22 @@ public:
   // Ssl::Connection
   bool peerCertificatePresented() override;
   std::string uriSanLocalCertificate() override;
-  std::string sha256PeerCertificateDigest() override;
+  const std::string& sha256PeerCertificateDigest() override;
   std::string subjectPeerCertificate() override;
   std::string uriSanPeerCertificate() override;
+  MonotonicTime handshakeStartTime() override { return handshake_start_time_; }
+
+  // Ssl::PrivateKeyConnectionCallbacks
+  void onPrivateKeyMethodComplete() override;
 
   SSL* rawSslForTest() { return ssl_.get(); }
 
 private:
-  PostIoAction doHandshake();
+  // The most plaintext encrypted before the resulting records are written to the socket.
+  static const uint64_t MAX_ENCRYPT_BATCH_SIZE = 64 * 1024;
+
+  PostIoAction doHandshake(uint64_t& bytes_written);
+  PostIoAction flushCiphertext(uint64_t& bytes_written);
   void drainErrorQueue();
   std::string getUriSanFromCertificate(X509* cert);
 
@@ -45,10 +56,23 @@ private:
   IoResult doReadFromSocket() override;
   IoResult doWriteToSocket() override;
   void onConnected() override;
+  void onSocketReplaced() override;
+  uint64_t pendingWriteBytes() const override {
+    return write_buffer_.length() - encrypted_bytes_ + ciphertext_.length();
+  }
 
   ContextImpl& ctx_;
+  // Set for upstream connections, which resume and cache sessions per upstream host.
+  ClientContextImpl* client_ctx_{};
+  // TLS records not yet written to the socket. Declared before ssl_, whose write BIO appends here.
+  Buffer::OwnedImpl ciphertext_;
+  // Plaintext at the front of write_buffer_ that is encrypted in ciphertext_. It stays in the
+  // write buffer until its records are written, so that watermarks and buffer stats count it.
+  uint64_t encrypted_bytes_{};
   bssl::UniquePtr<SSL> ssl_;
   bool handshake_complete_{};
+  MonotonicTime handshake_start_time_;
+  std::string sha256_peer_certificate_digest_;
 };
 
 class ClientConnectionImpl final : public ConnectionImpl, public Network::ClientConnection {
@@ -59,6 +83,13 @@ public:
 
   // Network::ClientConnection
   void connect() override;
+  void enableTcpFastOpen(Stats::Counter& syn_data_accepted) override {
+    doEnableTcpFastOpen(syn_data_accepted);
+  }
+  void enableHappyEyeballs(Network::Address::InstanceConstSharedPtr fallback_address,
+                           std::chrono::milliseconds delay) override {
+    doEnableHappyEyeballs(fallback_address, delay);
+  }
 };
 
 } // namespace Ssl
@@ -2,6 +2,9 @@
 
 #include <string>
 
+#include "envoy/common/exception.h"
+#include "envoy/registry/registry.h"
+
 #include "common/common/assert.h"
 #include "common/config/tls_context_json.h"
 #include "common/protobuf/utility.h"
@@ -77,7 +80,22 @@ ServerContextConfigImpl::ServerContextConfigImpl(const Json::Object& config)
         envoy::api::v2::DownstreamTlsContext downstream_tls_context;
         Config::TlsContextJson::translateDownstreamTlsContext(config, downstream_tls_context);
         return downstream_tls_context;
-      }()) {}
+      }()) {
+  session_ticket_key_paths_ = config.getStringArray("session_ticket_key_paths", true);
+
+  if (config.hasObject("private_key_method")) {
+    Json::ObjectSharedPtr private_key_method = config.getObject("private_key_method");
+    const std::string name = private_key_method->getString("name");
+    PrivateKeyMethodProviderFactory* factory =
+        Registry::FactoryRegistry<PrivateKeyMethodProviderFactory>::getFactory(name);
+    if (factory == nullptr) {
+      throw EnvoyException(
+          fmt::format("No PrivateKeyMethodProviderFactory found for name: {}", name));
+    }
+    private_key_method_provider_ = factory->createPrivateKeyMethodProvider(
+        *private_key_method->getObject("config", true), privateKeyFile());
+  }
+}
 
 } // namespace Ssl
 } // namespace Envoy
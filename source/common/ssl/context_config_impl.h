@@ -26,10 +26,16 @@ public:
     return verify_subject_alt_name_list_;
   };
   const std::string& verifyCertificateHash() const override { return verify_certificate_hash_; };
+  PrivateKeyMethodProviderSharedPtr privateKeyMethodProvider() const override {
+    return private_key_method_provider_;
+  }
 
 protected:
   ContextConfigImpl(const envoy::api::v2::CommonTlsContext& config);
 
+  // Only settable from v1 JSON, where it is created from the "private_key_method" object.
+  PrivateKeyMethodProviderSharedPtr private_key_method_provider_;
+
 private:
   static const std::string DEFAULT_CIPHER_SUITES;
   static const std::string DEFAULT_ECDH_CURVES;
@@ -64,9 +70,14 @@ public:
 
   // Ssl::ServerContextConfig
   bool requireClientCertificate() const override { return require_client_certificate_; }
+  const std::vector<std::string>& sessionTicketKeyPaths() const override {
+    return session_ticket_key_paths_;
+  }
 
 private:
   const bool require_client_certificate_;
+  // Only settable from v1 JSON until the v2 DownstreamTlsContext carries ticket keys.
+  std::vector<std::string> session_ticket_key_paths_;
 };
 
 } // namespace Ssl
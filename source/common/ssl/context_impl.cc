@@ -9,8 +9,12 @@
 #include "envoy/runtime/runtime.h"
 
 #include "common/common/assert.h"
+#include "common/common/empty_string.h"
 #include "common/common/hex.h"
+#include "common/filesystem/filesystem_impl.h"
 
+#include "openssl/hmac.h"
+#include "openssl/rand.h"
 #include "openssl/x509v3.h"
 #include "spdlog/spdlog.h"
 
@@ -66,18 +70,33 @@ ContextImpl::ContextImpl(ContextManagerImpl& parent, Stats::Scope& scope, Contex
   }
 
   if (!config.certChainFile().empty()) {
-    cert_chain_ = loadCert(config.certChainFile());
+    private_key_method_provider_ = config.privateKeyMethodProvider();
+    certificate_ = parent_.loadCertificate(
+        config.certChainFile(),
+        private_key_method_provider_ != nullptr ? EMPTY_STRING : config.privateKeyFile());
+    X509_up_ref(certificate_->leaf_.get());
+    cert_chain_.reset(certificate_->leaf_.get());
     cert_chain_file_path_ = config.certChainFile();
-    int rc = SSL_CTX_use_certificate_chain_file(ctx_.get(), config.certChainFile().c_str());
+    int rc = SSL_CTX_use_certificate(ctx_.get(), certificate_->leaf_.get());
+    for (const bssl::UniquePtr<X509>& intermediate : certificate_->intermediates_) {
+      rc = rc && SSL_CTX_add1_chain_cert(ctx_.get(), intermediate.get());
+    }
     if (0 == rc) {
       throw EnvoyException(
           fmt::format("Failed to load certificate chain file {}", config.certChainFile()));
     }
 
-    rc = SSL_CTX_use_PrivateKey_file(ctx_.get(), config.privateKeyFile().c_str(), SSL_FILETYPE_PEM);
-    if (0 == rc) {
-      throw EnvoyException(
-          fmt::format("Failed to load private key file {}", config.privateKeyFile()));
+    if (private_key_method_provider_ != nullptr) {
+      SSL_CTX_set_private_key_method(ctx_.get(),
+                                     &private_key_method_provider_->privateKeyMethod());
+    } else {
+      // This also checks that the private key matches the certificate.
+      rc = certificate_->private_key_ != nullptr &&
+           SSL_CTX_use_PrivateKey(ctx_.get(), certificate_->private_key_.get());
+      if (0 == rc) {
+        throw EnvoyException(
+            fmt::format("Failed to load private key file {}", config.privateKeyFile()));
+      }
     }
   }
 
@@ -182,6 +201,10 @@ void ContextImpl::logHandshake(SSL* ssl) const {
   if (!cert.get()) {
     stats_.no_certificate_.inc();
   }
+
+  if (SSL_session_reused(ssl)) {
+    stats_.session_reused_.inc();
+  }
 }
 
 bool ContextImpl::verifySubjectAltName(X509* cert,
@@ -343,6 +366,44 @@ bssl::UniquePtr<SSL> ClientContextImpl::newSsl() const {
   return ssl_con;
 }
 
+void ClientContextImpl::resumeSession(SSL* ssl, const std::string& session_key) {
+  bssl::UniquePtr<SSL_SESSION> session;
+  {
+    std::unique_lock<std::mutex> lock(session_cache_lock_);
+    auto it = session_cache_.find(session_key);
+    if (it == session_cache_.end()) {
+      return;
+    }
+
+    session = std::move(it->second.front());
+    it->second.pop_front();
+    if (it->second.empty()) {
+      session_cache_.erase(it);
+    }
+  }
+
+  // SSL_set_session() takes its own reference.
+  SSL_set_session(ssl, session.get());
+}
+
+void ClientContextImpl::storeSession(SSL* ssl, const std::string& session_key) {
+  bssl::UniquePtr<SSL_SESSION> session(SSL_get1_session(ssl));
+  if (!session) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(session_cache_lock_);
+  if (session_cache_.size() >= MAX_SESSION_HOSTS && session_cache_.count(session_key) == 0) {
+    session_cache_.clear();
+  }
+
+  std::list<bssl::UniquePtr<SSL_SESSION>>& sessions = session_cache_[session_key];
+  sessions.push_front(std::move(session));
+  if (sessions.size() > MAX_SESSIONS_PER_HOST) {
+    sessions.pop_back();
+  }
+}
+
 ServerContextImpl::ServerContextImpl(ContextManagerImpl& parent, Stats::Scope& scope,
                                      ServerContextConfig& config, Runtime::Loader& runtime)
     : ContextImpl(parent, scope, config), runtime_(runtime) {
@@ -370,6 +431,81 @@ ServerContextImpl::ServerContextImpl(ContextManagerImpl& parent, Stats::Scope& s
                                },
                                this);
   }
+
+  for (const std::string& path : config.sessionTicketKeyPaths()) {
+    session_ticket_keys_.push_back(loadSessionTicketKey(path));
+  }
+
+  if (!session_ticket_keys_.empty()) {
+    SSL_CTX_set_app_data(ctx_.get(), this);
+    SSL_CTX_set_tlsext_ticket_key_cb(
+        ctx_.get(), [](SSL* ssl, uint8_t* key_name, uint8_t* iv, EVP_CIPHER_CTX* ctx,
+                       HMAC_CTX* hmac_ctx, int encrypt) -> int {
+          ServerContextImpl* context_impl =
+              static_cast<ServerContextImpl*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+          return context_impl->sessionTicketProcess(key_name, iv, ctx, hmac_ctx, encrypt);
+        });
+  }
+}
+
+ServerContextImpl::SessionTicketKey
+ServerContextImpl::loadSessionTicketKey(const std::string& path) {
+  const std::string key_data = Filesystem::fileReadToEnd(path);
+  SessionTicketKey key;
+  if (key_data.size() != key.name_.size() + key.hmac_key_.size() + key.aes_key_.size()) {
+    throw EnvoyException(fmt::format("Session ticket key file {} must be {} bytes, not {}", path,
+                                     key.name_.size() + key.hmac_key_.size() +
+                                         key.aes_key_.size(),
+                                     key_data.size()));
+  }
+
+  auto pos = key_data.begin();
+  std::copy_n(pos, key.name_.size(), key.name_.begin());
+  pos += key.name_.size();
+  std::copy_n(pos, key.hmac_key_.size(), key.hmac_key_.begin());
+  pos += key.hmac_key_.size();
+  std::copy_n(pos, key.aes_key_.size(), key.aes_key_.begin());
+  return key;
+}
+
+int ServerContextImpl::sessionTicketProcess(uint8_t* key_name, uint8_t* iv, EVP_CIPHER_CTX* ctx,
+                                            HMAC_CTX* hmac_ctx, int encrypt) {
+  const EVP_MD* hmac_hash = EVP_sha256();
+  const EVP_CIPHER* cipher = EVP_aes_256_cbc();
+
+  if (encrypt == 1) {
+    // Encrypt new tickets with the first key.
+    const SessionTicketKey& key = session_ticket_keys_.front();
+    static_assert(std::tuple_size<decltype(key.name_)>::value == SSL_TICKET_KEY_NAME_LEN,
+                  "Expected key name length to match BoringSSL");
+    std::copy_n(key.name_.begin(), SSL_TICKET_KEY_NAME_LEN, key_name);
+
+    RELEASE_ASSERT(RAND_bytes(iv, EVP_CIPHER_iv_length(cipher)) == 1);
+    RELEASE_ASSERT(EVP_EncryptInit_ex(ctx, cipher, nullptr, key.aes_key_.data(), iv) == 1);
+    RELEASE_ASSERT(HMAC_Init_ex(hmac_ctx, key.hmac_key_.data(), key.hmac_key_.size(), hmac_hash,
+                                nullptr) == 1);
+    return 1;
+  }
+
+  // Decrypt with whichever key the ticket names. Tickets under an older key are accepted but
+  // renewed, so clients move to the current key.
+  for (size_t i = 0; i < session_ticket_keys_.size(); ++i) {
+    const SessionTicketKey& key = session_ticket_keys_[i];
+    if (!std::equal(key.name_.begin(), key.name_.end(), key_name)) {
+      continue;
+    }
+
+    if (HMAC_Init_ex(hmac_ctx, key.hmac_key_.data(), key.hmac_key_.size(), hmac_hash, nullptr) !=
+            1 ||
+        EVP_DecryptInit_ex(ctx, cipher, nullptr, key.aes_key_.data(), iv) != 1) {
+      return 0;
+    }
+    return i == 0 ? 1 : 2;
+  }
+
+  // Unknown key, fall back to a full handshake.
+  stats_.session_ticket_key_miss_.inc();
+  return 0;
 }
 
 } // namespace Ssl
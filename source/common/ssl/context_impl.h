@@ -1,11 +1,16 @@
 #pragma once
 
+#include <array>
+#include <list>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "envoy/runtime/runtime.h"
 #include "envoy/ssl/context.h"
 #include "envoy/ssl/context_config.h"
+#include "envoy/ssl/private_key_method.h"
 #include "envoy/stats/stats.h"
 #include "envoy/stats/stats_macros.h"
 
@@ -29,7 +34,9 @@ namespace Ssl {
   COUNTER(fail_verify_no_cert)                                                                     \
   COUNTER(fail_verify_error)                                                                       \
   COUNTER(fail_verify_san)                                                                         \
-  COUNTER(fail_verify_cert_hash)
+  COUNTER(fail_verify_cert_hash)                                                                   \
+  COUNTER(session_reused)                                                                          \
+  COUNTER(session_ticket_key_miss)
 // clang-format on
 
 /**
@@ -70,6 +77,14 @@ public:
 
   SslStats& stats() { return stats_; }
 
+  /**
+   * @return PrivateKeyMethodProvider* the provider performing private key operations for
+   *         connections using this context, or nullptr if the key is loaded into the context.
+   */
+  PrivateKeyMethodProvider* privateKeyMethodProvider() {
+    return private_key_method_provider_.get();
+  }
+
   // Ssl::Context
   size_t daysUntilFirstCertExpires() override;
   std::string getCaCertInformation() override;
@@ -115,9 +130,12 @@ protected:
   SslStats stats_;
   std::vector<uint8_t> parsed_alpn_protocols_;
   bssl::UniquePtr<X509> ca_cert_;
+  // Shared with the other contexts that use the same certificate.
+  CertificateDataConstSharedPtr certificate_;
   bssl::UniquePtr<X509> cert_chain_;
   std::string ca_file_path_;
   std::string cert_chain_file_path_;
+  PrivateKeyMethodProviderSharedPtr private_key_method_provider_;
 };
 
 class ClientContextImpl : public ContextImpl, public ClientContext {
@@ -126,8 +144,32 @@ public:
 
   bssl::UniquePtr<SSL> newSsl() const override;
 
+  /**
+   * Offer a cached session for the upstream host, if any, on a new connection. A cached session is
+   * handed to a single connection and returns to the cache once that connection completes its
+   * handshake, so TLS 1.3 tickets are never reused.
+   * @param ssl supplies the new connection.
+   * @param session_key supplies the upstream host the connection is for.
+   */
+  void resumeSession(SSL* ssl, const std::string& session_key);
+
+  /**
+   * Cache the session of a connection that completed its handshake.
+   * @param ssl supplies the connection.
+   * @param session_key supplies the upstream host the connection is for.
+   */
+  void storeSession(SSL* ssl, const std::string& session_key);
+
 private:
+  // Sessions kept per upstream host, newest first.
+  static const size_t MAX_SESSIONS_PER_HOST = 4;
+  // Bounds the cache for clusters whose membership churns.
+  static const size_t MAX_SESSION_HOSTS = 1024;
+
   std::string server_name_indication_;
+  // The context is shared by all workers.
+  std::mutex session_cache_lock_;
+  std::unordered_map<std::string, std::list<bssl::UniquePtr<SSL_SESSION>>> session_cache_;
 };
 
 class ServerContextImpl : public ContextImpl, public ServerContext {
@@ -136,11 +178,25 @@ public:
                     Runtime::Loader& runtime);
 
 private:
+  /**
+   * Session ticket key in the same 80 byte layout as nginx and OpenSSL key files: a 16 byte key
+   * name, followed by a 32 byte HMAC secret and a 32 byte AES-256 key.
+   */
+  struct SessionTicketKey {
+    std::array<uint8_t, 16> name_;
+    std::array<uint8_t, 32> hmac_key_;
+    std::array<uint8_t, 32> aes_key_;
+  };
+
   int alpnSelectCallback(const unsigned char** out, unsigned char* outlen, const unsigned char* in,
                          unsigned int inlen);
+  int sessionTicketProcess(uint8_t* key_name, uint8_t* iv, EVP_CIPHER_CTX* ctx,
+                           HMAC_CTX* hmac_ctx, int encrypt);
+  static SessionTicketKey loadSessionTicketKey(const std::string& path);
 
   Runtime::Loader& runtime_;
   std::vector<uint8_t> parsed_alt_alpn_protocols_;
+  std::vector<SessionTicketKey> session_ticket_keys_;
 };
 
 } // Ssl
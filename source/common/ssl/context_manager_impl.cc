@@ -1,15 +1,28 @@
 #include "common/ssl/context_manager_impl.h"
 
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <string>
+
+#include "envoy/common/exception.h"
 
 #include "common/common/assert.h"
+#include "common/common/hex.h"
+#include "common/filesystem/filesystem_impl.h"
 #include "common/ssl/context_impl.h"
 
+#include "openssl/err.h"
+#include "openssl/pem.h"
+#include "openssl/sha.h"
+
 namespace Envoy {
 namespace Ssl {
 
-ContextManagerImpl::~ContextManagerImpl() { ASSERT(contexts_.empty()); }
+ContextManagerImpl::~ContextManagerImpl() {
+  ASSERT(contexts_.empty());
+  ASSERT(certificates_.empty());
+}
 
 void ContextManagerImpl::releaseContext(Context* context) {
   std::unique_lock<std::mutex> lock(contexts_lock_);
@@ -34,6 +47,90 @@ ServerContextPtr ContextManagerImpl::createSslServerContext(Stats::Scope& scope,
   return context;
 }
 
+CertificateDataConstSharedPtr
+ContextManagerImpl::loadCertificate(const std::string& cert_chain_file,
+                                    const std::string& private_key_file) {
+  if (!Filesystem::fileExists(cert_chain_file)) {
+    throw EnvoyException(fmt::format("Failed to load certificate '{}'", cert_chain_file));
+  }
+  const std::string cert_chain = Filesystem::fileReadToEnd(cert_chain_file);
+  std::string private_key;
+  if (!private_key_file.empty()) {
+    if (!Filesystem::fileExists(private_key_file)) {
+      throw EnvoyException(fmt::format("Failed to load private key file {}", private_key_file));
+    }
+    private_key = Filesystem::fileReadToEnd(private_key_file);
+  }
+
+  // The files are identified by their contents, so a certificate that is rotated in place is
+  // parsed again while copies of one under different paths are not.
+  std::string key;
+  for (const std::string* contents : {&cert_chain, &private_key}) {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const uint8_t*>(contents->data()), contents->size(), digest);
+    key += Hex::encode(digest, sizeof(digest));
+  }
+
+  // Parsing happens under the lock, so that contexts that are created at the same time with the
+  // same files parse them only once.
+  std::unique_lock<std::mutex> lock(certificates_lock_);
+  auto it = certificates_.find(key);
+  if (it != certificates_.end()) {
+    CertificateDataConstSharedPtr data = it->second.lock();
+    if (data) {
+      return data;
+    }
+  }
+
+  std::unique_ptr<CertificateData> data(new CertificateData());
+  bssl::UniquePtr<BIO> bio(BIO_new_mem_buf(cert_chain.data(), cert_chain.size()));
+  RELEASE_ASSERT(bio);
+  data->leaf_.reset(PEM_read_bio_X509_AUX(bio.get(), nullptr, nullptr, nullptr));
+  if (!data->leaf_) {
+    throw EnvoyException(fmt::format("Failed to load certificate '{}'", cert_chain_file));
+  }
+
+  // As with SSL_CTX_use_certificate_chain_file(), the certificates that follow the leaf are its
+  // intermediates, and running out of them is not an error.
+  while (true) {
+    bssl::UniquePtr<X509> intermediate(PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr));
+    if (!intermediate) {
+      const uint32_t error = ERR_peek_last_error();
+      if (ERR_GET_LIB(error) == ERR_LIB_PEM && ERR_GET_REASON(error) == PEM_R_NO_START_LINE) {
+        ERR_clear_error();
+        break;
+      }
+      throw EnvoyException(
+          fmt::format("Failed to load certificate chain file {}", cert_chain_file));
+    }
+    data->intermediates_.push_back(std::move(intermediate));
+  }
+
+  if (!private_key_file.empty()) {
+    bssl::UniquePtr<BIO> key_bio(BIO_new_mem_buf(private_key.data(), private_key.size()));
+    RELEASE_ASSERT(key_bio);
+    data->private_key_.reset(PEM_read_bio_PrivateKey(key_bio.get(), nullptr, nullptr, nullptr));
+    if (!data->private_key_) {
+      throw EnvoyException(fmt::format("Failed to load private key file {}", private_key_file));
+    }
+  }
+
+  // The entry goes away with the last context that uses it.
+  CertificateDataConstSharedPtr shared_data(
+      data.release(), [this, key](const CertificateData* data) -> void {
+        {
+          std::unique_lock<std::mutex> lock(certificates_lock_);
+          auto it = certificates_.find(key);
+          if (it != certificates_.end() && it->second.expired()) {
+            certificates_.erase(it);
+          }
+        }
+        delete data;
+      });
+  certificates_[key] = shared_data;
+  return shared_data;
+}
+
 size_t ContextManagerImpl::daysUntilFirstCertExpires() {
   std::unique_lock<std::mutex> lock(contexts_lock_);
   size_t ret = std::numeric_limits<int>::max();
@@ -2,14 +2,33 @@
 
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "envoy/runtime/runtime.h"
 #include "envoy/ssl/context_manager.h"
 
+#include "openssl/ssl.h"
+
 namespace Envoy {
 namespace Ssl {
 
+/**
+ * A certificate chain and its private key, parsed from PEM files.
+ */
+struct CertificateData {
+  bssl::UniquePtr<X509> leaf_;
+  std::vector<bssl::UniquePtr<X509>> intermediates_;
+  // nullptr if the private key is not loaded, e.g. because a private key method performs the
+  // private key operations.
+  bssl::UniquePtr<EVP_PKEY> private_key_;
+};
+
+typedef std::shared_ptr<const CertificateData> CertificateDataConstSharedPtr;
+
 /**
  * The SSL context manager has the following threading model:
  * Contexts can be allocated via any thread (through in practice they are only allocated on the main
@@ -29,6 +48,20 @@ public:
    */
   void releaseContext(Context* context);
 
+  /**
+   * Parses a certificate chain and its private key. Contexts whose files have the same contents
+   * share the result for as long as any of them uses it, so that a certificate that many listeners
+   * or clusters repeat is parsed and held in memory only once.
+   * @param cert_chain_file supplies the PEM file with the leaf certificate followed by its
+   *        intermediates.
+   * @param private_key_file supplies the PEM file with the private key, or the empty string to not
+   *        load one.
+   * @return CertificateDataConstSharedPtr the parsed certificates and key.
+   * @throw EnvoyException if a file cannot be read or parsed.
+   */
+  CertificateDataConstSharedPtr loadCertificate(const std::string& cert_chain_file,
+                                                const std::string& private_key_file);
+
   // Ssl::ContextManager
   Ssl::ClientContextPtr createSslClientContext(Stats::Scope& scope,
                                                ClientContextConfig& config) override;
@@ -41,6 +74,9 @@ private:
   Runtime::Loader& runtime_;
   std::list<Context*> contexts_;
   std::mutex contexts_lock_;
+  // Keyed by the SHA-256 digests of the certificate chain and private key files.
+  std::unordered_map<std::string, std::weak_ptr<const CertificateData>> certificates_;
+  std::mutex certificates_lock_;
 };
 
 } // namespace Ssl
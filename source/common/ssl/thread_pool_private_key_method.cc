@@ -0,0 +1,233 @@
+#include "common/ssl/thread_pool_private_key_method.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/assert.h"
+
+#include "openssl/evp.h"
+#include "openssl/pem.h"
+#include "openssl/rsa.h"
+#include "spdlog/spdlog.h"
+
+namespace Envoy {
+namespace Ssl {
+
+ThreadPoolPrivateKeyMethodProvider::ThreadPoolPrivateKeyMethodProvider(
+    const std::string& private_key_file, uint32_t threads) {
+  std::unique_ptr<FILE, decltype(&fclose)> fp(fopen(private_key_file.c_str(), "r"), &fclose);
+  if (fp.get() != nullptr) {
+    private_key_.reset(PEM_read_PrivateKey(fp.get(), nullptr, nullptr, nullptr));
+  }
+  if (private_key_ == nullptr) {
+    throw EnvoyException(fmt::format("Failed to load private key file {}", private_key_file));
+  }
+
+  method_.sign = sign;
+  method_.decrypt = decrypt;
+  method_.complete = complete;
+
+  for (uint32_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(new Thread::Thread([this]() -> void { threadRoutine(); }));
+  }
+}
+
+ThreadPoolPrivateKeyMethodProvider::~ThreadPoolPrivateKeyMethodProvider() {
+  {
+    std::unique_lock<std::mutex> lock(queue_lock_);
+    shutdown_ = true;
+  }
+  queue_cv_.notify_all();
+  for (Thread::ThreadPtr& thread : threads_) {
+    thread->join();
+  }
+}
+
+int ThreadPoolPrivateKeyMethodProvider::sslIndex() {
+  static const int ssl_index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  RELEASE_ASSERT(ssl_index >= 0);
+  return ssl_index;
+}
+
+ThreadPoolPrivateKeyMethodProvider::ConnectionStateSharedPtr&
+ThreadPoolPrivateKeyMethodProvider::connectionState(SSL* ssl) {
+  ConnectionStateSharedPtr* state =
+      static_cast<ConnectionStateSharedPtr*>(SSL_get_ex_data(ssl, sslIndex()));
+  ASSERT(state != nullptr);
+  return *state;
+}
+
+void ThreadPoolPrivateKeyMethodProvider::registerConnection(
+    SSL* ssl, PrivateKeyConnectionCallbacks& callbacks, Event::Dispatcher& dispatcher) {
+  ASSERT(SSL_get_ex_data(ssl, sslIndex()) == nullptr);
+  SSL_set_ex_data(ssl, sslIndex(), new ConnectionStateSharedPtr(std::make_shared<ConnectionState>(
+                                       *this, callbacks, dispatcher)));
+}
+
+void ThreadPoolPrivateKeyMethodProvider::unregisterConnection(SSL* ssl) {
+  ConnectionStateSharedPtr* state =
+      static_cast<ConnectionStateSharedPtr*>(SSL_get_ex_data(ssl, sslIndex()));
+  if (state == nullptr) {
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock((*state)->lock_);
+    (*state)->callbacks_ = nullptr;
+  }
+  SSL_set_ex_data(ssl, sslIndex(), nullptr);
+  delete state;
+}
+
+ssl_private_key_result_t
+ThreadPoolPrivateKeyMethodProvider::sign(SSL* ssl, uint8_t*, size_t*, size_t,
+                                         uint16_t signature_algorithm, const uint8_t* in,
+                                         size_t in_len) {
+  ConnectionStateSharedPtr& state = connectionState(ssl);
+  EVP_PKEY* private_key = state->parent_.private_key_.get();
+  const EVP_MD* digest = SSL_get_signature_algorithm_digest(signature_algorithm);
+  const bool rsa_pss = SSL_is_signature_algorithm_rsa_pss(signature_algorithm);
+  std::vector<uint8_t> input(in, in + in_len);
+
+  state->parent_.startOperation(
+      state, [private_key, digest, rsa_pss, input](std::vector<uint8_t>& output) -> bool {
+        bssl::ScopedEVP_MD_CTX ctx;
+        EVP_PKEY_CTX* pkey_ctx;
+        if (!EVP_DigestSignInit(ctx.get(), &pkey_ctx, digest, nullptr, private_key)) {
+          return false;
+        }
+        if (rsa_pss && (!EVP_PKEY_CTX_set_rsa_padding(pkey_ctx, RSA_PKCS1_PSS_PADDING) ||
+                        !EVP_PKEY_CTX_set_rsa_pss_saltlen(pkey_ctx, -1))) {
+          return false;
+        }
+
+        size_t output_len;
+        if (!EVP_DigestSign(ctx.get(), nullptr, &output_len, input.data(), input.size())) {
+          return false;
+        }
+        output.resize(output_len);
+        if (!EVP_DigestSign(ctx.get(), output.data(), &output_len, input.data(), input.size())) {
+          return false;
+        }
+        output.resize(output_len);
+        return true;
+      });
+  return ssl_private_key_retry;
+}
+
+ssl_private_key_result_t ThreadPoolPrivateKeyMethodProvider::decrypt(SSL* ssl, uint8_t*, size_t*,
+                                                                     size_t, const uint8_t* in,
+                                                                     size_t in_len) {
+  ConnectionStateSharedPtr& state = connectionState(ssl);
+  RSA* rsa = EVP_PKEY_get0_RSA(state->parent_.private_key_.get());
+  if (rsa == nullptr) {
+    return ssl_private_key_failure;
+  }
+  std::vector<uint8_t> input(in, in + in_len);
+
+  state->parent_.startOperation(state, [rsa, input](std::vector<uint8_t>& output) -> bool {
+    // BoringSSL does the padding checks itself, so the operation is raw RSA.
+    output.resize(RSA_size(rsa));
+    size_t output_len;
+    if (!RSA_decrypt(rsa, &output_len, output.data(), output.size(), input.data(), input.size(),
+                     RSA_NO_PADDING)) {
+      return false;
+    }
+    output.resize(output_len);
+    return true;
+  });
+  return ssl_private_key_retry;
+}
+
+ssl_private_key_result_t ThreadPoolPrivateKeyMethodProvider::complete(SSL* ssl, uint8_t* out,
+                                                                      size_t* out_len,
+                                                                      size_t max_out) {
+  ConnectionStateSharedPtr& state = connectionState(ssl);
+  if (state->pending_) {
+    return ssl_private_key_retry;
+  }
+  if (state->failed_ || state->output_.size() > max_out) {
+    return ssl_private_key_failure;
+  }
+
+  std::copy(state->output_.begin(), state->output_.end(), out);
+  *out_len = state->output_.size();
+  state->output_.clear();
+  return ssl_private_key_success;
+}
+
+void ThreadPoolPrivateKeyMethodProvider::startOperation(const ConnectionStateSharedPtr& state,
+                                                        Operation operation) {
+  ASSERT(!state->pending_);
+  state->pending_ = true;
+  state->failed_ = false;
+
+  std::function<void()> task = [state, operation]() -> void {
+    std::vector<uint8_t> output;
+    const bool ok = operation(output);
+
+    // The connection and its dispatcher may be gone, in which case the result is dropped.
+    std::unique_lock<std::mutex> lock(state->lock_);
+    if (state->callbacks_ == nullptr) {
+      return;
+    }
+    state->dispatcher_.post([state, ok, output]() -> void {
+      state->pending_ = false;
+      state->failed_ = !ok;
+      state->output_ = output;
+      if (state->callbacks_ != nullptr) {
+        state->callbacks_->onPrivateKeyMethodComplete();
+      }
+    });
+  };
+
+  {
+    std::unique_lock<std::mutex> lock(queue_lock_);
+    queue_.push_back(std::move(task));
+  }
+  queue_cv_.notify_one();
+}
+
+void ThreadPoolPrivateKeyMethodProvider::threadRoutine() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(queue_lock_);
+      queue_cv_.wait(lock, [this]() -> bool { return shutdown_ || !queue_.empty(); });
+      if (shutdown_) {
+        return;
+      }
+      task = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    task();
+  }
+}
+
+PrivateKeyMethodProviderSharedPtr
+ThreadPoolPrivateKeyMethodFactory::createPrivateKeyMethodProvider(
+    const Json::Object& config, const std::string& private_key_file) {
+  const int64_t threads = config.getInteger("threads", 2);
+  if (threads < 1) {
+    throw EnvoyException(
+        fmt::format("Invalid thread pool private key method threads: {}", threads));
+  }
+  return std::make_shared<ThreadPoolPrivateKeyMethodProvider>(private_key_file, threads);
+}
+
+std::string ThreadPoolPrivateKeyMethodFactory::name() { return "envoy.thread_pool"; }
+
+/**
+ * Static registration for the thread pool private key method provider. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<ThreadPoolPrivateKeyMethodFactory,
+                                 PrivateKeyMethodProviderFactory>
+    register_;
+
+} // namespace Ssl
+} // namespace Envoy
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "envoy/registry/registry.h"
+#include "envoy/ssl/private_key_method.h"
+
+#include "common/common/thread.h"
+
+#include "openssl/ssl.h"
+
+namespace Envoy {
+namespace Ssl {
+
+/**
+ * Private key method provider that runs private key operations on a pool of offload threads, so a
+ * burst of handshakes doesn't stall the event loops of the workers. Each operation's result is
+ * posted back to the dispatcher of the connection that started it.
+ */
+class ThreadPoolPrivateKeyMethodProvider : public PrivateKeyMethodProvider {
+public:
+  ThreadPoolPrivateKeyMethodProvider(const std::string& private_key_file, uint32_t threads);
+  ~ThreadPoolPrivateKeyMethodProvider();
+
+  // Ssl::PrivateKeyMethodProvider
+  void registerConnection(SSL* ssl, PrivateKeyConnectionCallbacks& callbacks,
+                          Event::Dispatcher& dispatcher) override;
+  void unregisterConnection(SSL* ssl) override;
+  const SSL_PRIVATE_KEY_METHOD& privateKeyMethod() override { return method_; }
+
+private:
+  // Operation state of one connection. It is shared with the offload thread running an operation,
+  // which may finish after the connection is gone.
+  struct ConnectionState {
+    ConnectionState(ThreadPoolPrivateKeyMethodProvider& parent,
+                    PrivateKeyConnectionCallbacks& callbacks, Event::Dispatcher& dispatcher)
+        : parent_(parent), callbacks_(&callbacks), dispatcher_(dispatcher) {}
+
+    ThreadPoolPrivateKeyMethodProvider& parent_;
+    // Guards callbacks_ against the offload threads. Cleared when the connection unregisters, after
+    // which the dispatcher may be gone too.
+    std::mutex lock_;
+    PrivateKeyConnectionCallbacks* callbacks_;
+    Event::Dispatcher& dispatcher_;
+    // Only accessed on the dispatcher thread.
+    bool pending_{};
+    bool failed_{};
+    std::vector<uint8_t> output_;
+  };
+
+  typedef std::shared_ptr<ConnectionState> ConnectionStateSharedPtr;
+  // Computes the output of an operation, returning false on failure.
+  typedef std::function<bool(std::vector<uint8_t>& output)> Operation;
+
+  static int sslIndex();
+  static ConnectionStateSharedPtr& connectionState(SSL* ssl);
+  static ssl_private_key_result_t sign(SSL* ssl, uint8_t* out, size_t* out_len, size_t max_out,
+                                       uint16_t signature_algorithm, const uint8_t* in,
+                                       size_t in_len);
+  static ssl_private_key_result_t decrypt(SSL* ssl, uint8_t* out, size_t* out_len, size_t max_out,
+                                          const uint8_t* in, size_t in_len);
+  static ssl_private_key_result_t complete(SSL* ssl, uint8_t* out, size_t* out_len,
+                                           size_t max_out);
+
+  void startOperation(const ConnectionStateSharedPtr& state, Operation operation);
+  void threadRoutine();
+
+  bssl::UniquePtr<EVP_PKEY> private_key_;
+  SSL_PRIVATE_KEY_METHOD method_{};
+  std::mutex queue_lock_;
+  std::condition_variable queue_cv_;
+  std::list<std::function<void()>> queue_;
+  bool shutdown_{};
+  std::vector<Thread::ThreadPtr> threads_;
+};
+
+/**
+ * Config registration for the thread pool private key method provider.
+ * @see PrivateKeyMethodProviderFactory.
+ */
+class ThreadPoolPrivateKeyMethodFactory : public PrivateKeyMethodProviderFactory {
+public:
+  // Ssl::PrivateKeyMethodProviderFactory
+  PrivateKeyMethodProviderSharedPtr
+  createPrivateKeyMethodProvider(const Json::Object& config,
+                                 const std::string& private_key_file) override;
+  std::string name() override;
+};
+
+} // namespace Ssl
+} // namespace Envoy
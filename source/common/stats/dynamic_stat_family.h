@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "envoy/thread_local/thread_local.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * A bounded family of stat groups that are named after a dynamic key, such as the stats of each
+ * DynamoDB table or Mongo collection. Building the names of such stats and looking them up on every
+ * request is expensive, and a client sending arbitrary keys could create any number of stats.
+ * Instead, a group of prebuilt stat handles is built once per key, and at most max_keys keys get a
+ * group of their own. All other keys share an overflow group. Each thread caches the groups it has
+ * used, so a key that has been seen before is looked up without taking a lock.
+ */
+template <class Group> class DynamicStatFamily {
+public:
+  typedef std::function<Group*(const std::string& name)> GroupFactory;
+
+  /**
+   * @param tls supplies the slot allocator for the per-thread caches.
+   * @param max_keys supplies the maximum number of keys that get a group of their own.
+   * @param overflow_name supplies the name of the overflow group.
+   * @param factory supplies the factory that builds a group. It is called with a key, or with
+   *        overflow_name for the overflow group.
+   */
+  DynamicStatFamily(ThreadLocal::SlotAllocator& tls, uint32_t max_keys,
+                    const std::string& overflow_name, GroupFactory factory)
+      : max_keys_(max_keys), factory_(factory), overflow_(factory(overflow_name)),
+        tls_(tls.allocateSlot()) {
+    tls_->set([](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+      return std::make_shared<ThreadCache>();
+    });
+  }
+
+  /**
+   * @return Group& the group of a key, or the overflow group if max_keys other keys already have a
+   *         group.
+   */
+  Group& get(const std::string& key) {
+    ThreadCache& cache = tls_->getTyped<ThreadCache>();
+    auto cached = cache.groups_.find(key);
+    if (cached != cache.groups_.end()) {
+      return *cached->second;
+    }
+
+    Group& group = admit(key);
+    // Keys charged to the overflow group are only cached while the cache is small, so that a client
+    // sending arbitrary keys cannot grow it without bound.
+    if (&group != overflow_.get() || cache.groups_.size() < 2 * max_keys_) {
+      cache.groups_.emplace(key, &group);
+    }
+    return group;
+  }
+
+private:
+  struct ThreadCache : public ThreadLocal::ThreadLocalObject {
+    std::unordered_map<std::string, Group*> groups_;
+  };
+
+  Group& admit(const std::string& key) {
+    std::unique_lock<std::mutex> lock(lock_);
+    auto existing = groups_.find(key);
+    if (existing != groups_.end()) {
+      return *existing->second;
+    }
+    if (groups_.size() >= max_keys_) {
+      return *overflow_;
+    }
+
+    Group* group = factory_(key);
+    groups_.emplace(key, std::unique_ptr<Group>{group});
+    return *group;
+  }
+
+  const uint32_t max_keys_;
+  GroupFactory factory_;
+  std::unique_ptr<Group> overflow_;
+  std::mutex lock_;
+  std::unordered_map<std::string, std::unique_ptr<Group>> groups_;
+  ThreadLocal::SlotPtr tls_;
+};
+
+} // namespace Stats
+} // namespace Envoy
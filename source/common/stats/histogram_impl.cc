@@ -0,0 +1,188 @@
+#include "common/stats/histogram_impl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+namespace Envoy {
+namespace Stats {
+
+uint32_t HistogramBuckets::index(uint64_t value) {
+  if (value < SUB_BUCKETS) {
+    return value;
+  }
+
+  // Values in [2^msb, 2^(msb+1)) are counted in the group for msb, keeping SUB_BUCKET_BITS bits
+  // of precision below the most significant bit.
+  const uint32_t msb = 63 - __builtin_clzll(value);
+  const uint32_t shift = msb - SUB_BUCKET_BITS;
+  return shift * SUB_BUCKETS + (value >> shift);
+}
+
+double HistogramBuckets::lowerBound(uint32_t index) {
+  if (index < 2 * SUB_BUCKETS) {
+    return index;
+  }
+
+  const uint32_t shift = index / SUB_BUCKETS - 1;
+  return std::ldexp(index % SUB_BUCKETS + SUB_BUCKETS, shift);
+}
+
+double HistogramBuckets::upperBound(uint32_t index) { return lowerBound(index + 1); }
+
+void HistogramStatisticsImpl::addBucket(uint32_t index, uint64_t count) {
+  if (counts_.size() <= index) {
+    counts_.resize(index + 1);
+  }
+
+  counts_[index] += count;
+  count_ += count;
+}
+
+void HistogramStatisticsImpl::add(const HistogramStatisticsImpl& other) {
+  if (counts_.size() < other.counts_.size()) {
+    counts_.resize(other.counts_.size());
+  }
+
+  for (size_t i = 0; i < other.counts_.size(); i++) {
+    counts_[i] += other.counts_[i];
+  }
+
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+void HistogramStatisticsImpl::clear() {
+  counts_.clear();
+  count_ = 0;
+  sum_ = 0;
+}
+
+double HistogramStatisticsImpl::quantile(double quantile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+
+  // Find the bucket that holds the sample at the requested rank, and interpolate linearly inside
+  // of it. Samples are integers so the largest value a bucket can hold is its upper bound - 1.
+  const double rank = std::min(std::max(quantile, 0.0), 1.0) * count_;
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < counts_.size(); i++) {
+    if (counts_[i] == 0) {
+      continue;
+    }
+
+    if (cumulative + counts_[i] >= rank) {
+      const double fraction = (rank - cumulative) / counts_[i];
+      const double lower = HistogramBuckets::lowerBound(i);
+      return lower + (HistogramBuckets::upperBound(i) - 1 - lower) * fraction;
+    }
+
+    cumulative += counts_[i];
+  }
+
+  // Not reachable since the last non-empty bucket always covers the highest rank.
+  return HistogramBuckets::upperBound(counts_.size() - 1) - 1;
+}
+
+std::string HistogramStatisticsImpl::summary() const {
+  static const struct {
+    const char* label_;
+    double quantile_;
+  } quantiles[] = {{"P0", 0},     {"P25", 0.25}, {"P50", 0.5},     {"P75", 0.75},
+                   {"P90", 0.9},  {"P95", 0.95}, {"P99", 0.99},    {"P99.9", 0.999},
+                   {"P100", 1}};
+
+  std::string summary;
+  for (const auto& entry : quantiles) {
+    if (!summary.empty()) {
+      summary += ", ";
+    }
+    summary += entry.label_;
+    summary += ": ";
+    summary += std::to_string(std::llround(quantile(entry.quantile_)));
+  }
+
+  return summary;
+}
+
+HistogramBucketArray::HistogramBucketArray() {
+  for (std::atomic<Group*>& group : groups_) {
+    group = nullptr;
+  }
+}
+
+HistogramBucketArray::~HistogramBucketArray() {
+  for (std::atomic<Group*>& group : groups_) {
+    delete group.load();
+  }
+}
+
+void HistogramBucketArray::record(uint64_t value) {
+  const uint32_t index = HistogramBuckets::index(value);
+  std::atomic<Group*>& group_ref = groups_[index / HistogramBuckets::SUB_BUCKETS];
+  Group* group = group_ref.load(std::memory_order_acquire);
+  if (!group) {
+    // Only the first record into a range of values allocates. When racing with another thread the
+    // loser frees its group and uses the winner's.
+    Group* new_group = new Group();
+    if (group_ref.compare_exchange_strong(group, new_group, std::memory_order_acq_rel)) {
+      group = new_group;
+    } else {
+      delete new_group;
+    }
+  }
+
+  group->counts_[index % HistogramBuckets::SUB_BUCKETS].fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+void HistogramBucketArray::drain(HistogramStatisticsImpl& statistics) {
+  for (uint32_t i = 0; i < HistogramBuckets::NUM_GROUPS; i++) {
+    Group* group = groups_[i].load(std::memory_order_acquire);
+    if (!group) {
+      continue;
+    }
+
+    for (uint32_t j = 0; j < HistogramBuckets::SUB_BUCKETS; j++) {
+      const uint64_t count = group->counts_[j].exchange(0, std::memory_order_relaxed);
+      if (count > 0) {
+        statistics.addBucket(i * HistogramBuckets::SUB_BUCKETS + j, count);
+      }
+    }
+  }
+
+  statistics.addSum(sum_.exchange(0, std::memory_order_relaxed));
+}
+
+ThreadLocalHistogramSharedPtr ParentHistogramImpl::allocateThreadLocal() {
+  ThreadLocalHistogramSharedPtr tls_histogram = std::make_shared<ThreadLocalHistogramImpl>();
+  std::unique_lock<std::mutex> lock(lock_);
+  tls_histograms_.push_back(tls_histogram);
+  return tls_histogram;
+}
+
+void ParentHistogramImpl::merge() {
+  interval_.clear();
+  buckets_.drain(interval_);
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    for (auto it = tls_histograms_.begin(); it != tls_histograms_.end();) {
+      ThreadLocalHistogramSharedPtr tls_histogram = it->lock();
+      if (tls_histogram) {
+        tls_histogram->buckets_.drain(interval_);
+        ++it;
+      } else {
+        // The owning thread cache has been flushed. Anything it recorded since the last merge is
+        // lost, which is fine since this only happens when a scope is destroyed.
+        it = tls_histograms_.erase(it);
+      }
+    }
+  }
+
+  cumulative_.add(interval_);
+}
+
+} // namespace Stats
+} // namespace Envoy
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "envoy/stats/stats.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * Log-linear histogram bucketing. Every power of two range is split into SUB_BUCKETS linear
+ * buckets, so values below 2 * SUB_BUCKETS are counted exactly and all other values are counted
+ * with a relative error of at most 1 / SUB_BUCKETS.
+ */
+class HistogramBuckets {
+public:
+  static const uint32_t SUB_BUCKET_BITS = 4;
+  static const uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+  // One group of sub buckets for values below SUB_BUCKETS, and one for each power of two above.
+  static const uint32_t NUM_GROUPS = 64 - SUB_BUCKET_BITS + 1;
+  static const uint32_t NUM_BUCKETS = NUM_GROUPS * SUB_BUCKETS;
+
+  /**
+   * @return uint32_t the index of the bucket that counts a value.
+   */
+  static uint32_t index(uint64_t value);
+
+  /**
+   * @return double the smallest value counted by a bucket.
+   */
+  static double lowerBound(uint32_t index);
+
+  /**
+   * @return double the smallest value counted by the next bucket.
+   */
+  static double upperBound(uint32_t index);
+};
+
+/**
+ * Statistics over a set of bucket counts. Not thread safe.
+ */
+class HistogramStatisticsImpl : public HistogramStatistics {
+public:
+  /**
+   * Add samples to a bucket.
+   */
+  void addBucket(uint32_t index, uint64_t count);
+
+  /**
+   * Add to the sum of all samples. The samples themselves must be added via addBucket().
+   */
+  void addSum(uint64_t sum) { sum_ += sum; }
+
+  /**
+   * Add all samples of other to this.
+   */
+  void add(const HistogramStatisticsImpl& other);
+
+  /**
+   * Remove all samples.
+   */
+  void clear();
+
+  // Stats::HistogramStatistics
+  uint64_t sampleCount() const override { return count_; }
+  uint64_t sampleSum() const override { return sum_; }
+  double quantile(double quantile) const override;
+  std::string summary() const override;
+
+private:
+  // Only sized up to the highest bucket that has samples, which keeps typical latency histograms
+  // small.
+  std::vector<uint64_t> counts_;
+  uint64_t count_{};
+  uint64_t sum_{};
+};
+
+/**
+ * Lock free array of bucket counts. Groups of buckets are allocated on first use, so memory is
+ * only spent on the value ranges that are actually recorded.
+ */
+class HistogramBucketArray {
+public:
+  HistogramBucketArray();
+  ~HistogramBucketArray();
+
+  /**
+   * Record a value. Thread safe.
+   */
+  void record(uint64_t value);
+
+  /**
+   * Move all recorded samples into statistics, resetting the array. Thread safe with respect to
+   * concurrent record() calls; samples recorded concurrently end up in this or the next drain.
+   */
+  void drain(HistogramStatisticsImpl& statistics);
+
+private:
+  struct Group {
+    std::atomic<uint64_t> counts_[HistogramBuckets::SUB_BUCKETS]{};
+  };
+
+  std::atomic<Group*> groups_[HistogramBuckets::NUM_GROUPS];
+  std::atomic<uint64_t> sum_{};
+};
+
+/**
+ * The part of a histogram that is recorded into by a single thread.
+ */
+class ThreadLocalHistogramImpl {
+public:
+  void recordValue(uint64_t value) { buckets_.record(value); }
+
+private:
+  HistogramBucketArray buckets_;
+
+  friend class ParentHistogramImpl;
+};
+
+typedef std::shared_ptr<ThreadLocalHistogramImpl> ThreadLocalHistogramSharedPtr;
+
+/**
+ * Histogram implementation that owns the per thread histograms and merges them. Unlike counters
+ * and gauges, histograms always live on the heap and are not shared across a hot restart.
+ */
+class ParentHistogramImpl : public Histogram {
+public:
+  ParentHistogramImpl(const std::string& name) : name_(name) {}
+
+  /**
+   * @return ThreadLocalHistogramSharedPtr a new histogram for the calling thread to record into.
+   *         Its samples are included in every following merge() for as long as the caller keeps
+   *         it alive. Thread safe.
+   */
+  ThreadLocalHistogramSharedPtr allocateThreadLocal();
+
+  /**
+   * Record a value without a thread local histogram. This is used before threading has been
+   * initialized. Thread safe.
+   */
+  void recordValue(uint64_t value) { buckets_.record(value); }
+
+  // Stats::Histogram
+  void merge() override;
+  const HistogramStatistics& intervalStatistics() const override { return interval_; }
+  const HistogramStatistics& cumulativeStatistics() const override { return cumulative_; }
+  std::string name() override { return name_; }
+  bool used() override { return cumulative_.sampleCount() > 0; }
+
+private:
+  const std::string name_;
+  HistogramBucketArray buckets_;
+  // Only guards registration of thread local histograms. Recording never takes it.
+  std::mutex lock_;
+  std::vector<std::weak_ptr<ThreadLocalHistogramImpl>> tls_histograms_;
+  HistogramStatisticsImpl interval_;
+  HistogramStatisticsImpl cumulative_;
+};
+
+typedef std::shared_ptr<ParentHistogramImpl> ParentHistogramImplSharedPtr;
+
+} // namespace Stats
+} // namespace Envoy
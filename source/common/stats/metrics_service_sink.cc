@@ -0,0 +1,114 @@
+#include "common/stats/metrics_service_sink.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Stats {
+
+MetricsServiceSink::MetricsServiceSink(MetricsAsyncClientPtr&& client,
+                                       const LocalInfo::LocalInfo& local_info,
+                                       Stats::Scope& scope)
+    : service_method_(*Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+          "pb.envoy.metrics.MetricsService.StreamMetrics")),
+      client_(std::move(client)), local_info_(local_info),
+      stats_{ALL_METRICS_SERVICE_STATS(POOL_COUNTER_PREFIX(scope, "metrics_service."))} {}
+
+MetricsServiceSink::~MetricsServiceSink() {
+  if (stream_ != nullptr) {
+    stream_->resetStream();
+  }
+}
+
+void MetricsServiceSink::beginFlush() {
+  message_.Clear();
+  if (stream_ != nullptr) {
+    return;
+  }
+
+  // The IDs of the last stream mean nothing on a new one. A stream that fails to start closes
+  // before start() returns, and the flush is dropped in endFlush().
+  stat_ids_.clear();
+  stream_ = client_->start(service_method_, *this);
+  if (stream_ != nullptr) {
+    message_.mutable_identifier()->set_service_cluster(local_info_.clusterName());
+    message_.mutable_identifier()->set_service_node(local_info_.nodeName());
+  }
+}
+
+uint32_t MetricsServiceSink::statId(const std::string& name) {
+  auto id = stat_ids_.find(name);
+  if (id != stat_ids_.end()) {
+    return id->second;
+  }
+
+  const uint32_t new_id = stat_ids_.size();
+  stat_ids_.emplace(name, new_id);
+  pb::envoy::metrics::StreamMetricsMessage::Name* new_name = message_.add_names();
+  new_name->set_id(new_id);
+  new_name->set_name(name);
+  return new_id;
+}
+
+void MetricsServiceSink::flushCounter(const std::string& name, uint64_t delta) {
+  if (stream_ == nullptr) {
+    return;
+  }
+
+  pb::envoy::metrics::StreamMetricsMessage::Counter* counter = message_.add_counters();
+  counter->set_id(statId(name));
+  counter->set_delta(delta);
+}
+
+void MetricsServiceSink::flushGauge(const std::string& name, uint64_t value) {
+  if (stream_ == nullptr) {
+    return;
+  }
+
+  pb::envoy::metrics::StreamMetricsMessage::Gauge* gauge = message_.add_gauges();
+  gauge->set_id(statId(name));
+  gauge->set_value(value);
+}
+
+void MetricsServiceSink::flushHistogram(const std::string& name,
+                                        const HistogramStatistics& statistics) {
+  if (stream_ == nullptr) {
+    return;
+  }
+
+  static const double quantiles[] = {0, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1};
+  pb::envoy::metrics::StreamMetricsMessage::Histogram* histogram = message_.add_histograms();
+  histogram->set_id(statId(name));
+  histogram->set_sample_count(statistics.sampleCount());
+  histogram->set_sample_sum(statistics.sampleSum());
+  for (double quantile : quantiles) {
+    pb::envoy::metrics::StreamMetricsMessage::Histogram::Quantile* new_quantile =
+        histogram->add_quantiles();
+    new_quantile->set_quantile(quantile);
+    new_quantile->set_value(statistics.quantile(quantile));
+  }
+}
+
+void MetricsServiceSink::endFlush() {
+  if (stream_ == nullptr) {
+    stats_.flushes_dropped_.inc();
+    return;
+  }
+
+  stream_->sendMessage(message_, false);
+  stats_.flushes_sent_.inc();
+  message_.Clear();
+}
+
+void MetricsServiceSink::onRemoteClose(Grpc::Status::GrpcStatus status,
+                                       const std::string& message) {
+  ENVOY_LOG_MISC(debug, "metrics service stream closed: {}, {}", status, message);
+  stats_.stream_failure_.inc();
+  stream_ = nullptr;
+}
+
+} // namespace Stats
+} // namespace Envoy
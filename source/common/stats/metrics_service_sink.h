@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "envoy/grpc/async_client.h"
+#include "envoy/local_info/local_info.h"
+#include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "common/stats/metrics_service.pb.h"
+
+namespace Envoy {
+namespace Stats {
+
+/**
+ * All metrics service sink stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_METRICS_SERVICE_STATS(COUNTER)                                                         \
+  COUNTER(flushes_sent)                                                                            \
+  COUNTER(flushes_dropped)                                                                         \
+  COUNTER(stream_failure)
+// clang-format on
+
+/**
+ * Struct definition for all metrics service sink stats. @see stats_macros.h
+ */
+struct MetricsServiceStats {
+  ALL_METRICS_SERVICE_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+typedef Grpc::AsyncClient<pb::envoy::metrics::StreamMetricsMessage,
+                          pb::envoy::metrics::StreamMetricsResponse>
+    MetricsAsyncClient;
+typedef std::unique_ptr<MetricsAsyncClient> MetricsAsyncClientPtr;
+
+/**
+ * Sink that sends each stats flush to a collector over gRPC as one binary message, on a stream that
+ * lasts across flushes. The name of a stat is only sent the first time the stream carries the stat,
+ * and an ID stands for it after that. Counters are sent as deltas and histograms as a summary of
+ * their interval samples. A flush is dropped if the stream cannot be started, and the next flush
+ * tries again on a new stream, which names its stats anew.
+ */
+class MetricsServiceSink
+    : public Sink,
+      public Grpc::AsyncStreamCallbacks<pb::envoy::metrics::StreamMetricsResponse> {
+public:
+  MetricsServiceSink(MetricsAsyncClientPtr&& client, const LocalInfo::LocalInfo& local_info,
+                     Stats::Scope& scope);
+  ~MetricsServiceSink();
+
+  // Stats::Sink
+  void beginFlush() override;
+  void flushCounter(const std::string& name, uint64_t delta) override;
+  void flushGauge(const std::string& name, uint64_t value) override;
+  void endFlush() override;
+  void flushHistogram(const std::string& name, const HistogramStatistics& statistics) override;
+  void onHistogramComplete(const std::string&, uint64_t) override {
+    // Histograms are sent as the summaries of their flush intervals.
+  }
+  void onTimespanComplete(const std::string&, std::chrono::milliseconds) override {}
+
+  // Grpc::AsyncStreamCallbacks
+  void onCreateInitialMetadata(Http::HeaderMap&) override {}
+  void onReceiveInitialMetadata(Http::HeaderMapPtr&&) override {}
+  void onReceiveMessage(Grpc::ResponsePtr<pb::envoy::metrics::StreamMetricsResponse>&&) override {}
+  void onReceiveTrailingMetadata(Http::HeaderMapPtr&&) override {}
+  void onRemoteClose(Grpc::Status::GrpcStatus status, const std::string& message) override;
+
+private:
+  /**
+   * @return uint32_t the ID of a stat on the current stream. A stat that has none yet gets one,
+   *         and its name is added to the message.
+   */
+  uint32_t statId(const std::string& name);
+
+  const Protobuf::MethodDescriptor& service_method_;
+  MetricsAsyncClientPtr client_;
+  const LocalInfo::LocalInfo& local_info_;
+  MetricsServiceStats stats_;
+  Grpc::AsyncStream<pb::envoy::metrics::StreamMetricsMessage>* stream_{};
+  std::unordered_map<std::string, uint32_t> stat_ids_;
+  pb::envoy::metrics::StreamMetricsMessage message_;
+};
+
+} // namespace Stats
+} // namespace Envoy
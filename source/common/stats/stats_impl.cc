@@ -2,44 +2,315 @@
 
 #include <string.h>
 
+#include <algorithm>
 #include <chrono>
+#include <limits>
 #include <string>
 
-#include "common/common/utility.h"
+#include "common/memory/accounting.h"
 
 namespace Envoy {
 namespace Stats {
 
 void TimerImpl::TimespanImpl::complete(const std::string& dynamic_name) {
-  std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::steady_clock::now() - start_);
-  parent_.parent_.deliverTimingToSinks(dynamic_name, ms);
+  parent_.parent_.deliverTimingToSinks(dynamic_name, elapsed());
+}
+
+std::chrono::milliseconds TimerImpl::TimespanImpl::elapsed() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(time_source_.currentTime() -
+                                                               start_);
+}
+
+namespace {
+
+/**
+ * Invoke a callback for each dot separated token of a name. At most RawStatData::MAX_SYMBOLS
+ * tokens are produced: the last token holds the remainder of the name. Iteration stops early if
+ * the callback returns false.
+ * @return bool false if iteration was stopped by the callback.
+ */
+template <class Callback> bool forEachToken(const std::string& name, Callback callback) {
+  const size_t size =
+      name.size() < RawStatData::MAX_NAME_SIZE ? name.size() : RawStatData::MAX_NAME_SIZE;
+  const char* start = name.data();
+  const char* end = start + size;
+  for (size_t num_tokens = 1;; num_tokens++) {
+    const char* token_end = end;
+    if (num_tokens < RawStatData::MAX_SYMBOLS) {
+      token_end = std::find(start, end, '.');
+    }
+
+    if (!callback(start, static_cast<size_t>(token_end - start))) {
+      return false;
+    }
+
+    if (token_end == end) {
+      return true;
+    }
+
+    start = token_end + 1;
+  }
+}
+
+} // namespace
+
+CounterCells& CounterCells::get() {
+  static CounterCells* cells = new CounterCells();
+  return *cells;
+}
+
+CounterCells::Slab::Slab() {
+  for (std::atomic<Chunk*>& chunk : chunks_) {
+    chunk = nullptr;
+  }
+}
+
+CounterCells::Slab::~Slab() {
+  for (std::atomic<Chunk*>& chunk : chunks_) {
+    delete chunk.load();
+  }
+}
+
+uint32_t CounterCells::allocSlot(const RawStatData& data) {
+  std::unique_lock<std::mutex> lock(lock_);
+  auto existing = slots_.find(&data);
+  if (existing != slots_.end()) {
+    existing->second.ref_count_++;
+    return existing->second.slot_;
+  }
+
+  uint32_t slot;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  } else if (next_slot_ < CELLS_PER_CHUNK * MAX_CHUNKS) {
+    slot = next_slot_++;
+  } else {
+    return NO_SLOT;
+  }
+  slots_.emplace(&data, SlotRef{slot, 1});
+  return slot;
+}
+
+void CounterCells::freeSlot(const RawStatData& data) {
+  std::unique_lock<std::mutex> lock(lock_);
+  auto existing = slots_.find(&data);
+  ASSERT(existing != slots_.end());
+  if (--existing->second.ref_count_ > 0) {
+    return;
+  }
+  free_slots_.push_back(existing->second.slot_);
+  slots_.erase(existing);
+}
+
+uint64_t CounterCells::sum(uint32_t slot) const {
+  std::unique_lock<std::mutex> lock(lock_);
+  uint64_t sum = 0;
+  for (const std::unique_ptr<Slab>& slab : slabs_) {
+    const Chunk* chunk = slab->chunks_[slot / CELLS_PER_CHUNK].load(std::memory_order_acquire);
+    if (chunk != nullptr) {
+      sum += chunk->cells_[slot % CELLS_PER_CHUNK].load(std::memory_order_relaxed);
+    }
+  }
+  return sum;
+}
+
+uint64_t CounterCells::fold(uint32_t slot) {
+  std::unique_lock<std::mutex> lock(lock_);
+  uint64_t sum = 0;
+  for (const std::unique_ptr<Slab>& slab : slabs_) {
+    Chunk* chunk = slab->chunks_[slot / CELLS_PER_CHUNK].load(std::memory_order_acquire);
+    if (chunk != nullptr) {
+      sum += chunk->cells_[slot % CELLS_PER_CHUNK].exchange(0, std::memory_order_relaxed);
+    }
+  }
+  return sum;
+}
+
+CounterCells::Slab* CounterCells::newSlab() {
+  std::unique_lock<std::mutex> lock(lock_);
+  slabs_.emplace_back(new Slab());
+  return slabs_.back().get();
+}
+
+CounterCells::Chunk* CounterCells::newChunk(Slab& slab, uint32_t index) {
+  Chunk* chunk = new Chunk();
+  for (std::atomic<uint64_t>& cell : chunk->cells_) {
+    cell = 0;
+  }
+  slab.chunks_[index].store(chunk, std::memory_order_release);
+  return chunk;
+}
+
+CounterImpl::~CounterImpl() {
+  if (slot_ != CounterCells::NO_SLOT) {
+    // Fold the cells so a RawStatData shared with another process keeps the final value.
+    fold();
+    CounterCells::get().freeSlot(data_);
+  }
+  alloc_.free(data_);
+}
+
+uint64_t CounterImpl::latch() {
+  if (slot_ != CounterCells::NO_SLOT) {
+    fold();
+  }
+  return data_.pending_increment_.exchange(0);
+}
+
+void CounterImpl::reset() {
+  if (slot_ != CounterCells::NO_SLOT) {
+    fold();
+  }
+  data_.value_ = 0;
+}
+
+void CounterImpl::fold() {
+  const uint64_t folded = CounterCells::get().fold(slot_);
+  data_.value_ += folded;
+  data_.pending_increment_ += folded;
+}
+
+uint64_t CounterImpl::value() {
+  uint64_t value = data_.value_;
+  if (slot_ != CounterCells::NO_SLOT) {
+    value += CounterCells::get().sum(slot_);
+  }
+  return value;
 }
 
 RawStatData* HeapRawStatDataAllocator::alloc(const std::string& name) {
   RawStatData* data = new RawStatData();
   memset(data, 0, sizeof(RawStatData));
-  data->initialize(name);
+  // The heap symbol table only fills up if there are 64K distinct live tokens, which we treat the
+  // same as running out of memory.
+  bool initialized = data->initialize(name, symbol_table_);
+  RELEASE_ASSERT(initialized);
+  Memory::Accounting::charge(Memory::Owner::Stats, sizeof(RawStatData));
   return data;
 }
 
 void HeapRawStatDataAllocator::free(RawStatData& data) {
   // This allocator does not ever have concurrent access to the raw data.
   ASSERT(data.ref_count_ == 1);
+  data.releaseName(symbol_table_);
   delete &data;
+  Memory::Accounting::credit(Memory::Owner::Stats, sizeof(RawStatData));
 }
 
-void RawStatData::initialize(const std::string& name) {
+bool RawStatData::initialize(const std::string& name, SymbolTable& symbol_table) {
   ASSERT(!initialized());
   ASSERT(name.size() <= MAX_NAME_SIZE);
   ASSERT(std::string::npos == name.find(':'));
+
+  uint16_t num_symbols = 0;
+  bool interned = forEachToken(name, [&](const char* token, size_t size) -> bool {
+    if (!symbol_table.intern(token, size, symbols_[num_symbols])) {
+      return false;
+    }
+    num_symbols++;
+    return true;
+  });
+
+  if (!interned) {
+    for (uint16_t i = 0; i < num_symbols; i++) {
+      symbol_table.release(symbols_[i]);
+    }
+    return false;
+  }
+
+  num_symbols_ = num_symbols;
   ref_count_ = 1;
-  StringUtil::strlcpy(name_, name.substr(0, MAX_NAME_SIZE).c_str(), MAX_NAME_SIZE + 1);
+  return true;
 }
 
-bool RawStatData::matches(const std::string& name) {
+bool RawStatData::matches(const std::string& name, const SymbolTable& symbol_table) {
   // In case a stat got truncated, match on the truncated name.
-  return 0 == strcmp(name.substr(0, MAX_NAME_SIZE).c_str(), name_);
+  uint16_t index = 0;
+  bool matched = forEachToken(name, [&](const char* token, size_t size) -> bool {
+    if (index == num_symbols_ || !symbol_table.tokenEquals(symbols_[index], token, size)) {
+      return false;
+    }
+    index++;
+    return true;
+  });
+
+  return matched && index == num_symbols_;
+}
+
+std::string RawStatData::name(const SymbolTable& symbol_table) {
+  std::string name;
+  for (uint16_t i = 0; i < num_symbols_; i++) {
+    if (i > 0) {
+      name.push_back('.');
+    }
+    symbol_table.appendToken(symbols_[i], name);
+  }
+
+  return name;
+}
+
+void RawStatData::releaseName(SymbolTable& symbol_table) {
+  for (uint16_t i = 0; i < num_symbols_; i++) {
+    symbol_table.release(symbols_[i]);
+  }
+  num_symbols_ = 0;
+}
+
+bool SymbolTableImpl::intern(const char* token, size_t size, Symbol& symbol) {
+  std::string key(token, size);
+  std::unique_lock<std::mutex> lock(lock_);
+  auto existing = symbols_.find(key);
+  if (existing != symbols_.end()) {
+    entries_[existing->second].ref_count_++;
+    symbol = existing->second;
+    return true;
+  }
+
+  if (!free_symbols_.empty()) {
+    symbol = free_symbols_.back();
+    free_symbols_.pop_back();
+  } else if (entries_.size() <= std::numeric_limits<Symbol>::max()) {
+    symbol = entries_.size();
+    entries_.emplace_back();
+  } else {
+    return false;
+  }
+
+  entries_[symbol].token_ = key;
+  entries_[symbol].ref_count_ = 1;
+  symbols_.emplace(std::move(key), symbol);
+  return true;
+}
+
+void SymbolTableImpl::release(Symbol symbol) {
+  std::unique_lock<std::mutex> lock(lock_);
+  Entry& entry = entries_[symbol];
+  ASSERT(entry.ref_count_ > 0);
+  if (--entry.ref_count_ > 0) {
+    return;
+  }
+
+  symbols_.erase(entry.token_);
+  entry.token_.clear();
+  free_symbols_.push_back(symbol);
+}
+
+void SymbolTableImpl::appendToken(Symbol symbol, std::string& out) const {
+  std::unique_lock<std::mutex> lock(lock_);
+  ASSERT(entries_[symbol].ref_count_ > 0);
+  out.append(entries_[symbol].token_);
+}
+
+bool SymbolTableImpl::tokenEquals(Symbol symbol, const char* token, size_t size) const {
+  std::unique_lock<std::mutex> lock(lock_);
+  const std::string& entry_token = entries_[symbol].token_;
+  return entry_token.size() == size && 0 == memcmp(entry_token.data(), token, size);
+}
+
+size_t SymbolTableImpl::size() const {
+  std::unique_lock<std::mutex> lock(lock_);
+  return symbols_.size();
 }
 
 } // namespace Stats
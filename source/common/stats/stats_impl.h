@@ -6,20 +6,64 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/common/time.h"
 #include "envoy/stats/stats.h"
 
 #include "common/common/assert.h"
+#include "common/common/utility.h"
 
 namespace Envoy {
 namespace Stats {
 
+/**
+ * A small integer that identifies a single dot separated token of a stat name.
+ */
+typedef uint16_t Symbol;
+
+/**
+ * Interns the dot separated tokens of stat names as small integer symbols. Stat names share most
+ * of their tokens (e.g. "cluster.foo.upstream_rq_200" and "cluster.bar.upstream_rq_200"), so
+ * storing names as symbol sequences is much smaller than storing each name in full. Symbols are
+ * reference counted and may be recycled once their last reference has been released.
+ */
+class SymbolTable {
+public:
+  virtual ~SymbolTable() {}
+
+  /**
+   * Intern a token and increment its reference count.
+   * @param token supplies the start of the token. The token may be empty.
+   * @param size supplies the size of the token.
+   * @param symbol receives the symbol for the token.
+   * @return bool false if the table is full and the token could not be interned.
+   */
+  virtual bool intern(const char* token, size_t size, Symbol& symbol) PURE;
+
+  /**
+   * Release a reference to a symbol previously returned by intern().
+   */
+  virtual void release(Symbol symbol) PURE;
+
+  /**
+   * Append the token for a live symbol to a string.
+   */
+  virtual void appendToken(Symbol symbol, std::string& out) const PURE;
+
+  /**
+   * @return bool whether the token for a live symbol is equal to the supplied token.
+   */
+  virtual bool tokenEquals(Symbol symbol, const char* token, size_t size) const PURE;
+};
+
 /**
  * This structure is the backing memory for both CounterImpl and GaugeImpl. It is designed so that
- * it can be allocated from shared memory if needed.
+ * it can be allocated from shared memory if needed. The name is stored as a sequence of symbols
+ * from the SymbolTable of the allocator that owns the data.
  */
 struct RawStatData {
   struct Flags {
@@ -28,17 +72,33 @@ struct RawStatData {
 
   static const size_t MAX_NAME_SIZE = 127;
 
-  RawStatData() { memset(name_, 0, sizeof(name_)); }
-  void initialize(const std::string& name);
-  bool initialized() { return name_[0] != '\0'; }
-  bool matches(const std::string& name);
+  // Names with more tokens than this keep the remainder of the name, dots included, in the last
+  // symbol.
+  static const size_t MAX_SYMBOLS = 16;
+
+  RawStatData() : num_symbols_(0) {}
+
+  /**
+   * Initialize the data with a name, interning the name's tokens in the symbol table.
+   * @return bool false if the symbol table is full. The data is left uninitialized in this case.
+   */
+  bool initialize(const std::string& name, SymbolTable& symbol_table);
+  bool initialized() { return num_symbols_ != 0; }
+  bool matches(const std::string& name, const SymbolTable& symbol_table);
+  std::string name(const SymbolTable& symbol_table);
+
+  /**
+   * Release the name's symbols back to the symbol table. The data is left uninitialized.
+   */
+  void releaseName(SymbolTable& symbol_table);
 
   std::atomic<uint64_t> value_;
   std::atomic<uint64_t> pending_increment_;
   std::atomic<uint16_t> flags_;
   std::atomic<uint16_t> ref_count_;
-  std::atomic<uint32_t> unused_;
-  char name_[MAX_NAME_SIZE + 1];
+  uint16_t num_symbols_;
+  uint16_t unused_;
+  Symbol symbols_[MAX_SYMBOLS];
 };
 
 /**
@@ -61,33 +121,158 @@ public:
    * free the block if it is no longer needed.
    */
   virtual void free(RawStatData& data) PURE;
+
+  /**
+   * @return const SymbolTable& the symbol table that names of allocated data are encoded with.
+   */
+  virtual const SymbolTable& symbolTable() PURE;
+};
+
+/**
+ * Per-thread cells that counters are incremented in. Counters like upstream_rq_total are
+ * incremented by every worker, so incrementing the RawStatData directly bounces its cache line
+ * between cores. Instead each thread increments a cell of its own slab, and the cells of a counter
+ * are summed when it is read and folded into its RawStatData when it is latched. Counters that
+ * share a RawStatData, as in overlapping scopes, share its cells. Slabs are never shared between
+ * threads and outlive the threads that own them. Thread safe.
+ */
+class CounterCells {
+public:
+  static const uint32_t NO_SLOT = UINT32_MAX;
+
+  /**
+   * @return CounterCells& the process wide cells.
+   */
+  static CounterCells& get();
+
+  /**
+   * Reference the slot of the cells of a counter's data, allocating one whose cells are all 0 if
+   * the data has none yet.
+   * @param data supplies the data of the counter.
+   * @return uint32_t the slot or NO_SLOT if all slots are in use.
+   */
+  uint32_t allocSlot(const RawStatData& data);
+
+  /**
+   * Release a reference to the slot of a counter's data. The cells must have been folded before
+   * the last reference is released.
+   * @param data supplies the data of the counter.
+   */
+  void freeSlot(const RawStatData& data);
+
+  /**
+   * Add to the calling thread's cell of a slot.
+   */
+  void add(uint32_t slot, uint64_t amount) {
+    std::atomic<uint64_t>& cell = threadCell(slot);
+    cell.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  /**
+   * @return uint64_t the sum of all cells of a slot.
+   */
+  uint64_t sum(uint32_t slot) const;
+
+  /**
+   * Reset all cells of a slot to 0.
+   * @return uint64_t the sum of the cells before they were reset.
+   */
+  uint64_t fold(uint32_t slot);
+
+private:
+  static const uint32_t CELLS_PER_CHUNK = 512;
+  static const uint32_t MAX_CHUNKS = 1024;
+
+  struct Chunk {
+    std::atomic<uint64_t> cells_[CELLS_PER_CHUNK];
+    // Keeps the last cache line of the chunk from being shared with another thread's allocation.
+    char padding_[64];
+  };
+
+  struct Slab {
+    Slab();
+    ~Slab();
+
+    // Only written by the owning thread. Chunks are allocated the first time the thread uses one.
+    std::atomic<Chunk*> chunks_[MAX_CHUNKS];
+  };
+
+  CounterCells() {}
+
+  std::atomic<uint64_t>& threadCell(uint32_t slot) {
+    static thread_local Slab* slab = nullptr;
+    if (slab == nullptr) {
+      slab = newSlab();
+    }
+    Chunk* chunk = slab->chunks_[slot / CELLS_PER_CHUNK].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+      chunk = newChunk(*slab, slot / CELLS_PER_CHUNK);
+    }
+    return chunk->cells_[slot % CELLS_PER_CHUNK];
+  }
+
+  Slab* newSlab();
+  static Chunk* newChunk(Slab& slab, uint32_t index);
+
+  struct SlotRef {
+    uint32_t slot_;
+    uint32_t ref_count_;
+  };
+
+  mutable std::mutex lock_;
+  std::vector<std::unique_ptr<Slab>> slabs_;
+  std::unordered_map<const RawStatData*, SlotRef> slots_;
+  std::vector<uint32_t> free_slots_;
+  uint32_t next_slot_{};
 };
 
 /**
- * Counter implementation that wraps a RawStatData.
+ * Counter implementation that wraps a RawStatData. Increments go to per-thread CounterCells and
+ * reach the RawStatData when the counter is latched, so that a RawStatData in shared memory is
+ * kept current for hot restart by the periodic stats flush.
  */
 class CounterImpl : public Counter {
 public:
-  CounterImpl(RawStatData& data, RawStatDataAllocator& alloc) : data_(data), alloc_(alloc) {}
-  ~CounterImpl() { alloc_.free(data_); }
+  CounterImpl(RawStatData& data, RawStatDataAllocator& alloc)
+      : data_(data), alloc_(alloc), slot_(CounterCells::get().allocSlot(data)) {}
+  ~CounterImpl();
 
   // Stats::Counter
   void add(uint64_t amount) override {
-    data_.value_ += amount;
-    data_.pending_increment_ += amount;
-    data_.flags_ |= RawStatData::Flags::Used;
+    if (slot_ != CounterCells::NO_SLOT) {
+      CounterCells::get().add(slot_, amount);
+    } else {
+      data_.value_ += amount;
+      data_.pending_increment_ += amount;
+    }
+    // Only write the flags when they change, as they are shared with other threads.
+    if (!used()) {
+      data_.flags_ |= RawStatData::Flags::Used;
+    }
+    markChanged();
   }
 
+  bool clearChanged() override { return changed_.exchange(false); }
+
   void inc() override { add(1); }
-  uint64_t latch() override { return data_.pending_increment_.exchange(0); }
-  std::string name() override { return data_.name_; }
-  void reset() override { data_.value_ = 0; }
+  uint64_t latch() override;
+  std::string name() override { return data_.name(alloc_.symbolTable()); }
+  void reset() override;
   bool used() override { return data_.flags_ & RawStatData::Flags::Used; }
-  uint64_t value() override { return data_.value_; }
+  uint64_t value() override;
 
 private:
+  void fold();
+  void markChanged() {
+    if (!changed_) {
+      changed_ = true;
+    }
+  }
+
   RawStatData& data_;
   RawStatDataAllocator& alloc_;
+  const uint32_t slot_;
+  std::atomic<bool> changed_{};
 };
 
 /**
@@ -102,25 +287,37 @@ public:
   virtual void add(uint64_t amount) override {
     data_.value_ += amount;
     data_.flags_ |= RawStatData::Flags::Used;
+    markChanged();
   }
+  bool clearChanged() override { return changed_.exchange(false); }
   virtual void dec() override { sub(1); }
   virtual void inc() override { add(1); }
-  virtual std::string name() override { return data_.name_; }
+  virtual std::string name() override { return data_.name(alloc_.symbolTable()); }
   virtual void set(uint64_t value) override {
     data_.value_ = value;
     data_.flags_ |= RawStatData::Flags::Used;
+    markChanged();
   }
   virtual void sub(uint64_t amount) override {
     ASSERT(data_.value_ >= amount);
     ASSERT(used());
     data_.value_ -= amount;
+    markChanged();
   }
   bool used() override { return data_.flags_ & RawStatData::Flags::Used; }
   virtual uint64_t value() override { return data_.value_; }
 
 private:
+  void markChanged() {
+    // Only write the flag when it changes, as it is shared with other threads.
+    if (!changed_) {
+      changed_ = true;
+    }
+  }
+
   RawStatData& data_;
   RawStatDataAllocator& alloc_;
+  std::atomic<bool> changed_{};
 };
 
 /**
@@ -131,7 +328,12 @@ public:
   TimerImpl(const std::string& name, Store& parent) : name_(name), parent_(parent) {}
 
   // Stats::Timer
-  TimespanPtr allocateSpan() override { return TimespanPtr{new TimespanImpl(*this)}; }
+  TimespanPtr allocateSpan() override {
+    return TimespanPtr{new TimespanImpl(*this, ProdMonotonicTimeSource::instance_)};
+  }
+  TimespanPtr allocateSpan(MonotonicTimeSource& time_source) override {
+    return TimespanPtr{new TimespanImpl(*this, time_source)};
+  }
   std::string name() override { return name_; }
 
 private:
@@ -140,14 +342,17 @@ private:
    */
   class TimespanImpl : public Timespan {
   public:
-    TimespanImpl(TimerImpl& parent) : parent_(parent), start_(std::chrono::steady_clock::now()) {}
+    TimespanImpl(TimerImpl& parent, MonotonicTimeSource& time_source)
+        : parent_(parent), time_source_(time_source), start_(time_source.currentTime()) {}
 
     // Stats::Timespan
     void complete() override { complete(parent_.name_); }
     void complete(const std::string& dynamic_name) override;
+    std::chrono::milliseconds elapsed() override;
 
   private:
     TimerImpl& parent_;
+    MonotonicTimeSource& time_source_;
     MonotonicTime start_;
   };
 
@@ -155,6 +360,34 @@ private:
   Store& parent_;
 };
 
+/**
+ * Heap implementation of SymbolTable. Thread safe.
+ */
+class SymbolTableImpl : public SymbolTable {
+public:
+  // Stats::SymbolTable
+  bool intern(const char* token, size_t size, Symbol& symbol) override;
+  void release(Symbol symbol) override;
+  void appendToken(Symbol symbol, std::string& out) const override;
+  bool tokenEquals(Symbol symbol, const char* token, size_t size) const override;
+
+  /**
+   * @return size_t the number of live symbols.
+   */
+  size_t size() const;
+
+private:
+  struct Entry {
+    std::string token_;
+    uint32_t ref_count_;
+  };
+
+  mutable std::mutex lock_;
+  std::unordered_map<std::string, Symbol> symbols_;
+  std::vector<Entry> entries_;
+  std::vector<Symbol> free_symbols_;
+};
+
 /**
  * Implementation of RawStatDataAllocator that just allocates a new structure in memory and returns
  * it.
@@ -164,6 +397,10 @@ public:
   // RawStatDataAllocator
   RawStatData* alloc(const std::string& name) override;
   void free(RawStatData& data) override;
+  const SymbolTable& symbolTable() override { return symbol_table_; }
+
+private:
+  SymbolTableImpl symbol_table_;
 };
 
 /**
@@ -195,6 +432,20 @@ public:
     return list;
   }
 
+  void forEach(std::function<void(const std::string&, Base&)> callback) const {
+    for (auto& stat : stats_) {
+      callback(stat.first, *stat.second);
+    }
+  }
+
+  void forEachChanged(std::function<void(const std::string&, Base&)> callback) const {
+    for (auto& stat : stats_) {
+      if (stat.second->clearChanged()) {
+        callback(stat.first, *stat.second);
+      }
+    }
+  }
+
 private:
   std::unordered_map<std::string, std::shared_ptr<Impl>> stats_;
   Allocator alloc_;
@@ -228,6 +479,13 @@ public:
   // Stats::Store
   std::list<CounterSharedPtr> counters() const override { return counters_.toList(); }
   std::list<GaugeSharedPtr> gauges() const override { return gauges_.toList(); }
+  std::list<HistogramSharedPtr> histograms() const override { return {}; }
+  void forEachCounter(CounterCb callback) const override { counters_.forEach(callback); }
+  void forEachGauge(GaugeCb callback) const override { gauges_.forEach(callback); }
+  void forEachChangedCounter(CounterCb callback) const override {
+    counters_.forEachChanged(callback);
+  }
+  void forEachChangedGauge(GaugeCb callback) const override { gauges_.forEachChanged(callback); }
 
 private:
   struct ScopeImpl : public Scope {
@@ -1,8 +1,13 @@
 #include "common/stats/statsd.h"
 
+#include <string.h>
+#include <sys/socket.h>
+
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/common/exception.h"
 #include "envoy/event/dispatcher.h"
@@ -18,7 +23,9 @@ namespace Envoy {
 namespace Stats {
 namespace Statsd {
 
-Writer::Writer(Network::Address::InstanceConstSharedPtr address) {
+Writer::Writer(Network::Address::InstanceConstSharedPtr address, uint64_t max_packet_size,
+               UdpStatsdStats& stats)
+    : max_packet_size_(max_packet_size), stats_(stats) {
   fd_ = address->socket(Network::Address::SocketType::Datagram);
   ASSERT(fd_ != -1);
 
@@ -35,28 +42,111 @@ Writer::~Writer() {
 
 void Writer::writeCounter(const std::string& name, uint64_t increment) {
   std::string message(fmt::format("envoy.{}:{}|c", name, increment));
-  send(message);
+  write(message);
 }
 
 void Writer::writeGauge(const std::string& name, uint64_t value) {
   std::string message(fmt::format("envoy.{}:{}|g", name, value));
-  send(message);
+  write(message);
 }
 
 void Writer::writeTimer(const std::string& name, const std::chrono::milliseconds& ms) {
   std::string message(fmt::format("envoy.{}:{}|ms", name, ms.count()));
-  send(message);
+  write(message);
+}
+
+void Writer::beginBatch() {
+  ASSERT(!batching_);
+  batching_ = max_packet_size_ > 0;
+}
+
+void Writer::endBatch() {
+  if (!batching_) {
+    return;
+  }
+
+  if (batch_.size() > (packet_ends_.empty() ? 0 : packet_ends_.back())) {
+    packet_ends_.push_back(batch_.size());
+  }
+
+  sendBatch();
+  batch_.clear();
+  packet_ends_.clear();
+  batching_ = false;
+}
+
+void Writer::write(const std::string& message) {
+  if (!batching_) {
+    send(message);
+    return;
+  }
+
+  // Close the current datagram if the message does not fit. A message that is larger than the max
+  // packet size on its own still gets sent, in a datagram of its own.
+  const size_t packet_size = batch_.size() - (packet_ends_.empty() ? 0 : packet_ends_.back());
+  if (packet_size > 0) {
+    if (packet_size + 1 + message.size() > max_packet_size_) {
+      packet_ends_.push_back(batch_.size());
+    } else {
+      batch_.push_back('\n');
+    }
+  }
+
+  batch_.append(message);
 }
 
 void Writer::send(const std::string& message) {
-  ::send(fd_, message.c_str(), message.size(), MSG_DONTWAIT);
+  const ssize_t rc = ::send(fd_, message.c_str(), message.size(), MSG_DONTWAIT);
+  if (rc > 0) {
+    stats_.udp_packets_sent_.inc();
+    stats_.udp_bytes_sent_.add(rc);
+  }
+}
+
+void Writer::sendBatch() {
+  const size_t num_batch_packets =
+      packet_ends_.size() < MAX_BATCH_PACKETS ? packet_ends_.size() : MAX_BATCH_PACKETS;
+  std::vector<iovec> iovecs(num_batch_packets);
+  std::vector<mmsghdr> messages(num_batch_packets);
+
+  size_t next_packet = 0;
+  while (next_packet < packet_ends_.size()) {
+    const size_t num_packets = std::min(packet_ends_.size() - next_packet, num_batch_packets);
+    for (size_t i = 0; i < num_packets; i++) {
+      const size_t packet = next_packet + i;
+      const size_t start = packet == 0 ? 0 : packet_ends_[packet - 1];
+      iovecs[i].iov_base = &batch_[start];
+      iovecs[i].iov_len = packet_ends_[packet] - start;
+      memset(&messages[i], 0, sizeof(mmsghdr));
+      messages[i].msg_hdr.msg_iov = &iovecs[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    const int rc = ::sendmmsg(fd_, messages.data(), num_packets, MSG_DONTWAIT);
+    if (rc <= 0) {
+      // Same as with send() we do not retry. If the socket buffer is full or the send fails the
+      // rest of the batch is dropped.
+      return;
+    }
+
+    uint64_t bytes_sent = 0;
+    for (int i = 0; i < rc; i++) {
+      bytes_sent += messages[i].msg_len;
+    }
+
+    stats_.udp_packets_sent_.add(rc);
+    stats_.udp_bytes_sent_.add(bytes_sent);
+    next_packet += rc;
+  }
 }
 
 UdpStatsdSink::UdpStatsdSink(ThreadLocal::SlotAllocator& tls,
-                             Network::Address::InstanceConstSharedPtr address)
-    : tls_(tls.allocateSlot()), server_address_(address) {
+                             Network::Address::InstanceConstSharedPtr address,
+                             uint64_t max_packet_size, Stats::Scope& scope)
+    : tls_(tls.allocateSlot()), server_address_(address), max_packet_size_(max_packet_size),
+      stats_{ALL_UDP_STATSD_STATS(POOL_COUNTER_PREFIX(scope, "statsd."))} {
   tls_->set([this](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
-    return std::make_shared<Writer>(this->server_address_);
+    return std::make_shared<Writer>(this->server_address_, max_packet_size_, stats_);
   });
 }
 
@@ -3,10 +3,12 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/local_info/local_info.h"
 #include "envoy/network/connection.h"
 #include "envoy/stats/stats.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/thread_local/thread_local.h"
 #include "envoy/upstream/cluster_manager.h"
 
@@ -17,24 +19,65 @@ namespace Stats {
 namespace Statsd {
 
 /**
- * This is a simple UDP localhost writer for statsd messages.
+ * All UDP statsd stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_UDP_STATSD_STATS(COUNTER)                                                              \
+  COUNTER(udp_bytes_sent)                                                                          \
+  COUNTER(udp_packets_sent)
+// clang-format on
+
+/**
+ * Struct definition for all UDP statsd stats. @see stats_macros.h
+ */
+struct UdpStatsdStats {
+  ALL_UDP_STATSD_STATS(GENERATE_COUNTER_STRUCT)
+};
+
+/**
+ * This is a simple UDP localhost writer for statsd messages. If a max packet size is configured,
+ * metrics written between beginBatch() and endBatch() are packed newline separated into datagrams
+ * of at most that size, and all datagrams are sent with as few sendmmsg() calls as possible.
  */
 class Writer : public ThreadLocal::ThreadLocalObject {
 public:
-  Writer(Network::Address::InstanceConstSharedPtr address);
+  Writer(Network::Address::InstanceConstSharedPtr address, uint64_t max_packet_size,
+         UdpStatsdStats& stats);
   ~Writer();
 
   void writeCounter(const std::string& name, uint64_t increment);
   void writeGauge(const std::string& name, uint64_t value);
   void writeTimer(const std::string& name, const std::chrono::milliseconds& ms);
 
+  /**
+   * Start buffering writes. This is a no-op if batching is not configured.
+   */
+  void beginBatch();
+
+  /**
+   * Send all writes buffered since beginBatch().
+   */
+  void endBatch();
+
   // Called in unit test to validate address.
   int getFdForTests() const { return fd_; };
 
 private:
+  void write(const std::string& message);
   void send(const std::string& message);
+  void sendBatch();
+
+  // The most datagrams the kernel accepts in a single sendmmsg() call.
+  static const uint32_t MAX_BATCH_PACKETS = 1024;
 
   int fd_;
+  const uint64_t max_packet_size_;
+  UdpStatsdStats& stats_;
+  bool batching_{};
+  // All buffered datagrams back to back. packet_ends_ holds the end offset of every closed
+  // datagram. Both keep their capacity across flushes.
+  std::string batch_;
+  std::vector<size_t> packet_ends_;
 };
 
 /**
@@ -42,13 +85,21 @@ private:
  */
 class UdpStatsdSink : public Sink {
 public:
-  UdpStatsdSink(ThreadLocal::SlotAllocator& tls, Network::Address::InstanceConstSharedPtr address);
+  /**
+   * @param max_packet_size supplies the maximum size of a batched datagram. 0 disables batching,
+   *        in which case every metric is sent in its own datagram.
+   */
+  UdpStatsdSink(ThreadLocal::SlotAllocator& tls, Network::Address::InstanceConstSharedPtr address,
+                uint64_t max_packet_size, Stats::Scope& scope);
 
   // Stats::Sink
-  void beginFlush() override {}
+  void beginFlush() override { tls_->getTyped<Writer>().beginBatch(); }
   void flushCounter(const std::string& name, uint64_t delta) override;
   void flushGauge(const std::string& name, uint64_t value) override;
-  void endFlush() override {}
+  void endFlush() override { tls_->getTyped<Writer>().endBatch(); }
+  void flushHistogram(const std::string&, const HistogramStatistics&) override {
+    // Every raw sample is already written as a timer, statsd computes the quantiles.
+  }
   void onHistogramComplete(const std::string& name, uint64_t value) override {
     // For statsd histograms are just timers.
     onTimespanComplete(name, std::chrono::milliseconds(value));
@@ -60,6 +111,8 @@ public:
 private:
   ThreadLocal::SlotPtr tls_;
   Network::Address::InstanceConstSharedPtr server_address_;
+  const uint64_t max_packet_size_;
+  UdpStatsdStats stats_;
 };
 
 /**
@@ -84,6 +137,10 @@ public:
 
   void endFlush() override { tls_->getTyped<TlsSink>().endFlush(true); }
 
+  void flushHistogram(const std::string&, const HistogramStatistics&) override {
+    // Every raw sample is already written as a timer, statsd computes the quantiles.
+  }
+
   void onHistogramComplete(const std::string& name, uint64_t value) override {
     // For statsd histograms are just timers.
     onTimespanComplete(name, std::chrono::milliseconds(value));
@@ -28,7 +28,7 @@ std::list<CounterSharedPtr> ThreadLocalStoreImpl::counters() const {
   std::unique_lock<std::mutex> lock(lock_);
   for (ScopeImpl* scope : scopes_) {
     for (auto counter : scope->central_cache_.counters_) {
-      if (names.insert(counter.first).second) {
+      if (names.insert(counter.second->name()).second) {
         ret.push_back(counter.second);
       }
     }
@@ -37,6 +37,69 @@ std::list<CounterSharedPtr> ThreadLocalStoreImpl::counters() const {
   return ret;
 }
 
+void ThreadLocalStoreImpl::forEachCounter(CounterCb callback) const {
+  // Handle de-dup due to overlapping scopes. The name is needed for the callback anyway, so it is
+  // only built once per counter.
+  std::unordered_set<std::string> names;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (ScopeImpl* scope : scopes_) {
+    for (auto& counter : scope->central_cache_.counters_) {
+      auto name = names.insert(counter.second->name());
+      if (name.second) {
+        callback(*name.first, *counter.second);
+      }
+    }
+  }
+}
+
+void ThreadLocalStoreImpl::forEachGauge(GaugeCb callback) const {
+  // See comments in forEachCounter().
+  std::unordered_set<std::string> names;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (ScopeImpl* scope : scopes_) {
+    for (auto& gauge : scope->central_cache_.gauges_) {
+      auto name = names.insert(gauge.second->name());
+      if (name.second) {
+        callback(*name.first, *gauge.second);
+      }
+    }
+  }
+}
+
+void ThreadLocalStoreImpl::forEachChangedCounter(CounterCb callback) const {
+  // See comments in forEachCounter(). Only the names of changed counters are built.
+  std::unordered_set<std::string> names;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (ScopeImpl* scope : scopes_) {
+    for (auto& counter : scope->central_cache_.counters_) {
+      if (!counter.second->clearChanged()) {
+        continue;
+      }
+      auto name = names.insert(counter.second->name());
+      if (name.second) {
+        callback(*name.first, *counter.second);
+      }
+    }
+  }
+}
+
+void ThreadLocalStoreImpl::forEachChangedGauge(GaugeCb callback) const {
+  // See comments in forEachChangedCounter().
+  std::unordered_set<std::string> names;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (ScopeImpl* scope : scopes_) {
+    for (auto& gauge : scope->central_cache_.gauges_) {
+      if (!gauge.second->clearChanged()) {
+        continue;
+      }
+      auto name = names.insert(gauge.second->name());
+      if (name.second) {
+        callback(*name.first, *gauge.second);
+      }
+    }
+  }
+}
+
 ScopePtr ThreadLocalStoreImpl::createScope(const std::string& name) {
   std::unique_ptr<ScopeImpl> new_scope(new ScopeImpl(*this, name));
   std::unique_lock<std::mutex> lock(lock_);
@@ -51,7 +114,7 @@ std::list<GaugeSharedPtr> ThreadLocalStoreImpl::gauges() const {
   std::unique_lock<std::mutex> lock(lock_);
   for (ScopeImpl* scope : scopes_) {
     for (auto gauge : scope->central_cache_.gauges_) {
-      if (names.insert(gauge.first).second) {
+      if (names.insert(gauge.second->name()).second) {
         ret.push_back(gauge.second);
       }
     }
@@ -60,6 +123,23 @@ std::list<GaugeSharedPtr> ThreadLocalStoreImpl::gauges() const {
   return ret;
 }
 
+std::list<HistogramSharedPtr> ThreadLocalStoreImpl::histograms() const {
+  std::list<HistogramSharedPtr> ret;
+  std::unique_lock<std::mutex> lock(lock_);
+  for (auto it = histograms_.begin(); it != histograms_.end();) {
+    ParentHistogramImplSharedPtr histogram = it->second.lock();
+    if (histogram) {
+      ret.push_back(histogram);
+      ++it;
+    } else {
+      // All scopes that referenced the histogram have been destroyed.
+      it = histograms_.erase(it);
+    }
+  }
+
+  return ret;
+}
+
 void ThreadLocalStoreImpl::initializeThreading(Event::Dispatcher& main_thread_dispatcher,
                                                ThreadLocal::Instance& tls) {
   main_thread_dispatcher_ = &main_thread_dispatcher;
@@ -109,18 +189,28 @@ ThreadLocalStoreImpl::SafeAllocData ThreadLocalStoreImpl::safeAlloc(const std::s
   }
 }
 
+ParentHistogramImplSharedPtr ThreadLocalStoreImpl::findOrCreateHistogram(const std::string& name) {
+  // Must be called with lock_ held.
+  std::weak_ptr<ParentHistogramImpl>& weak_ref = histograms_[name];
+  ParentHistogramImplSharedPtr histogram = weak_ref.lock();
+  if (!histogram) {
+    histogram = std::make_shared<ParentHistogramImpl>(name);
+    weak_ref = histogram;
+  }
+
+  return histogram;
+}
+
 ThreadLocalStoreImpl::ScopeImpl::~ScopeImpl() { parent_.releaseScopeCrossThread(this); }
 
 Counter& ThreadLocalStoreImpl::ScopeImpl::counter(const std::string& name) {
-  // Determine the final name based on the prefix and the passed name.
-  std::string final_name = prefix_ + name;
-
   // We now try to acquire a *reference* to the TLS cache shared pointer. This might remain null
   // if we don't have TLS initialized currently. The de-referenced pointer might be null if there
-  // is no cache entry.
+  // is no cache entry. Both caches are per scope, so they are keyed by the name without the
+  // scope prefix. This means that a cache hit never has to build the final name.
   CounterSharedPtr* tls_ref = nullptr;
   if (!parent_.shutting_down_ && parent_.tls_) {
-    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].counters_[final_name];
+    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].counters_[name];
   }
 
   // If we have a valid cache entry, return it.
@@ -131,9 +221,9 @@ Counter& ThreadLocalStoreImpl::ScopeImpl::counter(const std::string& name) {
   // We must now look in the central store so we must be locked. We grab a reference to the
   // central store location. It might contain nothing. In this case, we allocate a new stat.
   std::unique_lock<std::mutex> lock(parent_.lock_);
-  CounterSharedPtr& central_ref = central_cache_.counters_[final_name];
+  CounterSharedPtr& central_ref = central_cache_.counters_[name];
   if (!central_ref) {
-    SafeAllocData alloc = parent_.safeAlloc(final_name);
+    SafeAllocData alloc = parent_.safeAlloc(prefix_ + name);
     central_ref.reset(new CounterImpl(alloc.data_, alloc.free_));
   }
 
@@ -157,6 +247,7 @@ void ThreadLocalStoreImpl::ScopeImpl::deliverHistogramToSinks(const std::string&
     return;
   }
 
+  recordHistogram(name, value);
   const std::string final_name = prefix_ + name;
   for (Sink& sink : parent_.timer_sinks_) {
     sink.onHistogramComplete(final_name, value);
@@ -170,6 +261,7 @@ void ThreadLocalStoreImpl::ScopeImpl::deliverTimingToSinks(const std::string& na
     return;
   }
 
+  recordHistogram(name, ms.count());
   const std::string final_name = prefix_ + name;
   for (Sink& sink : parent_.timer_sinks_) {
     sink.onTimespanComplete(final_name, ms);
@@ -179,10 +271,9 @@ void ThreadLocalStoreImpl::ScopeImpl::deliverTimingToSinks(const std::string& na
 Gauge& ThreadLocalStoreImpl::ScopeImpl::gauge(const std::string& name) {
   // See comments in counter(). There is no super clean way (via templates or otherwise) to
   // share this code so I'm leaving it largely duplicated for now.
-  std::string final_name = prefix_ + name;
   GaugeSharedPtr* tls_ref = nullptr;
   if (!parent_.shutting_down_ && parent_.tls_) {
-    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].gauges_[final_name];
+    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].gauges_[name];
   }
 
   if (tls_ref && *tls_ref) {
@@ -190,9 +281,9 @@ Gauge& ThreadLocalStoreImpl::ScopeImpl::gauge(const std::string& name) {
   }
 
   std::unique_lock<std::mutex> lock(parent_.lock_);
-  GaugeSharedPtr& central_ref = central_cache_.gauges_[final_name];
+  GaugeSharedPtr& central_ref = central_cache_.gauges_[name];
   if (!central_ref) {
-    SafeAllocData alloc = parent_.safeAlloc(final_name);
+    SafeAllocData alloc = parent_.safeAlloc(prefix_ + name);
     central_ref.reset(new GaugeImpl(alloc.data_, alloc.free_));
   }
 
@@ -206,10 +297,9 @@ Gauge& ThreadLocalStoreImpl::ScopeImpl::gauge(const std::string& name) {
 Timer& ThreadLocalStoreImpl::ScopeImpl::timer(const std::string& name) {
   // See comments in counter(). There is no super clean way (via templates or otherwise) to
   // share this code so I'm leaving it largely duplicated for now.
-  std::string final_name = prefix_ + name;
   TimerSharedPtr* tls_ref = nullptr;
   if (!parent_.shutting_down_ && parent_.tls_) {
-    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].timers_[final_name];
+    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].timers_[name];
   }
 
   if (tls_ref && *tls_ref) {
@@ -217,9 +307,9 @@ Timer& ThreadLocalStoreImpl::ScopeImpl::timer(const std::string& name) {
   }
 
   std::unique_lock<std::mutex> lock(parent_.lock_);
-  TimerSharedPtr& central_ref = central_cache_.timers_[final_name];
+  TimerSharedPtr& central_ref = central_cache_.timers_[name];
   if (!central_ref) {
-    central_ref.reset(new TimerImpl(final_name, parent_));
+    central_ref.reset(new TimerImpl(prefix_ + name, parent_));
   }
 
   if (tls_ref) {
@@ -229,5 +319,32 @@ Timer& ThreadLocalStoreImpl::ScopeImpl::timer(const std::string& name) {
   return *central_ref;
 }
 
+void ThreadLocalStoreImpl::ScopeImpl::recordHistogram(const std::string& name, uint64_t value) {
+  // See comments in counter(). The difference is that each thread records into its own histogram
+  // which is registered with the shared parent histogram on first use.
+  ThreadLocalHistogramSharedPtr* tls_ref = nullptr;
+  if (!parent_.shutting_down_ && parent_.tls_) {
+    tls_ref = &parent_.tls_->getTyped<TlsCache>().scope_cache_[this].histograms_[name];
+  }
+
+  if (tls_ref && *tls_ref) {
+    (*tls_ref)->recordValue(value);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(parent_.lock_);
+  ParentHistogramImplSharedPtr& central_ref = central_histograms_[name];
+  if (!central_ref) {
+    central_ref = parent_.findOrCreateHistogram(prefix_ + name);
+  }
+
+  if (tls_ref) {
+    *tls_ref = central_ref->allocateThreadLocal();
+    (*tls_ref)->recordValue(value);
+  } else {
+    central_ref->recordValue(value);
+  }
+}
+
 } // namespace Stats
 } // namespace Envoy
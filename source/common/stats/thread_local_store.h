@@ -11,6 +11,7 @@
 
 #include "envoy/thread_local/thread_local.h"
 
+#include "common/stats/histogram_impl.h"
 #include "common/stats/stats_impl.h"
 
 namespace Envoy {
@@ -44,6 +45,11 @@ namespace Stats {
  *   back to heap allocated stats if needed. NOTE: In this case, overlapping scopes will not share
  *   the same backing store. This is to keep things simple, it could be done in the future if
  *   needed.
+ * - Every histogram and timing delivery is also recorded into a histogram of the same name. Each
+ *   thread records into its own thread local histogram without locking. The thread local
+ *   histograms are owned by a parent histogram which merges them on the main thread when
+ *   histograms() are flushed. Parent histograms live on the heap and are shared by overlapping
+ *   scopes via a weak reference map in the store.
  */
 class ThreadLocalStoreImpl : public StoreRoot {
 public:
@@ -65,6 +71,11 @@ public:
   // Stats::Store
   std::list<CounterSharedPtr> counters() const override;
   std::list<GaugeSharedPtr> gauges() const override;
+  std::list<HistogramSharedPtr> histograms() const override;
+  void forEachCounter(CounterCb callback) const override;
+  void forEachGauge(GaugeCb callback) const override;
+  void forEachChangedCounter(CounterCb callback) const override;
+  void forEachChangedGauge(GaugeCb callback) const override;
 
   // Stats::StoreRoot
   void addSink(Sink& sink) override { timer_sinks_.push_back(sink); }
@@ -73,10 +84,13 @@ public:
   void shutdownThreading() override;
 
 private:
+  // Caches are always owned by a single scope, so they are keyed by the name without the scope's
+  // prefix.
   struct TlsCacheEntry {
     std::unordered_map<std::string, CounterSharedPtr> counters_;
     std::unordered_map<std::string, GaugeSharedPtr> gauges_;
     std::unordered_map<std::string, TimerSharedPtr> timers_;
+    std::unordered_map<std::string, ThreadLocalHistogramSharedPtr> histograms_;
   };
 
   struct ScopeImpl : public Scope {
@@ -94,9 +108,12 @@ private:
     Gauge& gauge(const std::string& name) override;
     Timer& timer(const std::string& name) override;
 
+    void recordHistogram(const std::string& name, uint64_t value);
+
     ThreadLocalStoreImpl& parent_;
     const std::string prefix_;
     TlsCacheEntry central_cache_;
+    std::unordered_map<std::string, ParentHistogramImplSharedPtr> central_histograms_;
   };
 
   struct TlsCache : public ThreadLocal::ThreadLocalObject {
@@ -111,12 +128,15 @@ private:
   void clearScopeFromCaches(ScopeImpl* scope);
   void releaseScopeCrossThread(ScopeImpl* scope);
   SafeAllocData safeAlloc(const std::string& name);
+  ParentHistogramImplSharedPtr findOrCreateHistogram(const std::string& name);
 
   RawStatDataAllocator& alloc_;
   Event::Dispatcher* main_thread_dispatcher_{};
   ThreadLocal::SlotPtr tls_;
   mutable std::mutex lock_;
   std::unordered_set<ScopeImpl*> scopes_;
+  // Keyed by the full name so that overlapping scopes share histograms. Guarded by lock_.
+  mutable std::unordered_map<std::string, std::weak_ptr<ParentHistogramImpl>> histograms_;
   ScopePtr default_scope_;
   std::list<std::reference_wrapper<Sink>> timer_sinks_;
   std::atomic<bool> shutting_down_{};
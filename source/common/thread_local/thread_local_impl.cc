@@ -3,6 +3,9 @@
 #include <atomic>
 #include <cstdint>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "envoy/event/dispatcher.h"
 
@@ -42,6 +45,12 @@ ThreadLocalObjectSharedPtr InstanceImpl::SlotImpl::get() {
   return thread_local_data_.data_[index_];
 }
 
+ThreadLocalObject& InstanceImpl::SlotImpl::getObject() {
+  ASSERT(thread_local_data_.data_.size() > index_);
+  ASSERT(thread_local_data_.data_[index_] != nullptr);
+  return *thread_local_data_.data_[index_];
+}
+
 void InstanceImpl::registerThread(Event::Dispatcher& dispatcher, bool main_thread) {
   ASSERT(std::this_thread::get_id() == main_thread_id_);
   ASSERT(!shutdown_);
@@ -102,6 +111,70 @@ void InstanceImpl::SlotImpl::set(InitializeCb cb) {
   setThreadLocal(index_, cb(*parent_.main_thread_dispatcher_));
 }
 
+void InstanceImpl::SlotImpl::update(InitializeCb cb, Event::PostCb complete_cb) {
+  ASSERT(std::this_thread::get_id() == parent_.main_thread_id_);
+  ASSERT(!parent_.shutdown_);
+
+  UpdateCompletionSharedPtr completion;
+  if (complete_cb && !parent_.registered_threads_.empty()) {
+    completion = std::make_shared<UpdateCompletion>(parent_.registered_threads_.size(),
+                                                    complete_cb);
+  }
+
+  while (pending_updates_.size() < parent_.registered_threads_.size()) {
+    pending_updates_.emplace_back(new PendingUpdate());
+  }
+
+  auto pending_update = pending_updates_.begin();
+  for (Event::Dispatcher& dispatcher : parent_.registered_threads_) {
+    PendingUpdateSharedPtr pending = *pending_update++;
+    {
+      std::unique_lock<std::mutex> lock(pending->lock_);
+      const bool posted = static_cast<bool>(pending->cb_);
+      pending->cb_ = cb;
+      if (completion) {
+        pending->completions_.push_back(completion);
+      }
+
+      // The thread has not applied the previous update yet, and will pick up this one instead.
+      if (posted) {
+        continue;
+      }
+    }
+
+    const uint32_t index = index_;
+    Event::Dispatcher& main_dispatcher = *parent_.main_thread_dispatcher_;
+    dispatcher.post([index, pending, &dispatcher, &main_dispatcher]() -> void {
+      applyPendingUpdate(index, *pending, dispatcher, main_dispatcher);
+    });
+  }
+
+  // Handle main thread.
+  setThreadLocal(index_, cb(*parent_.main_thread_dispatcher_));
+  if (complete_cb && !completion) {
+    complete_cb();
+  }
+}
+
+void InstanceImpl::applyPendingUpdate(uint32_t index, PendingUpdate& pending,
+                                      Event::Dispatcher& dispatcher,
+                                      Event::Dispatcher& main_dispatcher) {
+  Slot::InitializeCb cb;
+  std::vector<UpdateCompletionSharedPtr> completions;
+  {
+    std::unique_lock<std::mutex> lock(pending.lock_);
+    cb.swap(pending.cb_);
+    completions.swap(pending.completions_);
+  }
+
+  setThreadLocal(index, cb(dispatcher));
+  for (const UpdateCompletionSharedPtr& completion : completions) {
+    if (--completion->remaining_ == 0) {
+      main_dispatcher.post(completion->cb_);
+    }
+  }
+}
+
 void InstanceImpl::setThreadLocal(uint32_t index, ThreadLocalObjectSharedPtr object) {
   if (thread_local_data_.data_.size() <= index) {
     thread_local_data_.data_.resize(index + 1);
@@ -3,6 +3,8 @@
 #include <atomic>
 #include <cstdint>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "envoy/thread_local/thread_local.h"
@@ -27,17 +29,45 @@ public:
   void shutdownThread() override;
 
 private:
+  /**
+   * Tracks the threads that still have to apply an update before its completion callback runs.
+   */
+  struct UpdateCompletion {
+    UpdateCompletion(uint32_t remaining, Event::PostCb cb) : remaining_(remaining), cb_(cb) {}
+
+    std::atomic<uint32_t> remaining_;
+    const Event::PostCb cb_;
+  };
+
+  typedef std::shared_ptr<UpdateCompletion> UpdateCompletionSharedPtr;
+
+  /**
+   * The newest update of a slot that one thread has not applied yet, along with the completions of
+   * the updates it superseded.
+   */
+  struct PendingUpdate {
+    std::mutex lock_;
+    Slot::InitializeCb cb_;
+    std::vector<UpdateCompletionSharedPtr> completions_;
+  };
+
+  typedef std::shared_ptr<PendingUpdate> PendingUpdateSharedPtr;
+
   struct SlotImpl : public Slot {
     SlotImpl(InstanceImpl& parent, uint64_t index) : parent_(parent), index_(index) {}
     ~SlotImpl() { parent_.removeSlot(*this); }
 
     // ThreadLocal::Slot
     ThreadLocalObjectSharedPtr get() override;
+    ThreadLocalObject& getObject() override;
     void runOnAllThreads(Event::PostCb cb) override { parent_.runOnAllThreads(cb); }
     void set(InitializeCb cb) override;
+    void update(InitializeCb cb, Event::PostCb complete_cb) override;
 
     InstanceImpl& parent_;
     const uint64_t index_;
+    // The updates waiting to be applied, in the order of parent_.registered_threads_.
+    std::vector<PendingUpdateSharedPtr> pending_updates_;
   };
 
   struct ThreadLocalData {
@@ -47,6 +77,8 @@ private:
   void removeSlot(SlotImpl& slot);
   void runOnAllThreads(Event::PostCb cb);
   static void setThreadLocal(uint32_t index, ThreadLocalObjectSharedPtr object);
+  static void applyPendingUpdate(uint32_t index, PendingUpdate& pending,
+                                 Event::Dispatcher& dispatcher, Event::Dispatcher& main_dispatcher);
 
   static thread_local ThreadLocalData thread_local_data_;
   std::vector<SlotImpl*> slots_;
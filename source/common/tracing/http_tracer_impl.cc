@@ -1,5 +1,6 @@
 #include "common/tracing/http_tracer_impl.h"
 
+#include <algorithm>
 #include <string>
 
 #include "common/common/assert.h"
@@ -10,6 +11,7 @@
 #include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
 #include "common/http/utility.h"
+#include "common/runtime/key_registry.h"
 #include "common/runtime/uuid_util.h"
 
 #include "spdlog/spdlog.h"
@@ -60,7 +62,8 @@ void HttpTracerUtility::mutateHeaders(Http::HeaderMap& request_headers, Runtime:
       UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::Client);
     } else if (request_headers.EnvoyForceTrace()) {
       UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::Forced);
-    } else if (runtime.snapshot().featureEnabled("tracing.random_sampling", 10000, result, 10000)) {
+    } else if (runtime.snapshot().getInteger(AdaptiveSampler::TRACES_PER_SECOND_KEY, 0) == 0 &&
+               runtime.snapshot().featureEnabled("tracing.random_sampling", 10000, result, 10000)) {
       UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::Sampled);
     }
   }
@@ -72,6 +75,90 @@ void HttpTracerUtility::mutateHeaders(Http::HeaderMap& request_headers, Runtime:
   request_headers.RequestId()->value(x_request_id);
 }
 
+void HttpTracerUtility::mutateHeaders(Http::HeaderMap& request_headers, Runtime::Loader& runtime,
+                                      AdaptiveSampler& sampler, const std::string& cluster_name) {
+  if (!request_headers.RequestId()) {
+    return;
+  }
+
+  std::string x_request_id = request_headers.RequestId()->value().c_str();
+
+  uint16_t result;
+  if (!UuidUtils::uuidModBy(x_request_id, result, 10000) ||
+      UuidTraceStatus::NoTrace != UuidUtils::isTraceableUuid(x_request_id)) {
+    return;
+  }
+
+  // The global switch applies to adaptive sampling as well.
+  if (!runtime.snapshot().featureEnabled("tracing.global_enabled", 100, result) ||
+      !sampler.sample(cluster_name)) {
+    return;
+  }
+
+  UuidUtils::setTraceableUuid(x_request_id, UuidTraceStatus::Sampled);
+  request_headers.RequestId()->value(x_request_id);
+}
+
+const Runtime::Key AdaptiveSampler::TRACES_PER_SECOND_KEY =
+    Runtime::KeyRegistry::key("tracing.adaptive_sampling.traces_per_second");
+
+AdaptiveSampler::Target::Target(uint32_t traces_per_second, MonotonicTimeSource& time_source)
+    : traces_per_second_(traces_per_second),
+      bucket_(traces_per_second, traces_per_second, std::chrono::milliseconds(1000), time_source) {}
+
+AdaptiveSampler::AdaptiveSampler(Runtime::Loader& runtime, ThreadLocal::SlotAllocator& tls,
+                                 MonotonicTimeSource& time_source)
+    : runtime_(runtime), time_source_(time_source), tls_(tls.allocateSlot()) {
+  tls_->set([](Event::Dispatcher&) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+    return std::make_shared<ThreadLocalCache>();
+  });
+}
+
+bool AdaptiveSampler::enabled() {
+  return runtime_.snapshot().getInteger(TRACES_PER_SECOND_KEY, 0) > 0;
+}
+
+bool AdaptiveSampler::sample(const std::string& cluster_name) {
+  std::unordered_map<std::string, CachedTarget>& targets =
+      tls_->getTyped<ThreadLocalCache>().targets_;
+  auto it = targets.find(cluster_name);
+  if (it == targets.end()) {
+    it = targets
+             .emplace(cluster_name,
+                      CachedTarget{Runtime::KeyRegistry::key(fmt::format(
+                                       "tracing.adaptive_sampling.{}.traces_per_second",
+                                       cluster_name)),
+                                   nullptr})
+             .first;
+  }
+
+  Runtime::Snapshot& snapshot = runtime_.snapshot();
+  const uint32_t traces_per_second = std::min<uint64_t>(
+      snapshot.getInteger(it->second.key_, snapshot.getInteger(TRACES_PER_SECOND_KEY, 0)),
+      UINT32_MAX);
+  if (traces_per_second == 0) {
+    return false;
+  }
+
+  // The cached bucket is replaced when the target changes.
+  if (!it->second.target_ || it->second.target_->traces_per_second_ != traces_per_second) {
+    it->second.target_ = sharedTarget(cluster_name, traces_per_second);
+  }
+
+  uint32_t remaining;
+  return it->second.target_->bucket_.consume(remaining);
+}
+
+AdaptiveSampler::TargetSharedPtr AdaptiveSampler::sharedTarget(const std::string& cluster_name,
+                                                               uint32_t traces_per_second) {
+  std::unique_lock<std::mutex> lock(lock_);
+  TargetSharedPtr& target = targets_[cluster_name];
+  if (!target || target->traces_per_second_ != traces_per_second) {
+    target = std::make_shared<Target>(traces_per_second, time_source_);
+  }
+  return target;
+}
+
 const std::string HttpTracerUtility::INGRESS_OPERATION = "ingress";
 const std::string HttpTracerUtility::EGRESS_OPERATION = "egress";
 
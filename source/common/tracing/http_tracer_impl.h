@@ -1,15 +1,22 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
+#include "envoy/common/time.h"
 #include "envoy/local_info/local_info.h"
 #include "envoy/runtime/runtime.h"
+#include "envoy/singleton/instance.h"
 #include "envoy/thread_local/thread_local.h"
 #include "envoy/tracing/http_tracer.h"
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/http/header_map_impl.h"
 #include "common/json/json_loader.h"
+#include "common/ratelimit/local_ratelimit_impl.h"
 
 namespace Envoy {
 namespace Tracing {
@@ -27,6 +34,62 @@ struct Decision {
   bool is_tracing;
 };
 
+/**
+ * Samples requests at a target number of traces per second per upstream cluster, in place of the
+ * fixed tracing.random_sampling percentage, so that the load on the collector stays the same as
+ * traffic grows and low traffic clusters still get traced. The target of a cluster is the runtime
+ * value tracing.adaptive_sampling.<cluster>.traces_per_second, which defaults to
+ * TRACES_PER_SECOND_KEY. Adaptive sampling is on while TRACES_PER_SECOND_KEY is above 0.
+ *
+ * All workers share one token bucket per cluster. Each worker finds the buckets through a cache of
+ * its own, so that a sampling decision takes no lock.
+ */
+class AdaptiveSampler : public Singleton::Instance {
+public:
+  AdaptiveSampler(Runtime::Loader& runtime, ThreadLocal::SlotAllocator& tls,
+                  MonotonicTimeSource& time_source);
+
+  /**
+   * @return bool whether adaptive sampling is on.
+   */
+  bool enabled();
+
+  /**
+   * @param cluster_name supplies the upstream cluster of a request.
+   * @return bool whether to trace the request.
+   */
+  bool sample(const std::string& cluster_name);
+
+  static const Runtime::Key TRACES_PER_SECOND_KEY;
+
+private:
+  struct Target {
+    Target(uint32_t traces_per_second, MonotonicTimeSource& time_source);
+
+    const uint32_t traces_per_second_;
+    RateLimit::TokenBucket bucket_;
+  };
+
+  typedef std::shared_ptr<Target> TargetSharedPtr;
+
+  struct CachedTarget {
+    Runtime::Key key_;
+    TargetSharedPtr target_;
+  };
+
+  struct ThreadLocalCache : public ThreadLocal::ThreadLocalObject {
+    std::unordered_map<std::string, CachedTarget> targets_;
+  };
+
+  TargetSharedPtr sharedTarget(const std::string& cluster_name, uint32_t traces_per_second);
+
+  Runtime::Loader& runtime_;
+  MonotonicTimeSource& time_source_;
+  ThreadLocal::SlotPtr tls_;
+  std::mutex lock_;
+  std::unordered_map<std::string, TargetSharedPtr> targets_;
+};
+
 class HttpTracerUtility {
 public:
   /**
@@ -50,6 +113,13 @@ public:
    */
   static void mutateHeaders(Http::HeaderMap& request_headers, Runtime::Loader& runtime);
 
+  /**
+   * Sample a request that mutateHeaders() left untraced, once its upstream cluster is known. Only
+   * used while adaptive sampling is on, in which case mutateHeaders() does no random sampling.
+   */
+  static void mutateHeaders(Http::HeaderMap& request_headers, Runtime::Loader& runtime,
+                            AdaptiveSampler& sampler, const std::string& cluster_name);
+
   /**
    * 1) Fill in span tags based on the response headers.
    * 2) Finish active span.
@@ -64,6 +134,14 @@ public:
 
 class NullSpan : public Span {
 public:
+  /**
+   * @return NullSpan& a span that may stand in for any request that is not traced.
+   */
+  static NullSpan& instance() {
+    static NullSpan* instance = new NullSpan();
+    return *instance;
+  }
+
   // Tracing::Span
   void setTag(const std::string&, const std::string&) override {}
   void finishSpan(SpanFinalizer&) override {}
@@ -4,7 +4,7 @@ namespace Envoy {
 namespace Zipkin {
 
 // TODO(fabolive): Need to avoid the copy to improve performance.
-bool SpanBuffer::addSpan(const Span& span) {
+bool SpanBuffer::addSpan(Span&& span) {
   if (span_buffer_.size() == span_buffer_.capacity()) {
     // Buffer full
     return false;
@@ -15,19 +15,27 @@ bool SpanBuffer::addSpan(const Span& span) {
 }
 
 std::string SpanBuffer::toStringifiedJsonArray() {
-  std::string stringified_json_array = "[";
+  rapidjson::StringBuffer buffer;
+  toJsonArray(buffer);
+  return buffer.GetString();
+}
 
-  if (pendingSpans()) {
-    stringified_json_array += span_buffer_[0].toJson();
-    const uint64_t size = span_buffer_.size();
-    for (uint64_t i = 1; i < size; i++) {
-      stringified_json_array += ",";
-      stringified_json_array += span_buffer_[i].toJson();
-    }
+void SpanBuffer::toJsonArray(rapidjson::StringBuffer& buffer) const {
+  buffer.Clear();
+  JsonWriter writer(buffer);
+  writer.StartArray();
+  for (const Span& span : span_buffer_) {
+    span.toJson(writer);
   }
-  stringified_json_array += "]";
+  writer.EndArray();
+}
 
-  return stringified_json_array;
+void SpanBuffer::toProto(zipkin::proto3::ListOfSpans& spans) const {
+  // Clearing keeps the span messages allocated, so that they are reused by the next flush.
+  spans.Clear();
+  for (const Span& span : span_buffer_) {
+    span.toProto(*spans.add_spans());
+  }
 }
 } // namespace Zipkin
 } // namespace Envoy
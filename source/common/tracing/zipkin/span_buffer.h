@@ -38,7 +38,7 @@ public:
    *
    * @return true if the span was successfully added, or false if the buffer was full.
    */
-  bool addSpan(const Span& span);
+  bool addSpan(Span&& span);
 
   /**
    * Empties the buffer. This method is supposed to be called when all buffered spans
@@ -57,6 +57,21 @@ public:
    */
   std::string toStringifiedJsonArray();
 
+  /**
+   * Writes the contents of the buffer as a JSON array of spans into the given buffer, which is
+   * cleared first. Reusing the buffer across flushes avoids allocating it again.
+   *
+   * @param buffer The buffer to write the array to.
+   */
+  void toJsonArray(rapidjson::StringBuffer& buffer) const;
+
+  /**
+   * Fills in the Zipkin v2 protobuf representation of the contents of the buffer.
+   *
+   * @param spans The message to fill in, which is cleared first.
+   */
+  void toProto(zipkin::proto3::ListOfSpans& spans) const;
+
 private:
   // We use a pre-allocated vector to improve performance
   std::vector<Span> span_buffer_;
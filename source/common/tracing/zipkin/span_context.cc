@@ -1,5 +1,6 @@
 #include "common/tracing/zipkin/span_context.h"
 
+#include "common/common/regex.h"
 #include "common/common/utility.h"
 #include "common/tracing/zipkin/zipkin_core_constants.h"
 
@@ -46,13 +47,13 @@ static const std::string& hexDigitGroupRegexStr() {
  * guaranteed). In this case, the compilation units are ZipkinCoreConstants and SpanContext.
  */
 static const std::string& spanContextRegexStr() {
-  // ^([0-9,a-z]{16});([0-9,a-z]{16});([0-9,a-z]{16})((;(cs|sr|cr|ss))*)$
+  // ([0-9,a-z]{16});([0-9,a-z]{16});([0-9,a-z]{16})((;(cs|sr|cr|ss))*), matched in full.
   static const std::string* span_context_regex_str = new std::string(
-      "^" + hexDigitGroupRegexStr() + fieldSeparator() + hexDigitGroupRegexStr() +
-      fieldSeparator() + hexDigitGroupRegexStr() + "((" + fieldSeparator() + "(" +
+      hexDigitGroupRegexStr() + fieldSeparator() + hexDigitGroupRegexStr() + fieldSeparator() +
+      hexDigitGroupRegexStr() + "((" + fieldSeparator() + "(" +
       ZipkinCoreConstants::get().CLIENT_SEND + "|" + ZipkinCoreConstants::get().SERVER_RECV + "|" +
       ZipkinCoreConstants::get().CLIENT_RECV + "|" + ZipkinCoreConstants::get().SERVER_SEND +
-      "))*)$");
+      "))*)");
 
   return *span_context_regex_str;
 }
@@ -63,8 +64,8 @@ static const std::string& spanContextRegexStr() {
  * Note that a function is needed because the string used to build the regex
  * cannot be initialized statically.
  */
-static const std::regex& spanContextRegex() {
-  static const std::regex* span_context_regex = new std::regex(spanContextRegexStr());
+static const Regex::Pattern& spanContextRegex() {
+  static const Regex::Pattern* span_context_regex = new Regex::Pattern(spanContextRegexStr());
 
   return *span_context_regex;
 }
@@ -91,15 +92,15 @@ const std::string SpanContext::serializeToString() {
 }
 
 void SpanContext::populateFromString(const std::string& span_context_str) {
-  std::smatch match;
+  std::vector<std::string> groups;
 
   trace_id_ = parent_id_ = id_ = 0;
 
-  if (std::regex_search(span_context_str, match, spanContextRegex())) {
+  if (spanContextRegex().fullMatch(span_context_str.data(), span_context_str.size(), &groups)) {
     // This is a valid string encoding of the context
-    trace_id_ = std::stoull(match.str(1), nullptr, 16);
-    id_ = std::stoull(match.str(2), nullptr, 16);
-    parent_id_ = std::stoull(match.str(3), nullptr, 16);
+    trace_id_ = std::stoull(groups[0], nullptr, 16);
+    id_ = std::stoull(groups[1], nullptr, 16);
+    parent_id_ = std::stoull(groups[2], nullptr, 16);
 
     is_initialized_ = true;
   } else {
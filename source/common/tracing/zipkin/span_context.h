@@ -1,6 +1,6 @@
 #pragma once
 
-#include <regex>
+#include <string>
 
 #include "common/tracing/zipkin/util.h"
 #include "common/tracing/zipkin/zipkin_core_types.h"
@@ -37,6 +37,11 @@ public:
   const std::string ALWAYS_SAMPLE = "1";
 
   const std::string DEFAULT_COLLECTOR_ENDPOINT = "/api/v1/spans";
+
+  // Collector encodings
+  const std::string JSON_ENCODING = "json";
+  const std::string PROTO_ENCODING = "proto";
+  const std::string PROTO_CONTENT_TYPE = "application/x-protobuf";
 };
 
 typedef ConstSingleton<ZipkinCoreConstantValues> ZipkinCoreConstants;
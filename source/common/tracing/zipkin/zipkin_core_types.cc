@@ -1,5 +1,8 @@
 #include "common/tracing/zipkin/zipkin_core_types.h"
 
+#include <array>
+#include <string>
+
 #include "common/common/utility.h"
 #include "common/tracing/zipkin/span_context.h"
 #include "common/tracing/zipkin/util.h"
@@ -13,6 +16,27 @@ namespace Envoy {
 // TODO(fabolive): Need to add interfaces to the JSON namespace
 
 namespace Zipkin {
+namespace {
+
+// Writes a 64-bit id as the 16 lowercase hex digits that Zipkin expects.
+void writeHex(JsonWriter& writer, uint64_t value) {
+  static const char digits[] = "0123456789abcdef";
+  char hex[16];
+  for (int i = 15; i >= 0; --i) {
+    hex[i] = digits[value & 0xf];
+    value >>= 4;
+  }
+  writer.String(hex, sizeof(hex));
+}
+
+// Appends a 64-bit id in big-endian order, as Zipkin v2 ids are encoded.
+void appendBigEndian(std::string& out, uint64_t value) {
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<char>((value >> shift) & 0xff));
+  }
+}
+
+} // namespace
 
 Endpoint::Endpoint(const Endpoint& ep) {
   service_name_ = ep.serviceName();
@@ -27,7 +51,12 @@ Endpoint& Endpoint::operator=(const Endpoint& ep) {
 
 const std::string Endpoint::toJson() {
   rapidjson::StringBuffer s;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+  JsonWriter writer(s);
+  toJson(writer);
+  return s.GetString();
+}
+
+void Endpoint::toJson(JsonWriter& writer) const {
   writer.StartObject();
   if (!address_) {
     writer.Key(ZipkinJsonFieldNames::get().ENDPOINT_IPV4.c_str());
@@ -49,9 +78,22 @@ const std::string Endpoint::toJson() {
   writer.Key(ZipkinJsonFieldNames::get().ENDPOINT_SERVICE_NAME.c_str());
   writer.String(service_name_.c_str());
   writer.EndObject();
-  std::string json_string = s.GetString();
+}
 
-  return json_string;
+void Endpoint::toProto(zipkin::proto3::Endpoint& endpoint) const {
+  endpoint.set_service_name(service_name_);
+  if (!address_) {
+    return;
+  }
+  if (address_->ip()->version() == Network::Address::IpVersion::v4) {
+    // ipv4()->address() is already in network order.
+    const uint32_t address = address_->ip()->ipv4()->address();
+    endpoint.set_ipv4(&address, sizeof(address));
+  } else {
+    const std::array<uint8_t, 16> address = address_->ip()->ipv6()->address();
+    endpoint.set_ipv6(address.data(), address.size());
+  }
+  endpoint.set_port(address_->ip()->port());
 }
 
 Annotation::Annotation(const Annotation& ann) {
@@ -80,22 +122,22 @@ void Annotation::changeEndpointServiceName(const std::string& service_name) {
 
 const std::string Annotation::toJson() {
   rapidjson::StringBuffer s;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+  JsonWriter writer(s);
+  toJson(writer);
+  return s.GetString();
+}
+
+void Annotation::toJson(JsonWriter& writer) const {
   writer.StartObject();
   writer.Key(ZipkinJsonFieldNames::get().ANNOTATION_TIMESTAMP.c_str());
   writer.Uint64(timestamp_);
   writer.Key(ZipkinJsonFieldNames::get().ANNOTATION_VALUE.c_str());
   writer.String(value_.c_str());
-  writer.EndObject();
-
-  std::string json_string = s.GetString();
-
   if (endpoint_.valid()) {
-    Util::mergeJsons(json_string, static_cast<Endpoint>(endpoint_.value()).toJson(),
-                     ZipkinJsonFieldNames::get().ANNOTATION_ENDPOINT.c_str());
+    writer.Key(ZipkinJsonFieldNames::get().ANNOTATION_ENDPOINT.c_str());
+    endpoint_.value().toJson(writer);
   }
-
-  return json_string;
+  writer.EndObject();
 }
 
 BinaryAnnotation::BinaryAnnotation(const BinaryAnnotation& ann) {
@@ -120,22 +162,22 @@ BinaryAnnotation& BinaryAnnotation::operator=(const BinaryAnnotation& ann) {
 
 const std::string BinaryAnnotation::toJson() {
   rapidjson::StringBuffer s;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+  JsonWriter writer(s);
+  toJson(writer);
+  return s.GetString();
+}
+
+void BinaryAnnotation::toJson(JsonWriter& writer) const {
   writer.StartObject();
   writer.Key(ZipkinJsonFieldNames::get().BINARY_ANNOTATION_KEY.c_str());
   writer.String(key_.c_str());
   writer.Key(ZipkinJsonFieldNames::get().BINARY_ANNOTATION_VALUE.c_str());
   writer.String(value_.c_str());
-  writer.EndObject();
-
-  std::string json_string = s.GetString();
-
   if (endpoint_.valid()) {
-    Util::mergeJsons(json_string, static_cast<Endpoint>(endpoint_.value()).toJson(),
-                     ZipkinJsonFieldNames::get().BINARY_ANNOTATION_ENDPOINT.c_str());
+    writer.Key(ZipkinJsonFieldNames::get().BINARY_ANNOTATION_ENDPOINT.c_str());
+    endpoint_.value().toJson(writer);
   }
-
-  return json_string;
+  writer.EndObject();
 }
 
 const std::string Span::EMPTY_HEX_STRING_ = "0000000000000000";
@@ -171,18 +213,23 @@ void Span::setServiceName(const std::string& service_name) {
 
 const std::string Span::toJson() {
   rapidjson::StringBuffer s;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(s);
+  JsonWriter writer(s);
+  toJson(writer);
+  return s.GetString();
+}
+
+void Span::toJson(JsonWriter& writer) const {
   writer.StartObject();
   writer.Key(ZipkinJsonFieldNames::get().SPAN_TRACE_ID.c_str());
-  writer.String(Hex::uint64ToHex(trace_id_).c_str());
+  writeHex(writer, trace_id_);
   writer.Key(ZipkinJsonFieldNames::get().SPAN_NAME.c_str());
   writer.String(name_.c_str());
   writer.Key(ZipkinJsonFieldNames::get().SPAN_ID.c_str());
-  writer.String(Hex::uint64ToHex(id_).c_str());
+  writeHex(writer, id_);
 
   if (parent_id_.valid() && parent_id_.value()) {
     writer.Key(ZipkinJsonFieldNames::get().SPAN_PARENT_ID.c_str());
-    writer.String(Hex::uint64ToHex(parent_id_.value()).c_str());
+    writeHex(writer, parent_id_.value());
   }
 
   if (timestamp_.valid()) {
@@ -195,26 +242,64 @@ const std::string Span::toJson() {
     writer.Int64(duration_.value());
   }
 
-  writer.EndObject();
+  writer.Key(ZipkinJsonFieldNames::get().SPAN_ANNOTATIONS.c_str());
+  writer.StartArray();
+  for (const Annotation& annotation : annotations_) {
+    annotation.toJson(writer);
+  }
+  writer.EndArray();
 
-  std::string json_string = s.GetString();
+  writer.Key(ZipkinJsonFieldNames::get().SPAN_BINARY_ANNOTATIONS.c_str());
+  writer.StartArray();
+  for (const BinaryAnnotation& binary_annotation : binary_annotations_) {
+    binary_annotation.toJson(writer);
+  }
+  writer.EndArray();
 
-  std::vector<std::string> annotation_json_vector;
+  writer.EndObject();
+}
 
-  for (auto it = annotations_.begin(); it != annotations_.end(); it++) {
-    annotation_json_vector.push_back(it->toJson());
+void Span::toProto(zipkin::proto3::Span& span) const {
+  if (trace_id_high_.valid()) {
+    appendBigEndian(*span.mutable_trace_id(), trace_id_high_.value());
+  }
+  appendBigEndian(*span.mutable_trace_id(), trace_id_);
+  appendBigEndian(*span.mutable_id(), id_);
+  if (parent_id_.valid() && parent_id_.value()) {
+    appendBigEndian(*span.mutable_parent_id(), parent_id_.value());
+  }
+  span.set_name(name_);
+  span.set_debug(debug_);
+
+  // The v2 model has a kind and a local endpoint instead of the core annotations of v1.
+  const Annotation* start = annotations_.empty() ? nullptr : &annotations_.front();
+  const Annotation* end = annotations_.size() < 2 ? nullptr : &annotations_[1];
+  if (start != nullptr) {
+    if (start->value() == ZipkinCoreConstants::get().SERVER_RECV) {
+      span.set_kind(zipkin::proto3::Span::SERVER);
+      span.set_shared(!timestamp_.valid());
+    } else if (start->value() == ZipkinCoreConstants::get().CLIENT_SEND) {
+      span.set_kind(zipkin::proto3::Span::CLIENT);
+    }
+    if (start->isSetEndpoint()) {
+      start->endpoint().toProto(*span.mutable_local_endpoint());
+    }
   }
-  Util::addArrayToJson(json_string, annotation_json_vector,
-                       ZipkinJsonFieldNames::get().SPAN_ANNOTATIONS.c_str());
 
-  std::vector<std::string> binary_annotation_json_vector;
-  for (auto it = binary_annotations_.begin(); it != binary_annotations_.end(); it++) {
-    binary_annotation_json_vector.push_back(it->toJson());
+  if (timestamp_.valid()) {
+    span.set_timestamp(timestamp_.value());
+  } else if (start != nullptr) {
+    span.set_timestamp(start->timestamp());
+  }
+  if (duration_.valid()) {
+    span.set_duration(duration_.value());
+  } else if (start != nullptr && end != nullptr && end->timestamp() > start->timestamp()) {
+    span.set_duration(end->timestamp() - start->timestamp());
   }
-  Util::addArrayToJson(json_string, binary_annotation_json_vector,
-                       ZipkinJsonFieldNames::get().SPAN_BINARY_ANNOTATIONS.c_str());
 
-  return json_string;
+  for (const BinaryAnnotation& binary_annotation : binary_annotations_) {
+    (*span.mutable_tags())[binary_annotation.key()] = binary_annotation.value();
+  }
 }
 
 void Span::finish() {
@@ -254,7 +339,7 @@ void Span::finish() {
 
 void Span::setTag(const std::string& name, const std::string& value) {
   if (name.size() > 0 && value.size() > 0) {
-    addBinaryAnnotation(BinaryAnnotation(name, value));
+    binary_annotations_.emplace_back(name, value);
   }
 }
 } // namespace Zipkin
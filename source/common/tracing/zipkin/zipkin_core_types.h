@@ -9,10 +9,16 @@
 #include "common/common/hex.h"
 #include "common/tracing/zipkin/tracer_interface.h"
 #include "common/tracing/zipkin/util.h"
+#include "common/tracing/zipkin/zipkin.pb.h"
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 
 namespace Envoy {
 namespace Zipkin {
 
+typedef rapidjson::Writer<rapidjson::StringBuffer> JsonWriter;
+
 /**
  * Base class to be inherited by all classes that represent Zipkin-related concepts, namely:
  * endpoint, annotation, binary annotation, and span.
@@ -47,6 +53,12 @@ public:
    */
   Endpoint& operator=(const Endpoint&);
 
+  /**
+   * Move constructor and assignment operator.
+   */
+  Endpoint(Endpoint&&) = default;
+  Endpoint& operator=(Endpoint&&) = default;
+
   /**
    * Default constructor. Creates an empty Endpoint.
    */
@@ -88,6 +100,20 @@ public:
    */
   const std::string toJson() override;
 
+  /**
+   * Writes the endpoint as a Zipkin-compliant JSON object.
+   *
+   * @param writer The writer to write the object to.
+   */
+  void toJson(JsonWriter& writer) const;
+
+  /**
+   * Fills in the Zipkin v2 protobuf representation of the endpoint.
+   *
+   * @param endpoint The message to fill in.
+   */
+  void toProto(zipkin::proto3::Endpoint& endpoint) const;
+
 private:
   std::string service_name_;
   Network::Address::InstanceConstSharedPtr address_;
@@ -109,6 +135,12 @@ public:
    */
   Annotation& operator=(const Annotation&);
 
+  /**
+   * Move constructor and assignment operator.
+   */
+  Annotation(Annotation&&) = default;
+  Annotation& operator=(Annotation&&) = default;
+
   /**
    * Default constructor. Creates an empty annotation.
    */
@@ -180,6 +212,13 @@ public:
    */
   const std::string toJson() override;
 
+  /**
+   * Writes the annotation as a Zipkin-compliant JSON object.
+   *
+   * @param writer The writer to write the object to.
+   */
+  void toJson(JsonWriter& writer) const;
+
 private:
   uint64_t timestamp_;
   std::string value_;
@@ -208,6 +247,12 @@ public:
    */
   BinaryAnnotation& operator=(const BinaryAnnotation&);
 
+  /**
+   * Move constructor and assignment operator.
+   */
+  BinaryAnnotation(BinaryAnnotation&&) = default;
+  BinaryAnnotation& operator=(BinaryAnnotation&&) = default;
+
   /**
    * Default constructor. Creates an empty binary annotation.
    */
@@ -279,6 +324,13 @@ public:
    */
   const std::string toJson() override;
 
+  /**
+   * Writes the binary annotation as a Zipkin-compliant JSON object.
+   *
+   * @param writer The writer to write the object to.
+   */
+  void toJson(JsonWriter& writer) const;
+
 private:
   std::string key_;
   std::string value_;
@@ -298,6 +350,18 @@ public:
    */
   Span(const Span&);
 
+  /**
+   * Assignment operator.
+   */
+  Span& operator=(const Span&) = default;
+
+  /**
+   * Move constructor and assignment operator. Spans are moved from the tracer to the reporter's
+   * buffer, so that their annotations are not copied.
+   */
+  Span(Span&&) = default;
+  Span& operator=(Span&&) = default;
+
   /**
    * Default constructor. Creates an empty span.
    */
@@ -347,7 +411,7 @@ public:
   /**
    * Adds an annotation to the span (move semantics).
    */
-  void addAnnotation(const Annotation&& ann) { annotations_.push_back(ann); }
+  void addAnnotation(Annotation&& ann) { annotations_.push_back(std::move(ann)); }
 
   /**
    * Sets the span's binary annotations all at once.
@@ -362,7 +426,9 @@ public:
   /**
    * Adds a binary annotation to the span (move semantics).
    */
-  void addBinaryAnnotation(const BinaryAnnotation&& bann) { binary_annotations_.push_back(bann); }
+  void addBinaryAnnotation(BinaryAnnotation&& bann) {
+    binary_annotations_.push_back(std::move(bann));
+  }
 
   /**
    * Sets the span's debug attribute.
@@ -496,6 +562,23 @@ public:
    */
   const std::string toJson() override;
 
+  /**
+   * Writes the span as a Zipkin-compliant JSON object, without building any intermediate
+   * strings.
+   *
+   * @param writer The writer to write the object to.
+   */
+  void toJson(JsonWriter& writer) const;
+
+  /**
+   * Fills in the Zipkin v2 protobuf representation of the span. The kind of the span comes from
+   * its first annotation, and a server span without a timestamp of its own is marked as sharing
+   * its id with the client span.
+   *
+   * @param span The message to fill in.
+   */
+  void toProto(zipkin::proto3::Span& span) const;
+
   /**
    * Associates a Tracer object with the span. The tracer's reportSpan() method is invoked
    * by the span's finish() method so that the tracer can decide what to do with the span
@@ -517,6 +600,7 @@ public:
    * annotation will need to add a CR annotation) and add them;
    * (2) compute and set the span's duration; and
    * (3) invoke the tracer's reportSpan() method if a tracer has been associated with the span.
+   * The span is moved to the tracer, so it is left empty in that case.
    */
   void finish();
 
@@ -12,40 +12,41 @@
 namespace Envoy {
 namespace Zipkin {
 
-ZipkinSpan::ZipkinSpan(Zipkin::Span& span, Zipkin::Tracer& tracer) : span_(span), tracer_(tracer) {}
+ZipkinSpan::ZipkinSpan(Zipkin::SpanPtr&& span, Zipkin::Tracer& tracer)
+    : span_(std::move(span)), tracer_(tracer) {}
 
 void ZipkinSpan::finishSpan(Tracing::SpanFinalizer& finalizer) {
   finalizer.finalize(*this);
-  span_.finish();
+  span_->finish();
 }
 
 void ZipkinSpan::setTag(const std::string& name, const std::string& value) {
-  span_.setTag(name, value);
+  span_->setTag(name, value);
 }
 
 void ZipkinSpan::injectContext(Http::HeaderMap& request_headers) {
   // Set the trace-id and span-id headers properly, based on the newly-created span structure.
-  request_headers.insertXB3TraceId().value(span_.traceIdAsHexString());
-  request_headers.insertXB3SpanId().value(span_.idAsHexString());
+  request_headers.insertXB3TraceId().value(span_->traceIdAsHexString());
+  request_headers.insertXB3SpanId().value(span_->idAsHexString());
 
   // Set the parent-span header properly, based on the newly-created span structure.
-  if (span_.isSetParentId()) {
-    request_headers.insertXB3ParentSpanId().value(span_.parentIdAsHexString());
+  if (span_->isSetParentId()) {
+    request_headers.insertXB3ParentSpanId().value(span_->parentIdAsHexString());
   }
 
   // Set the sampled header.
   request_headers.insertXB3Sampled().value().setReference(ZipkinCoreConstants::get().ALWAYS_SAMPLE);
 
   // Set the ot-span-context header with the new context.
-  SpanContext context(span_);
+  SpanContext context(*span_);
   request_headers.insertOtSpanContext().value(context.serializeToString());
 }
 
 Tracing::SpanPtr ZipkinSpan::spawnChild(const Tracing::Config& config, const std::string& name,
                                         SystemTime start_time) {
-  SpanContext context(span_);
+  SpanContext context(*span_);
   return Tracing::SpanPtr{
-      new ZipkinSpan(*tracer_.startSpan(config, name, start_time, context), tracer_)};
+      new ZipkinSpan(tracer_.startSpan(config, name, start_time, context), tracer_)};
 }
 
 Driver::TlsTracer::TlsTracer(TracerPtr&& tracer, Driver& driver)
@@ -67,13 +68,18 @@ Driver::Driver(const Json::Object& config, Upstream::ClusterManager& cluster_man
 
   const std::string collector_endpoint =
       config.getString("collector_endpoint", ZipkinCoreConstants::get().DEFAULT_COLLECTOR_ENDPOINT);
+  const CollectorEncoding encoding =
+      config.getString("collector_encoding", ZipkinCoreConstants::get().JSON_ENCODING) ==
+              ZipkinCoreConstants::get().PROTO_ENCODING
+          ? CollectorEncoding::Proto
+          : CollectorEncoding::Json;
 
-  tls_->set([this, collector_endpoint, &random_generator](
+  tls_->set([this, collector_endpoint, encoding, &random_generator](
                 Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
     TracerPtr tracer(
         new Tracer(local_info_.clusterName(), local_info_.address(), random_generator));
-    tracer->setReporter(
-        ReporterImpl::NewInstance(std::ref(*this), std::ref(dispatcher), collector_endpoint));
+    tracer->setReporter(ReporterImpl::NewInstance(std::ref(*this), std::ref(dispatcher),
+                                                  collector_endpoint, encoding));
     return ThreadLocal::ThreadLocalObjectSharedPtr{new TlsTracer(std::move(tracer), *this)};
   });
 }
@@ -110,13 +116,13 @@ Tracing::SpanPtr Driver::startSpan(const Tracing::Config& config, Http::HeaderMa
     new_zipkin_span = tracer.startSpan(config, request_headers.Host()->value().c_str(), start_time);
   }
 
-  ZipkinSpanPtr active_span(new ZipkinSpan(*new_zipkin_span, tracer));
+  ZipkinSpanPtr active_span(new ZipkinSpan(std::move(new_zipkin_span), tracer));
   return std::move(active_span);
 }
 
 ReporterImpl::ReporterImpl(Driver& driver, Event::Dispatcher& dispatcher,
-                           const std::string& collector_endpoint)
-    : driver_(driver), collector_endpoint_(collector_endpoint) {
+                           const std::string& collector_endpoint, CollectorEncoding encoding)
+    : driver_(driver), collector_endpoint_(collector_endpoint), encoding_(encoding) {
   flush_timer_ = dispatcher.createTimer([this]() -> void {
     driver_.tracerStats().timer_flushed_.inc();
     flushSpans();
@@ -131,13 +137,14 @@ ReporterImpl::ReporterImpl(Driver& driver, Event::Dispatcher& dispatcher,
 }
 
 ReporterPtr ReporterImpl::NewInstance(Driver& driver, Event::Dispatcher& dispatcher,
-                                      const std::string& collector_endpoint) {
-  return ReporterPtr(new ReporterImpl(driver, dispatcher, collector_endpoint));
+                                      const std::string& collector_endpoint,
+                                      CollectorEncoding encoding) {
+  return ReporterPtr(new ReporterImpl(driver, dispatcher, collector_endpoint, encoding));
 }
 
 // TODO(fabolive): Need to avoid the copy to improve performance.
-void ReporterImpl::reportSpan(const Span& span) {
-  span_buffer_.addSpan(span);
+void ReporterImpl::reportSpan(Span&& span) {
+  span_buffer_.addSpan(std::move(span));
 
   const uint64_t min_flush_spans =
       driver_.runtime().snapshot().getInteger("tracing.zipkin.min_flush_spans", 5U);
@@ -157,23 +164,31 @@ void ReporterImpl::flushSpans() {
   if (span_buffer_.pendingSpans()) {
     driver_.tracerStats().spans_sent_.add(span_buffer_.pendingSpans());
 
-    const std::string request_body = span_buffer_.toStringifiedJsonArray();
     Http::MessagePtr message(new Http::RequestMessageImpl());
     message->headers().insertMethod().value().setReference(Http::Headers::get().MethodValues.Post);
     message->headers().insertPath().value(collector_endpoint_);
     message->headers().insertHost().value(driver_.cluster()->name());
-    message->headers().insertContentType().value().setReference(
-        Http::Headers::get().ContentTypeValues.Json);
 
     Buffer::InstancePtr body(new Buffer::OwnedImpl());
-    body->add(request_body);
+    if (encoding_ == CollectorEncoding::Proto) {
+      message->headers().insertContentType().value().setReference(
+          ZipkinCoreConstants::get().PROTO_CONTENT_TYPE);
+      span_buffer_.toProto(proto_spans_);
+      proto_spans_.SerializeToString(&proto_buffer_);
+      body->add(proto_buffer_);
+    } else {
+      message->headers().insertContentType().value().setReference(
+          Http::Headers::get().ContentTypeValues.Json);
+      span_buffer_.toJsonArray(json_buffer_);
+      body->add(json_buffer_.GetString(), json_buffer_.GetSize());
+    }
     message->body() = std::move(body);
 
     const uint64_t timeout =
         driver_.runtime().snapshot().getInteger("tracing.zipkin.request_timeout", 5000U);
     driver_.clusterManager()
         .httpAsyncClientForCluster(driver_.cluster()->name())
-        .send(std::move(message), *this, std::chrono::milliseconds(timeout));
+        .sendDirect(std::move(message), *this, std::chrono::milliseconds(timeout), "zipkin");
 
     span_buffer_.clear();
   }
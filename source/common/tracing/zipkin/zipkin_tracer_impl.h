@@ -25,6 +25,12 @@ struct ZipkinTracerStats {
   ZIPKIN_TRACER_STATS(GENERATE_COUNTER_STRUCT)
 };
 
+/**
+ * Encoding of the spans sent to the collector: Zipkin v1 JSON, or a Zipkin v2 protobuf
+ * ListOfSpans.
+ */
+enum class CollectorEncoding { Json, Proto };
+
 /**
  * Class for Zipkin spans, wrapping a Zipkin::Span object.
  */
@@ -35,7 +41,7 @@ public:
    *
    * @param span to be wrapped.
    */
-  ZipkinSpan(Zipkin::Span& span, Zipkin::Tracer& tracer);
+  ZipkinSpan(Zipkin::SpanPtr&& span, Zipkin::Tracer& tracer);
 
   /**
    * Calls Zipkin::Span::finishSpan() to perform all actions needed to finalize the span.
@@ -62,10 +68,10 @@ public:
   /**
    * @return a reference to the Zipkin::Span object.
    */
-  Zipkin::Span& span() { return span_; }
+  Zipkin::Span& span() { return *span_; }
 
 private:
-  Zipkin::Span span_;
+  Zipkin::SpanPtr span_;
   Zipkin::Tracer& tracer_;
 };
 
@@ -125,7 +131,7 @@ private:
 /**
  * This class derives from the abstract Zipkin::Reporter.
  * It buffers spans and relies on Http::AsyncClient to send spans to
- * Zipkin using JSON over HTTP.
+ * Zipkin using JSON or protobuf over HTTP.
  *
  * Two runtime parameters control the span buffering/flushing behavior, namely:
  * tracing.zipkin.min_flush_spans and tracing.zipkin.flush_interval_ms.
@@ -146,9 +152,10 @@ public:
    * @param collector_endpoint String representing the Zipkin endpoint to be used
    * when making HTTP POST requests carrying spans. This value comes from the
    * Zipkin-related tracing configuration.
+   * @param encoding The encoding of the spans sent to the collector.
    */
   ReporterImpl(Driver& driver, Event::Dispatcher& dispatcher,
-               const std::string& collector_endpoint);
+               const std::string& collector_endpoint, CollectorEncoding encoding);
 
   /**
    * Implementation of Zipkin::Reporter::reportSpan().
@@ -157,7 +164,7 @@ public:
    *
    * @param span The span to be buffered.
    */
-  void reportSpan(const Span& span) override;
+  void reportSpan(Span&& span) override;
 
   // Http::AsyncClient::Callbacks.
   // The callbacks below record Zipkin-span-related stats.
@@ -172,11 +179,13 @@ public:
    * @param collector_endpoint String representing the Zipkin endpoint to be used
    * when making HTTP POST requests carrying spans. This value comes from the
    * Zipkin-related tracing configuration.
+   * @param encoding The encoding of the spans sent to the collector.
    *
    * @return Pointer to the newly-created ZipkinReporter.
    */
   static ReporterPtr NewInstance(Driver& driver, Event::Dispatcher& dispatcher,
-                                 const std::string& collector_endpoint);
+                                 const std::string& collector_endpoint,
+                                 CollectorEncoding encoding);
 
 private:
   /**
@@ -193,6 +202,11 @@ private:
   Event::TimerPtr flush_timer_;
   SpanBuffer span_buffer_;
   const std::string collector_endpoint_;
+  const CollectorEncoding encoding_;
+  // Kept across flushes, so that encoding a batch reuses the memory of the previous one.
+  rapidjson::StringBuffer json_buffer_;
+  zipkin::proto3::ListOfSpans proto_spans_;
+  std::string proto_buffer_;
 };
 } // Zipkin
 } // namespace Envoy
@@ -24,7 +24,7 @@ CdsApiImpl::CdsApiImpl(const envoy::api::v2::ConfigSource& cds_config,
                        const LocalInfo::LocalInfo& local_info, Stats::Scope& scope)
     : cm_(cm), scope_(scope.createScope("cluster_manager.cds.")) {
   Config::Utility::checkLocalInfo("cds", local_info);
-  subscription_ =
+  subscription_.reset(new Config::DeltaSubscriptionImpl<envoy::api::v2::Cluster>(
       Config::SubscriptionFactory::subscriptionFromConfigSource<envoy::api::v2::Cluster>(
           cds_config, local_info.node(), dispatcher, cm, random, *scope_,
           [this, &cds_config, &eds_config, &cm, &dispatcher, &random,
@@ -33,23 +33,22 @@ CdsApiImpl::CdsApiImpl(const envoy::api::v2::ConfigSource& cds_config,
                                        eds_config, cm, dispatcher, random, local_info);
           },
           "envoy.api.v2.ClusterDiscoveryService.FetchClusters",
-          "envoy.api.v2.ClusterDiscoveryService.StreamClusters");
+          "envoy.api.v2.ClusterDiscoveryService.StreamClusters")));
 }
 
-void CdsApiImpl::onConfigUpdate(const ResourceVector& resources) {
-  // We need to keep track of which clusters we might need to remove.
-  ClusterManager::ClusterInfoMap clusters_to_remove = cm_.clusters();
-  for (auto& cluster : resources) {
-    const std::string cluster_name = cluster.name();
-    clusters_to_remove.erase(cluster_name);
-    if (cm_.addOrUpdatePrimaryCluster(cluster)) {
-      ENVOY_LOG(info, "cds: add/update cluster '{}'", cluster_name);
+void CdsApiImpl::onConfigUpdate(const ResourceVector& added_or_changed,
+                                const std::vector<uint64_t>& hashes,
+                                const std::vector<std::string>& removed) {
+  for (int i = 0; i < added_or_changed.size(); i++) {
+    const auto& cluster = added_or_changed[i];
+    if (cm_.addOrUpdatePrimaryCluster(cluster, hashes[i])) {
+      ENVOY_LOG(info, "cds: add/update cluster '{}'", cluster.name());
     }
   }
 
-  for (auto cluster : clusters_to_remove) {
-    if (cm_.removePrimaryCluster(cluster.first)) {
-      ENVOY_LOG(info, "cds: remove cluster '{}'", cluster.first);
+  for (const std::string& cluster_name : removed) {
+    if (cm_.removePrimaryCluster(cluster_name)) {
+      ENVOY_LOG(info, "cds: remove cluster '{}'", cluster_name);
     }
   }
 
@@ -8,6 +8,7 @@
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/common/logger.h"
+#include "common/config/delta_subscription_impl.h"
 
 #include "api/cds.pb.h"
 
@@ -18,7 +19,7 @@ namespace Upstream {
  * CDS API implementation that fetches via Subscription.
  */
 class CdsApiImpl : public CdsApi,
-                   Config::SubscriptionCallbacks<envoy::api::v2::Cluster>,
+                   Config::DeltaSubscriptionCallbacks<envoy::api::v2::Cluster>,
                    Logger::Loggable<Logger::Id::upstream> {
 public:
   static CdsApiPtr create(const envoy::api::v2::ConfigSource& cds_config,
@@ -40,12 +41,13 @@ private:
              const LocalInfo::LocalInfo& local_info, Stats::Scope& scope);
   void runInitializeCallbackIfAny();
 
-  // Config::SubscriptionCallbacks
-  void onConfigUpdate(const ResourceVector& resources) override;
+  // Config::DeltaSubscriptionCallbacks
+  void onConfigUpdate(const ResourceVector& added_or_changed, const std::vector<uint64_t>& hashes,
+                      const std::vector<std::string>& removed) override;
   void onConfigUpdateFailed(const EnvoyException* e) override;
 
   ClusterManager& cm_;
-  std::unique_ptr<Config::Subscription<envoy::api::v2::Cluster>> subscription_;
+  std::unique_ptr<Config::DeltaSubscriptionImpl<envoy::api::v2::Cluster>> subscription_;
   std::function<void()> initialize_callback_;
   Stats::ScopePtr scope_;
 };
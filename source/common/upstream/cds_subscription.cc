@@ -20,7 +20,8 @@ CdsSubscription::CdsSubscription(Config::SubscriptionStats stats,
                                  Runtime::RandomGenerator& random,
                                  const LocalInfo::LocalInfo& local_info)
     : RestApiFetcher(cm, cds_config.api_config_source().cluster_name()[0], dispatcher, random,
-                     Config::Utility::apiConfigSourceRefreshDelay(cds_config.api_config_source())),
+                     Config::Utility::apiConfigSourceRefreshDelay(cds_config.api_config_source()),
+                     "cds"),
       local_info_(local_info), stats_(stats), eds_config_(eds_config) {
   const auto& api_config_source = cds_config.api_config_source();
   UNREFERENCED_PARAMETER(api_config_source);
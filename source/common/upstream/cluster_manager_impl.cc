@@ -1,10 +1,13 @@
 #include "common/upstream/cluster_manager_impl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <functional>
 #include <list>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "envoy/event/dispatcher.h"
@@ -12,10 +15,13 @@
 #include "envoy/runtime/runtime.h"
 
 #include "common/common/enum_to_int.h"
+#include "common/common/thread.h"
 #include "common/common/utility.h"
 #include "common/config/cds_json.h"
 #include "common/config/utility.h"
+#include "common/http/alpn_conn_pool.h"
 #include "common/http/async_client_impl.h"
+#include "common/http/forwarding_conn_pool.h"
 #include "common/http/http1/conn_pool.h"
 #include "common/http/http2/conn_pool.h"
 #include "common/json/config_schemas.h"
@@ -25,7 +31,6 @@
 #include "common/upstream/cds_api_impl.h"
 #include "common/upstream/load_balancer_impl.h"
 #include "common/upstream/original_dst_cluster.h"
-#include "common/upstream/ring_hash_lb.h"
 
 #include "spdlog/spdlog.h"
 
@@ -163,7 +168,8 @@ ClusterManagerImpl::ClusterManagerImpl(const envoy::api::v2::Bootstrap& bootstra
                                        const LocalInfo::LocalInfo& local_info,
                                        AccessLog::AccessLogManager& log_manager)
     : factory_(factory), runtime_(runtime), stats_(stats), tls_(tls.allocateSlot()),
-      random_(random), local_info_(local_info), cm_stats_(generateStats(stats)) {
+      random_(random), local_info_(local_info), cm_stats_(generateStats(stats)),
+      main_thread_id_(std::this_thread::get_id()) {
   const auto& cm_config = bootstrap.cluster_manager();
   if (cm_config.has_outlier_detection()) {
     const std::string event_log_file_path = cm_config.outlier_detection().event_log_path();
@@ -183,8 +189,14 @@ ClusterManagerImpl::ClusterManagerImpl(const envoy::api::v2::Bootstrap& bootstra
         bootstrap.cluster_manager().upstream_bind_config().source_address());
   }
 
-  for (const auto& cluster : bootstrap.static_resources().clusters()) {
-    loadCluster(cluster, false);
+  if (!cm_config.local_cluster_name().empty()) {
+    local_cluster_name_.value(cm_config.local_cluster_name());
+  }
+
+  const auto& clusters = bootstrap.static_resources().clusters();
+  const std::vector<uint64_t> config_hashes = hashClusters(clusters);
+  for (int i = 0; i < clusters.size(); i++) {
+    loadCluster(clusters[i], config_hashes[i], false);
   }
 
   // We can now potentially create the CDS API once the backing cluster exists.
@@ -195,19 +207,15 @@ ClusterManagerImpl::ClusterManagerImpl(const envoy::api::v2::Bootstrap& bootstra
     init_helper_.setCds(nullptr);
   }
 
-  Optional<std::string> local_cluster_name;
-  if (!cm_config.local_cluster_name().empty()) {
-    local_cluster_name.value(cm_config.local_cluster_name());
-    if (primary_clusters_.find(local_cluster_name.value()) == primary_clusters_.end()) {
-      throw EnvoyException(
-          fmt::format("local cluster '{}' must be defined", local_cluster_name.value()));
-    }
+  if (local_cluster_name_.valid() &&
+      primary_clusters_.find(local_cluster_name_.value()) == primary_clusters_.end()) {
+    throw EnvoyException(
+        fmt::format("local cluster '{}' must be defined", local_cluster_name_.value()));
   }
 
-  tls_->set([this, local_cluster_name](
-                Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
+  tls_->set([this](Event::Dispatcher& dispatcher) -> ThreadLocal::ThreadLocalObjectSharedPtr {
     return ThreadLocal::ThreadLocalObjectSharedPtr{
-        new ThreadLocalClusterManagerImpl(*this, dispatcher, local_cluster_name)};
+        new ThreadLocalClusterManagerImpl(*this, dispatcher, local_cluster_name_)};
   });
 
   // To avoid threading issues, for those clusters that start with hosts already in them (like the
@@ -215,34 +223,66 @@ ClusterManagerImpl::ClusterManagerImpl(const envoy::api::v2::Bootstrap& bootstra
   // also require this for dynamic clusters where an immediate resolve occurred in the cluster
   // constructor, prior to the member update callback being configured.
   for (auto& cluster : primary_clusters_) {
-    postInitializeCluster(*cluster.second.cluster_);
+    postInitializeCluster(cluster.second);
   }
 
   init_helper_.onStaticLoadComplete();
 }
 
+std::vector<uint64_t> ClusterManagerImpl::hashClusters(
+    const Protobuf::RepeatedPtrField<envoy::api::v2::Cluster>& clusters) {
+  // Hashing serializes the whole config of a cluster and needs nothing but the proto, so unlike
+  // building the cluster it can run off the main thread. With many clusters it is spread over a
+  // few short lived threads, each taking every n-th cluster.
+  std::vector<uint64_t> config_hashes(clusters.size());
+  const uint32_t num_threads = std::max(
+      1U, std::min(std::thread::hardware_concurrency(),
+                   static_cast<uint32_t>(clusters.size()) / MIN_CLUSTERS_PER_HASH_THREAD));
+  auto hash_every_nth = [&clusters, &config_hashes, num_threads](uint32_t first) -> void {
+    for (int i = first; i < clusters.size(); i += num_threads) {
+      config_hashes[i] = MessageUtil::hash(clusters[i]);
+    }
+  };
+
+  std::vector<std::unique_ptr<Thread::Thread>> threads;
+  for (uint32_t first = 1; first < num_threads; first++) {
+    threads.emplace_back(new Thread::Thread([&hash_every_nth, first]() { hash_every_nth(first); }));
+  }
+  hash_every_nth(0);
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  return config_hashes;
+}
+
 ClusterManagerStats ClusterManagerImpl::generateStats(Stats::Scope& scope) {
   const std::string final_prefix = "cluster_manager.";
   return {ALL_CLUSTER_MANAGER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix),
                                     POOL_GAUGE_PREFIX(scope, final_prefix))};
 }
 
-void ClusterManagerImpl::postInitializeCluster(Cluster& cluster) {
-  if (cluster.hosts().empty()) {
+void ClusterManagerImpl::postInitializeCluster(const PrimaryClusterData& cluster) {
+  if (cluster.cluster_->hosts().empty()) {
     return;
   }
 
-  postThreadLocalClusterUpdate(cluster, cluster.hosts(), std::vector<HostSharedPtr>{});
+  postThreadLocalClusterUpdate(*cluster.cluster_, cluster.on_demand_, cluster.cluster_->hosts(),
+                               std::vector<HostSharedPtr>{});
 }
 
 bool ClusterManagerImpl::addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster& cluster) {
+  return addOrUpdatePrimaryCluster(cluster, MessageUtil::hash(cluster));
+}
+
+bool ClusterManagerImpl::addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster& cluster,
+                                                   uint64_t config_hash) {
   // First we need to see if this new config is new or an update to an existing dynamic cluster.
   // We don't allow updates to statically configured clusters in the main configuration.
   const std::string cluster_name = cluster.name();
   auto existing_cluster = primary_clusters_.find(cluster_name);
   if (existing_cluster != primary_clusters_.end() &&
       (!existing_cluster->second.added_via_api_ ||
-       existing_cluster->second.config_hash_ == MessageUtil::hash(cluster))) {
+       existing_cluster->second.config_hash_ == config_hash)) {
     return false;
   }
 
@@ -250,24 +290,33 @@ bool ClusterManagerImpl::addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster
     init_helper_.removeCluster(*existing_cluster->second.cluster_);
   }
 
-  loadCluster(cluster, true);
-  ClusterInfoConstSharedPtr new_cluster = primary_clusters_.at(cluster_name).cluster_->info();
+  loadCluster(cluster, config_hash, true);
+  const PrimaryClusterData& new_data = primary_clusters_.at(cluster_name);
+  ClusterInfoConstSharedPtr new_cluster = new_data.cluster_->info();
+  OnDemandClusterSharedPtr on_demand = new_data.on_demand_;
   ENVOY_LOG(info, "add/update cluster {}", cluster_name);
-  tls_->runOnAllThreads([this, new_cluster]() -> void {
+  tls_->runOnAllThreads([this, new_cluster, on_demand]() -> void {
     ThreadLocalClusterManagerImpl& cluster_manager =
         tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
-    if (cluster_manager.thread_local_clusters_.count(new_cluster->name()) > 0) {
+    if (cluster_manager.thread_local_clusters_.count(new_cluster->name()) > 0 ||
+        cluster_manager.on_demand_clusters_.count(new_cluster->name()) > 0) {
       ENVOY_LOG(debug, "updating TLS cluster {}", new_cluster->name());
     } else {
       ENVOY_LOG(debug, "adding TLS cluster {}", new_cluster->name());
     }
 
-    cluster_manager.thread_local_clusters_[new_cluster->name()].reset(
-        new ThreadLocalClusterManagerImpl::ClusterEntry(cluster_manager, new_cluster));
+    if (on_demand) {
+      cluster_manager.thread_local_clusters_.erase(new_cluster->name());
+      cluster_manager.on_demand_clusters_[new_cluster->name()] = on_demand;
+    } else {
+      cluster_manager.on_demand_clusters_.erase(new_cluster->name());
+      cluster_manager.thread_local_clusters_[new_cluster->name()].reset(
+          new ThreadLocalClusterManagerImpl::ClusterEntry(cluster_manager, new_cluster));
+    }
   });
 
-  postInitializeCluster(*primary_clusters_.at(cluster_name).cluster_);
+  postInitializeCluster(new_data);
   return true;
 }
 
@@ -286,15 +335,19 @@ bool ClusterManagerImpl::removePrimaryCluster(const std::string& cluster_name) {
     ThreadLocalClusterManagerImpl& cluster_manager =
         tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
-    ASSERT(cluster_manager.thread_local_clusters_.count(cluster_name) == 1);
+    ASSERT(cluster_manager.thread_local_clusters_.count(cluster_name) +
+               cluster_manager.on_demand_clusters_.count(cluster_name) >=
+           1);
     ENVOY_LOG(debug, "removing TLS cluster {}", cluster_name);
     cluster_manager.thread_local_clusters_.erase(cluster_name);
+    cluster_manager.on_demand_clusters_.erase(cluster_name);
   });
 
   return true;
 }
 
-void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster, bool added_via_api) {
+void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster,
+                                     uint64_t config_hash, bool added_via_api) {
   ClusterSharedPtr new_cluster =
       factory_.clusterFromProto(cluster, *this, outlier_event_logger_, added_via_api);
 
@@ -306,20 +359,28 @@ void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster, boo
     }
   }
 
+  OnDemandClusterSharedPtr on_demand;
+  if (new_cluster->info()->onDemand() &&
+      !(local_cluster_name_.valid() && local_cluster_name_.value() == cluster.name())) {
+    on_demand = std::make_shared<OnDemandCluster>(new_cluster->info());
+  }
+
   const Cluster& primary_cluster_reference = *new_cluster;
   new_cluster->addMemberUpdateCb(
-      [&primary_cluster_reference, this](const std::vector<HostSharedPtr>& hosts_added,
-                                         const std::vector<HostSharedPtr>& hosts_removed) {
+      [&primary_cluster_reference, on_demand,
+       this](const std::vector<HostSharedPtr>& hosts_added,
+             const std::vector<HostSharedPtr>& hosts_removed) {
         // This fires when a cluster is about to have an updated member set. We need to send this
         // out to all of the thread local configurations.
-        postThreadLocalClusterUpdate(primary_cluster_reference, hosts_added, hosts_removed);
+        postThreadLocalClusterUpdate(primary_cluster_reference, on_demand, hosts_added,
+                                     hosts_removed);
       });
 
   // emplace() will do nothing if the key already exists. Always erase first.
   size_t num_erased = primary_clusters_.erase(primary_cluster_reference.info()->name());
   primary_clusters_.emplace(
       primary_cluster_reference.info()->name(),
-      PrimaryClusterData{MessageUtil::hash(cluster), added_via_api, std::move(new_cluster)});
+      PrimaryClusterData{config_hash, added_via_api, std::move(new_cluster), on_demand});
 
   cm_stats_.total_clusters_.set(primary_clusters_.size());
   if (num_erased) {
@@ -331,13 +392,29 @@ void ClusterManagerImpl::loadCluster(const envoy::api::v2::Cluster& cluster, boo
 
 ThreadLocalCluster* ClusterManagerImpl::get(const std::string& cluster) {
   ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
+  return cluster_manager.findCluster(cluster);
+}
 
-  auto entry = cluster_manager.thread_local_clusters_.find(cluster);
-  if (entry != cluster_manager.thread_local_clusters_.end()) {
-    return entry->second.get();
-  } else {
-    return nullptr;
+uint32_t ClusterManagerImpl::clusterId(const std::string& cluster) {
+  std::lock_guard<std::mutex> lock(cluster_ids_lock_);
+  auto existing = cluster_ids_.find(cluster);
+  if (existing != cluster_ids_.end()) {
+    return existing->second;
   }
+
+  cluster_id_names_.push_back(cluster);
+  return cluster_ids_.emplace(cluster, cluster_id_names_.size() - 1).first->second;
+}
+
+std::string ClusterManagerImpl::clusterName(uint32_t cluster_id) {
+  std::lock_guard<std::mutex> lock(cluster_ids_lock_);
+  ASSERT(cluster_id < cluster_id_names_.size());
+  return cluster_id_names_[cluster_id];
+}
+
+ThreadLocalCluster* ClusterManagerImpl::getById(uint32_t cluster_id) {
+  ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
+  return cluster_manager.findCluster(cluster_id);
 }
 
 Http::ConnectionPool::Instance*
@@ -345,58 +422,129 @@ ClusterManagerImpl::httpConnPoolForCluster(const std::string& cluster, ResourceP
                                            LoadBalancerContext* context) {
   ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
-  auto entry = cluster_manager.thread_local_clusters_.find(cluster);
-  if (entry == cluster_manager.thread_local_clusters_.end()) {
+  ThreadLocalClusterManagerImpl::ClusterEntry* entry = cluster_manager.findCluster(cluster);
+  if (!entry) {
     return nullptr;
   }
 
   // Select a host and create a connection pool for it if it does not already exist.
-  return entry->second->connPool(priority, context);
+  return entry->connPool(priority, context);
+}
+
+Http::ConnectionPool::Instance*
+ClusterManagerImpl::httpConnPoolForClusterId(uint32_t cluster_id, ResourcePriority priority,
+                                             LoadBalancerContext* context) {
+  ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
+
+  ThreadLocalClusterManagerImpl::ClusterEntry* entry = cluster_manager.findCluster(cluster_id);
+  if (!entry) {
+    return nullptr;
+  }
+
+  return entry->connPool(priority, context);
 }
 
 void ClusterManagerImpl::postThreadLocalClusterUpdate(
-    const Cluster& primary_cluster, const std::vector<HostSharedPtr>& hosts_added,
+    const Cluster& primary_cluster, const OnDemandClusterSharedPtr& on_demand,
+    const std::vector<HostSharedPtr>& hosts_added,
     const std::vector<HostSharedPtr>& hosts_removed) {
   const std::string& name = primary_cluster.info()->name();
-  HostVectorConstSharedPtr hosts_copy(new std::vector<HostSharedPtr>(primary_cluster.hosts()));
-  HostVectorConstSharedPtr healthy_hosts_copy(
-      new std::vector<HostSharedPtr>(primary_cluster.healthyHosts()));
-  HostListsConstSharedPtr hosts_per_zone_copy(
-      new std::vector<std::vector<HostSharedPtr>>(primary_cluster.hostsPerZone()));
-  HostListsConstSharedPtr healthy_hosts_per_zone_copy(
-      new std::vector<std::vector<HostSharedPtr>>(primary_cluster.healthyHostsPerZone()));
-
-  tls_->runOnAllThreads([this, name, hosts_copy, healthy_hosts_copy, hosts_per_zone_copy,
-                         healthy_hosts_per_zone_copy, hosts_added, hosts_removed]() -> void {
-    ThreadLocalClusterManagerImpl::updateClusterMembership(
-        name, hosts_copy, healthy_hosts_copy, hosts_per_zone_copy, healthy_hosts_per_zone_copy,
-        hosts_added, hosts_removed, *tls_);
+  HostSetSnapshotConstSharedPtr snapshot(new HostSetSnapshot(
+      primary_cluster, hosts_added, hosts_removed, runtime_, ++host_set_sequence_));
+
+  if (on_demand) {
+    // A thread that builds the cluster later starts from the latest snapshot. Until some thread
+    // has built it there is nobody to update.
+    std::lock_guard<std::mutex> lock(on_demand->lock_);
+    on_demand->snapshot_ = snapshot;
+    if (on_demand->built_ == 0) {
+      return;
+    }
+  }
+
+  tls_->runOnAllThreads([this, name, snapshot]() -> void {
+    ThreadLocalClusterManagerImpl::updateClusterMembership(name, snapshot, *tls_);
   });
 }
 
+ClusterManagerImpl::HostSetSnapshot::HostSetSnapshot(
+    const Cluster& primary_cluster, const std::vector<HostSharedPtr>& hosts_added,
+    const std::vector<HostSharedPtr>& hosts_removed, Runtime::Loader& runtime, uint64_t sequence)
+    : hosts_(primary_cluster.hosts()), healthy_hosts_(primary_cluster.healthyHosts()),
+      hosts_per_zone_(primary_cluster.hostsPerZone()),
+      healthy_hosts_per_zone_(primary_cluster.healthyHostsPerZone()), hosts_added_(hosts_added),
+      hosts_removed_(hosts_removed), sequence_(sequence) {
+  // The lookup tables of the hashing load balancers only depend on the hosts, so they are built
+  // here once rather than by the load balancer of every worker.
+  switch (primary_cluster.info()->lbType()) {
+  case LoadBalancerType::RingHash:
+    ring_hash_rings_ = std::make_shared<RingHashLoadBalancer::Rings>(primary_cluster, runtime);
+    break;
+  case LoadBalancerType::Maglev:
+    maglev_tables_ = std::make_shared<MaglevLoadBalancer::Tables>(
+        primary_cluster, MaglevLoadBalancer::nextPrime(primary_cluster.info()->maglevTableSize()));
+    break;
+  default:
+    break;
+  }
+}
+
+Event::Dispatcher* ClusterManagerImpl::sharedConnPoolOwner(const Host& host) {
+  // Workers register as their thread local cluster manager is created, so right after startup two
+  // workers may briefly disagree on the owner of a host. That only costs a few extra connections.
+  std::lock_guard<std::mutex> lock(shared_conn_pool_owners_lock_);
+  if (shared_conn_pool_owners_.empty()) {
+    return nullptr;
+  }
+
+  const size_t index =
+      std::hash<std::string>()(host.address()->asString()) % shared_conn_pool_owners_.size();
+  return shared_conn_pool_owners_[index];
+}
+
 Host::CreateConnectionData ClusterManagerImpl::tcpConnForCluster(const std::string& cluster,
                                                                  LoadBalancerContext* context) {
   ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
 
-  auto entry = cluster_manager.thread_local_clusters_.find(cluster);
-  if (entry == cluster_manager.thread_local_clusters_.end()) {
+  ThreadLocalClusterManagerImpl::ClusterEntry* entry = cluster_manager.findCluster(cluster);
+  if (!entry) {
     throw EnvoyException(fmt::format("unknown cluster '{}'", cluster));
   }
 
-  HostConstSharedPtr logical_host = entry->second->lb_->chooseHost(context);
+  HostConstSharedPtr logical_host = entry->lb_->chooseHost(context);
   if (logical_host) {
     return logical_host->createConnection(cluster_manager.thread_local_dispatcher_);
   } else {
-    entry->second->cluster_info_->stats().upstream_cx_none_healthy_.inc();
+    entry->cluster_info_->stats().upstream_cx_none_healthy_.inc();
+    return {nullptr, nullptr};
+  }
+}
+
+Host::CreateConnectionData
+ClusterManagerImpl::prewarmedTcpConnForCluster(const std::string& cluster,
+                                               LoadBalancerContext* context) {
+  ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
+
+  ThreadLocalClusterManagerImpl::ClusterEntry* entry = cluster_manager.findCluster(cluster);
+  if (!entry) {
+    throw EnvoyException(fmt::format("unknown cluster '{}'", cluster));
+  }
+
+  // Prewarmed connections go to hosts picked without a context, so they can't serve contexts that
+  // determine the host.
+  if (entry->cluster_info_->lbType() == LoadBalancerType::OriginalDst ||
+      (context != nullptr && context->hashKey().valid())) {
     return {nullptr, nullptr};
   }
+
+  return entry->prewarmed_conn_pool_->claim();
 }
 
 Http::AsyncClient& ClusterManagerImpl::httpAsyncClientForCluster(const std::string& cluster) {
   ThreadLocalClusterManagerImpl& cluster_manager = tls_->getTyped<ThreadLocalClusterManagerImpl>();
-  auto entry = cluster_manager.thread_local_clusters_.find(cluster);
-  if (entry != cluster_manager.thread_local_clusters_.end()) {
-    return entry->second->http_async_client_;
+  ThreadLocalClusterManagerImpl::ClusterEntry* entry = cluster_manager.findCluster(cluster);
+  if (entry) {
+    return entry->http_async_client_;
   } else {
     throw EnvoyException(fmt::format("unknown cluster '{}'", cluster));
   }
@@ -406,6 +554,11 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ThreadLocalClusterManagerImpl
     ClusterManagerImpl& parent, Event::Dispatcher& dispatcher,
     const Optional<std::string>& local_cluster_name)
     : parent_(parent), thread_local_dispatcher_(dispatcher) {
+  if (std::this_thread::get_id() != parent.main_thread_id_) {
+    std::lock_guard<std::mutex> lock(parent.shared_conn_pool_owners_lock_);
+    parent.shared_conn_pool_owners_.push_back(&dispatcher);
+  }
+
   // If local cluster is defined then we need to initialize it first.
   if (local_cluster_name.valid()) {
     ENVOY_LOG(debug, "adding TLS local cluster {}", local_cluster_name.value());
@@ -424,6 +577,11 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ThreadLocalClusterManagerImpl
       continue;
     }
 
+    if (cluster.second.on_demand_) {
+      on_demand_clusters_[cluster.first] = cluster.second.on_demand_;
+      continue;
+    }
+
     ENVOY_LOG(debug, "adding TLS initial cluster {}", cluster.first);
     ASSERT(thread_local_clusters_.count(cluster.first) == 0);
     thread_local_clusters_[cluster.first].reset(
@@ -439,6 +597,14 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::~ThreadLocalClusterManagerImp
   // TODO(mattklein123): The above is sub-optimal and is related to the TODO in
   //                     redis/conn_pool_impl.cc. Will fix at the same time.
   ENVOY_LOG(debug, "shutting down thread local cluster manager");
+  {
+    std::lock_guard<std::mutex> lock(parent_.shared_conn_pool_owners_lock_);
+    auto owner = std::find(parent_.shared_conn_pool_owners_.begin(),
+                           parent_.shared_conn_pool_owners_.end(), &thread_local_dispatcher_);
+    if (owner != parent_.shared_conn_pool_owners_.end()) {
+      parent_.shared_conn_pool_owners_.erase(owner);
+    }
+  }
   host_http_conn_pool_map_.clear();
   for (auto& cluster : thread_local_clusters_) {
     if (&cluster.second->host_set_ != local_host_set_) {
@@ -448,6 +614,88 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::~ThreadLocalClusterManagerImp
   thread_local_clusters_.clear();
 }
 
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry*
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::findCluster(const std::string& name) {
+  auto entry = thread_local_clusters_.find(name);
+  if (entry != thread_local_clusters_.end()) {
+    entry->second->used_ = true;
+    return entry->second.get();
+  }
+
+  auto on_demand = on_demand_clusters_.find(name);
+  if (on_demand == on_demand_clusters_.end()) {
+    return nullptr;
+  }
+
+  if (!idle_timer_) {
+    idle_timer_ = thread_local_dispatcher_.createTimer([this]() -> void { onIdleTimer(); });
+    onIdleTimer();
+  }
+
+  ENVOY_LOG(debug, "building on demand TLS cluster {}", name);
+  ClusterEntry* new_entry = new ClusterEntry(*this, on_demand->second->info_);
+  thread_local_clusters_[name].reset(new_entry);
+  new_entry->on_demand_ = on_demand->second;
+  new_entry->used_ = true;
+  new_entry->own_member_update_cbs_ = new_entry->host_set_.memberUpdateCbCount();
+
+  // Once this thread is counted the main thread posts every update, so the snapshot taken here is
+  // either the latest or followed by the updates after it.
+  HostSetSnapshotConstSharedPtr snapshot;
+  {
+    std::lock_guard<std::mutex> lock(on_demand->second->lock_);
+    on_demand->second->built_++;
+    snapshot = on_demand->second->snapshot_;
+  }
+  if (snapshot) {
+    new_entry->updateHosts(snapshot, snapshot->hosts_, {});
+  }
+  return new_entry;
+}
+
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry*
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::findCluster(uint32_t cluster_id) {
+  if (cluster_id < clusters_by_id_.size() && clusters_by_id_[cluster_id]) {
+    clusters_by_id_[cluster_id]->used_ = true;
+    return clusters_by_id_[cluster_id];
+  }
+
+  // The cluster was not looked up by id since this thread last added it. Unknown clusters are not
+  // remembered, so that they are found once they are added.
+  ClusterEntry* entry = findCluster(parent_.clusterName(cluster_id));
+  if (entry) {
+    if (cluster_id >= clusters_by_id_.size()) {
+      clusters_by_id_.resize(cluster_id + 1);
+    }
+    clusters_by_id_[cluster_id] = entry;
+    entry->cluster_id_.value(cluster_id);
+  }
+  return entry;
+}
+
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::onIdleTimer() {
+  const uint64_t timeout =
+      parent_.runtime_.snapshot().getInteger("upstream.on_demand_idle_timeout_ms", 300000);
+  if (timeout == 0) {
+    idle_timer_.reset();
+    return;
+  }
+
+  // A cluster is removed once it has not been looked up for a whole period, so after between one
+  // and two timeouts of idleness.
+  for (auto entry = thread_local_clusters_.begin(); entry != thread_local_clusters_.end();) {
+    if (entry->second->on_demand_ && !entry->second->used_ && entry->second->idle()) {
+      ENVOY_LOG(debug, "removing idle on demand TLS cluster {}", entry->first);
+      entry = thread_local_clusters_.erase(entry);
+    } else {
+      entry->second->used_ = false;
+      ++entry;
+    }
+  }
+
+  idle_timer_->enableTimer(std::chrono::milliseconds(timeout));
+}
+
 void ClusterManagerImpl::ThreadLocalClusterManagerImpl::drainConnPools(
     const std::vector<HostSharedPtr>& hosts) {
   for (const HostSharedPtr& host : hosts) {
@@ -486,16 +734,24 @@ void ClusterManagerImpl::ThreadLocalClusterManagerImpl::drainConnPools(
 }
 
 void ClusterManagerImpl::ThreadLocalClusterManagerImpl::updateClusterMembership(
-    const std::string& name, HostVectorConstSharedPtr hosts, HostVectorConstSharedPtr healthy_hosts,
-    HostListsConstSharedPtr hosts_per_zone, HostListsConstSharedPtr healthy_hosts_per_zone,
-    const std::vector<HostSharedPtr>& hosts_added, const std::vector<HostSharedPtr>& hosts_removed,
-    ThreadLocal::Slot& tls) {
+    const std::string& name, HostSetSnapshotConstSharedPtr snapshot, ThreadLocal::Slot& tls) {
 
   ThreadLocalClusterManagerImpl& config = tls.getTyped<ThreadLocalClusterManagerImpl>();
 
-  ASSERT(config.thread_local_clusters_.find(name) != config.thread_local_clusters_.end());
-  config.thread_local_clusters_[name]->host_set_.updateHosts(
-      hosts, healthy_hosts, hosts_per_zone, healthy_hosts_per_zone, hosts_added, hosts_removed);
+  auto entry = config.thread_local_clusters_.find(name);
+  if (entry == config.thread_local_clusters_.end()) {
+    // The cluster is built on demand and this thread has not built it.
+    ASSERT(config.on_demand_clusters_.count(name) == 1);
+    return;
+  }
+
+  // A cluster built on demand may have started from a later snapshot than this one.
+  const HostSetSnapshotConstSharedPtr& current = entry->second->host_set_snapshot_;
+  if (current && current->sequence_ >= snapshot->sequence_) {
+    return;
+  }
+
+  entry->second->updateHosts(snapshot, snapshot->hosts_added_, snapshot->hosts_removed_);
 }
 
 ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
@@ -506,43 +762,88 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::ClusterEntry(
                          parent.parent_.random_,
                          Router::ShadowWriterPtr{new Router::ShadowWriterImpl(parent.parent_)}) {
 
-  switch (cluster->lbType()) {
-  case LoadBalancerType::LeastRequest: {
-    lb_.reset(new LeastRequestLoadBalancer(host_set_, parent.local_host_set_, cluster->stats(),
-                                           parent.parent_.runtime_, parent.parent_.random_));
-    break;
-  }
-  case LoadBalancerType::Random: {
-    lb_.reset(new RandomLoadBalancer(host_set_, parent.local_host_set_, cluster->stats(),
-                                     parent.parent_.runtime_, parent.parent_.random_));
-    break;
-  }
-  case LoadBalancerType::RoundRobin: {
-    lb_.reset(new RoundRobinLoadBalancer(host_set_, parent.local_host_set_, cluster->stats(),
-                                         parent.parent_.runtime_, parent.parent_.random_));
-    break;
-  }
-  case LoadBalancerType::RingHash: {
-    lb_.reset(new RingHashLoadBalancer(host_set_, cluster->stats(), parent.parent_.runtime_,
-                                       parent.parent_.random_));
-    break;
-  }
-  case LoadBalancerType::OriginalDst: {
-    lb_.reset(new OriginalDstCluster::LoadBalancer(
-        host_set_, parent.parent_.primary_clusters_.at(cluster->name()).cluster_));
-    break;
-  }
+  if (cluster->lbSubsetKeys().empty()) {
+    lb_ = createLoadBalancer(host_set_, parent.local_host_set_, true);
+  } else {
+    // The shared ring hash and Maglev tables are of all hosts, so subsets build their own.
+    lb_.reset(new SubsetLoadBalancer(
+        host_set_, cluster->lbSubsetKeys(),
+        cluster->lbSubsetFallback() ? createLoadBalancer(host_set_, parent.local_host_set_, true)
+                                    : nullptr,
+        [this](HostSet& host_set) -> LoadBalancerPtr {
+          return createLoadBalancer(host_set, nullptr, false);
+        },
+        cluster->stats()));
   }
 
-  host_set_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>&,
+  prewarmed_conn_pool_.reset(
+      new PrewarmedConnPool(parent.thread_local_dispatcher_, cluster_info_, *lb_));
+
+  host_set_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>& hosts_added,
                                      const std::vector<HostSharedPtr>& hosts_removed) -> void {
     // We need to go through and purge any connection pools for hosts that got deleted.
     // Even if two hosts actually point to the same address this will be safe, since if a
     // host is readded it will be a different physical HostSharedPtr.
+    for (const HostSharedPtr& host : hosts_added) {
+      hosts_.insert(host);
+    }
+    for (const HostSharedPtr& host : hosts_removed) {
+      hosts_.erase(host);
+    }
     parent_.drainConnPools(hosts_removed);
+    prefetchConnPools(hosts_added);
+    prewarmed_conn_pool_->removeHosts(hosts_removed);
+    prewarmed_conn_pool_->refill();
   });
 }
 
+LoadBalancerPtr ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::createLoadBalancer(
+    HostSet& host_set, const HostSet* local_host_set, bool shared_tables) {
+  ClusterManagerImpl& cm = parent_.parent_;
+  ClusterStats& stats = cluster_info_->stats();
+  switch (cluster_info_->lbType()) {
+  case LoadBalancerType::LeastRequest:
+    return LoadBalancerPtr{
+        new LeastRequestLoadBalancer(host_set, local_host_set, stats, cm.runtime_, cm.random_)};
+  case LoadBalancerType::PeakEwma:
+    return LoadBalancerPtr{new PeakEwmaLoadBalancer(host_set, local_host_set, stats, cm.runtime_,
+                                                    cm.random_,
+                                                    ProdMonotonicTimeSource::instance_)};
+  case LoadBalancerType::Random:
+    return LoadBalancerPtr{
+        new RandomLoadBalancer(host_set, local_host_set, stats, cm.runtime_, cm.random_)};
+  case LoadBalancerType::RoundRobin:
+    return LoadBalancerPtr{
+        new RoundRobinLoadBalancer(host_set, local_host_set, stats, cm.runtime_, cm.random_)};
+  case LoadBalancerType::RingHash: {
+    RingHashLoadBalancer::PrebuiltRingsCb prebuilt_rings;
+    if (shared_tables) {
+      prebuilt_rings = [this]() -> RingHashLoadBalancer::RingsConstSharedPtr {
+        return host_set_snapshot_ ? host_set_snapshot_->ring_hash_rings_ : nullptr;
+      };
+    }
+    return LoadBalancerPtr{
+        new RingHashLoadBalancer(host_set, stats, cm.runtime_, cm.random_, prebuilt_rings)};
+  }
+  case LoadBalancerType::Maglev: {
+    MaglevLoadBalancer::PrebuiltTablesCb prebuilt_tables;
+    if (shared_tables) {
+      prebuilt_tables = [this]() -> MaglevLoadBalancer::TablesConstSharedPtr {
+        return host_set_snapshot_ ? host_set_snapshot_->maglev_tables_ : nullptr;
+      };
+    }
+    return LoadBalancerPtr{new MaglevLoadBalancer(host_set, stats, cm.runtime_, cm.random_,
+                                                  cluster_info_->maglevTableSize(),
+                                                  prebuilt_tables)};
+  }
+  case LoadBalancerType::OriginalDst:
+    return LoadBalancerPtr{new OriginalDstCluster::LoadBalancer(
+        cm.primary_clusters_.at(cluster_info_->name()).cluster_)};
+  }
+
+  NOT_REACHED;
+}
+
 ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::~ClusterEntry() {
   // We need to drain all connection pools for the cluster being removed. Then we can remove the
   // cluster.
@@ -551,6 +852,36 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::~ClusterEntry()
   // the hosts inside of the HostImpl destructor. That is a change with wide implications, so we are
   // going with a more targeted approach for now.
   parent_.drainConnPools(host_set_.hosts());
+
+  if (cluster_id_.valid()) {
+    parent_.clusters_by_id_[cluster_id_.value()] = nullptr;
+  }
+
+  if (on_demand_) {
+    std::lock_guard<std::mutex> lock(on_demand_->lock_);
+    ASSERT(on_demand_->built_ > 0);
+    on_demand_->built_--;
+  }
+}
+
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::updateHosts(
+    HostSetSnapshotConstSharedPtr snapshot, const std::vector<HostSharedPtr>& hosts_added,
+    const std::vector<HostSharedPtr>& hosts_removed) {
+  // Set the snapshot first, as the load balancer picks up its shared tables from it in the member
+  // update callbacks. The host lists alias the snapshot, so they share its reference count.
+  host_set_snapshot_ = snapshot;
+  host_set_.updateHosts(HostVectorConstSharedPtr(snapshot, &snapshot->hosts_),
+                        HostVectorConstSharedPtr(snapshot, &snapshot->healthy_hosts_),
+                        HostListsConstSharedPtr(snapshot, &snapshot->hosts_per_zone_),
+                        HostListsConstSharedPtr(snapshot, &snapshot->healthy_hosts_per_zone_),
+                        hosts_added, hosts_removed);
+}
+
+bool ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::idle() const {
+  // Code that keeps the cluster, like a connection pool watching its hosts, or a stream that is
+  // still open, keeps it from being removed.
+  return host_set_.memberUpdateCbCount() == own_member_update_cbs_ &&
+         !http_async_client_.hasActiveStreams();
 }
 
 Http::ConnectionPool::Instance*
@@ -562,6 +893,16 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
     return nullptr;
   }
 
+  if (cluster_info_->sharedConnPools()) {
+    return &sharedConnPool(host, priority);
+  }
+
+  return &connPool(host, priority);
+}
+
+Http::ConnectionPool::Instance&
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
+    HostConstSharedPtr host, ResourcePriority priority) {
   ConnPoolsContainer& container = parent_.host_http_conn_pool_map_[host];
   ASSERT(enumToInt(priority) < container.pools_.size());
   if (!container.pools_[enumToInt(priority)]) {
@@ -569,7 +910,58 @@ ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::connPool(
         parent_.parent_.factory_.allocateConnPool(parent_.thread_local_dispatcher_, host, priority);
   }
 
-  return container.pools_[enumToInt(priority)].get();
+  return *container.pools_[enumToInt(priority)];
+}
+
+Http::ConnectionPool::Instance&
+ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::sharedConnPool(
+    HostConstSharedPtr host, ResourcePriority priority) {
+  ConnPoolsContainer& container = parent_.host_http_conn_pool_map_[host];
+  ASSERT(enumToInt(priority) < container.pools_.size());
+  if (container.pools_[enumToInt(priority)]) {
+    return *container.pools_[enumToInt(priority)];
+  }
+
+  Event::Dispatcher* owner = parent_.parent_.sharedConnPoolOwner(*host);
+  if (!owner || owner == &parent_.thread_local_dispatcher_) {
+    return connPool(host, priority);
+  }
+
+  // The owner always uses its own pool for the host, even if it would pick a different owner by
+  // now, so that a stream is never forwarded twice.
+  ClusterManagerImpl& cluster_manager = parent_.parent_;
+  const std::string name = cluster_info_->name();
+  container.pools_[enumToInt(priority)].reset(new Http::ForwardingConnPoolImpl(
+      parent_.thread_local_dispatcher_, *owner, host,
+      [&cluster_manager, name, host, priority]() -> Http::ConnectionPool::Instance* {
+        ThreadLocalClusterManagerImpl& owner_cluster_manager =
+            cluster_manager.tls_->getTyped<ThreadLocalClusterManagerImpl>();
+        ThreadLocalClusterManagerImpl::ClusterEntry* entry =
+            owner_cluster_manager.findCluster(name);
+        if (!entry || entry->hosts_.count(host) == 0) {
+          return nullptr;
+        }
+
+        return &entry->connPool(host, priority);
+      }));
+  return *container.pools_[enumToInt(priority)];
+}
+
+void ClusterManagerImpl::ThreadLocalClusterManagerImpl::ClusterEntry::prefetchConnPools(
+    const std::vector<HostSharedPtr>& hosts) {
+  if (cluster_info_->minWarmConnections() == 0) {
+    return;
+  }
+
+  // Open the warm connections of new hosts now instead of on the request path. Only the default
+  // priority is warmed, which is what nearly all requests use. With shared connection pools only
+  // the owner of a host opens connections to it.
+  for (const HostSharedPtr& host : hosts) {
+    Http::ConnectionPool::Instance& pool = cluster_info_->sharedConnPools()
+                                               ? sharedConnPool(host, ResourcePriority::Default)
+                                               : connPool(host, ResourcePriority::Default);
+    pool.prefetchConnections();
+  }
 }
 
 ClusterManagerPtr ProdClusterManagerFactory::clusterManagerFromProto(
@@ -583,8 +975,20 @@ ClusterManagerPtr ProdClusterManagerFactory::clusterManagerFromProto(
 Http::ConnectionPool::InstancePtr
 ProdClusterManagerFactory::allocateConnPool(Event::Dispatcher& dispatcher, HostConstSharedPtr host,
                                             ResourcePriority priority) {
-  if ((host->cluster().features() & ClusterInfo::Features::HTTP2) &&
-      runtime_.snapshot().featureEnabled("upstream.use_http2", 100)) {
+  if (host->cluster().features() & ClusterInfo::Features::HTTP2_ALPN) {
+    return Http::ConnectionPool::InstancePtr{new Http::AlpnConnPoolImpl(
+        dispatcher, host,
+        [&dispatcher, host,
+         priority](Http::Protocol protocol) -> Http::ConnectionPool::InstancePtr {
+          if (protocol == Http::Protocol::Http2) {
+            return Http::ConnectionPool::InstancePtr{
+                new Http::Http2::ProdConnPoolImpl(dispatcher, host, priority)};
+          }
+          return Http::ConnectionPool::InstancePtr{
+              new Http::Http1::ConnPoolImplProd(dispatcher, host, priority)};
+        })};
+  } else if ((host->cluster().features() & ClusterInfo::Features::HTTP2) &&
+             runtime_.snapshot().featureEnabled("upstream.use_http2", 100)) {
     return Http::ConnectionPool::InstancePtr{
         new Http::Http2::ProdConnPoolImpl(dispatcher, host, priority)};
   } else {
@@ -5,10 +5,14 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "envoy/event/timer.h"
 #include "envoy/http/codes.h"
 #include "envoy/local_info/local_info.h"
 #include "envoy/runtime/runtime.h"
@@ -17,6 +21,10 @@
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/http/async_client_impl.h"
+#include "common/upstream/maglev_lb.h"
+#include "common/upstream/prewarmed_conn_pool.h"
+#include "common/upstream/ring_hash_lb.h"
+#include "common/upstream/subset_lb.h"
 #include "common/upstream/upstream_impl.h"
 
 #include "api/bootstrap.pb.h"
@@ -129,6 +137,8 @@ public:
 
   // Upstream::ClusterManager
   bool addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster& cluster) override;
+  bool addOrUpdatePrimaryCluster(const envoy::api::v2::Cluster& cluster,
+                                 uint64_t config_hash) override;
   void setInitializedCb(std::function<void()> callback) override {
     init_helper_.setInitializedCb(callback);
   }
@@ -141,11 +151,18 @@ public:
     return clusters_map;
   }
   ThreadLocalCluster* get(const std::string& cluster) override;
+  uint32_t clusterId(const std::string& cluster) override;
+  ThreadLocalCluster* getById(uint32_t cluster_id) override;
   Http::ConnectionPool::Instance* httpConnPoolForCluster(const std::string& cluster,
                                                          ResourcePriority priority,
                                                          LoadBalancerContext* context) override;
+  Http::ConnectionPool::Instance* httpConnPoolForClusterId(uint32_t cluster_id,
+                                                           ResourcePriority priority,
+                                                           LoadBalancerContext* context) override;
   Host::CreateConnectionData tcpConnForCluster(const std::string& cluster,
                                                LoadBalancerContext* context) override;
+  Host::CreateConnectionData prewarmedTcpConnForCluster(const std::string& cluster,
+                                                        LoadBalancerContext* context) override;
   Http::AsyncClient& httpAsyncClientForCluster(const std::string& cluster) override;
   bool removePrimaryCluster(const std::string& cluster) override;
   void shutdown() override {
@@ -158,6 +175,47 @@ public:
   }
 
 private:
+  /**
+   * An immutable copy of a primary cluster's host set along with the load balancer lookup tables
+   * built from it. It is built once on the main thread for each membership update and shared by
+   * all workers, each of which adopts it by taking a reference rather than copying the host lists.
+   */
+  struct HostSetSnapshot {
+    HostSetSnapshot(const Cluster& primary_cluster, const std::vector<HostSharedPtr>& hosts_added,
+                    const std::vector<HostSharedPtr>& hosts_removed, Runtime::Loader& runtime,
+                    uint64_t sequence);
+
+    const std::vector<HostSharedPtr> hosts_;
+    const std::vector<HostSharedPtr> healthy_hosts_;
+    const std::vector<std::vector<HostSharedPtr>> hosts_per_zone_;
+    const std::vector<std::vector<HostSharedPtr>> healthy_hosts_per_zone_;
+    const std::vector<HostSharedPtr> hosts_added_;
+    const std::vector<HostSharedPtr> hosts_removed_;
+    // Only set for clusters that use the corresponding load balancer.
+    RingHashLoadBalancer::RingsConstSharedPtr ring_hash_rings_;
+    MaglevLoadBalancer::TablesConstSharedPtr maglev_tables_;
+    // Increases with each snapshot, so that a worker can tell an update it has already seen.
+    const uint64_t sequence_;
+  };
+
+  typedef std::shared_ptr<const HostSetSnapshot> HostSetSnapshotConstSharedPtr;
+
+  /**
+   * The state of a cluster whose thread local data is built on demand, shared by the main thread
+   * and the workers. The main thread keeps the latest snapshot of the cluster's hosts here, and
+   * only posts membership updates while at least one thread has built the cluster.
+   */
+  struct OnDemandCluster {
+    OnDemandCluster(ClusterInfoConstSharedPtr info) : info_(info) {}
+
+    const ClusterInfoConstSharedPtr info_;
+    std::mutex lock_;
+    HostSetSnapshotConstSharedPtr snapshot_;
+    uint32_t built_{};
+  };
+
+  typedef std::shared_ptr<OnDemandCluster> OnDemandClusterSharedPtr;
+
   /**
    * Thread local cached cluster data. Each thread local cluster gets updates from the parent
    * central dynamic cluster (if applicable). It maintains load balancer state and any created
@@ -175,8 +233,25 @@ private:
       ClusterEntry(ThreadLocalClusterManagerImpl& parent, ClusterInfoConstSharedPtr cluster);
       ~ClusterEntry();
 
+      /**
+       * @param host_set supplies the hosts to load balance over.
+       * @param local_host_set supplies the local host set for zone aware routing, or nullptr.
+       * @param shared_tables supplies whether ring hash and Maglev load balancers use the tables
+       *        of the host set snapshot, which are only of host_set if it is host_set_.
+       * @return LoadBalancerPtr a load balancer of the cluster's type.
+       */
+      LoadBalancerPtr createLoadBalancer(HostSet& host_set, const HostSet* local_host_set,
+                                         bool shared_tables);
       Http::ConnectionPool::Instance* connPool(ResourcePriority priority,
                                                LoadBalancerContext* context);
+      Http::ConnectionPool::Instance& connPool(HostConstSharedPtr host, ResourcePriority priority);
+      Http::ConnectionPool::Instance& sharedConnPool(HostConstSharedPtr host,
+                                                     ResourcePriority priority);
+      void prefetchConnPools(const std::vector<HostSharedPtr>& hosts);
+      void updateHosts(HostSetSnapshotConstSharedPtr snapshot,
+                       const std::vector<HostSharedPtr>& hosts_added,
+                       const std::vector<HostSharedPtr>& hosts_removed);
+      bool idle() const;
 
       // Upstream::ThreadLocalCluster
       const HostSet& hostSet() override { return host_set_; }
@@ -185,9 +260,25 @@ private:
 
       ThreadLocalClusterManagerImpl& parent_;
       HostSetImpl host_set_;
+      // The snapshot host_set_ was last updated from, which also holds the shared load balancer
+      // tables. Null until the first update.
+      HostSetSnapshotConstSharedPtr host_set_snapshot_;
       LoadBalancerPtr lb_;
       ClusterInfoConstSharedPtr cluster_info_;
+      PrewarmedConnPoolPtr prewarmed_conn_pool_;
       Http::AsyncClientImpl http_async_client_;
+      // The hosts this thread has been told about, so that the owner of a shared connection pool
+      // does not create pools for hosts that it has already removed.
+      std::unordered_set<HostConstSharedPtr> hosts_;
+      // Only set if the cluster is built on demand.
+      OnDemandClusterSharedPtr on_demand_;
+      // Whether the cluster was looked up since the last idle sweep.
+      bool used_{};
+      // The member update callbacks of the cluster itself. Any more belong to code that holds on
+      // to the cluster, which keeps it from being removed when idle.
+      size_t own_member_update_cbs_{};
+      // Set once the cluster was looked up by the id of its name, which indexes clusters_by_id_.
+      Optional<uint32_t> cluster_id_;
     };
 
     typedef std::unique_ptr<ClusterEntry> ClusterEntryPtr;
@@ -195,36 +286,56 @@ private:
     ThreadLocalClusterManagerImpl(ClusterManagerImpl& parent, Event::Dispatcher& dispatcher,
                                   const Optional<std::string>& local_cluster_name);
     ~ThreadLocalClusterManagerImpl();
+    ClusterEntry* findCluster(const std::string& name);
+    ClusterEntry* findCluster(uint32_t cluster_id);
+    void onIdleTimer();
     void drainConnPools(const std::vector<HostSharedPtr>& hosts);
     void drainConnPools(HostSharedPtr old_host, ConnPoolsContainer& container);
-    static void updateClusterMembership(const std::string& name, HostVectorConstSharedPtr hosts,
-                                        HostVectorConstSharedPtr healthy_hosts,
-                                        HostListsConstSharedPtr hosts_per_zone,
-                                        HostListsConstSharedPtr healthy_hosts_per_zone,
-                                        const std::vector<HostSharedPtr>& hosts_added,
-                                        const std::vector<HostSharedPtr>& hosts_removed,
+    static void updateClusterMembership(const std::string& name,
+                                        HostSetSnapshotConstSharedPtr snapshot,
                                         ThreadLocal::Slot& tls);
 
     ClusterManagerImpl& parent_;
     Event::Dispatcher& thread_local_dispatcher_;
+    // The clusters looked up by the id of their name, filled in on first lookup. An entry clears
+    // its slot when it is destroyed, so that a cluster that is updated or removed is looked up by
+    // name again.
+    std::vector<ClusterEntry*> clusters_by_id_;
     std::unordered_map<std::string, ClusterEntryPtr> thread_local_clusters_;
+    // Clusters built on demand that this thread may build when they are first looked up.
+    std::unordered_map<std::string, OnDemandClusterSharedPtr> on_demand_clusters_;
     std::unordered_map<HostConstSharedPtr, ConnPoolsContainer> host_http_conn_pool_map_;
     const HostSet* local_host_set_{};
+    // Removes idle clusters that were built on demand. Created when the first one is built.
+    Event::TimerPtr idle_timer_;
   };
 
   struct PrimaryClusterData {
-    PrimaryClusterData(uint64_t config_hash, bool added_via_api, ClusterSharedPtr&& cluster)
-        : config_hash_(config_hash), added_via_api_(added_via_api), cluster_(std::move(cluster)) {}
+    PrimaryClusterData(uint64_t config_hash, bool added_via_api, ClusterSharedPtr&& cluster,
+                       OnDemandClusterSharedPtr on_demand)
+        : config_hash_(config_hash), added_via_api_(added_via_api), cluster_(std::move(cluster)),
+          on_demand_(on_demand) {}
 
     const uint64_t config_hash_;
     const bool added_via_api_;
     ClusterSharedPtr cluster_;
+    // Only set if the cluster is built on demand.
+    const OnDemandClusterSharedPtr on_demand_;
   };
 
+  // With fewer static clusters than this per thread, hashing them is not worth another thread.
+  static const uint32_t MIN_CLUSTERS_PER_HASH_THREAD = 256;
+
   static ClusterManagerStats generateStats(Stats::Scope& scope);
-  void loadCluster(const envoy::api::v2::Cluster& cluster, bool added_via_api);
-  void postInitializeCluster(Cluster& cluster);
+  static std::vector<uint64_t>
+  hashClusters(const Protobuf::RepeatedPtrField<envoy::api::v2::Cluster>& clusters);
+  std::string clusterName(uint32_t cluster_id);
+  Event::Dispatcher* sharedConnPoolOwner(const Host& host);
+  void loadCluster(const envoy::api::v2::Cluster& cluster, uint64_t config_hash,
+                   bool added_via_api);
+  void postInitializeCluster(const PrimaryClusterData& cluster);
   void postThreadLocalClusterUpdate(const Cluster& primary_cluster,
+                                    const OnDemandClusterSharedPtr& on_demand,
                                     const std::vector<HostSharedPtr>& hosts_added,
                                     const std::vector<HostSharedPtr>& hosts_removed);
 
@@ -234,6 +345,14 @@ private:
   ThreadLocal::SlotPtr tls_;
   Runtime::RandomGenerator& random_;
   std::unordered_map<std::string, PrimaryClusterData> primary_clusters_;
+  // The interned cluster names, indexed by id. Names are never removed, so ids stay stable.
+  std::mutex cluster_ids_lock_;
+  std::unordered_map<std::string, uint32_t> cluster_ids_;
+  std::vector<std::string> cluster_id_names_;
+  // The local cluster is always built eagerly, since every zone aware load balancer uses it.
+  Optional<std::string> local_cluster_name_;
+  // The sequence number of the last host set snapshot.
+  uint64_t host_set_sequence_{};
   Optional<envoy::api::v2::ConfigSource> eds_config_;
   Network::Address::InstanceConstSharedPtr source_address_;
   Outlier::EventLoggerSharedPtr outlier_event_logger_;
@@ -241,6 +360,11 @@ private:
   CdsApiPtr cds_api_;
   ClusterManagerStats cm_stats_;
   ClusterManagerInitHelper init_helper_;
+  const std::thread::id main_thread_id_;
+  // The dispatchers of the workers, which own the connection pools of clusters with shared
+  // connection pools. The main thread does not own any.
+  std::mutex shared_conn_pool_owners_lock_;
+  std::vector<Event::Dispatcher*> shared_conn_pool_owners_;
 };
 
 } // namespace Upstream
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Earliest deadline first scheduler used for weighted round robin. Each entry is scheduled at a
+ * deadline of 1 / weight past the current time, and picking the entry with the earliest deadline
+ * advances the current time to that deadline. Over time each entry is picked in proportion to its
+ * weight, with entries of different weights interleaved rather than picked in bursts. Entries with
+ * the same deadline are picked in the order they were added. Both add() and pick() are O(log n).
+ */
+template <class C> class EdfScheduler {
+public:
+  /**
+   * Pick the entry with the earliest deadline and remove it from the schedule. The caller is
+   * expected to add() the entry back to keep it in rotation.
+   * @return std::shared_ptr<C> the picked entry or nullptr if the schedule is empty.
+   */
+  std::shared_ptr<C> pick() {
+    if (queue_.empty()) {
+      return nullptr;
+    }
+
+    const EdfEntry& edf_entry = queue_.top();
+    current_time_ = edf_entry.deadline_;
+    std::shared_ptr<C> ret = edf_entry.entry_;
+    queue_.pop();
+    return ret;
+  }
+
+  /**
+   * Add an entry to the schedule. Adding an entry right after it was picked keeps it in rotation.
+   * @param weight supplies the entry weight, which must be positive.
+   * @param entry supplies the entry.
+   */
+  void add(double weight, std::shared_ptr<C> entry) {
+    ASSERT(weight > 0);
+    queue_.push({current_time_ + 1.0 / weight, order_offset_++, std::move(entry)});
+  }
+
+  /**
+   * @return bool whether the schedule has no entries.
+   */
+  bool empty() const { return queue_.empty(); }
+
+private:
+  struct EdfEntry {
+    double deadline_;
+    // Tie breaker for entries with the same deadline, so picks are deterministic.
+    uint64_t order_offset_;
+    std::shared_ptr<C> entry_;
+
+    // std::priority_queue is a max heap, so the ordering is reversed to pop the earliest deadline.
+    bool operator<(const EdfEntry& rhs) const {
+      return deadline_ == rhs.deadline_ ? order_offset_ > rhs.order_offset_
+                                        : deadline_ > rhs.deadline_;
+    }
+  };
+
+  double current_time_{};
+  uint64_t order_offset_{};
+  std::priority_queue<EdfEntry> queue_;
+};
+
+} // namespace Upstream
+} // namespace Envoy
@@ -1,5 +1,9 @@
 #include "common/upstream/eds.h"
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "envoy/common/exception.h"
 
 #include "common/config/metadata.h"
@@ -7,6 +11,7 @@
 #include "common/config/utility.h"
 #include "common/network/address_impl.h"
 #include "common/network/utility.h"
+#include "common/protobuf/utility.h"
 #include "common/upstream/sds_subscription.h"
 
 namespace Envoy {
@@ -38,7 +43,6 @@ EdsClusterImpl::EdsClusterImpl(const envoy::api::v2::Cluster& cluster, Runtime::
 void EdsClusterImpl::initialize() { subscription_->start({cluster_name_}, *this); }
 
 void EdsClusterImpl::onConfigUpdate(const ResourceVector& resources) {
-  std::vector<HostSharedPtr> new_hosts;
   if (resources.size() != 1) {
     throw EnvoyException(fmt::format("Unexpected EDS resource length: {}", resources.size()));
   }
@@ -48,17 +52,49 @@ void EdsClusterImpl::onConfigUpdate(const ResourceVector& resources) {
     throw EnvoyException(fmt::format("Unexpected EDS cluster (expecting {}): {}", cluster_name_,
                                      cluster_load_assignment.cluster_name()));
   }
+
+  // Management servers commonly resend the same assignment, skip the work if nothing changed.
+  const uint64_t assignment_hash = MessageUtil::hash(cluster_load_assignment);
+  if (assignment_hash_.valid() && assignment_hash_.value() == assignment_hash) {
+    ENVOY_LOG(debug, "EDS assignment unchanged for cluster: {}", info_->name());
+    info_->stats().update_no_rebuild_.inc();
+    runInitializeCallbackIfAny();
+    return;
+  }
+
+  // Hosts that are already known are reused rather than built again, so an update that changes a
+  // few endpoints of a large cluster only builds hosts for those endpoints.
+  std::unordered_map<std::string, HostSharedPtr> current_hosts_by_address;
+  current_hosts_by_address.reserve(hosts().size());
+  for (const HostSharedPtr& host : hosts()) {
+    current_hosts_by_address.emplace(host->address()->asString(), host);
+  }
+
+  std::vector<HostSharedPtr> new_hosts;
+  bool health_changed = false;
   for (const auto& locality_lb_endpoint : cluster_load_assignment.endpoints()) {
     const std::string& zone = locality_lb_endpoint.locality().zone();
 
     for (const auto& lb_endpoint : locality_lb_endpoint.lb_endpoints()) {
+      Network::Address::InstanceConstSharedPtr address =
+          Network::Utility::fromProtoAddress(lb_endpoint.endpoint().address());
+      auto current_host = current_hosts_by_address.find(address->asString());
+      if (current_host != current_hosts_by_address.end()) {
+        // updateDynamicHostList() applies the weight of the new host to the host it keeps.
+        current_host->second->weight(lb_endpoint.load_balancing_weight().value());
+        health_changed |= updateEdsHealth(*current_host->second, lb_endpoint);
+        new_hosts.push_back(current_host->second);
+        continue;
+      }
+
       const bool canary = Config::Metadata::metadataValue(lb_endpoint.metadata(),
                                                           Config::MetadataFilters::get().ENVOY_LB,
                                                           Config::MetadataEnvoyLbKeys::get().CANARY)
                               .bool_value();
-      new_hosts.emplace_back(new HostImpl(
-          info_, "", Network::Utility::fromProtoAddress(lb_endpoint.endpoint().address()), canary,
-          lb_endpoint.load_balancing_weight().value(), zone));
+      new_hosts.emplace_back(new HostImpl(info_, "", address, canary,
+                                          lb_endpoint.load_balancing_weight().value(), zone,
+                                          lb_endpoint.metadata()));
+      updateEdsHealth(*new_hosts.back(), lb_endpoint);
     }
   }
 
@@ -103,6 +139,20 @@ void EdsClusterImpl::onConfigUpdate(const ResourceVector& resources) {
         }
       });
     }
+  } else if (health_changed) {
+    // Only the health status of existing hosts changed, so the host lists stay the same but the
+    // healthy host lists must be rebuilt.
+    ENVOY_LOG(debug, "EDS health status changed for cluster: {}", info_->name());
+    reloadHealthyHosts();
+  }
+
+  // With active health checking, hosts that left the assignment stay until they fail their health
+  // checks. Only skip identical updates once no such hosts are left, so a later update can still
+  // remove them.
+  if (hosts().size() == new_hosts.size()) {
+    assignment_hash_.value(assignment_hash);
+  } else {
+    assignment_hash_ = Optional<uint64_t>();
   }
 
   // If we didn't setup to initialize when our first round of health checking is complete, just
@@ -110,6 +160,34 @@ void EdsClusterImpl::onConfigUpdate(const ResourceVector& resources) {
   runInitializeCallbackIfAny();
 }
 
+bool EdsClusterImpl::updateEdsHealth(Host& host, const envoy::api::v2::LbEndpoint& lb_endpoint) {
+  // Health status supplied by the management server is applied in addition to any active health
+  // checking. This allows a fleet to share the health state computed by a subset of checkers
+  // rather than every Envoy checking every host.
+  bool eds_unhealthy;
+  switch (lb_endpoint.health_status()) {
+  case envoy::api::v2::HealthStatus::UNHEALTHY:
+  case envoy::api::v2::HealthStatus::DRAINING:
+  case envoy::api::v2::HealthStatus::TIMEOUT:
+    eds_unhealthy = true;
+    break;
+  default:
+    eds_unhealthy = false;
+    break;
+  }
+
+  if (eds_unhealthy == host.healthFlagGet(Host::HealthFlag::FAILED_EDS_HEALTH)) {
+    return false;
+  }
+
+  if (eds_unhealthy) {
+    host.healthFlagSet(Host::HealthFlag::FAILED_EDS_HEALTH);
+  } else {
+    host.healthFlagClear(Host::HealthFlag::FAILED_EDS_HEALTH);
+  }
+  return true;
+}
+
 void EdsClusterImpl::onConfigUpdateFailed(const EnvoyException* e) {
   UNREFERENCED_PARAMETER(e);
   // We need to allow server startup to continue, even if we have a bad
@@ -32,12 +32,19 @@ public:
   void onConfigUpdateFailed(const EnvoyException* e) override;
 
 private:
+  /**
+   * Apply the EDS health status of an endpoint to a host.
+   * @return bool whether the host's EDS health changed.
+   */
+  static bool updateEdsHealth(Host& host, const envoy::api::v2::LbEndpoint& lb_endpoint);
   void runInitializeCallbackIfAny();
 
   std::unique_ptr<Config::Subscription<envoy::api::v2::ClusterLoadAssignment>> subscription_;
   const LocalInfo::LocalInfo& local_info_;
   const std::string cluster_name_;
   uint64_t pending_health_checks_{};
+  // Hash of the last assignment applied, unset while the host list does not match it yet.
+  Optional<uint64_t> assignment_hash_;
 };
 
 } // namespace Upstream
@@ -48,6 +48,7 @@ HealthCheckerSharedPtr HealthCheckerFactory::create(const envoy::api::v2::Health
 }
 
 const std::chrono::milliseconds HealthCheckerImplBase::NO_TRAFFIC_INTERVAL{60000};
+const std::chrono::milliseconds HealthCheckerImplBase::CONNECT_DEFER_INTERVAL{1000};
 
 HealthCheckerImplBase::HealthCheckerImplBase(const Cluster& cluster,
                                              const envoy::api::v2::HealthCheck& config,
@@ -60,13 +61,46 @@ HealthCheckerImplBase::HealthCheckerImplBase(const Cluster& cluster,
       healthy_threshold_(PROTOBUF_GET_WRAPPED_REQUIRED(config, healthy_threshold)),
       stats_(generateStats(cluster.info()->statsScope())), runtime_(runtime), random_(random),
       interval_(PROTOBUF_GET_MS_REQUIRED(config, interval)),
-      interval_jitter_(PROTOBUF_GET_MS_OR_DEFAULT(config, interval_jitter, 0)) {
+      interval_jitter_(PROTOBUF_GET_MS_OR_DEFAULT(config, interval_jitter, 0)),
+      stagger_initial_checks_(
+          runtime.snapshot().getInteger("health_check.stagger_initial_checks", 0) != 0),
+      max_connects_per_second_(
+          runtime.snapshot().getInteger("health_check.max_connects_per_second", 0)) {
   cluster_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>& hosts_added,
                                     const std::vector<HostSharedPtr>& hosts_removed) -> void {
     onClusterMemberUpdate(hosts_added, hosts_removed);
   });
 }
 
+bool HealthCheckerImplBase::allowConnect() {
+  if (max_connects_per_second_ == 0) {
+    return true;
+  }
+
+  // Connects are counted in one second windows that start with the first connect in the window.
+  if (connects_in_window_ == 0) {
+    if (!connect_window_timer_) {
+      connect_window_timer_ =
+          dispatcher_.createTimer([this]() -> void { connects_in_window_ = 0; });
+    }
+    connect_window_timer_->enableTimer(std::chrono::seconds(1));
+  }
+
+  if (connects_in_window_ == max_connects_per_second_) {
+    return false;
+  }
+
+  connects_in_window_++;
+  return true;
+}
+
+std::chrono::milliseconds HealthCheckerImplBase::connectDeferInterval() {
+  // Deferred checks are spread over the next second so that they don't all retry in the same
+  // window.
+  return CONNECT_DEFER_INTERVAL +
+         std::chrono::milliseconds(random_.random() % CONNECT_DEFER_INTERVAL.count());
+}
+
 void HealthCheckerImplBase::decHealthy() {
   ASSERT(local_process_healthy_ > 0);
   local_process_healthy_--;
@@ -110,11 +144,18 @@ std::chrono::milliseconds HealthCheckerImplBase::interval() const {
 }
 
 void HealthCheckerImplBase::addHosts(const std::vector<HostSharedPtr>& hosts) {
-  for (const HostSharedPtr& host : hosts) {
-    active_sessions_[host] = makeSession(host);
+  // When staggering, the first checks of a batch of hosts are spread evenly over the interval
+  // instead of all running right away. Later checks keep their offsets since each session
+  // schedules its next check when its current one completes.
+  for (size_t i = 0; i < hosts.size(); i++) {
+    const HostSharedPtr& host = hosts[i];
+    ActiveHealthCheckSessionPtr& session = active_sessions_[host];
+    session = makeSession(host);
     host->setHealthChecker(
         HealthCheckHostMonitorPtr{new HealthCheckHostMonitorImpl(shared_from_this(), host)});
-    active_sessions_[host]->start();
+    session->start(stagger_initial_checks_
+                       ? std::chrono::milliseconds(interval_.count() * i / hosts.size())
+                       : std::chrono::milliseconds(0));
   }
 }
 
@@ -251,7 +292,23 @@ void HealthCheckerImplBase::ActiveHealthCheckSession::handleFailure(FailureType
   interval_timer_->enableTimer(parent_.interval());
 }
 
+void HealthCheckerImplBase::ActiveHealthCheckSession::start(
+    std::chrono::milliseconds initial_delay) {
+  if (initial_delay.count() > 0) {
+    interval_timer_->enableTimer(initial_delay);
+  } else {
+    onIntervalBase();
+  }
+}
+
 void HealthCheckerImplBase::ActiveHealthCheckSession::onIntervalBase() {
+  if (!hasConnection() && !parent_.allowConnect()) {
+    // The host has done nothing wrong, so this is not a failure. Just try again shortly.
+    parent_.stats_.connect_deferred_.inc();
+    interval_timer_->enableTimer(parent_.connectDeferInterval());
+    return;
+  }
+
   onInterval();
   timeout_timer_->enableTimer(parent_.timeout_);
   parent_.stats_.attempt_.inc();
@@ -387,8 +444,10 @@ void HttpHealthCheckerImpl::HttpActiveHealthCheckSession::onTimeout() {
 
 Http::CodecClient*
 ProdHttpHealthCheckerImpl::createCodecClient(Upstream::Host::CreateConnectionData& data) {
-  return new Http::CodecClientProd(Http::CodecClient::Type::HTTP1, std::move(data.connection_),
-                                   data.host_description_);
+  const Http::CodecClient::Type type =
+      (cluster_.info()->features() & ClusterInfo::Features::HTTP2) ? Http::CodecClient::Type::HTTP2
+                                                                   : Http::CodecClient::Type::HTTP1;
+  return new Http::CodecClientProd(type, std::move(data.connection_), data.host_description_);
 }
 
 TcpHealthCheckMatcher::MatchSegments TcpHealthCheckMatcher::loadProtoBytes(
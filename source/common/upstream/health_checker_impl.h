@@ -57,6 +57,7 @@ public:
   COUNTER(passive_failure)                                                                         \
   COUNTER(network_failure)                                                                         \
   COUNTER(verify_cluster)                                                                          \
+  COUNTER(connect_deferred)                                                                        \
   GAUGE  (healthy)
 // clang-format on
 
@@ -85,7 +86,7 @@ protected:
 
     virtual ~ActiveHealthCheckSession();
     void setUnhealthy(FailureType type);
-    void start() { onIntervalBase(); }
+    void start(std::chrono::milliseconds initial_delay);
 
   protected:
     ActiveHealthCheckSession(HealthCheckerImplBase& parent, HostSharedPtr host);
@@ -96,6 +97,11 @@ protected:
     HostSharedPtr host_;
 
   private:
+    /**
+     * @return bool whether the session has a connection it can check the host over, so that the
+     *         next check does not need to connect.
+     */
+    virtual bool hasConnection() const PURE;
     virtual void onInterval() PURE;
     void onIntervalBase();
     virtual void onTimeout() PURE;
@@ -140,6 +146,8 @@ private:
   };
 
   void addHosts(const std::vector<HostSharedPtr>& hosts);
+  bool allowConnect();
+  std::chrono::milliseconds connectDeferInterval();
   void decHealthy();
   HealthCheckerStats generateStats(Stats::Scope& scope);
   void incHealthy();
@@ -151,16 +159,22 @@ private:
   void setUnhealthyCrossThread(const HostSharedPtr& host);
 
   static const std::chrono::milliseconds NO_TRAFFIC_INTERVAL;
+  static const std::chrono::milliseconds CONNECT_DEFER_INTERVAL;
 
   std::list<HostStatusCb> callbacks_;
   const std::chrono::milliseconds interval_;
   const std::chrono::milliseconds interval_jitter_;
   std::unordered_map<HostSharedPtr, ActiveHealthCheckSessionPtr> active_sessions_;
   uint64_t local_process_healthy_{};
+  const bool stagger_initial_checks_;
+  const uint64_t max_connects_per_second_;
+  uint64_t connects_in_window_{};
+  Event::TimerPtr connect_window_timer_;
 };
 
 /**
- * HTTP health checker implementation. Connection keep alive is used where possible.
+ * HTTP health checker implementation. Connection keep alive is used where possible. Clusters that
+ * support HTTP/2 are health checked over HTTP/2, with each check a new stream on the connection.
  */
 class HttpHealthCheckerImpl : public HealthCheckerImplBase {
 public:
@@ -179,6 +193,7 @@ private:
     bool isHealthCheckSucceeded();
 
     // ActiveHealthCheckSession
+    bool hasConnection() const override { return client_ != nullptr; }
     void onInterval() override;
     void onTimeout() override;
 
@@ -333,6 +348,7 @@ private:
     void onEvent(Network::ConnectionEvent event);
 
     // ActiveHealthCheckSession
+    bool hasConnection() const override { return client_ != nullptr; }
     void onInterval() override;
     void onTimeout() override;
 
@@ -376,6 +392,7 @@ private:
     ~RedisActiveHealthCheckSession();
 
     // ActiveHealthCheckSession
+    bool hasConnection() const override { return client_ != nullptr; }
     void onInterval() override;
     void onTimeout() override;
 
@@ -384,6 +401,8 @@ private:
       // Allow the main HC infra to control timeout.
       return parent_.timeout_ * 2;
     }
+    uint32_t maxBatchRequests() const override { return 0; }
+    uint32_t maxBatchBytes() const override { return 0; }
 
     // Redis::ConnPool::PoolCallbacks
     void onResponse(Redis::RespValuePtr&& value) override;
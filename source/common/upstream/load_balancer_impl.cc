@@ -1,5 +1,7 @@
 #include "common/upstream/load_balancer_impl.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -17,6 +19,40 @@ static const std::string RuntimeZoneEnabled = "upstream.zone_routing.enabled";
 static const std::string RuntimeMinClusterSize = "upstream.zone_routing.min_cluster_size";
 static const std::string RuntimePanicThreshold = "upstream.healthy_panic_threshold";
 
+const uint32_t LoadBalancerUtility::MAX_UNHEALTHY_REPICKS;
+const uint32_t LoadBalancerUtility::MAX_UNHEALTHY_ENTRIES;
+
+HostConstSharedPtr LoadBalancerUtility::nextHealthyEntry(
+    const std::vector<uint32_t>& entries, size_t start,
+    const std::vector<HostConstSharedPtr>& hosts, ClusterStats& stats) {
+  const uint32_t owner = entries[start];
+  if (hosts[owner]->healthy()) {
+    return hosts[owner];
+  }
+
+  // Consecutive entries mostly belong to hosts already looked at, which are skipped.
+  stats.lb_unhealthy_repick_.inc();
+  uint32_t unhealthy[MAX_UNHEALTHY_REPICKS];
+  uint32_t unhealthy_count = 0;
+  const size_t last = std::min<size_t>(entries.size(), MAX_UNHEALTHY_ENTRIES + 1);
+  for (size_t i = 1; i < last; i++) {
+    const uint32_t index = entries[(start + i) % entries.size()];
+    if (index == owner ||
+        std::find(unhealthy, unhealthy + unhealthy_count, index) != unhealthy + unhealthy_count) {
+      continue;
+    }
+    if (hosts[index]->healthy()) {
+      return hosts[index];
+    }
+    unhealthy[unhealthy_count++] = index;
+    if (unhealthy_count == MAX_UNHEALTHY_REPICKS) {
+      break;
+    }
+  }
+
+  return hosts[owner];
+}
+
 LoadBalancerBase::LoadBalancerBase(const HostSet& host_set, const HostSet* local_host_set,
                                    ClusterStats& stats, Runtime::Loader& runtime,
                                    Runtime::RandomGenerator& random)
@@ -41,10 +77,19 @@ LoadBalancerBase::~LoadBalancerBase() {
 }
 
 void LoadBalancerBase::regenerateZoneRoutingStructures() {
+  uint64_t min_cluster_size = runtime_.snapshot().getInteger(RuntimeMinClusterSize, 6U);
+
+  // Most updates of large clusters only change which hosts are healthy within a zone, or update
+  // the other of the two clusters in a way that leaves its zone sizes alone. The routing is then
+  // the same as before.
+  if (!zoneRoutingInputsChanged(min_cluster_size)) {
+    return;
+  }
+
   stats_.lb_recalculate_zone_structures_.inc();
 
   // Do not perform any calculations if we cannot perform zone routing based on non runtime params.
-  if (earlyExitNonZoneRouting()) {
+  if (earlyExitNonZoneRouting(min_cluster_size)) {
     zone_routing_state_ = ZoneRoutingState::NoZoneRouting;
     return;
   }
@@ -105,7 +150,28 @@ void LoadBalancerBase::regenerateZoneRoutingStructures() {
   }
 };
 
-bool LoadBalancerBase::earlyExitNonZoneRouting() {
+bool LoadBalancerBase::zoneRoutingInputsChanged(uint64_t min_cluster_size) {
+  next_zone_routing_inputs_.clear();
+  next_zone_routing_inputs_.push_back(min_cluster_size);
+  next_zone_routing_inputs_.push_back(host_set_.healthyHosts().size());
+  // The number of upstream zones separates the upstream zones from the local ones.
+  next_zone_routing_inputs_.push_back(host_set_.healthyHostsPerZone().size());
+  for (const auto& zone_hosts : host_set_.healthyHostsPerZone()) {
+    next_zone_routing_inputs_.push_back(zone_hosts.size());
+  }
+  for (const auto& zone_hosts : local_host_set_->healthyHostsPerZone()) {
+    next_zone_routing_inputs_.push_back(zone_hosts.size());
+  }
+
+  if (next_zone_routing_inputs_ == zone_routing_inputs_) {
+    return false;
+  }
+
+  zone_routing_inputs_.swap(next_zone_routing_inputs_);
+  return true;
+}
+
+bool LoadBalancerBase::earlyExitNonZoneRouting(uint64_t min_cluster_size) {
   if (host_set_.healthyHostsPerZone().size() < 2) {
     return true;
   }
@@ -121,7 +187,6 @@ bool LoadBalancerBase::earlyExitNonZoneRouting() {
   }
 
   // Do not perform zone routing for small clusters.
-  uint64_t min_cluster_size = runtime_.snapshot().getInteger(RuntimeMinClusterSize, 6U);
   if (host_set_.healthyHosts().size() < min_cluster_size) {
     stats_.lb_zone_cluster_too_small_.inc();
     return true;
@@ -231,69 +296,182 @@ const std::vector<HostSharedPtr>& LoadBalancerBase::hostsToUse() {
   return tryChooseLocalZoneHosts();
 }
 
+RoundRobinLoadBalancer::RoundRobinLoadBalancer(const HostSet& host_set,
+                                               const HostSet* local_host_set_,
+                                               ClusterStats& stats, Runtime::Loader& runtime,
+                                               Runtime::RandomGenerator& random)
+    : LoadBalancerBase(host_set, local_host_set_, stats, runtime, random) {
+  host_set.addMemberUpdateCb(
+      [this](const std::vector<HostSharedPtr>&, const std::vector<HostSharedPtr>&) -> void {
+        schedulers_.clear();
+      });
+}
+
 HostConstSharedPtr RoundRobinLoadBalancer::chooseHost(const LoadBalancerContext*) {
   const std::vector<HostSharedPtr>& hosts_to_use = hostsToUse();
   if (hosts_to_use.empty()) {
     return nullptr;
   }
 
-  return hosts_to_use[rr_index_++ % hosts_to_use.size()];
+  return chooseHealthy(hosts_to_use, [this, &hosts_to_use]() -> HostConstSharedPtr {
+    return pickHost(hosts_to_use);
+  });
 }
 
-LeastRequestLoadBalancer::LeastRequestLoadBalancer(const HostSet& host_set,
-                                                   const HostSet* local_host_set,
-                                                   ClusterStats& stats, Runtime::Loader& runtime,
-                                                   Runtime::RandomGenerator& random)
-    : LoadBalancerBase(host_set, local_host_set, stats, runtime, random) {
-  host_set.addMemberUpdateCb([this](const std::vector<HostSharedPtr>&,
-                                    const std::vector<HostSharedPtr>& hosts_removed) -> void {
-    if (last_host_) {
-      for (const HostSharedPtr& host : hosts_removed) {
-        if (host == last_host_) {
-          hits_left_ = 0;
-          last_host_.reset();
-
-          break;
-        }
-      }
+HostConstSharedPtr
+RoundRobinLoadBalancer::pickHost(const std::vector<HostSharedPtr>& hosts_to_use) {
+  if (stats_.max_host_weight_.value() <= 1 ||
+      runtime_.snapshot().getInteger("upstream.weight_enabled", 1UL) == 0) {
+    return hosts_to_use[rr_index_++ % hosts_to_use.size()];
+  }
+
+  auto it = schedulers_.find(&hosts_to_use);
+  if (it == schedulers_.end()) {
+    it = schedulers_.emplace(&hosts_to_use, EdfScheduler<Host>()).first;
+    for (const HostSharedPtr& host : hosts_to_use) {
+      it->second.add(host->weight(), host);
     }
-  });
+  }
+
+  // Put the host straight back with its current weight, so weight changes apply on its next turn.
+  HostSharedPtr host = it->second.pick();
+  it->second.add(host->weight(), host);
+  return host;
 }
 
 HostConstSharedPtr LeastRequestLoadBalancer::chooseHost(const LoadBalancerContext*) {
-  bool is_weight_imbalanced = stats_.max_host_weight_.value() != 1;
-  bool is_weight_enabled = runtime_.snapshot().getInteger("upstream.weight_enabled", 1UL) != 0;
+  const std::vector<HostSharedPtr>& hosts_to_use = hostsToUse();
+  if (hosts_to_use.empty()) {
+    return nullptr;
+  }
 
-  if (is_weight_imbalanced && hits_left_ > 0 && is_weight_enabled) {
-    --hits_left_;
+  const bool use_weights = stats_.max_host_weight_.value() != 1 &&
+                           runtime_.snapshot().getInteger("upstream.weight_enabled", 1UL) != 0;
+  const uint64_t choice_count =
+      std::max(1UL, runtime_.snapshot().getInteger("upstream.least_request.choice_count", 2UL));
+  return chooseHealthy(hosts_to_use, [&]() -> HostConstSharedPtr {
+    return pickHost(hosts_to_use, use_weights, choice_count);
+  });
+}
 
-    return last_host_;
-  } else {
-    // To avoid hit stale last_host_ when all hosts become weight balanced.
-    hits_left_ = 0;
-    last_host_.reset();
+HostConstSharedPtr
+LeastRequestLoadBalancer::pickHost(const std::vector<HostSharedPtr>& hosts_to_use,
+                                   bool use_weights, uint64_t choice_count) {
+  // Keep references into the host vector rather than copying shared pointers for each candidate.
+  const HostSharedPtr* chosen = &hosts_to_use[random_.random() % hosts_to_use.size()];
+  for (uint64_t i = 1; i < choice_count; i++) {
+    const HostSharedPtr& candidate = hosts_to_use[random_.random() % hosts_to_use.size()];
+    if (!hasLessLoad(**chosen, *candidate, use_weights)) {
+      chosen = &candidate;
+    }
   }
 
+  return *chosen;
+}
+
+bool LeastRequestLoadBalancer::hasLessLoad(const Host& lhs, const Host& rhs, bool use_weights) {
+  const uint64_t lhs_active = lhs.stats().rq_active_.value();
+  const uint64_t rhs_active = rhs.stats().rq_active_.value();
+  if (!use_weights) {
+    return lhs_active < rhs_active;
+  }
+
+  // Compares (lhs_active + 1) / lhs.weight() with (rhs_active + 1) / rhs.weight() without
+  // dividing. The + 1 counts the request being placed, so that idle hosts still compare by weight.
+  return (lhs_active + 1) * rhs.weight() < (rhs_active + 1) * lhs.weight();
+}
+
+PeakEwmaLoadBalancer::PeakEwmaLoadBalancer(const HostSet& host_set,
+                                           const HostSet* local_host_set, ClusterStats& stats,
+                                           Runtime::Loader& runtime,
+                                           Runtime::RandomGenerator& random,
+                                           MonotonicTimeSource& time_source)
+    : LoadBalancerBase(host_set, local_host_set, stats, runtime, random),
+      time_source_(time_source) {
+  host_set.addMemberUpdateCb(
+      [this](const std::vector<HostSharedPtr>&,
+             const std::vector<HostSharedPtr>& hosts_removed) -> void {
+        for (const HostSharedPtr& host : hosts_removed) {
+          latencies_.erase(host.get());
+        }
+      });
+}
+
+HostConstSharedPtr PeakEwmaLoadBalancer::chooseHost(const LoadBalancerContext*) {
   const std::vector<HostSharedPtr>& hosts_to_use = hostsToUse();
   if (hosts_to_use.empty()) {
     return nullptr;
   }
 
-  // Make weighed random if we have hosts with non 1 weights.
-  if (is_weight_imbalanced & is_weight_enabled) {
-    last_host_ = hosts_to_use[random_.random() % hosts_to_use.size()];
-    hits_left_ = last_host_->weight() - 1;
+  const MonotonicTime now = time_source_.currentTime();
+  const double decay_ms = decayMs();
+  const uint64_t choice_count =
+      std::max(1UL, runtime_.snapshot().getInteger("upstream.least_request.choice_count", 2UL));
+  return chooseHealthy(hosts_to_use, [&]() -> HostConstSharedPtr {
+    return pickHost(hosts_to_use, now, decay_ms, choice_count);
+  });
+}
 
-    return last_host_;
-  } else {
-    HostSharedPtr host1 = hosts_to_use[random_.random() % hosts_to_use.size()];
-    HostSharedPtr host2 = hosts_to_use[random_.random() % hosts_to_use.size()];
-    if (host1->stats().rq_active_.value() < host2->stats().rq_active_.value()) {
-      return host1;
-    } else {
-      return host2;
+HostConstSharedPtr PeakEwmaLoadBalancer::pickHost(const std::vector<HostSharedPtr>& hosts_to_use,
+                                                  MonotonicTime now, double decay_ms,
+                                                  uint64_t choice_count) {
+  const HostSharedPtr* chosen = &hosts_to_use[random_.random() % hosts_to_use.size()];
+  double chosen_cost = cost(**chosen, now, decay_ms);
+  for (uint64_t i = 1; i < choice_count; i++) {
+    const HostSharedPtr& candidate = hosts_to_use[random_.random() % hosts_to_use.size()];
+    const double candidate_cost = cost(*candidate, now, decay_ms);
+    if (!(chosen_cost < candidate_cost)) {
+      chosen = &candidate;
+      chosen_cost = candidate_cost;
     }
   }
+
+  return *chosen;
+}
+
+void PeakEwmaLoadBalancer::onResponseTime(const HostDescription& host,
+                                          std::chrono::milliseconds response_time) {
+  auto it = latencies_.find(&host);
+  if (it == latencies_.end()) {
+    // The host has left the host set since it was picked.
+    return;
+  }
+
+  observe(it->second, response_time.count(), time_source_.currentTime(), decayMs());
+}
+
+void PeakEwmaLoadBalancer::observe(HostLatency& latency, double response_time_ms,
+                                   MonotonicTime now, double decay_ms) {
+  if (response_time_ms > latency.ewma_ms_) {
+    latency.ewma_ms_ = response_time_ms;
+  } else {
+    const double elapsed_ms = std::max<int64_t>(
+        0, std::chrono::duration_cast<std::chrono::milliseconds>(now - latency.last_update_)
+               .count());
+    const double weight = std::exp(-elapsed_ms / decay_ms);
+    latency.ewma_ms_ = latency.ewma_ms_ * weight + response_time_ms * (1 - weight);
+  }
+  latency.last_update_ = now;
+}
+
+double PeakEwmaLoadBalancer::cost(const Host& host, MonotonicTime now, double decay_ms) {
+  auto it = latencies_.find(&host);
+  if (it == latencies_.end()) {
+    it = latencies_.emplace(&host, HostLatency{0, now}).first;
+  }
+
+  // Decay towards zero for the time without responses before comparing.
+  observe(it->second, 0, now, decay_ms);
+
+  const uint64_t active = host.stats().rq_active_.value();
+  if (it->second.ewma_ms_ == 0) {
+    return active == 0 ? 0 : PENALTY_MS + active;
+  }
+  return it->second.ewma_ms_ * (active + 1);
+}
+
+double PeakEwmaLoadBalancer::decayMs() {
+  return std::max(1UL, runtime_.snapshot().getInteger("upstream.peak_ewma.decay_ms", 10000UL));
 }
 
 HostConstSharedPtr RandomLoadBalancer::chooseHost(const LoadBalancerContext*) {
@@ -302,7 +480,9 @@ HostConstSharedPtr RandomLoadBalancer::chooseHost(const LoadBalancerContext*) {
     return nullptr;
   }
 
-  return hosts_to_use[random_.random() % hosts_to_use.size()];
+  return chooseHealthy(hosts_to_use, [this, &hosts_to_use]() -> HostConstSharedPtr {
+    return hosts_to_use[random_.random() % hosts_to_use.size()];
+  });
 }
 
 } // namespace Upstream
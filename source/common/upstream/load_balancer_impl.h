@@ -1,12 +1,17 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <unordered_map>
 #include <vector>
 
+#include "envoy/common/time.h"
 #include "envoy/runtime/runtime.h"
 #include "envoy/upstream/load_balancer.h"
 #include "envoy/upstream/upstream.h"
 
+#include "common/upstream/edf_scheduler.h"
+
 namespace Envoy {
 namespace Upstream {
 
@@ -21,6 +26,32 @@ public:
    * requests to hosts regardless of whether they are healthy or not.
    */
   static bool isGlobalPanic(const HostSet& host_set, ClusterStats& stats, Runtime::Loader& runtime);
+
+  // How many more hosts a load balancer picks when the host it picked from the healthy hosts has
+  // failed since they were last rebuilt. Outlier ejections only rebuild the healthy hosts in
+  // batches, and health flags are atomic, so this keeps traffic off ejected hosts in the meantime.
+  static const uint32_t MAX_UNHEALTHY_REPICKS = 3;
+
+  // How many entries of a hash ring or table are looked at past the one a key hashed to. Entries
+  // of one host can be consecutive for long runs on small or skewed rings, so this bounds the walk
+  // when there are fewer than MAX_UNHEALTHY_REPICKS other hosts nearby.
+  static const uint32_t MAX_UNHEALTHY_ENTRIES = 64;
+
+  /**
+   * Choose the host of an entry of a hash ring or table, or, if it has become unhealthy, the host
+   * of the next entry owned by another host that is healthy, looking at no more than
+   * MAX_UNHEALTHY_REPICKS other hosts and MAX_UNHEALTHY_ENTRIES entries. This is the host the
+   * entry would have if the structure were rebuilt without the failed hosts, as far as a ring is
+   * concerned, so keys keep going to one host until the rebuild. The host of the entry is used if
+   * no healthy one was found.
+   * @param entries supplies the index in hosts of the host of each entry.
+   * @param start supplies the entry the key hashed to.
+   * @param hosts supplies the hosts.
+   * @param stats supplies the stats counting each call that looked past the host of the entry.
+   */
+  static HostConstSharedPtr nextHealthyEntry(const std::vector<uint32_t>& entries, size_t start,
+                                             const std::vector<HostConstSharedPtr>& hosts,
+                                             ClusterStats& stats);
 };
 
 /**
@@ -37,6 +68,29 @@ protected:
    */
   const std::vector<HostSharedPtr>& hostsToUse();
 
+  /**
+   * Pick a host from the hosts that hostsToUse() returned, and pick again while the host has
+   * become unhealthy, at most MAX_UNHEALTHY_REPICKS times. The last host picked is used if none
+   * was healthy. In panic all hosts are used, and none are picked again.
+   * @param hosts_to_use supplies the hosts that hostsToUse() returned.
+   * @param pick supplies a function picking a host from them.
+   */
+  template <class Pick>
+  HostConstSharedPtr chooseHealthy(const std::vector<HostSharedPtr>& hosts_to_use, Pick pick) {
+    HostConstSharedPtr host = pick();
+    if (&hosts_to_use == &host_set_.hosts()) {
+      return host;
+    }
+    if (host->healthy()) {
+      return host;
+    }
+    stats_.lb_unhealthy_repick_.inc();
+    for (uint32_t i = 0; i < LoadBalancerUtility::MAX_UNHEALTHY_REPICKS && !host->healthy(); i++) {
+      host = pick();
+    }
+    return host;
+  }
+
   ClusterStats& stats_;
   Runtime::Loader& runtime_;
   Runtime::RandomGenerator& random_;
@@ -47,8 +101,16 @@ private:
   /**
    * @return decision on quick exit from zone aware routing based on cluster configuration.
    * This gets recalculated on update callback.
+   * @param min_cluster_size supplies the smallest number of healthy upstream hosts to zone route.
    */
-  bool earlyExitNonZoneRouting();
+  bool earlyExitNonZoneRouting(uint64_t min_cluster_size);
+
+  /**
+   * @return whether anything that zone aware routing is computed from changed since the last
+   *         time its structures were regenerated.
+   * @param min_cluster_size supplies the smallest number of healthy upstream hosts to zone route.
+   */
+  bool zoneRoutingInputsChanged(uint64_t min_cluster_size);
 
   /**
    * Try to select upstream hosts from the same zone.
@@ -73,51 +135,123 @@ private:
   uint64_t local_percent_to_route_{};
   ZoneRoutingState zone_routing_state_{ZoneRoutingState::NoZoneRouting};
   std::vector<uint64_t> residual_capacity_;
+  // The minimum cluster size, the number of healthy upstream hosts, and the number of healthy
+  // hosts in each upstream and local zone the structures were last regenerated from. The next
+  // inputs are gathered into a second vector so that neither is reallocated on each update.
+  std::vector<uint64_t> zone_routing_inputs_;
+  std::vector<uint64_t> next_zone_routing_inputs_;
   Common::CallbackHandle* local_host_set_member_update_cb_handle_{};
 };
 
 /**
  * Implementation of LoadBalancer that performs RR selection across the hosts in the cluster.
+ *
+ * When all hosts have the same weight this is a plain index into the host list. Otherwise hosts
+ * are picked by an earliest deadline first scheduler so that each host gets a share of requests
+ * proportional to its weight, spread out over the rotation. There is one scheduler per host list
+ * that hostsToUse() picks from (healthy hosts, all hosts when in panic, or a zone's hosts), built
+ * on first use and dropped when the host set membership changes.
  */
 class RoundRobinLoadBalancer : public LoadBalancer, LoadBalancerBase {
 public:
   RoundRobinLoadBalancer(const HostSet& host_set, const HostSet* local_host_set_,
                          ClusterStats& stats, Runtime::Loader& runtime,
-                         Runtime::RandomGenerator& random)
-      : LoadBalancerBase(host_set, local_host_set_, stats, runtime, random) {}
+                         Runtime::RandomGenerator& random);
 
   // Upstream::LoadBalancer
   HostConstSharedPtr chooseHost(const LoadBalancerContext* context) override;
+  void onResponseTime(const HostDescription&, std::chrono::milliseconds) override {}
 
 private:
+  HostConstSharedPtr pickHost(const std::vector<HostSharedPtr>& hosts_to_use);
+
   size_t rr_index_{};
+  // Keyed by the host list. HostSet swaps its lists on every update, which runs the member update
+  // callback that clears this map, so the key never outlives the list it points to.
+  std::unordered_map<const std::vector<HostSharedPtr>*, EdfScheduler<Host>> schedulers_;
 };
 
 /**
  * Weighted Least Request load balancer.
  *
- * In a normal setup when all hosts have the same weight of 1 it randomly picks up two healthy hosts
- * and compares number of active requests.
+ * It randomly picks N healthy hosts (two by default) and chooses the one with the least active
+ * requests per unit of weight. With equal weights this is plain power of two choices.
  * Technique is based on http://www.eecs.harvard.edu/~michaelm/postscripts/mythesis.pdf
  *
- * When any of the hosts have non 1 weight, apply random weighted balancing.
- * Randomly pickup the host and send 'weight' number of requests to it.
- * This technique is acceptable for load testing but
- * will not work well in situations where requests take a long time.
- * In that case a different algorithm using a full scan will be required.
+ * Dividing by the weight means that a host of weight 3 is chosen over a host of weight 1 until it
+ * has about three times the active requests, so hosts of different sizes get load in proportion
+ * to their weights.
  */
 class LeastRequestLoadBalancer : public LoadBalancer, LoadBalancerBase {
 public:
   LeastRequestLoadBalancer(const HostSet& host_set, const HostSet* local_host_set_,
                            ClusterStats& stats, Runtime::Loader& runtime,
-                           Runtime::RandomGenerator& random);
+                           Runtime::RandomGenerator& random)
+      : LoadBalancerBase(host_set, local_host_set_, stats, runtime, random) {}
+
+  // Upstream::LoadBalancer
+  HostConstSharedPtr chooseHost(const LoadBalancerContext* context) override;
+  void onResponseTime(const HostDescription&, std::chrono::milliseconds) override {}
+
+private:
+  HostConstSharedPtr pickHost(const std::vector<HostSharedPtr>& hosts_to_use, bool use_weights,
+                              uint64_t choice_count);
+
+  /**
+   * @return whether lhs has fewer active requests than rhs, per unit of weight if use_weights.
+   */
+  static bool hasLessLoad(const Host& lhs, const Host& rhs, bool use_weights);
+};
+
+/**
+ * Peak EWMA load balancer.
+ *
+ * Keeps an exponentially weighted moving average of the response time of each host and picks the
+ * cheapest of N random healthy hosts (two by default), where the cost of a host is its average
+ * response time multiplied by its active requests plus one. A response slower than the average
+ * replaces it outright, so a host that slows down is avoided right away and is only picked again
+ * as the peak decays. The average decays towards zero while a host gets no responses, so a slow
+ * host is retried after a while. This is the "peak EWMA" technique from Finagle.
+ *
+ * Load balancers are per worker, so the averages only reflect responses seen by this worker and
+ * are updated without locking. Active requests are read from the host stats, which count requests
+ * from all workers.
+ */
+class PeakEwmaLoadBalancer : public LoadBalancer, LoadBalancerBase {
+public:
+  PeakEwmaLoadBalancer(const HostSet& host_set, const HostSet* local_host_set, ClusterStats& stats,
+                       Runtime::Loader& runtime, Runtime::RandomGenerator& random,
+                       MonotonicTimeSource& time_source);
 
   // Upstream::LoadBalancer
   HostConstSharedPtr chooseHost(const LoadBalancerContext* context) override;
+  void onResponseTime(const HostDescription& host,
+                      std::chrono::milliseconds response_time) override;
 
 private:
-  HostSharedPtr last_host_;
-  uint32_t hits_left_{};
+  struct HostLatency {
+    double ewma_ms_{};
+    MonotonicTime last_update_;
+  };
+
+  /**
+   * Fold a response time into the average, decayed for the time since the last update.
+   */
+  static void observe(HostLatency& latency, double response_time_ms, MonotonicTime now,
+                      double decay_ms);
+  HostConstSharedPtr pickHost(const std::vector<HostSharedPtr>& hosts_to_use, MonotonicTime now,
+                              double decay_ms, uint64_t choice_count);
+  double cost(const Host& host, MonotonicTime now, double decay_ms);
+  double decayMs();
+
+  // Cost of a host that has active requests but no response time yet, so that a new host gets a
+  // first request but is not flooded before its latency is known.
+  static constexpr double PENALTY_MS = 1e9;
+
+  MonotonicTimeSource& time_source_;
+  // Entries are added when a host is first considered and dropped when it leaves the host set, so
+  // a late response from a removed host does not add it back.
+  std::unordered_map<const HostDescription*, HostLatency> latencies_;
 };
 
 /**
@@ -131,6 +265,7 @@ public:
 
   // Upstream::LoadBalancer
   HostConstSharedPtr chooseHost(const LoadBalancerContext* context) override;
+  void onResponseTime(const HostDescription&, std::chrono::milliseconds) override {}
 };
 
 } // namespace Upstream
@@ -16,6 +16,15 @@
 namespace Envoy {
 namespace Upstream {
 
+namespace {
+
+bool sameAddress(const Network::Address::InstanceConstSharedPtr& address,
+                 const Network::Address::InstanceConstSharedPtr& other) {
+  return address == other || (address && other && *address == *other);
+}
+
+} // namespace
+
 LogicalDnsCluster::LogicalDnsCluster(const envoy::api::v2::Cluster& cluster,
                                      Runtime::Loader& runtime, Stats::Store& stats,
                                      Ssl::ContextManager& ssl_context_manager,
@@ -28,7 +37,9 @@ LogicalDnsCluster::LogicalDnsCluster(const envoy::api::v2::Cluster& cluster,
       dns_refresh_rate_ms_(
           std::chrono::milliseconds(PROTOBUF_GET_MS_OR_DEFAULT(cluster, dns_refresh_rate, 5000))),
       tls_(tls.allocateSlot()), initialized_(false),
-      resolve_timer_(dispatcher.createTimer([this]() -> void { startResolve(); })) {
+      resolve_timer_(dispatcher.createTimer([this]() -> void { startResolve(); })),
+      happy_eyeballs_delay_runtime_key_(
+          fmt::format("upstream.happy_eyeballs_delay_ms.{}", info_->name())) {
   const auto& hosts = cluster.hosts();
   if (hosts.size() != 1) {
     throw EnvoyException("logical_dns clusters must have a single host");
@@ -87,15 +98,19 @@ void LogicalDnsCluster::startResolve() {
           Network::Address::InstanceConstSharedPtr new_address =
               Network::Utility::getAddressWithPort(*address_list.front(),
                                                    Network::Utility::portFromTcpUrl(dns_url_));
-          if (!current_resolved_address_ || !(*new_address == *current_resolved_address_)) {
-            current_resolved_address_ = new_address;
-            // Capture URL to avoid a race with another update.
-            tls_->runOnAllThreads([this, new_address]() -> void {
-              tls_->getTyped<PerThreadCurrentHostData>().current_resolved_address_ = new_address;
-            });
+          // Auto resolves both families, the preferred one first. Keep the first address of the
+          // other family to fall back to.
+          Network::Address::InstanceConstSharedPtr new_fallback_address;
+          for (const Network::Address::InstanceConstSharedPtr& address : address_list) {
+            if (address->ip()->version() != address_list.front()->ip()->version()) {
+              new_fallback_address = Network::Utility::getAddressWithPort(
+                  *address, Network::Utility::portFromTcpUrl(dns_url_));
+              break;
+            }
           }
 
-          if (!logical_host_) {
+          const bool first_resolve = !logical_host_;
+          if (first_resolve) {
             // TODO(mattklein123): The logical host is only used in /clusters admin output. We used
             // to show the friendly DNS name in that output, but currently there is no way to
             // express a DNS name inside of an Address::Instance. For now this is OK but we might
@@ -110,6 +125,23 @@ void LogicalDnsCluster::startResolve() {
                   new LogicalHost(info_, hostname_, Network::Utility::getIpv6AnyAddress(), *this));
               break;
             }
+          }
+
+          HostDescriptionConstSharedPtr new_host_description =
+              updateHostDescriptions(address_list, new_address);
+          if (!sameAddress(new_address, current_resolved_address_) ||
+              !sameAddress(new_fallback_address, current_fallback_address_)) {
+            current_resolved_address_ = new_address;
+            current_fallback_address_ = new_fallback_address;
+            // Capture URL to avoid a race with another update.
+            tls_->runOnAllThreads([this, new_host_description, new_fallback_address]() -> void {
+              PerThreadCurrentHostData& data = tls_->getTyped<PerThreadCurrentHostData>();
+              data.current_host_description_ = new_host_description;
+              data.current_fallback_address_ = new_fallback_address;
+            });
+          }
+
+          if (first_resolve) {
             HostVectorSharedPtr new_hosts(new std::vector<HostSharedPtr>());
             new_hosts->emplace_back(logical_host_);
             updateHosts(new_hosts, createHealthyHostList(*new_hosts), empty_host_lists_,
@@ -127,13 +159,43 @@ void LogicalDnsCluster::startResolve() {
       });
 }
 
+HostDescriptionConstSharedPtr LogicalDnsCluster::updateHostDescriptions(
+    const std::list<Network::Address::InstanceConstSharedPtr>& address_list,
+    Network::Address::InstanceConstSharedPtr current_address) {
+  // Keep the descriptions of the addresses that are still resolved, so that connections to an
+  // address that becomes current again share a description with the ones made before.
+  std::unordered_map<std::string, HostDescriptionConstSharedPtr> host_descriptions;
+  for (const Network::Address::InstanceConstSharedPtr& address : address_list) {
+    auto it = host_descriptions_.find(address->ip()->addressAsString());
+    if (it != host_descriptions_.end()) {
+      host_descriptions.insert(*it);
+    }
+  }
+
+  HostDescriptionConstSharedPtr& current =
+      host_descriptions[current_address->ip()->addressAsString()];
+  if (!current) {
+    current.reset(new RealHostDescription(current_address, logical_host_));
+  }
+  host_descriptions_.swap(host_descriptions);
+  return current;
+}
+
 Upstream::Host::CreateConnectionData
 LogicalDnsCluster::LogicalHost::createConnection(Event::Dispatcher& dispatcher) const {
   PerThreadCurrentHostData& data = parent_.tls_->getTyped<PerThreadCurrentHostData>();
-  ASSERT(data.current_resolved_address_);
-  return {HostImpl::createConnection(dispatcher, *parent_.info_, data.current_resolved_address_),
-          HostDescriptionConstSharedPtr{
-              new RealHostDescription(data.current_resolved_address_, shared_from_this())}};
+  ASSERT(data.current_host_description_);
+  Network::ClientConnectionPtr connection = HostImpl::createConnection(
+      dispatcher, *parent_.info_, data.current_host_description_->address());
+  // A source address binds the connection to the family of the resolved address.
+  const uint64_t happy_eyeballs_delay_ms = parent_.runtime_.snapshot().getInteger(
+      parent_.happy_eyeballs_delay_runtime_key_, DEFAULT_HAPPY_EYEBALLS_DELAY_MS);
+  if (data.current_fallback_address_ && parent_.info_->sourceAddress() == nullptr &&
+      happy_eyeballs_delay_ms > 0) {
+    connection->enableHappyEyeballs(data.current_fallback_address_,
+                                    std::chrono::milliseconds(happy_eyeballs_delay_ms));
+  }
+  return {std::move(connection), data.current_host_description_};
 }
 
 } // namespace Upstream
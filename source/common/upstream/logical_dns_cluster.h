@@ -3,7 +3,9 @@
 #include <chrono>
 #include <cstdint>
 #include <functional>
+#include <list>
 #include <string>
+#include <unordered_map>
 
 #include "envoy/thread_local/thread_local.h"
 
@@ -25,6 +27,14 @@ namespace Upstream {
  * created that will internally have connections to different backends, while still allowing long
  * connection lengths and keep alive. The cluster type should only be used when an IP address change
  * means that connections using the IP should not drain.
+ *
+ * With the auto DNS lookup family, the first address of the other IP family is kept as well.
+ * Connections race a connect to it against the connect to the resolved IP (happy eyeballs), so an
+ * IP family that is broken on the path to the host only delays connects.
+ *
+ * The host description returned with each connection is shared by all connections to the same
+ * resolved IP. Descriptions are kept for the IPs of the latest resolution, so a round robin DNS
+ * answer that keeps returning the same set of IPs does not allocate new ones.
  */
 class LogicalDnsCluster : public ClusterImplBase {
 public:
@@ -69,10 +79,13 @@ private:
     HealthCheckHostMonitor& healthChecker() const override {
       return logical_host_->healthChecker();
     }
+    const envoy::api::v2::Metadata& metadata() const override {
+      return logical_host_->metadata();
+    }
     Outlier::DetectorHostMonitor& outlierDetector() const override {
       return logical_host_->outlierDetector();
     }
-    const HostStats& stats() const override { return logical_host_->stats(); }
+    HostStats& stats() const override { return logical_host_->stats(); }
     const std::string& hostname() const override { return logical_host_->hostname(); }
     Network::Address::InstanceConstSharedPtr address() const override { return address_; }
     const std::string& zone() const override { return EMPTY_STRING; }
@@ -82,10 +95,19 @@ private:
   };
 
   struct PerThreadCurrentHostData : public ThreadLocal::ThreadLocalObject {
-    Network::Address::InstanceConstSharedPtr current_resolved_address_;
+    // The description of the resolved address, shared by all connections to it.
+    HostDescriptionConstSharedPtr current_host_description_;
+    // The address to fall back to, nullptr if there is none.
+    Network::Address::InstanceConstSharedPtr current_fallback_address_;
   };
 
+  // How long the connect to the resolved address runs before the fallback connect starts.
+  static const uint64_t DEFAULT_HAPPY_EYEBALLS_DELAY_MS = 250;
+
   void startResolve();
+  HostDescriptionConstSharedPtr
+  updateHostDescriptions(const std::list<Network::Address::InstanceConstSharedPtr>& address_list,
+                         Network::Address::InstanceConstSharedPtr current_address);
 
   Network::DnsResolverSharedPtr dns_resolver_;
   const std::chrono::milliseconds dns_refresh_rate_ms_;
@@ -98,7 +120,12 @@ private:
   std::string dns_url_;
   std::string hostname_;
   Network::Address::InstanceConstSharedPtr current_resolved_address_;
+  Network::Address::InstanceConstSharedPtr current_fallback_address_;
+  const std::string happy_eyeballs_delay_runtime_key_;
   HostSharedPtr logical_host_;
+  // Host descriptions of the addresses of the latest resolution that connections were made to,
+  // keyed by IP. Only used on the main thread.
+  std::unordered_map<std::string, HostDescriptionConstSharedPtr> host_descriptions_;
   Network::ActiveDnsQuery* active_dns_query_{};
 };
 
@@ -0,0 +1,138 @@
+#include "common/upstream/maglev_lb.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common/common/assert.h"
+#include "common/common/hash.h"
+#include "common/upstream/load_balancer_impl.h"
+
+namespace Envoy {
+namespace Upstream {
+
+MaglevLoadBalancer::MaglevLoadBalancer(HostSet& host_set, ClusterStats& stats,
+                                       Runtime::Loader& runtime, Runtime::RandomGenerator& random,
+                                       uint64_t table_size, PrebuiltTablesCb prebuilt_tables)
+    : host_set_(host_set), stats_(stats), runtime_(runtime), random_(random),
+      table_size_(nextPrime(table_size)), prebuilt_tables_(prebuilt_tables) {
+  host_set_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>&,
+                                     const std::vector<HostSharedPtr>&) -> void { refresh(); });
+
+  refresh();
+}
+
+HostConstSharedPtr MaglevLoadBalancer::chooseHost(const LoadBalancerContext* context) {
+  if (LoadBalancerUtility::isGlobalPanic(host_set_, stats_, runtime_)) {
+    return tables_->all_hosts_table_->chooseHost(context, random_, false, stats_);
+  } else {
+    return tables_->healthy_hosts_table_->chooseHost(context, random_, true, stats_);
+  }
+}
+
+uint64_t MaglevLoadBalancer::nextPrime(uint64_t value) {
+  for (;; value++) {
+    if (value < 2) {
+      continue;
+    }
+    bool prime = true;
+    for (uint64_t divisor = 2; divisor * divisor <= value; divisor++) {
+      if (value % divisor == 0) {
+        prime = false;
+        break;
+      }
+    }
+    if (prime) {
+      return value;
+    }
+  }
+}
+
+void MaglevLoadBalancer::refresh() {
+  tables_ = prebuilt_tables_ ? prebuilt_tables_() : nullptr;
+  if (!tables_) {
+    tables_ = std::make_shared<Tables>(host_set_, table_size_);
+  }
+}
+
+MaglevLoadBalancer::Tables::Tables(const HostSet& host_set, uint64_t table_size)
+    : all_hosts_table_(std::make_shared<Table>(host_set.hosts(), table_size)) {
+  if (host_set.healthyHosts() == host_set.hosts()) {
+    healthy_hosts_table_ = all_hosts_table_;
+  } else {
+    healthy_hosts_table_ = std::make_shared<Table>(host_set.healthyHosts(), table_size);
+  }
+}
+
+MaglevLoadBalancer::Table::Table(const std::vector<HostSharedPtr>& hosts, uint64_t table_size) {
+  ENVOY_LOG(trace, "maglev: building table of size {}", table_size);
+  if (hosts.empty()) {
+    return;
+  }
+
+  // Hosts take turns in address order, so that every worker and every Envoy builds the same table
+  // from the same hosts, whatever order the host set has them in.
+  hosts_.assign(hosts.begin(), hosts.end());
+  std::sort(hosts_.begin(), hosts_.end(),
+            [](const HostConstSharedPtr& lhs, const HostConstSharedPtr& rhs) -> bool {
+              return lhs->address()->asString() < rhs->address()->asString();
+            });
+
+  // The permutation of a host visits the slots starting at its offset, skip slots at a time. Since
+  // the table size is a prime, every skip visits every slot.
+  struct Permutation {
+    uint64_t next_;
+    uint64_t skip_;
+  };
+  std::vector<Permutation> permutations;
+  permutations.reserve(hosts_.size());
+  for (const auto& host : hosts_) {
+    const std::string& address = host->address()->asString();
+    permutations.push_back({HashUtil::xxHash64(address) % table_size,
+                            HashUtil::xxHash64(address, 1) % (table_size - 1) + 1});
+  }
+
+  const uint32_t unowned = std::numeric_limits<uint32_t>::max();
+  entries_.assign(table_size, unowned);
+  uint64_t filled = 0;
+  while (true) {
+    for (uint32_t i = 0; i < hosts_.size(); i++) {
+      Permutation& permutation = permutations[i];
+      while (entries_[permutation.next_] != unowned) {
+        permutation.next_ = (permutation.next_ + permutation.skip_) % table_size;
+      }
+      entries_[permutation.next_] = i;
+      permutation.next_ = (permutation.next_ + permutation.skip_) % table_size;
+      if (++filled == table_size) {
+        return;
+      }
+    }
+  }
+}
+
+HostConstSharedPtr MaglevLoadBalancer::Table::chooseHost(const LoadBalancerContext* context,
+                                                         Runtime::RandomGenerator& random,
+                                                         bool skip_unhealthy,
+                                                         ClusterStats& stats) const {
+  if (entries_.empty()) {
+    return nullptr;
+  }
+
+  // If there is no hash in the context, just choose a random value (this effectively becomes
+  // the random LB but it won't crash if someone configures it this way).
+  // hashKey() may be computed on demand, so get it only once.
+  Optional<uint64_t> hash;
+  if (context) {
+    hash = context->hashKey();
+  }
+  const uint64_t h = hash.valid() ? hash.value() : random.random();
+  if (skip_unhealthy) {
+    return LoadBalancerUtility::nextHealthyEntry(entries_, h % entries_.size(), hosts_, stats);
+  }
+  return hosts_[entries_[h % entries_.size()]];
+}
+
+} // namespace Upstream
+} // namespace Envoy
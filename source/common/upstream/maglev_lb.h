@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "envoy/runtime/runtime.h"
+#include "envoy/upstream/load_balancer.h"
+
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * A consistent hashing load balancer that uses a Maglev lookup table, as described in "Maglev: A
+ * Fast and Reliable Software Network Load Balancer" (Eisenbud et al. 2016). Each host fills the
+ * table in the order of its own permutation of the table's slots, taking turns with the other
+ * hosts, so the hosts own nearly equal shares of the table and a host change moves few slots.
+ * Compared to the ring hash load balancer, lookups are a single table index and the table has a
+ * fixed size, however many hosts there are. Like the ring hash load balancer, a table is kept for
+ * all hosts as well as for healthy hosts, zone aware routing is not supported and host weights
+ * are ignored.
+ */
+class MaglevLoadBalancer : public LoadBalancer, Logger::Loggable<Logger::Id::upstream> {
+public:
+  class Tables;
+  typedef std::shared_ptr<const Tables> TablesConstSharedPtr;
+  typedef std::function<TablesConstSharedPtr()> PrebuiltTablesCb;
+
+  /**
+   * @param table_size supplies the requested size of the lookup table. The table size must be a
+   *        prime, so the next prime at or above it is used.
+   * @param prebuilt_tables optionally supplies the tables for the current hosts of host_set,
+   *        already built elsewhere and shared between load balancers. It is called on each host
+   *        set update and the load balancer only builds its own tables if it returns nullptr.
+   */
+  MaglevLoadBalancer(HostSet& host_set, ClusterStats& stats, Runtime::Loader& runtime,
+                     Runtime::RandomGenerator& random, uint64_t table_size,
+                     PrebuiltTablesCb prebuilt_tables = nullptr);
+
+  // Upstream::LoadBalancer
+  HostConstSharedPtr chooseHost(const LoadBalancerContext* context) override;
+  void onResponseTime(const HostDescription&, std::chrono::milliseconds) override {}
+
+  static const uint64_t DEFAULT_TABLE_SIZE = 65537;
+
+private:
+  /**
+   * The lookup table. entries_[i] is the index in hosts_ of the host that owns slot i.
+   */
+  struct Table {
+    Table(const std::vector<HostSharedPtr>& hosts, uint64_t table_size);
+
+    /**
+     * @param skip_unhealthy supplies whether to skip hosts that have become unhealthy since the
+     *        table was built, @see LoadBalancerUtility::nextHealthyEntry().
+     */
+    HostConstSharedPtr chooseHost(const LoadBalancerContext* context,
+                                  Runtime::RandomGenerator& random, bool skip_unhealthy,
+                                  ClusterStats& stats) const;
+
+    std::vector<uint32_t> entries_;
+    std::vector<HostConstSharedPtr> hosts_;
+  };
+
+  typedef std::shared_ptr<const Table> TableConstSharedPtr;
+
+public:
+  /**
+   * The tables for one version of a host set. They are immutable, so they can be built once on
+   * the main thread and shared by the load balancers of all workers.
+   */
+  class Tables {
+  public:
+    /**
+     * @param table_size supplies the table size, which must be a prime.
+     */
+    Tables(const HostSet& host_set, uint64_t table_size);
+
+  private:
+    friend class MaglevLoadBalancer;
+
+    TableConstSharedPtr all_hosts_table_;
+    // The same table as all_hosts_table_ when all hosts are healthy.
+    TableConstSharedPtr healthy_hosts_table_;
+  };
+
+  /**
+   * @return uint64_t the smallest prime at or above value.
+   */
+  static uint64_t nextPrime(uint64_t value);
+
+private:
+  void refresh();
+
+  HostSet& host_set_;
+  ClusterStats& stats_;
+  Runtime::Loader& runtime_;
+  Runtime::RandomGenerator& random_;
+  const uint64_t table_size_;
+  PrebuiltTablesCb prebuilt_tables_;
+  TablesConstSharedPtr tables_;
+};
+
+} // namespace Upstream
+} // namespace Envoy
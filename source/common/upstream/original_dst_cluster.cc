@@ -1,8 +1,10 @@
 #include "common/upstream/original_dst_cluster.h"
 
+#include <algorithm>
 #include <chrono>
-#include <list>
+#include <cstring>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "common/network/address_impl.h"
@@ -19,24 +21,9 @@ namespace Upstream {
 // OriginalDstCluster::LoadBalancer is never configured with any other type of cluster,
 // and throws an exception otherwise.
 
-OriginalDstCluster::LoadBalancer::LoadBalancer(HostSet& host_set, ClusterSharedPtr& parent)
-    : host_set_(host_set), parent_(std::static_pointer_cast<OriginalDstCluster>(parent)),
-      info_(parent->info()) {
-  // host_set_ is initially empty.
-  host_set_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>& hosts_added,
-                                     const std::vector<HostSharedPtr>& hosts_removed) -> void {
-    // Update the hosts map
-    for (const HostSharedPtr& host : hosts_removed) {
-      ENVOY_LOG(debug, "Removing host {}.", host->address()->asString());
-      host_map_.remove(host);
-    }
-    for (const HostSharedPtr& host : hosts_added) {
-      if (host_map_.insert(host)) {
-        ENVOY_LOG(debug, "Adding host {}.", host->address()->asString());
-      }
-    }
-  });
-}
+OriginalDstCluster::LoadBalancer::LoadBalancer(ClusterSharedPtr& parent)
+    : parent_(std::static_pointer_cast<OriginalDstCluster>(parent)), info_(parent->info()),
+      host_map_(std::static_pointer_cast<OriginalDstCluster>(parent)->host_map_) {}
 
 HostConstSharedPtr
 OriginalDstCluster::LoadBalancer::chooseHost(const LoadBalancerContext* context) {
@@ -47,37 +34,38 @@ OriginalDstCluster::LoadBalancer::chooseHost(const LoadBalancerContext* context)
     // if usingOriginalDst() returns 'true'.
     if (connection && connection->usingOriginalDst()) {
       const Network::Address::Instance& dst_addr = connection->localAddress();
-
-      // Check if a host with the destination address is already in the host set.
-      HostSharedPtr host = host_map_.find(dst_addr);
-      if (host) {
-        ENVOY_LOG(debug, "Using existing host {}.", host->address()->asString());
-        host->used(true); // Mark as used.
-        return std::move(host);
-      }
-      // Add a new host
       const Network::Address::Ip* dst_ip = dst_addr.ip();
       if (dst_ip) {
+        // Check if a host with the destination address is already in the cluster.
+        const HostMap::Key key = HostMap::key(*dst_ip);
+        HostSharedPtr host = host_map_->find(key);
+        if (host) {
+          ENVOY_LOG(debug, "Using existing host {}.", host->address()->asString());
+          return std::move(host);
+        }
+
+        // Create a host we can use immediately.
         Network::Address::InstanceConstSharedPtr host_ip_port(
             Network::Utility::copyInternetAddressAndPort(*dst_ip));
-        // Create a host we can use immediately.
-        host.reset(new HostImpl(info_, info_->name() + dst_addr.asString(), std::move(host_ip_port),
-                                false, 1, ""));
-
-        ENVOY_LOG(debug, "Created host {}.", host->address()->asString());
-        // Add the new host to the map.  We just failed to find it in
-        // our local map above, so insert without checking (2nd arg == false).
-        host_map_.insert(host, false);
-
-        if (std::shared_ptr<OriginalDstCluster> parent = parent_.lock()) {
-          // lambda cannot capture a member by value.
-          std::weak_ptr<OriginalDstCluster> post_parent = parent_;
-          parent->dispatcher_.post([post_parent, host]() mutable {
-            // The main cluster may have disappeared while this post was queued.
-            if (std::shared_ptr<OriginalDstCluster> parent = post_parent.lock()) {
-              parent->addHost(host);
-            }
-          });
+        HostSharedPtr new_host(new HostImpl(info_, info_->name() + dst_addr.asString(),
+                                            std::move(host_ip_port), false, 1, ""));
+
+        // Another thread may have added a host for the same address since the lookup above, in
+        // which case that host is used and the new one is dropped.
+        host = host_map_->insert(key, new_host);
+        if (host == new_host) {
+          ENVOY_LOG(debug, "Created host {}.", host->address()->asString());
+          std::shared_ptr<OriginalDstCluster> parent = parent_.lock();
+          if (parent && parent->queueHost(host)) {
+            // lambda cannot capture a member by value.
+            std::weak_ptr<OriginalDstCluster> post_parent = parent_;
+            parent->dispatcher_.post([post_parent]() -> void {
+              // The main cluster may have disappeared while this post was queued.
+              if (std::shared_ptr<OriginalDstCluster> parent = post_parent.lock()) {
+                parent->addPendingHosts();
+              }
+            });
+          }
         }
 
         return std::move(host);
@@ -91,6 +79,96 @@ OriginalDstCluster::LoadBalancer::chooseHost(const LoadBalancerContext* context)
   return nullptr;
 }
 
+OriginalDstCluster::HostMap::HostMap() {
+  for (Shard& shard : shards_) {
+    shard.table_ = std::make_shared<const Table>();
+  }
+}
+
+OriginalDstCluster::HostMap::Key
+OriginalDstCluster::HostMap::key(const Network::Address::Ip& ip) {
+  Key key{};
+  if (ip.version() == Network::Address::IpVersion::v4) {
+    const uint32_t address = ip.ipv4()->address();
+    memcpy(key.data(), &address, sizeof(address));
+    key[18] = 4;
+  } else {
+    const std::array<uint8_t, 16> address = ip.ipv6()->address();
+    std::copy(address.begin(), address.end(), key.begin());
+    key[18] = 6;
+  }
+  key[16] = static_cast<uint8_t>(ip.port() >> 8);
+  key[17] = static_cast<uint8_t>(ip.port());
+  return key;
+}
+
+HostSharedPtr OriginalDstCluster::HostMap::find(const Key& key) {
+  TableConstSharedPtr table;
+  {
+    Shard& key_shard = shard(key);
+    std::unique_lock<std::mutex> lock(key_shard.lock_);
+    table = key_shard.table_;
+  }
+
+  auto entry = table->find(key);
+  if (entry == table->end()) {
+    return nullptr;
+  }
+  // Only store the generation when it changes, so that busy hosts do not keep writing to a cache
+  // line that other workers read.
+  const uint64_t generation = generation_.load(std::memory_order_relaxed);
+  if (entry->second->generation_.load(std::memory_order_relaxed) != generation) {
+    entry->second->generation_.store(generation, std::memory_order_relaxed);
+  }
+  return entry->second->host_;
+}
+
+HostSharedPtr OriginalDstCluster::HostMap::insert(const Key& key, const HostSharedPtr& host) {
+  Shard& key_shard = shard(key);
+  std::unique_lock<std::mutex> lock(key_shard.lock_);
+  auto existing = key_shard.table_->find(key);
+  if (existing != key_shard.table_->end()) {
+    existing->second->generation_.store(generation_.load(std::memory_order_relaxed),
+                                        std::memory_order_relaxed);
+    return existing->second->host_;
+  }
+
+  std::shared_ptr<Table> table(new Table(*key_shard.table_));
+  table->emplace(key, std::make_shared<Entry>(host, generation_.load(std::memory_order_relaxed)));
+  key_shard.table_ = std::move(table);
+  return host;
+}
+
+std::vector<HostSharedPtr> OriginalDstCluster::HostMap::removeStale() {
+  const uint64_t generation = generation_.load(std::memory_order_relaxed);
+  std::vector<HostSharedPtr> removed;
+  for (Shard& shard : shards_) {
+    std::unique_lock<std::mutex> lock(shard.lock_);
+    // Most shards have no stale hosts when the cluster is busy, and are not copied.
+    const size_t removed_before = removed.size();
+    for (const auto& entry : *shard.table_) {
+      if (entry.second->generation_.load(std::memory_order_relaxed) != generation) {
+        removed.push_back(entry.second->host_);
+      }
+    }
+    if (removed.size() == removed_before) {
+      continue;
+    }
+
+    std::shared_ptr<Table> table(new Table());
+    table->reserve(shard.table_->size() - (removed.size() - removed_before));
+    for (const auto& entry : *shard.table_) {
+      if (entry.second->generation_.load(std::memory_order_relaxed) == generation) {
+        table->emplace(entry);
+      }
+    }
+    shard.table_ = std::move(table);
+  }
+
+  generation_.store(generation + 1, std::memory_order_relaxed);
+  return removed;
+}
+
 OriginalDstCluster::OriginalDstCluster(const envoy::api::v2::Cluster& config,
                                        Runtime::Loader& runtime, Stats::Store& stats,
                                        Ssl::ContextManager& ssl_context_manager, ClusterManager& cm,
@@ -99,36 +177,52 @@ OriginalDstCluster::OriginalDstCluster(const envoy::api::v2::Cluster& config,
                       added_via_api),
       dispatcher_(dispatcher), cleanup_interval_ms_(std::chrono::milliseconds(
                                    PROTOBUF_GET_MS_OR_DEFAULT(config, cleanup_interval, 5000))),
-      cleanup_timer_(dispatcher.createTimer([this]() -> void { cleanup(); })) {
+      cleanup_timer_(dispatcher.createTimer([this]() -> void { cleanup(); })),
+      host_map_(std::make_shared<HostMap>()) {
 
   cleanup_timer_->enableTimer(cleanup_interval_ms_);
 }
 
-void OriginalDstCluster::addHost(HostSharedPtr& host) {
+bool OriginalDstCluster::queueHost(const HostSharedPtr& host) {
+  std::unique_lock<std::mutex> lock(pending_hosts_lock_);
+  pending_hosts_.push_back(host);
+  return pending_hosts_.size() == 1;
+}
+
+void OriginalDstCluster::addPendingHosts() {
+  std::vector<HostSharedPtr> hosts_added;
+  {
+    std::unique_lock<std::mutex> lock(pending_hosts_lock_);
+    hosts_added.swap(pending_hosts_);
+  }
+  if (hosts_added.empty()) {
+    return;
+  }
+
+  ENVOY_LOG(debug, "Adding {} original dst hosts.", hosts_added.size());
   HostVectorSharedPtr new_hosts(new std::vector<HostSharedPtr>(hosts()));
-  new_hosts->emplace_back(host);
+  new_hosts->insert(new_hosts->end(), hosts_added.begin(), hosts_added.end());
   updateHosts(new_hosts, createHealthyHostList(*new_hosts), empty_host_lists_, empty_host_lists_,
-              {std::move(host)}, {});
+              hosts_added, {});
 }
 
 void OriginalDstCluster::cleanup() {
-  HostVectorSharedPtr new_hosts(new std::vector<HostSharedPtr>);
-  std::vector<HostSharedPtr> to_be_removed;
-  const auto& host_set = hosts();
+  // Hosts that are still pending are in host_map_, so they must be in the host set before stale
+  // hosts are removed from both.
+  addPendingHosts();
 
   ENVOY_LOG(debug, "Cleaning up stale original dst hosts.");
-  for (const HostSharedPtr& host : host_set) {
-    if (host->used()) {
-      ENVOY_LOG(debug, "Keeping active host {}.", host->address()->asString());
-      new_hosts->emplace_back(host);
-      host->used(false); // Mark to be removed during the next round.
-    } else {
-      ENVOY_LOG(debug, "Removing stale host {}.", host->address()->asString());
-      to_be_removed.emplace_back(host);
+  const std::vector<HostSharedPtr> to_be_removed = host_map_->removeStale();
+  if (!to_be_removed.empty()) {
+    ENVOY_LOG(debug, "Removing {} stale original dst hosts.", to_be_removed.size());
+    const std::unordered_set<HostSharedPtr> removed(to_be_removed.begin(), to_be_removed.end());
+    HostVectorSharedPtr new_hosts(new std::vector<HostSharedPtr>());
+    new_hosts->reserve(hosts().size() - to_be_removed.size());
+    for (const HostSharedPtr& host : hosts()) {
+      if (removed.count(host) == 0) {
+        new_hosts->push_back(host);
+      }
     }
-  }
-
-  if (to_be_removed.size() > 0) {
     updateHosts(new_hosts, createHealthyHostList(*new_hosts), empty_host_lists_, empty_host_lists_,
                 {}, to_be_removed);
   }
@@ -1,13 +1,20 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "envoy/thread_local/thread_local.h"
 
 #include "common/common/empty_string.h"
+#include "common/common/hash.h"
 #include "common/common/logger.h"
 #include "common/upstream/upstream_impl.h"
 
@@ -31,81 +38,124 @@ public:
   InitializePhase initializePhase() const override { return InitializePhase::Primary; }
   void setInitializedCb(std::function<void()> callback) override { callback(); }
 
+  /**
+   * Hosts of the cluster keyed by their binary destination address, shared by the main thread and
+   * all workers. The map is split into shards, each of which holds an immutable table that is
+   * replaced as a whole when hosts are added or removed, so a lookup only holds the lock of its
+   * shard for as long as it takes to copy a shared pointer, and never builds an address string.
+   * Each entry records the cleanup generation it was last used in, so that removeStale() can drop
+   * all hosts that have not been used since the previous cleanup in one pass over the shards.
+   */
+  class HostMap {
+  public:
+    // 16 address bytes (an IPv4 address only uses the first 4), 2 port bytes and the IP version.
+    typedef std::array<uint8_t, 19> Key;
+
+    HostMap();
+
+    /**
+     * @param ip supplies the address to build the key of.
+     * @return Key the key of the address.
+     */
+    static Key key(const Network::Address::Ip& ip);
+
+    /**
+     * Look up a host and mark it as used in the current generation.
+     * @param key supplies the key of the host address.
+     * @return HostSharedPtr the host, or nullptr if there is none.
+     */
+    HostSharedPtr find(const Key& key);
+
+    /**
+     * Add a host unless another thread has added one for the same key first.
+     * @param key supplies the key of the host address.
+     * @param host supplies the host to add.
+     * @return HostSharedPtr the host that is in the map, which is host if it was added.
+     */
+    HostSharedPtr insert(const Key& key, const HostSharedPtr& host);
+
+    /**
+     * Remove all hosts that have not been used in the current generation, and start a new one.
+     * Must only be called on the main thread.
+     * @return std::vector<HostSharedPtr> the removed hosts.
+     */
+    std::vector<HostSharedPtr> removeStale();
+
+  private:
+    struct Entry {
+      Entry(const HostSharedPtr& host, uint64_t generation)
+          : host_(host), generation_(generation) {}
+
+      const HostSharedPtr host_;
+      std::atomic<uint64_t> generation_;
+    };
+
+    struct KeyHash {
+      size_t operator()(const Key& key) const { return HashUtil::xxHash64(key.data(), key.size()); }
+    };
+
+    // Entries are shared between the successive tables of a shard, so that a host that is marked as
+    // used in one table stays marked in the next.
+    typedef std::unordered_map<Key, std::shared_ptr<Entry>, KeyHash> Table;
+    typedef std::shared_ptr<const Table> TableConstSharedPtr;
+
+    struct Shard {
+      std::mutex lock_;
+      TableConstSharedPtr table_;
+    };
+
+    static const size_t NumShards = 64;
+
+    Shard& shard(const Key& key) { return shards_[KeyHash()(key) % NumShards]; }
+
+    std::array<Shard, NumShards> shards_;
+    std::atomic<uint64_t> generation_{};
+  };
+
+  typedef std::shared_ptr<HostMap> HostMapSharedPtr;
+
   /**
    * Special Load Balancer for Original Dst Cluster.
    *
    * Load balancer gets called with the downstream context which can be used to make sure the
    * Original Dst cluster has a Host for the original destination.  Normally load balancers can't
    * modify clusters, but in this case we access a singleton OriginalDstCluster that we can ask to
-   * add hosts on demand.  Additions are synced with all other threads so that the host set in the
-   * cluster remains (eventually) consistent.  If multiple threads add a host to the same upstream
-   * address then two distinct HostSharedPtr's (with the same upstream IP address) will be added,
-   * and both of them will eventually time out.
+   * add hosts on demand.  All load balancers of the cluster look hosts up in the HostMap of the
+   * cluster, so a host that is created on one thread is used by all others right away, and only
+   * the hosts that are new to the whole cluster are posted to the main thread, in batches.
    */
   class LoadBalancer : public Upstream::LoadBalancer {
   public:
-    LoadBalancer(HostSet& host_set, ClusterSharedPtr& parent);
+    LoadBalancer(ClusterSharedPtr& parent);
 
     // Upstream::LoadBalancer
     HostConstSharedPtr chooseHost(const LoadBalancerContext* context) override;
+    void onResponseTime(const HostDescription&, std::chrono::milliseconds) override {}
 
   private:
-    /**
-     * Map from an host IP address/port to a HostSharedPtr.  Due to races multiple distinct host
-     * objects with the same address can be created, so we need to use a multimap.
-     */
-    class HostMap {
-    public:
-      bool insert(const HostSharedPtr& host, bool check = true) {
-        if (check) {
-          auto range = map_.equal_range(host->address()->asString());
-          auto it = std::find_if(
-              range.first, range.second,
-              [&host](const decltype(map_)::value_type pair) { return pair.second == host; });
-          if (it != range.second) {
-            return false; // 'host' already in the map, no need to insert.
-          }
-        }
-        map_.emplace(host->address()->asString(), host);
-        return true;
-      }
-
-      void remove(const HostSharedPtr& host) {
-        auto range = map_.equal_range(host->address()->asString());
-        auto it =
-            std::find_if(range.first, range.second, [&host](const decltype(map_)::value_type pair) {
-              return pair.second == host;
-            });
-        ASSERT(it != range.second);
-        map_.erase(it);
-      }
-
-      HostSharedPtr find(const Network::Address::Instance& address) {
-        auto it = map_.find(address.asString());
-
-        if (it != map_.end()) {
-          return it->second;
-        }
-        return nullptr;
-      }
-
-    private:
-      std::unordered_multimap<std::string, HostSharedPtr> map_;
-    };
-
-    HostSet& host_set_;                        // Thread local host set.
     std::weak_ptr<OriginalDstCluster> parent_; // Primary cluster managed by the main thread.
     ClusterInfoConstSharedPtr info_;
-    HostMap host_map_;
+    const HostMapSharedPtr host_map_;
   };
 
 private:
-  void addHost(HostSharedPtr&);
+  /**
+   * Queue a host that a worker has added to host_map_ to be added to the cluster.
+   * @param host supplies the new host.
+   * @return bool true if the host is the first of a batch, and the caller must post
+   *         addPendingHosts() to the main thread.
+   */
+  bool queueHost(const HostSharedPtr& host);
+  void addPendingHosts();
   void cleanup();
 
   Event::Dispatcher& dispatcher_;
   const std::chrono::milliseconds cleanup_interval_ms_;
   Event::TimerPtr cleanup_timer_;
+  const HostMapSharedPtr host_map_;
+  // Hosts that workers have added to host_map_ but that are not in the host set of the cluster yet.
+  std::mutex pending_hosts_lock_;
+  std::vector<HostSharedPtr> pending_hosts_;
 };
 
 } // namespace Upstream
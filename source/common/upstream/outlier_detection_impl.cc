@@ -12,6 +12,7 @@
 #include "common/common/utility.h"
 #include "common/http/codes.h"
 #include "common/protobuf/utility.h"
+#include "common/runtime/key_registry.h"
 
 #include "spdlog/spdlog.h"
 
@@ -46,23 +47,34 @@ void DetectorHostMonitorImpl::updateCurrentSuccessRateBucket() {
 }
 
 void DetectorHostMonitorImpl::putHttpResponseCode(uint64_t response_code) {
-  success_rate_accumulator_bucket_.load()->total_request_counter_++;
-  if (Http::CodeUtility::is5xx(response_code)) {
-    std::shared_ptr<DetectorImpl> detector = detector_.lock();
-    if (!detector) {
-      // It's possible for the cluster/detector to go away while we still have a host in use.
-      return;
-    }
+  const bool is_5xx = Http::CodeUtility::is5xx(response_code);
+  success_rate_accumulator_bucket_.load()->putRequest(!is_5xx);
+  if (!is_5xx) {
+    consecutive_5xx_ = 0;
+    return;
+  }
 
-    if (++consecutive_5xx_ ==
-        detector->runtime().snapshot().getInteger("outlier_detection.consecutive_5xx",
-                                                  detector->config().consecutive5xx())) {
-      detector->onConsecutive5xx(host_.lock());
-    }
-  } else {
-    success_rate_accumulator_bucket_.load()->success_request_counter_++;
+  // Only the response that reaches the threshold goes to the main thread, so the detector is only
+  // locked then.
+  if (++consecutive_5xx_ != consecutive_5xx_threshold_) {
+    return;
+  }
+
+  HostSharedPtr host = host_.lock();
+  if (host && host->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK)) {
+    // The host is already ejected so there is nothing for the main thread to do. Start counting
+    // again so that the host can be ejected for a new bout of 5xx after it is brought back.
     consecutive_5xx_ = 0;
+    return;
   }
+
+  std::shared_ptr<DetectorImpl> detector = detector_.lock();
+  if (!detector) {
+    // It's possible for the cluster/detector to go away while we still have a host in use.
+    return;
+  }
+
+  detector->onConsecutive5xx(host);
 }
 
 DetectorConfig::DetectorConfig(const envoy::api::v2::Cluster::OutlierDetection& config)
@@ -142,6 +154,7 @@ void DetectorImpl::initialize(const Cluster& cluster) {
 void DetectorImpl::addHostMonitor(HostSharedPtr host) {
   ASSERT(host_monitors_.count(host) == 0);
   DetectorHostMonitorImpl* monitor = new DetectorHostMonitorImpl(shared_from_this(), host);
+  monitor->consecutive5xxThreshold(consecutive5xxThreshold());
   host_monitors_[host] = monitor;
   host->setOutlierDetector(DetectorHostMonitorPtr{monitor});
 }
@@ -173,13 +186,23 @@ void DetectorImpl::checkHostForUneject(HostSharedPtr host, DetectorHostMonitorIm
   }
 }
 
+uint64_t DetectorImpl::consecutive5xxThreshold() {
+  static const Runtime::Key consecutive_5xx_key =
+      Runtime::KeyRegistry::key("outlier_detection.consecutive_5xx");
+  return runtime_.snapshot().getInteger(consecutive_5xx_key, config_.consecutive5xx());
+}
+
 bool DetectorImpl::enforceEjection(EjectionType type) {
+  static const Runtime::Key enforcing_consecutive_5xx_key =
+      Runtime::KeyRegistry::key("outlier_detection.enforcing_consecutive_5xx");
+  static const Runtime::Key enforcing_success_rate_key =
+      Runtime::KeyRegistry::key("outlier_detection.enforcing_success_rate");
   switch (type) {
   case EjectionType::Consecutive5xx:
-    return runtime_.snapshot().featureEnabled("outlier_detection.enforcing_consecutive_5xx",
+    return runtime_.snapshot().featureEnabled(enforcing_consecutive_5xx_key,
                                               config_.enforcingConsecutive5xx());
   case EjectionType::SuccessRate:
-    return runtime_.snapshot().featureEnabled("outlier_detection.enforcing_success_rate",
+    return runtime_.snapshot().featureEnabled(enforcing_success_rate_key,
                                               config_.enforcingSuccessRate());
   }
 
@@ -187,9 +210,10 @@ bool DetectorImpl::enforceEjection(EjectionType type) {
 }
 
 void DetectorImpl::ejectHost(HostSharedPtr host, EjectionType type) {
+  static const Runtime::Key max_ejection_percent_key =
+      Runtime::KeyRegistry::key("outlier_detection.max_ejection_percent");
   uint64_t max_ejection_percent = std::min<uint64_t>(
-      100, runtime_.snapshot().getInteger("outlier_detection.max_ejection_percent",
-                                          config_.maxEjectionPercent()));
+      100, runtime_.snapshot().getInteger(max_ejection_percent_key, config_.maxEjectionPercent()));
   double ejected_percent = 100.0 * stats_.ejections_active_.value() / host_monitors_.size();
   if (ejected_percent < max_ejection_percent) {
     stats_.ejections_total_.inc();
@@ -343,9 +367,11 @@ void DetectorImpl::processSuccessRateEjections() {
 
 void DetectorImpl::onIntervalTimer() {
   MonotonicTime now = time_source_.currentTime();
+  const uint64_t consecutive_5xx_threshold = consecutive5xxThreshold();
 
   for (auto host : host_monitors_) {
     checkHostForUneject(host.first, host.second, now);
+    host.second->consecutive5xxThreshold(consecutive_5xx_threshold);
 
     // Need to update the writer bucket to keep the data valid.
     host.second->updateCurrentSuccessRateBucket();
@@ -458,10 +484,48 @@ int EventLoggerImpl::secsSinceLastAction(const Optional<MonotonicTime>& lastActi
   return -1;
 }
 
+void SuccessRateAccumulatorBucket::putRequest(bool success) {
+  Shard& shard = shards_[threadShard()];
+  shard.total_request_counter_.fetch_add(1, std::memory_order_relaxed);
+  if (success) {
+    shard.success_request_counter_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void SuccessRateAccumulatorBucket::reset() {
+  for (Shard& shard : shards_) {
+    shard.success_request_counter_ = 0;
+    shard.total_request_counter_ = 0;
+  }
+}
+
+uint64_t SuccessRateAccumulatorBucket::successRequests() const {
+  uint64_t total = 0;
+  for (const Shard& shard : shards_) {
+    total += shard.success_request_counter_.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+uint64_t SuccessRateAccumulatorBucket::totalRequests() const {
+  uint64_t total = 0;
+  for (const Shard& shard : shards_) {
+    total += shard.total_request_counter_.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+size_t SuccessRateAccumulatorBucket::threadShard() {
+  // Threads are assigned shards round robin the first time they record a request, so up to
+  // NUM_SHARDS workers never share a shard.
+  static std::atomic<size_t> next_shard{0};
+  static thread_local const size_t shard = next_shard++ % NUM_SHARDS;
+  return shard;
+}
+
 SuccessRateAccumulatorBucket* SuccessRateAccumulator::updateCurrentWriter() {
   // Right now current is being written to and backup is not. Flush the backup and swap.
-  backup_success_rate_bucket_->success_request_counter_ = 0;
-  backup_success_rate_bucket_->total_request_counter_ = 0;
+  backup_success_rate_bucket_->reset();
 
   current_success_rate_bucket_.swap(backup_success_rate_bucket_);
 
@@ -469,12 +533,12 @@ SuccessRateAccumulatorBucket* SuccessRateAccumulator::updateCurrentWriter() {
 }
 
 Optional<double> SuccessRateAccumulator::getSuccessRate(uint64_t success_rate_request_volume) {
-  if (backup_success_rate_bucket_->total_request_counter_ < success_rate_request_volume) {
+  const uint64_t total_requests = backup_success_rate_bucket_->totalRequests();
+  if (total_requests < success_rate_request_volume) {
     return Optional<double>();
   }
 
-  return Optional<double>(backup_success_rate_bucket_->success_request_counter_ * 100.0 /
-                          backup_success_rate_bucket_->total_request_counter_);
+  return Optional<double>(backup_success_rate_bucket_->successRequests() * 100.0 / total_requests);
 }
 
 } // namespace Outlier
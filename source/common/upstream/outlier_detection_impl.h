@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
@@ -59,9 +60,41 @@ struct HostSuccessRatePair {
   double success_rate_;
 };
 
-struct SuccessRateAccumulatorBucket {
-  std::atomic<uint64_t> success_request_counter_;
-  std::atomic<uint64_t> total_request_counter_;
+/**
+ * Request counters for one success rate window. Every worker records every response to a host, so
+ * the counters are sharded by thread and each shard is padded to its own cache line. This keeps
+ * workers from contending on the same cache line. The shards are only summed on the main thread
+ * when the window ends.
+ */
+class SuccessRateAccumulatorBucket {
+public:
+  /**
+   * Record a request. Called on any thread.
+   * @param success supplies whether the request succeeded.
+   */
+  void putRequest(bool success);
+
+  /**
+   * Zero all of the counters. Called on the main thread once the bucket is no longer written to.
+   */
+  void reset();
+
+  uint64_t successRequests() const;
+  uint64_t totalRequests() const;
+
+private:
+  static constexpr size_t NUM_SHARDS = 8;
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  struct Shard {
+    std::atomic<uint64_t> success_request_counter_{};
+    std::atomic<uint64_t> total_request_counter_{};
+    char padding_[CACHE_LINE_SIZE - 2 * sizeof(std::atomic<uint64_t>)];
+  };
+
+  static size_t threadShard();
+
+  std::array<Shard, NUM_SHARDS> shards_;
 };
 
 /**
@@ -115,6 +148,7 @@ public:
   SuccessRateAccumulator& successRateAccumulator() { return success_rate_accumulator_; }
   void successRate(double new_success_rate) { success_rate_ = new_success_rate; }
   void resetConsecutive5xx() { consecutive_5xx_ = 0; }
+  void consecutive5xxThreshold(uint64_t threshold) { consecutive_5xx_threshold_ = threshold; }
 
   // Upstream::Outlier::DetectorHostMonitor
   uint32_t numEjections() override { return num_ejections_; }
@@ -128,6 +162,9 @@ private:
   std::weak_ptr<DetectorImpl> detector_;
   std::weak_ptr<Host> host_;
   std::atomic<uint32_t> consecutive_5xx_{0};
+  // Refreshed from runtime by the detector on the main thread so that workers don't need to lock
+  // the detector or read runtime for every 5xx.
+  std::atomic<uint64_t> consecutive_5xx_threshold_{0};
   Optional<MonotonicTime> last_ejection_time_;
   Optional<MonotonicTime> last_unejection_time_;
   uint32_t num_ejections_{};
@@ -214,6 +251,7 @@ private:
   void addHostMonitor(HostSharedPtr host);
   void armIntervalTimer();
   void checkHostForUneject(HostSharedPtr host, DetectorHostMonitorImpl* monitor, MonotonicTime now);
+  uint64_t consecutive5xxThreshold();
   void ejectHost(HostSharedPtr host, EjectionType type);
   static DetectionStats generateStats(Stats::Scope& scope);
   void initialize(const Cluster& cluster);
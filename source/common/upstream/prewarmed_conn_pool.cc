@@ -0,0 +1,131 @@
+#include "common/upstream/prewarmed_conn_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "common/common/assert.h"
+
+namespace Envoy {
+namespace Upstream {
+
+const uint64_t PrewarmedConnPool::REFILL_DELAY_MS;
+
+PrewarmedConnPool::PrewarmedConnPool(Event::Dispatcher& dispatcher,
+                                     ClusterInfoConstSharedPtr cluster, LoadBalancer& lb)
+    : dispatcher_(dispatcher), cluster_(cluster), lb_(lb),
+      refill_timer_(dispatcher.createTimer([this]() -> void {
+        refill_scheduled_ = false;
+        refill();
+      })) {}
+
+PrewarmedConnPool::~PrewarmedConnPool() {
+  while (!connections_.empty()) {
+    connections_.front()->connection_->close(Network::ConnectionCloseType::NoFlush);
+  }
+}
+
+Host::CreateConnectionData PrewarmedConnPool::claim() {
+  Host::CreateConnectionData data{nullptr, nullptr};
+  for (const IdleConnectionPtr& connection : connections_) {
+    if (!connection->connected_) {
+      continue;
+    }
+
+    connection->connection_->removeConnectionCallbacks(*connection);
+    connection->connection_->readDisable(false);
+    data.connection_ = std::move(connection->connection_);
+    data.host_description_ = connection->host_;
+    dispatcher_.deferredDelete(connection->removeFromList(connections_));
+    cluster_->stats().upstream_cx_prewarmed_claimed_.inc();
+    break;
+  }
+
+  // Replace the claimed connection, or follow a changed configuration, off the accept path.
+  if (connections_.size() != cluster_->prewarmedTcpConnections() && !refill_scheduled_) {
+    refill_scheduled_ = true;
+    refill_timer_->enableTimer(std::chrono::milliseconds(0));
+  }
+
+  return data;
+}
+
+void PrewarmedConnPool::refill() {
+  const uint32_t target = cluster_->prewarmedTcpConnections();
+  while (connections_.size() > target) {
+    connections_.back()->connection_->close(Network::ConnectionCloseType::NoFlush);
+  }
+
+  while (connections_.size() < target) {
+    HostConstSharedPtr host = lb_.chooseHost(nullptr);
+    if (!host) {
+      return;
+    }
+
+    Host::CreateConnectionData data = host->createConnection(dispatcher_);
+    if (!data.connection_) {
+      return;
+    }
+
+    ENVOY_LOG(debug, "prewarming a connection to cluster {}", cluster_->name());
+    IdleConnectionPtr connection(new IdleConnection(*this, host, std::move(data)));
+    connection->moveIntoList(std::move(connection), connections_);
+  }
+}
+
+void PrewarmedConnPool::removeHosts(const std::vector<HostSharedPtr>& hosts) {
+  std::vector<IdleConnection*> to_close;
+  for (const IdleConnectionPtr& connection : connections_) {
+    if (std::find(hosts.begin(), hosts.end(), connection->logical_host_) != hosts.end()) {
+      to_close.push_back(connection.get());
+    }
+  }
+
+  for (IdleConnection* connection : to_close) {
+    connection->connection_->close(Network::ConnectionCloseType::NoFlush);
+  }
+}
+
+void PrewarmedConnPool::onConnectionClosed(IdleConnection& connection) {
+  ENVOY_CONN_LOG(debug, "prewarmed connection closed", *connection.connection_);
+  const bool connected = connection.connected_;
+  dispatcher_.deferredDelete(connection.removeFromList(connections_));
+
+  // Back off from hosts that fail to connect, rather than retrying them in a loop.
+  if (!refill_scheduled_) {
+    refill_scheduled_ = true;
+    refill_timer_->enableTimer(std::chrono::milliseconds(connected ? 0 : REFILL_DELAY_MS));
+  }
+}
+
+PrewarmedConnPool::IdleConnection::IdleConnection(PrewarmedConnPool& parent,
+                                                  HostConstSharedPtr logical_host,
+                                                  Host::CreateConnectionData&& data)
+    : parent_(parent), logical_host_(logical_host), connection_(std::move(data.connection_)),
+      host_(data.host_description_),
+      connect_timer_(parent.dispatcher_.createTimer([this]() -> void {
+        connection_->close(Network::ConnectionCloseType::NoFlush);
+      })) {
+  connection_->addConnectionCallbacks(*this);
+  connection_->connect();
+  connection_->noDelay(true);
+  connect_timer_->enableTimer(parent.cluster_->connectTimeout());
+}
+
+void PrewarmedConnPool::IdleConnection::onEvent(Network::ConnectionEvent event) {
+  connect_timer_->disableTimer();
+  if (event == Network::ConnectionEvent::Connected) {
+    // Leave anything the upstream sends first in the socket for whoever claims the connection.
+    // Closes are still detected while reads are disabled. TLS connections only raise Connected
+    // after the handshake, which needs reads.
+    connected_ = true;
+    connection_->readDisable(true);
+    return;
+  }
+
+  parent_.onConnectionClosed(*this);
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "envoy/event/deferred_deletable.h"
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/network/connection.h"
+#include "envoy/upstream/load_balancer.h"
+#include "envoy/upstream/upstream.h"
+
+#include "common/common/linked_object.h"
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * Pool of idle TCP connections to a cluster, established ahead of time on one worker so that a TCP
+ * proxy can claim a connected one instead of waiting for the connect. The pool holds
+ * ClusterInfo::prewarmedTcpConnections() connections, which are opened to hosts picked by the
+ * cluster's load balancer and replaced as they are claimed or closed.
+ */
+class PrewarmedConnPool : Logger::Loggable<Logger::Id::upstream> {
+public:
+  PrewarmedConnPool(Event::Dispatcher& dispatcher, ClusterInfoConstSharedPtr cluster,
+                    LoadBalancer& lb);
+  ~PrewarmedConnPool();
+
+  /**
+   * Claim a connected idle connection. Reads, which are disabled while the connection is idle,
+   * are enabled again.
+   * @return Host::CreateConnectionData the connection and its host, or nullptr for both if no
+   *         connection is ready.
+   */
+  Host::CreateConnectionData claim();
+
+  /**
+   * Open connections until the pool holds as many as configured.
+   */
+  void refill();
+
+  /**
+   * Close the idle connections to hosts that left the cluster.
+   * @param hosts supplies the removed hosts.
+   */
+  void removeHosts(const std::vector<HostSharedPtr>& hosts);
+
+  // Delay before replacing connections that failed to connect.
+  static const uint64_t REFILL_DELAY_MS = 1000;
+
+private:
+  struct IdleConnection : LinkedObject<IdleConnection>,
+                          public Network::ConnectionCallbacks,
+                          public Event::DeferredDeletable {
+    IdleConnection(PrewarmedConnPool& parent, HostConstSharedPtr logical_host,
+                   Host::CreateConnectionData&& data);
+
+    // Network::ConnectionCallbacks
+    void onEvent(Network::ConnectionEvent event) override;
+    void onAboveWriteBufferHighWatermark() override {}
+    void onBelowWriteBufferLowWatermark() override {}
+
+    PrewarmedConnPool& parent_;
+    // The host the load balancer picked, which host_ may be a resolved address of.
+    HostConstSharedPtr logical_host_;
+    Network::ClientConnectionPtr connection_;
+    HostDescriptionConstSharedPtr host_;
+    Event::TimerPtr connect_timer_;
+    bool connected_{};
+  };
+
+  typedef std::unique_ptr<IdleConnection> IdleConnectionPtr;
+
+  void onConnectionClosed(IdleConnection& connection);
+
+  Event::Dispatcher& dispatcher_;
+  ClusterInfoConstSharedPtr cluster_;
+  LoadBalancer& lb_;
+  std::list<IdleConnectionPtr> connections_;
+  Event::TimerPtr refill_timer_;
+  bool refill_scheduled_{};
+};
+
+typedef std::unique_ptr<PrewarmedConnPool> PrewarmedConnPoolPtr;
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,110 @@
+#include "common/upstream/resource_manager_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace Envoy {
+namespace Upstream {
+
+const std::chrono::milliseconds ResourceManagerImpl::ADAPTIVE_WINDOW{1000};
+const double ResourceManagerImpl::ADAPTIVE_MIN_GRADIENT = 0.5;
+const double ResourceManagerImpl::ADAPTIVE_SMOOTHING = 0.2;
+std::atomic<uint32_t> ResourceManagerImpl::overload_limit_percent_{100};
+
+ResourceManagerImpl::RequestResourceImpl::RequestResourceImpl(uint64_t max,
+                                                              Runtime::Loader& runtime,
+                                                              const std::string& runtime_key,
+                                                              AdaptiveConcurrencyStats* stats,
+                                                              MonotonicTimeSource& time_source)
+    : ResourceImpl(max, runtime, runtime_key + "max_requests"), stats_(stats),
+      time_source_(time_source), adaptive_key_(runtime_key + "adaptive_concurrency"),
+      window_start_(time_source.currentTime().time_since_epoch().count()), limit_(max),
+      limit_estimate_(max) {
+  if (stats_) {
+    stats_->limit_.set(max);
+  }
+}
+
+bool ResourceManagerImpl::RequestResourceImpl::canCreate() {
+  if (!adaptive()) {
+    return ResourceImpl::canCreate();
+  }
+
+  const uint64_t max_requests = ResourceImpl::max();
+  if (current_ >= max_requests) {
+    return false;
+  }
+  if (current_ >= std::min(limit_.load(), max_requests)) {
+    stats_->rq_rejected_.inc();
+    return false;
+  }
+  return true;
+}
+
+uint64_t ResourceManagerImpl::RequestResourceImpl::max() {
+  const uint64_t max_requests = ResourceImpl::max();
+  return adaptive() ? std::min(limit_.load(), max_requests) : max_requests;
+}
+
+void ResourceManagerImpl::RequestResourceImpl::onResponseTime(
+    std::chrono::microseconds response_time) {
+  if (!adaptive()) {
+    return;
+  }
+
+  window_time_us_ += response_time.count();
+  if (++window_requests_ < ADAPTIVE_WINDOW_MIN_REQUESTS) {
+    return;
+  }
+
+  const MonotonicTime now = time_source_.currentTime();
+  if (now - MonotonicTime(MonotonicTime::duration(window_start_.load())) < ADAPTIVE_WINDOW) {
+    return;
+  }
+
+  // Only one thread closes a window. The others keep adding to the next one.
+  std::unique_lock<std::mutex> lock(update_lock_, std::try_to_lock);
+  if (lock.owns_lock()) {
+    updateLimit(now);
+  }
+}
+
+void ResourceManagerImpl::RequestResourceImpl::updateLimit(MonotonicTime now) {
+  // Another thread may have closed the window since it was checked.
+  if (now - MonotonicTime(MonotonicTime::duration(window_start_.load())) < ADAPTIVE_WINDOW) {
+    return;
+  }
+
+  // Responses recorded between the two exchanges land in the next window, which is harmless.
+  const uint64_t requests = window_requests_.exchange(0);
+  const uint64_t time_us = window_time_us_.exchange(0);
+  window_start_ = now.time_since_epoch().count();
+  if (requests == 0) {
+    return;
+  }
+
+  const double rtt_us = std::max(1.0, static_cast<double>(time_us) / requests);
+  if (min_rtt_us_ == 0 || rtt_us < min_rtt_us_ ||
+      ++windows_since_min_rtt_ >= ADAPTIVE_MIN_RTT_WINDOWS) {
+    min_rtt_us_ = rtt_us;
+    windows_since_min_rtt_ = 0;
+  }
+
+  const double max_requests = ResourceImpl::max();
+  const double gradient = std::max(ADAPTIVE_MIN_GRADIENT, std::min(1.0, min_rtt_us_ / rtt_us));
+  const double target = limit_estimate_ * gradient + std::sqrt(limit_estimate_);
+  limit_estimate_ = limit_estimate_ * (1 - ADAPTIVE_SMOOTHING) + target * ADAPTIVE_SMOOTHING;
+  limit_estimate_ = std::max(static_cast<double>(ADAPTIVE_MIN_LIMIT),
+                             std::min(limit_estimate_, max_requests));
+
+  limit_ = static_cast<uint64_t>(limit_estimate_);
+  stats_->limit_.set(limit_);
+  stats_->min_rtt_us_.set(static_cast<uint64_t>(min_rtt_us_));
+}
+
+} // namespace Upstream
+} // namespace Envoy
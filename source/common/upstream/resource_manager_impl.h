@@ -1,18 +1,42 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 
+#include "envoy/common/time.h"
 #include "envoy/runtime/runtime.h"
+#include "envoy/stats/stats_macros.h"
 #include "envoy/upstream/resource_manager.h"
+#include "envoy/upstream/upstream.h"
 
 #include "common/common/assert.h"
+#include "common/common/utility.h"
 
 namespace Envoy {
 namespace Upstream {
 
+/**
+ * All adaptive concurrency stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_ADAPTIVE_CONCURRENCY_STATS(COUNTER, GAUGE)                                             \
+  COUNTER(rq_rejected)                                                                             \
+  GAUGE  (limit)                                                                                   \
+  GAUGE  (min_rtt_us)
+// clang-format on
+
+/**
+ * Struct definition for all adaptive concurrency stats. @see stats_macros.h
+ */
+struct AdaptiveConcurrencyStats {
+  ALL_ADAPTIVE_CONCURRENCY_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
 /**
  * Implementation of ResourceManager.
  * NOTE: This implementation makes some assumptions which favor simplicity over correctness.
@@ -21,24 +45,57 @@ namespace Upstream {
  *    occur during high contention.
  * 2) Though atomics are used, it is possible for resources to temporarily go above the supplied
  *    maximums. This should not effect overall behavior.
+ * 3) The retry budget of each priority is computed from the requests of all priorities, since
+ *    the cluster stats are not kept per priority.
+ * 4) An adaptive requests limit is shared by all the worker threads. Their response times are
+ *    summed into one window, so the limit follows the latency of the whole cluster.
  */
 class ResourceManagerImpl : public ResourceManager {
 public:
+  /**
+   * @param stats supplies the stats of the cluster, which the retry budget is computed from, or
+   *        nullptr if there is no retry budget.
+   * @param adaptive_stats supplies the stats of the adaptive requests limit, or nullptr if the
+   *        requests limit cannot be adaptive. They must outlive the resource manager.
+   * @param time_source supplies the time source the adaptive limit windows are timed with.
+   */
   ResourceManagerImpl(Runtime::Loader& runtime, const std::string& runtime_key,
                       uint64_t max_connections, uint64_t max_pending_requests,
-                      uint64_t max_requests, uint64_t max_retries)
+                      uint64_t max_requests, uint64_t max_retries, ClusterStats* stats = nullptr,
+                      AdaptiveConcurrencyStats* adaptive_stats = nullptr,
+                      MonotonicTimeSource& time_source = ProdMonotonicTimeSource::instance_)
       : connections_(max_connections, runtime, runtime_key + "max_connections"),
         pending_requests_(max_pending_requests, runtime, runtime_key + "max_pending_requests"),
-        requests_(max_requests, runtime, runtime_key + "max_requests"),
-        retries_(max_retries, runtime, runtime_key + "max_retries") {}
+        requests_(max_requests, runtime, runtime_key, adaptive_stats, time_source),
+        retries_(max_retries, runtime, runtime_key, stats),
+        hedges_(DEFAULT_MAX_HEDGES, runtime, runtime_key + "max_hedges"),
+        shadows_(DEFAULT_MAX_SHADOWS, runtime, runtime_key + "max_shadows") {}
 
   // Upstream::ResourceManager
   Resource& connections() override { return connections_; }
   Resource& pendingRequests() override { return pending_requests_; }
   Resource& requests() override { return requests_; }
   Resource& retries() override { return retries_; }
+  Resource& hedges() override { return hedges_; }
+  Resource& shadows() override { return shadows_; }
+  void onResponseTime(std::chrono::microseconds response_time) override {
+    requests_.onResponseTime(response_time);
+  }
+
+  /**
+   * Scale the limits of all resource managers in the process, for the overload manager to shed
+   * upstream load with while the workers fall behind. Limits never drop below 1.
+   * @param percent supplies the percentage of the configured limits to apply. 100 applies the
+   *        configured limits.
+   */
+  static void setOverloadLimitPercent(uint32_t percent) { overload_limit_percent_ = percent; }
 
 private:
+  static uint64_t scaleLimit(uint64_t max) {
+    const uint32_t percent = overload_limit_percent_.load(std::memory_order_relaxed);
+    return percent >= 100 ? max : std::max<uint64_t>(1, max * percent / 100);
+  }
+
   struct ResourceImpl : public Resource {
     ResourceImpl(uint64_t max, Runtime::Loader& runtime, const std::string& runtime_key)
         : max_(max), runtime_(runtime), runtime_key_(runtime_key) {}
@@ -51,7 +108,9 @@ private:
       ASSERT(current_ > 0);
       current_--;
     }
-    uint64_t max() override { return runtime_.snapshot().getInteger(runtime_key_, max_); }
+    uint64_t max() override {
+      return scaleLimit(runtime_.snapshot().getInteger(runtime_key_, max_));
+    }
 
     const uint64_t max_;
     std::atomic<uint64_t> current_{};
@@ -59,10 +118,98 @@ private:
     const std::string runtime_key_;
   };
 
+  /**
+   * Active retries. With a retry budget, as many retries are allowed as the budget percentage of
+   * the active and pending requests of the cluster, but never fewer than the budget minimum.
+   * Otherwise max_retries applies.
+   */
+  struct RetryResourceImpl : public ResourceImpl {
+    RetryResourceImpl(uint64_t max, Runtime::Loader& runtime, const std::string& runtime_key,
+                      ClusterStats* stats)
+        : ResourceImpl(max, runtime, runtime_key + "max_retries"), stats_(stats),
+          budget_percent_key_(runtime_key + "retry_budget_percent"),
+          budget_min_retries_key_(runtime_key + "retry_budget_min_retries") {}
+
+    // Upstream::Resource
+    uint64_t max() override {
+      const uint64_t budget_percent =
+          stats_ ? runtime_.snapshot().getInteger(budget_percent_key_, 0) : 0;
+      if (budget_percent == 0) {
+        return ResourceImpl::max();
+      }
+
+      const uint64_t requests =
+          stats_->upstream_rq_active_.value() + stats_->upstream_rq_pending_active_.value();
+      return scaleLimit(std::max(requests * budget_percent / 100,
+                                 runtime_.snapshot().getInteger(budget_min_retries_key_,
+                                                                DEFAULT_RETRY_BUDGET_MIN_RETRIES)));
+    }
+
+    ClusterStats* const stats_;
+    const std::string budget_percent_key_;
+    const std::string budget_min_retries_key_;
+  };
+
+  /**
+   * Active requests. With an adaptive limit, the limit is adjusted from the response times of the
+   * cluster like a gradient concurrency limiter: once per window, the limit is scaled by the ratio
+   * of the lowest recent average response time to the current one, so it shrinks as requests start
+   * to queue, and it grows by its square root, so it keeps probing for more concurrency while
+   * response times hold. max_requests stays the upper bound.
+   */
+  struct RequestResourceImpl : public ResourceImpl {
+    RequestResourceImpl(uint64_t max, Runtime::Loader& runtime, const std::string& runtime_key,
+                        AdaptiveConcurrencyStats* stats, MonotonicTimeSource& time_source);
+
+    // Upstream::Resource
+    bool canCreate() override;
+    uint64_t max() override;
+
+    void onResponseTime(std::chrono::microseconds response_time);
+    bool adaptive() { return stats_ && runtime_.snapshot().getInteger(adaptive_key_, 0) != 0; }
+    void updateLimit(MonotonicTime now);
+
+    AdaptiveConcurrencyStats* const stats_;
+    MonotonicTimeSource& time_source_;
+    const std::string adaptive_key_;
+    // The response times of the current window, from all threads.
+    std::atomic<uint64_t> window_requests_{};
+    std::atomic<uint64_t> window_time_us_{};
+    std::atomic<MonotonicTime::rep> window_start_;
+    // The limit, as last computed by updateLimit().
+    std::atomic<uint64_t> limit_;
+    // Held by the thread that closes a window. The members below are only used under it.
+    std::mutex update_lock_;
+    double limit_estimate_;
+    double min_rtt_us_{};
+    uint32_t windows_since_min_rtt_{};
+  };
+
   ResourceImpl connections_;
   ResourceImpl pending_requests_;
-  ResourceImpl requests_;
-  ResourceImpl retries_;
+  RequestResourceImpl requests_;
+  RetryResourceImpl retries_;
+  ResourceImpl hedges_;
+  ResourceImpl shadows_;
+
+  // The cluster configuration has no hedge or shadow threshold or retry budget, so they can only
+  // be changed in runtime.
+  static const uint64_t DEFAULT_MAX_HEDGES = 3;
+  static const uint64_t DEFAULT_MAX_SHADOWS = 1024;
+  static const uint64_t DEFAULT_RETRY_BUDGET_MIN_RETRIES = 3;
+
+  // The adaptive limit is updated once per window that has at least the minimum number of
+  // responses. The lowest recent response time is sampled again after a number of windows, so that
+  // it follows lasting changes in the upstream. The limit never drops below the minimum, and the
+  // gradient never scales it down by more than half in one window.
+  static const std::chrono::milliseconds ADAPTIVE_WINDOW;
+  static const uint64_t ADAPTIVE_WINDOW_MIN_REQUESTS = 10;
+  static const uint32_t ADAPTIVE_MIN_RTT_WINDOWS = 100;
+  static const uint64_t ADAPTIVE_MIN_LIMIT = 4;
+  static const double ADAPTIVE_MIN_GRADIENT;
+  static const double ADAPTIVE_SMOOTHING;
+
+  static std::atomic<uint32_t> overload_limit_percent_;
 };
 
 typedef std::unique_ptr<ResourceManagerImpl> ResourceManagerImplPtr;
@@ -1,10 +1,14 @@
 #include "common/upstream/ring_hash_lb.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 
 #include "common/common/assert.h"
+#include "common/common/hash.h"
+#include "common/common/utility.h"
 #include "common/upstream/load_balancer_impl.h"
 
 namespace Envoy {
@@ -12,8 +16,10 @@ namespace Upstream {
 
 RingHashLoadBalancer::RingHashLoadBalancer(HostSet& host_set, ClusterStats& stats,
                                            Runtime::Loader& runtime,
-                                           Runtime::RandomGenerator& random)
-    : host_set_(host_set), stats_(stats), runtime_(runtime), random_(random) {
+                                           Runtime::RandomGenerator& random,
+                                           PrebuiltRingsCb prebuilt_rings)
+    : host_set_(host_set), stats_(stats), runtime_(runtime), random_(random),
+      prebuilt_rings_(prebuilt_rings) {
   host_set_.addMemberUpdateCb([this](const std::vector<HostSharedPtr>&,
                                      const std::vector<HostSharedPtr>&) -> void { refresh(); });
 
@@ -22,15 +28,17 @@ RingHashLoadBalancer::RingHashLoadBalancer(HostSet& host_set, ClusterStats& stat
 
 HostConstSharedPtr RingHashLoadBalancer::chooseHost(const LoadBalancerContext* context) {
   if (LoadBalancerUtility::isGlobalPanic(host_set_, stats_, runtime_)) {
-    return all_hosts_ring_.chooseHost(context, random_);
+    return rings_->all_hosts_ring_->chooseHost(context, random_, false, stats_);
   } else {
-    return healthy_hosts_ring_.chooseHost(context, random_);
+    return rings_->healthy_hosts_ring_->chooseHost(context, random_, true, stats_);
   }
 }
 
 HostConstSharedPtr RingHashLoadBalancer::Ring::chooseHost(const LoadBalancerContext* context,
-                                                          Runtime::RandomGenerator& random) {
-  if (ring_.empty()) {
+                                                          Runtime::RandomGenerator& random,
+                                                          bool skip_unhealthy,
+                                                          ClusterStats& stats) const {
+  if (hashes_.empty()) {
     return nullptr;
   }
 
@@ -43,42 +51,22 @@ HostConstSharedPtr RingHashLoadBalancer::Ring::chooseHost(const LoadBalancerCont
   }
   const uint64_t h = hash.valid() ? hash.value() : random.random();
 
-  // Ported from https://github.com/RJ/ketama/blob/master/libketama/ketama.c (ketama_get_server)
-  // I've generally kept the variable names to make the code easier to compare.
-  // NOTE: The algorithm depends on using signed integers for lowp, midp, and highp. Do not
-  //       change them!
-  int64_t lowp = 0;
-  int64_t highp = ring_.size();
-  while (true) {
-    int64_t midp = (lowp + highp) / 2;
-
-    if (midp == static_cast<int64_t>(ring_.size())) {
-      return ring_[0].host_;
-    }
-
-    uint64_t midval = ring_[midp].hash_;
-    uint64_t midval1 = midp == 0 ? 0 : ring_[midp - 1].hash_;
-
-    if (h <= midval && h > midval1) {
-      return ring_[midp].host_;
-    }
-
-    if (midval < h) {
-      lowp = midp + 1;
-    } else {
-      highp = midp - 1;
-    }
-
-    if (lowp > highp) {
-      return ring_[0].host_;
-    }
+  // As in ketama, the host is the first one on the ring at or after the hash, wrapping around to
+  // the first entry.
+  auto it = std::lower_bound(hashes_.begin(), hashes_.end(), h);
+  if (it == hashes_.end()) {
+    it = hashes_.begin();
   }
+  if (skip_unhealthy) {
+    return LoadBalancerUtility::nextHealthyEntry(host_indexes_, it - hashes_.begin(), hosts_,
+                                                 stats);
+  }
+  return hosts_[host_indexes_[it - hashes_.begin()]];
 }
 
-void RingHashLoadBalancer::Ring::create(Runtime::Loader& runtime,
-                                        const std::vector<HostSharedPtr>& hosts) {
+RingHashLoadBalancer::Ring::Ring(Runtime::Loader& runtime,
+                                 const std::vector<HostSharedPtr>& hosts) {
   ENVOY_LOG(trace, "ring hash: building ring");
-  ring_.clear();
   if (hosts.empty()) {
     return;
   }
@@ -86,11 +74,8 @@ void RingHashLoadBalancer::Ring::create(Runtime::Loader& runtime,
   // Currently we specify the minimum size of the ring, and determine the replication factor
   // based on the number of hosts. It's possible we might want to support more sophisticated
   // configuration in the future.
-  // NOTE: Currently we keep a ring for healthy hosts and unhealthy hosts, and this is done per
-  //       thread. This is the simplest implementation, but it's expensive from a memory
-  //       standpoint and duplicates the regeneration computation. In the future we might want
-  //       to generate the rings centrally and then just RCU them out to each thread. This is
-  //       sufficient for getting started.
+  // NOTE: The cluster manager builds the rings once on the main thread for each host set update
+  //       and shares them with all workers, see Rings.
   uint64_t min_ring_size = runtime.snapshot().getInteger("upstream.ring_hash.min_ring_size", 1024);
 
   uint64_t hashes_per_host = 1;
@@ -103,29 +88,65 @@ void RingHashLoadBalancer::Ring::create(Runtime::Loader& runtime,
 
   ENVOY_LOG(trace, "ring hash: min_ring_size={} hashes_per_host={}", min_ring_size,
             hashes_per_host);
-  ring_.reserve(hosts.size() * hashes_per_host);
+  const uint64_t ring_size = hosts.size() * hashes_per_host;
+  std::vector<std::pair<uint64_t, uint32_t>> ring;
+  ring.reserve(ring_size);
+  hosts_.reserve(hosts.size());
+
+  // Hash keys are "<address>_<i>". They are built in a stack buffer rather than as strings, since a
+  // large ring would otherwise allocate a string per entry. Addresses are never long enough to be
+  // truncated here, but if one were it would only weaken the hash.
+  // StringUtil::itoa() needs 21 bytes for the suffix.
+  char hash_key_buffer[196];
+  const size_t max_suffix_length = 21;
   for (const auto& host : hosts) {
+    const std::string& address = host->address()->asString();
+    const size_t prefix_length =
+        std::min(address.size(), sizeof(hash_key_buffer) - max_suffix_length - 1);
+    memcpy(hash_key_buffer, address.data(), prefix_length);
+    hash_key_buffer[prefix_length] = '_';
+    char* suffix = hash_key_buffer + prefix_length + 1;
+
+    const uint32_t host_index = hosts_.size();
+    hosts_.push_back(host);
     for (uint64_t i = 0; i < hashes_per_host; i++) {
-      std::string hash_key(host->address()->asString() + "_" + std::to_string(i));
-      uint64_t hash = std::hash<std::string>()(hash_key);
-      ENVOY_LOG(trace, "ring hash: hash_key={} hash={}", hash_key, hash);
-      ring_.push_back({hash, host});
+      const size_t suffix_length = StringUtil::itoa(suffix, max_suffix_length, i);
+      const uint64_t hash =
+          HashUtil::xxHash64(hash_key_buffer, suffix - hash_key_buffer + suffix_length);
+      ENVOY_LOG(trace, "ring hash: hash_key={} hash={}", hash_key_buffer, hash);
+      ring.emplace_back(hash, host_index);
+    }
+  }
+
+  std::sort(ring.begin(), ring.end());
+  hashes_.reserve(ring_size);
+  host_indexes_.reserve(ring_size);
+  for (const auto& entry : ring) {
+    hashes_.push_back(entry.first);
+    host_indexes_.push_back(entry.second);
+  }
+  if (ENVOY_LOG_CHECK_LEVEL(trace)) {
+    for (uint64_t i = 0; i < hashes_.size(); i++) {
+      ENVOY_LOG(trace, "ring hash: host={} hash={}",
+                hosts_[host_indexes_[i]]->address()->asString(), hashes_[i]);
     }
   }
+}
 
-  std::sort(ring_.begin(), ring_.end(), [](const RingEntry& lhs, const RingEntry& rhs) -> bool {
-    return lhs.hash_ < rhs.hash_;
-  });
-#ifndef NVLOG
-  for (auto entry : ring_) {
-    ENVOY_LOG(trace, "ring hash: host={} hash={}", entry.host_->address()->asString(), entry.hash_);
+RingHashLoadBalancer::Rings::Rings(const HostSet& host_set, Runtime::Loader& runtime)
+    : all_hosts_ring_(std::make_shared<Ring>(runtime, host_set.hosts())) {
+  if (host_set.healthyHosts() == host_set.hosts()) {
+    healthy_hosts_ring_ = all_hosts_ring_;
+  } else {
+    healthy_hosts_ring_ = std::make_shared<Ring>(runtime, host_set.healthyHosts());
   }
-#endif
 }
 
 void RingHashLoadBalancer::refresh() {
-  all_hosts_ring_.create(runtime_, host_set_.hosts());
-  healthy_hosts_ring_.create(runtime_, host_set_.healthyHosts());
+  rings_ = prebuilt_rings_ ? prebuilt_rings_() : nullptr;
+  if (!rings_) {
+    rings_ = std::make_shared<Rings>(host_set_, runtime_);
+  }
 }
 
 } // namespace Upstream
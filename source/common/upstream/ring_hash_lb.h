@@ -1,6 +1,9 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include "envoy/runtime/runtime.h"
@@ -22,34 +25,71 @@ namespace Upstream {
  */
 class RingHashLoadBalancer : public LoadBalancer, Logger::Loggable<Logger::Id::upstream> {
 public:
+  class Rings;
+  typedef std::shared_ptr<const Rings> RingsConstSharedPtr;
+  typedef std::function<RingsConstSharedPtr()> PrebuiltRingsCb;
+
+  /**
+   * @param prebuilt_rings optionally supplies the rings for the current hosts of host_set, already
+   *        built elsewhere and shared between load balancers. It is called on each host set update
+   *        and the load balancer only builds its own rings if it returns nullptr.
+   */
   RingHashLoadBalancer(HostSet& host_set, ClusterStats& stats, Runtime::Loader& runtime,
-                       Runtime::RandomGenerator& random);
+                       Runtime::RandomGenerator& random, PrebuiltRingsCb prebuilt_rings = nullptr);
 
   // Upstream::LoadBalancer
   HostConstSharedPtr chooseHost(const LoadBalancerContext* context) override;
+  void onResponseTime(const HostDescription&, std::chrono::milliseconds) override {}
 
 private:
-  struct RingEntry {
-    uint64_t hash_;
-    HostConstSharedPtr host_;
-  };
-
+  /**
+   * The ring is kept as parallel arrays sorted by hash, so that the binary search in chooseHost()
+   * only touches the hashes. host_indexes_[i] is the index in hosts_ of the host at hashes_[i].
+   */
   struct Ring {
+    Ring(Runtime::Loader& runtime, const std::vector<HostSharedPtr>& hosts);
+
+    /**
+     * @param skip_unhealthy supplies whether to skip hosts that have become unhealthy since the
+     *        ring was built, @see LoadBalancerUtility::nextHealthyEntry().
+     */
     HostConstSharedPtr chooseHost(const LoadBalancerContext* context,
-                                  Runtime::RandomGenerator& random);
-    void create(Runtime::Loader& runtime, const std::vector<HostSharedPtr>& hosts);
+                                  Runtime::RandomGenerator& random, bool skip_unhealthy,
+                                  ClusterStats& stats) const;
 
-    std::vector<RingEntry> ring_;
+    std::vector<uint64_t> hashes_;
+    std::vector<uint32_t> host_indexes_;
+    std::vector<HostConstSharedPtr> hosts_;
   };
 
+  typedef std::shared_ptr<const Ring> RingConstSharedPtr;
+
+public:
+  /**
+   * The rings for one version of a host set. They are immutable, so they can be built once on the
+   * main thread and shared by the load balancers of all workers.
+   */
+  class Rings {
+  public:
+    Rings(const HostSet& host_set, Runtime::Loader& runtime);
+
+  private:
+    friend class RingHashLoadBalancer;
+
+    RingConstSharedPtr all_hosts_ring_;
+    // The same ring as all_hosts_ring_ when all hosts are healthy.
+    RingConstSharedPtr healthy_hosts_ring_;
+  };
+
+private:
   void refresh();
 
   HostSet& host_set_;
   ClusterStats& stats_;
   Runtime::Loader& runtime_;
   Runtime::RandomGenerator& random_;
-  Ring all_hosts_ring_;
-  Ring healthy_hosts_ring_;
+  PrebuiltRingsCb prebuilt_rings_;
+  RingsConstSharedPtr rings_;
 };
 
 } // namespace Upstream
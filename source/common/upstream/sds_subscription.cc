@@ -22,7 +22,8 @@ SdsSubscription::SdsSubscription(ClusterStats& stats,
                                  const envoy::api::v2::ConfigSource& eds_config, ClusterManager& cm,
                                  Event::Dispatcher& dispatcher, Runtime::RandomGenerator& random)
     : RestApiFetcher(cm, eds_config.api_config_source().cluster_name()[0], dispatcher, random,
-                     Config::Utility::apiConfigSourceRefreshDelay(eds_config.api_config_source())),
+                     Config::Utility::apiConfigSourceRefreshDelay(eds_config.api_config_source()),
+                     "sds"),
       stats_(stats) {
   const auto& api_config_source = eds_config.api_config_source();
   UNREFERENCED_PARAMETER(api_config_source);
@@ -0,0 +1,170 @@
+#include "common/upstream/subset_lb.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "common/config/metadata.h"
+
+namespace Envoy {
+namespace Upstream {
+
+const HostListsConstSharedPtr SubsetLoadBalancer::empty_host_lists_{
+    new std::vector<std::vector<HostSharedPtr>>()};
+
+SubsetLoadBalancer::SubsetLoadBalancer(const HostSet& host_set,
+                                       const std::vector<std::vector<std::string>>& subset_keys,
+                                       LoadBalancerPtr&& fallback_lb, LoadBalancerFactory factory,
+                                       ClusterStats& stats)
+    : subset_keys_(subset_keys), fallback_lb_(std::move(fallback_lb)), factory_(factory),
+      stats_(stats) {
+  onHostsChanged(host_set.hosts(), {});
+  member_update_cb_handle_ = host_set.addMemberUpdateCb(
+      [this](const std::vector<HostSharedPtr>& hosts_added,
+             const std::vector<HostSharedPtr>& hosts_removed) -> void {
+        onHostsChanged(hosts_added, hosts_removed);
+      });
+}
+
+SubsetLoadBalancer::~SubsetLoadBalancer() { member_update_cb_handle_->remove(); }
+
+HostConstSharedPtr SubsetLoadBalancer::chooseHost(const LoadBalancerContext* context) {
+  const MetadataMatchCriteria* criteria = context ? context->metadataMatchCriteria() : nullptr;
+  if (criteria) {
+    auto subset = subsets_.find(*criteria);
+    if (subset != subsets_.end()) {
+      stats_.lb_subsets_selected_.inc();
+      return subset->second->lb_->chooseHost(context);
+    }
+  }
+
+  stats_.lb_subsets_fallback_.inc();
+  return fallback_lb_ ? fallback_lb_->chooseHost(context) : nullptr;
+}
+
+void SubsetLoadBalancer::onResponseTime(const HostDescription& host,
+                                        std::chrono::milliseconds response_time) {
+  if (fallback_lb_) {
+    fallback_lb_->onResponseTime(host, response_time);
+  }
+  auto subsets = host_subsets_.find(&host);
+  if (subsets == host_subsets_.end()) {
+    return;
+  }
+  for (Subset* subset : subsets->second) {
+    subset->lb_->onResponseTime(host, response_time);
+  }
+}
+
+void SubsetLoadBalancer::onHostsChanged(const std::vector<HostSharedPtr>& hosts_added,
+                                        const std::vector<HostSharedPtr>& hosts_removed) {
+  for (const HostSharedPtr& host : hosts_removed) {
+    removeHost(host);
+  }
+  for (const HostSharedPtr& host : hosts_added) {
+    addHost(host);
+  }
+
+  // An update without membership changes is a health change, which may affect any subset.
+  const bool health_changed = hosts_added.empty() && hosts_removed.empty();
+  for (auto it = subsets_.begin(); it != subsets_.end();) {
+    Subset& subset = *it->second;
+    if (!subset.changed_ && !health_changed) {
+      ++it;
+      continue;
+    }
+
+    updateSubset(subset);
+    if (subset.host_set_.hosts().empty()) {
+      ENVOY_LOG(debug, "removing empty load balancer subset");
+      it = subsets_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void SubsetLoadBalancer::addHost(const HostSharedPtr& host) {
+  const auto& filter_metadata = host->metadata().filter_metadata();
+  const auto lb_metadata = filter_metadata.find(Config::MetadataFilters::get().ENVOY_LB);
+  if (lb_metadata == filter_metadata.end()) {
+    return;
+  }
+
+  std::vector<Subset*>& host_subsets = host_subsets_[host.get()];
+  for (const std::vector<std::string>& keys : subset_keys_) {
+    MetadataMatchCriteria criteria;
+    criteria.reserve(keys.size());
+    for (const std::string& key : keys) {
+      const auto value = lb_metadata->second.fields().find(key);
+      if (value == lb_metadata->second.fields().end()) {
+        break;
+      }
+      std::string value_string = Config::Metadata::valueString(value->second);
+      if (value_string.empty()) {
+        break;
+      }
+      criteria.emplace_back(key, std::move(value_string));
+    }
+    if (criteria.size() != keys.size()) {
+      continue;
+    }
+
+    SubsetPtr& subset = subsets_[criteria];
+    if (!subset) {
+      ENVOY_LOG(debug, "adding load balancer subset");
+      subset.reset(new Subset());
+      subset->lb_ = factory_(subset->host_set_);
+    }
+    subset->hosts_added_.push_back(host);
+    subset->changed_ = true;
+    host_subsets.push_back(subset.get());
+  }
+
+  if (host_subsets.empty()) {
+    host_subsets_.erase(host.get());
+  }
+}
+
+void SubsetLoadBalancer::removeHost(const HostSharedPtr& host) {
+  auto subsets = host_subsets_.find(host.get());
+  if (subsets == host_subsets_.end()) {
+    return;
+  }
+  for (Subset* subset : subsets->second) {
+    subset->hosts_removed_.push_back(host);
+    subset->changed_ = true;
+  }
+  host_subsets_.erase(subsets);
+}
+
+void SubsetLoadBalancer::updateSubset(Subset& subset) {
+  // Removed hosts are dropped in one pass, so that removing many hosts of a large subset stays
+  // linear in its size.
+  const std::unordered_set<HostSharedPtr> removed(subset.hosts_removed_.begin(),
+                                                  subset.hosts_removed_.end());
+  HostVectorSharedPtr hosts(new std::vector<HostSharedPtr>());
+  hosts->reserve(subset.host_set_.hosts().size() + subset.hosts_added_.size());
+  for (const HostSharedPtr& host : subset.host_set_.hosts()) {
+    if (removed.count(host) == 0) {
+      hosts->push_back(host);
+    }
+  }
+  hosts->insert(hosts->end(), subset.hosts_added_.begin(), subset.hosts_added_.end());
+
+  HostVectorSharedPtr healthy_hosts(new std::vector<HostSharedPtr>());
+  for (const HostSharedPtr& host : *hosts) {
+    if (host->healthy()) {
+      healthy_hosts->push_back(host);
+    }
+  }
+
+  subset.host_set_.updateHosts(hosts, healthy_hosts, empty_host_lists_, empty_host_lists_,
+                               subset.hosts_added_, subset.hosts_removed_);
+  subset.hosts_added_.clear();
+  subset.hosts_removed_.clear();
+  subset.changed_ = false;
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/upstream/load_balancer.h"
+#include "envoy/upstream/upstream.h"
+
+#include "common/common/logger.h"
+#include "common/upstream/upstream_impl.h"
+
+namespace Envoy {
+namespace Upstream {
+
+/**
+ * A load balancer that groups the hosts of a cluster into subsets by their envoy.lb metadata, so
+ * that one cluster can replace many small clusters of the same service. For each configured set
+ * of keys, the hosts that have all the keys are grouped by their values, and each group gets a
+ * host set and a load balancer of its own. A request whose metadata match criteria have exactly
+ * the keys of a set is load balanced over the subset with its values, so choosing a host is a
+ * lookup rather than a scan of the cluster. Membership updates only touch the subsets of the hosts
+ * that were added or removed, and health changes only rebuild the healthy host lists.
+ *
+ * Requests that match no subset, including requests without criteria, go to the fallback load
+ * balancer over all hosts if there is one, and get no host otherwise. The subsets have no zone
+ * aware routing, since the local cluster is not grouped the same way.
+ */
+class SubsetLoadBalancer : public LoadBalancer, Logger::Loggable<Logger::Id::upstream> {
+public:
+  typedef std::function<LoadBalancerPtr(HostSet& host_set)> LoadBalancerFactory;
+
+  /**
+   * @param host_set supplies the hosts of the cluster.
+   * @param subset_keys supplies the sets of keys that hosts are grouped by. Each set is sorted.
+   * @param fallback_lb supplies the load balancer over host_set for requests that match no
+   *        subset, or nullptr if they get no host.
+   * @param factory supplies the factory for the load balancer of each subset.
+   * @param stats supplies the cluster stats.
+   */
+  SubsetLoadBalancer(const HostSet& host_set,
+                     const std::vector<std::vector<std::string>>& subset_keys,
+                     LoadBalancerPtr&& fallback_lb, LoadBalancerFactory factory,
+                     ClusterStats& stats);
+  ~SubsetLoadBalancer();
+
+  // Upstream::LoadBalancer
+  HostConstSharedPtr chooseHost(const LoadBalancerContext* context) override;
+  void onResponseTime(const HostDescription& host,
+                      std::chrono::milliseconds response_time) override;
+
+  /**
+   * @return size_t the number of subsets that have hosts.
+   */
+  size_t subsetCount() const { return subsets_.size(); }
+
+private:
+  struct Subset {
+    HostSetImpl host_set_;
+    LoadBalancerPtr lb_;
+    // The membership changes that host_set_ has not been updated with yet.
+    std::vector<HostSharedPtr> hosts_added_;
+    std::vector<HostSharedPtr> hosts_removed_;
+    bool changed_{};
+  };
+
+  typedef std::unique_ptr<Subset> SubsetPtr;
+
+  void onHostsChanged(const std::vector<HostSharedPtr>& hosts_added,
+                      const std::vector<HostSharedPtr>& hosts_removed);
+  void addHost(const HostSharedPtr& host);
+  void removeHost(const HostSharedPtr& host);
+  static void updateSubset(Subset& subset);
+
+  static const HostListsConstSharedPtr empty_host_lists_;
+
+  const std::vector<std::vector<std::string>> subset_keys_;
+  LoadBalancerPtr fallback_lb_;
+  LoadBalancerFactory factory_;
+  ClusterStats& stats_;
+  // Keyed by the criteria that select the subset.
+  std::map<MetadataMatchCriteria, SubsetPtr> subsets_;
+  // The subsets of each host, so that removing a host does not read its metadata again. A subset
+  // is only removed once all of its hosts are, so the pointers never dangle.
+  std::unordered_map<const HostDescription*, std::vector<Subset*>> host_subsets_;
+  Common::CallbackHandle* member_update_cb_handle_;
+};
+
+} // namespace Upstream
+} // namespace Envoy
@@ -1,10 +1,12 @@
 #include "common/upstream/upstream_impl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -15,9 +17,11 @@
 #include "envoy/upstream/health_checker.h"
 
 #include "common/common/enum_to_int.h"
+#include "common/common/hash.h"
 #include "common/common/utility.h"
 #include "common/config/protocol_json.h"
 #include "common/config/tls_context_json.h"
+#include "common/http/http2/codec_impl.h"
 #include "common/http/utility.h"
 #include "common/network/address_impl.h"
 #include "common/network/utility.h"
@@ -61,6 +65,14 @@ HostImpl::createConnection(Event::Dispatcher& dispatcher, const ClusterInfo& clu
                                                                   cluster.sourceAddress())
                            : dispatcher.createClientConnection(address, cluster.sourceAddress());
   connection->setBufferLimits(cluster.perConnectionBufferLimitBytes());
+  if (cluster.tcpFastOpen()) {
+    connection->enableTcpFastOpen(cluster.stats().upstream_cx_tcp_fast_open_);
+  }
+  if (cluster.perEventByteBudget() > 0) {
+    connection->setEventByteBudget(cluster.perEventByteBudget(),
+                                   cluster.stats().upstream_cx_read_budget_exhausted_,
+                                   cluster.stats().upstream_cx_write_budget_exhausted_);
+  }
   return connection;
 }
 
@@ -82,11 +94,26 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
       per_connection_buffer_limit_bytes_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, per_connection_buffer_limit_bytes, 1024 * 1024)),
       stats_scope_(stats.createScope(fmt::format("cluster.{}.", name_))),
-      stats_(generateStats(*stats_scope_)), features_(parseFeatures(config)),
+      stats_(generateStats(*stats_scope_)), code_stats_(*stats_scope_, ""),
+      features_(parseFeatures(config)),
       http2_settings_(Http::Utility::parseHttp2Settings(config.http2_protocol_options())),
-      resource_managers_(config, runtime, name_),
+      resource_managers_(config, runtime, name_, stats_, *stats_scope_),
       maintenance_mode_runtime_key_(fmt::format("upstream.maintenance_mode.{}", name_)),
-      source_address_(getSourceAddress(config, source_address)), added_via_api_(added_via_api) {
+      min_warm_connections_runtime_key_(fmt::format("upstream.min_warm_connections.{}", name_)),
+      prefetch_ratio_runtime_key_(fmt::format("upstream.prefetch_ratio.{}", name_)),
+      connection_idle_timeout_runtime_key_(
+          fmt::format("upstream.connection_idle_timeout_ms.{}", name_)),
+      prewarmed_tcp_connections_runtime_key_(
+          fmt::format("upstream.prewarmed_tcp_connections.{}", name_)),
+      shared_conn_pools_runtime_key_(fmt::format("upstream.shared_conn_pools.{}", name_)),
+      source_address_(getSourceAddress(config, source_address)),
+      // The cluster API has no TCP Fast Open option, so a cluster opts in with runtime.
+      tcp_fast_open_(
+          runtime.snapshot().getInteger(fmt::format("upstream.tcp_fast_open.{}", name_), 0) != 0),
+      per_event_byte_budget_(runtime.snapshot().getInteger(
+          fmt::format("upstream.per_event_byte_budget.{}", name_), 0)),
+      added_via_api_(added_via_api),
+      memory_charge_(Memory::Owner::ClusterManager, sizeof(ClusterInfoImpl) + config.ByteSize()) {
   ssl_ctx_ = nullptr;
   if (config.has_tls_context()) {
     Ssl::ClientContextConfigImpl context_config(config.tls_context());
@@ -98,13 +125,20 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
     lb_type_ = LoadBalancerType::RoundRobin;
     break;
   case envoy::api::v2::Cluster::LEAST_REQUEST:
-    lb_type_ = LoadBalancerType::LeastRequest;
+    // The cluster API has no peak EWMA policy, so a least request cluster opts into it in runtime.
+    lb_type_ =
+        runtime.snapshot().getInteger(fmt::format("upstream.peak_ewma.{}", name_), 0) != 0
+            ? LoadBalancerType::PeakEwma
+            : LoadBalancerType::LeastRequest;
     break;
   case envoy::api::v2::Cluster::RANDOM:
     lb_type_ = LoadBalancerType::Random;
     break;
   case envoy::api::v2::Cluster::RING_HASH:
-    lb_type_ = LoadBalancerType::RingHash;
+    // The cluster API has no Maglev policy, so a ring hash cluster opts into it in runtime.
+    maglev_table_size_ =
+        runtime.snapshot().getInteger(fmt::format("upstream.maglev_table_size.{}", name_), 0);
+    lb_type_ = maglev_table_size_ > 0 ? LoadBalancerType::Maglev : LoadBalancerType::RingHash;
     break;
   case envoy::api::v2::Cluster::ORIGINAL_DST_LB:
     if (config.type() != envoy::api::v2::Cluster::ORIGINAL_DST) {
@@ -116,6 +150,44 @@ ClusterInfoImpl::ClusterInfoImpl(const envoy::api::v2::Cluster& config,
   default:
     NOT_REACHED;
   }
+
+  // The cluster API has no subset options, so a cluster opts into subsets in runtime. The original
+  // destination load balancer creates its hosts itself, so it cannot group them.
+  if (lb_type_ != LoadBalancerType::OriginalDst) {
+    lb_subset_keys_ =
+        parseLbSubsetKeys(runtime.snapshot().get(fmt::format("upstream.lb_subset_keys.{}", name_)));
+    lb_subset_fallback_ =
+        runtime.snapshot().getInteger(fmt::format("upstream.lb_subset_fallback.{}", name_), 1) != 0;
+  }
+
+  // The cluster API has no on demand option, so a cluster opts in with runtime. The original
+  // destination load balancer reads the primary cluster, so workers always build it up front.
+  on_demand_ = lb_type_ != LoadBalancerType::OriginalDst &&
+               runtime.snapshot().getInteger(fmt::format("upstream.on_demand.{}", name_), 0) != 0;
+}
+
+std::vector<std::vector<std::string>> ClusterInfoImpl::parseLbSubsetKeys(const std::string& keys) {
+  // Key sets are separated by ';' and the keys of a set by ',', e.g. "stage,version;shard".
+  std::vector<std::vector<std::string>> key_sets;
+  for (const std::string& key_set : StringUtil::split(keys, ';')) {
+    std::vector<std::string> set_keys;
+    for (std::string key : StringUtil::split(key_set, ',')) {
+      StringUtil::trim(key);
+      if (!key.empty()) {
+        set_keys.push_back(key);
+      }
+    }
+    if (set_keys.empty()) {
+      continue;
+    }
+
+    std::sort(set_keys.begin(), set_keys.end());
+    set_keys.erase(std::unique(set_keys.begin(), set_keys.end()), set_keys.end());
+    if (std::find(key_sets.begin(), key_sets.end(), set_keys) == key_sets.end()) {
+      key_sets.push_back(set_keys);
+    }
+  }
+  return key_sets;
 }
 
 const HostListsConstSharedPtr ClusterImplBase::empty_host_lists_{
@@ -185,7 +257,7 @@ ClusterSharedPtr ClusterImplBase::create(const envoy::api::v2::Cluster& cluster,
     NOT_REACHED;
   }
 
-  if (!cluster.health_checks().empty()) {
+  if (!cluster.health_checks().empty() && activeHealthCheckSampled(cluster, runtime, local_info)) {
     // TODO(htuch): Need to support multiple health checks in v2.
     ASSERT(cluster.health_checks().size() == 1);
     new_cluster->setHealthChecker(HealthCheckerFactory::create(
@@ -193,10 +265,25 @@ ClusterSharedPtr ClusterImplBase::create(const envoy::api::v2::Cluster& cluster,
   }
 
   new_cluster->setOutlierDetector(Outlier::DetectorImplFactory::createForCluster(
-      *new_cluster, cluster, dispatcher, runtime, outlier_event_logger));
+      *new_cluster, cluster, dispatcher, runtime, outlier_event_logger), dispatcher);
   return std::move(new_cluster);
 }
 
+bool ClusterImplBase::activeHealthCheckSampled(const envoy::api::v2::Cluster& cluster,
+                                               Runtime::Loader& runtime,
+                                               const LocalInfo::LocalInfo& local_info) {
+  // Only EDS clusters can skip active health checking, as their hosts can still be marked
+  // unhealthy by the health status in the assignment. The sample is keyed on the node and cluster
+  // so that the same Envoys keep checking across cluster updates.
+  if (cluster.type() != envoy::api::v2::Cluster::EDS) {
+    return true;
+  }
+
+  const uint64_t sample_percent = runtime.snapshot().getInteger(
+      fmt::format("health_check.active_sample_percent.{}", cluster.name()), 100);
+  return HashUtil::xxHash64(local_info.nodeName() + cluster.name()) % 100 < sample_percent;
+}
+
 ClusterImplBase::ClusterImplBase(const envoy::api::v2::Cluster& cluster,
                                  const Network::Address::InstanceConstSharedPtr source_address,
                                  Runtime::Loader& runtime, Stats::Store& stats,
@@ -237,10 +324,41 @@ bool ClusterInfoImpl::maintenanceMode() const {
   return runtime_.snapshot().featureEnabled(maintenance_mode_runtime_key_, 0);
 }
 
+uint32_t ClusterInfoImpl::minWarmConnections() const {
+  return runtime_.snapshot().getInteger(min_warm_connections_runtime_key_, 0);
+}
+
+double ClusterInfoImpl::prefetchRatio() const {
+  // The runtime value is a percentage. Less than one connection per request is what the pool does
+  // without prefetching anyway.
+  return std::max<uint64_t>(100, runtime_.snapshot().getInteger(prefetch_ratio_runtime_key_, 100)) /
+         100.0;
+}
+
+std::chrono::milliseconds ClusterInfoImpl::connectionIdleTimeout() const {
+  return std::chrono::milliseconds(
+      runtime_.snapshot().getInteger(connection_idle_timeout_runtime_key_, 0));
+}
+
+uint32_t ClusterInfoImpl::prewarmedTcpConnections() const {
+  return runtime_.snapshot().getInteger(prewarmed_tcp_connections_runtime_key_, 0);
+}
+
+bool ClusterInfoImpl::sharedConnPools() const {
+  return runtime_.snapshot().getInteger(shared_conn_pools_runtime_key_, 0) != 0;
+}
+
 uint64_t ClusterInfoImpl::parseFeatures(const envoy::api::v2::Cluster& config) {
   uint64_t features = 0;
   if (config.has_http2_protocol_options()) {
     features |= Features::HTTP2;
+  } else if (config.has_tls_context()) {
+    // Offering h2 without the cluster being HTTP/2 leaves the protocol to each host.
+    const auto& alpn_protocols = config.tls_context().common_tls_context().alpn_protocols();
+    if (std::find(alpn_protocols.begin(), alpn_protocols.end(), Http::Http2::ALPN_STRING) !=
+        alpn_protocols.end()) {
+      features |= Features::HTTP2_ALPN;
+    }
   }
   return features;
 }
@@ -274,16 +392,30 @@ void ClusterImplBase::setHealthChecker(const HealthCheckerSharedPtr& health_chec
   });
 }
 
-void ClusterImplBase::setOutlierDetector(const Outlier::DetectorSharedPtr& outlier_detector) {
+void ClusterImplBase::setOutlierDetector(const Outlier::DetectorSharedPtr& outlier_detector,
+                                         Event::Dispatcher& dispatcher) {
   if (!outlier_detector) {
     return;
   }
 
   outlier_detector_ = outlier_detector;
-  outlier_detector_->addChangedStateCb([this](HostSharedPtr) -> void { reloadHealthyHosts(); });
+  outlier_reload_timer_ = dispatcher.createTimer([this]() -> void { reloadHealthyHosts(); });
+  outlier_detector_->addChangedStateCb([this](HostSharedPtr) -> void {
+    // Every rebuild is posted to all workers, so an ejection storm is absorbed by one rebuild.
+    // The host's health flag already changed, so load balancers skip it until then.
+    if (!outlier_reload_pending_) {
+      outlier_reload_pending_ = true;
+      outlier_reload_timer_->enableTimer(std::chrono::milliseconds(
+          runtime_.snapshot().getInteger("outlier_detection.host_set_update_delay_ms", 1000)));
+    }
+  });
 }
 
 void ClusterImplBase::reloadHealthyHosts() {
+  if (outlier_reload_pending_) {
+    outlier_reload_pending_ = false;
+    outlier_reload_timer_->disableTimer();
+  }
   HostVectorConstSharedPtr hosts_copy(new std::vector<HostSharedPtr>(hosts()));
   HostListsConstSharedPtr hosts_per_zone_copy(
       new std::vector<std::vector<HostSharedPtr>>(hostsPerZone()));
@@ -293,17 +425,32 @@ void ClusterImplBase::reloadHealthyHosts() {
 
 ClusterInfoImpl::ResourceManagers::ResourceManagers(const envoy::api::v2::Cluster& config,
                                                     Runtime::Loader& runtime,
-                                                    const std::string& cluster_name) {
+                                                    const std::string& cluster_name,
+                                                    ClusterStats& stats, Stats::Scope& scope)
+    : default_adaptive_stats_(generateAdaptiveStats(scope, "default")),
+      high_adaptive_stats_(generateAdaptiveStats(scope, "high")) {
   managers_[enumToInt(ResourcePriority::Default)] =
-      load(config, runtime, cluster_name, envoy::api::v2::RoutingPriority::DEFAULT);
+      load(config, runtime, cluster_name, envoy::api::v2::RoutingPriority::DEFAULT, stats,
+           default_adaptive_stats_);
   managers_[enumToInt(ResourcePriority::High)] =
-      load(config, runtime, cluster_name, envoy::api::v2::RoutingPriority::HIGH);
+      load(config, runtime, cluster_name, envoy::api::v2::RoutingPriority::HIGH, stats,
+           high_adaptive_stats_);
+}
+
+AdaptiveConcurrencyStats
+ClusterInfoImpl::ResourceManagers::generateAdaptiveStats(Stats::Scope& scope,
+                                                         const std::string& priority) {
+  const std::string prefix = fmt::format("adaptive_concurrency.{}.", priority);
+  return {ALL_ADAPTIVE_CONCURRENCY_STATS(POOL_COUNTER_PREFIX(scope, prefix),
+                                         POOL_GAUGE_PREFIX(scope, prefix))};
 }
 
 ResourceManagerImplPtr
 ClusterInfoImpl::ResourceManagers::load(const envoy::api::v2::Cluster& config,
                                         Runtime::Loader& runtime, const std::string& cluster_name,
-                                        const envoy::api::v2::RoutingPriority& priority) {
+                                        const envoy::api::v2::RoutingPriority& priority,
+                                        ClusterStats& stats,
+                                        AdaptiveConcurrencyStats& adaptive_stats) {
   uint64_t max_connections = 1024;
   uint64_t max_pending_requests = 1024;
   uint64_t max_requests = 1024;
@@ -323,8 +470,9 @@ ClusterInfoImpl::ResourceManagers::load(const envoy::api::v2::Cluster& config,
     max_requests = PROTOBUF_GET_WRAPPED_OR_DEFAULT(*it, max_requests, max_requests);
     max_retries = PROTOBUF_GET_WRAPPED_OR_DEFAULT(*it, max_retries, max_retries);
   }
-  return ResourceManagerImplPtr{new ResourceManagerImpl(
-      runtime, runtime_prefix, max_connections, max_pending_requests, max_requests, max_retries)};
+  return ResourceManagerImplPtr{new ResourceManagerImpl(runtime, runtime_prefix, max_connections,
+                                                        max_pending_requests, max_requests,
+                                                        max_retries, &stats, &adaptive_stats)};
 }
 
 StaticClusterImpl::StaticClusterImpl(const envoy::api::v2::Cluster& cluster,
@@ -351,41 +499,40 @@ bool BaseDynamicClusterImpl::updateDynamicHostList(const std::vector<HostSharedP
   uint64_t max_host_weight = 1;
 
   // Go through and see if the list we have is different from what we just got. If it is, we
-  // make a new host list and raise a change notification. This uses an N^2 search given that
-  // this does not happen very often and the list sizes should be small. We also check for
-  // duplicates here. It's possible for DNS to return the same address multiple times, and a bad
+  // make a new host list and raise a change notification. Current hosts are indexed by address so
+  // that this is linear in the number of hosts, which matters for large EDS clusters. We also check
+  // for duplicates here. It's possible for DNS to return the same address multiple times, and a bad
   // SDS implementation could do the same thing.
+  std::unordered_map<std::string, size_t> current_host_indexes;
+  current_host_indexes.reserve(current_hosts.size());
+  for (size_t i = 0; i < current_hosts.size(); i++) {
+    current_host_indexes.emplace(current_hosts[i]->address()->asString(), i);
+  }
+
   std::unordered_set<std::string> host_addresses;
+  host_addresses.reserve(new_hosts.size());
+  std::vector<bool> current_host_kept(current_hosts.size());
   std::vector<HostSharedPtr> final_hosts;
+  final_hosts.reserve(new_hosts.size());
   for (const HostSharedPtr& host : new_hosts) {
-    if (host_addresses.count(host->address()->asString())) {
+    const std::string& address = host->address()->asString();
+    if (!host_addresses.emplace(address).second) {
       continue;
     }
-    host_addresses.emplace(host->address()->asString());
-
-    bool found = false;
-    for (auto i = current_hosts.begin(); i != current_hosts.end();) {
-      // If we find a host matched based on address, we keep it. However we do change weight inline
-      // so do that here.
-      if (*(*i)->address() == *host->address()) {
-        if (host->weight() > max_host_weight) {
-          max_host_weight = host->weight();
-        }
 
-        (*i)->weight(host->weight());
-        final_hosts.push_back(*i);
-        i = current_hosts.erase(i);
-        found = true;
-      } else {
-        i++;
-      }
+    if (host->weight() > max_host_weight) {
+      max_host_weight = host->weight();
     }
 
-    if (!found) {
-      if (host->weight() > max_host_weight) {
-        max_host_weight = host->weight();
-      }
-
+    auto current_host_index = current_host_indexes.find(address);
+    if (current_host_index != current_host_indexes.end()) {
+      // If we find a host matched based on address, we keep it. However we do change weight inline
+      // so do that here.
+      const HostSharedPtr& current_host = current_hosts[current_host_index->second];
+      current_host->weight(host->weight());
+      final_hosts.push_back(current_host);
+      current_host_kept[current_host_index->second] = true;
+    } else {
       final_hosts.push_back(host);
       hosts_added.push_back(host);
 
@@ -396,34 +543,33 @@ bool BaseDynamicClusterImpl::updateDynamicHostList(const std::vector<HostSharedP
     }
   }
 
-  // If there are removed hosts, check to see if we should only delete if unhealthy.
-  if (!current_hosts.empty() && depend_on_hc) {
-    for (auto i = current_hosts.begin(); i != current_hosts.end();) {
-      if (!(*i)->healthFlagGet(Host::HealthFlag::FAILED_ACTIVE_HC)) {
-        if ((*i)->weight() > max_host_weight) {
-          max_host_weight = (*i)->weight();
-        }
+  // Hosts that are no longer present are removed, unless we depend on a health checker and they
+  // are still healthy, in which case we keep them until they fail.
+  std::vector<HostSharedPtr> removed;
+  for (size_t i = 0; i < current_hosts.size(); i++) {
+    if (current_host_kept[i]) {
+      continue;
+    }
 
-        final_hosts.push_back(*i);
-        i = current_hosts.erase(i);
-      } else {
-        i++;
+    HostSharedPtr& host = current_hosts[i];
+    if (depend_on_hc && !host->healthFlagGet(Host::HealthFlag::FAILED_ACTIVE_HC)) {
+      if (host->weight() > max_host_weight) {
+        max_host_weight = host->weight();
       }
+      final_hosts.push_back(std::move(host));
+    } else {
+      removed.push_back(std::move(host));
     }
   }
 
   info_->stats().max_host_weight_.set(max_host_weight);
 
-  if (!hosts_added.empty() || !current_hosts.empty()) {
-    hosts_removed = std::move(current_hosts);
-    current_hosts = std::move(final_hosts);
+  current_hosts = std::move(final_hosts);
+  if (!hosts_added.empty() || !removed.empty()) {
+    hosts_removed = std::move(removed);
     return true;
-  } else {
-    // During the search we moved all of the hosts from hosts_ into final_hosts so just
-    // move them back.
-    current_hosts = std::move(final_hosts);
-    return false;
   }
+  return false;
 }
 
 StrictDnsClusterImpl::StrictDnsClusterImpl(const envoy::api::v2::Cluster& cluster,
@@ -510,6 +656,10 @@ void StrictDnsClusterImpl::ResolveTarget::startResolve() {
           // a new address that has port in it. We need to both support IPv6 as well as potentially
           // move port handling into the DNS interface itself, which would work better for SRV.
           ASSERT(address != nullptr);
+          // Auto resolves both families. Only the preferred one, which comes first, becomes hosts.
+          if (address->ip()->version() != address_list.front()->ip()->version()) {
+            break;
+          }
           new_hosts.emplace_back(new HostImpl(parent_.info_, dns_address_,
                                               Network::Utility::getAddressWithPort(*address, port_),
                                               false, 1, ""));
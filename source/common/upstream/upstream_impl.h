@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 
+#include "envoy/event/dispatcher.h"
 #include "envoy/event/timer.h"
 #include "envoy/local_info/local_info.h"
 #include "envoy/network/dns.h"
@@ -24,6 +25,8 @@
 #include "common/common/callback_impl.h"
 #include "common/common/enum_to_int.h"
 #include "common/common/logger.h"
+#include "common/http/codes.h"
+#include "common/memory/accounting.h"
 #include "common/stats/stats_impl.h"
 #include "common/upstream/outlier_detection_impl.h"
 #include "common/upstream/resource_manager_impl.h"
@@ -47,11 +50,12 @@ public:
  */
 class HostDescriptionImpl : virtual public HostDescription {
 public:
-  HostDescriptionImpl(ClusterInfoConstSharedPtr cluster, const std::string& hostname,
-                      Network::Address::InstanceConstSharedPtr dest_address, bool canary,
-                      const std::string& zone)
+  HostDescriptionImpl(
+      ClusterInfoConstSharedPtr cluster, const std::string& hostname,
+      Network::Address::InstanceConstSharedPtr dest_address, bool canary, const std::string& zone,
+      const envoy::api::v2::Metadata& metadata = envoy::api::v2::Metadata::default_instance())
       : cluster_(cluster), hostname_(hostname), address_(dest_address), canary_(canary),
-        zone_(zone), stats_{ALL_HOST_STATS(POOL_COUNTER(stats_store_), POOL_GAUGE(stats_store_))} {}
+        zone_(zone), metadata_(metadata) {}
 
   // Upstream::HostDescription
   bool canary() const override { return canary_; }
@@ -74,7 +78,8 @@ public:
       return *null_outlier_detector;
     }
   }
-  const HostStats& stats() const override { return stats_; }
+  const envoy::api::v2::Metadata& metadata() const override { return metadata_; }
+  HostStats& stats() const override { return stats_; }
   const std::string& hostname() const override { return hostname_; }
   Network::Address::InstanceConstSharedPtr address() const override { return address_; }
   const std::string& zone() const override { return zone_; }
@@ -85,8 +90,8 @@ protected:
   Network::Address::InstanceConstSharedPtr address_;
   const bool canary_;
   const std::string zone_;
-  Stats::IsolatedStoreImpl stats_store_;
-  HostStats stats_;
+  const envoy::api::v2::Metadata metadata_;
+  mutable HostStats stats_;
   Outlier::DetectorHostMonitorPtr outlier_detector_;
   HealthCheckHostMonitorPtr health_checker_;
 };
@@ -100,15 +105,14 @@ class HostImpl : public HostDescriptionImpl,
 public:
   HostImpl(ClusterInfoConstSharedPtr cluster, const std::string& hostname,
            Network::Address::InstanceConstSharedPtr address, bool canary, uint32_t initial_weight,
-           const std::string& zone)
-      : HostDescriptionImpl(cluster, hostname, address, canary, zone), used_(true) {
+           const std::string& zone,
+           const envoy::api::v2::Metadata& metadata = envoy::api::v2::Metadata::default_instance())
+      : HostDescriptionImpl(cluster, hostname, address, canary, zone, metadata), used_(true) {
     weight(initial_weight);
   }
 
   // Upstream::Host
-  std::list<Stats::CounterSharedPtr> counters() const override { return stats_store_.counters(); }
   CreateConnectionData createConnection(Event::Dispatcher& dispatcher) const override;
-  std::list<Stats::GaugeSharedPtr> gauges() const override { return stats_store_.gauges(); }
   void healthFlagClear(HealthFlag flag) override { health_flags_ &= ~enumToInt(flag); }
   bool healthFlagGet(HealthFlag flag) const override { return health_flags_ & enumToInt(flag); }
   void healthFlagSet(HealthFlag flag) override { health_flags_ |= enumToInt(flag); }
@@ -133,6 +137,7 @@ private:
   std::atomic<uint64_t> health_flags_{};
   std::atomic<uint32_t> weight_;
   std::atomic<bool> used_;
+  const Memory::Charge memory_charge_{Memory::Owner::ClusterManager, sizeof(HostImpl)};
 };
 
 typedef std::shared_ptr<std::vector<HostSharedPtr>> HostVectorSharedPtr;
@@ -175,6 +180,11 @@ public:
     return member_update_cb_helper_.add(callback);
   }
 
+  /**
+   * @return size_t the number of registered member update callbacks.
+   */
+  size_t memberUpdateCbCount() const { return member_update_cb_helper_.size(); }
+
 protected:
   virtual void runUpdateCallbacks(const std::vector<HostSharedPtr>& hosts_added,
                                   const std::vector<HostSharedPtr>& hosts_removed) {
@@ -214,13 +224,27 @@ public:
   uint64_t features() const override { return features_; }
   const Http::Http2Settings& http2Settings() const override { return http2_settings_; }
   LoadBalancerType lbType() const override { return lb_type_; }
+  uint64_t maglevTableSize() const override { return maglev_table_size_; }
+  const std::vector<std::vector<std::string>>& lbSubsetKeys() const override {
+    return lb_subset_keys_;
+  }
+  bool lbSubsetFallback() const override { return lb_subset_fallback_; }
   bool maintenanceMode() const override;
   uint64_t maxRequestsPerConnection() const override { return max_requests_per_connection_; }
+  bool onDemand() const override { return on_demand_; }
+  uint32_t minWarmConnections() const override;
+  double prefetchRatio() const override;
+  std::chrono::milliseconds connectionIdleTimeout() const override;
+  uint32_t prewarmedTcpConnections() const override;
+  bool sharedConnPools() const override;
+  bool tcpFastOpen() const override { return tcp_fast_open_; }
+  uint32_t perEventByteBudget() const override { return per_event_byte_budget_; }
   const std::string& name() const override { return name_; }
   ResourceManager& resourceManager(ResourcePriority priority) const override;
   Ssl::ClientContext* sslContext() const override { return ssl_ctx_.get(); }
   ClusterStats& stats() const override { return stats_; }
   Stats::Scope& statsScope() const override { return *stats_scope_; }
+  Http::CodeStats& codeStats() const override { return code_stats_; }
   const Network::Address::InstanceConstSharedPtr& sourceAddress() const override {
     return source_address_;
   };
@@ -228,17 +252,24 @@ public:
 private:
   struct ResourceManagers {
     ResourceManagers(const envoy::api::v2::Cluster& config, Runtime::Loader& runtime,
-                     const std::string& cluster_name);
+                     const std::string& cluster_name, ClusterStats& stats, Stats::Scope& scope);
     ResourceManagerImplPtr load(const envoy::api::v2::Cluster& config, Runtime::Loader& runtime,
                                 const std::string& cluster_name,
-                                const envoy::api::v2::RoutingPriority& priority);
+                                const envoy::api::v2::RoutingPriority& priority,
+                                ClusterStats& stats, AdaptiveConcurrencyStats& adaptive_stats);
+    static AdaptiveConcurrencyStats generateAdaptiveStats(Stats::Scope& scope,
+                                                          const std::string& priority);
 
     typedef std::array<ResourceManagerImplPtr, NumResourcePriorities> Managers;
 
+    // Declared first, since the managers refer to them.
+    AdaptiveConcurrencyStats default_adaptive_stats_;
+    AdaptiveConcurrencyStats high_adaptive_stats_;
     Managers managers_;
   };
 
   static uint64_t parseFeatures(const envoy::api::v2::Cluster& config);
+  static std::vector<std::vector<std::string>> parseLbSubsetKeys(const std::string& keys);
 
   Runtime::Loader& runtime_;
   const std::string name_;
@@ -247,14 +278,27 @@ private:
   const uint32_t per_connection_buffer_limit_bytes_;
   Stats::ScopePtr stats_scope_;
   mutable ClusterStats stats_;
+  mutable Http::CodeStatsImpl code_stats_;
   Ssl::ClientContextPtr ssl_ctx_;
   const uint64_t features_;
   const Http::Http2Settings http2_settings_;
   mutable ResourceManagers resource_managers_;
   const std::string maintenance_mode_runtime_key_;
+  const std::string min_warm_connections_runtime_key_;
+  const std::string prefetch_ratio_runtime_key_;
+  const std::string connection_idle_timeout_runtime_key_;
+  const std::string prewarmed_tcp_connections_runtime_key_;
+  const std::string shared_conn_pools_runtime_key_;
   const Network::Address::InstanceConstSharedPtr source_address_;
   LoadBalancerType lb_type_;
+  uint64_t maglev_table_size_{};
+  std::vector<std::vector<std::string>> lb_subset_keys_;
+  bool lb_subset_fallback_{};
+  bool on_demand_{};
+  const bool tcp_fast_open_;
+  const uint32_t per_event_byte_budget_;
   const bool added_via_api_;
+  const Memory::Charge memory_charge_;
 };
 
 /**
@@ -283,9 +327,13 @@ public:
 
   /**
    * Optionally set the outlier detector for the primary cluster. Done for the same reason as
-   * documented in setHealthChecker().
+   * documented in setHealthChecker(). Ejections and unejections rebuild the healthy hosts in
+   * batches, at most once per outlier_detection.host_set_update_delay_ms. Load balancers skip
+   * hosts that became unhealthy in the meantime.
+   * @param dispatcher supplies the dispatcher of the batching timer.
    */
-  void setOutlierDetector(const Outlier::DetectorSharedPtr& outlier_detector);
+  void setOutlierDetector(const Outlier::DetectorSharedPtr& outlier_detector,
+                          Event::Dispatcher& dispatcher);
 
   // Upstream::Cluster
   ClusterInfoConstSharedPtr info() const override { return info_; }
@@ -297,12 +345,25 @@ protected:
                   Runtime::Loader& runtime, Stats::Store& stats,
                   Ssl::ContextManager& ssl_context_manager, bool added_via_api);
 
+  /**
+   * @return bool whether this Envoy is in the sample of Envoys that actively health check an EDS
+   *         cluster. Envoys outside of the sample rely on the health status supplied by EDS.
+   */
+  static bool activeHealthCheckSampled(const envoy::api::v2::Cluster& cluster,
+                                       Runtime::Loader& runtime,
+                                       const LocalInfo::LocalInfo& local_info);
   static HostVectorConstSharedPtr createHealthyHostList(const std::vector<HostSharedPtr>& hosts);
   static HostListsConstSharedPtr
   createHealthyHostLists(const std::vector<std::vector<HostSharedPtr>>& hosts);
   void runUpdateCallbacks(const std::vector<HostSharedPtr>& hosts_added,
                           const std::vector<HostSharedPtr>& hosts_removed) override;
 
+  /**
+   * Rebuild the healthy host lists after a host's health changed without a membership change.
+   * This includes any pending outlier detection changes.
+   */
+  void reloadHealthyHosts();
+
   static const HostListsConstSharedPtr empty_host_lists_;
 
   Runtime::Loader& runtime_;
@@ -311,9 +372,8 @@ protected:
              // and destroyed last.
   HealthCheckerSharedPtr health_checker_;
   Outlier::DetectorSharedPtr outlier_detector_;
-
-private:
-  void reloadHealthyHosts();
+  Event::TimerPtr outlier_reload_timer_;
+  bool outlier_reload_pending_{};
 };
 
 /**
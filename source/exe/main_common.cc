@@ -2,6 +2,8 @@
 #include <memory>
 
 #include "common/common/compiler_requirements.h"
+#include "common/common/recycler.h"
+#include "common/event/dispatcher_impl.h"
 #include "common/event/libevent.h"
 #include "common/network/utility.h"
 #include "common/stats/stats_impl.h"
@@ -74,12 +76,17 @@ int main_common(OptionsImpl& options) {
   ares_library_init(ARES_LIB_INIT_ALL);
 
   Logger::Registry::initialize(options.logLevel(), log_lock);
+  Logger::Registry::getSink()->setAsync(options.logQueueSize());
+  Recycler::maxFreeObjects(options.maxRecycledObjects());
+  Event::DispatcherImpl::epollChangelist(options.epollChangelist());
   DefaultTestHooks default_test_hooks;
   ThreadLocal::InstanceImpl tls;
   Stats::ThreadLocalStoreImpl stats_store(stats_allocator);
   Server::InstanceImpl server(options, local_address, default_test_hooks, *restarter, stats_store,
                               access_log_lock, component_factory, tls);
   server.run();
+  // The writer thread must be done with the log lock before the hot restarter goes away.
+  Logger::Registry::getSink()->setAsync(0);
   ares_library_cleanup();
   return 0;
 }
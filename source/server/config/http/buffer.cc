@@ -21,7 +21,11 @@ HttpFilterFactoryCb BufferFilterConfig::createFilterFactory(const Json::Object&
   Http::BufferFilterConfigConstSharedPtr config(new Http::BufferFilterConfig{
       Http::BufferFilter::generateStats(stats_prefix, context.scope()),
       static_cast<uint64_t>(json_config.getInteger("max_request_bytes")),
-      std::chrono::seconds(json_config.getInteger("max_request_time_s"))});
+      std::chrono::seconds(json_config.getInteger("max_request_time_s")),
+      static_cast<uint64_t>(json_config.getInteger("max_request_memory_bytes", 0)),
+      json_config.getString("spill_directory", "/tmp"),
+      static_cast<uint64_t>(json_config.getInteger("max_total_memory_bytes", 0)),
+      {}});
   return [config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
     callbacks.addStreamDecoderFilter(
         Http::StreamDecoderFilterSharedPtr{new Http::BufferFilter(config)});
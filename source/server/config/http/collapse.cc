@@ -0,0 +1,30 @@
+#include "server/config/http/collapse.h"
+
+#include <string>
+
+#include "envoy/registry/registry.h"
+
+#include "common/http/filter/collapse_filter.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+HttpFilterFactoryCb CollapseFilterConfig::createFilterFactory(const Json::Object& json_config,
+                                                              const std::string& stat_prefix,
+                                                              FactoryContext& context) {
+  Http::CollapseFilterConfigSharedPtr config(new Http::CollapseFilterConfig(
+      json_config, stat_prefix, context.scope(), context.threadLocal()));
+  return [config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamFilter(Http::StreamFilterSharedPtr{new Http::CollapseFilter(config)});
+  };
+}
+
+/**
+ * Static registration for the collapse filter. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<CollapseFilterConfig, NamedHttpFilterConfigFactory> register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "envoy/server/filter_config.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+/**
+ * Config registration for the collapse filter. @see NamedHttpFilterConfigFactory.
+ */
+class CollapseFilterConfig : public NamedHttpFilterConfigFactory {
+public:
+  HttpFilterFactoryCb createFilterFactory(const Json::Object& json_config,
+                                          const std::string& stat_prefix,
+                                          FactoryContext& context) override;
+  std::string name() override { return "collapse"; }
+};
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -0,0 +1,33 @@
+#include "server/config/http/ext_authz.h"
+
+#include <string>
+
+#include "envoy/registry/registry.h"
+
+#include "common/common/utility.h"
+#include "common/http/filter/ext_authz_filter.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+HttpFilterFactoryCb ExtAuthzFilterConfig::createFilterFactory(const Json::Object& json_config,
+                                                              const std::string& stat_prefix,
+                                                              FactoryContext& context) {
+  Http::ExtAuthzFilterConfigSharedPtr config(new Http::ExtAuthzFilterConfig(
+      json_config, stat_prefix, context.scope(), context.threadLocal(), context.clusterManager(),
+      ProdMonotonicTimeSource::instance_));
+  return [config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamDecoderFilter(
+        Http::StreamDecoderFilterSharedPtr{new Http::ExtAuthzFilter(config)});
+  };
+}
+
+/**
+ * Static registration for the external authorization filter. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<ExtAuthzFilterConfig, NamedHttpFilterConfigFactory> register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
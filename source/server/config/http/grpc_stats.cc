@@ -0,0 +1,28 @@
+#include "server/config/http/grpc_stats.h"
+
+#include "envoy/registry/registry.h"
+
+#include "common/grpc/stats_filter.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+HttpFilterFactoryCb GrpcStatsFilterConfig::createFilterFactory(const Json::Object&,
+                                                               const std::string& stat_prefix,
+                                                               FactoryContext& context) {
+  Grpc::StatsFilterConfigSharedPtr config(
+      new Grpc::StatsFilterConfig(stat_prefix, context.scope(), context.threadLocal()));
+  return [config](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamFilter(Http::StreamFilterSharedPtr{new Grpc::StatsFilter(config)});
+  };
+}
+
+/**
+ * Static registration for the gRPC stats filter. @see RegisterFactory.
+ */
+static Registry::RegisterFactory<GrpcStatsFilterConfig, NamedHttpFilterConfigFactory> register_;
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "envoy/server/filter_config.h"
+
+namespace Envoy {
+namespace Server {
+namespace Configuration {
+
+class GrpcStatsFilterConfig : public NamedHttpFilterConfigFactory {
+public:
+  HttpFilterFactoryCb createFilterFactory(const Json::Object&, const std::string& stat_prefix,
+                                          FactoryContext& context) override;
+  std::string name() override { return "grpc_stats"; }
+};
+
+} // namespace Configuration
+} // namespace Server
+} // namespace Envoy
@@ -5,22 +5,34 @@
 
 #include "envoy/registry/registry.h"
 
+#include "common/common/utility.h"
 #include "common/http/filter/ratelimit.h"
+#include "common/ratelimit/local_ratelimit_impl.h"
 
 namespace Envoy {
 namespace Server {
 namespace Configuration {
 
 HttpFilterFactoryCb RateLimitFilterConfig::createFilterFactory(const Json::Object& config,
-                                                               const std::string&,
+                                                               const std::string& stat_prefix,
                                                                FactoryContext& context) {
   Http::RateLimit::FilterConfigSharedPtr filter_config(new Http::RateLimit::FilterConfig(
       config, context.localInfo(), context.scope(), context.runtime(), context.clusterManager()));
   const uint32_t timeout_ms = config.getInteger("timeout_ms", 20);
-  return [filter_config, timeout_ms,
+  RateLimit::LocalRateLimiterSharedPtr local_limiter;
+  if (config.hasObject("local_rate_limit")) {
+    local_limiter.reset(new RateLimit::LocalRateLimiter(
+        *config.getObject("local_rate_limit"), stat_prefix + "ratelimit.", context.scope(),
+        context.threadLocal(), ProdMonotonicTimeSource::instance_));
+  }
+  return [filter_config, timeout_ms, local_limiter,
           &context](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-    callbacks.addStreamDecoderFilter(Http::StreamDecoderFilterSharedPtr{new Http::RateLimit::Filter(
-        filter_config, context.rateLimitClient(std::chrono::milliseconds(timeout_ms)))});
+    RateLimit::ClientPtr client = context.rateLimitClient(std::chrono::milliseconds(timeout_ms));
+    if (local_limiter) {
+      client.reset(new RateLimit::LocalClientImpl(local_limiter, std::move(client)));
+    }
+    callbacks.addStreamDecoderFilter(Http::StreamDecoderFilterSharedPtr{
+        new Http::RateLimit::Filter(filter_config, std::move(client))});
   };
 }
 
@@ -12,8 +12,10 @@
 #include "envoy/server/options.h"
 #include "envoy/stats/stats.h"
 
+#include "common/common/utility.h"
 #include "common/config/filter_json.h"
 #include "common/http/access_log/access_log_impl.h"
+#include "common/http/access_log/grpc_access_log_impl.h"
 #include "common/http/date_provider_impl.h"
 #include "common/http/http1/codec_impl.h"
 #include "common/http/http2/codec_impl.h"
@@ -21,6 +23,7 @@
 #include "common/json/config_schemas.h"
 #include "common/protobuf/utility.h"
 #include "common/router/rds_impl.h"
+#include "common/tracing/http_tracer_impl.h"
 
 #include "spdlog/spdlog.h"
 
@@ -33,9 +36,40 @@ const std::string HttpConnectionManagerConfig::DEFAULT_SERVER_STRING = "envoy";
 // Singleton registration via macro defined in envoy/singleton/manager.h
 SINGLETON_MANAGER_REGISTRATION(date_provider);
 SINGLETON_MANAGER_REGISTRATION(route_config_provider_manager);
+SINGLETON_MANAGER_REGISTRATION(adaptive_sampler);
 
 namespace {
 
+/**
+ * Passes filters through to the connection manager while counting them.
+ */
+class FilterCountingCallbacks : public Http::FilterChainFactoryCallbacks {
+public:
+  FilterCountingCallbacks(Http::FilterChainFactoryCallbacks& callbacks) : callbacks_(callbacks) {}
+
+  // Http::FilterChainFactoryCallbacks
+  void addStreamDecoderFilter(Http::StreamDecoderFilterSharedPtr filter) override {
+    decoder_filters_++;
+    callbacks_.addStreamDecoderFilter(filter);
+  }
+  void addStreamEncoderFilter(Http::StreamEncoderFilterSharedPtr filter) override {
+    encoder_filters_++;
+    callbacks_.addStreamEncoderFilter(filter);
+  }
+  void addStreamFilter(Http::StreamFilterSharedPtr filter) override {
+    decoder_filters_++;
+    encoder_filters_++;
+    callbacks_.addStreamFilter(filter);
+  }
+  void addAccessLogHandler(Http::AccessLog::InstanceSharedPtr handler) override {
+    callbacks_.addAccessLogHandler(handler);
+  }
+
+  Http::FilterChainFactoryCallbacks& callbacks_;
+  uint32_t decoder_filters_{};
+  uint32_t encoder_filters_{};
+};
+
 NetworkFilterFactoryCb createHttpConnectionManagerFilterFactory(
     const envoy::api::v2::filter::HttpConnectionManager& http_connection_manager,
     FactoryContext& context) {
@@ -121,6 +155,8 @@ HttpConnectionManagerConfig::HttpConnectionManagerConfig(
       route_config_provider_manager_(route_config_provider_manager),
       http2_settings_(Http::Utility::parseHttp2Settings(config.http2_protocol_options())),
       http1_settings_(Http::Utility::parseHttp1Settings(config.http_protocol_options())),
+      fast_head_parser_runtime_key_(stats_prefix_ + "http1.fast_head_parser"),
+      chunk_coalesce_bytes_runtime_key_(stats_prefix_ + "http1.chunk_coalesce_bytes"),
       drain_timeout_(PROTOBUF_GET_MS_OR_DEFAULT(config, drain_timeout, 5000)),
       generate_request_id_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, generate_request_id, true)),
 
@@ -183,8 +219,15 @@ HttpConnectionManagerConfig::HttpConnectionManagerConfig(
       request_headers_for_tags.push_back(Http::LowerCaseString(header));
     }
 
+    std::shared_ptr<Tracing::AdaptiveSampler> adaptive_sampler =
+        context_.singletonManager().getTyped<Tracing::AdaptiveSampler>(
+            SINGLETON_MANAGER_REGISTERED_NAME(adaptive_sampler), [this] {
+              return std::make_shared<Tracing::AdaptiveSampler>(
+                  context_.runtime(), context_.threadLocal(), ProdMonotonicTimeSource::instance_);
+            });
+
     tracing_config_.reset(new Http::TracingConnectionManagerConfig(
-        {tracing_operation_name, request_headers_for_tags}));
+        {tracing_operation_name, request_headers_for_tags, adaptive_sampler}));
   }
 
   if (config.has_idle_timeout()) {
@@ -192,9 +235,15 @@ HttpConnectionManagerConfig::HttpConnectionManagerConfig(
   }
 
   for (const auto& access_log : config.access_log()) {
-    Http::AccessLog::InstanceSharedPtr current_access_log =
-        Http::AccessLog::InstanceImpl::fromProto(access_log, context_.runtime(),
-                                                 context_.accessLogManager());
+    Http::AccessLog::InstanceSharedPtr current_access_log;
+    if (Http::AccessLog::GrpcAccessLogImpl::isGrpcPath(access_log.path())) {
+      current_access_log = Http::AccessLog::GrpcAccessLogImpl::fromProto(
+          access_log, context_.runtime(), context_.clusterManager(), context_.threadLocal(),
+          context_.scope());
+    } else {
+      current_access_log = Http::AccessLog::InstanceImpl::fromProto(
+          access_log, context_.runtime(), context_.accessLogManager(), context_.scope());
+    }
     access_logs_.push_back(current_access_log);
   }
 
@@ -251,6 +300,9 @@ HttpConnectionManagerConfig::HttpConnectionManagerConfig(
           fmt::format("unable to create http filter factory for '{}'", string_name));
     }
   }
+
+  plain_proxy_ = filters.size() == 1 && filters[0].name() == "router" && !tracing_config_ &&
+                 access_logs_.empty();
 }
 
 Http::ServerConnectionPtr
@@ -260,7 +312,7 @@ HttpConnectionManagerConfig::createCodec(Network::Connection& connection,
   switch (codec_type_) {
   case CodecType::HTTP1:
     return Http::ServerConnectionPtr{
-        new Http::Http1::ServerConnectionImpl(connection, callbacks, http1_settings_)};
+        new Http::Http1::ServerConnectionImpl(connection, callbacks, http1Settings())};
   case CodecType::HTTP2:
     return Http::ServerConnectionPtr{new Http::Http2::ServerConnectionImpl(
         connection, callbacks, context_.scope(), http2_settings_)};
@@ -271,17 +323,55 @@ HttpConnectionManagerConfig::createCodec(Network::Connection& connection,
           connection, callbacks, context_.scope(), http2_settings_)};
     } else {
       return Http::ServerConnectionPtr{
-          new Http::Http1::ServerConnectionImpl(connection, callbacks, http1_settings_)};
+          new Http::Http1::ServerConnectionImpl(connection, callbacks, http1Settings())};
     }
   }
 
   NOT_REACHED;
 }
 
+Http::Http1Settings HttpConnectionManagerConfig::http1Settings() {
+  Http::Http1Settings settings = http1_settings_;
+  settings.fast_head_parser_ =
+      context_.runtime().snapshot().featureEnabled(fast_head_parser_runtime_key_, 0);
+  settings.chunk_coalesce_bytes_ =
+      context_.runtime().snapshot().getInteger(chunk_coalesce_bytes_runtime_key_, 0);
+  return settings;
+}
+
 void HttpConnectionManagerConfig::createFilterChain(Http::FilterChainFactoryCallbacks& callbacks) {
+  if (plain_proxy_) {
+    filter_factories_.front()(callbacks);
+    return;
+  }
+
+  if (filter_chain_size_known_) {
+    for (const HttpFilterFactoryCb& factory : filter_factories_) {
+      factory(callbacks);
+    }
+    return;
+  }
+
+  // Workers may race to build the first chain. They all arrive at the same size.
+  FilterCountingCallbacks counting_callbacks(callbacks);
   for (const HttpFilterFactoryCb& factory : filter_factories_) {
-    factory(callbacks);
+    factory(counting_callbacks);
+  }
+
+  decoder_filters_ = counting_callbacks.decoder_filters_;
+  encoder_filters_ = counting_callbacks.encoder_filters_;
+  filter_chain_size_known_ = true;
+}
+
+Http::FilterChainSize HttpConnectionManagerConfig::filterChainSize() {
+  if (!filter_chain_size_known_) {
+    // Before the first chain, one slot per configured filter factory is a good guess since most
+    // factories add exactly one filter.
+    const uint32_t size = filter_factories_.size();
+    return {size, size};
   }
+
+  return {decoder_filters_, encoder_filters_};
 }
 
 const Network::Address::Instance& HttpConnectionManagerConfig::localAddress() {
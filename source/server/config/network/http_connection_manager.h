@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <functional>
@@ -64,6 +65,7 @@ public:
 
   // Http::FilterChainFactory
   void createFilterChain(Http::FilterChainFactoryCallbacks& callbacks) override;
+  Http::FilterChainSize filterChainSize() override;
 
   // Http::ConnectionManagerConfig
   const std::list<Http::AccessLog::InstanceSharedPtr>& accessLogs() override {
@@ -91,14 +93,26 @@ public:
   }
   const Network::Address::Instance& localAddress() override;
   const Optional<std::string>& userAgent() override { return user_agent_; }
+  bool plainProxy() override { return plain_proxy_; }
 
   static const std::string DEFAULT_SERVER_STRING;
 
 private:
   enum class CodecType { HTTP1, HTTP2, AUTO };
 
+  /**
+   * @return Http::Http1Settings the settings for a new HTTP/1.1 codec. Whether the fast head parser
+   *         is used is decided per connection by runtime.
+   */
+  Http::Http1Settings http1Settings();
+
   FactoryContext& context_;
   std::list<HttpFilterFactoryCb> filter_factories_;
+  // The size of the filter chain, learned from the first chain that is built. Filter factories
+  // may add any number of filters, so the size is not known up front.
+  std::atomic<bool> filter_chain_size_known_{};
+  std::atomic<uint32_t> decoder_filters_{};
+  std::atomic<uint32_t> encoder_filters_{};
   std::list<Http::AccessLog::InstanceSharedPtr> access_logs_;
   const std::string stats_prefix_;
   Http::ConnectionManagerStats stats_;
@@ -110,6 +124,8 @@ private:
   CodecType codec_type_;
   const Http::Http2Settings http2_settings_;
   const Http::Http1Settings http1_settings_;
+  const std::string fast_head_parser_runtime_key_;
+  const std::string chunk_coalesce_bytes_runtime_key_;
   std::string server_name_;
   Http::TracingConnectionManagerConfigPtr tracing_config_;
   Optional<std::string> user_agent_;
@@ -118,6 +134,9 @@ private:
   std::chrono::milliseconds drain_timeout_;
   bool generate_request_id_;
   Http::DateProvider& date_provider_;
+  // Whether the filter chain is the router alone, without tracing or access logs, which is how
+  // most listeners are configured. @see Http::ConnectionManagerConfig::plainProxy().
+  bool plain_proxy_{};
 };
 
 } // namespace Configuration
@@ -1,11 +1,15 @@
 #include "server/config/network/mongo_proxy.h"
 
+#include <memory>
 #include <string>
 
 #include "envoy/network/connection.h"
 #include "envoy/registry/registry.h"
 
+#include "common/config/utility.h"
 #include "common/json/config_schemas.h"
+#include "common/mongo/conn_pool_impl.h"
+#include "common/mongo/multiplex_filter.h"
 #include "common/mongo/proxy.h"
 
 namespace Envoy {
@@ -29,10 +33,26 @@ MongoProxyFilterConfigFactory::createFilterFactory(const Json::Object& config,
     fault_config = std::make_shared<Mongo::FaultConfig>(*config.getObject("fault"));
   }
 
-  return [stat_prefix, &context, access_log,
-          fault_config](Network::FilterManager& filter_manager) -> void {
+  Mongo::QueryStatFamiliesSharedPtr query_stats = std::make_shared<Mongo::QueryStatFamilies>(
+      context.scope(), stat_prefix, context.threadLocal());
+
+  Mongo::ConnPool::InstanceSharedPtr conn_pool;
+  if (config.hasObject("multiplex")) {
+    Json::ObjectSharedPtr multiplex = config.getObject("multiplex");
+    const std::string cluster_name = multiplex->getString("cluster_name");
+    Config::Utility::checkCluster("mongo", cluster_name, context.clusterManager());
+    conn_pool = std::make_shared<Mongo::ConnPool::InstanceImpl>(
+        cluster_name, context.clusterManager(), context.threadLocal(),
+        multiplex->getInteger("connections", 4));
+  }
+
+  return [stat_prefix, &context, access_log, fault_config, query_stats,
+          conn_pool](Network::FilterManager& filter_manager) -> void {
     filter_manager.addFilter(std::make_shared<Mongo::ProdProxyFilter>(
-        stat_prefix, context.scope(), context.runtime(), access_log, fault_config));
+        stat_prefix, context.scope(), context.runtime(), access_log, fault_config, query_stats));
+    if (conn_pool) {
+      filter_manager.addReadFilter(std::make_shared<Mongo::MultiplexFilter>(conn_pool));
+    }
   };
 }
 
@@ -6,7 +6,11 @@
 #include "envoy/network/connection.h"
 #include "envoy/registry/registry.h"
 
+#include "common/common/utility.h"
 #include "common/filter/ratelimit.h"
+#include "common/ratelimit/local_ratelimit_impl.h"
+
+#include "spdlog/spdlog.h"
 
 namespace Envoy {
 namespace Server {
@@ -17,9 +21,21 @@ NetworkFilterFactoryCb RateLimitConfigFactory::createFilterFactory(const Json::O
   RateLimit::TcpFilter::ConfigSharedPtr config(
       new RateLimit::TcpFilter::Config(json_config, context.scope(), context.runtime()));
   const uint32_t timeout_ms = json_config.getInteger("timeout_ms", 20);
-  return [config, timeout_ms, &context](Network::FilterManager& filter_manager) -> void {
-    filter_manager.addReadFilter(Network::ReadFilterSharedPtr{new RateLimit::TcpFilter::Instance(
-        config, context.rateLimitClient(std::chrono::milliseconds(timeout_ms)))});
+  RateLimit::LocalRateLimiterSharedPtr local_limiter;
+  if (json_config.hasObject("local_rate_limit")) {
+    local_limiter.reset(new RateLimit::LocalRateLimiter(
+        *json_config.getObject("local_rate_limit"),
+        fmt::format("ratelimit.{}.", json_config.getString("stat_prefix")), context.scope(),
+        context.threadLocal(), ProdMonotonicTimeSource::instance_));
+  }
+  return [config, timeout_ms, local_limiter,
+          &context](Network::FilterManager& filter_manager) -> void {
+    RateLimit::ClientPtr client = context.rateLimitClient(std::chrono::milliseconds(timeout_ms));
+    if (local_limiter) {
+      client.reset(new RateLimit::LocalClientImpl(local_limiter, std::move(client)));
+    }
+    filter_manager.addReadFilter(Network::ReadFilterSharedPtr{
+        new RateLimit::TcpFilter::Instance(config, std::move(client))});
   };
 }
 
@@ -5,9 +5,12 @@
 
 #include "envoy/registry/registry.h"
 
+#include "common/common/utility.h"
+
 #include "common/redis/codec_impl.h"
 #include "common/redis/command_splitter_impl.h"
 #include "common/redis/conn_pool_impl.h"
+#include "common/redis/key_cache.h"
 #include "common/redis/proxy_filter.h"
 
 namespace Envoy {
@@ -24,12 +27,21 @@ RedisProxyFilterConfigFactory::createFilterFactory(const Json::Object& config,
                                         Redis::ConnPool::ClientFactoryImpl::instance_,
                                         context.threadLocal(), *config.getObject("conn_pool")));
   std::shared_ptr<Redis::CommandSplitter::Instance> splitter(
-      new Redis::CommandSplitter::InstanceImpl(std::move(conn_pool), context.scope(),
-                                               filter_config->statPrefix()));
-  return [splitter, filter_config](Network::FilterManager& filter_manager) -> void {
-    Redis::DecoderFactoryImpl factory;
+      new Redis::CommandSplitter::InstanceImpl(
+          std::move(conn_pool), context.scope(), filter_config->statPrefix(),
+          ProdMonotonicTimeSource::instance_, filter_config->slowCommandThreshold(),
+          filter_config->slowCommandSampleOneIn()));
+  Redis::KeyCacheSharedPtr key_cache;
+  if (config.hasObject("cache")) {
+    key_cache = std::make_shared<Redis::KeyCache>(
+        *config.getObject("cache"), filter_config->statPrefix(), context.scope(),
+        context.threadLocal(), ProdMonotonicTimeSource::instance_, context.admin());
+  }
+  return [splitter, filter_config, key_cache](Network::FilterManager& filter_manager) -> void {
+    Redis::DecoderFactoryImpl factory(true);
     filter_manager.addReadFilter(std::make_shared<Redis::ProxyFilter>(
-        factory, Redis::EncoderPtr{new Redis::EncoderImpl()}, *splitter, filter_config));
+        factory, Redis::EncoderPtr{new Redis::EncoderImpl()}, *splitter, filter_config,
+        key_cache));
   };
 }
 
@@ -8,6 +8,12 @@ AsyncClient::Request* ValidationAsyncClient::send(MessagePtr&&, Callbacks&,
   return nullptr;
 }
 
+AsyncClient::Request* ValidationAsyncClient::sendDirect(MessagePtr&&, Callbacks&,
+                                                        const Optional<std::chrono::milliseconds>&,
+                                                        const std::string&) {
+  return nullptr;
+}
+
 AsyncClient::Stream* ValidationAsyncClient::start(StreamCallbacks&,
                                                   const Optional<std::chrono::milliseconds>&) {
   return nullptr;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <string>
 
 #include "envoy/http/async_client.h"
 #include "envoy/http/message.h"
@@ -11,8 +12,8 @@ namespace Envoy {
 namespace Http {
 
 /**
- * Config-validation-only implementation of AsyncClient. Both methods on AsyncClient are allowed to
- * return nullptr if the request can't be created, so that's what the ValidationAsyncClient does in
+ * Config-validation-only implementation of AsyncClient. All methods on AsyncClient that create a
+ * request or stream are allowed to return nullptr, so that's what the ValidationAsyncClient does in
  * all cases.
  */
 class ValidationAsyncClient : public AsyncClient {
@@ -20,6 +21,9 @@ public:
   // Http::AsyncClient
   AsyncClient::Request* send(MessagePtr&&, Callbacks&,
                              const Optional<std::chrono::milliseconds>&) override;
+  AsyncClient::Request* sendDirect(MessagePtr&&, Callbacks&,
+                                   const Optional<std::chrono::milliseconds>&,
+                                   const std::string&) override;
   AsyncClient::Stream* start(StreamCallbacks&, const Optional<std::chrono::milliseconds>&) override;
   Event::Dispatcher& dispatcher() override { NOT_IMPLEMENTED; }
 };
@@ -42,11 +42,22 @@ ValidationClusterManager::httpConnPoolForCluster(const std::string&, ResourcePri
   return nullptr;
 }
 
+Http::ConnectionPool::Instance*
+ValidationClusterManager::httpConnPoolForClusterId(uint32_t, ResourcePriority,
+                                                   LoadBalancerContext*) {
+  return nullptr;
+}
+
 Host::CreateConnectionData ValidationClusterManager::tcpConnForCluster(const std::string&,
                                                                        LoadBalancerContext*) {
   return Host::CreateConnectionData{nullptr, nullptr};
 }
 
+Host::CreateConnectionData
+ValidationClusterManager::prewarmedTcpConnForCluster(const std::string&, LoadBalancerContext*) {
+  return Host::CreateConnectionData{nullptr, nullptr};
+}
+
 Http::AsyncClient& ValidationClusterManager::httpAsyncClientForCluster(const std::string&) {
   return async_client_;
 }
@@ -49,7 +49,11 @@ public:
 
   Http::ConnectionPool::Instance* httpConnPoolForCluster(const std::string&, ResourcePriority,
                                                          LoadBalancerContext*) override;
+  Http::ConnectionPool::Instance* httpConnPoolForClusterId(uint32_t, ResourcePriority,
+                                                           LoadBalancerContext*) override;
   Host::CreateConnectionData tcpConnForCluster(const std::string&, LoadBalancerContext*) override;
+  Host::CreateConnectionData prewarmedTcpConnForCluster(const std::string&,
+                                                        LoadBalancerContext*) override;
   Http::AsyncClient& httpAsyncClientForCluster(const std::string&) override;
 
 private:
@@ -1,5 +1,12 @@
 #include "server/config_validation/server.h"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/common/thread.h"
 #include "common/common/version.h"
 #include "common/config/bootstrap_json.h"
 #include "common/local_info/local_info_impl.h"
@@ -13,15 +20,21 @@
 namespace Envoy {
 namespace Server {
 
-bool validateConfig(Options& options, Network::Address::InstanceConstSharedPtr local_address,
-                    ComponentFactory& component_factory) {
+namespace {
+
+bool validateConfigFile(Options& options, const std::string& config_path,
+                        Network::Address::InstanceConstSharedPtr local_address,
+                        ComponentFactory& component_factory, std::mutex& output_lock) {
   Thread::MutexBasicLockable access_log_lock;
   Stats::IsolatedStoreImpl stats_store;
 
   try {
-    ValidationInstance server(options, local_address, stats_store, access_log_lock,
+    ValidationInstance server(options, config_path, local_address, stats_store, access_log_lock,
                               component_factory);
-    std::cout << "configuration '" << options.configPath() << "' OK" << std::endl;
+    {
+      std::lock_guard<std::mutex> guard(output_lock);
+      std::cout << "configuration '" << config_path << "' OK" << std::endl;
+    }
     server.shutdown();
     return true;
   } catch (const EnvoyException& e) {
@@ -29,7 +42,46 @@ bool validateConfig(Options& options, Network::Address::InstanceConstSharedPtr l
   }
 }
 
-ValidationInstance::ValidationInstance(Options& options,
+} // namespace
+
+bool validateConfig(Options& options, Network::Address::InstanceConstSharedPtr local_address,
+                    ComponentFactory& component_factory) {
+  std::vector<std::string> config_paths{options.configPath()};
+  config_paths.insert(config_paths.end(), options.additionalConfigPaths().begin(),
+                      options.additionalConfigPaths().end());
+  if (config_paths.size() > 1 && config_paths.front().empty()) {
+    // Files may be given without --config-path.
+    config_paths.erase(config_paths.begin());
+  }
+
+  // Each ValidationInstance only uses objects of its own, and the thread it runs on as its main
+  // thread, so files are validated on several threads at once with only their output serialized.
+  std::mutex output_lock;
+  std::atomic<size_t> next_config{0};
+  std::atomic<bool> valid{true};
+  const auto validate = [&]() -> void {
+    for (size_t i = next_config++; i < config_paths.size(); i = next_config++) {
+      if (!validateConfigFile(options, config_paths[i], local_address, component_factory,
+                              output_lock)) {
+        valid = false;
+      }
+    }
+  };
+
+  const size_t num_threads =
+      std::min<size_t>(std::max(1U, options.concurrency()), config_paths.size());
+  std::vector<Thread::ThreadPtr> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(new Thread::Thread(validate));
+  }
+  validate();
+  for (Thread::ThreadPtr& thread : threads) {
+    thread->join();
+  }
+  return valid;
+}
+
+ValidationInstance::ValidationInstance(Options& options, const std::string& config_path,
                                        Network::Address::InstanceConstSharedPtr local_address,
                                        Stats::IsolatedStoreImpl& store,
                                        Thread::BasicLockable& access_log_lock,
@@ -40,16 +92,15 @@ ValidationInstance::ValidationInstance(Options& options,
       access_log_manager_(*api_, *dispatcher_, access_log_lock, store),
       listener_manager_(*this, *this, *this) {
   try {
-    initialize(options, local_address, component_factory);
+    initialize(options, config_path, local_address, component_factory);
   } catch (const EnvoyException& e) {
-    ENVOY_LOG(critical, "error initializing configuration '{}': {}", options.configPath(),
-              e.what());
+    ENVOY_LOG(critical, "error initializing configuration '{}': {}", config_path, e.what());
     thread_local_.shutdownThread();
     throw;
   }
 }
 
-void ValidationInstance::initialize(Options& options,
+void ValidationInstance::initialize(Options& options, const std::string& config_path,
                                     Network::Address::InstanceConstSharedPtr local_address,
                                     ComponentFactory& component_factory) {
   // See comments on InstanceImpl::initialize() for the overall flow here.
@@ -64,13 +115,13 @@ void ValidationInstance::initialize(Options& options,
   // Handle configuration that needs to take place prior to the main configuration load.
   envoy::api::v2::Bootstrap bootstrap;
   try {
-    MessageUtil::loadFromFile(options.configPath(), bootstrap);
+    MessageUtil::loadFromFile(config_path, bootstrap);
   } catch (const EnvoyException& e) {
     // TODO(htuch): When v1 is deprecated, make this a warning encouraging config upgrade.
     ENVOY_LOG(debug, "Unable to initialize config as v2, will retry as v1: {}", e.what());
   }
   if (!bootstrap.has_admin()) {
-    Json::ObjectSharedPtr config_json = Json::Factory::loadFromFile(options.configPath());
+    Json::ObjectSharedPtr config_json = Json::Factory::loadFromFile(config_path);
     Config::BootstrapJson::translateBootstrap(*config_json, bootstrap);
   }
   bootstrap.mutable_node()->set_build_version(VersionInfo::version());
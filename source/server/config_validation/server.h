@@ -29,7 +29,9 @@ namespace Server {
 
 /**
  * validateConfig() takes over from main() for a config-validation run of Envoy. It returns true if
- * the config is valid, false if invalid.
+ * the config is valid, false if invalid. When more than one config file is given, they are
+ * validated independently of each other on up to Options::concurrency() threads, and the result is
+ * true only if all of them are valid.
  */
 bool validateConfig(Options& options, Network::Address::InstanceConstSharedPtr local_address,
                     ComponentFactory& component_factory);
@@ -51,7 +53,8 @@ class ValidationInstance : Logger::Loggable<Logger::Id::main>,
                            public ListenerComponentFactory,
                            public WorkerFactory {
 public:
-  ValidationInstance(Options& options, Network::Address::InstanceConstSharedPtr local_address,
+  ValidationInstance(Options& options, const std::string& config_path,
+                     Network::Address::InstanceConstSharedPtr local_address,
                      Stats::IsolatedStoreImpl& store, Thread::BasicLockable& access_log_lock,
                      ComponentFactory& component_factory);
 
@@ -83,6 +86,7 @@ public:
   Options& options() override { return options_; }
   time_t startTimeCurrentEpoch() override { NOT_IMPLEMENTED; }
   time_t startTimeFirstEpoch() override { NOT_IMPLEMENTED; }
+  const StartupPhaseTimes& startupPhaseTimes() override { NOT_IMPLEMENTED; }
   Stats::Store& stats() override { return stats_store_; }
   Tracing::HttpTracer& httpTracer() override { return config_->httpTracer(); }
   ThreadLocal::Instance& threadLocal() override { return thread_local_; }
@@ -100,18 +104,24 @@ public:
     // validation mock.
     return nullptr;
   }
+  std::vector<Network::ListenSocketSharedPtr>
+  createReusePortListenSockets(Network::Address::InstanceConstSharedPtr, uint32_t count) override {
+    // As above, returned sockets are not used.
+    return std::vector<Network::ListenSocketSharedPtr>(count);
+  }
   DrainManagerPtr createDrainManager() override { return nullptr; }
   uint64_t nextListenerTag() override { return 0; }
 
   // Server::WorkerFactory
-  WorkerPtr createWorker() override {
+  WorkerPtr createWorker(uint32_t) override {
     // Returned workers are not currently used so we can return nothing here safely vs. a
     // validation mock.
     return nullptr;
   }
 
 private:
-  void initialize(Options& options, Network::Address::InstanceConstSharedPtr local_address,
+  void initialize(Options& options, const std::string& config_path,
+                  Network::Address::InstanceConstSharedPtr local_address,
                   ComponentFactory& component_factory);
 
   Options& options_;
@@ -57,9 +57,29 @@ void MainImpl::initialize(const envoy::api::v2::Bootstrap& bootstrap, Instance&
 
   for (const auto& stats_sink : bootstrap.stats_sinks()) {
     // TODO(mrice32): Add support for pluggable stats sinks.
+    if (stats_sink.name() == "envoy.metrics_service") {
+      // The metrics service sink has no message in the API, its config just names the cluster.
+      auto cluster_name = stats_sink.config().fields().find("cluster_name");
+      if (cluster_name == stats_sink.config().fields().end() ||
+          cluster_manager_->get(cluster_name->second.string_value()) == nullptr) {
+        throw EnvoyException("metrics service sink must name a cluster manager cluster");
+      }
+      metrics_service_cluster_name_.value(cluster_name->second.string_value());
+      continue;
+    }
+
     ASSERT(stats_sink.name() == "envoy.statsd");
+    // The max packet size is not part of the StatsdSink message, so it is taken out of the config
+    // before the conversion.
+    ProtobufWkt::Struct config = stats_sink.config();
+    auto max_packet_size = config.fields().find("max_packet_size");
+    if (max_packet_size != config.fields().end()) {
+      statsd_udp_max_packet_size_ = static_cast<uint64_t>(max_packet_size->second.number_value());
+      config.mutable_fields()->erase("max_packet_size");
+    }
+
     envoy::api::v2::StatsdSink statsd_sink;
-    MessageUtil::jsonConvert(stats_sink.config(), statsd_sink);
+    MessageUtil::jsonConvert(config, statsd_sink);
 
     switch (statsd_sink.statsd_specifier_case()) {
     case envoy::api::v2::StatsdSink::kAddress: {
@@ -90,8 +110,8 @@ void MainImpl::initialize(const envoy::api::v2::Bootstrap& bootstrap, Instance&
   initializeTracers(bootstrap.tracing(), server);
 
   if (bootstrap.has_rate_limit_service()) {
-    ratelimit_client_factory_.reset(
-        new RateLimit::GrpcFactoryImpl(bootstrap.rate_limit_service(), *cluster_manager_));
+    ratelimit_client_factory_.reset(new RateLimit::GrpcFactoryImpl(
+        bootstrap.rate_limit_service(), *cluster_manager_, server.threadLocal(), server.runtime()));
   } else {
     ratelimit_client_factory_.reset(new RateLimit::NullFactoryImpl());
   }
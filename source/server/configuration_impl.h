@@ -92,6 +92,10 @@ public:
   Network::Address::InstanceConstSharedPtr statsdUdpIpAddress() override {
     return statsd_udp_ip_address_;
   }
+  uint64_t statsdUdpMaxPacketSize() override { return statsd_udp_max_packet_size_; }
+  Optional<std::string> metricsServiceClusterName() override {
+    return metrics_service_cluster_name_;
+  }
   std::chrono::milliseconds statsFlushInterval() override { return stats_flush_interval_; }
   std::chrono::milliseconds wdMissTimeout() const override { return watchdog_miss_timeout_; }
   std::chrono::milliseconds wdMegaMissTimeout() const override {
@@ -113,6 +117,8 @@ private:
   Tracing::HttpTracerPtr http_tracer_;
   Optional<std::string> statsd_tcp_cluster_name_;
   Network::Address::InstanceConstSharedPtr statsd_udp_ip_address_;
+  uint64_t statsd_udp_max_packet_size_{};
+  Optional<std::string> metrics_service_cluster_name_;
   RateLimit::ClientFactoryPtr ratelimit_client_factory_;
   std::chrono::milliseconds stats_flush_interval_;
   std::chrono::milliseconds watchdog_miss_timeout_;
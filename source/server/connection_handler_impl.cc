@@ -1,5 +1,11 @@
 #include "server/connection_handler_impl.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 #include "envoy/event/dispatcher.h"
 #include "envoy/event/timer.h"
 #include "envoy/network/filter.h"
@@ -7,15 +13,48 @@
 namespace Envoy {
 namespace Server {
 
+ConnectionHandlerImpl* ConnectionBalancer::pickTarget(ConnectionHandlerImpl& handler,
+                                                      uint32_t threshold) {
+  const uint64_t local = handler.numConnections();
+  uint64_t total = 0;
+  uint64_t least = std::numeric_limits<uint64_t>::max();
+  ConnectionHandlerImpl* least_loaded = nullptr;
+  for (ConnectionHandlerImpl* candidate : handlers_) {
+    const uint64_t connections = candidate->numConnections();
+    total += connections;
+    if (connections < least) {
+      least = connections;
+      least_loaded = candidate;
+    }
+  }
+
+  // Compare against the average without dividing: local > total / size * (100 + threshold) / 100.
+  // Moving the connection must also leave the target with fewer connections than we have.
+  if (local * handlers_.size() * 100 <= total * (100 + threshold) || least + 1 >= local) {
+    return nullptr;
+  }
+  return least_loaded;
+}
+
 ConnectionHandlerImpl::ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher)
     : logger_(logger), dispatcher_(dispatcher) {}
 
+ConnectionHandlerImpl::ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher,
+                                             ConnectionBalancer& balancer,
+                                             Stats::Gauge& cx_active)
+    : logger_(logger), dispatcher_(dispatcher), balancer_(&balancer), cx_active_(&cx_active) {
+  balancer.registerHandler(*this);
+}
+
 void ConnectionHandlerImpl::addListener(Network::FilterChainFactory& factory,
                                         Network::ListenSocket& socket, Stats::Scope& scope,
                                         uint64_t listener_tag,
                                         const Network::ListenerOptions& listener_options) {
   ActiveListenerPtr l(
       new ActiveListener(*this, socket, factory, scope, listener_tag, listener_options));
+  if (listeners_disabled_) {
+    l->listener_->disable();
+  }
   listeners_.emplace_back(socket.localAddress(), std::move(l));
 }
 
@@ -26,6 +65,9 @@ void ConnectionHandlerImpl::addSslListener(Network::FilterChainFactory& factory,
                                            const Network::ListenerOptions& listener_options) {
   ActiveListenerPtr l(new SslActiveListener(*this, ssl_ctx, socket, factory, scope, listener_tag,
                                             listener_options));
+  if (listeners_disabled_) {
+    l->listener_->disable();
+  }
   listeners_.emplace_back(socket.localAddress(), std::move(l));
 }
 
@@ -53,6 +95,87 @@ void ConnectionHandlerImpl::stopListeners() {
   }
 }
 
+void ConnectionHandlerImpl::applyOverloadActions(const Network::OverloadActions& actions) {
+  if (actions.stop_accepting_ != listeners_disabled_) {
+    listeners_disabled_ = actions.stop_accepting_;
+    ENVOY_LOG_TO_LOGGER(logger_, warn, "{} accepting connections due to overload",
+                        listeners_disabled_ ? "stopped" : "resumed");
+    for (auto& listener : listeners_) {
+      if (!listener.second->listener_) {
+        continue;
+      }
+
+      if (listeners_disabled_) {
+        listener.second->listener_->disable();
+      } else {
+        listener.second->listener_->enable();
+      }
+    }
+  }
+
+  if (actions.buffer_limit_percent_ != buffer_limit_percent_) {
+    buffer_limit_percent_ = actions.buffer_limit_percent_;
+    for (auto& listener : listeners_) {
+      for (ActiveConnectionPtr& connection : listener.second->connections_) {
+        listener.second->applyBufferLimits(*connection->connection_);
+      }
+    }
+  }
+
+  if (actions.shed_bytes_ > 0) {
+    shedConnections(actions.shed_bytes_);
+  }
+}
+
+void ConnectionHandlerImpl::newBalancedConnection(
+    uint64_t listener_tag, int fd, Network::Address::InstanceConstSharedPtr remote_address,
+    Network::Address::InstanceConstSharedPtr local_address, bool using_original_dst) {
+  for (auto& listener : listeners_) {
+    if (listener.second->listener_tag_ == listener_tag && listener.second->listener_) {
+      listener.second->listener_->newConnection(fd, remote_address, local_address,
+                                                using_original_dst);
+      return;
+    }
+  }
+
+  // The listener was stopped or removed on this worker while the socket was in flight.
+  ENVOY_LOG_TO_LOGGER(logger_, debug, "closing balanced socket for missing listener {}",
+                      listener_tag);
+  ::close(fd);
+}
+
+void ConnectionHandlerImpl::shedConnections(uint64_t bytes) {
+  typedef std::pair<uint64_t, ActiveConnection*> Candidate;
+  std::vector<Candidate> candidates;
+  for (auto& listener : listeners_) {
+    for (ActiveConnectionPtr& connection : listener.second->connections_) {
+      candidates.emplace_back(connection->connection_->bufferedBytes(), connection.get());
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& lhs, const Candidate& rhs) { return lhs.first > rhs.first; });
+
+  // Closing a connection only defers its deletion, so the remaining candidates stay valid.
+  uint64_t freed = 0;
+  for (auto& candidate : candidates) {
+    if (freed >= bytes || candidate.first == 0) {
+      break;
+    }
+
+    ENVOY_CONN_LOG_TO_LOGGER(logger_, warn, "closing due to buffer memory overload ({} bytes)",
+                             *candidate.second->connection_, candidate.first);
+    candidate.second->listener_.stats_.downstream_cx_overload_shed_.inc();
+    candidate.second->connection_->close(Network::ConnectionCloseType::NoFlush);
+    freed += candidate.first;
+  }
+}
+
+void ConnectionHandlerImpl::ActiveListener::applyBufferLimits(Network::Connection& connection) {
+  connection.setBufferLimits(static_cast<uint64_t>(per_connection_buffer_limit_bytes_) *
+                             parent_.buffer_limit_percent_ / 100);
+}
+
 void ConnectionHandlerImpl::ActiveListener::removeConnection(ActiveConnection& connection) {
   ENVOY_CONN_LOG_TO_LOGGER(parent_.logger_, info, "adding to cleanup list",
                            *connection.connection_);
@@ -60,6 +183,36 @@ void ConnectionHandlerImpl::ActiveListener::removeConnection(ActiveConnection& c
   parent_.dispatcher_.deferredDelete(std::move(removed));
   ASSERT(parent_.num_connections_ > 0);
   parent_.num_connections_--;
+  if (parent_.cx_active_) {
+    parent_.cx_active_->dec();
+  }
+}
+
+bool ConnectionHandlerImpl::ActiveListener::onAccept(
+    int fd, Network::Address::InstanceConstSharedPtr remote_address,
+    Network::Address::InstanceConstSharedPtr local_address, bool using_original_dst) {
+  if (connection_balance_threshold_ == 0 || !parent_.balancer_) {
+    return false;
+  }
+
+  ConnectionHandlerImpl* target =
+      parent_.balancer_->pickTarget(parent_, connection_balance_threshold_);
+  if (!target) {
+    return false;
+  }
+
+  // Count the connection against the target right away so that a burst of accepts does not keep
+  // picking the same target before it gets to create the connections.
+  target->num_connections_++;
+  stats_.downstream_cx_balanced_.inc();
+  const uint64_t listener_tag = listener_tag_;
+  target->dispatcher_.post(
+      [target, listener_tag, fd, remote_address, local_address, using_original_dst]() -> void {
+        target->num_connections_--;
+        target->newBalancedConnection(listener_tag, fd, remote_address, local_address,
+                                      using_original_dst);
+      });
+  return true;
 }
 
 ConnectionHandlerImpl::ActiveListener::ActiveListener(
@@ -68,14 +221,16 @@ ConnectionHandlerImpl::ActiveListener::ActiveListener(
     const Network::ListenerOptions& listener_options)
     : ActiveListener(
           parent, parent.dispatcher_.createListener(parent, socket, *this, scope, listener_options),
-          factory, scope, listener_tag) {}
+          factory, scope, listener_tag, listener_options) {}
 
-ConnectionHandlerImpl::ActiveListener::ActiveListener(ConnectionHandlerImpl& parent,
-                                                      Network::ListenerPtr&& listener,
-                                                      Network::FilterChainFactory& factory,
-                                                      Stats::Scope& scope, uint64_t listener_tag)
+ConnectionHandlerImpl::ActiveListener::ActiveListener(
+    ConnectionHandlerImpl& parent, Network::ListenerPtr&& listener,
+    Network::FilterChainFactory& factory, Stats::Scope& scope, uint64_t listener_tag,
+    const Network::ListenerOptions& listener_options)
     : parent_(parent), factory_(factory), listener_(std::move(listener)),
-      stats_(generateStats(scope)), listener_tag_(listener_tag) {}
+      stats_(generateStats(scope)), listener_tag_(listener_tag),
+      per_connection_buffer_limit_bytes_(listener_options.per_connection_buffer_limit_bytes_),
+      connection_balance_threshold_(listener_options.connection_balance_threshold_) {}
 
 ConnectionHandlerImpl::ActiveListener::~ActiveListener() {
   while (!connections_.empty()) {
@@ -92,7 +247,7 @@ ConnectionHandlerImpl::SslActiveListener::SslActiveListener(
     : ActiveListener(parent,
                      parent.dispatcher_.createSslListener(parent, ssl_ctx, socket, *this, scope,
                                                           listener_options),
-                     factory, scope, listener_tag) {}
+                     factory, scope, listener_tag, listener_options) {}
 
 Network::Listener*
 ConnectionHandlerImpl::findListenerByAddress(const Network::Address::Instance& address) {
@@ -137,9 +292,15 @@ void ConnectionHandlerImpl::ActiveListener::onNewConnection(
                                *new_connection);
       new_connection->close(Network::ConnectionCloseType::NoFlush);
     } else {
+      if (parent_.buffer_limit_percent_ != 100) {
+        applyBufferLimits(*new_connection);
+      }
       ActiveConnectionPtr active_connection(new ActiveConnection(*this, std::move(new_connection)));
       active_connection->moveIntoList(std::move(active_connection), connections_);
       parent_.num_connections_++;
+      if (parent_.cx_active_) {
+        parent_.cx_active_->inc();
+      }
     }
   }
 }
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "envoy/common/time.h"
 #include "envoy/event/deferred_deletable.h"
@@ -12,9 +13,11 @@
 #include "envoy/network/filter.h"
 #include "envoy/network/listen_socket.h"
 #include "envoy/network/listener.h"
+#include "envoy/stats/stats.h"
 
 #include "common/common/linked_object.h"
 #include "common/common/non_copyable.h"
+#include "common/common/recycler.h"
 
 #include "spdlog/spdlog.h"
 
@@ -25,6 +28,8 @@ namespace Server {
 #define ALL_LISTENER_STATS(COUNTER, GAUGE, TIMER)                                                  \
   COUNTER(downstream_cx_total)                                                                     \
   COUNTER(downstream_cx_destroy)                                                                   \
+  COUNTER(downstream_cx_overload_shed)                                                             \
+  COUNTER(downstream_cx_balanced)                                                                  \
   GAUGE  (downstream_cx_active)                                                                    \
   TIMER  (downstream_cx_length_ms)
 // clang-format on
@@ -36,6 +41,30 @@ struct ListenerStats {
   ALL_LISTENER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT, GENERATE_TIMER_STRUCT)
 };
 
+class ConnectionHandlerImpl;
+
+/**
+ * Balances long lived connections across the connection handlers of all workers. A worker that
+ * accepts a socket while it has noticeably more connections than the average worker hands the
+ * socket to the least loaded worker, which then creates the connection. Handlers register while
+ * workers are created, before any worker starts, so the handler list is read without locking.
+ */
+class ConnectionBalancer {
+public:
+  void registerHandler(ConnectionHandlerImpl& handler) { handlers_.push_back(&handler); }
+
+  /**
+   * @param handler supplies the handler that accepted a socket.
+   * @param threshold supplies how far above the average number of connections, in percent, the
+   *        handler must be before sockets are moved away from it.
+   * @return ConnectionHandlerImpl* the handler to move the socket to or nullptr to keep it.
+   */
+  ConnectionHandlerImpl* pickTarget(ConnectionHandlerImpl& handler, uint32_t threshold);
+
+private:
+  std::vector<ConnectionHandlerImpl*> handlers_;
+};
+
 /**
  * Server side connection handler. This is used both by workers as well as the
  * main thread for non-threaded listeners.
@@ -44,6 +73,15 @@ class ConnectionHandlerImpl : public Network::ConnectionHandler, NonCopyable {
 public:
   ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher);
 
+  /**
+   * Create a worker's connection handler.
+   * @param balancer supplies the balancer shared with the other workers' handlers. The handler
+   *        registers itself with it.
+   * @param cx_active supplies the gauge tracking the worker's active connections.
+   */
+  ConnectionHandlerImpl(spdlog::logger& logger, Event::Dispatcher& dispatcher,
+                        ConnectionBalancer& balancer, Stats::Gauge& cx_active);
+
   // Network::ConnectionHandler
   uint64_t numConnections() override { return num_connections_; }
   void addListener(Network::FilterChainFactory& factory, Network::ListenSocket& socket,
@@ -56,6 +94,7 @@ public:
   void removeListeners(uint64_t listener_tag) override;
   void stopListeners(uint64_t listener_tag) override;
   void stopListeners() override;
+  void applyOverloadActions(const Network::OverloadActions& actions) override;
 
 private:
   struct ActiveConnection;
@@ -70,11 +109,19 @@ private:
                    const Network::ListenerOptions& listener_options);
 
     ActiveListener(ConnectionHandlerImpl& parent, Network::ListenerPtr&& listener,
-                   Network::FilterChainFactory& factory, Stats::Scope& scope,
-                   uint64_t listener_tag);
+                   Network::FilterChainFactory& factory, Stats::Scope& scope, uint64_t listener_tag,
+                   const Network::ListenerOptions& listener_options);
 
     ~ActiveListener();
 
+    /**
+     * Fires when a socket is accepted by the listener. Hands the socket to another worker if
+     * connection balancing is enabled and this worker has too many connections.
+     */
+    bool onAccept(int fd, Network::Address::InstanceConstSharedPtr remote_address,
+                  Network::Address::InstanceConstSharedPtr local_address,
+                  bool using_original_dst) override;
+
     /**
      * Fires when a new connection is received from the listener.
      * @param new_connection supplies the connection to take control of.
@@ -87,12 +134,20 @@ private:
      */
     void removeConnection(ActiveConnection& connection);
 
+    /**
+     * Set the buffer limits of a connection to the configured limit scaled by the handler's
+     * current buffer limit percentage.
+     */
+    void applyBufferLimits(Network::Connection& connection);
+
     ConnectionHandlerImpl& parent_;
     Network::FilterChainFactory& factory_;
     Network::ListenerPtr listener_;
     ListenerStats stats_;
     std::list<ActiveConnectionPtr> connections_;
     const uint64_t listener_tag_;
+    const uint32_t per_connection_buffer_limit_bytes_;
+    const uint32_t connection_balance_threshold_;
   };
 
   struct SslActiveListener : public ActiveListener {
@@ -109,7 +164,8 @@ private:
    */
   struct ActiveConnection : LinkedObject<ActiveConnection>,
                             public Event::DeferredDeletable,
-                            public Network::ConnectionCallbacks {
+                            public Network::ConnectionCallbacks,
+                            public Recycled {
     ActiveConnection(ActiveListener& listener, Network::ConnectionPtr&& new_connection);
     ~ActiveConnection();
 
@@ -131,10 +187,30 @@ private:
 
   static ListenerStats generateStats(Stats::Scope& scope);
 
+  /**
+   * Create a connection for a socket handed over by another worker's handler.
+   */
+  void newBalancedConnection(uint64_t listener_tag, int fd,
+                             Network::Address::InstanceConstSharedPtr remote_address,
+                             Network::Address::InstanceConstSharedPtr local_address,
+                             bool using_original_dst);
+
+  /**
+   * Close the connections with the most buffered data until at least bytes have been freed.
+   */
+  void shedConnections(uint64_t bytes);
+
   spdlog::logger& logger_;
   Event::Dispatcher& dispatcher_;
   std::list<std::pair<Network::Address::InstanceConstSharedPtr, ActiveListenerPtr>> listeners_;
+  // Read by other workers' handlers when balancing connections.
   std::atomic<uint64_t> num_connections_{};
+  // Only set for workers' handlers.
+  ConnectionBalancer* balancer_{};
+  Stats::Gauge* cx_active_{};
+  // Overload state set by applyOverloadActions().
+  bool listeners_disabled_{};
+  uint32_t buffer_limit_percent_{100};
 };
 
 } // Server
@@ -1,5 +1,6 @@
 #include "server/drain_manager_impl.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <functional>
@@ -10,6 +11,7 @@
 #include "envoy/server/instance.h"
 
 #include "common/common/assert.h"
+#include "common/common/utility.h"
 
 namespace Envoy {
 namespace Server {
@@ -33,7 +35,30 @@ bool DrainManagerImpl::drainClose() const {
 
   // We use the tick time as in increasing chance that we shutdown connections.
   return static_cast<uint64_t>(drain_time_completed_.count()) >
-         (server_.random().random() % server_.options().drainTime().count());
+             (server_.random().random() % server_.options().drainTime().count()) &&
+         acquireDrainClose();
+}
+
+bool DrainManagerImpl::acquireDrainClose() const {
+  const uint64_t rate = server_.options().drainCloseRate();
+  if (rate == 0) {
+    return true;
+  }
+
+  // A token bucket per worker that holds at most one second worth of drain closes.
+  static thread_local double tokens = 0;
+  static thread_local MonotonicTime last_refill;
+  const MonotonicTime now = ProdMonotonicTimeSource::instance_.currentTime();
+  const double elapsed_seconds =
+      std::chrono::duration_cast<std::chrono::duration<double>>(now - last_refill).count();
+  tokens = std::min<double>(rate, tokens + elapsed_seconds * rate);
+  last_refill = now;
+  if (tokens < 1) {
+    return false;
+  }
+
+  tokens--;
+  return true;
 }
 
 void DrainManagerImpl::drainSequenceTick() {
@@ -16,6 +16,8 @@ namespace Server {
  * 1) Terminates the parent process after 15 minutes.
  * 2) Drains the parent process over a period of 10 minutes where drain close becomes more
  *    likely each second that passes.
+ * 3) Optionally limits the rate at which each worker drain closes connections, so that clients
+ *    reconnect to the new process evenly over the drain time.
  */
 class DrainManagerImpl : Logger::Loggable<Logger::Id::main>, public DrainManager {
 public:
@@ -27,6 +29,11 @@ public:
   void startParentShutdownSequence() override;
 
 private:
+  /**
+   * @return bool whether the worker that calls it may drain close another connection now. All
+   *         drain managers of a worker share its rate.
+   */
+  bool acquireDrainClose() const;
   bool draining() const { return drain_tick_timer_ != nullptr; }
   void drainSequenceTick();
 
@@ -6,14 +6,18 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
+#include <unordered_set>
 
 #include "envoy/event/dispatcher.h"
 #include "envoy/event/file_event.h"
 #include "envoy/server/instance.h"
 #include "envoy/server/options.h"
+#include "envoy/upstream/cluster_manager.h"
 
 #include "common/common/utility.h"
 #include "common/network/utility.h"
@@ -25,7 +29,9 @@ namespace Server {
 
 // Increment this whenever there is a shared memory / RPC change that will prevent a hot restart
 // from working. Operations code can then cope with this and do a full restart.
-const uint64_t SharedMemory::VERSION = 8;
+const uint64_t SharedMemory::VERSION = 12;
+
+const uint64_t SharedMemorySymbolTable::MAX_SLOTS;
 
 SharedMemory& SharedMemory::initialize(Options& options) {
   int flags = O_RDWR;
@@ -43,25 +49,38 @@ SharedMemory& SharedMemory::initialize(Options& options) {
     PANIC(fmt::format("cannot open shared memory region {} check user permissions", shmem_name));
   }
 
+  uint64_t size;
   if (options.restartEpoch() == 0) {
-    int rc = ftruncate(shmem_fd, sizeof(SharedMemory));
+    SharedMemory layout;
+    layout.initializeLayout(options.maxStats());
+    size = layout.size_;
+    int rc = ftruncate(shmem_fd, size);
     RELEASE_ASSERT(rc != -1);
     UNREFERENCED_PARAMETER(rc);
+  } else {
+    // The size of the segment was chosen by the first process, and is read from its header.
+    SharedMemory* header = reinterpret_cast<SharedMemory*>(
+        mmap(nullptr, sizeof(SharedMemory), PROT_READ, MAP_SHARED, shmem_fd, 0));
+    RELEASE_ASSERT(header != MAP_FAILED);
+    RELEASE_ASSERT(header->version_ == VERSION);
+    size = header->size_;
+    munmap(header, sizeof(SharedMemory));
   }
 
   SharedMemory* shmem = reinterpret_cast<SharedMemory*>(
-      mmap(nullptr, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, shmem_fd, 0));
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, shmem_fd, 0));
   RELEASE_ASSERT(shmem != MAP_FAILED);
 
   if (options.restartEpoch() == 0) {
-    shmem->size_ = sizeof(SharedMemory);
+    // The segment is zero filled, so the index is empty and no slots are used.
+    shmem->initializeLayout(options.maxStats());
     shmem->version_ = VERSION;
     shmem->initializeMutex(shmem->log_lock_);
     shmem->initializeMutex(shmem->access_log_lock_);
     shmem->initializeMutex(shmem->stat_lock_);
     shmem->initializeMutex(shmem->init_lock_);
   } else {
-    RELEASE_ASSERT(shmem->size_ == sizeof(SharedMemory));
+    RELEASE_ASSERT(shmem->size_ == size);
     RELEASE_ASSERT(shmem->version_ == VERSION);
   }
 
@@ -86,10 +105,120 @@ void SharedMemory::initializeMutex(pthread_mutex_t& mutex) {
   pthread_mutex_init(&mutex, &attribute);
 }
 
-std::string SharedMemory::version() { return fmt::format("{}.{}", VERSION, sizeof(SharedMemory)); }
+namespace {
+
+// FNV-1a. The hash must be identical in all processes sharing the memory, which holds as long as
+// they agree on SharedMemory::VERSION.
+uint64_t hashToken(const char* token, size_t size) {
+  uint64_t hash = 14695981039346656037UL;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<uint8_t>(token[i]);
+    hash *= 1099511628211UL;
+  }
+  return hash;
+}
+
+uint64_t alignOffset(uint64_t offset) {
+  const uint64_t alignment = 64;
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+void SharedMemory::initializeLayout(uint64_t max_stats) {
+  max_stats_ = max_stats;
+  // An index with at least twice as many entries as stats keeps probe sequences short, and a power
+  // of two lets the hash be masked.
+  num_index_entries_ = 1;
+  while (num_index_entries_ < 2 * max_stats) {
+    num_index_entries_ <<= 1;
+  }
+  // Stat names share most of their tokens, so far fewer symbols than stats are needed.
+  num_symbol_slots_ =
+      std::min(SharedMemorySymbolTable::MAX_SLOTS, std::max<uint64_t>(4096, max_stats / 2));
+
+  stats_offset_ = alignOffset(sizeof(SharedMemory));
+  hashes_offset_ = alignOffset(stats_offset_ + max_stats * sizeof(Stats::RawStatData));
+  index_offset_ = alignOffset(hashes_offset_ + max_stats * sizeof(uint64_t));
+  free_stats_offset_ = alignOffset(index_offset_ + num_index_entries_ * sizeof(uint32_t));
+  symbols_offset_ = alignOffset(free_stats_offset_ + max_stats * sizeof(uint32_t));
+  size_ = symbols_offset_ + num_symbol_slots_ * sizeof(SharedSymbol);
+}
+
+bool SharedMemorySymbolTable::intern(const char* token, size_t size, Stats::Symbol& symbol) {
+  ASSERT(size <= Stats::RawStatData::MAX_NAME_SIZE);
+  const uint64_t start = hashToken(token, size) % num_slots_;
+  uint64_t free_index = num_slots_;
+  for (uint64_t i = 0; i < num_slots_; i++) {
+    const uint64_t index = (start + i) % num_slots_;
+    SharedSymbol& slot = slots_[index];
+    if (!slot.used_) {
+      // The end of the probe sequence, so the token is not in the table.
+      if (free_index == num_slots_) {
+        free_index = index;
+      }
+      break;
+    }
+
+    if (slot.size_ == size && 0 == memcmp(slot.token_, token, size)) {
+      if (slot.ref_count_++ == 0) {
+        num_used_++;
+      }
+      symbol = index;
+      return true;
+    }
+
+    // Slots with no references can be taken over, but only once we know that the token does not
+    // appear later in the probe sequence.
+    if (slot.ref_count_ == 0 && free_index == num_slots_) {
+      free_index = index;
+    }
+  }
+
+  if (free_index == num_slots_) {
+    return false;
+  }
+
+  SharedSymbol& slot = slots_[free_index];
+  slot.used_ = 1;
+  slot.ref_count_ = 1;
+  slot.size_ = size;
+  memcpy(slot.token_, token, size);
+  slot.token_[size] = '\0';
+  num_used_++;
+  symbol = free_index;
+  return true;
+}
+
+void SharedMemorySymbolTable::release(Stats::Symbol symbol) {
+  // The token stays in place until the slot is reused. See intern().
+  ASSERT(slots_[symbol].ref_count_ > 0);
+  if (--slots_[symbol].ref_count_ == 0) {
+    num_used_--;
+  }
+}
+
+void SharedMemorySymbolTable::appendToken(Stats::Symbol symbol, std::string& out) const {
+  out.append(slots_[symbol].token_, slots_[symbol].size_);
+}
+
+bool SharedMemorySymbolTable::tokenEquals(Stats::Symbol symbol, const char* token,
+                                          size_t size) const {
+  const SharedSymbol& slot = slots_[symbol];
+  return slot.size_ == size && 0 == memcmp(slot.token_, token, size);
+}
+
+std::string SharedMemory::version() {
+  // The sizes of the arrays that follow the header vary with --max-stats, but hot restarted
+  // processes use the sizes of their parent, so only the layout of the elements matters.
+  return fmt::format("{}.{}", VERSION,
+                     sizeof(SharedMemory) + sizeof(Stats::RawStatData) + sizeof(SharedSymbol));
+}
 
 HotRestartImpl::HotRestartImpl(Options& options)
-    : options_(options), shmem_(SharedMemory::initialize(options)), log_lock_(shmem_.log_lock_),
+    : options_(options), shmem_(SharedMemory::initialize(options)),
+      symbol_table_(shmem_.symbolSlots(), shmem_.num_symbol_slots_, shmem_.num_symbols_used_),
+      log_lock_(shmem_.log_lock_),
       access_log_lock_(shmem_.access_log_lock_), stat_lock_(shmem_.stat_lock_),
       init_lock_(shmem_.init_lock_) {
 
@@ -109,17 +238,44 @@ HotRestartImpl::HotRestartImpl(Options& options)
 Stats::RawStatData* HotRestartImpl::alloc(const std::string& name) {
   // Try to find the existing slot in shared memory, otherwise allocate a new one.
   std::unique_lock<Thread::BasicLockable> lock(stat_lock_);
-  for (Stats::RawStatData& data : shmem_.stats_slots_) {
-    if (!data.initialized()) {
-      data.initialize(name);
-      return &data;
-    } else if (data.matches(name)) {
+  const uint64_t hash = hashToken(name.c_str(), name.size());
+  const uint64_t mask = shmem_.num_index_entries_ - 1;
+  const uint32_t* index = shmem_.index();
+  for (uint64_t i = 0; i < shmem_.num_index_entries_; i++) {
+    const uint32_t entry = index[(hash + i) & mask];
+    if (entry == SharedMemory::EMPTY_INDEX_ENTRY) {
+      break;
+    }
+    if (entry == SharedMemory::REMOVED_INDEX_ENTRY || shmem_.statHashes()[entry - 1] != hash) {
+      continue;
+    }
+
+    Stats::RawStatData& data = shmem_.statSlots()[entry - 1];
+    if (data.matches(name, symbol_table_)) {
       data.ref_count_++;
       return &data;
     }
   }
 
-  return nullptr;
+  uint32_t slot;
+  if (shmem_.num_free_stat_slots_ > 0) {
+    slot = shmem_.freeStatSlots()[--shmem_.num_free_stat_slots_];
+  } else if (shmem_.num_stat_slots_touched_ < shmem_.max_stats_) {
+    slot = shmem_.num_stat_slots_touched_++;
+  } else {
+    return nullptr;
+  }
+
+  Stats::RawStatData& data = shmem_.statSlots()[slot];
+  if (!data.initialize(name, symbol_table_)) {
+    // If the symbol table is full the caller falls back to heap allocation.
+    shmem_.freeStatSlots()[shmem_.num_free_stat_slots_++] = slot;
+    return nullptr;
+  }
+
+  shmem_.statHashes()[slot] = hash;
+  addIndexEntry(slot);
+  return &data;
 }
 
 void HotRestartImpl::free(Stats::RawStatData& data) {
@@ -130,7 +286,80 @@ void HotRestartImpl::free(Stats::RawStatData& data) {
     return;
   }
 
+  const uint32_t slot = &data - shmem_.statSlots();
+  uint32_t* entry = findIndexEntry(slot);
+  ASSERT(entry != nullptr);
+  // An entry at the end of a probe sequence can be emptied, which keeps the sequence short.
+  const uint64_t position = entry - shmem_.index();
+  const uint32_t next = shmem_.index()[(position + 1) & (shmem_.num_index_entries_ - 1)];
+  if (next == SharedMemory::EMPTY_INDEX_ENTRY) {
+    *entry = SharedMemory::EMPTY_INDEX_ENTRY;
+  } else {
+    *entry = SharedMemory::REMOVED_INDEX_ENTRY;
+    shmem_.num_removed_index_entries_++;
+  }
+
+  data.releaseName(symbol_table_);
   memset(&data, 0, sizeof(Stats::RawStatData));
+  shmem_.freeStatSlots()[shmem_.num_free_stat_slots_++] = slot;
+
+  if (shmem_.num_removed_index_entries_ > shmem_.num_index_entries_ / 4) {
+    compactIndex();
+  }
+}
+
+uint32_t* HotRestartImpl::findIndexEntry(uint32_t slot) {
+  const uint64_t hash = shmem_.statHashes()[slot];
+  const uint64_t mask = shmem_.num_index_entries_ - 1;
+  uint32_t* index = shmem_.index();
+  for (uint64_t i = 0; i < shmem_.num_index_entries_; i++) {
+    uint32_t& entry = index[(hash + i) & mask];
+    if (entry == SharedMemory::EMPTY_INDEX_ENTRY) {
+      break;
+    }
+    if (entry == slot + 1) {
+      return &entry;
+    }
+  }
+
+  return nullptr;
+}
+
+void HotRestartImpl::addIndexEntry(uint32_t slot) {
+  const uint64_t hash = shmem_.statHashes()[slot];
+  const uint64_t mask = shmem_.num_index_entries_ - 1;
+  uint32_t* index = shmem_.index();
+  for (uint64_t i = 0; i < shmem_.num_index_entries_; i++) {
+    uint32_t& entry = index[(hash + i) & mask];
+    if (entry == SharedMemory::REMOVED_INDEX_ENTRY) {
+      shmem_.num_removed_index_entries_--;
+    } else if (entry != SharedMemory::EMPTY_INDEX_ENTRY) {
+      continue;
+    }
+
+    entry = slot + 1;
+    return;
+  }
+
+  NOT_REACHED;
+}
+
+void HotRestartImpl::compactIndex() {
+  memset(shmem_.index(), 0, shmem_.num_index_entries_ * sizeof(uint32_t));
+  shmem_.num_removed_index_entries_ = 0;
+  for (uint32_t slot = 0; slot < shmem_.num_stat_slots_touched_; slot++) {
+    if (shmem_.statSlots()[slot].initialized()) {
+      addIndexEntry(slot);
+    }
+  }
+}
+
+void HotRestartImpl::getStatsRegionInfo(StatsRegionInfo& info) {
+  std::unique_lock<Thread::BasicLockable> lock(stat_lock_);
+  info.stats_used_ = shmem_.num_stat_slots_touched_ - shmem_.num_free_stat_slots_;
+  info.stats_capacity_ = shmem_.max_stats_;
+  info.symbols_used_ = shmem_.num_symbols_used_;
+  info.symbols_capacity_ = shmem_.num_symbol_slots_;
 }
 
 int HotRestartImpl::bindDomainSocket(uint64_t id) {
@@ -166,6 +395,13 @@ sockaddr_un HotRestartImpl::createDomainSocketAddress(uint64_t id) {
 
 void HotRestartImpl::drainParentListeners() {
   if (options_.restartEpoch() > 0) {
+    // Sockets that no listener claimed would otherwise queue connections that are never accepted
+    // once the parent stops listening.
+    for (const auto& socket : parent_sockets_) {
+      close(socket.second);
+    }
+    parent_sockets_.clear();
+
     // No reply expected.
     RpcBase rpc(RpcMessageType::DrainListenersRequest);
     sendMessage(parent_address_, rpc);
@@ -175,20 +411,48 @@ void HotRestartImpl::drainParentListeners() {
   shmem_.flags_ &= ~SharedMemory::Flags::INITIALIZING;
 }
 
-int HotRestartImpl::duplicateParentListenSocket(const std::string& address) {
+int HotRestartImpl::duplicateParentListenSocket(const std::string& address,
+                                                uint32_t worker_index) {
   if (options_.restartEpoch() == 0 || parent_terminated_) {
     return -1;
   }
 
+  if (!parent_sockets_fetched_) {
+    fetchParentListenSockets();
+  }
+  const auto socket = parent_sockets_.find(std::make_pair(address, worker_index));
+  if (socket != parent_sockets_.end()) {
+    const int fd = socket->second;
+    parent_sockets_.erase(socket);
+    return fd;
+  }
+
+  // Sockets of listeners that the parent added since, or that were handed over already, are asked
+  // for one at a time.
   RpcGetListenSocketRequest rpc;
   ASSERT(address.length() < sizeof(rpc.address_));
   StringUtil::strlcpy(rpc.address_, address.c_str(), sizeof(rpc.address_));
+  rpc.worker_index_ = worker_index;
   sendMessage(parent_address_, rpc);
   RpcGetListenSocketReply* reply =
       receiveTypedRpc<RpcGetListenSocketReply, RpcMessageType::GetListenSocketReply>();
   return reply->fd_;
 }
 
+void HotRestartImpl::fetchParentListenSockets() {
+  parent_sockets_fetched_ = true;
+  RpcBase rpc(RpcMessageType::GetListenSocketsRequest);
+  sendMessage(parent_address_, rpc);
+  RpcGetListenSocketsReply* reply;
+  do {
+    reply = receiveTypedRpc<RpcGetListenSocketsReply, RpcMessageType::GetListenSocketsReply>();
+    for (uint32_t i = 0; i < reply->num_sockets_; i++) {
+      parent_sockets_[std::make_pair(std::string(reply->sockets_[i].address_),
+                                     reply->sockets_[i].worker_index_)] = reply->fds_[i];
+    }
+  } while (reply->more_);
+}
+
 void HotRestartImpl::getParentStats(GetParentStatsInfo& info) {
   // There exists a race condition during hot restart involving fetching parent stats. It looks like
   // this:
@@ -221,6 +485,31 @@ void HotRestartImpl::getParentStats(GetParentStatsInfo& info) {
   info.num_connections_ = reply->num_connections_;
 }
 
+void HotRestartImpl::getParentUnhealthyHosts(std::vector<UnhealthyHostInfo>& hosts) {
+  // See large comment in getParentStats() on why this operation is locked.
+  std::unique_lock<Thread::BasicLockable> lock(init_lock_, std::defer_lock);
+  hosts.clear();
+  if (options_.restartEpoch() == 0 || parent_terminated_ || !lock.try_lock()) {
+    return;
+  }
+
+  RpcBase rpc(RpcMessageType::GetUnhealthyHostsRequest);
+  sendMessage(parent_address_, rpc);
+  RpcGetUnhealthyHostsReply* reply;
+  do {
+    reply = receiveTypedRpc<RpcGetUnhealthyHostsReply, RpcMessageType::GetUnhealthyHostsReply>();
+    const char* entry = reply->hosts_;
+    for (uint32_t i = 0; i < reply->num_hosts_; i++) {
+      UnhealthyHostInfo host;
+      host.cluster_name_ = entry;
+      entry += host.cluster_name_.size() + 1;
+      host.address_ = entry;
+      entry += host.address_.size() + 1;
+      hosts.push_back(host);
+    }
+  } while (reply->more_);
+}
+
 void HotRestartImpl::initialize(Event::Dispatcher& dispatcher, Server::Instance& server) {
   socket_event_ =
       dispatcher.createFileEvent(my_domain_socket_,
@@ -233,28 +522,32 @@ void HotRestartImpl::initialize(Event::Dispatcher& dispatcher, Server::Instance&
   server_ = &server;
 }
 
+void HotRestartImpl::setSocketBlocking(bool blocking) {
+  int rc = fcntl(my_domain_socket_, F_SETFL, blocking ? 0 : O_NONBLOCK);
+  RELEASE_ASSERT(rc != -1);
+  UNREFERENCED_PARAMETER(rc);
+}
+
 HotRestartImpl::RpcBase* HotRestartImpl::receiveRpc(bool block) {
-  // By default the domain socket is non blocking. If we need to block, make it blocking first.
+  // If we need to block, make the socket blocking first.
   if (block) {
-    int rc = fcntl(my_domain_socket_, F_SETFL, 0);
-    RELEASE_ASSERT(rc != -1);
-    UNREFERENCED_PARAMETER(rc);
+    setSocketBlocking(true);
   }
 
   iovec iov[1];
   iov[0].iov_base = &rpc_buffer_[0];
   iov[0].iov_len = rpc_buffer_.size();
 
-  // We always setup to receive an FD even though most messages do not pass one.
-  uint8_t control_buffer[CMSG_SPACE(sizeof(int))];
-  memset(control_buffer, 0, CMSG_SPACE(sizeof(int)));
+  // We always setup to receive FDs even though most messages do not pass any.
+  uint8_t control_buffer[CMSG_SPACE(sizeof(int) * MAX_SOCKETS_PER_REPLY)];
+  memset(control_buffer, 0, sizeof(control_buffer));
 
   msghdr message;
   memset(&message, 0, sizeof(message));
   message.msg_iov = iov;
   message.msg_iovlen = 1;
   message.msg_control = control_buffer;
-  message.msg_controllen = CMSG_SPACE(sizeof(int));
+  message.msg_controllen = sizeof(control_buffer);
 
   int rc = recvmsg(my_domain_socket_, &message, 0);
   if (!block && rc == -1 && errno == EAGAIN) {
@@ -266,17 +559,15 @@ HotRestartImpl::RpcBase* HotRestartImpl::receiveRpc(bool block) {
 
   // Turn non-blocking back on if we made it blocking.
   if (block) {
-    int rc = fcntl(my_domain_socket_, F_SETFL, O_NONBLOCK);
-    RELEASE_ASSERT(rc != -1);
-    UNREFERENCED_PARAMETER(rc);
+    setSocketBlocking(false);
   }
 
   RpcBase* rpc = reinterpret_cast<RpcBase*>(&rpc_buffer_[0]);
   RELEASE_ASSERT(static_cast<uint64_t>(rc) == rpc->length_);
 
-  // We should only get control data in a GetListenSocketReply. If that's the case, pull the
-  // cloned fd out of the control data and stick it into the RPC so that higher level code does
-  // need to deal with any of this.
+  // We should only get control data in a GetListenSocketReply or GetListenSocketsReply. If that's
+  // the case, pull the cloned fds out of the control data and stick them into the RPC so that
+  // higher level code does need to deal with any of this.
   for (cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr;
        cmsg = CMSG_NXTHDR(&message, cmsg)) {
 
@@ -285,6 +576,15 @@ HotRestartImpl::RpcBase* HotRestartImpl::receiveRpc(bool block) {
 
       reinterpret_cast<RpcGetListenSocketReply*>(rpc)->fd_ =
           *reinterpret_cast<int*>(CMSG_DATA(cmsg));
+    } else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+               rpc->type_ == RpcMessageType::GetListenSocketsReply) {
+
+      RpcGetListenSocketsReply* reply = reinterpret_cast<RpcGetListenSocketsReply*>(rpc);
+      const size_t num_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      RELEASE_ASSERT(num_fds == reply->num_sockets_);
+      for (size_t i = 0; i < num_fds; i++) {
+        reply->fds_[i] = reinterpret_cast<int*>(CMSG_DATA(cmsg))[i];
+      }
     } else {
       RELEASE_ASSERT(false);
     }
@@ -309,6 +609,42 @@ void HotRestartImpl::sendMessage(sockaddr_un& address, RpcBase& rpc) {
   UNREFERENCED_PARAMETER(rc);
 }
 
+void HotRestartImpl::sendMessage(sockaddr_un& address, RpcBase& rpc, const int* fds,
+                                 uint32_t num_fds) {
+  ASSERT(num_fds <= MAX_SOCKETS_PER_REPLY);
+  if (num_fds == 0) {
+    // In this case there is no fd to duplicate so we just send a normal message.
+    sendMessage(address, rpc);
+    return;
+  }
+
+  iovec iov[1];
+  iov[0].iov_base = &rpc;
+  iov[0].iov_len = rpc.length_;
+
+  uint8_t control_buffer[CMSG_SPACE(sizeof(int) * MAX_SOCKETS_PER_REPLY)];
+  memset(control_buffer, 0, sizeof(control_buffer));
+
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_name = &address;
+  message.msg_namelen = sizeof(address);
+  message.msg_iov = iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control_buffer;
+  message.msg_controllen = CMSG_SPACE(sizeof(int) * num_fds);
+
+  cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+  control_message->cmsg_level = SOL_SOCKET;
+  control_message->cmsg_type = SCM_RIGHTS;
+  control_message->cmsg_len = CMSG_LEN(sizeof(int) * num_fds);
+  memcpy(CMSG_DATA(control_message), fds, sizeof(int) * num_fds);
+
+  int rc = sendmsg(my_domain_socket_, &message, 0);
+  RELEASE_ASSERT(rc != -1);
+  UNREFERENCED_PARAMETER(rc);
+}
+
 void HotRestartImpl::onGetListenSocket(RpcGetListenSocketRequest& rpc) {
   RpcGetListenSocketReply reply;
   reply.fd_ = -1;
@@ -317,41 +653,85 @@ void HotRestartImpl::onGetListenSocket(RpcGetListenSocketRequest& rpc) {
       Network::Utility::resolveUrl(std::string(rpc.address_));
   for (const auto& listener : server_->listenerManager().listeners()) {
     if (*listener.get().socket().localAddress() == *addr) {
-      reply.fd_ = listener.get().socket().fd();
+      // A listener with a SO_REUSEPORT socket per worker hands over the socket of the matching
+      // worker, so the child takes over the whole group one socket at a time.
+      reply.fd_ = listener.get().workerSocket(rpc.worker_index_).fd();
       break;
     }
   }
 
-  if (reply.fd_ == -1) {
-    // In this case there is no fd to duplicate so we just send a normal message.
-    sendMessage(child_address_, reply);
-  } else {
-    iovec iov[1];
-    iov[0].iov_base = &reply;
-    iov[0].iov_len = reply.length_;
-
-    uint8_t control_buffer[CMSG_SPACE(sizeof(int))];
-    memset(control_buffer, 0, CMSG_SPACE(sizeof(int)));
-
-    msghdr message;
-    memset(&message, 0, sizeof(message));
-    message.msg_name = &child_address_;
-    message.msg_namelen = sizeof(child_address_);
-    message.msg_iov = iov;
-    message.msg_iovlen = 1;
-    message.msg_control = control_buffer;
-    message.msg_controllen = CMSG_SPACE(sizeof(int));
-
-    cmsghdr* control_message = CMSG_FIRSTHDR(&message);
-    control_message->cmsg_level = SOL_SOCKET;
-    control_message->cmsg_type = SCM_RIGHTS;
-    control_message->cmsg_len = CMSG_LEN(sizeof(int));
-    *reinterpret_cast<int*>(CMSG_DATA(control_message)) = reply.fd_;
-
-    int rc = sendmsg(my_domain_socket_, &message, 0);
-    RELEASE_ASSERT(rc != -1);
-    UNREFERENCED_PARAMETER(rc);
+  const int fd = reply.fd_;
+  sendMessage(child_address_, reply, &fd, fd == -1 ? 0 : 1);
+}
+
+void HotRestartImpl::onGetListenSockets() {
+  setSocketBlocking(true);
+  RpcGetListenSocketsReply reply;
+  std::array<int, MAX_SOCKETS_PER_REPLY> reply_fds;
+  for (const auto& listener : server_->listenerManager().listeners()) {
+    const std::string address =
+        fmt::format("tcp://{}", listener.get().socket().localAddress()->asString());
+    // A listener with a SO_REUSEPORT socket per worker hands over the socket of each worker. Others
+    // hand over their one socket as that of the first worker.
+    std::unordered_set<int> fds;
+    for (uint32_t worker_index = 0; worker_index < std::max(1U, options_.concurrency());
+         worker_index++) {
+      const int fd = listener.get().workerSocket(worker_index).fd();
+      if (!fds.insert(fd).second) {
+        continue;
+      }
+
+      if (reply.num_sockets_ == MAX_SOCKETS_PER_REPLY) {
+        reply.more_ = 1;
+        sendMessage(child_address_, reply, reply_fds.data(), reply.num_sockets_);
+        reply = RpcGetListenSocketsReply();
+      }
+
+      RpcGetListenSocketsReply::Socket& socket = reply.sockets_[reply.num_sockets_];
+      ASSERT(address.length() < sizeof(socket.address_));
+      StringUtil::strlcpy(socket.address_, address.c_str(), sizeof(socket.address_));
+      socket.worker_index_ = worker_index;
+      reply_fds[reply.num_sockets_++] = fd;
+    }
   }
+
+  sendMessage(child_address_, reply, reply_fds.data(), reply.num_sockets_);
+  setSocketBlocking(false);
+}
+
+void HotRestartImpl::onGetUnhealthyHosts() {
+  setSocketBlocking(true);
+  RpcGetUnhealthyHostsReply reply;
+  size_t used = 0;
+  for (const auto& cluster : server_->clusterManager().clusters()) {
+    for (const Upstream::HostSharedPtr& host : cluster.second.get().hosts()) {
+      if (!host->healthFlagGet(Upstream::Host::HealthFlag::FAILED_ACTIVE_HC) &&
+          !host->healthFlagGet(Upstream::Host::HealthFlag::FAILED_OUTLIER_CHECK)) {
+        continue;
+      }
+
+      const std::string address = host->address()->asString();
+      const size_t size = cluster.first.size() + address.size() + 2;
+      if (size > sizeof(reply.hosts_)) {
+        continue;
+      }
+      if (used + size > sizeof(reply.hosts_)) {
+        reply.more_ = 1;
+        sendMessage(child_address_, reply);
+        reply = RpcGetUnhealthyHostsReply();
+        used = 0;
+      }
+
+      memcpy(reply.hosts_ + used, cluster.first.c_str(), cluster.first.size() + 1);
+      used += cluster.first.size() + 1;
+      memcpy(reply.hosts_ + used, address.c_str(), address.size() + 1);
+      used += address.size() + 1;
+      reply.num_hosts_++;
+    }
+  }
+
+  sendMessage(child_address_, reply);
+  setSocketBlocking(false);
 }
 
 void HotRestartImpl::onSocketEvent() {
@@ -377,6 +757,16 @@ void HotRestartImpl::onSocketEvent() {
       break;
     }
 
+    case RpcMessageType::GetListenSocketsRequest: {
+      onGetListenSockets();
+      break;
+    }
+
+    case RpcMessageType::GetUnhealthyHostsRequest: {
+      onGetUnhealthyHosts();
+      break;
+    }
+
     case RpcMessageType::GetStatsRequest: {
       GetParentStatsInfo info;
       server_->getParentStats(info);
@@ -6,7 +6,10 @@
 #include <array>
 #include <atomic>
 #include <cstdint>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "envoy/server/hot_restart.h"
 #include "envoy/server/options.h"
@@ -17,9 +20,60 @@
 namespace Envoy {
 namespace Server {
 
+/**
+ * A stat name token interned in shared memory. See SharedMemorySymbolTable.
+ */
+struct SharedSymbol {
+  uint32_t ref_count_;
+  // Set once the slot has held a token. Slots never go back to being unused so that probe
+  // sequences are never broken.
+  uint8_t used_;
+  uint8_t size_;
+  char token_[Stats::RawStatData::MAX_NAME_SIZE + 1];
+};
+
+/**
+ * SymbolTable implementation that interns tokens into an array of shared memory slots using open
+ * addressing. All processes sharing the memory see the same symbols, which is what allows stats to
+ * be matched by name across a hot restart. The stat lock must be held for intern() and release().
+ * Tokens of live symbols never change so they can be read without the lock.
+ */
+class SharedMemorySymbolTable : public Stats::SymbolTable {
+public:
+  // Symbols are indexes of slots, so there can be no more slots than symbols.
+  static const uint64_t MAX_SLOTS = static_cast<uint64_t>(UINT16_MAX) + 1;
+
+  /**
+   * @param slots supplies the slots the tokens are interned into.
+   * @param num_slots supplies the number of slots.
+   * @param num_used supplies the count of slots holding a referenced token, which is kept up to
+   *        date by the table.
+   */
+  SharedMemorySymbolTable(SharedSymbol* slots, uint64_t num_slots, uint64_t& num_used)
+      : slots_(slots), num_slots_(num_slots), num_used_(num_used) {}
+
+  // Stats::SymbolTable
+  bool intern(const char* token, size_t size, Stats::Symbol& symbol) override;
+  void release(Stats::Symbol symbol) override;
+  void appendToken(Stats::Symbol symbol, std::string& out) const override;
+  bool tokenEquals(Stats::Symbol symbol, const char* token, size_t size) const override;
+
+private:
+  SharedSymbol* slots_;
+  const uint64_t num_slots_;
+  uint64_t& num_used_;
+};
+
 /**
  * Shared memory segment. This structure is laid directly into shared memory and is used amongst
- * all running envoy processes.
+ * all running envoy processes. It is the header of the segment, and is followed by arrays whose
+ * sizes are chosen by the first process from --max-stats:
+ * - the stat slots.
+ * - the hash of the name of each stat slot.
+ * - an open addressing index of the stat slots in use, by the hash of the stat name.
+ * - a stack of the stat slots that were freed and can be reused.
+ * - the symbol slots of the SharedMemorySymbolTable.
+ * Hot restarted processes use the segment with the sizes the first process chose.
  */
 class SharedMemory {
 public:
@@ -30,6 +84,10 @@ private:
     static const uint64_t INITIALIZING = 0x1;
   };
 
+  // Index entries are the stat slot plus one, so that zeroed memory is an empty index.
+  static const uint32_t EMPTY_INDEX_ENTRY = 0;
+  static const uint32_t REMOVED_INDEX_ENTRY = UINT32_MAX;
+
   SharedMemory() {}
 
   /**
@@ -38,11 +96,25 @@ private:
    */
   static SharedMemory& initialize(Options& options);
 
+  /**
+   * Set the sizes and offsets of the arrays that follow the header for a number of stats.
+   */
+  void initializeLayout(uint64_t max_stats);
+
   /**
    * Initialize a pthread mutex for process shared locking.
    */
   void initializeMutex(pthread_mutex_t& mutex);
 
+  Stats::RawStatData* statSlots() {
+    return reinterpret_cast<Stats::RawStatData*>(at(stats_offset_));
+  }
+  uint64_t* statHashes() { return reinterpret_cast<uint64_t*>(at(hashes_offset_)); }
+  uint32_t* index() { return reinterpret_cast<uint32_t*>(at(index_offset_)); }
+  uint32_t* freeStatSlots() { return reinterpret_cast<uint32_t*>(at(free_stats_offset_)); }
+  SharedSymbol* symbolSlots() { return reinterpret_cast<SharedSymbol*>(at(symbols_offset_)); }
+  uint8_t* at(uint64_t offset) { return reinterpret_cast<uint8_t*>(this) + offset; }
+
   static const uint64_t VERSION;
 
   uint64_t size_;
@@ -52,7 +124,21 @@ private:
   pthread_mutex_t access_log_lock_;
   pthread_mutex_t stat_lock_;
   pthread_mutex_t init_lock_;
-  std::array<Stats::RawStatData, 16384> stats_slots_;
+
+  // The following are guarded by stat_lock_.
+  uint64_t max_stats_;
+  uint64_t num_index_entries_;
+  uint64_t num_symbol_slots_;
+  uint64_t stats_offset_;
+  uint64_t hashes_offset_;
+  uint64_t index_offset_;
+  uint64_t free_stats_offset_;
+  uint64_t symbols_offset_;
+  // Stat slots at and past this one have never been used.
+  uint64_t num_stat_slots_touched_;
+  uint64_t num_free_stat_slots_;
+  uint64_t num_removed_index_entries_;
+  uint64_t num_symbols_used_;
 
   friend class HotRestartImpl;
 };
@@ -113,8 +199,10 @@ public:
 
   // Server::HotRestart
   void drainParentListeners() override;
-  int duplicateParentListenSocket(const std::string& address) override;
+  int duplicateParentListenSocket(const std::string& address, uint32_t worker_index) override;
   void getParentStats(GetParentStatsInfo& info) override;
+  void getParentUnhealthyHosts(std::vector<UnhealthyHostInfo>& hosts) override;
+  void getStatsRegionInfo(StatsRegionInfo& info) override;
   void initialize(Event::Dispatcher& dispatcher, Server::Instance& server) override;
   void shutdownParentAdmin(ShutdownParentAdminInfo& info) override;
   void terminateParent() override;
@@ -124,6 +212,7 @@ public:
   // RawStatDataAllocator
   Stats::RawStatData* alloc(const std::string& name) override;
   void free(Stats::RawStatData& data) override;
+  const Stats::SymbolTable& symbolTable() override { return symbol_table_; }
 
 private:
   enum class RpcMessageType {
@@ -135,9 +224,16 @@ private:
     TerminateRequest = 6,
     UnknownRequestReply = 7,
     GetStatsRequest = 8,
-    GetStatsReply = 9
+    GetStatsReply = 9,
+    GetListenSocketsRequest = 10,
+    GetListenSocketsReply = 11,
+    GetUnhealthyHostsRequest = 12,
+    GetUnhealthyHostsReply = 13
   };
 
+  // Bounded by the RPC buffer, and by the number of fds that can be passed in one message.
+  static const uint32_t MAX_SOCKETS_PER_REPLY = 32;
+
   struct RpcBase {
     RpcBase(RpcMessageType type, uint64_t length = sizeof(RpcBase))
         : type_(type), length_(length) {}
@@ -150,6 +246,7 @@ private:
     RpcGetListenSocketRequest() : RpcBase(RpcMessageType::GetListenSocketRequest, sizeof(*this)) {}
 
     char address_[256]{0};
+    uint32_t worker_index_{0};
   } __attribute__((packed));
 
   struct RpcGetListenSocketReply : public RpcBase {
@@ -172,6 +269,35 @@ private:
     uint64_t unused_[16]{0};
   } __attribute__((packed));
 
+  // All of the listen sockets of the parent are handed over in as few messages as possible, each
+  // carrying the fds of up to MAX_SOCKETS_PER_REPLY sockets.
+  struct RpcGetListenSocketsReply : public RpcBase {
+    RpcGetListenSocketsReply() : RpcBase(RpcMessageType::GetListenSocketsReply, sizeof(*this)) {}
+
+    struct Socket {
+      char address_[96];
+      uint32_t worker_index_;
+    } __attribute__((packed));
+
+    // Set if more replies follow with the rest of the sockets.
+    uint8_t more_{0};
+    uint32_t num_sockets_{0};
+    Socket sockets_[MAX_SOCKETS_PER_REPLY]{};
+    // Filled in on receipt from the control data, in the order of sockets_.
+    int fds_[MAX_SOCKETS_PER_REPLY]{};
+  } __attribute__((packed));
+
+  struct RpcGetUnhealthyHostsReply : public RpcBase {
+    RpcGetUnhealthyHostsReply()
+        : RpcBase(RpcMessageType::GetUnhealthyHostsReply, sizeof(*this)) {}
+
+    // Set if more replies follow with the rest of the hosts.
+    uint8_t more_{0};
+    uint32_t num_hosts_{0};
+    // The cluster name and address of each host, each followed by a nul.
+    char hosts_[3584]{0};
+  } __attribute__((packed));
+
   template <class rpc_class, RpcMessageType rpc_type> rpc_class* receiveTypedRpc() {
     RpcBase* base_message = receiveRpc(true);
     RELEASE_ASSERT(base_message->length_ == sizeof(rpc_class));
@@ -179,15 +305,47 @@ private:
     return reinterpret_cast<rpc_class*>(base_message);
   }
 
+  /**
+   * @return uint32_t* the index entry of a stat slot, or nullptr if it is not in the index.
+   */
+  uint32_t* findIndexEntry(uint32_t slot);
+
+  /**
+   * Add a stat slot to the index. The index must not be full.
+   */
+  void addIndexEntry(uint32_t slot);
+
+  /**
+   * Build the index again from the stat slots in use, which drops the removed entries that make
+   * probe sequences longer.
+   */
+  void compactIndex();
+
   int bindDomainSocket(uint64_t id);
   sockaddr_un createDomainSocketAddress(uint64_t id);
+  void fetchParentListenSockets();
   void onGetListenSocket(RpcGetListenSocketRequest& rpc);
+  void onGetListenSockets();
+  void onGetUnhealthyHosts();
   void onSocketEvent();
   RpcBase* receiveRpc(bool block);
   void sendMessage(sockaddr_un& address, RpcBase& rpc);
 
+  /**
+   * Send a message along with duplicates of fds, which are filled into the RPC on receipt.
+   */
+  void sendMessage(sockaddr_un& address, RpcBase& rpc, const int* fds, uint32_t num_fds);
+
+  /**
+   * By default the domain socket is non blocking. It is made blocking while waiting for a reply,
+   * and while sending replies of several messages, which could otherwise overflow the queue of
+   * the receiving socket.
+   */
+  void setSocketBlocking(bool blocking);
+
   Options& options_;
   SharedMemory& shmem_;
+  SharedMemorySymbolTable symbol_table_;
   ProcessSharedMutex log_lock_;
   ProcessSharedMutex access_log_lock_;
   ProcessSharedMutex stat_lock_;
@@ -199,6 +357,10 @@ private:
   std::array<uint8_t, 4096> rpc_buffer_;
   Server::Instance* server_{};
   bool parent_terminated_{};
+  bool parent_sockets_fetched_{};
+  // Listen sockets handed over by the parent that no listener has claimed yet, by address and
+  // worker index.
+  std::map<std::pair<std::string, uint32_t>, int> parent_sockets_;
 };
 
 } // namespace Server
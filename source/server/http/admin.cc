@@ -1,7 +1,10 @@
 #include "server/http/admin.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
+#include <regex>
+#include <sstream>
 #include <string>
 #include <unordered_set>
 
@@ -18,6 +21,7 @@
 #include "common/common/enum_to_int.h"
 #include "common/common/utility.h"
 #include "common/common/version.h"
+#include "common/event/dispatcher_impl.h"
 #include "common/http/access_log/access_log_formatter.h"
 #include "common/http/access_log/access_log_impl.h"
 #include "common/http/codes.h"
@@ -25,6 +29,9 @@
 #include "common/http/headers.h"
 #include "common/http/http1/codec_impl.h"
 #include "common/json/json_loader.h"
+#include "common/memory/accounting.h"
+#include "common/memory/stats.h"
+#include "common/memory/utils.h"
 #include "common/network/listen_socket_impl.h"
 #include "common/profiler/profiler.h"
 #include "common/router/config_impl.h"
@@ -35,7 +42,10 @@
 namespace Envoy {
 namespace Server {
 
-AdminFilter::AdminFilter(AdminImpl& parent) : parent_(parent) {}
+const uint64_t AdminImpl::HOSTS_PER_CHUNK;
+const uint64_t AdminImpl::STATS_PER_CHUNK;
+
+AdminFilter::AdminFilter(AdminImpl& parent) : parent_(parent), request_(new Request(*this)) {}
 
 Http::FilterHeadersStatus AdminFilter::decodeHeaders(Http::HeaderMap& headers, bool end_stream) {
   request_headers_ = &headers;
@@ -128,50 +138,98 @@ void AdminImpl::addCircuitSettings(const std::string& cluster_name, const std::s
                            resource_manager.requests().max()));
   response.add(fmt::format("{}::{}_priority::max_retries::{}\n", cluster_name, priority_str,
                            resource_manager.retries().max()));
+  response.add(fmt::format("{}::{}_priority::max_hedges::{}\n", cluster_name, priority_str,
+                           resource_manager.hedges().max()));
+  response.add(fmt::format("{}::{}_priority::max_shadows::{}\n", cluster_name, priority_str,
+                           resource_manager.shadows().max()));
+}
+
+void AdminImpl::addHostStatus(const std::string& cluster_name, const Upstream::Host& host,
+                              double success_rate, Buffer::Instance& response) {
+  std::map<std::string, uint64_t> all_stats;
+  for (const auto& counter : host.stats().counters()) {
+    all_stats[counter.first] = counter.second;
+  }
+
+  for (const auto& gauge : host.stats().gauges()) {
+    all_stats[gauge.first] = gauge.second;
+  }
+
+  const std::string address = host.address()->asString();
+  for (auto stat : all_stats) {
+    response.add(fmt::format("{}::{}::{}::{}\n", cluster_name, address, stat.first, stat.second));
+  }
+
+  response.add(fmt::format("{}::{}::health_flags::{}\n", cluster_name, address,
+                           Upstream::HostUtility::healthFlagsToString(host)));
+  response.add(fmt::format("{}::{}::weight::{}\n", cluster_name, address, host.weight()));
+  response.add(fmt::format("{}::{}::zone::{}\n", cluster_name, address, host.zone()));
+  response.add(fmt::format("{}::{}::canary::{}\n", cluster_name, address, host.canary()));
+  response.add(fmt::format("{}::{}::success_rate::{}\n", cluster_name, address, success_rate));
 }
 
-Http::Code AdminImpl::handlerClusters(const std::string&, Buffer::Instance& response) {
+Http::Code AdminImpl::handlerClusters(const std::string&, Buffer::Instance&, ChunkCb& chunks) {
+  // Only the cluster settings are read on the main thread. The host lines, which make up most of
+  // the output for large clusters, are formatted in chunks from copies of the host lists. Outlier
+  // detection results are written by the main thread without synchronization, so the averages go
+  // into the settings and the success rates of the hosts are copied here too.
+  struct ClusterStatus {
+    std::string name_;
+    Buffer::OwnedImpl settings_;
+    std::vector<Upstream::HostSharedPtr> hosts_;
+    std::vector<double> success_rates_;
+  };
+  struct ClustersStatus {
+    std::list<ClusterStatus> clusters_;
+    size_t next_host_{};
+  };
+
+  std::shared_ptr<ClustersStatus> status(new ClustersStatus());
   for (auto& cluster : server_.clusterManager().clusters()) {
-    addOutlierInfo(cluster.second.get().info()->name(), cluster.second.get().outlierDetector(),
-                   response);
+    status->clusters_.emplace_back();
+    ClusterStatus& cluster_status = status->clusters_.back();
+    cluster_status.name_ = cluster.second.get().info()->name();
+    addOutlierInfo(cluster_status.name_, cluster.second.get().outlierDetector(),
+                   cluster_status.settings_);
 
     addCircuitSettings(
-        cluster.second.get().info()->name(), "default",
+        cluster_status.name_, "default",
         cluster.second.get().info()->resourceManager(Upstream::ResourcePriority::Default),
-        response);
+        cluster_status.settings_);
     addCircuitSettings(
-        cluster.second.get().info()->name(), "high",
-        cluster.second.get().info()->resourceManager(Upstream::ResourcePriority::High), response);
-
-    for (auto& host : cluster.second.get().hosts()) {
-      std::map<std::string, uint64_t> all_stats;
-      for (const Stats::CounterSharedPtr& counter : host->counters()) {
-        all_stats[counter->name()] = counter->value();
-      }
+        cluster_status.name_, "high",
+        cluster.second.get().info()->resourceManager(Upstream::ResourcePriority::High),
+        cluster_status.settings_);
+    cluster_status.hosts_ = cluster.second.get().hosts();
+    cluster_status.success_rates_.reserve(cluster_status.hosts_.size());
+    for (const Upstream::HostSharedPtr& host : cluster_status.hosts_) {
+      cluster_status.success_rates_.push_back(host->outlierDetector().successRate());
+    }
+  }
 
-      for (const Stats::GaugeSharedPtr& gauge : host->gauges()) {
-        all_stats[gauge->name()] = gauge->value();
-      }
+  if (status->clusters_.empty()) {
+    return Http::Code::OK;
+  }
 
-      for (auto stat : all_stats) {
-        response.add(fmt::format("{}::{}::{}::{}\n", cluster.second.get().info()->name(),
-                                 host->address()->asString(), stat.first, stat.second));
-      }
+  chunks = [status](Buffer::Instance& chunk) -> bool {
+    ClusterStatus& cluster_status = status->clusters_.front();
+    if (status->next_host_ == 0) {
+      chunk.move(cluster_status.settings_);
+    }
 
-      response.add(fmt::format("{}::{}::health_flags::{}\n", cluster.second.get().info()->name(),
-                               host->address()->asString(),
-                               Upstream::HostUtility::healthFlagsToString(*host)));
-      response.add(fmt::format("{}::{}::weight::{}\n", cluster.second.get().info()->name(),
-                               host->address()->asString(), host->weight()));
-      response.add(fmt::format("{}::{}::zone::{}\n", cluster.second.get().info()->name(),
-                               host->address()->asString(), host->zone()));
-      response.add(fmt::format("{}::{}::canary::{}\n", cluster.second.get().info()->name(),
-                               host->address()->asString(), host->canary()));
-      response.add(fmt::format("{}::{}::success_rate::{}\n", cluster.second.get().info()->name(),
-                               host->address()->asString(), host->outlierDetector().successRate()));
+    const size_t end =
+        std::min(cluster_status.hosts_.size(), status->next_host_ + HOSTS_PER_CHUNK);
+    for (; status->next_host_ < end; status->next_host_++) {
+      addHostStatus(cluster_status.name_, *cluster_status.hosts_[status->next_host_],
+                    cluster_status.success_rates_[status->next_host_], chunk);
     }
-  }
 
+    if (status->next_host_ == cluster_status.hosts_.size()) {
+      status->clusters_.pop_front();
+      status->next_host_ = 0;
+    }
+    return !status->clusters_.empty();
+  };
   return Http::Code::OK;
 }
 
@@ -198,6 +256,24 @@ Http::Code AdminImpl::handlerCpuProfiler(const std::string& url, Buffer::Instanc
   return Http::Code::OK;
 }
 
+Http::Code AdminImpl::handlerCpuProfile(const std::string&, Buffer::Instance& response) {
+  if (Profiler::Cpu::profilerEnabled()) {
+    response.add("the CPU profiler must be disabled first\n");
+    return Http::Code::BadRequest;
+  }
+
+  std::ifstream profile_file(profile_path_, std::ios::binary);
+  if (!profile_file) {
+    response.add("no CPU profile has been written\n");
+    return Http::Code::NotFound;
+  }
+
+  std::stringstream profile;
+  profile << profile_file.rdbuf();
+  response.add(profile.str());
+  return Http::Code::OK;
+}
+
 Http::Code AdminImpl::handlerHealthcheckFail(const std::string&, Buffer::Instance& response) {
   server_.failHealthcheck(true);
   response.add("OK\n");
@@ -210,6 +286,39 @@ Http::Code AdminImpl::handlerHealthcheckOk(const std::string&, Buffer::Instance&
   return Http::Code::OK;
 }
 
+Http::Code AdminImpl::handlerHeapProfile(const std::string&, Buffer::Instance& response) {
+  if (!Profiler::Heap::profilerEnabled()) {
+    response.add("the heap profiler must be enabled first\n");
+    return Http::Code::BadRequest;
+  }
+
+  response.add(Profiler::Heap::currentProfile());
+  return Http::Code::OK;
+}
+
+Http::Code AdminImpl::handlerHeapProfiler(const std::string& url, Buffer::Instance& response) {
+  Http::Utility::QueryParams query_params = Http::Utility::parseQueryString(url);
+  if (query_params.size() != 1 || query_params.begin()->first != "enable" ||
+      (query_params.begin()->second != "y" && query_params.begin()->second != "n")) {
+    response.add("?enable=<y|n>\n");
+    return Http::Code::BadRequest;
+  }
+
+  bool enable = query_params.begin()->second == "y";
+  if (enable && !Profiler::Heap::profilerEnabled()) {
+    if (!Profiler::Heap::startProfiler(profile_path_)) {
+      response.add("failure to start the profiler");
+      return Http::Code::InternalServerError;
+    }
+
+  } else if (!enable && Profiler::Heap::profilerEnabled()) {
+    Profiler::Heap::stopProfiler();
+  }
+
+  response.add("OK\n");
+  return Http::Code::OK;
+}
+
 Http::Code AdminImpl::handlerHotRestartVersion(const std::string&, Buffer::Instance& response) {
   response.add(server_.hotRestart().version());
   return Http::Code::OK;
@@ -240,6 +349,23 @@ Http::Code AdminImpl::handlerLogging(const std::string& url, Buffer::Instance& r
   return rc;
 }
 
+Http::Code AdminImpl::handlerMemory(const std::string&, Buffer::Instance& response) {
+  response.add(fmt::format("allocated: {}\n", Memory::Stats::totalCurrentlyAllocated()));
+  response.add(fmt::format("heap_size: {}\n", Memory::Stats::totalCurrentlyReserved()));
+  for (size_t i = 0; i < static_cast<size_t>(Memory::Owner::Count); i++) {
+    const Memory::Owner owner = static_cast<Memory::Owner>(i);
+    response.add(fmt::format("{}: {}\n", Memory::Accounting::name(owner),
+                             Memory::Accounting::bytes(owner)));
+  }
+
+  return Http::Code::OK;
+}
+
+Http::Code AdminImpl::handlerMemoryRelease(const std::string&, Buffer::Instance& response) {
+  response.add(fmt::format("released {} bytes\n", Memory::Utils::releaseFreeMemory(0)));
+  return Http::Code::OK;
+}
+
 Http::Code AdminImpl::handlerResetCounters(const std::string&, Buffer::Instance& response) {
   for (const Stats::CounterSharedPtr& counter : server_.stats().counters()) {
     counter->reset();
@@ -256,25 +382,129 @@ Http::Code AdminImpl::handlerServerInfo(const std::string&, Buffer::Instance& re
                            current_time - server_.startTimeCurrentEpoch(),
                            current_time - server_.startTimeFirstEpoch(),
                            server_.options().restartEpoch()));
+  for (const auto& phase : server_.startupPhaseTimes()) {
+    response.add(fmt::format("startup {} {}ms\n", phase.first, phase.second.count()));
+  }
   return Http::Code::OK;
 }
 
-Http::Code AdminImpl::handlerStats(const std::string&, Buffer::Instance& response) {
-  // We currently don't support timers locally (only via statsd) so just group all the counters
-  // and gauges together, alpha sort them, and spit them out.
-  std::map<std::string, uint64_t> all_stats;
-  for (const Stats::CounterSharedPtr& counter : server_.stats().counters()) {
-    all_stats.emplace(counter->name(), counter->value());
+Http::Code AdminImpl::handlerSlowCallbacks(const std::string&, Buffer::Instance& response) {
+  for (const Event::SlowCallbackLog::Entry& entry : Event::SlowCallbackLog::instance().entries()) {
+    response.add(fmt::format("{} {} {} {}us {}\n",
+                             AccessLogDateTimeFormatter::fromTime(entry.time_), entry.dispatcher_,
+                             entry.kind_, entry.duration_.count(), entry.origin_));
   }
 
-  for (const Stats::GaugeSharedPtr& gauge : server_.stats().gauges()) {
-    all_stats.emplace(gauge->name(), gauge->value());
+  return Http::Code::OK;
+}
+
+Http::Code AdminImpl::handlerStats(const std::string& url, Buffer::Instance& response,
+                                   ChunkCb& chunks) {
+  const Http::Utility::QueryParams query_params = Http::Utility::parseQueryString(url);
+  std::shared_ptr<std::regex> filter;
+  auto filter_param = query_params.find("filter");
+  if (filter_param != query_params.end()) {
+    try {
+      filter.reset(new std::regex(filter_param->second, std::regex::optimize));
+    } catch (std::regex_error& e) {
+      response.add(fmt::format("invalid filter regex: {}\n", e.what()));
+      response.add("usage: /stats?filter=<regex>&unsorted\n");
+      return Http::Code::BadRequest;
+    }
   }
 
-  for (auto stat : all_stats) {
-    response.add(fmt::format("{}: {}\n", stat.first, stat.second));
+  auto matches = [filter](const std::string& name) -> bool {
+    return !filter || std::regex_search(name, *filter);
+  };
+
+  // Histograms follow the counters and gauges as quantile summaries of all samples merged so far.
+  // Merging only happens on the main thread during the periodic stats flush, so that sinks always
+  // see complete intervals, which is why the summaries are taken here.
+  struct StatsStatus {
+    bool collected_{};
+    std::vector<std::pair<std::string, uint64_t>> stats_;
+    size_t next_stat_{};
+    Buffer::OwnedImpl histograms_;
+  };
+
+  std::shared_ptr<StatsStatus> status(new StatsStatus());
+  std::map<std::string, std::string> all_histograms;
+  for (const Stats::HistogramSharedPtr& histogram : server_.stats().histograms()) {
+    const std::string name = histogram->name();
+    if (histogram->used() && matches(name)) {
+      all_histograms.emplace(name, histogram->cumulativeStatistics().summary());
+    }
   }
 
+  for (auto& histogram : all_histograms) {
+    status->histograms_.add(fmt::format("{}: {}\n", histogram.first, histogram.second));
+  }
+
+  // The store can be iterated from any thread, so the counters and gauges are only visited once
+  // the response is streamed.
+  Stats::Store& store = server_.stats();
+  const bool unsorted = query_params.find("unsorted") != query_params.end();
+  chunks = [status, &store, matches, unsorted](Buffer::Instance& chunk) -> bool {
+    if (!status->collected_) {
+      status->collected_ = true;
+      if (unsorted) {
+        // Single pass that writes each stat straight into the response, which avoids copying the
+        // names and values of all stats before output.
+        auto add_stat = [&chunk, &matches](const std::string& name, uint64_t value) -> void {
+          if (matches(name)) {
+            char buffer[32];
+            chunk.add(name);
+            chunk.add(": ", 2);
+            chunk.add(buffer, StringUtil::itoa(buffer, sizeof(buffer), value));
+            chunk.add("\n", 1);
+          }
+        };
+        store.forEachCounter([&add_stat](const std::string& name, Stats::Counter& counter) -> void {
+          add_stat(name, counter.value());
+        });
+        store.forEachGauge([&add_stat](const std::string& name, Stats::Gauge& gauge) -> void {
+          add_stat(name, gauge.value());
+        });
+        return true;
+      }
+
+      // Group all the counters and gauges together and alpha sort them. As with inserting into a
+      // map, the first of several stats with the same name wins.
+      std::vector<std::pair<std::string, uint64_t>>& stats = status->stats_;
+      store.forEachCounter(
+          [&stats, &matches](const std::string& name, Stats::Counter& counter) -> void {
+            if (matches(name)) {
+              stats.emplace_back(name, counter.value());
+            }
+          });
+      store.forEachGauge([&stats, &matches](const std::string& name, Stats::Gauge& gauge) -> void {
+        if (matches(name)) {
+          stats.emplace_back(name, gauge.value());
+        }
+      });
+      typedef std::pair<std::string, uint64_t> Stat;
+      std::stable_sort(stats.begin(), stats.end(), [](const Stat& lhs, const Stat& rhs) -> bool {
+        return lhs.first < rhs.first;
+      });
+      stats.erase(std::unique(stats.begin(), stats.end(),
+                              [](const Stat& lhs, const Stat& rhs) -> bool {
+                                return lhs.first == rhs.first;
+                              }),
+                  stats.end());
+    }
+
+    const size_t end = std::min(status->stats_.size(), status->next_stat_ + STATS_PER_CHUNK);
+    for (; status->next_stat_ < end; status->next_stat_++) {
+      const std::pair<std::string, uint64_t>& stat = status->stats_[status->next_stat_];
+      chunk.add(fmt::format("{}: {}\n", stat.first, stat.second));
+    }
+
+    if (status->next_stat_ < status->stats_.size()) {
+      return true;
+    }
+    chunk.move(status->histograms_);
+    return false;
+  };
   return Http::Code::OK;
 }
 
@@ -315,15 +545,75 @@ void AdminFilter::onComplete() {
   std::string path = request_headers_->Path()->value().c_str();
   ENVOY_STREAM_LOG(info, "request complete: path: {}", *callbacks_, path);
 
-  Buffer::OwnedImpl response;
-  Http::Code code = parent_.runCallback(path, response);
+  // Handlers read and change state of the main thread, so they run there. The response comes back
+  // to the admin thread, where the stream may have gone away in the meantime.
+  AdminImpl& parent = parent_;
+  Event::Dispatcher& dispatcher = callbacks_->dispatcher();
+  RequestSharedPtr request = request_;
+  parent_.mainThreadDispatcher().post([&parent, &dispatcher, request, path]() -> void {
+    const Http::Code code = parent.runCallback(path, request->response_, request->chunks_);
+    dispatcher.post([request, code]() -> void {
+      if (request->filter_) {
+        request->filter_->onResponse(code);
+      }
+    });
+  });
+}
 
+void AdminFilter::onResponse(Http::Code code) {
+  Buffer::OwnedImpl& response = request_->response_;
   Http::HeaderMapPtr headers{
       new Http::HeaderMapImpl{{Http::Headers::get().Status, std::to_string(enumToInt(code))}}};
-  callbacks_->encodeHeaders(std::move(headers), response.length() == 0);
+  callbacks_->encodeHeaders(std::move(headers), response.length() == 0 && !request_->chunks_);
+
+  if (!request_->chunks_) {
+    if (response.length() > 0) {
+      callbacks_->encodeData(response, true);
+    }
+    return;
+  }
 
   if (response.length() > 0) {
-    callbacks_->encodeData(response, true);
+    callbacks_->encodeData(response, false);
+  }
+  callbacks_->addDownstreamWatermarkCallbacks(*this);
+  encodeNextChunk();
+}
+
+void AdminFilter::encodeNextChunk() {
+  if (above_high_watermark_ > 0) {
+    chunk_pending_ = true;
+    return;
+  }
+
+  Buffer::OwnedImpl chunk;
+  const bool more = request_->chunks_(chunk);
+  if (chunk.length() > 0 || !more) {
+    callbacks_->encodeData(chunk, !more);
+  }
+  if (more) {
+    postNextChunk();
+  }
+}
+
+void AdminFilter::postNextChunk() {
+  // One chunk per event loop iteration lets the other admin connections, and the writes of this
+  // one, make progress in between.
+  RequestSharedPtr request = request_;
+  callbacks_->dispatcher().post([request]() -> void {
+    if (request->filter_) {
+      request->filter_->encodeNextChunk();
+    }
+  });
+}
+
+void AdminFilter::onAboveWriteBufferHighWatermark() { above_high_watermark_++; }
+
+void AdminFilter::onBelowWriteBufferLowWatermark() {
+  ASSERT(above_high_watermark_ > 0);
+  if (--above_high_watermark_ == 0 && chunk_pending_) {
+    chunk_pending_ = false;
+    postNextChunk();
   }
 }
 
@@ -340,22 +630,35 @@ AdminImpl::AdminImpl(const std::string& access_log_path, const std::string& prof
                                                                        server_.stats())),
       handlers_{
           {"/certs", "print certs on machine", MAKE_ADMIN_HANDLER(handlerCerts), false},
-          {"/clusters", "upstream cluster status", MAKE_ADMIN_HANDLER(handlerClusters), false},
+          {"/clusters", "upstream cluster status", MAKE_CHUNKED_ADMIN_HANDLER(handlerClusters),
+           false},
+          {"/cpu_profile", "download the last CPU profile", MAKE_ADMIN_HANDLER(handlerCpuProfile),
+           false},
           {"/cpuprofiler", "enable/disable the CPU profiler",
            MAKE_ADMIN_HANDLER(handlerCpuProfiler), false},
           {"/healthcheck/fail", "cause the server to fail health checks",
            MAKE_ADMIN_HANDLER(handlerHealthcheckFail), false},
           {"/healthcheck/ok", "cause the server to pass health checks",
            MAKE_ADMIN_HANDLER(handlerHealthcheckOk), false},
+          {"/heap_profile", "print the live allocations of the heap profiler",
+           MAKE_ADMIN_HANDLER(handlerHeapProfile), false},
+          {"/heapprofiler", "enable/disable the heap profiler",
+           MAKE_ADMIN_HANDLER(handlerHeapProfiler), false},
           {"/hot_restart_version", "print the hot restart compatability version",
            MAKE_ADMIN_HANDLER(handlerHotRestartVersion), false},
           {"/logging", "query/change logging levels", MAKE_ADMIN_HANDLER(handlerLogging), false},
+          {"/memory/release", "return all free heap memory to the system",
+           MAKE_ADMIN_HANDLER(handlerMemoryRelease), false},
+          {"/memory", "print heap usage and the bytes held by each subsystem",
+           MAKE_ADMIN_HANDLER(handlerMemory), false},
           {"/quitquitquit", "exit the server", MAKE_ADMIN_HANDLER(handlerQuitQuitQuit), false},
           {"/reset_counters", "reset all counters to zero",
            MAKE_ADMIN_HANDLER(handlerResetCounters), false},
           {"/server_info", "print server version/status information",
            MAKE_ADMIN_HANDLER(handlerServerInfo), false},
-          {"/stats", "print server stats", MAKE_ADMIN_HANDLER(handlerStats), false},
+          {"/slow_callbacks", "print the most recent event loop callbacks that ran for long",
+           MAKE_ADMIN_HANDLER(handlerSlowCallbacks), false},
+          {"/stats", "print server stats", MAKE_CHUNKED_ADMIN_HANDLER(handlerStats), false},
           {"/listeners", "print listener addresses", MAKE_ADMIN_HANDLER(handlerListenerInfo),
            false}} {
 
@@ -393,11 +696,23 @@ void AdminImpl::createFilterChain(Http::FilterChainFactoryCallbacks& callbacks)
 }
 
 Http::Code AdminImpl::runCallback(const std::string& path, Buffer::Instance& response) {
+  ChunkCb chunks;
+  const Http::Code code = runCallback(path, response, chunks);
+  if (chunks) {
+    while (chunks(response)) {
+    }
+  }
+
+  return code;
+}
+
+Http::Code AdminImpl::runCallback(const std::string& path, Buffer::Instance& response,
+                                  ChunkCb& chunks) {
   Http::Code code = Http::Code::OK;
   bool found_handler = false;
   for (const UrlHandler& handler : handlers_) {
     if (path.find(handler.prefix_) == 0) {
-      code = handler.handler_(path, response);
+      code = handler.handler_(path, response, chunks);
       found_handler = true;
       break;
     }
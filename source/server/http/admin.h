@@ -2,15 +2,20 @@
 
 #include <chrono>
 #include <list>
+#include <memory>
 #include <string>
 
+#include "envoy/event/dispatcher.h"
+#include "envoy/http/codec.h"
 #include "envoy/http/filter.h"
 #include "envoy/network/listen_socket.h"
 #include "envoy/server/admin.h"
 #include "envoy/server/instance.h"
 #include "envoy/upstream/outlier_detection.h"
 #include "envoy/upstream/resource_manager.h"
+#include "envoy/upstream/upstream.h"
 
+#include "common/buffer/buffer_impl.h"
 #include "common/common/logger.h"
 #include "common/http/conn_manager_impl.h"
 #include "common/http/date_provider_impl.h"
@@ -21,6 +26,14 @@
 namespace Envoy {
 namespace Server {
 
+/**
+ * Like MAKE_ADMIN_HANDLER, for handlers of AdminImpl that stream their response in chunks.
+ */
+#define MAKE_CHUNKED_ADMIN_HANDLER(X)                                                              \
+  [this](const std::string& url, Buffer::Instance& data, ChunkCb& chunks) -> Http::Code {          \
+    return X(url, data, chunks);                                                                   \
+  }
+
 /**
  * Implementation of Server::admin.
  */
@@ -34,7 +47,34 @@ public:
             const std::string& address_out_path, Network::Address::InstanceConstSharedPtr address,
             Server::Instance& server);
 
+  /**
+   * Adds the next chunk of a response that is streamed in chunks. Chunks are produced off the main
+   * thread, so the callback must only read state that is safe to read from any thread.
+   * @param chunk supplies the buffer to add the chunk to.
+   * @return bool whether more chunks follow.
+   */
+  typedef std::function<bool(Buffer::Instance& chunk)> ChunkCb;
+
+  /**
+   * Runs the handler of a path and adds the whole response, including the chunks of a streamed
+   * response. Must be called on the main thread.
+   */
   Http::Code runCallback(const std::string& path, Buffer::Instance& response);
+
+  /**
+   * Runs the handler of a path. Must be called on the main thread.
+   * @param path supplies the path of the request.
+   * @param response supplies the buffer to add the response, or its start if it is streamed, to.
+   * @param chunks supplies the callback that is set if the rest of the response is streamed.
+   * @return Http::Code the status of the response.
+   */
+  Http::Code runCallback(const std::string& path, Buffer::Instance& response, ChunkCb& chunks);
+
+  /**
+   * @return Event::Dispatcher& the dispatcher of the main thread, which handlers run on.
+   */
+  Event::Dispatcher& mainThreadDispatcher() { return server_.dispatcher(); }
+
   const Network::ListenSocket& socket() override { return *socket_; }
   Network::ListenSocket& mutable_socket() { return *socket_; }
 
@@ -48,6 +88,7 @@ public:
 
   // Http::FilterChainFactory
   void createFilterChain(Http::FilterChainFactoryCallbacks& callbacks) override;
+  Http::FilterChainSize filterChainSize() override { return {1, 0}; }
 
   // Http::ConnectionManagerConfig
   const std::list<Http::AccessLog::InstanceSharedPtr>& accessLogs() override {
@@ -77,15 +118,30 @@ public:
   const Network::Address::Instance& localAddress() override;
   const Optional<std::string>& userAgent() override { return user_agent_; }
   const Http::TracingConnectionManagerConfig* tracingConfig() override { return nullptr; }
+  bool plainProxy() override { return false; }
 
 private:
+  typedef std::function<Http::Code(const std::string& url, Buffer::Instance& response,
+                                   ChunkCb& chunks)>
+      ChunkedHandlerCb;
+
   /**
    * Individual admin handler including prefix, help text, and callback.
    */
   struct UrlHandler {
+    UrlHandler(const std::string& prefix, const std::string& help_text, HandlerCb handler,
+               bool removable)
+        : UrlHandler(prefix, help_text,
+                     [handler](const std::string& url, Buffer::Instance& response,
+                               ChunkCb&) -> Http::Code { return handler(url, response); },
+                     removable) {}
+    UrlHandler(const std::string& prefix, const std::string& help_text, ChunkedHandlerCb handler,
+               bool removable)
+        : prefix_(prefix), help_text_(help_text), handler_(handler), removable_(removable) {}
+
     const std::string prefix_;
     const std::string help_text_;
-    const HandlerCb handler_;
+    const ChunkedHandlerCb handler_;
     const bool removable_;
   };
 
@@ -112,20 +168,37 @@ private:
   void addOutlierInfo(const std::string& cluster_name,
                       const Upstream::Outlier::Detector* outlier_detector,
                       Buffer::Instance& response);
+  // The host lines of /clusters and the stats of /stats are streamed in chunks of this many.
+  static const uint64_t HOSTS_PER_CHUNK = 1000;
+  static const uint64_t STATS_PER_CHUNK = 5000;
+
+  /**
+   * @param success_rate supplies the host's outlier detection success rate, which is written by
+   *        the main thread, so it is read there rather than from host.
+   */
+  static void addHostStatus(const std::string& cluster_name, const Upstream::Host& host,
+                            double success_rate, Buffer::Instance& response);
 
   /**
    * URL handlers.
    */
   Http::Code handlerCerts(const std::string& url, Buffer::Instance& response);
-  Http::Code handlerClusters(const std::string& url, Buffer::Instance& response);
+  Http::Code handlerClusters(const std::string& url, Buffer::Instance& response,
+                             ChunkCb& chunks);
+  Http::Code handlerCpuProfile(const std::string& url, Buffer::Instance& response);
   Http::Code handlerCpuProfiler(const std::string& url, Buffer::Instance& response);
   Http::Code handlerHealthcheckFail(const std::string& url, Buffer::Instance& response);
   Http::Code handlerHealthcheckOk(const std::string& url, Buffer::Instance& response);
+  Http::Code handlerHeapProfile(const std::string& url, Buffer::Instance& response);
+  Http::Code handlerHeapProfiler(const std::string& url, Buffer::Instance& response);
   Http::Code handlerHotRestartVersion(const std::string& url, Buffer::Instance& response);
   Http::Code handlerLogging(const std::string& url, Buffer::Instance& response);
+  Http::Code handlerMemory(const std::string& url, Buffer::Instance& response);
+  Http::Code handlerMemoryRelease(const std::string& url, Buffer::Instance& response);
   Http::Code handlerResetCounters(const std::string& url, Buffer::Instance& response);
   Http::Code handlerServerInfo(const std::string& url, Buffer::Instance& response);
-  Http::Code handlerStats(const std::string& url, Buffer::Instance& response);
+  Http::Code handlerSlowCallbacks(const std::string& url, Buffer::Instance& response);
+  Http::Code handlerStats(const std::string& url, Buffer::Instance& response, ChunkCb& chunks);
   Http::Code handlerQuitQuitQuit(const std::string& url, Buffer::Instance& response);
   Http::Code handlerListenerInfo(const std::string& url, Buffer::Instance& response);
 
@@ -144,14 +217,19 @@ private:
 };
 
 /**
- * A terminal HTTP filter that implements server admin functionality.
+ * A terminal HTTP filter that implements server admin functionality. The filter runs on the admin
+ * thread and hands the request to the main thread, which runs the handler. Streamed responses are
+ * then encoded one chunk per event loop iteration, and only while the downstream connection keeps
+ * up with them.
  */
-class AdminFilter : public Http::StreamDecoderFilter, Logger::Loggable<Logger::Id::admin> {
+class AdminFilter : public Http::StreamDecoderFilter,
+                    public Http::DownstreamWatermarkCallbacks,
+                    Logger::Loggable<Logger::Id::admin> {
 public:
   AdminFilter(AdminImpl& parent);
 
   // Http::StreamFilterBase
-  void onDestroy() override {}
+  void onDestroy() override { request_->filter_ = nullptr; }
 
   // Http::StreamDecoderFilter
   Http::FilterHeadersStatus decodeHeaders(Http::HeaderMap& headers, bool end_stream) override;
@@ -161,15 +239,47 @@ public:
     callbacks_ = &callbacks;
   }
 
+  // Http::DownstreamWatermarkCallbacks
+  void onAboveWriteBufferHighWatermark() override;
+  void onBelowWriteBufferLowWatermark() override;
+
 private:
+  /**
+   * The response of a request, which outlives the filter if the stream goes away while the main
+   * thread runs the handler.
+   */
+  struct Request {
+    Request(AdminFilter& filter) : filter_(&filter) {}
+
+    // Only accessed on the admin thread.
+    AdminFilter* filter_;
+    Buffer::OwnedImpl response_;
+    AdminImpl::ChunkCb chunks_;
+  };
+
+  typedef std::shared_ptr<Request> RequestSharedPtr;
+
   /**
    * Called when an admin request has been completely received.
    */
   void onComplete();
 
+  /**
+   * Called on the admin thread once the handler has run.
+   */
+  void onResponse(Http::Code code);
+
+  void encodeNextChunk();
+  void postNextChunk();
+
   AdminImpl& parent_;
+  RequestSharedPtr request_;
   Http::StreamDecoderFilterCallbacks* callbacks_{};
   Http::HeaderMap* request_headers_{};
+  // The number of downstream buffers above their high watermark.
+  uint32_t above_high_watermark_{};
+  // Whether the next chunk waits for the downstream buffers to drain.
+  bool chunk_pending_{};
 };
 
 } // namespace Server
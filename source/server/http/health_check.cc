@@ -7,6 +7,7 @@
 #include "envoy/event/timer.h"
 #include "envoy/http/header_map.h"
 #include "envoy/registry/registry.h"
+#include "envoy/upstream/cluster_manager.h"
 
 #include "common/common/assert.h"
 #include "common/common/enum_to_int.h"
@@ -39,16 +40,32 @@ HttpFilterFactoryCb HealthCheckFilterConfig::createFilterFactory(const Json::Obj
     throw EnvoyException("cache_time_ms must not be set when path_through_mode is disabled");
   }
 
+  ClusterMinHealthyPercentagesConstSharedPtr cluster_min_healthy_percentages;
+  if (config.hasObject("cluster_min_healthy_percentages")) {
+    if (pass_through_mode) {
+      throw EnvoyException(
+          "cluster_min_healthy_percentages must not be set when pass_through_mode is enabled");
+    }
+
+    std::shared_ptr<ClusterMinHealthyPercentages> percentages(new ClusterMinHealthyPercentages());
+    config.getObject("cluster_min_healthy_percentages")
+        ->iterate([&percentages](const std::string& cluster, const Json::Object& value) -> bool {
+          (*percentages)[cluster] = value.asInteger();
+          return true;
+        });
+    cluster_min_healthy_percentages = percentages;
+  }
+
   HealthCheckCacheManagerSharedPtr cache_manager;
   if (cache_time_ms > 0) {
     cache_manager.reset(new HealthCheckCacheManager(context.dispatcher(),
                                                     std::chrono::milliseconds(cache_time_ms)));
   }
 
-  return [&context, pass_through_mode, cache_manager,
-          hc_endpoint](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-    callbacks.addStreamFilter(Http::StreamFilterSharedPtr{
-        new HealthCheckFilter(context, pass_through_mode, cache_manager, hc_endpoint)});
+  return [&context, pass_through_mode, cache_manager, hc_endpoint,
+          cluster_min_healthy_percentages](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+    callbacks.addStreamFilter(Http::StreamFilterSharedPtr{new HealthCheckFilter(
+        context, pass_through_mode, cache_manager, hc_endpoint, cluster_min_healthy_percentages)});
   };
 }
 
@@ -139,6 +156,8 @@ void HealthCheckFilter::onComplete() {
     Http::Code final_status = Http::Code::OK;
     if (cache_manager_) {
       final_status = cache_manager_->getCachedResponseCode();
+    } else if (cluster_min_healthy_percentages_ && !clustersHealthy()) {
+      final_status = Http::Code::ServiceUnavailable;
     }
 
     if (!Http::CodeUtility::is2xx(enumToInt(final_status))) {
@@ -153,4 +172,25 @@ void HealthCheckFilter::onComplete() {
   callbacks_->encodeHeaders(std::move(headers), true);
 }
 
+bool HealthCheckFilter::clustersHealthy() {
+  for (const auto& item : *cluster_min_healthy_percentages_) {
+    // The worker's view of the cluster is read without locking. A cluster that does not exist
+    // (yet) counts as unhealthy.
+    Upstream::ThreadLocalCluster* cluster = context_.clusterManager().get(item.first);
+    if (cluster == nullptr) {
+      return false;
+    }
+
+    const Upstream::HostSet& host_set = cluster->hostSet();
+    const uint64_t total = host_set.hosts().size();
+    const uint64_t healthy = host_set.healthyHosts().size();
+    // An empty cluster is only healthy enough if no healthy hosts are required.
+    if (total == 0 ? item.second > 0 : healthy * 100 < total * item.second) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 } // namespace Envoy
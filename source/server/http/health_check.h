@@ -2,8 +2,10 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "envoy/http/codes.h"
 #include "envoy/http/filter.h"
@@ -52,15 +54,24 @@ private:
 
 typedef std::shared_ptr<HealthCheckCacheManager> HealthCheckCacheManagerSharedPtr;
 
+/**
+ * The minimum percentage of healthy hosts of each of the clusters that a health check answered
+ * without forwarding depends on, keyed by cluster name.
+ */
+typedef std::unordered_map<std::string, uint64_t> ClusterMinHealthyPercentages;
+typedef std::shared_ptr<const ClusterMinHealthyPercentages>
+    ClusterMinHealthyPercentagesConstSharedPtr;
+
 /**
  * Health check responder filter.
  */
 class HealthCheckFilter : public Http::StreamFilter {
 public:
   HealthCheckFilter(Server::Configuration::FactoryContext& context, bool pass_through_mode,
-                    HealthCheckCacheManagerSharedPtr cache_manager, const std::string& endpoint)
+                    HealthCheckCacheManagerSharedPtr cache_manager, const std::string& endpoint,
+                    ClusterMinHealthyPercentagesConstSharedPtr cluster_min_healthy_percentages)
       : context_(context), pass_through_mode_(pass_through_mode), cache_manager_(cache_manager),
-        endpoint_(endpoint) {}
+        endpoint_(endpoint), cluster_min_healthy_percentages_(cluster_min_healthy_percentages) {}
 
   // Http::StreamFilterBase
   void onDestroy() override {}
@@ -85,6 +96,7 @@ public:
 
 private:
   void onComplete();
+  bool clustersHealthy();
 
   Server::Configuration::FactoryContext& context_;
   Http::StreamDecoderFilterCallbacks* callbacks_{};
@@ -93,5 +105,6 @@ private:
   bool pass_through_mode_{};
   HealthCheckCacheManagerSharedPtr cache_manager_{};
   const std::string endpoint_;
+  ClusterMinHealthyPercentagesConstSharedPtr cluster_min_healthy_percentages_;
 };
 } // namespace Envoy
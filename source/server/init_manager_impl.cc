@@ -3,6 +3,7 @@
 #include <functional>
 
 #include "common/common/assert.h"
+#include "common/common/utility.h"
 
 namespace Envoy {
 namespace Server {
@@ -26,8 +27,13 @@ void InitManagerImpl::initialize(std::function<void()> callback) {
 }
 
 void InitManagerImpl::initializeTarget(Init::Target& target) {
-  target.initialize([this, &target]() -> void {
+  const MonotonicTime start = ProdMonotonicTimeSource::instance_.currentTime();
+  target.initialize([this, &target, start]() -> void {
     ASSERT(std::find(targets_.begin(), targets_.end(), &target) != targets_.end());
+    if (target_initialized_cb_) {
+      target_initialized_cb_(target.name(), start,
+                             ProdMonotonicTimeSource::instance_.currentTime());
+    }
     targets_.remove(&target);
     if (targets_.empty()) {
       state_ = State::Initialized;
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <functional>
 #include <list>
+#include <string>
 
+#include "envoy/common/time.h"
 #include "envoy/init/init.h"
 
 namespace Envoy {
@@ -12,8 +15,17 @@ namespace Server {
  */
 class InitManagerImpl : public Init::Manager {
 public:
+  typedef std::function<void(const std::string& name, MonotonicTime start, MonotonicTime end)>
+      TargetInitializedCb;
+
   void initialize(std::function<void()> callback);
 
+  /**
+   * Set a callback that is invoked with the name of each target and the times it started and
+   * completed initialization, once it has.
+   */
+  void setTargetInitializedCb(TargetInitializedCb callback) { target_initialized_cb_ = callback; }
+
   // Init::Manager
   void registerTarget(Init::Target& target) override;
 
@@ -25,6 +37,7 @@ private:
   std::list<Init::Target*> targets_;
   State state_{State::NotInitialized};
   std::function<void()> callback_;
+  TargetInitializedCb target_initialized_cb_;
 };
 
 } // namespace Server
@@ -13,7 +13,7 @@ LdsApi::LdsApi(const envoy::api::v2::ConfigSource& lds_config, Upstream::Cluster
                Init::Manager& init_manager, const LocalInfo::LocalInfo& local_info,
                Stats::Scope& scope, ListenerManager& lm)
     : listener_manager_(lm), scope_(scope.createScope("listener_manager.lds.")) {
-  subscription_ =
+  subscription_.reset(new Config::DeltaSubscriptionImpl<envoy::api::v2::Listener>(
       Envoy::Config::SubscriptionFactory::subscriptionFromConfigSource<envoy::api::v2::Listener>(
           lds_config, local_info.node(), dispatcher, cm, random, *scope_,
           [this, &lds_config, &cm, &dispatcher, &random,
@@ -22,7 +22,7 @@ LdsApi::LdsApi(const envoy::api::v2::ConfigSource& lds_config, Upstream::Cluster
                                        dispatcher, random, local_info);
           },
           "envoy.api.v2.ListenerDiscoveryService.FetchListeners",
-          "envoy.api.v2.ListenerDiscoveryService.StreamListeners");
+          "envoy.api.v2.ListenerDiscoveryService.StreamListeners")));
   Config::Utility::checkLocalInfo("lds", local_info);
   init_manager.registerTarget(*this);
 }
@@ -32,26 +32,21 @@ void LdsApi::initialize(std::function<void()> callback) {
   subscription_->start({}, *this);
 }
 
-void LdsApi::onConfigUpdate(const ResourceVector& resources) {
-  // We need to keep track of which listeners we might need to remove.
-  std::unordered_map<std::string, std::reference_wrapper<Listener>> listeners_to_remove;
-  for (const auto& listener : listener_manager_.listeners()) {
-    listeners_to_remove.emplace(listener.get().name(), listener);
-  }
-
-  for (const auto& listener : resources) {
-    const std::string listener_name = listener.name();
-    listeners_to_remove.erase(listener_name);
-    if (listener_manager_.addOrUpdateListener(listener)) {
-      ENVOY_LOG(info, "lds: add/update listener '{}'", listener_name);
+void LdsApi::onConfigUpdate(const ResourceVector& added_or_changed,
+                            const std::vector<uint64_t>& hashes,
+                            const std::vector<std::string>& removed) {
+  for (int i = 0; i < added_or_changed.size(); i++) {
+    const auto& listener = added_or_changed[i];
+    if (listener_manager_.addOrUpdateListener(listener, hashes[i])) {
+      ENVOY_LOG(info, "lds: add/update listener '{}'", listener.name());
     } else {
-      ENVOY_LOG(debug, "lds: add/update listener '{}' skipped", listener_name);
+      ENVOY_LOG(debug, "lds: add/update listener '{}' skipped", listener.name());
     }
   }
 
-  for (const auto& listener : listeners_to_remove) {
-    if (listener_manager_.removeListener(listener.first)) {
-      ENVOY_LOG(info, "lds: remove listener '{}'", listener.first);
+  for (const std::string& listener_name : removed) {
+    if (listener_manager_.removeListener(listener_name)) {
+      ENVOY_LOG(info, "lds: remove listener '{}'", listener_name);
     }
   }
 
@@ -7,6 +7,7 @@
 #include "envoy/server/listener_manager.h"
 
 #include "common/common/logger.h"
+#include "common/config/delta_subscription_impl.h"
 
 #include "api/lds.pb.h"
 
@@ -17,7 +18,7 @@ namespace Server {
  * LDS API implementation that fetches via Subscription.
  */
 class LdsApi : public Init::Target,
-               Config::SubscriptionCallbacks<envoy::api::v2::Listener>,
+               Config::DeltaSubscriptionCallbacks<envoy::api::v2::Listener>,
                Logger::Loggable<Logger::Id::upstream> {
 public:
   LdsApi(const envoy::api::v2::ConfigSource& lds_config, Upstream::ClusterManager& cm,
@@ -27,15 +28,17 @@ public:
 
   // Init::Target
   void initialize(std::function<void()> callback) override;
+  std::string name() const override { return "lds"; }
 
 private:
   void runInitializeCallbackIfAny();
 
-  // Config::SubscriptionCallbacks
-  void onConfigUpdate(const ResourceVector& resources) override;
+  // Config::DeltaSubscriptionCallbacks
+  void onConfigUpdate(const ResourceVector& added_or_changed, const std::vector<uint64_t>& hashes,
+                      const std::vector<std::string>& removed) override;
   void onConfigUpdateFailed(const EnvoyException* e) override;
 
-  std::unique_ptr<Config::Subscription<envoy::api::v2::Listener>> subscription_;
+  std::unique_ptr<Config::DeltaSubscriptionImpl<envoy::api::v2::Listener>> subscription_;
   ListenerManager& listener_manager_;
   Stats::ScopePtr scope_;
   std::function<void()> initialize_callback_;
@@ -17,7 +17,8 @@ LdsSubscription::LdsSubscription(Config::SubscriptionStats stats,
                                  Runtime::RandomGenerator& random,
                                  const LocalInfo::LocalInfo& local_info)
     : RestApiFetcher(cm, lds_config.api_config_source().cluster_name()[0], dispatcher, random,
-                     Config::Utility::apiConfigSourceRefreshDelay(lds_config.api_config_source())),
+                     Config::Utility::apiConfigSourceRefreshDelay(lds_config.api_config_source()),
+                     "lds"),
       local_info_(local_info), stats_(stats) {
   const auto& api_config_source = lds_config.api_config_source();
   UNREFERENCED_PARAMETER(lds_config);
@@ -1,8 +1,12 @@
 #include "server/listener_manager_impl.h"
 
+#include <algorithm>
+#include <chrono>
+
 #include "envoy/registry/registry.h"
 
 #include "common/common/assert.h"
+#include "common/common/utility.h"
 #include "common/network/listen_socket_impl.h"
 #include "common/network/utility.h"
 #include "common/protobuf/utility.h"
@@ -57,16 +61,36 @@ ProdListenerComponentFactory::createListenSocket(Network::Address::InstanceConst
                                                  bool bind_to_port) {
   // For each listener config we share a single TcpListenSocket among all threaded listeners.
   // UdsListenerSockets are not managed and do not participate in hot restart as they are only
-  // used for testing. First we try to get the socket from our parent if applicable.
+  // used for testing.
   // TODO(mattklein123): UDS support.
+  return createTcpListenSocket(address, bind_to_port, false, 0);
+}
+
+std::vector<Network::ListenSocketSharedPtr>
+ProdListenerComponentFactory::createReusePortListenSockets(
+    Network::Address::InstanceConstSharedPtr address, uint32_t count) {
+  std::vector<Network::ListenSocketSharedPtr> sockets;
+  for (uint32_t i = 0; i < count; i++) {
+    sockets.push_back(createTcpListenSocket(address, true, true, i));
+    // Every socket in the group must be bound to the same port. When binding to port zero, the
+    // rest of the group uses the port the kernel picked for the first socket.
+    address = sockets[0]->localAddress();
+  }
+  return sockets;
+}
+
+Network::ListenSocketSharedPtr ProdListenerComponentFactory::createTcpListenSocket(
+    Network::Address::InstanceConstSharedPtr address, bool bind_to_port, bool reuse_port,
+    uint32_t worker_index) {
+  // First we try to get the socket from our parent if applicable.
   ASSERT(address->type() == Network::Address::Type::Ip);
   const std::string addr = fmt::format("tcp://{}", address->asString());
-  const int fd = server_.hotRestart().duplicateParentListenSocket(addr);
+  const int fd = server_.hotRestart().duplicateParentListenSocket(addr, worker_index);
   if (fd != -1) {
-    ENVOY_LOG(info, "obtained socket for address {} from parent", addr);
+    ENVOY_LOG(info, "obtained socket for address {} worker {} from parent", addr, worker_index);
     return std::make_shared<Network::TcpListenSocket>(fd, address);
   } else {
-    return std::make_shared<Network::TcpListenSocket>(address, bind_to_port);
+    return std::make_shared<Network::TcpListenSocket>(address, bind_to_port, reuse_port);
   }
 }
 
@@ -83,11 +107,32 @@ ListenerImpl::ListenerImpl(const envoy::api::v2::Listener& config, ListenerManag
                                                  config.address().socket_address().port_value())),
       global_scope_(parent_.server_.stats().createScope("")),
       bind_to_port_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.deprecated_v1(), bind_to_port, true)),
+      reuse_port_(bind_to_port_ &&
+                  parent_.server_.runtime().snapshot().getInteger(
+                      fmt::format("listener.reuse_port.{}", name), 0) != 0),
       use_proxy_proto_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config.filter_chains()[0], use_proxy_proto, false)),
       use_original_dst_(PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, use_original_dst, false)),
       per_connection_buffer_limit_bytes_(
           PROTOBUF_GET_WRAPPED_OR_DEFAULT(config, per_connection_buffer_limit_bytes, 1024 * 1024)),
+      connection_balance_threshold_(parent_.server_.runtime().snapshot().getInteger(
+          fmt::format("listener.connection_balance_threshold.{}", name), 0)),
+      in_place_update_(parent_.server_.runtime().snapshot().getInteger(
+                           fmt::format("listener.in_place_update.{}", name), 0) != 0),
+      tcp_fast_open_queue_length_(
+          bind_to_port_ ? parent_.server_.runtime().snapshot().getInteger(
+                              fmt::format("listener.tcp_fast_open_queue_length.{}", name), 0)
+                        : 0),
+      defer_accept_seconds_(bind_to_port_
+                                ? parent_.server_.runtime().snapshot().getInteger(
+                                      fmt::format("listener.defer_accept_seconds.{}", name), 0)
+                                : 0),
+      per_event_byte_budget_(parent_.server_.runtime().snapshot().getInteger(
+          fmt::format("listener.per_event_byte_budget.{}", name), 0)),
+      max_accepts_per_wakeup_(parent_.server_.runtime().snapshot().getInteger(
+          fmt::format("listener.max_accepts_per_wakeup.{}", name), 0)),
+      max_accepts_per_second_(parent_.server_.runtime().snapshot().getInteger(
+          fmt::format("listener.max_accepts_per_second.{}", name), 0)),
       listener_tag_(parent_.factory_.nextListenerTag()), name_(name),
       workers_started_(workers_started), hash_(hash),
       local_drain_manager_(parent.factory_.createDrainManager()) {
@@ -102,7 +147,17 @@ ListenerImpl::ListenerImpl(const envoy::api::v2::Listener& config, ListenerManag
   std::replace(final_stat_name.begin(), final_stat_name.end(), ':', '_');
   listener_scope_ = parent_.server_.stats().createScope(final_stat_name);
 
+  Network::AcceptLimiter* global_accept_limiter = parent_.globalAcceptLimiter();
+  if (max_accepts_per_second_ > 0) {
+    own_accept_limiter_.reset(
+        new AcceptRateLimiter(max_accepts_per_second_, global_accept_limiter));
+    accept_limiter_ = own_accept_limiter_.get();
+  } else {
+    accept_limiter_ = global_accept_limiter;
+  }
+
   if (filter_chain.has_tls_context()) {
+    tls_context_hash_ = MessageUtil::hash(filter_chain.tls_context());
     Ssl::ServerContextConfigImpl context_config(filter_chain.tls_context());
     ssl_context_ = parent_.server_.sslContextManager().createSslServerContext(*listener_scope_,
                                                                               context_config);
@@ -121,15 +176,49 @@ ListenerImpl::~ListenerImpl() {
   filter_factories_.clear();
 }
 
+bool ListenerImpl::canTakeOver(const ListenerImpl& existing) const {
+  // Workers keep the sockets, TLS context and options of the listener they were given, so those
+  // must not change.
+  return in_place_update_ && *address_ == *existing.address_ && sockets_ == existing.sockets_ &&
+         tls_context_hash_ == existing.tls_context_hash_ &&
+         bind_to_port_ == existing.bind_to_port_ && reuse_port_ == existing.reuse_port_ &&
+         use_proxy_proto_ == existing.use_proxy_proto_ &&
+         use_original_dst_ == existing.use_original_dst_ &&
+         per_connection_buffer_limit_bytes_ == existing.per_connection_buffer_limit_bytes_ &&
+         connection_balance_threshold_ == existing.connection_balance_threshold_ &&
+         tcp_fast_open_queue_length_ == existing.tcp_fast_open_queue_length_ &&
+         defer_accept_seconds_ == existing.defer_accept_seconds_ &&
+         per_event_byte_budget_ == existing.per_event_byte_budget_ &&
+         max_accepts_per_wakeup_ == existing.max_accepts_per_wakeup_ &&
+         max_accepts_per_second_ == existing.max_accepts_per_second_;
+}
+
+void ListenerImpl::takeOver(ListenerImplPtr&& existing) {
+  ASSERT(canTakeOver(*existing));
+  ASSERT(predecessor_ == nullptr);
+  listener_tag_ = existing->listener_tag_;
+  existing->successor_ = this;
+  predecessor_ = std::move(existing);
+}
+
 bool ListenerImpl::createFilterChain(Network::Connection& connection) {
-  return Configuration::FilterChainUtility::buildFilterChain(connection, filter_factories_);
+  // The filter chain comes from the latest listener that took this one over.
+  const ListenerImpl* latest = this;
+  for (const ListenerImpl* successor = successor_; successor != nullptr;
+       successor = successor->successor_) {
+    latest = successor;
+  }
+  return Configuration::FilterChainUtility::buildFilterChain(connection, latest->filter_factories_);
 }
 
 bool ListenerImpl::drainClose() const {
   // When a listener is draining, the "drain close" decision is the union of the per-listener drain
   // manager and the server wide drain manager. This allows individual listeners to be drained and
   // removed independently of a server-wide drain event (e.g., /healthcheck/fail or hot restart).
-  return local_drain_manager_->drainClose() || parent_.server_.drainManager().drainClose();
+  // A listener that was taken over is drained along with the listener that took it over.
+  const ListenerImpl* successor = successor_;
+  return local_drain_manager_->drainClose() || parent_.server_.drainManager().drainClose() ||
+         (successor != nullptr && successor->drainClose());
 }
 
 void ListenerImpl::infoLog(const std::string& message) {
@@ -158,9 +247,42 @@ Init::Manager& ListenerImpl::initManager() {
   }
 }
 
-void ListenerImpl::setSocket(const Network::ListenSocketSharedPtr& socket) {
-  ASSERT(!socket_);
-  socket_ = socket;
+void ListenerImpl::setSockets(const std::vector<Network::ListenSocketSharedPtr>& sockets) {
+  ASSERT(sockets_.empty());
+  ASSERT(!sockets.empty());
+  sockets_ = sockets;
+}
+
+void ListenerImpl::setSocketOptions() {
+  if (tcp_fast_open_queue_length_ == 0 && defer_accept_seconds_ == 0) {
+    return;
+  }
+  for (const Network::ListenSocketSharedPtr& socket : sockets_) {
+    Network::Utility::setListenSocketOptions(socket->fd(), tcp_fast_open_queue_length_,
+                                             defer_accept_seconds_);
+  }
+}
+
+// The bucket is refilled every 10ms, or with a single token at rates below 100 per second.
+AcceptRateLimiter::AcceptRateLimiter(uint32_t accepts_per_second, Network::AcceptLimiter* parent)
+    : AcceptRateLimiter(accepts_per_second, (accepts_per_second + 99) / 100, parent) {}
+
+AcceptRateLimiter::AcceptRateLimiter(uint32_t accepts_per_second, uint32_t tokens_per_fill,
+                                     Network::AcceptLimiter* parent)
+    : fill_interval_(std::max<uint64_t>(1, 1000ULL * tokens_per_fill / accepts_per_second)),
+      bucket_(std::max(tokens_per_fill, accepts_per_second / 10), tokens_per_fill, fill_interval_,
+              ProdMonotonicTimeSource::instance_),
+      parent_(parent) {
+  ASSERT(accepts_per_second > 0);
+}
+
+bool AcceptRateLimiter::tryAccept() {
+  uint32_t remaining;
+  return bucket_.consume(remaining) && (parent_ == nullptr || parent_->tryAccept());
+}
+
+std::chrono::milliseconds AcceptRateLimiter::retryInterval() const {
+  return parent_ == nullptr ? fill_interval_ : std::min(fill_interval_, parent_->retryInterval());
 }
 
 ListenerManagerImpl::ListenerManagerImpl(Instance& server,
@@ -168,10 +290,23 @@ ListenerManagerImpl::ListenerManagerImpl(Instance& server,
                                          WorkerFactory& worker_factory)
     : server_(server), factory_(listener_factory), stats_(generateStats(server.stats())) {
   for (uint32_t i = 0; i < std::max(1U, server.options().concurrency()); i++) {
-    workers_.emplace_back(worker_factory.createWorker());
+    workers_.emplace_back(worker_factory.createWorker(i));
   }
 }
 
+Network::AcceptLimiter* ListenerManagerImpl::globalAcceptLimiter() {
+  // The runtime is not loaded yet when the manager is created.
+  if (!global_accept_limiter_created_) {
+    global_accept_limiter_created_ = true;
+    const uint64_t accepts_per_second =
+        server_.runtime().snapshot().getInteger("listener.max_accepts_per_second", 0);
+    if (accepts_per_second > 0) {
+      global_accept_limiter_.reset(new AcceptRateLimiter(accepts_per_second, nullptr));
+    }
+  }
+  return global_accept_limiter_.get();
+}
+
 ListenerManagerStats ListenerManagerImpl::generateStats(Stats::Scope& scope) {
   const std::string final_prefix = "listener_manager.";
   return {ALL_LISTENER_MANAGER_STATS(POOL_COUNTER_PREFIX(scope, final_prefix),
@@ -179,13 +314,17 @@ ListenerManagerStats ListenerManagerImpl::generateStats(Stats::Scope& scope) {
 }
 
 bool ListenerManagerImpl::addOrUpdateListener(const envoy::api::v2::Listener& config) {
+  return addOrUpdateListener(config, MessageUtil::hash(config));
+}
+
+bool ListenerManagerImpl::addOrUpdateListener(const envoy::api::v2::Listener& config,
+                                              uint64_t hash) {
   std::string name;
   if (!config.name().empty()) {
     name = config.name();
   } else {
     name = server_.random().uuid();
   }
-  const uint64_t hash = MessageUtil::hash(config);
   ENVOY_LOG(debug, "begin add/update listener: name={} hash={}", name, hash);
 
   auto existing_active_listener = getListenerByName(active_listeners_, name);
@@ -225,12 +364,13 @@ bool ListenerManagerImpl::addOrUpdateListener(const envoy::api::v2::Listener& co
     // In this case we can just replace inline.
     ASSERT(workers_started_);
     new_listener->infoLog("update warming listener");
-    new_listener->setSocket((*existing_warming_listener)->getSocket());
+    new_listener->setSockets((*existing_warming_listener)->getSockets());
     *existing_warming_listener = std::move(new_listener);
   } else if (existing_active_listener != active_listeners_.end()) {
     // In this case we have no warming listener, so what we do depends on whether workers
-    // have been started or not. Either way we get the socket from the existing listener.
-    new_listener->setSocket((*existing_active_listener)->getSocket());
+    // have been started or not. Either way we get the sockets from the existing listener, so an
+    // update keeps the socket group the listener was created with.
+    new_listener->setSockets((*existing_active_listener)->getSockets());
     if (workers_started_) {
       new_listener->infoLog("add warming listener");
       warming_listeners_.emplace_back(std::move(new_listener));
@@ -259,20 +399,27 @@ bool ListenerManagerImpl::addOrUpdateListener(const envoy::api::v2::Listener& co
     // to see if there is a listener that has a socket bound to the address we are configured for.
     // This is an edge case, but may happen if a listener is removed and then added back with a same
     // or different name and intended to listen on the same address. This should work and not fail.
-    Network::ListenSocketSharedPtr draining_listener_socket;
+    std::vector<Network::ListenSocketSharedPtr> draining_listener_sockets;
     auto existing_draining_listener = std::find_if(
         draining_listeners_.cbegin(), draining_listeners_.cend(),
         [&new_listener](const DrainingListener& listener) {
           return *new_listener->address() == *listener.listener_->socket().localAddress();
         });
     if (existing_draining_listener != draining_listeners_.cend()) {
-      draining_listener_socket = existing_draining_listener->listener_->getSocket();
+      draining_listener_sockets = existing_draining_listener->listener_->getSockets();
     }
 
-    new_listener->setSocket(
-        draining_listener_socket
-            ? draining_listener_socket
-            : factory_.createListenSocket(new_listener->address(), new_listener->bindToPort()));
+    if (!draining_listener_sockets.empty()) {
+      new_listener->setSockets(draining_listener_sockets);
+    } else if (new_listener->reusePort()) {
+      new_listener->setSockets(
+          factory_.createReusePortListenSockets(new_listener->address(), workers_.size()));
+      new_listener->setSocketOptions();
+    } else {
+      new_listener->setSockets(
+          {factory_.createListenSocket(new_listener->address(), new_listener->bindToPort())});
+      new_listener->setSocketOptions();
+    }
     if (workers_started_) {
       new_listener->infoLog("add warming listener");
       warming_listeners_.emplace_back(std::move(new_listener));
@@ -395,14 +542,26 @@ void ListenerManagerImpl::addListenerToWorker(Worker& worker, ListenerImpl& list
 }
 
 void ListenerManagerImpl::onListenerWarmed(ListenerImpl& listener) {
+  auto existing_active_listener = getListenerByName(active_listeners_, listener.name());
+  auto existing_warming_listener = getListenerByName(warming_listeners_, listener.name());
+  if (existing_active_listener != active_listeners_.end() &&
+      listener.canTakeOver(**existing_active_listener)) {
+    // Swap in the new filter chain for new connections without draining the existing ones.
+    listener.infoLog("warm complete. updating active listener in place");
+    listener.takeOver(std::move(*existing_active_listener));
+    *existing_active_listener = std::move(*existing_warming_listener);
+    warming_listeners_.erase(existing_warming_listener);
+    stats_.listener_in_place_update_.inc();
+    updateWarmingActiveGauges();
+    return;
+  }
+
   // The warmed listener should be added first so that the worker will accept new connections
   // when it stops listening on the old listener.
   for (const auto& worker : workers_) {
     addListenerToWorker(*worker, listener);
   }
 
-  auto existing_active_listener = getListenerByName(active_listeners_, listener.name());
-  auto existing_warming_listener = getListenerByName(warming_listeners_, listener.name());
   (*existing_warming_listener)->infoLog("warm complete. updating active listener");
   if (existing_active_listener != active_listeners_.end()) {
     drainListener(std::move(*existing_active_listener));
@@ -478,5 +637,26 @@ void ListenerManagerImpl::stopWorkers() {
   }
 }
 
+void ListenerManagerImpl::applyOverloadActions(const Network::OverloadActions& actions) {
+  if (!workers_started_ || workers_.empty()) {
+    return;
+  }
+
+  Network::OverloadActions worker_actions = actions;
+  worker_actions.shed_bytes_ = (actions.shed_bytes_ + workers_.size() - 1) / workers_.size();
+  for (const auto& worker : workers_) {
+    worker->applyOverloadActions(worker_actions);
+  }
+}
+
+std::chrono::milliseconds ListenerManagerImpl::workerLoopDelay() {
+  std::chrono::milliseconds loop_delay(0);
+  for (const auto& worker : workers_) {
+    loop_delay = std::max(loop_delay, worker->loopDelay());
+  }
+
+  return loop_delay;
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
 #include "envoy/server/filter_config.h"
 #include "envoy/server/instance.h"
 #include "envoy/server/listener_manager.h"
 #include "envoy/server/worker.h"
 
 #include "common/common/logger.h"
+#include "common/ratelimit/local_ratelimit_impl.h"
 
 #include "server/init_manager_impl.h"
 
@@ -39,10 +45,17 @@ public:
   }
   Network::ListenSocketSharedPtr
   createListenSocket(Network::Address::InstanceConstSharedPtr address, bool bind_to_port) override;
+  std::vector<Network::ListenSocketSharedPtr>
+  createReusePortListenSockets(Network::Address::InstanceConstSharedPtr address,
+                               uint32_t count) override;
   DrainManagerPtr createDrainManager() override;
   uint64_t nextListenerTag() override { return next_listener_tag_++; }
 
 private:
+  Network::ListenSocketSharedPtr
+  createTcpListenSocket(Network::Address::InstanceConstSharedPtr address, bool bind_to_port,
+                        bool reuse_port, uint32_t worker_index);
+
   Instance& server_;
   uint64_t next_listener_tag_{1};
 };
@@ -57,6 +70,7 @@ typedef std::unique_ptr<ListenerImpl> ListenerImplPtr;
 #define ALL_LISTENER_MANAGER_STATS(COUNTER, GAUGE)                                                 \
   COUNTER(listener_added)                                                                          \
   COUNTER(listener_modified)                                                                       \
+  COUNTER(listener_in_place_update)                                                                \
   COUNTER(listener_removed)                                                                        \
   COUNTER(listener_create_success)                                                                 \
   COUNTER(listener_create_failure)                                                                 \
@@ -72,6 +86,34 @@ struct ListenerManagerStats {
   ALL_LISTENER_MANAGER_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
 };
 
+/**
+ * Network::AcceptLimiter that allows a number of accepts per second, with bursts of up to a tenth
+ * of a second's worth. A limiter may have a parent, e.g. the limit of all listeners, which has to
+ * allow each accept as well. Both are shared by the workers.
+ */
+class AcceptRateLimiter : public Network::AcceptLimiter {
+public:
+  /**
+   * @param accepts_per_second supplies the rate, which must not be 0.
+   * @param parent supplies the limiter that must also allow each accept, or nullptr.
+   */
+  AcceptRateLimiter(uint32_t accepts_per_second, Network::AcceptLimiter* parent);
+
+  // Network::AcceptLimiter
+  bool tryAccept() override;
+  std::chrono::milliseconds retryInterval() const override;
+
+private:
+  AcceptRateLimiter(uint32_t accepts_per_second, uint32_t tokens_per_fill,
+                    Network::AcceptLimiter* parent);
+
+  const std::chrono::milliseconds fill_interval_;
+  RateLimit::TokenBucket bucket_;
+  Network::AcceptLimiter* parent_;
+};
+
+typedef std::unique_ptr<AcceptRateLimiter> AcceptRateLimiterPtr;
+
 /**
  * Implementation of ListenerManager.
  */
@@ -82,14 +124,23 @@ public:
 
   void onListenerWarmed(ListenerImpl& listener);
 
+  /**
+   * @return Network::AcceptLimiter* the limiter of the accept rate of all listeners, or nullptr
+   *         if the rate is unlimited. It is created from runtime when first used.
+   */
+  Network::AcceptLimiter* globalAcceptLimiter();
+
   // Server::ListenerManager
   bool addOrUpdateListener(const envoy::api::v2::Listener& config) override;
+  bool addOrUpdateListener(const envoy::api::v2::Listener& config, uint64_t hash) override;
   std::vector<std::reference_wrapper<Listener>> listeners() override;
   uint64_t numConnections() override;
   bool removeListener(const std::string& listener_name) override;
   void startWorkers(GuardDog& guard_dog) override;
   void stopListeners() override;
   void stopWorkers() override;
+  void applyOverloadActions(const Network::OverloadActions& actions) override;
+  std::chrono::milliseconds workerLoopDelay() override;
 
   Instance& server_;
   ListenerComponentFactory& factory_;
@@ -145,6 +196,8 @@ private:
   std::list<WorkerPtr> workers_;
   bool workers_started_{};
   ListenerManagerStats stats_;
+  AcceptRateLimiterPtr global_accept_limiter_;
+  bool global_accept_limiter_created_{};
 };
 
 // TODO(mattklein123): Consider getting rid of pre-worker start and post-worker start code by
@@ -182,22 +235,51 @@ public:
     return ret;
   }
 
+  /**
+   * @return TRUE if this listener can take over the worker listeners of an existing listener of the
+   *         same name. That requires that only the network filters of the two differ.
+   */
+  bool canTakeOver(const ListenerImpl& existing) const;
+
+  /**
+   * Take over the worker listeners of an existing listener, so that new connections get the filter
+   * chain of this listener while the connections of the existing one are left alone. The existing
+   * listener is owned by this one from then on, and is drained and removed with it.
+   * @param existing supplies the listener to take over.
+   */
+  void takeOver(ListenerImplPtr&& existing);
+
   Network::Address::InstanceConstSharedPtr address() const { return address_; }
-  const Network::ListenSocketSharedPtr& getSocket() const { return socket_; }
+  const std::vector<Network::ListenSocketSharedPtr>& getSockets() const { return sockets_; }
   uint64_t hash() const { return hash_; }
   void infoLog(const std::string& message);
   void initialize();
   DrainManager& localDrainManager() const { return *local_drain_manager_; }
-  void setSocket(const Network::ListenSocketSharedPtr& socket);
+  bool reusePort() const { return reuse_port_; }
+  void setSockets(const std::vector<Network::ListenSocketSharedPtr>& sockets);
+
+  /**
+   * Set the TCP Fast Open and deferred accept options of the listener on its new sockets. Sockets
+   * that are taken from an existing listener keep the options they were created with.
+   */
+  void setSocketOptions();
 
   // Server::Listener
   Network::FilterChainFactory& filterChainFactory() override { return *this; }
-  Network::ListenSocket& socket() override { return *socket_; }
+  Network::ListenSocket& socket() override { return *sockets_[0]; }
+  Network::ListenSocket& workerSocket(uint32_t worker_index) override {
+    return *sockets_[worker_index % sockets_.size()];
+  }
   bool bindToPort() override { return bind_to_port_; }
   Ssl::ServerContext* sslContext() override { return ssl_context_.get(); }
   bool useProxyProto() override { return use_proxy_proto_; }
   bool useOriginalDst() override { return use_original_dst_; }
   uint32_t perConnectionBufferLimitBytes() override { return per_connection_buffer_limit_bytes_; }
+  uint32_t connectionBalanceThreshold() override { return connection_balance_threshold_; }
+  bool tcpFastOpen() override { return tcp_fast_open_queue_length_ > 0; }
+  uint32_t perEventByteBudget() override { return per_event_byte_budget_; }
+  uint32_t maxAcceptsPerWakeup() override { return max_accepts_per_wakeup_; }
+  Network::AcceptLimiter* acceptLimiter() override { return accept_limiter_; }
   Stats::Scope& listenerScope() override { return *listener_scope_; }
   uint64_t listenerTag() override { return listener_tag_; }
   const std::string& name() const override { return name_; }
@@ -233,15 +315,30 @@ public:
 private:
   ListenerManagerImpl& parent_;
   Network::Address::InstanceConstSharedPtr address_;
-  Network::ListenSocketSharedPtr socket_;
+  // Either a single socket shared by all workers or a SO_REUSEPORT socket per worker.
+  std::vector<Network::ListenSocketSharedPtr> sockets_;
   Stats::ScopePtr global_scope_;   // Stats with global named scope, but needed for LDS cleanup.
   Stats::ScopePtr listener_scope_; // Stats with listener named scope.
   Ssl::ServerContextPtr ssl_context_;
   const bool bind_to_port_;
+  const bool reuse_port_;
   const bool use_proxy_proto_;
   const bool use_original_dst_;
   const uint32_t per_connection_buffer_limit_bytes_;
-  const uint64_t listener_tag_;
+  const uint32_t connection_balance_threshold_;
+  const bool in_place_update_;
+  const uint32_t tcp_fast_open_queue_length_;
+  const uint32_t defer_accept_seconds_;
+  const uint32_t per_event_byte_budget_;
+  const uint32_t max_accepts_per_wakeup_;
+  const uint32_t max_accepts_per_second_;
+  // The limiter of the listener's own rate, which has the global limiter as its parent.
+  AcceptRateLimiterPtr own_accept_limiter_;
+  // Either own_accept_limiter_ or the global limiter, nullptr if neither limits the rate.
+  Network::AcceptLimiter* accept_limiter_{};
+  // 0 if the listener doesn't terminate TLS.
+  uint64_t tls_context_hash_{};
+  uint64_t listener_tag_;
   const std::string name_;
   const bool workers_started_;
   const uint64_t hash_;
@@ -250,6 +347,11 @@ private:
   std::vector<Configuration::NetworkFilterFactoryCb> filter_factories_;
   DrainManagerPtr local_drain_manager_;
   bool saw_listener_create_failure_{};
+  // The listener that took this one over, if any. Workers keep creating filter chains through the
+  // listener they were given, so this is read on the workers.
+  std::atomic<ListenerImpl*> successor_{};
+  // The listener this one took over. It lives as long as this one, as its connections may use it.
+  ListenerImplPtr predecessor_;
 };
 
 } // namespace Server
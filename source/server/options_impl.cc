@@ -3,9 +3,12 @@
 #include <chrono>
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include "common/common/macros.h"
+#include "common/common/utility.h"
 #include "common/common/version.h"
 
 #include "spdlog/spdlog.h"
@@ -28,10 +31,18 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const std::string& hot_restart_v
       "uint64_t", cmd);
   TCLAP::ValueArg<uint32_t> concurrency("", "concurrency", "# of worker threads to run", false,
                                         std::thread::hardware_concurrency(), "uint32_t", cmd);
+  TCLAP::ValueArg<std::string> cpuset("", "cpuset",
+                                      "CPUs to pin worker threads to, for example '0-3,8'", false,
+                                      "", "string", cmd);
   TCLAP::ValueArg<std::string> config_path("c", "config-path", "Path to configuration file", false,
                                            "", "string", cmd);
   TCLAP::ValueArg<std::string> admin_address_path("", "admin-address-path", "Admin address path",
                                                   false, "", "string", cmd);
+  TCLAP::ValueArg<std::string> startup_trace_path("", "startup-trace-path", "Startup trace path",
+                                                  false, "", "string", cmd);
+  TCLAP::ValueArg<std::string> config_snapshot_dir(
+      "", "config-snapshot-dir", "Directory to keep snapshots of the applied configuration in",
+      false, "", "string", cmd);
   TCLAP::ValueArg<std::string> local_address_ip_version("", "local-address-ip-version",
                                                         "The local "
                                                         "IP address version (v4 or v6).",
@@ -39,6 +50,10 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const std::string& hot_restart_v
   TCLAP::ValueArg<std::string> log_level("l", "log-level", log_levels_string, false,
                                          spdlog::level::level_names[default_log_level], "string",
                                          cmd);
+  TCLAP::ValueArg<uint64_t> log_queue_size(
+      "", "log-queue-size",
+      "Log messages queued for an asynchronous writer, dropping more; 0 writes synchronously",
+      false, 0, "uint64_t", cmd);
   TCLAP::ValueArg<uint64_t> restart_epoch("", "restart-epoch", "hot restart epoch #", false, 0,
                                           "uint64_t", cmd);
   TCLAP::SwitchArg hot_restart_version_option("", "hot-restart-version",
@@ -49,11 +64,24 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const std::string& hot_restart_v
                                             cmd);
   TCLAP::ValueArg<std::string> service_zone("", "service-zone", "Zone name", false, "", "string",
                                             cmd);
+  TCLAP::ValueArg<uint64_t> max_stats("", "max-stats",
+                                      "Number of stats that hot restart shared memory holds", false,
+                                      16384, "uint64_t", cmd);
+  TCLAP::ValueArg<uint64_t> max_recycled_objects(
+      "", "max-recycled-objects",
+      "Freed connection objects of each size that every thread keeps for reuse", false, 0,
+      "uint64_t", cmd);
+  TCLAP::SwitchArg epoll_changelist("", "epoll-changelist",
+                                    "Batch epoll_ctl() calls through the libevent changelist", cmd,
+                                    false);
   TCLAP::ValueArg<uint64_t> file_flush_interval_msec("", "file-flush-interval-msec",
                                                      "Interval for log flushing in msec", false,
                                                      10000, "uint64_t", cmd);
   TCLAP::ValueArg<uint64_t> drain_time_s("", "drain-time-s", "Hot restart drain time in seconds",
                                          false, 600, "uint64_t", cmd);
+  TCLAP::ValueArg<uint64_t> drain_close_rate(
+      "", "drain-close-rate", "Connections each worker drain closes at most per second", false, 0,
+      "uint64_t", cmd);
   TCLAP::ValueArg<uint64_t> parent_shutdown_time_s("", "parent-shutdown-time-s",
                                                    "Hot restart parent shutdown time in seconds",
                                                    false, 900, "uint64_t", cmd);
@@ -61,6 +89,9 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const std::string& hot_restart_v
                                     "One of 'serve' (default; validate configs and then serve "
                                     "traffic normally) or 'validate' (validate configs and exit).",
                                     false, "serve", "string", cmd);
+  TCLAP::MultiArg<std::string> additional_config_paths(
+      "", "additional-config-path", "More configuration files to validate in validate mode", false,
+      "string", cmd);
 
   try {
     cmd.parse(argc, argv);
@@ -90,6 +121,12 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const std::string& hot_restart_v
     exit(1);
   }
 
+  if (mode_ != Server::Mode::Validate && !additional_config_paths.getValue().empty()) {
+    std::cerr << "error: more than one configuration file is only accepted in validate mode"
+              << std::endl;
+    exit(1);
+  }
+
   if (local_address_ip_version.getValue() == "v4") {
     local_address_ip_version_ = Network::Address::IpVersion::v4;
   } else if (local_address_ip_version.getValue() == "v6") {
@@ -102,15 +139,59 @@ OptionsImpl::OptionsImpl(int argc, char** argv, const std::string& hot_restart_v
 
   // For base ID, scale what the user inputs by 10 so that we have spread for domain sockets.
   base_id_ = base_id.getValue() * 10;
-  concurrency_ = concurrency.getValue();
+  if (!parseCpuset(cpuset.getValue(), cpuset_)) {
+    std::cerr << "error: invalid cpuset '" << cpuset.getValue() << "'" << std::endl;
+    exit(1);
+  }
+
+  // Stat slots are indexed with 32 bits in shared memory.
+  if (max_stats.getValue() == 0 || max_stats.getValue() >= UINT32_MAX) {
+    std::cerr << "error: invalid max stats '" << max_stats.getValue() << "'" << std::endl;
+    exit(1);
+  }
+
+  // Unless told otherwise, run one worker per CPU in the set.
+  concurrency_ = concurrency.isSet() || cpuset_.empty() ? concurrency.getValue() : cpuset_.size();
   config_path_ = config_path.getValue();
+  additional_config_paths_ = additional_config_paths.getValue();
   admin_address_path_ = admin_address_path.getValue();
+  startup_trace_path_ = startup_trace_path.getValue();
+  config_snapshot_dir_ = config_snapshot_dir.getValue();
+  log_queue_size_ = log_queue_size.getValue();
   restart_epoch_ = restart_epoch.getValue();
+  max_stats_ = max_stats.getValue();
+  max_recycled_objects_ = max_recycled_objects.getValue();
+  epoll_changelist_ = epoll_changelist.getValue();
   service_cluster_ = service_cluster.getValue();
   service_node_ = service_node.getValue();
   service_zone_ = service_zone.getValue();
   file_flush_interval_msec_ = std::chrono::milliseconds(file_flush_interval_msec.getValue());
   drain_time_ = std::chrono::seconds(drain_time_s.getValue());
+  drain_close_rate_ = drain_close_rate.getValue();
   parent_shutdown_time_ = std::chrono::seconds(parent_shutdown_time_s.getValue());
 }
+
+bool OptionsImpl::parseCpuset(const std::string& value, std::vector<uint32_t>& cpus) {
+  cpus.clear();
+  if (value.empty()) {
+    return true;
+  }
+
+  for (const std::string& range : StringUtil::split(value, ",", true)) {
+    const std::vector<std::string> bounds = StringUtil::split(range, "-", true);
+    uint64_t first;
+    uint64_t last;
+    if (bounds.empty() || bounds.size() > 2 || !StringUtil::atoul(bounds[0].c_str(), first) ||
+        !StringUtil::atoul(bounds.back().c_str(), last) || first > last ||
+        last >= std::numeric_limits<uint32_t>::max()) {
+      return false;
+    }
+
+    for (uint64_t cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  return true;
+}
 } // namespace Envoy
@@ -3,6 +3,7 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "envoy/server/options.h"
 
@@ -20,32 +21,60 @@ public:
   // Server::Options
   uint64_t baseId() override { return base_id_; }
   uint32_t concurrency() override { return concurrency_; }
+  const std::vector<uint32_t>& cpuset() override { return cpuset_; }
   const std::string& configPath() override { return config_path_; }
+  const std::vector<std::string>& additionalConfigPaths() override {
+    return additional_config_paths_;
+  }
   const std::string& adminAddressPath() override { return admin_address_path_; }
+  const std::string& startupTracePath() override { return startup_trace_path_; }
+  const std::string& configSnapshotDir() override { return config_snapshot_dir_; }
   Network::Address::IpVersion localAddressIpVersion() override { return local_address_ip_version_; }
   std::chrono::seconds drainTime() override { return drain_time_; }
+  uint64_t drainCloseRate() override { return drain_close_rate_; }
   spdlog::level::level_enum logLevel() override { return log_level_; }
+  uint64_t logQueueSize() override { return log_queue_size_; }
   std::chrono::seconds parentShutdownTime() override { return parent_shutdown_time_; }
   uint64_t restartEpoch() override { return restart_epoch_; }
+  uint64_t maxStats() override { return max_stats_; }
+  uint64_t maxRecycledObjects() override { return max_recycled_objects_; }
+  bool epollChangelist() override { return epoll_changelist_; }
   Server::Mode mode() const override { return mode_; }
   std::chrono::milliseconds fileFlushIntervalMsec() override { return file_flush_interval_msec_; }
   const std::string& serviceClusterName() override { return service_cluster_; }
   const std::string& serviceNodeName() override { return service_node_; }
   const std::string& serviceZone() override { return service_zone_; }
 
+  /**
+   * Parse a list of CPUs in the format used by taskset(1), such as "0-3,8,10-11".
+   * @param value supplies the list.
+   * @param cpus receives the CPUs in the order they appear.
+   * @return bool whether the list was valid.
+   */
+  static bool parseCpuset(const std::string& value, std::vector<uint32_t>& cpus);
+
 private:
   uint64_t base_id_;
   uint32_t concurrency_;
+  std::vector<uint32_t> cpuset_;
   std::string config_path_;
+  std::vector<std::string> additional_config_paths_;
   std::string admin_address_path_;
+  std::string startup_trace_path_;
+  std::string config_snapshot_dir_;
   Network::Address::IpVersion local_address_ip_version_;
   spdlog::level::level_enum log_level_;
+  uint64_t log_queue_size_;
   uint64_t restart_epoch_;
+  uint64_t max_stats_;
+  uint64_t max_recycled_objects_;
+  bool epoll_changelist_;
   std::string service_cluster_;
   std::string service_node_;
   std::string service_zone_;
   std::chrono::milliseconds file_flush_interval_msec_;
   std::chrono::seconds drain_time_;
+  uint64_t drain_close_rate_;
   std::chrono::seconds parent_shutdown_time_;
   Server::Mode mode_;
 };
@@ -0,0 +1,118 @@
+#include "server/overload_manager_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "common/upstream/resource_manager_impl.h"
+
+namespace Envoy {
+namespace Server {
+
+const uint64_t OverloadManagerImpl::DEFAULT_REFRESH_INTERVAL_MS;
+const uint64_t OverloadManagerImpl::DEFAULT_REDUCED_WATERMARK_PERCENT;
+const uint64_t OverloadManagerImpl::DEFAULT_REDUCED_RESOURCE_LIMIT_PERCENT;
+
+OverloadManagerImpl::OverloadManagerImpl(Event::Dispatcher& dispatcher, Runtime::Loader& runtime,
+                                         Stats::Scope& scope, ListenerManager& listener_manager,
+                                         AllocatedBytesCb allocated_bytes)
+    : runtime_(runtime), listener_manager_(listener_manager), allocated_bytes_(allocated_bytes),
+      stats_{ALL_OVERLOAD_STATS(POOL_COUNTER_PREFIX(scope, "overload."),
+                                POOL_GAUGE_PREFIX(scope, "overload."))},
+      refresh_timer_(dispatcher.createTimer([this]() -> void { refresh(); })) {
+  refresh_timer_->enableTimer(std::chrono::milliseconds(
+      runtime_.snapshot().getInteger("overload.refresh_interval_ms", DEFAULT_REFRESH_INTERVAL_MS)));
+}
+
+OverloadManagerImpl::~OverloadManagerImpl() {
+  Upstream::ResourceManagerImpl::setOverloadLimitPercent(100);
+}
+
+void OverloadManagerImpl::refresh() {
+  const Runtime::Snapshot& snapshot = runtime_.snapshot();
+  const uint64_t allocated = allocated_bytes_();
+  stats_.buffer_memory_allocated_.set(allocated);
+
+  const uint64_t stop_accepting_bytes =
+      snapshot.getInteger("overload.buffer_memory.stop_accepting_bytes", 0);
+  const uint64_t reduce_watermarks_bytes =
+      snapshot.getInteger("overload.buffer_memory.reduce_watermarks_bytes", 0);
+  const uint64_t shed_load_bytes = snapshot.getInteger("overload.buffer_memory.shed_load_bytes", 0);
+
+  const std::chrono::milliseconds loop_delay = listener_manager_.workerLoopDelay();
+  stats_.worker_loop_delay_ms_.set(loop_delay.count());
+  const uint64_t loop_delay_stop_accepting_ms =
+      snapshot.getInteger("overload.loop_delay.stop_accepting_ms", 0);
+  const uint64_t reduce_resource_limits_ms =
+      snapshot.getInteger("overload.loop_delay.reduce_resource_limits_ms", 0);
+
+  const bool loop_delay_stop_accepting =
+      loop_delay_stop_accepting_ms > 0 &&
+      static_cast<uint64_t>(loop_delay.count()) >= loop_delay_stop_accepting_ms;
+  if (loop_delay_stop_accepting != loop_delay_stop_accepting_) {
+    ENVOY_LOG(warn, "worker loop delay at {}ms, {} accepting connections", loop_delay.count(),
+              loop_delay_stop_accepting ? "stop" : "resume");
+  }
+  loop_delay_stop_accepting_ = loop_delay_stop_accepting;
+  stats_.loop_delay_stop_accepting_.set(loop_delay_stop_accepting ? 1 : 0);
+
+  uint32_t resource_limit_percent = 100;
+  if (reduce_resource_limits_ms > 0 &&
+      static_cast<uint64_t>(loop_delay.count()) >= reduce_resource_limits_ms) {
+    resource_limit_percent = std::max<uint64_t>(
+        1, std::min<uint64_t>(100, snapshot.getInteger(
+                                       "overload.loop_delay.reduced_resource_limit_percent",
+                                       DEFAULT_REDUCED_RESOURCE_LIMIT_PERCENT)));
+  }
+  if (resource_limit_percent != resource_limit_percent_) {
+    ENVOY_LOG(warn, "worker loop delay at {}ms, setting resource limits to {}% of configured",
+              loop_delay.count(), resource_limit_percent);
+    Upstream::ResourceManagerImpl::setOverloadLimitPercent(resource_limit_percent);
+    resource_limit_percent_ = resource_limit_percent;
+  }
+  stats_.reduce_resource_limits_.set(resource_limit_percent != 100 ? 1 : 0);
+
+  const bool memory_stop_accepting = stop_accepting_bytes > 0 && allocated >= stop_accepting_bytes;
+  Network::OverloadActions actions;
+  actions.stop_accepting_ = memory_stop_accepting || loop_delay_stop_accepting;
+  if (reduce_watermarks_bytes > 0 && allocated >= reduce_watermarks_bytes) {
+    actions.buffer_limit_percent_ = std::max<uint64_t>(
+        1, std::min<uint64_t>(100, snapshot.getInteger(
+                                       "overload.buffer_memory.reduced_watermark_percent",
+                                       DEFAULT_REDUCED_WATERMARK_PERCENT)));
+  }
+  if (shed_load_bytes > 0 && allocated > shed_load_bytes) {
+    actions.shed_bytes_ = allocated - shed_load_bytes;
+  }
+
+  if (memory_stop_accepting != memory_stop_accepting_) {
+    ENVOY_LOG(warn, "buffer memory at {} bytes, {} accepting connections", allocated,
+              memory_stop_accepting ? "stop" : "resume");
+  }
+  memory_stop_accepting_ = memory_stop_accepting;
+  if (actions.buffer_limit_percent_ != actions_.buffer_limit_percent_) {
+    ENVOY_LOG(warn, "buffer memory at {} bytes, setting buffer limits to {}% of configured",
+              allocated, actions.buffer_limit_percent_);
+  }
+  if (actions.shed_bytes_ > 0) {
+    ENVOY_LOG(warn, "buffer memory at {} bytes, shedding connections to free {} bytes", allocated,
+              actions.shed_bytes_);
+    stats_.shed_load_.inc();
+  }
+
+  stats_.stop_accepting_.set(actions.stop_accepting_ ? 1 : 0);
+  stats_.reduce_watermarks_.set(actions.buffer_limit_percent_ != 100 ? 1 : 0);
+
+  // Only push to the workers when there is something new for them to do.
+  if (actions.stop_accepting_ != actions_.stop_accepting_ ||
+      actions.buffer_limit_percent_ != actions_.buffer_limit_percent_ || actions.shed_bytes_ > 0) {
+    listener_manager_.applyOverloadActions(actions);
+  }
+  actions_ = actions;
+
+  refresh_timer_->enableTimer(std::chrono::milliseconds(
+      snapshot.getInteger("overload.refresh_interval_ms", DEFAULT_REFRESH_INTERVAL_MS)));
+}
+
+} // namespace Server
+} // namespace Envoy
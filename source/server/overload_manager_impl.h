@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/network/connection_handler.h"
+#include "envoy/runtime/runtime.h"
+#include "envoy/server/listener_manager.h"
+#include "envoy/stats/stats_macros.h"
+
+#include "common/common/logger.h"
+
+namespace Envoy {
+namespace Server {
+
+/**
+ * All overload manager stats. @see stats_macros.h
+ */
+// clang-format off
+#define ALL_OVERLOAD_STATS(COUNTER, GAUGE)                                                         \
+  COUNTER(shed_load)                                                                               \
+  GAUGE  (buffer_memory_allocated)                                                                 \
+  GAUGE  (stop_accepting)                                                                          \
+  GAUGE  (reduce_watermarks)                                                                       \
+  GAUGE  (worker_loop_delay_ms)                                                                    \
+  GAUGE  (loop_delay_stop_accepting)                                                               \
+  GAUGE  (reduce_resource_limits)
+// clang-format on
+
+/**
+ * Struct definition for all overload manager stats. @see stats_macros.h
+ */
+struct OverloadStats {
+  ALL_OVERLOAD_STATS(GENERATE_COUNTER_STRUCT, GENERATE_GAUGE_STRUCT)
+};
+
+/**
+ * Periodically compares the memory held by buffers across all workers against thresholds set in
+ * runtime and pushes the resulting actions to the workers. Each threshold is disabled when it is
+ * unset or 0:
+ *   overload.buffer_memory.stop_accepting_bytes: stop accepting new connections.
+ *   overload.buffer_memory.reduce_watermarks_bytes: scale the per connection buffer limits down
+ *     to overload.buffer_memory.reduced_watermark_percent (default 50) of their configured value.
+ *   overload.buffer_memory.shed_load_bytes: close the connections that buffer the most data until
+ *     the amount over the threshold has been freed.
+ *
+ * It does the same with how far the event loop of the worker that is furthest behind has fallen
+ * behind, in milliseconds, which shows when the workers run out of CPU:
+ *   overload.loop_delay.stop_accepting_ms: stop accepting new connections.
+ *   overload.loop_delay.reduce_resource_limits_ms: scale the resource limits of all clusters down
+ *     to overload.loop_delay.reduced_resource_limit_percent (default 50) of their configured value.
+ * The HTTP connection manager sheds load on each worker based on that worker's own loop delay.
+ */
+class OverloadManagerImpl : Logger::Loggable<Logger::Id::main> {
+public:
+  typedef std::function<uint64_t()> AllocatedBytesCb;
+
+  /**
+   * @param dispatcher supplies the main thread dispatcher used for the refresh timer.
+   * @param runtime supplies the runtime holding the thresholds.
+   * @param scope supplies the scope the stats are written to.
+   * @param listener_manager supplies the listener manager that forwards actions to the workers.
+   * @param allocated_bytes supplies the function returning the memory currently held by buffers.
+   */
+  OverloadManagerImpl(Event::Dispatcher& dispatcher, Runtime::Loader& runtime, Stats::Scope& scope,
+                      ListenerManager& listener_manager, AllocatedBytesCb allocated_bytes);
+  ~OverloadManagerImpl();
+
+  static const uint64_t DEFAULT_REFRESH_INTERVAL_MS = 1000;
+  static const uint64_t DEFAULT_REDUCED_WATERMARK_PERCENT = 50;
+  static const uint64_t DEFAULT_REDUCED_RESOURCE_LIMIT_PERCENT = 50;
+
+private:
+  void refresh();
+
+  Runtime::Loader& runtime_;
+  ListenerManager& listener_manager_;
+  AllocatedBytesCb allocated_bytes_;
+  OverloadStats stats_;
+  Event::TimerPtr refresh_timer_;
+  Network::OverloadActions actions_;
+  bool memory_stop_accepting_{};
+  bool loop_delay_stop_accepting_{};
+  uint32_t resource_limit_percent_{100};
+};
+
+typedef std::unique_ptr<OverloadManagerImpl> OverloadManagerImplPtr;
+
+} // namespace Server
+} // namespace Envoy
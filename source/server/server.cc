@@ -1,10 +1,19 @@
 #include "server/server.h"
 
 #include <signal.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <fstream>
 #include <functional>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "envoy/event/dispatcher.h"
 #include "envoy/event/signal.h"
@@ -14,22 +23,30 @@
 #include "envoy/upstream/cluster_manager.h"
 
 #include "common/api/api_impl.h"
+#include "common/buffer/buffer_impl.h"
+#include "common/common/hash.h"
 #include "common/common/utility.h"
 #include "common/common/version.h"
 #include "common/config/bootstrap_json.h"
+#include "common/config/snapshot_store.h"
+#include "common/filesystem/filesystem_impl.h"
+#include "common/grpc/async_client_impl.h"
 #include "common/local_info/local_info_impl.h"
 #include "common/memory/stats.h"
+#include "common/memory/utils.h"
 #include "common/network/address_impl.h"
 #include "common/protobuf/utility.h"
 #include "common/router/rds_impl.h"
 #include "common/runtime/runtime_impl.h"
 #include "common/singleton/manager_impl.h"
+#include "common/stats/metrics_service_sink.h"
 #include "common/stats/statsd.h"
 #include "common/upstream/cluster_manager_impl.h"
 
 #include "server/configuration_impl.h"
 #include "server/connection_handler_impl.h"
 #include "server/guarddog_impl.h"
+#include "server/overload_manager_impl.h"
 #include "server/test_hooks.h"
 
 #include "api/bootstrap.pb.h"
@@ -43,12 +60,16 @@ InstanceImpl::InstanceImpl(Options& options, Network::Address::InstanceConstShar
                            ComponentFactory& component_factory, ThreadLocal::Instance& tls)
     : options_(options), restarter_(restarter), start_time_(time(nullptr)),
       original_start_time_(start_time_),
-      stats_store_(store), server_stats_{ALL_SERVER_STATS(
-                               POOL_GAUGE_PREFIX(stats_store_, "server."))},
+      startup_start_(ProdMonotonicTimeSource::instance_.currentTime()),
+      startup_phase_start_(startup_start_), stats_store_(store),
+      server_stats_{ALL_SERVER_STATS(POOL_GAUGE_PREFIX(stats_store_, "server."))},
+      thread_usage_stats_(stats_store_),
       thread_local_(tls), api_(new Api::Impl(options.fileFlushIntervalMsec())),
-      dispatcher_(api_->allocateDispatcher()), singleton_manager_(new Singleton::ManagerImpl()),
-      handler_(new ConnectionHandlerImpl(ENVOY_LOGGER(), *dispatcher_)),
-      listener_component_factory_(*this), worker_factory_(thread_local_, *api_, hooks),
+      dispatcher_(api_->allocateDispatcher()), admin_dispatcher_(api_->allocateDispatcher()),
+      singleton_manager_(new Singleton::ManagerImpl()),
+      handler_(new ConnectionHandlerImpl(ENVOY_LOGGER(), *admin_dispatcher_)),
+      listener_component_factory_(*this),
+      worker_factory_(thread_local_, *api_, hooks, store, options.cpuset()),
       dns_resolver_(dispatcher_->createDnsResolver({})),
       access_log_manager_(*api_, *dispatcher_, access_log_lock, store) {
 
@@ -91,25 +112,33 @@ void InstanceImpl::failHealthcheck(bool fail) {
   server_stats_.live_.set(!fail);
 }
 
-void InstanceUtil::flushCountersAndGaugesToSinks(const std::list<Stats::SinkPtr>& sinks,
-                                                 Stats::Store& store) {
+void InstanceUtil::flushMetricsToSinks(const std::list<Stats::SinkPtr>& sinks,
+                                       Stats::Store& store) {
   for (const auto& sink : sinks) {
     sink->beginFlush();
   }
 
-  for (const Stats::CounterSharedPtr& counter : store.counters()) {
-    uint64_t delta = counter->latch();
-    if (counter->used()) {
-      for (const auto& sink : sinks) {
-        sink->flushCounter(counter->name(), delta);
-      }
+  // Only stats that changed since the last flush are sent. Sinks keep the last value of a gauge,
+  // and a counter that did not change has no delta to report.
+  store.forEachChangedCounter([&sinks](const std::string& name, Stats::Counter& counter) -> void {
+    const uint64_t delta = counter.latch();
+    for (const auto& sink : sinks) {
+      sink->flushCounter(name, delta);
     }
-  }
+  });
+
+  store.forEachChangedGauge([&sinks](const std::string& name, Stats::Gauge& gauge) -> void {
+    const uint64_t value = gauge.value();
+    for (const auto& sink : sinks) {
+      sink->flushGauge(name, value);
+    }
+  });
 
-  for (const Stats::GaugeSharedPtr& gauge : store.gauges()) {
-    if (gauge->used()) {
+  for (const Stats::HistogramSharedPtr& histogram : store.histograms()) {
+    histogram->merge();
+    if (histogram->used()) {
       for (const auto& sink : sinks) {
-        sink->flushGauge(gauge->name(), gauge->value());
+        sink->flushHistogram(histogram->name(), histogram->intervalStatistics());
       }
     }
   }
@@ -127,15 +156,75 @@ void InstanceImpl::flushStats() {
   server_stats_.memory_allocated_.set(Memory::Stats::totalCurrentlyAllocated() +
                                       info.memory_allocated_);
   server_stats_.memory_heap_size_.set(Memory::Stats::totalCurrentlyReserved());
+  server_stats_.memory_pageheap_free_.set(Memory::Stats::totalPageHeapFree());
+  server_stats_.memory_pageheap_unmapped_.set(Memory::Stats::totalPageHeapUnmapped());
+  server_stats_.memory_thread_cache_.set(Memory::Stats::totalThreadCacheBytes());
   server_stats_.parent_connections_.set(info.num_connections_);
   server_stats_.total_connections_.set(numConnections() + info.num_connections_);
   server_stats_.days_until_first_cert_expiring_.set(
       sslContextManager().daysUntilFirstCertExpires());
 
-  InstanceUtil::flushCountersAndGaugesToSinks(stat_sinks_, stats_store_);
+  HotRestart::StatsRegionInfo region_info;
+  restarter_.getStatsRegionInfo(region_info);
+  server_stats_.shared_stats_used_.set(region_info.stats_used_);
+  server_stats_.shared_stats_capacity_.set(region_info.stats_capacity_);
+  server_stats_.shared_symbols_used_.set(region_info.symbols_used_);
+  server_stats_.shared_symbols_capacity_.set(region_info.symbols_capacity_);
+  thread_usage_stats_.flush(Thread::UsageRegistry::instance().sample(),
+                            ProdMonotonicTimeSource::instance_.currentTime());
+
+  InstanceUtil::flushMetricsToSinks(stat_sinks_, stats_store_);
   stat_flush_timer_->enableTimer(config_->statsFlushInterval());
 }
 
+void InstanceImpl::releaseMemory() {
+  // Free pages above the threshold are returned to the system at a bounded rate, since releasing
+  // and later faulting in many pages at once is expensive.
+  const uint64_t threshold =
+      runtime().snapshot().getInteger("server.memory_release.free_threshold_bytes", 0);
+  const uint64_t free_bytes = Memory::Stats::totalPageHeapFree();
+  if (threshold > 0 && free_bytes > threshold) {
+    uint64_t release_bytes = free_bytes - threshold;
+    const uint64_t max_bytes =
+        runtime().snapshot().getInteger("server.memory_release.bytes_per_second", 0);
+    if (max_bytes > 0) {
+      release_bytes = std::min(release_bytes, max_bytes);
+    }
+    ENVOY_LOG(debug, "released {} bytes of free memory",
+              Memory::Utils::releaseFreeMemory(release_bytes));
+  }
+  memory_release_timer_->enableTimer(std::chrono::seconds(1));
+}
+
+void InstanceImpl::inheritParentHostHealth() {
+  if (runtime().snapshot().getInteger("health_check.inherit_parent_health", 0) == 0) {
+    return;
+  }
+
+  std::vector<HotRestart::UnhealthyHostInfo> unhealthy_hosts;
+  restarter_.getParentUnhealthyHosts(unhealthy_hosts);
+  std::unordered_map<std::string, std::unordered_set<std::string>> addresses_by_cluster;
+  for (const HotRestart::UnhealthyHostInfo& host : unhealthy_hosts) {
+    addresses_by_cluster[host.cluster_name_].insert(host.address_);
+  }
+
+  // Hosts are marked unhealthy through their health checker, which then needs the host to pass
+  // the healthy threshold of checks. Hosts of clusters without active health checking are left
+  // to outlier detection.
+  for (const auto& cluster : clusterManager().clusters()) {
+    const auto addresses = addresses_by_cluster.find(cluster.first);
+    if (addresses == addresses_by_cluster.end()) {
+      continue;
+    }
+    for (const Upstream::HostSharedPtr& host : cluster.second.get().hosts()) {
+      if (addresses->second.count(host->address()->asString()) > 0) {
+        host->healthChecker().setUnhealthy();
+      }
+    }
+  }
+  ENVOY_LOG(info, "inherited {} unhealthy hosts from parent", unhealthy_hosts.size());
+}
+
 void InstanceImpl::getParentStats(HotRestart::GetParentStatsInfo& info) {
   info.memory_allocated_ = Memory::Stats::totalCurrentlyAllocated();
   info.num_connections_ = numConnections();
@@ -150,18 +239,11 @@ void InstanceImpl::initialize(Options& options,
             restarter_.version());
 
   // Handle configuration that needs to take place prior to the main configuration load.
+  Config::SnapshotStore::setDirectory(options.configSnapshotDir());
   envoy::api::v2::Bootstrap bootstrap;
-  try {
-    MessageUtil::loadFromFile(options.configPath(), bootstrap);
-  } catch (const EnvoyException& e) {
-    // TODO(htuch): When v1 is deprecated, make this a warning encouraging config upgrade.
-    ENVOY_LOG(debug, "Unable to initialize config as v2, will retry as v1: {}", e.what());
-  }
-  if (!bootstrap.has_admin()) {
-    Json::ObjectSharedPtr config_json = Json::Factory::loadFromFile(options.configPath());
-    Config::BootstrapJson::translateBootstrap(*config_json, bootstrap);
-  }
+  loadBootstrap(options, bootstrap);
   bootstrap.mutable_node()->set_build_version(VersionInfo::version());
+  startupPhaseComplete("bootstrap");
 
   local_info_.reset(
       new LocalInfo::LocalInfoImpl(bootstrap.node(), local_address, options.serviceZone(),
@@ -179,8 +261,12 @@ void InstanceImpl::initialize(Options& options,
                              initial_config.admin().address(), *this));
 
   admin_scope_ = stats_store_.createScope("listener.admin.");
+  Network::ListenerOptions admin_listener_options =
+      Network::ListenerOptions::listenerOptionsWithBindToPort();
+  // Bound what the admin buffers for a slow client, so that streamed responses wait for it.
+  admin_listener_options.per_connection_buffer_limit_bytes_ = 1024 * 1024;
   handler_->addListener(*admin_, admin_->mutable_socket(), *admin_scope_, 0,
-                        Network::ListenerOptions::listenerOptionsWithBindToPort());
+                        admin_listener_options);
 
   loadServerFlags(initial_config.flagsPath());
 
@@ -188,12 +274,17 @@ void InstanceImpl::initialize(Options& options,
   listener_manager_.reset(
       new ListenerManagerImpl(*this, listener_component_factory_, worker_factory_));
 
+  // The admin thread runs the HTTP connection manager of the admin listener, which uses TLS.
+  thread_local_.registerThread(*admin_dispatcher_, false);
+
   // The main thread is also registered for thread local updates so that code that does not care
   // whether it runs on the main thread or on workers can still use TLS.
   thread_local_.registerThread(*dispatcher_, true);
 
   // We can now initialize stats for threading.
   stats_store_.initializeThreading(*dispatcher_, thread_local_);
+  dispatcher_->initializeStats(stats_store_, "server.dispatcher.");
+  admin_dispatcher_->initializeStats(stats_store_, "server.admin_dispatcher.");
 
   // Runtime gets initialized before the main configuration since during main configuration
   // load things may grab a reference to the loader for later use.
@@ -201,6 +292,7 @@ void InstanceImpl::initialize(Options& options,
 
   // Once we have runtime we can initialize the SSL context manager.
   ssl_context_manager_.reset(new Ssl::ContextManagerImpl(*runtime_loader_));
+  startupPhaseComplete("runtime");
 
   cluster_manager_factory_.reset(new Upstream::ProdClusterManagerFactory(
       runtime(), stats(), threadLocal(), random(), dnsResolver(), sslContextManager(), dispatcher(),
@@ -211,6 +303,7 @@ void InstanceImpl::initialize(Options& options,
   Configuration::MainImpl* main_config = new Configuration::MainImpl();
   config_.reset(main_config);
   main_config->initialize(bootstrap, *this, *cluster_manager_factory_);
+  startupPhaseComplete("static_resources");
 
   // Setup signals.
   sigterm_ = dispatcher_->listenForSignal(SIGTERM, [this]() -> void {
@@ -235,15 +328,63 @@ void InstanceImpl::initialize(Options& options,
   stat_flush_timer_ = dispatcher_->createTimer([this]() -> void { flushStats(); });
   stat_flush_timer_->enableTimer(config_->statsFlushInterval());
 
+  memory_release_timer_ = dispatcher_->createTimer([this]() -> void { releaseMemory(); });
+  memory_release_timer_->enableTimer(std::chrono::seconds(1));
+
   // GuardDog (deadlock detection) object and thread setup before workers are
   // started and before our own run() loop runs.
   guard_dog_.reset(
       new Server::GuardDogImpl(stats_store_, *config_, ProdMonotonicTimeSource::instance_));
 }
 
+void InstanceImpl::recordStartupTime(const std::string& name, const std::string& category,
+                                     MonotonicTime start, MonotonicTime end) {
+  const std::chrono::milliseconds took =
+      std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  ENVOY_LOG(info, "startup {} {} took {}ms", category, name, took.count());
+  startup_phase_times_.emplace_back(category == "phase" ? name : category + "." + name, took);
+  stats_store_.gauge("server.startup." + startup_phase_times_.back().first + "_ms")
+      .set(took.count());
+  startup_events_.push_back({name, category, start, end});
+}
+
+void InstanceImpl::startupPhaseComplete(const std::string& phase) {
+  const MonotonicTime now = ProdMonotonicTimeSource::instance_.currentTime();
+  recordStartupTime(phase, "phase", startup_phase_start_, now);
+  startup_phase_start_ = now;
+}
+
+void InstanceImpl::writeStartupTrace(const std::string& path) {
+  // The Chrome trace event format, with every phase and init target as a complete event.
+  std::ofstream trace(path);
+  if (!trace) {
+    ENVOY_LOG(warn, "unable to write startup trace to {}", path);
+    return;
+  }
+
+  const auto micros = [this](MonotonicTime time) -> int64_t {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - startup_start_).count();
+  };
+  trace << "{\"traceEvents\":[";
+  for (size_t i = 0; i < startup_events_.size(); i++) {
+    const StartupEvent& event = startup_events_[i];
+    trace << (i > 0 ? "," : "") << fmt::format(
+        "{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{},\"dur\":{},"
+        "\"pid\":{},\"tid\":{}}}",
+        StringUtil::escape(event.name_), event.category_, micros(event.start_),
+        micros(event.end_) - micros(event.start_), getpid(), event.category_ == "phase" ? 0 : 1);
+  }
+  trace << "]}\n";
+}
+
 void InstanceImpl::startWorkers() {
   listener_manager_->startWorkers(*guard_dog_);
 
+  // Overload actions are pushed to the workers, so only start watching once they are running.
+  overload_manager_.reset(new OverloadManagerImpl(*dispatcher_, runtime(), stats_store_,
+                                                  *listener_manager_,
+                                                  Buffer::Slice::allocatedBytes));
+
   // At this point we are ready to take traffic and all listening ports are up. Notify our parent
   // if applicable that they can stop listening and drain.
   restarter_.drainParentListeners();
@@ -271,8 +412,9 @@ Runtime::LoaderPtr InstanceUtil::createRuntime(Instance& server,
 void InstanceImpl::initializeStatSinks() {
   if (config_->statsdUdpIpAddress()) {
     ENVOY_LOG(info, "statsd UDP ip address: {}", config_->statsdUdpIpAddress()->asString());
-    stat_sinks_.emplace_back(
-        new Stats::Statsd::UdpStatsdSink(thread_local_, config_->statsdUdpIpAddress()));
+    stat_sinks_.emplace_back(new Stats::Statsd::UdpStatsdSink(
+        thread_local_, config_->statsdUdpIpAddress(), config_->statsdUdpMaxPacketSize(),
+        stats_store_));
     stats_store_.addSink(*stat_sinks_.back());
   }
 
@@ -283,6 +425,56 @@ void InstanceImpl::initializeStatSinks() {
                                          thread_local_, config_->clusterManager(), stats_store_));
     stats_store_.addSink(*stat_sinks_.back());
   }
+
+  if (config_->metricsServiceClusterName().valid()) {
+    const std::string& cluster_name = config_->metricsServiceClusterName().value();
+    ENVOY_LOG(info, "metrics service cluster: {}", cluster_name);
+    // The sink has no use for single histogram samples, so the store does not deliver them to it.
+    stat_sinks_.emplace_back(new Stats::MetricsServiceSink(
+        Stats::MetricsAsyncClientPtr{
+            new Grpc::AsyncClientImpl<pb::envoy::metrics::StreamMetricsMessage,
+                                      pb::envoy::metrics::StreamMetricsResponse>(
+                config_->clusterManager(), cluster_name)},
+        *local_info_, stats_store_));
+  }
+}
+
+void InstanceImpl::loadBootstrap(Options& options, envoy::api::v2::Bootstrap& bootstrap) {
+  // A snapshot is of the configuration file as this build translated it, so that an unchanged file
+  // is neither parsed nor validated again.
+  static const std::string snapshot_name = "bootstrap";
+  std::string snapshot_version;
+  if (Config::SnapshotStore::enabled() && Filesystem::fileExists(options.configPath())) {
+    snapshot_version =
+        fmt::format("{}/{:016x}", VersionInfo::version(),
+                    HashUtil::xxHash64(Filesystem::fileReadToEnd(options.configPath())));
+    envoy::api::v2::DiscoveryResponse snapshot;
+    if (Config::SnapshotStore::load(snapshot_name, snapshot) &&
+        snapshot.version_info() == snapshot_version && snapshot.resources().size() == 1 &&
+        snapshot.resources(0).UnpackTo(&bootstrap)) {
+      ENVOY_LOG(info, "loaded bootstrap snapshot of {}", options.configPath());
+      return;
+    }
+    bootstrap.Clear();
+  }
+
+  try {
+    MessageUtil::loadFromFile(options.configPath(), bootstrap);
+  } catch (const EnvoyException& e) {
+    // TODO(htuch): When v1 is deprecated, make this a warning encouraging config upgrade.
+    ENVOY_LOG(debug, "Unable to initialize config as v2, will retry as v1: {}", e.what());
+  }
+  if (!bootstrap.has_admin()) {
+    Json::ObjectSharedPtr config_json = Json::Factory::loadFromFile(options.configPath());
+    Config::BootstrapJson::translateBootstrap(*config_json, bootstrap);
+  }
+
+  if (!snapshot_version.empty()) {
+    envoy::api::v2::DiscoveryResponse snapshot;
+    snapshot.set_version_info(snapshot_version);
+    snapshot.add_resources()->PackFrom(bootstrap);
+    Config::SnapshotStore::store(snapshot_name, snapshot);
+  }
 }
 
 void InstanceImpl::loadServerFlags(const Optional<std::string>& flags_path) {
@@ -305,9 +497,26 @@ void InstanceImpl::run() {
   // this can fire immediately if all clusters have already initialized.
   clusterManager().setInitializedCb([this]() -> void {
     ENVOY_LOG(warn, "all clusters initialized. initializing init manager");
-    init_manager_.initialize([this]() -> void { startWorkers(); });
+    startupPhaseComplete("cluster_initialization");
+    inheritParentHostHealth();
+    init_manager_.setTargetInitializedCb(
+        [this](const std::string& name, MonotonicTime start, MonotonicTime end) -> void {
+          recordStartupTime(name, "init_target", start, end);
+        });
+    init_manager_.initialize([this]() -> void {
+      startupPhaseComplete("init_manager");
+      startWorkers();
+      startupPhaseComplete("workers");
+      if (!options_.startupTracePath().empty()) {
+        writeStartupTrace(options_.startupTracePath());
+      }
+    });
   });
 
+  // Admin requests are served from their own thread, so that slow clients and large responses do
+  // not hold up the main dispatch loop. Handlers still run on the main thread.
+  admin_thread_.reset(new Thread::Thread([this]() -> void { adminThreadRoutine(); }));
+
   // Run the main dispatch loop waiting to exit.
   ENVOY_LOG(warn, "starting main dispatch loop");
   auto watchdog = guard_dog_->createWatchDog(Thread::Thread::currentThreadId());
@@ -324,7 +533,10 @@ void InstanceImpl::run() {
   stats_store_.shutdownThreading();
 
   // Shutdown all the workers now that the main dispatch loop is done.
+  overload_manager_.reset();
   listener_manager_->stopWorkers();
+  admin_dispatcher_->exit();
+  admin_thread_->join();
 
   // Only flush if we have not been hot restarted.
   if (stat_flush_timer_) {
@@ -332,7 +544,6 @@ void InstanceImpl::run() {
   }
 
   config_->clusterManager().shutdown();
-  handler_.reset();
   thread_local_.shutdownThread();
   ENVOY_LOG(warn, "exiting");
   ENVOY_FLUSH_LOG();
@@ -345,11 +556,39 @@ void InstanceImpl::shutdown() {
   kill(getpid(), SIGTERM);
 }
 
+void InstanceImpl::adminThreadRoutine() {
+  ENVOY_LOG(info, "admin entering dispatch loop");
+  auto watchdog = guard_dog_->createWatchDog(Thread::Thread::currentThreadId());
+  watchdog->startWatchdog(*admin_dispatcher_);
+  admin_dispatcher_->run(Event::Dispatcher::RunType::Block);
+  ENVOY_LOG(info, "admin exited dispatch loop");
+  guard_dog_->stopWatching(watchdog);
+
+  // As on the workers, the admin connections must be closed before the thread exits so that no
+  // destructors that reference thread locals run on the main thread.
+  handler_.reset();
+  thread_local_.shutdownThread();
+  watchdog.reset();
+}
+
 void InstanceImpl::shutdownAdmin() {
   ENVOY_LOG(warn, "shutting down admin due to child startup");
   stat_flush_timer_.reset();
-  handler_->stopListeners();
-  admin_->mutable_socket().close();
+
+  // The listener belongs to the admin thread. Wait for it to close the socket, since the child
+  // binds the admin address once this returns.
+  std::mutex mutex;
+  std::condition_variable closed_event;
+  bool closed = false;
+  admin_dispatcher_->post([this, &mutex, &closed_event, &closed]() -> void {
+    handler_->stopListeners();
+    admin_->mutable_socket().close();
+    std::unique_lock<std::mutex> lock(mutex);
+    closed = true;
+    closed_event.notify_one();
+  });
+  std::unique_lock<std::mutex> lock(mutex);
+  closed_event.wait(lock, [&closed]() -> bool { return closed; });
 
   ENVOY_LOG(warn, "terminating parent process");
   restarter_.terminateParent();
@@ -8,6 +8,7 @@
 #include <string>
 
 #include "envoy/common/optional.h"
+#include "envoy/common/time.h"
 #include "envoy/server/configuration.h"
 #include "envoy/server/drain_manager.h"
 #include "envoy/server/guarddog.h"
@@ -17,15 +18,20 @@
 #include "envoy/tracing/http_tracer.h"
 
 #include "common/access_log/access_log_manager_impl.h"
+#include "common/common/thread.h"
 #include "common/runtime/runtime_impl.h"
 #include "common/ssl/context_manager_impl.h"
 
 #include "server/http/admin.h"
 #include "server/init_manager_impl.h"
 #include "server/listener_manager_impl.h"
+#include "server/overload_manager_impl.h"
 #include "server/test_hooks.h"
+#include "server/thread_usage_stats.h"
 #include "server/worker_impl.h"
 
+#include "api/bootstrap.pb.h"
+
 namespace Envoy {
 namespace Server {
 
@@ -37,11 +43,18 @@ namespace Server {
   GAUGE(uptime)                                                                                    \
   GAUGE(memory_allocated)                                                                          \
   GAUGE(memory_heap_size)                                                                          \
+  GAUGE(memory_pageheap_free)                                                                      \
+  GAUGE(memory_pageheap_unmapped)                                                                  \
+  GAUGE(memory_thread_cache)                                                                       \
   GAUGE(live)                                                                                      \
   GAUGE(parent_connections)                                                                        \
   GAUGE(total_connections)                                                                         \
   GAUGE(version)                                                                                   \
-  GAUGE(days_until_first_cert_expiring)
+  GAUGE(days_until_first_cert_expiring)                                                            \
+  GAUGE(shared_stats_used)                                                                         \
+  GAUGE(shared_stats_capacity)                                                                     \
+  GAUGE(shared_symbols_used)                                                                       \
+  GAUGE(shared_symbols_capacity)
 // clang-format on
 
 struct ServerStats {
@@ -78,13 +91,14 @@ public:
   static Runtime::LoaderPtr createRuntime(Instance& server, Server::Configuration::Initial& config);
 
   /**
-   * Helper for flushing counters and gauges to sinks. This takes care of calling beginFlush(),
-   * latching of counters and flushing, flushing of gauges, and calling endFlush(), on each sink.
+   * Helper for flushing counters, gauges, and histograms to sinks. This takes care of calling
+   * beginFlush(), latching of counters and flushing, flushing of gauges, merging of histograms and
+   * flushing, and calling endFlush(), on each sink. Only counters and gauges that changed since
+   * the last flush are flushed.
    * @param sinks supplies the list of sinks.
    * @param store supplies the store to flush.
    */
-  static void flushCountersAndGaugesToSinks(const std::list<Stats::SinkPtr>& sinks,
-                                            Stats::Store& store);
+  static void flushMetricsToSinks(const std::list<Stats::SinkPtr>& sinks, Stats::Store& store);
 };
 
 /**
@@ -129,30 +143,54 @@ public:
   Options& options() override { return options_; }
   time_t startTimeCurrentEpoch() override { return start_time_; }
   time_t startTimeFirstEpoch() override { return original_start_time_; }
+  const StartupPhaseTimes& startupPhaseTimes() override { return startup_phase_times_; }
   Stats::Store& stats() override { return stats_store_; }
   Tracing::HttpTracer& httpTracer() override;
   ThreadLocal::Instance& threadLocal() override { return thread_local_; }
   const LocalInfo::LocalInfo& localInfo() override { return *local_info_; }
 
 private:
+  void adminThreadRoutine();
   void flushStats();
+  void inheritParentHostHealth();
+  void releaseMemory();
   void initialize(Options& options, Network::Address::InstanceConstSharedPtr local_address,
                   ComponentFactory& component_factory);
   void initializeStatSinks();
+  void loadBootstrap(Options& options, envoy::api::v2::Bootstrap& bootstrap);
   void loadServerFlags(const Optional<std::string>& flags_path);
   uint64_t numConnections();
+  void recordStartupTime(const std::string& name, const std::string& category, MonotonicTime start,
+                         MonotonicTime end);
   void startWorkers();
+  void startupPhaseComplete(const std::string& phase);
+  void writeStartupTrace(const std::string& path);
+
+  struct StartupEvent {
+    std::string name_;
+    std::string category_;
+    MonotonicTime start_;
+    MonotonicTime end_;
+  };
 
   Options& options_;
   HotRestart& restarter_;
   const time_t start_time_;
   time_t original_start_time_;
+  StartupPhaseTimes startup_phase_times_;
+  const MonotonicTime startup_start_;
+  MonotonicTime startup_phase_start_;
+  std::vector<StartupEvent> startup_events_;
   Stats::StoreRoot& stats_store_;
   std::list<Stats::SinkPtr> stat_sinks_;
   ServerStats server_stats_;
+  ThreadUsageStats thread_usage_stats_;
   ThreadLocal::Instance& thread_local_;
   Api::ApiPtr api_;
   Event::DispatcherPtr dispatcher_;
+  // The admin listener and its connections run on their own thread, with this dispatcher.
+  Event::DispatcherPtr admin_dispatcher_;
+  Thread::ThreadPtr admin_thread_;
   std::unique_ptr<AdminImpl> admin_;
   Singleton::ManagerPtr singleton_manager_;
   Network::ConnectionHandlerPtr handler_;
@@ -169,12 +207,14 @@ private:
   Event::SignalEventPtr sig_hup_;
   Network::DnsResolverSharedPtr dns_resolver_;
   Event::TimerPtr stat_flush_timer_;
+  Event::TimerPtr memory_release_timer_;
   LocalInfo::LocalInfoPtr local_info_;
   DrainManagerPtr drain_manager_;
   AccessLog::AccessLogManagerImpl access_log_manager_;
   std::unique_ptr<Upstream::ClusterManagerFactory> cluster_manager_factory_;
   InitManagerImpl init_manager_;
   std::unique_ptr<Server::GuardDog> guard_dog_;
+  OverloadManagerImplPtr overload_manager_;
 };
 
 } // Server
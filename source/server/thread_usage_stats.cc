@@ -0,0 +1,45 @@
+#include "server/thread_usage_stats.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Envoy {
+namespace Server {
+
+namespace {
+
+uint64_t percent(std::chrono::nanoseconds part, std::chrono::nanoseconds whole) {
+  if (part.count() <= 0) {
+    return 0;
+  }
+  return std::min<uint64_t>(100, part.count() * 100 / whole.count());
+}
+
+} // namespace
+
+void ThreadUsageStats::flush(const std::vector<Thread::UsageRegistry::Sample>& samples,
+                             MonotonicTime now) {
+  std::unordered_map<std::string, LastSample> last_samples;
+  for (const Thread::UsageRegistry::Sample& sample : samples) {
+    auto last = last_samples_.find(sample.prefix_);
+    // A thread that was removed and added again under the same prefix starts over, which shows
+    // as its times going backwards.
+    if (last != last_samples_.end() && now > last->second.time_ &&
+        sample.cpu_time_ >= last->second.cpu_time_ &&
+        sample.idle_time_ >= last->second.idle_time_) {
+      const std::chrono::nanoseconds interval =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(now - last->second.time_);
+      scope_.gauge(sample.prefix_ + "cpu_percent")
+          .set(percent(sample.cpu_time_ - last->second.cpu_time_, interval));
+      if (sample.has_idle_time_) {
+        scope_.gauge(sample.prefix_ + "idle_percent")
+            .set(percent(sample.idle_time_ - last->second.idle_time_, interval));
+      }
+    }
+    last_samples[sample.prefix_] = {sample.cpu_time_, sample.idle_time_, now};
+  }
+  last_samples_.swap(last_samples);
+}
+
+} // namespace Server
+} // namespace Envoy
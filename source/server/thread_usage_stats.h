@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "envoy/common/time.h"
+#include "envoy/stats/stats.h"
+
+#include "common/common/thread.h"
+
+namespace Envoy {
+namespace Server {
+
+/**
+ * Publishes the CPU use of the threads in Thread::UsageRegistry once per stats flush, as the
+ * percentage of the time since the previous flush that each thread ran on a CPU, in
+ * <prefix>cpu_percent, and that it was idle, in <prefix>idle_percent. A thread is first reported
+ * at the flush after the one that first sampled it.
+ */
+class ThreadUsageStats {
+public:
+  ThreadUsageStats(Stats::Scope& scope) : scope_(scope) {}
+
+  /**
+   * @param samples supplies the current samples of all threads.
+   * @param now supplies the time the samples were taken.
+   */
+  void flush(const std::vector<Thread::UsageRegistry::Sample>& samples, MonotonicTime now);
+
+private:
+  struct LastSample {
+    std::chrono::nanoseconds cpu_time_;
+    std::chrono::nanoseconds idle_time_;
+    MonotonicTime time_;
+  };
+
+  Stats::Scope& scope_;
+  // By stat prefix. Threads that are gone are dropped at the next flush.
+  std::unordered_map<std::string, LastSample> last_samples_;
+};
+
+} // namespace Server
+} // namespace Envoy
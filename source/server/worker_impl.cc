@@ -9,21 +9,30 @@
 
 #include "common/common/thread.h"
 
-#include "server/connection_handler_impl.h"
-
 namespace Envoy {
 namespace Server {
 
-WorkerPtr ProdWorkerFactory::createWorker() {
+WorkerPtr ProdWorkerFactory::createWorker(uint32_t index) {
   Event::DispatcherPtr dispatcher(api_.allocateDispatcher());
-  return WorkerPtr{new WorkerImpl(
-      tls_, hooks_, std::move(dispatcher),
-      Network::ConnectionHandlerPtr{new ConnectionHandlerImpl(ENVOY_LOGGER(), *dispatcher)})};
+  dispatcher->initializeStats(stats_scope_,
+                              fmt::format("listener_manager.worker_{}.dispatcher.", index));
+  Stats::Gauge& cx_active =
+      stats_scope_.gauge(fmt::format("listener_manager.worker_{}.downstream_cx_active", index));
+  Optional<uint32_t> cpu;
+  if (!cpuset_.empty()) {
+    cpu = cpuset_[index % cpuset_.size()];
+  }
+  return WorkerPtr{new WorkerImpl(tls_, hooks_, std::move(dispatcher),
+                                  Network::ConnectionHandlerPtr{new ConnectionHandlerImpl(
+                                      ENVOY_LOGGER(), *dispatcher, balancer_, cx_active)},
+                                  index, cpu)};
 }
 
 WorkerImpl::WorkerImpl(ThreadLocal::Instance& tls, TestHooks& hooks,
-                       Event::DispatcherPtr&& dispatcher, Network::ConnectionHandlerPtr handler)
-    : tls_(tls), hooks_(hooks), dispatcher_(std::move(dispatcher)), handler_(std::move(handler)) {
+                       Event::DispatcherPtr&& dispatcher, Network::ConnectionHandlerPtr handler,
+                       uint32_t index, Optional<uint32_t> cpu)
+    : tls_(tls), hooks_(hooks), dispatcher_(std::move(dispatcher)), handler_(std::move(handler)),
+      index_(index), cpu_(cpu) {
   tls_.registerThread(*dispatcher_, false);
 }
 
@@ -47,14 +56,22 @@ void WorkerImpl::addListenerWorker(Listener& listener) {
                                                      .use_proxy_proto_ = listener.useProxyProto(),
                                                      .use_original_dst_ = listener.useOriginalDst(),
                                                      .per_connection_buffer_limit_bytes_ =
-                                                         listener.perConnectionBufferLimitBytes()};
+                                                         listener.perConnectionBufferLimitBytes(),
+                                                     .connection_balance_threshold_ =
+                                                         listener.connectionBalanceThreshold(),
+                                                     .tcp_fast_open_ = listener.tcpFastOpen(),
+                                                     .per_event_byte_budget_ =
+                                                         listener.perEventByteBudget(),
+                                                     .max_accepts_per_wakeup_ =
+                                                         listener.maxAcceptsPerWakeup(),
+                                                     .accept_limiter_ = listener.acceptLimiter()};
+  Network::ListenSocket& socket = listener.workerSocket(index_);
   if (listener.sslContext()) {
-    handler_->addSslListener(listener.filterChainFactory(), *listener.sslContext(),
-                             listener.socket(), listener.listenerScope(), listener.listenerTag(),
-                             listener_options);
+    handler_->addSslListener(listener.filterChainFactory(), *listener.sslContext(), socket,
+                             listener.listenerScope(), listener.listenerTag(), listener_options);
   } else {
-    handler_->addListener(listener.filterChainFactory(), listener.socket(),
-                          listener.listenerScope(), listener.listenerTag(), listener_options);
+    handler_->addListener(listener.filterChainFactory(), socket, listener.listenerScope(),
+                          listener.listenerTag(), listener_options);
   }
 
   hooks_.onWorkerListenerAdded();
@@ -103,7 +120,22 @@ void WorkerImpl::stopListeners() {
   dispatcher_->post([this]() -> void { handler_->stopListeners(); });
 }
 
+void WorkerImpl::applyOverloadActions(const Network::OverloadActions& actions) {
+  ASSERT(thread_);
+  dispatcher_->post([this, actions]() -> void { handler_->applyOverloadActions(actions); });
+}
+
 void WorkerImpl::threadRoutine(GuardDog& guard_dog) {
+  // Pin before the event loop runs, so that the buffers and caches the worker allocates on first
+  // use come from the memory of the CPU's NUMA node.
+  if (cpu_.valid()) {
+    if (Thread::Thread::pinCurrentThread(cpu_.value())) {
+      ENVOY_LOG(info, "worker pinned to cpu {}", cpu_.value());
+    } else {
+      ENVOY_LOG(warn, "unable to pin worker to cpu {}", cpu_.value());
+    }
+  }
+
   ENVOY_LOG(info, "worker entering dispatch loop");
   auto watchdog = guard_dog.createWatchDog(Thread::Thread::currentThreadId());
   watchdog->startWatchdog(*dispatcher_);
@@ -1,18 +1,23 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "envoy/api/api.h"
+#include "envoy/common/optional.h"
 #include "envoy/network/connection_handler.h"
 #include "envoy/server/guarddog.h"
 #include "envoy/server/listener_manager.h"
 #include "envoy/server/worker.h"
+#include "envoy/stats/stats.h"
 #include "envoy/thread_local/thread_local.h"
 
 #include "common/common/logger.h"
 #include "common/common/thread.h"
 
+#include "server/connection_handler_impl.h"
 #include "server/test_hooks.h"
 
 namespace Envoy {
@@ -20,16 +25,20 @@ namespace Server {
 
 class ProdWorkerFactory : public WorkerFactory, Logger::Loggable<Logger::Id::main> {
 public:
-  ProdWorkerFactory(ThreadLocal::Instance& tls, Api::Api& api, TestHooks& hooks)
-      : tls_(tls), api_(api), hooks_(hooks) {}
+  ProdWorkerFactory(ThreadLocal::Instance& tls, Api::Api& api, TestHooks& hooks,
+                    Stats::Scope& stats_scope, const std::vector<uint32_t>& cpuset)
+      : tls_(tls), api_(api), hooks_(hooks), stats_scope_(stats_scope), cpuset_(cpuset) {}
 
   // Server::WorkerFactory
-  WorkerPtr createWorker() override;
+  WorkerPtr createWorker(uint32_t index) override;
 
 private:
   ThreadLocal::Instance& tls_;
   Api::Api& api_;
   TestHooks& hooks_;
+  Stats::Scope& stats_scope_;
+  const std::vector<uint32_t> cpuset_;
+  ConnectionBalancer balancer_;
 };
 
 /**
@@ -38,7 +47,7 @@ private:
 class WorkerImpl : public Worker, Logger::Loggable<Logger::Id::main> {
 public:
   WorkerImpl(ThreadLocal::Instance& tls, TestHooks& hooks, Event::DispatcherPtr&& dispatcher,
-             Network::ConnectionHandlerPtr handler);
+             Network::ConnectionHandlerPtr handler, uint32_t index, Optional<uint32_t> cpu);
 
   // Server::Worker
   void addListener(Listener& listener, AddListenerCompletion completion) override;
@@ -48,6 +57,8 @@ public:
   void stop() override;
   void stopListener(Listener& listener) override;
   void stopListeners() override;
+  void applyOverloadActions(const Network::OverloadActions& actions) override;
+  std::chrono::milliseconds loopDelay() override { return dispatcher_->loopDelay(); }
 
 private:
   void addListenerWorker(Listener& listener);
@@ -57,6 +68,9 @@ private:
   TestHooks& hooks_;
   Event::DispatcherPtr dispatcher_;
   Network::ConnectionHandlerPtr handler_;
+  const uint32_t index_;
+  // The CPU to pin the worker thread to, if any.
+  const Optional<uint32_t> cpu_;
   Thread::ThreadPtr thread_;
 };
 
@@ -0,0 +1,21 @@
+// NOLINT(namespace-envoy)
+#include "common/common/logger.h"
+#include "common/common/thread.h"
+#include "common/event/libevent.h"
+
+#include "benchmark/benchmark.h"
+
+// The main entry point for all microbenchmarks. Logging is kept quiet so that it doesn't show up in
+// the measurements.
+int main(int argc, char** argv) {
+  Envoy::Event::Libevent::Global::initialize();
+  Envoy::Thread::MutexBasicLockable lock;
+  Envoy::Logger::Registry::initialize(spdlog::level::critical, lock);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Buffer {
+namespace {
+
+/**
+ * A buffer of the given size built from several slices with a needle at the very end, which is the
+ * worst case for search().
+ */
+OwnedImpl bufferWithNeedleAtEnd(uint64_t size, const std::string& needle) {
+  OwnedImpl buffer;
+  std::string data;
+  for (uint64_t i = 0; i < size - needle.size(); i++) {
+    data.push_back('a' + i % 23);
+  }
+  data += needle;
+
+  // Chop the data up the way reads from a socket would.
+  for (uint64_t offset = 0; offset < data.size(); offset += 4000) {
+    OwnedImpl piece(data.data() + offset, std::min<uint64_t>(4000, data.size() - offset));
+    buffer.move(piece);
+  }
+  return buffer;
+}
+
+/**
+ * The previous search(), as evbuffer_search() did it: memchr() for the first byte of the needle and
+ * a compare of the rest on every hit. Kept as a baseline.
+ */
+ssize_t firstByteSearch(const Instance& buffer, const std::string& needle) {
+  std::vector<RawSlice> slices(buffer.getRawSlices(nullptr, 0));
+  buffer.getRawSlices(slices.data(), slices.size());
+  uint64_t slice_start = 0;
+  for (size_t i = 0; i < slices.size(); i++) {
+    const char* begin = static_cast<const char*>(slices[i].mem_);
+    const char* end = begin + slices[i].len_;
+    for (const char* pos = begin; pos < end; pos++) {
+      pos = static_cast<const char*>(memchr(pos, needle[0], end - pos));
+      if (!pos) {
+        break;
+      }
+
+      // Compare the rest of the needle, continuing into later slices.
+      size_t matched = 0;
+      size_t slice = i;
+      const char* current = pos;
+      while (matched < needle.size() && slice < slices.size() && *current == needle[matched]) {
+        matched++;
+        if (++current == static_cast<const char*>(slices[slice].mem_) + slices[slice].len_ &&
+            ++slice < slices.size()) {
+          current = static_cast<const char*>(slices[slice].mem_);
+        }
+      }
+      if (matched == needle.size()) {
+        return slice_start + (pos - begin);
+      }
+    }
+    slice_start += slices[i].len_;
+  }
+  return -1;
+}
+
+void BM_OwnedImplSearch(benchmark::State& state) {
+  const std::string needle("\r\n\r\n");
+  OwnedImpl buffer = bufferWithNeedleAtEnd(state.range(0), needle);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(buffer.search(needle.data(), needle.size(), 0));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OwnedImplSearch)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+void BM_OwnedImplSearchBaseline(benchmark::State& state) {
+  const std::string needle("\r\n\r\n");
+  OwnedImpl buffer = bufferWithNeedleAtEnd(state.range(0), needle);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(firstByteSearch(buffer, needle));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OwnedImplSearchBaseline)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+// The first byte of the needle is common, so looking for it alone produces a lot of false hits.
+void BM_OwnedImplSearchCommonFirstByte(benchmark::State& state) {
+  const std::string needle("abcx");
+  OwnedImpl buffer = bufferWithNeedleAtEnd(state.range(0), needle);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(buffer.search(needle.data(), needle.size(), 0));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OwnedImplSearchCommonFirstByte)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+void BM_OwnedImplSearchCommonFirstByteBaseline(benchmark::State& state) {
+  const std::string needle("abcx");
+  OwnedImpl buffer = bufferWithNeedleAtEnd(state.range(0), needle);
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(firstByteSearch(buffer, needle));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OwnedImplSearchCommonFirstByteBaseline)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+void BM_OwnedImplFindFirstOfCrlf(benchmark::State& state) {
+  OwnedImpl buffer = bufferWithNeedleAtEnd(state.range(0), "\n");
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(buffer.findFirstOf("\r\n", 2, 0));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OwnedImplFindFirstOfCrlf)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+// More bytes than the vector path handles, which falls back to a table lookup.
+void BM_OwnedImplFindFirstOfLargeSet(benchmark::State& state) {
+  OwnedImpl buffer = bufferWithNeedleAtEnd(state.range(0), "\n");
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(buffer.findFirstOf("\r\n\t ;,", 6, 0));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_OwnedImplFindFirstOfLargeSet)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 18);
+
+} // namespace
+} // namespace Buffer
+} // namespace Envoy
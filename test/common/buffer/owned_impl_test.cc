@@ -0,0 +1,494 @@
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include "common/buffer/buffer_impl.h"
+
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Buffer {
+namespace {
+
+std::string randomString(uint64_t size) {
+  std::string data;
+  for (uint64_t i = 0; i < size; i++) {
+    data.push_back('a' + i % 26);
+  }
+  return data;
+}
+
+TEST(SliceTest, CreateRoundsUpToSizeClass) {
+  Slice small = Slice::create(10);
+  EXPECT_EQ(0, small.dataSize());
+  EXPECT_EQ(1024, small.reservableSize());
+
+  Slice medium = Slice::create(1025);
+  EXPECT_EQ(4096, medium.reservableSize());
+
+  Slice large = Slice::create(16384);
+  EXPECT_EQ(16384, large.reservableSize());
+
+  Slice oversized = Slice::create(16385);
+  EXPECT_EQ(16385, oversized.reservableSize());
+}
+
+TEST(SliceTest, FreedBlocksAreReused) {
+  uint8_t* mem;
+  {
+    Slice slice = Slice::create(4096);
+    mem = slice.data();
+  }
+
+  Slice slice = Slice::create(4096);
+  EXPECT_EQ(mem, slice.data());
+}
+
+TEST(SliceTest, SplitSharesBlock) {
+  Slice slice = Slice::create(100);
+  EXPECT_EQ(5, slice.append("hello", 5));
+  const uint8_t* mem = slice.data();
+
+  Slice front = slice.split(2);
+  EXPECT_EQ(mem, front.data());
+  EXPECT_EQ(2, front.dataSize());
+  EXPECT_EQ(mem + 2, slice.data());
+  EXPECT_EQ(3, slice.dataSize());
+
+  // Neither half may append while the block is shared.
+  EXPECT_EQ(0, front.reservableSize());
+  EXPECT_EQ(0, slice.append("x", 1));
+
+  {
+    Slice released = std::move(front);
+  }
+  EXPECT_EQ(1024 - 5, slice.reservableSize());
+}
+
+TEST(OwnedImplTest, AddAndDrain) {
+  OwnedImpl buffer;
+  EXPECT_EQ(0, buffer.length());
+  EXPECT_EQ(0, buffer.getRawSlices(nullptr, 0));
+
+  const std::string data = randomString(40000);
+  buffer.add(data);
+  EXPECT_EQ(40000, buffer.length());
+  EXPECT_EQ(data, TestUtility::bufferToString(buffer));
+  EXPECT_EQ(3, buffer.getRawSlices(nullptr, 0));
+
+  buffer.drain(20000);
+  EXPECT_EQ(20000, buffer.length());
+  EXPECT_EQ(data.substr(20000), TestUtility::bufferToString(buffer));
+  EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+
+  buffer.drain(20000);
+  EXPECT_EQ(0, buffer.length());
+  EXPECT_EQ(0, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST(OwnedImplTest, SmallAddsCoalesce) {
+  OwnedImpl buffer;
+  for (int i = 0; i < 100; i++) {
+    buffer.add("0123456789");
+  }
+  EXPECT_EQ(1000, buffer.length());
+  EXPECT_EQ(1, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST(OwnedImplTest, GetRawSlicesTruncated) {
+  OwnedImpl buffer(randomString(40000));
+  RawSlice slices[2];
+  EXPECT_EQ(3, buffer.getRawSlices(slices, 2));
+  EXPECT_EQ(16384, slices[0].len_);
+  EXPECT_EQ(16384, slices[1].len_);
+}
+
+TEST(OwnedImplTest, MoveAll) {
+  OwnedImpl buffer1("hello ");
+  OwnedImpl buffer2("world");
+  const void* mem = buffer2.linearize(5);
+  buffer1.move(buffer2);
+  EXPECT_EQ(0, buffer2.length());
+  EXPECT_EQ("hello world", TestUtility::bufferToString(buffer1));
+
+  // The slice is moved rather than copied.
+  RawSlice slices[2];
+  EXPECT_EQ(2, buffer1.getRawSlices(slices, 2));
+  EXPECT_EQ(mem, slices[1].mem_);
+
+  OwnedImpl buffer3;
+  buffer3.move(buffer1);
+  EXPECT_EQ(0, buffer1.length());
+  EXPECT_EQ("hello world", TestUtility::bufferToString(buffer3));
+}
+
+TEST(OwnedImplTest, MovePartial) {
+  const std::string data = randomString(20000);
+  OwnedImpl buffer1;
+  OwnedImpl buffer2(data);
+
+  buffer1.move(buffer2, 100);
+  EXPECT_EQ(100, buffer1.length());
+  EXPECT_EQ(19900, buffer2.length());
+  EXPECT_EQ(data.substr(0, 100), TestUtility::bufferToString(buffer1));
+  EXPECT_EQ(data.substr(100), TestUtility::bufferToString(buffer2));
+
+  // The split shares memory with the source buffer.
+  RawSlice slice1;
+  RawSlice slice2;
+  buffer1.getRawSlices(&slice1, 1);
+  buffer2.getRawSlices(&slice2, 1);
+  EXPECT_EQ(static_cast<uint8_t*>(slice1.mem_) + 100, slice2.mem_);
+
+  // Adding to either buffer must not overwrite the other's data.
+  buffer1.add("x");
+  EXPECT_EQ(data.substr(100), TestUtility::bufferToString(buffer2));
+  EXPECT_EQ(data.substr(0, 100) + "x", TestUtility::bufferToString(buffer1));
+
+  buffer1.move(buffer2, 19900);
+  EXPECT_EQ(0, buffer2.length());
+  EXPECT_EQ(data.substr(0, 100) + "x" + data.substr(100), TestUtility::bufferToString(buffer1));
+}
+
+TEST(OwnedImplTest, AddShared) {
+  const std::string data = randomString(20000);
+  OwnedImpl buffer1("hello ");
+  OwnedImpl buffer2(data);
+
+  buffer1.addShared(buffer2);
+  EXPECT_EQ(6 + 20000, buffer1.length());
+  EXPECT_EQ(20000, buffer2.length());
+  EXPECT_EQ("hello " + data, TestUtility::bufferToString(buffer1));
+
+  // The slices of the other buffer are referenced, not copied.
+  RawSlice slices1[3];
+  RawSlice slices2[2];
+  EXPECT_EQ(3, buffer1.getRawSlices(slices1, 3));
+  EXPECT_EQ(2, buffer2.getRawSlices(slices2, 2));
+  EXPECT_EQ(slices2[0].mem_, slices1[1].mem_);
+  EXPECT_EQ(slices2[1].mem_, slices1[2].mem_);
+
+  // Adding to or draining either buffer must not change the other's data.
+  buffer1.add("x");
+  buffer2.add("y");
+  EXPECT_EQ("hello " + data + "x", TestUtility::bufferToString(buffer1));
+  EXPECT_EQ(data + "y", TestUtility::bufferToString(buffer2));
+  buffer2.drain(20001);
+  EXPECT_EQ("hello " + data + "x", TestUtility::bufferToString(buffer1));
+}
+
+TEST(OwnedImplTest, AddBufferFragmentNoCleanup) {
+  const char input[] = "hello world";
+  BufferFragmentImpl fragment(input, 11, nullptr);
+  OwnedImpl buffer;
+  buffer.addBufferFragment(fragment);
+  EXPECT_EQ(11, buffer.length());
+
+  // The data is referenced, not copied.
+  RawSlice slice;
+  EXPECT_EQ(1, buffer.getRawSlices(&slice, 1));
+  EXPECT_EQ(input, slice.mem_);
+
+  buffer.drain(11);
+  EXPECT_EQ(0, buffer.length());
+}
+
+TEST(OwnedImplTest, AddBufferFragmentWithCleanup) {
+  std::string input(2048, 'a');
+  bool released = false;
+  BufferFragmentImpl fragment(
+      input.c_str(), input.size(),
+      [&released](const void*, size_t, const BufferFragmentImpl*) { released = true; });
+  OwnedImpl buffer("prefix");
+  buffer.addBufferFragment(fragment);
+  buffer.add("suffix");
+  EXPECT_EQ(2048 + 12, buffer.length());
+  EXPECT_EQ("prefix" + input + "suffix", TestUtility::bufferToString(buffer));
+
+  // Moving the fragment keeps referencing the same memory.
+  OwnedImpl other;
+  buffer.drain(6);
+  other.move(buffer, 1024);
+  RawSlice slice;
+  EXPECT_EQ(1, other.getRawSlices(&slice, 1));
+  EXPECT_EQ(input.c_str(), slice.mem_);
+  EXPECT_FALSE(released);
+
+  // Only released once both halves of the split are gone.
+  other.drain(1024);
+  EXPECT_FALSE(released);
+  buffer.drain(1024);
+  EXPECT_TRUE(released);
+  EXPECT_EQ("suffix", TestUtility::bufferToString(buffer));
+}
+
+TEST(OwnedImplTest, AddEmptyBufferFragment) {
+  bool released = false;
+  BufferFragmentImpl fragment(
+      nullptr, 0, [&released](const void*, size_t, const BufferFragmentImpl*) { released = true; });
+  OwnedImpl buffer;
+  buffer.addBufferFragment(fragment);
+  EXPECT_TRUE(released);
+  EXPECT_EQ(0, buffer.getRawSlices(nullptr, 0));
+}
+
+TEST(OwnedImplTest, WriteBufferFragment) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  const std::string input = randomString(1000);
+  bool released = false;
+  BufferFragmentImpl fragment(
+      input.c_str(), input.size(),
+      [&released](const void*, size_t, const BufferFragmentImpl*) { released = true; });
+  OwnedImpl buffer("header");
+  buffer.addBufferFragment(fragment);
+  EXPECT_EQ(1006, buffer.write(fds[1]));
+  EXPECT_TRUE(released);
+
+  OwnedImpl read_buffer;
+  while (read_buffer.length() < 1006) {
+    ASSERT_GT(read_buffer.read(fds[0], 1006 - read_buffer.length()), 0);
+  }
+  EXPECT_EQ("header" + input, TestUtility::bufferToString(read_buffer));
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(OwnedImplTest, Linearize) {
+  const std::string data = randomString(20000);
+  OwnedImpl buffer(data);
+  EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+
+  // Already contiguous.
+  EXPECT_EQ(0, memcmp(buffer.linearize(100), data.data(), 100));
+  EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+
+  void* mem = buffer.linearize(20000);
+  EXPECT_EQ(0, memcmp(mem, data.data(), 20000));
+  EXPECT_EQ(1, buffer.getRawSlices(nullptr, 0));
+  EXPECT_EQ(20000, buffer.length());
+  EXPECT_EQ(data, TestUtility::bufferToString(buffer));
+}
+
+TEST(OwnedImplTest, ReserveCommit) {
+  OwnedImpl buffer("hello");
+
+  // The space left in the last slice is handed out first.
+  RawSlice iovecs[2];
+  EXPECT_EQ(2, buffer.reserve(2000, iovecs, 2));
+  EXPECT_EQ(1024 - 5, iovecs[0].len_);
+  EXPECT_LE(2000 - iovecs[0].len_, iovecs[1].len_);
+  memcpy(iovecs[0].mem_, " ", 1);
+  iovecs[0].len_ = 1;
+  memcpy(iovecs[1].mem_, "world", 5);
+  iovecs[1].len_ = 5;
+  buffer.commit(iovecs, 2);
+  EXPECT_EQ("hello world", TestUtility::bufferToString(buffer));
+
+  // A single iovec always covers the whole reservation.
+  RawSlice iovec;
+  EXPECT_EQ(1, buffer.reserve(100000, &iovec, 1));
+  EXPECT_LE(100000, iovec.len_);
+  iovec.len_ = 0;
+  buffer.commit(&iovec, 1);
+  EXPECT_EQ(11, buffer.length());
+
+  // An uncommitted reservation is dropped by the next one.
+  EXPECT_EQ(1, buffer.reserve(100000, &iovec, 1));
+  EXPECT_EQ(1, buffer.reserve(10, &iovec, 1));
+  memcpy(iovec.mem_, "!", 1);
+  iovec.len_ = 1;
+  buffer.commit(&iovec, 1);
+  EXPECT_EQ("hello world!", TestUtility::bufferToString(buffer));
+}
+
+TEST(OwnedImplTest, Search) {
+  OwnedImpl buffer;
+  EXPECT_EQ(-1, buffer.search("a", 1, 0));
+  EXPECT_EQ(0, buffer.search("", 0, 0));
+
+  // Make the needle straddle a slice boundary.
+  OwnedImpl tail("needle in a haystack");
+  buffer.add(randomString(16380));
+  buffer.add("nee", 3);
+  buffer.move(tail);
+  EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+
+  EXPECT_EQ(16383, buffer.search("needle", 6, 0));
+  EXPECT_EQ(16383, buffer.search("needle", 6, 16383));
+  EXPECT_EQ(-1, buffer.search("needle", 6, 16384));
+  EXPECT_EQ(16383 + 12, buffer.search("haystack", 8, 0));
+  EXPECT_EQ(2, buffer.search("cde", 3, 0));
+  EXPECT_EQ(28, buffer.search("cde", 3, 3));
+  EXPECT_EQ(-1, buffer.search("haystacks", 9, 0));
+  EXPECT_EQ(-1, buffer.search("a", 1, buffer.length() + 1));
+}
+
+TEST(OwnedImplTest, SearchManySlices) {
+  // A needle that spans three slices, preceded by a partial match that also crosses a boundary.
+  OwnedImpl buffer;
+  for (const std::string& piece : {"xxab", "c", "abc", "d", "yy"}) {
+    OwnedImpl slice(piece);
+    buffer.move(slice);
+  }
+  EXPECT_EQ(5, buffer.getRawSlices(nullptr, 0));
+
+  EXPECT_EQ(5, buffer.search("abcd", 4, 0));
+  EXPECT_EQ(2, buffer.search("abc", 3, 0));
+  EXPECT_EQ(5, buffer.search("abc", 3, 3));
+  EXPECT_EQ(8, buffer.search("dyy", 3, 0));
+  EXPECT_EQ(-1, buffer.search("dyyy", 4, 0));
+}
+
+TEST(OwnedImplTest, SearchFrequentFirstByte) {
+  // Lots of partial matches before the real one, at every offset relative to the vector width and
+  // both within a slice and across the boundary into the next one.
+  for (size_t i = 0; i < 100; i++) {
+    OwnedImpl buffer(std::string(i, 'a') + "aab");
+    EXPECT_EQ(static_cast<ssize_t>(i + 1), buffer.search("ab", 2, 0));
+    EXPECT_EQ(static_cast<ssize_t>(i), buffer.search("aab", 3, 0));
+    EXPECT_EQ(-1, buffer.search("aac", 3, 0));
+
+    OwnedImpl tail("ab");
+    OwnedImpl split(std::string(i + 1, 'a'));
+    split.move(tail);
+    EXPECT_EQ(static_cast<ssize_t>(i), split.search("aab", 3, 0));
+    EXPECT_EQ(static_cast<ssize_t>(i), split.search("aab", 3, i));
+  }
+}
+
+TEST(OwnedImplTest, SearchFirstAndLastByteCandidates) {
+  // Candidates whose first and last bytes match but whose middle does not, so the vector scan has
+  // to check and reject each of them, with the match in the last position that fits.
+  std::string data;
+  for (int i = 0; i < 200; i++) {
+    data += "axxb";
+  }
+  for (size_t end = 0; end < 40; end++) {
+    OwnedImpl buffer(data + std::string(end, 'a') + "ayyb");
+    const ssize_t match = data.size() + end;
+    EXPECT_EQ(match, buffer.search("ayyb", 4, 0));
+    EXPECT_EQ(match, buffer.search("ayyb", 4, match));
+    EXPECT_EQ(-1, buffer.search("ayyb", 4, match + 1));
+    EXPECT_EQ(-1, buffer.search("axyb", 4, 0));
+    EXPECT_EQ(match + 3, buffer.search("b", 1, data.size()));
+  }
+}
+
+TEST(OwnedImplTest, FindFirstOf) {
+  OwnedImpl buffer;
+  EXPECT_EQ(-1, buffer.findFirstOf("\r\n", 2, 0));
+
+  // Put the delimiters at every offset relative to the vector width and across a slice boundary.
+  const std::string prefix(100, 'a');
+  for (size_t i = 0; i < prefix.size(); i++) {
+    std::string data = prefix;
+    data[i] = '\n';
+    OwnedImpl line(data);
+    EXPECT_EQ(static_cast<ssize_t>(i), line.findFirstOf("\r\n", 2, 0));
+    EXPECT_EQ(static_cast<ssize_t>(i), line.findFirstOf("\n", 1, 0));
+    EXPECT_EQ(static_cast<ssize_t>(i), line.findFirstOf("0123456789\n", 11, 0));
+    EXPECT_EQ(-1, line.findFirstOf("\r\n", 2, i + 1));
+  }
+
+  OwnedImpl tail("line\r\n");
+  buffer.add(prefix);
+  buffer.move(tail);
+  EXPECT_EQ(2, buffer.getRawSlices(nullptr, 0));
+  EXPECT_EQ(104, buffer.findFirstOf("\r\n", 2, 0));
+  EXPECT_EQ(105, buffer.findFirstOf("\n", 1, 0));
+  EXPECT_EQ(105, buffer.findFirstOf("\r\n", 2, 105));
+  EXPECT_EQ(100, buffer.findFirstOf("lmnopqrstuvwxyz", 15, 0));
+  EXPECT_EQ(-1, buffer.findFirstOf("z", 1, 0));
+  EXPECT_EQ(-1, buffer.findFirstOf("", 0, 0));
+  EXPECT_EQ(-1, buffer.findFirstOf("\n", 1, buffer.length()));
+}
+
+TEST(OwnedImplTest, ReadWrite) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  const std::string data = randomString(40000);
+  OwnedImpl write_buffer(data);
+  uint64_t written = 0;
+  while (written < data.size()) {
+    int rc = write_buffer.write(fds[1]);
+    ASSERT_GT(rc, 0);
+    written += rc;
+
+    OwnedImpl read_buffer;
+    while (read_buffer.length() < static_cast<uint64_t>(rc)) {
+      ASSERT_GT(read_buffer.read(fds[0], rc - read_buffer.length()), 0);
+    }
+    EXPECT_EQ(data.substr(written - rc, rc), TestUtility::bufferToString(read_buffer));
+  }
+  EXPECT_EQ(0, write_buffer.length());
+  EXPECT_EQ(0, write_buffer.write(fds[1]));
+
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(OwnedImplTest, Shrink) {
+  // A buffer that has never held data has no storage to iterate over.
+  OwnedImpl buffer;
+  buffer.shrink();
+  EXPECT_EQ(-1, buffer.findFirstOf("a", 1, 0));
+  EXPECT_EQ(0, buffer.getRawSlices(nullptr, 0));
+
+  // The data is kept, and a pending reservation is given up.
+  buffer.add("hello");
+  RawSlice iovecs[2];
+  EXPECT_EQ(2, buffer.reserve(2000, iovecs, 2));
+  buffer.shrink();
+  EXPECT_EQ("hello", TestUtility::bufferToString(buffer));
+
+  buffer.drain(5);
+  buffer.shrink();
+  EXPECT_EQ(0, buffer.length());
+  EXPECT_EQ(0, buffer.getRawSlices(nullptr, 0));
+
+  // The buffer keeps working after its storage is released.
+  buffer.add("world");
+  OwnedImpl other;
+  other.shrink();
+  other.move(buffer);
+  EXPECT_EQ("world", TestUtility::bufferToString(other));
+  EXPECT_EQ(0, buffer.length());
+}
+
+TEST(OwnedImplTest, AllocatedBytes) {
+  const uint64_t initial = Slice::allocatedBytes();
+  std::string data(1024, 'b');
+  BufferFragmentImpl fragment(data.data(), data.size(), nullptr);
+  {
+    OwnedImpl buffer(std::string(3 * Slice::DEFAULT_SIZE, 'a'));
+    EXPECT_LE(initial + 3 * Slice::DEFAULT_SIZE, Slice::allocatedBytes());
+
+    // Data moved between buffers stays accounted for once.
+    OwnedImpl other;
+    other.move(buffer);
+    EXPECT_LE(initial + 3 * Slice::DEFAULT_SIZE, Slice::allocatedBytes());
+    EXPECT_GT(initial + 5 * Slice::DEFAULT_SIZE, Slice::allocatedBytes());
+
+    // Fragments are owned elsewhere and don't count.
+    const uint64_t before_fragment = Slice::allocatedBytes();
+    other.addBufferFragment(fragment);
+    EXPECT_EQ(before_fragment, Slice::allocatedBytes());
+  }
+  EXPECT_EQ(initial, Slice::allocatedBytes());
+
+  // Slices released on another thread are still subtracted.
+  OwnedImpl* buffer = new OwnedImpl(std::string(Slice::DEFAULT_SIZE, 'a'));
+  std::thread([buffer]() { delete buffer; }).join();
+  EXPECT_EQ(initial, Slice::allocatedBytes());
+}
+
+} // namespace
+} // namespace Buffer
+} // namespace Envoy
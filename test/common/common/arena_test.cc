@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "common/common/arena.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+
+namespace {
+
+struct Tracked {
+  Tracked(std::vector<int>& destroyed, int id) : destroyed_(destroyed), id_(id) {}
+  ~Tracked() { destroyed_.push_back(id_); }
+
+  std::vector<int>& destroyed_;
+  const int id_;
+};
+
+} // namespace
+
+TEST(ArenaTest, AllocateIsAligned) {
+  Arena arena;
+  for (size_t alignment : {1, 2, 4, 8, 16, 64}) {
+    void* mem = arena.allocate(3, alignment);
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(mem) % alignment);
+  }
+}
+
+TEST(ArenaTest, SmallAllocationsShareBlock) {
+  Arena arena;
+  uint8_t* first = static_cast<uint8_t*>(arena.allocate(16, 1));
+  uint8_t* second = static_cast<uint8_t*>(arena.allocate(16, 1));
+  EXPECT_EQ(first + 16, second);
+  EXPECT_EQ(Arena::BLOCK_SIZE, arena.reservedBytes());
+}
+
+TEST(ArenaTest, FillsBlocks) {
+  Arena arena;
+  for (uint64_t i = 0; i < Arena::BLOCK_SIZE; i++) {
+    static_cast<uint8_t*>(arena.allocate(8, 8))[0] = 1;
+  }
+  EXPECT_LE(8U, arena.reservedBytes() / Arena::BLOCK_SIZE);
+  EXPECT_GE(9U, arena.reservedBytes() / Arena::BLOCK_SIZE);
+}
+
+TEST(ArenaTest, LargeAllocationKeepsCurrentBlock) {
+  Arena arena;
+  uint8_t* first = static_cast<uint8_t*>(arena.allocate(16, 1));
+  uint8_t* large = static_cast<uint8_t*>(arena.allocate(Arena::BLOCK_SIZE * 2, 1));
+  large[Arena::BLOCK_SIZE * 2 - 1] = 1;
+  uint8_t* second = static_cast<uint8_t*>(arena.allocate(16, 1));
+  EXPECT_EQ(first + 16, second);
+  EXPECT_LT(Arena::BLOCK_SIZE * 3, arena.reservedBytes());
+}
+
+TEST(ArenaTest, BlocksAreRecycled) {
+  void* first;
+  {
+    Arena arena;
+    first = arena.allocate(16, 1);
+  }
+  Arena arena;
+  EXPECT_EQ(first, arena.allocate(16, 1));
+}
+
+TEST(ArenaTest, CreateDestroysNewestFirst) {
+  std::vector<int> destroyed;
+  {
+    Arena arena;
+    arena.create<Tracked>(destroyed, 1);
+    arena.create<Tracked>(destroyed, 2);
+    uint64_t* trivial = arena.create<uint64_t>(3);
+    EXPECT_EQ(3U, *trivial);
+    arena.create<Tracked>(destroyed, 4);
+    EXPECT_TRUE(destroyed.empty());
+  }
+  EXPECT_EQ((std::vector<int>{4, 2, 1}), destroyed);
+}
+
+TEST(ArenaTest, Containers) {
+  Arena arena;
+  std::vector<std::string, ArenaAllocator<std::string>> strings{ArenaAllocator<std::string>(arena)};
+  std::list<int, ArenaAllocator<int>> ints{ArenaAllocator<int>(arena)};
+  for (int i = 0; i < 1000; i++) {
+    strings.push_back(std::to_string(i));
+    ints.push_back(i);
+  }
+
+  EXPECT_EQ("999", strings.back());
+  EXPECT_EQ(1000U, ints.size());
+  EXPECT_EQ(ArenaAllocator<int>(arena), ints.get_allocator());
+}
+
+} // namespace Envoy
@@ -4,6 +4,7 @@
 #include "common/common/base64.h"
 
 #include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
 
 #include "gtest/gtest.h"
 
@@ -108,4 +109,69 @@ TEST(Base64Test, BinaryBufferEncode) {
   EXPECT_EQ("AAECAwgKCQCqvA==", Base64::encode(buffer, 10));
   EXPECT_EQ("AAECAwgKCQCqvN4=", Base64::encode(buffer, 30));
 }
+
+TEST(Base64Test, BufferEncodeToBuffer) {
+  Buffer::OwnedImpl buffer;
+  buffer.add("\0\1\2\3", 4);
+  buffer.add("\b\n\t", 4);
+  buffer.add("\xaa\xbc\xde", 3);
+  Buffer::OwnedImpl output("prefix");
+  Base64::encode(buffer, output);
+  EXPECT_EQ("prefixAAECAwgKCQCqvN4=", TestUtility::bufferToString(output));
+
+  Buffer::OwnedImpl empty;
+  Base64::encode(empty, output);
+  EXPECT_EQ("prefixAAECAwgKCQCqvN4=", TestUtility::bufferToString(output));
+}
+
+TEST(Base64StreamDecoderTest, Decode) {
+  const std::string encoded = Base64::encode("foobar\0\1\xff", 9);
+  for (size_t split = 0; split <= encoded.size(); split++) {
+    Base64StreamDecoder decoder;
+    Buffer::OwnedImpl output;
+    Buffer::OwnedImpl input;
+    input.add(encoded.substr(0, split));
+    EXPECT_TRUE(decoder.decode(input, output));
+    EXPECT_EQ(split % 4, decoder.pending());
+    EXPECT_EQ(std::string("foobar\0\1\xff", 9).substr(0, split / 4 * 3),
+              TestUtility::bufferToString(output));
+
+    Buffer::OwnedImpl rest;
+    rest.add(encoded.substr(split));
+    EXPECT_TRUE(decoder.decode(rest, output));
+    EXPECT_EQ(0U, decoder.pending());
+    EXPECT_EQ(std::string("foobar\0\1\xff", 9), TestUtility::bufferToString(output));
+  }
+}
+
+TEST(Base64StreamDecoderTest, DecodeAcrossSlices) {
+  Base64StreamDecoder decoder;
+  Buffer::OwnedImpl input;
+  input.add("Z");
+  input.add("m9vY");
+  input.add("g=");
+  input.add("=");
+  Buffer::OwnedImpl output;
+  EXPECT_TRUE(decoder.decode(input, output));
+  EXPECT_EQ("foob", TestUtility::bufferToString(output));
+  EXPECT_EQ(0U, decoder.pending());
+}
+
+TEST(Base64StreamDecoderTest, DecodeConcatenated) {
+  Base64StreamDecoder decoder;
+  Buffer::OwnedImpl input("Zg==Zm8=Zm9v");
+  Buffer::OwnedImpl output;
+  EXPECT_TRUE(decoder.decode(input, output));
+  EXPECT_EQ("ffofoo", TestUtility::bufferToString(output));
+}
+
+TEST(Base64StreamDecoderTest, DecodeFailure) {
+  for (const std::string input : {"==Zg", "=Zm8", "Zm=8", "Zg=A", "Zh==", "Zm9=", "Zg..", "..Zg",
+                                  "A==="}) {
+    Base64StreamDecoder decoder;
+    Buffer::OwnedImpl buffer(input);
+    Buffer::OwnedImpl output;
+    EXPECT_FALSE(decoder.decode(buffer, output)) << input;
+  }
+}
 } // namespace Envoy
@@ -0,0 +1,14 @@
+#include <string>
+
+#include "common/common/hash.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+TEST(Hash, xxHash64) {
+  EXPECT_EQ(0xef46db3751d8e999U, HashUtil::xxHash64(""));
+  EXPECT_EQ(0x44bc2cf5ad770999U, HashUtil::xxHash64("abc"));
+  EXPECT_EQ(0xfbcea83c8a378bf1U, HashUtil::xxHash64("Nobody inspects the spammish repetition"));
+  EXPECT_EQ(HashUtil::xxHash64("abc"), HashUtil::xxHash64("abcd", 3));
+}
+} // namespace Envoy
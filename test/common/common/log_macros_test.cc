@@ -1,7 +1,10 @@
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include "common/common/logger.h"
+#include "common/common/thread.h"
 
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/network/mocks.h"
@@ -20,6 +23,15 @@ public:
     ENVOY_STREAM_LOG(info, "fake message", stream_);
   }
 
+  uint32_t logDebugCountingEvaluations() {
+    uint32_t evaluations = 0;
+    ENVOY_LOG(debug, "fake message {}", ++evaluations);
+    if (ENVOY_LOG_CHECK_LEVEL(debug)) {
+      ++evaluations;
+    }
+    return evaluations;
+  }
+
 private:
   NiceMock<Network::MockConnection> connection_;
   NiceMock<Http::MockStreamDecoderFilterCallbacks> stream_;
@@ -34,4 +46,40 @@ TEST(Logger, All) {
   // Misc logging with no facility.
   ENVOY_LOG_MISC(info, "fake message");
 }
+
+TEST(Logger, DisabledLevelSkipsArguments) {
+  TestFilterLog filter;
+  spdlog::logger& logger = Logger::Registry::getLog(Logger::Id::filter);
+  const spdlog::level::level_enum level = logger.level();
+
+  logger.set_level(spdlog::level::info);
+  EXPECT_EQ(0U, filter.logDebugCountingEvaluations());
+  logger.set_level(spdlog::level::trace);
+  EXPECT_EQ(2U, filter.logDebugCountingEvaluations());
+  logger.set_level(level);
+}
+
+TEST(Logger, AsyncSinkDropsWhenFull) {
+  std::shared_ptr<Logger::LockingStderrSink> sink = std::make_shared<Logger::LockingStderrSink>();
+  spdlog::logger logger("async_test", sink);
+  Thread::MutexBasicLockable lock;
+  sink->setLock(lock);
+  sink->setAsync(2);
+
+  {
+    // The writer blocks on the held lock, so at most a batch of messages it has taken and a full
+    // queue are kept and the rest are dropped.
+    std::lock_guard<Thread::MutexBasicLockable> guard(lock);
+    for (uint32_t i = 0; i < 10; i++) {
+      logger.info("fake message {}", i);
+    }
+    EXPECT_LE(6U, sink->dropped());
+  }
+
+  sink->flush();
+  sink->setAsync(0);
+  const uint64_t dropped = sink->dropped();
+  logger.info("fake message");
+  EXPECT_EQ(dropped, sink->dropped());
+}
 } // namespace Envoy
\ No newline at end of file
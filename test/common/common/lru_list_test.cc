@@ -0,0 +1,30 @@
+#include <string>
+
+#include "common/common/lru_list.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+
+TEST(LruListTest, Order) {
+  LruList<std::string> lru;
+  EXPECT_TRUE(lru.empty());
+
+  LruList<std::string>::Position a = lru.insert("a");
+  LruList<std::string>::Position b = lru.insert("b");
+  lru.insert("c");
+  EXPECT_EQ(3U, lru.size());
+  EXPECT_EQ("a", lru.leastRecentlyUsed());
+
+  lru.touch(a);
+  EXPECT_EQ("b", lru.leastRecentlyUsed());
+
+  // Positions stay valid as other entries are touched and removed.
+  lru.remove(b);
+  EXPECT_EQ("c", lru.leastRecentlyUsed());
+  lru.touch(a);
+  EXPECT_EQ("c", lru.leastRecentlyUsed());
+  EXPECT_EQ(2U, lru.size());
+}
+
+} // namespace Envoy
@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <thread>
+
+#include "common/common/recycler.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+
+namespace {
+
+class Base {
+public:
+  virtual ~Base() {}
+};
+
+class Small : public Base, public Recycled {
+public:
+  uint64_t data_[4];
+};
+
+class Large : public Small {
+public:
+  uint64_t more_data_[64];
+};
+
+class RecyclerTest : public testing::Test {
+public:
+  RecyclerTest() { Recycler::maxFreeObjects(2); }
+  ~RecyclerTest() { Recycler::maxFreeObjects(0); }
+};
+
+} // namespace
+
+TEST_F(RecyclerTest, ReusesMemoryOfSameSize) {
+  Small* first = new Small();
+  delete first;
+  Small* second = new Small();
+  EXPECT_EQ(first, second);
+  delete second;
+}
+
+TEST_F(RecyclerTest, ReleasesWithDynamicSize) {
+  Base* large = new Large();
+  void* memory = large;
+  delete large;
+
+  // The memory went to the free list of Large, not of Small.
+  Small* small = new Small();
+  EXPECT_NE(memory, static_cast<Base*>(small));
+  Large* other = new Large();
+  EXPECT_EQ(memory, static_cast<Base*>(other));
+  delete small;
+  delete other;
+}
+
+TEST_F(RecyclerTest, SameSizeClass) {
+  void* memory = Recycler::allocate(17);
+  Recycler::release(memory, 17);
+  EXPECT_EQ(memory, Recycler::allocate(32));
+  Recycler::release(memory, 32);
+}
+
+TEST_F(RecyclerTest, Cap) {
+  void* objects[3];
+  for (void*& object : objects) {
+    object = Recycler::allocate(64);
+  }
+  for (void* object : objects) {
+    Recycler::release(object, 64);
+  }
+
+  // Only the last two fit in the free list, and they come back newest first.
+  EXPECT_EQ(objects[1], Recycler::allocate(64));
+  EXPECT_EQ(objects[0], Recycler::allocate(64));
+  void* fresh = Recycler::allocate(64);
+  Recycler::release(objects[0], 64);
+  Recycler::release(objects[1], 64);
+  Recycler::release(fresh, 64);
+}
+
+TEST_F(RecyclerTest, ThreadExit) {
+  std::thread thread([]() { delete new Small(); });
+  thread.join();
+}
+
+} // namespace Envoy
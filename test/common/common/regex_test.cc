@@ -0,0 +1,54 @@
+#include <string>
+#include <vector>
+
+#include "envoy/common/exception.h"
+
+#include "common/common/regex.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Regex {
+
+TEST(RegexPattern, FullMatch) {
+  Pattern pattern("/users/\\d+");
+  EXPECT_TRUE(pattern.fullMatch("/users/123"));
+  EXPECT_FALSE(pattern.fullMatch("/users/123/location"));
+  EXPECT_FALSE(pattern.fullMatch("/api/users/123"));
+}
+
+TEST(RegexPattern, Groups) {
+  Pattern pattern("([0-9a-f]+);([0-9a-f]+)(;cs)?");
+  std::vector<std::string> groups;
+  const std::string value = "12ab;34cd";
+  EXPECT_TRUE(pattern.fullMatch(value.data(), value.size(), &groups));
+  EXPECT_EQ((std::vector<std::string>{"12ab", "34cd", ""}), groups);
+
+  const std::string invalid = "12ab;34cd;sr";
+  EXPECT_FALSE(pattern.fullMatch(invalid.data(), invalid.size(), &groups));
+}
+
+TEST(RegexPattern, Invalid) {
+  EXPECT_THROW(Pattern("/users/(\\d+"), EnvoyException);
+  // RE2 runs in linear time and does not support lookaround.
+  EXPECT_THROW(Pattern("/users/(?!validate)\\w+"), EnvoyException);
+}
+
+TEST(RegexPatternSet, FullMatch) {
+  PatternSet set({"/users/\\d+/.*", "/rides", "/users/\\d+/location"});
+  std::vector<int> indexes;
+  const std::string location = "/users/123/location";
+  EXPECT_TRUE(set.fullMatch(location.data(), location.size(), indexes));
+  EXPECT_EQ((std::vector<int>{0, 2}), indexes);
+
+  const std::string rides = "/rides/123";
+  EXPECT_FALSE(set.fullMatch(rides.data(), rides.size(), indexes));
+  EXPECT_TRUE(indexes.empty());
+}
+
+TEST(RegexPatternSet, Invalid) {
+  EXPECT_THROW(PatternSet({"/rides", "/users/(\\d+"}), EnvoyException);
+}
+
+} // namespace Regex
+} // namespace Envoy
@@ -74,6 +74,26 @@ TEST(StringUtil, rtrim) {
   }
 }
 
+TEST(StringUtil, trim) {
+  {
+    std::string test(" \t ");
+    StringUtil::trim(test);
+    EXPECT_EQ("", test);
+  }
+
+  {
+    std::string test("  hello world \r\n");
+    StringUtil::trim(test);
+    EXPECT_EQ("hello world", test);
+  }
+}
+
+TEST(StringUtil, trimView) {
+  EXPECT_EQ("", StringUtil::trimView(" \t ").toString());
+  EXPECT_EQ("hello world", StringUtil::trimView("  hello world \r\n").toString());
+  EXPECT_EQ("hello", StringUtil::trimView("hello").toString());
+}
+
 TEST(StringUtil, strlcpy) {
   {
     char dest[6];
@@ -135,6 +155,40 @@ TEST(StringUtil, split) {
               ContainerEq(StringUtil::split("hello   world", " ", true)));
 }
 
+TEST(StringUtil, splitToViews) {
+  auto split = [](StringView source, char delimiter, bool keep_empty_string) {
+    std::vector<std::string> ret;
+    for (const StringView piece : StringUtil::splitToViews(source, delimiter, keep_empty_string)) {
+      ret.push_back(piece.toString());
+    }
+    return ret;
+  };
+
+  EXPECT_EQ(std::vector<std::string>{}, split("", ',', false));
+  EXPECT_EQ(std::vector<std::string>{"a"}, split("a", ',', false));
+  EXPECT_EQ(std::vector<std::string>{"hello"}, split(",hello,", ',', false));
+  EXPECT_EQ(std::vector<std::string>{}, split(",,", ',', false));
+  EXPECT_THAT(std::vector<std::string>({"hello", "world"}),
+              ContainerEq(split("hello,,world", ',', false)));
+  EXPECT_THAT(std::vector<std::string>({"", "hello", "", "world", ""}),
+              ContainerEq(split(",hello,,world,", ',', true)));
+
+  // The pieces point into the source.
+  const std::string source("hello,world");
+  const std::vector<StringView> views = StringUtil::splitToViews(source, ',');
+  ASSERT_EQ(2U, views.size());
+  EXPECT_EQ(source.data(), views[0].data());
+  EXPECT_EQ(source.data() + 6, views[1].data());
+}
+
+TEST(StringUtil, caseInsensitiveEqual) {
+  EXPECT_TRUE(StringUtil::caseInsensitiveEqual("GZip", "gzip"));
+  EXPECT_TRUE(StringUtil::caseInsensitiveEqual("", ""));
+  EXPECT_FALSE(StringUtil::caseInsensitiveEqual("gzip", "gzi"));
+  EXPECT_FALSE(StringUtil::caseInsensitiveEqual("gzip", "zip"));
+  EXPECT_TRUE(StringUtil::caseInsensitiveEqual(StringView("gzip, br", 4), "GZIP"));
+}
+
 TEST(StringUtil, join) {
   EXPECT_EQ("hello,world", StringUtil::join({"hello", "world"}, ","));
   EXPECT_EQ("hello", StringUtil::join({"hello"}, ","));
@@ -171,6 +225,12 @@ TEST(StringUtil, startsWith) {
   EXPECT_FALSE(StringUtil::startsWith("test", "testtest"));
   EXPECT_FALSE(StringUtil::startsWith("test", "TESTTEST", false));
   EXPECT_FALSE(StringUtil::startsWith("", "test"));
+
+  const StringView view("q=0.5;level=1", 5);
+  EXPECT_TRUE(StringUtil::startsWith(view, "q="));
+  EXPECT_TRUE(StringUtil::startsWith(view, "Q=", false));
+  EXPECT_FALSE(StringUtil::startsWith(view, "Q="));
+  EXPECT_FALSE(StringUtil::startsWith(view, "q=0.5;"));
 }
 
 TEST(StringUtil, escape) {
@@ -0,0 +1,45 @@
+#include <string>
+#include <vector>
+
+#include "common/common/waiter_list.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+
+namespace {
+
+struct Waiter {
+  std::string name_;
+};
+
+} // namespace
+
+TEST(WaiterListTest, NotifyAll) {
+  Waiter a{"a"};
+  Waiter b{"b"};
+  Waiter c{"c"};
+  WaiterList<Waiter> waiters;
+  waiters.add(a);
+  waiters.add(b);
+  waiters.add(c);
+  waiters.remove(b);
+
+  // A waiter that waits again while being notified is left in the list for the next result.
+  std::vector<std::string> notified;
+  waiters.notifyAll([&](Waiter& waiter) -> void {
+    notified.push_back(waiter.name_);
+    if (&waiter == &c) {
+      waiters.add(c);
+    }
+  });
+  EXPECT_EQ((std::vector<std::string>{"a", "c"}), notified);
+  EXPECT_FALSE(waiters.empty());
+
+  notified.clear();
+  waiters.notifyAll([&](Waiter& waiter) -> void { notified.push_back(waiter.name_); });
+  EXPECT_EQ((std::vector<std::string>{"c"}), notified);
+  EXPECT_TRUE(waiters.empty());
+}
+
+} // namespace Envoy
@@ -0,0 +1,64 @@
+#include <string>
+#include <vector>
+
+#include "envoy/common/optional.h"
+
+#include "common/config/cds_json.h"
+#include "common/json/config_schemas.h"
+#include "common/json/json_loader.h"
+
+#include "api/cds.pb.h"
+#include "benchmark/benchmark.h"
+#include "fmt/format.h"
+
+namespace Envoy {
+namespace Config {
+namespace {
+
+/**
+ * @return std::string a v1 CDS response with a number of static and SDS clusters.
+ */
+std::string cdsResponseJson(uint32_t num_clusters) {
+  std::string json = R"EOF({"clusters": [)EOF";
+  for (uint32_t cluster = 0; cluster < num_clusters; cluster++) {
+    if (cluster > 0) {
+      json += ",";
+    }
+    if (cluster % 2 == 0) {
+      json += fmt::format(R"EOF({{"name": "cluster_{0}", "type": "static",
+                             "connect_timeout_ms": 250, "lb_type": "round_robin",
+                             "hosts": [{{"url": "tcp://10.0.{1}.{2}:443"}}]}})EOF",
+                          cluster, cluster / 256 % 256, cluster % 256);
+    } else {
+      json += fmt::format(R"EOF({{"name": "cluster_{0}", "type": "sds",
+                             "service_name": "service_{0}", "connect_timeout_ms": 250,
+                             "lb_type": "least_request",
+                             "circuit_breakers": {{"default": {{"max_connections": 100}}}}}})EOF",
+                          cluster);
+    }
+  }
+  return json + "]}";
+}
+
+/**
+ * Applies a CDS response of state.range(0) clusters as CdsSubscription does: the response is
+ * loaded and validated, and each cluster is validated and translated.
+ */
+void BM_CdsResponseTranslate(benchmark::State& state) {
+  const std::string json = cdsResponseJson(state.range(0));
+  const Optional<envoy::api::v2::ConfigSource> eds_config{envoy::api::v2::ConfigSource()};
+  while (state.KeepRunning()) {
+    Json::ObjectSharedPtr response = Json::Factory::loadFromString(json);
+    response->validateSchema(Json::Schema::CDS_SCHEMA);
+    for (const Json::ObjectSharedPtr& json_cluster : response->getObjectArray("clusters")) {
+      envoy::api::v2::Cluster cluster;
+      CdsJson::translateCluster(*json_cluster, eds_config, cluster);
+      benchmark::DoNotOptimize(cluster);
+    }
+  }
+}
+BENCHMARK(BM_CdsResponseTranslate)->Arg(100)->Arg(1000)->Arg(5000);
+
+} // namespace
+} // namespace Config
+} // namespace Envoy
@@ -0,0 +1,100 @@
+#include "common/config/delta_subscription_impl.h"
+#include "common/config/utility.h"
+#include "common/protobuf/utility.h"
+
+#include "test/common/config/subscription_test_harness.h"
+#include "test/mocks/config/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "api/cds.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+using testing::SaveArg;
+using testing::UnorderedElementsAre;
+using testing::_;
+
+namespace Envoy {
+namespace Config {
+namespace {
+
+typedef Protobuf::RepeatedPtrField<envoy::api::v2::Cluster> Clusters;
+
+class DeltaSubscriptionImplTest : public testing::Test {
+public:
+  DeltaSubscriptionImplTest()
+      : subscription_(new MockSubscription<envoy::api::v2::Cluster>()),
+        delta_subscription_(
+            std::unique_ptr<Subscription<envoy::api::v2::Cluster>>(subscription_)) {
+    EXPECT_CALL(*subscription_, start(_, _)).WillOnce(SaveArg<1>(&subscription_callbacks_));
+    delta_subscription_.start({}, callbacks_);
+  }
+
+  // Clusters of the given names, with a connect timeout of the given milliseconds.
+  Clusters clusters(const std::vector<std::pair<std::string, uint32_t>>& clusters) {
+    Clusters result;
+    for (const auto& cluster : clusters) {
+      auto* resource = result.Add();
+      resource->set_name(cluster.first);
+      resource->mutable_connect_timeout()->set_nanos(cluster.second * 1000000);
+    }
+    return result;
+  }
+
+  std::vector<uint64_t> hashes(const Clusters& clusters) {
+    std::vector<uint64_t> result;
+    for (const auto& cluster : clusters) {
+      result.push_back(MessageUtil::hash(cluster));
+    }
+    return result;
+  }
+
+  MockSubscription<envoy::api::v2::Cluster>* subscription_;
+  DeltaSubscriptionImpl<envoy::api::v2::Cluster> delta_subscription_;
+  SubscriptionCallbacks<envoy::api::v2::Cluster>* subscription_callbacks_{};
+  MockDeltaSubscriptionCallbacks<envoy::api::v2::Cluster> callbacks_;
+};
+
+// Validate that only added, changed and removed resources are delivered.
+TEST_F(DeltaSubscriptionImplTest, Changes) {
+  const Clusters added = clusters({{"a", 1}, {"b", 1}});
+  EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(added), hashes(added), IsEmpty()));
+  subscription_callbacks_->onConfigUpdate(added);
+
+  const Clusters changed = clusters({{"b", 2}, {"c", 1}});
+  EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(changed), hashes(changed), IsEmpty()));
+  subscription_callbacks_->onConfigUpdate(clusters({{"a", 1}, {"b", 2}, {"c", 1}}));
+
+  EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(Clusters()), IsEmpty(), ElementsAre("a")));
+  subscription_callbacks_->onConfigUpdate(clusters({{"b", 2}, {"c", 1}}));
+
+  // An update without changes is still delivered.
+  EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(Clusters()), IsEmpty(), IsEmpty()));
+  subscription_callbacks_->onConfigUpdate(clusters({{"b", 2}, {"c", 1}}));
+}
+
+// Validate that the changes of a rejected update are delivered again with the next one.
+TEST_F(DeltaSubscriptionImplTest, Rejected) {
+  EXPECT_CALL(callbacks_, onConfigUpdate(_, _, _));
+  subscription_callbacks_->onConfigUpdate(clusters({{"a", 1}, {"b", 1}}));
+
+  EXPECT_CALL(callbacks_,
+              onConfigUpdate(RepeatedProtoEq(clusters({{"c", 1}})), _, ElementsAre("b")))
+      .WillOnce(ThrowOnRejectedConfig(false));
+  EXPECT_THROW(subscription_callbacks_->onConfigUpdate(clusters({{"a", 1}, {"c", 1}})),
+               EnvoyException);
+
+  // The offered cluster is removed, as it may have been added.
+  EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(clusters({{"d", 1}})), _,
+                                         UnorderedElementsAre("b", "c")));
+  subscription_callbacks_->onConfigUpdate(clusters({{"a", 1}, {"d", 1}}));
+
+  EXPECT_CALL(callbacks_, onConfigUpdateFailed(nullptr));
+  subscription_callbacks_->onConfigUpdateFailed(nullptr);
+}
+
+} // namespace
+} // namespace Config
+} // namespace Envoy
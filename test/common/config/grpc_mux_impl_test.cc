@@ -0,0 +1,180 @@
+#include "common/config/grpc_mux_impl.h"
+#include "common/config/utility.h"
+
+#include "test/common/config/subscription_test_harness.h"
+#include "test/mocks/config/mocks.h"
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/grpc/mocks.h"
+#include "test/mocks/stats/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "api/eds.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Mock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Config {
+namespace {
+
+typedef Grpc::MockAsyncClient<envoy::api::v2::DiscoveryRequest, envoy::api::v2::DiscoveryResponse>
+    MuxMockAsyncClient;
+typedef GrpcMuxImpl<envoy::api::v2::ClusterLoadAssignment> GrpcEdsMuxImpl;
+typedef GrpcMuxSubscriptionImpl<envoy::api::v2::ClusterLoadAssignment> GrpcEdsMuxSubscriptionImpl;
+typedef Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> LoadAssignments;
+
+class GrpcMuxImplTest : public testing::Test {
+public:
+  GrpcMuxImplTest()
+      : async_client_(new MuxMockAsyncClient()),
+        // The retry timer is created first, so its expectation is set last.
+        flush_timer_(new Event::MockTimer(&dispatcher_)),
+        retry_timer_(new Event::MockTimer(&dispatcher_)),
+        stats1_(Utility::generateStats(stats_store_)),
+        stats2_(Utility::generateStats(stats_store2_)) {
+    node_.set_id("fo0");
+    mux_ = std::make_shared<GrpcEdsMuxImpl>(
+        node_, std::unique_ptr<MuxMockAsyncClient>(async_client_), dispatcher_,
+        *Protobuf::DescriptorPool::generated_pool()->FindMethodByName(
+            "envoy.api.v2.EndpointDiscoveryService.StreamEndpoints"));
+    subscription1_.reset(new GrpcEdsMuxSubscriptionImpl(mux_, stats1_));
+    subscription2_.reset(new GrpcEdsMuxSubscriptionImpl(mux_, stats2_));
+  }
+
+  void expectSendMessage(const std::vector<std::string>& cluster_names,
+                         const std::string& version) {
+    envoy::api::v2::DiscoveryRequest expected_request;
+    expected_request.mutable_node()->CopyFrom(node_);
+    for (const auto& cluster : cluster_names) {
+      expected_request.add_resource_names(cluster);
+    }
+    if (!version.empty()) {
+      expected_request.set_version_info(version);
+    }
+    EXPECT_CALL(async_stream_, sendMessage(ProtoEq(expected_request), false));
+  }
+
+  // Starts both subscriptions, which share one stream and one request.
+  void start() {
+    EXPECT_CALL(*flush_timer_, enableTimer(std::chrono::milliseconds(0)));
+    subscription1_->start({"cluster1"}, callbacks1_);
+    subscription2_->start({"cluster2", "cluster1"}, callbacks2_);
+    EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+    expectSendMessage({"cluster1", "cluster2"}, "");
+    flush_timer_->callback_();
+    Mock::VerifyAndClearExpectations(&async_stream_);
+  }
+
+  std::unique_ptr<envoy::api::v2::DiscoveryResponse>
+  response(const std::vector<std::string>& cluster_names, const std::string& version) {
+    std::unique_ptr<envoy::api::v2::DiscoveryResponse> response(
+        new envoy::api::v2::DiscoveryResponse());
+    response->set_version_info(version);
+    for (const auto& cluster : cluster_names) {
+      envoy::api::v2::ClusterLoadAssignment load_assignment;
+      load_assignment.set_cluster_name(cluster);
+      response->add_resources()->PackFrom(load_assignment);
+    }
+    return response;
+  }
+
+  LoadAssignments loadAssignments(const std::vector<std::string>& cluster_names) {
+    LoadAssignments load_assignments;
+    for (const auto& cluster : cluster_names) {
+      load_assignments.Add()->set_cluster_name(cluster);
+    }
+    return load_assignments;
+  }
+
+  envoy::api::v2::Node node_;
+  Event::MockDispatcher dispatcher_;
+  MuxMockAsyncClient* async_client_;
+  Event::MockTimer* flush_timer_;
+  Event::MockTimer* retry_timer_;
+  Grpc::MockAsyncStream<envoy::api::v2::DiscoveryRequest> async_stream_;
+  Stats::MockIsolatedStatsStore stats_store_;
+  Stats::MockIsolatedStatsStore stats_store2_;
+  SubscriptionStats stats1_;
+  SubscriptionStats stats2_;
+  MockSubscriptionCallbacks<envoy::api::v2::ClusterLoadAssignment> callbacks1_;
+  MockSubscriptionCallbacks<envoy::api::v2::ClusterLoadAssignment> callbacks2_;
+  GrpcEdsMuxImpl::SharedPtr mux_;
+  std::unique_ptr<GrpcEdsMuxSubscriptionImpl> subscription1_;
+  std::unique_ptr<GrpcEdsMuxSubscriptionImpl> subscription2_;
+};
+
+// Validate that each subscription gets the resources it named, and the response is acknowledged.
+TEST_F(GrpcMuxImplTest, SharedStream) {
+  start();
+
+  EXPECT_CALL(callbacks1_, onConfigUpdate(RepeatedProtoEq(loadAssignments({"cluster1"}))));
+  EXPECT_CALL(callbacks2_,
+              onConfigUpdate(RepeatedProtoEq(loadAssignments({"cluster2", "cluster1"}))));
+  expectSendMessage({"cluster1", "cluster2"}, "1");
+  mux_->onReceiveMessage(response({"cluster1", "cluster2", "cluster3"}, "1"));
+  EXPECT_EQ(1UL, stats1_.update_success_.value());
+  EXPECT_EQ(1UL, stats2_.update_success_.value());
+
+  // Only the subscriptions that resources are for get an update.
+  EXPECT_CALL(callbacks1_, onConfigUpdate(_)).Times(0);
+  EXPECT_CALL(callbacks2_, onConfigUpdate(RepeatedProtoEq(loadAssignments({"cluster2"}))));
+  expectSendMessage({"cluster1", "cluster2"}, "2");
+  mux_->onReceiveMessage(response({"cluster2"}, "2"));
+
+  // Changes to the subscriptions are sent together.
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  subscription1_->updateResources({"cluster3"});
+  subscription2_.reset();
+  expectSendMessage({"cluster3"}, "2");
+  flush_timer_->callback_();
+
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  subscription1_.reset();
+}
+
+// Validate that a response is not acknowledged if any subscription rejects its part of it.
+TEST_F(GrpcMuxImplTest, Rejected) {
+  start();
+
+  EXPECT_CALL(callbacks1_, onConfigUpdate(_)).WillOnce(ThrowOnRejectedConfig(false));
+  EXPECT_CALL(callbacks1_, onConfigUpdateFailed(_));
+  EXPECT_CALL(callbacks2_, onConfigUpdate(_));
+  expectSendMessage({"cluster1", "cluster2"}, "");
+  mux_->onReceiveMessage(response({"cluster1", "cluster2"}, "1"));
+  EXPECT_EQ(1UL, stats1_.update_rejected_.value());
+  EXPECT_EQ(1UL, stats2_.update_success_.value());
+
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+}
+
+// Validate that all subscriptions learn of a remote stream closure, and share the retry.
+TEST_F(GrpcMuxImplTest, RemoteStreamClose) {
+  start();
+
+  EXPECT_CALL(callbacks1_, onConfigUpdateFailed(nullptr));
+  EXPECT_CALL(callbacks2_, onConfigUpdateFailed(nullptr));
+  EXPECT_CALL(*retry_timer_, enableTimer(_));
+  mux_->onRemoteClose(Grpc::Status::GrpcStatus::Canceled, "");
+  EXPECT_EQ(1UL, stats1_.update_failure_.value());
+  EXPECT_EQ(1UL, stats2_.update_failure_.value());
+
+  // Changes while the retry is pending don't open a stream early.
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  subscription1_->updateResources({"cluster3"});
+  EXPECT_CALL(*async_client_, start(_, _)).Times(0);
+  flush_timer_->callback_();
+
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  expectSendMessage({"cluster1", "cluster2", "cluster3"}, "");
+  retry_timer_->callback_();
+  EXPECT_EQ(2UL, stats1_.update_attempt_.value());
+
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+}
+
+} // namespace
+} // namespace Config
+} // namespace Envoy
@@ -0,0 +1,118 @@
+#include "common/config/snapshot_store.h"
+#include "common/config/snapshot_subscription_impl.h"
+#include "common/protobuf/utility.h"
+
+#include "test/common/config/subscription_test_harness.h"
+#include "test/mocks/config/mocks.h"
+#include "test/test_common/environment.h"
+#include "test/test_common/utility.h"
+
+#include "api/cds.pb.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::_;
+
+namespace Envoy {
+namespace Config {
+namespace {
+
+typedef Protobuf::RepeatedPtrField<envoy::api::v2::Cluster> Clusters;
+
+class SnapshotSubscriptionImplTest : public testing::Test {
+public:
+  SnapshotSubscriptionImplTest() {
+    SnapshotStore::setDirectory(TestEnvironment::temporaryDirectory());
+  }
+
+  ~SnapshotSubscriptionImplTest() { SnapshotStore::setDirectory(""); }
+
+  // A started subscription, whose snapshot is delivered to callbacks_ if there is one.
+  std::unique_ptr<SnapshotSubscriptionImpl<envoy::api::v2::Cluster>>
+  start(const std::vector<std::string>& resources) {
+    subscription_ = new MockSubscription<envoy::api::v2::Cluster>();
+    std::unique_ptr<SnapshotSubscriptionImpl<envoy::api::v2::Cluster>> snapshot_subscription(
+        new SnapshotSubscriptionImpl<envoy::api::v2::Cluster>(
+            std::unique_ptr<Subscription<envoy::api::v2::Cluster>>(subscription_)));
+    EXPECT_CALL(*subscription_, start(resources, _))
+        .WillOnce(Invoke([this](const std::vector<std::string>&,
+                                SubscriptionCallbacks<envoy::api::v2::Cluster>& callbacks) -> void {
+          subscription_callbacks_ = &callbacks;
+        }));
+    snapshot_subscription->start(resources, callbacks_);
+    return snapshot_subscription;
+  }
+
+  Clusters clusters(const std::vector<std::string>& names) {
+    Clusters result;
+    for (const std::string& name : names) {
+      result.Add()->set_name(name);
+    }
+    return result;
+  }
+
+  MockSubscription<envoy::api::v2::Cluster>* subscription_{};
+  SubscriptionCallbacks<envoy::api::v2::Cluster>* subscription_callbacks_{};
+  MockSubscriptionCallbacks<envoy::api::v2::Cluster> callbacks_;
+};
+
+// Validate that the last accepted update is delivered when a later subscription starts, before
+// the wrapped subscription delivers anything.
+TEST_F(SnapshotSubscriptionImplTest, LoadsLastAcceptedUpdate) {
+  {
+    auto subscription = start({"snapshot_test"});
+    EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(clusters({"a"}))));
+    subscription_callbacks_->onConfigUpdate(clusters({"a"}));
+    EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(clusters({"a", "b"}))));
+    subscription_callbacks_->onConfigUpdate(clusters({"a", "b"}));
+
+    // Rejected updates are not kept.
+    EXPECT_CALL(callbacks_, onConfigUpdate(_)).WillOnce(ThrowOnRejectedConfig(false));
+    EXPECT_THROW(subscription_callbacks_->onConfigUpdate(clusters({"c"})), EnvoyException);
+
+    EXPECT_CALL(callbacks_, onConfigUpdateFailed(nullptr));
+    subscription_callbacks_->onConfigUpdateFailed(nullptr);
+  }
+
+  EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(clusters({"a", "b"}))));
+  auto subscription = start({"snapshot_test"});
+
+  // Subscriptions to other resources have their own snapshots.
+  EXPECT_CALL(callbacks_, onConfigUpdate(_)).Times(0);
+  start({"snapshot_test_other"});
+}
+
+// Validate that a rejected snapshot still lets the wrapped subscription start.
+TEST_F(SnapshotSubscriptionImplTest, RejectedSnapshot) {
+  {
+    auto subscription = start({"snapshot_test_rejected"});
+    EXPECT_CALL(callbacks_, onConfigUpdate(_));
+    subscription_callbacks_->onConfigUpdate(clusters({"a"}));
+  }
+
+  EXPECT_CALL(callbacks_, onConfigUpdate(RepeatedProtoEq(clusters({"a"}))))
+      .WillOnce(ThrowOnRejectedConfig(false));
+  auto subscription = start({"snapshot_test_rejected"});
+  EXPECT_NE(nullptr, subscription_callbacks_);
+}
+
+// Validate that snapshots that cannot be parsed are ignored.
+TEST(SnapshotStoreTest, Corrupt) {
+  SnapshotStore::setDirectory(TestEnvironment::temporaryDirectory());
+  TestEnvironment::writeStringToFileForTest("snapshot_store_corrupt.pb", "not a protobuf");
+  envoy::api::v2::DiscoveryResponse snapshot;
+  EXPECT_FALSE(SnapshotStore::load("snapshot_store_corrupt", snapshot));
+  EXPECT_FALSE(SnapshotStore::load("snapshot_store_missing", snapshot));
+
+  snapshot.set_version_info("1");
+  SnapshotStore::store("snapshot_store_corrupt", snapshot);
+  envoy::api::v2::DiscoveryResponse loaded;
+  EXPECT_TRUE(SnapshotStore::load("snapshot_store_corrupt", loaded));
+  EXPECT_EQ("1", loaded.version_info());
+  SnapshotStore::setDirectory("");
+}
+
+} // namespace
+} // namespace Config
+} // namespace Envoy
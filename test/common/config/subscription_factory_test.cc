@@ -90,7 +90,15 @@ TEST_F(SubscriptionFactoryTest, HttpSubscription) {
   auto* api_config_source = config.mutable_api_config_source();
   api_config_source->set_api_type(envoy::api::v2::ApiConfigSource::REST);
   api_config_source->add_cluster_name("eds_cluster");
-  EXPECT_CALL(dispatcher_, createTimer_(_));
+  // The retry timer is created first, so its expectation is set last.
+  Event::MockTimer* flush_timer = new Event::MockTimer(&dispatcher_);
+  new Event::MockTimer(&dispatcher_);
+  auto subscription = subscriptionFromConfigSource(config);
+
+  // The stream is opened once the subscriptions of this event loop iteration are known. The
+  // subscription is removed from the mux when it is destroyed.
+  EXPECT_CALL(*flush_timer, enableTimer(std::chrono::milliseconds(0))).Times(2);
+  subscription->start({"foo"}, callbacks_);
   EXPECT_CALL(cm_, httpAsyncClientForCluster("eds_cluster"));
   EXPECT_CALL(cm_.async_client_, send_(_, _, _))
       .WillOnce(Invoke([this](Http::MessagePtr& request, Http::AsyncClient::Callbacks& callbacks,
@@ -112,7 +120,15 @@ TEST_F(SubscriptionFactoryTest, GrpcSubscription) {
   auto* api_config_source = config.mutable_api_config_source();
   api_config_source->set_api_type(envoy::api::v2::ApiConfigSource::GRPC);
   api_config_source->add_cluster_name("eds_cluster");
-  EXPECT_CALL(dispatcher_, createTimer_(_));
+  // The retry timer is created first, so its expectation is set last.
+  Event::MockTimer* flush_timer = new Event::MockTimer(&dispatcher_);
+  new Event::MockTimer(&dispatcher_);
+  auto subscription = subscriptionFromConfigSource(config);
+
+  // The stream is opened once the subscriptions of this event loop iteration are known. The
+  // subscription is removed from the mux when it is destroyed.
+  EXPECT_CALL(*flush_timer, enableTimer(std::chrono::milliseconds(0))).Times(2);
+  subscription->start({"foo"}, callbacks_);
   EXPECT_CALL(cm_, httpAsyncClientForCluster("eds_cluster"));
   NiceMock<Http::MockAsyncClientStream> stream;
   EXPECT_CALL(cm_.async_client_, start(_, _)).WillOnce(Return(&stream));
@@ -124,7 +140,28 @@ TEST_F(SubscriptionFactoryTest, GrpcSubscription) {
       {"te", "trailers"}};
   EXPECT_CALL(stream, sendHeaders(HeaderMapEqualRef(&headers), _));
   EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_));
-  subscriptionFromConfigSource(config)->start({"foo"}, callbacks_);
+  flush_timer->callback_();
+}
+
+// Validate that gRPC subscriptions to the same management server share a stream.
+TEST_F(SubscriptionFactoryTest, GrpcSubscriptionsShareStream) {
+  envoy::api::v2::ConfigSource config;
+  auto* api_config_source = config.mutable_api_config_source();
+  api_config_source->set_api_type(envoy::api::v2::ApiConfigSource::GRPC);
+  api_config_source->add_cluster_name("eds_cluster");
+  Event::MockTimer* flush_timer = new Event::MockTimer(&dispatcher_);
+  new Event::MockTimer(&dispatcher_);
+  auto subscription1 = subscriptionFromConfigSource(config);
+  auto subscription2 = subscriptionFromConfigSource(config);
+
+  EXPECT_CALL(*flush_timer, enableTimer(std::chrono::milliseconds(0))).Times(2);
+  subscription1->start({"foo"}, callbacks_);
+  subscription2->start({"bar"}, callbacks_);
+  EXPECT_CALL(cm_, httpAsyncClientForCluster("eds_cluster"));
+  NiceMock<Http::MockAsyncClientStream> stream;
+  EXPECT_CALL(cm_.async_client_, start(_, _)).WillOnce(Return(&stream));
+  EXPECT_CALL(cm_.async_client_.dispatcher_, deferredDelete_(_));
+  flush_timer->callback_();
 }
 
 } // namespace Config
@@ -8,6 +8,7 @@
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/stats/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
 
@@ -29,7 +30,8 @@ public:
         .WillByDefault(Return(enabled));
     EXPECT_CALL(loader_.snapshot_, featureEnabled("dynamodb.filter_enabled", 100));
 
-    filter_.reset(new DynamoFilter(loader_, stat_prefix_, stats_));
+    dynamo_stats_ = std::make_shared<DynamoStats>(stats_, stat_prefix_, tls_);
+    filter_.reset(new DynamoFilter(loader_, stat_prefix_, stats_, dynamo_stats_));
 
     filter_->setDecoderFilterCallbacks(decoder_callbacks_);
     filter_->setEncoderFilterCallbacks(encoder_callbacks_);
@@ -41,6 +43,8 @@ public:
   NiceMock<Runtime::MockLoader> loader_;
   std::string stat_prefix_{"prefix."};
   Stats::MockStore stats_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  DynamoStatsSharedPtr dynamo_stats_;
   NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks_;
   NiceMock<Http::MockStreamEncoderFilterCallbacks> encoder_callbacks_;
 };
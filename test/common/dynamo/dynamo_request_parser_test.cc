@@ -1,9 +1,10 @@
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include "common/dynamo/dynamo_request_parser.h"
 #include "common/http/header_map_impl.h"
-#include "common/json/json_loader.h"
 
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
@@ -12,6 +13,27 @@
 
 namespace Envoy {
 namespace Dynamo {
+namespace {
+
+// Splits a body into slices of at most slice_size bytes.
+std::vector<Buffer::RawSlice> toSlices(const std::string& body, size_t slice_size = 1024) {
+  std::vector<Buffer::RawSlice> slices;
+  for (size_t offset = 0; offset < body.size(); offset += slice_size) {
+    slices.push_back({const_cast<char*>(body.data()) + offset,
+                      std::min<uint64_t>(slice_size, body.size() - offset)});
+  }
+  return slices;
+}
+
+RequestParser::TableDescriptor parseTable(const std::string& operation, const std::string& body) {
+  return RequestParser::parseTable(operation, toSlices(body));
+}
+
+RequestParser::ResponseDescriptor parseResponse(const std::string& body) {
+  return RequestParser::parseResponse(toSlices(body));
+}
+
+} // namespace
 
 TEST(DynamoRequestParser, parseOperation) {
   // Well formed x-amz-target header, in a format, Version.Operation
@@ -53,40 +75,54 @@ TEST(DynamoRequestParser, parseTableNameSingleOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
-
     // Supported operation
     for (const std::string& operation : supported_single_operations) {
-      EXPECT_EQ("Pets", RequestParser::parseTable(operation, *json_data).table_name);
+      EXPECT_EQ("Pets", parseTable(operation, json_string).table_name);
     }
 
     // Not supported operation
-    EXPECT_EQ("", RequestParser::parseTable("NotSupportedOperation", *json_data).table_name);
+    EXPECT_EQ("", parseTable("NotSupportedOperation", json_string).table_name);
+
+    // The body is split across slices, even in the middle of a key or value.
+    for (size_t slice_size = 1; slice_size < 8; slice_size++) {
+      EXPECT_EQ("Pets",
+                RequestParser::parseTable("GetItem", toSlices(json_string, slice_size)).table_name);
+    }
+  }
+
+  {
+    EXPECT_EQ("Pets", parseTable("GetItem", "{\"TableName\":\"Pets\"}").table_name);
+  }
+
+  // Only the top level TableName counts.
+  {
+    EXPECT_EQ("", parseTable("GetItem", "{\"Key\":{\"TableName\":\"Pets\"}}").table_name);
   }
 
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{\"TableName\":\"Pets\"}");
-    EXPECT_EQ("Pets", RequestParser::parseTable("GetItem", *json_data).table_name);
+    EXPECT_THROW(parseTable("GetItem", "{\"TableName\":\"Pets\"}}"), Json::Exception);
+    EXPECT_THROW(parseTable("GetItem", "{\"TableName\":"), Json::Exception);
   }
 }
 
 TEST(DynamoRequestParser, parseErrorType) {
   {
     EXPECT_EQ("ResourceNotFoundException",
-              RequestParser::parseErrorType(*Json::Factory::loadFromString(
-                  "{\"__type\":\"com.amazonaws.dynamodb.v20120810#ResourceNotFoundException\"}")));
+              parseResponse(
+                  "{\"__type\":\"com.amazonaws.dynamodb.v20120810#ResourceNotFoundException\"}")
+                  .error_type);
   }
 
   {
     EXPECT_EQ("ResourceNotFoundException",
-              RequestParser::parseErrorType(*Json::Factory::loadFromString(
+              parseResponse(
                   "{\"__type\":\"com.amazonaws.dynamodb.v20120810#ResourceNotFoundException\","
-                  "\"message\":\"Requested resource not found: Table: tablename not found\"}")));
+                  "\"message\":\"Requested resource not found: Table: tablename not found\"}")
+                  .error_type);
   }
 
   {
-    EXPECT_EQ("", RequestParser::parseErrorType(
-                      *Json::Factory::loadFromString("{\"__type\":\"UnKnownError\"}")));
+    EXPECT_EQ("", parseResponse("{\"__type\":\"UnKnownError\"}").error_type);
   }
 }
 
@@ -100,9 +136,7 @@ TEST(DynamoRequestParser, parseTableNameBatchOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
-
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", *json_data);
+    RequestParser::TableDescriptor table = parseTable("BatchGetItem", json_string);
     EXPECT_EQ("", table.table_name);
     EXPECT_FALSE(table.is_single_table);
   }
@@ -116,9 +150,7 @@ TEST(DynamoRequestParser, parseTableNameBatchOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
-
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", *json_data);
+    RequestParser::TableDescriptor table = parseTable("BatchGetItem", json_string);
     EXPECT_EQ("table_2", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
@@ -133,9 +165,7 @@ TEST(DynamoRequestParser, parseTableNameBatchOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
-
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", *json_data);
+    RequestParser::TableDescriptor table = parseTable("BatchGetItem", json_string);
     EXPECT_EQ("", table.table_name);
     EXPECT_FALSE(table.is_single_table);
   }
@@ -149,51 +179,43 @@ TEST(DynamoRequestParser, parseTableNameBatchOperation) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
-
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchWriteItem", *json_data);
+    RequestParser::TableDescriptor table = parseTable("BatchWriteItem", json_string);
     EXPECT_EQ("table_2", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
 
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{}");
-    RequestParser::TableDescriptor table =
-        RequestParser::parseTable("BatchWriteItem", *Json::Factory::loadFromString("{}"));
+    RequestParser::TableDescriptor table = parseTable("BatchWriteItem", "{}");
     EXPECT_EQ("", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
 
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{\"RequestItems\":{}}");
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchWriteItem", *json_data);
+    RequestParser::TableDescriptor table = parseTable("BatchWriteItem", "{\"RequestItems\":{}}");
     EXPECT_EQ("", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
 
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{}");
-    RequestParser::TableDescriptor table = RequestParser::parseTable("BatchGetItem", *json_data);
+    RequestParser::TableDescriptor table = parseTable("BatchGetItem", "{}");
     EXPECT_EQ("", table.table_name);
     EXPECT_TRUE(table.is_single_table);
   }
 }
 TEST(DynamoRequestParser, parseBatchUnProcessedKeys) {
   {
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString("{}");
-    std::vector<std::string> unprocessed_tables =
-        RequestParser::parseBatchUnProcessedKeys(*json_data);
+    std::vector<std::string> unprocessed_tables = parseResponse("{}").unprocessed_tables;
     EXPECT_EQ(0u, unprocessed_tables.size());
   }
   {
-    std::vector<std::string> unprocessed_tables = RequestParser::parseBatchUnProcessedKeys(
-        *Json::Factory::loadFromString("{\"UnprocessedKeys\":{}}"));
+    std::vector<std::string> unprocessed_tables =
+        parseResponse("{\"UnprocessedKeys\":{}}").unprocessed_tables;
     EXPECT_EQ(0u, unprocessed_tables.size());
   }
 
   {
-    std::vector<std::string> unprocessed_tables = RequestParser::parseBatchUnProcessedKeys(
-        *Json::Factory::loadFromString("{\"UnprocessedKeys\":{\"table_1\" :{}}}"));
+    std::vector<std::string> unprocessed_tables =
+        parseResponse("{\"UnprocessedKeys\":{\"table_1\" :{}}}").unprocessed_tables;
     EXPECT_EQ("table_1", unprocessed_tables[0]);
     EXPECT_EQ(1u, unprocessed_tables.size());
   }
@@ -207,10 +229,7 @@ TEST(DynamoRequestParser, parseBatchUnProcessedKeys) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
-
-    std::vector<std::string> unprocessed_tables =
-        RequestParser::parseBatchUnProcessedKeys(*json_data);
+    std::vector<std::string> unprocessed_tables = parseResponse(json_string).unprocessed_tables;
     EXPECT_TRUE(find(unprocessed_tables.begin(), unprocessed_tables.end(), "table_1") !=
                 unprocessed_tables.end());
     EXPECT_TRUE(find(unprocessed_tables.begin(), unprocessed_tables.end(), "table_2") !=
@@ -221,18 +240,17 @@ TEST(DynamoRequestParser, parseBatchUnProcessedKeys) {
 
 TEST(DynamoRequestParser, parsePartitionIds) {
   {
-    std::vector<RequestParser::PartitionDescriptor> partitions =
-        RequestParser::parsePartitions(*Json::Factory::loadFromString("{}"));
+    std::vector<RequestParser::PartitionDescriptor> partitions = parseResponse("{}").partitions;
     EXPECT_EQ(0u, partitions.size());
   }
   {
     std::vector<RequestParser::PartitionDescriptor> partitions =
-        RequestParser::parsePartitions(*Json::Factory::loadFromString("{\"ConsumedCapacity\":{}}"));
+        parseResponse("{\"ConsumedCapacity\":{}}").partitions;
     EXPECT_EQ(0u, partitions.size());
   }
   {
-    std::vector<RequestParser::PartitionDescriptor> partitions = RequestParser::parsePartitions(
-        *Json::Factory::loadFromString("{\"ConsumedCapacity\":{ \"Partitions\":{}}}"));
+    std::vector<RequestParser::PartitionDescriptor> partitions =
+        parseResponse("{\"ConsumedCapacity\":{ \"Partitions\":{}}}").partitions;
     EXPECT_EQ(0u, partitions.size());
   }
   {
@@ -246,10 +264,8 @@ TEST(DynamoRequestParser, parsePartitionIds) {
       }
     }
     )EOF";
-    Json::ObjectSharedPtr json_data = Json::Factory::loadFromString(json_string);
-
     std::vector<RequestParser::PartitionDescriptor> partitions =
-        RequestParser::parsePartitions(*json_data);
+        parseResponse(json_string).partitions;
     for (const RequestParser::PartitionDescriptor& partition : partitions) {
       if (partition.partition_id_ == "partition_1") {
         EXPECT_EQ(1u, partition.capacity_);
@@ -259,6 +275,32 @@ TEST(DynamoRequestParser, parsePartitionIds) {
     }
     EXPECT_EQ(2u, partitions.size());
   }
+  {
+    // Capacity may be an integer, and partitions are only read from the top level object.
+    std::string json_string = R"EOF(
+    {
+      "Item": {"ConsumedCapacity": {"Partitions": {"partition_2": 1.0}}},
+      "ConsumedCapacity": {
+        "Partitions": {
+          "partition_1" : 2
+        }
+      }
+    }
+    )EOF";
+
+    std::vector<RequestParser::PartitionDescriptor> partitions =
+        parseResponse(json_string).partitions;
+    ASSERT_EQ(1u, partitions.size());
+    EXPECT_EQ("partition_1", partitions[0].partition_id_);
+    EXPECT_EQ(2u, partitions[0].capacity_);
+  }
+  {
+    // Batch operations return the consumed capacity of each table in an array.
+    std::vector<RequestParser::PartitionDescriptor> partitions =
+        parseResponse("{\"ConsumedCapacity\":[{\"Partitions\":{\"partition_1\":1.0}}]}")
+            .partitions;
+    EXPECT_EQ(0u, partitions.size());
+  }
 }
 
 } // namespace Dynamo
@@ -1,14 +1,29 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "common/common/thread.h"
 #include "common/event/dispatcher_impl.h"
 
 #include "test/mocks/common.h"
+#include "test/mocks/stats/mocks.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace Envoy {
+using testing::Ge;
+using testing::HasSubstr;
 using testing::InSequence;
+using testing::NiceMock;
+using testing::_;
 
 namespace Event {
 
@@ -51,5 +66,155 @@ TEST(DispatcherImplTest, DeferredDelete) {
   dispatcher.clearDeferredDeleteList();
 }
 
+TEST(DispatcherImplTest, PostOrder) {
+  DispatcherImpl dispatcher;
+  std::vector<int> order;
+  for (int i = 0; i < 3; i++) {
+    dispatcher.post([&order, i]() -> void { order.push_back(i); });
+  }
+
+  // A callback posted from a callback runs after the ones already posted.
+  dispatcher.post([&]() -> void { dispatcher.post([&]() -> void { order.push_back(4); }); });
+  dispatcher.post([&]() -> void { order.push_back(3); });
+
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), order);
+}
+
+TEST(DispatcherImplTest, PostFromThreads) {
+  DispatcherImpl dispatcher;
+  const int num_threads = 4;
+  const int posts_per_thread = 1000;
+  int runs = 0;
+  std::vector<int> last_seen(num_threads, -1);
+
+  std::vector<Thread::ThreadPtr> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back(new Thread::Thread([&, t]() -> void {
+      for (int i = 0; i < posts_per_thread; i++) {
+        dispatcher.post([&, t, i]() -> void {
+          // Posts from one thread run in order.
+          EXPECT_EQ(last_seen[t] + 1, i);
+          last_seen[t] = i;
+          runs++;
+        });
+      }
+    }));
+  }
+
+  for (Thread::ThreadPtr& thread : threads) {
+    thread->join();
+  }
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+  EXPECT_EQ(num_threads * posts_per_thread, runs);
+}
+
+TEST(DispatcherImplTest, ApproximateTime) {
+  DispatcherImpl dispatcher;
+  MonotonicTimeSource& time_source = dispatcher.approximateMonotonicTime();
+
+  // Outside of the event loop the time is precise.
+  const MonotonicTime before = time_source.currentTime();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  EXPECT_LT(before, time_source.currentTime());
+
+  // Within a loop iteration the time stays the same.
+  TimerPtr timer = dispatcher.createTimer([&]() -> void {
+    const MonotonicTime start = time_source.currentTime();
+    const SystemTime system_start = dispatcher.approximateSystemTime().currentTime();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_LT(before, start);
+    EXPECT_EQ(start, time_source.currentTime());
+    EXPECT_EQ(system_start, dispatcher.approximateSystemTime().currentTime());
+    dispatcher.exit();
+  });
+  timer->enableTimer(std::chrono::milliseconds(0));
+  dispatcher.run(Dispatcher::RunType::Block);
+}
+
+TEST(DispatcherImplTest, Stats) {
+  DispatcherImpl dispatcher;
+  NiceMock<Stats::MockStore> store;
+  dispatcher.initializeStats(store, "test.");
+
+  for (int i = 0; i < 3; i++) {
+    dispatcher.post([]() -> void {});
+  }
+  dispatcher.post([]() -> void { std::this_thread::sleep_for(std::chrono::milliseconds(15)); });
+
+  const size_t logged = SlowCallbackLog::instance().entries().size();
+  EXPECT_CALL(store, deliverHistogramToSinks("test.post_batch_size", 4));
+  EXPECT_CALL(store, deliverHistogramToSinks("test.post_wait_us", _));
+  EXPECT_CALL(store, deliverHistogramToSinks("test.slow_callback_us", Ge(15000U)));
+  EXPECT_CALL(store.counter_, inc());
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+
+  // Only the posted callback is logged, not the timer that ran it.
+  std::list<SlowCallbackLog::Entry> entries = SlowCallbackLog::instance().entries();
+  ASSERT_EQ(std::min(logged + 1, SlowCallbackLog::MAX_ENTRIES), entries.size());
+  EXPECT_EQ("test.", entries.back().dispatcher_);
+  EXPECT_EQ("post", entries.back().kind_);
+  EXPECT_THAT(entries.back().origin_, HasSubstr("DispatcherImplTest_Stats"));
+}
+
+TEST(DispatcherImplTest, LoopDelay) {
+  DispatcherImpl dispatcher;
+  EXPECT_EQ(std::chrono::milliseconds(0), dispatcher.loopDelay());
+  NiceMock<Stats::MockStore> store;
+  dispatcher.initializeStats(store, "test.");
+
+  // A loop that is stuck shows as behind before the probe gets to run.
+  dispatcher.post([&]() -> void {
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_LE(std::chrono::milliseconds(50), dispatcher.loopDelay());
+  });
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+
+  // The late probe has run, and its delay is kept.
+  EXPECT_LE(std::chrono::milliseconds(50), dispatcher.loopDelay());
+}
+
+class DispatcherImplFdReuseTest : public testing::TestWithParam<bool> {};
+
+INSTANTIATE_TEST_CASE_P(EpollChangelist, DispatcherImplFdReuseTest, testing::Bool());
+
+// Validate that an fd that is closed and reused within one loop iteration is watched as the new
+// socket, with and without the epoll changelist.
+TEST_P(DispatcherImplFdReuseTest, CloseAndReuseFd) {
+  DispatcherImpl::epollChangelist(GetParam());
+  DispatcherImpl dispatcher;
+  DispatcherImpl::epollChangelist(false);
+
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  FileEventPtr event = dispatcher.createFileEvent(fds[0], [](uint32_t) -> void {},
+                                                  FileTriggerType::Edge, FileReadyType::Read);
+  dispatcher.run(Dispatcher::RunType::NonBlock);
+
+  int new_fds[2];
+  FileEventPtr new_event;
+  bool read_ready = false;
+  dispatcher.post([&]() -> void {
+    event.reset();
+    close(fds[0]);
+    close(fds[1]);
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, new_fds));
+    EXPECT_EQ(fds[0], new_fds[0]);
+    new_event = dispatcher.createFileEvent(new_fds[0],
+                                           [&](uint32_t events) -> void {
+                                             read_ready = events & FileReadyType::Read;
+                                             dispatcher.exit();
+                                           },
+                                           FileTriggerType::Edge, FileReadyType::Read);
+    EXPECT_EQ(1, write(new_fds[1], "a", 1));
+  });
+  dispatcher.run(Dispatcher::RunType::Block);
+  EXPECT_TRUE(read_ready);
+
+  new_event.reset();
+  close(new_fds[0]);
+  close(new_fds[1]);
+}
+
 } // namespace Event
 } // namespace Envoy
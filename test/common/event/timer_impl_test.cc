@@ -0,0 +1,104 @@
+#include <chrono>
+
+#include "common/event/dispatcher_impl.h"
+#include "common/event/timer_impl.h"
+
+#include "test/mocks/common.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Event {
+
+class TimerWheelTest : public testing::Test {
+public:
+  TimerWheelTest() {
+    // Every read of the clock, once when arming a timer and once per tick, advances it by step_.
+    ON_CALL(time_source_, currentTime()).WillByDefault(Invoke([this]() -> MonotonicTime {
+      reads_++;
+      last_read_ = now_;
+      now_ += step_;
+      return last_read_;
+    }));
+  }
+
+  MonotonicTime now_;
+  MonotonicTime last_read_;
+  int reads_{};
+  std::chrono::milliseconds step_{TimerWheel::TICK_MS};
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  DispatcherImpl dispatcher_;
+};
+
+// A timer fires in the first tick that starts after its deadline.
+TEST_F(TimerWheelTest, Fire) {
+  TimerWheel wheel(dispatcher_, time_source_);
+  int fired_at_read = 0;
+  TimerPtr timer = wheel.createTimer([&]() -> void { fired_at_read = reads_; });
+
+  // Armed at 0ms with a deadline at 25ms, so the timer expires in the tick starting at 30ms, which
+  // is the third tick after arming.
+  timer->enableTimer(std::chrono::milliseconds(25));
+  dispatcher_.run(Dispatcher::RunType::Block);
+  EXPECT_EQ(4, fired_at_read);
+}
+
+TEST_F(TimerWheelTest, DisableAndDestroyFromCallback) {
+  TimerWheel wheel(dispatcher_, time_source_);
+  ReadyWatcher watcher;
+  TimerPtr disabled = wheel.createTimer([&]() -> void { watcher.ready(); });
+  TimerPtr destroyed = wheel.createTimer([&]() -> void { watcher.ready(); });
+  TimerPtr rearmed;
+  int rearmed_runs = 0;
+  rearmed = wheel.createTimer([&]() -> void {
+    if (++rearmed_runs < 3) {
+      rearmed->enableTimer(std::chrono::milliseconds(5));
+    }
+  });
+  TimerPtr first = wheel.createTimer([&]() -> void {
+    // The other timers in the same slot are still waiting to run.
+    disabled->disableTimer();
+    destroyed.reset();
+  });
+
+  // Stop the clock so that all timers land in the same slot, in this order.
+  step_ = std::chrono::milliseconds(0);
+  first->enableTimer(std::chrono::milliseconds(5));
+  disabled->enableTimer(std::chrono::milliseconds(5));
+  destroyed->enableTimer(std::chrono::milliseconds(5));
+  rearmed->enableTimer(std::chrono::milliseconds(5));
+  step_ = std::chrono::milliseconds(TimerWheel::TICK_MS);
+
+  EXPECT_CALL(watcher, ready()).Times(0);
+  dispatcher_.run(Dispatcher::RunType::Block);
+  EXPECT_EQ(3, rearmed_runs);
+}
+
+// A timer further out than one revolution survives the visits to its slot before it expires, and
+// a clock that jumps ahead by more than a revolution still expires it.
+TEST_F(TimerWheelTest, LongTimeout) {
+  TimerWheel wheel(dispatcher_, time_source_);
+  const std::chrono::milliseconds revolution(TimerWheel::TICK_MS * TimerWheel::NUM_SLOTS);
+  MonotonicTime fired_at;
+  TimerPtr timer = wheel.createTimer([&]() -> void { fired_at = last_read_; });
+
+  step_ = revolution / 4;
+  timer->enableTimer(2 * revolution);
+  MonotonicTime armed_at = last_read_;
+  dispatcher_.run(Dispatcher::RunType::Block);
+  EXPECT_GE(fired_at - armed_at, 2 * revolution);
+  EXPECT_LE(fired_at - armed_at, 2 * revolution + step_);
+
+  step_ = 3 * revolution;
+  timer->enableTimer(revolution);
+  armed_at = last_read_;
+  dispatcher_.run(Dispatcher::RunType::Block);
+  EXPECT_EQ(armed_at + step_, fired_at);
+}
+
+} // namespace Event
+} // namespace Envoy
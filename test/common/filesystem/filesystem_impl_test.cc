@@ -28,7 +28,8 @@ TEST(FileSystemImpl, BadFile) {
   Thread::MutexBasicLockable lock;
   Stats::IsolatedStoreImpl store;
   Filesystem::OsSysCallsImpl os_sys_calls;
-  EXPECT_THROW(Filesystem::FileImpl("", dispatcher, lock, os_sys_calls, store,
+  Filesystem::FileFlusher flusher;
+  EXPECT_THROW(Filesystem::FileImpl("", dispatcher, lock, flusher, os_sys_calls, store,
                                     std::chrono::milliseconds(10000)),
                EnvoyException);
 }
@@ -64,9 +65,10 @@ TEST(FileSystemImpl, flushToLogFilePeriodically) {
   Thread::MutexBasicLockable mutex;
   Stats::IsolatedStoreImpl stats_store;
   NiceMock<Filesystem::MockOsSysCalls> os_sys_calls;
+  Filesystem::FileFlusher flusher;
 
   EXPECT_CALL(os_sys_calls, open_(_, _, _)).WillOnce(Return(5));
-  Filesystem::FileImpl file("", dispatcher, mutex, os_sys_calls, stats_store,
+  Filesystem::FileImpl file("", dispatcher, mutex, flusher, os_sys_calls, stats_store,
                             std::chrono::milliseconds(40));
 
   EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(40)));
@@ -117,10 +119,11 @@ TEST(FileSystemImpl, reopenFile) {
   Thread::MutexBasicLockable mutex;
   Stats::IsolatedStoreImpl stats_store;
   NiceMock<Filesystem::MockOsSysCalls> os_sys_calls;
+  Filesystem::FileFlusher flusher;
 
   Sequence sq;
   EXPECT_CALL(os_sys_calls, open_(_, _, _)).InSequence(sq).WillOnce(Return(5));
-  Filesystem::FileImpl file("", dispatcher, mutex, os_sys_calls, stats_store,
+  Filesystem::FileImpl file("", dispatcher, mutex, flusher, os_sys_calls, stats_store,
                             std::chrono::milliseconds(40));
 
   EXPECT_CALL(os_sys_calls, write_(_, _, _))
@@ -177,6 +180,7 @@ TEST(FilesystemImpl, reopenThrows) {
   Thread::MutexBasicLockable mutex;
   Stats::IsolatedStoreImpl stats_store;
   NiceMock<Filesystem::MockOsSysCalls> os_sys_calls;
+  Filesystem::FileFlusher flusher;
 
   EXPECT_CALL(os_sys_calls, write_(_, _, _))
       .WillRepeatedly(Invoke([](int fd, const void* buffer, size_t num_bytes) -> ssize_t {
@@ -189,7 +193,7 @@ TEST(FilesystemImpl, reopenThrows) {
   Sequence sq;
   EXPECT_CALL(os_sys_calls, open_(_, _, _)).InSequence(sq).WillOnce(Return(5));
 
-  Filesystem::FileImpl file("", dispatcher, mutex, os_sys_calls, stats_store,
+  Filesystem::FileImpl file("", dispatcher, mutex, flusher, os_sys_calls, stats_store,
                             std::chrono::milliseconds(40));
   EXPECT_CALL(os_sys_calls, close(5)).InSequence(sq);
   EXPECT_CALL(os_sys_calls, open_(_, _, _)).InSequence(sq).WillOnce(Return(-1));
@@ -224,8 +228,9 @@ TEST(FilesystemImpl, bigDataChunkShouldBeFlushedWithoutTimer) {
   Thread::MutexBasicLockable mutex;
   Stats::IsolatedStoreImpl stats_store;
   NiceMock<Filesystem::MockOsSysCalls> os_sys_calls;
+  Filesystem::FileFlusher flusher;
 
-  Filesystem::FileImpl file("", dispatcher, mutex, os_sys_calls, stats_store,
+  Filesystem::FileImpl file("", dispatcher, mutex, flusher, os_sys_calls, stats_store,
                             std::chrono::milliseconds(40));
 
   EXPECT_CALL(os_sys_calls, write_(_, _, _))
@@ -271,4 +276,45 @@ TEST(FilesystemImpl, bigDataChunkShouldBeFlushedWithoutTimer) {
     }
   }
 }
+
+TEST(FilesystemImpl, filesShareFlusher) {
+  NiceMock<Event::MockDispatcher> dispatcher;
+  Thread::MutexBasicLockable mutex;
+  Stats::IsolatedStoreImpl stats_store;
+  NiceMock<Filesystem::MockOsSysCalls> os_sys_calls;
+  Filesystem::FileFlusher flusher;
+
+  EXPECT_CALL(os_sys_calls, open_(_, _, _)).WillOnce(Return(5)).WillOnce(Return(6));
+  {
+    Filesystem::FileImpl file1("", dispatcher, mutex, flusher, os_sys_calls, stats_store,
+                               std::chrono::milliseconds(40));
+    Filesystem::FileImpl file2("", dispatcher, mutex, flusher, os_sys_calls, stats_store,
+                               std::chrono::milliseconds(40));
+
+    EXPECT_CALL(os_sys_calls, write_(5, _, _))
+        .WillOnce(Invoke([](int, const void* buffer, size_t num_bytes) -> ssize_t {
+          EXPECT_EQ("one", std::string(reinterpret_cast<const char*>(buffer), num_bytes));
+          return num_bytes;
+        }));
+    EXPECT_CALL(os_sys_calls, write_(6, _, _))
+        .WillOnce(Invoke([](int, const void* buffer, size_t num_bytes) -> ssize_t {
+          EXPECT_EQ("two", std::string(reinterpret_cast<const char*>(buffer), num_bytes));
+          return -1;
+        }));
+
+    file1.write("one");
+    file2.write("two");
+
+    {
+      std::unique_lock<Thread::BasicLockable> lock(os_sys_calls.write_mutex_);
+      while (os_sys_calls.num_writes_ != 2) {
+        os_sys_calls.write_event_.wait(os_sys_calls.write_mutex_);
+      }
+    }
+  }
+
+  // The failed write is dropped. Destroying the files waited for their flushes to complete.
+  EXPECT_EQ(1UL, stats_store.counter("filesystem.write_completed").value());
+  EXPECT_EQ(1UL, stats_store.counter("filesystem.write_failed").value());
+}
 } // namespace Envoy
@@ -38,6 +38,22 @@ TEST(ClientSslAuthAllowedPrincipalsTest, EmptyString) {
   EXPECT_EQ(0UL, principals.size());
 }
 
+TEST(ClientSslAuthAllowedPrincipalsTest, Digests) {
+  AllowedPrincipals principals;
+  principals.add("1b7d42ef0025ad89c1c911d6c10d7e86a4cb7c5863b2980abcbad1895f8b5314");
+  principals.add("1b7d42ef0025ad89c1c911d6c10d7e86a4cb7c5863b2980abcbad1895f8b531");
+  principals.add("zz7d42ef0025ad89c1c911d6c10d7e86a4cb7c5863b2980abcbad1895f8b5314");
+  EXPECT_EQ(1UL, principals.size());
+
+  EXPECT_TRUE(
+      principals.allowed("1b7d42ef0025ad89c1c911d6c10d7e86a4cb7c5863b2980abcbad1895f8b5314"));
+  EXPECT_TRUE(
+      principals.allowed("1B7D42EF0025AD89C1C911D6C10D7E86A4CB7C5863B2980ABCBAD1895F8B5314"));
+  EXPECT_FALSE(
+      principals.allowed("2b7d42ef0025ad89c1c911d6c10d7e86a4cb7c5863b2980abcbad1895f8b5314"));
+  EXPECT_FALSE(principals.allowed(""));
+}
+
 class ClientSslAuthFilterTest : public testing::Test {
 public:
   ClientSslAuthFilterTest()
@@ -151,7 +167,8 @@ TEST_F(ClientSslAuthFilterTest, Ssl) {
   ON_CALL(filter_callbacks_.connection_, ssl()).WillByDefault(Return(&ssl_));
   Network::Address::Ipv4Instance remote_address("192.168.1.1");
   EXPECT_CALL(filter_callbacks_.connection_, remoteAddress()).WillOnce(ReturnRef(remote_address));
-  EXPECT_CALL(ssl_, sha256PeerCertificateDigest()).WillOnce(Return("digest"));
+  const std::string digest = "digest";
+  EXPECT_CALL(ssl_, sha256PeerCertificateDigest()).WillOnce(ReturnRef(digest));
   EXPECT_CALL(filter_callbacks_.connection_, close(Network::ConnectionCloseType::NoFlush));
   EXPECT_EQ(Network::FilterStatus::StopIteration, instance_->onNewConnection());
   filter_callbacks_.connection_.raiseEvent(Network::ConnectionEvent::Connected);
@@ -169,8 +186,9 @@ TEST_F(ClientSslAuthFilterTest, Ssl) {
   // Create a new filter for an SSL connection with an authorized cert.
   createAuthFilter();
   EXPECT_CALL(filter_callbacks_.connection_, remoteAddress()).WillOnce(ReturnRef(remote_address));
-  EXPECT_CALL(ssl_, sha256PeerCertificateDigest())
-      .WillOnce(Return("1b7d42ef0025ad89c1c911d6c10d7e86a4cb7c5863b2980abcbad1895f8b5314"));
+  const std::string allowed_digest =
+      "1b7d42ef0025ad89c1c911d6c10d7e86a4cb7c5863b2980abcbad1895f8b5314";
+  EXPECT_CALL(ssl_, sha256PeerCertificateDigest()).WillOnce(ReturnRef(allowed_digest));
   EXPECT_EQ(Network::FilterStatus::StopIteration, instance_->onNewConnection());
   EXPECT_CALL(filter_callbacks_, continueReading());
   filter_callbacks_.connection_.raiseEvent(Network::ConnectionEvent::Connected);
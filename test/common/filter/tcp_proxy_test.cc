@@ -325,6 +325,62 @@ TEST(TcpProxyConfigTest, Routes) {
   }
 }
 
+TEST(TcpProxyConfigTest, RouteOrder) {
+  std::string json = R"EOF(
+    {
+      "stat_prefix": "name",
+      "route_config": {
+        "routes": [
+          {
+            "destination_ip_list": ["10.0.0.0/8"],
+            "destination_ports": "80",
+            "cluster": "wide_80"
+          },
+          {
+            "destination_ip_list": ["10.1.0.0/16"],
+            "cluster": "narrow"
+          },
+          {
+            "destination_ip_list": ["10.0.0.0/8"],
+            "source_ip_list": ["1.0.0.0/8"],
+            "cluster": "wide_source"
+          },
+          {
+            "destination_ports": "443",
+            "cluster": "any_443"
+          },
+          {
+            "cluster": "catch_all"
+          }
+        ]
+      }
+    }
+    )EOF";
+
+  Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json);
+  NiceMock<Upstream::MockClusterManager> cm_;
+
+  TcpProxyConfig config_obj(*json_config, cm_,
+                            cm_.thread_local_cluster_.cluster_.info_->stats_store_);
+
+  auto route = [&](const std::string& local, uint32_t port, const std::string& remote) {
+    NiceMock<Network::MockConnection> connection;
+    Network::Address::Ipv4Instance local_address(local, port);
+    EXPECT_CALL(connection, localAddress()).WillRepeatedly(ReturnRef(local_address));
+    Network::Address::Ipv4Instance remote_address(remote);
+    EXPECT_CALL(connection, remoteAddress()).WillRepeatedly(ReturnRef(remote_address));
+    return config_obj.getRouteFromEntries(connection);
+  };
+
+  // The first route that matches wins, even when a later one has a longer destination prefix.
+  EXPECT_EQ("wide_80", route("10.1.2.3", 80, "2.0.0.1"));
+  EXPECT_EQ("narrow", route("10.1.2.3", 81, "1.0.0.1"));
+  EXPECT_EQ("wide_source", route("10.2.0.1", 81, "1.0.0.1"));
+  EXPECT_EQ("catch_all", route("10.2.0.1", 81, "2.0.0.1"));
+  EXPECT_EQ("any_443", route("10.2.0.1", 443, "2.0.0.1"));
+  EXPECT_EQ("catch_all", route("12.0.0.1", 80, "2.0.0.1"));
+}
+
 TEST(TcpProxyConfigTest, EmptyRouteConfig) {
   std::string json = R"EOF(
     {
@@ -518,6 +574,77 @@ TEST_F(TcpProxyTest, UpstreamConnectionLimit) {
                     .value());
 }
 
+TEST_F(TcpProxyTest, Splice) {
+  std::string json = R"EOF(
+    {
+      "stat_prefix": "name",
+      "route_config": {
+        "routes": [
+          {
+            "cluster": "fake_cluster"
+          }
+        ]
+      },
+      "splice": true
+    }
+    )EOF";
+
+  Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+  config_.reset(
+      new TcpProxyConfig(*config, cluster_manager_,
+                         cluster_manager_.thread_local_cluster_.cluster_.info_->stats_store_));
+  EXPECT_TRUE(config_->splice());
+  setup(true);
+
+  // Nothing splices before the upstream connection is established.
+  Buffer::OwnedImpl buffer("hello");
+  EXPECT_CALL(*upstream_connection_, write(BufferEqual(&buffer)));
+  filter_->onData(buffer);
+
+  // Only the upstream direction can splice, the downstream one keeps using the filter.
+  EXPECT_CALL(filter_callbacks_.connection_, spliceTo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*upstream_connection_, spliceTo(_)).WillOnce(Return(false));
+  upstream_connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  EXPECT_EQ(1U, config_->stats().downstream_cx_spliced_total_.value());
+
+  Buffer::OwnedImpl response("world");
+  EXPECT_CALL(filter_callbacks_.connection_, write(BufferEqual(&response)));
+  upstream_read_filter_->onData(response);
+}
+
+// A prewarmed upstream connection is used as is, without connecting it again.
+TEST_F(TcpProxyTest, PrewarmedConnection) {
+  NiceMock<Network::MockClientConnection>* upstream_connection =
+      new NiceMock<Network::MockClientConnection>();
+  Upstream::MockHost::MockCreateConnectionData conn_info;
+  conn_info.connection_ = upstream_connection;
+  conn_info.host_description_.reset(
+      new Upstream::HostImpl(cluster_manager_.thread_local_cluster_.cluster_.info_, "",
+                             Network::Utility::resolveUrl("tcp://127.0.0.1:80"), false, 1, ""));
+  EXPECT_CALL(cluster_manager_, prewarmedTcpConnForCluster_("fake_cluster", _))
+      .WillOnce(Return(conn_info));
+  EXPECT_CALL(cluster_manager_, tcpConnForCluster_(_, _)).Times(0);
+  EXPECT_CALL(*upstream_connection, connect()).Times(0);
+  EXPECT_CALL(filter_callbacks_.connection_.dispatcher_, createTimer_(_)).Times(0);
+  EXPECT_CALL(*upstream_connection, addReadFilter(_))
+      .WillOnce(SaveArg<0>(&upstream_read_filter_));
+
+  filter_.reset(new TcpProxy(config_, cluster_manager_));
+  filter_->initializeReadFilterCallbacks(filter_callbacks_);
+  EXPECT_EQ(Network::FilterStatus::Continue, filter_->onNewConnection());
+
+  Buffer::OwnedImpl buffer("hello");
+  EXPECT_CALL(*upstream_connection, write(BufferEqual(&buffer)));
+  filter_->onData(buffer);
+
+  Buffer::OwnedImpl response("world");
+  EXPECT_CALL(filter_callbacks_.connection_, write(BufferEqual(&response)));
+  upstream_read_filter_->onData(response);
+
+  EXPECT_CALL(filter_callbacks_.connection_, close(Network::ConnectionCloseType::FlushWrite));
+  upstream_connection->raiseEvent(Network::ConnectionEvent::RemoteClose);
+}
+
 class TcpProxyRoutingTest : public testing::Test {
 public:
   TcpProxyRoutingTest() {
@@ -603,6 +603,25 @@ TEST_F(GrpcAsyncClientImplTest, CancelRequest) {
   request->grpc_request_->cancel();
 }
 
+// Validate that responses own the arena they are allocated on, and that heap allocated messages
+// still convert and get deleted.
+TEST(GrpcResponsePtrTest, ArenaAndHeapMessages) {
+  std::unique_ptr<Protobuf::Arena> arena(new Protobuf::Arena());
+  helloworld::HelloReply* message = Protobuf::Arena::CreateMessage<helloworld::HelloReply>(
+      arena.get());
+  message->set_message(HELLO_REPLY);
+  ResponsePtr<helloworld::HelloReply> response(
+      message, ResponseDeleter<helloworld::HelloReply>(std::move(arena)));
+  ResponsePtr<helloworld::HelloReply> moved = std::move(response);
+  EXPECT_EQ(HELLO_REPLY, moved->message());
+  EXPECT_EQ(nullptr, response);
+
+  ResponsePtr<helloworld::HelloReply> heap =
+      std::unique_ptr<helloworld::HelloReply>(new helloworld::HelloReply());
+  heap->set_message(HELLO_REPLY);
+  EXPECT_EQ(nullptr, heap->GetArena());
+}
+
 } // namespace
 } // namespace Grpc
 } // namespace Envoy
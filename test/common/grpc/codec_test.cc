@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <string>
@@ -164,5 +165,91 @@ TEST(GrpcCodecTest, decodeMultipleFrame) {
   }
 }
 
+class TestFrameCallbacks : public FrameCallbacks {
+public:
+  // Grpc::FrameCallbacks
+  void onFrame(Frame& frame) override {
+    flags_.push_back(frame.flags_);
+    payloads_.push_back(std::string(
+        static_cast<const char*>(frame.data_->linearize(frame.data_->length())),
+        frame.data_->length()));
+    EXPECT_EQ(frame.length_, frame.data_->length());
+    // Taking the payload must not disturb later frames.
+    Buffer::InstancePtr payload = std::move(frame.data_);
+  }
+
+  std::vector<uint8_t> flags_;
+  std::vector<std::string> payloads_;
+};
+
+TEST(GrpcCodecTest, decodeWithCallbacks) {
+  Buffer::OwnedImpl wire;
+  std::array<uint8_t, 5> header;
+  Encoder encoder;
+  for (const std::string payload : {"hello", "", "world!"}) {
+    encoder.newFrame(payload.empty() ? GRPC_FH_COMPRESSED : GRPC_FH_DEFAULT, payload.size(),
+                     header);
+    wire.add(header.data(), 5);
+    wire.add(payload);
+  }
+  const std::string data(static_cast<const char*>(wire.linearize(wire.length())), wire.length());
+
+  // Feed the frames in pieces of every size, so headers and payloads get split.
+  for (size_t piece = 1; piece <= data.size(); piece++) {
+    TestFrameCallbacks callbacks;
+    Decoder decoder;
+    for (size_t offset = 0; offset < data.size(); offset += piece) {
+      Buffer::OwnedImpl buffer(data.substr(offset, piece));
+      EXPECT_TRUE(decoder.decode(buffer, callbacks));
+      EXPECT_EQ(0, buffer.length());
+    }
+    EXPECT_EQ((std::vector<uint8_t>{GRPC_FH_DEFAULT, GRPC_FH_COMPRESSED, GRPC_FH_DEFAULT}),
+              callbacks.flags_);
+    EXPECT_EQ((std::vector<std::string>{"hello", "", "world!"}), callbacks.payloads_);
+  }
+}
+
+TEST(GrpcCodecTest, decodeInvalidFrameWithCallbacks) {
+  Buffer::OwnedImpl buffer;
+  std::array<uint8_t, 5> header;
+  Encoder encoder;
+  encoder.newFrame(GRPC_FH_DEFAULT, 1, header);
+  buffer.add(header.data(), 5);
+  buffer.add("a");
+  encoder.newFrame(0b10u, 1, header);
+  buffer.add(header.data(), 5);
+  buffer.add("b");
+
+  TestFrameCallbacks callbacks;
+  Decoder decoder;
+  EXPECT_FALSE(decoder.decode(buffer, callbacks));
+  EXPECT_EQ(std::vector<std::string>{"a"}, callbacks.payloads_);
+}
+
+TEST(GrpcCodecTest, inspectFrames) {
+  Buffer::OwnedImpl wire;
+  std::array<uint8_t, 5> header;
+  Encoder encoder;
+  for (const std::string payload : {"hello", "", "world!"}) {
+    encoder.newFrame(GRPC_FH_DEFAULT, payload.size(), header);
+    wire.add(header.data(), 5);
+    wire.add(payload);
+  }
+  const std::string data(static_cast<const char*>(wire.linearize(wire.length())), wire.length());
+
+  // A frame is counted where its header starts, however the stream is split.
+  for (size_t piece = 1; piece <= data.size(); piece++) {
+    FrameInspector inspector;
+    uint64_t count = 0;
+    for (size_t offset = 0; offset < data.size(); offset += piece) {
+      Buffer::OwnedImpl buffer(data.substr(offset, piece));
+      count += inspector.inspect(buffer);
+      EXPECT_EQ(std::min(piece, data.size() - offset), buffer.length());
+    }
+    EXPECT_EQ(3, count);
+    EXPECT_EQ(3, inspector.frameCount());
+  }
+}
+
 } // namespace Grpc
 } // namespace Envoy
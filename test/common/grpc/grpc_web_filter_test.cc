@@ -147,6 +147,27 @@ TEST_F(GrpcWebFilterTest, InvalidBase64) {
             filter_.decodeData(request_buffer, true));
 }
 
+TEST_F(GrpcWebFilterTest, Base64ChunksWithPadding) {
+  Http::TestHeaderMapImpl request_headers;
+  request_headers.addCopy(Http::Headers::get().ContentType,
+                          Http::Headers::get().ContentTypeValues.GrpcWebText);
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_.decodeHeaders(request_headers, false));
+
+  // A client may encode each message on its own, so padding can appear in the middle of the body.
+  const std::string encoded = std::string(B64_MESSAGE) + B64_MESSAGE;
+  Buffer::OwnedImpl request_buffer(encoded.substr(0, 37));
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_.decodeData(request_buffer, false));
+  Buffer::OwnedImpl decoded_buffer;
+  decoded_buffer.move(request_buffer);
+
+  request_buffer.add(encoded.substr(37));
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_.decodeData(request_buffer, true));
+  decoded_buffer.move(request_buffer);
+  EXPECT_EQ(std::string(TEXT_MESSAGE, TEXT_MESSAGE_SIZE) +
+                std::string(TEXT_MESSAGE, TEXT_MESSAGE_SIZE),
+            TestUtility::bufferToString(decoded_buffer));
+}
+
 TEST_P(GrpcWebFilterTest, StatsNoCluster) {
   Http::TestHeaderMapImpl request_headers{{"content-type", request_content_type()},
                                           {":path", "/lyft.users.BadCompanions/GetBadCompanions"}};
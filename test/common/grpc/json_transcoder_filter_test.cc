@@ -313,6 +313,65 @@ TEST_F(GrpcJsonTranscoderFilterTest, TranscodingUnaryError) {
   EXPECT_EQ(0, request_data.length());
 }
 
+TEST_F(GrpcJsonTranscoderFilterTest, TranscodingUnaryOverBufferLimit) {
+  JsonTranscoderConfig config(*Json::Factory::loadFromString(
+      "{\"proto_descriptor\": \"" + bookstoreDescriptorPath() +
+      "\",\"services\": [\"bookstore.Bookstore\"], \"max_buffered_response_bytes\": 10}"));
+  EXPECT_EQ(10UL, config.maxBufferedResponseBytes());
+  JsonTranscoderFilter filter(config);
+  filter.setDecoderFilterCallbacks(decoder_callbacks_);
+  filter.setEncoderFilterCallbacks(encoder_callbacks_);
+
+  Http::TestHeaderMapImpl request_headers{
+      {"content-type", "application/json"}, {":method", "POST"}, {":path", "/shelf"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter.decodeHeaders(request_headers, false));
+  Buffer::OwnedImpl request_data{"{\"theme\": \"Children\"}"};
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter.decodeData(request_data, true));
+
+  Http::TestHeaderMapImpl response_headers{
+      {"content-type", "application/grpc"}, {":status", "200"}, {"content-length", "30"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::StopIteration,
+            filter.encodeHeaders(response_headers, false));
+  EXPECT_EQ(nullptr, response_headers.ContentLength());
+
+  bookstore::Shelf response;
+  response.set_id(20);
+  response.set_theme("Children");
+  auto response_data = Common::serializeBody(response);
+
+  // The JSON is larger than the limit, so it is sent rather than buffered.
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter.encodeData(*response_data, false));
+  EXPECT_EQ("{\"id\":\"20\",\"theme\":\"Children\"}", TestUtility::bufferToString(*response_data));
+
+  // The headers are gone, so the gRPC status stays in the trailers.
+  Http::TestHeaderMapImpl response_trailers{{"grpc-status", "0"}};
+  EXPECT_EQ(Http::FilterTrailersStatus::Continue, filter.encodeTrailers(response_trailers));
+  EXPECT_EQ(nullptr, response_headers.GrpcStatus());
+  EXPECT_EQ(nullptr, response_headers.ContentLength());
+}
+
+TEST_F(GrpcJsonTranscoderFilterTest, TranscodingInvalidResponse) {
+  Http::TestHeaderMapImpl request_headers{
+      {"content-type", "application/json"}, {":method", "POST"}, {":path", "/shelf"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_.decodeHeaders(request_headers, false));
+  Buffer::OwnedImpl request_data{"{\"theme\": \"Children\"}"};
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_.decodeData(request_data, true));
+
+  Http::TestHeaderMapImpl response_headers{{"content-type", "application/grpc"},
+                                           {":status", "200"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::StopIteration,
+            filter_.encodeHeaders(response_headers, false));
+
+  // A length delimited field that is cut short.
+  Buffer::OwnedImpl response_data;
+  const uint8_t frame[] = {0, 0, 0, 0, 2, 0x12, 0x7f};
+  response_data.add(frame, sizeof(frame));
+
+  EXPECT_CALL(encoder_callbacks_, resetStream());
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer,
+            filter_.encodeData(response_data, true));
+}
+
 struct GrpcJsonTranscoderFilterPrintTestParam {
   std::string config_json_;
   std::string expected_response_;
@@ -0,0 +1,163 @@
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/grpc/codec.h"
+#include "common/grpc/common.h"
+#include "common/grpc/stats_filter.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+using testing::NiceMock;
+
+namespace Grpc {
+
+class GrpcStatsFilterTest : public testing::Test {
+public:
+  GrpcStatsFilterTest()
+      : config_(new StatsFilterConfig("http.test.", store_, tls_)), filter_(config_) {
+    filter_.setDecoderFilterCallbacks(decoder_callbacks_);
+  }
+
+  uint64_t counter(const std::string& name) {
+    return store_.counter("http.test.grpc.lyft.users.BadCompanions.GetBadCompanions." + name)
+        .value();
+  }
+
+  void addFrame(Buffer::Instance& buffer, const std::string& payload) {
+    std::array<uint8_t, 5> header;
+    Encoder().newFrame(GRPC_FH_DEFAULT, payload.size(), header);
+    buffer.add(header.data(), 5);
+    buffer.add(payload);
+  }
+
+  Stats::IsolatedStoreImpl store_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  StatsFilterConfigSharedPtr config_;
+  StatsFilter filter_;
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+  Http::TestHeaderMapImpl request_headers_{
+      {"content-type", "application/grpc"},
+      {":path", "/lyft.users.BadCompanions/GetBadCompanions"}};
+};
+
+TEST_F(GrpcStatsFilterTest, NotGrpc) {
+  Http::TestHeaderMapImpl request_headers{{"content-type", "application/json"},
+                                          {":path", "/lyft.users.BadCompanions/GetBadCompanions"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_.decodeHeaders(request_headers, true));
+  Http::TestHeaderMapImpl response_headers{{":status", "200"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_.encodeHeaders(response_headers, true));
+  filter_.onDestroy();
+  EXPECT_EQ(0U, counter("total"));
+}
+
+TEST_F(GrpcStatsFilterTest, NotAMethod) {
+  Http::TestHeaderMapImpl request_headers{{"content-type", "application/grpc"},
+                                          {":path", "/lyft.users.BadCompanions/"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_.decodeHeaders(request_headers, true));
+  filter_.onDestroy();
+  EXPECT_EQ(0U, counter("total"));
+}
+
+TEST_F(GrpcStatsFilterTest, UnarySuccess) {
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_.decodeHeaders(request_headers_, false));
+  Buffer::OwnedImpl request;
+  addFrame(request, "hello");
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_.decodeData(request, true));
+
+  Http::TestHeaderMapImpl response_headers{{":status", "200"},
+                                           {"content-type", "application/grpc"}};
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_.encodeHeaders(response_headers, false));
+  Buffer::OwnedImpl response;
+  addFrame(response, "world");
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_.encodeData(response, false));
+  Http::TestHeaderMapImpl response_trailers{{"grpc-status", "0"}};
+  EXPECT_EQ(Http::FilterTrailersStatus::Continue, filter_.encodeTrailers(response_trailers));
+  filter_.onDestroy();
+
+  EXPECT_EQ(1U, counter("total"));
+  EXPECT_EQ(1U, counter("success"));
+  EXPECT_EQ(0U, counter("failure"));
+  EXPECT_EQ(1U, counter("0"));
+  EXPECT_EQ(1U, counter("request_message_count"));
+  EXPECT_EQ(1U, counter("response_message_count"));
+}
+
+TEST_F(GrpcStatsFilterTest, StreamingMessageCounts) {
+  EXPECT_EQ(Http::FilterHeadersStatus::Continue, filter_.decodeHeaders(request_headers_, false));
+  Buffer::OwnedImpl request;
+  addFrame(request, "a");
+  addFrame(request, "");
+  addFrame(request, "c");
+  EXPECT_EQ(Http::FilterDataStatus::Continue, filter_.decodeData(request, false));
+  Http::TestHeaderMapImpl request_trailers;
+  EXPECT_EQ(Http::FilterTrailersStatus::Continue, filter_.decodeTrailers(request_trailers));
+
+  Http::TestHeaderMapImpl response_headers{{":status", "200"},
+                                           {"content-type", "application/grpc"}};
+  filter_.encodeHeaders(response_headers, false);
+  Buffer::OwnedImpl response;
+  addFrame(response, "x");
+  addFrame(response, "y");
+  filter_.encodeData(response, false);
+  Http::TestHeaderMapImpl response_trailers{{"grpc-status", "14"}};
+  filter_.encodeTrailers(response_trailers);
+  filter_.onDestroy();
+
+  EXPECT_EQ(3U, counter("request_message_count"));
+  EXPECT_EQ(2U, counter("response_message_count"));
+  EXPECT_EQ(1U, counter("failure"));
+  EXPECT_EQ(1U, counter("14"));
+}
+
+TEST_F(GrpcStatsFilterTest, TrailersOnlyError) {
+  filter_.decodeHeaders(request_headers_, true);
+  Http::TestHeaderMapImpl response_headers{
+      {":status", "200"}, {"content-type", "application/grpc"}, {"grpc-status", "5"}};
+  filter_.encodeHeaders(response_headers, true);
+  filter_.onDestroy();
+
+  EXPECT_EQ(1U, counter("failure"));
+  EXPECT_EQ(1U, counter("5"));
+}
+
+TEST_F(GrpcStatsFilterTest, HttpErrorWithoutGrpcStatus) {
+  filter_.decodeHeaders(request_headers_, true);
+  Http::TestHeaderMapImpl response_headers{{":status", "503"}};
+  filter_.encodeHeaders(response_headers, true);
+  filter_.onDestroy();
+
+  EXPECT_EQ(1U, counter("failure"));
+  EXPECT_EQ(1U, counter(std::to_string(Common::httpToGrpcStatus(503))));
+}
+
+TEST_F(GrpcStatsFilterTest, InvalidStatus) {
+  filter_.decodeHeaders(request_headers_, true);
+  Http::TestHeaderMapImpl response_headers{{":status", "200"}, {"grpc-status", "1024"}};
+  filter_.encodeHeaders(response_headers, true);
+  filter_.onDestroy();
+
+  EXPECT_EQ(1U, counter("failure"));
+  EXPECT_EQ(1U, counter("invalid"));
+}
+
+TEST_F(GrpcStatsFilterTest, Reset) {
+  filter_.decodeHeaders(request_headers_, false);
+  filter_.onDestroy();
+
+  EXPECT_EQ(1U, counter("total"));
+  EXPECT_EQ(1U, counter("failure"));
+  EXPECT_EQ(1U, counter("1"));
+}
+
+} // namespace Grpc
+} // namespace Envoy
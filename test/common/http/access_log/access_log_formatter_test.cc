@@ -174,6 +174,20 @@ TEST(AccessLogFormatterTest, requestInfoFormatter) {
     EXPECT_CALL(request_info, upstreamHost()).WillOnce(Return(nullptr));
     EXPECT_EQ("-", upstream_format.format(header, header, request_info));
   }
+
+  {
+    RequestInfoFormatter first_byte_format("UPSTREAM_FIRST_BYTE_US");
+    Optional<std::chrono::microseconds> time{std::chrono::microseconds{1234}};
+    EXPECT_CALL(request_info, timing(RequestTiming::UpstreamFirstByte)).WillOnce(Return(time));
+    EXPECT_EQ("1234", first_byte_format.format(header, header, request_info));
+  }
+
+  {
+    RequestInfoFormatter handshake_format("UPSTREAM_HANDSHAKE_END_US");
+    EXPECT_CALL(request_info, timing(RequestTiming::UpstreamHandshakeEnd))
+        .WillOnce(Return(Optional<std::chrono::microseconds>()));
+    EXPECT_EQ("-", handshake_format.format(header, header, request_info));
+  }
 }
 
 TEST(AccessLogFormatterTest, requestHeaderFormatter) {
@@ -261,6 +275,17 @@ TEST(AccessLogFormatterTest, CompositeFormatterSuccess) {
   }
 }
 
+TEST(AccessLogFormatterTest, FormatToAppends) {
+  MockRequestInfo request_info;
+  TestHeaderMapImpl request_header{{":method", "GET"}};
+  TestHeaderMapImpl response_header;
+  FormatterImpl formatter("%REQ(:METHOD)% %RESP(:STATUS)%");
+
+  std::string output = "line ";
+  formatter.formatTo(request_header, response_header, request_info, output);
+  EXPECT_EQ("line GET -", output);
+}
+
 TEST(AccessLogFormatterTest, ParserFailures) {
   AccessLogFormatParser parser;
 
@@ -64,6 +64,8 @@ public:
     return request_received_duration_;
   }
   void responseReceivedDuration(MonotonicTime time) override { UNREFERENCED_PARAMETER(time); }
+  void timing(RequestTiming, MonotonicTime) override {}
+  Optional<std::chrono::microseconds> timing(RequestTiming) const override { return {}; }
   uint64_t bytesReceived() const override { return 1; }
   Protocol protocol() const override { return protocol_; }
   void protocol(Protocol protocol) override { protocol_ = protocol; }
@@ -108,6 +110,7 @@ public:
   std::string output_;
   NiceMock<Runtime::MockLoader> runtime_;
   Envoy::AccessLog::MockAccessLogManager log_manager_;
+  Stats::IsolatedStoreImpl stats_;
 };
 
 TEST_F(AccessLogImplTest, LogMoreData) {
@@ -118,7 +121,7 @@ TEST_F(AccessLogImplTest, LogMoreData) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   EXPECT_CALL(*file_, write(_));
   request_info_.response_flags_ = ResponseFlag::UpstreamConnectionFailure;
@@ -141,7 +144,7 @@ TEST_F(AccessLogImplTest, EnvoyUpstreamServiceTime) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   EXPECT_CALL(*file_, write(_));
   response_headers_.addCopy(Http::Headers::get().EnvoyUpstreamServiceTime, "999");
@@ -160,7 +163,7 @@ TEST_F(AccessLogImplTest, NoFilter) {
     )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   EXPECT_CALL(*file_, write(_));
   log->log(&request_headers_, &response_headers_, request_info_);
@@ -181,7 +184,7 @@ TEST_F(AccessLogImplTest, UpstreamHost) {
       )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   EXPECT_CALL(*file_, write(_));
   log->log(&request_headers_, &response_headers_, request_info_);
@@ -203,7 +206,7 @@ TEST_F(AccessLogImplTest, WithFilterMiss) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   EXPECT_CALL(*file_, write(_)).Times(0);
   log->log(&request_headers_, &response_headers_, request_info_);
@@ -226,7 +229,7 @@ TEST_F(AccessLogImplTest, WithFilterHit) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   EXPECT_CALL(*file_, write(_)).Times(3);
   log->log(&request_headers_, &response_headers_, request_info_);
@@ -248,7 +251,7 @@ TEST_F(AccessLogImplTest, RuntimeFilter) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   // Value is taken from random generator.
   EXPECT_CALL(runtime_.snapshot_, featureEnabled("access_log.test_key", 0)).WillOnce(Return(true));
@@ -268,6 +271,37 @@ TEST_F(AccessLogImplTest, RuntimeFilter) {
   EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.test_key", 0)).WillOnce(Return(55));
   EXPECT_CALL(*file_, write(_)).Times(0);
   log->log(&request_headers_, &response_headers_, request_info_);
+
+  // A request ID that is not a UUID is hashed rather than sampled at random.
+  request_headers_.remove(Http::Headers::get().RequestId);
+  request_headers_.addCopy("x-request-id", "not-a-uuid");
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("access_log.test_key", 0)).Times(0);
+  EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.test_key", 0)).WillOnce(Return(100));
+  EXPECT_CALL(*file_, write(_));
+  log->log(&request_headers_, &response_headers_, request_info_);
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("access_log.test_key", 0)).WillOnce(Return(0));
+  EXPECT_CALL(*file_, write(_)).Times(0);
+  log->log(&request_headers_, &response_headers_, request_info_);
+}
+
+TEST_F(AccessLogImplTest, RateLimit) {
+  const std::string json = R"EOF(
+  {
+    "path": "/dev/null"
+  }
+  )EOF";
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger(InstanceImpl::MAX_LINES_PER_SECOND_KEY, 0))
+      .WillOnce(Return(2));
+  InstanceSharedPtr log =
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
+
+  EXPECT_CALL(*file_, write(_)).Times(2);
+  for (int i = 0; i < 3; ++i) {
+    log->log(&request_headers_, &response_headers_, request_info_);
+  }
+  EXPECT_EQ(1UL, stats_.counter("access_log.rate_limited").value());
 }
 
 TEST_F(AccessLogImplTest, PathRewrite) {
@@ -281,7 +315,7 @@ TEST_F(AccessLogImplTest, PathRewrite) {
 
   Json::ObjectSharedPtr loader = Json::Factory::loadFromString(json);
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   EXPECT_CALL(*file_, write(_));
   log->log(&request_headers_, &response_headers_, request_info_);
@@ -299,7 +333,7 @@ TEST_F(AccessLogImplTest, healthCheckTrue) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   TestHeaderMapImpl header_map{};
   request_info_.hc_request_ = true;
@@ -317,7 +351,7 @@ TEST_F(AccessLogImplTest, healthCheckFalse) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   TestHeaderMapImpl header_map{};
   EXPECT_CALL(*file_, write(_));
@@ -343,7 +377,7 @@ TEST_F(AccessLogImplTest, requestTracing) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
 
   {
     TestHeaderMapImpl forced_header{{"x-request-id", force_tracing_guid}};
@@ -367,6 +401,7 @@ TEST_F(AccessLogImplTest, requestTracing) {
 TEST(AccessLogImplTestCtor, FiltersMissingInOrAndFilter) {
   Runtime::MockLoader runtime;
   Envoy::AccessLog::MockAccessLogManager log_manager;
+  Stats::IsolatedStoreImpl stats;
 
   {
     const std::string json = R"EOF(
@@ -376,7 +411,7 @@ TEST(AccessLogImplTestCtor, FiltersMissingInOrAndFilter) {
       }
     )EOF";
 
-    EXPECT_THROW(InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime, log_manager),
+    EXPECT_THROW(InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime, log_manager, stats),
                  EnvoyException);
   }
 
@@ -388,7 +423,7 @@ TEST(AccessLogImplTestCtor, FiltersMissingInOrAndFilter) {
       }
     )EOF";
 
-    EXPECT_THROW(InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime, log_manager),
+    EXPECT_THROW(InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime, log_manager, stats),
                  EnvoyException);
   }
 }
@@ -406,7 +441,7 @@ TEST_F(AccessLogImplTest, andFilter) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
   request_info_.response_code_.value(500);
 
   {
@@ -437,7 +472,7 @@ TEST_F(AccessLogImplTest, orFilter) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
   request_info_.response_code_.value(500);
 
   {
@@ -471,7 +506,7 @@ TEST_F(AccessLogImplTest, multipleOperators) {
   )EOF";
 
   InstanceSharedPtr log =
-      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_);
+      InstanceImpl::fromProto(parseAccessLogFromJson(json), runtime_, log_manager_, stats_);
   request_info_.response_code_.value(500);
 
   {
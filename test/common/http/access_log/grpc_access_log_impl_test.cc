@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "common/http/access_log/grpc_access_log_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/grpc/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::ReturnRef;
+using testing::SaveArg;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+namespace AccessLog {
+namespace {
+
+typedef Grpc::MockAsyncClient<pb::envoy::accesslog::StreamAccessLogsMessage,
+                              pb::envoy::accesslog::StreamAccessLogsResponse>
+    MockAccessLogAsyncClient;
+
+class GrpcAccessLogImplTest : public testing::Test {
+public:
+  GrpcAccessLogImplTest()
+      : async_client_(new MockAccessLogAsyncClient()),
+        flush_timer_(new Event::MockTimer(&tls_.dispatcher_)) {
+    ON_CALL(request_info_, responseCode()).WillByDefault(ReturnRef(response_code_));
+    access_log_.reset(new GrpcAccessLogImpl(
+        nullptr, [this]() { return AccessLogAsyncClientPtr{async_client_}; }, tls_, stats_store_,
+        "access_log.grpc.collector."));
+  }
+
+  void log(uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+      access_log_->log(&request_headers_, nullptr, request_info_);
+    }
+  }
+
+  uint64_t counter(const std::string& name) {
+    return stats_store_.counter("access_log.grpc.collector." + name).value();
+  }
+
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  MockAccessLogAsyncClient* async_client_;
+  Event::MockTimer* flush_timer_;
+  Grpc::MockAsyncStream<pb::envoy::accesslog::StreamAccessLogsMessage> async_stream_;
+  Stats::IsolatedStoreImpl stats_store_;
+  TestHeaderMapImpl request_headers_{{":method", "GET"}, {":path", "/"}};
+  NiceMock<MockRequestInfo> request_info_;
+  Optional<uint32_t> response_code_{200};
+  std::unique_ptr<GrpcAccessLogImpl> access_log_;
+};
+
+// Validate that records are sent in batches on one stream.
+TEST_F(GrpcAccessLogImplTest, Batches) {
+  EXPECT_CALL(*flush_timer_, enableTimer(GrpcAccessLogImpl::FLUSH_INTERVAL));
+  log(2);
+
+  pb::envoy::accesslog::StreamAccessLogsMessage message;
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  EXPECT_CALL(async_stream_, sendMessage(_, false)).WillOnce(SaveArg<0>(&message));
+  flush_timer_->callback_();
+  ASSERT_EQ(2, message.entries_size());
+  EXPECT_EQ("GET", message.entries(0).method());
+  EXPECT_EQ(200U, message.entries(0).response_code());
+
+  // A full batch is sent at once on the open stream.
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  EXPECT_CALL(async_stream_, sendMessage(_, false)).WillOnce(SaveArg<0>(&message));
+  log(GrpcAccessLogImpl::MAX_BATCH_ENTRIES);
+  EXPECT_EQ(100, message.entries_size());
+  EXPECT_EQ(2UL, counter("batches_sent"));
+  EXPECT_EQ(102UL, counter("logged"));
+
+  EXPECT_CALL(async_stream_, resetStream());
+  access_log_.reset();
+}
+
+// Validate that records are buffered while the collector is unavailable, up to a limit.
+TEST_F(GrpcAccessLogImplTest, Unavailable) {
+  EXPECT_CALL(*flush_timer_, enableTimer(_)).Times(2);
+  log(GrpcAccessLogImpl::MAX_BUFFERED_ENTRIES);
+
+  Grpc::AsyncStreamCallbacks<pb::envoy::accesslog::StreamAccessLogsResponse>* callbacks;
+  EXPECT_CALL(*async_client_, start(_, _))
+      .WillOnce(Invoke([&callbacks](const Protobuf::MethodDescriptor&,
+                                    Grpc::AsyncStreamCallbacks<
+                                        pb::envoy::accesslog::StreamAccessLogsResponse>& cb) {
+        callbacks = &cb;
+        cb.onRemoteClose(Grpc::Status::GrpcStatus::Unavailable, "");
+        return nullptr;
+      }));
+  flush_timer_->callback_();
+  EXPECT_EQ(1UL, counter("stream_failure"));
+
+  log(1);
+  EXPECT_EQ(1UL, counter("dropped"));
+
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  EXPECT_CALL(async_stream_, sendMessage(_, false));
+  flush_timer_->callback_();
+  EXPECT_EQ(1UL, counter("batches_sent"));
+
+  // Records logged after the stream closes wait for the next flush.
+  EXPECT_CALL(async_stream_, sendMessage(_, false)).Times(0);
+  callbacks->onRemoteClose(Grpc::Status::GrpcStatus::Unavailable, "");
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  log(1);
+}
+
+TEST(GrpcAccessLogImplEntryTest, CreateEntry) {
+  NiceMock<MockRequestInfo> request_info;
+  Optional<uint32_t> response_code;
+  ON_CALL(request_info, responseCode()).WillByDefault(ReturnRef(response_code));
+  ON_CALL(request_info, protocol()).WillByDefault(Return(Protocol::Http2));
+  ON_CALL(request_info, duration()).WillByDefault(Return(std::chrono::microseconds(15)));
+  ON_CALL(request_info, getResponseFlag(ResponseFlag::UpstreamRequestTimeout))
+      .WillByDefault(Return(true));
+  ON_CALL(request_info, getResponseFlag(ResponseFlag::RateLimited)).WillByDefault(Return(true));
+  TestHeaderMapImpl request_headers{{":path", "/rewritten"},
+                                    {"x-envoy-original-path", "/original"},
+                                    {":authority", "host"},
+                                    {"x-request-id", "id"}};
+
+  pb::envoy::accesslog::HTTPAccessLogEntry entry;
+  GrpcAccessLogImpl::createEntry(entry, request_headers, request_info);
+  EXPECT_EQ(pb::envoy::accesslog::HTTPAccessLogEntry::HTTP2, entry.protocol());
+  EXPECT_EQ(15U, entry.duration_us());
+  EXPECT_EQ(0U, entry.response_code());
+  EXPECT_EQ(static_cast<uint32_t>(ResponseFlag::UpstreamRequestTimeout | ResponseFlag::RateLimited),
+            entry.response_flags());
+  EXPECT_EQ("/original", entry.path());
+  EXPECT_EQ("host", entry.authority());
+  EXPECT_EQ("id", entry.request_id());
+  EXPECT_EQ("", entry.method());
+}
+
+} // namespace
+} // namespace AccessLog
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,180 @@
+#include <memory>
+
+#include "common/http/alpn_conn_pool.h"
+#include "common/network/utility.h"
+
+#include "test/common/http/common.h"
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/network/mocks.h"
+#include "test/mocks/upstream/host.h"
+#include "test/test_common/printers.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Http {
+
+class AlpnConnPoolImplTest : public testing::Test {
+public:
+  AlpnConnPoolImplTest()
+      : pool_(new AlpnConnPoolImpl(dispatcher_, host_,
+                                   [this](Protocol protocol) -> ConnectionPool::InstancePtr {
+                                     created_protocol_ = protocol;
+                                     return std::move(owned_protocol_pool_);
+                                   })) {
+    ON_CALL(*host_, address())
+        .WillByDefault(Return(Network::Utility::resolveUrl("tcp://10.0.0.1:443")));
+  }
+
+  // Expect the connection that learns the protocol.
+  void expectConnect() {
+    connection_ = new NiceMock<Network::MockClientConnection>();
+    connect_timer_ = new NiceMock<Event::MockTimer>(&dispatcher_);
+    Upstream::MockHost::MockCreateConnectionData data;
+    data.connection_ = connection_;
+    data.host_description_ = host_;
+    EXPECT_CALL(*host_, createConnection_(_)).WillOnce(Return(data));
+    EXPECT_CALL(*connection_, connect());
+  }
+
+  void connected(const std::string& next_protocol) {
+    EXPECT_CALL(*connection_, nextProtocol()).WillOnce(Return(next_protocol));
+    EXPECT_CALL(*connection_, close(_));
+    connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  }
+
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  std::shared_ptr<NiceMock<Upstream::MockHost>> host_{new NiceMock<Upstream::MockHost>()};
+  ConnectionPool::InstancePtr owned_protocol_pool_{new NiceMock<ConnectionPool::MockInstance>()};
+  ConnectionPool::MockInstance* protocol_pool_{
+      static_cast<ConnectionPool::MockInstance*>(owned_protocol_pool_.get())};
+  Optional<Protocol> created_protocol_;
+  std::unique_ptr<AlpnConnPoolImpl> pool_;
+  NiceMock<Network::MockClientConnection>* connection_{};
+  NiceMock<Event::MockTimer>* connect_timer_{};
+  NiceMock<MockStreamDecoder> decoder_;
+  ConnPoolCallbacks callbacks_;
+};
+
+// Streams wait for the protocol and then go to the HTTP/2 pool, as do all later ones.
+TEST_F(AlpnConnPoolImplTest, Http2) {
+  expectConnect();
+  EXPECT_NE(nullptr, pool_->newStream(decoder_, callbacks_));
+  EXPECT_EQ(nullptr, pool_->protocol());
+
+  NiceMock<MockStreamEncoder> encoder;
+  EXPECT_CALL(*protocol_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](StreamDecoder&, ConnectionPool::Callbacks& callbacks)
+                           -> ConnectionPool::Cancellable* {
+                             callbacks.onPoolReady(encoder, host_);
+                             return nullptr;
+                           }));
+  EXPECT_CALL(callbacks_.pool_ready_, ready());
+  connected("h2");
+  EXPECT_EQ(Protocol::Http2, created_protocol_.value());
+  EXPECT_EQ(Protocol::Http2, *pool_->protocol());
+  EXPECT_EQ(&encoder, callbacks_.outer_encoder_);
+
+  ConnPoolCallbacks callbacks;
+  ConnectionPool::MockCancellable cancellable;
+  EXPECT_CALL(*protocol_pool_, newStream(_, _)).WillOnce(Return(&cancellable));
+  EXPECT_EQ(&cancellable, pool_->newStream(decoder_, callbacks));
+}
+
+// A host that selects nothing gets HTTP/1.1. Prefetching waits for the protocol.
+TEST_F(AlpnConnPoolImplTest, Http11Prefetch) {
+  expectConnect();
+  pool_->prefetchConnections();
+
+  EXPECT_CALL(*protocol_pool_, prefetchConnections());
+  connected("");
+  EXPECT_EQ(Protocol::Http11, created_protocol_.value());
+
+  EXPECT_CALL(*protocol_pool_, prefetchConnections());
+  pool_->prefetchConnections();
+}
+
+// A stream cancelled while it waits is not handed over, and one cancelled after that is
+// cancelled in the pool of the protocol.
+TEST_F(AlpnConnPoolImplTest, Cancel) {
+  expectConnect();
+  ConnectionPool::Cancellable* handle = pool_->newStream(decoder_, callbacks_);
+  ConnPoolCallbacks callbacks;
+  ConnectionPool::Cancellable* other_handle = pool_->newStream(decoder_, callbacks);
+  handle->cancel();
+
+  ConnectionPool::MockCancellable cancellable;
+  EXPECT_CALL(*protocol_pool_, newStream(_, _)).WillOnce(Return(&cancellable));
+  connected("h2");
+
+  EXPECT_CALL(cancellable, cancel());
+  other_handle->cancel();
+}
+
+// A failed connect fails the waiting streams, and the next stream connects again.
+TEST_F(AlpnConnPoolImplTest, ConnectFailure) {
+  expectConnect();
+  pool_->newStream(decoder_, callbacks_);
+
+  EXPECT_CALL(callbacks_.pool_failure_, ready());
+  connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_cx_connect_fail_.value());
+  EXPECT_EQ(1UL, host_->stats_.cx_connect_fail_.value());
+  EXPECT_EQ(nullptr, pool_->protocol());
+
+  expectConnect();
+  pool_->newStream(decoder_, callbacks_);
+
+  EXPECT_CALL(callbacks_.pool_failure_, ready());
+  connect_timer_->callback_();
+  EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_cx_connect_timeout_.value());
+  EXPECT_EQ(2UL, host_->cluster_.stats_.upstream_cx_connect_fail_.value());
+}
+
+// Draining completes once no stream waits, and a drain before the protocol is known carries over
+// to the pool of the protocol.
+TEST_F(AlpnConnPoolImplTest, Drain) {
+  expectConnect();
+  ConnectionPool::Cancellable* handle = pool_->newStream(decoder_, callbacks_);
+
+  ReadyWatcher drained;
+  pool_->addDrainedCallback([&]() -> void { drained.ready(); });
+
+  EXPECT_CALL(*connection_, close(_));
+  EXPECT_CALL(drained, ready());
+  handle->cancel();
+
+  // Nothing connects for prefetching while draining.
+  EXPECT_CALL(*host_, createConnection_(_)).Times(0);
+  pool_->prefetchConnections();
+}
+
+TEST_F(AlpnConnPoolImplTest, DrainCarriesOver) {
+  expectConnect();
+  pool_->newStream(decoder_, callbacks_);
+  pool_->addDrainedCallback([]() -> void {});
+
+  ConnectionPool::MockCancellable cancellable;
+  EXPECT_CALL(*protocol_pool_, addDrainedCallback(_));
+  EXPECT_CALL(*protocol_pool_, newStream(_, _)).WillOnce(Return(&cancellable));
+  connected("");
+}
+
+// Destroying the pool fails the streams that wait for the protocol.
+TEST_F(AlpnConnPoolImplTest, DestroyWhileWaiting) {
+  expectConnect();
+  pool_->newStream(decoder_, callbacks_);
+
+  EXPECT_CALL(callbacks_.pool_failure_, ready());
+  pool_.reset();
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -845,5 +845,135 @@ TEST_F(AsyncClientImplTest, WatermarkCallbacks) {
   EXPECT_CALL(stream_callbacks_, onReset());
 }
 
+TEST_F(AsyncClientImplTest, DirectBasic) {
+  message_->body().reset(new Buffer::OwnedImpl("test body"));
+  Buffer::Instance& data = *message_->body();
+
+  EXPECT_CALL(cm_, httpConnPoolForCluster("fake_cluster", _, _));
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](StreamDecoder& decoder,
+                           ConnectionPool::Callbacks& callbacks) -> ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(stream_encoder_, cm_.conn_pool_.host_);
+        response_decoder_ = &decoder;
+        return nullptr;
+      }));
+
+  TestHeaderMapImpl copy(message_->headers());
+  copy.addCopy("x-envoy-internal", "true");
+  copy.addCopy("x-forwarded-for", "127.0.0.1");
+  copy.addCopy(":scheme", "http");
+
+  EXPECT_CALL(stream_encoder_, encodeHeaders(HeaderMapEqualRef(&copy), false));
+  EXPECT_CALL(stream_encoder_, encodeData(BufferEqual(&data), true));
+
+  AsyncClient::Request* request = client_.sendDirect(
+      std::move(message_), callbacks_, Optional<std::chrono::milliseconds>(), "test");
+  EXPECT_NE(nullptr, request);
+  EXPECT_TRUE(client_.hasActiveStreams());
+
+  EXPECT_CALL(callbacks_, onSuccess_(_)).WillOnce(Invoke([](Message* response) -> void {
+    EXPECT_EQ(200U, Utility::getResponseStatus(response->headers()));
+    EXPECT_EQ("test body", response->bodyAsString());
+  }));
+  response_decoder_->decodeHeaders(HeaderMapPtr(new TestHeaderMapImpl{{":status", "200"}}), false);
+  response_decoder_->decodeData(data, true);
+  EXPECT_FALSE(client_.hasActiveStreams());
+
+  Stats::Store& stats = cm_.thread_local_cluster_.cluster_.info_->stats_store_;
+  EXPECT_EQ(1UL, stats.counter("async_client.test.rq_total").value());
+  EXPECT_EQ(1UL, stats.counter("async_client.test.rq_success").value());
+  EXPECT_EQ(0UL, stats.counter("async_client.test.rq_error").value());
+  // The router is not involved, so there are no routed request stats.
+  EXPECT_EQ(0UL, stats.counter("upstream_rq_200").value());
+}
+
+TEST_F(AsyncClientImplTest, DirectNoHealthyUpstream) {
+  EXPECT_CALL(cm_, httpConnPoolForCluster(_, _, _)).WillOnce(Return(nullptr));
+  expectSuccess(503);
+  EXPECT_EQ(nullptr, client_.sendDirect(std::move(message_), callbacks_,
+                                        Optional<std::chrono::milliseconds>(), "test"));
+  EXPECT_FALSE(client_.hasActiveStreams());
+  EXPECT_EQ(1UL, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                     .counter("async_client.test.rq_error")
+                     .value());
+}
+
+TEST_F(AsyncClientImplTest, DirectPoolFailure) {
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](StreamDecoder&,
+                           ConnectionPool::Callbacks& callbacks) -> ConnectionPool::Cancellable* {
+        callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::Overflow, nullptr);
+        return nullptr;
+      }));
+
+  expectSuccess(503);
+  EXPECT_EQ(nullptr, client_.sendDirect(std::move(message_), callbacks_,
+                                        Optional<std::chrono::milliseconds>(), "test"));
+}
+
+TEST_F(AsyncClientImplTest, DirectResetAfterResponseStart) {
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](StreamDecoder& decoder,
+                           ConnectionPool::Callbacks& callbacks) -> ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(stream_encoder_, cm_.conn_pool_.host_);
+        response_decoder_ = &decoder;
+        return nullptr;
+      }));
+
+  client_.sendDirect(std::move(message_), callbacks_, Optional<std::chrono::milliseconds>(),
+                     "test");
+  response_decoder_->decodeHeaders(HeaderMapPtr(new TestHeaderMapImpl{{":status", "200"}}), false);
+  EXPECT_CALL(callbacks_, onFailure(AsyncClient::FailureReason::Reset));
+  stream_encoder_.getStream().resetStream(StreamResetReason::RemoteReset);
+  EXPECT_FALSE(client_.hasActiveStreams());
+}
+
+TEST_F(AsyncClientImplTest, DirectTimeout) {
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](StreamDecoder&,
+                           ConnectionPool::Callbacks& callbacks) -> ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(stream_encoder_, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+
+  timer_ = new NiceMock<Event::MockTimer>(&dispatcher_);
+  EXPECT_CALL(*timer_, enableTimer(std::chrono::milliseconds(40)));
+  client_.sendDirect(std::move(message_), callbacks_, std::chrono::milliseconds(40), "test");
+
+  expectSuccess(504);
+  EXPECT_CALL(stream_encoder_.stream_, resetStream(StreamResetReason::LocalReset));
+  timer_->callback_();
+  EXPECT_EQ(1UL, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                     .counter("async_client.test.rq_timeout")
+                     .value());
+}
+
+TEST_F(AsyncClientImplTest, DirectCancelPending) {
+  NiceMock<ConnectionPool::MockCancellable> cancellable;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _)).WillOnce(Return(&cancellable));
+
+  timer_ = new NiceMock<Event::MockTimer>(&dispatcher_);
+  EXPECT_CALL(*timer_, disableTimer());
+  AsyncClient::Request* request =
+      client_.sendDirect(std::move(message_), callbacks_, std::chrono::milliseconds(40), "test");
+  EXPECT_CALL(cancellable, cancel());
+  request->cancel();
+  EXPECT_FALSE(client_.hasActiveStreams());
+}
+
+TEST_F(AsyncClientImplTest, DirectDestroyWithActiveRequest) {
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](StreamDecoder&,
+                           ConnectionPool::Callbacks& callbacks) -> ConnectionPool::Cancellable* {
+        callbacks.onPoolReady(stream_encoder_, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+
+  client_.sendDirect(std::move(message_), callbacks_, Optional<std::chrono::milliseconds>(),
+                     "test");
+  EXPECT_CALL(stream_encoder_.stream_, resetStream(StreamResetReason::LocalReset));
+  EXPECT_CALL(callbacks_, onFailure(AsyncClient::FailureReason::Reset));
+}
+
 } // namespace Http
 } // namespace Envoy
@@ -31,13 +31,24 @@ public:
 
     CodeUtility::ResponseStatInfo info{
         global_store_,      cluster_scope_,        "prefix.", headers, internal_request,
-        request_vhost_name, request_vcluster_name, from_az,   to_az,   canary};
+        request_vhost_name, request_vcluster_name, from_az,   to_az,   canary,
+        code_stats_.get()};
 
     CodeUtility::chargeResponseStat(info);
   }
 
   Stats::IsolatedStoreImpl global_store_;
   Stats::IsolatedStoreImpl cluster_scope_;
+  CodeStatsPtr code_stats_;
+};
+
+/**
+ * Runs the same cases as CodeUtilityTest but charges the cluster stats via pre-resolved
+ * CodeStatsImpl counters. The resulting stats must be identical.
+ */
+class CodeStatsImplTest : public CodeUtilityTest {
+public:
+  CodeStatsImplTest() { code_stats_.reset(new CodeStatsImpl(cluster_scope_, "prefix.")); }
 };
 
 TEST_F(CodeUtilityTest, NoCanary) {
@@ -174,6 +185,87 @@ TEST_F(CodeUtilityTest, PerZoneStats) {
   EXPECT_EQ(1U, cluster_scope_.counter("prefix.zone.from_az.to_az.upstream_rq_2xx").value());
 }
 
+TEST_F(CodeStatsImplTest, NoCanary) {
+  addResponse(201, false, false);
+  addResponse(301, false, true);
+  addResponse(401, false, false);
+  addResponse(501, false, true);
+
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_2xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_201").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.external.upstream_rq_2xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.external.upstream_rq_201").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_3xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_301").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.internal.upstream_rq_3xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.internal.upstream_rq_301").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_4xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_401").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.external.upstream_rq_4xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.external.upstream_rq_401").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_5xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_501").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.internal.upstream_rq_5xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.internal.upstream_rq_501").value());
+
+  EXPECT_EQ(16U, cluster_scope_.counters().size());
+}
+
+TEST_F(CodeStatsImplTest, Canary) {
+  addResponse(200, true, true);
+  addResponse(200, true, true);
+  addResponse(500, true, false);
+
+  EXPECT_EQ(2U, cluster_scope_.counter("prefix.upstream_rq_2xx").value());
+  EXPECT_EQ(2U, cluster_scope_.counter("prefix.upstream_rq_200").value());
+  EXPECT_EQ(2U, cluster_scope_.counter("prefix.internal.upstream_rq_2xx").value());
+  EXPECT_EQ(2U, cluster_scope_.counter("prefix.internal.upstream_rq_200").value());
+  EXPECT_EQ(2U, cluster_scope_.counter("prefix.canary.upstream_rq_2xx").value());
+  EXPECT_EQ(2U, cluster_scope_.counter("prefix.canary.upstream_rq_200").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_5xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_500").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.external.upstream_rq_5xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.external.upstream_rq_500").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.canary.upstream_rq_5xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.canary.upstream_rq_500").value());
+
+  EXPECT_EQ(12U, cluster_scope_.counters().size());
+}
+
+TEST_F(CodeStatsImplTest, UnknownCode) {
+  addResponse(299, false, false);
+  addResponse(700, false, false);
+
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_2xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_299").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.upstream_rq_700").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.external.upstream_rq_").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.external.upstream_rq_700").value());
+}
+
+TEST_F(CodeStatsImplTest, RequestVirtualCluster) {
+  addResponse(200, false, false, "test-vhost", "test-cluster");
+
+  EXPECT_EQ(
+      1U, global_store_.counter("vhost.test-vhost.vcluster.test-cluster.upstream_rq_2xx").value());
+  EXPECT_EQ(
+      1U, global_store_.counter("vhost.test-vhost.vcluster.test-cluster.upstream_rq_200").value());
+}
+
+TEST_F(CodeStatsImplTest, PerZoneStats) {
+  addResponse(200, false, false, "", "", "from_az", "to_az");
+  addResponse(503, false, false, "", "", "from_az", "to_az");
+  addResponse(200, false, false, "", "", "from_az", "other_az");
+
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.zone.from_az.to_az.upstream_rq_200").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.zone.from_az.to_az.upstream_rq_2xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.zone.from_az.to_az.upstream_rq_503").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.zone.from_az.to_az.upstream_rq_5xx").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.zone.from_az.other_az.upstream_rq_200").value());
+  EXPECT_EQ(1U, cluster_scope_.counter("prefix.zone.from_az.other_az.upstream_rq_2xx").value());
+}
+
 TEST(CodeUtilityResponseTimingTest, All) {
   Stats::MockStore global_store;
   Stats::MockStore cluster_scope;
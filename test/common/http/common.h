@@ -2,6 +2,7 @@
 
 #include <functional>
 
+#include "envoy/common/optional.h"
 #include "envoy/http/conn_pool.h"
 
 #include "common/http/codec_client.h"
@@ -52,10 +53,15 @@ struct ConnPoolCallbacks : public Http::ConnectionPool::Callbacks {
     pool_failure_.ready();
   }
 
+  void onPoolConnectionTiming(const Http::ConnectionPool::ConnectionTiming& timing) override {
+    connection_timing_.value(timing);
+  }
+
   ReadyWatcher pool_failure_;
   ReadyWatcher pool_ready_;
   Http::StreamEncoder* outer_encoder_{};
   Upstream::HostDescriptionConstSharedPtr host_;
+  Optional<Http::ConnectionPool::ConnectionTiming> connection_timing_;
 };
 
 /**
@@ -225,6 +225,7 @@ public:
   const Network::Address::Instance& localAddress() override { return local_address_; }
   const Optional<std::string>& userAgent() override { return user_agent_; }
   const TracingConnectionManagerConfig* tracingConfig() override { return tracing_config_.get(); }
+  bool plainProxy() override { return plain_proxy_; }
 
   NiceMock<Tracing::MockHttpTracer> tracer_;
   NiceMock<Runtime::MockLoader> runtime_;
@@ -252,6 +253,7 @@ public:
   std::unique_ptr<Ssl::MockConnection> ssl_connection_;
   RouteConfigProvider route_config_provider_;
   TracingConnectionManagerConfigPtr tracing_config_;
+  bool plain_proxy_{};
   SlowDateProviderImpl date_provider_;
   MockStream stream_;
   Http::StreamCallbacks* stream_callbacks_{nullptr};
@@ -456,6 +458,43 @@ TEST_F(HttpConnectionManagerImplTest, TestAccessLog) {
   conn_manager_->onData(fake_input);
 }
 
+// Validate that streams of a plain proxy config skip the filter chain size, access logs and
+// tracing, and still go through their filter.
+TEST_F(HttpConnectionManagerImplTest, PlainProxy) {
+  plain_proxy_ = true;
+  setup(false, "");
+
+  std::shared_ptr<MockStreamDecoderFilter> filter(new NiceMock<MockStreamDecoderFilter>());
+  EXPECT_CALL(filter_factory_, filterChainSize()).Times(0);
+  EXPECT_CALL(filter_factory_, createFilterChain(_))
+      .WillOnce(Invoke([&](FilterChainFactoryCallbacks& callbacks) -> void {
+        callbacks.addStreamDecoderFilter(filter);
+      }));
+  EXPECT_CALL(tracer_, startSpan_(_, _, _)).Times(0);
+
+  StreamDecoder* decoder = nullptr;
+  NiceMock<MockStreamEncoder> encoder;
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance& data) -> void {
+    decoder = &conn_manager_->newStream(encoder);
+
+    HeaderMapPtr headers{
+        new TestHeaderMapImpl{{":method", "GET"}, {":authority", "host"}, {":path", "/"}}};
+    EXPECT_CALL(*filter, decodeHeaders(_, true))
+        .WillOnce(Return(FilterHeadersStatus::StopIteration));
+    decoder->decodeHeaders(std::move(headers), true);
+
+    HeaderMapPtr response_headers{new TestHeaderMapImpl{{":status", "200"}}};
+    EXPECT_CALL(encoder, encodeHeaders(_, true));
+    filter->callbacks_->encodeHeaders(std::move(response_headers), true);
+
+    data.drain(4);
+  }));
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+  EXPECT_EQ(1U, stats_.named_.downstream_rq_2xx_.value());
+}
+
 TEST_F(HttpConnectionManagerImplTest, DoNotStartSpanIfTracingIsNotEnabled) {
   setup(false, "");
 
@@ -574,6 +613,62 @@ TEST_F(HttpConnectionManagerImplTest, NoPath) {
   conn_manager_->onData(fake_input);
 }
 
+// A worker whose event loop is too far behind turns new requests away.
+TEST_F(HttpConnectionManagerImplTest, LoopDelayRejectsRequests) {
+  setup(false, "");
+  ON_CALL(runtime_.snapshot_, getInteger("overload.loop_delay.reject_requests_ms", 0))
+      .WillByDefault(Return(500));
+  EXPECT_CALL(filter_callbacks_.connection_.dispatcher_, loopDelay())
+      .WillOnce(Return(std::chrono::milliseconds(499)))
+      .WillOnce(Return(std::chrono::milliseconds(500)));
+
+  NiceMock<MockStreamEncoder> encoder;
+  EXPECT_CALL(*codec_, dispatch(_)).WillRepeatedly(Invoke([&](Buffer::Instance&) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(encoder);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":method", "CONNECT"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+  }));
+
+  EXPECT_CALL(encoder, encodeHeaders(_, true))
+      .WillOnce(Invoke([](const HeaderMap& headers, bool) -> void {
+        EXPECT_STREQ("404", headers.Status()->value().c_str());
+      }))
+      .WillOnce(Invoke([](const HeaderMap& headers, bool) -> void {
+        EXPECT_STREQ("503", headers.Status()->value().c_str());
+      }));
+
+  Buffer::OwnedImpl fake_input;
+  conn_manager_->onData(fake_input);
+  conn_manager_->onData(fake_input);
+  EXPECT_EQ(1U, stats_.named_.downstream_rq_overload_rejected_.value());
+}
+
+// A worker whose event loop is behind closes HTTP/1.1 connections after the response.
+TEST_F(HttpConnectionManagerImplTest, LoopDelayDisablesKeepalive) {
+  setup(false, "");
+  ON_CALL(runtime_.snapshot_, getInteger("overload.loop_delay.disable_keepalive_ms", 0))
+      .WillByDefault(Return(100));
+  ON_CALL(filter_callbacks_.connection_.dispatcher_, loopDelay())
+      .WillByDefault(Return(std::chrono::milliseconds(100)));
+
+  NiceMock<MockStreamEncoder> encoder;
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance&) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(encoder);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":method", "CONNECT"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+  }));
+
+  EXPECT_CALL(encoder, encodeHeaders(_, true))
+      .WillOnce(Invoke([](const HeaderMap& headers, bool) -> void {
+        EXPECT_STREQ("close", headers.Connection()->value().c_str());
+      }));
+  EXPECT_CALL(filter_callbacks_.connection_, close(Network::ConnectionCloseType::FlushWrite));
+
+  Buffer::OwnedImpl fake_input;
+  conn_manager_->onData(fake_input);
+  EXPECT_EQ(1U, stats_.named_.downstream_cx_overload_disable_keepalive_.value());
+}
+
 TEST_F(HttpConnectionManagerImplTest, RejectWebSocketOnNonWebSocketRoute) {
   setup(false, "");
 
@@ -704,6 +799,78 @@ TEST_F(HttpConnectionManagerImplTest, WebSocketPrefixRewrite) {
   EXPECT_EQ(0U, stats_.named_.downstream_cx_websocket_active_.value());
 }
 
+TEST_F(HttpConnectionManagerImplTest, WebSocketSpliceAndShrinkIdleBuffers) {
+  setup(false, "");
+
+  ON_CALL(runtime_.snapshot_, featureEnabled("websocket.splice", 0)).WillByDefault(Return(true));
+  ON_CALL(runtime_.snapshot_, getInteger("websocket.buffer_idle_timeout_ms", 0))
+      .WillByDefault(Return(1000));
+  Event::MockDispatcher& dispatcher = filter_callbacks_.connection_.dispatcher_;
+  EXPECT_CALL(dispatcher, gauge("websocket_active"))
+      .WillOnce(Return(&fake_stats_.gauge("worker.websocket_active")));
+  EXPECT_CALL(dispatcher, gauge("websocket_buffered_bytes"))
+      .WillOnce(Return(&fake_stats_.gauge("worker.websocket_buffered_bytes")));
+
+  NiceMock<MockStreamEncoder> encoder;
+  NiceMock<Network::MockClientConnection>* upstream_connection =
+      new NiceMock<Network::MockClientConnection>();
+  Upstream::MockHost::MockCreateConnectionData conn_info;
+  conn_info.connection_ = upstream_connection;
+  conn_info.host_description_.reset(
+      new Upstream::HostImpl(cluster_manager_.thread_local_cluster_.cluster_.info_, "newhost",
+                             Network::Utility::resolveUrl("tcp://127.0.0.1:80"), false, 1, ""));
+  EXPECT_CALL(cluster_manager_, tcpConnForCluster_("fake_cluster", _)).WillOnce(Return(conn_info));
+  ON_CALL(route_config_provider_.route_config_->route_->route_entry_, useWebSocket())
+      .WillByDefault(Return(true));
+
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance& data) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(encoder);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"},
+                                               {":method", "GET"},
+                                               {":path", "/"},
+                                               {"connection", "Upgrade"},
+                                               {"upgrade", "websocket"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+    data.drain(4);
+  }));
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+  EXPECT_EQ(1U, fake_stats_.gauge("worker.websocket_active").value());
+
+  // Both directions are spliced once the upstream connects.
+  Event::MockTimer* idle_timer = new Event::MockTimer(&dispatcher);
+  EXPECT_CALL(filter_callbacks_.connection_, spliceTo(Ref(*upstream_connection)))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*upstream_connection, spliceTo(Ref(filter_callbacks_.connection_)))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  upstream_connection->raiseEvent(Network::ConnectionEvent::Connected);
+
+  // Buffers are only shrunk after an idle period without data.
+  Buffer::OwnedImpl ws_data("hello");
+  conn_manager_->onData(ws_data);
+  ON_CALL(filter_callbacks_.connection_, bufferedBytes()).WillByDefault(Return(10));
+  ON_CALL(*upstream_connection, bufferedBytes()).WillByDefault(Return(20));
+  EXPECT_CALL(filter_callbacks_.connection_, shrinkBuffers()).Times(0);
+  EXPECT_CALL(*upstream_connection, shrinkBuffers()).Times(0);
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  idle_timer->callback_();
+  EXPECT_EQ(30U, fake_stats_.gauge("worker.websocket_buffered_bytes").value());
+
+  ON_CALL(*upstream_connection, bufferedBytes()).WillByDefault(Return(0));
+  EXPECT_CALL(filter_callbacks_.connection_, shrinkBuffers());
+  EXPECT_CALL(*upstream_connection, shrinkBuffers());
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(1000)));
+  idle_timer->callback_();
+  EXPECT_EQ(10U, fake_stats_.gauge("worker.websocket_buffered_bytes").value());
+
+  filter_callbacks_.connection_.dispatcher_.clearDeferredDeleteList();
+  conn_manager_.reset();
+  EXPECT_EQ(0U, fake_stats_.gauge("worker.websocket_active").value());
+  EXPECT_EQ(0U, fake_stats_.gauge("worker.websocket_buffered_bytes").value());
+}
+
 TEST_F(HttpConnectionManagerImplTest, DrainClose) {
   setup(true, "");
 
@@ -1130,6 +1297,51 @@ TEST_F(HttpConnectionManagerImplTest, FilterAddBodyInTrailersCallback) {
       HeaderMapPtr{new TestHeaderMapImpl{{"some", "trailer"}}});
 }
 
+// Data added in the trailers callback of a stopped filter follows the data it buffered, and the
+// headers are continued ahead of both.
+TEST_F(HttpConnectionManagerImplTest, FilterAddBodyInTrailersCallbackWhileStopped) {
+  InSequence s;
+  setup(false, "");
+
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance&) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(response_encoder_);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}}};
+    decoder->decodeHeaders(std::move(headers), false);
+
+    Buffer::OwnedImpl fake_data("hello");
+    decoder->decodeData(fake_data, false);
+
+    HeaderMapPtr trailers{new TestHeaderMapImpl{{"foo", "bar"}}};
+    decoder->decodeTrailers(std::move(trailers));
+  }));
+
+  setupFilterChain(2, 0);
+
+  EXPECT_CALL(*decoder_filters_[0], decodeHeaders(_, false))
+      .WillOnce(Return(FilterHeadersStatus::StopIteration));
+  EXPECT_CALL(*decoder_filters_[0], decodeData(_, false))
+      .WillOnce(Return(FilterDataStatus::StopIterationAndBuffer));
+  Buffer::OwnedImpl trailers_data(" world");
+  EXPECT_CALL(*decoder_filters_[0], decodeTrailers(_))
+      .WillOnce(InvokeWithoutArgs([&]() -> FilterTrailersStatus {
+        decoder_filters_[0]->callbacks_->addDecodedData(trailers_data);
+        return FilterTrailersStatus::Continue;
+      }));
+  EXPECT_CALL(*decoder_filters_[1], decodeHeaders(_, false))
+      .WillOnce(Return(FilterHeadersStatus::Continue));
+  EXPECT_CALL(*decoder_filters_[1], decodeData(_, false))
+      .WillOnce(Invoke([](Buffer::Instance& data, bool) -> FilterDataStatus {
+        EXPECT_EQ(11U, data.length());
+        return FilterDataStatus::Continue;
+      }));
+  EXPECT_CALL(*decoder_filters_[1], decodeTrailers(_))
+      .WillOnce(Return(FilterTrailersStatus::StopIteration));
+
+  // Kick off the incoming data.
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+}
+
 TEST_F(HttpConnectionManagerImplTest, FilterAddBodyInline) {
   InSequence s;
   setup(false, "");
@@ -1432,6 +1644,45 @@ TEST_F(HttpConnectionManagerImplTest, MultipleFilters) {
   EXPECT_EQ(ssl_connection_.get(), encoder_filters_[1]->callbacks_->connection()->ssl());
 }
 
+TEST_F(HttpConnectionManagerImplTest, FilterChainLongerThanDeclared) {
+  InSequence s;
+  setup(false, "");
+
+  // Only the first filter in each direction fits in the room set aside for the stream.
+  ON_CALL(filter_factory_, filterChainSize()).WillByDefault(Return(FilterChainSize{1, 1}));
+
+  EXPECT_CALL(*codec_, dispatch(_)).WillOnce(Invoke([&](Buffer::Instance&) -> void {
+    StreamDecoder* decoder = &conn_manager_->newStream(response_encoder_);
+    HeaderMapPtr headers{new TestHeaderMapImpl{{":authority", "host"}, {":path", "/"}}};
+    decoder->decodeHeaders(std::move(headers), true);
+  }));
+
+  setupFilterChain(3, 2);
+
+  EXPECT_CALL(*decoder_filters_[0], decodeHeaders(_, true))
+      .WillOnce(Return(FilterHeadersStatus::Continue));
+  EXPECT_CALL(*decoder_filters_[1], decodeHeaders(_, true))
+      .WillOnce(Return(FilterHeadersStatus::StopIteration));
+
+  Buffer::OwnedImpl fake_input("1234");
+  conn_manager_->onData(fake_input);
+
+  EXPECT_CALL(*decoder_filters_[2], decodeHeaders(_, true))
+      .WillOnce(Return(FilterHeadersStatus::StopIteration));
+  decoder_filters_[1]->callbacks_->continueDecoding();
+
+  EXPECT_CALL(*encoder_filters_[0], encodeHeaders(_, true))
+      .WillOnce(Return(FilterHeadersStatus::StopIteration));
+  decoder_filters_[2]->callbacks_->encodeHeaders(
+      HeaderMapPtr{new TestHeaderMapImpl{{":status", "200"}}}, true);
+
+  EXPECT_CALL(*encoder_filters_[1], encodeHeaders(_, true))
+      .WillOnce(Return(FilterHeadersStatus::Continue));
+  EXPECT_CALL(response_encoder_, encodeHeaders(_, true));
+  expectOnDestroy();
+  encoder_filters_[0]->callbacks_->continueEncoding();
+}
+
 TEST(HttpConnectionManagerTracingStatsTest, verifyTracingStats) {
   Stats::IsolatedStoreImpl stats;
   ConnectionManagerTracingStats tracing_stats{CONN_MAN_TRACING_STATS(POOL_COUNTER(stats))};
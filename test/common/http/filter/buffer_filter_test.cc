@@ -9,7 +9,9 @@
 
 #include "test/mocks/buffer/mocks.h"
 #include "test/mocks/http/mocks.h"
+#include "test/test_common/environment.h"
 #include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -17,8 +19,8 @@
 namespace Envoy {
 using testing::DoAll;
 using testing::InSequence;
+using testing::Invoke;
 using testing::NiceMock;
-using testing::Return;
 using testing::SaveArg;
 using testing::_;
 
@@ -28,7 +30,8 @@ class BufferFilterTest : public testing::Test {
 public:
   BufferFilterTest()
       : config_{new BufferFilterConfig{BufferFilter::generateStats("", store_), 1024 * 1024,
-                                       std::chrono::seconds(0)}},
+                                       std::chrono::seconds(0), 0,
+                                       TestEnvironment::temporaryDirectory(), 0, {}}},
         filter_(config_) {
     filter_.setDecoderFilterCallbacks(callbacks_);
   }
@@ -86,19 +89,114 @@ TEST_F(BufferFilterTest, RequestTooLarge) {
   TestHeaderMapImpl headers;
   EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_.decodeHeaders(headers, false));
 
-  Buffer::InstancePtr buffered_data(new Buffer::OwnedImpl("buffered"));
-  ON_CALL(callbacks_, decodingBuffer()).WillByDefault(Return(buffered_data.get()));
-
   Buffer::OwnedImpl data1("hello");
   config_->max_request_bytes_ = 1;
   TestHeaderMapImpl response_headers{{":status", "413"}};
   EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), true));
-  EXPECT_EQ(FilterDataStatus::StopIterationAndBuffer, filter_.decodeData(data1, false));
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_.decodeData(data1, false));
 
   filter_.onDestroy();
   EXPECT_EQ(1U, config_->stats_.rq_too_large_.value());
 }
 
+// The body beyond the memory threshold is spilled and mapped back in at the end of the stream.
+TEST_F(BufferFilterTest, SpillToFile) {
+  InSequence s;
+
+  expectTimerCreate();
+  config_->max_request_memory_bytes_ = 5;
+
+  TestHeaderMapImpl headers;
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_.decodeHeaders(headers, false));
+
+  Buffer::OwnedImpl data1("hello");
+  EXPECT_EQ(FilterDataStatus::StopIterationAndBuffer, filter_.decodeData(data1, false));
+  EXPECT_EQ(5U, config_->total_memory_bytes_.load());
+
+  Buffer::OwnedImpl data2(" world");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_.decodeData(data2, false));
+  EXPECT_EQ(0U, data2.length());
+
+  Buffer::OwnedImpl data3("!");
+  EXPECT_EQ(FilterDataStatus::Continue, filter_.decodeData(data3, true));
+  EXPECT_EQ(" world!", TestUtility::bufferToString(data3));
+  EXPECT_EQ(0U, config_->total_memory_bytes_.load());
+  EXPECT_EQ(1U, config_->stats_.rq_spilled_.value());
+
+  filter_.onDestroy();
+}
+
+// With trailers, the spilled tail is added to the body ahead of them.
+TEST_F(BufferFilterTest, SpillToFileWithTrailers) {
+  InSequence s;
+
+  expectTimerCreate();
+  config_->max_request_memory_bytes_ = 1;
+
+  TestHeaderMapImpl headers;
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_.decodeHeaders(headers, false));
+
+  Buffer::OwnedImpl data1("hello");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_.decodeData(data1, false));
+
+  EXPECT_CALL(callbacks_, addDecodedData(_)).WillOnce(Invoke([](Buffer::Instance& data) -> void {
+    EXPECT_EQ("hello", TestUtility::bufferToString(data));
+  }));
+  TestHeaderMapImpl trailers;
+  EXPECT_EQ(FilterTrailersStatus::Continue, filter_.decodeTrailers(trailers));
+
+  filter_.onDestroy();
+}
+
+TEST_F(BufferFilterTest, SpillFailed) {
+  InSequence s;
+
+  expectTimerCreate();
+  config_->max_request_memory_bytes_ = 1;
+  config_->spill_directory_ = "/nonexistent/directory";
+
+  TestHeaderMapImpl headers;
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_.decodeHeaders(headers, false));
+
+  TestHeaderMapImpl response_headers{{":status", "503"}};
+  EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), true));
+  Buffer::OwnedImpl data1("hello");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter_.decodeData(data1, false));
+
+  filter_.onDestroy();
+  EXPECT_EQ(1U, config_->stats_.rq_spill_failed_.value());
+}
+
+// Without spilling, requests beyond the memory shared by the config are rejected.
+TEST_F(BufferFilterTest, MemoryExhausted) {
+  InSequence s;
+
+  expectTimerCreate();
+  config_->max_total_memory_bytes_ = 8;
+
+  TestHeaderMapImpl headers;
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter_.decodeHeaders(headers, false));
+  Buffer::OwnedImpl data1("hello");
+  EXPECT_EQ(FilterDataStatus::StopIterationAndBuffer, filter_.decodeData(data1, false));
+
+  NiceMock<MockStreamDecoderFilterCallbacks> callbacks2;
+  new NiceMock<Event::MockTimer>(&callbacks2.dispatcher_);
+  BufferFilter filter2(config_);
+  filter2.setDecoderFilterCallbacks(callbacks2);
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, filter2.decodeHeaders(headers, false));
+
+  TestHeaderMapImpl response_headers{{":status", "503"}};
+  EXPECT_CALL(callbacks2, encodeHeaders_(HeaderMapEqualRef(&response_headers), true));
+  Buffer::OwnedImpl data2("hello");
+  EXPECT_EQ(FilterDataStatus::StopIterationNoBuffer, filter2.decodeData(data2, false));
+  EXPECT_EQ(1U, config_->stats_.rq_memory_exhausted_.value());
+  filter2.onDestroy();
+
+  // The memory of a request is released once it is no longer buffered.
+  filter_.onDestroy();
+  EXPECT_EQ(0U, config_->total_memory_bytes_.load());
+}
+
 TEST_F(BufferFilterTest, TxResetAfterEndStream) {
   InSequence s;
 
@@ -0,0 +1,362 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/filter/cache_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_loader.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::ReturnPointee;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class CacheFilterTest : public testing::Test {
+public:
+  struct Stream {
+    Stream(CacheFilterConfigSharedPtr config, const std::string& path) : filter_(config) {
+      request_headers_.addCopy(":method", "GET");
+      request_headers_.addCopy(":authority", "host");
+      request_headers_.addCopy(":path", path);
+      filter_.setDecoderFilterCallbacks(decoder_callbacks_);
+      filter_.setEncoderFilterCallbacks(encoder_callbacks_);
+    }
+
+    ~Stream() { filter_.onDestroy(); }
+
+    FilterHeadersStatus request() { return filter_.decodeHeaders(request_headers_, true); }
+
+    void respond(TestHeaderMapImpl&& response_headers, const std::string& body) {
+      EXPECT_EQ(FilterHeadersStatus::Continue,
+                filter_.encodeHeaders(response_headers, body.empty()));
+      if (!body.empty()) {
+        Buffer::OwnedImpl data(body);
+        EXPECT_EQ(FilterDataStatus::Continue, filter_.encodeData(data, true));
+        EXPECT_EQ(body, TestUtility::bufferToString(data));
+      }
+    }
+
+    // Expect the request to be served from the cache.
+    void expectHit(const std::string& body, std::string* age = nullptr) {
+      EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, body.empty()))
+          .WillOnce(Invoke([age](HeaderMap& headers, bool) -> void {
+            EXPECT_STREQ("200", headers.Status()->value().c_str());
+            if (age != nullptr) {
+              *age = headers.get(Headers::get().Age)->value().c_str();
+            }
+          }));
+      if (!body.empty()) {
+        EXPECT_CALL(decoder_callbacks_, encodeData(_, true))
+            .WillOnce(Invoke([body](Buffer::Instance& data, bool) -> void {
+              EXPECT_EQ(body, TestUtility::bufferToString(data));
+            }));
+      }
+    }
+
+    NiceMock<MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+    NiceMock<MockStreamEncoderFilterCallbacks> encoder_callbacks_;
+    CacheFilter filter_;
+    TestHeaderMapImpl request_headers_;
+  };
+
+  CacheFilterTest() {
+    ON_CALL(time_source_, currentTime()).WillByDefault(ReturnPointee(&now_));
+    setUpConfig("{}");
+  }
+
+  void setUpConfig(const std::string& json) {
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    config_.reset(new CacheFilterConfig(*config, "test.", stats_, tls_, time_source_));
+  }
+
+  std::unique_ptr<Stream> stream(const std::string& path = "/") {
+    return std::unique_ptr<Stream>{new Stream(config_, path)};
+  }
+
+  // Fill the cache with a response for the path.
+  void fill(const std::string& path, TestHeaderMapImpl&& response_headers,
+            const std::string& body) {
+    std::unique_ptr<Stream> filler = stream(path);
+    EXPECT_EQ(FilterHeadersStatus::Continue, filler->request());
+    filler->respond(std::move(response_headers), body);
+  }
+
+  uint64_t counter(const std::string& name) {
+    return stats_.counter("test.cache." + name).value();
+  }
+
+  uint64_t gauge(const std::string& name) { return stats_.gauge("test.cache." + name).value(); }
+
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  MonotonicTime now_;
+  CacheFilterConfigSharedPtr config_;
+};
+
+TEST_F(CacheFilterTest, MissThenHit) {
+  fill("/", {{":status", "200"}, {"cache-control", "public, max-age=60"}}, "hello");
+  EXPECT_EQ(1U, counter("miss"));
+  EXPECT_EQ(1U, counter("insert"));
+  EXPECT_EQ(1U, gauge("entries"));
+
+  now_ += std::chrono::seconds(10);
+  std::unique_ptr<Stream> hit = stream();
+  std::string age;
+  hit->expectHit("hello", &age);
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, hit->request());
+  EXPECT_EQ("10", age);
+  EXPECT_EQ(1U, counter("hit"));
+
+  // Another path misses.
+  std::unique_ptr<Stream> other = stream("/other");
+  EXPECT_EQ(FilterHeadersStatus::Continue, other->request());
+  EXPECT_EQ(2U, counter("miss"));
+}
+
+// Hits share the cached body instead of copying it.
+TEST_F(CacheFilterTest, ZeroCopyBody) {
+  fill("/", {{":status", "200"}, {"cache-control", "max-age=60"}}, std::string(1024, 'a'));
+
+  const void* bodies[2];
+  for (const void*& body : bodies) {
+    std::unique_ptr<Stream> hit = stream();
+    EXPECT_CALL(hit->decoder_callbacks_, encodeData(_, true))
+        .WillOnce(Invoke([&body](Buffer::Instance& data, bool) -> void {
+          Buffer::RawSlice slice;
+          EXPECT_EQ(1U, data.getRawSlices(&slice, 1));
+          body = slice.mem_;
+        }));
+    EXPECT_EQ(FilterHeadersStatus::StopIteration, hit->request());
+  }
+  EXPECT_EQ(bodies[0], bodies[1]);
+}
+
+TEST_F(CacheFilterTest, Uncacheable) {
+  fill("/", {{":status", "200"}, {"cache-control", "no-store, max-age=60"}}, "hello");
+  fill("/", {{":status", "200"}, {"cache-control", "private, max-age=60"}}, "hello");
+  fill("/", {{":status", "200"}, {"cache-control", "max-age=60"}, {"set-cookie", "a=b"}},
+       "hello");
+  fill("/", {{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "*"}}, "hello");
+  fill("/", {{":status", "500"}, {"cache-control", "max-age=60"}}, "hello");
+  fill("/", {{":status", "200"}}, "hello");
+  EXPECT_EQ(0U, counter("insert"));
+
+  // Requests that are not cached do not use the cache at all.
+  fill("/", {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  std::unique_ptr<Stream> with_credentials = stream();
+  with_credentials->request_headers_.addCopy("authorization", "secret");
+  EXPECT_EQ(FilterHeadersStatus::Continue, with_credentials->request());
+  std::unique_ptr<Stream> post = stream();
+  post->request_headers_.Method()->value(std::string("POST"));
+  EXPECT_EQ(FilterHeadersStatus::Continue, post->request());
+  EXPECT_EQ(0U, counter("hit"));
+}
+
+TEST_F(CacheFilterTest, TooLarge) {
+  setUpConfig(R"EOF({"max_entry_bytes": 4})EOF");
+  fill("/", {{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  fill("/", {{":status", "200"}, {"cache-control", "max-age=60"}, {"content-length", "5"}},
+       "hello");
+  EXPECT_EQ(0U, counter("insert"));
+}
+
+TEST_F(CacheFilterTest, Vary) {
+  std::unique_ptr<Stream> filler = stream();
+  filler->request_headers_.addCopy("accept-encoding", "gzip");
+  filler->request();
+  filler->respond(
+      {{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "Accept-Encoding"}},
+      "gzipped");
+
+  std::unique_ptr<Stream> other_variant = stream();
+  EXPECT_EQ(FilterHeadersStatus::Continue, other_variant->request());
+  other_variant->respond(
+      {{":status", "200"}, {"cache-control", "max-age=60"}, {"vary", "Accept-Encoding"}}, "plain");
+
+  std::unique_ptr<Stream> gzip_hit = stream();
+  gzip_hit->request_headers_.addCopy("accept-encoding", "gzip");
+  gzip_hit->expectHit("gzipped");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, gzip_hit->request());
+
+  std::unique_ptr<Stream> plain_hit = stream();
+  plain_hit->expectHit("plain");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, plain_hit->request());
+  EXPECT_EQ(2U, gauge("entries"));
+}
+
+TEST_F(CacheFilterTest, Revalidate) {
+  fill("/", {{":status", "200"}, {"cache-control", "max-age=10"}, {"etag", "\"v1\""}}, "hello");
+
+  now_ += std::chrono::seconds(20);
+  std::unique_ptr<Stream> stale = stream();
+  EXPECT_EQ(FilterHeadersStatus::Continue, stale->request());
+  EXPECT_EQ("\"v1\"", stale->request_headers_.get_("if-none-match"));
+
+  EXPECT_CALL(stale->encoder_callbacks_, addEncodedData(_))
+      .WillOnce(Invoke([](Buffer::Instance& data) -> void {
+        EXPECT_EQ("hello", TestUtility::bufferToString(data));
+      }));
+  TestHeaderMapImpl response_headers{{":status", "304"}, {"cache-control", "max-age=30"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, stale->filter_.encodeHeaders(response_headers, true));
+  EXPECT_EQ("200", response_headers.get_(":status"));
+  EXPECT_EQ("\"v1\"", response_headers.get_("etag"));
+  EXPECT_EQ("0", response_headers.get_("age"));
+  EXPECT_EQ(1U, counter("validated"));
+
+  // The revalidated entry is fresh for its new max-age.
+  now_ += std::chrono::seconds(20);
+  std::unique_ptr<Stream> hit = stream();
+  hit->expectHit("hello");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, hit->request());
+}
+
+// A changed response replaces the stale entry.
+TEST_F(CacheFilterTest, RevalidateChanged) {
+  fill("/", {{":status", "200"}, {"cache-control", "no-cache"}, {"etag", "\"v1\""}}, "hello");
+
+  std::unique_ptr<Stream> stale = stream();
+  EXPECT_EQ(FilterHeadersStatus::Continue, stale->request());
+  stale->respond({{":status", "200"}, {"cache-control", "max-age=30"}, {"etag", "\"v2\""}},
+                 "world");
+  EXPECT_EQ(1U, gauge("entries"));
+
+  std::unique_ptr<Stream> hit = stream();
+  hit->expectHit("world");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, hit->request());
+}
+
+// A client's own conditional request is passed through, and its 304 is not rewritten.
+TEST_F(CacheFilterTest, ClientConditionalRequest) {
+  fill("/", {{":status", "200"}, {"cache-control", "max-age=10"}, {"etag", "\"v1\""}}, "hello");
+
+  now_ += std::chrono::seconds(20);
+  std::unique_ptr<Stream> conditional = stream();
+  conditional->request_headers_.addCopy("if-none-match", "\"v0\"");
+  EXPECT_EQ(FilterHeadersStatus::Continue, conditional->request());
+  EXPECT_EQ("\"v0\"", conditional->request_headers_.get_("if-none-match"));
+
+  TestHeaderMapImpl response_headers{{":status", "304"}};
+  conditional->filter_.encodeHeaders(response_headers, true);
+  EXPECT_EQ("304", response_headers.get_(":status"));
+  EXPECT_EQ(0U, counter("validated"));
+}
+
+TEST_F(CacheFilterTest, Coalesce) {
+  std::unique_ptr<Stream> filler = stream();
+  EXPECT_EQ(FilterHeadersStatus::Continue, filler->request());
+
+  std::unique_ptr<Stream> waiter1 = stream();
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, waiter1->request());
+  std::unique_ptr<Stream> waiter2 = stream();
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, waiter2->request());
+  EXPECT_EQ(2U, counter("coalesced"));
+
+  // A waiter that goes away is not called back.
+  EXPECT_CALL(waiter2->decoder_callbacks_, encodeHeaders_(_, _)).Times(0);
+  waiter2.reset();
+
+  waiter1->expectHit("hello");
+  filler->respond({{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(1U, counter("hit"));
+  EXPECT_EQ(1U, counter("miss"));
+}
+
+// Waiters go upstream themselves when the fill does not cache a response.
+TEST_F(CacheFilterTest, CoalesceUncacheable) {
+  std::unique_ptr<Stream> filler = stream();
+  EXPECT_EQ(FilterHeadersStatus::Continue, filler->request());
+  std::unique_ptr<Stream> waiter = stream();
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, waiter->request());
+
+  EXPECT_CALL(waiter->decoder_callbacks_, continueDecoding());
+  filler->respond({{":status", "200"}, {"cache-control", "no-store"}}, "hello");
+
+  // The waiter's own response is not stored.
+  waiter->respond({{":status", "200"}, {"cache-control", "max-age=60"}}, "hello");
+  EXPECT_EQ(0U, counter("insert"));
+}
+
+// Waiters go upstream themselves when the filling stream is reset.
+TEST_F(CacheFilterTest, CoalesceFillerReset) {
+  std::unique_ptr<Stream> filler = stream();
+  EXPECT_EQ(FilterHeadersStatus::Continue, filler->request());
+  std::unique_ptr<Stream> waiter = stream();
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, waiter->request());
+
+  EXPECT_CALL(waiter->decoder_callbacks_, continueDecoding());
+  filler.reset();
+
+  // The key is no longer being filled.
+  std::unique_ptr<Stream> next = stream();
+  EXPECT_EQ(FilterHeadersStatus::Continue, next->request());
+}
+
+TEST_F(CacheFilterTest, Trailers) {
+  std::unique_ptr<Stream> filler = stream();
+  filler->request();
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"cache-control", "max-age=60"}};
+  filler->filter_.encodeHeaders(response_headers, false);
+  Buffer::OwnedImpl data("hello");
+  filler->filter_.encodeData(data, false);
+  TestHeaderMapImpl response_trailers{{"grpc-status", "0"}};
+  EXPECT_EQ(FilterTrailersStatus::Continue, filler->filter_.encodeTrailers(response_trailers));
+  EXPECT_EQ(0U, counter("insert"));
+}
+
+TEST_F(CacheFilterTest, Eviction) {
+  setUpConfig(R"EOF({"max_bytes_per_worker": 2048})EOF");
+  fill("/a", {{":status", "200"}, {"cache-control", "max-age=60"}}, std::string(800, 'a'));
+  fill("/b", {{":status", "200"}, {"cache-control", "max-age=60"}}, std::string(800, 'b'));
+
+  // Using /a makes /b the least recently used entry.
+  std::unique_ptr<Stream> hit = stream("/a");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, hit->request());
+
+  fill("/c", {{":status", "200"}, {"cache-control", "max-age=60"}}, std::string(800, 'c'));
+  EXPECT_EQ(1U, counter("eviction"));
+  EXPECT_EQ(2U, gauge("entries"));
+  EXPECT_GE(2048U, gauge("bytes"));
+
+  std::unique_ptr<Stream> evicted = stream("/b");
+  EXPECT_EQ(FilterHeadersStatus::Continue, evicted->request());
+  std::unique_ptr<Stream> kept = stream("/a");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, kept->request());
+}
+
+TEST(CacheControlDirectivesTest, Parse) {
+  EXPECT_FALSE(CacheControlDirectives::parse(nullptr).max_age_.valid());
+
+  TestHeaderMapImpl headers{
+      {"cache-control", "No-Cache, private , max-age=\"60\", s-maxage=30, unknown=1"}};
+  CacheControlDirectives directives =
+      CacheControlDirectives::parse(headers.get(Headers::get().CacheControl));
+  EXPECT_TRUE(directives.no_cache_);
+  EXPECT_TRUE(directives.private_);
+  EXPECT_FALSE(directives.no_store_);
+  EXPECT_EQ(std::chrono::seconds(30), directives.max_age_.value());
+}
+
+TEST(CacheFilterConfigTest, BadConfig) {
+  Stats::IsolatedStoreImpl stats;
+  NiceMock<ThreadLocal::MockInstance> tls;
+  NiceMock<MockMonotonicTimeSource> time_source;
+  Json::ObjectSharedPtr config = Json::Factory::loadFromString(R"EOF({"max_bytes": 10})EOF");
+  EXPECT_THROW(CacheFilterConfig(*config, "test.", stats, tls, time_source), Json::Exception);
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -0,0 +1,250 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/filter/collapse_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_loader.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/router/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class CollapseFilterTest : public testing::Test {
+public:
+  struct Stream {
+    Stream(CollapseFilterConfigSharedPtr config, const std::string& method = "GET")
+        : filter_(config) {
+      request_headers_.addCopy(":method", method);
+      request_headers_.addCopy(":authority", "host");
+      request_headers_.addCopy(":path", "/");
+      decoder_callbacks_.route_->route_entry_.opaque_config_.insert(
+          {CollapseFilterConfig::ROUTE_OPT_IN_KEY, "true"});
+      filter_.setDecoderFilterCallbacks(decoder_callbacks_);
+    }
+
+    ~Stream() { filter_.onDestroy(); }
+
+    FilterHeadersStatus request() { return filter_.decodeHeaders(request_headers_, true); }
+
+    // Request as a follower, which waits for its leader.
+    void follow() {
+      timer_ = new NiceMock<Event::MockTimer>(&decoder_callbacks_.dispatcher_);
+      EXPECT_EQ(FilterHeadersStatus::StopIteration, request());
+    }
+
+    void expectResponse(const std::string& body) {
+      EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, false))
+          .WillOnce(Invoke([](HeaderMap& headers, bool) -> void {
+            EXPECT_STREQ("200", headers.Status()->value().c_str());
+          }));
+      EXPECT_CALL(decoder_callbacks_, encodeData(_, true))
+          .WillOnce(Invoke([body](Buffer::Instance& data, bool) -> void {
+            EXPECT_EQ(body, TestUtility::bufferToString(data));
+          }));
+    }
+
+    void respond(const std::string& body) {
+      TestHeaderMapImpl response_headers{{":status", "200"}};
+      EXPECT_EQ(FilterHeadersStatus::Continue, filter_.encodeHeaders(response_headers, false));
+      Buffer::OwnedImpl data(body);
+      EXPECT_EQ(FilterDataStatus::Continue, filter_.encodeData(data, true));
+      EXPECT_EQ(body, TestUtility::bufferToString(data));
+    }
+
+    NiceMock<MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+    CollapseFilter filter_;
+    TestHeaderMapImpl request_headers_;
+    Event::MockTimer* timer_{};
+  };
+
+  CollapseFilterTest() { setUpConfig("{}"); }
+
+  void setUpConfig(const std::string& json) {
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    config_.reset(new CollapseFilterConfig(*config, "test.", stats_, tls_));
+  }
+
+  uint64_t counter(const std::string& name) {
+    return stats_.counter("test.collapse." + name).value();
+  }
+
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  CollapseFilterConfigSharedPtr config_;
+};
+
+TEST_F(CollapseFilterTest, Collapse) {
+  Stream leader(config_);
+  EXPECT_EQ(FilterHeadersStatus::Continue, leader.request());
+  Stream follower1(config_);
+  follower1.follow();
+  Stream follower2(config_);
+  follower2.follow();
+  EXPECT_EQ(2U, counter("collapsed"));
+
+  follower1.expectResponse("body");
+  follower2.expectResponse("body");
+  leader.respond("body");
+}
+
+TEST_F(CollapseFilterTest, CollapseWithTrailers) {
+  Stream leader(config_);
+  leader.request();
+  Stream follower(config_);
+  follower.follow();
+
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  EXPECT_CALL(follower.decoder_callbacks_, encodeHeaders_(_, false));
+  leader.filter_.encodeHeaders(response_headers, false);
+  Buffer::OwnedImpl data("body");
+  EXPECT_CALL(follower.decoder_callbacks_, encodeData(_, false));
+  leader.filter_.encodeData(data, false);
+  TestHeaderMapImpl response_trailers{{"grpc-status", "0"}};
+  EXPECT_CALL(follower.decoder_callbacks_, encodeTrailers_(_))
+      .WillOnce(Invoke([](HeaderMap& trailers) -> void {
+        EXPECT_STREQ("0", trailers.get(LowerCaseString("grpc-status"))->value().c_str());
+      }));
+  leader.filter_.encodeTrailers(response_trailers);
+}
+
+TEST_F(CollapseFilterTest, NotCollapsed) {
+  // Routes must opt in.
+  {
+    Stream leader(config_);
+    leader.decoder_callbacks_.route_->route_entry_.opaque_config_.clear();
+    EXPECT_EQ(FilterHeadersStatus::Continue, leader.request());
+    Stream other(config_);
+    other.decoder_callbacks_.route_->route_entry_.opaque_config_.clear();
+    EXPECT_EQ(FilterHeadersStatus::Continue, other.request());
+  }
+
+  // Only requests without a body are collapsed.
+  {
+    Stream leader(config_, "POST");
+    EXPECT_EQ(FilterHeadersStatus::Continue, leader.request());
+    Stream other(config_, "POST");
+    EXPECT_EQ(FilterHeadersStatus::Continue, other.request());
+    Stream get(config_);
+    EXPECT_EQ(FilterHeadersStatus::Continue,
+              get.filter_.decodeHeaders(get.request_headers_, false));
+    Stream other_get(config_);
+    EXPECT_EQ(FilterHeadersStatus::Continue,
+              other_get.filter_.decodeHeaders(other_get.request_headers_, false));
+  }
+
+  EXPECT_EQ(0U, counter("collapsed"));
+}
+
+TEST_F(CollapseFilterTest, KeyHeaders) {
+  setUpConfig(R"EOF({"headers": ["accept"]})EOF");
+  Stream leader(config_);
+  leader.request_headers_.addCopy("accept", "text/html");
+  EXPECT_EQ(FilterHeadersStatus::Continue, leader.request());
+  Stream other(config_);
+  other.request_headers_.addCopy("accept", "application/json");
+  EXPECT_EQ(FilterHeadersStatus::Continue, other.request());
+  Stream absent(config_);
+  EXPECT_EQ(FilterHeadersStatus::Continue, absent.request());
+  Stream follower(config_);
+  follower.request_headers_.addCopy("accept", "text/html");
+  follower.follow();
+}
+
+// A request that arrives once the response has started goes upstream itself.
+TEST_F(CollapseFilterTest, LateRequest) {
+  Stream leader(config_);
+  leader.request();
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  leader.filter_.encodeHeaders(response_headers, false);
+
+  Stream late(config_);
+  EXPECT_EQ(FilterHeadersStatus::Continue, late.request());
+  EXPECT_CALL(late.decoder_callbacks_, encodeData(_, _)).Times(0);
+  Buffer::OwnedImpl data("body");
+  leader.filter_.encodeData(data, true);
+}
+
+TEST_F(CollapseFilterTest, WaitTimeout) {
+  setUpConfig(R"EOF({"max_wait_ms": 50})EOF");
+  Stream leader(config_);
+  leader.request();
+  Stream follower(config_);
+  follower.timer_ = new NiceMock<Event::MockTimer>(&follower.decoder_callbacks_.dispatcher_);
+  EXPECT_CALL(*follower.timer_, enableTimer(std::chrono::milliseconds(50)));
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, follower.request());
+
+  EXPECT_CALL(follower.decoder_callbacks_, continueDecoding());
+  follower.timer_->callback_();
+  EXPECT_EQ(1U, counter("wait_timeout"));
+
+  EXPECT_CALL(follower.decoder_callbacks_, encodeHeaders_(_, _)).Times(0);
+  leader.respond("body");
+}
+
+TEST_F(CollapseFilterTest, FollowerReset) {
+  Stream leader(config_);
+  leader.request();
+  Stream follower(config_);
+  follower.follow();
+  follower.filter_.onDestroy();
+
+  EXPECT_CALL(follower.decoder_callbacks_, encodeHeaders_(_, _)).Times(0);
+  leader.respond("body");
+}
+
+// The longest waiting follower goes upstream in place of a leader that is reset before its
+// response, and the other followers follow it.
+TEST_F(CollapseFilterTest, LeaderResetBeforeResponse) {
+  std::unique_ptr<Stream> leader(new Stream(config_));
+  leader->request();
+  Stream follower1(config_);
+  follower1.follow();
+  Stream follower2(config_);
+  follower2.follow();
+
+  EXPECT_CALL(follower1.decoder_callbacks_, continueDecoding());
+  leader.reset();
+
+  follower2.expectResponse("body");
+  follower1.respond("body");
+  EXPECT_EQ(0U, counter("leader_reset"));
+}
+
+TEST_F(CollapseFilterTest, LeaderResetDuringResponse) {
+  std::unique_ptr<Stream> leader(new Stream(config_));
+  leader->request();
+  Stream follower(config_);
+  follower.follow();
+
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  EXPECT_CALL(follower.decoder_callbacks_, encodeHeaders_(_, false));
+  leader->filter_.encodeHeaders(response_headers, false);
+
+  EXPECT_CALL(follower.decoder_callbacks_, resetStream());
+  leader.reset();
+  EXPECT_EQ(1U, counter("leader_reset"));
+}
+
+TEST(CollapseFilterConfigTest, BadConfig) {
+  Stats::IsolatedStoreImpl stats;
+  NiceMock<ThreadLocal::MockInstance> tls;
+  Json::ObjectSharedPtr config = Json::Factory::loadFromString(R"EOF({"max_wait_ms": -1})EOF");
+  EXPECT_THROW(CollapseFilterConfig(*config, "test.", stats, tls), Json::Exception);
+}
+
+} // namespace Http
+} // namespace Envoy
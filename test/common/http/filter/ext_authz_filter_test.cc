@@ -0,0 +1,277 @@
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "common/http/filter/ext_authz_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/http/message_impl.h"
+#include "common/json/json_loader.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::ReturnPointee;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class ExtAuthzFilterTest : public testing::Test {
+public:
+  struct Stream {
+    Stream(ExtAuthzFilterConfigSharedPtr config, const std::string& user = "alice")
+        : filter_(config) {
+      request_headers_.addCopy(":method", "GET");
+      request_headers_.addCopy(":authority", "host");
+      request_headers_.addCopy(":path", "/resource");
+      request_headers_.addCopy("x-user", user);
+      filter_.setDecoderFilterCallbacks(decoder_callbacks_);
+    }
+
+    ~Stream() { filter_.onDestroy(); }
+
+    FilterHeadersStatus request() { return filter_.decodeHeaders(request_headers_, true); }
+
+    void expectDenied(const std::string& code) {
+      EXPECT_CALL(decoder_callbacks_, encodeHeaders_(_, true))
+          .WillOnce(Invoke([code](HeaderMap& headers, bool) -> void {
+            EXPECT_STREQ(code.c_str(), headers.Status()->value().c_str());
+          }));
+    }
+
+    NiceMock<MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+    ExtAuthzFilter filter_;
+    TestHeaderMapImpl request_headers_;
+  };
+
+  ExtAuthzFilterTest() {
+    ON_CALL(time_source_, currentTime()).WillByDefault(ReturnPointee(&now_));
+    setUpConfig(cached_json_);
+  }
+
+  void setUpConfig(const std::string& json) {
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    config_.reset(new ExtAuthzFilterConfig(*config, "test.", stats_, tls_, cm_, time_source_));
+  }
+
+  // Expect a check, whose callbacks are kept in callbacks_.
+  void expectCheck() {
+    EXPECT_CALL(cm_.async_client_, send_(_, _, _))
+        .WillOnce(Invoke([this](MessagePtr& message, AsyncClient::Callbacks& callbacks,
+                                const Optional<std::chrono::milliseconds>& timeout)
+                             -> AsyncClient::Request* {
+          EXPECT_STREQ("GET", message->headers().Method()->value().c_str());
+          EXPECT_STREQ("/authz/resource", message->headers().Path()->value().c_str());
+          EXPECT_STREQ("host", message->headers().Host()->value().c_str());
+          EXPECT_NE(nullptr, message->headers().get(LowerCaseString("x-user")));
+          EXPECT_EQ(std::chrono::milliseconds(100), timeout.value());
+          callbacks_ = &callbacks;
+          return &request_;
+        }));
+  }
+
+  void respond(const std::string& code) {
+    MessagePtr response(new ResponseMessageImpl(HeaderMapPtr{new TestHeaderMapImpl{
+        {":status", code}}}));
+    callbacks_->onSuccess(std::move(response));
+  }
+
+  uint64_t counter(const std::string& name) {
+    return stats_.counter("test.ext_authz." + name).value();
+  }
+
+  const std::string cached_json_ = R"EOF(
+    {
+      "cluster": "authz",
+      "timeout_ms": 100,
+      "path_prefix": "/authz",
+      "headers": ["x-user"],
+      "cache": {
+        "key_headers": ["x-user"],
+        "allow_ttl_ms": 1000,
+        "deny_ttl_ms": 500,
+        "max_entries_per_worker": 2
+      }
+    }
+  )EOF";
+
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<Upstream::MockClusterManager> cm_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  MonotonicTime now_;
+  ExtAuthzFilterConfigSharedPtr config_;
+  AsyncClient::Callbacks* callbacks_{};
+  NiceMock<MockAsyncClientRequest> request_{&cm_.async_client_};
+};
+
+// Validate that allowed requests continue, and that the decision is cached until it expires.
+TEST_F(ExtAuthzFilterTest, AllowedAndCached) {
+  {
+    Stream stream(config_);
+    expectCheck();
+    EXPECT_EQ(FilterHeadersStatus::StopIteration, stream.request());
+    EXPECT_CALL(stream.decoder_callbacks_, continueDecoding());
+    respond("200");
+  }
+  EXPECT_EQ(1U, counter("ok"));
+  EXPECT_EQ(1U, counter("cache_miss"));
+
+  {
+    Stream stream(config_);
+    EXPECT_CALL(cm_.async_client_, send_(_, _, _)).Times(0);
+    EXPECT_EQ(FilterHeadersStatus::Continue, stream.request());
+  }
+  EXPECT_EQ(1U, counter("cache_hit"));
+
+  now_ += std::chrono::milliseconds(1000);
+  Stream stream(config_);
+  expectCheck();
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, stream.request());
+  EXPECT_EQ(2U, counter("cache_miss"));
+}
+
+// Validate that denied requests are sent the code of the service, and that denials are cached.
+TEST_F(ExtAuthzFilterTest, DeniedAndCached) {
+  {
+    Stream stream(config_);
+    expectCheck();
+    EXPECT_EQ(FilterHeadersStatus::StopIteration, stream.request());
+    stream.expectDenied("401");
+    respond("401");
+  }
+  EXPECT_EQ(1U, counter("denied"));
+
+  Stream stream(config_);
+  stream.expectDenied("401");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, stream.request());
+  EXPECT_EQ(1U, counter("cache_hit"));
+}
+
+// Validate that errors deny requests with 403, and are not cached.
+TEST_F(ExtAuthzFilterTest, ErrorNotCached) {
+  {
+    Stream stream(config_);
+    expectCheck();
+    EXPECT_EQ(FilterHeadersStatus::StopIteration, stream.request());
+    stream.expectDenied("403");
+    respond("503");
+  }
+  {
+    Stream stream(config_);
+    expectCheck();
+    EXPECT_EQ(FilterHeadersStatus::StopIteration, stream.request());
+    stream.expectDenied("403");
+    callbacks_->onFailure(AsyncClient::FailureReason::Reset);
+  }
+  EXPECT_EQ(2U, counter("error"));
+  EXPECT_EQ(0U, counter("cache_hit"));
+}
+
+// Validate that failure_mode_allow lets requests through when the service fails.
+TEST_F(ExtAuthzFilterTest, FailureModeAllow) {
+  setUpConfig(R"EOF({"cluster": "authz", "failure_mode_allow": true})EOF");
+  Stream stream(config_);
+  EXPECT_CALL(cm_.async_client_, send_(_, _, _))
+      .WillOnce(Invoke([](MessagePtr&, AsyncClient::Callbacks& callbacks,
+                          const Optional<std::chrono::milliseconds>&) -> AsyncClient::Request* {
+        callbacks.onFailure(AsyncClient::FailureReason::Reset);
+        return nullptr;
+      }));
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream.request());
+  EXPECT_EQ(1U, counter("failure_mode_allowed"));
+}
+
+// Validate that a missing cluster is an error.
+TEST_F(ExtAuthzFilterTest, MissingCluster) {
+  EXPECT_CALL(cm_, get("authz")).WillOnce(Return(nullptr));
+  Stream stream(config_);
+  stream.expectDenied("403");
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, stream.request());
+  EXPECT_EQ(1U, counter("error"));
+}
+
+// Validate that requests with the key of a check in flight wait for its decision, and that the
+// check is only cancelled when no request waits for it.
+TEST_F(ExtAuthzFilterTest, Coalesced) {
+  Stream first(config_);
+  std::unique_ptr<Stream> second(new Stream(config_));
+  Stream other(config_, "bob");
+
+  expectCheck();
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, first.request());
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, second->request());
+  EXPECT_EQ(1U, counter("coalesced"));
+
+  // Other keys are checked on their own.
+  AsyncClient::Callbacks* first_callbacks = callbacks_;
+  expectCheck();
+  EXPECT_EQ(FilterHeadersStatus::StopIteration, other.request());
+
+  EXPECT_CALL(request_, cancel()).Times(0);
+  second.reset();
+  callbacks_ = first_callbacks;
+  EXPECT_CALL(first.decoder_callbacks_, continueDecoding());
+  respond("200");
+
+  EXPECT_CALL(request_, cancel());
+}
+
+// Validate that the least recently used decisions are evicted.
+TEST_F(ExtAuthzFilterTest, Eviction) {
+  for (const std::string user : {"a", "b", "c"}) {
+    Stream stream(config_, user);
+    EXPECT_CALL(cm_.async_client_, send_(_, _, _))
+        .WillOnce(Invoke([this](MessagePtr&, AsyncClient::Callbacks& callbacks,
+                                const Optional<std::chrono::milliseconds>&)
+                             -> AsyncClient::Request* {
+          callbacks_ = &callbacks;
+          return &request_;
+        }));
+    stream.request();
+    respond("200");
+  }
+  EXPECT_EQ(1U, counter("cache_eviction"));
+  EXPECT_EQ(2U, stats_.gauge("test.ext_authz.cache_entries").value());
+
+  Stream stream(config_, "c");
+  EXPECT_EQ(FilterHeadersStatus::Continue, stream.request());
+}
+
+// Validate that requests are neither cached nor coalesced without a cache.
+TEST_F(ExtAuthzFilterTest, NoCache) {
+  setUpConfig(R"EOF({"cluster": "authz"})EOF");
+  for (int i = 0; i < 2; i++) {
+    Stream stream(config_);
+    EXPECT_CALL(cm_.async_client_, send_(_, _, _))
+        .WillOnce(Invoke([this](MessagePtr&, AsyncClient::Callbacks& callbacks,
+                                const Optional<std::chrono::milliseconds>&)
+                             -> AsyncClient::Request* {
+          callbacks_ = &callbacks;
+          return &request_;
+        }));
+    EXPECT_EQ(FilterHeadersStatus::StopIteration, stream.request());
+    EXPECT_CALL(stream.decoder_callbacks_, continueDecoding());
+    respond("200");
+  }
+  EXPECT_EQ(0U, counter("cache_hit"));
+  EXPECT_EQ(0U, counter("cache_miss"));
+}
+
+TEST_F(ExtAuthzFilterTest, BadConfig) {
+  EXPECT_THROW(setUpConfig(R"EOF({"timeout_ms": 100})EOF"), Json::Exception);
+  EXPECT_THROW(setUpConfig(R"EOF({"cluster": "authz", "cache": {}})EOF"), Json::Exception);
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -595,6 +595,43 @@ TEST_F(FaultFilterTest, FixedDelayAndAbortHeaderMatchFail) {
   EXPECT_EQ(0UL, config_->stats().aborts_injected_.value());
 }
 
+TEST_F(FaultFilterTest, ZeroPercentSkipsMatching) {
+  SetUpTest(fault_with_target_cluster_json);
+  request_headers_.addCopy("x-envoy-downstream-service-cluster", "cluster");
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("fault.http.delay.fixed_delay_percent", 100))
+      .WillOnce(Return(0UL));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("fault.http.cluster.delay.fixed_delay_percent", 100))
+      .WillOnce(Return(0UL));
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled(_, _)).Times(0);
+  EXPECT_CALL(filter_callbacks_, route()).Times(0);
+
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data_, false));
+  EXPECT_EQ(0UL, config_->stats().delays_injected_.value());
+}
+
+TEST_F(FaultFilterTest, DownstreamClusterPercentOnly) {
+  SetUpTest(fixed_delay_only_json);
+  request_headers_.addCopy("x-envoy-downstream-service-cluster", "cluster");
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("fault.http.delay.fixed_delay_percent", 100))
+      .WillOnce(Return(0UL));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("fault.http.cluster.delay.fixed_delay_percent", 100))
+      .WillOnce(Return(50UL));
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("fault.http.delay.fixed_delay_percent", 100))
+      .WillOnce(Return(false));
+  EXPECT_CALL(runtime_.snapshot_,
+              featureEnabled("fault.http.cluster.delay.fixed_delay_percent", 100))
+      .WillOnce(Return(false));
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("fault.http.abort.abort_percent", 0))
+      .WillOnce(Return(false));
+  EXPECT_CALL(runtime_.snapshot_, featureEnabled("fault.http.cluster.abort.abort_percent", 0))
+      .WillOnce(Return(false));
+
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+}
+
 TEST_F(FaultFilterTest, TimerResetAfterStreamReset) {
   SetUpTest(fixed_delay_only_json);
 
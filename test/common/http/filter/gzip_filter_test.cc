@@ -0,0 +1,192 @@
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/filter/gzip_filter.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_loader.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zlib.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::_;
+
+namespace Envoy {
+namespace Http {
+
+class GzipFilterTest : public testing::Test {
+public:
+  GzipFilterTest() { setUpFilter("{}"); }
+
+  ~GzipFilterTest() { filter_->onDestroy(); }
+
+  void setUpFilter(const std::string& json) {
+    if (filter_) {
+      filter_->onDestroy();
+    }
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    config_.reset(new GzipFilterConfig(*config, "test.", stats_, tls_));
+    filter_.reset(new GzipFilter(config_));
+    filter_->setEncoderFilterCallbacks(encoder_callbacks_);
+  }
+
+  // Inflate the gzip stream, which must be complete.
+  std::string decompress(const std::string& compressed) {
+    z_stream zstream{};
+    EXPECT_EQ(Z_OK, inflateInit2(&zstream, 15 + 16));
+    std::vector<unsigned char> input(compressed.begin(), compressed.end());
+    std::vector<char> output(64 * 1024);
+    zstream.next_in = input.data();
+    zstream.avail_in = input.size();
+    zstream.next_out = reinterpret_cast<Bytef*>(output.data());
+    zstream.avail_out = output.size();
+    EXPECT_EQ(Z_STREAM_END, inflate(&zstream, Z_FINISH));
+    std::string result(output.data(), zstream.total_out);
+    inflateEnd(&zstream);
+    return result;
+  }
+
+  void requestGzip() {
+    TestHeaderMapImpl request_headers{{"accept-encoding", "deflate, gzip"}};
+    EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers, false));
+  }
+
+  uint64_t counter(const std::string& name) {
+    return stats_.counter("test.gzip." + name).value();
+  }
+
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<MockStreamEncoderFilterCallbacks> encoder_callbacks_;
+  GzipFilterConfigSharedPtr config_;
+  std::unique_ptr<GzipFilter> filter_;
+};
+
+TEST_F(GzipFilterTest, AcceptsGzip) {
+  EXPECT_FALSE(GzipFilter::acceptsGzip(nullptr));
+
+  auto accepts = [](const std::string& value) -> bool {
+    TestHeaderMapImpl headers{{"accept-encoding", value}};
+    return GzipFilter::acceptsGzip(headers.get(Headers::get().AcceptEncoding));
+  };
+  EXPECT_TRUE(accepts("gzip"));
+  EXPECT_TRUE(accepts("br, GZIP;q=0.5"));
+  EXPECT_TRUE(accepts("*"));
+  EXPECT_FALSE(accepts("deflate"));
+  EXPECT_FALSE(accepts("gzip;q=0"));
+  EXPECT_FALSE(accepts("gzipped"));
+}
+
+// A streamed response is compressed frame by frame and each frame can be decompressed as it
+// arrives.
+TEST_F(GzipFilterTest, Compress) {
+  requestGzip();
+  TestHeaderMapImpl response_headers{{":status", "200"},
+                                     {"content-type", "text/html; charset=utf-8"},
+                                     {"content-length", "4096"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->encodeHeaders(response_headers, false));
+  EXPECT_FALSE(response_headers.has("content-length"));
+  EXPECT_EQ("gzip", response_headers.get_("content-encoding"));
+  EXPECT_EQ("Accept-Encoding", response_headers.get_("vary"));
+
+  const std::string first(2048, 'a');
+  const std::string second(2048, 'b');
+  Buffer::OwnedImpl data1(first);
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->encodeData(data1, false));
+  Buffer::OwnedImpl data2(second);
+  EXPECT_EQ(FilterDataStatus::Continue, filter_->encodeData(data2, true));
+
+  const std::string compressed = TestUtility::bufferToString(data1) +
+                                 TestUtility::bufferToString(data2);
+  EXPECT_EQ(first + second, decompress(compressed));
+  EXPECT_EQ(1U, counter("compressed"));
+  EXPECT_EQ(4096U, counter("total_uncompressed_bytes"));
+  EXPECT_EQ(compressed.size(), counter("total_compressed_bytes"));
+  EXPECT_GT(4096U, compressed.size());
+}
+
+// The gzip trailer is added ahead of response trailers.
+TEST_F(GzipFilterTest, CompressWithTrailers) {
+  requestGzip();
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "application/json"}};
+  filter_->encodeHeaders(response_headers, false);
+
+  const std::string body(100, 'a');
+  Buffer::OwnedImpl data(body);
+  filter_->encodeData(data, false);
+  std::string compressed = TestUtility::bufferToString(data);
+
+  EXPECT_CALL(encoder_callbacks_, addEncodedData(_))
+      .WillOnce(Invoke([&compressed](Buffer::Instance& trailer) -> void {
+        compressed += TestUtility::bufferToString(trailer);
+      }));
+  TestHeaderMapImpl response_trailers{{"grpc-status", "0"}};
+  EXPECT_EQ(FilterTrailersStatus::Continue, filter_->encodeTrailers(response_trailers));
+  EXPECT_EQ(body, decompress(compressed));
+}
+
+// Compressors return to the pool and are reset for the next response.
+TEST_F(GzipFilterTest, ReuseCompressor) {
+  for (int i = 0; i < 2; i++) {
+    setUpFilter("{}");
+    requestGzip();
+    TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/plain"}};
+    filter_->encodeHeaders(response_headers, false);
+    Buffer::OwnedImpl data("hello world, hello world, hello world");
+    filter_->encodeData(data, true);
+    EXPECT_EQ("hello world, hello world, hello world",
+              decompress(TestUtility::bufferToString(data)));
+  }
+}
+
+TEST_F(GzipFilterTest, NotCompressed) {
+  auto expectNotCompressed = [this](TestHeaderMapImpl&& response_headers) -> void {
+    setUpFilter(R"EOF({"min_content_length": 100, "content_types": ["text/plain"]})EOF");
+    requestGzip();
+    filter_->encodeHeaders(response_headers, false);
+    EXPECT_FALSE(response_headers.has("content-encoding"));
+    Buffer::OwnedImpl data("hello");
+    filter_->encodeData(data, true);
+    EXPECT_EQ("hello", TestUtility::bufferToString(data));
+  };
+
+  expectNotCompressed({{":status", "200"}, {"content-type", "text/html"}});
+  expectNotCompressed(
+      {{":status", "200"}, {"content-type", "text/plain"}, {"content-length", "5"}});
+  expectNotCompressed(
+      {{":status", "200"}, {"content-type", "text/plain"}, {"cache-control", "no-transform"}});
+  expectNotCompressed({{":status", "200"},
+                       {"content-type", "text/plain"},
+                       {"content-encoding", "br"},
+                       {"content-length", "500"}});
+  EXPECT_EQ(4U, counter("not_compressed"));
+  EXPECT_EQ(0U, counter("compressed"));
+}
+
+TEST_F(GzipFilterTest, NotAccepted) {
+  TestHeaderMapImpl request_headers{{"accept-encoding", "identity"}};
+  filter_->decodeHeaders(request_headers, false);
+  TestHeaderMapImpl response_headers{{":status", "200"}, {"content-type", "text/plain"}};
+  filter_->encodeHeaders(response_headers, false);
+  EXPECT_FALSE(response_headers.has("content-encoding"));
+  EXPECT_EQ(0U, counter("not_compressed"));
+}
+
+TEST(GzipFilterConfigTest, BadConfig) {
+  Stats::IsolatedStoreImpl stats;
+  NiceMock<ThreadLocal::MockInstance> tls;
+  Json::ObjectSharedPtr config =
+      Json::Factory::loadFromString(R"EOF({"compression_level": 10})EOF");
+  EXPECT_THROW(GzipFilterConfig(*config, "test.", stats, tls), Json::Exception);
+}
+
+} // namespace Http
+} // namespace Envoy
@@ -2,14 +2,22 @@
 #include "common/http/filter/ip_tagging_filter.h"
 #include "common/http/header_map_impl.h"
 #include "common/http/headers.h"
+#include "common/stats/stats_impl.h"
 
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/filesystem/mocks.h"
 #include "test/mocks/http/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/environment.h"
 #include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "spdlog/spdlog.h"
 
+using testing::NiceMock;
 using testing::Return;
+using testing::SaveArg;
 using testing::_;
 
 namespace Envoy {
@@ -55,11 +63,21 @@ public:
 
   void SetUpTest(const std::string json) {
     Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
-    config_.reset(new IpTaggingFilterConfig(*config));
+    config_.reset(new IpTaggingFilterConfig(*config, "prefix.", stats_, tls_, dispatcher_));
     filter_.reset(new IpTaggingFilter(config_));
     filter_->setDecoderFilterCallbacks(filter_callbacks_);
+    filter_callbacks_.downstream_address_ = "1.2.3.4";
   }
 
+  std::string ipTags() {
+    return request_headers_.has(Headers::get().EnvoyIpTags)
+               ? request_headers_.get_(Headers::get().EnvoyIpTags)
+               : "";
+  }
+
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<Event::MockDispatcher> dispatcher_;
   IpTaggingFilterConfigSharedPtr config_;
   std::unique_ptr<IpTaggingFilter> filter_;
   NiceMock<MockStreamDecoderFilterCallbacks> filter_callbacks_;
@@ -70,9 +88,17 @@ public:
 TEST_F(IpTaggingFilterTest, InternalRequest) {
   SetUpTest(internal_request_json);
 
+  request_headers_.addCopy(Headers::get().EnvoyInternalRequest, "true");
   EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
   EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data_, false));
   EXPECT_EQ(FilterTrailersStatus::Continue, filter_->decodeTrailers(request_headers_));
+  EXPECT_EQ("test_internal", ipTags());
+  EXPECT_EQ(1U, stats_.counter("prefix.ip_tagging.hit").value());
+
+  // External requests are left alone.
+  TestHeaderMapImpl external_headers;
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(external_headers, false));
+  EXPECT_FALSE(external_headers.has(Headers::get().EnvoyIpTags));
 }
 
 TEST_F(IpTaggingFilterTest, ExternalRequest) {
@@ -81,6 +107,12 @@ TEST_F(IpTaggingFilterTest, ExternalRequest) {
   EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
   EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data_, false));
   EXPECT_EQ(FilterTrailersStatus::Continue, filter_->decodeTrailers(request_headers_));
+  EXPECT_EQ("test_external", ipTags());
+
+  // Internal requests are left alone.
+  TestHeaderMapImpl internal_headers{{"x-envoy-internal", "true"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(internal_headers, false));
+  EXPECT_FALSE(internal_headers.has(Headers::get().EnvoyIpTags));
 }
 
 TEST_F(IpTaggingFilterTest, BothRequest) {
@@ -89,6 +121,129 @@ TEST_F(IpTaggingFilterTest, BothRequest) {
   EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
   EXPECT_EQ(FilterDataStatus::Continue, filter_->decodeData(data_, false));
   EXPECT_EQ(FilterTrailersStatus::Continue, filter_->decodeTrailers(request_headers_));
+  EXPECT_EQ("test_both", ipTags());
+
+  TestHeaderMapImpl internal_headers{{"x-envoy-internal", "true"}};
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(internal_headers, false));
+  EXPECT_EQ("test_both", internal_headers.get_(Headers::get().EnvoyIpTags));
+}
+
+TEST_F(IpTaggingFilterTest, NoHit) {
+  SetUpTest(both_request_json);
+  filter_callbacks_.downstream_address_ = "1.2.3.5";
+
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+  EXPECT_FALSE(request_headers_.has(Headers::get().EnvoyIpTags));
+  EXPECT_EQ(1U, stats_.counter("prefix.ip_tagging.no_hit").value());
+}
+
+TEST_F(IpTaggingFilterTest, NestedPrefixes) {
+  const std::string json = R"EOF(
+    {
+      "ip_tags" : [
+        {
+          "ip_tag_name" : "internal",
+          "ip_list" : ["10.0.0.0/8", "2001:db8::/32"]
+        },
+        {
+          "ip_tag_name" : "lab",
+          "ip_list" : ["10.1.0.0/16", "10.2.3.0/24", "2001:db8:1::/48"]
+        },
+        {
+          "ip_tag_name" : "blocked",
+          "ip_list" : ["10.1.2.3", "10.0.0.0/8"]
+        }
+      ]
+    }
+  )EOF";
+  SetUpTest(json);
+
+  const std::vector<std::pair<std::string, std::string>> cases = {
+      {"10.3.0.1", "internal,blocked"},      {"10.1.9.9", "internal,lab,blocked"},
+      {"10.1.2.3", "internal,lab,blocked"},  {"10.2.3.4", "internal,lab,blocked"},
+      {"11.0.0.1", ""},                      {"2001:db8::1", "internal"},
+      {"2001:db8:1::1", "internal,lab"},     {"2001:db9::1", ""},
+      {"not an address", ""},
+  };
+  for (const auto& test_case : cases) {
+    filter_callbacks_.downstream_address_ = test_case.first;
+    TestHeaderMapImpl headers;
+    EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(headers, false));
+    EXPECT_EQ(test_case.second, headers.has(Headers::get().EnvoyIpTags)
+                                    ? headers.get_(Headers::get().EnvoyIpTags)
+                                    : "")
+        << test_case.first;
+  }
+}
+
+TEST_F(IpTaggingFilterTest, InvalidPrefix) {
+  const std::string json = R"EOF(
+    {
+      "ip_tags" : [
+        {
+          "ip_tag_name" : "bad",
+          "ip_list" : ["10.0.0.0/33"]
+        }
+      ]
+    }
+  )EOF";
+  EXPECT_THROW_WITH_MESSAGE(SetUpTest(json), EnvoyException,
+                            "invalid ip/mask combo '10.0.0.0/33' (format is <ip>/<# mask bits>)");
+}
+
+TEST_F(IpTaggingFilterTest, BothIpTagsAndPath) {
+  const std::string json = R"EOF(
+    {
+      "ip_tags_path" : "/dev/null",
+      "ip_tags" : [
+        {
+          "ip_tag_name" : "test",
+          "ip_list" : ["1.2.3.4"]
+        }
+      ]
+    }
+  )EOF";
+  EXPECT_THROW_WITH_MESSAGE(SetUpTest(json), EnvoyException,
+                            "ip tagging filter config can't have both ip_tags and ip_tags_path");
+}
+
+TEST_F(IpTaggingFilterTest, ReloadFromFile) {
+  const std::string path = TestEnvironment::writeStringToFileForTest("ip_tags.json", R"EOF(
+    {
+      "ip_tags" : [{"ip_tag_name" : "first", "ip_list" : ["1.2.3.0/24"]}]
+    }
+  )EOF");
+
+  Filesystem::MockWatcher* watcher = new Filesystem::MockWatcher();
+  Filesystem::Watcher::OnChangedCb on_changed;
+  EXPECT_CALL(dispatcher_, createFilesystemWatcher_()).WillOnce(Return(watcher));
+  EXPECT_CALL(*watcher, addWatch(path, Filesystem::Watcher::Events::MovedTo, _))
+      .WillOnce(SaveArg<2>(&on_changed));
+  SetUpTest(fmt::format("{{\"ip_tags_path\" : \"{}\"}}", path));
+
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(request_headers_, false));
+  EXPECT_EQ("first", ipTags());
+
+  TestEnvironment::writeStringToFileForTest("ip_tags.json", R"EOF(
+    {
+      "ip_tags" : [{"ip_tag_name" : "second", "ip_list" : ["1.2.0.0/16"]}]
+    }
+  )EOF");
+  on_changed(Filesystem::Watcher::Events::MovedTo);
+  EXPECT_EQ(1U, stats_.counter("prefix.ip_tagging.reload_success").value());
+
+  TestHeaderMapImpl headers;
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(headers, false));
+  EXPECT_EQ("second", headers.get_(Headers::get().EnvoyIpTags));
+
+  // A bad version is rejected, and the last good one stays.
+  TestEnvironment::writeStringToFileForTest("ip_tags.json", "{\"ip_tags\" : 1}");
+  on_changed(Filesystem::Watcher::Events::MovedTo);
+  EXPECT_EQ(1U, stats_.counter("prefix.ip_tagging.reload_failure").value());
+
+  TestHeaderMapImpl more_headers;
+  EXPECT_EQ(FilterHeadersStatus::Continue, filter_->decodeHeaders(more_headers, false));
+  EXPECT_EQ("second", more_headers.get_(Headers::get().EnvoyIpTags));
 }
 
 } // namespace Http
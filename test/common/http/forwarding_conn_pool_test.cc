@@ -0,0 +1,288 @@
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/forwarding_conn_pool.h"
+#include "common/http/header_map_impl.h"
+
+#include "test/common/http/common.h"
+#include "test/mocks/buffer/mocks.h"
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/upstream/host.h"
+#include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Http {
+
+/**
+ * A dispatcher that queues posted callbacks until the test runs them, standing in for the loop of
+ * another thread.
+ */
+class QueueingDispatcher : public NiceMock<Event::MockDispatcher> {
+public:
+  QueueingDispatcher() {
+    ON_CALL(*this, post(_)).WillByDefault(Invoke([this](Event::PostCb cb) -> void {
+      posted_.push_back(cb);
+    }));
+  }
+
+  void runPosted() {
+    while (!posted_.empty()) {
+      std::vector<Event::PostCb> posted;
+      posted.swap(posted_);
+      for (const Event::PostCb& cb : posted) {
+        cb();
+      }
+    }
+  }
+
+  std::vector<Event::PostCb> posted_;
+};
+
+class ForwardingConnPoolImplTest : public testing::Test {
+public:
+  ForwardingConnPoolImplTest()
+      : pool_(new ForwardingConnPoolImpl(dispatcher_, owner_dispatcher_, host_,
+                                         [this]() -> ConnectionPool::Instance* {
+                                           return owner_pool_available_ ? &owner_pool_ : nullptr;
+                                         })) {}
+
+  ~ForwardingConnPoolImplTest() {
+    pool_.reset();
+    owner_dispatcher_.runPosted();
+    dispatcher_.runPosted();
+  }
+
+  void expectOwnerNewStream() {
+    EXPECT_CALL(owner_pool_, newStream(_, _))
+        .WillOnce(Invoke([this](StreamDecoder& decoder, ConnectionPool::Callbacks& callbacks)
+                             -> ConnectionPool::Cancellable* {
+                               owner_decoder_ = &decoder;
+                               owner_callbacks_ = &callbacks;
+                               return &owner_cancellable_;
+                             }));
+  }
+
+  // Start a stream and make it ready on the owner and then locally.
+  void startStream() {
+    expectOwnerNewStream();
+    EXPECT_NE(nullptr, pool_->newStream(decoder_, callbacks_));
+    owner_dispatcher_.runPosted();
+
+    EXPECT_CALL(owner_encoder_.stream_, addCallbacks(_));
+    owner_callbacks_->onPoolReady(owner_encoder_, owner_pool_.host_);
+    EXPECT_CALL(callbacks_.pool_ready_, ready());
+    dispatcher_.runPosted();
+    EXPECT_EQ(owner_pool_.host_, callbacks_.host_);
+  }
+
+  QueueingDispatcher dispatcher_;
+  QueueingDispatcher owner_dispatcher_;
+  std::shared_ptr<Upstream::MockHost> host_{new NiceMock<Upstream::MockHost>()};
+  ConnectionPool::MockInstance owner_pool_;
+  bool owner_pool_available_{true};
+  std::unique_ptr<ForwardingConnPoolImpl> pool_;
+  NiceMock<MockStreamDecoder> decoder_;
+  ConnPoolCallbacks callbacks_;
+  StreamDecoder* owner_decoder_{};
+  ConnectionPool::Callbacks* owner_callbacks_{};
+  ConnectionPool::MockCancellable owner_cancellable_;
+  NiceMock<MockStreamEncoder> owner_encoder_;
+  ReadyWatcher drained_;
+};
+
+TEST_F(ForwardingConnPoolImplTest, RequestResponse) {
+  startStream();
+
+  // Nothing reaches the owner's connection until its dispatcher runs.
+  TestHeaderMapImpl request_headers{{":method", "GET"}, {":path", "/"}};
+  EXPECT_CALL(owner_encoder_, encodeHeaders(HeaderMapEqualRef(&request_headers), false));
+  callbacks_.outer_encoder_->encodeHeaders(request_headers, false);
+  Buffer::OwnedImpl request_body("hello");
+  callbacks_.outer_encoder_->encodeData(request_body, true);
+  EXPECT_EQ(0UL, request_body.length());
+  EXPECT_CALL(owner_encoder_, encodeData(BufferStringEqual("hello"), true));
+  owner_dispatcher_.runPosted();
+
+  pool_->addDrainedCallback([this]() -> void { drained_.ready(); });
+
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  owner_decoder_->decodeHeaders(HeaderMapPtr{new TestHeaderMapImpl(response_headers)}, false);
+  Buffer::OwnedImpl response_body("world");
+  owner_decoder_->decodeData(response_body, false);
+  owner_decoder_->decodeTrailers(HeaderMapPtr{new TestHeaderMapImpl{{"grpc-status", "0"}}});
+  EXPECT_CALL(decoder_, decodeHeaders_(HeaderMapEqual(&response_headers), false));
+  EXPECT_CALL(decoder_, decodeData(BufferStringEqual("world"), false));
+  EXPECT_CALL(decoder_, decodeTrailers_(_));
+  EXPECT_CALL(drained_, ready());
+  dispatcher_.runPosted();
+}
+
+TEST_F(ForwardingConnPoolImplTest, CancelPending) {
+  EXPECT_CALL(owner_pool_, newStream(_, _)).WillOnce(Return(&owner_cancellable_));
+  ConnectionPool::Cancellable* handle = pool_->newStream(decoder_, callbacks_);
+  owner_dispatcher_.runPosted();
+
+  pool_->addDrainedCallback([this]() -> void { drained_.ready(); });
+  EXPECT_CALL(drained_, ready());
+  handle->cancel();
+  EXPECT_CALL(owner_cancellable_, cancel());
+  owner_dispatcher_.runPosted();
+}
+
+TEST_F(ForwardingConnPoolImplTest, CancelBeforeOwnerStarts) {
+  // The stream is cancelled before the owner has even asked its pool for it.
+  ConnectionPool::Cancellable* handle = pool_->newStream(decoder_, callbacks_);
+  handle->cancel();
+
+  EXPECT_CALL(owner_pool_, newStream(_, _)).WillOnce(Return(&owner_cancellable_));
+  EXPECT_CALL(owner_cancellable_, cancel());
+  owner_dispatcher_.runPosted();
+}
+
+TEST_F(ForwardingConnPoolImplTest, CancelRacesReady) {
+  expectOwnerNewStream();
+  ConnectionPool::Cancellable* handle = pool_->newStream(decoder_, callbacks_);
+  owner_dispatcher_.runPosted();
+
+  // The owner's stream is ready, but the cancel is already on its way.
+  owner_callbacks_->onPoolReady(owner_encoder_, owner_pool_.host_);
+  handle->cancel();
+  EXPECT_CALL(owner_encoder_.stream_, resetStream(StreamResetReason::LocalReset));
+  owner_dispatcher_.runPosted();
+
+  EXPECT_CALL(callbacks_.pool_ready_, ready()).Times(0);
+  dispatcher_.runPosted();
+}
+
+TEST_F(ForwardingConnPoolImplTest, NoOwnerPool) {
+  owner_pool_available_ = false;
+  pool_->newStream(decoder_, callbacks_);
+  owner_dispatcher_.runPosted();
+
+  EXPECT_CALL(callbacks_.pool_failure_, ready());
+  dispatcher_.runPosted();
+  EXPECT_EQ(host_, callbacks_.host_);
+}
+
+TEST_F(ForwardingConnPoolImplTest, OwnerPoolFailure) {
+  EXPECT_CALL(owner_pool_, newStream(_, _))
+      .WillOnce(Invoke([](StreamDecoder&, ConnectionPool::Callbacks& callbacks)
+                           -> ConnectionPool::Cancellable* {
+                             callbacks.onPoolFailure(ConnectionPool::PoolFailureReason::Overflow,
+                                                     nullptr);
+                             return nullptr;
+                           }));
+  pool_->newStream(decoder_, callbacks_);
+  owner_dispatcher_.runPosted();
+
+  EXPECT_CALL(callbacks_.pool_failure_, ready());
+  dispatcher_.runPosted();
+  EXPECT_EQ(nullptr, callbacks_.host_);
+}
+
+TEST_F(ForwardingConnPoolImplTest, RemoteReset) {
+  startStream();
+
+  MockStreamCallbacks stream_callbacks;
+  callbacks_.outer_encoder_->getStream().addCallbacks(stream_callbacks);
+  owner_encoder_.stream_.resetStream(StreamResetReason::RemoteReset);
+
+  EXPECT_CALL(stream_callbacks, onResetStream(StreamResetReason::RemoteReset));
+  dispatcher_.runPosted();
+}
+
+TEST_F(ForwardingConnPoolImplTest, LocalReset) {
+  startStream();
+
+  MockStreamCallbacks stream_callbacks;
+  callbacks_.outer_encoder_->getStream().addCallbacks(stream_callbacks);
+  EXPECT_CALL(stream_callbacks, onResetStream(StreamResetReason::LocalReset));
+  callbacks_.outer_encoder_->getStream().resetStream(StreamResetReason::LocalReset);
+
+  // The owner's stream does not call back for a reset that it was asked to do.
+  EXPECT_CALL(owner_encoder_.stream_, removeCallbacks(_));
+  EXPECT_CALL(owner_encoder_.stream_, resetStream(StreamResetReason::LocalReset));
+  owner_dispatcher_.runPosted();
+  dispatcher_.runPosted();
+}
+
+TEST_F(ForwardingConnPoolImplTest, EarlyResponse) {
+  startStream();
+
+  // The response completes before the request does, so the stream is not done yet.
+  TestHeaderMapImpl request_headers{{":method", "POST"}, {":path", "/"}};
+  callbacks_.outer_encoder_->encodeHeaders(request_headers, false);
+  owner_dispatcher_.runPosted();
+  owner_decoder_->decodeHeaders(HeaderMapPtr{new TestHeaderMapImpl{{":status", "413"}}}, true);
+  dispatcher_.runPosted();
+
+  pool_->addDrainedCallback([this]() -> void { drained_.ready(); });
+  EXPECT_CALL(drained_, ready());
+  callbacks_.outer_encoder_->getStream().resetStream(StreamResetReason::LocalReset);
+  EXPECT_CALL(owner_encoder_.stream_, resetStream(StreamResetReason::LocalReset));
+  owner_dispatcher_.runPosted();
+}
+
+TEST_F(ForwardingConnPoolImplTest, ReadDisableAndWatermarks) {
+  startStream();
+
+  MockStreamCallbacks stream_callbacks;
+  callbacks_.outer_encoder_->getStream().addCallbacks(stream_callbacks);
+  callbacks_.outer_encoder_->getStream().readDisable(true);
+  EXPECT_CALL(owner_encoder_.stream_, readDisable(true));
+  owner_dispatcher_.runPosted();
+
+  for (StreamCallbacks* callbacks : owner_encoder_.stream_.callbacks_) {
+    callbacks->onAboveWriteBufferHighWatermark();
+    callbacks->onBelowWriteBufferLowWatermark();
+  }
+  EXPECT_CALL(stream_callbacks, onAboveWriteBufferHighWatermark());
+  EXPECT_CALL(stream_callbacks, onBelowWriteBufferLowWatermark());
+  dispatcher_.runPosted();
+
+  callbacks_.outer_encoder_->getStream().resetStream(StreamResetReason::LocalReset);
+}
+
+TEST_F(ForwardingConnPoolImplTest, DestroyWithActiveStreams) {
+  startStream();
+  MockStreamCallbacks stream_callbacks;
+  callbacks_.outer_encoder_->getStream().addCallbacks(stream_callbacks);
+
+  ConnPoolCallbacks pending_callbacks;
+  EXPECT_CALL(owner_pool_, newStream(_, _)).WillOnce(Return(&owner_cancellable_));
+  pool_->newStream(decoder_, pending_callbacks);
+
+  EXPECT_CALL(stream_callbacks, onResetStream(StreamResetReason::ConnectionTermination));
+  EXPECT_CALL(pending_callbacks.pool_failure_, ready());
+  pool_.reset();
+
+  EXPECT_CALL(owner_encoder_.stream_, resetStream(StreamResetReason::ConnectionTermination));
+  EXPECT_CALL(owner_cancellable_, cancel());
+  owner_dispatcher_.runPosted();
+}
+
+TEST_F(ForwardingConnPoolImplTest, DrainWithNoStreams) {
+  EXPECT_CALL(drained_, ready());
+  pool_->addDrainedCallback([this]() -> void { drained_.ready(); });
+}
+
+TEST_F(ForwardingConnPoolImplTest, PrefetchIsLeftToTheOwner) {
+  EXPECT_CALL(owner_pool_, prefetchConnections()).Times(0);
+  pool_->prefetchConnections();
+  owner_dispatcher_.runPosted();
+}
+
+} // namespace Http
+} // namespace Envoy
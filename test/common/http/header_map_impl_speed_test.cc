@@ -0,0 +1,162 @@
+#include <string>
+#include <vector>
+
+#include "common/http/header_map_impl.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Http {
+namespace {
+
+// A typical browser request: a few inline headers that the codecs always see, followed by custom
+// headers.
+const std::vector<std::pair<std::string, std::string>>& requestHeaders() {
+  static const std::vector<std::pair<std::string, std::string>> headers{
+      {":method", "GET"},
+      {":path", "/api/v1/users/1234/profile?fields=name,email"},
+      {":authority", "api.example.com"},
+      {":scheme", "https"},
+      {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36"},
+      {"accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8"},
+      {"accept-encoding", "gzip, deflate, br"},
+      {"accept-language", "en-US,en;q=0.5"},
+      {"cookie", "session=7b2f3e4a5c6d7e8f9a0b1c2d3e4f5a6b; theme=dark"},
+      {"x-forwarded-for", "10.0.0.1"},
+      {"x-request-id", "4b5c6d7e-8f9a-4b1c-8d3e-4f5a6b7c8d9e"},
+      {"cache-control", "no-cache"}};
+  return headers;
+}
+
+/**
+ * Add headers the way the codecs do, taking ownership of the parsed key and value.
+ */
+void addViaMove(HeaderMapImpl& map, const std::string& key, const std::string& value) {
+  HeaderString key_string;
+  key_string.setCopy(key.data(), key.size());
+  HeaderString value_string;
+  value_string.setCopy(value.data(), value.size());
+  map.addViaMove(std::move(key_string), std::move(value_string));
+}
+
+void BM_HeaderMapImplInsert(benchmark::State& state) {
+  const auto& headers = requestHeaders();
+  while (state.KeepRunning()) {
+    HeaderMapImpl map;
+    for (const auto& header : headers) {
+      addViaMove(map, header.first, header.second);
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * headers.size());
+}
+BENCHMARK(BM_HeaderMapImplInsert);
+
+/**
+ * Per header insert cost for the longer inline headers Envoy adds itself, which is where resolving
+ * the inline slot costs the most.
+ */
+void BM_HeaderMapImplInsertEnvoyHeaders(benchmark::State& state) {
+  static const std::vector<std::pair<std::string, std::string>> headers{
+      {"x-envoy-upstream-rq-timeout-ms", "15000"},
+      {"x-envoy-upstream-rq-per-try-timeout-ms", "5000"},
+      {"x-envoy-expected-rq-timeout-ms", "15000"},
+      {"x-envoy-downstream-service-cluster", "frontend"},
+      {"x-envoy-upstream-service-time", "12"},
+      {"x-forwarded-proto", "https"},
+      {"content-length", "0"},
+      {"x-not-inline-header", "value"}};
+  while (state.KeepRunning()) {
+    HeaderMapImpl map;
+    for (const auto& header : headers) {
+      addViaMove(map, header.first, header.second);
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * headers.size());
+}
+BENCHMARK(BM_HeaderMapImplInsertEnvoyHeaders);
+
+void BM_HeaderMapImplAddCopyCustom(benchmark::State& state) {
+  std::vector<LowerCaseString> keys;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    keys.emplace_back("x-custom-header-" + std::to_string(i));
+  }
+  const std::string value("some value");
+
+  while (state.KeepRunning()) {
+    HeaderMapImpl map;
+    for (const LowerCaseString& key : keys) {
+      map.addCopy(key, value);
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_HeaderMapImplAddCopyCustom)->Arg(1)->Arg(10)->Arg(50);
+
+void BM_HeaderMapImplGetInline(benchmark::State& state) {
+  HeaderMapImpl map;
+  for (const auto& header : requestHeaders()) {
+    addViaMove(map, header.first, header.second);
+  }
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(map.Host());
+    benchmark::DoNotOptimize(map.Path());
+    benchmark::DoNotOptimize(map.RequestId());
+  }
+}
+BENCHMARK(BM_HeaderMapImplGetInline);
+
+void BM_HeaderMapImplGetCustom(benchmark::State& state) {
+  HeaderMapImpl map;
+  for (const auto& header : requestHeaders()) {
+    addViaMove(map, header.first, header.second);
+  }
+  const LowerCaseString present("cookie");
+  const LowerCaseString missing("x-not-there");
+
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(map.get(present));
+    benchmark::DoNotOptimize(map.get(missing));
+  }
+}
+BENCHMARK(BM_HeaderMapImplGetCustom);
+
+void BM_HeaderMapImplCopy(benchmark::State& state) {
+  HeaderMapImpl map;
+  for (const auto& header : requestHeaders()) {
+    addViaMove(map, header.first, header.second);
+  }
+
+  // Copies go through the HeaderMap interface, e.g. when shadowing or retrying requests.
+  const HeaderMap& source = map;
+  while (state.KeepRunning()) {
+    HeaderMapImpl copy(source);
+    benchmark::DoNotOptimize(copy.size());
+  }
+}
+BENCHMARK(BM_HeaderMapImplCopy);
+
+void BM_HeaderMapImplIterate(benchmark::State& state) {
+  HeaderMapImpl map;
+  for (const auto& header : requestHeaders()) {
+    addViaMove(map, header.first, header.second);
+  }
+
+  while (state.KeepRunning()) {
+    uint64_t bytes = 0;
+    map.iterate(
+        [](const HeaderEntry& header, void* context) -> void {
+          *static_cast<uint64_t*>(context) += header.key().size() + header.value().size();
+        },
+        &bytes);
+    benchmark::DoNotOptimize(bytes);
+  }
+}
+BENCHMARK(BM_HeaderMapImplIterate);
+
+} // namespace
+} // namespace Http
+} // namespace Envoy
@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 
 #include "common/http/header_map_impl.h"
 
@@ -280,6 +281,29 @@ TEST(HeaderMapImplTest, MoveIntoInline) {
   EXPECT_STREQ("hello", headers.Host()->value().c_str());
 }
 
+TEST(HeaderMapImplTest, StaticLookup) {
+  HeaderMapImpl headers;
+  headers.addCopy(LowerCaseString("x-envoy-upstream-rq-timeout-ms"), "1");
+  headers.addCopy(LowerCaseString("x-envoy-upstream-alt-stat-name"), "2");
+  headers.addCopy(LowerCaseString("x-envoy-expected-rq-timeout-ms"), "3");
+  headers.addCopy(LowerCaseString("host"), "4");
+  EXPECT_STREQ("1", headers.EnvoyUpstreamRequestTimeoutMs()->value().c_str());
+  EXPECT_STREQ("2", headers.EnvoyUpstreamAltStatName()->value().c_str());
+  EXPECT_STREQ("3", headers.EnvoyExpectedRequestTimeoutMs()->value().c_str());
+  EXPECT_STREQ("4", headers.Host()->value().c_str());
+
+  // Names that only look like inline headers: same length and mostly the same characters, a prefix,
+  // and a longer name.
+  headers.addCopy(LowerCaseString("x-envoy-upstream-rq-timeout-mx"), "5");
+  headers.addCopy(LowerCaseString("content-lengt"), "6");
+  headers.addCopy(LowerCaseString("content-lengthh"), "7");
+  headers.addCopy(LowerCaseString("x-envoy-upstream-rq-timeout-alt-response-too-long"), "8");
+  EXPECT_STREQ("1", headers.EnvoyUpstreamRequestTimeoutMs()->value().c_str());
+  EXPECT_EQ(nullptr, headers.ContentLength());
+  EXPECT_EQ(nullptr, headers.EnvoyUpstreamRequestTimeoutAltResponse());
+  EXPECT_EQ(8UL, headers.size());
+}
+
 TEST(HeaderMapImplTest, Remove) {
   HeaderMapImpl headers;
 
@@ -311,6 +335,24 @@ TEST(HeaderMapImplTest, Remove) {
   EXPECT_EQ(0UL, headers.size());
 }
 
+TEST(HeaderMapImplTest, RemoveKeys) {
+  TestHeaderMapImpl headers{{"x-foo", "1"}, {"x-bar", "2"},          {"x-foo", "3"}, {"x-baz", "4"},
+                            {"x-fo", "5"},  {"content-length", "6"}, {"x-fooo", "7"}};
+  headers.removeKeys({LowerCaseString("x-foo"), LowerCaseString("content-length"),
+                      LowerCaseString("x-baz"), LowerCaseString("x-absent")});
+  EXPECT_EQ((TestHeaderMapImpl{{"x-bar", "2"}, {"x-fo", "5"}, {"x-fooo", "7"}}), headers);
+  EXPECT_EQ(nullptr, headers.ContentLength());
+
+  // Only O(1) headers.
+  headers.insertContentLength().value(5);
+  headers.removeKeys({Headers::get().ContentLength});
+  EXPECT_EQ(nullptr, headers.ContentLength());
+  EXPECT_EQ(3UL, headers.size());
+
+  headers.removeKeys({});
+  EXPECT_EQ(3UL, headers.size());
+}
+
 TEST(HeaderMapImplTest, DoubleInlineAdd) {
   HeaderMapImpl headers;
   headers.addReferenceKey(Headers::get().ContentLength, 5);
@@ -386,6 +428,80 @@ TEST(HeaderMapImplTest, Equality) {
   EXPECT_FALSE(headers1 == headers2);
 }
 
+TEST(HeaderMapImplTest, ManyHeaders) {
+  HeaderMapImpl headers;
+  headers.insertHost().value(std::string("host"));
+  const HeaderEntry* host = headers.Host();
+
+  // Grow well past the first block and make sure earlier entries stay put.
+  std::vector<LowerCaseString> keys;
+  for (int i = 0; i < 100; i++) {
+    keys.emplace_back("x-header-" + std::to_string(i));
+    headers.addCopy(keys.back(), i);
+  }
+  const HeaderEntry* first = headers.get(keys.front());
+  EXPECT_EQ(101UL, headers.size());
+  EXPECT_EQ(host, headers.Host());
+  EXPECT_STREQ("host", headers.Host()->value().c_str());
+  EXPECT_STREQ("0", first->value().c_str());
+  EXPECT_STREQ("99", headers.get(keys.back())->value().c_str());
+
+  // Remove every other header, then add some new ones which reuse the removed slots. Iteration must
+  // still follow insertion order.
+  for (int i = 1; i < 100; i += 2) {
+    headers.remove(keys[i]);
+  }
+  headers.removeHost();
+  EXPECT_EQ(50UL, headers.size());
+  EXPECT_EQ(first, headers.get(keys.front()));
+  headers.addCopy(LowerCaseString("x-last"), "last");
+  headers.insertContentLength().value(5);
+
+  std::vector<std::string> order;
+  headers.iterate(
+      [](const HeaderEntry& header, void* context) -> void {
+        static_cast<std::vector<std::string>*>(context)->push_back(header.key().c_str());
+      },
+      &order);
+  ASSERT_EQ(52UL, order.size());
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ(keys[i * 2].get(), order[i]);
+  }
+  EXPECT_EQ("x-last", order[50]);
+  EXPECT_EQ("content-length", order[51]);
+}
+
+TEST(HeaderMapImplTest, Copy) {
+  HeaderMapImpl headers;
+  headers.insertHost().value(std::string("host"));
+  headers.addCopy(LowerCaseString("hello"), "world");
+  headers.insertContentLength().value(5);
+  const LowerCaseString large_key("large");
+  const std::string large_value(4096, 'a');
+  headers.addReference(large_key, large_value);
+
+  HeaderMapImpl copy(static_cast<const HeaderMap&>(headers));
+  EXPECT_EQ(headers, copy);
+  EXPECT_EQ(4UL, copy.size());
+  EXPECT_NE(headers.Host(), copy.Host());
+  EXPECT_STREQ("host", copy.Host()->value().c_str());
+  EXPECT_STREQ("5", copy.ContentLength()->value().c_str());
+  EXPECT_NE(large_value.c_str(), copy.get(large_key)->value().c_str());
+  EXPECT_EQ(large_value, copy.get(large_key)->value().c_str());
+
+  // The copy is independent of the original.
+  headers.removeHost();
+  headers.remove(LowerCaseString("hello"));
+  EXPECT_STREQ("host", copy.Host()->value().c_str());
+  EXPECT_STREQ("world", copy.get(LowerCaseString("hello"))->value().c_str());
+
+  // Copying a copy behaves the same.
+  HeaderMapImpl copy2(copy);
+  EXPECT_EQ(copy, copy2);
+  copy2.insertContentLength().value(6);
+  EXPECT_STREQ("5", copy.ContentLength()->value().c_str());
+}
+
 TEST(HeaderMapImplTest, LargeCharInHeader) {
   HeaderMapImpl headers;
   LowerCaseString static_key("\x90hello");
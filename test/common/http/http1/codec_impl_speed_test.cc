@@ -0,0 +1,110 @@
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/http/header_map_impl.h"
+#include "common/http/http1/codec_impl.h"
+
+#include "test/mocks/network/mocks.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Http {
+namespace Http1 {
+namespace {
+
+/**
+ * Answers every request with a header only response as soon as the request is complete, so that
+ * the codec is ready for the next request on the connection.
+ */
+class RespondingCallbacks : public ServerConnectionCallbacks, public StreamDecoder {
+public:
+  // Http::ConnectionCallbacks
+  void onGoAway() override {}
+
+  // Http::ServerConnectionCallbacks
+  StreamDecoder& newStream(StreamEncoder& response_encoder) override {
+    response_encoder_ = &response_encoder;
+    return *this;
+  }
+
+  // Http::StreamDecoder
+  void decodeHeaders(HeaderMapPtr&& headers, bool end_stream) override {
+    benchmark::DoNotOptimize(headers.get());
+    if (end_stream) {
+      respond();
+    }
+  }
+  void decodeData(Buffer::Instance& data, bool end_stream) override {
+    data.drain(data.length());
+    if (end_stream) {
+      respond();
+    }
+  }
+  void decodeTrailers(HeaderMapPtr&&) override { respond(); }
+
+private:
+  void respond() { response_encoder_->encodeHeaders(response_headers_, true); }
+
+  StreamEncoder* response_encoder_{};
+  HeaderMapImpl response_headers_{{Headers::get().Status, "200"}};
+};
+
+const std::string& getRequest() {
+  static const std::string request("GET /api/v1/users/1234/profile?fields=name,email HTTP/1.1\r\n"
+                                   "Host: api.example.com\r\n"
+                                   "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+                                   "Accept: text/html,application/xhtml+xml,*/*;q=0.8\r\n"
+                                   "Accept-Encoding: gzip, deflate, br\r\n"
+                                   "Accept-Language: en-US,en;q=0.5\r\n"
+                                   "Cookie: session=7b2f3e4a5c6d7e8f9a0b1c2d3e4f5a6b\r\n"
+                                   "X-Request-Id: 4b5c6d7e-8f9a-4b1c-8d3e-4f5a6b7c8d9e\r\n"
+                                   "\r\n");
+  return request;
+}
+
+// The argument selects whether the fast head parser is used.
+void BM_ServerConnectionImplDispatchGet(benchmark::State& state) {
+  testing::NiceMock<Network::MockConnection> connection;
+  RespondingCallbacks callbacks;
+  Http1Settings settings;
+  settings.fast_head_parser_ = state.range(0) != 0;
+  ServerConnectionImpl codec(connection, callbacks, settings);
+
+  const std::string& request = getRequest();
+  while (state.KeepRunning()) {
+    Buffer::OwnedImpl data(request);
+    codec.dispatch(data);
+  }
+  state.SetBytesProcessed(state.iterations() * request.size());
+}
+BENCHMARK(BM_ServerConnectionImplDispatchGet)->Arg(0)->Arg(1);
+
+// The arguments are the size of the body and whether the fast head parser is used.
+void BM_ServerConnectionImplDispatchPost(benchmark::State& state) {
+  testing::NiceMock<Network::MockConnection> connection;
+  RespondingCallbacks callbacks;
+  Http1Settings settings;
+  settings.fast_head_parser_ = state.range(1) != 0;
+  ServerConnectionImpl codec(connection, callbacks, settings);
+
+  const std::string request("POST /upload HTTP/1.1\r\nHost: api.example.com\r\n"
+                            "Content-Length: " +
+                            std::to_string(state.range(0)) + "\r\n\r\n" +
+                            std::string(state.range(0), 'b'));
+  while (state.KeepRunning()) {
+    Buffer::OwnedImpl data(request);
+    codec.dispatch(data);
+  }
+  state.SetBytesProcessed(state.iterations() * request.size());
+}
+BENCHMARK(BM_ServerConnectionImplDispatchPost)
+    ->Args({1024, 0})
+    ->Args({1024, 1})
+    ->Args({65536, 0})
+    ->Args({65536, 1});
+
+} // namespace
+} // namespace Http1
+} // namespace Http
+} // namespace Envoy
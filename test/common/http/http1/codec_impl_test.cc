@@ -9,6 +9,7 @@
 #include "common/http/http1/codec_impl.h"
 
 #include "test/mocks/buffer/mocks.h"
+#include "test/mocks/event/mocks.h"
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/network/mocks.h"
 #include "test/test_common/printers.h"
@@ -347,6 +348,39 @@ TEST_F(Http1ServerConnectionImplTest, HeaderOnlyResponse) {
   EXPECT_EQ("HTTP/1.1 200 OK\r\ncontent-length: 0\r\n\r\n", output);
 }
 
+TEST_F(Http1ServerConnectionImplTest, LargeAndUncommonResponseHeads) {
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> decoder;
+  Http::StreamEncoder* response_encoder = nullptr;
+  EXPECT_CALL(callbacks_, newStream(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoder = &encoder;
+        return decoder;
+      }));
+
+  std::string output;
+  ON_CALL(connection_, write(_)).WillByDefault(AddBufferToString(&output));
+
+  // A head larger than the default reservation is still written in one piece.
+  Buffer::OwnedImpl buffer("GET / HTTP/1.1\r\n\r\n");
+  codec_->dispatch(buffer);
+  const std::string large_value(10000, 'a');
+  TestHeaderMapImpl headers{{":status", "404"}, {"large", large_value}, {"content-length", "0"}};
+  response_encoder->encodeHeaders(headers, true);
+  EXPECT_EQ("HTTP/1.1 404 Not Found\r\nlarge: " + large_value + "\r\ncontent-length: 0\r\n\r\n",
+            output);
+
+  // Status codes outside of the cached range are formatted on the fly.
+  output.clear();
+  Buffer::OwnedImpl buffer2("GET / HTTP/1.1\r\n\r\n");
+  codec_->dispatch(buffer2);
+  TestHeaderMapImpl uncommon_headers{{":status", "999"}};
+  response_encoder->encodeHeaders(uncommon_headers, true);
+  EXPECT_EQ("HTTP/1.1 999 Unknown\r\ncontent-length: 0\r\n\r\n", output);
+}
+
 TEST_F(Http1ServerConnectionImplTest, ChunkedResponse) {
   initialize();
 
@@ -374,6 +408,62 @@ TEST_F(Http1ServerConnectionImplTest, ChunkedResponse) {
             output);
 }
 
+TEST_F(Http1ServerConnectionImplTest, ChunkedResponseCoalescing) {
+  codec_settings_.chunk_coalesce_bytes_ = 8;
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> decoder;
+  Http::StreamEncoder* response_encoder = nullptr;
+  EXPECT_CALL(callbacks_, newStream(_))
+      .WillOnce(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoder = &encoder;
+        return decoder;
+      }));
+
+  Buffer::OwnedImpl buffer("GET / HTTP/1.1\r\n\r\n");
+  codec_->dispatch(buffer);
+
+  std::string output;
+  ON_CALL(connection_, write(_)).WillByDefault(AddBufferToString(&output));
+
+  TestHeaderMapImpl headers{{":status", "200"}};
+  response_encoder->encodeHeaders(headers, false);
+  output.clear();
+
+  // Small chunks are held back until the timer fires at the end of the event loop iteration.
+  Event::MockTimer* timer = new Event::MockTimer(&connection_.dispatcher_);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(0)));
+  Buffer::OwnedImpl data1("ab");
+  response_encoder->encodeData(data1, false);
+  Buffer::OwnedImpl data2("cd");
+  response_encoder->encodeData(data2, false);
+  EXPECT_EQ("", output);
+
+  EXPECT_CALL(*timer, disableTimer());
+  timer->callback_();
+  EXPECT_EQ("4\r\nabcd\r\n", output);
+  output.clear();
+
+  // Enough held back data is written right away.
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(0)));
+  EXPECT_CALL(*timer, disableTimer());
+  Buffer::OwnedImpl data3("efghi");
+  response_encoder->encodeData(data3, false);
+  Buffer::OwnedImpl data4("jklmn");
+  response_encoder->encodeData(data4, false);
+  EXPECT_EQ("a\r\nefghijklmn\r\n", output);
+  output.clear();
+
+  // Held back data goes out ahead of larger chunks and the end of the stream.
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(0)));
+  EXPECT_CALL(*timer, disableTimer());
+  Buffer::OwnedImpl data5("o");
+  response_encoder->encodeData(data5, false);
+  Buffer::OwnedImpl data6("pqrstuvwxyz");
+  response_encoder->encodeData(data6, true);
+  EXPECT_EQ("1\r\no\r\nb\r\npqrstuvwxyz\r\n0\r\n\r\n", output);
+}
+
 TEST_F(Http1ServerConnectionImplTest, ContentLengthResponse) {
   initialize();
 
@@ -490,6 +580,155 @@ TEST_F(Http1ServerConnectionImplTest, RequestWithTrailers) {
   EXPECT_EQ(0U, buffer.length());
 }
 
+TEST_F(Http1ServerConnectionImplTest, FastHeadParser) {
+  codec_settings_.fast_head_parser_ = true;
+  initialize();
+
+  InSequence sequence;
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  TestHeaderMapImpl expected_headers{{":authority", "hello"},
+                                     {"test", ""},
+                                     {"x-forwarded-for", "10.0.0.1"},
+                                     {"x-custom", "some value"},
+                                     {":path", "/path?query"},
+                                     {":method", "GET"}};
+  EXPECT_CALL(decoder, decodeHeaders_(HeaderMapEqual(&expected_headers), true)).Times(1);
+
+  Buffer::OwnedImpl buffer("GET /path?query HTTP/1.1\r\nHOST: hello\r\nTest:\r\n"
+                           "X-Forwarded-For: 10.0.0.1\r\nx-custom:  some value\r\n\r\n");
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+  EXPECT_EQ(Protocol::Http11, codec_->protocol());
+}
+
+TEST_F(Http1ServerConnectionImplTest, FastHeadParserHttp10) {
+  codec_settings_.fast_head_parser_ = true;
+  initialize();
+  TestHeaderMapImpl expected_headers{{"x-custom", "value"}, {":path", "/"}, {":method", "GET"}};
+  Buffer::OwnedImpl buffer("GET / HTTP/1.0\r\nx-custom: value\r\n\r\n");
+  expectHeadersTest(Protocol::Http10, false, buffer, expected_headers);
+}
+
+TEST_F(Http1ServerConnectionImplTest, FastHeadParserPostWithContentLength) {
+  codec_settings_.fast_head_parser_ = true;
+  initialize();
+
+  InSequence sequence;
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  TestHeaderMapImpl expected_headers{
+      {"content-length", "5"}, {"x-custom", "value"}, {":path", "/"}, {":method", "POST"}};
+  EXPECT_CALL(decoder, decodeHeaders_(HeaderMapEqual(&expected_headers), false)).Times(1);
+
+  Buffer::OwnedImpl expected_data1("12345");
+  EXPECT_CALL(decoder, decodeData(BufferEqual(&expected_data1), false)).Times(1);
+
+  Buffer::OwnedImpl expected_data2;
+  EXPECT_CALL(decoder, decodeData(BufferEqual(&expected_data2), true)).Times(1);
+
+  Buffer::OwnedImpl buffer("POST / HTTP/1.1\r\nContent-Length: 5\r\nx-custom: value\r\n\r\n12345");
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+}
+
+TEST_F(Http1ServerConnectionImplTest, FastHeadParserChunkedWithTrailers) {
+  codec_settings_.fast_head_parser_ = true;
+  initialize();
+
+  InSequence sequence;
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  TestHeaderMapImpl expected_headers{
+      {"transfer-encoding", "chunked"}, {":path", "/"}, {":method", "POST"}};
+  EXPECT_CALL(decoder, decodeHeaders_(HeaderMapEqual(&expected_headers), false)).Times(1);
+
+  Buffer::OwnedImpl expected_data1("Hello World");
+  EXPECT_CALL(decoder, decodeData(BufferEqual(&expected_data1), false)).Times(1);
+
+  Buffer::OwnedImpl expected_data2;
+  EXPECT_CALL(decoder, decodeData(BufferEqual(&expected_data2), true)).Times(1);
+
+  Buffer::OwnedImpl buffer("POST / HTTP/1.1\r\ntransfer-encoding: chunked\r\n\r\nb\r\nHello "
+                           "World\r\n0\r\nhello: world\r\nsecond: header\r\n\r\n");
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+}
+
+TEST_F(Http1ServerConnectionImplTest, FastHeadParserPartialHead) {
+  codec_settings_.fast_head_parser_ = true;
+  initialize();
+
+  InSequence sequence;
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  // The head does not arrive in one piece, so http_parser handles all of it.
+  TestHeaderMapImpl expected_headers{{":authority", "hello"}, {":path", "/"}, {":method", "GET"}};
+  EXPECT_CALL(decoder, decodeHeaders_(HeaderMapEqual(&expected_headers), true)).Times(1);
+
+  Buffer::OwnedImpl buffer("GET / HTTP/1.1\r\nhost: hel");
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+
+  Buffer::OwnedImpl buffer2("lo\r\n\r\n");
+  codec_->dispatch(buffer2);
+  EXPECT_EQ(0U, buffer2.length());
+}
+
+TEST_F(Http1ServerConnectionImplTest, FastHeadParserDoubleRequest) {
+  codec_settings_.fast_head_parser_ = true;
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> decoder;
+  Http::StreamEncoder* response_encoder = nullptr;
+  EXPECT_CALL(callbacks_, newStream(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](Http::StreamEncoder& encoder) -> Http::StreamDecoder& {
+        response_encoder = &encoder;
+        return decoder;
+      }));
+
+  TestHeaderMapImpl expected_headers{{"x-custom", "value"}, {":path", "/"}, {":method", "GET"}};
+  EXPECT_CALL(decoder, decodeHeaders_(HeaderMapEqual(&expected_headers), true)).Times(2);
+
+  std::string request("GET / HTTP/1.1\r\nx-custom: value\r\n\r\n");
+  Buffer::OwnedImpl buffer(request);
+  buffer.add(request);
+
+  codec_->dispatch(buffer);
+  EXPECT_EQ(request.size(), buffer.length());
+
+  response_encoder->encodeHeaders(TestHeaderMapImpl{{":status", "200"}}, true);
+
+  codec_->dispatch(buffer);
+  EXPECT_EQ(0U, buffer.length());
+}
+
+TEST_F(Http1ServerConnectionImplTest, FastHeadParserBadRequest) {
+  codec_settings_.fast_head_parser_ = true;
+  initialize();
+
+  std::string output;
+  ON_CALL(connection_, write(_)).WillByDefault(AddBufferToString(&output));
+
+  Http::MockStreamDecoder decoder;
+  EXPECT_CALL(callbacks_, newStream(_)).WillOnce(ReturnRef(decoder));
+
+  // The head is well formed as far as the fast parser is concerned, and http_parser rejects the
+  // start line when it runs the framing head.
+  Buffer::OwnedImpl buffer("G@T / HTTP/1.1\r\nhost: hello\r\n\r\n");
+  EXPECT_THROW(codec_->dispatch(buffer), CodecProtocolException);
+  EXPECT_EQ("HTTP/1.1 400 Bad Request\r\ncontent-length: 0\r\nconnection: close\r\n\r\n", output);
+}
+
 TEST_F(Http1ServerConnectionImplTest, WatermarkTest) {
   EXPECT_CALL(connection_, bufferLimit()).Times(1).WillOnce(Return(10));
   initialize();
@@ -671,6 +910,30 @@ TEST_F(Http1ClientConnectionImplTest, NoContentLengthResponse) {
   codec_->dispatch(empty);
 }
 
+TEST_F(Http1ClientConnectionImplTest, ChunkedResponseDecodedPerRead) {
+  initialize();
+
+  NiceMock<Http::MockStreamDecoder> response_decoder;
+  Http::StreamEncoder& request_encoder = codec_->newStream(response_decoder);
+  TestHeaderMapImpl headers{{":method", "GET"}, {":path", "/"}, {":authority", "host"}};
+  request_encoder.encodeHeaders(headers, true);
+
+  // The chunks of one read are decoded as one piece of data.
+  InSequence sequence;
+  Buffer::OwnedImpl expected_data1("abcdef");
+  EXPECT_CALL(response_decoder, decodeData(BufferEqual(&expected_data1), false));
+  Buffer::OwnedImpl response("HTTP/1.1 200 OK\r\ntransfer-encoding: chunked\r\n\r\n"
+                             "2\r\nab\r\n2\r\ncd\r\n2\r\nef\r\n");
+  codec_->dispatch(response);
+
+  Buffer::OwnedImpl expected_data2("gh");
+  EXPECT_CALL(response_decoder, decodeData(BufferEqual(&expected_data2), false));
+  Buffer::OwnedImpl expected_data3;
+  EXPECT_CALL(response_decoder, decodeData(BufferEqual(&expected_data3), true));
+  Buffer::OwnedImpl end("2\r\ngh\r\n0\r\n\r\n");
+  codec_->dispatch(end);
+}
+
 TEST_F(Http1ClientConnectionImplTest, ResponseWithTrailers) {
   initialize();
 
@@ -241,6 +241,29 @@ TEST_F(Http1ConnPoolImplTest, MultipleRequestAndResponse) {
   dispatcher_.clearDeferredDeleteList();
 }
 
+/**
+ * Test that only the request that waited for a new connection is told how long it took to connect.
+ */
+TEST_F(Http1ConnPoolImplTest, ConnectionTiming) {
+  ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
+  ASSERT_TRUE(r1.callbacks_.connection_timing_.valid());
+  const Http::ConnectionPool::ConnectionTiming& timing = r1.callbacks_.connection_timing_.value();
+  EXPECT_NE(MonotonicTime(), timing.connect_start_);
+  EXPECT_LE(timing.connect_start_, timing.connect_end_);
+  EXPECT_EQ(MonotonicTime(), timing.handshake_end_);
+  r1.startRequest();
+  r1.completeResponse(false);
+
+  ActiveTestRequest r2(*this, 0, ActiveTestRequest::Type::Immediate);
+  EXPECT_FALSE(r2.callbacks_.connection_timing_.valid());
+  r2.startRequest();
+  r2.completeResponse(false);
+
+  EXPECT_CALL(conn_pool_, onClientDestroy());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
 /**
  * Test when we overflow max pending requests.
  */
@@ -581,6 +604,119 @@ TEST_F(Http1ConnPoolImplTest, RemoteCloseToCompleteResponse) {
   dispatcher_.clearDeferredDeleteList();
 }
 
+TEST_F(Http1ConnPoolImplTest, PrefetchRatio) {
+  InSequence s;
+  cluster_->prefetch_ratio_ = 1.5;
+
+  // The request opens a connection for itself and one ahead of the next request.
+  conn_pool_.expectClientCreate();
+  conn_pool_.expectClientCreate();
+  ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::Pending);
+  r1.expectNewStream();
+  EXPECT_CALL(*conn_pool_.test_clients_[0].connect_timer_, disableTimer());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  EXPECT_CALL(*conn_pool_.test_clients_[1].connect_timer_, disableTimer());
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+
+  r1.startRequest();
+  r1.completeResponse(false);
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_total_.value());
+
+  EXPECT_CALL(conn_pool_, onClientDestroy()).Times(2);
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
+TEST_F(Http1ConnPoolImplTest, MinWarmConnections) {
+  InSequence s;
+  cluster_->min_warm_connections_ = 2;
+
+  conn_pool_.expectClientCreate();
+  conn_pool_.expectClientCreate();
+  conn_pool_.prefetchConnections();
+  for (size_t i = 0; i < 2; i++) {
+    EXPECT_CALL(*conn_pool_.test_clients_[i].connect_timer_, disableTimer());
+    conn_pool_.test_clients_[i].connection_->raiseEvent(Network::ConnectionEvent::Connected);
+  }
+
+  // Nothing more is opened while the warm connections are there.
+  conn_pool_.prefetchConnections();
+
+  // The request does not wait for a connection. The last connection to become ready is used.
+  ActiveTestRequest r1(*this, 1, ActiveTestRequest::Type::Immediate);
+  r1.startRequest();
+  r1.completeResponse(false);
+
+  // A warm connection that the upstream closes is replaced.
+  conn_pool_.expectClientCreate();
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_CALL(conn_pool_, onClientDestroy());
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(3U, cluster_->stats_.upstream_cx_total_.value());
+
+  cluster_->min_warm_connections_ = 0;
+  EXPECT_CALL(conn_pool_, onClientDestroy()).Times(2);
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  conn_pool_.test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
+/**
+ * Test that the most recently used connection is reused first, and that idle connections beyond
+ * the warm ones are closed after the idle timeout.
+ */
+TEST_F(Http1ConnPoolImplTest, IdleTimeout) {
+  cluster_->resource_manager_.reset(
+      new Upstream::ResourceManagerImpl(runtime_, "fake_key", 2, 1024, 1024, 1));
+  cluster_->connection_idle_timeout_ = std::chrono::milliseconds(1000);
+  cluster_->min_warm_connections_ = 1;
+
+  ActiveTestRequest r1(*this, 0, ActiveTestRequest::Type::CreateConnection);
+  r1.startRequest();
+  ActiveTestRequest r2(*this, 1, ActiveTestRequest::Type::CreateConnection);
+  r2.startRequest();
+
+  Event::MockTimer* idle_timer0 = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*idle_timer0, enableTimer(std::chrono::milliseconds(1000)));
+  r1.completeResponse(false);
+  Event::MockTimer* idle_timer1 = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*idle_timer1, enableTimer(std::chrono::milliseconds(1000))).Times(2);
+  r2.completeResponse(false);
+
+  // The connection that became ready last is used.
+  EXPECT_CALL(*idle_timer1, disableTimer());
+  ActiveTestRequest r3(*this, 1, ActiveTestRequest::Type::Immediate);
+  r3.startRequest();
+  r3.completeResponse(false);
+
+  // The surplus connection is closed.
+  EXPECT_CALL(conn_pool_, onClientDestroy());
+  idle_timer0->callback_();
+  dispatcher_.clearDeferredDeleteList();
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_idle_timeout_.value());
+
+  // The warm connection is kept.
+  idle_timer1->callback_();
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_idle_timeout_.value());
+
+  cluster_->min_warm_connections_ = 0;
+  EXPECT_CALL(conn_pool_, onClientDestroy());
+  conn_pool_.test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  dispatcher_.clearDeferredDeleteList();
+}
+
+TEST_F(Http1ConnPoolImplTest, NoPrefetchWhileDraining) {
+  cluster_->min_warm_connections_ = 1;
+
+  ReadyWatcher drained;
+  EXPECT_CALL(drained, ready());
+  conn_pool_.addDrainedCallback([&]() -> void { drained.ready(); });
+
+  EXPECT_CALL(dispatcher_, createClientConnection_(_, _)).Times(0);
+  conn_pool_.prefetchConnections();
+}
+
 } // namespace Http1
 } // namespace Http
 } // namespace Envoy
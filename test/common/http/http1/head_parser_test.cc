@@ -0,0 +1,127 @@
+#include <string>
+#include <vector>
+
+#include "common/http/http1/head_parser.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Http {
+namespace Http1 {
+
+class HeadParserTest : public ::testing::Test {
+public:
+  std::vector<std::pair<std::string, std::string>> headers() {
+    std::vector<std::pair<std::string, std::string>> headers;
+    for (const HeadParser::Header& header : parser_.headers()) {
+      headers.emplace_back(std::string(header.name_, header.name_size_),
+                           std::string(header.value_, header.value_size_));
+    }
+    return headers;
+  }
+
+  HeadParser parser_;
+};
+
+TEST_F(HeadParserTest, Request) {
+  const std::string head = "GET /path HTTP/1.1\r\n"
+                           "Host: example.com\r\n"
+                           "Content-Length: 5\r\n"
+                           "x-empty:\r\n"
+                           "x-spaces: \t  value with spaces\r\n"
+                           "Connection: keep-alive\r\n"
+                           "\r\n";
+  const std::string data = head + "hello";
+  EXPECT_EQ(head.size(), parser_.parse(data.c_str(), data.size()));
+
+  std::vector<std::pair<std::string, std::string>> expected{{"Host", "example.com"},
+                                                            {"Content-Length", "5"},
+                                                            {"x-empty", ""},
+                                                            {"x-spaces", "value with spaces"},
+                                                            {"Connection", "keep-alive"}};
+  EXPECT_EQ(expected, headers());
+  EXPECT_EQ("GET /path HTTP/1.1\r\nContent-Length: 5\r\nConnection: keep-alive\r\n\r\n",
+            parser_.framingHead());
+}
+
+TEST_F(HeadParserTest, Response) {
+  const std::string head = "HTTP/1.1 200 OK\r\n"
+                           "transfer-encoding: chunked\r\n"
+                           "server: envoy\r\n"
+                           "\r\n";
+  EXPECT_EQ(head.size(), parser_.parse(head.c_str(), head.size()));
+  EXPECT_EQ(2UL, parser_.headers().size());
+  EXPECT_EQ("HTTP/1.1 200 OK\r\ntransfer-encoding: chunked\r\n\r\n", parser_.framingHead());
+}
+
+TEST_F(HeadParserTest, NoHeaders) {
+  const std::string head = "GET / HTTP/1.1\r\n\r\n";
+  EXPECT_EQ(head.size(), parser_.parse(head.c_str(), head.size()));
+  EXPECT_TRUE(parser_.headers().empty());
+  EXPECT_EQ(head, parser_.framingHead());
+}
+
+TEST_F(HeadParserTest, LongValues) {
+  // Long enough to go through the vectorized scan, with characters on either side of the control
+  // characters and with obs-text.
+  const std::string value = std::string(100, 'a') + " \t~\x80\xff" + std::string(37, '!');
+  const std::string head = "GET / HTTP/1.1\r\nx-long: " + value + "\r\n\r\n";
+  EXPECT_EQ(head.size(), parser_.parse(head.c_str(), head.size()));
+  ASSERT_EQ(1UL, parser_.headers().size());
+  EXPECT_EQ(value, headers()[0].second);
+}
+
+TEST_F(HeadParserTest, Incomplete) {
+  const std::string head = "GET / HTTP/1.1\r\nhost: example.com\r\nx-value: 1\r\n\r\n";
+  for (size_t size = 0; size < head.size(); size++) {
+    EXPECT_EQ(0UL, parser_.parse(head.c_str(), size)) << size;
+  }
+  EXPECT_EQ(head.size(), parser_.parse(head.c_str(), head.size()));
+}
+
+TEST_F(HeadParserTest, Refused) {
+  const std::vector<std::string> heads{
+      // Leading empty line.
+      "\r\nGET / HTTP/1.1\r\n\r\n",
+      // Bare LF line endings.
+      "GET / HTTP/1.1\nhost: a\n\n",
+      "GET / HTTP/1.1\r\nhost: a\n\r\n",
+      "GET / HTTP/1.1\r\nhost: a\r\n\n",
+      // Bare CR.
+      "GET / HTTP/1.1\r\nhost: a\rb\r\n\r\n",
+      "GET / HTTP/1.1\r\nhost: a\r\n\rx",
+      // Obsolete line folding.
+      "GET / HTTP/1.1\r\nhost: a\r\n b\r\n\r\n",
+      // Whitespace in or after the name.
+      "GET / HTTP/1.1\r\nho st: a\r\n\r\n",
+      "GET / HTTP/1.1\r\nhost : a\r\n\r\n",
+      // Missing or empty name.
+      "GET / HTTP/1.1\r\nhost\r\n\r\n",
+      "GET / HTTP/1.1\r\n: a\r\n\r\n",
+      // Trailing whitespace in the value.
+      "GET / HTTP/1.1\r\nhost: a \r\n\r\n",
+      "GET / HTTP/1.1\r\nhost: a\t\r\n\r\n",
+      // Control characters in the value.
+      "GET / HTTP/1.1\r\nhost: a" + std::string(1, '\0') + "b\r\n\r\n",
+      "GET / HTTP/1.1\r\nhost: a\x7f\r\n\r\n",
+      "GET / HTTP/1.1\r\nhost: " + std::string(40, 'a') + "\x01" + "\r\n\r\n",
+  };
+  for (const std::string& head : heads) {
+    EXPECT_EQ(0UL, parser_.parse(head.c_str(), head.size())) << head;
+  }
+}
+
+TEST_F(HeadParserTest, MaxHeaders) {
+  std::string head = "GET / HTTP/1.1\r\n";
+  for (size_t i = 0; i < HeadParser::MAX_HEADERS; i++) {
+    head += "x: y\r\n";
+  }
+  const std::string max_head = head + "\r\n";
+  EXPECT_EQ(max_head.size(), parser_.parse(max_head.c_str(), max_head.size()));
+  head += "x: y\r\n\r\n";
+  EXPECT_EQ(0UL, parser_.parse(head.c_str(), head.size()));
+}
+
+} // namespace Http1
+} // namespace Http
+} // namespace Envoy
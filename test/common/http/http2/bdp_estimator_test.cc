@@ -0,0 +1,103 @@
+#include <chrono>
+
+#include "common/http/http2/bdp_estimator.h"
+
+#include "test/mocks/common.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Return;
+
+namespace Envoy {
+namespace Http {
+namespace Http2 {
+
+class BdpEstimatorTest : public testing::Test {
+public:
+  BdpEstimatorTest() : estimator_(1000, 8000, time_source_) {}
+
+  // Run one sample in which bytes are received over a round trip of rtt.
+  bool sample(uint64_t bytes, std::chrono::milliseconds rtt) {
+    const bool send_ping = estimator_.onDataReceived(bytes);
+    EXPECT_TRUE(send_ping);
+    EXPECT_CALL(time_source_, currentTime()).WillOnce(Return(now_));
+    estimator_.onPingSent();
+    now_ += rtt;
+    EXPECT_CALL(time_source_, currentTime()).WillOnce(Return(now_));
+    return estimator_.onPingAck();
+  }
+
+  MockMonotonicTimeSource time_source_;
+  MonotonicTime now_;
+  BdpEstimator estimator_;
+};
+
+TEST_F(BdpEstimatorTest, GrowsWhileWindowLimited) {
+  EXPECT_EQ(1000U, estimator_.estimate());
+
+  // Most of the estimate arrived within a round trip.
+  EXPECT_TRUE(sample(900, std::chrono::milliseconds(10)));
+  EXPECT_EQ(2000U, estimator_.estimate());
+
+  // More than twice the estimate arrived, the estimate jumps to what arrived.
+  EXPECT_TRUE(sample(5000, std::chrono::milliseconds(10)));
+  EXPECT_EQ(5000U, estimator_.estimate());
+
+  // Growth stops at the maximum, and there is no need for more samples.
+  EXPECT_TRUE(sample(5000, std::chrono::milliseconds(5)));
+  EXPECT_EQ(8000U, estimator_.estimate());
+  EXPECT_FALSE(estimator_.onDataReceived(100));
+}
+
+TEST_F(BdpEstimatorTest, NoGrowth) {
+  // Too little data arrived to tell whether the window is the limit.
+  EXPECT_FALSE(sample(600, std::chrono::milliseconds(10)));
+  EXPECT_EQ(1000U, estimator_.estimate());
+
+  EXPECT_TRUE(sample(900, std::chrono::milliseconds(10)));
+  EXPECT_EQ(2000U, estimator_.estimate());
+
+  // Enough data arrived, but the bandwidth did not go up: the round trip got longer instead.
+  EXPECT_FALSE(sample(1500, std::chrono::milliseconds(20)));
+  EXPECT_EQ(2000U, estimator_.estimate());
+}
+
+TEST_F(BdpEstimatorTest, OnePingAtATime) {
+  EXPECT_TRUE(estimator_.onDataReceived(100));
+  EXPECT_CALL(time_source_, currentTime()).WillOnce(Return(now_));
+  estimator_.onPingSent();
+  EXPECT_FALSE(estimator_.onDataReceived(100));
+
+  // Data that arrives while the PING is in flight counts towards the sample.
+  EXPECT_FALSE(estimator_.onDataReceived(700));
+  now_ += std::chrono::milliseconds(1);
+  EXPECT_CALL(time_source_, currentTime()).WillOnce(Return(now_));
+  EXPECT_TRUE(estimator_.onPingAck());
+
+  // An ACK without a PING in flight is ignored.
+  EXPECT_FALSE(estimator_.onPingAck());
+  EXPECT_TRUE(estimator_.onDataReceived(100));
+}
+
+TEST_F(BdpEstimatorTest, Shrink) {
+  EXPECT_FALSE(estimator_.shrink());
+
+  EXPECT_TRUE(sample(4000, std::chrono::milliseconds(10)));
+  EXPECT_EQ(4000U, estimator_.estimate());
+  EXPECT_TRUE(estimator_.shrink());
+  EXPECT_EQ(2000U, estimator_.estimate());
+
+  // Growth resumes at a lower bandwidth than before the receiver fell behind.
+  EXPECT_TRUE(sample(1500, std::chrono::milliseconds(10)));
+  EXPECT_EQ(4000U, estimator_.estimate());
+
+  EXPECT_TRUE(estimator_.shrink());
+  EXPECT_TRUE(estimator_.shrink());
+  EXPECT_EQ(1000U, estimator_.estimate());
+  EXPECT_FALSE(estimator_.shrink());
+}
+
+} // namespace Http2
+} // namespace Http
+} // namespace Envoy
@@ -1,5 +1,8 @@
+#include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include "envoy/http/codec.h"
 
@@ -9,6 +12,8 @@
 #include "common/stats/stats_impl.h"
 
 #include "test/common/http/common.h"
+#include "test/mocks/buffer/mocks.h"
+#include "test/mocks/event/mocks.h"
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/network/mocks.h"
 #include "test/test_common/printers.h"
@@ -190,6 +195,23 @@ TEST_P(Http2CodecImplTest, ShutdownNotice) {
   response_encoder_->encodeHeaders(response_headers, true);
 }
 
+TEST_P(Http2CodecImplTest, MaxConcurrentStreams) {
+  initialize();
+
+  TestHeaderMapImpl request_headers;
+  HttpTestUtility::addDefaultHeaders(request_headers);
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, true));
+  request_encoder_->encodeHeaders(request_headers, true);
+
+  // The SETTINGS of the server have arrived with its first frames. The default is not sent, which
+  // leaves the number of streams unlimited.
+  const uint32_t expected =
+      server_http2settings_.max_concurrent_streams_ == NGHTTP2_INITIAL_MAX_CONCURRENT_STREAMS
+          ? std::numeric_limits<uint32_t>::max()
+          : server_http2settings_.max_concurrent_streams_;
+  EXPECT_EQ(expected, client_.maxConcurrentStreams());
+}
+
 TEST_P(Http2CodecImplTest, RefusedStreamReset) {
   initialize();
 
@@ -546,6 +568,51 @@ TEST_P(Http2CodecImplTest, WatermarkUnderEndStream) {
   response_encoder_->encodeHeaders(response_headers, true);
 }
 
+TEST_P(Http2CodecImplTest, HeaderCompressionStats) {
+  initialize();
+
+  TestHeaderMapImpl request_headers;
+  HttpTestUtility::addDefaultHeaders(request_headers);
+  request_headers.addCopy("x-request-id", "25d2a0e2-1f9e-4d6c-9c0e-5a3a7f0b8f9c");
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, true));
+  request_encoder_->encodeHeaders(request_headers, true);
+
+  // The client and the server share the stats store, and only the client sent headers.
+  EXPECT_EQ(request_headers.byteSize(), stats_store_.counter("http2.tx_header_bytes").value());
+  EXPECT_EQ(request_headers.byteSize(), stats_store_.counter("http2.rx_header_bytes").value());
+  EXPECT_LT(0U, stats_store_.counter("http2.tx_header_bytes_compressed").value());
+  EXPECT_GT(request_headers.byteSize(),
+            stats_store_.counter("http2.tx_header_bytes_compressed").value());
+  EXPECT_EQ(stats_store_.counter("http2.tx_header_bytes_compressed").value(),
+            stats_store_.counter("http2.rx_header_bytes_compressed").value());
+}
+
+TEST_P(Http2CodecImplTest, DataIsMovedNotCopied) {
+  initialize();
+
+  TestHeaderMapImpl request_headers;
+  HttpTestUtility::addDefaultHeaders(request_headers);
+  EXPECT_CALL(request_decoder_, decodeHeaders_(_, false));
+  request_encoder_->encodeHeaders(request_headers, false);
+
+  // The DATA frame goes out in a single write with the body still in the memory it was added from.
+  const std::string body(1024, 'a');
+  Buffer::BufferFragmentImpl fragment(body.data(), body.size(), nullptr);
+  Buffer::OwnedImpl data;
+  data.addBufferFragment(fragment);
+  EXPECT_CALL(client_connection_, write(_)).WillOnce(Invoke([&](Buffer::Instance& output) -> void {
+    const uint64_t num_slices = output.getRawSlices(nullptr, 0);
+    std::vector<Buffer::RawSlice> slices(num_slices);
+    output.getRawSlices(slices.data(), num_slices);
+    EXPECT_TRUE(std::any_of(slices.begin(), slices.end(), [&](const Buffer::RawSlice& slice) {
+      return slice.mem_ == body.data() && slice.len_ == body.size();
+    }));
+    server_wrapper_.dispatch(output, server_);
+  }));
+  EXPECT_CALL(request_decoder_, decodeData(BufferStringEqual(body), true));
+  request_encoder_->encodeData(data, true);
+}
+
 #define HTTP2SETTINGS_SMALL_WINDOW_COMBINE                                                         \
   ::testing::Combine(::testing::Values(Http2Settings::DEFAULT_HPACK_TABLE_SIZE),                   \
                      ::testing::Values(Http2Settings::DEFAULT_MAX_CONCURRENT_STREAMS),             \
@@ -586,6 +653,220 @@ INSTANTIATE_TEST_CASE_P(Http2CodecImplTestDefaultSettings, Http2CodecImplTest,
 INSTANTIATE_TEST_CASE_P(Http2CodecImplTestEdgeSettings, Http2CodecImplTest,
                         ::testing::Combine(HTTP2SETTINGS_EDGE_COMBINE, HTTP2SETTINGS_EDGE_COMBINE));
 
+const uint32_t INITIAL_WINDOW_SIZE = 65535;
+const uint32_t MAX_WINDOW_SIZE = 1024 * 1024;
+
+class Http2CodecImplWindowAutoTuningTest : public testing::Test {
+public:
+  static Http2Settings serverSettings() {
+    Http2Settings http2_settings;
+    http2_settings.initial_stream_window_size_ = INITIAL_WINDOW_SIZE;
+    http2_settings.initial_connection_window_size_ = INITIAL_WINDOW_SIZE;
+    http2_settings.window_auto_tuning_ = true;
+    http2_settings.max_stream_window_size_ = MAX_WINDOW_SIZE;
+    http2_settings.max_connection_window_size_ = MAX_WINDOW_SIZE;
+    return http2_settings;
+  }
+
+  Http2CodecImplWindowAutoTuningTest()
+      : client_(client_connection_, client_callbacks_, client_stats_store_, Http2Settings()),
+        server_(server_connection_, server_callbacks_, server_stats_store_, serverSettings()) {
+    ON_CALL(client_connection_, write(_)).WillByDefault(Invoke([&](Buffer::Instance& data) -> void {
+      server_wrapper_.dispatch(data, server_);
+    }));
+    ON_CALL(server_connection_, write(_)).WillByDefault(Invoke([&](Buffer::Instance& data) -> void {
+      client_wrapper_.dispatch(data, client_);
+    }));
+    EXPECT_CALL(server_callbacks_, newStream(_))
+        .WillOnce(Invoke([&](StreamEncoder&) -> StreamDecoder& { return request_decoder_; }));
+    EXPECT_CALL(request_decoder_, decodeHeaders_(_, false));
+    EXPECT_CALL(request_decoder_, decodeData(_, _)).Times(AnyNumber());
+  }
+
+  uint64_t streamWindowSize() {
+    return server_stats_store_.gauge("http2.stream_window_size").value();
+  }
+  uint64_t connectionWindowSize() {
+    return server_stats_store_.gauge("http2.connection_window_size").value();
+  }
+
+  // Send a request body that is several times the initial window in a single write, so that each
+  // round trip fills the whole window.
+  void sendBody() {
+    Buffer::OwnedImpl body(std::string(1024 * 1024, 'a'));
+    request_encoder_->encodeData(body, false);
+  }
+
+  Stats::IsolatedStoreImpl client_stats_store_;
+  NiceMock<Network::MockConnection> client_connection_;
+  MockConnectionCallbacks client_callbacks_;
+  TestClientConnectionImpl client_;
+  Http2CodecImplTest::ConnectionWrapper client_wrapper_;
+  Stats::IsolatedStoreImpl server_stats_store_;
+  NiceMock<Network::MockConnection> server_connection_;
+  MockServerConnectionCallbacks server_callbacks_;
+  TestServerConnectionImpl server_;
+  Http2CodecImplTest::ConnectionWrapper server_wrapper_;
+  MockStreamDecoder response_decoder_;
+  MockStreamDecoder request_decoder_;
+  StreamEncoder* request_encoder_{};
+};
+
+TEST_F(Http2CodecImplWindowAutoTuningTest, GrowAndShrink) {
+  EXPECT_EQ(INITIAL_WINDOW_SIZE, streamWindowSize());
+  EXPECT_EQ(INITIAL_WINDOW_SIZE, connectionWindowSize());
+
+  request_encoder_ = &client_.newStream(response_decoder_);
+  TestHeaderMapImpl request_headers;
+  HttpTestUtility::addDefaultHeaders(request_headers);
+  request_encoder_->encodeHeaders(request_headers, false);
+  sendBody();
+
+  // The windows grew, and the peer was told about it.
+  EXPECT_LT(INITIAL_WINDOW_SIZE, streamWindowSize());
+  EXPECT_GE(MAX_WINDOW_SIZE, streamWindowSize());
+  EXPECT_EQ(streamWindowSize(), connectionWindowSize());
+  EXPECT_EQ(streamWindowSize(), nghttp2_session_get_remote_settings(
+                                    client_.session(), NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE));
+  EXPECT_EQ(connectionWindowSize(),
+            nghttp2_session_get_effective_local_window_size(server_.session()));
+
+  // The stream stops reading, the windows shrink.
+  const uint64_t grown_window_size = streamWindowSize();
+  server_.getStream(1)->readDisable(true);
+  EXPECT_GT(grown_window_size, streamWindowSize());
+  EXPECT_EQ(streamWindowSize(), connectionWindowSize());
+  server_.getStream(1)->readDisable(false);
+}
+
+class Http2CodecImplWriteSchedulingTest : public testing::Test {
+public:
+  static Http2Settings serverSettings() {
+    Http2Settings http2_settings;
+    http2_settings.stream_write_quantum_ = QUANTUM;
+    http2_settings.coalesce_frame_writes_ = true;
+    return http2_settings;
+  }
+
+  Http2CodecImplWriteSchedulingTest()
+      : client_(client_connection_, client_callbacks_, stats_store_, Http2Settings()),
+        server_(server_connection_, server_callbacks_, stats_store_, serverSettings()) {
+    ON_CALL(client_connection_, write(_)).WillByDefault(Invoke([&](Buffer::Instance& data) -> void {
+      server_wrapper_.dispatch(data, server_);
+    }));
+    ON_CALL(server_connection_, write(_)).WillByDefault(Invoke([&](Buffer::Instance& data) -> void {
+      client_wrapper_.dispatch(data, client_);
+    }));
+  }
+
+  // Open a request stream whose response body chunks are recorded by the client.
+  StreamEncoder& openStream(MockStreamDecoder& response_decoder, int32_t stream_id) {
+    StreamEncoder* response_encoder = nullptr;
+    EXPECT_CALL(server_callbacks_, newStream(_))
+        .WillOnce(Invoke([&](StreamEncoder& encoder) -> StreamDecoder& {
+          response_encoder = &encoder;
+          return request_decoder_;
+        }));
+    EXPECT_CALL(request_decoder_, decodeHeaders_(_, true));
+    TestHeaderMapImpl request_headers;
+    HttpTestUtility::addDefaultHeaders(request_headers);
+    client_.newStream(response_decoder).encodeHeaders(request_headers, true);
+
+    EXPECT_CALL(response_decoder, decodeHeaders_(_, false));
+    EXPECT_CALL(response_decoder, decodeData(_, _))
+        .WillRepeatedly(Invoke([this, stream_id](Buffer::Instance& data, bool) -> void {
+          received_.emplace_back(stream_id, data.length());
+        }));
+    return *response_encoder;
+  }
+
+  static const uint32_t QUANTUM = 1024;
+
+  Stats::IsolatedStoreImpl stats_store_;
+  NiceMock<Network::MockConnection> client_connection_;
+  MockConnectionCallbacks client_callbacks_;
+  TestClientConnectionImpl client_;
+  Http2CodecImplTest::ConnectionWrapper client_wrapper_;
+  NiceMock<Network::MockConnection> server_connection_;
+  MockServerConnectionCallbacks server_callbacks_;
+  TestServerConnectionImpl server_;
+  Http2CodecImplTest::ConnectionWrapper server_wrapper_;
+  MockStreamDecoder request_decoder_;
+  // The stream ID and length of each DATA frame received by the client, in order.
+  std::vector<std::pair<int32_t, uint64_t>> received_;
+};
+
+TEST_F(Http2CodecImplWriteSchedulingTest, StreamsTakeTurns) {
+  MockStreamDecoder response_decoder1;
+  MockStreamDecoder response_decoder2;
+  StreamEncoder& response_encoder1 = openStream(response_decoder1, 1);
+  StreamEncoder& response_encoder2 = openStream(response_decoder2, 3);
+
+  // Both responses are encoded in full before anything is written.
+  Event::MockTimer* send_timer = new NiceMock<Event::MockTimer>(&server_connection_.dispatcher_);
+  EXPECT_CALL(*send_timer, enableTimer(std::chrono::milliseconds(0))).Times(AtLeast(1));
+  TestHeaderMapImpl response_headers{{":status", "200"}};
+  for (StreamEncoder* encoder : {&response_encoder1, &response_encoder2}) {
+    encoder->encodeHeaders(response_headers, false);
+    Buffer::OwnedImpl body(std::string(4 * QUANTUM, 'a'));
+    encoder->encodeData(body, true);
+  }
+  EXPECT_TRUE(received_.empty());
+
+  // Once the loop gets to the timer, the bodies go out in quanta that alternate between streams.
+  send_timer->callback_();
+  ASSERT_EQ(8U, received_.size());
+  for (size_t i = 0; i < received_.size(); i++) {
+    EXPECT_EQ(i % 2 == 0 ? 1 : 3, received_[i].first);
+    EXPECT_EQ(QUANTUM, received_[i].second);
+  }
+}
+
+// Every dynamic table entry takes the size of the name and the value plus 32 octets.
+const size_t REQUEST_ID_ENTRY_SIZE = 12 + 36 + 32;
+const size_t OTHER_ENTRY_SIZE = 7 + 5 + 32;
+
+class Http2CodecImplHeaderIndexingTest : public testing::Test {
+public:
+  // Encode a request whose only headers that are not in the static table are x-request-id and
+  // x-other, and return the size of the client's dynamic table.
+  size_t encodeRequest(const Http2Settings& http2_settings) {
+    TestClientConnectionImpl client(connection_, callbacks_, stats_store_, http2_settings);
+    TestHeaderMapImpl request_headers{{":method", "GET"},
+                                      {":path", "/"},
+                                      {":scheme", "http"},
+                                      {"x-request-id", "25d2a0e2-1f9e-4d6c-9c0e-5a3a7f0b8f9c"},
+                                      {"x-other", "value"}};
+    client.newStream(response_decoder_).encodeHeaders(request_headers, true);
+    return nghttp2_session_get_hd_deflate_dynamic_table_size(client.session());
+  }
+
+  Stats::IsolatedStoreImpl stats_store_;
+  NiceMock<Network::MockConnection> connection_;
+  MockConnectionCallbacks callbacks_;
+  MockStreamDecoder response_decoder_;
+};
+
+TEST_F(Http2CodecImplHeaderIndexingTest, IndexAll) {
+  EXPECT_EQ(REQUEST_ID_ENTRY_SIZE + OTHER_ENTRY_SIZE, encodeRequest(Http2Settings()));
+}
+
+TEST_F(Http2CodecImplHeaderIndexingTest, NeverIndexHeaders) {
+  Http2Settings http2_settings;
+  http2_settings.never_index_headers_ = {"x-request-id"};
+  EXPECT_EQ(OTHER_ENTRY_SIZE, encodeRequest(http2_settings));
+}
+
+TEST_F(Http2CodecImplHeaderIndexingTest, EncoderTableSize) {
+  Http2Settings http2_settings;
+  // nghttp2 does not index entries that would take more than 3/4 of the table.
+  http2_settings.hpack_encoder_table_size_ = 2 * OTHER_ENTRY_SIZE;
+  EXPECT_EQ(OTHER_ENTRY_SIZE, encodeRequest(http2_settings));
+
+  http2_settings.hpack_encoder_table_size_ = 0;
+  EXPECT_EQ(0U, encodeRequest(http2_settings));
+}
+
 TEST(Http2CodecUtility, reconstituteCrumbledCookies) {
   {
     HeaderString key;
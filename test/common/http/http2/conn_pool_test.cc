@@ -406,6 +406,150 @@ TEST_F(Http2ConnPoolImplTest, GoAway) {
   EXPECT_EQ(1U, cluster_->stats_.upstream_cx_close_notify_.value());
 }
 
+TEST_F(Http2ConnPoolImplTest, MultipleConnectionsLeastActive) {
+  InSequence s;
+  cluster_->http2_settings_.max_connections_per_pool_ = 2;
+
+  expectClientCreate();
+  ActiveTestRequest r1(*this, 0);
+  expectClientConnect(0);
+
+  // The first connection is busy, so a second one is opened.
+  expectClientCreate();
+  ActiveTestRequest r2(*this, 1);
+  expectClientConnect(1);
+
+  // There can be no more connections, so the stream goes to the first of the least active ones.
+  ActiveTestRequest r3(*this, 0);
+
+  EXPECT_CALL(r2.inner_encoder_, encodeHeaders(_, true));
+  r2.callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+  EXPECT_CALL(r2.decoder_, decodeHeaders_(_, true));
+  r2.inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+
+  // The second connection is idle now.
+  ActiveTestRequest r4(*this, 1);
+
+  for (ActiveTestRequest* r : {&r1, &r3, &r4}) {
+    EXPECT_CALL(r->inner_encoder_, encodeHeaders(_, true));
+    r->callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+    EXPECT_CALL(r->decoder_, decodeHeaders_(_, true));
+    r->inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+  }
+
+  test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_CALL(*this, onClientDestroy()).Times(2);
+  dispatcher_.clearDeferredDeleteList();
+
+  EXPECT_EQ(2U, cluster_->stats_.upstream_cx_total_.value());
+  EXPECT_EQ(4U, cluster_->stats_.upstream_rq_total_.value());
+}
+
+TEST_F(Http2ConnPoolImplTest, MaxConcurrentStreams) {
+  InSequence s;
+  cluster_->http2_settings_.max_connections_per_pool_ = 2;
+
+  expectClientCreate();
+  ON_CALL(*test_clients_[0].codec_, maxConcurrentStreams()).WillByDefault(Return(1));
+  ActiveTestRequest r1(*this, 0);
+  expectClientConnect(0);
+
+  expectClientCreate();
+  ActiveTestRequest r2(*this, 1);
+  expectClientConnect(1);
+
+  // The first connection is at the limit of its peer, so the second one takes the stream even
+  // though both have as many active streams.
+  ActiveTestRequest r3(*this, 1);
+
+  for (ActiveTestRequest* r : {&r1, &r2, &r3}) {
+    EXPECT_CALL(r->inner_encoder_, encodeHeaders(_, true));
+    r->callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+    EXPECT_CALL(r->decoder_, decodeHeaders_(_, true));
+    r->inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+  }
+
+  test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_CALL(*this, onClientDestroy()).Times(2);
+  dispatcher_.clearDeferredDeleteList();
+}
+
+TEST_F(Http2ConnPoolImplTest, GoAwayMultipleConnections) {
+  InSequence s;
+  cluster_->http2_settings_.max_connections_per_pool_ = 2;
+
+  expectClientCreate();
+  ActiveTestRequest r1(*this, 0);
+  expectClientConnect(0);
+
+  expectClientCreate();
+  ActiveTestRequest r2(*this, 1);
+  expectClientConnect(1);
+
+  // The first connection drains, which makes room for another one.
+  test_clients_[0].codec_client_->raiseGoAway();
+  expectClientCreate();
+  ActiveTestRequest r3(*this, 2);
+  expectClientConnect(2);
+
+  // The draining connection is closed once its last stream completes.
+  EXPECT_CALL(r1.inner_encoder_, encodeHeaders(_, true));
+  r1.callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+  EXPECT_CALL(dispatcher_, deferredDelete_(_));
+  EXPECT_CALL(r1.decoder_, decodeHeaders_(_, true));
+  r1.inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+  EXPECT_CALL(*this, onClientDestroy());
+  dispatcher_.clearDeferredDeleteList();
+
+  for (ActiveTestRequest* r : {&r2, &r3}) {
+    EXPECT_CALL(r->inner_encoder_, encodeHeaders(_, true));
+    r->callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+    EXPECT_CALL(r->decoder_, decodeHeaders_(_, true));
+    r->inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+  }
+
+  test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  test_clients_[2].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_CALL(*this, onClientDestroy()).Times(2);
+  dispatcher_.clearDeferredDeleteList();
+
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_close_notify_.value());
+}
+
+TEST_F(Http2ConnPoolImplTest, MinWarmConnections) {
+  InSequence s;
+  cluster_->http2_settings_.max_connections_per_pool_ = 2;
+  cluster_->min_warm_connections_ = 3;
+
+  // No more connections are kept warm than streams are spread over.
+  expectClientCreate();
+  expectClientCreate();
+  pool_.prefetchConnections();
+  expectClientConnect(0);
+  expectClientConnect(1);
+  pool_.prefetchConnections();
+
+  ActiveTestRequest r1(*this, 0);
+  EXPECT_CALL(r1.inner_encoder_, encodeHeaders(_, true));
+  r1.callbacks_.outer_encoder_->encodeHeaders(HeaderMapImpl{}, true);
+  EXPECT_CALL(r1.decoder_, decodeHeaders_(_, true));
+  r1.inner_decoder_->decodeHeaders(HeaderMapPtr{new HeaderMapImpl{}}, true);
+
+  // A warm connection that the upstream closes is replaced.
+  expectClientCreate();
+  test_clients_[0].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_CALL(*this, onClientDestroy());
+  dispatcher_.clearDeferredDeleteList();
+
+  cluster_->min_warm_connections_ = 0;
+  test_clients_[1].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  test_clients_[2].connection_->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_CALL(*this, onClientDestroy()).Times(2);
+  dispatcher_.clearDeferredDeleteList();
+}
+
 } // namespace Http2
 } // namespace Http
 } // namespace Envoy
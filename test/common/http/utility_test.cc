@@ -1,5 +1,6 @@
 #include <cstdint>
 #include <string>
+#include <vector>
 
 #include "common/config/protocol_json.h"
 #include "common/http/exception.h"
@@ -7,12 +8,18 @@
 #include "common/http/utility.h"
 #include "common/network/address_impl.h"
 
+#include "test/mocks/buffer/mocks.h"
+#include "test/mocks/http/mocks.h"
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
 
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "spdlog/spdlog.h"
 
+using testing::_;
+using testing::Invoke;
+
 namespace Envoy {
 namespace Http {
 
@@ -28,6 +35,8 @@ TEST(HttpUtility, parseQueryString) {
             Utility::parseQueryString("/hello?hello=&hello2=world2"));
   EXPECT_EQ(Utility::QueryParams({{"name", "admin"}, {"level", "trace"}}),
             Utility::parseQueryString("/logging?name=admin&level=trace"));
+  EXPECT_EQ(Utility::QueryParams({{"unsorted", ""}, {"filter", "^foo"}}),
+            Utility::parseQueryString("/stats?unsorted&filter=^foo"));
 }
 
 TEST(HttpUtility, getResponseStatus) {
@@ -35,6 +44,18 @@ TEST(HttpUtility, getResponseStatus) {
   EXPECT_EQ(200U, Utility::getResponseStatus(TestHeaderMapImpl{{":status", "200"}}));
 }
 
+TEST(HttpUtility, appendHeaderValues) {
+  const std::vector<LowerCaseString> names{LowerCaseString("a"), LowerCaseString("b"),
+                                           LowerCaseString("c")};
+  std::string key = "prefix";
+  Utility::appendHeaderValues(TestHeaderMapImpl{{"a", "1"}, {"c", ""}}, names, key);
+  EXPECT_EQ("prefix\n=1\n\n=", key);
+
+  std::string empty_key;
+  Utility::appendHeaderValues(TestHeaderMapImpl{{"a", "1"}}, {}, empty_key);
+  EXPECT_EQ("", empty_key);
+}
+
 TEST(HttpUtility, isInternalRequest) {
   EXPECT_FALSE(Utility::isInternalRequest(TestHeaderMapImpl{}));
   EXPECT_FALSE(
@@ -119,6 +140,8 @@ TEST(HttpUtility, parseHttp2Settings) {
   {
     auto http2_settings = parseHttp2SettingsFromJson("{}");
     EXPECT_EQ(Http2Settings::DEFAULT_HPACK_TABLE_SIZE, http2_settings.hpack_table_size_);
+    EXPECT_EQ(Http2Settings::DEFAULT_HPACK_TABLE_SIZE, http2_settings.hpack_encoder_table_size_);
+    EXPECT_EQ(5U, http2_settings.never_index_headers_.size());
     EXPECT_EQ(Http2Settings::DEFAULT_MAX_CONCURRENT_STREAMS,
               http2_settings.max_concurrent_streams_);
     EXPECT_EQ(Http2Settings::DEFAULT_INITIAL_STREAM_WINDOW_SIZE,
@@ -137,6 +160,7 @@ TEST(HttpUtility, parseHttp2Settings) {
                                           }
                                         })raw");
     EXPECT_EQ(1U, http2_settings.hpack_table_size_);
+    EXPECT_EQ(1U, http2_settings.hpack_encoder_table_size_);
     EXPECT_EQ(2U, http2_settings.max_concurrent_streams_);
     EXPECT_EQ(3U, http2_settings.initial_stream_window_size_);
     EXPECT_EQ(4U, http2_settings.initial_connection_window_size_);
@@ -169,6 +193,11 @@ TEST(HttpUtility, OneAddressInXFF) {
   EXPECT_EQ(first_address, Utility::getLastAddressFromXFF(request_headers));
 }
 
+TEST(HttpUtility, TrailingSeparatorsInXFF) {
+  TestHeaderMapImpl request_headers{{"x-forwarded-for", "34.0.0.1, 10.0.0.1, , "}};
+  EXPECT_EQ("10.0.0.1", Utility::getLastAddressFromXFF(request_headers));
+}
+
 TEST(HttpUtility, TestParseCookie) {
   TestHeaderMapImpl headers{
       {"someheader", "10.0.0.1"},
@@ -206,5 +235,54 @@ TEST(HttpUtility, TestParseCookieWithQuotes) {
   EXPECT_EQ(Utility::parseCookieValue(headers, "leadingdquote"), "\"foobar");
 }
 
+TEST(HttpUtility, SendLocalReply) {
+  MockStreamDecoderFilterCallbacks callbacks;
+  bool is_reset = false;
+
+  EXPECT_CALL(callbacks, encodeHeaders_(_, false))
+      .WillOnce(Invoke([](HeaderMap& headers, bool) -> void {
+        EXPECT_STREQ("503", headers.Status()->value().c_str());
+        EXPECT_STREQ("5", headers.ContentLength()->value().c_str());
+        EXPECT_STREQ("text/plain", headers.ContentType()->value().c_str());
+      }));
+  Buffer::OwnedImpl moved;
+  EXPECT_CALL(callbacks, encodeData(BufferStringEqual("large"), true))
+      .WillOnce(Invoke([&moved](Buffer::Instance& data, bool) -> void { moved.move(data); }));
+  Utility::sendLocalReply(callbacks, is_reset, Code::ServiceUnavailable, "large");
+
+  // The body outlives the call when it is moved into another buffer.
+  EXPECT_EQ("large", TestUtility::bufferToString(moved));
+}
+
+TEST(HttpUtility, SendLocalReplyReusesBody) {
+  MockStreamDecoderFilterCallbacks callbacks;
+  bool is_reset = false;
+
+  std::vector<const void*> bodies;
+  EXPECT_CALL(callbacks, encodeHeaders_(_, false)).Times(2);
+  EXPECT_CALL(callbacks, encodeData(BufferStringEqual("no healthy upstream"), true))
+      .Times(2)
+      .WillRepeatedly(Invoke([&bodies](Buffer::Instance& data, bool) -> void {
+        Buffer::RawSlice slice;
+        data.getRawSlices(&slice, 1);
+        bodies.push_back(slice.mem_);
+      }));
+  Utility::sendLocalReply(callbacks, is_reset, Code::ServiceUnavailable, "no healthy upstream");
+  Utility::sendLocalReply(callbacks, is_reset, Code::ServiceUnavailable, "no healthy upstream");
+
+  // Both replies reference the body formatted for the first one.
+  ASSERT_EQ(2U, bodies.size());
+  EXPECT_EQ(bodies[0], bodies[1]);
+}
+
+TEST(HttpUtility, SendLocalReplyNoBody) {
+  MockStreamDecoderFilterCallbacks callbacks;
+  bool is_reset = false;
+
+  EXPECT_CALL(callbacks, encodeHeaders_(_, true));
+  EXPECT_CALL(callbacks, encodeData(_, _)).Times(0);
+  Utility::sendLocalReply(callbacks, is_reset, Code::ServiceUnavailable, "");
+}
+
 } // namespace Http
 } // namespace Envoy
@@ -289,6 +289,17 @@ TEST(JsonLoaderTest, Schema) {
     EXPECT_THROW(json->validateSchema(invalid_schema), Exception);
     EXPECT_THROW(json->validateSchema(different_schema), Exception);
     EXPECT_NO_THROW(json->validateSchema(valid_schema));
+
+    // Schemas are compiled once and reused, and a schema that fails to parse still fails.
+    EXPECT_THROW(json->validateSchema(invalid_json_schema), std::invalid_argument);
+    EXPECT_THROW(json->validateSchema(different_schema), Exception);
+    EXPECT_NO_THROW(json->validateSchema(valid_schema));
+
+    // A schema whose text changes is compiled again.
+    std::string schema = valid_schema;
+    EXPECT_NO_THROW(json->validateSchema(schema));
+    schema = different_schema;
+    EXPECT_THROW(json->validateSchema(schema), Exception);
   }
 
   {
@@ -12,8 +12,10 @@
 
 namespace Envoy {
 using testing::Eq;
+using testing::Invoke;
 using testing::NiceMock;
 using testing::Pointee;
+using testing::_;
 
 namespace Mongo {
 
@@ -156,6 +158,40 @@ TEST_F(MongoCodecImplTest, Reply) {
   decoder_.onData(output_);
 }
 
+TEST_F(MongoCodecImplTest, ReplyDocumentsDecodedOnAccess) {
+  ReplyMessageImpl reply(2, 2);
+  reply.numberReturned(2);
+  reply.documents().push_back(Bson::DocumentImpl::create()->addString("hello", "world"));
+  reply.documents().push_back(Bson::DocumentImpl::create());
+  EXPECT_EQ(2U, reply.numberOfDocuments());
+  EXPECT_EQ(27U, reply.documentsByteSize());
+
+  encoder_.encodeReply(reply);
+  EXPECT_CALL(callbacks_, decodeReply_(_)).WillOnce(Invoke([&](ReplyMessagePtr& message) -> void {
+    // The number and size of the documents are known before they are decoded.
+    EXPECT_EQ(2U, message->numberOfDocuments());
+    EXPECT_EQ(27U, message->documentsByteSize());
+    EXPECT_EQ(2, Json::Factory::loadFromString(message->toString(false))->getInteger("documents"));
+    EXPECT_EQ(reply, *message);
+    EXPECT_EQ(2U, message->numberOfDocuments());
+    EXPECT_EQ(27U, message->documentsByteSize());
+  }));
+  decoder_.onData(output_);
+}
+
+TEST_F(MongoCodecImplTest, ReplyInvalidDocumentLength) {
+  Bson::BufferHelper::writeInt32(output_, 16 + 20 + 4); // Size
+  Bson::BufferHelper::writeInt32(output_, 0);           // Request ID
+  Bson::BufferHelper::writeInt32(output_, 1);           // Response to
+  Bson::BufferHelper::writeInt32(output_, 1);           // OP_REPLY
+  Bson::BufferHelper::writeInt32(output_, 0);           // Flags
+  Bson::BufferHelper::writeInt64(output_, 0);           // Cursor ID
+  Bson::BufferHelper::writeInt32(output_, 0);           // Starting from
+  Bson::BufferHelper::writeInt32(output_, 1);           // Number returned
+  Bson::BufferHelper::writeInt32(output_, 40);          // Document length past the message
+  EXPECT_THROW(decoder_.onData(output_), EnvoyException);
+}
+
 TEST_F(MongoCodecImplTest, GetMoreEqual) {
   {
     GetMoreMessageImpl g1(0, 0);
@@ -0,0 +1,230 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/mongo/codec_impl.h"
+#include "common/mongo/conn_pool_impl.h"
+
+#include "test/mocks/mongo/mocks.h"
+#include "test/mocks/network/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+using testing::AtMost;
+using testing::Invoke;
+using testing::IsNull;
+using testing::NiceMock;
+using testing::Return;
+using testing::SaveArg;
+using testing::_;
+
+namespace Mongo {
+namespace ConnPool {
+
+class MongoConnPoolImplTest : public testing::Test {
+public:
+  void setup(uint32_t connections) {
+    conn_pool_.reset(new InstanceImpl("foo", cm_, tls_, connections));
+  }
+
+  Network::MockClientConnection* expectConnection() {
+    Network::MockClientConnection* connection = new NiceMock<Network::MockClientConnection>();
+    Upstream::MockHost::MockCreateConnectionData conn_info;
+    conn_info.connection_ = connection;
+    EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(IsNull())).WillOnce(Return(host_));
+    EXPECT_CALL(*host_, createConnection_(_)).WillOnce(Return(conn_info));
+    EXPECT_CALL(*connection, addReadFilter(_)).WillOnce(SaveArg<0>(&upstream_read_filter_));
+    EXPECT_CALL(*connection, connect());
+    EXPECT_CALL(*connection, noDelay(true));
+    ON_CALL(*connection, write(_)).WillByDefault(Invoke([this](Buffer::Instance& data) -> void {
+      written_.move(data);
+    }));
+    return connection;
+  }
+
+  void encode(Buffer::Instance& output, int32_t request_id, int32_t response_to,
+              Message::OpCode op, const std::string& body) {
+    const int32_t length = 16 + body.size();
+    EncoderImpl(output).encodeHeader({length, request_id, response_to, static_cast<int32_t>(op)});
+    output.add(body);
+  }
+
+  std::string message(int32_t request_id, int32_t response_to, Message::OpCode op,
+                      const std::string& body) {
+    Buffer::OwnedImpl buffer;
+    encode(buffer, request_id, response_to, op, body);
+    return TestUtility::bufferToString(buffer);
+  }
+
+  PoolRequest* makeRequest(int32_t request_id, const std::string& body,
+                           PoolCallbacks& callbacks) {
+    Buffer::OwnedImpl buffer(body);
+    return conn_pool_->makeRequest({static_cast<int32_t>(16 + body.size()), request_id, 0,
+                                    static_cast<int32_t>(Message::OpCode::OP_QUERY)},
+                                   buffer, callbacks);
+  }
+
+  NiceMock<Upstream::MockClusterManager> cm_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  std::shared_ptr<Upstream::MockHost> host_{new NiceMock<Upstream::MockHost>()};
+  Network::ReadFilterSharedPtr upstream_read_filter_;
+  Buffer::OwnedImpl written_;
+  InstanceSharedPtr conn_pool_;
+};
+
+TEST_F(MongoConnPoolImplTest, RequestAndReply) {
+  setup(1);
+  Network::MockClientConnection* connection = expectConnection();
+  MockPoolCallbacks callbacks;
+  EXPECT_NE(nullptr, makeRequest(7, "query", callbacks));
+  EXPECT_EQ(message(1, 0, Message::OpCode::OP_QUERY, "query"),
+            TestUtility::bufferToString(written_));
+  written_.drain(written_.length());
+  EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_cx_total_.value());
+
+  // Messages that get no reply share the connection, and still take a request ID.
+  Buffer::OwnedImpl insert("insert");
+  EXPECT_TRUE(conn_pool_->send({22, 8, 0, static_cast<int32_t>(Message::OpCode::OP_INSERT)},
+                               insert));
+  EXPECT_EQ(message(2, 0, Message::OpCode::OP_INSERT, "insert"),
+            TestUtility::bufferToString(written_));
+
+  // The reply arrives in two parts.
+  Buffer::OwnedImpl reply;
+  encode(reply, 100, 1, Message::OpCode::OP_REPLY, "reply");
+  Buffer::OwnedImpl first(reply.linearize(10), 10);
+  reply.drain(10);
+  upstream_read_filter_->onData(first);
+
+  EXPECT_CALL(callbacks, onReply(_, _))
+      .WillOnce(Invoke([](const MessageHeader& header, Buffer::Instance& body) -> void {
+        EXPECT_EQ(21, header.message_length_);
+        EXPECT_EQ(100, header.request_id_);
+        EXPECT_EQ(1, header.response_to_);
+        EXPECT_EQ("reply", TestUtility::bufferToString(body));
+      }));
+  upstream_read_filter_->onData(reply);
+
+  EXPECT_CALL(*connection, close(_));
+  tls_.shutdownThread();
+}
+
+TEST_F(MongoConnPoolImplTest, RoundRobin) {
+  setup(2);
+  Network::MockClientConnection* connection1 = expectConnection();
+  MockPoolCallbacks callbacks;
+  EXPECT_NE(nullptr, makeRequest(1, "a", callbacks));
+  Network::MockClientConnection* connection2 = expectConnection();
+  EXPECT_NE(nullptr, makeRequest(2, "b", callbacks));
+
+  // Both connections exist now.
+  EXPECT_CALL(*connection1, write(_));
+  EXPECT_NE(nullptr, makeRequest(3, "c", callbacks));
+  EXPECT_EQ(2UL, host_->cluster_.stats_.upstream_cx_total_.value());
+
+  EXPECT_CALL(callbacks, onFailure()).Times(3);
+  EXPECT_CALL(*connection1, close(_));
+  EXPECT_CALL(*connection2, close(_));
+  tls_.shutdownThread();
+}
+
+TEST_F(MongoConnPoolImplTest, NoHost) {
+  setup(1);
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(IsNull())).WillRepeatedly(Return(nullptr));
+  MockPoolCallbacks callbacks;
+  EXPECT_EQ(nullptr, makeRequest(1, "query", callbacks));
+  Buffer::OwnedImpl insert("insert");
+  EXPECT_FALSE(conn_pool_->send({22, 2, 0, static_cast<int32_t>(Message::OpCode::OP_INSERT)},
+                                insert));
+  tls_.shutdownThread();
+}
+
+TEST_F(MongoConnPoolImplTest, Cancel) {
+  setup(1);
+  Network::MockClientConnection* connection = expectConnection();
+  MockPoolCallbacks callbacks;
+  PoolRequest* request = makeRequest(1, "query", callbacks);
+  request->cancel();
+
+  Buffer::OwnedImpl reply;
+  encode(reply, 100, 1, Message::OpCode::OP_REPLY, "reply");
+  upstream_read_filter_->onData(reply);
+  EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_rq_cancelled_.value());
+
+  EXPECT_CALL(*connection, close(_));
+  tls_.shutdownThread();
+}
+
+TEST_F(MongoConnPoolImplTest, RemoteClose) {
+  setup(1);
+  Network::MockClientConnection* connection = expectConnection();
+  MockPoolCallbacks callbacks1;
+  MockPoolCallbacks callbacks2;
+  PoolRequest* request1 = makeRequest(1, "query", callbacks1);
+  PoolRequest* request2 = makeRequest(2, "query", callbacks2);
+
+  // The first failure cancels the other request, as a downstream connection closing would.
+  uint32_t failures = 0;
+  EXPECT_CALL(callbacks1, onFailure()).Times(AtMost(1)).WillOnce(Invoke([&]() -> void {
+    failures++;
+    request2->cancel();
+  }));
+  EXPECT_CALL(callbacks2, onFailure()).Times(AtMost(1)).WillOnce(Invoke([&]() -> void {
+    failures++;
+    request1->cancel();
+  }));
+  connection->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_EQ(1U, failures);
+  EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_rq_cancelled_.value());
+  EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_cx_destroy_with_active_rq_.value());
+  EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_cx_connect_fail_.value());
+
+  // The next request makes a new connection.
+  Network::MockClientConnection* connection2 = expectConnection();
+  EXPECT_NE(nullptr, makeRequest(3, "query", callbacks1));
+
+  EXPECT_CALL(*connection2, close(_));
+  EXPECT_CALL(callbacks1, onFailure());
+  tls_.shutdownThread();
+}
+
+TEST_F(MongoConnPoolImplTest, InvalidReplyLength) {
+  setup(1);
+  Network::MockClientConnection* connection = expectConnection();
+  MockPoolCallbacks callbacks;
+  makeRequest(1, "query", callbacks);
+  connection->raiseEvent(Network::ConnectionEvent::Connected);
+
+  Buffer::OwnedImpl reply;
+  EncoderImpl(reply).encodeHeader({8, 100, 1, static_cast<int32_t>(Message::OpCode::OP_REPLY)});
+  EXPECT_CALL(callbacks, onFailure());
+  EXPECT_CALL(*connection, close(_));
+  upstream_read_filter_->onData(reply);
+  EXPECT_EQ(1UL, host_->cluster_.stats_.upstream_cx_protocol_error_.value());
+  EXPECT_EQ(0UL, host_->cluster_.stats_.upstream_cx_connect_fail_.value());
+
+  tls_.shutdownThread();
+}
+
+TEST_F(MongoConnPoolImplTest, HostRemoved) {
+  setup(1);
+  Network::MockClientConnection* connection = expectConnection();
+  MockPoolCallbacks callbacks;
+  makeRequest(1, "query", callbacks);
+
+  EXPECT_CALL(callbacks, onFailure());
+  EXPECT_CALL(*connection, close(_));
+  cm_.thread_local_cluster_.cluster_.runCallbacks({}, {host_});
+
+  tls_.shutdownThread();
+}
+
+} // namespace ConnPool
+} // namespace Mongo
+} // namespace Envoy
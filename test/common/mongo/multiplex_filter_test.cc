@@ -0,0 +1,141 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/mongo/codec_impl.h"
+#include "common/mongo/multiplex_filter.h"
+
+#include "test/mocks/mongo/mocks.h"
+#include "test/mocks/network/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Mongo {
+
+class MongoMultiplexFilterTest : public testing::Test {
+public:
+  MongoMultiplexFilterTest() {
+    filter_.reset(new MultiplexFilter(conn_pool_));
+    filter_->initializeReadFilterCallbacks(read_callbacks_);
+    ON_CALL(read_callbacks_.connection_, write(_))
+        .WillByDefault(Invoke([this](Buffer::Instance& data) -> void { written_.move(data); }));
+  }
+
+  void encode(Buffer::Instance& output, int32_t request_id, int32_t response_to,
+              Message::OpCode op, const std::string& body) {
+    const int32_t length = 16 + body.size();
+    EncoderImpl(output).encodeHeader({length, request_id, response_to, static_cast<int32_t>(op)});
+    output.add(body);
+  }
+
+  // Expects a request to the pool, and saves its callbacks.
+  void expectRequest(int32_t request_id, const std::string& body,
+                     ConnPool::PoolRequest* handle) {
+    EXPECT_CALL(*conn_pool_, makeRequest(_, _, _))
+        .WillOnce(Invoke([this, request_id, body, handle](
+                             const MessageHeader& header, Buffer::Instance& data,
+                             ConnPool::PoolCallbacks& callbacks) -> ConnPool::PoolRequest* {
+          EXPECT_EQ(request_id, header.request_id_);
+          EXPECT_EQ(body, TestUtility::bufferToString(data));
+          pool_callbacks_ = &callbacks;
+          return handle;
+        }));
+  }
+
+  std::shared_ptr<ConnPool::MockInstance> conn_pool_{new ConnPool::MockInstance()};
+  NiceMock<Network::MockReadFilterCallbacks> read_callbacks_;
+  std::unique_ptr<MultiplexFilter> filter_;
+  ConnPool::PoolCallbacks* pool_callbacks_{};
+  Buffer::OwnedImpl written_;
+};
+
+TEST_F(MongoMultiplexFilterTest, QueryAndReply) {
+  ConnPool::MockPoolRequest pool_request;
+  Buffer::OwnedImpl data;
+  encode(data, 5, 0, Message::OpCode::OP_QUERY, "query");
+
+  // The message is forwarded once it has all arrived.
+  Buffer::OwnedImpl first(data.linearize(18), 18);
+  data.drain(18);
+  EXPECT_EQ(Network::FilterStatus::StopIteration, filter_->onData(first));
+  expectRequest(5, "query", &pool_request);
+  EXPECT_EQ(Network::FilterStatus::StopIteration, filter_->onData(data));
+
+  // The reply goes back with the request ID of the downstream client.
+  Buffer::OwnedImpl body("reply");
+  pool_callbacks_->onReply({21, 100, 1, static_cast<int32_t>(Message::OpCode::OP_REPLY)}, body);
+  Buffer::OwnedImpl expected;
+  encode(expected, 100, 5, Message::OpCode::OP_REPLY, "reply");
+  EXPECT_EQ(TestUtility::bufferToString(expected), TestUtility::bufferToString(written_));
+
+  // The request is done, so closing doesn't cancel it.
+  EXPECT_CALL(pool_request, cancel()).Times(0);
+  read_callbacks_.connection_.raiseEvent(Network::ConnectionEvent::RemoteClose);
+}
+
+TEST_F(MongoMultiplexFilterTest, MessagesWithoutReply) {
+  Buffer::OwnedImpl data;
+  encode(data, 1, 0, Message::OpCode::OP_INSERT, "insert");
+  encode(data, 2, 0, Message::OpCode::OP_UPDATE, "update");
+  encode(data, 3, 0, Message::OpCode::OP_DELETE, "delete");
+  encode(data, 4, 0, Message::OpCode::OP_KILL_CURSORS, "kill");
+  EXPECT_CALL(*conn_pool_, send(_, _)).Times(4).WillRepeatedly(Return(true));
+  EXPECT_EQ(Network::FilterStatus::StopIteration, filter_->onData(data));
+  EXPECT_EQ(0UL, data.length());
+}
+
+TEST_F(MongoMultiplexFilterTest, UnsupportedOp) {
+  Buffer::OwnedImpl data;
+  encode(data, 1, 0, Message::OpCode::OP_MSG, "msg");
+  encode(data, 2, 0, Message::OpCode::OP_INSERT, "insert");
+  EXPECT_CALL(*conn_pool_, send(_, _)).Times(0);
+  EXPECT_CALL(read_callbacks_.connection_, close(Network::ConnectionCloseType::NoFlush));
+  filter_->onData(data);
+}
+
+TEST_F(MongoMultiplexFilterTest, InvalidLength) {
+  Buffer::OwnedImpl data;
+  EncoderImpl(data).encodeHeader({4, 1, 0, static_cast<int32_t>(Message::OpCode::OP_QUERY)});
+  EXPECT_CALL(read_callbacks_.connection_, close(Network::ConnectionCloseType::NoFlush));
+  filter_->onData(data);
+}
+
+TEST_F(MongoMultiplexFilterTest, NoUpstream) {
+  Buffer::OwnedImpl data;
+  encode(data, 1, 0, Message::OpCode::OP_QUERY, "query");
+  expectRequest(1, "query", nullptr);
+  EXPECT_CALL(read_callbacks_.connection_, close(Network::ConnectionCloseType::NoFlush));
+  filter_->onData(data);
+}
+
+TEST_F(MongoMultiplexFilterTest, FailureClosesConnection) {
+  ConnPool::MockPoolRequest pool_request1;
+  ConnPool::MockPoolRequest pool_request2;
+  Buffer::OwnedImpl data;
+  encode(data, 1, 0, Message::OpCode::OP_QUERY, "query1");
+  expectRequest(1, "query1", &pool_request1);
+  filter_->onData(data);
+  ConnPool::PoolCallbacks* callbacks1 = pool_callbacks_;
+
+  encode(data, 2, 0, Message::OpCode::OP_GET_MORE, "get_more");
+  expectRequest(2, "get_more", &pool_request2);
+  filter_->onData(data);
+
+  // The other request is canceled when the connection closes.
+  EXPECT_CALL(read_callbacks_.connection_, close(Network::ConnectionCloseType::NoFlush));
+  EXPECT_CALL(pool_request1, cancel()).Times(0);
+  EXPECT_CALL(pool_request2, cancel());
+  callbacks1->onFailure();
+}
+
+} // namespace Mongo
+} // namespace Envoy
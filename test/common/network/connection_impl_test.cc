@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -29,6 +30,7 @@ using testing::AnyNumber;
 using testing::DoAll;
 using testing::InSequence;
 using testing::Invoke;
+using testing::NiceMock;
 using testing::Return;
 using testing::Sequence;
 using testing::StrictMock;
@@ -60,6 +62,27 @@ TEST(ConnectionImplUtility, updateBufferStats) {
   ConnectionImplUtility::updateBufferStats(3, 3, previous_total, counter, gauge);
 }
 
+TEST(ConnectionImplUtility, nextReadSize) {
+  const uint64_t max = ConnectionImplUtility::MAX_READ_SIZE;
+
+  // Full reads grow the read size up to the max.
+  EXPECT_EQ(32768UL, ConnectionImplUtility::nextReadSize(16384, 16384, max));
+  EXPECT_EQ(max, ConnectionImplUtility::nextReadSize(max, max, max));
+  EXPECT_EQ(65536UL, ConnectionImplUtility::nextReadSize(65536, 65536, 65536));
+
+  // Reads that return at least half keep the size.
+  EXPECT_EQ(16384UL, ConnectionImplUtility::nextReadSize(16384, 8192, max));
+
+  // Short reads shrink the read size down to the min.
+  EXPECT_EQ(8192UL, ConnectionImplUtility::nextReadSize(16384, 100, max));
+  EXPECT_EQ(ConnectionImplUtility::MIN_READ_SIZE,
+            ConnectionImplUtility::nextReadSize(ConnectionImplUtility::MIN_READ_SIZE, 1, max));
+
+  // A max below the min (e.g. a tiny buffer limit) still reads the min.
+  EXPECT_EQ(ConnectionImplUtility::MIN_READ_SIZE,
+            ConnectionImplUtility::nextReadSize(16384, 16384, 2));
+}
+
 class ConnectionImplDeathTest : public testing::TestWithParam<Address::IpVersion> {};
 INSTANTIATE_TEST_CASE_P(IpVersions, ConnectionImplDeathTest,
                         testing::ValuesIn(TestEnvironment::getIpVersionsForTest()));
@@ -345,9 +368,9 @@ TEST_P(ConnectionImplTest, BasicWrite) {
   std::string data_to_write = "hello world";
   Buffer::OwnedImpl buffer_to_write(data_to_write);
   std::string data_written;
-  EXPECT_CALL(*client_write_buffer_, move(_))
+  EXPECT_CALL(*client_write_buffer_, add(_))
       .WillRepeatedly(DoAll(AddBufferToStringWithoutDraining(&data_written),
-                            Invoke(client_write_buffer_, &MockBuffer::baseMove)));
+                            Invoke(client_write_buffer_, &MockBuffer::baseAdd)));
   EXPECT_CALL(*client_write_buffer_, write(_))
       .WillOnce(Invoke(client_write_buffer_, &MockBuffer::trackWrites));
   client_connection_->write(buffer_to_write);
@@ -357,6 +380,102 @@ TEST_P(ConnectionImplTest, BasicWrite) {
   disconnect(true);
 }
 
+#ifdef __linux__
+// Data read from a spliced connection bypasses its read filters and goes straight to the socket of
+// the peer.
+TEST_P(ConnectionImplTest, Splice) {
+  setUpBasicConnection();
+  connect();
+
+  // A second connection through the listener, whose client end the server connection splices to.
+  int expected_callbacks = 2;
+  ClientConnectionPtr splice_client =
+      dispatcher_->createClientConnection(socket_.localAddress(), source_address_);
+  NiceMock<MockConnectionCallbacks> splice_client_callbacks;
+  splice_client->addConnectionCallbacks(splice_client_callbacks);
+  ConnectionPtr splice_server;
+  std::shared_ptr<MockReadFilter> splice_read_filter(new NiceMock<MockReadFilter>());
+  EXPECT_CALL(listener_callbacks_, onNewConnection_(_))
+      .WillOnce(Invoke([&](Network::ConnectionPtr& conn) -> void {
+        splice_server = std::move(conn);
+        splice_server->addReadFilter(splice_read_filter);
+        if (--expected_callbacks == 0) {
+          dispatcher_->exit();
+        }
+      }));
+  EXPECT_CALL(splice_client_callbacks, onEvent(ConnectionEvent::Connected))
+      .WillOnce(Invoke([&](Network::ConnectionEvent) -> void {
+        if (--expected_callbacks == 0) {
+          dispatcher_->exit();
+        }
+      }));
+  splice_client->connect();
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+
+  EXPECT_TRUE(server_connection_->spliceTo(*splice_client));
+  // A connection only has one source splicing to it.
+  EXPECT_FALSE(client_connection_->spliceTo(*splice_client));
+
+  EXPECT_CALL(*read_filter_, onData(_)).Times(0);
+  std::string data_read;
+  EXPECT_CALL(*splice_read_filter, onData(_))
+      .WillRepeatedly(Invoke([&](Buffer::Instance& data) -> FilterStatus {
+        data_read += TestUtility::bufferToString(data);
+        data.drain(data.length());
+        if (data_read.size() == 11) {
+          dispatcher_->exit();
+        }
+        return FilterStatus::StopIteration;
+      }));
+
+  Buffer::OwnedImpl buffer("hello world");
+  client_connection_->write(buffer);
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ("hello world", data_read);
+
+  splice_client->close(ConnectionCloseType::NoFlush);
+  splice_server->close(ConnectionCloseType::NoFlush);
+  disconnect(true);
+}
+#endif
+
+// Small writes within one dispatcher iteration are copied into the write buffer and flushed with a
+// single write() call, while large writes are still moved.
+TEST_P(ConnectionImplTest, CoalesceSmallWrites) {
+  useMockBuffer();
+
+  setUpBasicConnection();
+
+  connect();
+
+  std::string small_data(16, 'a');
+  std::string large_data(ConnectionImplUtility::COALESCE_WRITE_SIZE + 1, 'b');
+  Buffer::OwnedImpl first_buffer_to_write(small_data);
+  Buffer::OwnedImpl second_buffer_to_write(small_data);
+  Buffer::OwnedImpl third_buffer_to_write(large_data);
+  EXPECT_CALL(*client_write_buffer_, add(_))
+      .Times(2)
+      .WillRepeatedly(Invoke(client_write_buffer_, &MockBuffer::baseAdd));
+  EXPECT_CALL(*client_write_buffer_, move(_))
+      .WillOnce(Invoke(client_write_buffer_, &MockBuffer::baseMove));
+  EXPECT_CALL(*client_write_buffer_, write(_))
+      .WillOnce(Invoke(client_write_buffer_, &MockBuffer::trackWrites));
+  client_connection_->write(first_buffer_to_write);
+  client_connection_->write(second_buffer_to_write);
+  client_connection_->write(third_buffer_to_write);
+  EXPECT_EQ(0, first_buffer_to_write.length());
+  EXPECT_EQ(0, second_buffer_to_write.length());
+  EXPECT_EQ(0, third_buffer_to_write.length());
+
+  // Both small writes share the slice at the end of the write buffer.
+  EXPECT_EQ(2, client_write_buffer_->getRawSlices(nullptr, 0));
+  dispatcher_->run(Event::Dispatcher::RunType::NonBlock);
+  EXPECT_EQ(static_cast<int>(2 * small_data.size() + large_data.size()),
+            client_write_buffer_->bytes_written());
+
+  disconnect(true);
+}
+
 // Similar to BasicWrite, only with watermarks set.
 TEST_P(ConnectionImplTest, WriteWithWatermarks) {
   useMockBuffer();
@@ -370,9 +489,9 @@ TEST_P(ConnectionImplTest, WriteWithWatermarks) {
   std::string data_to_write = "hello world";
   Buffer::OwnedImpl first_buffer_to_write(data_to_write);
   std::string data_written;
-  EXPECT_CALL(*client_write_buffer_, move(_))
+  EXPECT_CALL(*client_write_buffer_, add(_))
       .WillRepeatedly(DoAll(AddBufferToStringWithoutDraining(&data_written),
-                            Invoke(client_write_buffer_, &MockBuffer::baseMove)));
+                            Invoke(client_write_buffer_, &MockBuffer::baseAdd)));
   EXPECT_CALL(*client_write_buffer_, write(_))
       .WillOnce(Invoke(client_write_buffer_, &MockBuffer::trackWrites));
   // The write() call on the connection will buffer enough data to bring the connection above the
@@ -389,9 +508,9 @@ TEST_P(ConnectionImplTest, WriteWithWatermarks) {
   // with errno set to EAGAIN via failWrite().  This should result in going above the high
   // watermark and not returning.
   Buffer::OwnedImpl second_buffer_to_write(data_to_write);
-  EXPECT_CALL(*client_write_buffer_, move(_))
+  EXPECT_CALL(*client_write_buffer_, add(_))
       .WillRepeatedly(DoAll(AddBufferToStringWithoutDraining(&data_written),
-                            Invoke(client_write_buffer_, &MockBuffer::baseMove)));
+                            Invoke(client_write_buffer_, &MockBuffer::baseAdd)));
   EXPECT_CALL(*client_write_buffer_, write(_)).WillOnce(Invoke([&](int fd) -> int {
     dispatcher_->exit();
     return client_write_buffer_->failWrite(fd);
@@ -472,8 +591,8 @@ TEST_P(ConnectionImplTest, WatermarkFuzzing) {
 
     // Do the actual work.  Write |buffer_to_write| bytes to the connection and
     // drain |bytes_to_flush| before having the buffer failWrite()
-    EXPECT_CALL(*client_write_buffer_, move(_))
-        .WillOnce(Invoke(client_write_buffer_, &MockBuffer::baseMove));
+    EXPECT_CALL(*client_write_buffer_, add(_))
+        .WillOnce(Invoke(client_write_buffer_, &MockBuffer::baseAdd));
     EXPECT_CALL(*client_write_buffer_, write(_))
         .WillOnce(DoAll(Invoke([&](int) -> void { client_write_buffer_->drain(bytes_to_flush); }),
                         Return(bytes_to_flush)))
@@ -502,6 +621,103 @@ TEST_P(ConnectionImplTest, BindTest) {
   disconnect(true);
 }
 
+// A connection that uses up its event byte budget continues from a new event, so all data still
+// arrives.
+TEST_P(ConnectionImplTest, EventByteBudget) {
+  setUpBasicConnection();
+  connect();
+
+  Stats::Counter& read_exhausted = stats_store_.counter("read_budget_exhausted");
+  server_connection_->setEventByteBudget(4096, read_exhausted,
+                                         stats_store_.counter("write_budget_exhausted"));
+
+  const uint64_t buffer_size = 256 * 1024;
+  uint64_t filter_seen = 0;
+  EXPECT_CALL(*read_filter_, onData(_))
+      .WillRepeatedly(Invoke([&](Buffer::Instance& data) -> FilterStatus {
+        filter_seen += data.length();
+        data.drain(data.length());
+        if (filter_seen == buffer_size) {
+          dispatcher_->exit();
+        }
+        return FilterStatus::StopIteration;
+      }));
+
+  Buffer::OwnedImpl data(std::string(buffer_size, 'a'));
+  client_connection_->write(data);
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ(buffer_size, filter_seen);
+  EXPECT_LT(0U, read_exhausted.value());
+
+  disconnect(true);
+}
+
+#ifdef __linux__
+// Data written before a TCP Fast Open connect is delivered, whether or not the SYN carried it.
+TEST_P(ConnectionImplTest, TcpFastOpen) {
+  setUpBasicConnection();
+  client_connection_->enableTcpFastOpen(stats_store_.counter("tcp_fast_open"));
+
+  Buffer::OwnedImpl buffer("hello world");
+  client_connection_->write(buffer);
+  client_connection_->connect();
+
+  read_filter_.reset(new NiceMock<MockReadFilter>());
+  EXPECT_CALL(listener_callbacks_, onNewConnection_(_))
+      .WillOnce(Invoke([&](Network::ConnectionPtr& conn) -> void {
+        server_connection_ = std::move(conn);
+        server_connection_->addConnectionCallbacks(server_callbacks_);
+        server_connection_->addReadFilter(read_filter_);
+      }));
+  EXPECT_CALL(client_callbacks_, onEvent(ConnectionEvent::Connected));
+  EXPECT_CALL(*read_filter_, onData(_))
+      .WillOnce(Invoke([&](Buffer::Instance& data) -> FilterStatus {
+        EXPECT_EQ("hello world", TestUtility::bufferToString(data));
+        data.drain(data.length());
+        dispatcher_->exit();
+        return FilterStatus::StopIteration;
+      }));
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+
+  disconnect(true);
+}
+#endif
+
+// A connect that fails falls back right away, without waiting for the fallback delay.
+TEST_P(ConnectionImplTest, HappyEyeballsFallback) {
+  dispatcher_.reset(new Event::DispatcherImpl);
+  listener_ =
+      dispatcher_->createListener(connection_handler_, socket_, listener_callbacks_, stats_store_,
+                                  Network::ListenerOptions::listenerOptionsWithBindToPort());
+  // Nothing listens on port 1, so the connect is refused.
+  client_connection_ = dispatcher_->createClientConnection(
+      Utility::resolveUrl(
+          fmt::format("tcp://{}:1", Network::Test::getLoopbackAddressUrlString(GetParam()))),
+      source_address_);
+  client_connection_->addConnectionCallbacks(client_callbacks_);
+  client_connection_->enableHappyEyeballs(socket_.localAddress(), std::chrono::seconds(60));
+  client_connection_->noDelay(true);
+
+  connect();
+  EXPECT_EQ(socket_.localAddress()->asString(), client_connection_->remoteAddress().asString());
+
+  disconnect(true);
+}
+
+// The fallback connect starts after the delay and is closed once the first connect succeeds.
+TEST_P(ConnectionImplTest, HappyEyeballsFirstConnectWins) {
+  setUpBasicConnection();
+  client_connection_->enableHappyEyeballs(
+      Utility::resolveUrl(
+          fmt::format("tcp://{}:1", Network::Test::getLoopbackAddressUrlString(GetParam()))),
+      std::chrono::milliseconds(0));
+
+  connect();
+  EXPECT_EQ(socket_.localAddress()->asString(), client_connection_->remoteAddress().asString());
+
+  disconnect(true);
+}
+
 class ReadBufferLimitTest : public ConnectionImplTest {
 public:
   void readBufferLimitTest(uint32_t read_buffer_limit, uint32_t expected_chunk_size) {
@@ -49,8 +49,9 @@ enum record_type { A, AAAA };
 
 class TestDnsServerQuery {
 public:
-  TestDnsServerQuery(ConnectionPtr connection, const HostMap& hosts_A, const HostMap& hosts_AAAA)
-      : connection_(std::move(connection)), hosts_A_(hosts_A), hosts_AAAA_(hosts_AAAA) {
+  TestDnsServerQuery(ConnectionPtr connection, const HostMap& hosts_A, const HostMap& hosts_AAAA,
+                     const uint32_t& ttl)
+      : connection_(std::move(connection)), hosts_A_(hosts_A), hosts_AAAA_(hosts_AAAA), ttl_(ttl) {
     connection_->addReadFilter(Network::ReadFilterSharedPtr{new ReadFilter(*this)});
   }
 
@@ -143,7 +144,7 @@ private:
           DNS_RR_SET_LEN(response_rr_fixed, sizeof(in6_addr));
         }
         DNS_RR_SET_CLASS(response_rr_fixed, C_IN);
-        DNS_RR_SET_TTL(response_rr_fixed, 0);
+        DNS_RR_SET_TTL(response_rr_fixed, parent_.ttl_);
 
         size_t response_rest_len;
         if (q_type == T_A) {
@@ -194,13 +195,19 @@ private:
   ConnectionPtr connection_;
   const HostMap& hosts_A_;
   const HostMap& hosts_AAAA_;
+  const uint32_t& ttl_;
 };
 
 class TestDnsServer : public ListenerCallbacks {
 public:
+  bool onAccept(int, Address::InstanceConstSharedPtr, Address::InstanceConstSharedPtr,
+                bool) override {
+    return false;
+  }
+
   void onNewConnection(ConnectionPtr&& new_connection) override {
     TestDnsServerQuery* query =
-        new TestDnsServerQuery(std::move(new_connection), hosts_A_, hosts_AAAA_);
+        new TestDnsServerQuery(std::move(new_connection), hosts_A_, hosts_AAAA_, ttl_);
     queries_.emplace_back(query);
   }
 
@@ -212,9 +219,13 @@ public:
     }
   }
 
+  // TTL of the answered records.
+  void setTtl(uint32_t ttl) { ttl_ = ttl; }
+
 private:
   HostMap hosts_A_;
   HostMap hosts_AAAA_;
+  uint32_t ttl_{};
   // All queries are tracked so we can do resource reclamation when the test is
   // over.
   std::vector<std::unique_ptr<TestDnsServerQuery>> queries_;
@@ -384,8 +395,9 @@ TEST_P(DnsImplTest, LocalLookup) {
                                    address_list = results;
                                  }))
         << error_msg;
-    EXPECT_FALSE(hasAddress(address_list, "127.0.0.1"));
-    EXPECT_TRUE(hasAddress(address_list, "::1")) << error_msg;
+    // Auto resolves both families, IPv6 first.
+    ASSERT_FALSE(address_list.empty()) << error_msg;
+    EXPECT_EQ("::1", address_list.front()->ip()->addressAsString()) << error_msg;
   }
 }
 
@@ -527,6 +539,8 @@ TEST_P(DnsImplTest, MultiARecordLookupWithV6) {
   EXPECT_TRUE(hasAddress(address_list, "1::2"));
   EXPECT_TRUE(hasAddress(address_list, "1::2:3"));
   EXPECT_TRUE(hasAddress(address_list, "1::2:3:4"));
+  EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+  EXPECT_EQ(6U, address_list.size());
 
   EXPECT_NE(nullptr,
             resolver_->resolve("some.good.domain", DnsLookupFamily::V6Only,
@@ -541,6 +555,37 @@ TEST_P(DnsImplTest, MultiARecordLookupWithV6) {
   EXPECT_TRUE(hasAddress(address_list, "1::2:3:4"));
 }
 
+// Validate that Auto queries both families at the same time, returns the IPv6 addresses first and
+// still succeeds if only one family resolves.
+TEST_P(DnsImplTest, AutoResolvesBothFamilies) {
+  server_->addHosts("some.good.domain", {"201.134.56.7"}, A);
+  server_->addHosts("some.good.domain", {"1::2"}, AAAA);
+  server_->addHosts("v4.good.domain", {"123.4.5.6"}, A);
+  std::list<Address::InstanceConstSharedPtr> address_list;
+  EXPECT_NE(nullptr,
+            resolver_->resolve("some.good.domain", DnsLookupFamily::Auto,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list = results;
+                                 dispatcher_.exit();
+                               }));
+
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  ASSERT_EQ(2U, address_list.size());
+  EXPECT_EQ("1::2", address_list.front()->ip()->addressAsString());
+  EXPECT_EQ("201.134.56.7", address_list.back()->ip()->addressAsString());
+
+  EXPECT_NE(nullptr,
+            resolver_->resolve("v4.good.domain", DnsLookupFamily::Auto,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list = results;
+                                 dispatcher_.exit();
+                               }));
+
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  ASSERT_EQ(1U, address_list.size());
+  EXPECT_EQ("123.4.5.6", address_list.front()->ip()->addressAsString());
+}
+
 // Validate working of cancellation provided by ActiveDnsQuery return.
 TEST_P(DnsImplTest, Cancel) {
   server_->addHosts("some.good.domain", {"201.134.56.7"}, A);
@@ -564,6 +609,92 @@ TEST_P(DnsImplTest, Cancel) {
   EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
 }
 
+// Validate that answers with a TTL are cached, and a resolution of a cached name completes
+// synchronously with the cached addresses.
+TEST_P(DnsImplTest, CachedResolution) {
+  server_->setTtl(300);
+  server_->addHosts("some.good.domain", {"201.134.56.7"}, A);
+  std::list<Address::InstanceConstSharedPtr> address_list;
+  EXPECT_NE(nullptr,
+            resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list = results;
+                                 dispatcher_.exit();
+                               }));
+
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+
+  // The server answer changes, but the cached one is still fresh.
+  server_->addHosts("some.good.domain", {"123.4.5.6"}, A);
+  address_list.clear();
+  EXPECT_EQ(nullptr,
+            resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list = results;
+                               }));
+  EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+
+  // The cache is per lookup family.
+  EXPECT_NE(nullptr,
+            resolver_->resolve("some.good.domain", DnsLookupFamily::Auto,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list = results;
+                                 dispatcher_.exit();
+                               }));
+
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_TRUE(hasAddress(address_list, "123.4.5.6"));
+}
+
+// Validate that answers with a zero TTL are not cached.
+TEST_P(DnsImplTest, ZeroTtlNotCached) {
+  server_->addHosts("some.good.domain", {"201.134.56.7"}, A);
+  for (int i = 0; i < 2; ++i) {
+    std::list<Address::InstanceConstSharedPtr> address_list;
+    EXPECT_NE(nullptr,
+              resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                                 [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                   address_list = results;
+                                   dispatcher_.exit();
+                                 }));
+
+    dispatcher_.run(Event::Dispatcher::RunType::Block);
+    EXPECT_TRUE(hasAddress(address_list, "201.134.56.7"));
+  }
+}
+
+// Validate that concurrent resolutions of a name share one query, and cancelling one of them
+// doesn't affect the others.
+TEST_P(DnsImplTest, CollapsedResolution) {
+  server_->addHosts("some.good.domain", {"201.134.56.7"}, A);
+
+  ActiveDnsQuery* query =
+      resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                         [](std::list<Address::InstanceConstSharedPtr> &&) -> void { FAIL(); });
+
+  std::list<Address::InstanceConstSharedPtr> address_list1;
+  std::list<Address::InstanceConstSharedPtr> address_list2;
+  EXPECT_NE(nullptr,
+            resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list1 = results;
+                               }));
+  EXPECT_NE(nullptr,
+            resolver_->resolve("some.good.domain", DnsLookupFamily::V4Only,
+                               [&](std::list<Address::InstanceConstSharedPtr>&& results) -> void {
+                                 address_list2 = results;
+                                 dispatcher_.exit();
+                               }));
+
+  ASSERT_NE(nullptr, query);
+  query->cancel();
+
+  dispatcher_.run(Event::Dispatcher::RunType::Block);
+  EXPECT_TRUE(hasAddress(address_list1, "201.134.56.7"));
+  EXPECT_TRUE(hasAddress(address_list2, "201.134.56.7"));
+}
+
 class DnsImplZeroTimeoutTest : public DnsImplTest {
 protected:
   bool zero_timeout() const override { return true; }
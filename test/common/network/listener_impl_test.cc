@@ -1,3 +1,6 @@
+#include <chrono>
+#include <vector>
+
 #include "common/network/address_impl.h"
 #include "common/network/listener_impl.h"
 #include "common/network/utility.h"
@@ -327,5 +330,108 @@ TEST_P(ListenerImplTest, WildcardListenerUseActualDst) {
   dispatcher.run(Event::Dispatcher::RunType::Block);
 }
 
+// Validate that no connection is created for a socket the callbacks take over.
+TEST_P(ListenerImplTest, AcceptTakenOver) {
+  Stats::IsolatedStoreImpl stats_store;
+  Event::DispatcherImpl dispatcher;
+  Network::TcpListenSocket socket(Network::Test::getCanonicalLoopbackAddress(version_), true);
+  Network::MockListenerCallbacks listener_callbacks;
+  Network::MockConnectionHandler connection_handler;
+  Network::TestListenerImpl listener(connection_handler, dispatcher, socket, listener_callbacks,
+                                     stats_store,
+                                     Network::ListenerOptions::listenerOptionsWithBindToPort());
+
+  Network::ClientConnectionPtr client_connection = dispatcher.createClientConnection(
+      socket.localAddress(), Network::Address::InstanceConstSharedPtr());
+  client_connection->connect();
+
+  EXPECT_CALL(listener, newConnection(_, _, _, _)).Times(0);
+  EXPECT_CALL(listener_callbacks, onAccept(_, _, _, false))
+      .WillOnce(Invoke([&](int fd, Address::InstanceConstSharedPtr remote_address,
+                           Address::InstanceConstSharedPtr, bool) -> bool {
+        EXPECT_NE(nullptr, remote_address);
+        ::close(fd);
+        client_connection->close(ConnectionCloseType::NoFlush);
+        dispatcher.exit();
+        return true;
+      }));
+
+  dispatcher.run(Event::Dispatcher::RunType::Block);
+}
+
+// Validate that connections beyond the per wakeup limit are accepted on a later wakeup.
+TEST_P(ListenerImplTest, MaxAcceptsPerWakeup) {
+  Stats::IsolatedStoreImpl stats_store;
+  Event::DispatcherImpl dispatcher;
+  Network::TcpListenSocket socket(Network::Test::getCanonicalLoopbackAddress(version_), true);
+  Network::MockListenerCallbacks listener_callbacks;
+  Network::MockConnectionHandler connection_handler;
+  Network::ListenerOptions options = Network::ListenerOptions::listenerOptionsWithBindToPort();
+  options.max_accepts_per_wakeup_ = 1;
+  Network::TestListenerImpl listener(connection_handler, dispatcher, socket, listener_callbacks,
+                                     stats_store, options);
+
+  std::vector<Network::ClientConnectionPtr> client_connections;
+  for (int i = 0; i < 3; i++) {
+    client_connections.push_back(dispatcher.createClientConnection(
+        socket.localAddress(), Network::Address::InstanceConstSharedPtr()));
+    client_connections.back()->connect();
+  }
+
+  int accepted = 0;
+  EXPECT_CALL(listener, newConnection(_, _, _, _)).Times(0);
+  EXPECT_CALL(listener_callbacks, onAccept(_, _, _, false))
+      .Times(3)
+      .WillRepeatedly(Invoke([&](int fd, Address::InstanceConstSharedPtr,
+                                 Address::InstanceConstSharedPtr, bool) -> bool {
+        ::close(fd);
+        if (++accepted == 3) {
+          dispatcher.exit();
+        }
+        return true;
+      }));
+
+  dispatcher.run(Event::Dispatcher::RunType::Block);
+  EXPECT_LE(1U, stats_store.counter("downstream_cx_accept_batch_limited").value());
+  for (Network::ClientConnectionPtr& client_connection : client_connections) {
+    client_connection->close(ConnectionCloseType::NoFlush);
+  }
+}
+
+// Validate that a connection the accept limiter holds back is accepted once the limiter allows.
+TEST_P(ListenerImplTest, AcceptLimiter) {
+  Stats::IsolatedStoreImpl stats_store;
+  Event::DispatcherImpl dispatcher;
+  Network::TcpListenSocket socket(Network::Test::getCanonicalLoopbackAddress(version_), true);
+  Network::MockListenerCallbacks listener_callbacks;
+  Network::MockConnectionHandler connection_handler;
+  Network::MockAcceptLimiter accept_limiter;
+  Network::ListenerOptions options = Network::ListenerOptions::listenerOptionsWithBindToPort();
+  options.accept_limiter_ = &accept_limiter;
+  Network::TestListenerImpl listener(connection_handler, dispatcher, socket, listener_callbacks,
+                                     stats_store, options);
+
+  Network::ClientConnectionPtr client_connection = dispatcher.createClientConnection(
+      socket.localAddress(), Network::Address::InstanceConstSharedPtr());
+  client_connection->connect();
+
+  EXPECT_CALL(accept_limiter, tryAccept())
+      .WillOnce(Return(false))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(accept_limiter, retryInterval()).WillOnce(Return(std::chrono::milliseconds(1)));
+  EXPECT_CALL(listener, newConnection(_, _, _, _)).Times(0);
+  EXPECT_CALL(listener_callbacks, onAccept(_, _, _, false))
+      .WillOnce(Invoke([&](int fd, Address::InstanceConstSharedPtr,
+                           Address::InstanceConstSharedPtr, bool) -> bool {
+        ::close(fd);
+        client_connection->close(ConnectionCloseType::NoFlush);
+        dispatcher.exit();
+        return true;
+      }));
+
+  dispatcher.run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ(1U, stats_store.counter("downstream_cx_accept_rate_limited").value());
+}
+
 } // namespace Network
 } // namespace Envoy
@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/network/address_impl.h"
+#include "common/network/cidr_range.h"
+#include "common/network/prefix_trie.h"
+
+#include "gtest/gtest.h"
+#include "spdlog/spdlog.h"
+
+namespace Envoy {
+namespace Network {
+namespace Address {
+
+TEST(PrefixTrieTest, Empty) {
+  PrefixTrie<uint32_t> trie;
+  EXPECT_TRUE(trie.empty());
+  EXPECT_FALSE(trie.contains(0));
+}
+
+TEST(PrefixTrieTest, Ipv4) {
+  PrefixTrie<uint32_t> trie;
+  trie.insert(0x0a000000, 8);   // 10.0.0.0/8
+  trie.insert(0xc0a80100, 24);  // 192.168.1.0/24
+  trie.insert(0xc0a80000, 16);  // 192.168.0.0/16, covering the /24 above.
+  trie.insert(0xc0a90101, 32);  // 192.169.1.1/32
+  trie.insert(0x0a0b0c0d, 30);  // Covered by 10.0.0.0/8.
+  EXPECT_FALSE(trie.empty());
+
+  EXPECT_TRUE(trie.contains(0x0a000000));
+  EXPECT_TRUE(trie.contains(0x0affffff));
+  EXPECT_FALSE(trie.contains(0x0b000000));
+  EXPECT_FALSE(trie.contains(0x09ffffff));
+  EXPECT_TRUE(trie.contains(0xc0a80101));
+  EXPECT_TRUE(trie.contains(0xc0a8ff01));
+  EXPECT_FALSE(trie.contains(0xc0a70000));
+  EXPECT_TRUE(trie.contains(0xc0a90101));
+  EXPECT_FALSE(trie.contains(0xc0a90100));
+  EXPECT_FALSE(trie.contains(0xc0a90102));
+}
+
+TEST(PrefixTrieTest, Ipv4All) {
+  PrefixTrie<uint32_t> trie;
+  trie.insert(0x01020304, 32);
+  trie.insert(0xffffffff, 0);
+  EXPECT_TRUE(trie.contains(0));
+  EXPECT_TRUE(trie.contains(0xffffffff));
+}
+
+TEST(PrefixTrieTest, Ipv6) {
+  PrefixTrie<Ipv6PrefixTrieKey> trie;
+  trie.insert(Ipv6Instance("2001:db8:85a3::").ip()->ipv6()->address(), 64);
+  trie.insert(Ipv6Instance("2001:db8::").ip()->ipv6()->address(), 33);
+  trie.insert(Ipv6Instance("::1").ip()->ipv6()->address(), 128);
+
+  EXPECT_TRUE(trie.contains(Ipv6Instance("2001:db8:85a3::8a2e:370:7334").ip()->ipv6()->address()));
+  EXPECT_TRUE(trie.contains(Ipv6Instance("2001:db8:7fff::").ip()->ipv6()->address()));
+  EXPECT_FALSE(trie.contains(Ipv6Instance("2001:db8:8000::").ip()->ipv6()->address()));
+  EXPECT_TRUE(trie.contains(Ipv6Instance("::1").ip()->ipv6()->address()));
+  EXPECT_FALSE(trie.contains(Ipv6Instance("::2").ip()->ipv6()->address()));
+  EXPECT_FALSE(trie.contains(Ipv6Instance("::").ip()->ipv6()->address()));
+}
+
+TEST(PrefixTrieTest, LongestMatch) {
+  PrefixTrie<uint32_t> trie;
+  EXPECT_EQ(PrefixTrie<uint32_t>::NO_VALUE, trie.longestMatch(0x0a000001));
+
+  trie.insert(0x0a000000, 8, 1);   // 10.0.0.0/8
+  trie.insert(0x0a010000, 16, 2);  // 10.1.0.0/16
+  trie.insert(0x0a010200, 24, 3);  // 10.1.2.0/24
+  trie.insert(0x0a010000, 16, 4);  // Replaces the value of 10.1.0.0/16.
+
+  EXPECT_EQ(1U, trie.longestMatch(0x0a020304));
+  EXPECT_EQ(4U, trie.longestMatch(0x0a010304));
+  EXPECT_EQ(3U, trie.longestMatch(0x0a010204));
+  EXPECT_EQ(PrefixTrie<uint32_t>::NO_VALUE, trie.longestMatch(0x0b010204));
+  EXPECT_TRUE(trie.contains(0x0a010204));
+}
+
+// Compare an IpList against the ranges' own matching, over random prefixes and addresses that are
+// made to share leading bits with them.
+TEST(PrefixTrieTest, MatchesCidrRanges) {
+  std::mt19937 random(1);
+  for (int round = 0; round < 20; round++) {
+    std::vector<std::string> subnets;
+    std::vector<CidrRange> ranges;
+    std::vector<uint32_t> bases;
+    for (int i = 0; i < 50; i++) {
+      const uint32_t base = random() & 0xf0f0f0f0;
+      bases.push_back(base);
+      const std::string subnet =
+          fmt::format("{}.{}.{}.{}/{}", base >> 24, (base >> 16) & 0xff, (base >> 8) & 0xff,
+                      base & 0xff, 4 + random() % 29);
+      subnets.push_back(subnet);
+      ranges.push_back(CidrRange::create(subnet));
+    }
+    IpList list(subnets);
+
+    for (int i = 0; i < 1000; i++) {
+      const uint32_t ip = bases[random() % bases.size()] ^ (random() >> (random() % 32));
+      const Ipv4Instance address(fmt::format("{}.{}.{}.{}", ip >> 24, (ip >> 16) & 0xff,
+                                             (ip >> 8) & 0xff, ip & 0xff));
+      bool expected = false;
+      for (const CidrRange& range : ranges) {
+        expected = expected || range.isInRange(address);
+      }
+      EXPECT_EQ(expected, list.contains(address)) << address.asString();
+    }
+  }
+}
+
+} // namespace Address
+} // namespace Network
+} // namespace Envoy
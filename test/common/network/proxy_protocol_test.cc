@@ -67,6 +67,37 @@ public:
     conn_->write(buf);
   }
 
+  // A V2 header with the given version and command byte, family byte, and address block.
+  static std::string v2Header(uint8_t version_command, uint8_t family, const std::string& rest) {
+    std::string header("\r\n\r\n\0\r\nQUIT\n", 12);
+    header.push_back(version_command);
+    header.push_back(family);
+    header.push_back(rest.size() >> 8);
+    header.push_back(rest.size() & 0xff);
+    return header + rest;
+  }
+
+  // An empty remote_address expects the connection's own addresses.
+  void expectData(const std::string& remote_address, const std::string& local_address) {
+    EXPECT_CALL(*read_filter_, onNewConnection());
+    EXPECT_CALL(*read_filter_, onData(_))
+        .WillOnce(Invoke([=](Buffer::Instance& buffer) -> FilterStatus {
+          if (remote_address.empty()) {
+            EXPECT_EQ(server_connection_->remoteAddress().ip()->addressAsString(),
+                      socket_.localAddress()->ip()->addressAsString());
+            EXPECT_EQ(server_connection_->localAddress().asString(),
+                      socket_.localAddress()->asString());
+          } else {
+            EXPECT_EQ(server_connection_->remoteAddress().asString(), remote_address);
+            EXPECT_EQ(server_connection_->localAddress().asString(), local_address);
+          }
+
+          EXPECT_EQ(TestUtility::bufferToString(buffer), "more data");
+          buffer.drain(9);
+          return Network::FilterStatus::Continue;
+        }));
+  }
+
   void disconnect() {
     EXPECT_CALL(connection_callbacks_, onEvent(ConnectionEvent::LocalClose));
     EXPECT_CALL(server_callbacks_, onEvent(ConnectionEvent::RemoteClose))
@@ -141,6 +172,118 @@ TEST_P(ProxyProtocolTest, BasicV6) {
   disconnect();
 }
 
+TEST_P(ProxyProtocolTest, Unknown) {
+  connect();
+  write("PROXY UNKNOWN ffff::1 ffff::2 1234 5678\r\nmore data");
+
+  expectData("", "");
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+const std::string V2_TCP4_ADDRESSES("\x01\x02\x03\x04\xfe\xfe\xfe\xfe\xff\xff\x04\xd2", 12);
+const std::string V2_TCP6_ADDRESSES("\x00\x01\x00\x02\x00\x03\x00\x00"
+                                    "\x00\x00\x00\x00\x00\x00\x00\x04"
+                                    "\x00\x05\x00\x06\x00\x00\x00\x00"
+                                    "\x00\x00\x00\x00\x00\x07\x00\x08"
+                                    "\xff\xff\x04\xd2",
+                                    36);
+
+TEST_P(ProxyProtocolTest, V2Basic) {
+  connect();
+  write(v2Header(0x21, 0x11, V2_TCP4_ADDRESSES) + "more data");
+
+  expectData("1.2.3.4:65535", "254.254.254.254:1234");
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2BasicV6) {
+  connect();
+  write(v2Header(0x21, 0x21, V2_TCP6_ADDRESSES) + "more data");
+
+  expectData("[1:2:3::4]:65535", "[5:6::7:8]:1234");
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2Tlvs) {
+  connect();
+  // TLVs, here longer than what is peeked at at once, follow the addresses and are dropped.
+  write(v2Header(0x21, 0x11, V2_TCP4_ADDRESSES + std::string(1000, 'x')) + "more data");
+
+  expectData("1.2.3.4:65535", "254.254.254.254:1234");
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2Fragmented) {
+  connect();
+  const std::string header = v2Header(0x21, 0x11, V2_TCP4_ADDRESSES + "tlv");
+  write(header.substr(0, 10));
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  write(header.substr(10, 10));
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  write(header.substr(20, 8));
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  write(header.substr(28) + "more data");
+
+  expectData("1.2.3.4:65535", "254.254.254.254:1234");
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2Local) {
+  connect();
+  write(v2Header(0x20, 0x00, "") + "more data");
+
+  expectData("", "");
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2UnsupportedFamily) {
+  connect();
+  // UDP over IPv4 keeps the connection's own addresses.
+  write(v2Header(0x21, 0x12, V2_TCP4_ADDRESSES) + "more data");
+
+  expectData("", "");
+  dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+
+  disconnect();
+}
+
+TEST_P(ProxyProtocolTest, V2BadVersion) {
+  connectNoRead();
+  write(v2Header(0x31, 0x11, V2_TCP4_ADDRESSES) + "more data");
+  expectProxyProtoError();
+}
+
+TEST_P(ProxyProtocolTest, V2BadCommand) {
+  connectNoRead();
+  write(v2Header(0x22, 0x11, V2_TCP4_ADDRESSES) + "more data");
+  expectProxyProtoError();
+}
+
+TEST_P(ProxyProtocolTest, V2AddressesTooShort) {
+  connectNoRead();
+  write(v2Header(0x21, 0x21, V2_TCP4_ADDRESSES) + "more data");
+  expectProxyProtoError();
+}
+
+TEST_P(ProxyProtocolTest, V2InvalidSrcAddress) {
+  connectNoRead();
+  const std::string addresses("\xe6\x00\x00\x01\x0a\x01\x01\x03\x04\xd2\x16\x2e", 12);
+  write(v2Header(0x21, 0x11, addresses) + "more data");
+  expectProxyProtoError();
+}
+
 TEST_P(ProxyProtocolTest, Fragmented) {
   connect();
   write("PROXY TCP4");
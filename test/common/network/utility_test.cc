@@ -1,3 +1,7 @@
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <cstdint>
 #include <list>
 #include <string>
@@ -146,6 +150,29 @@ TEST_P(NetworkUtilityGetLocalAddress, GetLocalAddress) {
 
 TEST(NetworkUtility, GetOriginalDst) { EXPECT_EQ(nullptr, Utility::getOriginalDst(-1)); }
 
+#ifdef __linux__
+TEST(NetworkUtility, ListenSocketOptions) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_NE(-1, fd);
+  Utility::setListenSocketOptions(fd, 16, 5);
+
+  int value = 0;
+  socklen_t value_len = sizeof(value);
+  EXPECT_EQ(0, getsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &value, &value_len));
+  EXPECT_EQ(16, value);
+  // The kernel rounds the deferral to its SYN-ACK retransmission schedule.
+  EXPECT_EQ(0, getsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, &value_len));
+  EXPECT_NE(0, value);
+  close(fd);
+
+  EXPECT_THROW(Utility::setListenSocketOptions(-1, 16, 0), EnvoyException);
+  EXPECT_THROW(Utility::setListenSocketOptions(-1, 0, 5), EnvoyException);
+  Utility::setListenSocketOptions(-1, 0, 0);
+}
+#endif
+
+TEST(NetworkUtility, TcpFastOpenAccepted) { EXPECT_FALSE(Utility::tcpFastOpenAccepted(-1)); }
+
 TEST(NetworkUtility, InternalAddress) {
   EXPECT_TRUE(Utility::isInternalAddress("127.0.0.1"));
   EXPECT_TRUE(Utility::isInternalAddress("10.0.0.1"));
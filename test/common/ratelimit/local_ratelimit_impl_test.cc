@@ -0,0 +1,183 @@
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "common/json/json_loader.h"
+#include "common/ratelimit/local_ratelimit_impl.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/ratelimit/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+using testing::Invoke;
+using testing::NiceMock;
+using testing::ReturnPointee;
+using testing::WithArg;
+using testing::_;
+
+namespace RateLimit {
+
+class MockRequestCallbacks : public RequestCallbacks {
+public:
+  MOCK_METHOD1(complete, void(LimitStatus status));
+};
+
+TEST(TokenBucketTest, ConsumeAndRefill) {
+  NiceMock<MockMonotonicTimeSource> time_source;
+  MonotonicTime now;
+  ON_CALL(time_source, currentTime()).WillByDefault(ReturnPointee(&now));
+  TokenBucket bucket(3, 2, std::chrono::milliseconds(100), time_source);
+
+  uint32_t remaining;
+  EXPECT_TRUE(bucket.consume(remaining));
+  EXPECT_EQ(2U, remaining);
+  EXPECT_TRUE(bucket.consume(remaining));
+  EXPECT_TRUE(bucket.consume(remaining));
+  EXPECT_EQ(0U, remaining);
+  EXPECT_FALSE(bucket.consume(remaining));
+
+  // Still within the first interval.
+  now += std::chrono::milliseconds(99);
+  EXPECT_FALSE(bucket.consume(remaining));
+
+  now += std::chrono::milliseconds(1);
+  EXPECT_TRUE(bucket.consume(remaining));
+  EXPECT_EQ(1U, remaining);
+  EXPECT_TRUE(bucket.consume(remaining));
+  EXPECT_FALSE(bucket.consume(remaining));
+
+  // Refills stop at the maximum.
+  now += std::chrono::milliseconds(1000);
+  EXPECT_TRUE(bucket.consume(remaining));
+  EXPECT_EQ(2U, remaining);
+}
+
+class LocalRateLimitTest : public testing::Test {
+public:
+  LocalRateLimitTest() {
+    ON_CALL(time_source_, currentTime()).WillByDefault(ReturnPointee(&now_));
+  }
+
+  void initialize(const std::string& mode, bool shared) {
+    const std::string json = R"EOF(
+    {
+      "mode": ")EOF" + mode + R"EOF(",
+      "near_limit_ratio": 0.5,
+      "shared": )EOF" + (shared ? "true" : "false") + R"EOF(,
+      "buckets": [
+        {
+          "descriptor": [{"key": "foo", "value": "bar"}],
+          "max_tokens": 4,
+          "fill_interval_ms": 1000
+        }
+      ]
+    }
+    )EOF";
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    limiter_.reset(new LocalRateLimiter(*config, "prefix.", stats_, tls_, time_source_));
+    global_client_ = new MockClient();
+    client_.reset(new LocalClientImpl(limiter_, ClientPtr{global_client_}));
+  }
+
+  void expectGlobalCall(const std::vector<Descriptor>& descriptors) {
+    EXPECT_CALL(*global_client_, limit(_, "domain", descriptors, _))
+        .WillOnce(WithArg<0>(Invoke([this](RequestCallbacks& callbacks) -> void {
+          global_callbacks_ = &callbacks;
+        })));
+  }
+
+  void limit(const std::vector<Descriptor>& descriptors, LimitStatus expected) {
+    EXPECT_CALL(callbacks_, complete(expected));
+    client_->limit(callbacks_, "domain", descriptors, {"", ""});
+  }
+
+  const std::vector<Descriptor> known_{{{{"foo", "bar"}}}};
+  const std::vector<Descriptor> unknown_{{{{"foo", "baz"}}}};
+  MonotonicTime now_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  Stats::IsolatedStoreImpl stats_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  LocalRateLimiterSharedPtr limiter_;
+  MockClient* global_client_;
+  RequestCallbacks* global_callbacks_{};
+  std::unique_ptr<LocalClientImpl> client_;
+  MockRequestCallbacks callbacks_;
+};
+
+TEST_F(LocalRateLimitTest, Local) {
+  initialize("local", false);
+  EXPECT_CALL(*global_client_, limit(_, _, _, _)).Times(0);
+
+  for (int i = 0; i < 4; i++) {
+    limit(known_, LimitStatus::OK);
+  }
+  limit(known_, LimitStatus::OverLimit);
+
+  // Descriptors without a bucket are not limited.
+  limit(unknown_, LimitStatus::OK);
+
+  now_ += std::chrono::milliseconds(1000);
+  limit(known_, LimitStatus::OK);
+
+  EXPECT_EQ(6U, stats_.counter("prefix.local.ok").value());
+  EXPECT_EQ(1U, stats_.counter("prefix.local.over_limit").value());
+}
+
+TEST_F(LocalRateLimitTest, Prefilter) {
+  initialize("prefilter", true);
+
+  // Well within the limit.
+  limit(known_, LimitStatus::OK);
+  limit(known_, LimitStatus::OK);
+
+  // Near the limit, the rate limit service decides.
+  expectGlobalCall(known_);
+  client_->limit(callbacks_, "domain", known_, {"", ""});
+  EXPECT_CALL(callbacks_, complete(LimitStatus::OverLimit));
+  global_callbacks_->complete(LimitStatus::OverLimit);
+
+  // As it does for descriptors without a bucket. The call can be cancelled.
+  EXPECT_CALL(*global_client_, limit(_, "domain", unknown_, _));
+  client_->limit(callbacks_, "domain", unknown_, {"", ""});
+  EXPECT_CALL(*global_client_, cancel());
+  client_->cancel();
+
+  // The last token is near the limit too.
+  expectGlobalCall(known_);
+  client_->limit(callbacks_, "domain", known_, {"", ""});
+  EXPECT_CALL(callbacks_, complete(LimitStatus::OK));
+  global_callbacks_->complete(LimitStatus::OK);
+
+  // Over the limit, the rate limit service isn't called.
+  limit(known_, LimitStatus::OverLimit);
+  EXPECT_EQ(3U, stats_.counter("prefix.local.global_call").value());
+  EXPECT_EQ(1U, stats_.counter("prefix.local.over_limit").value());
+}
+
+TEST_F(LocalRateLimitTest, Report) {
+  initialize("report", false);
+
+  expectGlobalCall(known_);
+  limit(known_, LimitStatus::OK);
+
+  // No second report while the first is outstanding.
+  limit(known_, LimitStatus::OK);
+  EXPECT_CALL(callbacks_, complete(_)).Times(0);
+  global_callbacks_->complete(LimitStatus::OverLimit);
+
+  EXPECT_CALL(*global_client_, limit(_, "domain", known_, _));
+  limit(known_, LimitStatus::OK);
+  EXPECT_EQ(2U, stats_.counter("prefix.local.report").value());
+
+  // An outstanding report is cancelled with the client.
+  EXPECT_CALL(*global_client_, cancel());
+  client_.reset();
+}
+
+} // namespace RateLimit
+} // namespace Envoy
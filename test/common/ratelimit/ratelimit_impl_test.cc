@@ -6,7 +6,10 @@
 #include "common/http/headers.h"
 #include "common/ratelimit/ratelimit_impl.h"
 
+#include "test/mocks/event/mocks.h"
 #include "test/mocks/grpc/mocks.h"
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
@@ -17,8 +20,10 @@
 namespace Envoy {
 using testing::AtLeast;
 using testing::Invoke;
+using testing::NiceMock;
 using testing::Ref;
 using testing::Return;
+using testing::SaveArg;
 using testing::WithArg;
 using testing::_;
 
@@ -119,25 +124,166 @@ TEST_F(RateLimitGrpcClientTest, Cancel) {
   client_.cancel();
 }
 
+typedef Grpc::MockAsyncClient<pb::lyft::ratelimit::BatchRateLimitRequest,
+                              pb::lyft::ratelimit::BatchRateLimitResponse>
+    MockBatchRateLimitAsyncClient;
+
+class RateLimitGrpcBatcherTest : public testing::Test {
+public:
+  RateLimitGrpcBatcherTest()
+      : async_client_(new MockBatchRateLimitAsyncClient()),
+        flush_timer_(new Event::MockTimer(&dispatcher_)),
+        batcher_(BatchRateLimitAsyncClientPtr{async_client_}, dispatcher_, runtime_) {
+    ON_CALL(runtime_.snapshot_, getInteger("ratelimit.batch_window_ms", 0))
+        .WillByDefault(Return(1));
+    ON_CALL(runtime_.snapshot_, getInteger("ratelimit.batch_max_requests", 100))
+        .WillByDefault(Return(2));
+  }
+
+  Grpc::ResponsePtr<pb::lyft::ratelimit::BatchRateLimitResponse>
+  response(uint64_t id, pb::lyft::ratelimit::RateLimitResponse_Code code) {
+    Grpc::ResponsePtr<pb::lyft::ratelimit::BatchRateLimitResponse> message(
+        new pb::lyft::ratelimit::BatchRateLimitResponse());
+    pb::lyft::ratelimit::BatchRateLimitResponse::Item* item = message->add_items();
+    item->set_id(id);
+    item->mutable_response()->set_overall_code(code);
+    return message;
+  }
+
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  MockBatchRateLimitAsyncClient* async_client_;
+  Event::MockTimer* flush_timer_;
+  Grpc::MockAsyncStream<pb::lyft::ratelimit::BatchRateLimitRequest> async_stream_;
+  GrpcBatcher batcher_;
+  MockRequestCallbacks request_callbacks_;
+};
+
+// Validate that checks are sent in batches on one stream, and that the answers are routed by ID.
+TEST_F(RateLimitGrpcBatcherTest, Batches) {
+  MockRequestCallbacks other_callbacks;
+  EXPECT_CALL(*flush_timer_, enableTimer(std::chrono::milliseconds(1)));
+  EXPECT_EQ(0UL, batcher_.limit(request_callbacks_, "foo", {{{{"foo", "bar"}}}}));
+
+  // A full batch is sent at once.
+  pb::lyft::ratelimit::BatchRateLimitRequest batch;
+  EXPECT_CALL(*async_client_, start(_, Ref(batcher_)))
+      .WillOnce(Invoke([this](const Protobuf::MethodDescriptor& service_method,
+                              Grpc::AsyncStreamCallbacks<
+                                  pb::lyft::ratelimit::BatchRateLimitResponse>&) {
+        EXPECT_EQ("ShouldRateLimitBatch", service_method.name());
+        return &async_stream_;
+      }));
+  EXPECT_CALL(async_stream_, sendMessage(_, false)).WillOnce(SaveArg<0>(&batch));
+  EXPECT_EQ(1UL, batcher_.limit(other_callbacks, "foo", {{{{"bar", "baz"}}}}));
+  ASSERT_EQ(2, batch.items_size());
+  EXPECT_EQ(0UL, batch.items(0).id());
+  EXPECT_EQ("foo", batch.items(0).request().domain());
+  EXPECT_EQ(1UL, batch.items(1).id());
+  EXPECT_EQ("bar", batch.items(1).request().descriptors(0).entries(0).key());
+
+  EXPECT_CALL(other_callbacks, complete(LimitStatus::OverLimit));
+  batcher_.onReceiveMessage(response(1, pb::lyft::ratelimit::RateLimitResponse_Code_OVER_LIMIT));
+  EXPECT_CALL(request_callbacks_, complete(LimitStatus::OK));
+  batcher_.onReceiveMessage(response(0, pb::lyft::ratelimit::RateLimitResponse_Code_OK));
+
+  // A partial batch waits for the window, and goes out on the same stream.
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  batcher_.limit(request_callbacks_, "foo", {{{{"foo", "bar"}}}});
+  EXPECT_CALL(async_stream_, sendMessage(_, false)).WillOnce(SaveArg<0>(&batch));
+  flush_timer_->callback_();
+  ASSERT_EQ(1, batch.items_size());
+  EXPECT_EQ(2UL, batch.items(0).id());
+
+  // The answer to a cancelled check is ignored.
+  batcher_.cancel(2);
+  EXPECT_CALL(request_callbacks_, complete(_)).Times(0);
+  batcher_.onReceiveMessage(response(2, pb::lyft::ratelimit::RateLimitResponse_Code_OK));
+
+  EXPECT_CALL(async_stream_, resetStream());
+}
+
+// Validate that a closed stream fails the checks sent on it, and that the next batch starts a new
+// stream.
+TEST_F(RateLimitGrpcBatcherTest, StreamFailure) {
+  MockRequestCallbacks other_callbacks;
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  EXPECT_CALL(async_stream_, sendMessage(_, false));
+  batcher_.limit(request_callbacks_, "foo", {{{{"foo", "bar"}}}});
+  batcher_.limit(request_callbacks_, "foo", {{{{"foo", "bar"}}}});
+
+  // A check that has not been sent is not failed.
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  batcher_.limit(other_callbacks, "foo", {{{{"foo", "bar"}}}});
+  EXPECT_CALL(request_callbacks_, complete(LimitStatus::Error)).Times(2);
+  batcher_.onRemoteClose(Grpc::Status::GrpcStatus::Unavailable, "");
+
+  // A stream that fails to start fails the checks at once.
+  EXPECT_CALL(*async_client_, start(_, _))
+      .WillOnce(Invoke([](const Protobuf::MethodDescriptor&,
+                          Grpc::AsyncStreamCallbacks<pb::lyft::ratelimit::BatchRateLimitResponse>&
+                              callbacks) {
+        callbacks.onRemoteClose(Grpc::Status::GrpcStatus::Unavailable, "");
+        return nullptr;
+      }));
+  EXPECT_CALL(other_callbacks, complete(LimitStatus::Error));
+  flush_timer_->callback_();
+}
+
+// Validate that a batched client times out and cancels its check.
+TEST_F(RateLimitGrpcBatcherTest, ClientTimeout) {
+  BatchedClientImpl client(batcher_, std::chrono::milliseconds(20));
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  Event::MockTimer* timeout_timer = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*timeout_timer, enableTimer(std::chrono::milliseconds(20))).Times(2);
+  client.limit(request_callbacks_, "foo", {{{{"foo", "bar"}}}}, Tracing::EMPTY_CONTEXT);
+
+  EXPECT_CALL(request_callbacks_, complete(LimitStatus::Error));
+  timeout_timer->callback_();
+
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  EXPECT_CALL(async_stream_, sendMessage(_, false));
+  flush_timer_->callback_();
+  batcher_.onReceiveMessage(response(0, pb::lyft::ratelimit::RateLimitResponse_Code_OK));
+
+  // The timer is reused by the next check, which can be cancelled.
+  EXPECT_CALL(*flush_timer_, enableTimer(_));
+  client.limit(request_callbacks_, "foo", {{{{"foo", "bar"}}}}, Tracing::EMPTY_CONTEXT);
+  EXPECT_CALL(*timeout_timer, disableTimer());
+  client.cancel();
+
+  EXPECT_CALL(async_stream_, resetStream());
+}
+
 TEST(RateLimitGrpcFactoryTest, NoCluster) {
   envoy::api::v2::RateLimitServiceConfig config;
   config.set_cluster_name("foo");
   Upstream::MockClusterManager cm;
+  NiceMock<ThreadLocal::MockInstance> tls;
+  NiceMock<Runtime::MockLoader> runtime;
 
   EXPECT_CALL(cm, get("foo")).WillOnce(Return(nullptr));
-  EXPECT_THROW(GrpcFactoryImpl(config, cm), EnvoyException);
+  EXPECT_THROW(GrpcFactoryImpl(config, cm, tls, runtime), EnvoyException);
 }
 
 TEST(RateLimitGrpcFactoryTest, Create) {
   envoy::api::v2::RateLimitServiceConfig config;
   config.set_cluster_name("foo");
   Upstream::MockClusterManager cm;
+  NiceMock<ThreadLocal::MockInstance> tls;
+  NiceMock<Runtime::MockLoader> runtime;
 
   EXPECT_CALL(cm, get("foo")).Times(AtLeast(1));
-  GrpcFactoryImpl factory(config, cm);
-  factory.create(Optional<std::chrono::milliseconds>());
+  GrpcFactoryImpl factory(config, cm, tls, runtime);
+  ClientPtr client = factory.create(Optional<std::chrono::milliseconds>());
+  EXPECT_NE(nullptr, dynamic_cast<GrpcClientImpl*>(client.get()));
+
+  EXPECT_CALL(runtime.snapshot_, getInteger("ratelimit.batch_window_ms", 0)).WillOnce(Return(1));
+  client = factory.create(Optional<std::chrono::milliseconds>());
+  EXPECT_NE(nullptr, dynamic_cast<BatchedClientImpl*>(client.get()));
 }
 
+
 TEST(RateLimitNullFactoryTest, Basic) {
   NullFactoryImpl factory;
   ClientPtr client = factory.create(Optional<std::chrono::milliseconds>());
@@ -0,0 +1,30 @@
+#include <string>
+
+#include "common/redis/cluster_slot.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Redis {
+
+TEST(RedisClusterSlotTest, KeySlot) {
+  // The CRC16 check value of 123456789 is 0x31c3.
+  EXPECT_EQ(0x31c3, ClusterSlot::keySlot("123456789"));
+  EXPECT_EQ(12182, ClusterSlot::keySlot("foo"));
+  EXPECT_EQ(5061, ClusterSlot::keySlot("bar"));
+  EXPECT_EQ(0, ClusterSlot::keySlot(""));
+}
+
+TEST(RedisClusterSlotTest, HashTags) {
+  EXPECT_EQ(ClusterSlot::keySlot("user1000"), ClusterSlot::keySlot("{user1000}.following"));
+  EXPECT_EQ(ClusterSlot::keySlot("user1000"), ClusterSlot::keySlot("{user1000}.followers"));
+  EXPECT_EQ(ClusterSlot::keySlot("bar"), ClusterSlot::keySlot("foo{bar}{zap}"));
+  EXPECT_EQ(ClusterSlot::keySlot("{bar"), ClusterSlot::keySlot("foo{{bar}}zap"));
+
+  // Without a closing brace or with an empty tag, the whole key is hashed.
+  EXPECT_NE(ClusterSlot::keySlot("bar"), ClusterSlot::keySlot("foo{bar"));
+  EXPECT_NE(ClusterSlot::keySlot("bar"), ClusterSlot::keySlot("foo{}{bar}"));
+}
+
+} // namespace Redis
+} // namespace Envoy
@@ -0,0 +1,60 @@
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/redis/codec_impl.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Redis {
+namespace {
+
+class NullDecoderCallbacks : public DecoderCallbacks {
+public:
+  // Redis::DecoderCallbacks
+  void onRespValue(RespValuePtr&& value) override { benchmark::DoNotOptimize(value.get()); }
+};
+
+/**
+ * @return std::string a single encoded command of the form "SET key value" with a value of the
+ *         given size.
+ */
+std::string encodedCommand(uint64_t value_size) {
+  std::vector<RespValue> array(3);
+  array[0].type(RespType::BulkString);
+  array[0].asString() = "SET";
+  array[1].type(RespType::BulkString);
+  array[1].asString() = "some:key:1234";
+  array[2].type(RespType::BulkString);
+  array[2].asString() = std::string(value_size, 'v');
+  RespValue request;
+  request.type(RespType::Array);
+  request.asArray().swap(array);
+
+  EncoderImpl encoder;
+  Buffer::OwnedImpl buffer;
+  encoder.encode(request, buffer);
+  return std::string(static_cast<char*>(buffer.linearize(buffer.length())), buffer.length());
+}
+
+void BM_DecoderImplDecode(benchmark::State& state) {
+  // A pipeline of commands, as a busy client would send them.
+  std::string pipeline;
+  for (uint32_t i = 0; i < 10; i++) {
+    pipeline += encodedCommand(state.range(0));
+  }
+
+  NullDecoderCallbacks callbacks;
+  DecoderImpl decoder(callbacks);
+  while (state.KeepRunning()) {
+    Buffer::OwnedImpl data(pipeline);
+    decoder.decode(data);
+  }
+  state.SetBytesProcessed(state.iterations() * pipeline.size());
+}
+BENCHMARK(BM_DecoderImplDecode)->Arg(16)->Arg(1024)->Arg(16384);
+
+} // namespace
+} // namespace Redis
+} // namespace Envoy
@@ -186,5 +186,57 @@ TEST_F(RedisEncoderDecoderImplTest, InvalidBulkStringExpectLF) {
   EXPECT_THROW(decoder_.decode(buffer_), ProtocolError);
 }
 
+class RedisRawDecoderImplTest : public testing::Test, public DecoderCallbacks {
+public:
+  RedisRawDecoderImplTest() : decoder_(*this, true) {}
+
+  // Redis::DecoderCallbacks
+  void onRespValue(RespValuePtr&& value) override {
+    decoded_values_.emplace_back(std::move(value));
+  }
+
+  EncoderImpl encoder_;
+  DecoderImpl decoder_;
+  Buffer::OwnedImpl buffer_;
+  std::vector<RespValuePtr> decoded_values_;
+};
+
+TEST_F(RedisRawDecoderImplTest, KeepRaw) {
+  buffer_.add("*2\r\n$3\r\nget\r\n$3\r\nfoo\r\n$3\r\nba");
+  decoder_.decode(buffer_);
+  EXPECT_EQ(0UL, buffer_.length());
+  ASSERT_EQ(1UL, decoded_values_.size());
+  EXPECT_EQ("[\"get\", \"foo\"]", decoded_values_[0]->toString());
+  EXPECT_EQ("*2\r\n$3\r\nget\r\n$3\r\nfoo\r\n",
+            TestUtility::bufferToString(*decoded_values_[0]->raw()));
+
+  // The bytes of a value that spans decode() calls are kept as well.
+  buffer_.add("r\r\n:007\r\n");
+  decoder_.decode(buffer_);
+  EXPECT_EQ(0UL, buffer_.length());
+  ASSERT_EQ(3UL, decoded_values_.size());
+  EXPECT_EQ("$3\r\nbar\r\n", TestUtility::bufferToString(*decoded_values_[1]->raw()));
+
+  // The encoder writes the bytes out as they came in.
+  EXPECT_EQ(7, decoded_values_[2]->asInteger());
+  encoder_.encode(*decoded_values_[2], buffer_);
+  EXPECT_EQ(":007\r\n", TestUtility::bufferToString(buffer_));
+  buffer_.drain(buffer_.length());
+
+  // Until the value is changed.
+  decoded_values_[2]->type(RespType::Integer);
+  decoded_values_[2]->asInteger() = 7;
+  EXPECT_EQ(nullptr, decoded_values_[2]->raw());
+  encoder_.encode(*decoded_values_[2], buffer_);
+  EXPECT_EQ(":7\r\n", TestUtility::bufferToString(buffer_));
+}
+
+TEST_F(RedisRawDecoderImplTest, ErrorAfterValue) {
+  buffer_.add(":1\r\n^");
+  EXPECT_THROW(decoder_.decode(buffer_), ProtocolError);
+  ASSERT_EQ(1UL, decoded_values_.size());
+  EXPECT_EQ(":1\r\n", TestUtility::bufferToString(*decoded_values_[0]->raw()));
+}
+
 } // namespace Redis
 } // namespace Envoy
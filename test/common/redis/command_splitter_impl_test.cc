@@ -3,12 +3,14 @@
 #include <string>
 #include <vector>
 
+#include "common/network/utility.h"
 #include "common/redis/command_splitter_impl.h"
 #include "common/redis/supported_commands.h"
 #include "common/stats/stats_impl.h"
 
 #include "test/mocks/common.h"
 #include "test/mocks/redis/mocks.h"
+#include "test/mocks/upstream/host.h"
 #include "test/test_common/printers.h"
 
 #include "gmock/gmock.h"
@@ -19,8 +21,10 @@ using testing::ByRef;
 using testing::DoAll;
 using testing::Eq;
 using testing::InSequence;
+using testing::NiceMock;
 using testing::Ref;
 using testing::Return;
+using testing::ReturnPointee;
 using testing::WithArg;
 using testing::_;
 
@@ -42,7 +46,8 @@ public:
 
   ConnPool::MockInstance* conn_pool_{new ConnPool::MockInstance()};
   Stats::IsolatedStoreImpl store_;
-  InstanceImpl splitter_{ConnPool::InstancePtr{conn_pool_}, store_, "redis.foo."};
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  InstanceImpl splitter_{ConnPool::InstancePtr{conn_pool_}, store_, "redis.foo.", time_source_};
   MockSplitCallbacks callbacks_;
   SplitRequestPtr handle_;
 };
@@ -95,6 +100,25 @@ TEST_F(RedisCommandSplitterImplTest, UnsupportedCommand) {
   EXPECT_EQ(1UL, store_.counter("redis.foo.splitter.unsupported_command").value());
 }
 
+TEST_F(RedisCommandSplitterImplTest, ReadOnlyCommands) {
+  InSequence s;
+
+  ConnPool::MockPoolRequest pool_request;
+  RespValue get;
+  makeBulkStringArray(get, {"get", "hello"});
+  EXPECT_CALL(*conn_pool_, makeReadRequest("hello", Ref(get), _)).WillOnce(Return(&pool_request));
+  handle_ = splitter_.makeRequest(get, callbacks_);
+  EXPECT_CALL(pool_request, cancel());
+  handle_->cancel();
+
+  RespValue set;
+  makeBulkStringArray(set, {"set", "hello", "world"});
+  EXPECT_CALL(*conn_pool_, makeRequest("hello", Ref(set), _)).WillOnce(Return(&pool_request));
+  handle_ = splitter_.makeRequest(set, callbacks_);
+  EXPECT_CALL(pool_request, cancel());
+  handle_->cancel();
+}
+
 class RedisSingleServerRequestTest : public RedisCommandSplitterImplTest,
                                      public testing::WithParamInterface<std::string> {
 public:
@@ -448,6 +472,92 @@ TEST_F(RedisMGETCommandHandlerTest, Cancel) {
   handle_->cancel();
 };
 
+TEST_F(RedisMGETCommandHandlerTest, ClusterMode) {
+  InSequence s;
+
+  // foo and {foo}bar are in the same slot, and bar is in another.
+  RespValue request;
+  makeBulkStringArray(request, {"mget", "foo", "bar", "{foo}bar"});
+  RespValue expected_request1;
+  makeBulkStringArray(expected_request1, {"mget", "foo", "{foo}bar"});
+  RespValue expected_request2;
+  makeBulkStringArray(expected_request2, {"get", "bar"});
+  pool_callbacks_.resize(2);
+  std::vector<ConnPool::MockPoolRequest> pool_requests(2);
+  pool_requests_.swap(pool_requests);
+
+  EXPECT_CALL(*conn_pool_, clusterMode()).WillOnce(Return(true));
+  EXPECT_CALL(*conn_pool_, makeRequest("foo", Eq(ByRef(expected_request1)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks_[0])), Return(&pool_requests_[0])));
+  EXPECT_CALL(*conn_pool_, makeRequest("bar", Eq(ByRef(expected_request2)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks_[1])), Return(&pool_requests_[1])));
+  handle_ = splitter_.makeRequest(request, callbacks_);
+  EXPECT_NE(nullptr, handle_);
+
+  RespValuePtr response2(new RespValue());
+  response2->type(RespType::BulkString);
+  response2->asString() = "2";
+  pool_callbacks_[1]->onResponse(std::move(response2));
+
+  RespValue expected_response;
+  makeBulkStringArray(expected_response, {"1", "2", ""});
+  expected_response.asArray()[2].type(RespType::Null);
+
+  RespValuePtr response1(new RespValue());
+  makeBulkStringArray(*response1, {"1", ""});
+  response1->asArray()[1].type(RespType::Null);
+  EXPECT_CALL(callbacks_, onResponse_(PointeesEq(&expected_response)));
+  pool_callbacks_[0]->onResponse(std::move(response1));
+};
+
+TEST_F(RedisMGETCommandHandlerTest, GroupByHost) {
+  InSequence s;
+
+  // foo and baz are on the same host, bar is on another, and qux has no host.
+  RespValue request;
+  makeBulkStringArray(request, {"mget", "foo", "bar", "baz", "qux"});
+  RespValue expected_request1;
+  makeBulkStringArray(expected_request1, {"mget", "foo", "baz"});
+  RespValue expected_request2;
+  makeBulkStringArray(expected_request2, {"get", "bar"});
+  RespValue expected_request3;
+  makeBulkStringArray(expected_request3, {"get", "qux"});
+  pool_callbacks_.resize(3);
+  std::vector<ConnPool::MockPoolRequest> pool_requests(3);
+  pool_requests_.swap(pool_requests);
+
+  Upstream::HostConstSharedPtr host1(new NiceMock<Upstream::MockHost>());
+  Upstream::HostConstSharedPtr host2(new NiceMock<Upstream::MockHost>());
+  EXPECT_CALL(*conn_pool_, clusterMode()).WillOnce(Return(false));
+  EXPECT_CALL(*conn_pool_, hostForKey("foo")).WillOnce(Return(host1));
+  EXPECT_CALL(*conn_pool_, hostForKey("bar")).WillOnce(Return(host2));
+  EXPECT_CALL(*conn_pool_, hostForKey("baz")).WillOnce(Return(host1));
+  EXPECT_CALL(*conn_pool_, hostForKey("qux")).WillOnce(Return(nullptr));
+  EXPECT_CALL(*conn_pool_, makeRequest("foo", Eq(ByRef(expected_request1)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks_[0])), Return(&pool_requests_[0])));
+  EXPECT_CALL(*conn_pool_, makeRequest("bar", Eq(ByRef(expected_request2)), _))
+      .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks_[1])), Return(&pool_requests_[1])));
+  EXPECT_CALL(*conn_pool_, makeRequest("qux", Eq(ByRef(expected_request3)), _))
+      .WillOnce(Return(nullptr));
+  handle_ = splitter_.makeRequest(request, callbacks_);
+  EXPECT_NE(nullptr, handle_);
+
+  RespValuePtr response2(new RespValue());
+  response2->type(RespType::BulkString);
+  response2->asString() = "2";
+  pool_callbacks_[1]->onResponse(std::move(response2));
+
+  // The responses of foo and baz are put back in the order of the request.
+  RespValue expected_response;
+  makeBulkStringArray(expected_response, {"1", "2", "3", "no upstream host"});
+  expected_response.asArray()[3].type(RespType::Error);
+
+  RespValuePtr response1(new RespValue());
+  makeBulkStringArray(*response1, {"1", "3"});
+  EXPECT_CALL(callbacks_, onResponse_(PointeesEq(&expected_response)));
+  pool_callbacks_[0]->onResponse(std::move(response1));
+};
+
 class RedisMSETCommandHandlerTest : public RedisCommandSplitterImplTest {
 public:
   void setup(uint32_t num_sets, const std::list<uint64_t>& null_handle_indexes) {
@@ -661,6 +771,61 @@ TEST_P(RedisSplitKeysSumResultHandlerTest, NoUpstreamHostForAll) {
 INSTANTIATE_TEST_CASE_P(RedisSplitKeysSumResultHandlerTest, RedisSplitKeysSumResultHandlerTest,
                         testing::ValuesIn(SupportedCommands::hashMultipleSumResultCommands()));
 
+class RedisSlowCommandTest : public RedisCommandSplitterImplTest {
+public:
+  RedisSlowCommandTest() {
+    ON_CALL(time_source_, currentTime()).WillByDefault(ReturnPointee(&now_));
+  }
+
+  // Make a GET that takes the given time to respond.
+  void get(std::chrono::milliseconds time) {
+    RespValue request;
+    makeBulkStringArray(request, {"get", "user:1234"});
+    ConnPool::PoolCallbacks* pool_callbacks;
+    EXPECT_CALL(*slow_conn_pool_, makeReadRequest("user:1234", Ref(request), _))
+        .WillOnce(DoAll(WithArg<2>(SaveArgAddress(&pool_callbacks)), Return(&pool_request_)));
+    handle_ = slow_splitter_.makeRequest(request, callbacks_);
+    EXPECT_NE(nullptr, handle_);
+
+    now_ += time;
+    EXPECT_CALL(callbacks_, onResponse_(_));
+    pool_callbacks->onResponse(RespValuePtr{new RespValue()});
+  }
+
+  MonotonicTime now_;
+  ConnPool::MockPoolRequest pool_request_;
+  ConnPool::MockInstance* slow_conn_pool_{new ConnPool::MockInstance()};
+  InstanceImpl slow_splitter_{ConnPool::InstancePtr{slow_conn_pool_}, store_, "redis.slow.",
+                              time_source_, std::chrono::milliseconds(10), 2};
+};
+
+// Validate that commands over the threshold are counted, and that one in every
+// slow_command_sample_one_in of them is logged.
+TEST_F(RedisSlowCommandTest, Sampled) {
+  std::shared_ptr<Upstream::MockHost> host(new NiceMock<Upstream::MockHost>());
+  ON_CALL(*host, address())
+      .WillByDefault(Return(Network::Utility::resolveUrl("tcp://10.0.0.1:6379")));
+  EXPECT_CALL(*slow_conn_pool_, hostForKey("user:1234")).WillOnce(Return(host));
+  get(std::chrono::milliseconds(10));
+  EXPECT_CALL(*slow_conn_pool_, hostForKey(_)).Times(0);
+  get(std::chrono::milliseconds(20));
+  get(std::chrono::milliseconds(9));
+  EXPECT_EQ(2UL, store_.counter("redis.slow.splitter.slow_command").value());
+  EXPECT_EQ(3UL, store_.counter("redis.slow.command.get.total").value());
+
+  EXPECT_CALL(*slow_conn_pool_, hostForKey("user:1234")).WillOnce(Return(nullptr));
+  EXPECT_CALL(*slow_conn_pool_, clusterMode()).WillOnce(Return(true));
+  get(std::chrono::milliseconds(10));
+}
+
+TEST(RedisKeyPrefixTest, KeyPrefix) {
+  EXPECT_EQ("user", InstanceImpl::keyPrefix("user:1234"));
+  EXPECT_EQ("user", InstanceImpl::keyPrefix("user:1234:name"));
+  EXPECT_EQ("", InstanceImpl::keyPrefix(":1234"));
+  EXPECT_EQ("abcdefghijklmnopqrstuvwxyz012345",
+            InstanceImpl::keyPrefix("abcdefghijklmnopqrstuvwxyz0123456789"));
+}
+
 } // namespace CommandSplitter
 } // namespace Redis
 } // namespace Envoy
@@ -5,23 +5,29 @@
 #include "common/redis/conn_pool_impl.h"
 #include "common/upstream/upstream_impl.h"
 
+#include "test/mocks/common.h"
 #include "test/mocks/network/mocks.h"
 #include "test/mocks/redis/mocks.h"
 #include "test/mocks/thread_local/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
+#include "test/test_common/utility.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace Envoy {
+using testing::ByRef;
+using testing::DoAll;
 using testing::Eq;
 using testing::InSequence;
 using testing::Invoke;
+using testing::IsNull;
 using testing::Ref;
 using testing::Return;
 using testing::ReturnRef;
 using testing::SaveArg;
+using testing::WithArg;
 using testing::_;
 
 namespace Redis {
@@ -42,8 +48,8 @@ public:
     for (const Stats::GaugeSharedPtr& gauge : host_->cluster_.stats_store_.gauges()) {
       EXPECT_EQ(0U, gauge->value());
     }
-    for (const Stats::GaugeSharedPtr& gauge : host_->stats_store_.gauges()) {
-      EXPECT_EQ(0U, gauge->value());
+    for (const auto& gauge : host_->stats_.gauges()) {
+      EXPECT_EQ(0U, gauge.second);
     }
   }
 
@@ -53,7 +59,10 @@ public:
       "op_timeout_ms": 20
     }
     )EOF";
+    setup(json_string);
+  }
 
+  void setup(const std::string& json_string) {
     Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
     config_.reset(new ConfigImpl(*json_config));
 
@@ -119,11 +128,15 @@ TEST_F(RedisClientImplTest, Basic) {
   EXPECT_CALL(*decoder_, decode(Ref(fake_data))).WillOnce(Invoke([&](Buffer::Instance&) -> void {
     InSequence s;
     RespValuePtr response1(new RespValue());
+    EXPECT_CALL(host_->cluster_.stats_store_,
+                deliverTimingToSinks("redis.upstream_rq_time", _));
     EXPECT_CALL(callbacks1, onResponse_(Ref(response1)));
     EXPECT_CALL(host_->outlier_detector_, putHttpResponseCode(200));
     callbacks_->onRespValue(std::move(response1));
 
     RespValuePtr response2(new RespValue());
+    EXPECT_CALL(host_->cluster_.stats_store_,
+                deliverTimingToSinks("redis.upstream_rq_time", _));
     EXPECT_CALL(callbacks2, onResponse_(Ref(response2)));
     EXPECT_CALL(*connect_or_op_timer_, disableTimer());
     EXPECT_CALL(host_->outlier_detector_, putHttpResponseCode(200));
@@ -136,6 +149,91 @@ TEST_F(RedisClientImplTest, Basic) {
   client_->close();
 }
 
+TEST_F(RedisClientImplTest, Batching) {
+  InSequence s;
+
+  // Created by the client before its connect or op timer.
+  Event::MockTimer* flush_timer = new Event::MockTimer(&dispatcher_);
+  setup(R"EOF({"op_timeout_ms": 20, "max_batch_requests": 3})EOF");
+
+  // The first request of a batch waits for the flush timer.
+  RespValue request1;
+  MockPoolCallbacks callbacks1;
+  EXPECT_CALL(*encoder_, encode(Ref(request1), _));
+  EXPECT_CALL(*flush_timer, enableTimer(std::chrono::milliseconds(0)));
+  client_->makeRequest(request1, callbacks1);
+
+  onConnected();
+
+  RespValue request2;
+  MockPoolCallbacks callbacks2;
+  EXPECT_CALL(*encoder_, encode(Ref(request2), _));
+  EXPECT_CALL(*connect_or_op_timer_, enableTimer(_));
+  client_->makeRequest(request2, callbacks2);
+
+  // A full batch is written right away.
+  RespValue request3;
+  MockPoolCallbacks callbacks3;
+  EXPECT_CALL(*encoder_, encode(Ref(request3), _));
+  EXPECT_CALL(*flush_timer, disableTimer());
+  EXPECT_CALL(*upstream_connection_, write(_));
+  EXPECT_CALL(*connect_or_op_timer_, enableTimer(_));
+  client_->makeRequest(request3, callbacks3);
+
+  // Otherwise the timer writes the batch.
+  RespValue request4;
+  MockPoolCallbacks callbacks4;
+  EXPECT_CALL(*encoder_, encode(Ref(request4), _));
+  EXPECT_CALL(*flush_timer, enableTimer(std::chrono::milliseconds(0)));
+  EXPECT_CALL(*connect_or_op_timer_, enableTimer(_));
+  client_->makeRequest(request4, callbacks4);
+
+  EXPECT_CALL(*flush_timer, disableTimer());
+  EXPECT_CALL(*upstream_connection_, write(_));
+  flush_timer->callback_();
+
+  EXPECT_CALL(*upstream_connection_, close(Network::ConnectionCloseType::NoFlush));
+  EXPECT_CALL(callbacks1, onFailure());
+  EXPECT_CALL(callbacks2, onFailure());
+  EXPECT_CALL(callbacks3, onFailure());
+  EXPECT_CALL(callbacks4, onFailure());
+  EXPECT_CALL(*flush_timer, disableTimer());
+  EXPECT_CALL(*connect_or_op_timer_, disableTimer());
+  client_->close();
+}
+
+TEST_F(RedisClientImplTest, BatchingBytes) {
+  InSequence s;
+
+  Event::MockTimer* flush_timer = new Event::MockTimer(&dispatcher_);
+  setup(R"EOF({"op_timeout_ms": 20, "max_batch_bytes": 8})EOF");
+
+  RespValue request1;
+  MockPoolCallbacks callbacks1;
+  EXPECT_CALL(*encoder_, encode(Ref(request1), _))
+      .WillOnce(Invoke([](const RespValue&, Buffer::Instance& out) -> void { out.add("1234"); }));
+  EXPECT_CALL(*flush_timer, enableTimer(std::chrono::milliseconds(0)));
+  client_->makeRequest(request1, callbacks1);
+
+  RespValue request2;
+  MockPoolCallbacks callbacks2;
+  EXPECT_CALL(*encoder_, encode(Ref(request2), _))
+      .WillOnce(Invoke([](const RespValue&, Buffer::Instance& out) -> void { out.add("5678"); }));
+  EXPECT_CALL(*flush_timer, disableTimer());
+  EXPECT_CALL(*upstream_connection_, write(_)).WillOnce(Invoke([](Buffer::Instance& data) -> void {
+    EXPECT_EQ("12345678", TestUtility::bufferToString(data));
+    data.drain(data.length());
+  }));
+  client_->makeRequest(request2, callbacks2);
+
+  EXPECT_CALL(*upstream_connection_, close(Network::ConnectionCloseType::NoFlush));
+  EXPECT_CALL(callbacks1, onFailure());
+  EXPECT_CALL(callbacks2, onFailure());
+  EXPECT_CALL(*flush_timer, disableTimer());
+  EXPECT_CALL(*connect_or_op_timer_, disableTimer());
+  client_->close();
+}
+
 TEST_F(RedisClientImplTest, Cancel) {
   InSequence s;
 
@@ -380,7 +478,7 @@ TEST_F(RedisConnPoolImplTest, Basic) {
   EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_))
       .WillOnce(
           Invoke([&](const Upstream::LoadBalancerContext* context) -> Upstream::HostConstSharedPtr {
-            EXPECT_EQ(context->hashKey().value(), std::hash<std::string>()("foo"));
+            EXPECT_EQ(context->hashKey().value(), HashUtil::xxHash64("foo"));
             return cm_.thread_local_cluster_.lb_.host_;
           }));
   EXPECT_CALL(*this, create_(_)).WillOnce(Return(client));
@@ -392,6 +490,18 @@ TEST_F(RedisConnPoolImplTest, Basic) {
   tls_.shutdownThread();
 };
 
+TEST_F(RedisConnPoolImplTest, HostForKey) {
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_))
+      .WillOnce(
+          Invoke([&](const Upstream::LoadBalancerContext* context) -> Upstream::HostConstSharedPtr {
+            EXPECT_EQ(context->hashKey().value(), HashUtil::xxHash64("foo"));
+            return cm_.thread_local_cluster_.lb_.host_;
+          }));
+  EXPECT_EQ(cm_.thread_local_cluster_.lb_.host_, conn_pool_->hostForKey("foo"));
+
+  tls_.shutdownThread();
+};
+
 TEST_F(RedisConnPoolImplTest, HostRemove) {
   InSequence s;
   MockPoolCallbacks callbacks;
@@ -463,6 +573,280 @@ TEST_F(RedisConnPoolImplTest, RemoteClose) {
   tls_.shutdownThread();
 }
 
+class RedisClusterConnPoolImplTest : public RedisConnPoolImplTest {
+public:
+  RedisClusterConnPoolImplTest() {
+    setup("master");
+
+    for (const std::string& url : {"tcp://10.0.0.1:6379", "tcp://10.0.0.2:6379"}) {
+      std::shared_ptr<Upstream::MockHost> host(new NiceMock<Upstream::MockHost>());
+      ON_CALL(*host, address()).WillByDefault(Return(Network::Utility::resolveUrl(url)));
+      hosts_.push_back(host);
+    }
+    cm_.thread_local_cluster_.cluster_.hosts_ = hosts_;
+
+    std::vector<RespValue> values(2);
+    values[0].type(RespType::BulkString);
+    values[0].asString() = "cluster";
+    values[1].type(RespType::BulkString);
+    values[1].asString() = "slots";
+    cluster_slots_request_.type(RespType::Array);
+    cluster_slots_request_.asArray().swap(values);
+
+    std::vector<RespValue> get(2);
+    get[0].type(RespType::BulkString);
+    get[0].asString() = "get";
+    get[1].type(RespType::BulkString);
+    get[1].asString() = "foo";
+    value_.type(RespType::Array);
+    value_.asArray().swap(get);
+  }
+
+  void setup(const std::string& read_policy) {
+    std::string json_string = R"EOF(
+    {
+      "op_timeout_ms": 20,
+      "cluster_mode": true,
+      "read_policy": ")EOF" + read_policy + R"EOF("
+    }
+    )EOF";
+
+    Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
+    conn_pool_.reset(new InstanceImpl(cluster_name_, cm_, *this, tls_, *json_config));
+  }
+
+  void expectRequest(MockClient& client, PoolCallbacks*& callbacks, PoolRequest* request) {
+    EXPECT_CALL(client, makeRequest(_, _))
+        .WillOnce(Invoke([&callbacks, request](const RespValue& value,
+                                               PoolCallbacks& request_callbacks) -> PoolRequest* {
+          EXPECT_EQ("*2\r\n$3\r\nget\r\n$3\r\nfoo\r\n",
+                    TestUtility::bufferToString(*value.raw()));
+          callbacks = &request_callbacks;
+          return request;
+        }));
+  }
+
+  RespValuePtr makeError(const std::string& error) {
+    RespValuePtr value(new RespValue());
+    value->type(RespType::Error);
+    value->asString() = error;
+    return value;
+  }
+
+  void makeArray(RespValue& value, uint32_t size) {
+    std::vector<RespValue> values(size);
+    value.type(RespType::Array);
+    value.asArray().swap(values);
+  }
+
+  void makeNode(RespValue& value, const std::string& ip) {
+    makeArray(value, 2);
+    value.asArray()[0].type(RespType::BulkString);
+    value.asArray()[0].asString() = ip;
+    value.asArray()[1].type(RespType::Integer);
+    value.asArray()[1].asInteger() = 6379;
+  }
+
+  RespValuePtr makeSlots() {
+    // [[0, 8191, ["10.0.0.1", 6379]], [8192, 16383, ["10.0.0.2", 6379]]]
+    RespValuePtr value(new RespValue());
+    makeArray(*value, 2);
+    for (uint32_t i = 0; i < 2; i++) {
+      RespValue& range = value->asArray()[i];
+      makeArray(range, 3);
+      range.asArray()[0].type(RespType::Integer);
+      range.asArray()[0].asInteger() = i * 8192;
+      range.asArray()[1].type(RespType::Integer);
+      range.asArray()[1].asInteger() = i * 8192 + 8191;
+      makeNode(range.asArray()[2], "10.0.0." + std::to_string(i + 1));
+    }
+    return value;
+  }
+
+  RespValuePtr makeReplicatedSlots() {
+    // [[0, 16383, ["10.0.0.1", 6379], ["10.0.0.2", 6379]]]
+    RespValuePtr value(new RespValue());
+    makeArray(*value, 1);
+    RespValue& range = value->asArray()[0];
+    makeArray(range, 4);
+    range.asArray()[0].type(RespType::Integer);
+    range.asArray()[0].asInteger() = 0;
+    range.asArray()[1].type(RespType::Integer);
+    range.asArray()[1].asInteger() = 16383;
+    makeNode(range.asArray()[2], "10.0.0.1");
+    makeNode(range.asArray()[3], "10.0.0.2");
+    return value;
+  }
+
+  std::vector<Upstream::HostSharedPtr> hosts_;
+  RespValue cluster_slots_request_;
+  RespValue value_;
+  MockPoolCallbacks callbacks_;
+};
+
+TEST_F(RedisClusterConnPoolImplTest, Slots) {
+  InSequence s;
+
+  // Keys are not grouped by host in cluster mode.
+  EXPECT_EQ(nullptr, conn_pool_->hostForKey("foo"));
+
+  MockClient* client1 = new NiceMock<MockClient>();
+  MockClient* client2 = new NiceMock<MockClient>();
+  PoolCallbacks* slots_callbacks;
+  MockPoolRequest slots_request;
+  PoolCallbacks* callbacks1;
+  MockPoolRequest active_request1;
+
+  // The first request discovers the slots, and goes to a node chosen by hashing meanwhile.
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(IsNull())).WillOnce(Return(hosts_[0]));
+  EXPECT_CALL(*this, create_(Eq(hosts_[0]))).WillOnce(Return(client1));
+  EXPECT_CALL(*client1, makeRequest(Eq(ByRef(cluster_slots_request_)), _))
+      .WillOnce(DoAll(WithArg<1>(SaveArgAddress(&slots_callbacks)), Return(&slots_request)));
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(hosts_[0]));
+  expectRequest(*client1, callbacks1, &active_request1);
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", value_, callbacks_));
+
+  slots_callbacks->onResponse(makeSlots());
+  EXPECT_CALL(callbacks_, onResponse_(_));
+  RespValuePtr response(new RespValue());
+  callbacks1->onResponse(std::move(response));
+
+  // foo is in slot 12182, which the second node owns.
+  PoolCallbacks* callbacks2;
+  MockPoolRequest active_request2;
+  EXPECT_CALL(*this, create_(Eq(hosts_[1]))).WillOnce(Return(client2));
+  expectRequest(*client2, callbacks2, &active_request2);
+  PoolRequest* request = conn_pool_->makeRequest("foo", value_, callbacks_);
+  EXPECT_NE(nullptr, request);
+
+  EXPECT_CALL(active_request2, cancel());
+  request->cancel();
+
+  // A host change discovers the slots again.
+  cm_.thread_local_cluster_.cluster_.runCallbacks({}, {hosts_[1]});
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(IsNull())).WillOnce(Return(hosts_[0]));
+  EXPECT_CALL(*client1, makeRequest(Eq(ByRef(cluster_slots_request_)), _))
+      .WillOnce(Return(&slots_request));
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(hosts_[0]));
+  expectRequest(*client1, callbacks1, &active_request1);
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", value_, callbacks_));
+
+  tls_.shutdownThread();
+}
+
+TEST_F(RedisClusterConnPoolImplTest, Redirections) {
+  InSequence s;
+
+  MockClient* client1 = new NiceMock<MockClient>();
+  MockClient* client2 = new NiceMock<MockClient>();
+  MockPoolRequest slots_request;
+  PoolCallbacks* callbacks;
+  MockPoolRequest active_request;
+
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(IsNull())).WillOnce(Return(hosts_[0]));
+  EXPECT_CALL(*this, create_(Eq(hosts_[0]))).WillOnce(Return(client1));
+  EXPECT_CALL(*client1, makeRequest(Eq(ByRef(cluster_slots_request_)), _))
+      .WillOnce(Return(&slots_request));
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(hosts_[0]));
+  expectRequest(*client1, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", value_, callbacks_));
+
+  // The slots are already being discovered.
+  EXPECT_CALL(*this, create_(Eq(hosts_[1]))).WillOnce(Return(client2));
+  expectRequest(*client2, callbacks, &active_request);
+  callbacks->onResponse(makeError("MOVED 12182 10.0.0.2:6379"));
+
+  RespValue asking_request;
+  makeArray(asking_request, 1);
+  asking_request.asArray()[0].type(RespType::BulkString);
+  asking_request.asArray()[0].asString() = "asking";
+  EXPECT_CALL(*client1, makeRequest(Eq(ByRef(asking_request)), _)).WillOnce(Return(nullptr));
+  expectRequest(*client1, callbacks, &active_request);
+  callbacks->onResponse(makeError("ASK 12182 10.0.0.1:6379"));
+
+  // Unknown nodes and other errors are passed on.
+  EXPECT_CALL(callbacks_, onResponse_(_));
+  callbacks->onResponse(makeError("MOVED 12182 10.0.0.3:6379"));
+
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(hosts_[0]));
+  expectRequest(*client1, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", value_, callbacks_));
+  EXPECT_CALL(callbacks_, onResponse_(_));
+  callbacks->onResponse(makeError("ERR unknown command"));
+
+  tls_.shutdownThread();
+}
+
+TEST_F(RedisClusterConnPoolImplTest, ReadPolicy) {
+  InSequence s;
+
+  setup("any");
+  MockClient* client1 = new NiceMock<MockClient>();
+  MockClient* client2 = new NiceMock<MockClient>();
+  PoolCallbacks* slots_callbacks;
+  MockPoolRequest slots_request;
+  PoolCallbacks* callbacks;
+  MockPoolRequest active_request;
+
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(IsNull())).WillOnce(Return(hosts_[0]));
+  EXPECT_CALL(*this, create_(Eq(hosts_[0]))).WillOnce(Return(client1));
+  EXPECT_CALL(*client1, makeRequest(Eq(ByRef(cluster_slots_request_)), _))
+      .WillOnce(DoAll(WithArg<1>(SaveArgAddress(&slots_callbacks)), Return(&slots_request)));
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(hosts_[0]));
+  expectRequest(*client1, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeReadRequest("foo", value_, callbacks_));
+  slots_callbacks->onResponse(makeReplicatedSlots());
+
+  // Reads go to the replica, which is sent READONLY first, and to the master in turn.
+  RespValue readonly_request;
+  makeArray(readonly_request, 1);
+  readonly_request.asArray()[0].type(RespType::BulkString);
+  readonly_request.asArray()[0].asString() = "readonly";
+  EXPECT_CALL(*this, create_(Eq(hosts_[1]))).WillOnce(Return(client2));
+  EXPECT_CALL(*client2, makeRequest(Eq(ByRef(readonly_request)), _)).WillOnce(Return(nullptr));
+  expectRequest(*client2, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeReadRequest("foo", value_, callbacks_));
+
+  expectRequest(*client1, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeReadRequest("foo", value_, callbacks_));
+
+  expectRequest(*client2, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeReadRequest("foo", value_, callbacks_));
+
+  // Writes go to the master.
+  expectRequest(*client1, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("foo", value_, callbacks_));
+
+  tls_.shutdownThread();
+}
+
+TEST_F(RedisClusterConnPoolImplTest, ReplicaReadPolicy) {
+  InSequence s;
+
+  setup("replica");
+  MockClient* client1 = new NiceMock<MockClient>();
+  PoolCallbacks* slots_callbacks;
+  MockPoolRequest slots_request;
+  PoolCallbacks* callbacks;
+  MockPoolRequest active_request;
+
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(IsNull())).WillOnce(Return(hosts_[0]));
+  EXPECT_CALL(*this, create_(Eq(hosts_[0]))).WillOnce(Return(client1));
+  EXPECT_CALL(*client1, makeRequest(Eq(ByRef(cluster_slots_request_)), _))
+      .WillOnce(DoAll(WithArg<1>(SaveArgAddress(&slots_callbacks)), Return(&slots_request)));
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, chooseHost(_)).WillOnce(Return(hosts_[0]));
+  expectRequest(*client1, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeReadRequest("foo", value_, callbacks_));
+
+  // Without replicas, reads fail and writes still go to the master.
+  slots_callbacks->onResponse(makeSlots());
+  EXPECT_EQ(nullptr, conn_pool_->makeReadRequest("bar", value_, callbacks_));
+  expectRequest(*client1, callbacks, &active_request);
+  EXPECT_NE(nullptr, conn_pool_->makeRequest("bar", value_, callbacks_));
+
+  tls_.shutdownThread();
+}
+
 } // namespace ConnPool
 } // namespace Redis
 } // namespace Envoy
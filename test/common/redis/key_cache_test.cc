@@ -0,0 +1,245 @@
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/json/json_loader.h"
+#include "common/redis/key_cache.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/common.h"
+#include "test/mocks/server/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+using testing::DoAll;
+using testing::NiceMock;
+using testing::Return;
+using testing::ReturnPointee;
+using testing::SaveArg;
+using testing::_;
+
+namespace Redis {
+
+TEST(HotKeyDetectorTest, SpaceSaving) {
+  HotKeyDetector detector(2);
+  for (int i = 0; i < 5; i++) {
+    detector.sample("a");
+  }
+  detector.sample("b");
+  detector.sample("b");
+
+  // c replaces b, the key with the lowest count, and starts from its count.
+  detector.sample("c");
+  std::vector<std::pair<std::string, uint64_t>> expected{{"a", 5}, {"c", 3}};
+  EXPECT_EQ(expected, detector.topKeys(2));
+
+  expected.resize(1);
+  EXPECT_EQ(expected, detector.topKeys(1));
+}
+
+class RedisKeyCacheTest : public testing::Test {
+public:
+  RedisKeyCacheTest() { ON_CALL(time_source_, currentTime()).WillByDefault(ReturnPointee(&now_)); }
+
+  ~RedisKeyCacheTest() {
+    if (cache_ && hot_keys_) {
+      EXPECT_CALL(admin_, removeHandler("/redis/foo/hot_keys"));
+    }
+    cache_.reset();
+  }
+
+  void initialize(const std::string& extra = "") {
+    const std::string json = R"EOF(
+    {
+      "max_entries": 2,
+      "ttl_ms": 1000,
+      "key_prefixes": ["user:"])EOF" + extra + R"EOF(
+    }
+    )EOF";
+    Json::ObjectSharedPtr config = Json::Factory::loadFromString(json);
+    cache_.reset(new KeyCache(*config, "redis.foo.", store_, tls_, time_source_, admin_));
+  }
+
+  void makeBulkStringArray(RespValue& value, const std::vector<std::string>& strings) {
+    std::vector<RespValue> values(strings.size());
+    for (uint64_t i = 0; i < strings.size(); i++) {
+      values[i].type(RespType::BulkString);
+      values[i].asString() = strings[i];
+    }
+
+    value.type(RespType::Array);
+    value.asArray().swap(values);
+  }
+
+  RespValuePtr request(const std::vector<std::string>& strings, KeyCache::Lookup& lookup) {
+    RespValue value;
+    makeBulkStringArray(value, strings);
+    return cache_->onRequest(value, lookup);
+  }
+
+  // Misses on a GET of key, and caches value as its response.
+  void fill(const std::string& key, const std::string& value) {
+    KeyCache::Lookup lookup;
+    EXPECT_EQ(nullptr, request({"get", key}, lookup));
+    EXPECT_TRUE(lookup.pending_);
+    RespValue response;
+    response.type(RespType::BulkString);
+    response.asString() = value;
+    cache_->onResponse(lookup, response);
+  }
+
+  void expectHit(const std::string& key, const std::string& value) {
+    KeyCache::Lookup lookup;
+    RespValuePtr response = request({"GET", key}, lookup);
+    ASSERT_NE(nullptr, response);
+    EXPECT_EQ(RespType::BulkString, response->type());
+    EXPECT_EQ(value, response->asString());
+    EXPECT_FALSE(lookup.pending_);
+  }
+
+  void expectMiss(const std::string& key) {
+    KeyCache::Lookup lookup;
+    EXPECT_EQ(nullptr, request({"get", key}, lookup));
+    EXPECT_TRUE(lookup.pending_);
+  }
+
+  MonotonicTime now_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  Stats::IsolatedStoreImpl store_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<Server::MockAdmin> admin_;
+  bool hot_keys_{};
+  std::unique_ptr<KeyCache> cache_;
+};
+
+TEST_F(RedisKeyCacheTest, HitAndExpire) {
+  initialize();
+  fill("user:1", "one");
+  expectHit("user:1", "one");
+
+  now_ += std::chrono::milliseconds(999);
+  expectHit("user:1", "one");
+
+  now_ += std::chrono::milliseconds(1);
+  expectMiss("user:1");
+
+  EXPECT_EQ(2UL, store_.counter("redis.foo.cache.hit").value());
+  EXPECT_EQ(2UL, store_.counter("redis.foo.cache.miss").value());
+  EXPECT_EQ(1UL, store_.counter("redis.foo.cache.insert").value());
+}
+
+TEST_F(RedisKeyCacheTest, NotCached) {
+  initialize();
+
+  // Keys outside the prefixes, and other commands, are never looked up.
+  KeyCache::Lookup lookup;
+  EXPECT_EQ(nullptr, request({"get", "session:1"}, lookup));
+  EXPECT_EQ(nullptr, request({"strlen", "user:1"}, lookup));
+  EXPECT_FALSE(lookup.pending_);
+
+  // Only bulk strings are cached, so a missing key is looked up again.
+  expectMiss("user:1");
+  lookup.pending_ = true;
+  lookup.key_ = "user:1";
+  RespValue nil;
+  cache_->onResponse(lookup, nil);
+  expectMiss("user:1");
+  EXPECT_EQ(0UL, store_.counter("redis.foo.cache.insert").value());
+}
+
+TEST_F(RedisKeyCacheTest, Invalidate) {
+  initialize();
+  fill("user:1", "one");
+  fill("user:2", "two");
+
+  KeyCache::Lookup lookup;
+  EXPECT_EQ(nullptr, request({"set", "user:1", "uno"}, lookup));
+  expectMiss("user:1");
+  expectHit("user:2", "two");
+
+  fill("user:1", "uno");
+  EXPECT_EQ(nullptr, request({"del", "user:3", "user:1", "user:2"}, lookup));
+  expectMiss("user:1");
+  expectMiss("user:2");
+
+  fill("user:1", "one");
+  fill("user:2", "two");
+  EXPECT_EQ(nullptr, request({"mset", "user:2", "user:1", "x", "y"}, lookup));
+  expectHit("user:1", "one");
+  expectMiss("user:2");
+
+  EXPECT_EQ(nullptr, request({"eval", "return 1", "1", "user:1", "user:2"}, lookup));
+  expectMiss("user:1");
+  EXPECT_EQ(5UL, store_.counter("redis.foo.cache.invalidate").value());
+
+  // Reads don't invalidate.
+  fill("user:1", "one");
+  EXPECT_EQ(nullptr, request({"strlen", "user:1"}, lookup));
+  expectHit("user:1", "one");
+}
+
+TEST_F(RedisKeyCacheTest, WriteWhileGetInFlight) {
+  initialize();
+  KeyCache::Lookup get;
+  EXPECT_EQ(nullptr, request({"get", "user:1"}, get));
+
+  KeyCache::Lookup set;
+  EXPECT_EQ(nullptr, request({"set", "user:1", "one"}, set));
+
+  // The GET may have been answered before the SET, so its response is not cached.
+  RespValue response;
+  response.type(RespType::BulkString);
+  response.asString() = "old";
+  cache_->onResponse(get, response);
+  expectMiss("user:1");
+}
+
+TEST_F(RedisKeyCacheTest, Evict) {
+  initialize();
+  fill("user:1", "one");
+  fill("user:2", "two");
+  expectHit("user:1", "one");
+
+  // user:2 is the least recently used.
+  fill("user:3", "three");
+  expectHit("user:1", "one");
+  expectMiss("user:2");
+  expectHit("user:3", "three");
+  EXPECT_EQ(1UL, store_.counter("redis.foo.cache.evict").value());
+}
+
+TEST_F(RedisKeyCacheTest, HotKeys) {
+  Server::Admin::HandlerCb handler;
+  EXPECT_CALL(admin_, addHandler("/redis/foo/hot_keys", _, _, true))
+      .WillOnce(DoAll(SaveArg<2>(&handler), Return(true)));
+  hot_keys_ = true;
+  initialize(R"EOF(,
+      "hot_keys": {"sample_rate": 2, "top_k": 1})EOF");
+
+  KeyCache::Lookup lookup;
+  for (int i = 0; i < 3; i++) {
+    request({"get", "a"}, lookup);
+    request({"incr", "b"}, lookup);
+  }
+
+  // Only every other request is sampled.
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, handler("/redis/foo/hot_keys", response));
+  EXPECT_EQ("b: 3\n", TestUtility::bufferToString(response));
+}
+
+TEST_F(RedisKeyCacheTest, HotKeysHandlerExists) {
+  EXPECT_CALL(admin_, addHandler("/redis/foo/hot_keys", _, _, true)).WillOnce(Return(false));
+  initialize(R"EOF(,
+      "hot_keys": {"top_k": 1})EOF");
+  EXPECT_CALL(admin_, removeHandler(_)).Times(0);
+}
+
+} // namespace Redis
+} // namespace Envoy
@@ -6,6 +6,8 @@
 #include "test/mocks/common.h"
 #include "test/mocks/network/mocks.h"
 #include "test/mocks/redis/mocks.h"
+#include "test/mocks/server/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 #include "test/test_common/printers.h"
 #include "test/test_common/utility.h"
@@ -41,6 +43,25 @@ TEST(RedisProxyFilterConfigTest, Normal) {
   Stats::IsolatedStoreImpl store;
   ProxyFilterConfig config(*json_config, cm, store);
   EXPECT_EQ("fake_cluster", config.clusterName());
+  EXPECT_EQ(std::chrono::milliseconds(0), config.slowCommandThreshold());
+}
+
+TEST(RedisProxyFilterConfigTest, SlowCommandLog) {
+  std::string json_string = R"EOF(
+  {
+    "cluster_name": "fake_cluster",
+    "stat_prefix": "foo",
+    "conn_pool": {},
+    "slow_command_log": {"threshold_ms": 50, "sample_one_in": 10}
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
+  NiceMock<Upstream::MockClusterManager> cm;
+  Stats::IsolatedStoreImpl store;
+  ProxyFilterConfig config(*json_config, cm, store);
+  EXPECT_EQ(std::chrono::milliseconds(50), config.slowCommandThreshold());
+  EXPECT_EQ(10U, config.slowCommandSampleOneIn());
 }
 
 TEST(RedisProxyFilterConfigTest, InvalidCluster) {
@@ -136,6 +157,72 @@ public:
   NiceMock<Network::MockReadFilterCallbacks> filter_callbacks_;
 };
 
+TEST_F(RedisProxyFilterTest, KeyCache) {
+  std::string json_string = R"EOF(
+  {
+    "max_entries": 10,
+    "ttl_ms": 1000
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
+  NiceMock<ThreadLocal::MockInstance> tls;
+  NiceMock<MockMonotonicTimeSource> time_source;
+  NiceMock<Server::MockAdmin> admin;
+  KeyCacheSharedPtr key_cache(
+      new KeyCache(*json_config, config_->statPrefix(), store_, tls, time_source, admin));
+  filter_.reset();
+  encoder_ = new MockEncoder();
+  decoder_ = new MockDecoder();
+  filter_.reset(new ProxyFilter(*this, EncoderPtr{encoder_}, splitter_, config_, key_cache));
+  filter_->initializeReadFilterCallbacks(filter_callbacks_);
+
+  const auto get = []() -> RespValuePtr {
+    std::vector<RespValue> values(2);
+    values[0].type(RespType::BulkString);
+    values[0].asString() = "get";
+    values[1].type(RespType::BulkString);
+    values[1].asString() = "foo";
+    RespValuePtr request(new RespValue());
+    request->type(RespType::Array);
+    request->asArray().swap(values);
+    return request;
+  };
+
+  Buffer::OwnedImpl fake_data;
+  CommandSplitter::MockSplitRequest* request_handle = new CommandSplitter::MockSplitRequest();
+  CommandSplitter::SplitCallbacks* request_callbacks;
+  EXPECT_CALL(*decoder_, decode(Ref(fake_data))).WillOnce(Invoke([&](Buffer::Instance&) -> void {
+    RespValuePtr request = get();
+    EXPECT_CALL(splitter_, makeRequest_(Ref(*request), _))
+        .WillOnce(DoAll(WithArg<1>(SaveArgAddress(&request_callbacks)), Return(request_handle)));
+    decoder_callbacks_->onRespValue(std::move(request));
+  }));
+  EXPECT_EQ(Network::FilterStatus::Continue, filter_->onData(fake_data));
+
+  RespValuePtr response(new RespValue());
+  response->type(RespType::BulkString);
+  response->asString() = "bar";
+  EXPECT_CALL(*encoder_, encode(Ref(*response), _));
+  EXPECT_CALL(filter_callbacks_.connection_, write(_));
+  request_callbacks->onResponse(std::move(response));
+
+  // The second GET is answered from the cache without reaching the splitter.
+  EXPECT_CALL(*decoder_, decode(Ref(fake_data))).WillOnce(Invoke([&](Buffer::Instance&) -> void {
+    decoder_callbacks_->onRespValue(get());
+  }));
+  EXPECT_CALL(*encoder_, encode(_, _))
+      .WillOnce(Invoke([](const RespValue& value, Buffer::Instance&) -> void {
+        EXPECT_EQ(RespType::BulkString, value.type());
+        EXPECT_EQ("bar", value.asString());
+      }));
+  EXPECT_CALL(filter_callbacks_.connection_, write(_));
+  EXPECT_EQ(Network::FilterStatus::Continue, filter_->onData(fake_data));
+
+  EXPECT_EQ(1UL, store_.counter("redis.foo.cache.hit").value());
+  EXPECT_EQ(2UL, config_->stats().downstream_rq_total_.value());
+}
+
 TEST_F(RedisProxyFilterTest, OutOfOrderResponse) {
   InSequence s;
 
@@ -0,0 +1,109 @@
+#include <string>
+
+#include "common/config/rds_json.h"
+#include "common/http/header_map_impl.h"
+#include "common/json/json_loader.h"
+#include "common/router/config_impl.h"
+
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+#include "test/test_common/utility.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Router {
+namespace {
+
+/**
+ * @return std::string a route configuration with a number of virtual hosts, each with a number of
+ *         prefix routes, plus a wildcard host with regex routes and a catch all default host.
+ */
+std::string routeConfigJson(uint32_t num_hosts, uint32_t num_routes) {
+  std::string json = R"EOF({"virtual_hosts": [)EOF";
+  for (uint32_t host = 0; host < num_hosts; host++) {
+    json += fmt::format(R"EOF({{"name": "host_{0}", "domains": ["host{0}.example.com"],
+                             "routes": [)EOF",
+                        host);
+    for (uint32_t route = 0; route < num_routes; route++) {
+      json += fmt::format(R"EOF({{"prefix": "/service_{0}/", "cluster": "cluster_{0}"}},)EOF",
+                          route);
+    }
+    json += R"EOF({"prefix": "/", "cluster": "default"}]},)EOF";
+  }
+
+  json += R"EOF({"name": "wildcard", "domains": ["*.wild.example.com"], "routes": [)EOF";
+  for (uint32_t route = 0; route < num_routes; route++) {
+    json += fmt::format(R"EOF({{"regex": "/regex_{0}/[0-9]+", "cluster": "cluster_{0}"}},)EOF",
+                        route);
+  }
+  json += R"EOF({"prefix": "/", "cluster": "default"}]},)EOF";
+  json += R"EOF({"name": "default", "domains": ["*"],
+                 "routes": [{"prefix": "/", "cluster": "default"}]}]})EOF";
+  return json;
+}
+
+/**
+ * A route table with 100 virtual hosts of 10 routes each.
+ */
+class RouteFixture {
+public:
+  RouteFixture() {
+    envoy::api::v2::RouteConfiguration route_config;
+    Config::RdsJson::translateRouteConfiguration(
+        *Json::Factory::loadFromString(routeConfigJson(100, 10)), route_config);
+    config_.reset(new ConfigImpl(route_config, runtime_, cm_, false));
+  }
+
+  testing::NiceMock<Runtime::MockLoader> runtime_;
+  testing::NiceMock<Upstream::MockClusterManager> cm_;
+  std::unique_ptr<ConfigImpl> config_;
+};
+
+void routeBenchmark(benchmark::State& state, const std::string& host, const std::string& path) {
+  RouteFixture fixture;
+  Http::TestHeaderMapImpl headers{{":authority", host}, {":path", path}, {":method", "GET"}};
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(fixture.config_->route(headers, 0));
+  }
+}
+
+void BM_RouteMatcherExactHostFirstRoute(benchmark::State& state) {
+  routeBenchmark(state, "host50.example.com", "/service_0/foo");
+}
+BENCHMARK(BM_RouteMatcherExactHostFirstRoute);
+
+void BM_RouteMatcherExactHostLastRoute(benchmark::State& state) {
+  routeBenchmark(state, "host50.example.com", "/service_9/foo");
+}
+BENCHMARK(BM_RouteMatcherExactHostLastRoute);
+
+void BM_RouteMatcherWildcardHostRegex(benchmark::State& state) {
+  routeBenchmark(state, "api.wild.example.com", "/regex_9/1234");
+}
+BENCHMARK(BM_RouteMatcherWildcardHostRegex);
+
+void BM_RouteMatcherDefaultHost(benchmark::State& state) {
+  routeBenchmark(state, "unknown.example.org", "/anything");
+}
+BENCHMARK(BM_RouteMatcherDefaultHost);
+
+/**
+ * Loads a route configuration of state.range(0) virtual hosts with 10 routes each, from JSON text
+ * through schema validation to the translated proto.
+ */
+void BM_RouteConfigLoad(benchmark::State& state) {
+  const std::string json = routeConfigJson(state.range(0), 10);
+  while (state.KeepRunning()) {
+    envoy::api::v2::RouteConfiguration route_config;
+    Config::RdsJson::translateRouteConfiguration(*Json::Factory::loadFromString(json),
+                                                 route_config);
+    benchmark::DoNotOptimize(route_config);
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_RouteConfigLoad)->Arg(10)->Arg(100)->Arg(1000);
+
+} // namespace
+} // namespace Router
+} // namespace Envoy
@@ -9,6 +9,7 @@
 #include "common/http/headers.h"
 #include "common/json/json_loader.h"
 #include "common/router/config_impl.h"
+#include "common/stats/stats_impl.h"
 
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/upstream/mocks.h"
@@ -161,8 +162,7 @@ TEST(RouteMatcherTest, TestRoutes) {
         {"pattern": "^/rides$", "method": "POST", "name": "ride_request"},
         {"pattern": "^/rides/\\d+$", "method": "PUT", "name": "update_ride"},
         {"pattern": "^/users/\\d+/chargeaccounts$", "method": "POST", "name": "cc_add"},
-        {"pattern": "^/users/\\d+/chargeaccounts/(?!validate)\\w+$", "method": "PUT",
-         "name": "cc_add"},
+        {"pattern": "^/users/\\d+/chargeaccounts/\\w+$", "method": "PUT", "name": "cc_add"},
         {"pattern": "^/users$", "method": "POST", "name": "create_user_login"},
         {"pattern": "^/users/\\d+$", "method": "PUT", "name": "update_user"},
         {"pattern": "^/users/\\d+/location$", "method": "POST", "name": "ulu"}]
@@ -180,6 +180,10 @@ TEST(RouteMatcherTest, TestRoutes) {
   // Base routing testing.
   EXPECT_EQ("instant-server",
             config.route(genHeaders("api.lyft.com", "/", "GET"), 0)->routeEntry()->clusterName());
+  EXPECT_EQ(cm.clusterId("instant-server"), config.route(genHeaders("api.lyft.com", "/", "GET"), 0)
+                                                ->routeEntry()
+                                                ->clusterId()
+                                                .value());
   EXPECT_EQ("ats", config.route(genHeaders("api.lyft.com", "/api/leads/me", "GET"), 0)
                        ->routeEntry()
                        ->clusterName());
@@ -341,7 +345,7 @@ TEST(RouteMatcherTest, TestRoutes) {
   }
   {
     Http::TestHeaderMapImpl headers =
-        genHeaders("api.lyft.com", "/users/123/chargeaccounts/validate", "PUT");
+        genHeaders("api.lyft.com", "/users/123/chargeaccounts/hello-123", "PUT");
     EXPECT_EQ("other", config.route(headers, 0)->routeEntry()->virtualCluster(headers)->name());
   }
   {
@@ -702,6 +706,198 @@ TEST(RouteMatcherTest, HeaderMatchedRouting) {
   }
 }
 
+TEST(RouteMatcherTest, RouteCache) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "path_only",
+      "domains": ["www.lyft.com"],
+      "routes": [
+        {
+          "path": "/foo",
+          "cluster": "foo"
+        },
+        {
+          "prefix": "/",
+          "case_sensitive": false,
+          "cluster": "default"
+        }
+      ]
+    },
+    {
+      "name": "with_headers",
+      "domains": ["api.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "with_headers",
+          "headers" : [
+            {"name": "test_header", "value": "test"}
+          ]
+        },
+        {
+          "prefix": "/",
+          "cluster": "without_headers"
+        }
+      ]
+    }
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ON_CALL(runtime.snapshot_, getInteger("router.route_cache_size", 0)).WillByDefault(Return(2));
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+  RouteCache& cache = RouteCache::get();
+  cache.clear();
+
+  RouteConstSharedPtr foo = config.route(genHeaders("www.lyft.com", "/foo", "GET"), 0);
+  EXPECT_EQ("foo", foo->routeEntry()->clusterName());
+  EXPECT_EQ(foo, config.route(genHeaders("www.lyft.com", "/foo", "GET"), 0));
+  EXPECT_EQ("default", config.route(genHeaders("www.lyft.com", "/foo?bar", "GET"), 0)
+                           ->routeEntry()
+                           ->clusterName());
+  EXPECT_EQ(2U, cache.size());
+
+  // The cache is bounded.
+  EXPECT_EQ("default", config.route(genHeaders("www.lyft.com", "/bar", "GET"), 0)
+                           ->routeEntry()
+                           ->clusterName());
+  EXPECT_EQ(2U, cache.size());
+
+  // Routes that look at headers are never cached.
+  EXPECT_EQ("without_headers",
+            config.route(genHeaders("api.lyft.com", "/", "GET"), 0)->routeEntry()->clusterName());
+  Http::TestHeaderMapImpl headers = genHeaders("api.lyft.com", "/", "GET");
+  headers.addCopy("test_header", "test");
+  EXPECT_EQ("with_headers", config.route(headers, 0)->routeEntry()->clusterName());
+
+  // Each route table has entries of its own.
+  ConfigImpl other_config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+  RouteConstSharedPtr other_foo = other_config.route(genHeaders("www.lyft.com", "/foo", "GET"), 0);
+  EXPECT_NE(foo, other_foo);
+  EXPECT_EQ("foo", other_foo->routeEntry()->clusterName());
+
+  cache.clear();
+}
+
+TEST(RouteMatcherTest, CarriesOverUnchangedVirtualHosts) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "www",
+      "domains": ["www.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "www"
+        }
+      ]
+    },
+    {
+      "name": "api",
+      "domains": ["api.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "api"
+        }
+      ]
+    }
+  ],
+  "request_headers_to_add": [
+    {"key": "x-global-header", "value": "global"}
+  ]
+}
+  )EOF";
+
+  std::string changed_json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "www",
+      "domains": ["www.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "www"
+        }
+      ]
+    },
+    {
+      "name": "api",
+      "domains": ["api.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "api2"
+        }
+      ]
+    }
+  ],
+  "request_headers_to_add": [
+    {"key": "x-global-header", "value": "global"}
+  ]
+}
+  )EOF";
+
+  std::string changed_headers_json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "www",
+      "domains": ["www.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "cluster": "www"
+        }
+      ]
+    }
+  ],
+  "request_headers_to_add": [
+    {"key": "x-global-header", "value": "changed"}
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  std::unique_ptr<ConfigImpl> config(
+      new ConfigImpl(parseRouteConfigurationFromJson(json), runtime, cm, true));
+  RouteConstSharedPtr www = config->route(genHeaders("www.lyft.com", "/", "GET"), 0);
+  RouteConstSharedPtr api = config->route(genHeaders("api.lyft.com", "/", "GET"), 0);
+
+  ConfigImpl changed_config(parseRouteConfigurationFromJson(changed_json), runtime, cm, true,
+                            config.get());
+  config.reset();
+
+  // The unchanged virtual host is shared and outlives the previous route table.
+  RouteConstSharedPtr changed_www = changed_config.route(genHeaders("www.lyft.com", "/", "GET"), 0);
+  EXPECT_EQ(www, changed_www);
+  EXPECT_NE(api, changed_config.route(genHeaders("api.lyft.com", "/", "GET"), 0));
+  EXPECT_EQ("api2", changed_config.route(genHeaders("api.lyft.com", "/", "GET"), 0)
+                        ->routeEntry()
+                        ->clusterName());
+
+  Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/", "GET");
+  changed_www->routeEntry()->finalizeRequestHeaders(headers);
+  EXPECT_EQ("global", headers.get_("x-global-header"));
+
+  // Virtual hosts are rebuilt when the headers of the route table change.
+  ConfigImpl changed_headers_config(parseRouteConfigurationFromJson(changed_headers_json), runtime,
+                                    cm, true, &changed_config);
+  RouteConstSharedPtr rebuilt_www =
+      changed_headers_config.route(genHeaders("www.lyft.com", "/", "GET"), 0);
+  EXPECT_NE(www, rebuilt_www);
+  Http::TestHeaderMapImpl rebuilt_headers = genHeaders("www.lyft.com", "/", "GET");
+  rebuilt_www->routeEntry()->finalizeRequestHeaders(rebuilt_headers);
+  EXPECT_EQ("changed", rebuilt_headers.get_("x-global-header"));
+}
+
 TEST(RouterMatcherTest, HashPolicy) {
   std::string json = R"EOF(
 {
@@ -787,6 +983,12 @@ TEST(RouteMatcherTest, ClusterHeader) {
   EXPECT_EQ(
       "", config.route(genHeaders("www.lyft.com", "/bar", "GET"), 0)->routeEntry()->clusterName());
 
+  // The cluster is only known per request, so it is not interned.
+  EXPECT_FALSE(config.route(genHeaders("some_cluster", "/foo", "GET"), 0)
+                   ->routeEntry()
+                   ->clusterId()
+                   .valid());
+
   {
     Http::TestHeaderMapImpl headers = genHeaders("www.lyft.com", "/bar", "GET");
     headers.addCopy("some_header", "some_cluster");
@@ -1569,6 +1771,10 @@ TEST(RouteMatcherTest, WeightedClusters) {
     EXPECT_EQ("cluster1", config.route(headers, 115)->routeEntry()->clusterName());
     EXPECT_EQ("cluster2", config.route(headers, 445)->routeEntry()->clusterName());
     EXPECT_EQ("cluster3", config.route(headers, 560)->routeEntry()->clusterName());
+
+    // Each weighted cluster interns its own name.
+    EXPECT_EQ(cm.clusterId("cluster2"),
+              config.route(headers, 445)->routeEntry()->clusterId().value());
   }
 
   // Make sure weighted cluster entries call through to the parent when needed.
@@ -1577,6 +1783,7 @@ TEST(RouteMatcherTest, WeightedClusters) {
     const RouteEntry* route = config.route(headers, 115)->routeEntry();
     EXPECT_EQ(nullptr, route->hashPolicy());
     EXPECT_TRUE(route->opaqueConfig().empty());
+    EXPECT_EQ(nullptr, route->metadataMatchCriteria());
     EXPECT_FALSE(route->autoHostRewrite());
     EXPECT_FALSE(route->useWebSocket());
     EXPECT_TRUE(route->includeVirtualHostRateLimits());
@@ -1618,6 +1825,57 @@ TEST(RouteMatcherTest, WeightedClusters) {
   }
 }
 
+TEST(RouteMatcherTest, WeightedClusterTableFollowsRuntime) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "www2",
+      "domains": ["www2.lyft.com"],
+      "routes": [
+        {
+          "prefix": "/",
+          "weighted_clusters": {
+            "runtime_key_prefix" : "www2_weights",
+            "clusters" : [
+              { "name" : "cluster1", "weight" : 30 },
+              { "name" : "cluster2", "weight" : 30 },
+              { "name" : "cluster3", "weight" : 40 }
+            ]
+          }
+        }
+      ]
+    }
+  ]
+}
+  )EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  Stats::IsolatedStoreImpl store;
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true, nullptr, &store);
+  Http::TestHeaderMapImpl headers = genHeaders("www2.lyft.com", "/foo", "GET");
+
+  // The weights are only looked up again once the runtime snapshot changes.
+  EXPECT_CALL(runtime.snapshot_, version()).WillRepeatedly(Return(1));
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster1", 30)).WillOnce(Return(30));
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster2", 30)).WillOnce(Return(30));
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster3", 40)).WillOnce(Return(40));
+  EXPECT_EQ("cluster1", config.route(headers, 29)->routeEntry()->clusterName());
+  EXPECT_EQ("cluster2", config.route(headers, 30)->routeEntry()->clusterName());
+  EXPECT_EQ("cluster3", config.route(headers, 199)->routeEntry()->clusterName());
+  EXPECT_EQ(1UL, store.counter("weighted_cluster_table_rebuilt").value());
+
+  EXPECT_CALL(runtime.snapshot_, version()).WillRepeatedly(Return(2));
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster1", 30)).WillOnce(Return(0));
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster2", 30)).WillOnce(Return(50));
+  EXPECT_CALL(runtime.snapshot_, getInteger("www2_weights.cluster3", 40)).WillOnce(Return(50));
+  EXPECT_EQ("cluster2", config.route(headers, 0)->routeEntry()->clusterName());
+  EXPECT_EQ("cluster2", config.route(headers, 49)->routeEntry()->clusterName());
+  EXPECT_EQ("cluster3", config.route(headers, 50)->routeEntry()->clusterName());
+  EXPECT_EQ(2UL, store.counter("weighted_cluster_table_rebuilt").value());
+}
+
 TEST(RouteMatcherTest, ExclusiveWeightedClustersOrClusterConfig) {
   std::string json = R"EOF(
 {
@@ -1945,6 +2203,57 @@ TEST(RouteMatcherTest, TestOpaqueConfig) {
   EXPECT_EQ(opaque_config.find("name2")->second, "value2");
 }
 
+TEST(RouteMatcherTest, TestMetadataMatch) {
+  std::string json = R"EOF(
+{
+  "virtual_hosts": [
+    {
+      "name": "default",
+      "domains": ["*"],
+      "routes": [
+        {
+          "prefix": "/api",
+          "cluster": "ats",
+          "metadata_match" : {
+              "version": "1.2",
+              "stage": "prod"
+          }
+        },
+        {
+          "prefix": "/",
+          "weighted_clusters": {
+            "clusters" : [{ "name" : "ats", "weight" : 100 }]
+          },
+          "metadata_match" : {"stage": "canary"}
+        }
+      ]
+    }
+  ]
+}
+)EOF";
+
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<Upstream::MockClusterManager> cm;
+  ConfigImpl config(parseRouteConfigurationFromJson(json), runtime, cm, true);
+
+  // Criteria are sorted by key.
+  const Upstream::MetadataMatchCriteria* criteria =
+      config.route(genHeaders("api.lyft.com", "/api", "GET"), 0)
+          ->routeEntry()
+          ->metadataMatchCriteria();
+  ASSERT_NE(nullptr, criteria);
+  const Upstream::MetadataMatchCriteria expected{{"stage", "prod"}, {"version", "1.2"}};
+  EXPECT_EQ(expected, *criteria);
+
+  // Weighted clusters use the criteria of their route.
+  criteria = config.route(genHeaders("api.lyft.com", "/foo", "GET"), 0)
+                 ->routeEntry()
+                 ->metadataMatchCriteria();
+  ASSERT_NE(nullptr, criteria);
+  const Upstream::MetadataMatchCriteria expected_canary{{"stage", "canary"}};
+  EXPECT_EQ(expected_canary, *criteria);
+}
+
 TEST(RoutePropertyTest, excludeVHRateLimits) {
   std::string json = R"EOF(
   {
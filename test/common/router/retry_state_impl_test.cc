@@ -270,21 +270,24 @@ TEST_F(RouterRetryStateImplTest, Backoff) {
   setup(request_headers);
   EXPECT_TRUE(state_->enabled());
 
+  // Between 25ms and 75ms.
   EXPECT_CALL(random_, random()).WillOnce(Return(49));
   retry_timer_ = new Event::MockTimer(&dispatcher_);
-  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(24)));
+  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(74)));
   EXPECT_TRUE(state_->shouldRetry(nullptr, connect_failure_, callback_));
   EXPECT_CALL(callback_ready_, ready());
   retry_timer_->callback_();
 
+  // Between 25ms and 3 * 74ms.
   EXPECT_CALL(random_, random()).WillOnce(Return(149));
-  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(74)));
+  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(174)));
   EXPECT_TRUE(state_->shouldRetry(nullptr, connect_failure_, callback_));
   EXPECT_CALL(callback_ready_, ready());
   retry_timer_->callback_();
 
+  // Between 25ms and the 250ms max.
   EXPECT_CALL(random_, random()).WillOnce(Return(349));
-  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(174)));
+  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(148)));
   EXPECT_TRUE(state_->shouldRetry(nullptr, connect_failure_, callback_));
   EXPECT_CALL(callback_ready_, ready());
   retry_timer_->callback_();
@@ -296,6 +299,85 @@ TEST_F(RouterRetryStateImplTest, Backoff) {
   EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_success_.value());
 }
 
+TEST_F(RouterRetryStateImplTest, BackoffMax) {
+  policy_.num_retries_ = 2;
+  policy_.retry_on_ = RetryPolicy::RETRY_ON_CONNECT_FAILURE;
+  ON_CALL(runtime_.snapshot_, getInteger("upstream.max_retry_backoff_ms", 250))
+      .WillByDefault(Return(50));
+  Http::TestHeaderMapImpl request_headers;
+  setup(request_headers);
+
+  EXPECT_CALL(random_, random()).WillOnce(Return(49));
+  retry_timer_ = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(48)));
+  EXPECT_TRUE(state_->shouldRetry(nullptr, connect_failure_, callback_));
+  EXPECT_CALL(callback_ready_, ready());
+  retry_timer_->callback_();
+
+  EXPECT_CALL(random_, random()).WillOnce(Return(25));
+  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(50)));
+  EXPECT_TRUE(state_->shouldRetry(nullptr, connect_failure_, callback_));
+}
+
+TEST_F(RouterRetryStateImplTest, RetryAfter) {
+  policy_.num_retries_ = 3;
+  policy_.retry_on_ = RetryPolicy::RETRY_ON_5XX;
+  Http::TestHeaderMapImpl request_headers;
+  setup(request_headers);
+
+  EXPECT_CALL(random_, random()).Times(0);
+  Http::TestHeaderMapImpl response_headers{{":status", "503"}, {"retry-after", "0"}};
+  retry_timer_ = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(0)));
+  EXPECT_TRUE(state_->shouldRetry(&response_headers, no_reset_, callback_));
+  EXPECT_CALL(callback_ready_, ready());
+  retry_timer_->callback_();
+
+  // Longer than the max back off.
+  Http::TestHeaderMapImpl long_response_headers{{":status", "503"}, {"retry-after", "1"}};
+  EXPECT_FALSE(state_->shouldRetry(&long_response_headers, no_reset_, callback_));
+
+  // Much longer than the max back off, such that the delay in milliseconds would wrap around to
+  // 152 ms.
+  Http::TestHeaderMapImpl huge_response_headers{{":status", "503"},
+                                                {"retry-after", "55340232221128655"}};
+  EXPECT_FALSE(state_->shouldRetry(&huge_response_headers, no_reset_, callback_));
+
+  // An HTTP date is ignored.
+  Http::TestHeaderMapImpl date_response_headers{{":status", "503"},
+                                                {"retry-after", "Wed, 21 Oct 2015 07:28:00 GMT"}};
+  EXPECT_CALL(random_, random()).WillOnce(Return(0));
+  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(25)));
+  EXPECT_TRUE(state_->shouldRetry(&date_response_headers, no_reset_, callback_));
+
+  EXPECT_EQ(2UL, cluster_.stats().upstream_rq_retry_.value());
+  EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_pushback_.value());
+}
+
+TEST_F(RouterRetryStateImplTest, GrpcRetryPushback) {
+  policy_.num_retries_ = 2;
+  policy_.retry_on_ = RetryPolicy::RETRY_ON_GRPC_RESOURCE_EXHAUSTED;
+  Http::TestHeaderMapImpl request_headers;
+  setup(request_headers);
+
+  EXPECT_CALL(random_, random()).Times(0);
+  Http::TestHeaderMapImpl response_headers{
+      {":status", "200"}, {"grpc-status", "8"}, {"grpc-retry-pushback-ms", "120"}};
+  retry_timer_ = new Event::MockTimer(&dispatcher_);
+  EXPECT_CALL(*retry_timer_, enableTimer(std::chrono::milliseconds(120)));
+  EXPECT_TRUE(state_->shouldRetry(&response_headers, no_reset_, callback_));
+  EXPECT_CALL(callback_ready_, ready());
+  retry_timer_->callback_();
+
+  // A negative pushback means do not retry.
+  Http::TestHeaderMapImpl negative_response_headers{
+      {":status", "200"}, {"grpc-status", "8"}, {"grpc-retry-pushback-ms", "-1"}};
+  EXPECT_FALSE(state_->shouldRetry(&negative_response_headers, no_reset_, callback_));
+
+  EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_.value());
+  EXPECT_EQ(1UL, cluster_.stats().upstream_rq_retry_pushback_.value());
+}
+
 TEST_F(RouterRetryStateImplTest, Cancel) {
   // Cover the case where we start a retry, and then we get destructed. This is how the router
   // uses the implementation in the cancel case.
@@ -0,0 +1,78 @@
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "common/router/route_cache.h"
+
+#include "test/mocks/router/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Router {
+
+class RouteCacheTest : public testing::Test {
+public:
+  void TearDown() override { cache_.clear(); }
+
+  RouteConstSharedPtr find(const std::string& key) {
+    RouteConstSharedPtr route;
+    EXPECT_TRUE(cache_.find(key, route));
+    return route;
+  }
+
+  bool contains(const std::string& key) {
+    RouteConstSharedPtr route;
+    return cache_.find(key, route);
+  }
+
+  RouteCache& cache_{RouteCache::get()};
+  RouteConstSharedPtr route1_{std::make_shared<testing::NiceMock<MockRoute>>()};
+  RouteConstSharedPtr route2_{std::make_shared<testing::NiceMock<MockRoute>>()};
+};
+
+TEST_F(RouteCacheTest, FindAndInsert) {
+  EXPECT_FALSE(contains("a"));
+  cache_.insert("a", route1_, 10);
+  cache_.insert("b", nullptr, 10);
+  EXPECT_EQ(route1_, find("a"));
+  EXPECT_EQ(nullptr, find("b"));
+  EXPECT_EQ(2U, cache_.size());
+
+  cache_.insert("a", route2_, 10);
+  EXPECT_EQ(route2_, find("a"));
+  EXPECT_EQ(2U, cache_.size());
+}
+
+TEST_F(RouteCacheTest, EvictsLeastRecentlyUsed) {
+  cache_.insert("a", route1_, 2);
+  cache_.insert("b", route1_, 2);
+  find("a");
+  cache_.insert("c", route2_, 2);
+
+  EXPECT_FALSE(contains("b"));
+  EXPECT_EQ(route1_, find("a"));
+  EXPECT_EQ(route2_, find("c"));
+
+  // A smaller bound from another route table shrinks the cache.
+  cache_.insert("d", route2_, 1);
+  EXPECT_EQ(1U, cache_.size());
+  EXPECT_EQ(route2_, find("d"));
+}
+
+TEST_F(RouteCacheTest, Disabled) {
+  cache_.insert("a", route1_, 0);
+  EXPECT_FALSE(contains("a"));
+  EXPECT_EQ(0U, cache_.size());
+}
+
+TEST_F(RouteCacheTest, PerThread) {
+  cache_.insert("a", route1_, 10);
+  std::thread thread([]() -> void { EXPECT_EQ(0U, RouteCache::get().size()); });
+  thread.join();
+  EXPECT_EQ(1U, cache_.size());
+}
+
+} // namespace Router
+} // namespace Envoy
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/router/route_trie.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Router {
+
+class RouteTrieTest : public testing::Test {
+public:
+  std::vector<uint32_t> candidates(const std::string& path) {
+    std::vector<uint32_t> candidates;
+    trie_.candidates(path.c_str(), path.size(), candidates);
+    return candidates;
+  }
+
+  RouteTrie trie_;
+};
+
+TEST_F(RouteTrieTest, Empty) {
+  EXPECT_TRUE(candidates("/").empty());
+  EXPECT_TRUE(candidates("").empty());
+}
+
+TEST_F(RouteTrieTest, Prefixes) {
+  trie_.addPrefix("/foo/bar", 0);
+  trie_.addPrefix("/foo", 1);
+  trie_.addPrefix("/", 2);
+  trie_.addPrefix("/fob", 3);
+  trie_.addPrefix("", 4);
+
+  EXPECT_EQ((std::vector<uint32_t>{0, 1, 2, 4}), candidates("/foo/bar/baz"));
+  EXPECT_EQ((std::vector<uint32_t>{1, 2, 4}), candidates("/foo/ba"));
+  EXPECT_EQ((std::vector<uint32_t>{1, 2, 4}), candidates("/foo"));
+  EXPECT_EQ((std::vector<uint32_t>{2, 4}), candidates("/fo"));
+  EXPECT_EQ((std::vector<uint32_t>{2, 3, 4}), candidates("/fob?a=b"));
+  EXPECT_EQ((std::vector<uint32_t>{4}), candidates("foo"));
+}
+
+TEST_F(RouteTrieTest, PrefixMatchesQueryString) {
+  trie_.addPrefix("/foo?bar", 0);
+
+  EXPECT_EQ((std::vector<uint32_t>{0}), candidates("/foo?bar=baz"));
+  EXPECT_TRUE(candidates("/foo?ba").empty());
+}
+
+TEST_F(RouteTrieTest, Paths) {
+  trie_.addPath("/foo", 0);
+  trie_.addPath("/foo/bar", 1);
+  trie_.addPath("/", 2);
+  trie_.addPath("/foo", 3);
+
+  EXPECT_EQ((std::vector<uint32_t>{0, 3}), candidates("/foo"));
+  EXPECT_EQ((std::vector<uint32_t>{0, 3}), candidates("/foo?bar=baz"));
+  EXPECT_EQ((std::vector<uint32_t>{1}), candidates("/foo/bar"));
+  EXPECT_EQ((std::vector<uint32_t>{2}), candidates("/"));
+  EXPECT_EQ((std::vector<uint32_t>{2}), candidates("/?foo"));
+  EXPECT_TRUE(candidates("/foo/").empty());
+  EXPECT_TRUE(candidates("/fo").empty());
+  EXPECT_TRUE(candidates("/foo/barbaz").empty());
+}
+
+TEST_F(RouteTrieTest, PathWithQueryStringNeverMatches) {
+  trie_.addPath("/foo?bar", 0);
+
+  EXPECT_TRUE(candidates("/foo?bar").empty());
+  EXPECT_TRUE(candidates("/foo").empty());
+}
+
+TEST_F(RouteTrieTest, IgnoresCase) {
+  trie_.addPrefix("/Foo", 0);
+  trie_.addPath("/fOO/BAR", 1);
+
+  EXPECT_EQ((std::vector<uint32_t>{0}), candidates("/FOO"));
+  EXPECT_EQ((std::vector<uint32_t>{0, 1}), candidates("/foo/bar"));
+  EXPECT_EQ((std::vector<uint32_t>{0, 1}), candidates("/Foo/Bar?Baz"));
+}
+
+TEST_F(RouteTrieTest, MixedInOrder) {
+  trie_.addPath("/api/v1/users", 0);
+  trie_.addPrefix("/api/v2", 1);
+  trie_.addPrefix("/api", 2);
+  trie_.addPath("/api/v2", 3);
+  trie_.addPrefix("/api/v1/", 4);
+  trie_.addPrefix("/", 5);
+
+  EXPECT_EQ((std::vector<uint32_t>{0, 2, 4, 5}), candidates("/api/v1/users"));
+  EXPECT_EQ((std::vector<uint32_t>{1, 2, 3, 5}), candidates("/api/v2"));
+  EXPECT_EQ((std::vector<uint32_t>{1, 2, 5}), candidates("/api/v2/users"));
+  EXPECT_EQ((std::vector<uint32_t>{2, 5}), candidates("/api/v3"));
+  EXPECT_EQ((std::vector<uint32_t>{5}), candidates("/other"));
+}
+
+TEST_F(RouteTrieTest, ManyRoutes) {
+  for (uint32_t i = 0; i < 3000; i++) {
+    trie_.addPath("/service/" + std::to_string(i) + "/method", 2 * i);
+    trie_.addPrefix("/service/" + std::to_string(i) + "/", 2 * i + 1);
+  }
+
+  EXPECT_EQ((std::vector<uint32_t>{5998, 5999}), candidates("/service/2999/method"));
+  EXPECT_EQ((std::vector<uint32_t>{201}), candidates("/service/100/other"));
+  EXPECT_EQ((std::vector<uint32_t>{21}), candidates("/service/10/method/"));
+  EXPECT_TRUE(candidates("/service/3000/method").empty());
+}
+
+} // namespace Router
+} // namespace Envoy
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "common/buffer/buffer_impl.h"
+#include "common/common/hash.h"
 #include "common/network/utility.h"
 #include "common/router/router.h"
 #include "common/upstream/upstream_impl.h"
@@ -24,6 +25,7 @@ namespace Envoy {
 using testing::AtLeast;
 using testing::Invoke;
 using testing::NiceMock;
+using testing::Ref;
 using testing::Return;
 using testing::ReturnRef;
 using testing::SaveArg;
@@ -71,6 +73,47 @@ public:
     EXPECT_CALL(*per_try_timeout_, disableTimer());
   }
 
+  void expectHedgeTimerCreate() {
+    hedge_timeout_ = new Event::MockTimer(&callbacks_.dispatcher_);
+    EXPECT_CALL(*hedge_timeout_, enableTimer(std::chrono::milliseconds(5)));
+    EXPECT_CALL(*hedge_timeout_, disableTimer());
+  }
+
+  // Sends a request that is hedged after 5ms, and fires the hedge timer. The hedge goes to
+  // hedge_pool_.
+  void sendHedgedRequest() {
+    EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+        .WillOnce(Invoke([&](Http::StreamDecoder& decoder,
+                             Http::ConnectionPool::Callbacks& callbacks)
+                             -> Http::ConnectionPool::Cancellable* {
+          response_decoder1_ = &decoder;
+          callbacks.onPoolReady(encoder1_, cm_.conn_pool_.host_);
+          return nullptr;
+        }));
+    expectResponseTimerCreate();
+    expectHedgeTimerCreate();
+
+    Http::TestHeaderMapImpl headers{{"x-envoy-internal", "true"},
+                                    {"x-envoy-upstream-rq-hedge-delay-ms", "5"}};
+    HttpTestUtility::addDefaultHeaders(headers);
+    router_.decodeHeaders(headers, true);
+
+    EXPECT_CALL(cm_, httpConnPoolForCluster(_, _, _)).WillOnce(Return(&hedge_pool_));
+    EXPECT_CALL(hedge_pool_, newStream(_, _))
+        .WillOnce(Invoke([&](Http::StreamDecoder& decoder,
+                             Http::ConnectionPool::Callbacks& callbacks)
+                             -> Http::ConnectionPool::Cancellable* {
+          response_decoder2_ = &decoder;
+          callbacks.onPoolReady(encoder2_, hedge_pool_.host_);
+          return nullptr;
+        }));
+    EXPECT_CALL(encoder2_, encodeHeaders(_, true));
+    hedge_timeout_->callback_();
+    EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                      .counter("upstream_rq_hedge")
+                      .value());
+  }
+
   std::string upstream_zone_{"to_az"};
   Stats::IsolatedStoreImpl stats_store_;
   NiceMock<Upstream::MockClusterManager> cm_;
@@ -84,6 +127,12 @@ public:
   TestFilter router_;
   Event::MockTimer* response_timeout_{};
   Event::MockTimer* per_try_timeout_{};
+  Event::MockTimer* hedge_timeout_{};
+  NiceMock<Http::ConnectionPool::MockInstance> hedge_pool_;
+  NiceMock<Http::MockStreamEncoder> encoder1_;
+  NiceMock<Http::MockStreamEncoder> encoder2_;
+  Http::StreamDecoder* response_decoder1_{};
+  Http::StreamDecoder* response_decoder2_{};
   Network::Address::InstanceConstSharedPtr host_address_{
       Network::Utility::resolveUrl("tcp://10.0.0.5:9211")};
 };
@@ -755,6 +804,7 @@ TEST_F(RouterTest, RetryUpstream5xxNotComplete) {
   EXPECT_CALL(*router_.retry_state_, shouldRetry(_, _, _)).WillOnce(Return(false));
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(200));
   EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putResponseTime(_));
+  EXPECT_CALL(cm_.thread_local_cluster_.lb_, onResponseTime(Ref(*cm_.conn_pool_.host_), _));
   EXPECT_CALL(cm_.conn_pool_.host_->health_checker_, setUnhealthy());
   Http::HeaderMapPtr response_headers2(new Http::TestHeaderMapImpl{
       {":status", "200"}, {"x-envoy-immediate-health-check-fail", "true"}});
@@ -774,6 +824,47 @@ TEST_F(RouterTest, RetryUpstream5xxNotComplete) {
                     .value());
 }
 
+TEST_F(RouterTest, RetryBufferLimit) {
+  NiceMock<Http::MockStreamEncoder> encoder1;
+  Http::StreamDecoder* response_decoder = nullptr;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder = &decoder;
+        callbacks.onPoolReady(encoder1, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+
+  Http::TestHeaderMapImpl headers{{"x-envoy-retry-on", "5xx"},
+                                  {"x-envoy-internal", "true"},
+                                  {"x-envoy-retry-buffer-limit-bytes", "8"}};
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, false);
+  EXPECT_FALSE(headers.has("x-envoy-retry-buffer-limit-bytes"));
+
+  // Under the limit the body is buffered for retries.
+  Buffer::OwnedImpl buffered_data("hello");
+  EXPECT_CALL(*router_.retry_state_, enabled()).WillOnce(Return(true));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationAndBuffer,
+            router_.decodeData(buffered_data, false));
+
+  // Going over the limit turns retries off and streams the rest of the body.
+  ON_CALL(callbacks_, decodingBuffer()).WillByDefault(Return(&buffered_data));
+  Buffer::OwnedImpl body_data("world");
+  EXPECT_CALL(*router_.retry_state_, enabled()).WillOnce(Return(true));
+  EXPECT_CALL(encoder1, encodeData(_, true));
+  EXPECT_EQ(Http::FilterDataStatus::StopIterationNoBuffer, router_.decodeData(body_data, true));
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("upstream_rq_retry_buffer_overflow")
+                    .value());
+
+  // A 5xx response is not retried.
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  response_decoder->decodeHeaders(
+      Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "503"}}}, true);
+}
+
 TEST_F(RouterTest, RetryUpstreamGrpcCancelled) {
   NiceMock<Http::MockStreamEncoder> encoder1;
   Http::StreamDecoder* response_decoder = nullptr;
@@ -847,17 +938,53 @@ TEST_F(RouterTest, Shadow) {
       .Times(AtLeast(1))
       .WillRepeatedly(Return(body_data.get()));
   EXPECT_CALL(*shadow_writer_, shadow_("foo", _, std::chrono::milliseconds(10)))
-      .WillOnce(Invoke(
-          [](const std::string&, Http::MessagePtr& request, std::chrono::milliseconds) -> void {
-            EXPECT_NE(nullptr, request->body());
-            EXPECT_NE(nullptr, request->trailers());
-          }));
+      .WillOnce(Invoke([&](const std::string&, Http::MessagePtr& request,
+                           std::chrono::milliseconds) -> void {
+        EXPECT_NE(nullptr, request->trailers());
+
+        // The body is shared with the buffered request rather than copied.
+        ASSERT_NE(nullptr, request->body());
+        Buffer::RawSlice shadow_slice;
+        Buffer::RawSlice body_slice;
+        EXPECT_EQ(1, request->body()->getRawSlices(&shadow_slice, 1));
+        EXPECT_EQ(1, body_data->getRawSlices(&body_slice, 1));
+        EXPECT_EQ(body_slice.mem_, shadow_slice.mem_);
+      }));
   router_.decodeTrailers(trailers);
 
   Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
   response_decoder->decodeHeaders(std::move(response_headers), true);
 }
 
+TEST_F(RouterTest, ShadowSampledByRequestId) {
+  callbacks_.route_->route_entry_.shadow_policy_.cluster_ = "foo";
+  callbacks_.route_->route_entry_.shadow_policy_.runtime_key_ = "bar";
+  ON_CALL(callbacks_, streamId()).WillByDefault(Return(43));
+
+  NiceMock<Http::MockStreamEncoder> encoder;
+  Http::StreamDecoder* response_decoder = nullptr;
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder = &decoder;
+        callbacks.onPoolReady(encoder, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+
+  EXPECT_CALL(runtime_.snapshot_,
+              featureEnabled("bar", 0, HashUtil::xxHash64("some-request-id"), 10000))
+      .WillOnce(Return(true));
+
+  Http::TestHeaderMapImpl headers{{"x-request-id", "some-request-id"}};
+  HttpTestUtility::addDefaultHeaders(headers);
+  EXPECT_CALL(*shadow_writer_, shadow_("foo", _, std::chrono::milliseconds(10)));
+  router_.decodeHeaders(headers, true);
+
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder->decodeHeaders(std::move(response_headers), true);
+}
+
 TEST_F(RouterTest, AltStatName) {
   // Also test no upstream timeout here.
   EXPECT_CALL(callbacks_.route_->route_entry_, timeout())
@@ -917,6 +1044,117 @@ TEST_F(RouterTest, Redirect) {
   router_.decodeHeaders(headers, true);
 }
 
+TEST_F(RouterTest, HedgeRespondsFirst) {
+  sendHedgedRequest();
+
+  // The original request is reset once the hedge responds.
+  EXPECT_CALL(encoder1_.stream_, resetStream(Http::StreamResetReason::LocalReset));
+  EXPECT_CALL(hedge_pool_.host_->outlier_detector_, putHttpResponseCode(200));
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder2_->decodeHeaders(std::move(response_headers), true);
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("upstream_rq_hedge_won")
+                    .value());
+}
+
+TEST_F(RouterTest, HedgedRequestRespondsFirst) {
+  sendHedgedRequest();
+
+  EXPECT_CALL(encoder2_.stream_, resetStream(Http::StreamResetReason::LocalReset));
+  EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(200));
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder1_->decodeHeaders(std::move(response_headers), true);
+  EXPECT_EQ(0U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("upstream_rq_hedge_won")
+                    .value());
+}
+
+TEST_F(RouterTest, HedgedRequestResetKeepsHedge) {
+  sendHedgedRequest();
+
+  // Losing one of the two requests does not end the downstream request.
+  EXPECT_CALL(cm_.conn_pool_.host_->outlier_detector_, putHttpResponseCode(503));
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, _)).Times(0);
+  encoder1_.stream_.resetStream(Http::StreamResetReason::RemoteReset);
+
+  EXPECT_CALL(hedge_pool_.host_->outlier_detector_, putHttpResponseCode(200));
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder2_->decodeHeaders(std::move(response_headers), true);
+}
+
+TEST_F(RouterTest, HedgedRequestGlobalTimeout) {
+  sendHedgedRequest();
+
+  EXPECT_CALL(encoder1_.stream_, resetStream(Http::StreamResetReason::LocalReset));
+  EXPECT_CALL(encoder2_.stream_, resetStream(Http::StreamResetReason::LocalReset));
+  Http::TestHeaderMapImpl response_headers{
+      {":status", "504"}, {"content-length", "24"}, {"content-type", "text/plain"}};
+  EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&response_headers), false));
+  EXPECT_CALL(callbacks_, encodeData(_, true));
+  response_timeout_->callback_();
+}
+
+TEST_F(RouterTest, HedgeOverflow) {
+  ON_CALL(cm_.thread_local_cluster_.cluster_.info_->runtime_.snapshot_,
+          getInteger("fake_keymax_hedges", 3))
+      .WillByDefault(Return(0));
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder1_ = &decoder;
+        callbacks.onPoolReady(encoder1_, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+  expectHedgeTimerCreate();
+
+  Http::TestHeaderMapImpl headers{{"x-envoy-internal", "true"},
+                                  {"x-envoy-upstream-rq-hedge-delay-ms", "5"}};
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+
+  EXPECT_CALL(hedge_pool_, newStream(_, _)).Times(0);
+  hedge_timeout_->callback_();
+  EXPECT_EQ(1U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("upstream_rq_hedge_overflow")
+                    .value());
+
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder1_->decodeHeaders(std::move(response_headers), true);
+}
+
+TEST_F(RouterTest, HedgeNeedsAnotherHost) {
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _))
+      .WillOnce(Invoke([&](Http::StreamDecoder& decoder, Http::ConnectionPool::Callbacks& callbacks)
+                           -> Http::ConnectionPool::Cancellable* {
+        response_decoder1_ = &decoder;
+        callbacks.onPoolReady(encoder1_, cm_.conn_pool_.host_);
+        return nullptr;
+      }));
+  expectResponseTimerCreate();
+  expectHedgeTimerCreate();
+
+  Http::TestHeaderMapImpl headers{{"x-envoy-internal", "true"},
+                                  {"x-envoy-upstream-rq-hedge-delay-ms", "5"}};
+  HttpTestUtility::addDefaultHeaders(headers);
+  router_.decodeHeaders(headers, true);
+
+  // The load balancer keeps picking the host that already has the request.
+  EXPECT_CALL(cm_.conn_pool_, newStream(_, _)).Times(0);
+  hedge_timeout_->callback_();
+  EXPECT_EQ(0U, cm_.thread_local_cluster_.cluster_.info_->stats_store_
+                    .counter("upstream_rq_hedge")
+                    .value());
+
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, true));
+  Http::HeaderMapPtr response_headers(new Http::TestHeaderMapImpl{{":status", "200"}});
+  response_decoder1_->decodeHeaders(std::move(response_headers), true);
+}
+
 TEST(RouterFilterUtilityTest, finalTimeout) {
   {
     NiceMock<MockRouteEntry> route;
@@ -997,6 +1235,58 @@ TEST(RouterFilterUtilityTest, finalTimeout) {
   }
 }
 
+TEST(RouterFilterUtilityTest, hedgeDelay) {
+  FilterUtility::TimeoutData timeout;
+  timeout.global_timeout_ = std::chrono::milliseconds(15);
+  {
+    Http::TestHeaderMapImpl headers;
+    EXPECT_EQ(std::chrono::milliseconds(0), FilterUtility::hedgeDelay(headers, timeout));
+  }
+  {
+    Http::TestHeaderMapImpl headers{{"x-envoy-upstream-rq-hedge-delay-ms", "5"}};
+    EXPECT_EQ(std::chrono::milliseconds(5), FilterUtility::hedgeDelay(headers, timeout));
+    EXPECT_FALSE(headers.has("x-envoy-upstream-rq-hedge-delay-ms"));
+  }
+  {
+    Http::TestHeaderMapImpl headers{{"x-envoy-upstream-rq-hedge-delay-ms", "bad"}};
+    EXPECT_EQ(std::chrono::milliseconds(0), FilterUtility::hedgeDelay(headers, timeout));
+    EXPECT_FALSE(headers.has("x-envoy-upstream-rq-hedge-delay-ms"));
+  }
+  {
+    Http::TestHeaderMapImpl headers{{"x-envoy-upstream-rq-hedge-delay-ms", "15"}};
+    EXPECT_EQ(std::chrono::milliseconds(0), FilterUtility::hedgeDelay(headers, timeout));
+  }
+  {
+    timeout.per_try_timeout_ = std::chrono::milliseconds(5);
+    Http::TestHeaderMapImpl headers{{"x-envoy-upstream-rq-hedge-delay-ms", "5"}};
+    EXPECT_EQ(std::chrono::milliseconds(0), FilterUtility::hedgeDelay(headers, timeout));
+  }
+}
+
+TEST(RouterFilterUtilityTest, retryBufferLimit) {
+  NiceMock<Runtime::MockLoader> runtime;
+  {
+    Http::TestHeaderMapImpl headers;
+    EXPECT_EQ(0U, FilterUtility::retryBufferLimit(headers, runtime));
+  }
+  {
+    Http::TestHeaderMapImpl headers;
+    EXPECT_CALL(runtime.snapshot_, getInteger("upstream.retry_buffer_limit_bytes", 0))
+        .WillOnce(Return(1024));
+    EXPECT_EQ(1024U, FilterUtility::retryBufferLimit(headers, runtime));
+  }
+  {
+    Http::TestHeaderMapImpl headers{{"x-envoy-retry-buffer-limit-bytes", "16"}};
+    EXPECT_EQ(16U, FilterUtility::retryBufferLimit(headers, runtime));
+    EXPECT_FALSE(headers.has("x-envoy-retry-buffer-limit-bytes"));
+  }
+  {
+    Http::TestHeaderMapImpl headers{{"x-envoy-retry-buffer-limit-bytes", "bad"}};
+    EXPECT_EQ(0U, FilterUtility::retryBufferLimit(headers, runtime));
+    EXPECT_FALSE(headers.has("x-envoy-retry-buffer-limit-bytes"));
+  }
+}
+
 TEST(RouterFilterUtilityTest, setUpstreamScheme) {
   {
     Upstream::MockClusterInfo cluster;
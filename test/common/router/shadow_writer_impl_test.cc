@@ -12,6 +12,7 @@
 
 namespace Envoy {
 using testing::Invoke;
+using testing::Return;
 using testing::_;
 
 namespace Router {
@@ -59,5 +60,43 @@ TEST(ShadowWriterImplTest, All) {
   callback->onFailure(Http::AsyncClient::FailureReason::Reset);
 }
 
+TEST(ShadowWriterImplTest, Overflow) {
+  Upstream::MockClusterManager cm;
+  ShadowWriterImpl writer(cm);
+  Upstream::MockClusterInfo& info = *cm.thread_local_cluster_.cluster_.info_;
+  ON_CALL(info.runtime_.snapshot_, getInteger("fake_keymax_shadows", 1024))
+      .WillByDefault(Return(1));
+
+  Http::MockAsyncClientRequest request(&cm.async_client_);
+  Http::AsyncClient::Callbacks* callback;
+  EXPECT_CALL(cm, httpAsyncClientForCluster("foo")).WillRepeatedly(ReturnRef(cm.async_client_));
+  EXPECT_CALL(cm.async_client_, send_(_, _, _))
+      .Times(2)
+      .WillRepeatedly(
+          Invoke([&](Http::MessagePtr&, Http::AsyncClient::Callbacks& callbacks,
+                     const Optional<std::chrono::milliseconds>&) -> Http::AsyncClient::Request* {
+            callback = &callbacks;
+            return &request;
+          }));
+
+  Http::MessagePtr message(new Http::RequestMessageImpl());
+  message->headers().insertHost().value(std::string("cluster1"));
+  writer.shadow("foo", std::move(message), std::chrono::milliseconds(5));
+
+  // The second shadow is dropped while the first one is outstanding.
+  message.reset(new Http::RequestMessageImpl());
+  message->headers().insertHost().value(std::string("cluster1"));
+  writer.shadow("foo", std::move(message), std::chrono::milliseconds(5));
+  EXPECT_EQ(1U, info.stats_.upstream_rq_shadow_overflow_.value());
+
+  // Completing the first shadow frees up the circuit breaker.
+  callback->onSuccess(Http::MessagePtr{new Http::RequestMessageImpl()});
+  message.reset(new Http::RequestMessageImpl());
+  message->headers().insertHost().value(std::string("cluster1"));
+  writer.shadow("foo", std::move(message), std::chrono::milliseconds(5));
+  EXPECT_EQ(1U, info.stats_.upstream_rq_shadow_overflow_.value());
+  callback->onFailure(Http::AsyncClient::FailureReason::Reset);
+}
+
 } // namespace Router
 } // namespace Envoy
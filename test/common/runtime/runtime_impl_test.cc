@@ -1,6 +1,7 @@
 #include <memory>
 #include <string>
 
+#include "common/runtime/key_registry.h"
 #include "common/runtime/runtime_impl.h"
 #include "common/stats/stats_impl.h"
 
@@ -16,7 +17,8 @@
 namespace Envoy {
 using testing::NiceMock;
 using testing::Return;
-using testing::ReturnNew;
+using testing::SaveArg;
+using testing::_;
 
 namespace Runtime {
 
@@ -49,8 +51,9 @@ public:
   }
 
   void setup(const std::string& primary_dir, const std::string& override_dir) {
-    EXPECT_CALL(dispatcher, createFilesystemWatcher_())
-        .WillOnce(ReturnNew<NiceMock<Filesystem::MockWatcher>>());
+    Filesystem::MockWatcher* watcher = new NiceMock<Filesystem::MockWatcher>();
+    EXPECT_CALL(dispatcher, createFilesystemWatcher_()).WillOnce(Return(watcher));
+    EXPECT_CALL(*watcher, addWatch(_, _, _)).WillOnce(SaveArg<2>(&on_changed_cb));
 
     loader.reset(new LoaderImpl(dispatcher, tls, TestEnvironment::temporaryPath(primary_dir),
                                 "envoy", override_dir, store, generator));
@@ -62,6 +65,7 @@ public:
   Stats::IsolatedStoreImpl store;
   MockRandomGenerator generator;
   std::unique_ptr<LoaderImpl> loader;
+  Filesystem::Watcher::OnChangedCb on_changed_cb;
 };
 
 TEST_F(RuntimeImplTest, All) {
@@ -94,6 +98,49 @@ TEST_F(RuntimeImplTest, All) {
 
   // Overrides from override dir
   EXPECT_EQ("hello override", loader->snapshot().get("file1"));
+
+  // Only the null snapshot has version 0.
+  EXPECT_NE(0UL, loader->snapshot().version());
+}
+
+TEST_F(RuntimeImplTest, Keys) {
+  const Key file3 = KeyRegistry::key("file3");
+  const Key file4 = KeyRegistry::key("file4");
+  const Key invalid = KeyRegistry::key("invalid");
+  EXPECT_EQ(file3.index(), KeyRegistry::key("file3").index());
+  EXPECT_NE(file3.index(), file4.index());
+  setup("test/common/runtime/test_data/current", "envoy_override");
+
+  EXPECT_EQ(2UL, loader->snapshot().getInteger(file3, 1));
+  EXPECT_EQ(123UL, loader->snapshot().getInteger(file4, 1));
+  EXPECT_EQ(1UL, loader->snapshot().getInteger(invalid, 1));
+
+  EXPECT_CALL(generator, random()).WillOnce(Return(1));
+  EXPECT_TRUE(loader->snapshot().featureEnabled(file3, 1));
+  EXPECT_FALSE(loader->snapshot().featureEnabled(file3, 1, 3));
+  EXPECT_TRUE(loader->snapshot().featureEnabled(file4, 1, 122, 300));
+
+  // Keys registered after the snapshot was loaded are looked up by name.
+  EXPECT_EQ(1UL, loader->snapshot().getInteger(KeyRegistry::key("file1"), 2));
+  EXPECT_EQ(2UL, loader->snapshot().getInteger(Key(), 2));
+}
+
+TEST_F(RuntimeImplTest, ReloadReusesUnchangedFiles) {
+  setup("test/common/runtime/test_data/current", "envoy_override");
+  EXPECT_EQ(0UL, store.counter("runtime.file_reused").value());
+
+  on_changed_cb(Filesystem::Watcher::Events::MovedTo);
+  EXPECT_EQ(6UL, store.counter("runtime.file_reused").value());
+  EXPECT_EQ("world", loader->snapshot().get("file2"));
+
+  const std::string file2 = "test/common/runtime/test_data/root/envoy/file2";
+  TestEnvironment::writeStringToFileForTest(file2, "changed");
+  on_changed_cb(Filesystem::Watcher::Events::MovedTo);
+  EXPECT_EQ(11UL, store.counter("runtime.file_reused").value());
+  EXPECT_EQ("changed", loader->snapshot().get("file2"));
+  EXPECT_EQ("hello override", loader->snapshot().get("file1"));
+  EXPECT_EQ(123UL, loader->snapshot().getInteger("file4", 1));
+  TestEnvironment::writeStringToFileForTest(file2, "world");
 }
 
 TEST_F(RuntimeImplTest, BadDirectory) { setup("/baddir", "/baddir"); }
@@ -111,6 +158,7 @@ TEST(NullRuntimeImplTest, All) {
   EXPECT_EQ(1UL, loader.snapshot().getInteger("foo", 1));
   EXPECT_CALL(generator, random()).WillOnce(Return(49));
   EXPECT_TRUE(loader.snapshot().featureEnabled("foo", 50));
+  EXPECT_EQ(0UL, loader.snapshot().version());
 }
 
 } // namespace Runtime
@@ -1,3 +1,5 @@
+#include <sys/socket.h>
+
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -127,6 +129,32 @@ TEST_P(SslConnectionImplTest, GetCertDigest) {
            true, GetParam());
 }
 
+// The server signs on the offload thread pool and resumes the handshake when the result is posted.
+TEST_P(SslConnectionImplTest, ThreadPoolPrivateKeyMethod) {
+  std::string client_ctx_json = R"EOF(
+  {
+    "cert_chain_file": "{{ test_rundir }}/test/common/ssl/test_data/no_san_cert.pem",
+    "private_key_file": "{{ test_rundir }}/test/common/ssl/test_data/no_san_key.pem"
+  }
+  )EOF";
+
+  std::string server_ctx_json = R"EOF(
+  {
+    "cert_chain_file": "{{ test_tmpdir }}/unittestcert.pem",
+    "private_key_file": "{{ test_tmpdir }}/unittestkey.pem",
+    "ca_cert_file": "{{ test_rundir }}/test/common/ssl/test_data/ca_cert.pem",
+    "private_key_method": {
+      "name": "envoy.thread_pool",
+      "config": {"threads": 1}
+    }
+  }
+  )EOF";
+
+  testUtil(client_ctx_json, server_ctx_json,
+           "4444fbca965d916475f04fb4dd234dd556adb028ceb4300fa8ad6f2983c6aaa3", "", "ssl.handshake",
+           true, GetParam());
+}
+
 TEST_P(SslConnectionImplTest, GetUriWithUriSan) {
   std::string client_ctx_json = R"EOF(
   {
@@ -379,6 +407,77 @@ TEST_P(SslConnectionImplTest, ClientAuthMultipleCAs) {
   EXPECT_EQ(1UL, stats_store.counter("ssl.handshake").value());
 }
 
+// Upstream connections resume the session of an earlier connection to the same host.
+TEST_P(SslConnectionImplTest, ClientSessionResumption) {
+  Stats::IsolatedStoreImpl server_stats_store;
+  Stats::IsolatedStoreImpl client_stats_store;
+  Runtime::MockLoader runtime;
+
+  std::string server_ctx_json = R"EOF(
+  {
+    "cert_chain_file": "{{ test_tmpdir }}/unittestcert.pem",
+    "private_key_file": "{{ test_tmpdir }}/unittestkey.pem"
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr server_ctx_loader = TestEnvironment::jsonLoadFromString(server_ctx_json);
+  ServerContextConfigImpl server_ctx_config(*server_ctx_loader);
+  ContextManagerImpl manager(runtime);
+  ServerContextPtr server_ctx(
+      manager.createSslServerContext(server_stats_store, server_ctx_config));
+
+  Event::DispatcherImpl dispatcher;
+  Network::TcpListenSocket socket(Network::Test::getCanonicalLoopbackAddress(GetParam()), true);
+  Network::MockListenerCallbacks callbacks;
+  Network::MockConnectionHandler connection_handler;
+  Network::ListenerPtr listener = dispatcher.createSslListener(
+      connection_handler, *server_ctx, socket, callbacks, server_stats_store,
+      Network::ListenerOptions::listenerOptionsWithBindToPort());
+
+  Json::ObjectSharedPtr client_ctx_loader = TestEnvironment::jsonLoadFromString("{}");
+  ClientContextConfigImpl client_ctx_config(*client_ctx_loader);
+  ClientContextPtr client_ctx(
+      manager.createSslClientContext(client_stats_store, client_ctx_config));
+
+  for (uint32_t i = 0; i < 2; ++i) {
+    Network::ClientConnectionPtr client_connection = dispatcher.createSslClientConnection(
+        *client_ctx, socket.localAddress(), Network::Address::InstanceConstSharedPtr());
+    Network::MockConnectionCallbacks client_connection_callbacks;
+    client_connection->addConnectionCallbacks(client_connection_callbacks);
+    client_connection->connect();
+
+    Network::ConnectionPtr server_connection;
+    Network::MockConnectionCallbacks server_connection_callbacks;
+    EXPECT_CALL(callbacks, onNewConnection_(_))
+        .WillOnce(Invoke([&](Network::ConnectionPtr& conn) -> void {
+          server_connection = std::move(conn);
+          server_connection->addConnectionCallbacks(server_connection_callbacks);
+        }));
+
+    // Close once both sides have completed the handshake, so both have cached the session.
+    uint32_t connected = 0;
+    auto on_connected = [&](Network::ConnectionEvent) -> void {
+      if (++connected == 2) {
+        server_connection->close(Network::ConnectionCloseType::NoFlush);
+        client_connection->close(Network::ConnectionCloseType::NoFlush);
+        dispatcher.exit();
+      }
+    };
+    EXPECT_CALL(server_connection_callbacks, onEvent(Network::ConnectionEvent::Connected))
+        .WillOnce(Invoke(on_connected));
+    EXPECT_CALL(client_connection_callbacks, onEvent(Network::ConnectionEvent::Connected))
+        .WillOnce(Invoke(on_connected));
+    EXPECT_CALL(server_connection_callbacks, onEvent(Network::ConnectionEvent::LocalClose));
+    EXPECT_CALL(client_connection_callbacks, onEvent(Network::ConnectionEvent::LocalClose));
+
+    dispatcher.run(Event::Dispatcher::RunType::Block);
+  }
+
+  EXPECT_EQ(2UL, client_stats_store.counter("ssl.handshake").value());
+  EXPECT_EQ(1UL, client_stats_store.counter("ssl.session_reused").value());
+  EXPECT_EQ(1UL, server_stats_store.counter("ssl.session_reused").value());
+}
+
 TEST_P(SslConnectionImplTest, SslError) {
   Stats::IsolatedStoreImpl stats_store;
   Runtime::MockLoader runtime;
@@ -558,6 +657,9 @@ public:
     EXPECT_CALL(*client_write_buffer, move(_))
         .WillRepeatedly(DoAll(AddBufferToStringWithoutDraining(&data_written),
                               Invoke(client_write_buffer, &MockBuffer::baseMove)));
+    EXPECT_CALL(*client_write_buffer, add(_))
+        .WillRepeatedly(DoAll(AddBufferToStringWithoutDraining(&data_written),
+                              Invoke(client_write_buffer, &MockBuffer::baseAdd)));
     EXPECT_CALL(*client_write_buffer, drain(_)).WillOnce(Invoke([&](uint64_t n) -> void {
       client_write_buffer->baseDrain(n);
       dispatcher_->exit();
@@ -569,6 +671,54 @@ public:
     disconnect();
   }
 
+  // Shrink a socket buffer of a connection so that its writes back up after a few records.
+  void shrinkSocketBuffer(Network::Connection& connection, int option) {
+    int fd = SSL_get_fd(dynamic_cast<ConnectionImpl&>(connection).rawSslForTest());
+    int size = 4096;
+    EXPECT_EQ(0, setsockopt(fd, SOL_SOCKET, option, &size, sizeof(size)));
+  }
+
+  // Complete the handshake, then shrink the socket buffers between the client and the server.
+  void connectWithSmallSocketBuffers() {
+    initialize(0);
+
+    EXPECT_CALL(listener_callbacks_, onNewConnection_(_))
+        .WillOnce(Invoke([&](Network::ConnectionPtr& conn) -> void {
+          server_connection_ = std::move(conn);
+          server_connection_->addConnectionCallbacks(server_callbacks_);
+          server_connection_->addReadFilter(read_filter_);
+        }));
+    EXPECT_CALL(client_callbacks_, onEvent(Network::ConnectionEvent::Connected))
+        .WillOnce(Invoke([&](Network::ConnectionEvent) -> void { dispatcher_->exit(); }));
+    dispatcher_->run(Event::Dispatcher::RunType::Block);
+
+    shrinkSocketBuffer(*client_connection_, SO_SNDBUF);
+    shrinkSocketBuffer(*server_connection_, SO_RCVBUF);
+    EXPECT_CALL(*read_filter_, onNewConnection());
+  }
+
+  // Count the data the server reads, exiting the dispatcher once bytes_expected were read.
+  void expectServerData(uint32_t bytes_expected, uint32_t& bytes_seen) {
+    uint32_t* seen = &bytes_seen;
+    EXPECT_CALL(*read_filter_, onData(_))
+        .WillRepeatedly(Invoke([this, bytes_expected, seen](Buffer::Instance& data)
+                                   -> Network::FilterStatus {
+          *seen += data.length();
+          data.drain(data.length());
+          if (*seen == bytes_expected) {
+            dispatcher_->exit();
+          }
+          return Network::FilterStatus::StopIteration;
+        }));
+  }
+
+  // Run the dispatcher until the client has written all it can to a server that does not read.
+  void runUntilSocketBacksUp() {
+    for (uint32_t i = 0; i < 10; i++) {
+      dispatcher_->run(Event::Dispatcher::RunType::NonBlock);
+    }
+  }
+
   void disconnect() {
     EXPECT_CALL(client_callbacks_, onEvent(Network::ConnectionEvent::LocalClose));
     EXPECT_CALL(server_callbacks_, onEvent(Network::ConnectionEvent::RemoteClose))
@@ -634,6 +784,90 @@ TEST_P(SslReadBufferLimitTest, WritesSmallerThanBufferLimit) { singleWriteTest(5
 
 TEST_P(SslReadBufferLimitTest, WritesLargerThanBufferLimit) { singleWriteTest(1024, 5 * 1024); }
 
+// Validate that plaintext whose records the socket has not taken yet still counts against the
+// write buffer watermarks, and that only the bytes written to the socket are counted as written.
+TEST_P(SslReadBufferLimitTest, WriteBlockedWithCiphertextBuffered) {
+  connectWithSmallSocketBuffers();
+  Stats::Counter& write_total = stats_store_.counter("client.write_total");
+  client_connection_->setBufferStats(
+      {stats_store_.counter("client.read_total"), stats_store_.gauge("client.read_current"),
+       write_total, stats_store_.gauge("client.write_current")});
+  client_connection_->setBufferLimits(16 * 1024);
+  server_connection_->readDisable(true);
+
+  const uint32_t write_size = 1024 * 1024;
+  EXPECT_CALL(client_callbacks_, onAboveWriteBufferHighWatermark());
+  Buffer::OwnedImpl data(std::string(write_size, 'a'));
+  client_connection_->write(data);
+  runUntilSocketBacksUp();
+  EXPECT_TRUE(client_connection_->aboveHighWatermark());
+  EXPECT_LT(write_total.value(), write_size);
+
+  uint32_t bytes_seen = 0;
+  expectServerData(write_size, bytes_seen);
+  EXPECT_CALL(client_callbacks_, onBelowWriteBufferLowWatermark());
+  server_connection_->readDisable(false);
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ(write_size, bytes_seen);
+  EXPECT_FALSE(client_connection_->aboveHighWatermark());
+  // The records add headers and authentication tags to the plaintext.
+  EXPECT_GT(write_total.value(), write_size);
+
+  disconnect();
+}
+
+// Validate that a close with flush waits for the records the socket has not taken yet.
+TEST_P(SslReadBufferLimitTest, CloseWithFlushWaitsForCiphertext) {
+  connectWithSmallSocketBuffers();
+  server_connection_->readDisable(true);
+
+  const uint32_t write_size = 1024 * 1024;
+  Buffer::OwnedImpl data(std::string(write_size, 'a'));
+  client_connection_->write(data);
+  runUntilSocketBacksUp();
+  client_connection_->close(Network::ConnectionCloseType::FlushWrite);
+  EXPECT_EQ(Network::Connection::State::Closing, client_connection_->state());
+
+  uint32_t bytes_seen = 0;
+  expectServerData(write_size, bytes_seen);
+  EXPECT_CALL(client_callbacks_, onEvent(Network::ConnectionEvent::LocalClose));
+  EXPECT_CALL(server_callbacks_, onEvent(Network::ConnectionEvent::RemoteClose))
+      .WillOnce(Invoke([&](Network::ConnectionEvent) -> void { dispatcher_->exit(); }));
+  server_connection_->readDisable(false);
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ(write_size, bytes_seen);
+  EXPECT_EQ(Network::Connection::State::Closed, client_connection_->state());
+}
+
+// Validate that handshake records the socket does not take at once are flushed by later events,
+// ahead of data written before the handshake completed.
+TEST_P(SslReadBufferLimitTest, HandshakeFlushedBeforeEarlyWrite) {
+  initialize(0);
+  shrinkSocketBuffer(*client_connection_, SO_SNDBUF);
+  shrinkSocketBuffer(*client_connection_, SO_RCVBUF);
+
+  EXPECT_CALL(listener_callbacks_, onNewConnection_(_))
+      .WillOnce(Invoke([&](Network::ConnectionPtr& conn) -> void {
+        server_connection_ = std::move(conn);
+        server_connection_->addConnectionCallbacks(server_callbacks_);
+        server_connection_->addReadFilter(read_filter_);
+        shrinkSocketBuffer(*server_connection_, SO_SNDBUF);
+      }));
+  EXPECT_CALL(client_callbacks_, onEvent(Network::ConnectionEvent::Connected));
+  EXPECT_CALL(*read_filter_, onNewConnection());
+
+  const uint32_t write_size = 256 * 1024;
+  uint32_t bytes_seen = 0;
+  expectServerData(write_size, bytes_seen);
+  Buffer::OwnedImpl data(std::string(write_size, 'a'));
+  client_connection_->write(data);
+  dispatcher_->run(Event::Dispatcher::RunType::Block);
+  EXPECT_EQ(write_size, bytes_seen);
+  EXPECT_EQ(0UL, stats_store_.counter("ssl.connection_error").value());
+
+  disconnect();
+}
+
 TEST_P(SslReadBufferLimitTest, TestBind) {
   std::string address_string = TestUtility::getIpv4Loopback();
   if (GetParam() == Network::Address::IpVersion::v4) {
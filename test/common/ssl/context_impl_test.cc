@@ -1,6 +1,7 @@
 #include <string>
 #include <vector>
 
+#include "common/filesystem/filesystem_impl.h"
 #include "common/json/json_loader.h"
 #include "common/ssl/context_config_impl.h"
 #include "common/ssl/context_impl.h"
@@ -9,6 +10,7 @@
 #include "test/common/ssl/ssl_certs_test.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/test_common/environment.h"
+#include "test/test_common/utility.h"
 
 #include "gtest/gtest.h"
 
@@ -168,5 +170,91 @@ TEST_F(SslContextImplTest, TestNoCert) {
   EXPECT_EQ("", context->getCertChainInformation());
 }
 
+// Certificates are shared by the files' contents, for as long as they are used.
+TEST_F(SslContextImplTest, SharedCertificate) {
+  const std::string cert = TestEnvironment::substitute("{{ test_tmpdir }}/unittestcert.pem");
+  const std::string key = TestEnvironment::substitute("{{ test_tmpdir }}/unittestkey.pem");
+  const std::string cert_copy = TestEnvironment::writeStringToFileForTest(
+      "unittestcert_copy.pem", Filesystem::fileReadToEnd(cert));
+  const std::string key_copy = TestEnvironment::writeStringToFileForTest(
+      "unittestkey_copy.pem", Filesystem::fileReadToEnd(key));
+  Runtime::MockLoader runtime;
+  ContextManagerImpl manager(runtime);
+
+  CertificateDataConstSharedPtr certificate = manager.loadCertificate(cert, key);
+  EXPECT_NE(nullptr, certificate->leaf_);
+  EXPECT_NE(nullptr, certificate->private_key_);
+  EXPECT_EQ(certificate, manager.loadCertificate(cert, key));
+  EXPECT_EQ(certificate, manager.loadCertificate(cert_copy, key_copy));
+
+  CertificateDataConstSharedPtr without_key = manager.loadCertificate(cert, "");
+  EXPECT_NE(certificate, without_key);
+  EXPECT_EQ(nullptr, without_key->private_key_);
+
+  // Contexts keep using the certificate after it is released here.
+  Stats::IsolatedStoreImpl store;
+  Json::ObjectSharedPtr loader = TestEnvironment::jsonLoadFromString(R"EOF(
+  {
+    "cert_chain_file": "{{ test_tmpdir }}/unittestcert_copy.pem",
+    "private_key_file": "{{ test_tmpdir }}/unittestkey_copy.pem"
+  }
+  )EOF");
+  ServerContextConfigImpl cfg(*loader);
+  ServerContextPtr context(manager.createSslServerContext(store, cfg));
+  certificate.reset();
+  without_key.reset();
+  EXPECT_NE(std::string::npos, context->getCertChainInformation().find("unittestcert_copy.pem"));
+}
+
+TEST_F(SslContextImplTest, BadCertificate) {
+  const std::string cert = TestEnvironment::writeStringToFileForTest("bad_cert.pem", "garbage");
+  Runtime::MockLoader runtime;
+  ContextManagerImpl manager(runtime);
+  EXPECT_THROW_WITH_MESSAGE(manager.loadCertificate(cert, ""), EnvoyException,
+                            "Failed to load certificate '" + cert + "'");
+  EXPECT_THROW_WITH_MESSAGE(manager.loadCertificate(cert + ".missing", ""), EnvoyException,
+                            "Failed to load certificate '" + cert + ".missing'");
+}
+
+TEST_F(SslContextImplTest, TestSessionTicketKeys) {
+  const std::string key_path =
+      TestEnvironment::writeStringToFileForTest("ticket_key_good", std::string(80, 'a'));
+  std::string json = R"EOF(
+  {
+    "cert_chain_file": "{{ test_tmpdir }}/unittestcert.pem",
+    "private_key_file": "{{ test_tmpdir }}/unittestkey.pem",
+    "session_ticket_key_paths": ["{{ test_tmpdir }}/ticket_key_good"]
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr loader = TestEnvironment::jsonLoadFromString(json);
+  ServerContextConfigImpl cfg(*loader);
+  EXPECT_EQ(std::vector<std::string>{key_path}, cfg.sessionTicketKeyPaths());
+  Runtime::MockLoader runtime;
+  ContextManagerImpl manager(runtime);
+  Stats::IsolatedStoreImpl store;
+  ServerContextPtr context(manager.createSslServerContext(store, cfg));
+}
+
+TEST_F(SslContextImplTest, TestBadSessionTicketKeySize) {
+  const std::string key_path =
+      TestEnvironment::writeStringToFileForTest("ticket_key_short", std::string(79, 'a'));
+  std::string json = R"EOF(
+  {
+    "cert_chain_file": "{{ test_tmpdir }}/unittestcert.pem",
+    "private_key_file": "{{ test_tmpdir }}/unittestkey.pem",
+    "session_ticket_key_paths": ["{{ test_tmpdir }}/ticket_key_short"]
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr loader = TestEnvironment::jsonLoadFromString(json);
+  ServerContextConfigImpl cfg(*loader);
+  Runtime::MockLoader runtime;
+  ContextManagerImpl manager(runtime);
+  Stats::IsolatedStoreImpl store;
+  EXPECT_THROW_WITH_MESSAGE(manager.createSslServerContext(store, cfg), EnvoyException,
+                            "Session ticket key file " + key_path + " must be 80 bytes, not 79");
+}
+
 } // namespace Ssl
 } // namespace Envoy
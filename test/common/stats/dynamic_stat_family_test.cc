@@ -0,0 +1,49 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/stats/dynamic_stat_family.h"
+
+#include "test/mocks/thread_local/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+
+namespace Envoy {
+namespace Stats {
+
+class DynamicStatFamilyTest : public testing::Test {
+public:
+  struct Group {
+    Group(const std::string& name) : name_(name) {}
+
+    const std::string name_;
+  };
+
+  DynamicStatFamilyTest()
+      : family_(tls_, 2, "overflow", [this](const std::string& name) -> Group* {
+          built_.push_back(name);
+          return new Group(name);
+        }) {}
+
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  std::vector<std::string> built_;
+  DynamicStatFamily<Group> family_;
+};
+
+TEST_F(DynamicStatFamilyTest, Admission) {
+  EXPECT_EQ("a", family_.get("a").name_);
+  EXPECT_EQ("b", family_.get("b").name_);
+  EXPECT_EQ("overflow", family_.get("c").name_);
+  EXPECT_EQ("overflow", family_.get("d").name_);
+  EXPECT_EQ(&family_.get("a"), &family_.get("a"));
+  EXPECT_EQ(&family_.get("c"), &family_.get("d"));
+
+  // Groups are only built once, and keys that overflow never build one.
+  EXPECT_EQ((std::vector<std::string>{"overflow", "a", "b"}), built_);
+}
+
+} // namespace Stats
+} // namespace Envoy
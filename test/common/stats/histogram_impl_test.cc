@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/stats/histogram_impl.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Stats {
+
+TEST(HistogramBucketsTest, Index) {
+  // Small values are exact.
+  for (uint64_t value = 0; value < 2 * HistogramBuckets::SUB_BUCKETS; value++) {
+    EXPECT_EQ(value, HistogramBuckets::index(value));
+    EXPECT_EQ(value, HistogramBuckets::lowerBound(value));
+    EXPECT_EQ(value + 1, HistogramBuckets::upperBound(value));
+  }
+
+  EXPECT_EQ(32U, HistogramBuckets::index(32));
+  EXPECT_EQ(32U, HistogramBuckets::index(33));
+  EXPECT_EQ(33U, HistogramBuckets::index(34));
+  EXPECT_EQ(HistogramBuckets::NUM_BUCKETS - 1, HistogramBuckets::index(UINT64_MAX));
+
+  // Every value is within the bounds of its bucket and buckets are contiguous.
+  for (uint32_t index = 0; index < HistogramBuckets::NUM_BUCKETS - 1; index++) {
+    EXPECT_EQ(HistogramBuckets::upperBound(index), HistogramBuckets::lowerBound(index + 1));
+  }
+
+  for (uint64_t value : {100UL, 1000UL, 12345UL, 1000000UL, 1UL << 40}) {
+    const uint32_t index = HistogramBuckets::index(value);
+    EXPECT_LE(HistogramBuckets::lowerBound(index), value);
+    EXPECT_GT(HistogramBuckets::upperBound(index), value);
+  }
+}
+
+TEST(HistogramStatisticsImplTest, Empty) {
+  HistogramStatisticsImpl statistics;
+  EXPECT_EQ(0U, statistics.sampleCount());
+  EXPECT_EQ(0U, statistics.sampleSum());
+  EXPECT_EQ(0, statistics.quantile(0.5));
+}
+
+TEST(HistogramStatisticsImplTest, Quantiles) {
+  HistogramBucketArray buckets;
+  for (uint64_t value = 1; value <= 20; value++) {
+    buckets.record(value);
+  }
+
+  HistogramStatisticsImpl statistics;
+  buckets.drain(statistics);
+  EXPECT_EQ(20U, statistics.sampleCount());
+  EXPECT_EQ(210U, statistics.sampleSum());
+  EXPECT_EQ(1, statistics.quantile(0));
+  EXPECT_EQ(10, statistics.quantile(0.5));
+  EXPECT_EQ(20, statistics.quantile(1));
+  EXPECT_EQ("P0: 1, P25: 5, P50: 10, P75: 15, P90: 18, P95: 19, P99: 20, P99.9: 20, P100: 20",
+            statistics.summary());
+
+  // Draining resets the array.
+  HistogramStatisticsImpl empty;
+  buckets.drain(empty);
+  EXPECT_EQ(0U, empty.sampleCount());
+  EXPECT_EQ(0U, empty.sampleSum());
+
+  statistics.add(statistics);
+  EXPECT_EQ(40U, statistics.sampleCount());
+  EXPECT_EQ(420U, statistics.sampleSum());
+  EXPECT_EQ(10, statistics.quantile(0.5));
+
+  statistics.clear();
+  EXPECT_EQ(0U, statistics.sampleCount());
+}
+
+TEST(HistogramStatisticsImplTest, RelativeError) {
+  HistogramBucketArray buckets;
+  for (uint64_t value = 1; value <= 100000; value++) {
+    buckets.record(value);
+  }
+
+  HistogramStatisticsImpl statistics;
+  buckets.drain(statistics);
+  EXPECT_NEAR(50000, statistics.quantile(0.5), 50000.0 / HistogramBuckets::SUB_BUCKETS);
+  EXPECT_NEAR(99000, statistics.quantile(0.99), 99000.0 / HistogramBuckets::SUB_BUCKETS);
+}
+
+TEST(ParentHistogramImplTest, Merge) {
+  ParentHistogramImpl histogram("h");
+  EXPECT_EQ("h", histogram.name());
+  EXPECT_FALSE(histogram.used());
+
+  histogram.recordValue(1);
+  ThreadLocalHistogramSharedPtr tls_histogram = histogram.allocateThreadLocal();
+  tls_histogram->recordValue(2);
+  EXPECT_FALSE(histogram.used());
+
+  histogram.merge();
+  EXPECT_TRUE(histogram.used());
+  EXPECT_EQ(2U, histogram.intervalStatistics().sampleCount());
+  EXPECT_EQ(3U, histogram.intervalStatistics().sampleSum());
+  EXPECT_EQ(2U, histogram.cumulativeStatistics().sampleCount());
+
+  tls_histogram->recordValue(3);
+  histogram.merge();
+  EXPECT_EQ(1U, histogram.intervalStatistics().sampleCount());
+  EXPECT_EQ(3U, histogram.intervalStatistics().sampleSum());
+  EXPECT_EQ(3U, histogram.cumulativeStatistics().sampleCount());
+  EXPECT_EQ(6U, histogram.cumulativeStatistics().sampleSum());
+
+  // Released thread local histograms no longer contribute.
+  tls_histogram.reset();
+  histogram.merge();
+  EXPECT_EQ(0U, histogram.intervalStatistics().sampleCount());
+  EXPECT_EQ(3U, histogram.cumulativeStatistics().sampleCount());
+}
+
+TEST(ParentHistogramImplTest, MultipleThreads) {
+  ParentHistogramImpl histogram("h");
+  std::vector<ThreadLocalHistogramSharedPtr> tls_histograms;
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < 4; i++) {
+    tls_histograms.push_back(histogram.allocateThreadLocal());
+    ThreadLocalHistogramImpl& tls_histogram = *tls_histograms.back();
+    threads.emplace_back([&histogram, &tls_histogram]() -> void {
+      for (uint64_t value = 0; value < 10000; value++) {
+        tls_histogram.recordValue(value);
+        if (value % 1000 == 0) {
+          histogram.recordValue(value);
+        }
+      }
+    });
+  }
+
+  // Merging concurrently with recording must neither lose nor duplicate samples.
+  uint64_t merged = 0;
+  for (uint32_t i = 0; i < 10; i++) {
+    histogram.merge();
+    merged += histogram.intervalStatistics().sampleCount();
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  histogram.merge();
+  merged += histogram.intervalStatistics().sampleCount();
+  EXPECT_EQ(4U * (10000 + 10), merged);
+  EXPECT_EQ(merged, histogram.cumulativeStatistics().sampleCount());
+}
+
+} // namespace Stats
+} // namespace Envoy
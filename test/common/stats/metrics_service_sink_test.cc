@@ -0,0 +1,138 @@
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "common/stats/histogram_impl.h"
+#include "common/stats/metrics_service_sink.h"
+#include "common/stats/stats_impl.h"
+
+#include "test/mocks/grpc/mocks.h"
+#include "test/mocks/local_info/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::SaveArg;
+using testing::_;
+
+namespace Envoy {
+namespace Stats {
+namespace {
+
+typedef Grpc::MockAsyncClient<pb::envoy::metrics::StreamMetricsMessage,
+                              pb::envoy::metrics::StreamMetricsResponse>
+    MockMetricsAsyncClient;
+
+class MetricsServiceSinkTest : public testing::Test {
+public:
+  MetricsServiceSinkTest()
+      : async_client_(new MockMetricsAsyncClient()),
+        sink_(new MetricsServiceSink(MetricsAsyncClientPtr{async_client_}, local_info_,
+                                     stats_store_)) {}
+
+  void flush(pb::envoy::metrics::StreamMetricsMessage& message) {
+    EXPECT_CALL(async_stream_, sendMessage(_, false)).WillOnce(SaveArg<0>(&message));
+    sink_->beginFlush();
+    sink_->flushCounter("cluster.foo.upstream_rq", 3);
+    sink_->flushGauge("cluster.foo.membership_total", 7);
+    sink_->endFlush();
+  }
+
+  NiceMock<LocalInfo::MockLocalInfo> local_info_;
+  IsolatedStoreImpl stats_store_;
+  MockMetricsAsyncClient* async_client_;
+  Grpc::MockAsyncStream<pb::envoy::metrics::StreamMetricsMessage> async_stream_;
+  std::unique_ptr<MetricsServiceSink> sink_;
+};
+
+// Validate that names are sent once per stream, and IDs after that.
+TEST_F(MetricsServiceSinkTest, NamesOncePerStream) {
+  EXPECT_CALL(*async_client_, start(_, _))
+      .WillOnce(Invoke([this](const Protobuf::MethodDescriptor& service_method,
+                              Grpc::AsyncStreamCallbacks<
+                                  pb::envoy::metrics::StreamMetricsResponse>&) {
+        EXPECT_EQ("StreamMetrics", service_method.name());
+        return &async_stream_;
+      }));
+  pb::envoy::metrics::StreamMetricsMessage message;
+  flush(message);
+  EXPECT_EQ("cluster_name", message.identifier().service_cluster());
+  EXPECT_EQ("node_name", message.identifier().service_node());
+  ASSERT_EQ(2, message.names_size());
+  EXPECT_EQ(0U, message.names(0).id());
+  EXPECT_EQ("cluster.foo.upstream_rq", message.names(0).name());
+  EXPECT_EQ(1U, message.names(1).id());
+  ASSERT_EQ(1, message.counters_size());
+  EXPECT_EQ(0U, message.counters(0).id());
+  EXPECT_EQ(3U, message.counters(0).delta());
+  ASSERT_EQ(1, message.gauges_size());
+  EXPECT_EQ(1U, message.gauges(0).id());
+  EXPECT_EQ(7U, message.gauges(0).value());
+
+  // Known stats are only referred to by ID, and new ones are named.
+  EXPECT_CALL(async_stream_, sendMessage(_, false)).WillOnce(SaveArg<0>(&message));
+  sink_->beginFlush();
+  sink_->flushCounter("cluster.foo.upstream_rq", 5);
+  HistogramStatisticsImpl statistics;
+  statistics.addBucket(HistogramBuckets::index(10), 2);
+  statistics.addSum(20);
+  sink_->flushHistogram("cluster.foo.upstream_rq_time", statistics);
+  sink_->endFlush();
+  EXPECT_FALSE(message.has_identifier());
+  ASSERT_EQ(1, message.names_size());
+  EXPECT_EQ(2U, message.names(0).id());
+  EXPECT_EQ("cluster.foo.upstream_rq_time", message.names(0).name());
+  EXPECT_EQ(0U, message.counters(0).id());
+  EXPECT_EQ(5U, message.counters(0).delta());
+  ASSERT_EQ(1, message.histograms_size());
+  EXPECT_EQ(2U, message.histograms(0).sample_count());
+  EXPECT_EQ(20U, message.histograms(0).sample_sum());
+  EXPECT_EQ(9, message.histograms(0).quantiles_size());
+  EXPECT_EQ(2UL, stats_store_.counter("metrics_service.flushes_sent").value());
+
+  EXPECT_CALL(async_stream_, resetStream());
+  sink_.reset();
+}
+
+// Validate that a flush is dropped while the stream cannot be started, and that a new stream names
+// its stats anew.
+TEST_F(MetricsServiceSinkTest, StreamFailure) {
+  Grpc::AsyncStreamCallbacks<pb::envoy::metrics::StreamMetricsResponse>* callbacks;
+  EXPECT_CALL(*async_client_, start(_, _))
+      .WillOnce(Invoke([this, &callbacks](const Protobuf::MethodDescriptor&,
+                                    Grpc::AsyncStreamCallbacks<
+                                        pb::envoy::metrics::StreamMetricsResponse>& cb) {
+        callbacks = &cb;
+        return &async_stream_;
+      }));
+  pb::envoy::metrics::StreamMetricsMessage message;
+  flush(message);
+  callbacks->onRemoteClose(Grpc::Status::GrpcStatus::Unavailable, "");
+
+  EXPECT_CALL(*async_client_, start(_, _))
+      .WillOnce(Invoke([](const Protobuf::MethodDescriptor&,
+                          Grpc::AsyncStreamCallbacks<pb::envoy::metrics::StreamMetricsResponse>&
+                              cb) {
+        cb.onRemoteClose(Grpc::Status::GrpcStatus::Unavailable, "");
+        return nullptr;
+      }));
+  sink_->beginFlush();
+  sink_->flushCounter("cluster.foo.upstream_rq", 1);
+  sink_->endFlush();
+  EXPECT_EQ(1UL, stats_store_.counter("metrics_service.flushes_dropped").value());
+  EXPECT_EQ(2UL, stats_store_.counter("metrics_service.stream_failure").value());
+
+  EXPECT_CALL(*async_client_, start(_, _)).WillOnce(Return(&async_stream_));
+  flush(message);
+  EXPECT_TRUE(message.has_identifier());
+  EXPECT_EQ(2, message.names_size());
+
+  EXPECT_CALL(async_stream_, resetStream());
+}
+
+} // namespace
+} // namespace Stats
+} // namespace Envoy
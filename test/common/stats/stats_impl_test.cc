@@ -1,5 +1,10 @@
 #include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "common/common/thread.h"
 #include "common/stats/stats_impl.h"
 
 #include "gtest/gtest.h"
@@ -38,5 +43,191 @@ TEST(StatsIsolatedStoreImplTest, All) {
   EXPECT_EQ(2UL, store.gauges().size());
 }
 
+TEST(StatsCounterImplTest, ThreadCells) {
+  IsolatedStoreImpl store;
+  Counter& c1 = store.counter("c1");
+  Counter& c2 = store.counter("c2");
+  EXPECT_FALSE(c1.used());
+
+  std::vector<std::unique_ptr<Thread::Thread>> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back(new Thread::Thread([&c1, &c2]() -> void {
+      for (int i = 0; i < 1000; i++) {
+        c1.inc();
+      }
+      c2.add(5);
+    }));
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+
+  EXPECT_TRUE(c1.used());
+  EXPECT_EQ(4000UL, c1.value());
+  EXPECT_EQ(20UL, c2.value());
+  EXPECT_EQ(4000UL, c1.latch());
+  EXPECT_EQ(0UL, c1.latch());
+  EXPECT_EQ(4000UL, c1.value());
+
+  c2.inc();
+  c2.reset();
+  EXPECT_EQ(0UL, c2.value());
+  EXPECT_EQ(21UL, c2.latch());
+
+  // The cells of a released counter start over when they are reused.
+  {
+    IsolatedStoreImpl other_store;
+    other_store.counter("c3").add(3);
+  }
+  IsolatedStoreImpl other_store;
+  EXPECT_EQ(0UL, other_store.counter("c3").value());
+}
+
+/**
+ * Hands out one RawStatData per name, as the shared memory allocator does for overlapping scopes.
+ */
+class SharingRawStatDataAllocator : public RawStatDataAllocator {
+public:
+  // RawStatDataAllocator
+  RawStatData* alloc(const std::string& name) override {
+    RawStatData*& data = stats_[name];
+    if (data == nullptr) {
+      data = heap_.alloc(name);
+    } else {
+      data->ref_count_++;
+    }
+    return data;
+  }
+  void free(RawStatData& data) override {
+    if (data.ref_count_ > 1) {
+      data.ref_count_--;
+      return;
+    }
+    for (auto it = stats_.begin(); it != stats_.end(); it++) {
+      if (it->second == &data) {
+        stats_.erase(it);
+        break;
+      }
+    }
+    heap_.free(data);
+  }
+  const SymbolTable& symbolTable() override { return heap_.symbolTable(); }
+
+private:
+  HeapRawStatDataAllocator heap_;
+  std::map<std::string, RawStatData*> stats_;
+};
+
+TEST(StatsCounterImplTest, SharedData) {
+  SharingRawStatDataAllocator alloc;
+  std::unique_ptr<CounterImpl> c1(new CounterImpl(*alloc.alloc("c"), alloc));
+  std::unique_ptr<CounterImpl> c2(new CounterImpl(*alloc.alloc("c"), alloc));
+
+  // Increments through either counter are seen by both before any latch.
+  c1->inc();
+  c2->add(2);
+  EXPECT_EQ(3UL, c1->value());
+  EXPECT_EQ(3UL, c2->value());
+
+  // Destroying one counter keeps the cells of the other, which another counter must not reuse.
+  c2.reset();
+  std::unique_ptr<CounterImpl> other(new CounterImpl(*alloc.alloc("other"), alloc));
+  other->add(5);
+  c1->inc();
+  EXPECT_EQ(4UL, c1->value());
+  EXPECT_EQ(5UL, other->value());
+  EXPECT_EQ(4UL, c1->latch());
+}
+
+TEST(SymbolTableImplTest, InternAndRelease) {
+  SymbolTableImpl table;
+  Symbol foo;
+  Symbol bar;
+  Symbol foo2;
+  EXPECT_TRUE(table.intern("foo", 3, foo));
+  EXPECT_TRUE(table.intern("bar", 3, bar));
+  EXPECT_TRUE(table.intern("foo", 3, foo2));
+  EXPECT_NE(foo, bar);
+  EXPECT_EQ(foo, foo2);
+  EXPECT_EQ(2UL, table.size());
+  EXPECT_TRUE(table.tokenEquals(foo, "foo", 3));
+  EXPECT_FALSE(table.tokenEquals(foo, "fo", 2));
+
+  std::string out;
+  table.appendToken(bar, out);
+  EXPECT_EQ("bar", out);
+
+  // foo has two references.
+  table.release(foo);
+  EXPECT_EQ(2UL, table.size());
+  table.release(foo2);
+  EXPECT_EQ(1UL, table.size());
+
+  // The freed symbol is recycled.
+  Symbol baz;
+  EXPECT_TRUE(table.intern("baz", 3, baz));
+  EXPECT_EQ(foo, baz);
+  table.release(baz);
+  table.release(bar);
+  EXPECT_EQ(0UL, table.size());
+}
+
+TEST(RawStatDataTest, EncodedNames) {
+  SymbolTableImpl table;
+  RawStatData data1;
+  RawStatData data2;
+  EXPECT_FALSE(data1.initialized());
+  EXPECT_TRUE(data1.initialize("cluster.foo.upstream_rq_200", table));
+  EXPECT_TRUE(data2.initialize("cluster.bar.upstream_rq_200", table));
+  EXPECT_TRUE(data1.initialized());
+
+  // "cluster" and "upstream_rq_200" are shared.
+  EXPECT_EQ(4UL, table.size());
+  EXPECT_EQ("cluster.foo.upstream_rq_200", data1.name(table));
+  EXPECT_EQ("cluster.bar.upstream_rq_200", data2.name(table));
+  EXPECT_TRUE(data1.matches("cluster.foo.upstream_rq_200", table));
+  EXPECT_FALSE(data1.matches("cluster.foo.upstream_rq_2000", table));
+  EXPECT_FALSE(data1.matches("cluster.foo", table));
+  EXPECT_FALSE(data1.matches("cluster.foo.upstream_rq_200.extra", table));
+
+  data1.releaseName(table);
+  EXPECT_FALSE(data1.initialized());
+  EXPECT_EQ(3UL, table.size());
+  data2.releaseName(table);
+  EXPECT_EQ(0UL, table.size());
+}
+
+TEST(RawStatDataTest, EmptyTokens) {
+  SymbolTableImpl table;
+  RawStatData data;
+  EXPECT_TRUE(data.initialize("a..b.", table));
+  EXPECT_EQ("a..b.", data.name(table));
+  EXPECT_TRUE(data.matches("a..b.", table));
+  EXPECT_FALSE(data.matches("a.b.", table));
+  data.releaseName(table);
+}
+
+TEST(RawStatDataTest, TooManyTokens) {
+  SymbolTableImpl table;
+  RawStatData data;
+  const std::string name = "0.1.2.3.4.5.6.7.8.9.10.11.12.13.14.15.16.17.18.19";
+  EXPECT_TRUE(data.initialize(name, table));
+  EXPECT_EQ(16U, data.num_symbols_);
+  EXPECT_EQ(name, data.name(table));
+  EXPECT_TRUE(data.matches(name, table));
+  data.releaseName(table);
+}
+
+TEST(RawStatDataTest, Truncation) {
+  SymbolTableImpl table;
+  RawStatData data;
+  const std::string long_name(RawStatData::MAX_NAME_SIZE, 'a');
+  EXPECT_TRUE(data.initialize(long_name, table));
+  EXPECT_EQ(long_name, data.name(table));
+  // Longer names match on the truncated name.
+  EXPECT_TRUE(data.matches(long_name + "b", table));
+  data.releaseName(table);
+}
+
 } // namespace Stats
 } // namespace Envoy
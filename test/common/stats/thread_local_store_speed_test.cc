@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+
+#include "common/stats/stats_impl.h"
+#include "common/stats/thread_local_store.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Stats {
+namespace {
+
+/**
+ * A store with a set of existing counters, the way code on the request path finds them.
+ */
+class StoreFixture {
+public:
+  StoreFixture(bool threading) : store_(alloc_) {
+    if (threading) {
+      store_.initializeThreading(dispatcher_, tls_);
+    }
+    for (uint32_t i = 0; i < 100; i++) {
+      names_.push_back("cluster.service_" + std::to_string(i) + ".upstream_rq_total");
+      store_.counter(names_.back());
+    }
+  }
+
+  ~StoreFixture() {
+    store_.shutdownThreading();
+    tls_.shutdownThread();
+  }
+
+  testing::NiceMock<Event::MockDispatcher> dispatcher_;
+  testing::NiceMock<ThreadLocal::MockInstance> tls_;
+  HeapRawStatDataAllocator alloc_;
+  ThreadLocalStoreImpl store_;
+  std::vector<std::string> names_;
+};
+
+void BM_ThreadLocalStoreCounter(benchmark::State& state) {
+  StoreFixture fixture(true);
+  size_t index = 0;
+  while (state.KeepRunning()) {
+    fixture.store_.counter(fixture.names_[index++ % fixture.names_.size()]).inc();
+  }
+}
+BENCHMARK(BM_ThreadLocalStoreCounter);
+
+// Before threading is initialized every lookup goes to the central cache under a lock.
+void BM_ThreadLocalStoreCounterNoTls(benchmark::State& state) {
+  StoreFixture fixture(false);
+  size_t index = 0;
+  while (state.KeepRunning()) {
+    fixture.store_.counter(fixture.names_[index++ % fixture.names_.size()]).inc();
+  }
+}
+BENCHMARK(BM_ThreadLocalStoreCounterNoTls);
+
+void BM_ThreadLocalStoreScopeCounter(benchmark::State& state) {
+  StoreFixture fixture(true);
+  while (state.KeepRunning()) {
+    ScopePtr scope = fixture.store_.createScope("listener.0.0.0.0_80.");
+    benchmark::DoNotOptimize(&scope->counter("downstream_cx_total"));
+  }
+}
+BENCHMARK(BM_ThreadLocalStoreScopeCounter);
+
+} // namespace
+} // namespace Stats
+} // namespace Envoy
@@ -35,7 +35,7 @@ public:
     if (!stat_ref) {
       stat_ref.reset(new RawStatData());
       memset(stat_ref.get(), 0, sizeof(RawStatData));
-      stat_ref->initialize(name);
+      EXPECT_TRUE(stat_ref->initialize(name, symbol_table_));
     } else {
       stat_ref->ref_count_++;
     }
@@ -50,6 +50,7 @@ public:
 
     for (auto i = stats_.begin(); i != stats_.end(); i++) {
       if (i->second.get() == &data) {
+        data.releaseName(symbol_table_);
         stats_.erase(i);
         return;
       }
@@ -58,7 +59,10 @@ public:
     FAIL();
   }
 
+  const SymbolTable& symbolTable() override { return symbol_table_; }
+
 private:
+  SymbolTableImpl symbol_table_;
   std::unordered_map<std::string, std::unique_ptr<RawStatData>> stats_;
 };
 
@@ -80,6 +84,7 @@ public:
 
   MOCK_METHOD1(alloc, RawStatData*(const std::string& name));
   MOCK_METHOD1(free, void(RawStatData& data));
+  const SymbolTable& symbolTable() override { return alloc_.symbolTable(); }
 
   NiceMock<Event::MockDispatcher> main_thread_dispatcher_;
   NiceMock<ThreadLocal::MockInstance> tls_;
@@ -273,6 +278,29 @@ TEST_F(StatsThreadLocalStoreTest, OverlappingScopes) {
 
   // We should dedup when we fetch all counters to handle the overlapping case.
   EXPECT_EQ(2UL, store_->counters().size());
+  std::list<std::string> counter_names;
+  store_->forEachCounter([&counter_names](const std::string& name, Counter& counter) -> void {
+    counter_names.push_back(name);
+    EXPECT_EQ(name, counter.name());
+  });
+  counter_names.sort();
+  EXPECT_EQ((std::list<std::string>{"scope1.c", "stats.overflow"}), counter_names);
+
+  // Changed counters are also deduped, and are only visited once until they change again.
+  uint64_t num_changed = 0;
+  store_->forEachChangedCounter([&num_changed](const std::string& name, Counter&) -> void {
+    EXPECT_EQ("scope1.c", name);
+    num_changed++;
+  });
+  EXPECT_EQ(1UL, num_changed);
+  store_->forEachChangedCounter([](const std::string&, Counter&) -> void { FAIL(); });
+  c2.inc();
+  store_->forEachChangedCounter([&num_changed](const std::string& name, Counter& counter) -> void {
+    EXPECT_EQ("scope1.c", name);
+    EXPECT_EQ(3UL, counter.latch());
+    num_changed++;
+  });
+  EXPECT_EQ(2UL, num_changed);
 
   // Gauges should work the same way.
   EXPECT_CALL(*this, alloc(_)).Times(2);
@@ -286,12 +314,18 @@ TEST_F(StatsThreadLocalStoreTest, OverlappingScopes) {
   EXPECT_EQ(1UL, g1.value());
   EXPECT_EQ(1UL, g2.value());
   EXPECT_EQ(1UL, store_->gauges().size());
+  uint64_t num_gauges = 0;
+  store_->forEachGauge([&num_gauges](const std::string& name, Gauge&) -> void {
+    EXPECT_EQ("scope1.g", name);
+    num_gauges++;
+  });
+  EXPECT_EQ(1UL, num_gauges);
 
   // Deleting scope 1 will call free but will be reference counted. It still leaves scope 2 valid.
   EXPECT_CALL(*this, free(_)).Times(2);
   scope1.reset();
   c2.inc();
-  EXPECT_EQ(3UL, c2.value());
+  EXPECT_EQ(4UL, c2.value());
   EXPECT_EQ(2UL, store_->counters().size());
   g2.set(10);
   EXPECT_EQ(10UL, g2.value());
@@ -304,6 +338,56 @@ TEST_F(StatsThreadLocalStoreTest, OverlappingScopes) {
   EXPECT_CALL(*this, free(_)).Times(3);
 }
 
+TEST_F(StatsThreadLocalStoreTest, Histograms) {
+  InSequence s;
+
+  // Deliveries before threading is initialized are recorded into the parent histogram directly.
+  EXPECT_CALL(sink_, onHistogramComplete("h", 1));
+  store_->deliverHistogramToSinks("h", 1);
+
+  store_->initializeThreading(main_thread_dispatcher_, tls_);
+  ScopePtr scope1 = store_->createScope("scope1.");
+  ScopePtr scope2 = store_->createScope("scope1.");
+
+  EXPECT_CALL(sink_, onHistogramComplete("h", 2));
+  store_->deliverHistogramToSinks("h", 2);
+  EXPECT_CALL(sink_, onTimespanComplete("scope1.t", std::chrono::milliseconds(10)));
+  scope1->deliverTimingToSinks("t", std::chrono::milliseconds(10));
+  EXPECT_CALL(sink_, onTimespanComplete("scope1.t", std::chrono::milliseconds(20)));
+  scope2->deliverTimingToSinks("t", std::chrono::milliseconds(20));
+
+  // Overlapping scopes share the same histogram.
+  std::list<HistogramSharedPtr> histograms = store_->histograms();
+  EXPECT_EQ(2UL, histograms.size());
+  for (const HistogramSharedPtr& histogram : histograms) {
+    EXPECT_FALSE(histogram->used());
+    histogram->merge();
+    EXPECT_TRUE(histogram->used());
+    EXPECT_EQ(2U, histogram->intervalStatistics().sampleCount());
+    if (histogram->name() == "h") {
+      EXPECT_EQ(3U, histogram->intervalStatistics().sampleSum());
+    } else {
+      EXPECT_EQ("scope1.t", histogram->name());
+      EXPECT_EQ(30U, histogram->intervalStatistics().sampleSum());
+    }
+  }
+
+  // The histogram is released along with the last scope that refers to it.
+  EXPECT_CALL(main_thread_dispatcher_, post(_)).Times(2);
+  scope1.reset();
+  EXPECT_EQ(2UL, store_->histograms().size());
+  scope2.reset();
+  histograms.clear();
+  EXPECT_EQ(1UL, store_->histograms().size());
+  EXPECT_EQ("h", store_->histograms().front()->name());
+
+  store_->shutdownThreading();
+  tls_.shutdownThread();
+
+  // Includes overflow stat.
+  EXPECT_CALL(*this, free(_));
+}
+
 TEST_F(StatsThreadLocalStoreTest, AllocFailed) {
   InSequence s;
   store_->initializeThreading(main_thread_dispatcher_, tls_);
@@ -1,7 +1,12 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <chrono>
+#include <string>
 
 #include "common/network/address_impl.h"
 #include "common/network/utility.h"
+#include "common/stats/stats_impl.h"
 #include "common/stats/statsd.h"
 
 #include "test/mocks/thread_local/mocks.h"
@@ -28,7 +33,8 @@ TEST_P(UdpStatsdSinkTest, InitWithIpAddress) {
   Network::Address::InstanceConstSharedPtr server_address =
       Network::Utility::parseInternetAddressAndPort(
           fmt::format("{}:8125", Network::Test::getLoopbackAddressUrlString(GetParam())));
-  UdpStatsdSink sink(tls_, server_address);
+  IsolatedStoreImpl stats_store;
+  UdpStatsdSink sink(tls_, server_address, 0, stats_store);
   int fd = sink.getFdForTests();
   EXPECT_NE(fd, -1);
 
@@ -47,6 +53,45 @@ TEST_P(UdpStatsdSinkTest, InitWithIpAddress) {
   tls_.shutdownThread();
 }
 
+TEST_P(UdpStatsdSinkTest, BatchedFlush) {
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  std::pair<Network::Address::InstanceConstSharedPtr, int> server =
+      Network::Test::bindFreeLoopbackPort(GetParam(), Network::Address::SocketType::Datagram);
+  IsolatedStoreImpl stats_store;
+  UdpStatsdSink sink(tls_, server.first, 40, stats_store);
+
+  // "envoy.counter_N:1|c" is 19 bytes so two fit in a datagram including the separator.
+  sink.beginFlush();
+  for (uint32_t i = 0; i < 5; i++) {
+    sink.flushCounter(fmt::format("counter_{}", i), 1);
+  }
+  sink.flushGauge("a_gauge_with_a_name_longer_than_the_max_packet_size", 2);
+  sink.endFlush();
+
+  // Timers are not batched.
+  sink.onTimespanComplete("timer", std::chrono::milliseconds(5));
+
+  const std::string expected[] = {"envoy.counter_0:1|c\nenvoy.counter_1:1|c",
+                                  "envoy.counter_2:1|c\nenvoy.counter_3:1|c",
+                                  "envoy.counter_4:1|c",
+                                  "envoy.a_gauge_with_a_name_longer_than_the_max_packet_size:2|g",
+                                  "envoy.timer:5|ms"};
+  uint64_t bytes = 0;
+  for (const std::string& datagram : expected) {
+    char buffer[128];
+    ssize_t rc = recv(server.second, buffer, sizeof(buffer), 0);
+    ASSERT_GT(rc, 0);
+    EXPECT_EQ(datagram, std::string(buffer, rc));
+    bytes += rc;
+  }
+
+  EXPECT_EQ(5UL, stats_store.counter("statsd.udp_packets_sent").value());
+  EXPECT_EQ(bytes, stats_store.counter("statsd.udp_bytes_sent").value());
+
+  tls_.shutdownThread();
+  close(server.second);
+}
+
 } // namespace Statsd
 } // namespace Stats
 } // namespace Envoy
@@ -1,12 +1,16 @@
 #include "common/thread_local/thread_local_impl.h"
 
+#include "test/mocks/common.h"
 #include "test/mocks/event/mocks.h"
 
 #include "gmock/gmock.h"
 
 using testing::InSequence;
+using testing::Invoke;
 using testing::Ref;
+using testing::Return;
 using testing::ReturnPointee;
+using testing::SaveArg;
 using testing::_;
 
 namespace Envoy {
@@ -58,6 +62,8 @@ TEST_F(ThreadLocalInstanceImplTest, All) {
   // avoid "leaks" when using InSequence and shared_ptr.
   SlotPtr slot2 = tls_.allocateSlot();
   TestThreadLocalObject& object_ref2 = setObject(*slot2);
+  EXPECT_EQ(&object_ref2, &slot2->getTyped<TestThreadLocalObject>());
+  EXPECT_EQ(&object_ref2, slot2->get().get());
 
   EXPECT_CALL(thread_dispatcher_, post(_));
   EXPECT_CALL(object_ref2, onDestroy());
@@ -79,5 +85,47 @@ TEST_F(ThreadLocalInstanceImplTest, All) {
   tls_.shutdownThread();
 }
 
+// Updates made before a thread applied the previous one are coalesced into a single post, and the
+// completion callbacks of all of them run once the thread applied the newest.
+TEST_F(ThreadLocalInstanceImplTest, Update) {
+  SlotPtr slot = tls_.allocateSlot();
+  std::shared_ptr<TestThreadLocalObject> first(new TestThreadLocalObject());
+  std::shared_ptr<TestThreadLocalObject> second(new TestThreadLocalObject());
+  ReadyWatcher first_complete;
+  ReadyWatcher second_complete;
+
+  Event::PostCb apply;
+  EXPECT_CALL(thread_dispatcher_, post(_)).WillOnce(SaveArg<0>(&apply));
+  EXPECT_CALL(*this, createThreadLocal(Ref(main_dispatcher_)))
+      .WillOnce(Return(first))
+      .WillOnce(Return(second));
+  slot->update(
+      [this](Event::Dispatcher& dispatcher) -> ThreadLocalObjectSharedPtr {
+        return createThreadLocal(dispatcher);
+      },
+      [&]() -> void { first_complete.ready(); });
+  slot->update(
+      [this](Event::Dispatcher& dispatcher) -> ThreadLocalObjectSharedPtr {
+        return createThreadLocal(dispatcher);
+      },
+      [&]() -> void { second_complete.ready(); });
+  EXPECT_EQ(second.get(), &slot->getObject());
+
+  // The thread only builds its object once.
+  EXPECT_CALL(*this, createThreadLocal(Ref(thread_dispatcher_))).WillOnce(Return(second));
+  EXPECT_CALL(main_dispatcher_, post(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([](Event::PostCb cb) -> void { cb(); }));
+  EXPECT_CALL(first_complete, ready());
+  EXPECT_CALL(second_complete, ready());
+  apply();
+
+  first.reset();
+  second.reset();
+  tls_.shutdownGlobalThreading();
+  slot.reset();
+  tls_.shutdownThread();
+}
+
 } // namespace ThreadLocal
 } // namespace Envoy
@@ -10,6 +10,7 @@
 #include "common/runtime/uuid_util.h"
 #include "common/tracing/http_tracer_impl.h"
 
+#include "test/mocks/common.h"
 #include "test/mocks/http/mocks.h"
 #include "test/mocks/local_info/mocks.h"
 #include "test/mocks/runtime/mocks.h"
@@ -157,6 +158,99 @@ TEST(HttpTracerUtilityTest, mutateHeaders) {
   }
 }
 
+TEST(HttpTracerUtilityTest, mutateHeadersAdaptiveSampling) {
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<ThreadLocal::MockInstance> tls;
+  NiceMock<MockMonotonicTimeSource> time_source;
+  ON_CALL(runtime.snapshot_, getInteger("tracing.adaptive_sampling.traces_per_second", 0))
+      .WillByDefault(Return(1));
+  ON_CALL(runtime.snapshot_, featureEnabled("tracing.global_enabled", 100, _))
+      .WillByDefault(Return(true));
+  AdaptiveSampler sampler(runtime, tls, time_source);
+
+  // Random sampling is off while adaptive sampling is on.
+  {
+    EXPECT_CALL(runtime.snapshot_, featureEnabled("tracing.random_sampling", 10000, _, 10000))
+        .Times(0);
+    Http::TestHeaderMapImpl request_headers{
+        {"x-request-id", "125a4afb-6f55-44ba-ad80-413f09f48a28"}};
+    HttpTracerUtility::mutateHeaders(request_headers, runtime);
+    EXPECT_EQ(UuidTraceStatus::NoTrace,
+              UuidUtils::isTraceableUuid(request_headers.get_("x-request-id")));
+
+    HttpTracerUtility::mutateHeaders(request_headers, runtime, sampler, "cluster");
+    EXPECT_EQ(UuidTraceStatus::Sampled,
+              UuidUtils::isTraceableUuid(request_headers.get_("x-request-id")));
+  }
+
+  // Over the target.
+  {
+    Http::TestHeaderMapImpl request_headers{
+        {"x-request-id", "125a4afb-6f55-44ba-ad80-413f09f48a28"}};
+    HttpTracerUtility::mutateHeaders(request_headers, runtime, sampler, "cluster");
+    EXPECT_EQ(UuidTraceStatus::NoTrace,
+              UuidUtils::isTraceableUuid(request_headers.get_("x-request-id")));
+  }
+
+  // Forced requests do not take from the target.
+  {
+    Http::TestHeaderMapImpl request_headers{
+        {"x-request-id", "125a4afb-6f55-a4ba-ad80-413f09f48a28"}};
+    HttpTracerUtility::mutateHeaders(request_headers, runtime, sampler, "other_cluster");
+    EXPECT_EQ(UuidTraceStatus::Forced,
+              UuidUtils::isTraceableUuid(request_headers.get_("x-request-id")));
+    EXPECT_TRUE(sampler.sample("other_cluster"));
+  }
+
+  // Global off.
+  {
+    EXPECT_CALL(runtime.snapshot_, featureEnabled("tracing.global_enabled", 100, _))
+        .WillOnce(Return(false));
+    Http::TestHeaderMapImpl request_headers{
+        {"x-request-id", "125a4afb-6f55-44ba-ad80-413f09f48a28"}};
+    HttpTracerUtility::mutateHeaders(request_headers, runtime, sampler, "third_cluster");
+    EXPECT_EQ(UuidTraceStatus::NoTrace,
+              UuidUtils::isTraceableUuid(request_headers.get_("x-request-id")));
+  }
+}
+
+TEST(AdaptiveSamplerTest, TargetPerCluster) {
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<ThreadLocal::MockInstance> tls;
+  NiceMock<MockMonotonicTimeSource> time_source;
+  MonotonicTime now;
+  ON_CALL(time_source, currentTime()).WillByDefault(Invoke([&now]() { return now; }));
+  AdaptiveSampler sampler(runtime, tls, time_source);
+  EXPECT_FALSE(sampler.enabled());
+  EXPECT_FALSE(sampler.sample("fast"));
+
+  ON_CALL(runtime.snapshot_, getInteger("tracing.adaptive_sampling.traces_per_second", 0))
+      .WillByDefault(Return(2));
+  ON_CALL(runtime.snapshot_, getInteger("tracing.adaptive_sampling.off.traces_per_second", 2))
+      .WillByDefault(Return(0));
+  ON_CALL(runtime.snapshot_, getInteger("tracing.adaptive_sampling.slow.traces_per_second", 2))
+      .WillByDefault(Return(1));
+  EXPECT_TRUE(sampler.enabled());
+  EXPECT_TRUE(sampler.sample("fast"));
+  EXPECT_TRUE(sampler.sample("fast"));
+  EXPECT_FALSE(sampler.sample("fast"));
+  EXPECT_TRUE(sampler.sample("slow"));
+  EXPECT_FALSE(sampler.sample("slow"));
+  EXPECT_FALSE(sampler.sample("off"));
+
+  now += std::chrono::seconds(1);
+  EXPECT_TRUE(sampler.sample("fast"));
+  EXPECT_TRUE(sampler.sample("slow"));
+
+  // A new target takes effect at once.
+  ON_CALL(runtime.snapshot_, getInteger("tracing.adaptive_sampling.slow.traces_per_second", 2))
+      .WillByDefault(Return(3));
+  EXPECT_TRUE(sampler.sample("slow"));
+  EXPECT_TRUE(sampler.sample("slow"));
+  EXPECT_TRUE(sampler.sample("slow"));
+  EXPECT_FALSE(sampler.sample("slow"));
+}
+
 TEST(HttpTracerUtilityTest, IsTracing) {
   NiceMock<Http::AccessLog::MockRequestInfo> request_info;
   NiceMock<Stats::MockStore> stats;
@@ -22,7 +22,7 @@ namespace Zipkin {
 class TestReporterImpl : public Reporter {
 public:
   TestReporterImpl(int value) : value_(value) {}
-  void reportSpan(const Span& span) { reported_spans_.push_back(span); }
+  void reportSpan(Span&& span) { reported_spans_.push_back(std::move(span)); }
   int getValue() { return value_; }
   std::vector<Span>& reportedSpans() { return reported_spans_; }
 
@@ -275,10 +275,13 @@ TEST(ZipkinTracerTest, finishSpan) {
 
   // Finishing a server-side span with an SR annotation must add an SS annotation
   server_side->finish();
-  EXPECT_EQ(2ULL, server_side->annotations().size());
 
-  // Test if the reporter's reportSpan method was actually called upon finishing the span
-  EXPECT_EQ(1ULL, reporter_object->reportedSpans().size());
+  // Test if the reporter's reportSpan method was actually called upon finishing the span. The
+  // span is moved to the reporter.
+  ASSERT_EQ(1ULL, reporter_object->reportedSpans().size());
+  EXPECT_EQ(0ULL, server_side->annotations().size());
+  server_side.reset(new Span(std::move(reporter_object->reportedSpans()[0])));
+  EXPECT_EQ(2ULL, server_side->annotations().size());
 
   // Check the SR annotation added at span-creation time
   ann = server_side->annotations()[0];
@@ -182,6 +182,50 @@ TEST_F(ZipkinDriverTest, FlushSeveralSpans) {
   EXPECT_EQ(1U, stats_.counter("tracing.zipkin.reports_failed").value());
 }
 
+TEST_F(ZipkinDriverTest, FlushSpansProto) {
+  EXPECT_CALL(cm_, get("fake_cluster")).WillRepeatedly(Return(&cm_.thread_local_cluster_));
+  std::string proto_config = R"EOF(
+    {
+     "collector_cluster": "fake_cluster",
+     "collector_endpoint": "/api/v2/spans",
+     "collector_encoding": "proto"
+     }
+  )EOF";
+  Json::ObjectSharedPtr loader = Json::Factory::loadFromString(proto_config);
+  setup(*loader, true);
+
+  Http::MockAsyncClientRequest request(&cm_.async_client_);
+  zipkin::proto3::ListOfSpans spans;
+  EXPECT_CALL(cm_.async_client_, send_(_, _, _))
+      .WillOnce(
+          Invoke([&](Http::MessagePtr& message, Http::AsyncClient::Callbacks&,
+                     const Optional<std::chrono::milliseconds>&) -> Http::AsyncClient::Request* {
+            EXPECT_STREQ("/api/v2/spans", message->headers().Path()->value().c_str());
+            EXPECT_STREQ("application/x-protobuf",
+                         message->headers().ContentType()->value().c_str());
+            EXPECT_TRUE(spans.ParseFromString(message->bodyAsString()));
+
+            return &request;
+          }));
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("tracing.zipkin.min_flush_spans", 5))
+      .WillOnce(Return(1));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("tracing.zipkin.request_timeout", 5000U))
+      .WillOnce(Return(5000U));
+
+  Tracing::SpanPtr span =
+      driver_->startSpan(config_, request_headers_, operation_name_, start_time_);
+  Tracing::MockFinalizer finalizer;
+  EXPECT_CALL(finalizer, finalize(_));
+  span->finishSpan(finalizer);
+
+  ASSERT_EQ(1, spans.spans_size());
+  EXPECT_EQ(operation_name_, spans.spans(0).name());
+  EXPECT_EQ(zipkin::proto3::Span::SERVER, spans.spans(0).kind());
+  EXPECT_EQ(8U, spans.spans(0).id().size());
+  EXPECT_EQ(1U, stats_.counter("tracing.zipkin.spans_sent").value());
+}
+
 TEST_F(ZipkinDriverTest, FlushOneSpanReportFailure) {
   setupValidDriver();
 
@@ -5,6 +5,7 @@
 #include "common/config/utility.h"
 #include "common/http/message_impl.h"
 #include "common/json/json_loader.h"
+#include "common/protobuf/utility.h"
 #include "common/upstream/cds_api_impl.h"
 
 #include "test/common/upstream/utility.h"
@@ -18,7 +19,6 @@
 
 using testing::InSequence;
 using testing::Invoke;
-using testing::Return;
 using testing::ReturnRef;
 using testing::_;
 
@@ -50,9 +50,11 @@ public:
   }
 
   void expectAdd(const std::string& cluster_name) {
-    EXPECT_CALL(cm_, addOrUpdatePrimaryCluster(_))
-        .WillOnce(Invoke([cluster_name](const envoy::api::v2::Cluster& cluster) -> bool {
+    EXPECT_CALL(cm_, addOrUpdatePrimaryCluster(_, _))
+        .WillOnce(Invoke([cluster_name](const envoy::api::v2::Cluster& cluster,
+                                        uint64_t config_hash) -> bool {
           EXPECT_EQ(cluster_name, cluster.name());
+          EXPECT_EQ(MessageUtil::hash(cluster), config_hash);
           return true;
         }));
   }
@@ -72,14 +74,6 @@ public:
             }));
   }
 
-  ClusterManager::ClusterInfoMap makeClusterMap(std::vector<std::string> clusters) {
-    ClusterManager::ClusterInfoMap map;
-    for (auto cluster : clusters) {
-      map.emplace(cluster, cm_.thread_local_cluster_.cluster_);
-    }
-    return map;
-  }
-
   MockClusterManager cm_;
   Event::MockDispatcher dispatcher_;
   NiceMock<Runtime::MockRandomGenerator> random_;
@@ -126,7 +120,6 @@ TEST_F(CdsApiImplTest, Basic) {
       Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}));
   message->body().reset(new Buffer::OwnedImpl(response1_json));
 
-  EXPECT_CALL(cm_, clusters()).WillOnce(Return(ClusterManager::ClusterInfoMap{}));
   expectAdd("cluster1");
   expectAdd("cluster2");
   EXPECT_CALL(initialized_, ready());
@@ -144,8 +137,7 @@ TEST_F(CdsApiImplTest, Basic) {
       Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}));
   message->body().reset(new Buffer::OwnedImpl(response2_json));
 
-  EXPECT_CALL(cm_, clusters()).WillOnce(Return(makeClusterMap({"cluster1", "cluster2"})));
-  expectAdd("cluster1");
+  // Only the changes are applied.
   expectAdd("cluster3");
   EXPECT_CALL(cm_, removePrimaryCluster("cluster2"));
   EXPECT_CALL(*interval_timer_, enableTimer(_));
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -368,6 +369,18 @@ TEST_F(ClusterManagerImplTest, HttpHealthChecker) {
   factory_.tls_.shutdownThread();
 }
 
+TEST_F(ClusterManagerImplTest, ManyStaticClusters) {
+  // Enough clusters that their configs are hashed on several threads, where there are cores.
+  std::vector<std::string> clusters;
+  for (uint32_t i = 0; i < 1024; i++) {
+    clusters.push_back(defaultStaticClusterJson(fmt::format("cluster_{}", i)));
+  }
+  create(parseBootstrapFromJson(fmt::sprintf("{%s}", clustersJson(clusters))));
+  EXPECT_EQ(1024UL, factory_.stats_.counter("cluster_manager.cluster_added").value());
+  EXPECT_NE(nullptr, cluster_manager_->get("cluster_1023"));
+  factory_.tls_.shutdownThread();
+}
+
 TEST_F(ClusterManagerImplTest, UnknownCluster) {
   const std::string json =
       fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("cluster_1")}));
@@ -634,6 +647,51 @@ TEST_F(ClusterManagerImplTest, DynamicAddRemove) {
   EXPECT_TRUE(Mock::VerifyAndClearExpectations(cluster2.get()));
 }
 
+TEST_F(ClusterManagerImplTest, ClusterIdFollowsDynamicCluster) {
+  const std::string json = R"EOF(
+  {
+    "clusters": []
+  }
+  )EOF";
+
+  create(parseBootstrapFromJson(json));
+
+  // A name can be interned before a cluster of that name exists.
+  const uint32_t id = cluster_manager_->clusterId("fake_cluster");
+  EXPECT_EQ(id, cluster_manager_->clusterId("fake_cluster"));
+  EXPECT_NE(id, cluster_manager_->clusterId("other_cluster"));
+  EXPECT_EQ(nullptr, cluster_manager_->getById(id));
+
+  std::shared_ptr<MockCluster> cluster1(new NiceMock<MockCluster>());
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster1));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(defaultStaticCluster("fake_cluster")));
+  EXPECT_EQ(cluster1->info_, cluster_manager_->getById(id)->info());
+  EXPECT_EQ(cluster_manager_->get("fake_cluster"), cluster_manager_->getById(id));
+
+  // An update rebinds the id to the new cluster.
+  auto update_cluster = defaultStaticCluster("fake_cluster");
+  update_cluster.mutable_per_connection_buffer_limit_bytes()->set_value(12345);
+  std::shared_ptr<MockCluster> cluster2(new NiceMock<MockCluster>());
+  cluster2->hosts_ = {HostSharedPtr{new HostImpl(
+      cluster2->info_, "", Network::Utility::resolveUrl("tcp://127.0.0.1:80"), false, 1, "")}};
+  EXPECT_CALL(factory_, clusterFromProto_(_, _, _, _)).WillOnce(Return(cluster2));
+  EXPECT_TRUE(cluster_manager_->addOrUpdatePrimaryCluster(update_cluster));
+  EXPECT_EQ(cluster2->info_, cluster_manager_->getById(id)->info());
+
+  Http::ConnectionPool::MockInstance* cp = new Http::ConnectionPool::MockInstance();
+  EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp));
+  EXPECT_EQ(cp, cluster_manager_->httpConnPoolForClusterId(id, ResourcePriority::Default, nullptr));
+
+  // Once removed, the id no longer finds the cluster.
+  Http::ConnectionPool::Instance::DrainedCb drained_cb;
+  EXPECT_CALL(*cp, addDrainedCallback(_)).WillOnce(SaveArg<0>(&drained_cb));
+  EXPECT_TRUE(cluster_manager_->removePrimaryCluster("fake_cluster"));
+  EXPECT_EQ(nullptr, cluster_manager_->getById(id));
+  EXPECT_EQ(nullptr,
+            cluster_manager_->httpConnPoolForClusterId(id, ResourcePriority::Default, nullptr));
+  drained_cb();
+}
+
 TEST_F(ClusterManagerImplTest, AddOrUpdatePrimaryClusterStaticExists) {
   const std::string json =
       fmt::sprintf("{%s}", clustersJson({defaultStaticClusterJson("some_cluster")}));
@@ -755,6 +813,165 @@ TEST_F(ClusterManagerImplTest, DynamicHostRemove) {
   factory_.tls_.shutdownThread();
 }
 
+// Validate that the worker's load balancer adopts the rings built once with each membership
+// update rather than building its own, and that an update delivered after a later one is ignored.
+TEST_F(ClusterManagerImplTest, SharedRingHashRings) {
+  const std::string json = R"EOF(
+  {
+    "clusters": [
+    {
+      "name": "cluster_1",
+      "connect_timeout_ms": 250,
+      "type": "strict_dns",
+      "dns_resolvers": [ "1.2.3.4:80" ],
+      "lb_type": "ring_hash",
+      "hosts": [{"url": "tcp://localhost:11001"}]
+    }]
+  }
+  )EOF";
+
+  std::shared_ptr<Network::MockDnsResolver> dns_resolver(new Network::MockDnsResolver());
+  EXPECT_CALL(factory_.dispatcher_, createDnsResolver(_)).WillOnce(Return(dns_resolver));
+
+  Network::DnsResolver::ResolveCb dns_callback;
+  Event::MockTimer* dns_timer_ = new NiceMock<Event::MockTimer>(&factory_.dispatcher_);
+  Network::MockActiveDnsQuery active_dns_query;
+  EXPECT_CALL(*dns_resolver, resolve(_, _, _))
+      .WillRepeatedly(DoAll(SaveArg<2>(&dns_callback), Return(&active_dns_query)));
+  create(parseBootstrapFromJson(json));
+
+  // All hosts are healthy, so each update builds a single ring, which reads the ring size.
+  EXPECT_CALL(factory_.runtime_.snapshot_, getInteger("upstream.ring_hash.min_ring_size", _))
+      .WillOnce(Return(12));
+  dns_callback(TestUtility::makeDnsResponse({"127.0.0.1", "127.0.0.2"}));
+  ThreadLocalCluster* cluster = cluster_manager_->get("cluster_1");
+  EXPECT_EQ(2UL, cluster->hostSet().hosts().size());
+  EXPECT_NE(nullptr, cluster->loadBalancer().chooseHost(nullptr));
+
+  // Hold the updates back from the worker, and deliver them out of order.
+  std::vector<Event::PostCb> updates;
+  EXPECT_CALL(factory_.tls_, runOnAllThreads(_))
+      .WillRepeatedly(Invoke([&](Event::PostCb cb) -> void { updates.push_back(cb); }));
+  EXPECT_CALL(factory_.runtime_.snapshot_, getInteger("upstream.ring_hash.min_ring_size", _))
+      .Times(2)
+      .WillRepeatedly(Return(12));
+  dns_timer_->callback_();
+  dns_callback(TestUtility::makeDnsResponse({"127.0.0.3"}));
+  dns_timer_->callback_();
+  dns_callback(TestUtility::makeDnsResponse({"127.0.0.4"}));
+  ASSERT_EQ(2UL, updates.size());
+
+  updates[1]();
+  updates[0]();
+  ASSERT_EQ(1UL, cluster->hostSet().hosts().size());
+  EXPECT_EQ("127.0.0.4:11001", cluster->hostSet().hosts()[0]->address()->asString());
+  EXPECT_EQ(cluster->hostSet().hosts()[0], cluster->loadBalancer().chooseHost(nullptr));
+
+  factory_.tls_.shutdownThread();
+}
+
+TEST_F(ClusterManagerImplTest, WarmConnectionsOnHostAdd) {
+  const std::string json = R"EOF(
+  {
+    "clusters": [
+    {
+      "name": "cluster_1",
+      "connect_timeout_ms": 250,
+      "type": "strict_dns",
+      "dns_resolvers": [ "1.2.3.4:80" ],
+      "lb_type": "round_robin",
+      "hosts": [{"url": "tcp://localhost:11001"}]
+    }]
+  }
+  )EOF";
+
+  ON_CALL(factory_.runtime_.snapshot_, getInteger("upstream.min_warm_connections.cluster_1", 0))
+      .WillByDefault(Return(2));
+
+  std::shared_ptr<Network::MockDnsResolver> dns_resolver(new Network::MockDnsResolver());
+  EXPECT_CALL(factory_.dispatcher_, createDnsResolver(_)).WillOnce(Return(dns_resolver));
+
+  Network::DnsResolver::ResolveCb dns_callback;
+  // The DNS refresh timer.
+  new NiceMock<Event::MockTimer>(&factory_.dispatcher_);
+  Network::MockActiveDnsQuery active_dns_query;
+  EXPECT_CALL(*dns_resolver, resolve(_, _, _))
+      .WillRepeatedly(DoAll(SaveArg<2>(&dns_callback), Return(&active_dns_query)));
+  create(parseBootstrapFromJson(json));
+
+  // Every added host gets a default priority pool that is asked to open its warm connections.
+  std::vector<Http::ConnectionPool::MockInstance*> pools;
+  EXPECT_CALL(factory_, allocateConnPool_(_))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](HostConstSharedPtr) -> Http::ConnectionPool::Instance* {
+        Http::ConnectionPool::MockInstance* pool = new Http::ConnectionPool::MockInstance();
+        EXPECT_CALL(*pool, prefetchConnections());
+        pools.push_back(pool);
+        return pool;
+      }));
+  dns_callback(TestUtility::makeDnsResponse({"127.0.0.1", "127.0.0.2"}));
+  EXPECT_EQ(2UL, pools.size());
+
+  // Requests get the warmed pools.
+  for (size_t i = 0; i < 2; i++) {
+    Http::ConnectionPool::Instance* pool =
+        cluster_manager_->httpConnPoolForCluster("cluster_1", ResourcePriority::Default, nullptr);
+    EXPECT_NE(pools.end(), std::find(pools.begin(), pools.end(), pool));
+  }
+
+  factory_.tls_.shutdownThread();
+}
+
+TEST_F(ClusterManagerImplTest, OnDemandCluster) {
+  const std::string json = R"EOF(
+  {
+    "clusters": [
+    {
+      "name": "cluster_1",
+      "connect_timeout_ms": 250,
+      "type": "static",
+      "lb_type": "round_robin",
+      "hosts": [{"url": "tcp://127.0.0.1:11001"}]
+    }]
+  }
+  )EOF";
+
+  ON_CALL(factory_.runtime_.snapshot_, getInteger("upstream.on_demand.cluster_1", 0))
+      .WillByDefault(Return(1));
+  create(parseBootstrapFromJson(json));
+  EXPECT_TRUE(cluster_manager_->clusters().at("cluster_1").get().info()->onDemand());
+
+  // The first lookup builds the cluster with the hosts it already has, and starts the idle sweep.
+  Event::MockTimer* idle_timer = new NiceMock<Event::MockTimer>(&factory_.tls_.dispatcher_);
+  EXPECT_CALL(*idle_timer, enableTimer(std::chrono::milliseconds(300000))).Times(4);
+  Http::ConnectionPool::MockInstance* cp = new Http::ConnectionPool::MockInstance();
+  EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp));
+  EXPECT_EQ(cp, cluster_manager_->httpConnPoolForCluster("cluster_1", ResourcePriority::Default,
+                                                         nullptr));
+  EXPECT_EQ(1UL, cluster_manager_->get("cluster_1")->hostSet().hosts().size());
+
+  // A cluster that was used since the last sweep stays.
+  idle_timer->callback_();
+  EXPECT_EQ(cp, cluster_manager_->httpConnPoolForCluster("cluster_1", ResourcePriority::Default,
+                                                         nullptr));
+  idle_timer->callback_();
+
+  // A cluster that was not is removed, and its connection pools drained.
+  Http::ConnectionPool::Instance::DrainedCb drained_cb;
+  EXPECT_CALL(*cp, addDrainedCallback(_)).WillOnce(SaveArg<0>(&drained_cb));
+  idle_timer->callback_();
+  EXPECT_CALL(factory_.tls_.dispatcher_, deferredDelete_(_)).Times(NumResourcePriorities);
+  drained_cb();
+
+  // The next lookup builds it again.
+  cp = new Http::ConnectionPool::MockInstance();
+  EXPECT_CALL(factory_, allocateConnPool_(_)).WillOnce(Return(cp));
+  EXPECT_EQ(cp, cluster_manager_->httpConnPoolForCluster("cluster_1", ResourcePriority::Default,
+                                                         nullptr));
+
+  factory_.tls_.shutdownThread();
+}
+
 TEST_F(ClusterManagerImplTest, OriginalDstInitialization) {
   const std::string json = R"EOF(
   {
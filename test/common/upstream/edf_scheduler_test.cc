@@ -0,0 +1,57 @@
+#include <memory>
+
+#include "common/upstream/edf_scheduler.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Upstream {
+
+TEST(EdfSchedulerTest, Empty) {
+  EdfScheduler<uint32_t> sched;
+  EXPECT_TRUE(sched.empty());
+  EXPECT_EQ(nullptr, sched.pick());
+}
+
+// Equal weights pick in insertion order, like plain round robin.
+TEST(EdfSchedulerTest, Unweighted) {
+  EdfScheduler<uint32_t> sched;
+  std::shared_ptr<uint32_t> entries[3];
+  for (uint32_t i = 0; i < 3; ++i) {
+    entries[i] = std::make_shared<uint32_t>(i);
+    sched.add(1, entries[i]);
+  }
+
+  for (uint32_t rounds = 0; rounds < 3; ++rounds) {
+    for (uint32_t i = 0; i < 3; ++i) {
+      auto peek = sched.pick();
+      EXPECT_EQ(entries[i], peek);
+      sched.add(1, peek);
+    }
+  }
+}
+
+// Weighted entries are picked in proportion to their weights and interleaved.
+TEST(EdfSchedulerTest, Weighted) {
+  EdfScheduler<uint32_t> sched;
+  std::shared_ptr<uint32_t> light = std::make_shared<uint32_t>(0);
+  std::shared_ptr<uint32_t> heavy = std::make_shared<uint32_t>(1);
+  sched.add(1, light);
+  sched.add(2, heavy);
+
+  // Deadlines: heavy at 1/2, 1, 3/2, ... and light at 1, 2, ... Ties go to the earlier add.
+  uint32_t picks[2] = {};
+  std::shared_ptr<uint32_t> expected[] = {heavy, light, heavy, heavy, light, heavy};
+  for (const auto& entry : expected) {
+    auto peek = sched.pick();
+    EXPECT_EQ(entry, peek);
+    ++picks[*peek];
+    sched.add(*peek == 0 ? 1 : 2, peek);
+  }
+
+  EXPECT_EQ(2U, picks[0]);
+  EXPECT_EQ(4U, picks[1]);
+}
+
+} // namespace Upstream
+} // namespace Envoy
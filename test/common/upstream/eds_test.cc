@@ -113,5 +113,103 @@ TEST_F(EdsTest, NoServiceNameOnSuccessConfigUpdate) {
   EXPECT_TRUE(initialized);
 }
 
+// Validate that known hosts are kept across updates and that an identical update is skipped.
+TEST_F(EdsTest, EndpointUpdates) {
+  Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> resources;
+  auto* cluster_load_assignment = resources.Add();
+  cluster_load_assignment->set_cluster_name("fare");
+  auto add_endpoint = [cluster_load_assignment](uint32_t port, uint32_t weight) {
+    auto* lb_endpoint = cluster_load_assignment->add_endpoints()->add_lb_endpoints();
+    auto* socket_address =
+        lb_endpoint->mutable_endpoint()->mutable_address()->mutable_socket_address();
+    socket_address->set_address("1.2.3.4");
+    socket_address->set_port_value(port);
+    lb_endpoint->mutable_load_balancing_weight()->set_value(weight);
+  };
+  add_endpoint(80, 1);
+  add_endpoint(81, 1);
+
+  uint32_t membership_updates = 0;
+  cluster_->addMemberUpdateCb(
+      [&membership_updates](const std::vector<HostSharedPtr>&,
+                            const std::vector<HostSharedPtr>&) -> void { membership_updates++; });
+  cluster_->onConfigUpdate(resources);
+  EXPECT_EQ(1U, membership_updates);
+  ASSERT_EQ(2U, cluster_->hosts().size());
+  const HostSharedPtr host_80 = cluster_->hosts()[0];
+
+  // Resending the same assignment does nothing.
+  cluster_->onConfigUpdate(resources);
+  EXPECT_EQ(1U, membership_updates);
+  EXPECT_EQ(1U, cluster_->info()->stats().update_no_rebuild_.value());
+
+  // Changing a weight updates the existing host in place.
+  cluster_load_assignment->mutable_endpoints(0)
+      ->mutable_lb_endpoints(0)
+      ->mutable_load_balancing_weight()
+      ->set_value(3);
+  cluster_->onConfigUpdate(resources);
+  EXPECT_EQ(1U, membership_updates);
+  EXPECT_EQ(host_80, cluster_->hosts()[0]);
+  EXPECT_EQ(3U, host_80->weight());
+  EXPECT_EQ(3U, cluster_->info()->stats().max_host_weight_.value());
+
+  // Replacing an endpoint keeps the unchanged host and adds the new one.
+  cluster_load_assignment->mutable_endpoints(1)
+      ->mutable_lb_endpoints(0)
+      ->mutable_endpoint()
+      ->mutable_address()
+      ->mutable_socket_address()
+      ->set_port_value(82);
+  cluster_->onConfigUpdate(resources);
+  EXPECT_EQ(2U, membership_updates);
+  ASSERT_EQ(2U, cluster_->hosts().size());
+  EXPECT_EQ(host_80, cluster_->hosts()[0]);
+  EXPECT_EQ("1.2.3.4:82", cluster_->hosts()[1]->address()->asString());
+}
+
+// Validate that the EDS health status of an endpoint is applied to its host.
+TEST_F(EdsTest, EndpointHealthStatus) {
+  Protobuf::RepeatedPtrField<envoy::api::v2::ClusterLoadAssignment> resources;
+  auto* cluster_load_assignment = resources.Add();
+  cluster_load_assignment->set_cluster_name("fare");
+  auto add_endpoint = [cluster_load_assignment](uint32_t port,
+                                                envoy::api::v2::HealthStatus health_status) {
+    auto* lb_endpoint = cluster_load_assignment->add_endpoints()->add_lb_endpoints();
+    auto* socket_address =
+        lb_endpoint->mutable_endpoint()->mutable_address()->mutable_socket_address();
+    socket_address->set_address("1.2.3.4");
+    socket_address->set_port_value(port);
+    lb_endpoint->set_health_status(health_status);
+  };
+  add_endpoint(80, envoy::api::v2::HealthStatus::HEALTHY);
+  add_endpoint(81, envoy::api::v2::HealthStatus::UNHEALTHY);
+  add_endpoint(82, envoy::api::v2::HealthStatus::UNKNOWN);
+
+  cluster_->onConfigUpdate(resources);
+  ASSERT_EQ(3U, cluster_->hosts().size());
+  EXPECT_FALSE(cluster_->hosts()[1]->healthy());
+  EXPECT_TRUE(cluster_->hosts()[1]->healthFlagGet(Host::HealthFlag::FAILED_EDS_HEALTH));
+  EXPECT_EQ(2U, cluster_->healthyHosts().size());
+
+  // A health status change alone rebuilds the healthy hosts without changing membership.
+  uint32_t membership_updates = 0;
+  cluster_->addMemberUpdateCb([&membership_updates](const std::vector<HostSharedPtr>& hosts_added,
+                                                    const std::vector<HostSharedPtr>&) -> void {
+    EXPECT_TRUE(hosts_added.empty());
+    membership_updates++;
+  });
+  cluster_load_assignment->mutable_endpoints(0)->mutable_lb_endpoints(0)->set_health_status(
+      envoy::api::v2::HealthStatus::DRAINING);
+  cluster_load_assignment->mutable_endpoints(1)->mutable_lb_endpoints(0)->set_health_status(
+      envoy::api::v2::HealthStatus::HEALTHY);
+  cluster_->onConfigUpdate(resources);
+  EXPECT_EQ(1U, membership_updates);
+  EXPECT_FALSE(cluster_->hosts()[0]->healthy());
+  EXPECT_TRUE(cluster_->hosts()[1]->healthy());
+  EXPECT_EQ(2U, cluster_->healthyHosts().size());
+  EXPECT_EQ(cluster_->hosts()[1], cluster_->healthyHosts()[0]);
+}
+
 } // namespace Upstream
 } // namespace Envoy
@@ -628,6 +628,72 @@ TEST_F(HttpHealthCheckerImplTest, RemoteCloseBetweenChecks) {
   EXPECT_TRUE(cluster_->hosts_[0]->healthy());
 }
 
+TEST_F(HttpHealthCheckerImplTest, StaggerInitialChecks) {
+  ON_CALL(runtime_.snapshot_, getInteger("health_check.stagger_initial_checks", 0))
+      .WillByDefault(Return(1));
+  setupNoServiceValidationHC();
+
+  cluster_->hosts_ = {
+      HostSharedPtr{new HostImpl(cluster_->info_, "",
+                                 Network::Utility::resolveUrl("tcp://127.0.0.1:80"), false, 1, "")},
+      HostSharedPtr{new HostImpl(cluster_->info_, "",
+                                 Network::Utility::resolveUrl("tcp://127.0.0.1:81"), false, 1, "")}};
+
+  // Timers are handed out most recently created first, so the second host's timers are created
+  // before the first host's.
+  Event::MockTimer* second_timeout_timer = new Event::MockTimer(&dispatcher_);
+  Event::MockTimer* second_interval_timer = new Event::MockTimer(&dispatcher_);
+  expectSessionCreate();
+  expectStreamCreate(0);
+
+  // The first host is checked right away and the second one half way through the interval.
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, enableTimer(_));
+  EXPECT_CALL(*second_interval_timer, enableTimer(std::chrono::milliseconds(500)));
+  EXPECT_CALL(*second_timeout_timer, enableTimer(_)).Times(0);
+  health_checker_->start();
+  EXPECT_EQ(1UL, cluster_->info_->stats_store_.counter("health_check.attempt").value());
+}
+
+TEST_F(HttpHealthCheckerImplTest, MaxConnectsPerSecond) {
+  ON_CALL(runtime_.snapshot_, getInteger("health_check.max_connects_per_second", 0))
+      .WillByDefault(Return(1));
+  setupNoServiceValidationHC();
+  EXPECT_CALL(*this, onHostStatus(_, false)).Times(2);
+
+  cluster_->hosts_ = {HostSharedPtr{new HostImpl(
+      cluster_->info_, "", Network::Utility::resolveUrl("tcp://127.0.0.1:80"), false, 1, "")}};
+  // The connect window timer is created after the session's timers.
+  Event::MockTimer* connect_window_timer = new Event::MockTimer(&dispatcher_);
+  expectSessionCreate();
+  expectStreamCreate(0);
+  EXPECT_CALL(*connect_window_timer, enableTimer(std::chrono::milliseconds(1000)));
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, enableTimer(_));
+  health_checker_->start();
+
+  EXPECT_CALL(*test_sessions_[0]->interval_timer_, enableTimer(_));
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, disableTimer());
+  respond(0, "200", true);
+
+  // The connection was closed and the window is used up, so the next check is deferred.
+  EXPECT_CALL(*test_sessions_[0]->interval_timer_, enableTimer(std::chrono::milliseconds(1000)));
+  test_sessions_[0]->interval_timer_->callback_();
+  EXPECT_EQ(1UL, cluster_->info_->stats_store_.counter("health_check.connect_deferred").value());
+  EXPECT_EQ(1UL, cluster_->info_->stats_store_.counter("health_check.attempt").value());
+
+  // Once the window is over the check connects again.
+  connect_window_timer->callback_();
+  expectClientCreate(0);
+  expectStreamCreate(0);
+  EXPECT_CALL(*connect_window_timer, enableTimer(std::chrono::milliseconds(1000)));
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, enableTimer(_));
+  test_sessions_[0]->interval_timer_->callback_();
+  EXPECT_EQ(2UL, cluster_->info_->stats_store_.counter("health_check.attempt").value());
+
+  EXPECT_CALL(*test_sessions_[0]->interval_timer_, enableTimer(_));
+  EXPECT_CALL(*test_sessions_[0]->timeout_timer_, disableTimer());
+  respond(0, "200", false);
+}
+
 TEST(TcpHealthCheckMatcher, loadJsonBytes) {
   {
     Protobuf::RepeatedPtrField<envoy::api::v2::HealthCheck::Payload> repeated_payload;
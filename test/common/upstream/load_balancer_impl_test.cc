@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -7,6 +8,7 @@
 #include "common/upstream/load_balancer_impl.h"
 #include "common/upstream/upstream_impl.h"
 
+#include "test/mocks/common.h"
 #include "test/mocks/runtime/mocks.h"
 #include "test/mocks/upstream/mocks.h"
 
@@ -16,6 +18,7 @@
 namespace Envoy {
 using testing::NiceMock;
 using testing::Return;
+using testing::ReturnPointee;
 
 namespace Upstream {
 
@@ -69,6 +72,51 @@ TEST_F(RoundRobinLoadBalancerTest, Normal) {
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
 }
 
+// Validate that hosts that failed since the healthy hosts were last rebuilt are skipped.
+TEST_F(RoundRobinLoadBalancerTest, SkipsNewlyUnhealthy) {
+  init(false);
+  cluster_.healthy_hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
+                             newTestHost(cluster_.info_, "tcp://127.0.0.1:81"),
+                             newTestHost(cluster_.info_, "tcp://127.0.0.1:82")};
+  cluster_.hosts_ = cluster_.healthy_hosts_;
+  cluster_.healthy_hosts_[0]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[2], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(2U, stats_.lb_unhealthy_repick_.value());
+
+  // The last host picked is used when none of the picks is healthy.
+  for (const HostSharedPtr& host : cluster_.healthy_hosts_) {
+    host->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  }
+  EXPECT_EQ(cluster_.healthy_hosts_[2], lb_->chooseHost(nullptr));
+  EXPECT_EQ(3U, stats_.lb_unhealthy_repick_.value());
+}
+
+// Validate that the walk past an unhealthy entry is bounded by the entries looked at, and counts
+// one repick per call.
+TEST_F(RoundRobinLoadBalancerTest, NextHealthyEntryBounded) {
+  HostSharedPtr unhealthy_host = newTestHost(cluster_.info_, "tcp://127.0.0.1:80");
+  HostSharedPtr other_unhealthy_host = newTestHost(cluster_.info_, "tcp://127.0.0.1:81");
+  unhealthy_host->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  other_unhealthy_host->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  std::vector<HostConstSharedPtr> hosts = {unhealthy_host, other_unhealthy_host,
+                                           newTestHost(cluster_.info_, "tcp://127.0.0.1:82")};
+
+  // Host 82 is one entry past the bound.
+  std::vector<uint32_t> entries(LoadBalancerUtility::MAX_UNHEALTHY_ENTRIES + 2, 1);
+  entries[0] = 0;
+  entries.back() = 2;
+  EXPECT_EQ(hosts[0], LoadBalancerUtility::nextHealthyEntry(entries, 0, hosts, stats_));
+  EXPECT_EQ(1U, stats_.lb_unhealthy_repick_.value());
+
+  // Host 82 is the last entry within the bound.
+  entries.pop_back();
+  entries.back() = 2;
+  EXPECT_EQ(hosts[2], LoadBalancerUtility::nextHealthyEntry(entries, 0, hosts, stats_));
+  EXPECT_EQ(2U, stats_.lb_unhealthy_repick_.value());
+}
+
 TEST_F(RoundRobinLoadBalancerTest, MaxUnhealthyPanic) {
   init(false);
   cluster_.healthy_hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
@@ -96,6 +144,39 @@ TEST_F(RoundRobinLoadBalancerTest, MaxUnhealthyPanic) {
   EXPECT_EQ(3UL, stats_.lb_healthy_panic_.value());
 }
 
+TEST_F(RoundRobinLoadBalancerTest, Weighted) {
+  init(false);
+  cluster_.healthy_hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80", 1),
+                             newTestHost(cluster_.info_, "tcp://127.0.0.1:81", 2)};
+  cluster_.hosts_ = cluster_.healthy_hosts_;
+  stats_.max_host_weight_.set(2UL);
+
+  // The weight 2 host gets two out of every three picks, interleaved with the weight 1 host.
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+
+  // A membership change starts a new schedule which includes the added host.
+  std::vector<HostSharedPtr> hosts_added{newTestHost(cluster_.info_, "tcp://127.0.0.1:82", 2)};
+  cluster_.healthy_hosts_.push_back(hosts_added[0]);
+  cluster_.hosts_ = cluster_.healthy_hosts_;
+  cluster_.runCallbacks(hosts_added, empty_host_vector_);
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[2], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[2], lb_->chooseHost(nullptr));
+
+  // With weights disabled in runtime we go back to plain round robin.
+  ON_CALL(runtime_.snapshot_, getInteger("upstream.weight_enabled", 1)).WillByDefault(Return(0));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_->chooseHost(nullptr));
+  EXPECT_EQ(cluster_.healthy_hosts_[2], lb_->chooseHost(nullptr));
+}
+
 TEST_F(RoundRobinLoadBalancerTest, ZoneAwareSmallCluster) {
   init(true);
   HostVectorSharedPtr hosts(
@@ -200,6 +281,43 @@ TEST_F(RoundRobinLoadBalancerTest, ZoneAwareRoutingLargeZoneSwitchOnOff) {
   EXPECT_EQ(cluster_.healthy_hosts_[2], lb_->chooseHost(nullptr));
 }
 
+TEST_F(RoundRobinLoadBalancerTest, ZoneAwareRoutingRegeneratedOnZoneSizeChange) {
+  init(true);
+  HostVectorSharedPtr hosts(
+      new std::vector<HostSharedPtr>({newTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
+                                      newTestHost(cluster_.info_, "tcp://127.0.0.1:81"),
+                                      newTestHost(cluster_.info_, "tcp://127.0.0.1:82")}));
+  HostListsSharedPtr hosts_per_zone(new std::vector<std::vector<HostSharedPtr>>(
+      {{newTestHost(cluster_.info_, "tcp://127.0.0.1:81")},
+       {newTestHost(cluster_.info_, "tcp://127.0.0.1:80")},
+       {newTestHost(cluster_.info_, "tcp://127.0.0.1:82")}}));
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.zone_routing.min_cluster_size", 6))
+      .WillRepeatedly(Return(3));
+
+  cluster_.healthy_hosts_ = *hosts;
+  cluster_.hosts_ = *hosts;
+  cluster_.healthy_hosts_per_zone_ = *hosts_per_zone;
+  local_cluster_hosts_->updateHosts(hosts, hosts, hosts_per_zone, hosts_per_zone,
+                                    empty_host_vector_, empty_host_vector_);
+  EXPECT_EQ(1U, stats_.lb_recalculate_zone_structures_.value());
+
+  // Different hosts in zones of the same size route the same way.
+  HostListsSharedPtr other_hosts_per_zone(new std::vector<std::vector<HostSharedPtr>>(
+      {{newTestHost(cluster_.info_, "tcp://127.0.0.1:83")},
+       {newTestHost(cluster_.info_, "tcp://127.0.0.1:84")},
+       {newTestHost(cluster_.info_, "tcp://127.0.0.1:85")}}));
+  local_cluster_hosts_->updateHosts(hosts, hosts, other_hosts_per_zone, other_hosts_per_zone,
+                                    empty_host_vector_, empty_host_vector_);
+  EXPECT_EQ(1U, stats_.lb_recalculate_zone_structures_.value());
+
+  // A zone that grows does not.
+  (*other_hosts_per_zone)[1].push_back(newTestHost(cluster_.info_, "tcp://127.0.0.1:86"));
+  local_cluster_hosts_->updateHosts(hosts, hosts, other_hosts_per_zone, other_hosts_per_zone,
+                                    empty_host_vector_, empty_host_vector_);
+  EXPECT_EQ(2U, stats_.lb_recalculate_zone_structures_.value());
+}
+
 TEST_F(RoundRobinLoadBalancerTest, ZoneAwareRoutingSmallZone) {
   init(true);
   HostVectorSharedPtr upstream_hosts(
@@ -406,7 +524,7 @@ TEST_F(LeastRequestLoadBalancerTest, SingleHost) {
 
   // Host weight is 100.
   {
-    EXPECT_CALL(random_, random()).WillOnce(Return(2));
+    EXPECT_CALL(random_, random()).WillOnce(Return(2)).WillOnce(Return(3));
     stats_.max_host_weight_.set(100UL);
     EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
   }
@@ -414,7 +532,7 @@ TEST_F(LeastRequestLoadBalancerTest, SingleHost) {
   std::vector<HostSharedPtr> empty;
   {
     cluster_.runCallbacks(empty, empty);
-    EXPECT_CALL(random_, random()).WillOnce(Return(2));
+    EXPECT_CALL(random_, random()).WillOnce(Return(2)).WillOnce(Return(3));
     EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
   }
 
@@ -454,6 +572,8 @@ TEST_F(LeastRequestLoadBalancerTest, WeightImbalanceRuntimeOff) {
       .WillRepeatedly(Return(0));
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.least_request.choice_count", 2))
+      .WillRepeatedly(Return(2));
 
   cluster_.healthy_hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80", 1),
                              newTestHost(cluster_.info_, "tcp://127.0.0.1:81", 3)};
@@ -478,62 +598,159 @@ TEST_F(LeastRequestLoadBalancerTest, WeightImbalance) {
   cluster_.hosts_ = cluster_.healthy_hosts_;
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
       .WillRepeatedly(Return(50));
-
   EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.weight_enabled", 1))
       .WillRepeatedly(Return(1));
-  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
-      .WillRepeatedly(Return(50));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.least_request.choice_count", 2))
+      .WillRepeatedly(Return(2));
 
-  // As max weight higher then 1 we do random host pick and keep it for weight requests.
-  EXPECT_CALL(random_, random()).WillOnce(Return(1));
+  // Both hosts idle, the heavier host wins regardless of pick order.
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
+  EXPECT_CALL(random_, random()).WillOnce(Return(1)).WillOnce(Return(0));
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 
-  // Same host stays as we have to hit it 3 times.
-  cluster_.healthy_hosts_[0]->stats().rq_active_.set(2);
-  cluster_.healthy_hosts_[1]->stats().rq_active_.set(1);
-  EXPECT_CALL(random_, random()).Times(0);
+  // The heavier host still wins with twice the active requests of the lighter one.
+  cluster_.healthy_hosts_[0]->stats().rq_active_.set(1);
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(2);
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 
-  // Same host stays as we have to hit it 3 times.
-  EXPECT_CALL(random_, random()).Times(0);
+  // Equal load per unit of weight (2 / 1 vs. 6 / 3), the second pick wins the tie.
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(5);
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
+  EXPECT_CALL(random_, random()).WillOnce(Return(1)).WillOnce(Return(0));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
 
-  // Get random host after previous one was selected 3 times in a row.
-  EXPECT_CALL(random_, random()).WillOnce(Return(2));
+  // Past three times the active requests the lighter host wins.
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(6);
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
 
-  // Select second host again.
-  EXPECT_CALL(random_, random()).WillOnce(Return(1));
-  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
+  // Set weight to 1, we compare raw active requests.
+  stats_.max_host_weight_.set(1UL);
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(2);
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+}
 
-  // Set weight to 1, we will switch to the two random hosts mode.
+TEST_F(LeastRequestLoadBalancerTest, ChoiceCount) {
+  cluster_.healthy_hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
+                             newTestHost(cluster_.info_, "tcp://127.0.0.1:81"),
+                             newTestHost(cluster_.info_, "tcp://127.0.0.1:82")};
   stats_.max_host_weight_.set(1UL);
-  EXPECT_CALL(random_, random()).WillOnce(Return(2)).WillOnce(Return(3));
+  cluster_.hosts_ = cluster_.healthy_hosts_;
+  cluster_.healthy_hosts_[0]->stats().rq_active_.set(3);
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(1);
+  cluster_.healthy_hosts_[2]->stats().rq_active_.set(2);
+
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.healthy_panic_threshold", 50))
+      .WillRepeatedly(Return(50));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.least_request.choice_count", 2))
+      .WillOnce(Return(3))
+      .WillOnce(Return(1))
+      .WillOnce(Return(0));
+
+  // Three choices, the least loaded of all three wins.
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1)).WillOnce(Return(2));
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 
-  EXPECT_CALL(random_, random()).WillOnce(Return(2)).WillOnce(Return(2));
+  // One choice degenerates to random.
+  EXPECT_CALL(random_, random()).WillOnce(Return(0));
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+
+  // Zero is treated as one choice.
+  EXPECT_CALL(random_, random()).WillOnce(Return(2));
+  EXPECT_EQ(cluster_.healthy_hosts_[2], lb_.chooseHost(nullptr));
 }
 
-TEST_F(LeastRequestLoadBalancerTest, WeightImbalanceCallbacks) {
-  cluster_.healthy_hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80", 1),
-                             newTestHost(cluster_.info_, "tcp://127.0.0.1:81", 3)};
-  stats_.max_host_weight_.set(3UL);
+class PeakEwmaLoadBalancerTest : public testing::Test {
+public:
+  PeakEwmaLoadBalancerTest() : stats_(ClusterInfoImpl::generateStats(stats_store_)) {
+    ON_CALL(time_source_, currentTime()).WillByDefault(ReturnPointee(&now_));
+    cluster_.healthy_hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
+                               newTestHost(cluster_.info_, "tcp://127.0.0.1:81")};
+    cluster_.hosts_ = cluster_.healthy_hosts_;
+  }
 
-  cluster_.hosts_ = cluster_.healthy_hosts_;
+  NiceMock<MockCluster> cluster_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<Runtime::MockRandomGenerator> random_;
+  NiceMock<MockMonotonicTimeSource> time_source_;
+  MonotonicTime now_;
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_;
+  PeakEwmaLoadBalancer lb_{cluster_, nullptr, stats_, runtime_, random_, time_source_};
+};
 
-  EXPECT_CALL(random_, random()).WillOnce(Return(1));
+TEST_F(PeakEwmaLoadBalancerTest, NoHosts) {
+  cluster_.healthy_hosts_.clear();
+  cluster_.hosts_.clear();
+  EXPECT_EQ(nullptr, lb_.chooseHost(nullptr));
+}
+
+TEST_F(PeakEwmaLoadBalancerTest, Normal) {
+  // No response times yet and no active requests, the second pick wins the tie.
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
   EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 
-  // Same host stays as we have to hit it 3 times, but we remove it and fire callback.
-  std::vector<HostSharedPtr> empty;
-  std::vector<HostSharedPtr> hosts_removed;
-  hosts_removed.push_back(cluster_.hosts_[1]);
-  cluster_.hosts_.erase(cluster_.hosts_.begin() + 1);
-  cluster_.healthy_hosts_.erase(cluster_.healthy_hosts_.begin() + 1);
-  cluster_.runCallbacks(empty, hosts_removed);
+  lb_.onResponseTime(*cluster_.healthy_hosts_[0], std::chrono::milliseconds(10));
+  lb_.onResponseTime(*cluster_.healthy_hosts_[1], std::chrono::milliseconds(50));
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+  EXPECT_CALL(random_, random()).WillOnce(Return(1)).WillOnce(Return(0));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+
+  // Cost is latency times active requests plus one: 10 * 6 against 50 * 1.
+  cluster_.healthy_hosts_[0]->stats().rq_active_.set(5);
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
 
-  EXPECT_CALL(random_, random()).WillOnce(Return(1));
+  // A slower response replaces the average right away.
+  cluster_.healthy_hosts_[0]->stats().rq_active_.set(0);
+  lb_.onResponseTime(*cluster_.healthy_hosts_[0], std::chrono::milliseconds(100));
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
+}
+
+TEST_F(PeakEwmaLoadBalancerTest, NoResponseTimePenalty) {
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  lb_.chooseHost(nullptr);
+
+  // A host without a response time but with active requests costs more than a known slow host.
+  lb_.onResponseTime(*cluster_.healthy_hosts_[0], std::chrono::milliseconds(1000));
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[1], lb_.chooseHost(nullptr));
+
+  cluster_.healthy_hosts_[1]->stats().rq_active_.set(1);
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+}
+
+TEST_F(PeakEwmaLoadBalancerTest, Decay) {
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  lb_.chooseHost(nullptr);
+  lb_.onResponseTime(*cluster_.healthy_hosts_[0], std::chrono::milliseconds(100));
+
+  // After one decay period (10s by default) the 100ms peak has decayed to about 37ms, below the
+  // 50ms just seen from the other host.
+  now_ += std::chrono::milliseconds(10000);
+  lb_.onResponseTime(*cluster_.healthy_hosts_[1], std::chrono::milliseconds(50));
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
+}
+
+TEST_F(PeakEwmaLoadBalancerTest, RemovedHost) {
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
+  lb_.chooseHost(nullptr);
+  lb_.onResponseTime(*cluster_.healthy_hosts_[0], std::chrono::milliseconds(100));
+  lb_.onResponseTime(*cluster_.healthy_hosts_[1], std::chrono::milliseconds(50));
+
+  // The latency of a removed host is dropped, and a late response does not bring it back.
+  std::vector<HostSharedPtr> empty;
+  cluster_.runCallbacks(empty, {cluster_.healthy_hosts_[0]});
+  lb_.onResponseTime(*cluster_.healthy_hosts_[0], std::chrono::milliseconds(1000));
+  EXPECT_CALL(random_, random()).WillOnce(Return(0)).WillOnce(Return(1));
   EXPECT_EQ(cluster_.healthy_hosts_[0], lb_.chooseHost(nullptr));
 }
 
@@ -22,6 +22,7 @@
 namespace Envoy {
 using testing::Invoke;
 using testing::NiceMock;
+using testing::Return;
 using testing::_;
 
 namespace Upstream {
@@ -235,5 +236,120 @@ TEST_F(LogicalDnsClusterTest, Basic) {
   tls_.shutdownThread();
 }
 
+// Connections to the same resolved address share a host description, which is kept while the
+// address stays in the resolution.
+TEST_F(LogicalDnsClusterTest, HostDescriptionReuse) {
+  const std::string json = R"EOF(
+  {
+    "name": "name",
+    "connect_timeout_ms": 250,
+    "type": "logical_dns",
+    "lb_type": "round_robin",
+    "hosts": [{"url": "tcp://foo.bar.com:443"}]
+  }
+  )EOF";
+
+  expectResolve(Network::DnsLookupFamily::V4Only);
+  setup(json);
+
+  EXPECT_CALL(membership_updated_, ready());
+  EXPECT_CALL(initialized_, ready());
+  EXPECT_CALL(*resolve_timer_, enableTimer(_));
+  dns_callback_(TestUtility::makeDnsResponse({"127.0.0.1", "127.0.0.2"}));
+  HostSharedPtr logical_host = cluster_->hosts()[0];
+
+  EXPECT_CALL(dispatcher_, createClientConnection_(_, _))
+      .WillRepeatedly(Invoke([](Network::Address::InstanceConstSharedPtr,
+                                Network::Address::InstanceConstSharedPtr) {
+        return new NiceMock<Network::MockClientConnection>();
+      }));
+  HostDescriptionConstSharedPtr first =
+      logical_host->createConnection(dispatcher_).host_description_;
+  EXPECT_EQ(first, logical_host->createConnection(dispatcher_).host_description_);
+
+  expectResolve(Network::DnsLookupFamily::V4Only);
+  resolve_timer_->callback_();
+  EXPECT_CALL(*resolve_timer_, enableTimer(_));
+  dns_callback_(TestUtility::makeDnsResponse({"127.0.0.2", "127.0.0.1"}));
+  HostDescriptionConstSharedPtr second =
+      logical_host->createConnection(dispatcher_).host_description_;
+  EXPECT_NE(first, second);
+  EXPECT_EQ("127.0.0.2:443", second->address()->asString());
+
+  // 127.0.0.1 is still resolved, so its description comes back.
+  expectResolve(Network::DnsLookupFamily::V4Only);
+  resolve_timer_->callback_();
+  EXPECT_CALL(*resolve_timer_, enableTimer(_));
+  dns_callback_(TestUtility::makeDnsResponse({"127.0.0.1", "127.0.0.3"}));
+  EXPECT_EQ(first, logical_host->createConnection(dispatcher_).host_description_);
+
+  // 127.0.0.2 dropped out of the previous resolution, so it gets a new description.
+  expectResolve(Network::DnsLookupFamily::V4Only);
+  resolve_timer_->callback_();
+  EXPECT_CALL(*resolve_timer_, enableTimer(_));
+  dns_callback_(TestUtility::makeDnsResponse({"127.0.0.2"}));
+  HostDescriptionConstSharedPtr third =
+      logical_host->createConnection(dispatcher_).host_description_;
+  EXPECT_NE(second, third);
+  EXPECT_EQ("127.0.0.2:443", third->address()->asString());
+
+  tls_.shutdownThread();
+}
+
+// With both families resolved, connections to the first address fall back to the first address
+// of the other family.
+TEST_F(LogicalDnsClusterTest, HappyEyeballs) {
+  const std::string json = R"EOF(
+  {
+    "name": "name",
+    "connect_timeout_ms": 250,
+    "type": "logical_dns",
+    "lb_type": "round_robin",
+    "dns_lookup_family": "auto",
+    "hosts": [{"url": "tcp://foo.bar.com:443"}]
+  }
+  )EOF";
+
+  expectResolve(Network::DnsLookupFamily::Auto);
+  setup(json);
+
+  EXPECT_CALL(membership_updated_, ready());
+  EXPECT_CALL(initialized_, ready());
+  EXPECT_CALL(*resolve_timer_, enableTimer(_));
+  dns_callback_(TestUtility::makeDnsResponse({"::1", "::2", "127.0.0.1"}));
+  HostSharedPtr logical_host = cluster_->hosts()[0];
+
+  NiceMock<Network::MockClientConnection>* connection =
+      new NiceMock<Network::MockClientConnection>();
+  EXPECT_CALL(dispatcher_, createClientConnection_(
+                               PointeesEq(Network::Utility::resolveUrl("tcp://[::1]:443")), _))
+      .WillOnce(Return(connection));
+  EXPECT_CALL(*connection,
+              enableHappyEyeballs(PointeesEq(Network::Utility::resolveUrl("tcp://127.0.0.1:443")),
+                                  std::chrono::milliseconds(250)));
+  logical_host->createConnection(dispatcher_);
+
+  // The runtime can turn it off.
+  connection = new NiceMock<Network::MockClientConnection>();
+  EXPECT_CALL(dispatcher_, createClientConnection_(_, _)).WillOnce(Return(connection));
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.happy_eyeballs_delay_ms.name", 250))
+      .WillOnce(Return(0));
+  EXPECT_CALL(*connection, enableHappyEyeballs(_, _)).Times(0);
+  logical_host->createConnection(dispatcher_);
+
+  // Without addresses of the other family there is nothing to fall back to.
+  expectResolve(Network::DnsLookupFamily::Auto);
+  resolve_timer_->callback_();
+  EXPECT_CALL(*resolve_timer_, enableTimer(_));
+  dns_callback_(TestUtility::makeDnsResponse({"::1"}));
+
+  connection = new NiceMock<Network::MockClientConnection>();
+  EXPECT_CALL(dispatcher_, createClientConnection_(_, _)).WillOnce(Return(connection));
+  EXPECT_CALL(*connection, enableHappyEyeballs(_, _)).Times(0);
+  logical_host->createConnection(dispatcher_);
+
+  tls_.shutdownThread();
+}
+
 } // namespace Upstream
 } // namespace Envoy
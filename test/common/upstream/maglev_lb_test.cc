@@ -0,0 +1,195 @@
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/network/utility.h"
+#include "common/upstream/maglev_lb.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "spdlog/spdlog.h"
+
+namespace Envoy {
+using testing::NiceMock;
+using testing::Return;
+
+namespace Upstream {
+
+static HostSharedPtr newTestHost(Upstream::ClusterInfoConstSharedPtr cluster,
+                                 const std::string& url) {
+  return std::make_shared<HostImpl>(cluster, "", Network::Utility::resolveUrl(url), false, 1, "");
+}
+
+class TestLoadBalancerContext : public LoadBalancerContext {
+public:
+  TestLoadBalancerContext(uint64_t hash_key) : hash_key_(hash_key) {}
+
+  // Upstream::LoadBalancerContext
+  Optional<uint64_t> hashKey() const override { return hash_key_; }
+  const Network::Connection* downstreamConnection() const override { return nullptr; }
+  const MetadataMatchCriteria* metadataMatchCriteria() const override { return nullptr; }
+
+  Optional<uint64_t> hash_key_;
+};
+
+class MaglevLoadBalancerTest : public testing::Test {
+public:
+  MaglevLoadBalancerTest() : stats_(ClusterInfoImpl::generateStats(stats_store_)) {}
+
+  void init(uint64_t table_size) {
+    lb_.reset(new MaglevLoadBalancer(cluster_, stats_, runtime_, random_, table_size));
+  }
+
+  std::string chooseAddress(uint64_t hash) {
+    TestLoadBalancerContext context(hash);
+    return lb_->chooseHost(&context)->address()->asString();
+  }
+
+  NiceMock<MockCluster> cluster_;
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<Runtime::MockRandomGenerator> random_;
+  std::unique_ptr<MaglevLoadBalancer> lb_;
+};
+
+TEST_F(MaglevLoadBalancerTest, NoHost) {
+  init(7);
+  EXPECT_EQ(nullptr, lb_->chooseHost(nullptr));
+};
+
+TEST_F(MaglevLoadBalancerTest, Basic) {
+  // The order of the hosts does not matter.
+  cluster_.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:93"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:91"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:90"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:92")};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  // Rounded up to a table size of 7.
+  init(6);
+
+  // This is the table built using xxHash64.
+  // maglev: slot=0 host=127.0.0.1:92
+  // maglev: slot=1 host=127.0.0.1:91
+  // maglev: slot=2 host=127.0.0.1:90
+  // maglev: slot=3 host=127.0.0.1:91
+  // maglev: slot=4 host=127.0.0.1:90
+  // maglev: slot=5 host=127.0.0.1:92
+  // maglev: slot=6 host=127.0.0.1:93
+  EXPECT_EQ("127.0.0.1:92", chooseAddress(0));
+  EXPECT_EQ("127.0.0.1:91", chooseAddress(3));
+  EXPECT_EQ("127.0.0.1:93", chooseAddress(6));
+  EXPECT_EQ("127.0.0.1:92", chooseAddress(7));
+  {
+    EXPECT_CALL(random_, random()).WillOnce(Return(13));
+    EXPECT_EQ("127.0.0.1:93", lb_->chooseHost(nullptr)->address()->asString());
+  }
+
+  // In panic mode all hosts are used.
+  cluster_.healthy_hosts_.clear();
+  cluster_.runCallbacks({}, {});
+  EXPECT_EQ("127.0.0.1:92", chooseAddress(0));
+}
+
+TEST_F(MaglevLoadBalancerTest, HostChange) {
+  cluster_.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:90"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:91")};
+  init(7);
+
+  // maglev: slot=0 host=127.0.0.1:90
+  // maglev: slot=1 host=127.0.0.1:91
+  // maglev: slot=2 host=127.0.0.1:90
+  // maglev: slot=3 host=127.0.0.1:91
+  // maglev: slot=4 host=127.0.0.1:90
+  // maglev: slot=5 host=127.0.0.1:91
+  // maglev: slot=6 host=127.0.0.1:90
+  EXPECT_EQ("127.0.0.1:90", chooseAddress(0));
+  EXPECT_EQ("127.0.0.1:91", chooseAddress(1));
+
+  cluster_.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:91"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:92")};
+  cluster_.runCallbacks({}, {});
+
+  // The slots of 127.0.0.1:91 stay with it.
+  // maglev: slot=0 host=127.0.0.1:92
+  // maglev: slot=1 host=127.0.0.1:91
+  // maglev: slot=2 host=127.0.0.1:91
+  // maglev: slot=3 host=127.0.0.1:91
+  // maglev: slot=4 host=127.0.0.1:92
+  // maglev: slot=5 host=127.0.0.1:91
+  // maglev: slot=6 host=127.0.0.1:92
+  EXPECT_EQ("127.0.0.1:92", chooseAddress(0));
+  EXPECT_EQ("127.0.0.1:91", chooseAddress(1));
+  EXPECT_EQ("127.0.0.1:91", chooseAddress(3));
+  EXPECT_EQ("127.0.0.1:91", chooseAddress(5));
+}
+
+// Validate that load balancers adopt the tables supplied with an update rather than building their
+// own, and build their own when none are supplied. The supplied tables are built from other hosts
+// than the load balancers', so that it shows which tables a load balancer uses.
+TEST_F(MaglevLoadBalancerTest, PrebuiltTables) {
+  NiceMock<MockCluster> other_host_set;
+  other_host_set.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:90"),
+                           newTestHost(cluster_.info_, "tcp://127.0.0.1:91")};
+  other_host_set.healthy_hosts_ = other_host_set.hosts_;
+  cluster_.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:91"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:92")};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  MaglevLoadBalancer::TablesConstSharedPtr tables;
+  MaglevLoadBalancer::PrebuiltTablesCb prebuilt_tables = [&tables]() { return tables; };
+
+  // The tables are the ones in HostChange.
+  lb_.reset(new MaglevLoadBalancer(cluster_, stats_, runtime_, random_, 7, prebuilt_tables));
+  EXPECT_EQ("127.0.0.1:92", chooseAddress(0));
+
+  tables = std::make_shared<MaglevLoadBalancer::Tables>(other_host_set, 7);
+  MaglevLoadBalancer other_lb(cluster_, stats_, runtime_, random_, 7, prebuilt_tables);
+  cluster_.runCallbacks({}, {});
+  EXPECT_EQ("127.0.0.1:90", chooseAddress(0));
+  TestLoadBalancerContext context(0);
+  EXPECT_EQ(lb_->chooseHost(&context), other_lb.chooseHost(&context));
+
+  // The tables of an earlier update are not kept when a later update supplies none.
+  tables = nullptr;
+  cluster_.runCallbacks({}, {});
+  EXPECT_EQ("127.0.0.1:92", chooseAddress(0));
+}
+
+// With the default table size, hosts own near equal shares of the table and removing a host moves
+// few slots between the other hosts.
+TEST_F(MaglevLoadBalancerTest, BalanceAndDisruption) {
+  for (uint64_t i = 0; i < 10; i++) {
+    cluster_.hosts_.push_back(newTestHost(cluster_.info_, fmt::format("tcp://10.0.0.{}:80", i)));
+  }
+  init(MaglevLoadBalancer::DEFAULT_TABLE_SIZE);
+
+  std::vector<std::string> before;
+  std::unordered_map<std::string, uint64_t> slots;
+  for (uint64_t i = 0; i < MaglevLoadBalancer::DEFAULT_TABLE_SIZE; i++) {
+    before.push_back(chooseAddress(i));
+    slots[before.back()]++;
+  }
+  EXPECT_EQ(10U, slots.size());
+  for (const auto& host_slots : slots) {
+    EXPECT_GE(host_slots.second, 6553U);
+    EXPECT_LE(host_slots.second, 6554U);
+  }
+
+  cluster_.hosts_.erase(cluster_.hosts_.begin());
+  cluster_.runCallbacks({}, {});
+  uint64_t moved = 0;
+  for (uint64_t i = 0; i < MaglevLoadBalancer::DEFAULT_TABLE_SIZE; i++) {
+    if (before[i] != "10.0.0.0:80" && chooseAddress(i) != before[i]) {
+      moved++;
+    }
+  }
+  EXPECT_EQ(157U, moved);
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -38,6 +38,7 @@ public:
   // Upstream::LoadBalancerContext
   Optional<uint64_t> hashKey() const override { return 0; }
   const Network::Connection* downstreamConnection() const override { return connection_; }
+  const MetadataMatchCriteria* metadataMatchCriteria() const override { return nullptr; }
 
   Optional<uint64_t> hash_key_;
   const Network::Connection* connection_;
@@ -142,7 +143,7 @@ TEST_F(OriginalDstClusterTest, NoContext) {
   // No downstream connection => no host.
   {
     TestLoadBalancerContext lb_context(nullptr);
-    OriginalDstCluster::LoadBalancer lb(*cluster_, cluster_);
+    OriginalDstCluster::LoadBalancer lb(cluster_);
     EXPECT_CALL(dispatcher_, post(_)).Times(0);
     HostConstSharedPtr host = lb.chooseHost(&lb_context);
     EXPECT_EQ(host, nullptr);
@@ -154,10 +155,7 @@ TEST_F(OriginalDstClusterTest, NoContext) {
     TestLoadBalancerContext lb_context(&connection);
 
     EXPECT_CALL(connection, usingOriginalDst()).WillOnce(Return(false));
-    // First argument is normally the reference to the ThreadLocalCluster's HostSet, but in these
-    // tests we do not have the thread local clusters, so we pass a reference to the HostSet of the
-    // primary cluster.  The implementation handles both cases the same.
-    OriginalDstCluster::LoadBalancer lb(*cluster_, cluster_);
+    OriginalDstCluster::LoadBalancer lb(cluster_);
     EXPECT_CALL(dispatcher_, post(_)).Times(0);
     HostConstSharedPtr host = lb.chooseHost(&lb_context);
     EXPECT_EQ(host, nullptr);
@@ -171,7 +169,7 @@ TEST_F(OriginalDstClusterTest, NoContext) {
     EXPECT_CALL(connection, localAddress()).WillRepeatedly(ReturnRef(local_address));
     EXPECT_CALL(connection, usingOriginalDst()).WillRepeatedly(Return(true));
 
-    OriginalDstCluster::LoadBalancer lb(*cluster_, cluster_);
+    OriginalDstCluster::LoadBalancer lb(cluster_);
     EXPECT_CALL(dispatcher_, post(_)).Times(0);
     HostConstSharedPtr host = lb.chooseHost(&lb_context);
     EXPECT_EQ(host, nullptr);
@@ -207,7 +205,7 @@ TEST_F(OriginalDstClusterTest, Membership) {
   EXPECT_CALL(connection, localAddress()).WillRepeatedly(ReturnRef(local_address));
   EXPECT_CALL(connection, usingOriginalDst()).WillRepeatedly(Return(true));
 
-  OriginalDstCluster::LoadBalancer lb(*cluster_, cluster_);
+  OriginalDstCluster::LoadBalancer lb(cluster_);
   Event::PostCb post_cb;
   EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
   HostConstSharedPtr host = lb.chooseHost(&lb_context);
@@ -231,15 +229,19 @@ TEST_F(OriginalDstClusterTest, Membership) {
 
   // Make host time out, no membership changes happen on the first timeout.
   ASSERT_EQ(1UL, cluster_->hosts().size());
-  EXPECT_EQ(true, cluster_->hosts()[0]->used());
   EXPECT_CALL(*cleanup_timer_, enableTimer(_));
   cleanup_timer_->callback_();
   EXPECT_EQ(cluster_hosts, cluster_->hosts()); // hosts vector remains the same
 
-  // host gets removed on the 2nd timeout.
-  ASSERT_EQ(1UL, cluster_->hosts().size());
-  EXPECT_EQ(false, cluster_->hosts()[0]->used());
+  // Using the host keeps it for another interval.
+  EXPECT_CALL(dispatcher_, post(_)).Times(0);
+  EXPECT_EQ(host, lb.chooseHost(&lb_context));
+  EXPECT_CALL(*cleanup_timer_, enableTimer(_));
+  cleanup_timer_->callback_();
+  EXPECT_EQ(cluster_hosts, cluster_->hosts());
 
+  // host gets removed on the timeout after an interval without use.
+  ASSERT_EQ(1UL, cluster_->hosts().size());
   EXPECT_CALL(*cleanup_timer_, enableTimer(_));
   EXPECT_CALL(membership_updated_, ready());
   cleanup_timer_->callback_();
@@ -294,7 +296,7 @@ TEST_F(OriginalDstClusterTest, Membership2) {
   EXPECT_CALL(connection2, localAddress()).WillRepeatedly(ReturnRef(local_address2));
   EXPECT_CALL(connection2, usingOriginalDst()).WillRepeatedly(Return(true));
 
-  OriginalDstCluster::LoadBalancer lb(*cluster_, cluster_);
+  OriginalDstCluster::LoadBalancer lb(cluster_);
 
   EXPECT_CALL(membership_updated_, ready());
   Event::PostCb post_cb;
@@ -326,23 +328,88 @@ TEST_F(OriginalDstClusterTest, Membership2) {
 
   // Make hosts time out, no membership changes happen on the first timeout.
   ASSERT_EQ(2UL, cluster_->hosts().size());
-  EXPECT_EQ(true, cluster_->hosts()[0]->used());
-  EXPECT_EQ(true, cluster_->hosts()[1]->used());
   EXPECT_CALL(*cleanup_timer_, enableTimer(_));
   cleanup_timer_->callback_();
   EXPECT_EQ(cluster_hosts, cluster_->hosts()); // hosts vector remains the same
 
-  // both hosts get removed on the 2nd timeout.
-  ASSERT_EQ(2UL, cluster_->hosts().size());
-  EXPECT_EQ(false, cluster_->hosts()[0]->used());
-  EXPECT_EQ(false, cluster_->hosts()[1]->used());
+  // Only the host that is used again is kept on the 2nd timeout.
+  EXPECT_EQ(host2, lb.chooseHost(&lb_context2));
+  EXPECT_CALL(*cleanup_timer_, enableTimer(_));
+  EXPECT_CALL(membership_updated_, ready());
+  cleanup_timer_->callback_();
+  ASSERT_EQ(1UL, cluster_->hosts().size());
+  EXPECT_EQ(host2, cluster_->hosts()[0]);
 
+  // Both hosts are gone after the 3rd timeout.
   EXPECT_CALL(*cleanup_timer_, enableTimer(_));
   EXPECT_CALL(membership_updated_, ready());
   cleanup_timer_->callback_();
-  EXPECT_NE(cluster_hosts, cluster_->hosts()); // hosts vector changes
+  EXPECT_EQ(0UL, cluster_->hosts().size());
+}
+
+TEST_F(OriginalDstClusterTest, BatchedMembership) {
+  std::string json = R"EOF(
+  {
+    "name": "name",
+    "connect_timeout_ms": 1250,
+    "type": "original_dst",
+    "lb_type": "original_dst_lb"
+  }
+  )EOF";
+
+  EXPECT_CALL(initialized_, ready());
+  EXPECT_CALL(*cleanup_timer_, enableTimer(_));
+  setup(json);
+
+  NiceMock<Network::MockConnection> connection1;
+  TestLoadBalancerContext lb_context1(&connection1);
+  Network::Address::Ipv4Instance local_address1("10.10.11.11", 80);
+  EXPECT_CALL(connection1, localAddress()).WillRepeatedly(ReturnRef(local_address1));
+  EXPECT_CALL(connection1, usingOriginalDst()).WillRepeatedly(Return(true));
 
+  // Same address on another port.
+  NiceMock<Network::MockConnection> connection2;
+  TestLoadBalancerContext lb_context2(&connection2);
+  Network::Address::Ipv4Instance local_address2("10.10.11.11", 81);
+  EXPECT_CALL(connection2, localAddress()).WillRepeatedly(ReturnRef(local_address2));
+  EXPECT_CALL(connection2, usingOriginalDst()).WillRepeatedly(Return(true));
+
+  OriginalDstCluster::LoadBalancer lb(cluster_);
+
+  // Hosts that are created before the main thread runs the post are added in one update.
+  Event::PostCb post_cb;
+  EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
+  HostConstSharedPtr host1 = lb.chooseHost(&lb_context1);
+  HostConstSharedPtr host2 = lb.chooseHost(&lb_context2);
+  ASSERT_NE(host1, nullptr);
+  ASSERT_NE(host2, nullptr);
+  EXPECT_NE(host1, host2);
+  EXPECT_EQ(local_address2, *host2->address());
   EXPECT_EQ(0UL, cluster_->hosts().size());
+
+  EXPECT_CALL(membership_updated_, ready());
+  post_cb();
+  EXPECT_EQ(2UL, cluster_->hosts().size());
+
+  // Hosts that are still pending when the cleanup timer fires are added first.
+  NiceMock<Network::MockConnection> connection3;
+  TestLoadBalancerContext lb_context3(&connection3);
+  Network::Address::Ipv6Instance local_address3("FD00::1", 80);
+  EXPECT_CALL(connection3, localAddress()).WillRepeatedly(ReturnRef(local_address3));
+  EXPECT_CALL(connection3, usingOriginalDst()).WillRepeatedly(Return(true));
+
+  EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
+  HostConstSharedPtr host3 = lb.chooseHost(&lb_context3);
+  EXPECT_CALL(membership_updated_, ready());
+  EXPECT_CALL(*cleanup_timer_, enableTimer(_));
+  cleanup_timer_->callback_();
+  ASSERT_EQ(3UL, cluster_->hosts().size());
+  EXPECT_EQ(host3, cluster_->hosts()[2]);
+
+  // The post finds nothing left to add.
+  EXPECT_CALL(membership_updated_, ready()).Times(0);
+  post_cb();
+  EXPECT_EQ(3UL, cluster_->hosts().size());
 }
 
 TEST_F(OriginalDstClusterTest, Connection) {
@@ -373,7 +440,7 @@ TEST_F(OriginalDstClusterTest, Connection) {
   EXPECT_CALL(connection, localAddress()).WillRepeatedly(ReturnRef(local_address));
   EXPECT_CALL(connection, usingOriginalDst()).WillRepeatedly(Return(true));
 
-  OriginalDstCluster::LoadBalancer lb(*cluster_, cluster_);
+  OriginalDstCluster::LoadBalancer lb(cluster_);
   Event::PostCb post_cb;
   EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
   HostConstSharedPtr host = lb.chooseHost(&lb_context);
@@ -421,15 +488,18 @@ TEST_F(OriginalDstClusterTest, MultipleClusters) {
   EXPECT_CALL(connection, localAddress()).WillRepeatedly(ReturnRef(local_address));
   EXPECT_CALL(connection, usingOriginalDst()).WillRepeatedly(Return(true));
 
-  OriginalDstCluster::LoadBalancer lb1(*cluster_, cluster_);
-  OriginalDstCluster::LoadBalancer lb2(second, cluster_);
+  OriginalDstCluster::LoadBalancer lb1(cluster_);
+  OriginalDstCluster::LoadBalancer lb2(cluster_);
   Event::PostCb post_cb;
   EXPECT_CALL(dispatcher_, post(_)).WillOnce(SaveArg<0>(&post_cb));
   HostConstSharedPtr host = lb1.chooseHost(&lb_context);
-  post_cb();
   ASSERT_NE(host, nullptr);
   EXPECT_EQ(local_address, *host->address());
 
+  // lb2 uses the host of lb1 right away, without posting it again.
+  EXPECT_EQ(host, lb2.chooseHost(&lb_context));
+  post_cb();
+
   EXPECT_EQ(1UL, cluster_->hosts().size());
   // Check that lb2 also gets updated
   EXPECT_EQ(1UL, second.hosts().size());
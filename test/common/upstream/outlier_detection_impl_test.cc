@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "envoy/common/optional.h"
@@ -516,6 +517,38 @@ TEST_F(OutlierDetectorImplTest, Consecutive5xxAlreadyEjected) {
   loadRq(cluster_.hosts_[0], 5, 503);
 }
 
+TEST_F(OutlierDetectorImplTest, Consecutive5xxRuntimeThreshold) {
+  EXPECT_CALL(cluster_, addMemberUpdateCb(_));
+  cluster_.hosts_ = {HostSharedPtr{new HostImpl(
+      cluster_.info_, "", Network::Utility::resolveUrl("tcp://127.0.0.1:80"), false, 1, "")}};
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  std::shared_ptr<DetectorImpl> detector(DetectorImpl::create(
+      cluster_, empty_outlier_detection_, dispatcher_, runtime_, time_source_, event_logger_));
+  detector->addChangedStateCb([&](HostSharedPtr host) -> void { checker_.check(host); });
+
+  // A runtime change of the threshold only applies from the next interval.
+  ON_CALL(runtime_.snapshot_, getInteger("outlier_detection.consecutive_5xx", 5))
+      .WillByDefault(Return(3));
+  loadRq(cluster_.hosts_[0], 3, 503);
+  EXPECT_FALSE(cluster_.hosts_[0]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+  loadRq(cluster_.hosts_[0], 1, 200);
+
+  EXPECT_CALL(time_source_, currentTime())
+      .WillOnce(Return(MonotonicTime(std::chrono::milliseconds(10000))));
+  EXPECT_CALL(*interval_timer_, enableTimer(std::chrono::milliseconds(10000)));
+  interval_timer_->callback_();
+
+  loadRq(cluster_.hosts_[0], 2, 503);
+  EXPECT_CALL(time_source_, currentTime())
+      .WillOnce(Return(MonotonicTime(std::chrono::milliseconds(10001))));
+  EXPECT_CALL(checker_, check(cluster_.hosts_[0]));
+  EXPECT_CALL(*event_logger_,
+              logEject(std::static_pointer_cast<const HostDescription>(cluster_.hosts_[0]), _,
+                       EjectionType::Consecutive5xx, true));
+  loadRq(cluster_.hosts_[0], 1, 503);
+  EXPECT_TRUE(cluster_.hosts_[0]->healthFlagGet(Host::HealthFlag::FAILED_OUTLIER_CHECK));
+}
+
 TEST(DetectorHostMonitorNullImplTest, All) {
   DetectorHostMonitorNullImpl null_sink;
 
@@ -592,6 +625,32 @@ TEST(OutlierDetectionEventLoggerImplTest, All) {
   Json::Factory::loadFromString(log4);
 }
 
+TEST(OutlierSuccessRateAccumulatorTest, MultipleThreads) {
+  SuccessRateAccumulator accumulator;
+  SuccessRateAccumulatorBucket* bucket = accumulator.updateCurrentWriter();
+
+  // More threads than shards, so that some threads share a shard.
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < 10; i++) {
+    threads.emplace_back([bucket]() -> void {
+      for (uint32_t j = 0; j < 100; j++) {
+        bucket->putRequest(j % 4 != 0);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  accumulator.updateCurrentWriter();
+  EXPECT_EQ(75.0, accumulator.getSuccessRate(1000).value());
+  EXPECT_FALSE(accumulator.getSuccessRate(1001).valid());
+
+  // The next window starts out empty.
+  accumulator.updateCurrentWriter();
+  EXPECT_FALSE(accumulator.getSuccessRate(1).valid());
+}
+
 TEST(OutlierUtility, SRThreshold) {
   std::vector<HostSuccessRatePair> data = {
       HostSuccessRatePair(nullptr, 50),  HostSuccessRatePair(nullptr, 100),
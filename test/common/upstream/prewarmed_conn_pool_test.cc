@@ -0,0 +1,123 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "common/upstream/prewarmed_conn_pool.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/network/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Upstream {
+
+class PrewarmedConnPoolTest : public testing::Test {
+public:
+  PrewarmedConnPoolTest() {
+    refill_timer_ = new NiceMock<Event::MockTimer>(&dispatcher_);
+    pool_.reset(new PrewarmedConnPool(dispatcher_, cluster_, lb_));
+  }
+
+  NiceMock<Network::MockClientConnection>* expectConnection() {
+    NiceMock<Network::MockClientConnection>* connection =
+        new NiceMock<Network::MockClientConnection>();
+    EXPECT_CALL(*lb_.host_, createConnection_(_))
+        .WillOnce(Return(MockHost::MockCreateConnectionData{connection, lb_.host_}))
+        .RetiresOnSaturation();
+    EXPECT_CALL(*connection, connect());
+    return connection;
+  }
+
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  std::shared_ptr<NiceMock<MockClusterInfo>> cluster_{new NiceMock<MockClusterInfo>()};
+  NiceMock<MockLoadBalancer> lb_;
+  NiceMock<Event::MockTimer>* refill_timer_;
+  std::unique_ptr<PrewarmedConnPool> pool_;
+};
+
+// Nothing is prewarmed by default.
+TEST_F(PrewarmedConnPoolTest, Disabled) {
+  EXPECT_CALL(*lb_.host_, createConnection_(_)).Times(0);
+  pool_->refill();
+  EXPECT_EQ(nullptr, pool_->claim().connection_);
+}
+
+// Only connected connections are claimed, and claims are replaced in the background.
+TEST_F(PrewarmedConnPoolTest, Claim) {
+  cluster_->prewarmed_tcp_connections_ = 2;
+  NiceMock<Network::MockClientConnection>* connection1 = expectConnection();
+  NiceMock<Network::MockClientConnection>* connection2 = expectConnection();
+  pool_->refill();
+
+  // Nothing is connected yet.
+  EXPECT_EQ(nullptr, pool_->claim().connection_);
+
+  EXPECT_CALL(*connection2, readDisable(true));
+  connection2->raiseEvent(Network::ConnectionEvent::Connected);
+
+  EXPECT_CALL(*connection2, removeConnectionCallbacks(_));
+  EXPECT_CALL(*connection2, readDisable(false));
+  EXPECT_CALL(*refill_timer_, enableTimer(std::chrono::milliseconds(0)));
+  Host::CreateConnectionData data = pool_->claim();
+  EXPECT_EQ(connection2, data.connection_.get());
+  EXPECT_EQ(lb_.host_, data.host_description_);
+  EXPECT_EQ(1U, cluster_->stats_.upstream_cx_prewarmed_claimed_.value());
+  EXPECT_TRUE(connection2->callbacks_.empty());
+
+  // The claimed connection is no longer the pool's, so closing it doesn't affect the pool.
+  connection2->raiseEvent(Network::ConnectionEvent::RemoteClose);
+
+  expectConnection();
+  refill_timer_->callback_();
+  UNREFERENCED_PARAMETER(connection1);
+}
+
+// Connections that fail to connect are replaced after a delay.
+TEST_F(PrewarmedConnPoolTest, ConnectFailure) {
+  cluster_->prewarmed_tcp_connections_ = 1;
+  NiceMock<Network::MockClientConnection>* connection = expectConnection();
+  pool_->refill();
+
+  EXPECT_CALL(*refill_timer_,
+              enableTimer(std::chrono::milliseconds(PrewarmedConnPool::REFILL_DELAY_MS)));
+  connection->raiseEvent(Network::ConnectionEvent::RemoteClose);
+  EXPECT_EQ(nullptr, pool_->claim().connection_);
+
+  expectConnection();
+  refill_timer_->callback_();
+}
+
+// Connections to removed hosts are closed, and the pool shrinks with the configuration.
+TEST_F(PrewarmedConnPoolTest, RemoveHostsAndShrink) {
+  cluster_->prewarmed_tcp_connections_ = 2;
+  NiceMock<Network::MockClientConnection>* connection1 = expectConnection();
+  NiceMock<Network::MockClientConnection>* connection2 = expectConnection();
+  pool_->refill();
+  connection1->raiseEvent(Network::ConnectionEvent::Connected);
+  connection2->raiseEvent(Network::ConnectionEvent::Connected);
+
+  EXPECT_CALL(*connection1, close(Network::ConnectionCloseType::NoFlush));
+  EXPECT_CALL(*connection2, close(Network::ConnectionCloseType::NoFlush));
+  pool_->removeHosts({lb_.host_});
+  EXPECT_EQ(nullptr, pool_->claim().connection_);
+
+  cluster_->prewarmed_tcp_connections_ = 1;
+  NiceMock<Network::MockClientConnection>* connection3 = expectConnection();
+  refill_timer_->callback_();
+
+  cluster_->prewarmed_tcp_connections_ = 0;
+  EXPECT_CALL(*refill_timer_, enableTimer(std::chrono::milliseconds(0)));
+  EXPECT_EQ(nullptr, pool_->claim().connection_);
+  EXPECT_CALL(*connection3, close(Network::ConnectionCloseType::NoFlush));
+  refill_timer_->callback_();
+}
+
+} // namespace Upstream
+} // namespace Envoy
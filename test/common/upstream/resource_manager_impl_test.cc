@@ -1,5 +1,7 @@
+#include "common/stats/stats_impl.h"
 #include "common/upstream/resource_manager_impl.h"
 
+#include "test/mocks/common.h"
 #include "test/mocks/runtime/mocks.h"
 
 #include "gmock/gmock.h"
@@ -8,6 +10,7 @@
 namespace Envoy {
 using testing::NiceMock;
 using testing::Return;
+using testing::ReturnPointee;
 
 namespace Upstream {
 
@@ -45,6 +48,132 @@ TEST(ResourceManagerImplTest, RuntimeResourceManager) {
       .WillRepeatedly(Return(0U));
   EXPECT_EQ(0U, resource_manager.retries().max());
   EXPECT_FALSE(resource_manager.retries().canCreate());
+
+  EXPECT_CALL(runtime.snapshot_,
+              getInteger("circuit_breakers.runtime_resource_manager_test.default.max_hedges", 3U))
+      .Times(2)
+      .WillRepeatedly(Return(0U));
+  EXPECT_EQ(0U, resource_manager.hedges().max());
+  EXPECT_FALSE(resource_manager.hedges().canCreate());
+
+  EXPECT_CALL(runtime.snapshot_,
+              getInteger("circuit_breakers.runtime_resource_manager_test.default.max_shadows",
+                         1024U))
+      .Times(2)
+      .WillRepeatedly(Return(0U));
+  EXPECT_EQ(0U, resource_manager.shadows().max());
+  EXPECT_FALSE(resource_manager.shadows().canCreate());
+}
+
+TEST(ResourceManagerImplTest, RetryBudget) {
+  NiceMock<Runtime::MockLoader> runtime;
+  Stats::IsolatedStoreImpl store;
+  ClusterStats stats{ALL_CLUSTER_STATS(POOL_COUNTER(store), POOL_GAUGE(store), POOL_TIMER(store))};
+  ResourceManagerImpl resource_manager(runtime, "circuit_breakers.retry_budget_test.default.", 0,
+                                       0, 0, 1, &stats);
+
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.retry_budget_test.default.max_retries", 1U))
+      .WillByDefault(Return(1U));
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.retry_budget_test.default.retry_budget_min_retries", 3U))
+      .WillByDefault(Return(3U));
+
+  // Without a budget, max_retries applies.
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.retry_budget_test.default.retry_budget_percent", 0U))
+      .WillByDefault(Return(0U));
+  stats.upstream_rq_active_.set(100);
+  EXPECT_EQ(1U, resource_manager.retries().max());
+
+  // With a budget, the minimum applies to few requests.
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.retry_budget_test.default.retry_budget_percent", 0U))
+      .WillByDefault(Return(20U));
+  stats.upstream_rq_active_.set(5);
+  EXPECT_EQ(3U, resource_manager.retries().max());
+
+  // Active and pending requests both count towards the budget.
+  stats.upstream_rq_active_.set(40);
+  stats.upstream_rq_pending_active_.set(10);
+  EXPECT_EQ(10U, resource_manager.retries().max());
+  for (uint64_t i = 0; i < 10; i++) {
+    EXPECT_TRUE(resource_manager.retries().canCreate());
+    resource_manager.retries().inc();
+  }
+  EXPECT_FALSE(resource_manager.retries().canCreate());
+
+  // The budget shrinks with the requests.
+  stats.upstream_rq_active_.set(0);
+  stats.upstream_rq_pending_active_.set(0);
+  EXPECT_EQ(3U, resource_manager.retries().max());
+  for (uint64_t i = 0; i < 10; i++) {
+    resource_manager.retries().dec();
+  }
+  EXPECT_TRUE(resource_manager.retries().canCreate());
+}
+
+TEST(ResourceManagerImplTest, AdaptiveConcurrency) {
+  NiceMock<Runtime::MockLoader> runtime;
+  Stats::IsolatedStoreImpl store;
+  AdaptiveConcurrencyStats stats{
+      ALL_ADAPTIVE_CONCURRENCY_STATS(POOL_COUNTER(store), POOL_GAUGE(store))};
+  MonotonicTime now;
+  NiceMock<MockMonotonicTimeSource> time_source;
+  ON_CALL(time_source, currentTime()).WillByDefault(ReturnPointee(&now));
+  ResourceManagerImpl resource_manager(runtime, "circuit_breakers.adaptive_test.default.", 0, 0,
+                                       100, 0, nullptr, &stats, time_source);
+  auto respond = [&resource_manager](uint64_t requests, uint64_t response_time_us) -> void {
+    for (uint64_t i = 0; i < requests; i++) {
+      resource_manager.onResponseTime(std::chrono::microseconds(response_time_us));
+    }
+  };
+
+  // Not adaptive unless enabled in runtime.
+  respond(10, 1000);
+  now += std::chrono::seconds(1);
+  respond(10, 1000);
+  EXPECT_EQ(100U, resource_manager.requests().max());
+  EXPECT_EQ(100U, stats.limit_.value());
+
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.adaptive_test.default.adaptive_concurrency", 0U))
+      .WillByDefault(Return(1U));
+
+  // A window needs enough responses and time to update the limit. While the response time holds,
+  // the limit stays at max_requests.
+  respond(9, 1000);
+  now += std::chrono::seconds(1);
+  respond(1, 1000);
+  EXPECT_EQ(1000U, stats.min_rtt_us_.value());
+  EXPECT_EQ(100U, resource_manager.requests().max());
+
+  // Slower responses scale the limit down, by at most half per window before smoothing.
+  respond(10, 4000);
+  EXPECT_EQ(100U, resource_manager.requests().max());
+  now += std::chrono::seconds(1);
+  respond(1, 4000);
+  EXPECT_EQ(92U, resource_manager.requests().max());
+  EXPECT_EQ(92U, stats.limit_.value());
+  EXPECT_EQ(1000U, stats.min_rtt_us_.value());
+
+  for (uint64_t i = 0; i < 92; i++) {
+    EXPECT_TRUE(resource_manager.requests().canCreate());
+    resource_manager.requests().inc();
+  }
+  EXPECT_FALSE(resource_manager.requests().canCreate());
+  EXPECT_EQ(1U, stats.rq_rejected_.value());
+
+  // Rejections by max_requests itself are not counted.
+  ON_CALL(runtime.snapshot_,
+          getInteger("circuit_breakers.adaptive_test.default.max_requests", 100U))
+      .WillByDefault(Return(50U));
+  EXPECT_FALSE(resource_manager.requests().canCreate());
+  EXPECT_EQ(1U, stats.rq_rejected_.value());
+
+  for (uint64_t i = 0; i < 92; i++) {
+    resource_manager.requests().dec();
+  }
 }
 
 } // namespace Upstream
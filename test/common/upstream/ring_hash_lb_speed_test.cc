@@ -0,0 +1,75 @@
+#include <cstdint>
+#include <string>
+
+#include "common/network/utility.h"
+#include "common/upstream/ring_hash_lb.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Upstream {
+namespace {
+
+class TestLoadBalancerContext : public LoadBalancerContext {
+public:
+  // Upstream::LoadBalancerContext
+  Optional<uint64_t> hashKey() const override { return hash_key_; }
+  const Network::Connection* downstreamConnection() const override { return nullptr; }
+  const MetadataMatchCriteria* metadataMatchCriteria() const override { return nullptr; }
+
+  Optional<uint64_t> hash_key_;
+};
+
+/**
+ * A ring hash load balancer over a number of healthy hosts.
+ */
+class RingHashFixture {
+public:
+  RingHashFixture(uint64_t num_hosts) : stats_(ClusterInfoImpl::generateStats(stats_store_)) {
+    for (uint64_t i = 0; i < num_hosts; i++) {
+      cluster_.hosts_.push_back(std::make_shared<HostImpl>(
+          cluster_.info_, "",
+          Network::Utility::resolveUrl(fmt::format("tcp://10.0.{}.{}:6379", i / 256, i % 256)),
+          false, 1, ""));
+    }
+    cluster_.healthy_hosts_ = cluster_.hosts_;
+    lb_.reset(new RingHashLoadBalancer(cluster_, stats_, runtime_, random_));
+    cluster_.runCallbacks({}, {});
+  }
+
+  testing::NiceMock<MockCluster> cluster_;
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_;
+  testing::NiceMock<Runtime::MockLoader> runtime_;
+  testing::NiceMock<Runtime::MockRandomGenerator> random_;
+  std::unique_ptr<RingHashLoadBalancer> lb_;
+};
+
+void BM_RingHashLoadBalancerChooseHost(benchmark::State& state) {
+  RingHashFixture fixture(state.range(0));
+  TestLoadBalancerContext context;
+  uint64_t hash = 0;
+  while (state.KeepRunning()) {
+    // Spread the keys over the ring so the lookups don't all hit the same cache lines.
+    context.hash_key_.value(hash += 0x9E3779B97F4A7C15);
+    benchmark::DoNotOptimize(fixture.lb_->chooseHost(&context));
+  }
+}
+BENCHMARK(BM_RingHashLoadBalancerChooseHost)->Arg(10)->Arg(100)->Arg(1000);
+
+// Rebuilding the ring is what host set updates pay for.
+void BM_RingHashLoadBalancerBuildRing(benchmark::State& state) {
+  RingHashFixture fixture(state.range(0));
+  while (state.KeepRunning()) {
+    fixture.cluster_.runCallbacks({}, {});
+  }
+}
+BENCHMARK(BM_RingHashLoadBalancerBuildRing)->Arg(10)->Arg(100);
+
+} // namespace
+} // namespace Upstream
+} // namespace Envoy
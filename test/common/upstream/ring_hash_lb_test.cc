@@ -30,6 +30,7 @@ public:
   // Upstream::LoadBalancerContext
   Optional<uint64_t> hashKey() const override { return hash_key_; }
   const Network::Connection* downstreamConnection() const override { return nullptr; }
+  const MetadataMatchCriteria* metadataMatchCriteria() const override { return nullptr; }
 
   Optional<uint64_t> hash_key_;
 };
@@ -61,39 +62,37 @@ TEST_F(RingHashLoadBalancerTest, Basic) {
       .WillByDefault(Return(12));
   cluster_.runCallbacks({}, {});
 
-  // This is the hash ring built using the default hash (probably murmur2) on GCC 5.4.
-  // TODO(mattklein123): Compile in and use murmur3 or city so we know exactly
-  // what we are going to get.
-  // ring hash: host=127.0.0.1:85 hash=1358027074129602068
-  // ring hash: host=127.0.0.1:83 hash=4361834613929391114
-  // ring hash: host=127.0.0.1:84 hash=7224494972555149682
-  // ring hash: host=127.0.0.1:81 hash=7701421856454313576
-  // ring hash: host=127.0.0.1:82 hash=8649315368077433379
-  // ring hash: host=127.0.0.1:84 hash=8739448859063030639
-  // ring hash: host=127.0.0.1:81 hash=9887544217113020895
-  // ring hash: host=127.0.0.1:82 hash=10150910876324007731
-  // ring hash: host=127.0.0.1:83 hash=15168472011420622455
-  // ring hash: host=127.0.0.1:80 hash=15427156902705414897
-  // ring hash: host=127.0.0.1:85 hash=16375050414328759093
-  // ring hash: host=127.0.0.1:80 hash=17613279263364193813
+  // This is the hash ring built using xxHash64.
+  // ring hash: host=127.0.0.1:83 hash=842294666033307227
+  // ring hash: host=127.0.0.1:84 hash=2231552554775993225
+  // ring hash: host=127.0.0.1:85 hash=3617836676629228985
+  // ring hash: host=127.0.0.1:80 hash=5454692015285649509
+  // ring hash: host=127.0.0.1:81 hash=7859399908942313493
+  // ring hash: host=127.0.0.1:82 hash=8241336090459785962
+  // ring hash: host=127.0.0.1:84 hash=12589998527382061165
+  // ring hash: host=127.0.0.1:82 hash=12882406409176325258
+  // ring hash: host=127.0.0.1:80 hash=13838424394637650569
+  // ring hash: host=127.0.0.1:85 hash=14454039294846722197
+  // ring hash: host=127.0.0.1:81 hash=16064866803292627174
+  // ring hash: host=127.0.0.1:83 hash=17869494589454488074
   {
     TestLoadBalancerContext context(0);
-    EXPECT_EQ(cluster_.hosts_[5], lb_.chooseHost(&context));
+    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
   }
   {
     TestLoadBalancerContext context(std::numeric_limits<uint64_t>::max());
-    EXPECT_EQ(cluster_.hosts_[5], lb_.chooseHost(&context));
+    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
   }
   {
-    TestLoadBalancerContext context(1358027074129602068);
-    EXPECT_EQ(cluster_.hosts_[5], lb_.chooseHost(&context));
+    TestLoadBalancerContext context(842294666033307227);
+    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
   }
   {
-    TestLoadBalancerContext context(1358027074129602069);
-    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
+    TestLoadBalancerContext context(842294666033307228);
+    EXPECT_EQ(cluster_.hosts_[4], lb_.chooseHost(&context));
   }
   {
-    EXPECT_CALL(random_, random()).WillOnce(Return(10150910876324007730UL));
+    EXPECT_CALL(random_, random()).WillOnce(Return(12882406409176325257UL));
     EXPECT_EQ(cluster_.hosts_[2], lb_.chooseHost(nullptr));
   }
 
@@ -101,10 +100,78 @@ TEST_F(RingHashLoadBalancerTest, Basic) {
   cluster_.runCallbacks({}, {});
   {
     TestLoadBalancerContext context(0);
-    EXPECT_EQ(cluster_.hosts_[5], lb_.chooseHost(&context));
+    EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
   }
 }
 
+// Validate that hosts that failed since the ring was built are skipped for the next hosts on the
+// ring, up to a bound.
+TEST_F(RingHashLoadBalancerTest, SkipsNewlyUnhealthy) {
+  cluster_.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:81"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:82"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:83"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:84"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:85")};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  ON_CALL(runtime_.snapshot_, getInteger("upstream.ring_hash.min_ring_size", _))
+      .WillByDefault(Return(12));
+  cluster_.runCallbacks({}, {});
+
+  // The ring is the one in Basic, which starts with 83, 84, 85 and 80.
+  TestLoadBalancerContext context(0);
+  cluster_.hosts_[3]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  cluster_.hosts_[4]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  cluster_.hosts_[5]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  EXPECT_EQ(cluster_.hosts_[0], lb_.chooseHost(&context));
+  EXPECT_EQ(1U, stats_.lb_unhealthy_repick_.value());
+
+  // The host of the hash is used when no healthy host is found.
+  cluster_.hosts_[0]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  EXPECT_EQ(cluster_.hosts_[3], lb_.chooseHost(&context));
+  EXPECT_EQ(2U, stats_.lb_unhealthy_repick_.value());
+}
+
+// Validate that load balancers adopt the rings supplied with an update rather than each building
+// their own, and build their own when none are supplied.
+TEST_F(RingHashLoadBalancerTest, PrebuiltRings) {
+  NiceMock<MockCluster> host_set;
+  host_set.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:81"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:82"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:83"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:84"),
+                     newTestHost(cluster_.info_, "tcp://127.0.0.1:85")};
+  host_set.healthy_hosts_ = host_set.hosts_;
+  RingHashLoadBalancer::RingsConstSharedPtr rings;
+  RingHashLoadBalancer::PrebuiltRingsCb prebuilt_rings = [&rings]() { return rings; };
+  TestLoadBalancerContext context(0);
+
+  // All hosts are healthy, so building rings builds a single ring, which reads the ring size.
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.ring_hash.min_ring_size", _))
+      .WillOnce(Return(12));
+  RingHashLoadBalancer lb(host_set, stats_, runtime_, random_, prebuilt_rings);
+  EXPECT_EQ(host_set.hosts_[3], lb.chooseHost(&context));
+
+  // The ring is the one in Basic, so the rings are built once here rather than by either balancer.
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.ring_hash.min_ring_size", _))
+      .WillOnce(Return(12));
+  rings = std::make_shared<RingHashLoadBalancer::Rings>(host_set, runtime_);
+  RingHashLoadBalancer other_lb(host_set, stats_, runtime_, random_, prebuilt_rings);
+  host_set.runCallbacks({}, {});
+  EXPECT_EQ(host_set.hosts_[3], lb.chooseHost(&context));
+  EXPECT_EQ(host_set.hosts_[3], other_lb.chooseHost(&context));
+
+  // Without rings supplied with an update, each balancer builds its own again.
+  rings = nullptr;
+  EXPECT_CALL(runtime_.snapshot_, getInteger("upstream.ring_hash.min_ring_size", _))
+      .Times(2)
+      .WillRepeatedly(Return(12));
+  host_set.runCallbacks({}, {});
+  EXPECT_EQ(host_set.hosts_[3], lb.chooseHost(&context));
+  EXPECT_EQ(host_set.hosts_[3], other_lb.chooseHost(&context));
+}
+
 TEST_F(RingHashLoadBalancerTest, UnevenHosts) {
   cluster_.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:80"),
                      newTestHost(cluster_.info_, "tcp://127.0.0.1:81")};
@@ -112,29 +179,25 @@ TEST_F(RingHashLoadBalancerTest, UnevenHosts) {
       .WillByDefault(Return(3));
   cluster_.runCallbacks({}, {});
 
-  // This is the hash ring built using the default hash (probably murmur2) on GCC 5.4.
-  // TODO(mattklein123): Compile in and use murmur3 or city so we know exactly
-  // what we are going to get.
-  // ring hash: host=127.0.0.1:81 hash=7701421856454313576
-  // ring hash: host=127.0.0.1:81 hash=9887544217113020895
-  // ring hash: host=127.0.0.1:80 hash=15427156902705414897
-  // ring hash: host=127.0.0.1:80 hash=17613279263364193813
+  // This is the hash ring built using xxHash64.
+  // ring hash: host=127.0.0.1:80 hash=5454692015285649509
+  // ring hash: host=127.0.0.1:81 hash=7859399908942313493
+  // ring hash: host=127.0.0.1:80 hash=13838424394637650569
+  // ring hash: host=127.0.0.1:81 hash=16064866803292627174
   {
     TestLoadBalancerContext context(0);
-    EXPECT_EQ(cluster_.hosts_[1], lb_.chooseHost(&context));
+    EXPECT_EQ(cluster_.hosts_[0], lb_.chooseHost(&context));
   }
 
   cluster_.hosts_ = {newTestHost(cluster_.info_, "tcp://127.0.0.1:81"),
                      newTestHost(cluster_.info_, "tcp://127.0.0.1:82")};
   cluster_.runCallbacks({}, {});
 
-  // This is the hash ring built using the default hash (probably murmur2) on GCC 5.4.
-  // TODO(mattklein123): Compile in and use murmur3 or city so we know exactly
-  // what we are going to get.
-  // ring hash: host=127.0.0.1:81 hash=7701421856454313576
-  // ring hash: host=127.0.0.1:82 hash=8649315368077433379
-  // ring hash: host=127.0.0.1:81 hash=9887544217113020895
-  // ring hash: host=127.0.0.1:82 hash=10150910876324007731
+  // This is the hash ring built using xxHash64.
+  // ring hash: host=127.0.0.1:81 hash=7859399908942313493
+  // ring hash: host=127.0.0.1:82 hash=8241336090459785962
+  // ring hash: host=127.0.0.1:82 hash=12882406409176325258
+  // ring hash: host=127.0.0.1:81 hash=16064866803292627174
   {
     TestLoadBalancerContext context(0);
     EXPECT_EQ(cluster_.hosts_[0], lb_.chooseHost(&context));
@@ -0,0 +1,179 @@
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/config/metadata.h"
+#include "common/network/utility.h"
+#include "common/upstream/load_balancer_impl.h"
+#include "common/upstream/subset_lb.h"
+#include "common/upstream/upstream_impl.h"
+
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/upstream/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+using testing::NiceMock;
+
+namespace Upstream {
+
+class TestLoadBalancerContext : public LoadBalancerContext {
+public:
+  TestLoadBalancerContext(const MetadataMatchCriteria& criteria) : criteria_(criteria) {}
+
+  // Upstream::LoadBalancerContext
+  Optional<uint64_t> hashKey() const override { return {}; }
+  const Network::Connection* downstreamConnection() const override { return nullptr; }
+  const MetadataMatchCriteria* metadataMatchCriteria() const override { return &criteria_; }
+
+  const MetadataMatchCriteria criteria_;
+};
+
+class SubsetLoadBalancerTest : public testing::Test {
+public:
+  SubsetLoadBalancerTest() : stats_(ClusterInfoImpl::generateStats(stats_store_)) {}
+
+  void init(bool fallback) {
+    LoadBalancerPtr fallback_lb;
+    if (fallback) {
+      fallback_lb.reset(new RoundRobinLoadBalancer(cluster_, nullptr, stats_, runtime_, random_));
+    }
+    lb_.reset(new SubsetLoadBalancer(
+        cluster_, {{"stage", "version"}, {"shard"}}, std::move(fallback_lb),
+        [this](HostSet& host_set) -> LoadBalancerPtr {
+          return LoadBalancerPtr{
+              new RoundRobinLoadBalancer(host_set, nullptr, stats_, runtime_, random_)};
+        },
+        stats_));
+  }
+
+  HostSharedPtr newTestHost(const std::string& url,
+                            const std::map<std::string, std::string>& lb_metadata) {
+    envoy::api::v2::Metadata metadata;
+    for (const auto& entry : lb_metadata) {
+      Config::Metadata::mutableMetadataValue(metadata, Config::MetadataFilters::get().ENVOY_LB,
+                                             entry.first)
+          .set_string_value(entry.second);
+    }
+    return std::make_shared<HostImpl>(cluster_.info_, "", Network::Utility::resolveUrl(url), false,
+                                      1, "", metadata);
+  }
+
+  std::string chooseAddress(const MetadataMatchCriteria& criteria) {
+    TestLoadBalancerContext context(criteria);
+    HostConstSharedPtr host = lb_->chooseHost(&context);
+    return host ? host->address()->asString() : "";
+  }
+
+  NiceMock<MockCluster> cluster_;
+  Stats::IsolatedStoreImpl stats_store_;
+  ClusterStats stats_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  NiceMock<Runtime::MockRandomGenerator> random_;
+  std::unique_ptr<SubsetLoadBalancer> lb_;
+};
+
+TEST_F(SubsetLoadBalancerTest, NoHosts) {
+  init(true);
+  EXPECT_EQ(0U, lb_->subsetCount());
+  EXPECT_EQ("", chooseAddress({{"shard", "1"}}));
+  EXPECT_EQ(nullptr, lb_->chooseHost(nullptr));
+  EXPECT_EQ(2U, stats_.lb_subsets_fallback_.value());
+}
+
+TEST_F(SubsetLoadBalancerTest, SelectsSubset) {
+  cluster_.hosts_ = {
+      newTestHost("tcp://127.0.0.1:80", {{"stage", "prod"}, {"version", "1"}, {"shard", "a"}}),
+      newTestHost("tcp://127.0.0.1:81", {{"stage", "prod"}, {"version", "2"}, {"shard", "a"}}),
+      newTestHost("tcp://127.0.0.1:82", {{"stage", "prod"}, {"version", "2"}, {"shard", "b"}}),
+      newTestHost("tcp://127.0.0.1:83", {{"stage", "canary"}}),
+      newTestHost("tcp://127.0.0.1:84", {})};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  init(true);
+
+  // The canary host has no version and the last host no metadata, so they are in no subset.
+  EXPECT_EQ(4U, lb_->subsetCount());
+
+  EXPECT_EQ("127.0.0.1:80", chooseAddress({{"stage", "prod"}, {"version", "1"}}));
+  EXPECT_EQ("127.0.0.1:80", chooseAddress({{"stage", "prod"}, {"version", "1"}}));
+  EXPECT_EQ("127.0.0.1:81", chooseAddress({{"stage", "prod"}, {"version", "2"}}));
+  EXPECT_EQ("127.0.0.1:82", chooseAddress({{"stage", "prod"}, {"version", "2"}}));
+  EXPECT_EQ("127.0.0.1:82", chooseAddress({{"shard", "b"}}));
+  EXPECT_EQ(5U, stats_.lb_subsets_selected_.value());
+
+  // Criteria must have exactly the keys of a subset, so these go to the fallback.
+  chooseAddress({{"stage", "prod"}});
+  chooseAddress({{"shard", "a"}, {"stage", "prod"}, {"version", "1"}});
+  chooseAddress({{"shard", "c"}});
+  EXPECT_EQ(3U, stats_.lb_subsets_fallback_.value());
+}
+
+TEST_F(SubsetLoadBalancerTest, NoFallback) {
+  cluster_.hosts_ = {newTestHost("tcp://127.0.0.1:80", {{"shard", "a"}})};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  init(false);
+
+  EXPECT_EQ("127.0.0.1:80", chooseAddress({{"shard", "a"}}));
+  EXPECT_EQ("", chooseAddress({{"shard", "b"}}));
+  EXPECT_EQ(nullptr, lb_->chooseHost(nullptr));
+  EXPECT_EQ(2U, stats_.lb_subsets_fallback_.value());
+}
+
+TEST_F(SubsetLoadBalancerTest, MembershipUpdates) {
+  HostSharedPtr host_a = newTestHost("tcp://127.0.0.1:80", {{"shard", "a"}});
+  HostSharedPtr host_b = newTestHost("tcp://127.0.0.1:81", {{"shard", "b"}});
+  cluster_.hosts_ = {host_a};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  init(false);
+  EXPECT_EQ(1U, lb_->subsetCount());
+
+  // Adding a host with new values adds a subset.
+  cluster_.hosts_ = {host_a, host_b};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  cluster_.runCallbacks({host_b}, {});
+  EXPECT_EQ(2U, lb_->subsetCount());
+  EXPECT_EQ("127.0.0.1:81", chooseAddress({{"shard", "b"}}));
+
+  // Adding a host to an existing subset.
+  HostSharedPtr host_a2 = newTestHost("tcp://127.0.0.1:82", {{"shard", "a"}});
+  cluster_.hosts_ = {host_a, host_b, host_a2};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  cluster_.runCallbacks({host_a2}, {});
+  EXPECT_EQ(2U, lb_->subsetCount());
+  EXPECT_EQ("127.0.0.1:80", chooseAddress({{"shard", "a"}}));
+  EXPECT_EQ("127.0.0.1:82", chooseAddress({{"shard", "a"}}));
+
+  // Removing the last host of a subset removes the subset.
+  cluster_.hosts_ = {host_a, host_a2};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  cluster_.runCallbacks({}, {host_b});
+  EXPECT_EQ(1U, lb_->subsetCount());
+  EXPECT_EQ("", chooseAddress({{"shard", "b"}}));
+
+  cluster_.hosts_ = {host_a2};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  cluster_.runCallbacks({}, {host_a});
+  EXPECT_EQ("127.0.0.1:82", chooseAddress({{"shard", "a"}}));
+  EXPECT_EQ("127.0.0.1:82", chooseAddress({{"shard", "a"}}));
+}
+
+TEST_F(SubsetLoadBalancerTest, HealthUpdates) {
+  HostSharedPtr host_a = newTestHost("tcp://127.0.0.1:80", {{"shard", "a"}});
+  HostSharedPtr host_a2 = newTestHost("tcp://127.0.0.1:81", {{"shard", "a"}});
+  cluster_.hosts_ = {host_a, host_a2};
+  cluster_.healthy_hosts_ = cluster_.hosts_;
+  init(false);
+
+  // An update without membership changes rebuilds the healthy hosts of the subsets.
+  host_a->healthFlagSet(Host::HealthFlag::FAILED_ACTIVE_HC);
+  cluster_.healthy_hosts_ = {host_a2};
+  cluster_.runCallbacks({}, {});
+  EXPECT_EQ("127.0.0.1:81", chooseAddress({{"shard", "a"}}));
+  EXPECT_EQ("127.0.0.1:81", chooseAddress({{"shard", "a"}}));
+}
+
+} // namespace Upstream
+} // namespace Envoy
@@ -3,6 +3,7 @@
 #include <list>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "envoy/api/api.h"
@@ -28,6 +29,8 @@
 using testing::ContainerEq;
 using testing::Invoke;
 using testing::NiceMock;
+using testing::Return;
+using testing::ReturnRef;
 using testing::_;
 
 namespace Envoy {
@@ -89,7 +92,8 @@ std::vector<StrictDnsConfigTuple> generateStrictDnsParams() {
   {
     std::string family_json(R"EOF("dns_lookup_family": "auto",)EOF");
     Network::DnsLookupFamily family(Network::DnsLookupFamily::Auto);
-    std::list<std::string> dns_response{"127.0.0.1", "127.0.0.2"};
+    // Only the family that comes first becomes hosts.
+    std::list<std::string> dns_response{"::1", "::2", "127.0.0.1"};
     dns_config.push_back(std::make_tuple(family_json, family, dns_response));
   }
   return dns_config;
@@ -304,6 +308,22 @@ TEST(HostImplTest, HostameCanaryAndZone) {
   EXPECT_EQ("hello", host.zone());
 }
 
+TEST(HostImplTest, Stats) {
+  MockCluster cluster;
+  HostImpl host(cluster.info_, "", Network::Utility::resolveUrl("tcp://10.0.0.1:1234"), false, 1,
+                "");
+  host.stats().rq_total_.add(2);
+  host.stats().rq_active_.inc();
+  host.stats().rq_active_.inc();
+  host.stats().rq_active_.dec();
+
+  typedef std::vector<std::pair<std::string, uint64_t>> NamesAndValues;
+  EXPECT_EQ((NamesAndValues{{"cx_total", 0}, {"cx_connect_fail", 0}, {"rq_total", 2},
+                            {"rq_timeout", 0}}),
+            host.stats().counters());
+  EXPECT_EQ((NamesAndValues{{"cx_active", 0}, {"rq_active", 1}}), host.stats().gauges());
+}
+
 TEST(StaticClusterImplTest, EmptyHostname) {
   Stats::IsolatedStoreImpl stats;
   Ssl::MockContextManager ssl_context_manager;
@@ -348,6 +368,141 @@ TEST(StaticClusterImplTest, RingHash) {
   EXPECT_TRUE(cluster.info()->addedViaApi());
 }
 
+// Offering h2 with ALPN leaves the protocol to each host, unless the cluster is HTTP/2.
+TEST(StaticClusterImplTest, AlpnFeatures) {
+  Stats::IsolatedStoreImpl stats;
+  NiceMock<Ssl::MockContextManager> ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  NiceMock<MockClusterManager> cm;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "round_robin",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}],
+    "ssl_context": {"alpn_protocols": "h2,http/1.1"}
+  }
+  )EOF";
+
+  StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                            false);
+  EXPECT_EQ(ClusterInfo::Features::HTTP2_ALPN, cluster.info()->features());
+
+  const std::string http2_json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "round_robin",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}],
+    "ssl_context": {"alpn_protocols": "h2"},
+    "features": "http2"
+  }
+  )EOF";
+
+  StaticClusterImpl http2_cluster(parseClusterFromJson(http2_json), runtime, stats,
+                                  ssl_context_manager, cm, false);
+  EXPECT_EQ(ClusterInfo::Features::HTTP2, http2_cluster.info()->features());
+
+  const std::string http11_json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "round_robin",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}],
+    "ssl_context": {"alpn_protocols": "http/1.1"}
+  }
+  )EOF";
+
+  StaticClusterImpl http11_cluster(parseClusterFromJson(http11_json), runtime, stats,
+                                   ssl_context_manager, cm, false);
+  EXPECT_EQ(0U, http11_cluster.info()->features());
+}
+
+TEST(StaticClusterImplTest, Maglev) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "ring_hash",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}]
+  }
+  )EOF";
+
+  EXPECT_CALL(runtime.snapshot_, getInteger("upstream.maglev_table_size.staticcluster", 0))
+      .WillOnce(Return(65537));
+  NiceMock<MockClusterManager> cm;
+  StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                            false);
+  EXPECT_EQ(LoadBalancerType::Maglev, cluster.info()->lbType());
+  EXPECT_EQ(65537U, cluster.info()->maglevTableSize());
+}
+
+TEST(StaticClusterImplTest, LbSubsets) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "round_robin",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}]
+  }
+  )EOF";
+
+  const std::string keys = "version, stage;shard;;stage,version,version";
+  EXPECT_CALL(runtime.snapshot_, get("upstream.lb_subset_keys.staticcluster"))
+      .WillOnce(ReturnRef(keys));
+  EXPECT_CALL(runtime.snapshot_, getInteger("upstream.lb_subset_fallback.staticcluster", 1))
+      .WillOnce(Return(0));
+  NiceMock<MockClusterManager> cm;
+  StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                            false);
+  // Keys are sorted and duplicate sets are dropped.
+  const std::vector<std::vector<std::string>> expected_keys{{"stage", "version"}, {"shard"}};
+  EXPECT_EQ(expected_keys, cluster.info()->lbSubsetKeys());
+  EXPECT_FALSE(cluster.info()->lbSubsetFallback());
+}
+
+TEST(StaticClusterImplTest, TcpFastOpen) {
+  Stats::IsolatedStoreImpl stats;
+  Ssl::MockContextManager ssl_context_manager;
+  NiceMock<Runtime::MockLoader> runtime;
+  const std::string json = R"EOF(
+  {
+    "name": "staticcluster",
+    "connect_timeout_ms": 250,
+    "type": "static",
+    "lb_type": "round_robin",
+    "hosts": [{"url": "tcp://10.0.0.1:11001"}]
+  }
+  )EOF";
+
+  EXPECT_CALL(runtime.snapshot_, getInteger("upstream.tcp_fast_open.staticcluster", 0))
+      .WillOnce(Return(1));
+  NiceMock<MockClusterManager> cm;
+  StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
+                            false);
+  EXPECT_TRUE(cluster.info()->tcpFastOpen());
+
+  // Connections to the hosts of the cluster count accepted SYN data in the cluster stats.
+  NiceMock<Event::MockDispatcher> dispatcher;
+  Network::MockClientConnection* connection = new NiceMock<Network::MockClientConnection>();
+  EXPECT_CALL(dispatcher, createClientConnection_(_, _)).WillOnce(Return(connection));
+  EXPECT_CALL(*connection, enableTcpFastOpen(_))
+      .WillOnce(Invoke([](Stats::Counter& syn_data_accepted) -> void { syn_data_accepted.inc(); }));
+  cluster.hosts()[0]->createConnection(dispatcher);
+  EXPECT_EQ(1U, cluster.info()->stats().upstream_cx_tcp_fast_open_.value());
+}
+
 TEST(StaticClusterImplTest, OutlierDetector) {
   Stats::IsolatedStoreImpl stats;
   Ssl::MockContextManager ssl_context_manager;
@@ -367,25 +522,42 @@ TEST(StaticClusterImplTest, OutlierDetector) {
   StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
                             false);
 
+  NiceMock<Event::MockDispatcher> dispatcher;
+  Event::MockTimer* timer = new Event::MockTimer(&dispatcher);
   Outlier::MockDetector* detector = new Outlier::MockDetector();
   EXPECT_CALL(*detector, addChangedStateCb(_));
-  cluster.setOutlierDetector(Outlier::DetectorSharedPtr{detector});
+  cluster.setOutlierDetector(Outlier::DetectorSharedPtr{detector}, dispatcher);
 
   EXPECT_EQ(2UL, cluster.healthyHosts().size());
   EXPECT_EQ(2UL, cluster.info()->stats().membership_healthy_.value());
 
-  // Set a single host as having failed and fire outlier detector callbacks. This should result
-  // in only a single healthy host.
+  // Set both hosts as having failed and fire outlier detector callbacks. The healthy hosts are
+  // only rebuilt once, when the timer fires.
+  EXPECT_CALL(runtime.snapshot_, getInteger("outlier_detection.host_set_update_delay_ms", 1000))
+      .WillRepeatedly(Return(500));
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(500)));
   cluster.hosts()[0]->outlierDetector().putHttpResponseCode(503);
   cluster.hosts()[0]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
   detector->runCallbacks(cluster.hosts()[0]);
+  cluster.hosts()[1]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  detector->runCallbacks(cluster.hosts()[1]);
+  EXPECT_EQ(2UL, cluster.healthyHosts().size());
+
+  // One host comes back before the rebuild. This should result in only a single healthy host.
+  cluster.hosts()[1]->healthFlagClear(Host::HealthFlag::FAILED_OUTLIER_CHECK);
+  detector->runCallbacks(cluster.hosts()[1]);
+  EXPECT_CALL(*timer, disableTimer());
+  timer->callback_();
   EXPECT_EQ(1UL, cluster.healthyHosts().size());
   EXPECT_EQ(1UL, cluster.info()->stats().membership_healthy_.value());
   EXPECT_NE(cluster.healthyHosts()[0], cluster.hosts()[0]);
 
   // Bring the host back online.
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(500)));
   cluster.hosts()[0]->healthFlagClear(Host::HealthFlag::FAILED_OUTLIER_CHECK);
   detector->runCallbacks(cluster.hosts()[0]);
+  EXPECT_CALL(*timer, disableTimer());
+  timer->callback_();
   EXPECT_EQ(2UL, cluster.healthyHosts().size());
   EXPECT_EQ(2UL, cluster.info()->stats().membership_healthy_.value());
 }
@@ -409,8 +581,10 @@ TEST(StaticClusterImplTest, HealthyStat) {
   StaticClusterImpl cluster(parseClusterFromJson(json), runtime, stats, ssl_context_manager, cm,
                             false);
 
+  NiceMock<Event::MockDispatcher> dispatcher;
+  NiceMock<Event::MockTimer>* timer = new NiceMock<Event::MockTimer>(&dispatcher);
   Outlier::MockDetector* outlier_detector = new NiceMock<Outlier::MockDetector>();
-  cluster.setOutlierDetector(Outlier::DetectorSharedPtr{outlier_detector});
+  cluster.setOutlierDetector(Outlier::DetectorSharedPtr{outlier_detector}, dispatcher);
 
   std::shared_ptr<MockHealthChecker> health_checker(new NiceMock<MockHealthChecker>());
   cluster.setHealthChecker(health_checker);
@@ -420,6 +594,7 @@ TEST(StaticClusterImplTest, HealthyStat) {
 
   cluster.hosts()[0]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
   outlier_detector->runCallbacks(cluster.hosts()[0]);
+  timer->callback_();
   EXPECT_EQ(1UL, cluster.healthyHosts().size());
   EXPECT_EQ(1UL, cluster.info()->stats().membership_healthy_.value());
 
@@ -430,6 +605,7 @@ TEST(StaticClusterImplTest, HealthyStat) {
 
   cluster.hosts()[0]->healthFlagClear(Host::HealthFlag::FAILED_OUTLIER_CHECK);
   outlier_detector->runCallbacks(cluster.hosts()[0]);
+  timer->callback_();
   EXPECT_EQ(1UL, cluster.healthyHosts().size());
   EXPECT_EQ(1UL, cluster.info()->stats().membership_healthy_.value());
 
@@ -440,6 +616,7 @@ TEST(StaticClusterImplTest, HealthyStat) {
 
   cluster.hosts()[0]->healthFlagSet(Host::HealthFlag::FAILED_OUTLIER_CHECK);
   outlier_detector->runCallbacks(cluster.hosts()[0]);
+  timer->callback_();
   EXPECT_EQ(1UL, cluster.healthyHosts().size());
   EXPECT_EQ(1UL, cluster.info()->stats().membership_healthy_.value());
 
@@ -245,8 +245,17 @@ FakeUpstream::~FakeUpstream() {
   thread_->join();
 }
 
+void FakeUpstream::setFilterChainFactory(Network::FilterChainFactory& factory) {
+  std::unique_lock<std::mutex> lock(lock_);
+  filter_chain_factory_ = &factory;
+}
+
 bool FakeUpstream::createFilterChain(Network::Connection& connection) {
   std::unique_lock<std::mutex> lock(lock_);
+  if (filter_chain_factory_ != nullptr) {
+    return filter_chain_factory_->createFilterChain(connection);
+  }
+
   connection.readDisable(true);
   new_connections_.emplace_back(new QueuedConnectionWrapper(connection));
   new_connection_event_.notify_one();
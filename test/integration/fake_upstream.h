@@ -229,6 +229,14 @@ public:
   FakeRawConnectionPtr waitForRawConnection();
   Network::Address::InstanceConstSharedPtr localAddress() const { return socket_->localAddress(); }
 
+  /**
+   * Create the filter chain of each new connection with factory on the fake upstream thread,
+   * rather than queueing the connection for waitForHttpConnection() or waitForRawConnection(). This
+   * lets load tests serve requests without the test thread. Must be called before the first
+   * connection arrives.
+   */
+  void setFilterChainFactory(Network::FilterChainFactory& factory);
+
   // Network::FilterChainFactory
   bool createFilterChain(Network::Connection& connection) override;
 
@@ -249,5 +257,6 @@ private:
   Network::ConnectionHandlerPtr handler_;
   std::list<QueuedConnectionWrapperPtr> new_connections_;
   FakeHttpConnection::Type http_type_;
+  Network::FilterChainFactory* filter_chain_factory_{};
 };
 } // namespace Envoy
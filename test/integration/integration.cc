@@ -237,7 +237,11 @@ void IntegrationTcpClient::waitForDisconnect() {
 
 void IntegrationTcpClient::write(const std::string& data) {
   Buffer::OwnedImpl buffer(data);
-  EXPECT_CALL(*client_write_buffer_, move(_)).Times(1);
+  if (data.size() <= Network::ConnectionImplUtility::COALESCE_WRITE_SIZE) {
+    EXPECT_CALL(*client_write_buffer_, add(_)).Times(1);
+  } else {
+    EXPECT_CALL(*client_write_buffer_, move(_)).Times(1);
+  }
   EXPECT_CALL(*client_write_buffer_, write(_)).Times(1);
 
   int bytes_expected = client_write_buffer_->bytes_written() + data.size();
@@ -0,0 +1,509 @@
+// Load tests of the proxy, built on the integration test framework. Each benchmark starts a server
+// with test/config/integration/server_load.json and fake upstreams that respond on their own
+// thread, then keeps a fixed number of requests in flight from the benchmark thread and reports
+// requests per second (items_per_second), latency percentiles in microseconds and the process CPU
+// time per request. Run it with an optimized build, e.g.:
+//
+//   bazel run -c opt //test/integration:proxy_speed_test -- --benchmark_filter=Http2
+//
+// and compare against a run of the baseline. The CPU time includes the load generator and the fake
+// upstreams, which do the same work in both runs.
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/buffer/buffer_impl.h"
+#include "common/filter/echo.h"
+#include "common/http/http1/codec_impl.h"
+#include "common/network/filter_impl.h"
+
+#include "test/integration/integration.h"
+#include "test/test_common/environment.h"
+#include "test/test_common/utility.h"
+
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace {
+
+enum class Mode { Http1, Http2, TcpProxy };
+
+/**
+ * Responds to each request on an HTTP/1 upstream connection as soon as the request is complete.
+ */
+class AutoResponseFilter : public Network::ReadFilterBaseImpl,
+                           public Http::ServerConnectionCallbacks {
+public:
+  AutoResponseFilter(Network::Connection& connection, const Http::HeaderMap& response_headers,
+                     const std::string& chunk, uint32_t chunks)
+      : codec_(new Http::Http1::ServerConnectionImpl(connection, *this, Http::Http1Settings())),
+        response_headers_(response_headers), chunk_(chunk), chunks_(chunks) {}
+
+  // Network::ReadFilter
+  Network::FilterStatus onData(Buffer::Instance& data) override {
+    codec_->dispatch(data);
+    return Network::FilterStatus::StopIteration;
+  }
+
+  // Http::ServerConnectionCallbacks
+  Http::StreamDecoder& newStream(Http::StreamEncoder& response_encoder) override {
+    streams_.remove_if([](const StreamPtr& stream) -> bool { return stream->responded_; });
+    streams_.emplace_back(new Stream(*this, response_encoder));
+    return *streams_.back();
+  }
+  void onGoAway() override {}
+
+private:
+  struct Stream : public Http::StreamDecoder {
+    Stream(AutoResponseFilter& parent, Http::StreamEncoder& encoder)
+        : parent_(parent), encoder_(encoder) {}
+
+    void respond() {
+      encoder_.encodeHeaders(parent_.response_headers_, parent_.chunk_.empty());
+      for (uint32_t i = 0; !parent_.chunk_.empty() && i < parent_.chunks_; i++) {
+        Buffer::OwnedImpl data(parent_.chunk_);
+        encoder_.encodeData(data, i == parent_.chunks_ - 1);
+      }
+      responded_ = true;
+    }
+
+    // Http::StreamDecoder
+    void decodeHeaders(Http::HeaderMapPtr&&, bool end_stream) override {
+      if (end_stream) {
+        respond();
+      }
+    }
+    void decodeData(Buffer::Instance&, bool end_stream) override {
+      if (end_stream) {
+        respond();
+      }
+    }
+    void decodeTrailers(Http::HeaderMapPtr&&) override { respond(); }
+
+    AutoResponseFilter& parent_;
+    Http::StreamEncoder& encoder_;
+    bool responded_{};
+  };
+
+  typedef std::unique_ptr<Stream> StreamPtr;
+
+  Http::ServerConnectionPtr codec_;
+  const Http::HeaderMap& response_headers_;
+  const std::string& chunk_;
+  const uint32_t chunks_;
+  std::list<StreamPtr> streams_;
+};
+
+/**
+ * Serves the connections of a fake upstream with an AutoResponseFilter, or echoes back whatever
+ * they send for the TCP proxy.
+ */
+class AutoResponder : public Network::FilterChainFactory {
+public:
+  AutoResponder(Mode mode, uint64_t chunk_size, uint32_t chunks)
+      : mode_(mode), chunk_(chunk_size, 'a'), chunks_(chunks) {
+    if (chunks_ == 1) {
+      response_headers_.addCopy("content-length", std::to_string(chunk_size));
+    }
+  }
+
+  // Network::FilterChainFactory
+  bool createFilterChain(Network::Connection& connection) override {
+    if (mode_ == Mode::TcpProxy) {
+      connection.addReadFilter(Network::ReadFilterSharedPtr{new Filter::Echo()});
+    } else {
+      connection.addReadFilter(Network::ReadFilterSharedPtr{
+          new AutoResponseFilter(connection, response_headers_, chunk_, chunks_)});
+    }
+    return true;
+  }
+
+private:
+  const Mode mode_;
+  const std::string chunk_;
+  const uint32_t chunks_;
+  Http::TestHeaderMapImpl response_headers_{{":status", "200"}};
+};
+
+/**
+ * Keeps a number of requests in flight on the client dispatcher, sending the next request of each
+ * as soon as the response to the previous one is complete, and records their latencies.
+ */
+class LoadGenerator {
+public:
+  LoadGenerator(Event::Dispatcher& dispatcher, uint64_t chunk_size, uint32_t chunks)
+      : dispatcher_(dispatcher), chunk_(chunk_size, 'a'), chunks_(chunks) {}
+  virtual ~LoadGenerator() {}
+
+  /**
+   * Run the client dispatcher until count more requests complete.
+   */
+  void waitForCompletions(uint64_t count) {
+    target_ += count;
+    if (completed_ < target_) {
+      dispatcher_.run(Event::Dispatcher::RunType::Block);
+    }
+  }
+
+  void startRecording() {
+    recording_ = true;
+    latencies_us_.clear();
+  }
+
+  /**
+   * @return the latency in microseconds that percentile of the recorded requests stay within.
+   */
+  double latencyPercentile(double percentile) {
+    if (latencies_us_.empty()) {
+      return 0;
+    }
+    const size_t index = std::min(latencies_us_.size() - 1,
+                                  static_cast<size_t>(latencies_us_.size() * percentile / 100));
+    std::nth_element(latencies_us_.begin(), latencies_us_.begin() + index, latencies_us_.end());
+    return latencies_us_[index];
+  }
+
+  uint64_t errors() const { return errors_; }
+
+protected:
+  typedef std::chrono::steady_clock::time_point StartTime;
+
+  void onComplete(StartTime start) {
+    if (recording_) {
+      latencies_us_.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count());
+    }
+    if (++completed_ == target_) {
+      dispatcher_.exit();
+    }
+  }
+
+  Event::Dispatcher& dispatcher_;
+  const std::string chunk_;
+  const uint32_t chunks_;
+  bool stopping_{};
+  uint64_t errors_{};
+
+private:
+  uint64_t completed_{};
+  uint64_t target_{};
+  bool recording_{};
+  std::vector<uint64_t> latencies_us_;
+};
+
+typedef std::unique_ptr<LoadGenerator> LoadGeneratorPtr;
+
+/**
+ * HTTP load over one connection per request in flight for HTTP/1, and a single connection for
+ * HTTP/2.
+ */
+class HttpLoadGenerator : public LoadGenerator {
+public:
+  HttpLoadGenerator(BaseIntegrationTest& test, uint32_t port, Http::CodecClient::Type type,
+                    uint32_t concurrency, uint64_t chunk_size, uint32_t chunks)
+      : LoadGenerator(*test.dispatcher_, chunk_size, chunks) {
+    request_headers_.addCopy(":method", chunk_.empty() ? "GET" : "POST");
+    if (!chunk_.empty() && chunks_ == 1) {
+      request_headers_.addCopy("content-length", std::to_string(chunk_size));
+    }
+
+    for (uint32_t i = 0; i < concurrency; i++) {
+      if (clients_.empty() || type == Http::CodecClient::Type::HTTP1) {
+        clients_.push_back(test.makeHttpConnection(port, type));
+      }
+      requests_.emplace_back(new Request(*this, *clients_.back()));
+      requests_.back()->start();
+    }
+  }
+
+  ~HttpLoadGenerator() {
+    // Reset the requests in flight, then let the requests that are waiting to start see that the
+    // load is stopping.
+    stopping_ = true;
+    for (IntegrationCodecClientPtr& client : clients_) {
+      client->close();
+    }
+    dispatcher_.run(Event::Dispatcher::RunType::NonBlock);
+  }
+
+private:
+  struct Request : public Http::StreamDecoder, public Http::StreamCallbacks {
+    Request(HttpLoadGenerator& parent, Http::CodecClient& client)
+        : parent_(parent), client_(client) {}
+
+    void start() {
+      if (parent_.stopping_) {
+        return;
+      }
+      start_ = std::chrono::steady_clock::now();
+      Http::StreamEncoder& encoder = client_.newStream(*this);
+      encoder.getStream().addCallbacks(*this);
+      encoder.encodeHeaders(parent_.request_headers_, parent_.chunk_.empty());
+      for (uint32_t i = 0; !parent_.chunk_.empty() && i < parent_.chunks_; i++) {
+        Buffer::OwnedImpl data(parent_.chunk_);
+        encoder.encodeData(data, i == parent_.chunks_ - 1);
+      }
+    }
+
+    void onResponseComplete() {
+      parent_.onComplete(start_);
+      // The HTTP/1 codec only takes the next request once it is done with this response.
+      parent_.dispatcher_.post([this]() -> void { start(); });
+    }
+
+    // Http::StreamDecoder
+    void decodeHeaders(Http::HeaderMapPtr&&, bool end_stream) override {
+      if (end_stream) {
+        onResponseComplete();
+      }
+    }
+    void decodeData(Buffer::Instance&, bool end_stream) override {
+      if (end_stream) {
+        onResponseComplete();
+      }
+    }
+    void decodeTrailers(Http::HeaderMapPtr&&) override { onResponseComplete(); }
+
+    // Http::StreamCallbacks
+    void onResetStream(Http::StreamResetReason) override {
+      if (!parent_.stopping_) {
+        parent_.errors_++;
+        parent_.dispatcher_.post([this]() -> void { start(); });
+      }
+    }
+    void onAboveWriteBufferHighWatermark() override {}
+    void onBelowWriteBufferLowWatermark() override {}
+
+    HttpLoadGenerator& parent_;
+    Http::CodecClient& client_;
+    StartTime start_;
+  };
+
+  typedef std::unique_ptr<Request> RequestPtr;
+
+  Http::TestHeaderMapImpl request_headers_{
+      {":path", "/"}, {":scheme", "http"}, {":authority", "host"}};
+  std::vector<IntegrationCodecClientPtr> clients_;
+  std::vector<RequestPtr> requests_;
+};
+
+/**
+ * TCP proxy load over one connection per request in flight, where a request is a message that the
+ * upstream echoes back.
+ */
+class TcpLoadGenerator : public LoadGenerator {
+public:
+  TcpLoadGenerator(BaseIntegrationTest& test, uint32_t port, uint32_t concurrency,
+                   uint64_t chunk_size, uint32_t chunks)
+      : LoadGenerator(*test.dispatcher_, chunk_size, chunks) {
+    for (uint32_t i = 0; i < concurrency; i++) {
+      clients_.emplace_back(new Client(*this, test.makeClientConnection(port)));
+      clients_.back()->start();
+    }
+  }
+
+  ~TcpLoadGenerator() {
+    stopping_ = true;
+    for (ClientPtr& client : clients_) {
+      client->connection_->close(Network::ConnectionCloseType::NoFlush);
+    }
+  }
+
+private:
+  struct Client : public Network::ConnectionCallbacks {
+    Client(TcpLoadGenerator& parent, Network::ClientConnectionPtr&& connection)
+        : parent_(parent), connection_(std::move(connection)) {
+      connection_->addConnectionCallbacks(*this);
+      connection_->addReadFilter(Network::ReadFilterSharedPtr{new ReadFilter(*this)});
+      connection_->noDelay(true);
+      connection_->connect();
+    }
+
+    void start() {
+      start_ = std::chrono::steady_clock::now();
+      for (uint32_t i = 0; i < parent_.chunks_; i++) {
+        Buffer::OwnedImpl data(parent_.chunk_);
+        connection_->write(data);
+      }
+    }
+
+    void onData(Buffer::Instance& data) {
+      received_ += data.length();
+      data.drain(data.length());
+      if (received_ == parent_.chunk_.size() * parent_.chunks_) {
+        received_ = 0;
+        parent_.onComplete(start_);
+        start();
+      }
+    }
+
+    // Network::ConnectionCallbacks
+    void onEvent(Network::ConnectionEvent event) override {
+      // The proxy never closes a connection on its own, so a close is only expected on teardown.
+      RELEASE_ASSERT(parent_.stopping_ || event == Network::ConnectionEvent::Connected);
+    }
+    void onAboveWriteBufferHighWatermark() override {}
+    void onBelowWriteBufferLowWatermark() override {}
+
+    struct ReadFilter : public Network::ReadFilterBaseImpl {
+      ReadFilter(Client& parent) : parent_(parent) {}
+
+      // Network::ReadFilter
+      Network::FilterStatus onData(Buffer::Instance& data) override {
+        parent_.onData(data);
+        return Network::FilterStatus::StopIteration;
+      }
+
+      Client& parent_;
+    };
+
+    TcpLoadGenerator& parent_;
+    Network::ClientConnectionPtr connection_;
+    StartTime start_;
+    uint64_t received_{};
+  };
+
+  typedef std::unique_ptr<Client> ClientPtr;
+
+  std::vector<ClientPtr> clients_;
+};
+
+/**
+ * The proxy under load, with a fake upstream for each of its HTTP and TCP proxy listeners.
+ */
+class ProxyLoadTest : public BaseIntegrationTest {
+public:
+  ProxyLoadTest(Mode mode, uint64_t chunk_size, uint32_t chunks)
+      : BaseIntegrationTest(Network::Address::IpVersion::v4), mode_(mode), chunk_size_(chunk_size),
+        chunks_(chunks), responder_(mode, chunk_size, chunks) {
+    fake_upstreams_.emplace_back(new FakeUpstream(0, FakeHttpConnection::Type::HTTP1, version_));
+    fake_upstreams_.back()->setFilterChainFactory(responder_);
+    registerPort("upstream_http", fake_upstreams_.back()->localAddress()->ip()->port());
+    fake_upstreams_.emplace_back(new FakeUpstream(0, FakeHttpConnection::Type::HTTP1, version_));
+    fake_upstreams_.back()->setFilterChainFactory(responder_);
+    registerPort("upstream_tcp", fake_upstreams_.back()->localAddress()->ip()->port());
+    createTestServer("test/config/integration/server_load.json", {"http", "tcp_proxy"});
+  }
+
+  ~ProxyLoadTest() {
+    // The upstream connections use the responder.
+    test_server_.reset();
+    fake_upstreams_.clear();
+  }
+
+  LoadGeneratorPtr startLoad(uint32_t concurrency) {
+    switch (mode_) {
+    case Mode::Http1:
+      return LoadGeneratorPtr{new HttpLoadGenerator(*this, lookupPort("http"),
+                                                    Http::CodecClient::Type::HTTP1, concurrency,
+                                                    chunk_size_, chunks_)};
+    case Mode::Http2:
+      return LoadGeneratorPtr{new HttpLoadGenerator(*this, lookupPort("http"),
+                                                    Http::CodecClient::Type::HTTP2, concurrency,
+                                                    chunk_size_, chunks_)};
+    case Mode::TcpProxy:
+      return LoadGeneratorPtr{
+          new TcpLoadGenerator(*this, lookupPort("tcp_proxy"), concurrency, chunk_size_, chunks_)};
+    }
+    NOT_REACHED;
+  }
+
+private:
+  const Mode mode_;
+  const uint64_t chunk_size_;
+  const uint32_t chunks_;
+  AutoResponder responder_;
+};
+
+// "bazel run" does not set up the environment that "bazel test" gives the integration test
+// framework, so default to the runfiles tree that the binary is started in.
+void initializeEnvironment() {
+  static bool initialized = false;
+  if (initialized) {
+    return;
+  }
+  initialized = true;
+
+  char cwd[PATH_MAX];
+  RELEASE_ASSERT(::getcwd(cwd, sizeof(cwd)) != nullptr);
+  ::setenv("TEST_RUNDIR", cwd, 0);
+  ::setenv("TEST_TMPDIR", "/tmp", 0);
+  static char name[] = "proxy_speed_test";
+  static char* argv[] = {name, nullptr};
+  TestEnvironment::initializeOptions(1, argv);
+}
+
+double processCpuSeconds() {
+  struct rusage usage;
+  RELEASE_ASSERT(::getrusage(RUSAGE_SELF, &usage) == 0);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Arguments are the number of requests in flight, the size of each body chunk in bytes, and the
+// number of chunks in each request and response body. Bodies of a single chunk have a
+// content-length, bodies of more chunks are streamed.
+void BM_ProxyLoad(benchmark::State& state, Mode mode) {
+  initializeEnvironment();
+  const uint32_t concurrency = state.range(0);
+  ProxyLoadTest test(mode, state.range(1), state.range(2));
+  LoadGeneratorPtr load = test.startLoad(concurrency);
+
+  // Warm up the connection pools and the allocator before measuring.
+  load->waitForCompletions(concurrency * 10);
+  load->startRecording();
+  const double cpu_start = processCpuSeconds();
+  while (state.KeepRunning()) {
+    load->waitForCompletions(1);
+  }
+  const double cpu_seconds = processCpuSeconds() - cpu_start;
+
+  state.SetItemsProcessed(state.iterations());
+  state.counters["p50_us"] = load->latencyPercentile(50);
+  state.counters["p90_us"] = load->latencyPercentile(90);
+  state.counters["p99_us"] = load->latencyPercentile(99);
+  state.counters["p999_us"] = load->latencyPercentile(99.9);
+  state.counters["cpu_us_per_request"] = cpu_seconds * 1e6 / state.iterations();
+  state.counters["errors"] = load->errors();
+}
+
+void httpArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int concurrency : {1, 16, 128}) {
+    benchmark->Args({concurrency, 0, 1});
+    benchmark->Args({concurrency, 4096, 1});
+    benchmark->Args({concurrency, 16384, 16});
+  }
+}
+
+void tcpArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int concurrency : {1, 16, 128}) {
+    benchmark->Args({concurrency, 4096, 1});
+    benchmark->Args({concurrency, 16384, 16});
+  }
+}
+
+BENCHMARK_CAPTURE(BM_ProxyLoad, Http1, Mode::Http1)
+    ->Apply(httpArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_ProxyLoad, Http2, Mode::Http2)
+    ->Apply(httpArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_ProxyLoad, TcpProxy, Mode::TcpProxy)
+    ->Apply(tcpArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace Envoy
@@ -6,6 +6,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "envoy/server/options.h"
 
@@ -35,13 +36,24 @@ public:
   // Server::Options
   uint64_t baseId() override { return 0; }
   uint32_t concurrency() override { return 1; }
+  const std::vector<uint32_t>& cpuset() override { return cpuset_; }
   const std::string& configPath() override { return config_path_; }
+  const std::vector<std::string>& additionalConfigPaths() override {
+    return additional_config_paths_;
+  }
   const std::string& adminAddressPath() override { return admin_address_path_; }
+  const std::string& startupTracePath() override { return startup_trace_path_; }
+  const std::string& configSnapshotDir() override { return config_snapshot_dir_; }
   Network::Address::IpVersion localAddressIpVersion() override { return local_address_ip_version_; }
   std::chrono::seconds drainTime() override { return std::chrono::seconds(1); }
+  uint64_t drainCloseRate() override { return 0; }
   spdlog::level::level_enum logLevel() override { NOT_IMPLEMENTED; }
+  uint64_t logQueueSize() override { NOT_IMPLEMENTED; }
   std::chrono::seconds parentShutdownTime() override { return std::chrono::seconds(2); }
   uint64_t restartEpoch() override { return 0; }
+  uint64_t maxStats() override { return 16384; }
+  uint64_t maxRecycledObjects() override { return 0; }
+  bool epollChangelist() override { return false; }
   std::chrono::milliseconds fileFlushIntervalMsec() override {
     return std::chrono::milliseconds(10000);
   }
@@ -52,11 +64,15 @@ public:
 
 private:
   const std::string config_path_;
+  const std::vector<std::string> additional_config_paths_;
   const std::string admin_address_path_;
+  const std::string startup_trace_path_;
+  const std::string config_snapshot_dir_;
   const Network::Address::IpVersion local_address_ip_version_;
   const std::string service_cluster_name_;
   const std::string service_node_name_;
   const std::string service_zone_;
+  const std::vector<uint32_t> cpuset_;
 };
 
 class TestDrainManager : public DrainManager {
@@ -163,6 +179,26 @@ public:
     std::unique_lock<std::mutex> lock(lock_);
     return store_.gauges();
   }
+  std::list<HistogramSharedPtr> histograms() const override {
+    std::unique_lock<std::mutex> lock(lock_);
+    return store_.histograms();
+  }
+  void forEachCounter(CounterCb callback) const override {
+    std::unique_lock<std::mutex> lock(lock_);
+    store_.forEachCounter(callback);
+  }
+  void forEachGauge(GaugeCb callback) const override {
+    std::unique_lock<std::mutex> lock(lock_);
+    store_.forEachGauge(callback);
+  }
+  void forEachChangedCounter(CounterCb callback) const override {
+    std::unique_lock<std::mutex> lock(lock_);
+    store_.forEachChangedCounter(callback);
+  }
+  void forEachChangedGauge(GaugeCb callback) const override {
+    std::unique_lock<std::mutex> lock(lock_);
+    store_.forEachChangedGauge(callback);
+  }
 
   // Stats::StoreRoot
   void addSink(Sink&) override {}
@@ -15,13 +15,17 @@ public:
     ON_CALL(*this, write(testing::_))
         .WillByDefault(testing::Invoke(this, &MockBuffer::trackWrites));
     ON_CALL(*this, move(testing::_)).WillByDefault(testing::Invoke(this, &MockBuffer::baseMove));
+    ON_CALL(*this, add(testing::_)).WillByDefault(testing::Invoke(this, &MockBuffer::baseAdd));
   }
 
+  using Buffer::OwnedImpl::add;
+  MOCK_METHOD1(add, void(const Instance& data));
   MOCK_METHOD1(write, int(int fd));
   MOCK_METHOD1(move, void(Instance& rhs));
   MOCK_METHOD2(move, void(Instance& rhs, uint64_t length));
   MOCK_METHOD1(drain, void(uint64_t size));
 
+  void baseAdd(const Instance& data) { Buffer::OwnedImpl::add(data); }
   void baseMove(Instance& rhs) { Buffer::OwnedImpl::move(rhs); }
   void baseDrain(uint64_t size) { Buffer::OwnedImpl::drain(size); }
 
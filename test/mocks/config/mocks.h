@@ -16,6 +16,17 @@ public:
   MOCK_METHOD1_T(onConfigUpdateFailed, void(const EnvoyException* e));
 };
 
+template <class ResourceType>
+class MockDeltaSubscriptionCallbacks : public DeltaSubscriptionCallbacks<ResourceType> {
+public:
+  MOCK_METHOD3_T(onConfigUpdate,
+                 void(const typename DeltaSubscriptionCallbacks<ResourceType>::ResourceVector&
+                          added_or_changed,
+                      const std::vector<uint64_t>& hashes,
+                      const std::vector<std::string>& removed));
+  MOCK_METHOD1_T(onConfigUpdateFailed, void(const EnvoyException* e));
+};
+
 template <class ResourceType> class MockSubscription : public Subscription<ResourceType> {
 public:
   MOCK_METHOD2_T(start, void(const std::vector<std::string>& resources,
@@ -1,5 +1,7 @@
 #include "mocks.h"
 
+#include "common/common/utility.h"
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -8,6 +10,7 @@ using testing::Invoke;
 using testing::NiceMock;
 using testing::Return;
 using testing::ReturnNew;
+using testing::ReturnRef;
 using testing::SaveArg;
 using testing::_;
 
@@ -19,6 +22,9 @@ MockDispatcher::MockDispatcher() {
   }));
   ON_CALL(*this, createTimer_(_)).WillByDefault(ReturnNew<NiceMock<Event::MockTimer>>());
   ON_CALL(*this, post(_)).WillByDefault(Invoke([](PostCb cb) -> void { cb(); }));
+  ON_CALL(*this, approximateSystemTime()).WillByDefault(ReturnRef(ProdSystemTimeSource::instance_));
+  ON_CALL(*this, approximateMonotonicTime())
+      .WillByDefault(ReturnRef(ProdMonotonicTimeSource::instance_));
 }
 
 MockDispatcher::~MockDispatcher() {}
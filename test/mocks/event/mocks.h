@@ -67,6 +67,8 @@ public:
 
   TimerPtr createTimer(TimerCb cb) override { return TimerPtr{createTimer_(cb)}; }
 
+  TimerPtr createCoarseTimer(TimerCb cb) override { return TimerPtr{createTimer_(cb)}; }
+
   void deferredDelete(DeferredDeletablePtr&& to_delete) override {
     deferredDelete_(to_delete);
     if (to_delete) {
@@ -106,10 +108,15 @@ public:
   MOCK_METHOD1(createTimer_, Timer*(TimerCb cb));
   MOCK_METHOD1(deferredDelete_, void(DeferredDeletablePtr& to_delete));
   MOCK_METHOD0(exit, void());
+  MOCK_METHOD2(initializeStats, void(Stats::Scope& scope, const std::string& prefix));
+  MOCK_METHOD1(gauge, Stats::Gauge*(const std::string& name));
+  MOCK_METHOD0(loopDelay, std::chrono::milliseconds());
   MOCK_METHOD2(listenForSignal_, SignalEvent*(int signal_num, SignalCb cb));
   MOCK_METHOD1(post, void(std::function<void()> callback));
   MOCK_METHOD1(run, void(RunType type));
   Buffer::Factory& getBufferFactory() override { return *buffer_factory_; }
+  MOCK_METHOD0(approximateSystemTime, SystemTimeSource&());
+  MOCK_METHOD0(approximateMonotonicTime, MonotonicTimeSource&());
 
 private:
   std::list<DeferredDeletablePtr> to_delete_;
@@ -29,6 +29,15 @@ ssize_t MockOsSysCalls::write(int fd, const void* buffer, size_t num_bytes) {
   return result;
 }
 
+ssize_t MockOsSysCalls::writev(int fd, const iovec* iov, int num_iov) {
+  // Tests see the buffers as a single write.
+  std::string buffer;
+  for (int i = 0; i < num_iov; i++) {
+    buffer.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+  }
+  return write(fd, buffer.data(), buffer.size());
+}
+
 MockFile::MockFile() {}
 MockFile::~MockFile() {}
 
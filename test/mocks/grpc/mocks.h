@@ -29,7 +29,7 @@ public:
 template <class ResponseType>
 class MockAsyncRequestCallbacks : public AsyncRequestCallbacks<ResponseType> {
 public:
-  void onSuccess(std::unique_ptr<ResponseType>&& response) { onSuccess_(*response); }
+  void onSuccess(ResponsePtr<ResponseType>&& response) { onSuccess_(*response); }
 
   MOCK_METHOD1_T(onCreateInitialMetadata, void(Http::HeaderMap& metadata));
   MOCK_METHOD1_T(onSuccess_, void(const ResponseType& response));
@@ -43,7 +43,7 @@ public:
     onReceiveInitialMetadata_(*metadata);
   }
 
-  void onReceiveMessage(std::unique_ptr<ResponseType>&& message) { onReceiveMessage_(*message); }
+  void onReceiveMessage(ResponsePtr<ResponseType>&& message) { onReceiveMessage_(*message); }
 
   void onReceiveTrailingMetadata(Http::HeaderMapPtr&& metadata) {
     onReceiveTrailingMetadata_(*metadata);
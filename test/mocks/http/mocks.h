@@ -52,6 +52,8 @@ public:
   MOCK_METHOD1(requestReceivedDuration, void(MonotonicTime time));
   MOCK_CONST_METHOD0(responseReceivedDuration, std::chrono::microseconds());
   MOCK_METHOD1(responseReceivedDuration, void(MonotonicTime time));
+  MOCK_METHOD2(timing, void(RequestTiming point, MonotonicTime time));
+  MOCK_CONST_METHOD1(timing, Optional<std::chrono::microseconds>(RequestTiming point));
   MOCK_CONST_METHOD0(bytesReceived, uint64_t());
   MOCK_CONST_METHOD0(protocol, Protocol());
   MOCK_METHOD1(protocol, void(Protocol protocol));
@@ -102,6 +104,7 @@ public:
   MOCK_METHOD0(localAddress, const Network::Address::Instance&());
   MOCK_METHOD0(userAgent, const Optional<std::string>&());
   MOCK_METHOD0(tracingConfig, const Http::TracingConnectionManagerConfig*());
+  MOCK_METHOD0(plainProxy, bool());
 };
 
 class MockConnectionCallbacks : public virtual ConnectionCallbacks {
@@ -212,6 +215,7 @@ public:
 
   // Http::ClientConnection
   MOCK_METHOD1(newStream, StreamEncoder&(StreamDecoder& response_decoder));
+  MOCK_METHOD0(maxConcurrentStreams, uint32_t());
 };
 
 class MockFilterChainFactory : public FilterChainFactory {
@@ -221,6 +225,7 @@ public:
 
   // Http::FilterChainFactory
   MOCK_METHOD1(createFilterChain, void(FilterChainFactoryCallbacks& callbacks));
+  MOCK_METHOD0(filterChainSize, FilterChainSize());
 };
 
 class MockStreamFilterCallbacksBase {
@@ -367,6 +372,14 @@ public:
     return send_(request, callbacks, timeout);
   }
 
+  // Direct requests are expected like routed requests, so tests need not care which path the
+  // code under test takes.
+  Request* sendDirect(MessagePtr&& request, Callbacks& callbacks,
+                      const Optional<std::chrono::milliseconds>& timeout,
+                      const std::string&) override {
+    return send_(request, callbacks, timeout);
+  }
+
   MOCK_METHOD3(send_, Request*(MessagePtr& request, Callbacks& callbacks,
                                const Optional<std::chrono::milliseconds>& timeout));
 
@@ -467,6 +480,7 @@ public:
   MOCK_METHOD1(addDrainedCallback, void(DrainedCb cb));
   MOCK_METHOD2(newStream, Cancellable*(Http::StreamDecoder& response_decoder,
                                        Http::ConnectionPool::Callbacks& callbacks));
+  MOCK_METHOD0(prefetchConnections, void());
 
   std::shared_ptr<testing::NiceMock<Upstream::MockHostDescription>> host_{
       new testing::NiceMock<Upstream::MockHostDescription>()};
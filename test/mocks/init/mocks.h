@@ -18,6 +18,7 @@ public:
   ~MockTarget();
 
   MOCK_METHOD1(initialize, void(std::function<void()> callback));
+  MOCK_CONST_METHOD0(name, std::string());
 
   std::function<void()> callback_;
 };
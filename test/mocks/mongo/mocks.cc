@@ -0,0 +1,21 @@
+#include "mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Mongo {
+namespace ConnPool {
+
+MockPoolRequest::MockPoolRequest() {}
+MockPoolRequest::~MockPoolRequest() {}
+
+MockPoolCallbacks::MockPoolCallbacks() {}
+MockPoolCallbacks::~MockPoolCallbacks() {}
+
+MockInstance::MockInstance() {}
+MockInstance::~MockInstance() {}
+
+} // namespace ConnPool
+} // namespace Mongo
+} // namespace Envoy
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "envoy/mongo/conn_pool.h"
+
+#include "gmock/gmock.h"
+
+namespace Envoy {
+namespace Mongo {
+namespace ConnPool {
+
+class MockPoolRequest : public PoolRequest {
+public:
+  MockPoolRequest();
+  ~MockPoolRequest();
+
+  MOCK_METHOD0(cancel, void());
+};
+
+class MockPoolCallbacks : public PoolCallbacks {
+public:
+  MockPoolCallbacks();
+  ~MockPoolCallbacks();
+
+  MOCK_METHOD2(onReply, void(const MessageHeader& header, Buffer::Instance& body));
+  MOCK_METHOD0(onFailure, void());
+};
+
+class MockInstance : public Instance {
+public:
+  MockInstance();
+  ~MockInstance();
+
+  MOCK_METHOD3(makeRequest, PoolRequest*(const MessageHeader& header, Buffer::Instance& body,
+                                         PoolCallbacks& callbacks));
+  MOCK_METHOD2(send, bool(const MessageHeader& header, Buffer::Instance& body));
+};
+
+} // namespace ConnPool
+} // namespace Mongo
+} // namespace Envoy
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <list>
 #include <string>
@@ -48,6 +49,7 @@ public:
 
   // Network::Connection
   MOCK_METHOD1(addConnectionCallbacks, void(ConnectionCallbacks& cb));
+  MOCK_METHOD1(removeConnectionCallbacks, void(ConnectionCallbacks& cb));
   MOCK_METHOD1(addWriteFilter, void(WriteFilterSharedPtr filter));
   MOCK_METHOD1(addFilter, void(FilterSharedPtr filter));
   MOCK_METHOD1(addReadFilter, void(ReadFilterSharedPtr filter));
@@ -68,8 +70,13 @@ public:
   MOCK_METHOD1(write, void(Buffer::Instance& data));
   MOCK_METHOD1(setBufferLimits, void(uint32_t limit));
   MOCK_CONST_METHOD0(bufferLimit, uint32_t());
+  MOCK_METHOD3(setEventByteBudget, void(uint32_t bytes, Stats::Counter& read_exhausted,
+                                        Stats::Counter& write_exhausted));
   MOCK_CONST_METHOD0(usingOriginalDst, bool());
   MOCK_CONST_METHOD0(aboveHighWatermark, bool());
+  MOCK_CONST_METHOD0(bufferedBytes, uint64_t());
+  MOCK_METHOD1(spliceTo, bool(Connection& peer));
+  MOCK_METHOD0(shrinkBuffers, void());
 };
 
 /**
@@ -83,6 +90,7 @@ public:
 
   // Network::Connection
   MOCK_METHOD1(addConnectionCallbacks, void(ConnectionCallbacks& cb));
+  MOCK_METHOD1(removeConnectionCallbacks, void(ConnectionCallbacks& cb));
   MOCK_METHOD1(addWriteFilter, void(WriteFilterSharedPtr filter));
   MOCK_METHOD1(addFilter, void(FilterSharedPtr filter));
   MOCK_METHOD1(addReadFilter, void(ReadFilterSharedPtr filter));
@@ -103,11 +111,19 @@ public:
   MOCK_METHOD1(write, void(Buffer::Instance& data));
   MOCK_METHOD1(setBufferLimits, void(uint32_t limit));
   MOCK_CONST_METHOD0(bufferLimit, uint32_t());
+  MOCK_METHOD3(setEventByteBudget, void(uint32_t bytes, Stats::Counter& read_exhausted,
+                                        Stats::Counter& write_exhausted));
   MOCK_CONST_METHOD0(usingOriginalDst, bool());
   MOCK_CONST_METHOD0(aboveHighWatermark, bool());
+  MOCK_CONST_METHOD0(bufferedBytes, uint64_t());
+  MOCK_METHOD1(spliceTo, bool(Connection& peer));
+  MOCK_METHOD0(shrinkBuffers, void());
 
   // Network::ClientConnection
   MOCK_METHOD0(connect, void());
+  MOCK_METHOD1(enableTcpFastOpen, void(Stats::Counter& syn_data_accepted));
+  MOCK_METHOD2(enableHappyEyeballs, void(Address::InstanceConstSharedPtr fallback_address,
+                                         std::chrono::milliseconds delay));
 };
 
 class MockActiveDnsQuery : public ActiveDnsQuery {
@@ -185,9 +201,21 @@ public:
 
   void onNewConnection(ConnectionPtr&& conn) override { onNewConnection_(conn); }
 
+  MOCK_METHOD4(onAccept, bool(int fd, Address::InstanceConstSharedPtr remote_address,
+                              Address::InstanceConstSharedPtr local_address,
+                              bool using_original_dst));
   MOCK_METHOD1(onNewConnection_, void(ConnectionPtr& conn));
 };
 
+class MockAcceptLimiter : public AcceptLimiter {
+public:
+  MockAcceptLimiter();
+  ~MockAcceptLimiter();
+
+  MOCK_METHOD0(tryAccept, bool());
+  MOCK_CONST_METHOD0(retryInterval, std::chrono::milliseconds());
+};
+
 class MockDrainDecision : public DrainDecision {
 public:
   MockDrainDecision();
@@ -222,6 +250,11 @@ public:
   ~MockListener();
 
   MOCK_METHOD0(onDestroy, void());
+  MOCK_METHOD0(disable, void());
+  MOCK_METHOD0(enable, void());
+  MOCK_METHOD4(newConnection, void(int fd, Address::InstanceConstSharedPtr remote_address,
+                                   Address::InstanceConstSharedPtr local_address,
+                                   bool using_original_dst));
 };
 
 class MockConnectionHandler : public ConnectionHandler {
@@ -243,6 +276,7 @@ public:
   MOCK_METHOD1(removeListeners, void(uint64_t listener_tag));
   MOCK_METHOD1(stopListeners, void(uint64_t listener_tag));
   MOCK_METHOD0(stopListeners, void());
+  MOCK_METHOD1(applyOverloadActions, void(const OverloadActions& actions));
 };
 
 } // namespace Network
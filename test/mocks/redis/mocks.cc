@@ -81,7 +81,12 @@ MockPoolRequest::~MockPoolRequest() {}
 MockPoolCallbacks::MockPoolCallbacks() {}
 MockPoolCallbacks::~MockPoolCallbacks() {}
 
-MockInstance::MockInstance() {}
+MockInstance::MockInstance() {
+  // Reads are made like any other request, unless a test expects otherwise.
+  ON_CALL(*this, makeReadRequest(_, _, _))
+      .WillByDefault(Invoke(this, &MockInstance::makeRequest));
+}
+
 MockInstance::~MockInstance() {}
 
 } // namespace ConnPool
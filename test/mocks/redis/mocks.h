@@ -83,6 +83,10 @@ public:
 
   MOCK_METHOD3(makeRequest, PoolRequest*(const std::string& hash_key, const RespValue& request,
                                          PoolCallbacks& callbacks));
+  MOCK_METHOD3(makeReadRequest, PoolRequest*(const std::string& hash_key,
+                                             const RespValue& request, PoolCallbacks& callbacks));
+  MOCK_CONST_METHOD0(clusterMode, bool());
+  MOCK_METHOD1(hostForKey, Upstream::HostConstSharedPtr(const std::string& hash_key));
 };
 
 } // namespace ConnPool
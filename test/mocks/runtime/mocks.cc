@@ -1,11 +1,15 @@
 #include "mocks.h"
 
+#include "common/common/empty_string.h"
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace Envoy {
+using testing::Invoke;
 using testing::Return;
 using testing::ReturnArg;
+using testing::ReturnRef;
 using testing::_;
 
 namespace Runtime {
@@ -14,7 +18,11 @@ MockRandomGenerator::MockRandomGenerator() { ON_CALL(*this, uuid()).WillByDefaul
 
 MockRandomGenerator::~MockRandomGenerator() {}
 
-MockSnapshot::MockSnapshot() { ON_CALL(*this, getInteger(_, _)).WillByDefault(ReturnArg<1>()); }
+MockSnapshot::MockSnapshot() {
+  ON_CALL(*this, get(_)).WillByDefault(ReturnRef(EMPTY_STRING));
+  ON_CALL(*this, getInteger(_, _)).WillByDefault(ReturnArg<1>());
+  ON_CALL(*this, version()).WillByDefault(Invoke([this]() -> uint64_t { return ++version_; }));
+}
 
 MockSnapshot::~MockSnapshot() {}
 
@@ -33,6 +33,11 @@ public:
                                           uint64_t random_value, uint16_t num_buckets));
   MOCK_CONST_METHOD1(get, const std::string&(const std::string& key));
   MOCK_CONST_METHOD2(getInteger, uint64_t(const std::string& key, uint64_t default_value));
+  MOCK_CONST_METHOD0(version, uint64_t());
+
+  // Tests change what the snapshot returns without replacing it, so by default every call reports
+  // a new version.
+  uint64_t version_{};
 };
 
 class MockLoader : public Loader {
@@ -20,10 +20,14 @@ namespace Server {
 MockOptions::MockOptions(const std::string& config_path)
     : config_path_(config_path), admin_address_path_("") {
   ON_CALL(*this, configPath()).WillByDefault(ReturnRef(config_path_));
+  ON_CALL(*this, additionalConfigPaths()).WillByDefault(ReturnRef(additional_config_paths_));
   ON_CALL(*this, adminAddressPath()).WillByDefault(ReturnRef(admin_address_path_));
+  ON_CALL(*this, startupTracePath()).WillByDefault(ReturnRef(startup_trace_path_));
+  ON_CALL(*this, configSnapshotDir()).WillByDefault(ReturnRef(config_snapshot_dir_));
   ON_CALL(*this, serviceClusterName()).WillByDefault(ReturnRef(service_cluster_name_));
   ON_CALL(*this, serviceNodeName()).WillByDefault(ReturnRef(service_node_name_));
   ON_CALL(*this, serviceZone()).WillByDefault(ReturnRef(service_zone_name_));
+  ON_CALL(*this, cpuset()).WillByDefault(ReturnRef(cpuset_));
 }
 MockOptions::~MockOptions() {}
 
@@ -49,6 +53,10 @@ MockHotRestart::~MockHotRestart() {}
 MockListenerComponentFactory::MockListenerComponentFactory()
     : socket_(std::make_shared<NiceMock<Network::MockListenSocket>>()) {
   ON_CALL(*this, createListenSocket(_, _)).WillByDefault(Return(socket_));
+  ON_CALL(*this, createReusePortListenSockets(_, _))
+      .WillByDefault(Invoke([this](Network::Address::InstanceConstSharedPtr, uint32_t count) {
+        return std::vector<Network::ListenSocketSharedPtr>(count, socket_);
+      }));
 }
 MockListenerComponentFactory::~MockListenerComponentFactory() {}
 
@@ -58,6 +66,7 @@ MockListenerManager::~MockListenerManager() {}
 MockListener::MockListener() {
   ON_CALL(*this, filterChainFactory()).WillByDefault(ReturnRef(filter_chain_factory_));
   ON_CALL(*this, socket()).WillByDefault(ReturnRef(socket_));
+  ON_CALL(*this, workerSocket(_)).WillByDefault(ReturnRef(socket_));
   ON_CALL(*this, listenerScope()).WillByDefault(ReturnRef(scope_));
   ON_CALL(*this, name()).WillByDefault(ReturnRef(name_));
 }
@@ -102,6 +111,7 @@ MockInstance::MockInstance()
   ON_CALL(*this, initManager()).WillByDefault(ReturnRef(init_manager_));
   ON_CALL(*this, listenerManager()).WillByDefault(ReturnRef(listener_manager_));
   ON_CALL(*this, singletonManager()).WillByDefault(ReturnRef(*singleton_manager_));
+  ON_CALL(*this, startupPhaseTimes()).WillByDefault(ReturnRef(startup_phase_times_));
 }
 
 MockInstance::~MockInstance() {}
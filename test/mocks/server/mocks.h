@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <list>
 #include <string>
+#include <vector>
 
 #include "envoy/server/admin.h"
 #include "envoy/server/configuration.h"
@@ -45,13 +46,22 @@ public:
 
   MOCK_METHOD0(baseId, uint64_t());
   MOCK_METHOD0(concurrency, uint32_t());
+  MOCK_METHOD0(cpuset, const std::vector<uint32_t>&());
   MOCK_METHOD0(configPath, const std::string&());
+  MOCK_METHOD0(additionalConfigPaths, const std::vector<std::string>&());
   MOCK_METHOD0(adminAddressPath, const std::string&());
+  MOCK_METHOD0(startupTracePath, const std::string&());
+  MOCK_METHOD0(configSnapshotDir, const std::string&());
   MOCK_METHOD0(localAddressIpVersion, Network::Address::IpVersion());
   MOCK_METHOD0(drainTime, std::chrono::seconds());
+  MOCK_METHOD0(drainCloseRate, uint64_t());
   MOCK_METHOD0(logLevel, spdlog::level::level_enum());
+  MOCK_METHOD0(logQueueSize, uint64_t());
   MOCK_METHOD0(parentShutdownTime, std::chrono::seconds());
   MOCK_METHOD0(restartEpoch, uint64_t());
+  MOCK_METHOD0(maxStats, uint64_t());
+  MOCK_METHOD0(maxRecycledObjects, uint64_t());
+  MOCK_METHOD0(epollChangelist, bool());
   MOCK_METHOD0(fileFlushIntervalMsec, std::chrono::milliseconds());
   MOCK_CONST_METHOD0(mode, Mode());
   MOCK_METHOD0(serviceClusterName, const std::string&());
@@ -59,10 +69,14 @@ public:
   MOCK_METHOD0(serviceZone, const std::string&());
 
   std::string config_path_;
+  std::vector<std::string> additional_config_paths_;
   std::string admin_address_path_;
+  std::string startup_trace_path_;
+  std::string config_snapshot_dir_;
   std::string service_cluster_name_;
   std::string service_node_name_;
   std::string service_zone_name_;
+  std::vector<uint32_t> cpuset_;
 };
 
 class MockAdmin : public Admin {
@@ -121,8 +135,11 @@ public:
 
   // Server::HotRestart
   MOCK_METHOD0(drainParentListeners, void());
-  MOCK_METHOD1(duplicateParentListenSocket, int(const std::string& address));
+  MOCK_METHOD2(duplicateParentListenSocket,
+               int(const std::string& address, uint32_t worker_index));
   MOCK_METHOD1(getParentStats, void(GetParentStatsInfo& info));
+  MOCK_METHOD1(getParentUnhealthyHosts, void(std::vector<UnhealthyHostInfo>& hosts));
+  MOCK_METHOD1(getStatsRegionInfo, void(StatsRegionInfo& info));
   MOCK_METHOD2(initialize, void(Event::Dispatcher& dispatcher, Server::Instance& server));
   MOCK_METHOD1(shutdownParentAdmin, void(ShutdownParentAdminInfo& info));
   MOCK_METHOD0(terminateParent, void());
@@ -144,6 +161,9 @@ public:
   MOCK_METHOD2(createListenSocket,
                Network::ListenSocketSharedPtr(Network::Address::InstanceConstSharedPtr address,
                                               bool bind_to_port));
+  MOCK_METHOD2(createReusePortListenSockets,
+               std::vector<Network::ListenSocketSharedPtr>(
+                   Network::Address::InstanceConstSharedPtr address, uint32_t count));
   MOCK_METHOD0(createDrainManager_, DrainManager*());
   MOCK_METHOD0(nextListenerTag, uint64_t());
 
@@ -156,12 +176,15 @@ public:
   ~MockListenerManager();
 
   MOCK_METHOD1(addOrUpdateListener, bool(const envoy::api::v2::Listener& config));
+  MOCK_METHOD2(addOrUpdateListener, bool(const envoy::api::v2::Listener& config, uint64_t hash));
   MOCK_METHOD0(listeners, std::vector<std::reference_wrapper<Listener>>());
   MOCK_METHOD0(numConnections, uint64_t());
   MOCK_METHOD1(removeListener, bool(const std::string& listener_name));
   MOCK_METHOD1(startWorkers, void(GuardDog& guard_dog));
   MOCK_METHOD0(stopListeners, void());
   MOCK_METHOD0(stopWorkers, void());
+  MOCK_METHOD1(applyOverloadActions, void(const Network::OverloadActions& actions));
+  MOCK_METHOD0(workerLoopDelay, std::chrono::milliseconds());
 };
 
 class MockListener : public Listener {
@@ -171,11 +194,17 @@ public:
 
   MOCK_METHOD0(filterChainFactory, Network::FilterChainFactory&());
   MOCK_METHOD0(socket, Network::ListenSocket&());
+  MOCK_METHOD1(workerSocket, Network::ListenSocket&(uint32_t worker_index));
   MOCK_METHOD0(sslContext, Ssl::ServerContext*());
   MOCK_METHOD0(useProxyProto, bool());
   MOCK_METHOD0(bindToPort, bool());
   MOCK_METHOD0(useOriginalDst, bool());
   MOCK_METHOD0(perConnectionBufferLimitBytes, uint32_t());
+  MOCK_METHOD0(connectionBalanceThreshold, uint32_t());
+  MOCK_METHOD0(tcpFastOpen, bool());
+  MOCK_METHOD0(perEventByteBudget, uint32_t());
+  MOCK_METHOD0(maxAcceptsPerWakeup, uint32_t());
+  MOCK_METHOD0(acceptLimiter, Network::AcceptLimiter*());
   MOCK_METHOD0(listenerScope, Stats::Scope&());
   MOCK_METHOD0(listenerTag, uint64_t());
   MOCK_CONST_METHOD0(name, const std::string&());
@@ -192,7 +221,7 @@ public:
   ~MockWorkerFactory();
 
   // Server::WorkerFactory
-  WorkerPtr createWorker() override { return WorkerPtr{createWorker_()}; }
+  WorkerPtr createWorker(uint32_t) override { return WorkerPtr{createWorker_()}; }
 
   MOCK_METHOD0(createWorker_, Worker*());
 };
@@ -222,6 +251,8 @@ public:
   MOCK_METHOD0(stop, void());
   MOCK_METHOD1(stopListener, void(Listener& listener));
   MOCK_METHOD0(stopListeners, void());
+  MOCK_METHOD1(applyOverloadActions, void(const Network::OverloadActions& actions));
+  MOCK_METHOD0(loopDelay, std::chrono::milliseconds());
 
   AddListenerCompletion add_listener_completion_;
   std::function<void()> remove_listener_completion_;
@@ -261,6 +292,7 @@ public:
   MOCK_METHOD0(singletonManager, Singleton::Manager&());
   MOCK_METHOD0(startTimeCurrentEpoch, time_t());
   MOCK_METHOD0(startTimeFirstEpoch, time_t());
+  MOCK_METHOD0(startupPhaseTimes, const StartupPhaseTimes&());
   MOCK_METHOD0(stats, Stats::Store&());
   MOCK_METHOD0(httpTracer, Tracing::HttpTracer&());
   MOCK_METHOD0(threadLocal, ThreadLocal::Instance&());
@@ -287,6 +319,7 @@ public:
   testing::NiceMock<Init::MockManager> init_manager_;
   testing::NiceMock<MockListenerManager> listener_manager_;
   Singleton::ManagerPtr singleton_manager_;
+  StartupPhaseTimes startup_phase_times_;
 };
 
 namespace Configuration {
@@ -301,6 +334,8 @@ public:
   MOCK_METHOD0(rateLimitClientFactory, RateLimit::ClientFactory&());
   MOCK_METHOD0(statsdTcpClusterName, Optional<std::string>());
   MOCK_METHOD0(statsdUdpIpAddress, Network::Address::InstanceConstSharedPtr());
+  MOCK_METHOD0(statsdUdpMaxPacketSize, uint64_t());
+  MOCK_METHOD0(metricsServiceClusterName, Optional<std::string>());
   MOCK_METHOD0(statsFlushInterval, std::chrono::milliseconds());
   MOCK_CONST_METHOD0(wdMissTimeout, std::chrono::milliseconds());
   MOCK_CONST_METHOD0(wdMegaMissTimeout, std::chrono::milliseconds());
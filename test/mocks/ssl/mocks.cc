@@ -1,12 +1,17 @@
 #include "mocks.h"
 
+using testing::ReturnRef;
+
 namespace Envoy {
 namespace Ssl {
 
 MockContextManager::MockContextManager() {}
 MockContextManager::~MockContextManager() {}
 
-MockConnection::MockConnection() {}
+MockConnection::MockConnection() {
+  ON_CALL(*this, sha256PeerCertificateDigest()).WillByDefault(ReturnRef(sha256_digest_));
+}
+
 MockConnection::~MockConnection() {}
 
 MockClientContext::MockClientContext() {}
@@ -44,9 +44,12 @@ public:
 
   MOCK_METHOD0(peerCertificatePresented, bool());
   MOCK_METHOD0(uriSanLocalCertificate, std::string());
-  MOCK_METHOD0(sha256PeerCertificateDigest, std::string());
+  MOCK_METHOD0(sha256PeerCertificateDigest, const std::string&());
   MOCK_METHOD0(subjectPeerCertificate, std::string());
   MOCK_METHOD0(uriSanPeerCertificate, std::string());
+  MOCK_METHOD0(handshakeStartTime, MonotonicTime());
+
+  std::string sha256_digest_;
 };
 
 class MockClientContext : public ClientContext {
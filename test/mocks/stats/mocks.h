@@ -22,6 +22,7 @@ public:
   ~MockCounter();
 
   MOCK_METHOD1(add, void(uint64_t amount));
+  MOCK_METHOD0(clearChanged, bool());
   MOCK_METHOD0(inc, void());
   MOCK_METHOD0(latch, uint64_t());
   MOCK_METHOD0(name, std::string());
@@ -36,6 +37,7 @@ public:
   ~MockGauge();
 
   MOCK_METHOD1(add, void(uint64_t amount));
+  MOCK_METHOD0(clearChanged, bool());
   MOCK_METHOD0(dec, void());
   MOCK_METHOD0(inc, void());
   MOCK_METHOD0(name, std::string());
@@ -52,6 +54,7 @@ public:
 
   MOCK_METHOD0(complete, void());
   MOCK_METHOD1(complete, void(const std::string& dynamic_name));
+  MOCK_METHOD0(elapsed, std::chrono::milliseconds());
 };
 
 class MockSink : public Sink {
@@ -63,6 +66,8 @@ public:
   MOCK_METHOD2(flushCounter, void(const std::string& name, uint64_t delta));
   MOCK_METHOD2(flushGauge, void(const std::string& name, uint64_t value));
   MOCK_METHOD0(endFlush, void());
+  MOCK_METHOD2(flushHistogram,
+               void(const std::string& name, const HistogramStatistics& statistics));
   MOCK_METHOD2(onHistogramComplete, void(const std::string& name, uint64_t value));
   MOCK_METHOD2(onTimespanComplete, void(const std::string& name, std::chrono::milliseconds ms));
 };
@@ -81,6 +86,11 @@ public:
   MOCK_METHOD1(createScope_, Scope*(const std::string& name));
   MOCK_METHOD1(gauge, Gauge&(const std::string&));
   MOCK_CONST_METHOD0(gauges, std::list<GaugeSharedPtr>());
+  MOCK_CONST_METHOD0(histograms, std::list<HistogramSharedPtr>());
+  MOCK_CONST_METHOD1(forEachCounter, void(CounterCb callback));
+  MOCK_CONST_METHOD1(forEachGauge, void(GaugeCb callback));
+  MOCK_CONST_METHOD1(forEachChangedCounter, void(CounterCb callback));
+  MOCK_CONST_METHOD1(forEachChangedGauge, void(GaugeCb callback));
   MOCK_METHOD1(timer, Timer&(const std::string& name));
 
   testing::NiceMock<MockCounter> counter_;
@@ -51,8 +51,15 @@ public:
 
     // ThreadLocal::Slot
     ThreadLocalObjectSharedPtr get() override { return parent_.data_[index_]; }
+    ThreadLocalObject& getObject() override { return *parent_.data_[index_]; }
     void runOnAllThreads(Event::PostCb cb) override { parent_.runOnAllThreads(cb); }
     void set(InitializeCb cb) override { parent_.data_[index_] = cb(parent_.dispatcher_); }
+    void update(InitializeCb cb, Event::PostCb complete_cb) override {
+      set(cb);
+      if (complete_cb) {
+        complete_cb();
+      }
+    }
 
     MockInstance& parent_;
     const uint32_t index_;
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "envoy/upstream/cluster_manager.h"
 #include "envoy/upstream/upstream.h"
@@ -30,25 +31,46 @@ public:
   MOCK_CONST_METHOD0(perConnectionBufferLimitBytes, uint32_t());
   MOCK_CONST_METHOD0(features, uint64_t());
   MOCK_CONST_METHOD0(http2Settings, const Http::Http2Settings&());
+  MOCK_CONST_METHOD0(lbSubsetFallback, bool());
+  MOCK_CONST_METHOD0(lbSubsetKeys, const std::vector<std::vector<std::string>>&());
   MOCK_CONST_METHOD0(lbType, LoadBalancerType());
+  MOCK_CONST_METHOD0(maglevTableSize, uint64_t());
   MOCK_CONST_METHOD0(maintenanceMode, bool());
   MOCK_CONST_METHOD0(maxRequestsPerConnection, uint64_t());
+  MOCK_CONST_METHOD0(minWarmConnections, uint32_t());
+  MOCK_CONST_METHOD0(onDemand, bool());
+  MOCK_CONST_METHOD0(prewarmedTcpConnections, uint32_t());
+  MOCK_CONST_METHOD0(prefetchRatio, double());
+  MOCK_CONST_METHOD0(connectionIdleTimeout, std::chrono::milliseconds());
+  MOCK_CONST_METHOD0(sharedConnPools, bool());
+  MOCK_CONST_METHOD0(tcpFastOpen, bool());
+  MOCK_CONST_METHOD0(perEventByteBudget, uint32_t());
   MOCK_CONST_METHOD0(name, const std::string&());
   MOCK_CONST_METHOD1(resourceManager, ResourceManager&(ResourcePriority priority));
   MOCK_CONST_METHOD0(sslContext, Ssl::ClientContext*());
   MOCK_CONST_METHOD0(stats, ClusterStats&());
   MOCK_CONST_METHOD0(statsScope, Stats::Scope&());
+  MOCK_CONST_METHOD0(codeStats, Http::CodeStats&());
   MOCK_CONST_METHOD0(sourceAddress, const Network::Address::InstanceConstSharedPtr&());
 
   std::string name_{"fake_cluster"};
   Http::Http2Settings http2_settings_{};
   uint64_t max_requests_per_connection_{};
+  uint32_t min_warm_connections_{};
+  uint32_t prewarmed_tcp_connections_{};
+  double prefetch_ratio_{1};
+  std::chrono::milliseconds connection_idle_timeout_{};
+  bool shared_conn_pools_{};
   NiceMock<Stats::MockIsolatedStatsStore> stats_store_;
   ClusterStats stats_;
+  Http::CodeStatsPtr code_stats_;
   NiceMock<Runtime::MockLoader> runtime_;
   std::unique_ptr<Upstream::ResourceManager> resource_manager_;
   Network::Address::InstanceConstSharedPtr source_address_;
   LoadBalancerType lb_type_{LoadBalancerType::RoundRobin};
+  uint64_t maglev_table_size_{};
+  std::vector<std::vector<std::string>> lb_subset_keys_;
+  bool lb_subset_fallback_{true};
 };
 
 } // namespace Upstream
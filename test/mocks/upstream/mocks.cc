@@ -1,5 +1,6 @@
 #include "test/mocks/upstream/mocks.h"
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 
@@ -45,6 +46,7 @@ MockHostDescription::MockHostDescription()
     : address_(Network::Utility::resolveUrl("tcp://10.0.0.1:443")) {
   ON_CALL(*this, hostname()).WillByDefault(ReturnRef(hostname_));
   ON_CALL(*this, address()).WillByDefault(Return(address_));
+  ON_CALL(*this, metadata()).WillByDefault(ReturnRef(metadata_));
   ON_CALL(*this, outlierDetector()).WillByDefault(ReturnRef(outlier_detector_));
   ON_CALL(*this, stats()).WillByDefault(ReturnRef(stats_));
   ON_CALL(*this, cluster()).WillByDefault(ReturnRef(cluster_));
@@ -55,6 +57,7 @@ MockHostDescription::~MockHostDescription() {}
 
 MockHost::MockHost() {
   ON_CALL(*this, cluster()).WillByDefault(ReturnRef(cluster_));
+  ON_CALL(*this, metadata()).WillByDefault(ReturnRef(metadata_));
   ON_CALL(*this, outlierDetector()).WillByDefault(ReturnRef(outlier_detector_));
   ON_CALL(*this, stats()).WillByDefault(ReturnRef(stats_));
 }
@@ -63,6 +66,7 @@ MockHost::~MockHost() {}
 
 MockClusterInfo::MockClusterInfo()
     : stats_(ClusterInfoImpl::generateStats(stats_store_)),
+      code_stats_(new Http::CodeStatsImpl(stats_store_, "")),
       resource_manager_(new Upstream::ResourceManagerImpl(runtime_, "fake_key", 1, 1024, 1024, 1)) {
 
   ON_CALL(*this, connectTimeout()).WillByDefault(Return(std::chrono::milliseconds(1)));
@@ -70,13 +74,24 @@ MockClusterInfo::MockClusterInfo()
   ON_CALL(*this, http2Settings()).WillByDefault(ReturnRef(http2_settings_));
   ON_CALL(*this, maxRequestsPerConnection())
       .WillByDefault(ReturnPointee(&max_requests_per_connection_));
+  ON_CALL(*this, minWarmConnections()).WillByDefault(ReturnPointee(&min_warm_connections_));
+  ON_CALL(*this, prewarmedTcpConnections())
+      .WillByDefault(ReturnPointee(&prewarmed_tcp_connections_));
+  ON_CALL(*this, prefetchRatio()).WillByDefault(ReturnPointee(&prefetch_ratio_));
+  ON_CALL(*this, connectionIdleTimeout())
+      .WillByDefault(ReturnPointee(&connection_idle_timeout_));
+  ON_CALL(*this, sharedConnPools()).WillByDefault(ReturnPointee(&shared_conn_pools_));
   ON_CALL(*this, stats()).WillByDefault(ReturnRef(stats_));
   ON_CALL(*this, statsScope()).WillByDefault(ReturnRef(stats_store_));
+  ON_CALL(*this, codeStats()).WillByDefault(ReturnRef(*code_stats_));
   ON_CALL(*this, sourceAddress()).WillByDefault(ReturnRef(source_address_));
   ON_CALL(*this, resourceManager(_))
       .WillByDefault(Invoke(
           [this](ResourcePriority) -> Upstream::ResourceManager& { return *resource_manager_; }));
   ON_CALL(*this, lbType()).WillByDefault(ReturnPointee(&lb_type_));
+  ON_CALL(*this, maglevTableSize()).WillByDefault(ReturnPointee(&maglev_table_size_));
+  ON_CALL(*this, lbSubsetKeys()).WillByDefault(ReturnRef(lb_subset_keys_));
+  ON_CALL(*this, lbSubsetFallback()).WillByDefault(ReturnPointee(&lb_subset_fallback_));
   ON_CALL(*this, sourceAddress()).WillByDefault(ReturnRef(source_address_));
 }
 
@@ -122,6 +137,27 @@ MockClusterManager::MockClusterManager() {
   // Matches are LIFO so "" will match first.
   ON_CALL(*this, get(_)).WillByDefault(Return(&thread_local_cluster_));
   ON_CALL(*this, get("")).WillByDefault(Return(nullptr));
+
+  // Lookups by id are forwarded to the lookups by name, so that expectations can name clusters.
+  ON_CALL(*this, clusterId(_))
+      .WillByDefault(Invoke([this](const std::string& cluster) -> uint32_t {
+        auto existing = std::find(cluster_ids_.begin(), cluster_ids_.end(), cluster);
+        if (existing != cluster_ids_.end()) {
+          return existing - cluster_ids_.begin();
+        }
+        cluster_ids_.push_back(cluster);
+        return cluster_ids_.size() - 1;
+      }));
+  ON_CALL(*this, getById(_))
+      .WillByDefault(Invoke([this](uint32_t cluster_id) -> ThreadLocalCluster* {
+        return get(cluster_ids_.at(cluster_id));
+      }));
+  ON_CALL(*this, httpConnPoolForClusterId(_, _, _))
+      .WillByDefault(Invoke(
+          [this](uint32_t cluster_id, ResourcePriority priority,
+                 LoadBalancerContext* context) -> Http::ConnectionPool::Instance* {
+            return httpConnPoolForCluster(cluster_ids_.at(cluster_id), priority, context);
+          }));
 }
 
 MockClusterManager::~MockClusterManager() {}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <list>
 #include <memory>
@@ -69,6 +70,8 @@ public:
 
   // Upstream::LoadBalancer
   MOCK_METHOD1(chooseHost, HostConstSharedPtr(const LoadBalancerContext* context));
+  MOCK_METHOD2(onResponseTime,
+               void(const HostDescription& host, std::chrono::milliseconds response_time));
 
   std::shared_ptr<MockHost> host_{new MockHost()};
 };
@@ -98,18 +101,34 @@ public:
     return {Network::ClientConnectionPtr{data.connection_}, data.host_description_};
   }
 
+  Host::CreateConnectionData prewarmedTcpConnForCluster(const std::string& cluster,
+                                                        LoadBalancerContext* context) override {
+    MockHost::MockCreateConnectionData data = prewarmedTcpConnForCluster_(cluster, context);
+    return {Network::ClientConnectionPtr{data.connection_}, data.host_description_};
+  }
+
   // Upstream::ClusterManager
   MOCK_METHOD1(addOrUpdatePrimaryCluster, bool(const envoy::api::v2::Cluster& cluster));
+  MOCK_METHOD2(addOrUpdatePrimaryCluster,
+               bool(const envoy::api::v2::Cluster& cluster, uint64_t config_hash));
   MOCK_METHOD1(setInitializedCb, void(std::function<void()>));
   MOCK_METHOD0(clusters, ClusterInfoMap());
   MOCK_METHOD1(get, ThreadLocalCluster*(const std::string& cluster));
+  MOCK_METHOD1(clusterId, uint32_t(const std::string& cluster));
+  MOCK_METHOD1(getById, ThreadLocalCluster*(uint32_t cluster_id));
   MOCK_METHOD3(httpConnPoolForCluster,
                Http::ConnectionPool::Instance*(const std::string& cluster,
                                                ResourcePriority priority,
                                                LoadBalancerContext* context));
+  MOCK_METHOD3(httpConnPoolForClusterId,
+               Http::ConnectionPool::Instance*(uint32_t cluster_id, ResourcePriority priority,
+                                               LoadBalancerContext* context));
   MOCK_METHOD2(tcpConnForCluster_,
                MockHost::MockCreateConnectionData(const std::string& cluster,
                                                   LoadBalancerContext* context));
+  MOCK_METHOD2(prewarmedTcpConnForCluster_,
+               MockHost::MockCreateConnectionData(const std::string& cluster,
+                                                  LoadBalancerContext* context));
   MOCK_METHOD1(httpAsyncClientForCluster, Http::AsyncClient&(const std::string& cluster));
   MOCK_METHOD1(removePrimaryCluster, bool(const std::string& cluster));
   MOCK_METHOD0(shutdown, void());
@@ -119,6 +138,8 @@ public:
   NiceMock<Http::MockAsyncClient> async_client_;
   NiceMock<MockThreadLocalCluster> thread_local_cluster_;
   Network::Address::InstanceConstSharedPtr source_address_;
+  // The names interned by clusterId(), indexed by id.
+  std::vector<std::string> cluster_ids_;
 };
 
 class MockHealthChecker : public HealthChecker {
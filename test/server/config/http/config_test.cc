@@ -6,6 +6,7 @@
 #include "server/config/http/dynamo.h"
 #include "server/config/http/fault.h"
 #include "server/config/http/grpc_http1_bridge.h"
+#include "server/config/http/grpc_stats.h"
 #include "server/config/http/grpc_web.h"
 #include "server/config/http/ip_tagging.h"
 #include "server/config/http/ratelimit.h"
@@ -140,6 +141,21 @@ TEST(HttpFilterConfigTest, GrpcHttp1BridgeFilter) {
   cb(filter_callback);
 }
 
+TEST(HttpFilterConfigTest, GrpcStatsFilter) {
+  std::string json_string = R"EOF(
+  {
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
+  NiceMock<MockFactoryContext> context;
+  GrpcStatsFilterConfig factory;
+  HttpFilterFactoryCb cb = factory.createFilterFactory(*json_config, "stats", context);
+  Http::MockFilterChainFactoryCallbacks filter_callback;
+  EXPECT_CALL(filter_callback, addStreamFilter(_));
+  cb(filter_callback);
+}
+
 TEST(HttpFilterConfigTest, GrpcWebFilter) {
   std::string json_string = R"EOF(
   {
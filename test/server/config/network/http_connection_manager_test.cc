@@ -5,6 +5,7 @@
 
 #include "server/config/network/http_connection_manager.h"
 
+#include "test/mocks/http/mocks.h"
 #include "test/mocks/network/mocks.h"
 #include "test/mocks/server/mocks.h"
 #include "test/test_common/printers.h"
@@ -15,6 +16,7 @@
 
 using testing::ContainerEq;
 using testing::Return;
+using testing::_;
 
 namespace Envoy {
 namespace Server {
@@ -107,6 +109,42 @@ TEST_F(HttpConnectionManagerConfigTest, MiscConfig) {
   EXPECT_THAT(std::vector<Http::LowerCaseString>({Http::LowerCaseString("foo")}),
               ContainerEq(config.tracingConfig()->request_headers_for_tags_));
   EXPECT_EQ(*context_.local_info_.address_, config.localAddress());
+  EXPECT_FALSE(config.plainProxy());
+}
+
+TEST_F(HttpConnectionManagerConfigTest, PlainProxy) {
+  const std::string json_string = R"EOF(
+  {
+    "codec_type": "http1",
+    "stat_prefix": "router",
+    "route_config":
+    {
+      "virtual_hosts": [
+        {
+          "name": "service",
+          "domains": [ "*" ],
+          "routes": [
+            {
+              "prefix": "/",
+              "cluster": "cluster"
+            }
+          ]
+        }
+      ]
+    },
+    "filters": [
+      { "type": "decoder", "name": "router", "config": {} }
+    ]
+  }
+  )EOF";
+
+  HttpConnectionManagerConfig config(parseHttpConnectionManagerFromJson(json_string), context_,
+                                     date_provider_, route_config_provider_manager_);
+  EXPECT_TRUE(config.plainProxy());
+
+  Http::MockFilterChainFactoryCallbacks callbacks;
+  EXPECT_CALL(callbacks, addStreamDecoderFilter(_));
+  config.createFilterChain(callbacks);
 }
 
 TEST_F(HttpConnectionManagerConfigTest, SingleDateProvider) {
@@ -32,6 +32,27 @@ TEST(MongoFilterConfigTest, CorrectConfigurationNoFaults) {
   cb(connection);
 }
 
+TEST(MongoFilterConfigTest, CorrectConfigurationMultiplex) {
+  std::string json_string = R"EOF(
+  {
+    "stat_prefix": "my_stat_prefix",
+    "multiplex" : {
+      "cluster_name": "fake_cluster",
+      "connections": 2
+    }
+  }
+  )EOF";
+
+  Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
+  NiceMock<MockFactoryContext> context;
+  MongoProxyFilterConfigFactory factory;
+  NetworkFilterFactoryCb cb = factory.createFilterFactory(*json_config, context);
+  Network::MockConnection connection;
+  EXPECT_CALL(connection, addFilter(_));
+  EXPECT_CALL(connection, addReadFilter(_));
+  cb(connection);
+}
+
 void handleInvalidConfiguration(const std::string& json_string) {
   Json::ObjectSharedPtr json_config = Json::Factory::loadFromString(json_string);
   NiceMock<MockFactoryContext> context;
@@ -217,6 +238,20 @@ TEST(MongoFilterConfigTest, CorrectFaultConfiguration) {
   cb(connection);
 }
 
+TEST(MongoFilterConfigTest, InvalidMultiplexZeroConnections) {
+  std::string json_string = R"EOF(
+  {
+    "stat_prefix": "my_stat_prefix",
+    "multiplex" : {
+      "cluster_name": "fake_cluster",
+      "connections": 0
+    }
+  }
+  )EOF";
+
+  handleInvalidConfiguration(json_string);
+}
+
 } // namespace Configuration
 } // namespace Server
 } // namespace Envoy
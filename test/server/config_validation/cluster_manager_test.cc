@@ -38,6 +38,9 @@ TEST(ValidationClusterManagerTest, MockedMethods) {
       bootstrap, stats, tls, runtime, random, local_info, log_manager);
   EXPECT_EQ(nullptr,
             cluster_manager->httpConnPoolForCluster("cluster", ResourcePriority::Default, nullptr));
+  const uint32_t cluster_id = cluster_manager->clusterId("cluster");
+  EXPECT_EQ(nullptr, cluster_manager->httpConnPoolForClusterId(
+                         cluster_id, ResourcePriority::Default, nullptr));
   Host::CreateConnectionData data = cluster_manager->tcpConnForCluster("cluster", nullptr);
   EXPECT_EQ(nullptr, data.connection_);
   EXPECT_EQ(nullptr, data.host_description_);
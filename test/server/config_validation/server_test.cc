@@ -37,10 +37,26 @@ TEST_P(ValidationServerTest, Validate) {
 // all the example configs) but can't until light validation is implemented, mocking out access to
 // the filesystem for TLS certs, etc. In the meantime, these are the example configs that work
 // as-is.
-INSTANTIATE_TEST_CASE_P(ValidConfigs, ValidationServerTest,
-                        ::testing::Values("front-envoy.json", "google_com_proxy.json",
-                                          "google_com_proxy.yaml", "google_com_proxy.v2.yaml",
-                                          "s2s-grpc-envoy.json", "service-envoy.json"));
+const std::vector<std::string> valid_configs{
+    "front-envoy.json",         "google_com_proxy.json", "google_com_proxy.yaml",
+    "google_com_proxy.v2.yaml", "s2s-grpc-envoy.json",   "service-envoy.json"};
+
+INSTANTIATE_TEST_CASE_P(ValidConfigs, ValidationServerTest, ::testing::ValuesIn(valid_configs));
+
+// Validate that several config files are validated in parallel, and that one invalid file fails
+// the run.
+TEST_P(ValidationServerTest, ValidateAdditional) {
+  ON_CALL(options_, concurrency()).WillByDefault(testing::Return(3));
+  for (const std::string& config : valid_configs) {
+    options_.additional_config_paths_.push_back(directory_ + config);
+  }
+  EXPECT_TRUE(
+      validateConfig(options_, Network::Address::InstanceConstSharedPtr(), component_factory_));
+
+  options_.additional_config_paths_.push_back(directory_ + "nonexistent.json");
+  EXPECT_FALSE(
+      validateConfig(options_, Network::Address::InstanceConstSharedPtr(), component_factory_));
+}
 
 } // namespace Server
 } // namespace Envoy
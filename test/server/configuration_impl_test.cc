@@ -61,6 +61,7 @@ TEST_F(ConfigurationImplTest, DefaultStatsFlushInterval) {
   config.initialize(bootstrap, server_, cluster_manager_factory_);
 
   EXPECT_EQ(std::chrono::milliseconds(5000), config.statsFlushInterval());
+  EXPECT_EQ(0U, config.statsdUdpMaxPacketSize());
 }
 
 TEST_F(ConfigurationImplTest, CustomStatsFlushInterval) {
@@ -86,6 +87,69 @@ TEST_F(ConfigurationImplTest, CustomStatsFlushInterval) {
   EXPECT_EQ(std::chrono::milliseconds(500), config.statsFlushInterval());
 }
 
+TEST_F(ConfigurationImplTest, StatsdUdpMaxPacketSize) {
+  std::string json = R"EOF(
+  {
+    "listeners": [],
+
+    "statsd_udp_ip_address": "127.0.0.1:8125",
+    "statsd_udp_max_packet_size": 1432,
+
+    "cluster_manager": {
+      "clusters": []
+    },
+
+    "admin": {"access_log_path": "/dev/null", "address": "tcp://1.2.3.4:5678"}
+  }
+  )EOF";
+
+  envoy::api::v2::Bootstrap bootstrap = TestUtility::parseBootstrapFromJson(json);
+
+  MainImpl config;
+  config.initialize(bootstrap, server_, cluster_manager_factory_);
+
+  EXPECT_EQ("127.0.0.1:8125", config.statsdUdpIpAddress()->asString());
+  EXPECT_EQ(1432U, config.statsdUdpMaxPacketSize());
+}
+
+TEST_F(ConfigurationImplTest, MetricsServiceClusterName) {
+  std::string json = R"EOF(
+  {
+    "listeners": [],
+
+    "metrics_service_cluster_name": "metrics",
+
+    "cluster_manager": {
+      "clusters": [
+        {
+          "name": "metrics",
+          "type": "static",
+          "connect_timeout_ms": 1,
+          "lb_type": "round_robin",
+          "features": "http2",
+          "hosts": [{"url": "tcp://127.0.0.1:9000"}]
+        }
+      ]
+    },
+
+    "admin": {"access_log_path": "/dev/null", "address": "tcp://1.2.3.4:5678"}
+  }
+  )EOF";
+
+  envoy::api::v2::Bootstrap bootstrap = TestUtility::parseBootstrapFromJson(json);
+
+  MainImpl config;
+  config.initialize(bootstrap, server_, cluster_manager_factory_);
+  EXPECT_EQ("metrics", config.metricsServiceClusterName().value());
+
+  (*bootstrap.mutable_stats_sinks(0)->mutable_config()->mutable_fields())["cluster_name"]
+      .set_string_value("unknown");
+  MainImpl bad_config;
+  EXPECT_THROW_WITH_MESSAGE(bad_config.initialize(bootstrap, server_, cluster_manager_factory_),
+                            EnvoyException,
+                            "metrics service sink must name a cluster manager cluster");
+}
+
 TEST_F(ConfigurationImplTest, SetUpstreamClusterPerConnectionBufferLimit) {
   const std::string json = R"EOF(
   {
@@ -215,5 +215,163 @@ TEST_F(ConnectionHandlerTest, FindListenerByAddress) {
   EXPECT_CALL(*listener3, onDestroy());
 }
 
+TEST_F(ConnectionHandlerTest, OverloadStopAccepting) {
+  Network::MockListener* listener = new NiceMock<Network::MockListener>();
+  EXPECT_CALL(dispatcher_, createListener_(_, _, _, _, _)).WillOnce(Return(listener));
+  handler_->addListener(factory_, socket_, stats_store_, 1,
+                        Network::ListenerOptions::listenerOptionsWithBindToPort());
+
+  Network::OverloadActions actions;
+  actions.stop_accepting_ = true;
+  EXPECT_CALL(*listener, disable());
+  handler_->applyOverloadActions(actions);
+
+  // Unchanged state is not applied again.
+  EXPECT_CALL(*listener, disable()).Times(0);
+  handler_->applyOverloadActions(actions);
+
+  // Listeners added while overloaded start out disabled.
+  Network::MockListener* listener2 = new NiceMock<Network::MockListener>();
+  EXPECT_CALL(dispatcher_, createListener_(_, _, _, _, _)).WillOnce(Return(listener2));
+  EXPECT_CALL(*listener2, disable());
+  handler_->addListener(factory_, socket_, stats_store_, 2,
+                        Network::ListenerOptions::listenerOptionsWithBindToPort());
+
+  actions.stop_accepting_ = false;
+  EXPECT_CALL(*listener, enable());
+  EXPECT_CALL(*listener2, enable());
+  handler_->applyOverloadActions(actions);
+
+  EXPECT_CALL(*listener, onDestroy());
+  EXPECT_CALL(*listener2, onDestroy());
+}
+
+TEST_F(ConnectionHandlerTest, OverloadReduceBufferLimits) {
+  Network::MockListener* listener = new NiceMock<Network::MockListener>();
+  Network::ListenerCallbacks* listener_callbacks;
+  EXPECT_CALL(dispatcher_, createListener_(_, _, _, _, _))
+      .WillOnce(Invoke([&](Network::ConnectionHandler&, Network::ListenSocket&,
+                           Network::ListenerCallbacks& cb, Stats::Scope&,
+                           const Network::ListenerOptions&) -> Network::Listener* {
+        listener_callbacks = &cb;
+        return listener;
+
+      }));
+  Network::ListenerOptions listener_options =
+      Network::ListenerOptions::listenerOptionsWithBindToPort();
+  listener_options.per_connection_buffer_limit_bytes_ = 1000;
+  handler_->addListener(factory_, socket_, stats_store_, 1, listener_options);
+
+  Network::MockConnection* connection = new NiceMock<Network::MockConnection>();
+  EXPECT_CALL(factory_, createFilterChain(_)).WillOnce(Return(true));
+  listener_callbacks->onNewConnection(Network::ConnectionPtr{connection});
+
+  Network::OverloadActions actions;
+  actions.buffer_limit_percent_ = 50;
+  EXPECT_CALL(*connection, setBufferLimits(500));
+  handler_->applyOverloadActions(actions);
+
+  // New connections get the reduced limit as well.
+  Network::MockConnection* connection2 = new NiceMock<Network::MockConnection>();
+  EXPECT_CALL(*connection2, setBufferLimits(500));
+  EXPECT_CALL(factory_, createFilterChain(_)).WillOnce(Return(true));
+  listener_callbacks->onNewConnection(Network::ConnectionPtr{connection2});
+
+  actions.buffer_limit_percent_ = 100;
+  EXPECT_CALL(*connection, setBufferLimits(1000));
+  EXPECT_CALL(*connection2, setBufferLimits(1000));
+  handler_->applyOverloadActions(actions);
+
+  EXPECT_CALL(*listener, onDestroy());
+}
+
+TEST_F(ConnectionHandlerTest, OverloadShedConnections) {
+  Network::MockListener* listener = new NiceMock<Network::MockListener>();
+  Network::ListenerCallbacks* listener_callbacks;
+  EXPECT_CALL(dispatcher_, createListener_(_, _, _, _, _))
+      .WillOnce(Invoke([&](Network::ConnectionHandler&, Network::ListenSocket&,
+                           Network::ListenerCallbacks& cb, Stats::Scope&,
+                           const Network::ListenerOptions&) -> Network::Listener* {
+        listener_callbacks = &cb;
+        return listener;
+
+      }));
+  handler_->addListener(factory_, socket_, stats_store_, 1,
+                        Network::ListenerOptions::listenerOptionsWithBindToPort());
+
+  Network::MockConnection* small = new NiceMock<Network::MockConnection>();
+  Network::MockConnection* large = new NiceMock<Network::MockConnection>();
+  Network::MockConnection* medium = new NiceMock<Network::MockConnection>();
+  ON_CALL(*small, bufferedBytes()).WillByDefault(Return(10));
+  ON_CALL(*large, bufferedBytes()).WillByDefault(Return(1000));
+  ON_CALL(*medium, bufferedBytes()).WillByDefault(Return(100));
+  EXPECT_CALL(factory_, createFilterChain(_)).Times(3).WillRepeatedly(Return(true));
+  listener_callbacks->onNewConnection(Network::ConnectionPtr{small});
+  listener_callbacks->onNewConnection(Network::ConnectionPtr{large});
+  listener_callbacks->onNewConnection(Network::ConnectionPtr{medium});
+
+  // The largest connections are closed first until enough bytes have been freed.
+  Network::OverloadActions actions;
+  actions.shed_bytes_ = 1050;
+  EXPECT_CALL(*large, close(Network::ConnectionCloseType::NoFlush));
+  EXPECT_CALL(*medium, close(Network::ConnectionCloseType::NoFlush));
+  handler_->applyOverloadActions(actions);
+  EXPECT_EQ(1UL, handler_->numConnections());
+  EXPECT_EQ(2UL, stats_store_.counter("downstream_cx_overload_shed").value());
+
+  EXPECT_CALL(*small, close(Network::ConnectionCloseType::NoFlush));
+
+  EXPECT_CALL(*listener, onDestroy());
+}
+
+TEST_F(ConnectionHandlerTest, BalanceConnections) {
+  ConnectionBalancer balancer;
+  NiceMock<Event::MockDispatcher> dispatcher2;
+  ConnectionHandlerImpl handler1(ENVOY_LOGGER(), dispatcher_, balancer,
+                                 stats_store_.gauge("worker_0.downstream_cx_active"));
+  ConnectionHandlerImpl handler2(ENVOY_LOGGER(), dispatcher2, balancer,
+                                 stats_store_.gauge("worker_1.downstream_cx_active"));
+
+  Network::ListenerOptions listener_options =
+      Network::ListenerOptions::listenerOptionsWithBindToPort();
+  listener_options.connection_balance_threshold_ = 50;
+
+  Network::MockListener* listener1 = new NiceMock<Network::MockListener>();
+  Network::ListenerCallbacks* listener_callbacks1;
+  EXPECT_CALL(dispatcher_, createListener_(_, _, _, _, _))
+      .WillOnce(Invoke([&](Network::ConnectionHandler&, Network::ListenSocket&,
+                           Network::ListenerCallbacks& cb, Stats::Scope&,
+                           const Network::ListenerOptions&) -> Network::Listener* {
+        listener_callbacks1 = &cb;
+        return listener1;
+      }));
+  handler1.addListener(factory_, socket_, stats_store_, 1, listener_options);
+
+  Network::MockListener* listener2 = new NiceMock<Network::MockListener>();
+  EXPECT_CALL(dispatcher2, createListener_(_, _, _, _, _)).WillOnce(Return(listener2));
+  handler2.addListener(factory_, socket_, stats_store_, 1, listener_options);
+
+  // Idle workers keep their connections, and moving a worker's only connection gains nothing.
+  EXPECT_CALL(factory_, createFilterChain(_)).Times(2).WillRepeatedly(Return(true));
+  EXPECT_FALSE(listener_callbacks1->onAccept(42, nullptr, nullptr, false));
+  listener_callbacks1->onNewConnection(
+      Network::ConnectionPtr{new NiceMock<Network::MockConnection>()});
+  EXPECT_FALSE(listener_callbacks1->onAccept(42, nullptr, nullptr, false));
+  listener_callbacks1->onNewConnection(
+      Network::ConnectionPtr{new NiceMock<Network::MockConnection>()});
+  EXPECT_EQ(2UL, stats_store_.gauge("worker_0.downstream_cx_active").value());
+
+  // With two connections against none the first worker is above the average by more than the
+  // threshold, so the socket is handed to the second worker's listener.
+  EXPECT_CALL(dispatcher2, post(_));
+  EXPECT_CALL(*listener2, newConnection(43, _, _, false));
+  EXPECT_TRUE(listener_callbacks1->onAccept(43, nullptr, nullptr, false));
+  EXPECT_EQ(1UL, stats_store_.counter("downstream_cx_balanced").value());
+  EXPECT_EQ(0UL, handler2.numConnections());
+
+  EXPECT_CALL(*listener1, onDestroy());
+  EXPECT_CALL(*listener2, onDestroy());
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -57,5 +57,21 @@ TEST(DrainManagerImplTest, All) {
   EXPECT_TRUE(drain_manager.drainClose());
 }
 
+// Validate that the drain closes of a worker are limited to the configured rate.
+TEST(DrainManagerImplTest, DrainCloseRate) {
+  NiceMock<MockInstance> server;
+  ON_CALL(server.options_, drainTime()).WillByDefault(Return(std::chrono::seconds(1)));
+  ON_CALL(server.options_, drainCloseRate()).WillByDefault(Return(2));
+  DrainManagerImpl drain_manager(server);
+
+  new NiceMock<Event::MockTimer>(&server.dispatcher_);
+  drain_manager.startDrainSequence([]() -> void {});
+
+  // The drain time has passed, so every connection would be drain closed without the limit.
+  EXPECT_TRUE(drain_manager.drainClose());
+  EXPECT_TRUE(drain_manager.drainClose());
+  EXPECT_FALSE(drain_manager.drainClose());
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -1,11 +1,17 @@
+#include <unistd.h>
+
 #include <fstream>
 
 #include "common/http/message_impl.h"
+#include "common/memory/accounting.h"
+#include "common/network/utility.h"
 #include "common/profiler/profiler.h"
 
 #include "server/http/admin.h"
 
+#include "test/mocks/buffer/mocks.h"
 #include "test/mocks/server/mocks.h"
+#include "test/mocks/upstream/mocks.h"
 #include "test/test_common/environment.h"
 #include "test/test_common/network_utility.h"
 #include "test/test_common/printers.h"
@@ -15,7 +21,10 @@
 #include "gtest/gtest.h"
 
 namespace Envoy {
+using testing::Invoke;
 using testing::NiceMock;
+using testing::Return;
+using testing::ReturnRef;
 using testing::_;
 
 namespace Server {
@@ -61,6 +70,51 @@ TEST_P(AdminFilterTest, Trailers) {
   filter_.decodeTrailers(request_headers_);
 }
 
+// A streamed response is encoded one chunk per event loop iteration, and waits while the
+// downstream connection is above its high watermark.
+TEST_P(AdminFilterTest, StreamedResponse) {
+  server_.stats_store_.counter("foo.bar").inc();
+  std::list<Event::PostCb> posted;
+  EXPECT_CALL(callbacks_.dispatcher_, post(_))
+      .WillRepeatedly(Invoke([&posted](Event::PostCb cb) -> void { posted.push_back(cb); }));
+  auto run_posted = [&posted]() -> void {
+    ASSERT_EQ(1U, posted.size());
+    Event::PostCb cb = posted.front();
+    posted.pop_front();
+    cb();
+  };
+
+  Http::TestHeaderMapImpl request_headers{{":path", "/stats?unsorted&filter=^foo\\."}};
+  filter_.decodeHeaders(request_headers, true);
+
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, false));
+  EXPECT_CALL(callbacks_, encodeData(BufferStringEqual("foo.bar: 1\n"), false));
+  run_posted();
+
+  ASSERT_EQ(1U, callbacks_.callbacks_.size());
+  callbacks_.callbacks_.front()->onAboveWriteBufferHighWatermark();
+  EXPECT_CALL(callbacks_, encodeData(_, _)).Times(0);
+  run_posted();
+  EXPECT_TRUE(posted.empty());
+
+  callbacks_.callbacks_.front()->onBelowWriteBufferLowWatermark();
+  EXPECT_CALL(callbacks_, encodeData(BufferStringEqual(""), true));
+  run_posted();
+  EXPECT_TRUE(posted.empty());
+}
+
+// Nothing is encoded if the stream goes away while the main thread runs the handler.
+TEST_P(AdminFilterTest, DestroyedBeforeResponse) {
+  std::list<Event::PostCb> posted;
+  EXPECT_CALL(callbacks_.dispatcher_, post(_))
+      .WillOnce(Invoke([&posted](Event::PostCb cb) -> void { posted.push_back(cb); }));
+  filter_.decodeHeaders(request_headers_, true);
+  filter_.onDestroy();
+
+  EXPECT_CALL(callbacks_, encodeHeaders_(_, _)).Times(0);
+  posted.front()();
+}
+
 class AdminInstanceTest : public testing::TestWithParam<Network::Address::IpVersion> {
 public:
   AdminInstanceTest()
@@ -93,6 +147,19 @@ TEST_P(AdminInstanceTest, AdminProfiler) {
   EXPECT_FALSE(Profiler::Cpu::profilerEnabled());
 }
 
+TEST_P(AdminInstanceTest, AdminHeapProfiler) {
+  Buffer::OwnedImpl data;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/heapprofiler?enable=y", data));
+  EXPECT_TRUE(Profiler::Heap::profilerEnabled());
+
+  Buffer::OwnedImpl profile;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/heap_profile", profile));
+  EXPECT_EQ("heap profile:", TestUtility::bufferToString(profile).substr(0, 13));
+
+  admin_.runCallback("/heapprofiler?enable=n", data);
+  EXPECT_FALSE(Profiler::Heap::profilerEnabled());
+}
+
 #endif
 
 TEST_P(AdminInstanceTest, AdminBadProfiler) {
@@ -104,6 +171,22 @@ TEST_P(AdminInstanceTest, AdminBadProfiler) {
   EXPECT_FALSE(Profiler::Cpu::profilerEnabled());
 }
 
+TEST_P(AdminInstanceTest, AdminCpuProfile) {
+  Buffer::OwnedImpl response;
+  TestEnvironment::writeStringToFileForTest("envoy.prof", "profile");
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/cpu_profile", response));
+  EXPECT_EQ("profile", TestUtility::bufferToString(response));
+
+  unlink(cpu_profile_path_.c_str());
+  EXPECT_EQ(Http::Code::NotFound, admin_.runCallback("/cpu_profile", response));
+}
+
+TEST_P(AdminInstanceTest, AdminHeapProfileDisabled) {
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::BadRequest, admin_.runCallback("/heap_profile", response));
+  EXPECT_EQ(Http::Code::BadRequest, admin_.runCallback("/heapprofiler?enable=x", response));
+}
+
 TEST_P(AdminInstanceTest, WriteAddressToFile) {
   std::ifstream address_file(address_out_path_);
   std::string address_from_file;
@@ -146,5 +229,136 @@ TEST_P(AdminInstanceTest, CustomHandler) {
   EXPECT_EQ(Http::Code::Accepted, admin_.runCallback("/foo/bar", response));
 }
 
+TEST_P(AdminInstanceTest, StatsFilter) {
+  server_.stats_store_.counter("foo.bar").inc();
+  server_.stats_store_.gauge("foo.baz").set(3);
+  server_.stats_store_.counter("foobar").inc();
+
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/stats?filter=^foo\\.", response));
+  EXPECT_EQ("foo.bar: 1\nfoo.baz: 3\n", TestUtility::bufferToString(response));
+}
+
+TEST_P(AdminInstanceTest, StatsUnsorted) {
+  server_.stats_store_.counter("foo.bar").add(10);
+  server_.stats_store_.gauge("foo.baz").set(3);
+
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/stats?unsorted&filter=^foo\\.", response));
+  const std::string output = TestUtility::bufferToString(response);
+  EXPECT_NE(std::string::npos, output.find("foo.bar: 10\n"));
+  EXPECT_NE(std::string::npos, output.find("foo.baz: 3\n"));
+  EXPECT_EQ(std::string("foo.bar: 10\nfoo.baz: 3\n").size(), output.size());
+}
+
+// Sorted stats are streamed in chunks of at most 5000, followed by the histograms.
+TEST_P(AdminInstanceTest, StatsChunks) {
+  for (uint32_t i = 0; i < 5001; i++) {
+    server_.stats_store_.counter(fmt::format("foo.{:04}", i)).inc();
+  }
+
+  Buffer::OwnedImpl response;
+  AdminImpl::ChunkCb chunks;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/stats?filter=^foo\\.", response, chunks));
+  EXPECT_EQ(0U, response.length());
+  ASSERT_TRUE(chunks);
+
+  Buffer::OwnedImpl chunk;
+  EXPECT_TRUE(chunks(chunk));
+  const std::string first = TestUtility::bufferToString(chunk);
+  EXPECT_EQ(0U, first.find("foo.0000: 1\n"));
+  EXPECT_EQ(first.size() - 12, first.find("foo.4999: 1\n"));
+
+  chunk.drain(chunk.length());
+  EXPECT_FALSE(chunks(chunk));
+  EXPECT_EQ("foo.5000: 1\n", TestUtility::bufferToString(chunk));
+}
+
+// The host lines of /clusters are streamed in chunks of at most 1000 hosts, after the settings of
+// the cluster. The success rates of the hosts are read by the handler, on the main thread.
+TEST_P(AdminInstanceTest, ClustersChunks) {
+  NiceMock<Upstream::MockCluster> cluster;
+  cluster.info_->name_ = "fake_cluster";
+  std::shared_ptr<NiceMock<Upstream::MockHost>> host(new NiceMock<Upstream::MockHost>());
+  const std::string zone = "zone";
+  ON_CALL(*host, address())
+      .WillByDefault(Return(Network::Utility::resolveUrl("tcp://10.0.0.1:80")));
+  ON_CALL(*host, zone()).WillByDefault(ReturnRef(zone));
+  cluster.hosts_.assign(1001, host);
+  Upstream::ClusterManager::ClusterInfoMap clusters;
+  clusters.emplace("fake_cluster", cluster);
+  ON_CALL(server_.cluster_manager_, clusters()).WillByDefault(Return(clusters));
+
+  Buffer::OwnedImpl response;
+  AdminImpl::ChunkCb chunks;
+  EXPECT_CALL(host->outlier_detector_, successRate()).Times(1001).WillRepeatedly(Return(95.5));
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/clusters", response, chunks));
+  EXPECT_EQ(0U, response.length());
+  ASSERT_TRUE(chunks);
+  EXPECT_CALL(host->outlier_detector_, successRate()).Times(0);
+
+  auto count_hosts = [](const std::string& output) -> size_t {
+    size_t count = 0;
+    for (size_t pos = output.find("::zone::zone\n"); pos != std::string::npos;
+         pos = output.find("::zone::zone\n", pos + 1)) {
+      count++;
+    }
+    return count;
+  };
+
+  Buffer::OwnedImpl chunk;
+  EXPECT_TRUE(chunks(chunk));
+  const std::string first = TestUtility::bufferToString(chunk);
+  EXPECT_EQ(0U, first.find("fake_cluster::default_priority::max_connections::"));
+  EXPECT_EQ(1000U, count_hosts(first));
+
+  chunk.drain(chunk.length());
+  EXPECT_FALSE(chunks(chunk));
+  const std::string second = TestUtility::bufferToString(chunk);
+  EXPECT_EQ(std::string::npos, second.find("max_connections"));
+  EXPECT_EQ(1U, count_hosts(second));
+  EXPECT_NE(std::string::npos, second.find("fake_cluster::10.0.0.1:80::weight::"));
+  EXPECT_NE(std::string::npos, second.find("fake_cluster::10.0.0.1:80::success_rate::95.5\n"));
+}
+
+TEST_P(AdminInstanceTest, StatsInvalidFilter) {
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::BadRequest, admin_.runCallback("/stats?filter=(", response));
+}
+
+TEST_P(AdminInstanceTest, MemoryRelease) {
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/memory/release", response));
+  const std::string output = TestUtility::bufferToString(response);
+  EXPECT_EQ(0U, output.find("released "));
+  EXPECT_EQ(output.size() - 7, output.find(" bytes\n"));
+}
+
+TEST_P(AdminInstanceTest, Memory) {
+  const uint64_t before = Memory::Accounting::bytes(Memory::Owner::RouteConfigs);
+  Memory::Charge charge(Memory::Owner::RouteConfigs, 1000);
+
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/memory", response));
+  const std::string output = TestUtility::bufferToString(response);
+  EXPECT_EQ(0U, output.find("allocated: "));
+  EXPECT_NE(std::string::npos, output.find("\nheap_size: "));
+  EXPECT_NE(std::string::npos, output.find(fmt::format("\nroute_configs: {}\n", before + 1000)));
+  EXPECT_NE(std::string::npos, output.find("\ncluster_manager: "));
+  EXPECT_NE(std::string::npos, output.find("\nconnection_buffers: "));
+  EXPECT_NE(std::string::npos, output.find("\nstats: "));
+}
+
+TEST_P(AdminInstanceTest, ServerInfoStartupPhases) {
+  server_.startup_phase_times_ = {{"bootstrap", std::chrono::milliseconds(12)},
+                                  {"static_resources", std::chrono::milliseconds(2315)}};
+
+  Buffer::OwnedImpl response;
+  EXPECT_EQ(Http::Code::OK, admin_.runCallback("/server_info", response));
+  const std::string output = TestUtility::bufferToString(response);
+  const std::string phases = "\nstartup bootstrap 12ms\nstartup static_resources 2315ms\n";
+  EXPECT_EQ(output.size() - phases.size(), output.find(phases));
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -36,7 +36,8 @@ public:
   }
 
   void prepareFilter(bool pass_through) {
-    filter_.reset(new HealthCheckFilter(context_, pass_through, cache_manager_, "/healthcheck"));
+    filter_.reset(new HealthCheckFilter(context_, pass_through, cache_manager_, "/healthcheck",
+                                        cluster_min_healthy_percentages_));
     filter_->setDecoderFilterCallbacks(callbacks_);
   }
 
@@ -44,6 +45,7 @@ public:
   Event::MockTimer* cache_timer_{};
   Event::MockDispatcher dispatcher_;
   HealthCheckCacheManagerSharedPtr cache_manager_;
+  ClusterMinHealthyPercentagesConstSharedPtr cluster_min_healthy_percentages_;
   std::unique_ptr<HealthCheckFilter> filter_;
   NiceMock<Http::MockStreamDecoderFilterCallbacks> callbacks_;
   Http::TestHeaderMapImpl request_headers_;
@@ -65,6 +67,29 @@ public:
   HealthCheckFilterCachingTest() : HealthCheckFilterTest(true, true) {}
 };
 
+class HealthCheckFilterClusterHealthTest : public HealthCheckFilterTest {
+public:
+  HealthCheckFilterClusterHealthTest() : HealthCheckFilterTest(false, false) {
+    cluster_min_healthy_percentages_.reset(new ClusterMinHealthyPercentages{{"www", 50}});
+    prepareFilter(false);
+  }
+
+  void setHosts(uint32_t total, uint32_t healthy) {
+    Upstream::MockCluster& cluster = context_.cluster_manager_.thread_local_cluster_.cluster_;
+    cluster.hosts_.assign(total, host_);
+    cluster.healthy_hosts_.assign(healthy, host_);
+  }
+
+  void expectResponse(const std::string& status) {
+    Http::TestHeaderMapImpl health_check_response{{":status", status}};
+    EXPECT_CALL(callbacks_, encodeHeaders_(HeaderMapEqualRef(&health_check_response), true));
+    EXPECT_EQ(Http::FilterHeadersStatus::StopIteration,
+              filter_->decodeHeaders(request_headers_, true));
+  }
+
+  Upstream::HostSharedPtr host_{new NiceMock<Upstream::MockHost>()};
+};
+
 TEST_F(HealthCheckFilterNoPassThroughTest, OkOrFailed) {
   EXPECT_CALL(context_, healthCheckFailed()).Times(0);
   EXPECT_CALL(callbacks_.request_info_, healthCheck(true));
@@ -207,6 +232,45 @@ TEST_F(HealthCheckFilterCachingTest, NotHcRequest) {
             filter_->decodeHeaders(request_headers_no_hc_, true));
 }
 
+TEST_F(HealthCheckFilterClusterHealthTest, Healthy) {
+  setHosts(4, 2);
+  expectResponse("200");
+}
+
+TEST_F(HealthCheckFilterClusterHealthTest, Unhealthy) {
+  setHosts(4, 1);
+  EXPECT_CALL(callbacks_.request_info_,
+              setResponseFlag(Http::AccessLog::ResponseFlag::FailedLocalHealthCheck));
+  expectResponse("503");
+}
+
+TEST_F(HealthCheckFilterClusterHealthTest, EmptyCluster) {
+  setHosts(0, 0);
+  expectResponse("503");
+
+  // An empty cluster does not fail a threshold of 0.
+  cluster_min_healthy_percentages_.reset(new ClusterMinHealthyPercentages{{"www", 0}});
+  prepareFilter(false);
+  expectResponse("200");
+}
+
+TEST_F(HealthCheckFilterClusterHealthTest, UnknownCluster) {
+  setHosts(1, 1);
+  EXPECT_CALL(context_.cluster_manager_, get("www")).WillOnce(Return(nullptr));
+  expectResponse("503");
+}
+
+TEST(HealthCheckFilterConfig, failsWhenPassThroughAndClusterHealthSet) {
+  Server::Configuration::HealthCheckFilterConfig healthCheckFilterConfig;
+  Json::ObjectSharedPtr config =
+      Json::Factory::loadFromString("{\"pass_through_mode\":true, \"endpoint\":\"foo\", "
+                                    "\"cluster_min_healthy_percentages\":{\"www\":50}}");
+  NiceMock<Server::Configuration::MockFactoryContext> context;
+
+  EXPECT_THROW(healthCheckFilterConfig.createFilterFactory(*config, "dummy_stats_prefix", context),
+               EnvoyException);
+}
+
 TEST(HealthCheckFilterConfig, failsWhenNotPassThroughButTimeoutSet) {
   Server::Configuration::HealthCheckFilterConfig healthCheckFilterConfig;
   Json::ObjectSharedPtr config = Json::Factory::loadFromString(
@@ -7,6 +7,7 @@
 
 using testing::InSequence;
 using testing::Invoke;
+using testing::Return;
 using testing::_;
 
 namespace Envoy {
@@ -63,5 +64,25 @@ TEST_F(InitManagerImplTest, TargetAfterInitializing) {
   target1.callback_();
 }
 
+TEST_F(InitManagerImplTest, TargetInitializedCb) {
+  InSequence s;
+  Init::MockTarget target;
+  ReadyWatcher target_initialized;
+  manager_.setTargetInitializedCb(
+      [&](const std::string& name, MonotonicTime start, MonotonicTime end) -> void {
+        EXPECT_EQ("target", name);
+        EXPECT_LE(start, end);
+        target_initialized.ready();
+      });
+
+  manager_.registerTarget(target);
+  EXPECT_CALL(target, initialize(_));
+  manager_.initialize([&]() -> void { initialized_.ready(); });
+  EXPECT_CALL(target, name()).WillOnce(Return("target"));
+  EXPECT_CALL(target_initialized, ready());
+  EXPECT_CALL(initialized_, ready());
+  target.callback_();
+}
+
 } // namespace Server
 } // namespace Envoy
@@ -1,5 +1,6 @@
 #include "common/config/utility.h"
 #include "common/http/message_impl.h"
+#include "common/protobuf/utility.h"
 
 #include "server/lds_api.h"
 
@@ -40,9 +41,11 @@ public:
   }
 
   void expectAdd(const std::string& listener_name, bool updated) {
-    EXPECT_CALL(listener_manager_, addOrUpdateListener(_))
-        .WillOnce(Invoke([listener_name, updated](const envoy::api::v2::Listener& config) -> bool {
+    EXPECT_CALL(listener_manager_, addOrUpdateListener(_, _))
+        .WillOnce(Invoke([listener_name, updated](const envoy::api::v2::Listener& config,
+                                                  uint64_t hash) -> bool {
           EXPECT_EQ(listener_name, config.name());
+          EXPECT_EQ(MessageUtil::hash(config), hash);
           return updated;
         }));
   }
@@ -62,17 +65,6 @@ public:
             }));
   }
 
-  void makeListenersAndExpectCall(const std::vector<std::string>& listener_names) {
-    std::vector<std::reference_wrapper<Listener>> refs;
-    listeners_.clear();
-    for (const auto& name : listener_names) {
-      listeners_.emplace_back();
-      listeners_.back().name_ = name;
-      refs.push_back(listeners_.back());
-    }
-    EXPECT_CALL(listener_manager_, listeners()).WillOnce(Return(refs));
-  }
-
   NiceMock<Upstream::MockClusterManager> cluster_manager_;
   Event::MockDispatcher dispatcher_;
   NiceMock<Runtime::MockRandomGenerator> random_;
@@ -84,9 +76,6 @@ public:
   std::unique_ptr<LdsApi> lds_;
   Event::MockTimer* interval_timer_{new Event::MockTimer(&dispatcher_)};
   Http::AsyncClient::Callbacks* callbacks_{};
-
-private:
-  std::list<NiceMock<MockListener>> listeners_;
 };
 
 TEST_F(LdsApiTest, UnknownCluster) {
@@ -150,7 +139,6 @@ TEST_F(LdsApiTest, Basic) {
       Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}));
   message->body().reset(new Buffer::OwnedImpl(response1_json));
 
-  makeListenersAndExpectCall({});
   expectAdd("listener1", true);
   expectAdd("listener2", true);
   EXPECT_CALL(init_.initialized_, ready());
@@ -181,8 +169,7 @@ TEST_F(LdsApiTest, Basic) {
       Http::HeaderMapPtr{new Http::TestHeaderMapImpl{{":status", "200"}}}));
   message->body().reset(new Buffer::OwnedImpl(response2_json));
 
-  makeListenersAndExpectCall({"listener1", "listener2"});
-  expectAdd("listener1", false);
+  // Only the changes are applied.
   expectAdd("listener3", true);
   EXPECT_CALL(listener_manager_, removeListener("listener2")).WillOnce(Return(true));
   EXPECT_CALL(*interval_timer_, enableTimer(_));
@@ -1,3 +1,7 @@
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include "envoy/registry/registry.h"
 
 #include "common/network/address_impl.h"
@@ -5,6 +9,7 @@
 #include "server/configuration_impl.h"
 #include "server/listener_manager_impl.h"
 
+#include "test/mocks/network/mocks.h"
 #include "test/mocks/server/mocks.h"
 #include "test/server/utility.h"
 #include "test/test_common/environment.h"
@@ -32,6 +37,7 @@ public:
   Init::MockTarget target_;
   MockDrainManager* drain_manager_ = new MockDrainManager();
   Configuration::FactoryContext* context_{};
+  uint64_t filter_chains_built_{};
 };
 
 class ListenerManagerImplTest : public testing::Test {
@@ -62,7 +68,9 @@ public:
               if (need_init) {
                 context.initManager().registerTarget(notifier->target_);
               }
-              return {[notifier](Network::FilterManager&) -> void {}};
+              return {[notifier](Network::FilterManager&) -> void {
+                notifier->filter_chains_built_++;
+              }};
             }));
 
     return raw_listener;
@@ -698,5 +706,196 @@ TEST_F(ListenerManagerImplTest, DuplicateAddressDontBind) {
   EXPECT_CALL(*listener_foo, onDestroy());
 }
 
+TEST_F(ListenerManagerImplTest, ReusePortListener) {
+  InSequence s;
+
+  ON_CALL(server_.runtime_loader_.snapshot_, getInteger("listener.reuse_port.foo", 0))
+      .WillByDefault(Return(1));
+
+  const std::string listener_foo_json = R"EOF(
+  {
+    "name": "foo",
+    "address": "tcp://127.0.0.1:1234",
+    "filters": []
+  }
+  )EOF";
+
+  // A listener with SO_REUSEPORT enabled gets a socket per worker.
+  ListenerHandle* listener_foo = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createReusePortListenSockets(_, 1));
+  EXPECT_CALL(listener_factory_, createListenSocket(_, _)).Times(0);
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromJson(listener_foo_json)));
+  checkStats(1, 0, 0, 0, 1, 0);
+
+  // An update keeps the existing socket group.
+  const std::string listener_foo_update1_json = R"EOF(
+  {
+    "name": "foo",
+    "address": "tcp://127.0.0.1:1234",
+    "filters": [
+      { "type" : "read", "name" : "fake", "config" : {} }
+    ]
+  }
+  )EOF";
+
+  ListenerHandle* listener_foo_update1 = expectListenerCreate(false);
+  EXPECT_CALL(*listener_foo, onDestroy());
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromJson(listener_foo_update1_json)));
+  checkStats(1, 1, 0, 0, 1, 0);
+
+  EXPECT_CALL(*listener_foo_update1, onDestroy());
+}
+
+#ifdef __linux__
+TEST_F(ListenerManagerImplTest, TcpFastOpenAndDeferAccept) {
+  ON_CALL(server_.runtime_loader_.snapshot_,
+          getInteger("listener.tcp_fast_open_queue_length.foo", 0))
+      .WillByDefault(Return(16));
+  ON_CALL(server_.runtime_loader_.snapshot_, getInteger("listener.defer_accept_seconds.foo", 0))
+      .WillByDefault(Return(5));
+
+  const std::string listener_foo_json = R"EOF(
+  {
+    "name": "foo",
+    "address": "tcp://127.0.0.1:1234",
+    "filters": []
+  }
+  )EOF";
+
+  // The options are set on the socket that is created for the listener.
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_NE(-1, fd);
+  ON_CALL(*listener_factory_.socket_, fd()).WillByDefault(Return(fd));
+
+  ListenerHandle* listener_foo = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromJson(listener_foo_json)));
+  EXPECT_TRUE(manager_->listeners()[0].get().tcpFastOpen());
+
+  int value = 0;
+  socklen_t value_len = sizeof(value);
+  EXPECT_EQ(0, getsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &value, &value_len));
+  EXPECT_EQ(16, value);
+  EXPECT_EQ(0, getsockopt(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, &value_len));
+  EXPECT_NE(0, value);
+
+  EXPECT_CALL(*listener_foo, onDestroy());
+  close(fd);
+}
+#endif
+
+TEST_F(ListenerManagerImplTest, AcceptLimits) {
+  ON_CALL(server_.runtime_loader_.snapshot_, getInteger("listener.max_accepts_per_wakeup.foo", 0))
+      .WillByDefault(Return(8));
+  ON_CALL(server_.runtime_loader_.snapshot_, getInteger("listener.max_accepts_per_second.foo", 0))
+      .WillByDefault(Return(1));
+  ON_CALL(server_.runtime_loader_.snapshot_, getInteger("listener.max_accepts_per_second", 0))
+      .WillByDefault(Return(1000));
+
+  const std::string listener_foo_json = R"EOF(
+  {
+    "name": "foo",
+    "address": "tcp://127.0.0.1:1234",
+    "filters": []
+  }
+  )EOF";
+
+  ListenerHandle* listener_foo = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromJson(listener_foo_json)));
+  Listener& listener = manager_->listeners()[0].get();
+  EXPECT_EQ(8U, listener.maxAcceptsPerWakeup());
+
+  // The listener's own rate allows a single accept per second.
+  ASSERT_NE(nullptr, listener.acceptLimiter());
+  EXPECT_TRUE(listener.acceptLimiter()->tryAccept());
+  EXPECT_FALSE(listener.acceptLimiter()->tryAccept());
+  EXPECT_EQ(std::chrono::milliseconds(10), listener.acceptLimiter()->retryInterval());
+
+  EXPECT_CALL(*listener_foo, onDestroy());
+}
+
+TEST(AcceptRateLimiterTest, Parent) {
+  AcceptRateLimiter parent(1, nullptr);
+  AcceptRateLimiter limiter(1000, &parent);
+  EXPECT_EQ(std::chrono::milliseconds(1000), parent.retryInterval());
+  EXPECT_EQ(std::chrono::milliseconds(10), limiter.retryInterval());
+
+  // The limiter has tokens left, but the parent allows only one accept.
+  EXPECT_TRUE(limiter.tryAccept());
+  EXPECT_FALSE(limiter.tryAccept());
+}
+
+TEST_F(ListenerManagerImplTest, InPlaceUpdate) {
+  InSequence s;
+
+  ON_CALL(server_.runtime_loader_.snapshot_, getInteger("listener.in_place_update.foo", 0))
+      .WillByDefault(Return(1));
+
+  EXPECT_CALL(*worker_, start(_));
+  manager_->startWorkers(guard_dog_);
+
+  const std::string listener_foo_json = R"EOF(
+  {
+    "name": "foo",
+    "address": "tcp://127.0.0.1:1234",
+    "filters": []
+  }
+  )EOF";
+
+  ListenerHandle* listener_foo = expectListenerCreate(false);
+  EXPECT_CALL(listener_factory_, createListenSocket(_, true));
+  EXPECT_CALL(*worker_, addListener(_, _));
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromJson(listener_foo_json)));
+  worker_->callAddCompletion(true);
+  Listener& worker_listener = manager_->listeners()[0];
+  const uint64_t listener_tag = worker_listener.listenerTag();
+
+  // The update takes over the listener of the workers, and nothing is drained.
+  const std::string listener_foo_update1_json = R"EOF(
+  {
+    "name": "foo",
+    "address": "tcp://127.0.0.1:1234",
+    "filters": [
+      { "type" : "read", "name" : "fake", "config" : {} }
+    ]
+  }
+  )EOF";
+
+  ListenerHandle* listener_foo_update1 = expectListenerCreate(false);
+  EXPECT_CALL(*worker_, addListener(_, _)).Times(0);
+  EXPECT_CALL(*worker_, stopListener(_)).Times(0);
+  EXPECT_CALL(*listener_foo->drain_manager_, startDrainSequence(_)).Times(0);
+  EXPECT_TRUE(manager_->addOrUpdateListener(parseListenerFromJson(listener_foo_update1_json)));
+  checkStats(1, 1, 0, 0, 1, 0);
+  EXPECT_EQ(1UL,
+            server_.stats_store_.counter("listener_manager.listener_in_place_update").value());
+  EXPECT_EQ(listener_tag, manager_->listeners()[0].get().listenerTag());
+
+  // New connections get the filter chain of the update.
+  Network::MockConnection connection;
+  EXPECT_CALL(connection, initializeReadFilters()).WillOnce(Return(true));
+  EXPECT_TRUE(worker_listener.filterChainFactory().createFilterChain(connection));
+  EXPECT_EQ(0UL, listener_foo->filter_chains_built_);
+  EXPECT_EQ(1UL, listener_foo_update1->filter_chains_built_);
+
+  // Removing the update drains the connections of both.
+  EXPECT_CALL(*worker_, stopListener(_));
+  EXPECT_CALL(*listener_foo_update1->drain_manager_, startDrainSequence(_));
+  EXPECT_TRUE(manager_->removeListener("foo"));
+
+  EXPECT_CALL(*listener_foo->drain_manager_, drainClose()).WillOnce(Return(false));
+  EXPECT_CALL(server_.drain_manager_, drainClose()).WillOnce(Return(false));
+  EXPECT_CALL(*listener_foo_update1->drain_manager_, drainClose()).WillOnce(Return(true));
+  EXPECT_TRUE(listener_foo->context_->drainDecision().drainClose());
+
+  EXPECT_CALL(*worker_, removeListener(_, _));
+  listener_foo_update1->drain_manager_->drain_sequence_completion_();
+  EXPECT_CALL(*listener_foo, onDestroy());
+  EXPECT_CALL(*listener_foo_update1, onDestroy());
+  worker_->callRemovalCompletion();
+  checkStats(1, 1, 1, 0, 0, 0);
+}
+
 } // namespace Server
 } // namespace Envoy
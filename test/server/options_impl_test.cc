@@ -40,29 +40,81 @@ TEST(OptionsImplTest, All) {
       "envoy --mode validate --concurrency 2 -c hello --admin-address-path path --restart-epoch 1 "
       "--local-address-ip-version v6 -l info --service-cluster cluster --service-node node "
       "--service-zone zone --file-flush-interval-msec 9000 --drain-time-s 60 "
-      "--parent-shutdown-time-s 90");
+      "--parent-shutdown-time-s 90 --max-stats 100000 --drain-close-rate 50 "
+      "--startup-trace-path trace --log-queue-size 1000 --max-recycled-objects 64 "
+      "--config-snapshot-dir snapshots --epoll-changelist");
   EXPECT_EQ(Server::Mode::Validate, options->mode());
   EXPECT_EQ(2U, options->concurrency());
   EXPECT_EQ("hello", options->configPath());
   EXPECT_EQ("path", options->adminAddressPath());
+  EXPECT_EQ("trace", options->startupTracePath());
+  EXPECT_EQ("snapshots", options->configSnapshotDir());
   EXPECT_EQ(Network::Address::IpVersion::v6, options->localAddressIpVersion());
   EXPECT_EQ(1U, options->restartEpoch());
   EXPECT_EQ(spdlog::level::info, options->logLevel());
+  EXPECT_EQ(1000U, options->logQueueSize());
+  EXPECT_EQ(64U, options->maxRecycledObjects());
+  EXPECT_TRUE(options->epollChangelist());
   EXPECT_EQ("cluster", options->serviceClusterName());
   EXPECT_EQ("node", options->serviceNodeName());
   EXPECT_EQ("zone", options->serviceZone());
   EXPECT_EQ(std::chrono::milliseconds(9000), options->fileFlushIntervalMsec());
   EXPECT_EQ(std::chrono::seconds(60), options->drainTime());
+  EXPECT_EQ(50U, options->drainCloseRate());
   EXPECT_EQ(std::chrono::seconds(90), options->parentShutdownTime());
+  EXPECT_EQ(100000U, options->maxStats());
+}
+
+TEST(OptionsImplTest, AdditionalConfigPaths) {
+  std::unique_ptr<OptionsImpl> options =
+      createOptionsImpl("envoy --mode validate -c hello --additional-config-path world "
+                        "--additional-config-path again");
+  EXPECT_EQ("hello", options->configPath());
+  EXPECT_EQ(std::vector<std::string>({"world", "again"}), options->additionalConfigPaths());
+
+  EXPECT_EXIT(createOptionsImpl("envoy -c hello --additional-config-path world"),
+              testing::ExitedWithCode(1),
+              "only accepted in validate mode");
 }
 
 TEST(OptionsImplTest, DefaultParams) {
   std::unique_ptr<OptionsImpl> options = createOptionsImpl("envoy -c hello");
   EXPECT_EQ(std::chrono::seconds(600), options->drainTime());
+  EXPECT_EQ(0U, options->drainCloseRate());
   EXPECT_EQ(std::chrono::seconds(900), options->parentShutdownTime());
   EXPECT_EQ("", options->adminAddressPath());
+  EXPECT_EQ("", options->startupTracePath());
+  EXPECT_EQ("", options->configSnapshotDir());
   EXPECT_EQ(Network::Address::IpVersion::v4, options->localAddressIpVersion());
   EXPECT_EQ(Server::Mode::Serve, options->mode());
+  EXPECT_EQ(16384U, options->maxStats());
+  EXPECT_FALSE(options->epollChangelist());
+}
+
+TEST(OptionsImplTest, Cpuset) {
+  std::unique_ptr<OptionsImpl> options = createOptionsImpl("envoy -c hello --cpuset 2-4,8");
+  EXPECT_EQ((std::vector<uint32_t>{2, 3, 4, 8}), options->cpuset());
+  EXPECT_EQ(4U, options->concurrency());
+
+  options = createOptionsImpl("envoy -c hello --cpuset 1 --concurrency 2");
+  EXPECT_EQ(std::vector<uint32_t>{1}, options->cpuset());
+  EXPECT_EQ(2U, options->concurrency());
+
+  options = createOptionsImpl("envoy -c hello");
+  EXPECT_TRUE(options->cpuset().empty());
+
+  std::vector<uint32_t> cpus;
+  EXPECT_TRUE(OptionsImpl::parseCpuset("0,3-3,5-6", cpus));
+  EXPECT_EQ((std::vector<uint32_t>{0, 3, 5, 6}), cpus);
+  EXPECT_FALSE(OptionsImpl::parseCpuset("3-1", cpus));
+  EXPECT_FALSE(OptionsImpl::parseCpuset("-1", cpus));
+  EXPECT_FALSE(OptionsImpl::parseCpuset("1,,2", cpus));
+  EXPECT_FALSE(OptionsImpl::parseCpuset("1-2-3", cpus));
+  EXPECT_FALSE(OptionsImpl::parseCpuset("a", cpus));
+}
+
+TEST(OptionsImplTest, BadCpuset) {
+  EXPECT_DEATH(createOptionsImpl("envoy -c hello --cpuset 4-2"), "error: invalid cpuset '4-2'");
 }
 
 TEST(OptionsImplTest, BadCliOption) {
@@ -0,0 +1,176 @@
+#include "common/stats/stats_impl.h"
+#include "common/upstream/resource_manager_impl.h"
+
+#include "server/overload_manager_impl.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/runtime/mocks.h"
+#include "test/mocks/server/mocks.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using testing::Field;
+using testing::Invoke;
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace Envoy {
+namespace Server {
+
+class OverloadManagerImplTest : public testing::Test {
+public:
+  OverloadManagerImplTest() : timer_(new Event::MockTimer(&dispatcher_)) {
+    EXPECT_CALL(listener_manager_, workerLoopDelay()).WillRepeatedly(Invoke([this]() {
+      return loop_delay_;
+    }));
+    EXPECT_CALL(*timer_, enableTimer(std::chrono::milliseconds(1000)));
+    overload_manager_.reset(new OverloadManagerImpl(dispatcher_, runtime_, stats_store_,
+                                                    listener_manager_,
+                                                    [this]() -> uint64_t { return allocated_; }));
+  }
+
+  void setThreshold(const std::string& key, uint64_t value) {
+    ON_CALL(runtime_.snapshot_, getInteger("overload.buffer_memory." + key, _))
+        .WillByDefault(Return(value));
+  }
+
+  void setLoopDelayThreshold(const std::string& key, uint64_t value) {
+    ON_CALL(runtime_.snapshot_, getInteger("overload.loop_delay." + key, _))
+        .WillByDefault(Return(value));
+  }
+
+  void refresh() {
+    EXPECT_CALL(*timer_, enableTimer(std::chrono::milliseconds(1000)));
+    timer_->callback_();
+  }
+
+  uint64_t gauge(const std::string& name) { return stats_store_.gauge("overload." + name).value(); }
+
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  Event::MockTimer* timer_;
+  NiceMock<Runtime::MockLoader> runtime_;
+  Stats::IsolatedStoreImpl stats_store_;
+  MockListenerManager listener_manager_;
+  uint64_t allocated_{};
+  std::chrono::milliseconds loop_delay_{};
+  OverloadManagerImplPtr overload_manager_;
+};
+
+TEST_F(OverloadManagerImplTest, Disabled) {
+  allocated_ = 1024 * 1024 * 1024;
+  EXPECT_CALL(listener_manager_, applyOverloadActions(_)).Times(0);
+  refresh();
+  EXPECT_EQ(allocated_, gauge("buffer_memory_allocated"));
+  EXPECT_EQ(0UL, gauge("stop_accepting"));
+  EXPECT_EQ(0UL, gauge("reduce_watermarks"));
+}
+
+TEST_F(OverloadManagerImplTest, StopAccepting) {
+  setThreshold("stop_accepting_bytes", 1000);
+  allocated_ = 999;
+  EXPECT_CALL(listener_manager_, applyOverloadActions(_)).Times(0);
+  refresh();
+
+  allocated_ = 1000;
+  EXPECT_CALL(listener_manager_,
+              applyOverloadActions(Field(&Network::OverloadActions::stop_accepting_, true)));
+  refresh();
+  EXPECT_EQ(1UL, gauge("stop_accepting"));
+
+  // Actions are only pushed again when they change.
+  EXPECT_CALL(listener_manager_, applyOverloadActions(_)).Times(0);
+  refresh();
+
+  allocated_ = 500;
+  EXPECT_CALL(listener_manager_,
+              applyOverloadActions(Field(&Network::OverloadActions::stop_accepting_, false)));
+  refresh();
+  EXPECT_EQ(0UL, gauge("stop_accepting"));
+}
+
+TEST_F(OverloadManagerImplTest, ReduceWatermarks) {
+  setThreshold("reduce_watermarks_bytes", 1000);
+  setThreshold("reduced_watermark_percent", 25);
+  allocated_ = 2000;
+  EXPECT_CALL(listener_manager_,
+              applyOverloadActions(Field(&Network::OverloadActions::buffer_limit_percent_, 25)));
+  refresh();
+  EXPECT_EQ(1UL, gauge("reduce_watermarks"));
+
+  allocated_ = 0;
+  EXPECT_CALL(listener_manager_,
+              applyOverloadActions(Field(&Network::OverloadActions::buffer_limit_percent_, 100)));
+  refresh();
+  EXPECT_EQ(0UL, gauge("reduce_watermarks"));
+}
+
+TEST_F(OverloadManagerImplTest, ShedLoad) {
+  setThreshold("shed_load_bytes", 1000);
+  allocated_ = 1000;
+  EXPECT_CALL(listener_manager_, applyOverloadActions(_)).Times(0);
+  refresh();
+
+  // Shedding is requested on every refresh for as long as memory stays over the threshold.
+  allocated_ = 1500;
+  EXPECT_CALL(listener_manager_,
+              applyOverloadActions(Field(&Network::OverloadActions::shed_bytes_, 500)))
+      .Times(2);
+  refresh();
+  refresh();
+  EXPECT_EQ(2UL, stats_store_.counter("overload.shed_load").value());
+}
+
+// Accepting stops while the workers are behind, whatever the memory held by buffers.
+TEST_F(OverloadManagerImplTest, LoopDelayStopAccepting) {
+  setLoopDelayThreshold("stop_accepting_ms", 200);
+  loop_delay_ = std::chrono::milliseconds(150);
+  EXPECT_CALL(listener_manager_, applyOverloadActions(_)).Times(0);
+  refresh();
+  EXPECT_EQ(150UL, gauge("worker_loop_delay_ms"));
+
+  loop_delay_ = std::chrono::milliseconds(250);
+  EXPECT_CALL(listener_manager_,
+              applyOverloadActions(Field(&Network::OverloadActions::stop_accepting_, true)));
+  refresh();
+  EXPECT_EQ(1UL, gauge("loop_delay_stop_accepting"));
+  EXPECT_EQ(1UL, gauge("stop_accepting"));
+
+  loop_delay_ = std::chrono::milliseconds(0);
+  EXPECT_CALL(listener_manager_,
+              applyOverloadActions(Field(&Network::OverloadActions::stop_accepting_, false)));
+  refresh();
+  EXPECT_EQ(0UL, gauge("loop_delay_stop_accepting"));
+}
+
+// Resource limits of all clusters shrink while the workers are behind, and are restored when
+// they catch up or the overload manager goes away.
+TEST_F(OverloadManagerImplTest, LoopDelayReduceResourceLimits) {
+  setLoopDelayThreshold("reduce_resource_limits_ms", 100);
+  setLoopDelayThreshold("reduced_resource_limit_percent", 10);
+  NiceMock<Runtime::MockLoader> cluster_runtime;
+  Upstream::ResourceManagerImpl resource_manager(cluster_runtime, "", 1000, 1000, 1000, 5);
+
+  loop_delay_ = std::chrono::milliseconds(100);
+  refresh();
+  EXPECT_EQ(1UL, gauge("reduce_resource_limits"));
+  EXPECT_EQ(100UL, resource_manager.connections().max());
+  EXPECT_EQ(100UL, resource_manager.requests().max());
+  // Limits never drop to 0.
+  EXPECT_EQ(1UL, resource_manager.retries().max());
+
+  loop_delay_ = std::chrono::milliseconds(50);
+  refresh();
+  EXPECT_EQ(0UL, gauge("reduce_resource_limits"));
+  EXPECT_EQ(1000UL, resource_manager.connections().max());
+
+  loop_delay_ = std::chrono::milliseconds(100);
+  refresh();
+  EXPECT_EQ(100UL, resource_manager.connections().max());
+  overload_manager_.reset();
+  EXPECT_EQ(1000UL, resource_manager.connections().max());
+}
+
+} // namespace Server
+} // namespace Envoy
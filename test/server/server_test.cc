@@ -1,5 +1,6 @@
 #include "common/common/version.h"
 #include "common/network/address_impl.h"
+#include "common/stats/histogram_impl.h"
 #include "common/thread_local/thread_local_impl.h"
 
 #include "server/server.h"
@@ -12,7 +13,11 @@
 #include "gtest/gtest.h"
 
 using testing::InSequence;
+using testing::NiceMock;
+using testing::Property;
+using testing::Return;
 using testing::StrictMock;
+using testing::_;
 
 namespace Envoy {
 namespace Server {
@@ -31,7 +36,58 @@ TEST(ServerInstanceUtil, flushHelper) {
 
   std::list<Stats::SinkPtr> sinks;
   sinks.emplace_back(std::move(sink));
-  InstanceUtil::flushCountersAndGaugesToSinks(sinks, store);
+  InstanceUtil::flushMetricsToSinks(sinks, store);
+}
+
+TEST(ServerInstanceUtil, flushOnlyChanged) {
+  InSequence s;
+
+  Stats::IsolatedStoreImpl store;
+  store.counter("hello").inc();
+  store.counter("unchanged").inc();
+  store.gauge("world").set(5);
+  store.gauge("unchanged").set(1);
+  std::unique_ptr<Stats::MockSink> sink(new NiceMock<Stats::MockSink>());
+  Stats::MockSink& sink_ref = *sink;
+  std::list<Stats::SinkPtr> sinks;
+  sinks.emplace_back(std::move(sink));
+  InstanceUtil::flushMetricsToSinks(sinks, store);
+
+  store.counter("hello").add(2);
+  store.gauge("world").set(5);
+  EXPECT_CALL(sink_ref, beginFlush());
+  EXPECT_CALL(sink_ref, flushCounter("hello", 2));
+  EXPECT_CALL(sink_ref, flushGauge("world", 5));
+  EXPECT_CALL(sink_ref, endFlush());
+  InstanceUtil::flushMetricsToSinks(sinks, store);
+
+  EXPECT_CALL(sink_ref, beginFlush());
+  EXPECT_CALL(sink_ref, flushCounter(_, _)).Times(0);
+  EXPECT_CALL(sink_ref, flushGauge(_, _)).Times(0);
+  EXPECT_CALL(sink_ref, endFlush());
+  InstanceUtil::flushMetricsToSinks(sinks, store);
+}
+
+TEST(ServerInstanceUtil, flushHistograms) {
+  InSequence s;
+
+  Stats::ParentHistogramImplSharedPtr used(new Stats::ParentHistogramImpl("used"));
+  Stats::ParentHistogramImplSharedPtr unused(new Stats::ParentHistogramImpl("unused"));
+  used->recordValue(5);
+  used->recordValue(7);
+
+  NiceMock<Stats::MockStore> store;
+  ON_CALL(store, histograms())
+      .WillByDefault(Return(std::list<Stats::HistogramSharedPtr>{used, unused}));
+  std::unique_ptr<Stats::MockSink> sink(new StrictMock<Stats::MockSink>());
+  EXPECT_CALL(*sink, beginFlush());
+  EXPECT_CALL(*sink, flushHistogram("used", Property(&Stats::HistogramStatistics::sampleSum, 12)));
+  EXPECT_CALL(*sink, endFlush());
+
+  std::list<Stats::SinkPtr> sinks;
+  sinks.emplace_back(std::move(sink));
+  InstanceUtil::flushMetricsToSinks(sinks, store);
+  EXPECT_EQ(2U, used->cumulativeStatistics().sampleCount());
 }
 
 // Class creates minimally viable server instance for testing.
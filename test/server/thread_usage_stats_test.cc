@@ -0,0 +1,81 @@
+#include <chrono>
+#include <vector>
+
+#include "common/common/thread.h"
+#include "common/stats/stats_impl.h"
+
+#include "server/thread_usage_stats.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Server {
+
+class ThreadUsageStatsTest : public testing::Test {
+public:
+  Thread::UsageRegistry::Sample sample(const std::string& prefix, uint64_t cpu_ms, uint64_t idle_ms,
+                                       bool has_idle_time = true) {
+    return {prefix, std::chrono::milliseconds(cpu_ms), std::chrono::milliseconds(idle_ms),
+            has_idle_time};
+  }
+
+  MonotonicTime at(uint64_t ms) { return MonotonicTime(std::chrono::milliseconds(ms)); }
+
+  Stats::IsolatedStoreImpl stats_store_;
+  ThreadUsageStats stats_{stats_store_};
+};
+
+// Utilization is reported over the interval between two flushes.
+TEST_F(ThreadUsageStatsTest, Interval) {
+  stats_.flush({sample("worker.", 100, 0), sample("flush.", 10, 0, false)}, at(1000));
+  EXPECT_EQ(0UL, stats_store_.gauge("worker.cpu_percent").value());
+
+  stats_.flush({sample("worker.", 850, 200), sample("flush.", 60, 0, false)}, at(2000));
+  EXPECT_EQ(75UL, stats_store_.gauge("worker.cpu_percent").value());
+  EXPECT_EQ(20UL, stats_store_.gauge("worker.idle_percent").value());
+  EXPECT_EQ(5UL, stats_store_.gauge("flush.cpu_percent").value());
+  EXPECT_EQ(0UL, stats_store_.gauge("flush.idle_percent").value());
+
+  stats_.flush({sample("worker.", 950, 1100)}, at(3000));
+  EXPECT_EQ(10UL, stats_store_.gauge("worker.cpu_percent").value());
+  EXPECT_EQ(90UL, stats_store_.gauge("worker.idle_percent").value());
+}
+
+// A thread added again under the same prefix starts over, as does one that was gone for a flush.
+TEST_F(ThreadUsageStatsTest, Restart) {
+  stats_.flush({sample("worker.", 500, 500)}, at(1000));
+  stats_.flush({sample("worker.", 100, 100)}, at(2000));
+  EXPECT_EQ(0UL, stats_store_.gauge("worker.cpu_percent").value());
+
+  stats_.flush({}, at(3000));
+  stats_.flush({sample("worker.", 2000, 100)}, at(4000));
+  EXPECT_EQ(0UL, stats_store_.gauge("worker.cpu_percent").value());
+
+  stats_.flush({sample("worker.", 2500, 100)}, at(5000));
+  EXPECT_EQ(50UL, stats_store_.gauge("worker.cpu_percent").value());
+}
+
+// The calling thread is sampled until it is removed.
+TEST(UsageRegistryTest, AddRemove) {
+  Thread::UsageRegistry& registry = Thread::UsageRegistry::instance();
+  const uint64_t handle = registry.add(
+      "test.", []() -> std::chrono::nanoseconds { return std::chrono::milliseconds(7); });
+
+  bool found = false;
+  for (const Thread::UsageRegistry::Sample& sample : registry.sample()) {
+    if (sample.prefix_ == "test.") {
+      found = true;
+      EXPECT_TRUE(sample.has_idle_time_);
+      EXPECT_EQ(std::chrono::milliseconds(7), sample.idle_time_);
+    }
+  }
+  EXPECT_TRUE(found);
+
+  registry.remove(handle);
+  for (const Thread::UsageRegistry::Sample& sample : registry.sample()) {
+    EXPECT_NE("test.", sample.prefix_);
+  }
+}
+
+} // namespace Server
+} // namespace Envoy
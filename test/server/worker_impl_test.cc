@@ -33,7 +33,7 @@ public:
   NiceMock<MockGuardDog> guard_dog_;
   DefaultTestHooks hooks_;
   WorkerImpl worker_{tls_, hooks_, Event::DispatcherPtr{dispatcher_},
-                     Network::ConnectionHandlerPtr{handler_}};
+                     Network::ConnectionHandlerPtr{handler_}, 1, Optional<uint32_t>()};
   Event::TimerPtr no_exit_timer_ = dispatcher_->createTimer([]() -> void {});
 };
 
@@ -46,6 +46,7 @@ TEST_F(WorkerImplTest, BasicFlow) {
   // thread starts running.
   NiceMock<MockListener> listener;
   ON_CALL(listener, listenerTag()).WillByDefault(Return(1));
+  EXPECT_CALL(listener, workerSocket(1));
   EXPECT_CALL(*handler_, addListener(_, _, _, 1, _))
       .WillOnce(InvokeWithoutArgs([current_thread_id]() -> void {
         EXPECT_NE(current_thread_id, std::this_thread::get_id());